@@ -0,0 +1,127 @@
+# Generates src/NotepadNext/languages/manifest.lua, which is everything needed to pick a language for a file
+# and build the file dialog filters without loading the full language definitions. Run it again whenever a
+# language is added or its extensions or first_line patterns change.
+
+import os
+import re
+
+languagesDirectory = "../src/NotepadNext/languages"
+
+# Display name and the module it is defined in
+languages = [
+    ("ActionScript", "actionscript"),
+    ("ADA", "ada"),
+    ("Assembly", "asm"),
+    ("ASN.1", "asn1"),
+    ("asp", "asp"),
+    ("autoIt", "autoit"),
+    ("AviSynth", "avs"),
+    ("BaanC", "baanc"),
+    ("bash", "bash"),
+    ("Batch", "batch"),
+    ("BlitzBasic", "blitzbasic"),
+    ("C", "c"),
+    ("Caml", "caml"),
+    ("CMakeFile", "cmake"),
+    ("COBOL", "cobol"),
+    ("Csound", "csound"),
+    ("CoffeeScript", "coffeescript"),
+    ("C++", "cpp"),
+    ("C#", "cs"),
+    ("CSS", "css"),
+    ("SCSS", "scss"),
+    ("D", "d"),
+    ("DIFF", "diff"),
+    ("Erlang", "erlang"),
+    ("ESCRIPT", "escript"),
+    ("Forth", "forth"),
+    ("Fortran (free form)", "fortran"),
+    ("Fortran (fixed form)", "fortran77"),
+    ("FreeBasic", "freebasic"),
+    ("GUI4CLI", "gui4cli"),
+    ("Go", "go"),
+    ("Haskell", "haskell"),
+    ("HTML", "html"),
+    ("ini file", "ini"),
+    ("InnoSetup", "inno"),
+    ("Intel HEX", "ihex"),
+    ("Java", "java"),
+    ("JavaScript", "javascript"),
+    ("JSON", "json"),
+    ("KiXtart", "kix"),
+    ("LISP", "lisp"),
+    ("LaTeX", "latex"),
+    ("Lua", "lua"),
+    ("Less", "less"),
+    ("Makefile", "makefile"),
+    ("Markdown", "markdown"),
+    ("Matlab", "matlab"),
+    ("MMIXAL", "mmixal"),
+    ("Nimrod", "nimrod"),
+    ("extended crontab", "nncrontab"),
+    ("Dos Style", "nfo"),
+    ("NSIS", "nsis"),
+    ("OScript", "oscript"),
+    ("Objective-C", "objc"),
+    ("Pascal", "pascal"),
+    ("Perl", "perl"),
+    ("PHP", "php"),
+    ("Postscript", "postscript"),
+    ("PowerShell", "powershell"),
+    ("Properties file", "props"),
+    ("PureBasic", "purebasic"),
+    ("Python", "python"),
+    ("R", "r"),
+    ("REBOL", "rebol"),
+    ("registry", "registry"),
+    ("RC", "rc"),
+    ("Ruby", "ruby"),
+    ("Rust", "rust"),
+    ("Scheme", "scheme"),
+    ("Smalltalk", "smalltalk"),
+    ("spice", "spice"),
+    ("SQL", "sql"),
+    ("S-Record", "srec"),
+    ("Swift", "swift"),
+    ("TCL", "tcl"),
+    ("Tektronix extended HEX", "tehex"),
+    ("TeX", "tex"),
+    ("Text", "text"),
+    ("VB / VBS", "vb"),
+    ("txt2tags", "txt2tags"),
+    ("Verilog", "verilog"),
+    ("VHDL", "vhdl"),
+    ("Visual Prolog", "visualprolog"),
+    ("XML", "xml"),
+    ("YAML", "yaml"),
+]
+
+def StringList(source, field):
+    # The string literals are copied as they are, so any escapes mean the same thing in the manifest
+    match = re.search(r"^L\." + field + r"\s*=\s*\{(.*?)\}", source, re.MULTILINE | re.DOTALL)
+    if not match:
+        return None
+    return re.findall(r'"(?:[^"\\]|\\.)*"', match.group(1))
+
+def ManifestEntry(name, module):
+    with open(os.path.join(languagesDirectory, module + ".lua"), encoding="utf-8") as f:
+        source = f.read()
+
+    fields = ['module = "' + module + '"']
+    for field in ["extensions", "first_line"]:
+        strings = StringList(source, field)
+        if strings is not None:
+            fields.append(field + " = {" + ", ".join(strings) + "}")
+
+    return '    ["' + name + '"] = {' + ", ".join(fields) + "},"
+
+def main():
+    out = ["-- Generated by scripts/GenerateLanguageManifest.py, do not edit", "return {"]
+    out += [ManifestEntry(name, module) for name, module in languages]
+    out.append("}")
+
+    with open(os.path.join(languagesDirectory, "manifest.lua"), "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(out) + "\n")
+
+if __name__ == "__main__":
+    main()
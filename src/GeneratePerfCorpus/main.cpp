@@ -0,0 +1,484 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// Generates a set of files for measuring how the editor copes with large or unusual input: file loading,
+// the lexers, folding, the hex viewer and Find in Files. The output only depends on the seed and scale, so
+// the same files can be regenerated on any machine instead of being checked in.
+//
+//     GeneratePerfCorpus <output directory> [--scale 0.01] [--seed 1] [--only <name>...] [--stamp <file>]
+//
+// A scale of 1 produces the full sized files (several GB in total), smaller scales shrink everything. The
+// stamp file is written once everything else is, so a build can tell the corpus is complete.
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Sizes at a scale of 1
+static const double MINIFIED_JS_BYTES = 100.0 * 1024 * 1024;
+static const double CSV_LINES = 10.0 * 1000 * 1000;
+static const double MIXED_EOL_LOG_LINES = 5.0 * 1000 * 1000;
+static const double UTF16_LOG_LINES = 2.0 * 1000 * 1000;
+static const double SHIFT_JIS_LINES = 1000.0 * 1000;
+static const double JSON_DEPTH = 2000;
+static const double JSON_OBJECTS = 200.0 * 1000;
+static const double BLOB_BYTES = 256.0 * 1024 * 1024;
+static const double TREE_FILES = 100.0 * 1000;
+
+static const char *const WORDS[] = {
+    "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "theta", "lambda", "sigma", "omega",
+    "request", "response", "error", "warning", "value", "index", "buffer", "editor", "search", "match",
+};
+
+// Already in Shift-JIS so nothing has to be converted: 日本語 文字列 検索 置換 編集 保存 読み込み ファイル テキスト エディタ
+static const char *const JAPANESE[] = {
+    "\x93\xFA\x96\x7B\x8C\xEA", "\x95\xB6\x8E\x9A\x97\xF1", "\x8C\x9F\x8D\xF5", "\x92\x75\x8A\xB7", "\x95\xD2\x8F\x57",
+    "\x95\xDB\x91\xB6", "\x93\xC7\x82\xDD\x8D\x9E\x82\xDD", "\x83\x74\x83\x40\x83\x43\x83\x8B",
+    "\x83\x65\x83\x4C\x83\x58\x83\x67", "\x83\x47\x83\x66\x83\x42\x83\x5E",
+};
+static const char JAPANESE_COMMA[] = "\x81\x41";
+
+static const char *const LEVELS[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+static const char *const EXTENSIONS[] = {".txt", ".cpp", ".h", ".py", ".json", ".log"};
+
+template<typename T, size_t N>
+static constexpr size_t countOf(const T (&)[N]) { return N; }
+
+// splitmix64, which unlike the standard distributions gives the same numbers with every compiler
+class Random
+{
+public:
+    explicit Random(const std::string &seed)
+    {
+        // FNV-1a of the seed
+        state = 14695981039346656037ULL;
+        for (unsigned char c : seed) {
+            state = (state ^ c) * 1099511628211ULL;
+        }
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Inclusive at both ends
+    int between(int low, int high) { return low + static_cast<int>(next() % static_cast<uint64_t>(high - low + 1)); }
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    template<typename T, size_t N>
+    T choice(const T (&items)[N]) { return items[next() % N]; }
+
+private:
+    uint64_t state;
+};
+
+// Collects the output and writes it a megabyte at a time
+class Output
+{
+public:
+    explicit Output(const std::string &path) : path(path), file(std::fopen(path.c_str(), "wb"))
+    {
+        if (!file) {
+            std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+            std::exit(1);
+        }
+
+        buffer.reserve(FLUSH_SIZE + 4096);
+    }
+
+    ~Output()
+    {
+        flush();
+        if (std::fclose(file) != 0) {
+            std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+            std::exit(1);
+        }
+    }
+
+    void write(const char *data, size_t length)
+    {
+        buffer.append(data, length);
+        if (buffer.size() >= FLUSH_SIZE) {
+            flush();
+        }
+    }
+
+    void write(const std::string &text) { write(text.data(), text.size()); }
+    void write(const char *text) { write(text, std::strlen(text)); }
+
+    void printf(const char *format, ...)
+#ifdef __GNUC__
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+private:
+    static const size_t FLUSH_SIZE = 1024 * 1024;
+
+    void flush()
+    {
+        if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+            std::exit(1);
+        }
+        buffer.clear();
+    }
+
+    std::string path;
+    std::FILE *file;
+    std::string buffer;
+};
+
+void Output::printf(const char *format, ...)
+{
+    char line[4096];
+
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    write(line, static_cast<size_t>(length < 0 ? 0 : (length < int(sizeof(line)) ? length : int(sizeof(line)) - 1)));
+}
+
+static long long scaled(double value, double scale)
+{
+    const long long result = static_cast<long long>(value * scale);
+    return result < 1 ? 1 : result;
+}
+
+static bool makeDirectory(const std::string &path)
+{
+    for (size_t i = 1; i <= path.size(); ++i) {
+        if (i < path.size() && path[i] != '/' && path[i] != '\\') {
+            continue;
+        }
+
+        const std::string parent = path.substr(0, i);
+#ifdef _WIN32
+        _mkdir(parent.c_str());
+#else
+        mkdir(parent.c_str(), 0755);
+#endif
+    }
+
+#ifdef _WIN32
+    struct _stat info;
+    return _stat(path.c_str(), &info) == 0 && (info.st_mode & _S_IFDIR);
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+static std::string words(Random &random, int low, int high, const char *separator = " ")
+{
+    std::string text;
+    const int count = random.between(low, high);
+
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) {
+            text += separator;
+        }
+        text += random.choice(WORDS);
+    }
+
+    return text;
+}
+
+static std::string logLine(Random &random, long long i)
+{
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "2024-01-01 00:%02d:%02d.%03d [%s] ", int((i / 60000) % 60), int((i / 1000) % 60),
+                  int(i % 1000), random.choice(LEVELS));
+
+    return prefix + words(random, 3, 15);
+}
+
+static void minifiedJs(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+    const long long target = scaled(MINIFIED_JS_BYTES, scale);
+    long long written = 0;
+
+    // All of it on the one line
+    for (long long i = 0; written < target; ++i) {
+        char chunk[256];
+        const int length = std::snprintf(chunk, sizeof(chunk), "function %s%lld(a,b){var c=a+b*%d;if(c>%d){return \"%s\"}return c};",
+                                         random.choice(WORDS), i, random.between(0, 999), random.between(0, 99999), random.choice(WORDS));
+        out.write(chunk, static_cast<size_t>(length));
+        written += length;
+    }
+}
+
+static void csv(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+    out.write("id,name,value,ratio,flag\n");
+
+    const long long lines = scaled(CSV_LINES, scale);
+    for (long long i = 0; i < lines; ++i) {
+        const char *name = random.choice(WORDS);
+        const int value = random.between(-100000, 100000);
+        const double ratio = random.unit();
+        const char *flag = random.next() & 1 ? "true" : "false";
+
+        out.printf("%lld,%s,%d,%.4f,%s\n", i, name, value, ratio, flag);
+    }
+}
+
+static void mixedEolLog(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+
+    const long long lines = scaled(MIXED_EOL_LOG_LINES, scale);
+    for (long long i = 0; i < lines; ++i) {
+        out.write(logLine(random, i));
+        out.write(random.unit() < 0.5 ? "\r\n" : "\n");
+    }
+}
+
+static void utf16Log(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+    out.write("\xFF\xFE", 2);
+
+    // The lines are all ASCII, so each byte only needs a zero after it
+    std::string wide;
+    const long long lines = scaled(UTF16_LOG_LINES, scale);
+    for (long long i = 0; i < lines; ++i) {
+        const std::string line = logLine(random, i) + "\r\n";
+
+        wide.clear();
+        for (char c : line) {
+            wide += c;
+            wide += '\0';
+        }
+        out.write(wide);
+    }
+}
+
+static void shiftJis(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+
+    const long long lines = scaled(SHIFT_JIS_LINES, scale);
+    for (long long i = 0; i < lines; ++i) {
+        out.printf("%lld: ", i);
+
+        const int count = random.between(2, 12);
+        for (int j = 0; j < count; ++j) {
+            if (j > 0) {
+                out.write(JAPANESE_COMMA);
+            }
+            out.write(random.choice(JAPANESE));
+        }
+
+        out.write("\r\n");
+    }
+}
+
+static void nestedJson(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+    const long long depth = scaled(JSON_DEPTH, scale);
+    const long long objects = scaled(JSON_OBJECTS, scale);
+
+    out.write("{\n");
+
+    // One very deep chain to stress fold levels, then lots of shallow siblings
+    for (long long level = 0; level < depth; ++level) {
+        out.write(std::string(2 * (level + 1), ' '));
+        out.printf("\"level%lld\": {\n", level);
+    }
+    out.write(std::string(2 * (depth + 1), ' '));
+    out.write("\"leaf\": true\n");
+    for (long long level = depth - 1; level >= 0; --level) {
+        out.write(std::string(2 * (level + 1), ' '));
+        out.write(level == 0 ? "},\n" : "}\n");
+    }
+
+    out.write("  \"items\": [\n");
+    for (long long i = 0; i < objects; ++i) {
+        const char *name = random.choice(WORDS);
+
+        std::string tags;
+        const int count = random.between(0, 5);
+        for (int j = 0; j < count; ++j) {
+            if (j > 0) {
+                tags += ", ";
+            }
+            tags += '"';
+            tags += random.choice(WORDS);
+            tags += '"';
+        }
+
+        out.printf("    {\n      \"id\": %lld,\n      \"name\": \"%s\",\n      \"tags\": [%s]\n    }%s\n", i, name, tags.c_str(),
+                   i + 1 < objects ? "," : "");
+    }
+    out.write("  ]\n}\n");
+}
+
+static void blob(const std::string &path, Random &random, double scale)
+{
+    Output out(path);
+
+    std::vector<char> block(1024 * 1024);
+    long long remaining = scaled(BLOB_BYTES, scale);
+
+    while (remaining > 0) {
+        const size_t size = static_cast<size_t>(remaining < static_cast<long long>(block.size()) ? remaining : block.size());
+
+        for (size_t i = 0; i < size; i += 8) {
+            const uint64_t value = random.next();
+            for (size_t j = 0; j < 8 && i + j < size; ++j) {
+                block[i + j] = static_cast<char>(value >> (8 * j));
+            }
+        }
+
+        out.write(block.data(), size);
+        remaining -= static_cast<long long>(size);
+    }
+}
+
+static void fileTree(const std::string &path, Random &random, double scale)
+{
+    const long long files = scaled(TREE_FILES, scale);
+
+    for (long long i = 0; i < files; ++i) {
+        char directory[64];
+        std::snprintf(directory, sizeof(directory), "/d%02d/d%02d", int(i % 100), int((i / 100) % 100));
+
+        if (!makeDirectory(path + directory)) {
+            std::fprintf(stderr, "Cannot create %s%s\n", path.c_str(), directory);
+            std::exit(1);
+        }
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "/file%06lld%s", i, random.choice(EXTENSIONS));
+
+        Output out(path + directory + name);
+        const int lines = random.between(1, 40);
+        for (int j = 0; j < lines; ++j) {
+            out.write(words(random, 1, 12));
+            out.write("\n");
+        }
+    }
+}
+
+struct Generator
+{
+    const char *name;
+    void (*generate)(const std::string &path, Random &random, double scale);
+};
+
+static const Generator GENERATORS[] = {
+    {"minified.js", minifiedJs},
+    {"big.csv", csv},
+    {"mixed_eol.log", mixedEolLog},
+    {"utf16le_bom.log", utf16Log},
+    {"shift_jis.txt", shiftJis},
+    {"nested.json", nestedJson},
+    {"blob.bin", blob},
+    {"tree", fileTree},
+};
+
+static int usage(const char *program)
+{
+    std::fprintf(stderr, "usage: %s <output directory> [--scale 1] [--seed 1] [--only <name>...] [--stamp <file>]\n", program);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string output;
+    std::string stamp;
+    std::vector<std::string> only;
+    double scale = 1.0;
+    long long seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+
+        if (argument == "--scale" && i + 1 < argc) {
+            scale = std::atof(argv[++i]);
+        }
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = std::atoll(argv[++i]);
+        }
+        else if (argument == "--stamp" && i + 1 < argc) {
+            stamp = argv[++i];
+        }
+        else if (argument == "--only") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                only.push_back(argv[++i]);
+            }
+        }
+        else if (output.empty() && argument[0] != '-') {
+            output = argument;
+        }
+        else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (output.empty() || scale <= 0) {
+        return usage(argv[0]);
+    }
+
+    if (!makeDirectory(output)) {
+        std::fprintf(stderr, "Cannot create %s\n", output.c_str());
+        return 1;
+    }
+
+    for (const Generator &generator : GENERATORS) {
+        if (!only.empty() && std::find(only.begin(), only.end(), generator.name) == only.end()) {
+            continue;
+        }
+
+        std::printf("Generating %s\n", generator.name);
+        std::fflush(stdout);
+
+        // Each file gets its own generator so they don't change when another one is skipped or resized
+        Random random(std::to_string(seed) + ":" + generator.name);
+        generator.generate(output + "/" + generator.name, random, scale);
+    }
+
+    if (!stamp.empty()) {
+        Output out(stamp);
+        out.printf("scale %g seed %lld\n", scale, seed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+# This file is part of Notepad Next.
+# Copyright 2024 Justin Dailey
+#
+# Notepad Next is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Notepad Next is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+
+# Build time tool that compiles the bundled Lua scripts to bytecode, see NotepadNext.pro
+
+TARGET = LuaBytecode
+
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= qt app_bundle
+
+include(../Config.pri)
+include(../lua.pri)
+
+SOURCES += main.cpp
+
+# Keep it in a known place no matter the build configuration so it can be run from NotepadNext.pro
+DESTDIR = $$OUT_PWD
+
+OBJECTS_DIR = build/obj
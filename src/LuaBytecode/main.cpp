@@ -0,0 +1,131 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// Compiles Lua source files to bytecode and writes them out as a C++ source file defining
+// LuaBytecodeBundle::chunks, sorted by name so they can be binary searched.
+//
+//     LuaBytecode <output.cpp> <file.lua>...
+//
+// Each chunk is named after the file's directory and file name, e.g. "languages/cpp.lua", which
+// matches where the source is found in the application's resources.
+
+#include "lua.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::string bundleName(const std::string &path)
+{
+    std::string name = path;
+    std::replace(name.begin(), name.end(), '\\', '/');
+
+    const std::string::size_type fileSlash = name.rfind('/');
+    if (fileSlash == std::string::npos || fileSlash == 0) {
+        return name;
+    }
+
+    const std::string::size_type directorySlash = name.rfind('/', fileSlash - 1);
+    return directorySlash == std::string::npos ? name : name.substr(directorySlash + 1);
+}
+
+static int appendToString(lua_State *, const void *data, size_t size, void *userData)
+{
+    static_cast<std::string *>(userData)->append(static_cast<const char *>(data), size);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <output.cpp> <file.lua>...\n", argv[0]);
+        return 1;
+    }
+
+    lua_State *L = luaL_newstate();
+    std::vector<std::pair<std::string, std::string>> chunks;
+
+    for (int i = 2; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[i]);
+            return 1;
+        }
+
+        std::stringstream source;
+        source << file.rdbuf();
+        const std::string text = source.str();
+
+        const std::string name = bundleName(argv[i]);
+
+        // Use the resource path so error messages and tracebacks read the same as when loading the source
+        const std::string chunkName = "@:/" + name;
+
+        if (luaL_loadbuffer(L, text.data(), text.size(), chunkName.c_str()) != LUA_OK) {
+            std::fprintf(stderr, "%s: %s\n", argv[0], lua_tostring(L, -1));
+            return 1;
+        }
+
+        // Debug information is kept so errors still have line numbers
+        std::string bytecode;
+        lua_dump(L, appendToString, &bytecode, 0);
+        lua_pop(L, 1);
+
+        chunks.emplace_back(name, std::move(bytecode));
+    }
+
+    lua_close(L);
+
+    std::sort(chunks.begin(), chunks.end());
+
+    std::ofstream output(argv[1], std::ios::binary | std::ios::trunc);
+    if (!output) {
+        std::fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    output << "// Generated by LuaBytecode, do not edit\n\n";
+    output << "#include \"LuaBytecodeBundle.h\"\n\n";
+
+    char hex[8];
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const std::string &bytecode = chunks[i].second;
+
+        output << "// " << chunks[i].first << "\n";
+        output << "static const unsigned char chunk" << i << "[] = {";
+        for (size_t j = 0; j < bytecode.size(); ++j) {
+            std::snprintf(hex, sizeof(hex), "0x%02x,", static_cast<unsigned char>(bytecode[j]));
+            output << ((j % 16) == 0 ? "\n    " : " ") << hex;
+        }
+        output << "\n};\n\n";
+    }
+
+    output << "const LuaBytecodeBundle::Chunk LuaBytecodeBundle::chunks[] = {\n";
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        output << "    {\"" << chunks[i].first << "\", chunk" << i << ", sizeof(chunk" << i << ")},\n";
+    }
+    output << "};\n\n";
+    output << "const size_t LuaBytecodeBundle::chunkCount = " << chunks.size() << ";\n";
+
+    return output ? 0 : 1;
+}
@@ -23,6 +23,23 @@ TEMPLATE = subdirs
 
 SUBDIRS = NotepadNext
 
+# Compiles the bundled Lua scripts at build time, see NotepadNext/NotepadNext.pro
+!cross_compile:!no_lua_bytecode {
+    SUBDIRS += LuaBytecode
+    NotepadNext.depends = LuaBytecode
+}
+
+# QtTest benchmarks of the editor core, add "CONFIG+=benchmarks" to build them as well
+benchmarks {
+    SUBDIRS += GeneratePerfCorpus benchmarks
+    benchmarks.depends = GeneratePerfCorpus
+}
+
+# QtTest tests of the editor core, add "CONFIG+=tests" to build them as well and run them with "make check"
+tests {
+    SUBDIRS += tests
+}
+
 
 # Extra Windows targets
 win32 {
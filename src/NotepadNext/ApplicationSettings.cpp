@@ -17,9 +17,16 @@
  */
 
 #include "ApplicationSettings.h"
+#include "RegexEngine.h"
+#include "Scintilla.h"
 
 #include <QApplication>
 #include <QFont>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 
 #define CREATE_SETTING(group, name, lname, type, default) \
 ApplicationSetting<type> name{#group "/" #name, default};\
@@ -35,11 +42,121 @@ ApplicationSetting<type> name{#group "/" #name, default};\
 
 
 
+// How long changes are collected before being written
+static const int WRITE_DELAY = 500;
+
+namespace {
+
+struct SettingsCache {
+    QMutex mutex;
+
+    // Every key read or written so far. Ones that aren't in the file are held as an invalid QVariant.
+    QHash<QString, QVariant> values;
+
+    // Changes that haven't been written yet
+    QHash<QString, QVariant> pending;
+
+    // Held while writing so a flush() waits for a write that is already going
+    QMutex writeMutex;
+};
+
+SettingsCache &cache()
+{
+    static SettingsCache settingsCache;
+    return settingsCache;
+}
+
+}
+
 ApplicationSettings::ApplicationSettings(QObject *parent)
     : QSettings{parent}
 {
 }
 
+void ApplicationSettings::flush()
+{
+    writePendingChanges();
+}
+
+void ApplicationSettings::resetCache()
+{
+    SettingsCache &c = cache();
+    QMutexLocker locker(&c.mutex);
+
+    c.values.clear();
+    c.pending.clear();
+}
+
+QVariant ApplicationSettings::cachedValue(const QString &key)
+{
+    SettingsCache &c = cache();
+    QMutexLocker locker(&c.mutex);
+
+    auto it = c.values.constFind(key);
+    if (it != c.values.constEnd()) {
+        return *it;
+    }
+
+    const QVariant value = QSettings().value(key);
+    c.values.insert(key, value);
+
+    return value;
+}
+
+void ApplicationSettings::setCachedValue(const QString &key, const QVariant &value)
+{
+    {
+        SettingsCache &c = cache();
+        QMutexLocker locker(&c.mutex);
+
+        c.values.insert(key, value);
+        c.pending.insert(key, value);
+    }
+
+    if (QCoreApplication::instance() == Q_NULLPTR) {
+        writePendingChanges();
+        return;
+    }
+
+    // Restart the timer on the GUI thread, whichever thread this is
+    QMetaObject::invokeMethod(QCoreApplication::instance(), []() {
+        static QTimer *timer = Q_NULLPTR;
+
+        if (timer == Q_NULLPTR) {
+            timer = new QTimer(QCoreApplication::instance());
+            timer->setSingleShot(true);
+            timer->setInterval(WRITE_DELAY);
+
+            QObject::connect(timer, &QTimer::timeout, []() {
+                QThreadPool::globalInstance()->start([]() { writePendingChanges(); });
+            });
+        }
+
+        timer->start();
+    });
+}
+
+void ApplicationSettings::writePendingChanges()
+{
+    SettingsCache &c = cache();
+    QMutexLocker writeLocker(&c.writeMutex);
+
+    QHash<QString, QVariant> pending;
+    {
+        QMutexLocker locker(&c.mutex);
+        pending.swap(c.pending);
+    }
+
+    if (pending.isEmpty())
+        return;
+
+    QSettings settings;
+    for (auto it = pending.constBegin(); it != pending.constEnd(); ++it) {
+        settings.setValue(it.key(), it.value());
+    }
+    settings.sync();
+}
+
 CREATE_SETTING(Gui, ShowMenuBar, showMenuBar, bool, true)
 CREATE_SETTING(Gui, ShowToolBar, showToolBar, bool, true)
 CREATE_SETTING(Gui, ShowTabBar, showTabBar, bool, true)
@@ -54,14 +171,35 @@ CREATE_SETTING(Gui, CombineSearchResults, combineSearchResults, bool, false)
 CREATE_SETTING(App, RestorePreviousSession, restorePreviousSession, bool, false)
 CREATE_SETTING(App, RestoreUnsavedFiles, restoreUnsavedFiles, bool, false)
 CREATE_SETTING(App, RestoreTempFiles, restoreTempFiles, bool, false)
+CREATE_SETTING(App, SessionAutoSaveInterval, sessionAutoSaveInterval, int, 60)
 
 CREATE_SETTING(App, Translation, translation, QString, QStringLiteral(""))
 
+CREATE_SETTING(App, LargeFileThreshold, largeFileThreshold, int, 1024)
+
+CREATE_SETTING(App, HibernateAfter, hibernateAfter, int, 0)
+CREATE_SETTING(App, MaxAwakeEditors, maxAwakeEditors, int, 0)
+
+CREATE_SETTING(App, UndoActionLimit, undoActionLimit, int, 0)
+CREATE_SETTING(App, UndoMemoryLimit, undoMemoryLimit, int, 512)
+
+CREATE_SETTING(App, MemorySoftLimit, memorySoftLimit, int, 0)
+
+CREATE_SETTING(App, ScriptInstructionBudget, scriptInstructionBudget, int, 0)
+
+CREATE_SETTING(Performance, LayoutThreads, layoutThreads, int, []() { return QThread::idealThreadCount(); })
+CREATE_SETTING(Performance, PositionCacheSize, positionCacheSize, int, 4096)
+CREATE_SETTING(Performance, LayoutCacheMode, layoutCacheMode, int, SC_CACHE_PAGE)
+CREATE_SETTING(Performance, RegexEngine, regexEngine, int, RegexEngine::QtRegularExpression)
+
 CREATE_SETTING(Editor, ShowWhitespace, showWhitespace, bool, false);
 CREATE_SETTING(Editor, ShowEndOfLine, showEndOfLine, bool, false);
 CREATE_SETTING(Editor, ShowWrapSymbol, showWrapSymbol, bool, false);
 CREATE_SETTING(Editor, ShowIndentGuide, showIndentGuide, bool, true);
+CREATE_SETTING(Editor, ShowChangeHistory, showChangeHistory, bool, false)
 CREATE_SETTING(Editor, WordWrap, wordWrap, bool, false)
+CREATE_SETTING(Editor, SpellCheck, spellCheck, bool, false)
+CREATE_SETTING(Editor, SpellCheckDictionary, spellCheckDictionary, QString, QStringLiteral(""))
 CREATE_SETTING(Editor, FontName, fontName, QString, QStringLiteral("Courier New"))
 CREATE_SETTING(Editor, FontSize, fontSize, int, []() { return qApp->font().pointSize() + 2; })
 CREATE_SETTING(Editor, AdditionalWordChars, additionalWordChars, QString, QStringLiteral(""));
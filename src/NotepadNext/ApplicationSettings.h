@@ -61,6 +61,10 @@ Q_SIGNAL\
     void lname##Changed(type lname);\
 
 
+// Typed settings (the get() and set() below, and the DEFINE_SETTING accessors) are read from the file once and then
+// served from one copy shared by the whole application, so looking one up doesn't need a QSettings at all. Changes go
+// into that copy straight away and are written to the file a moment later on a worker thread, a batch at a time.
+// Everything else, e.g. groups and arrays, goes through QSettings as usual, so the two shouldn't share keys.
 class ApplicationSettings : public QSettings
 {
     Q_OBJECT
@@ -70,16 +74,33 @@ public:
 
 public:
     template <typename T>
-    T get(const char *key, const T &defaultValue) const
-    { return value(QLatin1String(key), defaultValue).template value<T>(); }
+    static T get(const char *key, const T &defaultValue)
+    {
+        const QVariant value = cachedValue(QLatin1String(key));
+        return value.isValid() ? value.template value<T>() : defaultValue;
+    }
 
     template <typename T>
-    T get(const ApplicationSetting<T> &setting) const
-    { return get(setting.key(), setting.getDefault()); }
+    static T get(const ApplicationSetting<T> &setting)
+    {
+        const QVariant value = cachedValue(QLatin1String(setting.key()));
+        return value.isValid() ? value.template value<T>() : setting.getDefault();
+    }
 
     template <typename T>
-    void set(const ApplicationSetting<T> &setting, const T &value)
-    { setValue(QLatin1String(setting.key()), value); }
+    static void set(const ApplicationSetting<T> &setting, const T &value)
+    { setCachedValue(QLatin1String(setting.key()), QVariant::fromValue(value)); }
+
+    // Writes any changes that are still waiting, e.g. before the application exits
+    static void flush();
+
+    // Forgets what has been read so far, for when the file was changed some other way
+    static void resetCache();
+
+private:
+    static QVariant cachedValue(const QString &key);
+    static void setCachedValue(const QString &key, const QVariant &value);
+    static void writePendingChanges();
 
 public:
     DEFINE_SETTING(ShowMenuBar, showMenuBar, bool)
@@ -96,14 +117,35 @@ public:
     DEFINE_SETTING(RestorePreviousSession, restorePreviousSession, bool)
     DEFINE_SETTING(RestoreUnsavedFiles, restoreUnsavedFiles, bool)
     DEFINE_SETTING(RestoreTempFiles, restoreTempFiles, bool)
+    DEFINE_SETTING(SessionAutoSaveInterval, sessionAutoSaveInterval, int) // in seconds, 0 only saves the session on exit
 
     DEFINE_SETTING(Translation, translation, QString)
 
+    DEFINE_SETTING(LargeFileThreshold, largeFileThreshold, int) // in MB, 0 never offers the large file viewer
+
+    DEFINE_SETTING(HibernateAfter, hibernateAfter, int) // in minutes, 0 never hibernates idle editors
+    DEFINE_SETTING(MaxAwakeEditors, maxAwakeEditors, int) // 0 doesn't limit how many editors are kept in memory
+
+    DEFINE_SETTING(UndoActionLimit, undoActionLimit, int) // per editor, 0 keeps every undo action
+    DEFINE_SETTING(UndoMemoryLimit, undoMemoryLimit, int) // in MB per editor, 0 doesn't limit the undo history's size
+
+    DEFINE_SETTING(MemorySoftLimit, memorySoftLimit, int) // in MB, 0 only gives memory back when the system runs low
+
+    DEFINE_SETTING(ScriptInstructionBudget, scriptInstructionBudget, int) // in millions of instructions, 0 lets scripts run forever
+
+    DEFINE_SETTING(LayoutThreads, layoutThreads, int) // per tab, how many threads Scintilla may lay out lines on
+    DEFINE_SETTING(PositionCacheSize, positionCacheSize, int) // per tab, how many measured pieces of text are kept
+    DEFINE_SETTING(LayoutCacheMode, layoutCacheMode, int) // one of SC_CACHE_*
+    DEFINE_SETTING(RegexEngine, regexEngine, int) // one of RegexEngine::Engine
+
     DEFINE_SETTING(ShowWhitespace, showWhitespace, bool);
     DEFINE_SETTING(ShowEndOfLine, showEndOfLine, bool);
     DEFINE_SETTING(ShowWrapSymbol, showWrapSymbol, bool)
     DEFINE_SETTING(ShowIndentGuide, showIndentGuide, bool)
+    DEFINE_SETTING(ShowChangeHistory, showChangeHistory, bool) // for files opened from then on, it is set per editor
     DEFINE_SETTING(WordWrap, wordWrap, bool);
+    DEFINE_SETTING(SpellCheck, spellCheck, bool)
+    DEFINE_SETTING(SpellCheckDictionary, spellCheckDictionary, QString) // a word list, empty looks for one of the system's
     DEFINE_SETTING(FontName, fontName, QString);
     DEFINE_SETTING(FontSize, fontSize, int);
     DEFINE_SETTING(AdditionalWordChars, additionalWordChars, QString);
@@ -0,0 +1,257 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BackgroundSearcher.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+
+
+// How many hits to collect before handing them back to the GUI thread
+const int BATCH_SIZE = 500;
+
+BackgroundSearcher::BackgroundSearcher(QObject *parent) :
+    QObject(parent),
+    state(std::make_shared<SharedState>())
+{
+}
+
+BackgroundSearcher::~BackgroundSearcher()
+{
+    // The worker only holds on to the shared state so it is safe to let it wind down on its own
+    cancel();
+}
+
+void BackgroundSearcher::addEditor(ScintillaNext *editor)
+{
+    Job job;
+
+    job.editor = editor;
+    job.text = *editor->textSnapshot();
+    job.wordChars = editor->wordChars();
+    job.whitespaceChars = editor->whitespaceChars();
+    job.changeGeneration = editor->changeGeneration();
+
+    jobs.append(job);
+
+    searchedGenerations.insert(editor, editor->changeGeneration());
+}
+
+bool BackgroundSearcher::isOutdated(ScintillaNext *editor) const
+{
+    auto it = searchedGenerations.constFind(editor);
+
+    return it != searchedGenerations.constEnd() && it.value() != editor->changeGeneration();
+}
+
+bool BackgroundSearcher::canSearch(const QByteArray &pattern, int flags)
+{
+    BufferSearcher searcher(pattern, flags);
+
+    return searcher.isValid() && searcher.canSearch();
+}
+
+void BackgroundSearcher::start(const QByteArray &pattern, int flags, bool collectResults)
+{
+    Q_ASSERT(!running);
+
+    running = true;
+
+    QPointer<BackgroundSearcher> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+    const QVector<Job> work = jobs;
+    jobs.clear();
+
+    QThreadPool::globalInstance()->start([=]() {
+        // Everything posted back goes through the application object since this object may be deleted at any point
+        auto post = [=](auto func) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    func(self.data());
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        qint64 totalBytes = 0;
+        for (const Job &job : work) {
+            totalBytes += job.text.size();
+        }
+
+        qint64 bytesDone = 0;
+        int totalHits = 0;
+        int lastPercent = -1;
+
+        auto reportProgress = [&](qint64 position) {
+            const int percent = totalBytes > 0 ? static_cast<int>((bytesDone + position) * 100 / totalBytes) : 100;
+
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                post([=](BackgroundSearcher *s) { emit s->progressChanged(percent); });
+            }
+        };
+
+        for (const Job &job : work) {
+            if (sharedState->canceled)
+                break;
+
+            BufferSearcher searcher(pattern, flags);
+            searcher.setCharacterClasses(job.wordChars, job.whitespaceChars);
+
+            const char *data = job.text.constData();
+            const qsizetype length = job.text.size();
+            const QPointer<ScintillaNext> editor = job.editor;
+
+            QVector<SearchHit> hits;
+
+            if (collectResults) {
+                searcher.forEachHit(data, length, [&](const SearchHit &hit, qsizetype start) {
+                    if (sharedState->canceled)
+                        return false;
+
+                    ++totalHits;
+                    hits.append(hit);
+
+                    if (hits.size() >= BATCH_SIZE) {
+                        post([=](BackgroundSearcher *s) { emit s->resultsFound(editor, hits); });
+                        hits.clear();
+
+                        reportProgress(start);
+                    }
+
+                    return true;
+                });
+            }
+            else {
+                searcher.forEachMatch(data, length, 0, length, [&](qsizetype start, qsizetype) {
+                    ++totalHits;
+
+                    if ((totalHits % BATCH_SIZE) == 0)
+                        reportProgress(start);
+
+                    return !sharedState->canceled;
+                });
+            }
+
+            if (!hits.isEmpty()) {
+                post([=](BackgroundSearcher *s) { emit s->resultsFound(editor, hits); });
+            }
+
+            bytesDone += length;
+            reportProgress(0);
+        }
+
+        const bool canceled = sharedState->canceled;
+
+        post([=](BackgroundSearcher *s) {
+            s->running = false;
+            emit s->finished(totalHits, canceled);
+        });
+    });
+}
+
+void BackgroundSearcher::startReplace(const QByteArray &pattern, int flags, const QByteArray &replacement, bool preview)
+{
+    Q_ASSERT(!running);
+
+    running = true;
+
+    QPointer<BackgroundSearcher> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+    const QVector<Job> work = jobs;
+    jobs.clear();
+
+    QThreadPool::globalInstance()->start([=]() {
+        auto post = [=](auto func) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    func(self.data());
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        int totalReplacements = 0;
+        int jobsDone = 0;
+
+        for (const Job &job : work) {
+            if (sharedState->canceled)
+                break;
+
+            BufferSearcher searcher(pattern, flags);
+            searcher.setCharacterClasses(job.wordChars, job.whitespaceChars);
+
+            std::vector<Sci_CharacterRange> ranges;
+            QVector<QByteArray> replacements;
+
+            // A literal replacement is the same for every match so only keep one copy of it
+            const bool sameForEveryMatch = !(flags & SCFIND_REGEXP);
+            if (sameForEveryMatch)
+                replacements.append(replacement);
+
+            searcher.forEachReplacement(job.text.constData(), job.text.size(), replacement, [&](qsizetype start, qsizetype end, const QByteArray &text) {
+                ranges.push_back({static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(end)});
+
+                if (!sameForEveryMatch)
+                    replacements.append(text);
+
+                return !sharedState->canceled;
+            });
+
+            // Nothing gets replaced in a document unless all of its matches were found
+            if (sharedState->canceled)
+                break;
+
+            totalReplacements += static_cast<int>(ranges.size());
+
+            if (!ranges.empty()) {
+                const QPointer<ScintillaNext> editor = job.editor;
+
+                if (preview) {
+                    ReplacePreview documentPreview;
+                    documentPreview.ranges = std::move(ranges);
+                    documentPreview.replacements = replacements;
+                    documentPreview.changeGeneration = job.changeGeneration;
+                    documentPreview.makeHunks(job.text.constData(), job.text.size());
+
+                    post([=](BackgroundSearcher *s) { emit s->replacementsPreviewed(editor, documentPreview); });
+                }
+                else {
+                    post([=](BackgroundSearcher *s) { emit s->replacementsFound(editor, ranges, replacements); });
+                }
+            }
+
+            ++jobsDone;
+
+            const int percent = jobsDone * 100 / work.size();
+            post([=](BackgroundSearcher *s) { emit s->progressChanged(percent); });
+        }
+
+        const bool canceled = sharedState->canceled;
+
+        post([=](BackgroundSearcher *s) {
+            s->running = false;
+            emit s->finished(totalReplacements, canceled);
+        });
+    });
+}
+
+void BackgroundSearcher::cancel()
+{
+    state->canceled = true;
+}
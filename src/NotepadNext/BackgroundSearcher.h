@@ -0,0 +1,98 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QVector>
+
+#include "BufferSearcher.h"
+#include "ReplacePreview.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+class ScintillaNext;
+
+// Searches a snapshot of one or more editors on a QThreadPool so the GUI never blocks. Results are
+// delivered in batches on the thread that owns this object.
+class BackgroundSearcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BackgroundSearcher(QObject *parent = nullptr);
+    ~BackgroundSearcher() override;
+
+    // Takes a copy of the editor's current text, so any changes made after this are not seen by the search
+    void addEditor(ScintillaNext *editor);
+
+    // Whether the editor's text has changed since it was added
+    bool isOutdated(ScintillaNext *editor) const;
+
+    // Check if the pattern can be searched on raw bytes, else the caller needs to search using Scintilla itself
+    static bool canSearch(const QByteArray &pattern, int flags);
+
+    // If collectResults is false only the number of matches is reported
+    void start(const QByteArray &pattern, int flags, bool collectResults = true);
+
+    // Works out the text each match is replaced with but leaves it up to the receiver to apply them, which
+    // must be done on the GUI thread anyway. All of an editor's replacements are reported together.
+    // If preview is true, replacementsPreviewed() is emitted instead, with the matches already grouped into hunks
+    void startReplace(const QByteArray &pattern, int flags, const QByteArray &replacement, bool preview = false);
+
+    bool isRunning() const { return running; }
+
+    // Results the worker had already posted can still arrive after this is true
+    bool isCanceled() const { return state->canceled; }
+
+public slots:
+    void cancel();
+
+signals:
+    void resultsFound(ScintillaNext *editor, const QVector<SearchHit> &hits);
+    void replacementsFound(ScintillaNext *editor, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements);
+    void replacementsPreviewed(ScintillaNext *editor, const ReplacePreview &preview);
+    void progressChanged(int percent);
+    void finished(int totalHits, bool canceled);
+
+private:
+    struct Job
+    {
+        QPointer<ScintillaNext> editor;
+        QByteArray text;
+        QByteArray wordChars;
+        QByteArray whitespaceChars;
+        quint64 changeGeneration;
+    };
+
+    struct SharedState
+    {
+        std::atomic_bool canceled{false};
+    };
+
+    QVector<Job> jobs;
+    QHash<const ScintillaNext *, quint64> searchedGenerations;
+    std::shared_ptr<SharedState> state;
+    bool running = false;
+};
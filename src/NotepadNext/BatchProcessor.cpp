@@ -0,0 +1,462 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BatchProcessor.h"
+#include "EditorManager.h"
+#include "EncodingDetector.h"
+#include "FileFilter.h"
+#include "Finder.h"
+#include "Logging.h"
+#include "LuaExtension.h"
+#include "MacroManager.h"
+#include "MacroPlayer.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+
+
+BatchProcessor::BatchProcessor(NotepadNextApplication *app) :
+    QObject(app),
+    app(app)
+{
+}
+
+void BatchProcessor::setMacro(const Macro &value)
+{
+    macro = value;
+    hasMacro = true;
+}
+
+bool BatchProcessor::start(const Options &batchOptions, QString &error)
+{
+    qInfo(Q_FUNC_INFO);
+
+    Q_ASSERT(!running);
+
+    options = batchOptions;
+
+    if (!hasMacro && options.macroName.isEmpty() && options.scriptFile.isEmpty() && options.find.isEmpty()) {
+        error = tr("Nothing to do, give a macro, a script or something to find and replace");
+        return false;
+    }
+
+    if (!hasMacro && !options.macroName.isEmpty()) {
+        // The manager is only needed long enough to find the macro
+        MacroManager macroManager;
+
+        for (const Macro *m : macroManager.availableMacros()) {
+            if (m->getName() == options.macroName) {
+                setMacro(*m);
+                break;
+            }
+        }
+
+        if (!hasMacro) {
+            error = tr("There is no saved macro named \"%1\"").arg(options.macroName);
+            return false;
+        }
+    }
+
+    if (!options.scriptFile.isEmpty()) {
+        QFile file(options.scriptFile);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = tr("Can not read the script \"%1\": %2").arg(options.scriptFile, file.errorString());
+            return false;
+        }
+
+        script = file.readAll();
+    }
+
+    for (ScintillaNext *editor : qAsConst(options.editors)) {
+        // A clone is another view of its source's document, which would otherwise get it twice
+        if (editor->isClone())
+            continue;
+
+        names.append(editor->isFile() ? editor->getFilePath() : editor->getName());
+        openEditors.append(editor);
+        wasOpen.append(true);
+    }
+
+    for (const QString &filePath : collectFiles()) {
+        ScintillaNext *editor = app->getEditorManager()->getEditorByFilePath(filePath);
+
+        if (editor && openEditors.contains(editor))
+            continue;
+
+        names.append(filePath);
+        openEditors.append(editor);
+        wasOpen.append(editor != Q_NULLPTR);
+    }
+
+    if (names.isEmpty()) {
+        error = tr("No files to work on");
+        return false;
+    }
+
+    results.resize(names.size());
+
+    // Enough to keep the workers busy reading and writing while the edits are made here
+    maxInFlight = qMax(1, QThread::idealThreadCount()) * 2;
+
+    running = true;
+    timer.start();
+
+    // Everything could be done without waiting on anything, so let whoever started it get ready for finished() first
+    QMetaObject::invokeMethod(this, [=]() { startNext(); }, Qt::QueuedConnection);
+
+    return true;
+}
+
+void BatchProcessor::cancel()
+{
+    if (!running || canceled)
+        return;
+
+    qInfo(Q_FUNC_INFO);
+
+    canceled = true;
+
+    // Anything not started yet is left as it is
+    for (int i = nextItem; i < names.size(); ++i) {
+        results[i] = {Outcome::Skipped, tr("canceled")};
+    }
+    itemsDone += names.size() - nextItem;
+    nextItem = names.size();
+
+    for (MacroPlayer *player : findChildren<MacroPlayer *>()) {
+        player->cancel();
+    }
+
+    // Nothing may be in flight, in which case this is where it finishes
+    startNext();
+}
+
+QStringList BatchProcessor::collectFiles() const
+{
+    const FileFilter filter(options.filters);
+    QStringList collected;
+
+    for (const QString &path : options.paths) {
+        const QFileInfo info(path);
+
+        if (!info.isDir()) {
+            collected.append(info.absoluteFilePath());
+            continue;
+        }
+
+        QStringList directories{info.absoluteFilePath()};
+        while (!directories.isEmpty()) {
+            QDirIterator it(directories.takeLast(), QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+
+            while (it.hasNext()) {
+                it.next();
+                const QFileInfo entry = it.fileInfo();
+
+                if (entry.isDir()) {
+                    // Don't follow links to directories, they can easily be cycles
+                    if (options.recursive && !entry.isSymLink() && entry.fileName() != QStringLiteral(".git") && filter.acceptsDirectory(entry.fileName()))
+                        directories.append(entry.absoluteFilePath());
+                }
+                else if (filter.acceptsFile(entry.fileName())) {
+                    collected.append(entry.absoluteFilePath());
+                }
+            }
+        }
+    }
+
+    // Gives the same report every time, and a file given twice is only worked on once
+    std::sort(collected.begin(), collected.end());
+    collected.erase(std::unique(collected.begin(), collected.end()), collected.end());
+
+    return collected;
+}
+
+void BatchProcessor::startNext()
+{
+    while (inFlight < maxInFlight && nextItem < names.size()) {
+        const int index = nextItem++;
+        ScintillaNext *editor = openEditors.at(index);
+
+        if (wasOpen.at(index) && editor == Q_NULLPTR) {
+            results[index] = {Outcome::Skipped, tr("closed")};
+            ++itemsDone;
+            continue;
+        }
+
+        if (editor == Q_NULLPTR) {
+            const QString &filePath = names.at(index);
+
+            if (!QFileInfo::exists(filePath)) {
+                results[index] = {Outcome::Failed, tr("does not exist")};
+                ++itemsDone;
+                continue;
+            }
+
+            if (EncodingDetector::isBinaryFile(filePath)) {
+                results[index] = {Outcome::Skipped, tr("binary file")};
+                ++itemsDone;
+                continue;
+            }
+
+            if (options.useEditorManager)
+                editor = app->getEditorManager()->createEditorFromFile(filePath);
+            else
+                editor = ScintillaNext::fromFile(filePath, false, true);
+
+            if (editor == Q_NULLPTR) {
+                results[index] = {Outcome::Failed, tr("could not be read")};
+                ++itemsDone;
+                continue;
+            }
+
+            openEditors[index] = editor;
+        }
+
+        ++inFlight;
+
+        // Big files are read by a worker, anything else is already there but still goes through the event loop so this loop isn't re-entered
+        if (editor->isLoading()) {
+            connect(editor, &ScintillaNext::loadingFinished, this, [=](bool complete) {
+                process(editor, index, complete);
+            });
+        }
+        else {
+            QPointer<ScintillaNext> guard = editor;
+
+            QMetaObject::invokeMethod(this, [=]() {
+                if (guard)
+                    process(guard, index, true);
+                else
+                    finishFile(Q_NULLPTR, index, Outcome::Failed, tr("closed"));
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    emit progressChanged(names.isEmpty() ? 100 : static_cast<int>(qint64(itemsDone) * 100 / names.size()));
+
+    if (running && inFlight == 0 && nextItem >= names.size()) {
+        running = false;
+
+        const bool success = !options.writeReport || writeReportFile();
+
+        emit finished(success && !canceled && std::none_of(results.cbegin(), results.cend(), [](const Result &result) { return result.outcome == Outcome::Failed; }));
+    }
+}
+
+void BatchProcessor::process(ScintillaNext *editor, int index, bool complete)
+{
+    if (!complete) {
+        finishFile(editor, index, Outcome::Failed, tr("only part of it could be read"));
+        return;
+    }
+
+    if (editor->readOnly()) {
+        finishFile(editor, index, Outcome::Failed, tr("read only"));
+        return;
+    }
+
+    if (canceled) {
+        finishFile(editor, index, Outcome::Skipped, tr("canceled"));
+        return;
+    }
+
+    // The macro, the script and the replacement can all be undone together, also for the open editors
+    editor->beginUndoAction();
+
+    if (!hasMacro) {
+        finishEdits(editor, index);
+        return;
+    }
+
+    // The player keeps things responsive, and can play it on each line at once on the workers
+    MacroPlayer *player = new MacroPlayer(&macro, editor, options.macroTimes > 0 ? options.macroTimes : -1, this);
+    player->setLineByLine(options.lineByLine);
+
+    QPointer<ScintillaNext> guard = editor;
+    connect(player, &MacroPlayer::finished, this, [=](bool playerCanceled) {
+        player->deleteLater();
+
+        if (guard.isNull()) {
+            finishFile(Q_NULLPTR, index, Outcome::Failed, tr("closed"));
+        }
+        else if (playerCanceled) {
+            guard->endUndoAction();
+            finishFile(guard, index, guard->modify() ? Outcome::Modified : Outcome::Skipped, tr("canceled"));
+        }
+        else {
+            finishEdits(guard, index);
+        }
+    });
+
+    player->start();
+}
+
+void BatchProcessor::finishEdits(ScintillaNext *editor, int index)
+{
+    QStringList changes;
+    bool scriptFailed = false;
+
+    if (!script.isEmpty()) {
+        LuaExtension::Instance().setEditor(editor);
+
+        scriptFailed = !LuaExtension::Instance().RunString(script.constData());
+    }
+
+    if (!scriptFailed && !options.find.isEmpty()) {
+        Finder finder(editor);
+        finder.setSearchFlags(options.searchFlags);
+        finder.setSearchText(QString::fromUtf8(options.find));
+
+        const int replacements = finder.replaceAll(QString::fromUtf8(options.replacement));
+        if (replacements > 0)
+            changes.append(tr("%n replacement(s)", "", replacements));
+    }
+
+    editor->endUndoAction();
+
+    if (scriptFailed) {
+        finishFile(editor, index, Outcome::Failed, tr("the script failed"));
+        return;
+    }
+
+    if (!editor->modify()) {
+        finishFile(editor, index, Outcome::Unchanged);
+        return;
+    }
+
+    // Open editors are left for the user to look over and save
+    if (wasOpen.at(index)) {
+        changes.append(tr("open, not saved"));
+        finishFile(editor, index, Outcome::Modified, changes.join(QStringLiteral(", ")));
+        return;
+    }
+
+    if (options.dryRun) {
+        changes.append(tr("not saved"));
+        finishFile(editor, index, Outcome::Modified, changes.join(QStringLiteral(", ")));
+        return;
+    }
+
+    // The file is written by a worker, to a temporary file that replaces it once it is complete
+    connect(editor, &ScintillaNext::saved, this, [=]() {
+        finishFile(editor, index, Outcome::Modified, changes.join(QStringLiteral(", ")));
+    });
+    connect(editor, &ScintillaNext::saveFailed, this, [=](QFileDevice::FileError error) {
+        finishFile(editor, index, Outcome::Failed, tr("could not be saved (error %1)").arg(error));
+    });
+
+    editor->saveInBackground();
+}
+
+void BatchProcessor::finishFile(ScintillaNext *editor, int index, Outcome outcome, const QString &detail)
+{
+    qCDebug(lcFile, "Batch finished %s", qUtf8Printable(names.at(index)));
+
+    results[index] = {outcome, detail};
+
+    if (editor) {
+        editor->disconnect(this);
+
+        if (!wasOpen.at(index)) {
+            editor->close();
+        }
+    }
+
+    --inFlight;
+    ++itemsDone;
+    startNext();
+}
+
+static const char *const OUTCOME_NAMES[] = {"modified", "unchanged", "skipped", "failed"};
+
+QString BatchProcessor::summary() const
+{
+    int counts[4] = {0, 0, 0, 0};
+
+    for (const Result &result : results) {
+        ++counts[static_cast<int>(result.outcome)];
+    }
+
+    QString text = tr("%1 files in %2 s: %3 modified, %4 unchanged, %5 skipped, %6 failed")
+                   .arg(names.size())
+                   .arg(timer.elapsed() / 1000.0, 0, 'f', 1)
+                   .arg(counts[0]).arg(counts[1]).arg(counts[2]).arg(counts[3]);
+
+    if (options.dryRun)
+        text += QLatin1Char(' ') + tr("(dry run, nothing was saved)");
+
+    return text;
+}
+
+QString BatchProcessor::report() const
+{
+    QString report;
+    QTextStream stream(&report);
+
+    for (int i = 0; i < names.size(); ++i) {
+        const Result &result = results.at(i);
+
+        // Files nothing happened to would only drown out the rest
+        if (result.outcome == Outcome::Unchanged)
+            continue;
+
+        stream << QString::fromLatin1(OUTCOME_NAMES[static_cast<int>(result.outcome)]).leftJustified(10) << QDir::toNativeSeparators(names.at(i));
+        if (!result.detail.isEmpty())
+            stream << " (" << result.detail << ")";
+        stream << '\n';
+    }
+
+    stream << summary() << '\n';
+    stream.flush();
+
+    return report;
+}
+
+bool BatchProcessor::writeReportFile() const
+{
+    const QString text = report();
+
+    if (options.reportFile.isEmpty()) {
+        fputs(text.toLocal8Bit().constData(), stdout);
+        fflush(stdout);
+        return true;
+    }
+
+    QSaveFile file(options.reportFile);
+    const QByteArray data = text.toUtf8();
+
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning("Unable to write the batch report to %s: %s", qUtf8Printable(options.reportFile), qUtf8Printable(file.errorString()));
+        fputs(text.toLocal8Bit().constData(), stdout);
+        return false;
+    }
+
+    return true;
+}
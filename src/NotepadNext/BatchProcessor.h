@@ -0,0 +1,137 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include "Macro.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QVector>
+
+
+class NotepadNextApplication;
+class ScintillaNext;
+
+// Runs a macro, a Lua script and/or a find and replace over many files, e.g. for --batch or running a macro in
+// every document of a folder. Each file gets an editor of its own that is never shown, and is saved once it has
+// been changed. Several files are in flight at once: reading and writing them happens on the global QThreadPool,
+// as does playing a macro line by line, while the rest of the edits run on this thread since Scintilla and the
+// Lua state belong to it. Editors that are already open are changed as they are and left for the user to save.
+// Everything done to one document is a single undo action.
+class BatchProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        QStringList paths; // files, and directories to take the files out of
+        QString filters; // see FileFilter, only used for the files in directories
+        bool recursive = true;
+        QVector<ScintillaNext *> editors; // open editors to work on as well
+
+        // Going through the EditorManager applies EditorConfig and the other rules to the files, but if there is a
+        // window they would all show up in it
+        bool useEditorManager = true;
+
+        QString macroName; // the saved macro to use, unless setMacro() was used
+        int macroTimes = 1; // 0 runs it until the end of the file
+        bool lineByLine = false; // see MacroPlayer::setLineByLine()
+
+        QString scriptFile;
+
+        QByteArray find;
+        QByteArray replacement;
+        int searchFlags = 0;
+
+        bool dryRun = false;
+        bool writeReport = true;
+        QString reportFile; // empty writes it to the console
+    };
+
+    explicit BatchProcessor(NotepadNextApplication *app);
+
+    void setMacro(const Macro &macro);
+
+    // Returns false if the options can't be used, e.g. the macro doesn't exist, with error saying why
+    bool start(const Options &options, QString &error);
+    bool isRunning() const { return running; }
+
+    // A line for each file that was changed, skipped or failed, then the totals
+    QString report() const;
+    QString summary() const;
+
+public slots:
+    // The files already being worked on still get finished, so none are left half done
+    void cancel();
+
+signals:
+    void progressChanged(int percent);
+    void finished(bool success);
+
+private:
+    enum class Outcome {
+        Modified,
+        Unchanged,
+        Skipped,
+        Failed
+    };
+
+    struct Result
+    {
+        Outcome outcome = Outcome::Skipped;
+        QString detail;
+    };
+
+    QStringList collectFiles() const;
+
+    void startNext();
+    void process(ScintillaNext *editor, int index, bool complete);
+    void finishEdits(ScintillaNext *editor, int index);
+    void finishFile(ScintillaNext *editor, int index, Outcome outcome, const QString &detail = QString());
+    bool writeReportFile() const;
+
+    NotepadNextApplication *app;
+    Options options;
+
+    Macro macro;
+    bool hasMacro = false;
+    QByteArray script;
+
+    // The open editors come first, followed by the files. A file that is already open is worked on in
+    // that editor, the rest get one of their own for as long as they are being worked on.
+    QStringList names;
+    QVector<QPointer<ScintillaNext>> openEditors;
+    QVector<bool> wasOpen;
+    QVector<Result> results;
+    int nextItem = 0;
+    int inFlight = 0;
+    int itemsDone = 0;
+    int maxInFlight = 1;
+    bool running = false;
+    bool canceled = false;
+
+    QElapsedTimer timer;
+};
+
+#endif // BATCHPROCESSOR_H
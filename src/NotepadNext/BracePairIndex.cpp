@@ -0,0 +1,249 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BracePairIndex.h"
+#include "ScintillaNext.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+#include <array>
+
+using namespace Scintilla;
+
+
+// The document is indexed in pieces of about this size while the application is idle
+const int CHUNK_SIZE = 1024 * 64;
+
+// How long each idle slice is allowed to run before giving control back to the event loop
+const int SLICE_BUDGET_MS = 8;
+
+// About 24 MB of entries, anything past this many braces is left for BraceMatch to search
+const size_t MAX_ENTRIES = 1024 * 1024;
+
+// An opening brace that has not found its partner yet
+const Sci_Position PENDING = -2;
+
+const int BRACE_KINDS = 4;
+
+// The kind of brace for each byte (starting from 1) or 0 if it isn't one
+static const std::array<unsigned char, 256> &braceKinds()
+{
+    static const std::array<unsigned char, 256> kinds = []() {
+        std::array<unsigned char, 256> k{};
+        k['('] = k[')'] = 1;
+        k['['] = k[']'] = 2;
+        k['{'] = k['}'] = 3;
+        k['<'] = k['>'] = 4;
+        return k;
+    }();
+
+    return kinds;
+}
+
+static bool isOpeningBrace(char c)
+{
+    return c == '(' || c == '[' || c == '{' || c == '<';
+}
+
+BracePairIndex::BracePairIndex(ScintillaNext *editor, QObject *parent) :
+    QObject(parent),
+    editor(editor),
+    timer(new QTimer(this)),
+    openBraces(256 * BRACE_KINDS)
+{
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &BracePairIndex::indexNextChunk);
+
+    connect(editor, &ScintillaEdit::notify, this, &BracePairIndex::notify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &BracePairIndex::reset);
+
+    // Restyling can change which braces get paired
+    editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ChangeStyle);
+
+    reset();
+}
+
+bool BracePairIndex::lookup(Sci_Position pos, Sci_Position &match) const
+{
+    if (pos < 0 || pos >= indexedTo) {
+        return false;
+    }
+
+    const auto it = std::lower_bound(entries.begin(), entries.end(), pos, [](const Entry &entry, Sci_Position position) {
+        return entry.position < position;
+    });
+
+    match = INVALID_POSITION;
+
+    // Everything before indexedTo is in the index, so it isn't a brace
+    if (it == entries.end() || it->position != pos) {
+        return true;
+    }
+
+    if (it->partner == INVALID_POSITION) {
+        return true;
+    }
+
+    if (it->partner >= 0 && it->partner < indexedTo) {
+        match = it->partner;
+        return true;
+    }
+
+    // Still looking for its partner, which can only be given up on once the whole document has been seen
+    return !needsRepair && it->partner == PENDING && indexedTo >= editor->length();
+}
+
+void BracePairIndex::notify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code != Notification::Modified) {
+        return;
+    }
+
+    if (FlagSet(pscn->modificationType, ModificationFlags::InsertText) ||
+        FlagSet(pscn->modificationType, ModificationFlags::DeleteText) ||
+        FlagSet(pscn->modificationType, ModificationFlags::ChangeStyle)) {
+        invalidateFrom(pscn->position);
+    }
+}
+
+void BracePairIndex::indexNextChunk()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    const Sci_Position startedAt = indexedTo;
+    const bool repaired = needsRepair;
+
+    if (needsRepair) {
+        repair();
+    }
+
+    // Braces are only paired with others of the same style, so stop where the lexer has got to
+    const Sci_Position styledTo = qMin<Sci_Position>(editor->endStyled(), editor->length());
+
+    while (indexedTo < styledTo && entries.size() < MAX_ENTRIES && elapsed.elapsed() < SLICE_BUDGET_MS) {
+        indexedTo = indexRange(indexedTo, qMin<Sci_Position>(styledTo, indexedTo + CHUNK_SIZE));
+    }
+
+    if (indexedTo >= styledTo || entries.size() >= MAX_ENTRIES) {
+        timer->stop();
+
+        if (repaired || indexedTo != startedAt) {
+            emit indexUpdated();
+        }
+    }
+}
+
+void BracePairIndex::reset()
+{
+    entries.clear();
+    entries.shrink_to_fit();
+
+    for (auto &stack : openBraces) {
+        stack.clear();
+    }
+
+    indexedTo = 0;
+    needsRepair = false;
+
+    timer->start();
+}
+
+void BracePairIndex::invalidateFrom(Sci_Position pos)
+{
+    // Styling mostly happens past what has been indexed, so this is usually nothing
+    if (pos >= indexedTo) {
+        if (!timer->isActive()) {
+            timer->start();
+        }
+        return;
+    }
+
+    // Putting the entries right is left until the next slice, so many edits in a row only pay for it once
+    indexedTo = qMax<Sci_Position>(0, pos);
+    needsRepair = true;
+
+    timer->start();
+}
+
+void BracePairIndex::repair()
+{
+    needsRepair = false;
+
+    const auto firstInvalid = std::lower_bound(entries.begin(), entries.end(), indexedTo, [](const Entry &entry, Sci_Position position) {
+        return entry.position < position;
+    });
+    entries.erase(firstInvalid, entries.end());
+
+    for (auto &stack : openBraces) {
+        stack.clear();
+    }
+
+    // Anything that was paired with a brace that has gone is waiting again
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry &entry = entries[i];
+
+        if (entry.opening && (entry.partner == PENDING || entry.partner >= indexedTo)) {
+            entry.partner = PENDING;
+            openBraces[entry.key].push_back(i);
+        }
+    }
+}
+
+Sci_Position BracePairIndex::indexRange(Sci_Position start, Sci_Position end)
+{
+    const std::array<unsigned char, 256> &kinds = braceKinds();
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(start, end - start));
+
+    for (Sci_Position i = 0; i < end - start; ++i) {
+        const unsigned char kind = kinds[static_cast<unsigned char>(text[i])];
+
+        if (kind == 0) {
+            continue;
+        }
+
+        if (entries.size() >= MAX_ENTRIES) {
+            return start + i;
+        }
+
+        const Sci_Position pos = start + i;
+        const unsigned short key = static_cast<unsigned short>(editor->styleAt(pos) * BRACE_KINDS + kind - 1);
+        std::vector<size_t> &open = openBraces[key];
+
+        if (isOpeningBrace(text[i])) {
+            open.push_back(entries.size());
+            entries.push_back({pos, PENDING, key, true});
+        }
+        else if (open.empty()) {
+            entries.push_back({pos, INVALID_POSITION, key, false});
+        }
+        else {
+            Entry &partner = entries[open.back()];
+            const Sci_Position partnerPosition = partner.position;
+            open.pop_back();
+
+            partner.partner = pos;
+            entries.push_back({pos, partnerPosition, key, false});
+        }
+    }
+
+    return end;
+}
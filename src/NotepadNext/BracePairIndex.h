@@ -0,0 +1,88 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BRACEPAIRINDEX_H
+#define BRACEPAIRINDEX_H
+
+#include <QObject>
+
+#include <vector>
+
+#include "Sci_Position.h"
+
+class ScintillaNext;
+class QTimer;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Where the partner of every brace in a document is, so finding it doesn't mean searching the text. It pairs
+// braces the same way SCI_BRACEMATCH does, only counting braces of the same kind and style. The document is
+// indexed from the start while the application is idle, but only as far as it has been styled. An edit throws
+// away everything after where it happened and that part gets indexed again.
+class BracePairIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    BracePairIndex(ScintillaNext *editor, QObject *parent = Q_NULLPTR);
+
+    // Returns true if the index knows the answer for pos, then match is the position of its partner or
+    // INVALID_POSITION if it is unmatched or not a brace. False means the caller has to search for itself.
+    bool lookup(Sci_Position pos, Sci_Position &match) const;
+
+signals:
+    // Indexing has caught up with the styled part of the document
+    void indexUpdated();
+
+private slots:
+    void notify(const Scintilla::NotificationData *pscn);
+    void indexNextChunk();
+
+private:
+    struct Entry
+    {
+        Sci_Position position;
+        Sci_Position partner;
+        unsigned short key; // the style and kind of brace
+        bool opening;
+    };
+
+    void reset();
+    void invalidateFrom(Sci_Position pos);
+    void repair();
+    Sci_Position indexRange(Sci_Position start, Sci_Position end);
+
+    ScintillaNext *editor;
+    QTimer *timer;
+
+    // Sorted by position
+    std::vector<Entry> entries;
+
+    // Indexes into entries of the opening braces that are still waiting for a partner, one stack per key
+    std::vector<std::vector<size_t>> openBraces;
+
+    // Everything before this is correct, anything in entries after it is left over from before an edit
+    Sci_Position indexedTo = 0;
+    bool needsRepair = false;
+};
+
+#endif // BRACEPAIRINDEX_H
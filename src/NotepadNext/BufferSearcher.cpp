@@ -0,0 +1,369 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BufferSearcher.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// The upper and lower case of ASCII letters differ only by 0x20, and so do the second bytes of the
+// Latin-1 letters after 0xC3 in UTF-8 (e.g. C3 89 and C3 A9 for É and é). Or-ing 0x20 into both the
+// pattern and the text folds them with a single operation that works just as well 16 bytes at a time.
+const char FOLD_BIT = 0x20;
+
+static bool isFoldableAscii(unsigned char c)
+{
+    return (c | FOLD_BIT) >= 'a' && (c | FOLD_BIT) <= 'z';
+}
+
+static bool isFoldableLatin1(unsigned char c)
+{
+    // × and ÷ have no case, and neither ß nor ÿ have theirs within the range
+    return c >= 0x80 && c <= 0xBE && c != 0x97 && c != 0xB7 && c != 0x9F;
+}
+
+// How many bytes the UTF8 sequence at pos takes up, anything that isn't valid counts as a single byte
+static qsizetype sequenceWidth(const char *data, qsizetype pos, qsizetype end)
+{
+    const unsigned char c = static_cast<unsigned char>(data[pos]);
+    qsizetype width = 1;
+
+    if (c >= 0xF5)
+        width = 1;
+    else if (c >= 0xF0)
+        width = 4;
+    else if (c >= 0xE0)
+        width = 3;
+    else if (c >= 0xC2)
+        width = 2;
+
+    // Make sure it actually is a valid sequence, else treat it as a single byte
+    for (qsizetype i = 1; i < width; ++i) {
+        if (pos + i >= end || (static_cast<unsigned char>(data[pos + i]) & 0xC0) != 0x80)
+            return 1;
+    }
+
+    return width;
+}
+
+// Which bytes of the pattern can be folded with FOLD_BIT. Returns false if anything in it would need
+// Scintilla's case folder, i.e. any non-ASCII character outside of the Latin-1 range other than the ones
+// without case. µ is one of those since it folds to the Greek μ.
+static bool computeFoldMask(const QByteArray &pattern, QByteArray &mask)
+{
+    mask.fill(0, pattern.size());
+
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(pattern.at(i));
+
+        if (c < 0x80) {
+            if (isFoldableAscii(c))
+                mask[i] = FOLD_BIT;
+
+            continue;
+        }
+
+        if (i + 1 >= pattern.size() || (c != 0xC2 && c != 0xC3))
+            return false;
+
+        const unsigned char next = static_cast<unsigned char>(pattern.at(++i));
+
+        if (c == 0xC2 && next == 0xB5)
+            return false;
+        else if (c == 0xC3 && isFoldableLatin1(next))
+            mask[i] = FOLD_BIT;
+        else if (c == 0xC3 && (next == 0x9F || next == 0xBF))
+            return false;
+    }
+
+    return true;
+}
+
+BufferSearcher::BufferSearcher(const QByteArray &pattern, int searchFlags) :
+    pattern(pattern),
+    flags(searchFlags),
+    isRegex(searchFlags & SCFIND_REGEXP),
+    matchCase(searchFlags & SCFIND_MATCHCASE)
+{
+    if (isRegex) {
+        // Use the same options as QRegexSearch so results are identical to SCI_FINDTEXT
+        QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption | QRegularExpression::UseUnicodePropertiesOption;
+
+        if (!matchCase)
+            options |= QRegularExpression::CaseInsensitiveOption;
+
+        re.setPattern(QString::fromUtf8(pattern));
+        re.setPatternOptions(options);
+        re.optimize();
+    }
+    else if (!matchCase) {
+        canFold = computeFoldMask(pattern, foldMask);
+        foldedPattern = pattern;
+
+        for (qsizetype i = 0; i < pattern.size(); ++i) {
+            foldedPattern[i] = pattern.at(i) | foldMask.at(i);
+        }
+    }
+
+    for (int i = 0; i < 256; ++i) {
+        const unsigned char c = static_cast<unsigned char>(i);
+
+        if (c == '\r' || c == '\n')
+            charClasses[i] = CharClass::NewLine;
+        else if (c < 0x20 || c == ' ')
+            charClasses[i] = CharClass::Space;
+        else if (c >= 0x80 || std::isalnum(c) || c == '_')
+            charClasses[i] = CharClass::Word;
+        else
+            charClasses[i] = CharClass::Punctuation;
+    }
+}
+
+void BufferSearcher::setCharacterClasses(const QByteArray &wordChars, const QByteArray &whitespaceChars)
+{
+    for (int i = 0; i < 256; ++i) {
+        if (i != '\r' && i != '\n')
+            charClasses[i] = CharClass::Punctuation;
+    }
+
+    for (const char c : whitespaceChars) {
+        charClasses[static_cast<unsigned char>(c)] = CharClass::Space;
+    }
+
+    for (const char c : wordChars) {
+        charClasses[static_cast<unsigned char>(c)] = CharClass::Word;
+    }
+}
+
+bool BufferSearcher::canSearch() const
+{
+    // Folding anything other than ASCII and Latin-1 requires Scintilla's case folder
+    return isRegex || matchCase || canFold;
+}
+
+QByteArray BufferSearcher::foldLiteral(const QByteArray &literal)
+{
+    QByteArray mask;
+    QByteArray folded = literal;
+
+    if (!computeFoldMask(literal, mask))
+        return folded;
+
+    for (qsizetype i = 0; i < literal.size(); ++i) {
+        folded[i] = literal.at(i) | mask.at(i);
+    }
+
+    return folded;
+}
+
+bool BufferSearcher::isValid() const
+{
+    return !pattern.isEmpty() && (!isRegex || re.isValid());
+}
+
+std::vector<Sci_CharacterRange> BufferSearcher::findAll(const char *data, qsizetype length, qsizetype start, qsizetype end, Sci_PositionCR offset) const
+{
+    std::vector<Sci_CharacterRange> matches;
+
+    forEachMatch(data, length, start, end, [&](qsizetype matchStart, qsizetype matchEnd) {
+        matches.push_back({static_cast<Sci_PositionCR>(matchStart + offset), static_cast<Sci_PositionCR>(matchEnd + offset)});
+        return true;
+    });
+
+    return matches;
+}
+
+bool BufferSearcher::isWordStartAt(const char *data, qsizetype length, qsizetype pos) const
+{
+    if (pos >= length)
+        return false;
+
+    // Same as Document::IsWordStartAt(), the start of the text counts as a space, which can start a word
+    const CharClass cc = charClasses[static_cast<unsigned char>(data[pos])];
+    const CharClass ccPrev = charClasses[static_cast<unsigned char>(pos > 0 ? data[pos - 1] : ' ')];
+
+    return cc != ccPrev && (cc == CharClass::Word || cc == CharClass::Punctuation);
+}
+
+bool BufferSearcher::isWordEndAt(const char *data, qsizetype length, qsizetype pos) const
+{
+    if (pos <= 0)
+        return false;
+
+    const CharClass ccPrev = charClasses[static_cast<unsigned char>(data[pos - 1])];
+    const CharClass ccNext = charClasses[static_cast<unsigned char>(pos < length ? data[pos] : ' ')];
+
+    return ccPrev != ccNext && (ccPrev == CharClass::Word || ccPrev == CharClass::Punctuation);
+}
+
+bool BufferSearcher::passesWordChecks(const char *data, qsizetype length, qsizetype start, qsizetype end) const
+{
+    // Same rules as Document::MatchesWordOptions()
+    if (flags & SCFIND_WHOLEWORD)
+        return isWordStartAt(data, length, start) && isWordEndAt(data, length, end);
+    else if (flags & SCFIND_WORDSTART)
+        return isWordStartAt(data, length, start);
+
+    return true;
+}
+
+const char *BufferSearcher::findLiteral(const char *first, const char *last) const
+{
+    const qsizetype patternLength = pattern.length();
+    const char *lastStart = last - patternLength;
+
+    if (matchCase) {
+        const char c = pattern.at(0);
+
+        // memchr() is heavily optimized by every C library so let it find the candidates
+        while (first <= lastStart) {
+            first = static_cast<const char *>(std::memchr(first, c, lastStart - first + 1));
+
+            if (first == Q_NULLPTR)
+                return Q_NULLPTR;
+
+            if (std::memcmp(first + 1, pattern.constData() + 1, patternLength - 1) == 0)
+                return first;
+
+            ++first;
+        }
+    }
+    else {
+        const char *folded = foldedPattern.constData();
+        const char *mask = foldMask.constData();
+        const qsizetype last = patternLength - 1;
+
+        auto matchesAt = [&](const char *candidate) {
+            for (qsizetype i = 1; i < last; ++i) {
+                if ((candidate[i] | mask[i]) != folded[i])
+                    return false;
+            }
+
+            return true;
+        };
+
+#ifdef __SSE2__
+        // Look for the first and last byte of the pattern (in either case) together, 16 places at a time.
+        // Only the places where both line up need the rest of the pattern compared.
+        const __m128i firstMask = _mm_set1_epi8(mask[0]);
+        const __m128i firstByte = _mm_set1_epi8(folded[0]);
+        const __m128i lastMask = _mm_set1_epi8(mask[last]);
+        const __m128i lastByte = _mm_set1_epi8(folded[last]);
+
+        while (lastStart - first + 1 >= 16) {
+            const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+            const __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + last));
+            const __m128i both = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(starts, firstMask), firstByte),
+                                               _mm_cmpeq_epi8(_mm_or_si128(ends, lastMask), lastByte));
+
+            unsigned int candidates = static_cast<unsigned int>(_mm_movemask_epi8(both));
+            while (candidates != 0) {
+                const int offset = qCountTrailingZeroBits(candidates);
+
+                if (matchesAt(first + offset))
+                    return first + offset;
+
+                candidates &= candidates - 1;
+            }
+
+            first += 16;
+        }
+#endif
+
+        for (; first <= lastStart; ++first) {
+            if ((first[0] | mask[0]) == folded[0] && (first[last] | mask[last]) == folded[last] && matchesAt(first))
+                return first;
+        }
+    }
+
+    return Q_NULLPTR;
+}
+
+void BufferSearcher::setRegexChunking(qsizetype chunkSize, qsizetype overlap)
+{
+    regexChunkSize = qMax<qsizetype>(1024, chunkSize);
+
+    // A partial match has to start after the beginning of its chunk, else the search could never move on
+    regexOverlap = qBound<qsizetype>(0, overlap, regexChunkSize / 2);
+}
+
+qsizetype BufferSearcher::nextCharacter(const char *data, qsizetype pos, qsizetype end)
+{
+    // The position just past whatever character pos is part of
+    ++pos;
+
+    while (pos < end && (static_cast<unsigned char>(data[pos]) & 0xC0) == 0x80)
+        ++pos;
+
+    return qMin(pos, end);
+}
+
+qsizetype BufferSearcher::utf16Length(const char *data, qsizetype pos, qsizetype end)
+{
+    qsizetype units = 0;
+
+    while (pos < end) {
+        const qsizetype width = sequenceWidth(data, pos, end);
+
+        pos += width;
+        units += (width == 4) ? 2 : 1;
+    }
+
+    return units;
+}
+
+qsizetype BufferSearcher::regexContextStart(const char *data, qsizetype start, qsizetype chunkStart) const
+{
+    // Nothing before the range is ever looked at, which is how a match at the start of it can match ^
+    const qsizetype limit = qMax(start, chunkStart - regexOverlap);
+
+    for (qsizetype pos = chunkStart; pos > limit; --pos) {
+        if (data[pos - 1] == '\n' || data[pos - 1] == '\r')
+            return pos;
+    }
+
+    // The line is too long, so at least don't start in the middle of a character
+    qsizetype pos = limit;
+    while (pos < chunkStart && (static_cast<unsigned char>(data[pos]) & 0xC0) == 0x80)
+        ++pos;
+
+    return pos;
+}
+
+qsizetype BufferSearcher::advanceUtf16(const char *data, qsizetype pos, qsizetype end, qsizetype units)
+{
+    // Move forward through the UTF8 bytes until the requested number of UTF16 code units have been
+    // consumed. Same idea as Document::GetRelativePositionUTF16() but without needing a Document.
+    while (units > 0 && pos < end) {
+        const qsizetype width = sequenceWidth(data, pos, end);
+
+        pos += width;
+        units -= (width == 4) ? 2 : 1;
+    }
+
+    return pos;
+}
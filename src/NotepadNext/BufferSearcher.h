@@ -0,0 +1,319 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "Scintilla.h"
+
+
+struct SearchHit
+{
+    int lineNumber;
+    int startPositionFromBeginning;
+    int endPositionFromBeginning;
+    QString lineText;
+};
+
+// Finds every match of a pattern in a contiguous block of UTF-8 bytes in a single pass. It does
+// not depend on an editor so it can be used on a document's buffer or on any other chunk of text,
+// including from a worker thread.
+class BufferSearcher
+{
+public:
+    static const qsizetype DEFAULT_REGEX_CHUNK_SIZE = 4 * 1024 * 1024;
+    static const qsizetype DEFAULT_REGEX_OVERLAP = 64 * 1024;
+
+    BufferSearcher(const QByteArray &pattern, int searchFlags);
+
+    // Character classes used for SCFIND_WHOLEWORD and SCFIND_WORDSTART. If these are never set then
+    // alphanumeric characters, '_', and any byte >= 0x80 are considered word characters.
+    void setCharacterClasses(const QByteArray &wordChars, const QByteArray &whitespaceChars);
+
+    // Regular expressions are matched about chunkSize bytes at a time so memory use doesn't grow with the size
+    // of the text, only one chunk is ever decoded to UTF-16. A match that reaches the end of a chunk (including
+    // ones spanning lines) is tried again from where it started in the next chunk, as long as it starts within
+    // overlap bytes of the end. The overlap is also how far back ^ and lookbehinds can see into the last chunk.
+    void setRegexChunking(qsizetype chunkSize, qsizetype overlap);
+
+    // Checked between chunks, so a long search with no matches can still be stopped
+    void setCancelFlag(const std::atomic_bool *canceled) { cancelFlag = canceled; }
+
+    // Some searches can't be done directly on the bytes, e.g. case insensitive literals with characters
+    // outside of ASCII and Latin-1. The caller needs to fall back to using Scintilla's own searching in this case.
+    bool canSearch() const;
+    bool isValid() const;
+
+    // The literal with its case folded the same way a case insensitive search does it
+    static QByteArray foldLiteral(const QByteArray &literal);
+
+    // Calls callback(start, end) for every non-empty match within [start, end) of data. The bytes just
+    // outside of the range (if any) are only used to check word boundaries. Returning false from the
+    // callback stops the search.
+    template<typename Func>
+    void forEachMatch(const char *data, qsizetype length, qsizetype start, qsizetype end, Func callback) const;
+
+    // Same as forEachMatch() over all of data, but calls callback(const SearchHit &, start) with the line
+    // number of the match. If lineTextContext is more than 0 the hit also gets the text of the line around
+    // the match, with at most that many bytes either side of it. Longer lines are cut short with "...".
+    template<typename Func>
+    void forEachHit(const char *data, qsizetype length, Func callback, int lineTextContext = 0) const;
+
+    // Same as forEachMatch() over all of data, but calls callback(start, end, const QByteArray &text) with
+    // what the match gets replaced by. For regular expressions any back references in replacement are
+    // expanded the same way QRegexSearch does it.
+    template<typename Func>
+    void forEachReplacement(const char *data, qsizetype length, const QByteArray &replacement, Func callback) const;
+
+    std::vector<Sci_CharacterRange> findAll(const char *data, qsizetype length, qsizetype start, qsizetype end, Sci_PositionCR offset = 0) const;
+
+private:
+    enum class CharClass : unsigned char { Space, NewLine, Word, Punctuation };
+
+    template<typename Func>
+    void forEachLiteralMatch(const char *data, qsizetype length, qsizetype start, qsizetype end, Func callback) const;
+
+    // Calls callback(start, end, const QRegularExpressionMatch &)
+    template<typename Func>
+    void forEachRegexMatch(const char *data, qsizetype start, qsizetype end, Func callback) const;
+
+    bool isWordStartAt(const char *data, qsizetype length, qsizetype pos) const;
+    bool isWordEndAt(const char *data, qsizetype length, qsizetype pos) const;
+    bool passesWordChecks(const char *data, qsizetype length, qsizetype start, qsizetype end) const;
+
+    const char *findLiteral(const char *first, const char *last) const;
+
+    static qsizetype advanceUtf16(const char *data, qsizetype pos, qsizetype end, qsizetype units);
+    static qsizetype utf16Length(const char *data, qsizetype pos, qsizetype end);
+    static qsizetype nextCharacter(const char *data, qsizetype pos, qsizetype end);
+    qsizetype regexContextStart(const char *data, qsizetype start, qsizetype chunkStart) const;
+
+    QByteArray pattern;
+    QByteArray foldedPattern;
+    QByteArray foldMask;
+    bool canFold = false;
+    int flags;
+    bool isRegex;
+    bool matchCase;
+    QRegularExpression re;
+    qsizetype regexChunkSize = DEFAULT_REGEX_CHUNK_SIZE;
+    qsizetype regexOverlap = DEFAULT_REGEX_OVERLAP;
+    const std::atomic_bool *cancelFlag = Q_NULLPTR;
+
+    std::array<CharClass, 256> charClasses;
+};
+
+template<typename Func>
+void BufferSearcher::forEachMatch(const char *data, qsizetype length, qsizetype start, qsizetype end, Func callback) const
+{
+    if (!isValid() || !canSearch() || start >= end)
+        return;
+
+    if (isRegex) {
+        forEachRegexMatch(data, start, end, [&](qsizetype matchStart, qsizetype matchEnd, const QRegularExpressionMatch &) {
+            return callback(matchStart, matchEnd);
+        });
+    }
+    else {
+        forEachLiteralMatch(data, length, start, end, callback);
+    }
+}
+
+template<typename Func>
+void BufferSearcher::forEachHit(const char *data, qsizetype length, Func callback, int lineTextContext) const
+{
+    int line = 0;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+    SearchHit hit{0, 0, 0, QString()};
+
+    auto isContinuationByte = [data](qsizetype pos) { return (static_cast<unsigned char>(data[pos]) & 0xC0) == 0x80; };
+
+    forEachMatch(data, length, 0, length, [&](qsizetype start, qsizetype end) {
+        // Scintilla treats \n, \r\n, and \r as line endings
+        for (; scanned < start; ++scanned) {
+            const char c = data[scanned];
+
+            if (c == '\n' || (c == '\r' && (scanned + 1 >= length || data[scanned + 1] != '\n'))) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        hit.lineNumber = line;
+
+        if (lineTextContext > 0) {
+            // Only look as far either side of the match as will be displayed, lines can be megabytes long
+            qsizetype textStart = qMax(lineStart, start - lineTextContext);
+            while (textStart < start && isContinuationByte(textStart))
+                ++textStart;
+
+            const qsizetype limit = qMin(length, end + lineTextContext);
+            qsizetype textEnd = end;
+            while (textEnd < limit && data[textEnd] != '\n' && data[textEnd] != '\r')
+                ++textEnd;
+
+            const bool truncatedEnd = textEnd == limit && limit < length && data[textEnd] != '\n' && data[textEnd] != '\r';
+            while (truncatedEnd && textEnd > end && isContinuationByte(textEnd))
+                --textEnd;
+
+            hit.lineText = QString::fromUtf8(data + textStart, textEnd - textStart);
+
+            if (textStart > lineStart)
+                hit.lineText.prepend(QStringLiteral("..."));
+            if (truncatedEnd)
+                hit.lineText.append(QStringLiteral("..."));
+        }
+
+        hit.startPositionFromBeginning = static_cast<int>(start - lineStart);
+        hit.endPositionFromBeginning = static_cast<int>(end - lineStart);
+
+        return callback(static_cast<const SearchHit &>(hit), start);
+    });
+}
+
+template<typename Func>
+void BufferSearcher::forEachReplacement(const char *data, qsizetype length, const QByteArray &replacement, Func callback) const
+{
+    if (!isValid() || !canSearch() || length <= 0)
+        return;
+
+    if (isRegex) {
+        const QString replacementText = QString::fromUtf8(replacement);
+
+        forEachRegexMatch(data, 0, length, [&](qsizetype start, qsizetype end, const QRegularExpressionMatch &m) {
+            QString text = m.captured();
+            text.replace(re, replacementText);
+
+            const QByteArray bytes = text.toUtf8();
+            return callback(start, end, bytes);
+        });
+    }
+    else {
+        forEachLiteralMatch(data, length, 0, length, [&](qsizetype start, qsizetype end) {
+            return callback(start, end, replacement);
+        });
+    }
+}
+
+template<typename Func>
+void BufferSearcher::forEachLiteralMatch(const char *data, qsizetype length, qsizetype start, qsizetype end, Func callback) const
+{
+    const qsizetype patternLength = pattern.length();
+    const char *last = data + end;
+    const char *cur = data + start;
+
+    while (last - cur >= patternLength) {
+        const char *found = findLiteral(cur, last);
+
+        if (found == Q_NULLPTR)
+            return;
+
+        const qsizetype matchStart = found - data;
+        const qsizetype matchEnd = matchStart + patternLength;
+
+        if (passesWordChecks(data, length, matchStart, matchEnd)) {
+            if (!callback(matchStart, matchEnd))
+                return;
+
+            cur = found + patternLength;
+        }
+        else {
+            cur = found + 1;
+        }
+    }
+}
+
+template<typename Func>
+void BufferSearcher::forEachRegexMatch(const char *data, qsizetype start, qsizetype end, Func callback) const
+{
+    // Moves past a UTF-16 code unit without splitting a surrogate pair
+    auto nextOffset = [](const QString &text, qsizetype offset) {
+        return offset + (offset < text.size() && text.at(offset).isHighSurrogate() ? 2 : 1);
+    };
+
+    for (qsizetype chunkStart = start; chunkStart < end;) {
+        if (cancelFlag && *cancelFlag)
+            return;
+
+        const qsizetype chunkEnd = nextCharacter(data, qMin(end, chunkStart + regexChunkSize - 1), end);
+        const bool lastChunk = chunkEnd >= end;
+        const qsizetype contextStart = regexContextStart(data, start, chunkStart);
+
+        // Anything that gets to the end of a chunk that isn't the last one is only a partial match, PCRE2 then
+        // reports where it started so it can be tried again with the rest of the text
+        const QRegularExpression::MatchType matchType = lastChunk ? QRegularExpression::NormalMatch : QRegularExpression::PartialPreferFirstMatch;
+        const QString text = QString::fromUtf8(data + contextStart, chunkEnd - contextStart);
+
+        // Keep track of the byte position of the last UTF16 offset that was converted so that each
+        // conversion only has to look at the bytes since the previous match
+        qsizetype bytePos = contextStart;
+        qsizetype utf16Pos = 0;
+        qsizetype offset = utf16Length(data, contextStart, chunkStart);
+        qsizetype nextChunkStart = chunkEnd;
+
+        while (offset <= text.size()) {
+            const QRegularExpressionMatch m = re.match(text, offset, matchType);
+
+            if (m.hasPartialMatch()) {
+                const qsizetype partialStart = advanceUtf16(data, bytePos, chunkEnd, m.capturedStart(0) - utf16Pos);
+
+                bytePos = partialStart;
+                utf16Pos = m.capturedStart(0);
+
+                if (chunkEnd - partialStart <= regexOverlap) {
+                    nextChunkStart = partialStart;
+                    break;
+                }
+
+                // It would go on too far to be carried over, so look for anything else after where it started
+                offset = nextOffset(text, m.capturedStart(0));
+                continue;
+            }
+
+            if (!m.hasMatch())
+                break;
+
+            if (m.capturedLength(0) == 0) {
+                offset = nextOffset(text, m.capturedEnd(0));
+                continue;
+            }
+
+            const qsizetype matchStart = advanceUtf16(data, bytePos, chunkEnd, m.capturedStart(0) - utf16Pos);
+            const qsizetype matchEnd = advanceUtf16(data, matchStart, chunkEnd, m.capturedLength(0));
+
+            bytePos = matchEnd;
+            utf16Pos = m.capturedEnd(0);
+
+            if (!callback(matchStart, matchEnd, m))
+                return;
+
+            offset = m.capturedEnd(0);
+        }
+
+        chunkStart = nextChunkStart;
+    }
+}
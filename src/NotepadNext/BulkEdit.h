@@ -0,0 +1,38 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BULKEDIT_H
+#define BULKEDIT_H
+
+class ScintillaNext;
+
+// Groups lots of programmatic changes to an editor into one undo action. Until the last one for the editor goes
+// away nothing watching it hears about the individual changes and nothing is repainted, then everything catches
+// up and it gets drawn once. See ScintillaNext::beginBulkEdit().
+class BulkEdit
+{
+public:
+    explicit BulkEdit(ScintillaNext *editor);
+    ~BulkEdit();
+
+private:
+    ScintillaNext *editor;
+};
+
+#endif // BULKEDIT_H
@@ -0,0 +1,179 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BytePattern.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+static int HexDigit(QChar c)
+{
+    const ushort u = c.unicode();
+
+    if (u >= '0' && u <= '9')
+        return u - '0';
+    if (u >= 'a' && u <= 'f')
+        return u - 'a' + 10;
+    if (u >= 'A' && u <= 'F')
+        return u - 'A' + 10;
+
+    return -1;
+}
+
+BytePattern::BytePattern(const QString &text)
+{
+    int value = 0;
+    int mask = 0;
+    int digits = 0;
+
+    for (const QChar c : text) {
+        if (c.isSpace()) {
+            // A byte can't be split by a space
+            if (digits == 1) {
+                values.clear();
+                masks.clear();
+                return;
+            }
+
+            continue;
+        }
+
+        const int digit = HexDigit(c);
+
+        if (digit < 0 && c != QLatin1Char('?')) {
+            values.clear();
+            masks.clear();
+            return;
+        }
+
+        value = (value << 4) | qMax(digit, 0);
+        mask = (mask << 4) | (digit < 0 ? 0 : 0xF);
+
+        if (++digits == 2) {
+            values.append(static_cast<char>(value));
+            masks.append(static_cast<char>(mask));
+            value = mask = digits = 0;
+        }
+    }
+
+    if (digits != 0) {
+        values.clear();
+        masks.clear();
+        return;
+    }
+
+    anchor = masks.indexOf(static_cast<char>(0xFF));
+}
+
+bool BytePattern::hasWildcards() const
+{
+    for (char mask : masks) {
+        if (static_cast<unsigned char>(mask) != 0xFF)
+            return true;
+    }
+
+    return false;
+}
+
+bool BytePattern::matchesAt(const char *data) const
+{
+    for (int i = 0; i < values.size(); ++i) {
+        if ((data[i] & masks[i]) != values[i])
+            return false;
+    }
+
+    return true;
+}
+
+qint64 BytePattern::indexIn(const char *data, qint64 length, qint64 from) const
+{
+    const qint64 lastStart = length - values.size();
+
+    if (!isValid() || from < 0 || from > lastStart)
+        return -1;
+
+    // Nothing to look for first, every place has to be compared
+    if (anchor < 0) {
+        for (qint64 i = from; i <= lastStart; ++i) {
+            if (matchesAt(data + i))
+                return i;
+        }
+
+        return -1;
+    }
+
+    const char c = values.at(anchor);
+    const char *first = data + from + anchor;
+    const char *last = data + lastStart + anchor;
+
+#ifdef __SSE2__
+    const __m128i needle = _mm_set1_epi8(c);
+
+    while (last - first + 1 >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+        unsigned int candidates = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+
+        while (candidates != 0) {
+            const int offset = qCountTrailingZeroBits(candidates);
+            const char *start = first + offset - anchor;
+
+            if (matchesAt(start))
+                return start - data;
+
+            candidates &= candidates - 1;
+        }
+
+        first += 16;
+    }
+#endif
+
+    // memchr() is heavily optimized by every C library, so it finds the rest of them
+    while (first <= last) {
+        first = static_cast<const char *>(std::memchr(first, c, last - first + 1));
+
+        if (first == Q_NULLPTR)
+            return -1;
+
+        if (matchesAt(first - anchor))
+            return first - anchor - data;
+
+        ++first;
+    }
+
+    return -1;
+}
+
+qint64 BytePattern::lastIndexIn(const char *data, qint64 length, qint64 from) const
+{
+    if (!isValid())
+        return -1;
+
+    for (qint64 i = qMin(from, length - values.size()); i >= 0; --i) {
+        if ((anchor < 0 || data[i + anchor] == values.at(anchor)) && matchesAt(data + i))
+            return i;
+    }
+
+    return -1;
+}
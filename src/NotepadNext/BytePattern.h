@@ -0,0 +1,58 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BYTEPATTERN_H
+#define BYTEPATTERN_H
+
+#include <QByteArray>
+#include <QString>
+
+
+// A run of bytes written in hex, e.g. "4D 5A ?? 00 1?", where a ? stands for any digit. Whitespace between the
+// bytes is optional. Searching picks a byte of the pattern that has no wildcards in it and looks for that first,
+// 16 bytes at a time where SSE2 is available, so only the places it turns up at need the rest compared.
+class BytePattern
+{
+public:
+    BytePattern() = default;
+    explicit BytePattern(const QString &text);
+
+    // An empty pattern, an odd number of digits or anything that isn't a digit or ? is not valid
+    bool isValid() const { return !values.isEmpty(); }
+    bool hasWildcards() const;
+    int length() const { return values.size(); }
+
+    // The bytes themselves, only meaningful if there are no wildcards
+    QByteArray bytes() const { return values; }
+
+    bool matchesAt(const char *data) const;
+
+    // Where the first match starting in [from, length) is, or -1 if there isn't one
+    qint64 indexIn(const char *data, qint64 length, qint64 from = 0) const;
+
+    // Where the last match starting in [0, from] is, or -1 if there isn't one
+    qint64 lastIndexIn(const char *data, qint64 length, qint64 from) const;
+
+private:
+    QByteArray values;
+    QByteArray masks; // the bits of each byte that have to match
+    int anchor = -1; // a byte with no wildcards, -1 if every byte has some
+};
+
+#endif // BYTEPATTERN_H
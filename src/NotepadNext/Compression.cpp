@@ -0,0 +1,498 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "Compression.h"
+
+#include <QFileInfo>
+
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+
+// How much room is made at a time for what comes out of a decoder or encoder
+const int OUTPUT_BLOCK_SIZE = 256 * 1024;
+
+// Makes room for another block of output at the end of out, returning where it starts. Once the library has
+// filled in what it can, out has to be shrunk back by however much of the block is left over.
+static char *growOutput(QByteArray &out)
+{
+    const int used = out.size();
+    out.resize(used + OUTPUT_BLOCK_SIZE);
+
+    return out.data() + used;
+}
+
+#ifdef HAVE_ZLIB
+class GzipDecoder : public Compression::Decoder
+{
+public:
+    GzipDecoder()
+    {
+        // Adding 32 to the window bits accepts both gzip and zlib headers
+        valid = inflateInit2(&stream, 15 + 32) == Z_OK;
+    }
+
+    ~GzipDecoder() override
+    {
+        inflateEnd(&stream);
+    }
+
+    bool decode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        if (!valid)
+            return false;
+
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = static_cast<uInt>(length);
+
+        do {
+            // Rotated logs are often several gzip members one after the other
+            if (ended && stream.avail_in > 0) {
+                inflateReset(&stream);
+                ended = false;
+            }
+
+            stream.next_out = reinterpret_cast<Bytef *>(growOutput(out));
+            stream.avail_out = OUTPUT_BLOCK_SIZE;
+
+            const int result = inflate(&stream, Z_NO_FLUSH);
+            out.chop(static_cast<int>(stream.avail_out));
+
+            if (result == Z_STREAM_END)
+                ended = true;
+            else if (result != Z_OK && result != Z_BUF_ERROR)
+                return false;
+        } while (stream.avail_in > 0 || stream.avail_out == 0);
+
+        return true;
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        Q_UNUSED(out)
+
+        return valid && ended;
+    }
+
+private:
+    z_stream stream = z_stream();
+    bool valid = false;
+    bool ended = false;
+};
+
+class GzipEncoder : public Compression::Encoder
+{
+public:
+    GzipEncoder()
+    {
+        // Adding 16 to the window bits writes a gzip header rather than a zlib one
+        valid = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~GzipEncoder() override
+    {
+        deflateEnd(&stream);
+    }
+
+    bool encode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        return valid && run(data, length, Z_NO_FLUSH, out);
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        return valid && run(Q_NULLPTR, 0, Z_FINISH, out);
+    }
+
+private:
+    bool run(const char *data, qsizetype length, int flush, QByteArray &out)
+    {
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = static_cast<uInt>(length);
+
+        int result;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(growOutput(out));
+            stream.avail_out = OUTPUT_BLOCK_SIZE;
+
+            result = deflate(&stream, flush);
+            out.chop(static_cast<int>(stream.avail_out));
+
+            if (result == Z_STREAM_ERROR)
+                return false;
+        } while (stream.avail_in > 0 || stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+
+        return true;
+    }
+
+    z_stream stream = z_stream();
+    bool valid = false;
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdDecoder : public Compression::Decoder
+{
+public:
+    ZstdDecoder() :
+        stream(ZSTD_createDStream())
+    {
+    }
+
+    ~ZstdDecoder() override
+    {
+        ZSTD_freeDStream(stream);
+    }
+
+    bool decode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        if (stream == Q_NULLPTR)
+            return false;
+
+        // Frames one after the other are handled by the stream itself
+        ZSTD_inBuffer input = {data, static_cast<size_t>(length), 0};
+        ZSTD_outBuffer output;
+
+        do {
+            output = {growOutput(out), OUTPUT_BLOCK_SIZE, 0};
+
+            const size_t result = ZSTD_decompressStream(stream, &output, &input);
+            out.chop(static_cast<int>(output.size - output.pos));
+
+            if (ZSTD_isError(result))
+                return false;
+
+            frameComplete = result == 0;
+        } while (input.pos < input.size || output.pos == output.size);
+
+        return true;
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        Q_UNUSED(out)
+
+        return stream != Q_NULLPTR && frameComplete;
+    }
+
+private:
+    ZSTD_DStream *stream;
+    bool frameComplete = false;
+};
+
+class ZstdEncoder : public Compression::Encoder
+{
+public:
+    ZstdEncoder() :
+        context(ZSTD_createCCtx())
+    {
+    }
+
+    ~ZstdEncoder() override
+    {
+        ZSTD_freeCCtx(context);
+    }
+
+    bool encode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        return context != Q_NULLPTR && run(data, length, ZSTD_e_continue, out);
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        return context != Q_NULLPTR && run(Q_NULLPTR, 0, ZSTD_e_end, out);
+    }
+
+private:
+    bool run(const char *data, qsizetype length, ZSTD_EndDirective directive, QByteArray &out)
+    {
+        ZSTD_inBuffer input = {data, static_cast<size_t>(length), 0};
+        ZSTD_outBuffer output;
+        size_t remaining;
+
+        do {
+            output = {growOutput(out), OUTPUT_BLOCK_SIZE, 0};
+
+            remaining = ZSTD_compressStream2(context, &output, &input, directive);
+            out.chop(static_cast<int>(output.size - output.pos));
+
+            if (ZSTD_isError(remaining))
+                return false;
+        } while (input.pos < input.size || output.pos == output.size || (directive == ZSTD_e_end && remaining > 0));
+
+        return true;
+    }
+
+    ZSTD_CCtx *context;
+};
+#endif
+
+#ifdef HAVE_LZMA
+// Decoding and encoding with liblzma work the same way, only the stream is set up differently
+class XzStream
+{
+public:
+    ~XzStream()
+    {
+        lzma_end(&stream);
+    }
+
+protected:
+    bool run(const char *data, qsizetype length, lzma_action action, QByteArray &out)
+    {
+        stream.next_in = reinterpret_cast<const uint8_t *>(data);
+        stream.avail_in = static_cast<size_t>(length);
+
+        do {
+            stream.next_out = reinterpret_cast<uint8_t *>(growOutput(out));
+            stream.avail_out = OUTPUT_BLOCK_SIZE;
+
+            const lzma_ret result = lzma_code(&stream, action);
+            out.chop(static_cast<int>(stream.avail_out));
+
+            if (result == LZMA_STREAM_END) {
+                ended = true;
+                return true;
+            }
+
+            if (result != LZMA_OK)
+                return false;
+        } while (stream.avail_in > 0 || stream.avail_out == 0);
+
+        return true;
+    }
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    bool valid = false;
+    bool ended = false;
+};
+
+class XzDecoder : public Compression::Decoder, private XzStream
+{
+public:
+    XzDecoder()
+    {
+        // Several streams one after the other are read as one, the same as the xz tool does
+        valid = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+    }
+
+    bool decode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        return valid && run(data, length, LZMA_RUN, out);
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        return valid && run(Q_NULLPTR, 0, LZMA_FINISH, out) && ended;
+    }
+};
+
+class XzEncoder : public Compression::Encoder, private XzStream
+{
+public:
+    XzEncoder()
+    {
+        valid = lzma_easy_encoder(&stream, LZMA_PRESET_DEFAULT, LZMA_CHECK_CRC64) == LZMA_OK;
+    }
+
+    bool encode(const char *data, qsizetype length, QByteArray &out) override
+    {
+        return valid && run(data, length, LZMA_RUN, out);
+    }
+
+    bool finish(QByteArray &out) override
+    {
+        while (valid && !ended) {
+            if (!run(Q_NULLPTR, 0, LZMA_FINISH, out))
+                return false;
+        }
+
+        return valid;
+    }
+};
+#endif
+
+bool Compression::isAvailable(Format format)
+{
+    switch (format) {
+    case Format::None:
+        return true;
+    case Format::Gzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Format::Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case Format::Xz:
+#ifdef HAVE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+Compression::Format Compression::detect(const char *data, qsizetype length)
+{
+    Format format = Format::None;
+
+    if (length >= 2 && std::memcmp(data, "\x1F\x8B", 2) == 0)
+        format = Format::Gzip;
+    else if (length >= 4 && std::memcmp(data, "\x28\xB5\x2F\xFD", 4) == 0)
+        format = Format::Zstd;
+    else if (length >= 6 && std::memcmp(data, "\xFD" "7zXZ\x00", 6) == 0)
+        format = Format::Xz;
+
+    return isAvailable(format) ? format : Format::None;
+}
+
+Compression::Format Compression::forFileName(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    Format format = Format::None;
+
+    if (suffix == QStringLiteral("gz"))
+        format = Format::Gzip;
+    else if (suffix == QStringLiteral("zst"))
+        format = Format::Zstd;
+    else if (suffix == QStringLiteral("xz"))
+        format = Format::Xz;
+
+    return isAvailable(format) ? format : Format::None;
+}
+
+std::unique_ptr<Compression::Decoder> Compression::createDecoder(Format format)
+{
+    switch (format) {
+#ifdef HAVE_ZLIB
+    case Format::Gzip:
+        return std::make_unique<GzipDecoder>();
+#endif
+#ifdef HAVE_ZSTD
+    case Format::Zstd:
+        return std::make_unique<ZstdDecoder>();
+#endif
+#ifdef HAVE_LZMA
+    case Format::Xz:
+        return std::make_unique<XzDecoder>();
+#endif
+    default:
+        return std::unique_ptr<Decoder>();
+    }
+}
+
+std::unique_ptr<Compression::Encoder> Compression::createEncoder(Format format)
+{
+    switch (format) {
+#ifdef HAVE_ZLIB
+    case Format::Gzip:
+        return std::make_unique<GzipEncoder>();
+#endif
+#ifdef HAVE_ZSTD
+    case Format::Zstd:
+        return std::make_unique<ZstdEncoder>();
+#endif
+#ifdef HAVE_LZMA
+    case Format::Xz:
+        return std::make_unique<XzEncoder>();
+#endif
+    default:
+        return std::unique_ptr<Encoder>();
+    }
+}
+
+bool Compression::decompress(Format format, const char *data, qsizetype length, QByteArray &out)
+{
+    std::unique_ptr<Decoder> decoder = createDecoder(format);
+
+    if (!decoder)
+        return false;
+
+    for (qsizetype pos = 0; pos < length; pos += INPUT_CHUNK_SIZE) {
+        if (!decoder->decode(data + pos, qMin(INPUT_CHUNK_SIZE, length - pos), out))
+            return false;
+    }
+
+    return decoder->finish(out);
+}
+
+CompressionWriter::CompressionWriter(Compression::Format format, QIODevice *device) :
+    encoder(Compression::createEncoder(format)),
+    device(device)
+{
+    QIODevice::open(QIODevice::WriteOnly);
+}
+
+CompressionWriter::~CompressionWriter()
+{
+}
+
+bool CompressionWriter::finish()
+{
+    QByteArray compressed;
+
+    return encoder && encoder->finish(compressed) && flush(compressed);
+}
+
+qint64 CompressionWriter::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+
+    return -1;
+}
+
+qint64 CompressionWriter::writeData(const char *data, qint64 maxSize)
+{
+    if (!encoder)
+        return -1;
+
+    for (qint64 pos = 0; pos < maxSize; pos += Compression::INPUT_CHUNK_SIZE) {
+        QByteArray compressed;
+
+        if (!encoder->encode(data + pos, qMin<qint64>(Compression::INPUT_CHUNK_SIZE, maxSize - pos), compressed) || !flush(compressed))
+            return -1;
+    }
+
+    return maxSize;
+}
+
+bool CompressionWriter::flush(const QByteArray &compressed)
+{
+    return compressed.isEmpty() || device->write(compressed) == compressed.size();
+}
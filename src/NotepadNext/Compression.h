@@ -0,0 +1,107 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <memory>
+
+
+// Streaming support for gzip, zstd and xz compressed files. Each format is only available if its library was found
+// when building (see NotepadNext.pro), otherwise files in it are treated like any other file.
+class Compression
+{
+public:
+    enum class Format {
+        None,
+        Gzip,
+        Zstd,
+        Xz,
+    };
+
+    // How much compressed data is worth handing to a Decoder at a time, so what comes out of it stays a sensible size
+    static constexpr qsizetype INPUT_CHUNK_SIZE = 256 * 1024;
+
+    static bool isAvailable(Format format);
+
+    // Goes by the magic bytes at the start of data. Formats that aren't available are None.
+    static Format detect(const char *data, qsizetype length);
+
+    // Goes by the extension, for a file that is about to be written. Formats that aren't available are None.
+    static Format forFileName(const QString &filePath);
+
+    // Decompresses data a piece at a time, appending whatever comes out of each piece to out
+    class Decoder
+    {
+    public:
+        virtual ~Decoder() = default;
+
+        // Returns false if the data is corrupt
+        virtual bool decode(const char *data, qsizetype length, QByteArray &out) = 0;
+
+        // Called once all of the data has been given, returns false if it was cut off
+        virtual bool finish(QByteArray &out) = 0;
+    };
+
+    static std::unique_ptr<Decoder> createDecoder(Format format);
+
+    // The same the other way around
+    class Encoder
+    {
+    public:
+        virtual ~Encoder() = default;
+
+        virtual bool encode(const char *data, qsizetype length, QByteArray &out) = 0;
+        virtual bool finish(QByteArray &out) = 0;
+    };
+
+    static std::unique_ptr<Encoder> createEncoder(Format format);
+
+    // Decompresses all of data in one go, returns false if it is corrupt or cut off
+    static bool decompress(Format format, const char *data, qsizetype length, QByteArray &out);
+};
+
+// Compresses everything written to it and passes it on to another device, so the uncompressed text never has to be
+// held in memory. finish() has to be called once everything has been written.
+class CompressionWriter : public QIODevice
+{
+public:
+    CompressionWriter(Compression::Format format, QIODevice *device);
+    ~CompressionWriter() override;
+
+    bool finish();
+
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    bool flush(const QByteArray &compressed);
+
+    std::unique_ptr<Compression::Encoder> encoder;
+    QIODevice *device;
+};
+
+#endif // COMPRESSION_H
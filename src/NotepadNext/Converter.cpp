@@ -19,6 +19,19 @@
 
 #include "Converter.h"
 
+#include <QBuffer>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// How much of the document is fetched and converted at a time
+const int CHUNK_SIZE = 1024 * 1024;
+
 Converter::Converter(ScintillaNext *editor) :
     editor(editor)
 {
@@ -29,8 +42,143 @@ void Converter::convert(QTextStream &stream)
     convertRange(stream, 0, editor->length());
 }
 
+void Converter::convertRange(QTextStream &stream, int start, int end)
+{
+    QByteArray output;
+    QBuffer buffer(&output);
+    buffer.open(QIODevice::WriteOnly);
+
+    exportRange(&buffer, start, end);
+
+    stream << output;
+    stream.flush();
+}
+
+bool Converter::exportRange(QIODevice *device, int start, int end, const ProgressCallback &progress)
+{
+    ensureDocumentStyled(start, end);
+
+    const qint64 total = 2 * static_cast<qint64>(qMax(1, end - start));
+    QByteArray text;
+    QByteArray styles;
+    QByteArray out;
+
+    // First just see which styles are used
+    bool used[256] = {};
+    for (int pos = start; pos < end; pos += CHUNK_SIZE) {
+        styledText(pos, qMin(end, pos + CHUNK_SIZE), text, styles);
+
+        for (const char style : qAsConst(styles)) {
+            used[static_cast<unsigned char>(style)] = true;
+        }
+
+        if (progress && !progress(static_cast<int>(static_cast<qint64>(pos - start) * 100 / total)))
+            return false;
+    }
+
+    QVector<int> usedStyles;
+    for (int style = 0; style < 256; ++style) {
+        if (used[style])
+            usedStyles.append(style);
+    }
+
+    writeHeader(out, usedStyles);
+    if (device->write(out) != out.size())
+        return false;
+
+    for (int pos = start; pos < end; pos += CHUNK_SIZE) {
+        const int chunkEnd = qMin(end, pos + CHUNK_SIZE);
+
+        styledText(pos, chunkEnd, text, styles);
+
+        out.clear();
+        writeBody(out, text, styles, static_cast<char>(editor->charAt(chunkEnd)));
+        if (device->write(out) != out.size())
+            return false;
+
+        if (progress && !progress(static_cast<int>((static_cast<qint64>(end - start) + (chunkEnd - start)) * 100 / total)))
+            return false;
+    }
+
+    out.clear();
+    writeFooter(out);
+
+    return device->write(out) == out.size();
+}
+
 void Converter::ensureDocumentStyled(int start, int end)
 {
     // If idle styling is used, then the document may not have styling information yet
     editor->colourise(start, end);
 }
+
+void Converter::styledText(int start, int end, QByteArray &text, QByteArray &styles) const
+{
+    const int length = end - start;
+
+    // SCI_GETSTYLEDTEXTFULL interleaves each byte with its style and adds two terminating zero bytes
+    QByteArray styled(2 * length + 2, '\0');
+    Sci_TextRangeFull tr;
+    tr.chrg.cpMin = start;
+    tr.chrg.cpMax = end;
+    tr.lpstrText = styled.data();
+    editor->send(SCI_GETSTYLEDTEXTFULL, 0, reinterpret_cast<sptr_t>(&tr));
+
+    text.resize(length);
+    styles.resize(length);
+
+    const char *src = styled.constData();
+    char *textData = text.data();
+    char *styleData = styles.data();
+    for (int i = 0; i < length; ++i) {
+        textData[i] = src[2 * i];
+        styleData[i] = src[2 * i + 1];
+    }
+}
+
+int Converter::findAnyOf(const char *text, int pos, int length, const char *bytes)
+{
+    const int count = static_cast<int>(std::strlen(bytes));
+    Q_ASSERT(count > 0 && count <= 8);
+
+#ifdef __SSE2__
+    __m128i targets[8];
+    for (int i = 0; i < count; ++i) {
+        targets[i] = _mm_set1_epi8(bytes[i]);
+    }
+
+    for (; pos + 16 <= length; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+
+        __m128i found = _mm_cmpeq_epi8(chunk, targets[0]);
+        for (int i = 1; i < count; ++i) {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, targets[i]));
+        }
+
+        const int mask = _mm_movemask_epi8(found);
+        if (mask != 0)
+            return pos + qCountTrailingZeroBits(static_cast<quint32>(mask));
+    }
+#endif
+
+    for (; pos < length; ++pos) {
+        for (int i = 0; i < count; ++i) {
+            if (text[pos] == bytes[i])
+                return pos;
+        }
+    }
+
+    return length;
+}
+
+int Converter::styleRunEnd(const QByteArray &styles, int pos)
+{
+    const char style = styles.at(pos);
+    const char *data = styles.constData();
+    const int length = styles.size();
+
+    while (pos < length && data[pos] == style)
+        ++pos;
+
+    return pos;
+}
@@ -16,24 +16,52 @@
  * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-
 #pragma once
 
 #include <QTextStream>
+#include <QVector>
+
+#include <functional>
 
 #include "ScintillaNext.h"
 
+class QIODevice;
+
 class Converter
 {
 public:
     Converter(ScintillaNext *editor);
+    virtual ~Converter() = default;
 
     void convert(QTextStream &stream);
-    virtual void convertRange(QTextStream &stream, int start, int end) = 0;
+    void convertRange(QTextStream &stream, int start, int end);
+
+    // Given how far along the export is, returns false to cancel it
+    typedef std::function<bool(int percent)> ProgressCallback;
+
+    // Writes the range to the device a chunk at a time rather than building all of the output in memory first. The
+    // styles used are collected in a pass over just the style bytes beforehand, since the header needs them.
+    // Returns false if it was canceled or writing failed.
+    bool exportRange(QIODevice *device, int start, int end, const ProgressCallback &progress = ProgressCallback());
+
+    // Where the first of bytes (at most 8 of them) is in text at or after pos, or length if none of them are there.
+    // It looks at 16 bytes at a time where SSE2 is available, since the escapes are few and far between.
+    static int findAnyOf(const char *text, int pos, int length, const char *bytes);
 
 protected:
     void ensureDocumentStyled(int start, int end);
 
+    // The bytes of the range and the style of each one, fetched from the editor in one go
+    void styledText(int start, int end, QByteArray &text, QByteArray &styles) const;
+
+    // Where the run of bytes with the same style as the one at pos ends
+    static int styleRunEnd(const QByteArray &styles, int pos);
+
+    // The output is made in three parts. The header is given every style used in the range, then the body is
+    // handed over a chunk at a time. following is the byte after the end of the chunk.
+    virtual void writeHeader(QByteArray &out, const QVector<int> &usedStyles) = 0;
+    virtual void writeBody(QByteArray &out, const QByteArray &text, const QByteArray &styles, char following) = 0;
+    virtual void writeFooter(QByteArray &out) = 0;
+
     ScintillaNext *editor;
 };
-
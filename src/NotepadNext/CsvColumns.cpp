@@ -0,0 +1,465 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CsvColumns.h"
+#include "ScintillaNext.h"
+
+#include <QtAlgorithms>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+
+using namespace Scintilla;
+
+
+// Once this many lines have been split the whole lot is thrown away, it is only ever the lines around the screen
+// that are needed more than once
+const size_t MAX_CACHED_LINES = 64 * 1024;
+
+// Lines on screen longer than this are left as they are instead of being split every time the view scrolls
+const Sci_Position MAX_LINE_LENGTH = 1024 * 1024;
+
+// How much of the start of the document is looked at to guess the delimiter
+const qsizetype DETECT_LENGTH = 64 * 1024;
+const int DETECT_LINES = 20;
+
+CsvColumns *CsvColumns::forEditor(ScintillaNext *editor)
+{
+    CsvColumns *columns = editor->findChild<CsvColumns *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (columns == Q_NULLPTR) {
+        columns = new CsvColumns(editor);
+    }
+
+    return columns;
+}
+
+char CsvColumns::detectDelimiter(const char *text, qsizetype length)
+{
+    static const char candidates[] = {',', '\t', ';', '|'};
+
+    std::vector<qsizetype> lineStarts{0};
+    for (qsizetype i = 0; i < length && static_cast<int>(lineStarts.size()) <= DETECT_LINES; ++i) {
+        if (text[i] == '\n') {
+            lineStarts.push_back(i + 1);
+        }
+    }
+
+    // The last line is most likely cut short unless the text ended
+    if (lineStarts.back() != length) {
+        lineStarts.push_back(length + 1);
+    }
+
+    char best = ',';
+    int bestScore = 0;
+    std::vector<quint32> offsets;
+
+    // The best one splits the most lines into the same number of fields as the first line
+    for (char candidate : candidates) {
+        size_t firstCount = 0;
+        int score = 0;
+
+        for (size_t line = 0; line + 1 < lineStarts.size(); ++line) {
+            qsizetype lineLength = lineStarts[line + 1] - 1 - lineStarts[line];
+            if (lineLength > 0 && text[lineStarts[line] + lineLength - 1] == '\r') {
+                --lineLength;
+            }
+
+            offsets.clear();
+            splitLine(text + lineStarts[line], lineLength, candidate, offsets);
+
+            if (line == 0) {
+                firstCount = offsets.size();
+            }
+
+            if (firstCount > 2 && offsets.size() == firstCount) {
+                ++score;
+            }
+        }
+
+        if (score > bestScore) {
+            best = candidate;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+void CsvColumns::splitLine(const char *text, qsizetype length, char delimiter, std::vector<quint32> &offsets)
+{
+    offsets.push_back(0);
+
+    bool quoted = false;
+    qsizetype i = 0;
+
+#ifdef __SSE2__
+    // Only the quotes and delimiters are looked at one by one. A doubled quote inside a quoted field flips it
+    // twice, which leaves it quoted.
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i quotes = _mm_set1_epi8('"');
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        const uint quoteMask = static_cast<uint>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quotes)));
+        uint mask = quoteMask | static_cast<uint>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, delimiters)));
+
+        while (mask != 0) {
+            const uint bit = qCountTrailingZeroBits(mask);
+
+            if (quoteMask & (1u << bit)) {
+                quoted = !quoted;
+            }
+            else if (!quoted) {
+                offsets.push_back(static_cast<quint32>(i + bit + 1));
+            }
+
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (text[i] == '"') {
+            quoted = !quoted;
+        }
+        else if (text[i] == delimiter && !quoted) {
+            offsets.push_back(static_cast<quint32>(i + 1));
+        }
+    }
+
+    offsets.push_back(static_cast<quint32>(length + 1));
+}
+
+std::string_view CsvColumns::field(std::string_view line, int column, char delimiter)
+{
+    // Sorts ask for a field from every line, so this isn't allocated for each of them
+    thread_local std::vector<quint32> offsets;
+    offsets.clear();
+    splitLine(line.data(), static_cast<qsizetype>(line.size()), delimiter, offsets);
+
+    if (column < 0 || static_cast<size_t>(column) + 1 >= offsets.size())
+        return std::string_view();
+
+    std::string_view text = line.substr(offsets[column], offsets[column + 1] - 1 - offsets[column]);
+
+    // Without the quotes around it, so quoted and unquoted values compare the same
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        text = text.substr(1, text.size() - 2);
+    }
+
+    return text;
+}
+
+CsvColumns::CsvColumns(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("CsvColumns");
+
+    indicator = editor->allocateIndicator(QStringLiteral("csv_column"));
+    editor->indicSetFore(indicator, 0x808080);
+    editor->indicSetStyle(indicator, INDIC_STRAIGHTBOX);
+    editor->indicSetAlpha(indicator, 30);
+    editor->indicSetOutlineAlpha(indicator, 0);
+    editor->indicSetUnder(indicator, true);
+
+    connect(editor, &ScintillaEdit::notify, this, &CsvColumns::notify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, [=]() {
+        lineFields.clear();
+        updateVisibleLines();
+    });
+}
+
+void CsvColumns::setEnabled(bool enabled)
+{
+    if (this->enabled == enabled)
+        return;
+
+    this->enabled = enabled;
+
+    if (enabled) {
+        editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+        const qsizetype length = qMin<qsizetype>(editor->length(), DETECT_LENGTH);
+        fieldDelimiter = detectDelimiter(reinterpret_cast<const char *>(editor->rangePointer(0, length)), length);
+
+        updateVisibleLines();
+    }
+    else {
+        editor->setModificationsNeeded(this, ModificationFlags::None);
+
+        editor->setIndicatorCurrent(indicator);
+        editor->indicatorClearRange(0, editor->length());
+
+        clearTabStops();
+        lineFields.clear();
+        aligned = false;
+    }
+
+    emit enabledChanged(enabled);
+}
+
+void CsvColumns::setDelimiter(char delimiter)
+{
+    // A quote can only ever start or end a quoted field
+    if (delimiter == '"' || delimiter == fieldDelimiter)
+        return;
+
+    fieldDelimiter = delimiter;
+    lineFields.clear();
+
+    clearTabStops();
+    aligned = aligned && canAlign();
+
+    updateVisibleLines();
+}
+
+void CsvColumns::setAligned(bool aligned)
+{
+    this->aligned = aligned && canAlign();
+
+    if (!this->aligned) {
+        clearTabStops();
+    }
+
+    updateVisibleLines();
+}
+
+const std::vector<quint32> &CsvColumns::fieldOffsets(Sci_Position line)
+{
+    auto it = lineFields.find(line);
+
+    if (it != lineFields.end())
+        return it->second;
+
+    if (lineFields.size() >= MAX_CACHED_LINES) {
+        lineFields.clear();
+    }
+
+    std::vector<quint32> &offsets = lineFields[line];
+
+    const Sci_Position start = editor->positionFromLine(line);
+    const Sci_Position length = editor->lineEndPosition(line) - start;
+    splitLine(reinterpret_cast<const char *>(editor->rangePointer(start, length)), length, fieldDelimiter, offsets);
+
+    return offsets;
+}
+
+int CsvColumns::columnAt(Sci_Position position)
+{
+    const Sci_Position line = editor->lineFromPosition(position);
+    const std::vector<quint32> &offsets = fieldOffsets(line);
+    const quint32 offset = static_cast<quint32>(position - editor->positionFromLine(line));
+
+    // The last offset starts the field past the end, which is never the one a position is in
+    const auto it = std::upper_bound(offsets.begin(), offsets.end() - 1, offset);
+
+    return static_cast<int>(std::distance(offsets.begin(), it)) - 1;
+}
+
+int CsvColumns::selectColumn(int column)
+{
+    qInfo(Q_FUNC_INFO);
+
+    Sci_Position firstLine = editor->lineFromPosition(editor->selectionStart());
+    Sci_Position lastLine = editor->lineFromPosition(editor->selectionEnd());
+
+    if (firstLine == lastLine) {
+        firstLine = 0;
+        lastLine = editor->lineCount() - 1;
+    }
+    else if (editor->positionFromLine(lastLine) == editor->selectionEnd()) {
+        // A selection ending at the very start of a line doesn't include it
+        --lastLine;
+    }
+
+    const Sci_Position caretLine = editor->lineFromPosition(editor->currentPos());
+    const Sci_Position spanStart = editor->positionFromLine(firstLine);
+    const Sci_Position spanEnd = editor->lineEndPosition(lastLine);
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(spanStart, spanEnd - spanStart));
+    const qsizetype length = spanEnd - spanStart;
+
+    // The lines are split straight from the text rather than through the cache, they are most likely only
+    // needed this once
+    std::vector<Sci_CharacterRange> ranges;
+    std::vector<quint32> offsets;
+    int mainSelection = 0;
+
+    qsizetype lineStart = 0;
+    Sci_Position line = firstLine;
+
+    while (lineStart <= length) {
+        qsizetype lineEnd = lineStart;
+        while (lineEnd < length && text[lineEnd] != '\n' && text[lineEnd] != '\r')
+            ++lineEnd;
+
+        offsets.clear();
+        splitLine(text + lineStart, lineEnd - lineStart, fieldDelimiter, offsets);
+
+        if (column >= 0 && static_cast<size_t>(column) + 1 < offsets.size()) {
+            const Sci_PositionCR start = static_cast<Sci_PositionCR>(spanStart + lineStart + offsets[column]);
+            const Sci_PositionCR end = static_cast<Sci_PositionCR>(spanStart + lineStart + offsets[column + 1] - 1);
+
+            if (line == caretLine) {
+                mainSelection = static_cast<int>(ranges.size());
+            }
+
+            ranges.push_back({start, end});
+        }
+
+        if (lineEnd < length && text[lineEnd] == '\r' && lineEnd + 1 < length && text[lineEnd + 1] == '\n')
+            ++lineEnd;
+
+        lineStart = lineEnd + 1;
+        ++line;
+    }
+
+    if (!ranges.empty()) {
+        editor->selectRanges(ranges, mainSelection);
+    }
+
+    return static_cast<int>(ranges.size());
+}
+
+void CsvColumns::notify(const NotificationData *pscn)
+{
+    if (!enabled)
+        return;
+
+    if (pscn->nmhdr.code == Notification::UpdateUI) {
+        if (FlagSet(pscn->updated, Update::Content) || FlagSet(pscn->updated, Update::VScroll)) {
+            updateVisibleLines();
+        }
+    }
+    else if (pscn->nmhdr.code == Notification::Zoom) {
+        // The widths are in pixels, so they are measured again at the new size
+        columnWidths.clear();
+        updateVisibleLines();
+    }
+    else if (pscn->nmhdr.code == Notification::Modified) {
+        if (!FlagSet(pscn->modificationType, ModificationFlags::InsertText) && !FlagSet(pscn->modificationType, ModificationFlags::DeleteText))
+            return;
+
+        if (pscn->linesAdded != 0) {
+            // Every line after it has a different number now
+            lineFields.clear();
+
+            if (alignedLast >= 0 && pscn->linesAdded > 0) {
+                alignedLast += pscn->linesAdded;
+            }
+        }
+        else {
+            lineFields.erase(editor->lineFromPosition(pscn->position));
+        }
+    }
+}
+
+void CsvColumns::updateVisibleLines()
+{
+    if (!enabled)
+        return;
+
+    // The document lines on screen, each once even if it's wrapped, skipping any that are hidden
+    std::vector<Sci_Position> lines;
+    const Sci_Position firstVisible = editor->firstVisibleLine();
+    const Sci_Position lineCount = editor->lineCount();
+
+    for (Sci_Position visible = firstVisible; visible <= firstVisible + editor->linesOnScreen(); ++visible) {
+        const Sci_Position line = editor->docLineFromVisible(visible);
+
+        if (line >= lineCount)
+            break;
+
+        if ((lines.empty() || lines.back() != line) && editor->lineLength(line) <= MAX_LINE_LENGTH) {
+            lines.push_back(line);
+        }
+    }
+
+    if (lines.empty())
+        return;
+
+    editor->setIndicatorCurrent(indicator);
+    editor->indicatorClearRange(editor->positionFromLine(lines.front()), editor->lineEndPosition(lines.back()) - editor->positionFromLine(lines.front()));
+
+    // Every other field is shaded so the columns stand out from each other
+    for (Sci_Position line : lines) {
+        const std::vector<quint32> &offsets = fieldOffsets(line);
+        const Sci_Position lineStart = editor->positionFromLine(line);
+
+        for (size_t i = 1; i + 1 < offsets.size(); i += 2) {
+            editor->indicatorFillRange(lineStart + offsets[i], offsets[i + 1] - 1 - offsets[i]);
+        }
+    }
+
+    if (!aligned)
+        return;
+
+    for (Sci_Position line : lines) {
+        const std::vector<quint32> &offsets = fieldOffsets(line);
+        const Sci_Position lineStart = editor->positionFromLine(line);
+
+        if (columnWidths.size() + 2 < offsets.size()) {
+            columnWidths.resize(offsets.size() - 2, 0);
+        }
+
+        // The last field doesn't need a tab stop after it
+        for (size_t i = 0; i + 2 < offsets.size(); ++i) {
+            const Sci_Position fieldLength = offsets[i + 1] - 1 - offsets[i];
+            const QByteArray text(reinterpret_cast<const char *>(editor->rangePointer(lineStart + offsets[i], fieldLength)), fieldLength);
+
+            columnWidths[i] = qMax(columnWidths[i], static_cast<int>(editor->textWidth(STYLE_DEFAULT, text.constData())));
+        }
+    }
+
+    const int padding = static_cast<int>(editor->textWidth(STYLE_DEFAULT, "  "));
+
+    for (Sci_Position line : lines) {
+        const std::vector<quint32> &offsets = fieldOffsets(line);
+
+        editor->clearTabStops(line);
+
+        int x = 0;
+        for (size_t i = 0; i + 2 < offsets.size(); ++i) {
+            x += columnWidths[i] + padding;
+            editor->addTabStop(line, x);
+        }
+    }
+
+    alignedFirst = alignedFirst < 0 ? lines.front() : qMin(alignedFirst, lines.front());
+    alignedLast = qMax(alignedLast, lines.back());
+}
+
+void CsvColumns::clearTabStops()
+{
+    if (alignedFirst >= 0) {
+        const Sci_Position last = qMin(alignedLast, editor->lineCount() - 1);
+
+        for (Sci_Position line = alignedFirst; line <= last; ++line) {
+            editor->clearTabStops(line);
+        }
+    }
+
+    alignedFirst = -1;
+    alignedLast = -1;
+    columnWidths.clear();
+}
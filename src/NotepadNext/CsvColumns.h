@@ -0,0 +1,110 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CSVCOLUMNS_H
+#define CSVCOLUMNS_H
+
+#include <QObject>
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Scintilla.h"
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Treats the lines of an editor as the records of a CSV (or TSV, etc.) file. Where the fields of a line start is
+// only worked out when something asks for that line, such as the lines on screen, and kept until the line is
+// edited, so even a file of several GB costs nothing until it is looked at. Quoted fields may contain the
+// delimiter, but each line is split on its own so a quoted field can't carry on past the end of its line.
+//
+// While enabled the fields of the lines on screen are shaded a column at a time, and a tab separated file can
+// also be aligned by giving each line tab stops at the widest field of each column seen so far. There is one per
+// editor, use CsvColumns::forEditor() to get it.
+class CsvColumns : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CsvColumns *forEditor(ScintillaNext *editor);
+
+    // Guesses the delimiter from the first lines of the text, ',' if nothing looks likely
+    static char detectDelimiter(const char *text, qsizetype length);
+
+    // Appends where each field of the line starts, followed by length + 1 as if another field started just past
+    // the end of it, so field i is always from offsets[i] up to offsets[i + 1] - 1
+    static void splitLine(const char *text, qsizetype length, char delimiter, std::vector<quint32> &offsets);
+
+    // The text of the given field (0 based) of the line, or an empty view if it doesn't have that many
+    static std::string_view field(std::string_view line, int column, char delimiter);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    void setDelimiter(char delimiter);
+    char delimiter() const { return fieldDelimiter; }
+
+    // Only a tab delimiter can be aligned as the columns line up at the tab stops
+    void setAligned(bool aligned);
+    bool isAligned() const { return aligned; }
+    bool canAlign() const { return fieldDelimiter == '\t'; }
+
+    const std::vector<quint32> &fieldOffsets(Sci_Position line);
+    int columnAt(Sci_Position position);
+
+    // Selects the given field of every line of the selection, or of the whole document if the selection is on a
+    // single line, as one selection per line. Returns how many lines had the field.
+    int selectColumn(int column);
+
+signals:
+    void enabledChanged(bool enabled);
+
+private slots:
+    void notify(const Scintilla::NotificationData *pscn);
+
+private:
+    explicit CsvColumns(ScintillaNext *editor);
+
+    void updateVisibleLines();
+    void clearTabStops();
+
+    ScintillaNext *editor;
+    int indicator;
+
+    bool enabled = false;
+    bool aligned = false;
+    char fieldDelimiter = ',';
+
+    std::unordered_map<Sci_Position, std::vector<quint32>> lineFields;
+
+    // Only grow, so the columns don't move about as different lines are scrolled into view
+    std::vector<int> columnWidths;
+
+    // The lines that might have tab stops set, which is moved down as lines are added above it
+    Sci_Position alignedFirst = -1;
+    Sci_Position alignedLast = -1;
+};
+
+#endif // CSVCOLUMNS_H
@@ -19,25 +19,105 @@
 
 #include "DebugManager.h"
 
+#include <QCoreApplication>
 #include <QList>
+#include <QTimer>
 
+#include <atomic>
 
-Q_GLOBAL_STATIC(QList<DebugOutputHandler>, handlers);
-Q_GLOBAL_STATIC(QStringList, buffered_debug_output);
-QtMessageHandler original = Q_NULLPTR;
 
-static void buffer_debug_output(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+// How often queued messages are handed to the handlers
+static const int DRAIN_INTERVAL = 100;
+
+// A bounded queue that any number of threads can push to without locking, and the main thread pops
+// from. Each slot has a sequence number that says whether it is free for the next writer or holds a
+// message for the reader. If the queue is full the message is dropped rather than blocking the thread
+// that is logging.
+class MessageQueue
 {
-    buffered_debug_output->append(qFormatLogMessage(type, context, msg));
+public:
+    static const size_t Capacity = 8192;
 
-    original(type, context, msg);
-}
+    MessageQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(QString &&message)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        for (;;) {
+            slot = &slots[pos & (Capacity - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const qptrdiff difference = static_cast<qptrdiff>(sequence) - static_cast<qptrdiff>(pos);
+
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->message = std::move(message);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only ever called from the main thread
+    bool pop(QString &message)
+    {
+        Slot *slot = &slots[head & (Capacity - 1)];
+
+        if (slot->sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+
+        message = std::move(slot->message);
+        slot->message = QString();
+        slot->sequence.store(head + Capacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+    int takeDropped()
+    {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        QString message;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<size_t> tail{0};
+    size_t head = 0;
+    std::atomic_int dropped{0};
+};
+
+Q_GLOBAL_STATIC(QList<DebugOutputHandler>, handlers);
+Q_GLOBAL_STATIC(MessageQueue, queued_debug_output);
+QtMessageHandler original = Q_NULLPTR;
+static QTimer *drainTimer = Q_NULLPTR;
 
 static void debug_manager_handler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-    const QString log_message = qFormatLogMessage(type, context, msg);
-    for (DebugOutputHandler handler : *handlers) {
-        handler(log_message);
+    // This can be called from any thread, so nothing here may block or touch the handlers directly
+    if (!queued_debug_output.isDestroyed()) {
+        queued_debug_output->push(qFormatLogMessage(type, context, msg));
     }
 
     original(type, context, msg);
@@ -58,28 +138,50 @@ void DebugManager::manageDebugOutput()
 
 void DebugManager::pauseDebugOutput()
 {
-    // Just to be safe, restore the original message handler
-    qInstallMessageHandler(0);
-
-    buffered_debug_output->clear();
-
-    original = qInstallMessageHandler(buffer_debug_output);
+    // Messages keep queuing up, they just aren't handed out until output is resumed
+    if (drainTimer) {
+        drainTimer->stop();
+    }
 }
 
 void DebugManager::resumeDebugOutput()
 {
-    for (DebugOutputHandler handler : *handlers) {
-        for (const QString &msg : *buffered_debug_output) {
-            handler(msg);
-        }
+    if (!drainTimer) {
+        drainTimer = new QTimer(QCoreApplication::instance());
+        drainTimer->setInterval(DRAIN_INTERVAL);
+        QObject::connect(drainTimer, &QTimer::timeout, drainTimer, &DebugManager::drainDebugOutput);
     }
 
-    buffered_debug_output->clear();
+    drainDebugOutput();
 
-    qInstallMessageHandler(debug_manager_handler);
+    drainTimer->start();
 }
 
 void DebugManager::addMessageHandler(DebugOutputHandler handler)
 {
     handlers->append(handler);
 }
+
+void DebugManager::drainDebugOutput()
+{
+    QStringList messages;
+    QString message;
+
+    // Don't take more than a queue's worth, otherwise a handler that logs could keep this going forever
+    while (messages.size() < static_cast<int>(MessageQueue::Capacity) && queued_debug_output->pop(message)) {
+        messages.append(std::move(message));
+    }
+
+    const int dropped = queued_debug_output->takeDropped();
+    if (dropped > 0) {
+        messages.append(QStringLiteral("[%1 debug messages were dropped]").arg(dropped));
+    }
+
+    if (messages.isEmpty()) {
+        return;
+    }
+
+    for (DebugOutputHandler handler : *handlers) {
+        handler(messages);
+    }
+}
@@ -20,15 +20,18 @@
 #ifndef DEBUGMANAGER_H
 #define DEBUGMANAGER_H
 
+#include <QStringList>
 #include <QtMessageHandler>
 
-typedef void (*DebugOutputHandler)(const QString &str);
+// Handlers are always called on the main thread with a batch of messages in the order they were logged
+typedef void (*DebugOutputHandler)(const QStringList &messages);
 
 namespace DebugManager {
     void manageDebugOutput();
     void pauseDebugOutput();
     void resumeDebugOutput();
     void addMessageHandler(DebugOutputHandler handler);
+    void drainDebugOutput();
 }
 
 #endif // DEBUGMANAGER_H
@@ -26,7 +26,9 @@
 #include "DockAreaTitleBar.h"
 
 #include "ScintillaNext.h"
+#include "Logging.h"
 
+#include <QSet>
 #include <QUuid>
 
 
@@ -84,14 +86,23 @@ DockedEditor::DockedEditor(QWidget *parent) : QObject(parent)
             Q_UNUSED(from);
             Q_UNUSED(to);
 
+            invalidateEditorList();
             emit editorOrderChanged();
         });
 
+        // Dragging a tab to another area takes it out of one tab bar and puts it in another
+        connect(DockArea->titleBar()->tabBar(), &ads::CDockAreaTabBar::tabInserted, this, &DockedEditor::invalidateEditorList);
+        connect(DockArea->titleBar()->tabBar(), &ads::CDockAreaTabBar::removingTab, this, &DockedEditor::invalidateEditorList);
+        connect(DockArea, &QObject::destroyed, this, &DockedEditor::invalidateEditorList);
+
         // In theory the order changes when a new dock area is created (e.g. editor is dragged and dropped),
         // but the dockAreaCreated() signal is triggered before it is actually added to the CDockManager,
         // so interrogating the dock manager during the signal doesn't help.
         //emit editorOrderChanged();
     });
+
+    connect(dockManager, &ads::CDockContainerWidget::dockAreasAdded, this, &DockedEditor::invalidateEditorList);
+    connect(dockManager, &ads::CDockContainerWidget::dockAreasRemoved, this, &DockedEditor::invalidateEditorList);
 }
 
 
@@ -102,26 +113,27 @@ ScintillaNext *DockedEditor::getCurrentEditor() const
 
 int DockedEditor::count() const
 {
-    int total = 0;
-
-    for (int i = 0; i < dockManager->dockAreaCount(); ++i)
-        total += dockManager->dockArea(i)->dockWidgetsCount();
-
-    return total;
+    return editors().size();
 }
 
 QVector<ScintillaNext *> DockedEditor::editors() const
 {
-    QVector<ScintillaNext *> editors;
+    if (editorListValid) {
+        return editorList;
+    }
+
+    editorList.clear();
 
     // For each area, for each widget, append it to our list
     for (const ads::CDockAreaWidget* areaWidget : dockManager->openedDockAreas()) {
         for (const ads::CDockWidget* dockWidget : areaWidget->dockWidgets()) {
-            editors.append(qobject_cast<ScintillaNext *>(dockWidget->widget()));
+            editorList.append(qobject_cast<ScintillaNext *>(dockWidget->widget()));
         }
     }
 
-    return editors;
+    editorListValid = true;
+
+    return editorList;
 }
 
 void DockedEditor::switchToEditor(const ScintillaNext *editor)
@@ -136,6 +148,92 @@ void DockedEditor::switchToEditor(const ScintillaNext *editor)
     }
 }
 
+void DockedEditor::beginClosingEditors(const QVector<ScintillaNext *> &editors)
+{
+    Q_ASSERT(!closingEditors);
+
+    closingEditors = true;
+
+    // Otherwise closing the current tab shows the next one, which may be about to close too, and so on through all
+    // of them. The closest one that stays open in the same area is picked, the same as closing just the one would.
+    if (currentEditor != Q_NULLPTR && editors.contains(currentEditor)) {
+        const QVector<ScintillaNext *> all = this->editors();
+        const int current = all.indexOf(currentEditor);
+        const ads::CDockAreaWidget *area = currentDockArea();
+        const QSet<ScintillaNext *> closing(editors.begin(), editors.end());
+        ScintillaNext *next = Q_NULLPTR;
+
+        auto stays = [&](int i) {
+            return !closing.contains(all[i]) && qobject_cast<ads::CDockWidget *>(all[i]->parentWidget())->dockAreaWidget() == area;
+        };
+
+        for (int i = current + 1; next == Q_NULLPTR && i < all.size(); ++i) {
+            if (stays(i))
+                next = all[i];
+        }
+
+        for (int i = current - 1; next == Q_NULLPTR && i >= 0; --i) {
+            if (stays(i))
+                next = all[i];
+        }
+
+        if (next != Q_NULLPTR) {
+            switchToEditor(next);
+        }
+    }
+
+    dockManager->setUpdatesEnabled(false);
+}
+
+void DockedEditor::endClosingEditors()
+{
+    Q_ASSERT(closingEditors);
+
+    closingEditors = false;
+
+    dockManager->setUpdatesEnabled(true);
+
+    if (!closedEditors.isEmpty()) {
+        const QVector<ScintillaNext *> closed = closedEditors;
+        closedEditors.clear();
+
+        emit editorsClosed(closed);
+    }
+}
+
+void DockedEditor::showSideBySide(const ScintillaNext *left, const ScintillaNext *right)
+{
+    ads::CDockWidget *leftDock = qobject_cast<ads::CDockWidget *>(left->parentWidget());
+    ads::CDockWidget *rightDock = qobject_cast<ads::CDockWidget *>(right->parentWidget());
+
+    if (leftDock == Q_NULLPTR || rightDock == Q_NULLPTR) {
+        qWarning() << "Expected editor's parent to be CDockWidget";
+        return;
+    }
+
+    if (leftDock->dockAreaWidget() == rightDock->dockAreaWidget()) {
+        ads::CDockAreaWidget *otherArea = Q_NULLPTR;
+
+        for (ads::CDockAreaWidget *areaWidget : dockManager->openedDockAreas()) {
+            if (areaWidget != leftDock->dockAreaWidget()) {
+                otherArea = areaWidget;
+                break;
+            }
+        }
+
+        // Use the other view when there already is one, rather than splitting again
+        if (otherArea != Q_NULLPTR) {
+            dockManager->addDockWidget(ads::CenterDockWidgetArea, rightDock, otherArea);
+        }
+        else {
+            dockManager->addDockWidget(ads::RightDockWidgetArea, rightDock, leftDock->dockAreaWidget());
+        }
+    }
+
+    leftDock->raise();
+    rightDock->raise();
+}
+
 void DockedEditor::dockWidgetCloseRequested()
 {
     ads::CDockWidget *dockWidget = qobject_cast<ads::CDockWidget *>(sender());
@@ -158,7 +256,7 @@ ads::CDockAreaWidget *DockedEditor::currentDockArea() const
 
 void DockedEditor::addEditor(ScintillaNext *editor)
 {
-    qInfo(Q_FUNC_INFO);
+    qCDebug(lcUi, Q_FUNC_INFO);
 
     Q_ASSERT(editor != Q_NULLPTR);
 
@@ -196,25 +294,45 @@ void DockedEditor::addEditor(ScintillaNext *editor)
     }
 
     // Set the icon
-    if (editor->readOnly()) {
-        dockWidget->tabWidget()->setIcon(QIcon(":/icons/readonly.png"));
-    }
-    else {
-        dockWidget->tabWidget()->setIcon(QIcon(editor->canSaveToDisk() ? ":/icons/unsaved.png" : ":/icons/saved.png"));
-        connect(editor, &ScintillaNext::savePointChanged, dockWidget, [=](bool dirty) {
+    auto updateIcon = [=]() {
+        if (editor->isSaving()) {
+            dockWidget->tabWidget()->setIcon(QIcon(":/icons/arrow_refresh.png"));
+        }
+        else if (editor->readOnly()) {
+            dockWidget->tabWidget()->setIcon(QIcon(":/icons/readonly.png"));
+        }
+        else {
             const bool actuallyDirty = editor->canSaveToDisk();
             const QString iconPath = actuallyDirty ? ":/icons/unsaved.png" : ":/icons/saved.png";
             dockWidget->tabWidget()->setIcon(QIcon(iconPath));
-        });
-    }
+        }
+    };
+
+    updateIcon();
+    connect(editor, &ScintillaNext::savePointChanged, dockWidget, updateIcon);
+    connect(editor, &ScintillaNext::saveStarted, dockWidget, updateIcon);
+    connect(editor, &ScintillaNext::saved, dockWidget, updateIcon);
+    connect(editor, &ScintillaNext::saveFailed, dockWidget, updateIcon);
+    connect(editor, &ScintillaNext::loadingFinished, dockWidget, updateIcon);
 
     connect(editor, &ScintillaNext::closed, dockWidget, &ads::CDockWidget::closeDockWidget);
-    connect(editor, &ScintillaNext::closed, this, [=]() { emit editorClosed(editor); });
+    connect(editor, &ScintillaNext::closed, this, [=]() {
+        invalidateEditorList();
+
+        if (closingEditors) {
+            closedEditors.append(editor);
+        }
+        else {
+            emit editorClosed(editor);
+        }
+    });
+    connect(editor, &QObject::destroyed, this, &DockedEditor::invalidateEditorList);
     connect(editor, &ScintillaNext::renamed, this, [=]() { editorRenamed(editor); });
 
     connect(dockWidget, &ads::CDockWidget::closeRequested, this, &DockedEditor::dockWidgetCloseRequested);
 
     dockManager->addDockWidget(ads::CenterDockWidgetArea, dockWidget, currentDockArea());
+    invalidateEditorList();
 
     emit editorAdded(editor);
 }
@@ -33,6 +33,16 @@ private:
     ads::CDockManager* dockManager = Q_NULLPTR;
     ScintillaNext *currentEditor = Q_NULLPTR;
 
+    // Kept in tab order and only walked again after a tab was added, closed or moved, since it gets asked for
+    // constantly and there can be a lot of tabs
+    mutable QVector<ScintillaNext *> editorList;
+    mutable bool editorListValid = false;
+
+    void invalidateEditorList() { editorListValid = false; }
+
+    bool closingEditors = false;
+    QVector<ScintillaNext *> closedEditors;
+
 public:
     explicit DockedEditor(QWidget *parent);
 
@@ -43,8 +53,17 @@ public:
 
     void switchToEditor(const ScintillaNext *editor);
 
+    // Shows the two editors next to each other, moving the right one into another dock area if they share one
+    void showSideBySide(const ScintillaNext *left, const ScintillaNext *right);
+
     int count() const;
 
+    // Between these, editors that are closed don't each move the current tab, repaint the dock areas or send
+    // editorClosed(). If the current editor is one of them another one is switched to first, and editorsClosed()
+    // is sent once for all of them at the end.
+    void beginClosingEditors(const QVector<ScintillaNext *> &editors);
+    void endClosingEditors();
+
 public slots:
     void addEditor(ScintillaNext *editor);
 
@@ -56,6 +75,7 @@ signals:
     void editorAdded(ScintillaNext *editor);
     void editorCloseRequested(ScintillaNext *editor);
     void editorClosed(ScintillaNext *editor);
+    void editorsClosed(const QVector<ScintillaNext *> &editors);
     void editorActivated(ScintillaNext *editor);
     void editorOrderChanged();
 
@@ -22,13 +22,22 @@
 
 
 #include <DockAreaTitleBar.h>
+#include <QToolButton>
+
+#include "TabListMenu.h"
 
 class DockedEditorTitleBar : public ads::CDockAreaTitleBar
 {
     Q_OBJECT
 
 public:
-    explicit DockedEditorTitleBar(ads::CDockAreaWidget* parent) : ads::CDockAreaTitleBar(parent) {}
+    explicit DockedEditorTitleBar(ads::CDockAreaWidget* parent) : ads::CDockAreaTitleBar(parent) {
+        QToolButton *tabsButton = qobject_cast<QToolButton *>(button(ads::TitleBarButtonTabsMenu));
+
+        if (tabsButton) {
+            tabsButton->setMenu(new TabListMenu(parent, tabsButton));
+        }
+    }
 
 signals:
     void doubleClicked();
@@ -0,0 +1,528 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "DocumentCompare.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+using namespace Scintilla;
+
+
+const int MARK_COMPARE_GAP = 17;
+const int MARK_COMPARE_CHANGED = 18;
+const int MARK_COMPARE_ADDED = 19;
+const int MARK_COMPARE_REMOVED = 20;
+
+const int COMPARE_MARKERS[] = {MARK_COMPARE_GAP, MARK_COMPARE_CHANGED, MARK_COMPARE_ADDED, MARK_COMPARE_REMOVED};
+const int COMPARE_MARKER_MASK = (1 << MARK_COMPARE_GAP) | (1 << MARK_COMPARE_CHANGED) | (1 << MARK_COMPARE_ADDED) | (1 << MARK_COMPARE_REMOVED);
+
+// How long after the last edit to diff the edited lines again
+const int REDIFF_DELAY_MS = 250;
+
+// Unchanged lines either side of an edit that are diffed with it, so a line typed next to a difference can join it
+const int CONTEXT_LINES = 3;
+
+// Past this many changed lines in one diff the characters within them aren't compared
+const int MAX_PAIRED_LINES = 100000;
+
+static Sci_Position lineStart(ScintillaNext *editor, int line)
+{
+    return line >= editor->lineCount() ? editor->length() : editor->positionFromLine(line);
+}
+
+static void setUpEditor(ScintillaNext *editor, int indicator)
+{
+    // Backgrounds in the BGR order Scintilla uses: yellow, green, red
+    editor->markerDefine(MARK_COMPARE_CHANGED, SC_MARK_BACKGROUND);
+    editor->markerSetBack(MARK_COMPARE_CHANGED, 0xA0FFFF);
+    editor->markerDefine(MARK_COMPARE_ADDED, SC_MARK_BACKGROUND);
+    editor->markerSetBack(MARK_COMPARE_ADDED, 0xC0FFC0);
+    editor->markerDefine(MARK_COMPARE_REMOVED, SC_MARK_BACKGROUND);
+    editor->markerSetBack(MARK_COMPARE_REMOVED, 0xC0C0FF);
+
+    // Where the lines that are only in the other editor would be
+    editor->markerDefine(MARK_COMPARE_GAP, SC_MARK_UNDERLINE);
+    editor->markerSetBack(MARK_COMPARE_GAP, 0x4040FF);
+
+    editor->indicSetStyle(indicator, INDIC_FULLBOX);
+    editor->indicSetFore(indicator, 0x0080FF);
+    editor->indicSetAlpha(indicator, 80);
+    editor->indicSetOutlineAlpha(indicator, 0);
+    editor->indicSetUnder(indicator, true);
+}
+
+static void clearMarkers(ScintillaNext *editor, int first, int last)
+{
+    if (first <= 0 && last >= editor->lineCount()) {
+        for (int marker : COMPARE_MARKERS) {
+            editor->markerDeleteAll(marker);
+        }
+        return;
+    }
+
+    for (int line = editor->markerNext(qMax(0, first), COMPARE_MARKER_MASK); line >= 0 && line < last; line = editor->markerNext(line + 1, COMPARE_MARKER_MASK)) {
+        for (int marker : COMPARE_MARKERS) {
+            editor->markerDelete(line, marker);
+        }
+    }
+}
+
+static void addMarker(ScintillaNext *editor, int line, int marker)
+{
+    if (line >= 0 && line < editor->lineCount() && !(editor->markerGet(line) & (1 << marker))) {
+        editor->markerAdd(line, marker);
+    }
+}
+
+DocumentCompare::DocumentCompare(ScintillaNext *left, ScintillaNext *right, QObject *parent) :
+    QObject(parent),
+    left(left),
+    right(right)
+{
+    setObjectName("DocumentCompare");
+
+    leftIndicator = left->allocateIndicator(QStringLiteral("compare_changes"));
+    rightIndicator = right->allocateIndicator(QStringLiteral("compare_changes"));
+
+    for (ScintillaNext *editor : {left, right}) {
+        const bool isLeft = editor == left;
+
+        setUpEditor(editor, isLeft ? leftIndicator : rightIndicator);
+        editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+        connect(editor, &ScintillaEdit::notify, this, [=](const NotificationData *pscn) { editorNotified(isLeft, pscn); });
+        connect(editor, &ScintillaNext::modificationsResumed, this, [=]() {
+            markAllDirty();
+            diffTimer.start();
+        });
+        connect(editor, &ScintillaNext::closed, this, &QObject::deleteLater);
+        connect(editor, &QObject::destroyed, this, &QObject::deleteLater);
+    }
+
+    diffTimer.setSingleShot(true);
+    diffTimer.setInterval(REDIFF_DELAY_MS);
+    connect(&diffTimer, &QTimer::timeout, this, &DocumentCompare::startDiff);
+
+    markAllDirty();
+    startDiff();
+}
+
+DocumentCompare::~DocumentCompare()
+{
+    for (ScintillaNext *editor : {left.data(), right.data()}) {
+        if (editor == Q_NULLPTR)
+            continue;
+
+        clearMarkers(editor, 0, editor->lineCount());
+        editor->setIndicatorCurrent(editor == left ? leftIndicator : rightIndicator);
+        editor->indicatorClearRange(0, editor->length());
+    }
+}
+
+bool DocumentCompare::goToDifference(ScintillaNext *editor, bool forward)
+{
+    if (!isComparing(editor))
+        return false;
+
+    const bool isLeft = editor == left;
+    const int line = static_cast<int>(editor->lineFromPosition(editor->currentPos()));
+    int target = -1;
+
+    for (const LineDiff::LineHunk &hunk : hunks) {
+        const int start = isLeft ? hunk.oldStart : hunk.newStart;
+
+        if (forward && start > line) {
+            target = start;
+            break;
+        }
+        if (!forward && start < line) {
+            target = start;
+        }
+    }
+
+    if (target < 0)
+        return false;
+
+    target = qMin(target, static_cast<int>(editor->lineCount()) - 1);
+    editor->ensureVisible(target);
+    editor->gotoLine(target);
+    editor->verticalCentreCaret();
+
+    return true;
+}
+
+DocumentCompare::Result DocumentCompare::diffText(const QByteArray &leftText, const QByteArray &rightText, Sci_Position leftOffset, Sci_Position rightOffset)
+{
+    Result result;
+    result.hunks = LineDiff::diffLines(leftText, rightText);
+
+    auto lineStarts = [](const QByteArray &text) {
+        std::vector<qint64> starts{0};
+        const char *data = text.constData();
+
+        for (const char *p = data; (p = static_cast<const char *>(std::memchr(p, '\n', text.constData() + text.size() - p))) != nullptr; ++p) {
+            starts.push_back(p + 1 - data);
+        }
+
+        starts.push_back(text.size());
+        return starts;
+    };
+
+    // Where line i ends, without its line end
+    auto lineEnd = [](const QByteArray &text, const std::vector<qint64> &starts, int line) {
+        qint64 end = starts[line + 1];
+        while (end > starts[line] && (text[static_cast<int>(end - 1)] == '\n' || text[static_cast<int>(end - 1)] == '\r'))
+            --end;
+        return end;
+    };
+
+    const std::vector<qint64> leftStarts = lineStarts(leftText);
+    const std::vector<qint64> rightStarts = lineStarts(rightText);
+    int pairs = 0;
+
+    // The lines of a change are paired up in order, and whatever is between their common start and end differs
+    for (const LineDiff::LineHunk &hunk : result.hunks) {
+        const int count = qMin(hunk.oldEnd - hunk.oldStart, hunk.newEnd - hunk.newStart);
+
+        for (int i = 0; i < count && pairs < MAX_PAIRED_LINES; ++i, ++pairs) {
+            const qint64 a = leftStarts[hunk.oldStart + i];
+            const qint64 b = rightStarts[hunk.newStart + i];
+            const qint64 aLength = lineEnd(leftText, leftStarts, hunk.oldStart + i) - a;
+            const qint64 bLength = lineEnd(rightText, rightStarts, hunk.newStart + i) - b;
+            const char *x = leftText.constData() + a;
+            const char *y = rightText.constData() + b;
+
+            qint64 prefix = 0;
+            while (prefix < aLength && prefix < bLength && x[prefix] == y[prefix])
+                ++prefix;
+
+            qint64 suffix = 0;
+            while (suffix < aLength - prefix && suffix < bLength - prefix && x[aLength - 1 - suffix] == y[bLength - 1 - suffix])
+                ++suffix;
+
+            // Don't split a UTF-8 character
+            while (prefix > 0 && (static_cast<uchar>(x[prefix]) & 0xC0) == 0x80)
+                --prefix;
+            while (suffix > 0 && (static_cast<uchar>(x[aLength - suffix]) & 0xC0) == 0x80)
+                --suffix;
+
+            if (aLength - suffix > prefix) {
+                result.leftChanges.push_back({static_cast<Sci_PositionCR>(leftOffset + a + prefix), static_cast<Sci_PositionCR>(leftOffset + a + aLength - suffix)});
+            }
+            if (bLength - suffix > prefix) {
+                result.rightChanges.push_back({static_cast<Sci_PositionCR>(rightOffset + b + prefix), static_cast<Sci_PositionCR>(rightOffset + b + bLength - suffix)});
+            }
+        }
+    }
+
+    return result;
+}
+
+void DocumentCompare::editorNotified(bool isLeft, const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code == Notification::Modified) {
+        editorModified(isLeft, pscn);
+    }
+    else if (pscn->nmhdr.code == Notification::UpdateUI) {
+        if (FlagSet(pscn->updated, Update::VScroll) || FlagSet(pscn->updated, Update::HScroll)) {
+            syncScrolling(isLeft);
+        }
+    }
+}
+
+void DocumentCompare::editorModified(bool isLeft, const NotificationData *pscn)
+{
+    const bool inserted = FlagSet(pscn->modificationType, ModificationFlags::InsertText);
+    const bool deleted = FlagSet(pscn->modificationType, ModificationFlags::DeleteText);
+
+    if (!inserted && !deleted)
+        return;
+
+    ScintillaNext *editor = isLeft ? left : right;
+    const int added = static_cast<int>(pscn->linesAdded);
+    const int line = static_cast<int>(editor->lineFromPosition(pscn->position));
+
+    // The edit replaced lines [line, oldEnd) with [line, newEnd)
+    const int oldEnd = line + (inserted ? 1 : 1 - added);
+    const int newEnd = line + (inserted ? 1 + added : 1);
+
+    for (LineDiff::LineHunk &hunk : hunks) {
+        int &start = isLeft ? hunk.oldStart : hunk.newStart;
+        int &end = isLeft ? hunk.oldEnd : hunk.newEnd;
+
+        if (start >= oldEnd) {
+            start += added;
+            end += added;
+        }
+        else if (end > line) {
+            // It is going to be diffed again anyway, it only needs to cover the edit
+            end = qMax(end + added, newEnd);
+        }
+    }
+
+    Dirty &dirty = isLeft ? leftDirty : rightDirty;
+
+    if (dirty.isEmpty()) {
+        dirty.start = line;
+        dirty.end = newEnd;
+    }
+    else {
+        dirty.start = dirty.start >= oldEnd ? line : qMin(dirty.start, line);
+        dirty.end = qMax(dirty.end >= oldEnd ? dirty.end + added : dirty.end, newEnd);
+    }
+
+    diffTimer.start();
+}
+
+void DocumentCompare::markAllDirty()
+{
+    hunks.clear();
+    leftDirty = {0, left ? static_cast<int>(left->lineCount()) : 0};
+    rightDirty = {0, right ? static_cast<int>(right->lineCount()) : 0};
+}
+
+void DocumentCompare::startDiff()
+{
+    if (diffRunning || !left || !right || (leftDirty.isEmpty() && rightDirty.isEmpty()))
+        return;
+
+    const int leftCount = static_cast<int>(left->lineCount());
+    const int rightCount = static_cast<int>(right->lineCount());
+
+    // The differences entirely before and after every edited line are still right, so only the lines between them
+    // need to be diffed again
+    auto isBefore = [&](const LineDiff::LineHunk &hunk) {
+        return (leftDirty.isEmpty() || hunk.oldEnd <= leftDirty.start) && (rightDirty.isEmpty() || hunk.newEnd <= rightDirty.start);
+    };
+    auto isAfter = [&](const LineDiff::LineHunk &hunk) {
+        return (leftDirty.isEmpty() || hunk.oldStart >= leftDirty.end) && (rightDirty.isEmpty() || hunk.newStart >= rightDirty.end);
+    };
+
+    int previous = -1;
+    while (previous + 1 < hunks.size() && isBefore(hunks[previous + 1]))
+        ++previous;
+
+    int next = hunks.size();
+    while (next - 1 > previous && isAfter(hunks[next - 1]))
+        --next;
+
+    const int offsetBefore = previous >= 0 ? hunks[previous].newEnd - hunks[previous].oldEnd : 0;
+    const int offsetAfter = next < hunks.size() ? hunks[next].newStart - hunks[next].oldStart : rightCount - leftCount;
+    const int floorLeft = previous >= 0 ? hunks[previous].oldEnd : 0;
+    const int ceilingLeft = next < hunks.size() ? hunks[next].oldStart : leftCount;
+
+    int startLeft = INT_MAX;
+    int endLeft = INT_MIN;
+
+    if (!leftDirty.isEmpty()) {
+        startLeft = leftDirty.start;
+        endLeft = leftDirty.end;
+    }
+    if (!rightDirty.isEmpty()) {
+        startLeft = qMin(startLeft, rightDirty.start - offsetBefore);
+        endLeft = qMax(endLeft, rightDirty.end - offsetAfter);
+    }
+    if (next > previous + 1) {
+        startLeft = qMin(startLeft, hunks[previous + 1].oldStart);
+        endLeft = qMax(endLeft, hunks[next - 1].oldEnd);
+    }
+
+    startLeft = qBound(floorLeft, startLeft - CONTEXT_LINES, ceilingLeft);
+    endLeft = qBound(startLeft, endLeft + CONTEXT_LINES, ceilingLeft);
+
+    int startRight = startLeft + offsetBefore;
+    int endRight = endLeft + offsetAfter;
+
+    // Should the edits have left the differences in a state that doesn't add up, start again from scratch
+    if (startRight < 0 || endRight > rightCount || endRight < startRight) {
+        previous = -1;
+        next = hunks.size();
+        startLeft = 0;
+        endLeft = leftCount;
+        startRight = 0;
+        endRight = rightCount;
+    }
+
+    const Sci_Position leftOffset = lineStart(left, startLeft);
+    const Sci_Position rightOffset = lineStart(right, startRight);
+
+    // The worker gets its own copy of the text since Scintilla is free to move the gap in its buffer at any time
+    const QByteArray leftText(reinterpret_cast<const char *>(left->rangePointer(leftOffset, lineStart(left, endLeft) - leftOffset)), lineStart(left, endLeft) - leftOffset);
+    const QByteArray rightText(reinterpret_cast<const char *>(right->rangePointer(rightOffset, lineStart(right, endRight) - rightOffset)), lineStart(right, endRight) - rightOffset);
+
+    const quint64 leftGeneration = left->changeGeneration();
+    const quint64 rightGeneration = right->changeGeneration();
+    QPointer<DocumentCompare> self = this;
+
+    diffRunning = true;
+
+    QThreadPool::globalInstance()->start([=]() {
+        const Result result = diffText(leftText, rightText, leftOffset, rightOffset);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self)
+                return;
+
+            self->diffRunning = false;
+
+            if (!self->left || !self->right)
+                return;
+
+            // Anything edited in the meantime has moved the lines about, the edits are still marked dirty so just try again
+            if (self->left->changeGeneration() != leftGeneration || self->right->changeGeneration() != rightGeneration) {
+                self->diffTimer.start();
+                return;
+            }
+
+            self->applyResult(previous + 1, next, startLeft, endLeft, startRight, endRight, result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DocumentCompare::applyResult(int hunkBegin, int hunkEnd, int leftStart, int leftEnd, int rightStart, int rightEnd, const Result &result)
+{
+    QVector<LineDiff::LineHunk> newHunks;
+    newHunks.reserve(hunkBegin + result.hunks.size() + hunks.size() - hunkEnd);
+
+    for (int i = 0; i < hunkBegin; ++i) {
+        newHunks.append(hunks[i]);
+    }
+    for (LineDiff::LineHunk hunk : result.hunks) {
+        hunk.oldStart += leftStart;
+        hunk.oldEnd += leftStart;
+        hunk.newStart += rightStart;
+        hunk.newEnd += rightStart;
+        newHunks.append(hunk);
+    }
+    for (int i = hunkEnd; i < hunks.size(); ++i) {
+        newHunks.append(hunks[i]);
+    }
+
+    hunks.swap(newHunks);
+    leftDirty = Dirty();
+    rightDirty = Dirty();
+
+    // The line above the region may have the gap marker of the difference before it, so that one is marked again
+    clearMarkers(left, leftStart - 1, leftEnd);
+    clearMarkers(right, rightStart - 1, rightEnd);
+
+    left->setIndicatorCurrent(leftIndicator);
+    left->indicatorClearRange(lineStart(left, leftStart), lineStart(left, leftEnd) - lineStart(left, leftStart));
+    right->setIndicatorCurrent(rightIndicator);
+    right->indicatorClearRange(lineStart(right, rightStart), lineStart(right, rightEnd) - lineStart(right, rightStart));
+
+    if (hunkBegin > 0) {
+        markHunk(hunks[hunkBegin - 1]);
+    }
+    for (int i = hunkBegin; i < hunkBegin + result.hunks.size(); ++i) {
+        markHunk(hunks[i]);
+    }
+
+    left->setIndicatorCurrent(leftIndicator);
+    for (const Sci_CharacterRange &range : result.leftChanges) {
+        left->indicatorFillRange(range.cpMin, range.cpMax - range.cpMin);
+    }
+
+    right->setIndicatorCurrent(rightIndicator);
+    for (const Sci_CharacterRange &range : result.rightChanges) {
+        right->indicatorFillRange(range.cpMin, range.cpMax - range.cpMin);
+    }
+
+    const bool initial = !compareDone;
+    compareDone = true;
+
+    emit compared(hunks.size(), initial);
+}
+
+void DocumentCompare::markHunk(const LineDiff::LineHunk &hunk)
+{
+    const bool inLeft = hunk.oldEnd > hunk.oldStart;
+    const bool inRight = hunk.newEnd > hunk.newStart;
+
+    for (int line = hunk.oldStart; line < hunk.oldEnd; ++line) {
+        addMarker(left, line, inRight ? MARK_COMPARE_CHANGED : MARK_COMPARE_REMOVED);
+    }
+    for (int line = hunk.newStart; line < hunk.newEnd; ++line) {
+        addMarker(right, line, inLeft ? MARK_COMPARE_CHANGED : MARK_COMPARE_ADDED);
+    }
+
+    if (!inLeft) {
+        addMarker(left, hunk.oldStart - 1, MARK_COMPARE_GAP);
+    }
+    if (!inRight) {
+        addMarker(right, hunk.newStart - 1, MARK_COMPARE_GAP);
+    }
+}
+
+int DocumentCompare::lineFromOtherSide(int line, bool fromLeft) const
+{
+    // The last difference that starts at or before the line
+    auto it = std::upper_bound(hunks.begin(), hunks.end(), line, [fromLeft](int line, const LineDiff::LineHunk &hunk) {
+        return line < (fromLeft ? hunk.oldStart : hunk.newStart);
+    });
+
+    if (it == hunks.begin())
+        return line;
+
+    const LineDiff::LineHunk &hunk = *(it - 1);
+    const int start = fromLeft ? hunk.oldStart : hunk.newStart;
+    const int end = fromLeft ? hunk.oldEnd : hunk.newEnd;
+    const int otherStart = fromLeft ? hunk.newStart : hunk.oldStart;
+    const int otherEnd = fromLeft ? hunk.newEnd : hunk.oldEnd;
+
+    if (line < end)
+        return otherStart + qMin(line - start, qMax(0, otherEnd - otherStart - 1));
+
+    return line - end + otherEnd;
+}
+
+void DocumentCompare::syncScrolling(bool fromLeft)
+{
+    ScintillaNext *from = fromLeft ? left : right;
+    ScintillaNext *to = fromLeft ? right : left;
+    int &expected = fromLeft ? expectedLeftTop : expectedRightTop;
+    int &otherExpected = fromLeft ? expectedRightTop : expectedLeftTop;
+
+    if (!from || !to)
+        return;
+
+    // This is the scroll that was just synced from the other editor
+    const int top = static_cast<int>(from->firstVisibleLine());
+    if (top == expected) {
+        expected = -1;
+        return;
+    }
+    expected = -1;
+
+    const int line = lineFromOtherSide(static_cast<int>(from->docLineFromVisible(top)), fromLeft);
+    const int otherTop = static_cast<int>(to->visibleFromDocLine(line));
+
+    if (otherTop != to->firstVisibleLine()) {
+        otherExpected = otherTop;
+        to->setFirstVisibleLine(otherTop);
+    }
+
+    to->setXOffset(from->xOffset());
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DOCUMENTCOMPARE_H
+#define DOCUMENTCOMPARE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <vector>
+
+#include "LineDiff.h"
+#include "Scintilla.h"
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Compares two editors shown side by side. The lines only in the left one, only in the right one, and changed in
+// both are marked, as are the characters that differ within changed lines, and scrolling one editor scrolls the
+// other to the matching line. The diff runs on a QThreadPool from copies of the text. After an edit only the
+// lines between the differences on either side of the edit are copied and diffed again, and spliced into the
+// rest, so editing one line of a huge file doesn't diff the whole thing.
+class DocumentCompare : public QObject
+{
+    Q_OBJECT
+
+public:
+    DocumentCompare(ScintillaNext *left, ScintillaNext *right, QObject *parent = Q_NULLPTR);
+    ~DocumentCompare() override;
+
+    ScintillaNext *leftEditor() const { return left; }
+    ScintillaNext *rightEditor() const { return right; }
+    bool isComparing(const ScintillaNext *editor) const { return editor != Q_NULLPTR && (editor == left || editor == right); }
+
+    // Old lines are the left editor's and new lines are the right editor's
+    const QVector<LineDiff::LineHunk> &differences() const { return hunks; }
+
+    // Moves the caret of the editor to the start of the next (or previous) difference. Returns false if there isn't one.
+    bool goToDifference(ScintillaNext *editor, bool forward);
+
+signals:
+    void compared(int differences, bool initial);
+
+private:
+    // The lines of one side that have been edited since they were last diffed, in its current line numbers
+    struct Dirty {
+        int start = -1;
+        int end = -1;
+
+        bool isEmpty() const { return start < 0; }
+    };
+
+    struct Result {
+        QVector<LineDiff::LineHunk> hunks;
+        std::vector<Sci_CharacterRange> leftChanges;
+        std::vector<Sci_CharacterRange> rightChanges;
+    };
+
+    static Result diffText(const QByteArray &leftText, const QByteArray &rightText, Sci_Position leftOffset, Sci_Position rightOffset);
+
+    void editorNotified(bool isLeft, const Scintilla::NotificationData *pscn);
+    void editorModified(bool isLeft, const Scintilla::NotificationData *pscn);
+    void markAllDirty();
+    void startDiff();
+    void applyResult(int hunkBegin, int hunkEnd, int leftStart, int leftEnd, int rightStart, int rightEnd, const Result &result);
+    void markHunk(const LineDiff::LineHunk &hunk);
+    void syncScrolling(bool fromLeft);
+
+    int lineFromOtherSide(int line, bool fromLeft) const;
+
+    QPointer<ScintillaNext> left;
+    QPointer<ScintillaNext> right;
+
+    QVector<LineDiff::LineHunk> hunks;
+    Dirty leftDirty;
+    Dirty rightDirty;
+
+    int leftIndicator;
+    int rightIndicator;
+    bool diffRunning = false;
+    bool compareDone = false;
+
+    // What the other editor was scrolled to, so its own scroll notification isn't synced back again
+    int expectedLeftTop = -1;
+    int expectedRightTop = -1;
+
+    QTimer diffTimer;
+};
+
+#endif // DOCUMENTCOMPARE_H
@@ -0,0 +1,285 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "DocumentStatistics.h"
+
+#include <QtAlgorithms>
+#include <QHashFunctions>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+static bool isWordByte(unsigned char c)
+{
+    // Same as BufferSearcher's default word characters
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_' || c >= 0x80;
+}
+
+// Histograms of bytes stall when the same byte comes up again and again, since every increment waits on the last. Four
+// tables taking turns keeps four of them going at once.
+static void countBytes(const unsigned char *data, qsizetype length, std::array<qint64, 256> &counts)
+{
+    std::array<std::array<quint32, 256>, 4> tables{};
+    qsizetype i = 0;
+
+    for (; i + 4 <= length; i += 4) {
+        tables[0][data[i]]++;
+        tables[1][data[i + 1]]++;
+        tables[2][data[i + 2]]++;
+        tables[3][data[i + 3]]++;
+    }
+
+    for (; i < length; ++i) {
+        tables[0][data[i]]++;
+    }
+
+    for (int c = 0; c < 256; ++c) {
+        counts[c] += static_cast<qint64>(tables[0][c]) + tables[1][c] + tables[2][c] + tables[3][c];
+    }
+}
+
+// A word starts wherever a word byte follows anything else, and a character is anything that isn't a UTF-8
+// continuation byte. Both are worked out 16 bytes at a time as bit masks and then counted.
+static void countWordsAndCharacters(const unsigned char *data, qsizetype length, qint64 &words, qint64 &characters)
+{
+    qsizetype i = 0;
+    bool previousWord = false;
+
+#ifdef __SSE2__
+    // Unsigned range checks, x is in [base, base + range] when min(x - base, range) is still x - base
+    auto inRange = [](__m128i bytes, char base, char range) {
+        const __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(base));
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(range)), offset);
+    };
+
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i underscore = _mm_set1_epi8('_');
+    const __m128i continuationMask = _mm_set1_epi8(static_cast<char>(0xC0));
+    const __m128i continuation = _mm_set1_epi8(static_cast<char>(0x80));
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i word = _mm_or_si128(_mm_or_si128(inRange(bytes, '0', 9), inRange(_mm_or_si128(bytes, caseBit), 'a', 25)), _mm_cmpeq_epi8(bytes, underscore));
+
+        // The top bit of each byte is already the mask for anything >= 0x80
+        const unsigned int wordBits = static_cast<unsigned int>(_mm_movemask_epi8(word) | _mm_movemask_epi8(bytes));
+        const unsigned int starts = wordBits & ~((wordBits << 1) | (previousWord ? 1u : 0u));
+        const unsigned int continuations = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, continuationMask), continuation)));
+
+        words += qPopulationCount(starts);
+        characters += 16 - qPopulationCount(continuations);
+        previousWord = wordBits & 0x8000;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        const bool word = isWordByte(data[i]);
+
+        if (word && !previousWord)
+            ++words;
+        if ((data[i] & 0xC0) != 0x80)
+            ++characters;
+
+        previousWord = word;
+    }
+}
+
+// Only needed when there is something other than ASCII, which in most data files there isn't
+static void countOtherCharacters(const unsigned char *data, qsizetype length, QHash<uint, qint64> &counts)
+{
+    for (qsizetype i = 0; i < length;) {
+        const unsigned char c = data[i];
+
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+
+        int width = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        uint codePoint = width == 4 ? (c & 0x07) : width == 3 ? (c & 0x0F) : width == 2 ? (c & 0x1F) : 0xFFFD;
+
+        for (int j = 1; j < width; ++j) {
+            if (i + j >= length || (data[i + j] & 0xC0) != 0x80) {
+                codePoint = 0xFFFD;
+                width = j;
+                break;
+            }
+
+            codePoint = (codePoint << 6) | (data[i + j] & 0x3F);
+        }
+
+        counts[codePoint]++;
+        i += width;
+    }
+}
+
+int BlockStatistics::bucketOf(qint64 length)
+{
+    int bucket = 0;
+
+    while (length > 0 && bucket < LENGTH_BUCKETS - 1) {
+        length >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+static std::shared_ptr<const BlockStatistics> countBlock(const char *data, qsizetype length, bool countLastLine)
+{
+    auto block = std::make_shared<BlockStatistics>();
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+
+    block->bytes = length;
+    countBytes(bytes, length, block->byteCounts);
+    countWordsAndCharacters(bytes, length, block->words, block->characters);
+
+    bool hasOtherCharacters = false;
+    for (int c = 0x80; c < 256 && !hasOtherCharacters; ++c) {
+        hasOtherCharacters = block->byteCounts[c] > 0;
+    }
+    if (hasOtherCharacters)
+        countOtherCharacters(bytes, length, block->otherCharacters);
+
+    auto addLine = [&](qsizetype start, qsizetype end) {
+        // \r\n counts as the line end, not part of the line
+        if (end > start && data[end - 1] == '\r')
+            --end;
+
+        const qint64 lineLength = end - start;
+        QVector<BlockStatistics::Line> &longest = block->longestLines;
+
+        block->lineLengths[BlockStatistics::bucketOf(lineLength)]++;
+        block->lineHashes.push_back(static_cast<quint64>(qHashBits(data + start, static_cast<size_t>(lineLength))));
+
+        if (longest.size() < BlockStatistics::LONGEST_LINES || lineLength > longest.last().length) {
+            auto it = std::upper_bound(longest.begin(), longest.end(), lineLength, [](qint64 length, const BlockStatistics::Line &line) {
+                return length > line.length;
+            });
+            longest.insert(it, {lineLength, block->lines});
+
+            if (longest.size() > BlockStatistics::LONGEST_LINES)
+                longest.removeLast();
+        }
+
+        block->lines++;
+    };
+
+    qsizetype lineStart = 0;
+    while (lineStart < length) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(data + lineStart, '\n', length - lineStart));
+
+        if (lineEnd == Q_NULLPTR)
+            break;
+
+        addLine(lineStart, lineEnd - data);
+        lineStart = lineEnd - data + 1;
+    }
+
+    if (countLastLine)
+        addLine(lineStart, length);
+
+    return block;
+}
+
+std::vector<std::shared_ptr<const BlockStatistics>> BlockStatistics::count(const char *data, qsizetype length, bool endOfDocument, qsizetype blockSize)
+{
+    std::vector<std::shared_ptr<const BlockStatistics>> blocks;
+    qsizetype start = 0;
+
+    do {
+        // Blocks end after a line end, unless the line is longer than the block so it ends up in one of its own
+        qsizetype end = length;
+
+        if (length - start > blockSize) {
+            const char *lineEnd = static_cast<const char *>(std::memchr(data + start + blockSize - 1, '\n', length - start - blockSize + 1));
+
+            if (lineEnd)
+                end = lineEnd - data + 1;
+        }
+
+        blocks.push_back(countBlock(data + start, end - start, endOfDocument && end == length));
+        start = end;
+    } while (start < length);
+
+    return blocks;
+}
+
+void DocumentStatistics::add(const BlockStatistics &block)
+{
+    totals.bytes += block.bytes;
+    totals.lines += block.lines;
+    totals.words += block.words;
+    totals.characters += block.characters;
+
+    for (int c = 0; c < 128; ++c) {
+        totals.asciiCounts[c] += block.byteCounts[c];
+    }
+
+    for (auto it = block.otherCharacters.constBegin(); it != block.otherCharacters.constEnd(); ++it) {
+        totals.otherCharacters[it.key()] += it.value();
+    }
+
+    for (int i = 0; i < BlockStatistics::LENGTH_BUCKETS; ++i) {
+        totals.lineLengths[i] += block.lineLengths[i];
+    }
+
+    for (const quint64 hash : block.lineHashes) {
+        lineCounts[hash]++;
+    }
+
+    totals.distinctLines = lineCounts.size();
+}
+
+void DocumentStatistics::remove(const BlockStatistics &block)
+{
+    totals.bytes -= block.bytes;
+    totals.lines -= block.lines;
+    totals.words -= block.words;
+    totals.characters -= block.characters;
+
+    for (int c = 0; c < 128; ++c) {
+        totals.asciiCounts[c] -= block.byteCounts[c];
+    }
+
+    for (auto it = block.otherCharacters.constBegin(); it != block.otherCharacters.constEnd(); ++it) {
+        auto total = totals.otherCharacters.find(it.key());
+
+        if (total != totals.otherCharacters.end() && (*total -= it.value()) <= 0)
+            totals.otherCharacters.erase(total);
+    }
+
+    for (int i = 0; i < BlockStatistics::LENGTH_BUCKETS; ++i) {
+        totals.lineLengths[i] -= block.lineLengths[i];
+    }
+
+    for (const quint64 hash : block.lineHashes) {
+        auto count = lineCounts.find(hash);
+
+        if (count != lineCounts.end() && --(*count) <= 0)
+            lineCounts.erase(count);
+    }
+
+    totals.distinctLines = lineCounts.size();
+}
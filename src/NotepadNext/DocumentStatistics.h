@@ -0,0 +1,88 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+
+// Statistics of a run of whole lines of a document. They are worked out on a worker thread and never change after
+// that, so a document is split into blocks of these and only the blocks that were edited have to be counted again.
+struct BlockStatistics
+{
+    // Lines are put into buckets by their length in bytes: 0, 1, 2-3, 4-7, ... and everything past the last
+    static const int LENGTH_BUCKETS = 24;
+    static const int LONGEST_LINES = 10;
+
+    struct Line
+    {
+        qint64 length; // in bytes, without the line end
+        qint64 line;   // from the start of the block
+    };
+
+    qint64 bytes = 0;
+    qint64 lines = 0;
+    qint64 words = 0;
+    qint64 characters = 0;
+
+    std::array<qint64, 256> byteCounts{};
+    QHash<uint, qint64> otherCharacters; // anything that isn't ASCII, by code point
+    std::array<qint64, LENGTH_BUCKETS> lineLengths{};
+    QVector<Line> longestLines; // longest first
+    std::vector<quint64> lineHashes; // one for each line, to find duplicates with
+
+    static int bucketOf(qint64 length);
+
+    // Counts text made of whole lines, splitting it into blocks of about blockSize bytes. The last line only counts
+    // if nothing comes after the text, any other text ends with a line end.
+    static std::vector<std::shared_ptr<const BlockStatistics>> count(const char *data, qsizetype length, bool endOfDocument, qsizetype blockSize);
+};
+
+// The statistics of a whole document, kept up to date by adding the blocks that are counted and removing the ones
+// they replace. Only one thread touches it at a time.
+class DocumentStatistics
+{
+public:
+    struct Summary
+    {
+        qint64 bytes = 0;
+        qint64 lines = 0;
+        qint64 words = 0;
+        qint64 characters = 0;
+        qint64 distinctLines = 0;
+
+        std::array<qint64, 128> asciiCounts{};
+        QHash<uint, qint64> otherCharacters;
+        std::array<qint64, BlockStatistics::LENGTH_BUCKETS> lineLengths{};
+    };
+
+    void add(const BlockStatistics &block);
+    void remove(const BlockStatistics &block);
+
+    const Summary &summary() const { return totals; }
+
+private:
+    Summary totals;
+    QHash<quint64, qint32> lineCounts;
+};
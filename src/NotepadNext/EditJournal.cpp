@@ -0,0 +1,387 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditJournal.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QTextCodec>
+#include <QThreadPool>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+// Bump the version whenever what is written to the journal changes
+const quint32 JOURNAL_MAGIC = 0x4E4E454A; // "NNEJ"
+const qint32 JOURNAL_VERSION = 1;
+const QDataStream::Version JOURNAL_STREAM_VERSION = QDataStream::Qt_5_12;
+
+const quint8 JOURNAL_INSERTION = 'I';
+const quint8 JOURNAL_DELETION = 'D';
+
+// Roughly what each operation takes in the journal on top of any text it inserts
+const qint64 JOURNAL_OPERATION_SIZE = 17;
+
+// How long edits are collected before they are written out together
+const int JOURNAL_FLUSH_INTERVAL_MS = 1000;
+
+// Once the journal is bigger than the file itself it is cheaper to keep a copy of the file instead
+const qint64 JOURNAL_MIN_SIZE_LIMIT = 4 * 1024 * 1024;
+
+// A single thread writes every journal, so the writes to each one happen in the order they were made
+static QThreadPool *JournalWriter()
+{
+    static QThreadPool *pool = []() {
+        QThreadPool *p = new QThreadPool();
+        p->setMaxThreadCount(1);
+        return p;
+    }();
+
+    return pool;
+}
+
+static bool SyncToDisk(QFile &file)
+{
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+static bool WriteJournal(const QString &filePath, const QByteArray &data, bool truncate)
+{
+    QFile file(filePath);
+    const QIODevice::OpenMode mode = QIODevice::WriteOnly | (truncate ? QIODevice::Truncate : QIODevice::Append);
+
+    if (file.open(mode) && file.write(data) == data.size() && file.flush() && SyncToDisk(file)) {
+        return true;
+    }
+
+    qWarning("Unable to write the edit journal \"%s\": %s", qUtf8Printable(filePath), qUtf8Printable(file.errorString()));
+    return false;
+}
+
+static QByteArray EncodingName(const ScintillaNext *editor)
+{
+    // No encoding means the file is UTF-8
+    return editor->getEncoding() ? editor->getEncoding()->name() : QByteArray();
+}
+
+EditJournal::EditJournal(ScintillaNext *editor, const QString &filePath) :
+    QObject(editor),
+    editor(editor),
+    journalPath(filePath)
+{
+    setObjectName("EditJournal");
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(JOURNAL_FLUSH_INTERVAL_MS);
+    connect(&flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+
+    connect(editor, &ScintillaNext::modified, this, [=](Scintilla::ModificationFlags type, Scintilla::Position position, Scintilla::Position length, Scintilla::Position linesAdded, const QByteArray &text) {
+        Q_UNUSED(linesAdded);
+
+        if (!valid) {
+            return;
+        }
+
+        if (Scintilla::FlagSet(type, Scintilla::ModificationFlags::InsertText)) {
+            record(true, position, length, text);
+        }
+        else if (Scintilla::FlagSet(type, Scintilla::ModificationFlags::DeleteText)) {
+            record(false, position, length, QByteArray());
+        }
+    });
+
+    // There is no telling what happened while modifications were suspended
+    connect(editor, &ScintillaNext::modificationsResumed, this, &EditJournal::stop);
+
+    connect(editor, &ScintillaNext::savePointChanged, this, [=](bool dirty) {
+        if (!dirty) {
+            restartIfSaved();
+        }
+    });
+
+    // A background save can finish with more typed since, in which case the file is no longer what the journal started from
+    connect(editor, &ScintillaNext::saved, this, &EditJournal::restartIfSaved);
+
+    connect(editor, &ScintillaNext::loadingFinished, this, [=](bool complete) {
+        if (complete) {
+            restartIfSaved();
+        }
+        else {
+            stop();
+        }
+    });
+}
+
+void EditJournal::setEnabled(bool enable)
+{
+    if (enabled == enable) {
+        return;
+    }
+
+    enabled = enable;
+    restartIfSaved();
+}
+
+void EditJournal::flush()
+{
+    flushTimer.stop();
+
+    if (!isUsable() || pending.isEmpty()) {
+        return;
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    const bool truncate = !headerWritten;
+
+    stream.setVersion(JOURNAL_STREAM_VERSION);
+
+    if (!headerWritten) {
+        writeHeader(stream);
+        headerWritten = true;
+    }
+
+    for (const Operation &operation : qAsConst(pending)) {
+        if (operation.insertion) {
+            stream << JOURNAL_INSERTION << operation.position << operation.text;
+        }
+        else {
+            stream << JOURNAL_DELETION << operation.position << operation.length;
+        }
+    }
+
+    pending.clear();
+    pendingBytes = 0;
+    bytesWritten += data.size();
+
+    write(data, truncate);
+}
+
+void EditJournal::waitForWrites()
+{
+    JournalWriter()->waitForDone();
+}
+
+bool EditJournal::replay(ScintillaNext *editor, const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    QFile file(filePath);
+
+    // Nothing was ever written to it, so there is nothing to put back
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug("No edit journal at \"%s\"", qUtf8Printable(filePath));
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    qint32 version = 0;
+    qint64 size = 0;
+    qint64 modified = 0;
+    QByteArray encoding;
+
+    stream.setVersion(JOURNAL_STREAM_VERSION);
+    stream >> magic >> version;
+
+    if (magic != JOURNAL_MAGIC || version != JOURNAL_VERSION) {
+        qWarning("Unknown edit journal format (version %d)", version);
+        return false;
+    }
+
+    stream >> size >> modified >> encoding;
+
+    const QFileInfo fileInfo(editor->getFilePath());
+
+    // The operations only make sense on top of exactly the text they were recorded from
+    if (stream.status() != QDataStream::Ok || editor->modify() || fileInfo.size() != size || fileInfo.lastModified().toMSecsSinceEpoch() != modified || EncodingName(editor) != encoding) {
+        qWarning("\"%s\" changed since its edit journal was started, it is left as it is on disk", qUtf8Printable(editor->getFilePath()));
+        return false;
+    }
+
+    const bool wasReadOnly = editor->readOnly();
+    int applied = 0;
+
+    editor->setReadOnly(false);
+    editor->beginUndoAction();
+
+    while (!stream.atEnd()) {
+        quint8 type = 0;
+        qint64 position = 0;
+        qint64 length = 0;
+        QByteArray text;
+
+        stream >> type >> position;
+
+        if (type == JOURNAL_INSERTION) {
+            stream >> text;
+            length = text.size();
+        }
+        else if (type == JOURNAL_DELETION) {
+            stream >> length;
+        }
+
+        // Anything written when it crashed may only be partly there
+        if (stream.status() != QDataStream::Ok || (type != JOURNAL_INSERTION && type != JOURNAL_DELETION)) {
+            qWarning("The edit journal of \"%s\" ends part way through a change", qUtf8Printable(editor->getFilePath()));
+            break;
+        }
+
+        if (position < 0 || length < 0 || position > editor->length() || (type == JOURNAL_DELETION && position + length > editor->length())) {
+            qWarning("The edit journal of \"%s\" does not match the file", qUtf8Printable(editor->getFilePath()));
+            break;
+        }
+
+        if (type == JOURNAL_INSERTION) {
+            // The text can have NULs in it, so it is not inserted as a string
+            editor->setTargetRange(position, position);
+            editor->replaceTarget(text.size(), text.constData());
+        }
+        else {
+            editor->deleteRange(position, length);
+        }
+
+        ++applied;
+    }
+
+    editor->endUndoAction();
+    editor->setReadOnly(wasReadOnly);
+
+    qDebug("Replayed %d changes from the edit journal", applied);
+
+    return true;
+}
+
+void EditJournal::record(bool insertion, qint64 position, qint64 length, const QByteArray &text)
+{
+    // Typing and deleting come a character at a time, so a run of them are kept as one operation
+    Operation *last = pending.isEmpty() ? Q_NULLPTR : &pending.last();
+
+    if (last && insertion && last->insertion && position == last->position + last->length) {
+        last->text.append(text);
+        last->length += length;
+        pendingBytes += length;
+    }
+    else if (last && !insertion && !last->insertion && (position == last->position || position + length == last->position)) {
+        last->position = qMin(position, last->position);
+        last->length += length;
+    }
+    else {
+        pending.append({insertion, position, length, text});
+        pendingBytes += JOURNAL_OPERATION_SIZE + text.size();
+    }
+
+    if (bytesWritten + pendingBytes > qMax(static_cast<qint64>(editor->length()), JOURNAL_MIN_SIZE_LIMIT)) {
+        qInfo("The edit journal of \"%s\" is bigger than the file, it is no longer kept", qUtf8Printable(editor->getFilePath()));
+        stop();
+        return;
+    }
+
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+void EditJournal::restartIfSaved()
+{
+    if (enabled && editor->isFile() && !editor->modify() && !editor->isLoading()) {
+        restart();
+    }
+    else {
+        stop();
+    }
+}
+
+void EditJournal::restart()
+{
+    stop();
+
+    const QFileInfo fileInfo(editor->getFilePath());
+
+    baseSize = fileInfo.size();
+    baseModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    baseEncoding = EncodingName(editor);
+    bytesWritten = 0;
+    valid = true;
+
+    // Whatever was written before doesn't belong to the file any more, so it is replaced straight away in case
+    // it gets replayed before anything new is written
+    if (fileWritten) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+
+        stream.setVersion(JOURNAL_STREAM_VERSION);
+        writeHeader(stream);
+
+        bytesWritten = data.size();
+        write(data, true);
+        headerWritten = true;
+    }
+    else {
+        headerWritten = false;
+    }
+}
+
+void EditJournal::stop()
+{
+    // What was already written is left alone, it is still the file as it was then if it is needed before something else replaces it
+    ++epoch;
+    valid = false;
+    pending.clear();
+    pendingBytes = 0;
+    flushTimer.stop();
+}
+
+void EditJournal::writeHeader(QDataStream &stream) const
+{
+    stream << JOURNAL_MAGIC << JOURNAL_VERSION << baseSize << baseModified << baseEncoding;
+}
+
+void EditJournal::write(const QByteArray &data, bool truncate)
+{
+    const QString filePath = journalPath;
+    const quint64 writeEpoch = epoch;
+    QPointer<EditJournal> self = this;
+
+    fileWritten = true;
+
+    JournalWriter()->start([=]() {
+        if (WriteJournal(filePath, data, truncate)) {
+            return;
+        }
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self && self->epoch == writeEpoch) {
+                self->stop();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
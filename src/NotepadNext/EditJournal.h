@@ -0,0 +1,102 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+
+class ScintillaNext;
+
+// Keeps an append-only record of every insertion and deletion made to a file since the last time it matched what
+// is on disk, so an unsaved file can be put back after a crash by reading the file and replaying its journal rather
+// than writing out a copy of the whole buffer. Operations are collected as they happen and written out in batches
+// on a worker thread, where they are synced to disk. The journal starts again whenever the file is saved or
+// reloaded. Anything it cannot follow, such as a bulk edit, stops it until then and the file has to be kept some
+// other way.
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    EditJournal(ScintillaNext *editor, const QString &filePath);
+
+    QString filePath() const { return journalPath; }
+
+    // The journal is recorded and can be replayed on top of the file as it is on disk
+    bool isUsable() const { return enabled && valid; }
+
+    // Nothing is written while disabled, and once re-enabled it has to wait for the next save point
+    void setEnabled(bool enable);
+
+    // Writes out whatever has not been yet, without waiting for it
+    void flush();
+
+    // Waits for everything every journal has been asked to write to be on disk
+    static void waitForWrites();
+
+    // Applies the journal to an editor that has just read the file, as a single undo action. Nothing is done if
+    // the file changed since the journal was started.
+    static bool replay(ScintillaNext *editor, const QString &filePath);
+
+private:
+    struct Operation {
+        bool insertion;
+        qint64 position;
+        qint64 length;
+        QByteArray text;
+    };
+
+    void record(bool insertion, qint64 position, qint64 length, const QByteArray &text);
+    void restartIfSaved();
+    void restart();
+    void stop();
+    void writeHeader(QDataStream &stream) const;
+    void write(const QByteArray &data, bool truncate);
+
+    ScintillaNext *editor;
+    QString journalPath;
+    QTimer flushTimer;
+
+    bool enabled = false;
+    bool valid = false;
+
+    // Which restart() the writes belong to, so failures from an earlier one are ignored
+    quint64 epoch = 0;
+
+    // What the file on disk was when the journal started
+    qint64 baseSize = 0;
+    qint64 baseModified = 0;
+    QByteArray baseEncoding;
+
+    bool headerWritten = false;
+    bool fileWritten = false;
+    qint64 bytesWritten = 0;
+    QVector<Operation> pending;
+    qint64 pendingBytes = 0;
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,352 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditorConfigCache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+
+
+static const QString CONFIG_FILE_NAME = QStringLiteral(".editorconfig");
+
+// Properties from the specification whose values are case insensitive
+static const QStringList KNOWN_PROPERTIES = {
+    QStringLiteral("indent_style"),
+    QStringLiteral("indent_size"),
+    QStringLiteral("tab_width"),
+    QStringLiteral("end_of_line"),
+    QStringLiteral("charset"),
+    QStringLiteral("trim_trailing_whitespace"),
+    QStringLiteral("insert_final_newline"),
+    QStringLiteral("root"),
+};
+
+static const QRegularExpression NUMBER_RANGE(QStringLiteral("^([+-]?\\d+)\\.\\.([+-]?\\d+)$"));
+
+// Returns the index of the brace that closes the one at start, or -1 if there isn't one
+static int matchingBrace(const QString &glob, int start)
+{
+    int depth = 0;
+
+    for (int i = start; i < glob.size(); ++i) {
+        if (glob[i] == QLatin1Char('\\')) {
+            ++i;
+        }
+        else if (glob[i] == QLatin1Char('{')) {
+            ++depth;
+        }
+        else if (glob[i] == QLatin1Char('}') && --depth == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Splits the inside of a brace on the commas that aren't in a nested brace
+static QStringList splitAlternatives(const QString &inside)
+{
+    QStringList parts;
+    int depth = 0;
+    int partStart = 0;
+
+    for (int i = 0; i < inside.size(); ++i) {
+        const QChar c = inside[i];
+
+        if (c == QLatin1Char('\\')) {
+            ++i;
+        }
+        else if (c == QLatin1Char('{')) {
+            ++depth;
+        }
+        else if (c == QLatin1Char('}')) {
+            --depth;
+        }
+        else if (c == QLatin1Char(',') && depth == 0) {
+            parts.append(inside.mid(partStart, i - partStart));
+            partStart = i + 1;
+        }
+    }
+
+    parts.append(inside.mid(partStart));
+
+    return parts;
+}
+
+static QString globToRegex(const QString &glob, QVector<QPair<int, int>> &numberRanges)
+{
+    QString regex;
+
+    for (int i = 0; i < glob.size(); ++i) {
+        const QChar c = glob[i];
+
+        if (c == QLatin1Char('\\') && i + 1 < glob.size()) {
+            regex += QRegularExpression::escape(glob.mid(++i, 1));
+        }
+        else if (c == QLatin1Char('*')) {
+            if (i + 1 < glob.size() && glob[i + 1] == QLatin1Char('*')) {
+                regex += QStringLiteral(".*");
+                ++i;
+            }
+            else {
+                regex += QStringLiteral("[^/]*");
+            }
+        }
+        else if (c == QLatin1Char('?')) {
+            regex += QStringLiteral("[^/]");
+        }
+        else if (c == QLatin1Char('[')) {
+            const int close = glob.indexOf(QLatin1Char(']'), i + 1);
+
+            // A bracket that is never closed, or that would span a path separator, is just a bracket
+            if (close < 0 || glob.mid(i, close - i).contains(QLatin1Char('/'))) {
+                regex += QStringLiteral("\\[");
+                continue;
+            }
+
+            QString set = glob.mid(i + 1, close - i - 1);
+            if (set.startsWith(QLatin1Char('!'))) {
+                set[0] = QLatin1Char('^');
+            }
+
+            regex += QLatin1Char('[') + set.replace(QLatin1Char('\\'), QStringLiteral("\\\\")) + QLatin1Char(']');
+            i = close;
+        }
+        else if (c == QLatin1Char('{')) {
+            const int close = matchingBrace(glob, i);
+
+            if (close < 0) {
+                regex += QStringLiteral("\\{");
+                continue;
+            }
+
+            const QString inside = glob.mid(i + 1, close - i - 1);
+            const QRegularExpressionMatch range = NUMBER_RANGE.match(inside);
+            const QStringList alternatives = splitAlternatives(inside);
+
+            if (range.hasMatch()) {
+                // Regular expressions can't check a numeric range, so the number is captured and checked afterwards
+                const int low = range.captured(1).toInt();
+                const int high = range.captured(2).toInt();
+                numberRanges.append(qMakePair(qMin(low, high), qMax(low, high)));
+                regex += QStringLiteral("([+-]?\\d+)");
+            }
+            else if (alternatives.size() > 1) {
+                QStringList converted;
+                for (const QString &alternative : alternatives) {
+                    converted.append(globToRegex(alternative, numberRanges));
+                }
+
+                regex += QStringLiteral("(?:") + converted.join(QLatin1Char('|')) + QLatin1Char(')');
+            }
+            else {
+                // A single item in braces matches itself, braces included
+                regex += QStringLiteral("\\{") + globToRegex(inside, numberRanges) + QStringLiteral("\\}");
+            }
+
+            i = close;
+        }
+        else {
+            regex += QRegularExpression::escape(QString(c));
+        }
+    }
+
+    return regex;
+}
+
+bool EditorConfigCache::Section::matches(const QString &filePath) const
+{
+    const QRegularExpressionMatch match = pattern.match(filePath);
+
+    if (!match.hasMatch()) {
+        return false;
+    }
+
+    for (int i = 0; i < numberRanges.size(); ++i) {
+        const int number = match.captured(i + 1).toInt();
+
+        if (number < numberRanges[i].first || number > numberRanges[i].second) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+EditorConfigCache::EditorConfigCache(QObject *parent) :
+    QObject(parent),
+    watcher(new QFileSystemWatcher(this))
+{
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &EditorConfigCache::invalidate);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &EditorConfigCache::invalidate);
+}
+
+QMap<QString, QString> EditorConfigCache::settingsForFile(const QString &filePath)
+{
+    const QString absolutePath = QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+
+    // Collect the files from the nearest up to a root one, then apply them furthest first so nearer ones win. The
+    // directories are worked out from the path alone, nothing on the way up needs to exist.
+    QVector<ConfigFile> chain;
+    QString directory = QFileInfo(absolutePath).path();
+
+    while (true) {
+        const ConfigFile configFile = configFileIn(directory);
+
+        if (configFile.exists) {
+            chain.append(configFile);
+
+            if (configFile.root) {
+                break;
+            }
+        }
+
+        const QString parent = QFileInfo(directory).path();
+        if (parent == directory) {
+            break;
+        }
+
+        directory = parent;
+    }
+
+    QMap<QString, QString> settings;
+
+    for (int i = chain.size() - 1; i >= 0; --i) {
+        for (const Section &section : chain[i].sections) {
+            if (section.matches(absolutePath)) {
+                for (const auto &property : section.properties) {
+                    settings.insert(property.first, property.second);
+                }
+            }
+        }
+    }
+
+    // Defaults the specification derives from the other properties
+    if (settings.value(QStringLiteral("indent_size")) == QStringLiteral("tab") && settings.contains(QStringLiteral("tab_width"))) {
+        settings.insert(QStringLiteral("indent_size"), settings.value(QStringLiteral("tab_width")));
+    }
+
+    if (!settings.contains(QStringLiteral("tab_width")) && settings.value(QStringLiteral("indent_size")).toInt() > 0) {
+        settings.insert(QStringLiteral("tab_width"), settings.value(QStringLiteral("indent_size")));
+    }
+
+    return settings;
+}
+
+void EditorConfigCache::invalidate(const QString &path)
+{
+    // Either a .editorconfig itself changed, or something was added to or removed from a directory
+    const QFileInfo info(path);
+    const QString directory = info.fileName() == CONFIG_FILE_NAME ? info.path() : path;
+
+    configFiles.remove(QDir::cleanPath(directory));
+}
+
+EditorConfigCache::ConfigFile EditorConfigCache::configFileIn(const QString &directory)
+{
+    auto it = configFiles.find(directory);
+
+    if (it != configFiles.end()) {
+        return it.value();
+    }
+
+    ConfigFile configFile;
+    QFile file(QDir(directory).filePath(CONFIG_FILE_NAME));
+
+    if (file.open(QIODevice::ReadOnly)) {
+        configFile = parse(directory, file.readAll());
+
+        if (!watcher->files().contains(file.fileName())) {
+            watcher->addPath(file.fileName());
+        }
+    }
+
+    // Also watched when there isn't one, so one being created is noticed
+    if (!watcher->directories().contains(directory)) {
+        watcher->addPath(directory);
+    }
+
+    return configFiles.insert(directory, configFile).value();
+}
+
+EditorConfigCache::ConfigFile EditorConfigCache::parse(const QString &directory, const QByteArray &contents)
+{
+    ConfigFile configFile;
+    configFile.exists = true;
+
+    Section *section = Q_NULLPTR;
+
+    for (const QByteArray &rawLine : contents.split('\n')) {
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')) || line.startsWith(QLatin1Char(';'))) {
+            continue;
+        }
+
+        if (line.startsWith(QLatin1Char('[')) && line.endsWith(QLatin1Char(']'))) {
+            configFile.sections.append(compileSection(directory, line.mid(1, line.size() - 2)));
+            section = &configFile.sections.last();
+            continue;
+        }
+
+        const int equals = line.indexOf(QLatin1Char('='));
+        if (equals <= 0) {
+            continue;
+        }
+
+        const QString key = line.left(equals).trimmed().toLower();
+        QString value = line.mid(equals + 1).trimmed();
+
+        if (KNOWN_PROPERTIES.contains(key)) {
+            value = value.toLower();
+        }
+
+        // Anything before the first section is the preamble, where only root means anything
+        if (section) {
+            section->properties.append(qMakePair(key, value));
+        }
+        else if (key == QStringLiteral("root")) {
+            configFile.root = value == QStringLiteral("true");
+        }
+    }
+
+    return configFile;
+}
+
+EditorConfigCache::Section EditorConfigCache::compileSection(const QString &directory, const QString &glob)
+{
+    Section section;
+    QString pattern = glob;
+
+    // A glob without a slash matches the file name in any directory below, otherwise it is relative to this one
+    QString prefix = QRegularExpression::escape(directory == QStringLiteral("/") ? QString() : directory) + QLatin1Char('/');
+    if (!pattern.contains(QLatin1Char('/'))) {
+        prefix += QStringLiteral("(?:.*/)?");
+    }
+    else if (pattern.startsWith(QLatin1Char('/'))) {
+        pattern.remove(0, 1);
+    }
+
+    section.pattern.setPattern(QLatin1Char('^') + prefix + globToRegex(pattern, section.numberRanges) + QLatin1Char('$'));
+    section.pattern.optimize();
+
+    return section;
+}
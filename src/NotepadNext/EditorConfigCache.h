@@ -0,0 +1,71 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EDITORCONFIGCACHE_H
+#define EDITORCONFIGCACHE_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QRegularExpression>
+#include <QVector>
+
+
+class QFileSystemWatcher;
+
+// Works out the EditorConfig properties of a file. Every .editorconfig is parsed once, with its section globs turned
+// into regular expressions, and kept until a file system watcher says the file (or the directory it would be in)
+// changed. Opening lots of files from the same tree then only costs a few hash lookups each.
+class EditorConfigCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditorConfigCache(QObject *parent = nullptr);
+
+    // Property names are lower case, as are the values of the properties the specification defines
+    QMap<QString, QString> settingsForFile(const QString &filePath);
+
+private slots:
+    void invalidate(const QString &path);
+
+private:
+    struct Section {
+        QRegularExpression pattern;
+        QVector<QPair<int, int>> numberRanges; // for each {num1..num2} in the glob, checked against its capture
+        QVector<QPair<QString, QString>> properties;
+
+        bool matches(const QString &filePath) const;
+    };
+
+    struct ConfigFile {
+        bool exists = false;
+        bool root = false;
+        QVector<Section> sections;
+    };
+
+    ConfigFile configFileIn(const QString &directory);
+    static ConfigFile parse(const QString &directory, const QByteArray &contents);
+    static Section compileSection(const QString &directory, const QString &glob);
+
+    QFileSystemWatcher *watcher;
+    QHash<QString, ConfigFile> configFiles; // by directory
+};
+
+#endif // EDITORCONFIGCACHE_H
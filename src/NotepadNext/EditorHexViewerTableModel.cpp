@@ -18,22 +18,77 @@
 
 
 #include "EditorHexViewerTableModel.h"
+#include "BytePattern.h"
 #include "ScintillaNext.h"
 
+#include <QVector>
+
+
+// How many rows are read from the editor at once, enough to cover a screen or two of scrolling
+const int CACHE_ROWS = 256;
 
 static int IndexToPos(const QModelIndex &index)
 {
     return index.row() * 16 + index.column();
 }
 
+static int RowCountFor(int length)
+{
+    return (length / 16) + 1;
+}
+
 EditorHexViewerTableModel::EditorHexViewerTableModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
 }
 
+const QString &EditorHexViewerTableModel::hexString(unsigned char byte)
+{
+    static const QVector<QString> table = []() {
+        QVector<QString> strings;
+        strings.reserve(256);
+        for (int i = 0; i < 256; ++i) {
+            strings.append(QString("%1").arg(i, 2, 16, QChar('0')).toUpper());
+        }
+        return strings;
+    }();
+
+    return table.at(byte);
+}
+
 void EditorHexViewerTableModel::setEditor(ScintillaNext *e)
 {
+    beginResetModel();
+
+    if (editor) {
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+    }
+
     editor = e;
+    cacheRowCount = 0;
+    rows = editor ? RowCountFor(static_cast<int>(editor->length())) : 0;
+
+    if (editor) {
+        connect(editor, &ScintillaNext::modified, this, [=](Scintilla::ModificationFlags type, Scintilla::Position position) {
+            if (replacing) {
+                return;
+            }
+
+            if (Scintilla::FlagSet(type, Scintilla::ModificationFlags::InsertText) || Scintilla::FlagSet(type, Scintilla::ModificationFlags::DeleteText)) {
+                invalidate(static_cast<int>(position));
+            }
+        });
+
+        // Nothing is heard about the changes made while they are suspended, so start over afterwards
+        connect(editor, &ScintillaNext::modificationsResumed, this, [=]() {
+            beginResetModel();
+            cacheRowCount = 0;
+            rows = RowCountFor(static_cast<int>(editor->length()));
+            endResetModel();
+        });
+    }
+
+    endResetModel();
 }
 
 QVariant EditorHexViewerTableModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -60,7 +115,7 @@ int EditorHexViewerTableModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid())
         return 0;
 
-    return (editor->length() / 16) + 1;
+    return rows;
 }
 
 int EditorHexViewerTableModel::columnCount(const QModelIndex &parent) const
@@ -76,26 +131,33 @@ QVariant EditorHexViewerTableModel::data(const QModelIndex &index, int role) con
     if (!index.isValid())
         return QVariant();
 
-    if (role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::ToolTipRole) {
+    if (role == ByteRole) {
+        const QByteArray bytes = rowBytes(index.row());
+        if (index.column() >= bytes.size()) return QVariant();
+
+        return static_cast<int>(static_cast<unsigned char>(bytes.at(index.column())));
+    }
+    else if (role == RowBytesRole) {
+        return rowBytes(index.row());
+    }
+    else if (role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::ToolTipRole) {
+        const QByteArray bytes = rowBytes(index.row());
+
         if (index.column() == 16) {
             QString str;
+            str.reserve(bytes.size());
 
-            for (int i = 0; i < 16 ; ++i) {
-                int docPos = index.row() * 16 + i;
-                if (docPos >= editor->length()) break;
-
-                QChar c = QChar(static_cast<uchar>(editor->charAt(docPos)));
+            for (char ch : bytes) {
+                QChar c = QChar(static_cast<uchar>(ch));
                 str += c.isPrint() ? c : '.';
             }
 
             return str;
         }
 
-        int docPos = IndexToPos(index);
-        if (docPos >= editor->length()) return QVariant();
+        if (index.column() >= bytes.size()) return QVariant();
 
-        unsigned char ch = static_cast<unsigned char>(editor->charAt(docPos));
-        return QString("%1").arg(ch, 2, 16, QChar('0')).toUpper();
+        return hexString(static_cast<unsigned char>(bytes.at(index.column())));
     }
     else if (role == Qt::TextAlignmentRole) {
         if (index.column() == 16) return Qt::AlignVCenter;
@@ -112,15 +174,9 @@ bool EditorHexViewerTableModel::setData(const QModelIndex &index, const QVariant
         unsigned int charValue = value.toString().toInt(&ok, 16);
 
         if (ok && charValue <= 255) {
-            QByteArray byte(1, static_cast<char>(charValue));
-            int pos = IndexToPos(index);
-
-            editor->setTargetRange(pos, pos + 1);
-            editor->replaceTarget(1, byte.constData());
+            const qint64 pos = positionOf(index);
 
-            emit dataChanged(index, index, QVector<int>() << role);
-
-            return true;
+            return replaceBytes(pos, pos + 1, QByteArray(1, static_cast<char>(charValue)));
         }
     }
 
@@ -144,3 +200,123 @@ Qt::ItemFlags EditorHexViewerTableModel::flags(const QModelIndex &index) const
         return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
     }
 }
+
+qint64 EditorHexViewerTableModel::length() const
+{
+    return editor ? editor->length() : 0;
+}
+
+bool EditorHexViewerTableModel::isReadOnly() const
+{
+    return !editor || editor->readOnly();
+}
+
+qint64 EditorHexViewerTableModel::positionOf(const QModelIndex &index)
+{
+    return IndexToPos(index);
+}
+
+QModelIndex EditorHexViewerTableModel::indexOf(qint64 position) const
+{
+    return index(static_cast<int>(position / 16), static_cast<int>(position % 16));
+}
+
+qint64 EditorHexViewerTableModel::find(const BytePattern &pattern, qint64 position, bool backwards) const
+{
+    if (!editor || !pattern.isValid())
+        return -1;
+
+    const char *data = reinterpret_cast<const char *>(editor->characterPointer());
+    const qint64 documentLength = editor->length();
+
+    return backwards ? pattern.lastIndexIn(data, documentLength, position) : pattern.indexIn(data, documentLength, position);
+}
+
+bool EditorHexViewerTableModel::replaceBytes(qint64 start, qint64 end, const QByteArray &bytes)
+{
+    if (isReadOnly() || start < 0 || start > end || end > editor->length())
+        return false;
+
+    // Otherwise the deletion and insertion it is made of would each update every row after it
+    replacing = true;
+    editor->setTargetRange(start, end);
+    editor->replaceTarget(bytes.size(), bytes.constData());
+    replacing = false;
+
+    if (bytes.size() == end - start) {
+        // Nothing moved, so only the rows it covers changed
+        cacheRowCount = 0;
+
+        if (end > start) {
+            emit dataChanged(index(static_cast<int>(start / 16), 0), index(static_cast<int>((end - 1) / 16), 16));
+        }
+    }
+    else {
+        invalidate(static_cast<int>(start));
+    }
+
+    return true;
+}
+
+bool EditorHexViewerTableModel::fillBytes(qint64 start, qint64 end, const QByteArray &bytes)
+{
+    if (bytes.isEmpty() || end <= start)
+        return false;
+
+    const int length = static_cast<int>(end - start);
+    QByteArray filled = bytes.repeated(length / bytes.size());
+
+    filled.append(bytes.left(length - filled.size()));
+
+    return replaceBytes(start, end, filled);
+}
+
+bool EditorHexViewerTableModel::overwriteBytes(qint64 position, const QByteArray &bytes)
+{
+    if (!editor || bytes.isEmpty() || position < 0)
+        return false;
+
+    return replaceBytes(position, qMin(position + bytes.size(), static_cast<qint64>(editor->length())), bytes);
+}
+
+QByteArray EditorHexViewerTableModel::rowBytes(int row) const
+{
+    if (!editor || row < 0 || row >= rows)
+        return QByteArray();
+
+    if (row < cacheFirstRow || row >= cacheFirstRow + cacheRowCount) {
+        const int length = static_cast<int>(editor->length());
+
+        // Center the window on the row so scrolling either way stays inside of it for a while
+        cacheFirstRow = qMax(0, row - CACHE_ROWS / 2);
+        cacheRowCount = qMin(CACHE_ROWS, rows - cacheFirstRow);
+
+        const int start = cacheFirstRow * 16;
+        const int end = qMin(length, (cacheFirstRow + cacheRowCount) * 16);
+        cache = start < end ? editor->get_text_range(start, end) : QByteArray();
+    }
+
+    return cache.mid((row - cacheFirstRow) * 16, 16);
+}
+
+void EditorHexViewerTableModel::invalidate(int position)
+{
+    cacheRowCount = 0;
+
+    const int newRows = RowCountFor(static_cast<int>(editor->length()));
+
+    if (newRows > rows) {
+        beginInsertRows(QModelIndex(), rows, newRows - 1);
+        rows = newRows;
+        endInsertRows();
+    }
+    else if (newRows < rows) {
+        beginRemoveRows(QModelIndex(), newRows, rows - 1);
+        rows = newRows;
+        endRemoveRows();
+    }
+
+    // Everything after the change has moved
+    const int firstRow = qMin(position / 16, rows - 1);
+    emit dataChanged(index(firstRow, 0), index(rows - 1, 16));
+}
@@ -21,17 +21,31 @@
 #define EDITORHEXVIEWERTABLEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QByteArray>
+#include <QPointer>
 
 
+class BytePattern;
 class ScintillaNext;
 
+// Shows an editor's bytes 16 to a row with the printable characters at the end. The bytes are read a window of
+// rows at a time rather than asking the editor for each cell, and HexViewerDelegate paints them straight from
+// ByteRole/RowBytesRole, so scrolling through a large file doesn't build a string for every cell it passes.
 class EditorHexViewerTableModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
+    enum Roles {
+        ByteRole = Qt::UserRole, // the cell's byte as an int
+        RowBytesRole, // all of the row's bytes as a QByteArray
+    };
+
     explicit EditorHexViewerTableModel(QObject *parent = nullptr);
 
+    // The two digit upper case hex for each byte
+    static const QString &hexString(unsigned char byte);
+
     void setEditor(ScintillaNext *e);
 
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
@@ -44,8 +58,36 @@ public:
 
     Qt::ItemFlags flags(const QModelIndex &index) const override;
 
+    qint64 length() const;
+    bool isReadOnly() const;
+
+    static qint64 positionOf(const QModelIndex &index);
+    QModelIndex indexOf(qint64 position) const;
+
+    // Where the pattern next starts at or after position, or at or before it going backwards. -1 if nowhere.
+    qint64 find(const BytePattern &pattern, qint64 position, bool backwards) const;
+
+    // Each of these is a single replacement in the editor, so a single undo action, and the rows it touched are
+    // updated together once it is done rather than for each byte
+    bool replaceBytes(qint64 start, qint64 end, const QByteArray &bytes);
+
+    // The bytes are repeated over [start, end), the last time cut short if need be
+    bool fillBytes(qint64 start, qint64 end, const QByteArray &bytes);
+
+    // Writes over the bytes from position on, and carries on past the end of the document if there are more
+    bool overwriteBytes(qint64 position, const QByteArray &bytes);
+
 private:
-    ScintillaNext *editor;
+    QByteArray rowBytes(int row) const;
+    void invalidate(int position);
+
+    QPointer<ScintillaNext> editor;
+    int rows = 0;
+    bool replacing = false; // replaceBytes() updates the rows itself
+
+    mutable QByteArray cache;
+    mutable int cacheFirstRow = 0;
+    mutable int cacheRowCount = 0;
 };
 
 #endif // EDITORHEXVIEWERTABLEMODEL_H
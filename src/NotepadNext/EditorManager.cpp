@@ -17,17 +17,24 @@
  */
 
 #include <QApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
 
 #include "ApplicationSettings.h"
 
 #include "EditorManager.h"
+#include "RegexEngine.h"
 #include "ScintillaNext.h"
 #include "Scintilla.h"
+#include "StartupTrace.h"
 
 // Editor decorators
 #include "BraceMatch.h"
 #include "HighlightedScrollBar.h"
 #include "SmartHighlighter.h"
+#include "SpellChecker.h"
+#include "SpellDictionary.h"
 #include "SurroundSelection.h"
 #include "LineNumbers.h"
 #include "BetterMultiSelection.h"
@@ -35,79 +42,107 @@
 #include "AutoCompletion.h"
 #include "URLFinder.h"
 #include "BookMarkDecorator.h"
+#include "BackgroundLexer.h"
+#include "LargeFileProfile.h"
+#include "LogTimestampIndex.h"
+#include "UndoHistoryLimiter.h"
 
 
 const int MARK_HIDELINESBEGIN = 23;
 const int MARK_HIDELINESEND = 22;
 const int MARK_HIDELINESUNDERLINE = 21;
 
+// How long after deferring editors to start reading the ones that aren't visible, and the gap between each one
+const int DEFERRED_LOAD_DELAY = 1000;
+const int DEFERRED_LOAD_INTERVAL = 50;
+
 
 EditorManager::EditorManager(ApplicationSettings *settings, QObject *parent)
     : QObject(parent), settings(settings)
 {
     connect(this, &EditorManager::editorCreated, this, [=](ScintillaNext *editor) {
         connect(editor, &ScintillaNext::closed, this, [=]() {
+            if (closingEditors) {
+                closedEditors.append(editor);
+            }
+
             emit editorClosed(editor);
         });
     });
 
+    // These only change the editors that are on screen straight away, the rest are done once they are shown
     connect(settings, &ApplicationSettings::showWrapSymbolChanged, this, [=](bool b) {
-        for (auto &editor : getEditors()) {
+        forEachEditorWhenShown(QStringLiteral("wrap_symbol"), [=](ScintillaNext *editor) {
             editor->setWrapVisualFlags(b ? SC_WRAPVISUALFLAG_END : SC_WRAPVISUALFLAG_NONE);
-        }
+        });
     });
 
-
     connect(settings, &ApplicationSettings::showWhitespaceChanged, this, [=](bool b) {
         // TODO: could make SCWS_VISIBLEALWAYS configurable via settings. Probably not worth
         // taking up menu space e.g. show all, show leading, show trailing
-        for (auto &editor : getEditors()) {
+        forEachEditorWhenShown(QStringLiteral("whitespace"), [=](ScintillaNext *editor) {
             editor->setViewWS(b ? SCWS_VISIBLEALWAYS : SCWS_INVISIBLE);
-        }
+        });
     });
 
     connect(settings, &ApplicationSettings::showEndOfLineChanged, this, [=](bool b) {
-        for (auto &editor : getEditors()) {
+        forEachEditorWhenShown(QStringLiteral("end_of_line"), [=](ScintillaNext *editor) {
             editor->setViewEOL(b);
-        }
+        });
     });
 
     connect(settings, &ApplicationSettings::showIndentGuideChanged, this, [=](bool b) {
-        for (auto &editor : getEditors()) {
+        forEachEditorWhenShown(QStringLiteral("indent_guide"), [=](ScintillaNext *editor) {
             editor->setIndentationGuides(b ? SC_IV_LOOKBOTH : SC_IV_NONE);
-        }
+        });
     });
 
+    // Rewrapping is the expensive one, so hidden documents are definitely better off waiting
     connect(settings, &ApplicationSettings::wordWrapChanged, this, [=](bool b) {
-        if (b) {
-            for (auto &editor : getEditors()) {
-                editor->setWrapMode(SC_WRAP_WORD);
+        forEachEditorWhenShown(QStringLiteral("word_wrap"), [=](ScintillaNext *editor) {
+            if (b) {
+                // Wrapping is what those editors can least afford
+                if (!LargeFileProfile::isAppliedTo(editor)) {
+                    editor->setWrapMode(SC_WRAP_WORD);
+                }
             }
-        }
-        else {
-            for (auto &editor : getEditors()) {
+            else {
                 // Store the top line and restore it after the lines have been unwrapped
                 int topLine = editor->docLineFromVisible(editor->firstVisibleLine());
                 editor->setWrapMode(SC_WRAP_NONE);
                 editor->setFirstVisibleLine(topLine);
             }
-        }
+        });
     });
 
-    connect(settings, &ApplicationSettings::fontNameChanged, this, [=](QString fontName){
-        for (auto &editor : getEditors()) {
-            for (int i = 0; i <= STYLE_MAX; ++i) {
-                editor->styleSetFont(i, fontName.toUtf8().data());
+    // Spell checking goes through the whole document, so it is left until the editor is looked at
+    connect(settings, &ApplicationSettings::spellCheckChanged, this, [=](bool b) {
+        forEachEditorWhenShown(QStringLiteral("spell_check"), [=](ScintillaNext *editor) {
+            SpellChecker *checker = editor->findChild<SpellChecker *>(QString(), Qt::FindDirectChildrenOnly);
+
+            if (checker && !LargeFileProfile::isAppliedTo(editor)) {
+                checker->setEnabled(b);
             }
-        }
+        });
     });
 
-    connect(settings, &ApplicationSettings::fontSizeChanged, this, [=](int fontSize){
-        for (auto &editor : getEditors()) {
-            for (int i = 0; i <= STYLE_MAX; ++i) {
-                editor->styleSetSize(i, fontSize);
-            }
-        }
+    SpellDictionary::instance()->setPath(settings->spellCheckDictionary());
+    connect(settings, &ApplicationSettings::spellCheckDictionaryChanged, SpellDictionary::instance(), &SpellDictionary::setPath);
+
+    connect(settings, &ApplicationSettings::fontNameChanged, this, &EditorManager::updateFonts);
+    connect(settings, &ApplicationSettings::fontSizeChanged, this, &EditorManager::updateFonts);
+
+    connect(settings, &ApplicationSettings::undoActionLimitChanged, this, &EditorManager::updateUndoLimits);
+    connect(settings, &ApplicationSettings::undoMemoryLimitChanged, this, &EditorManager::updateUndoLimits);
+
+    connect(settings, &ApplicationSettings::layoutThreadsChanged, this, &EditorManager::updateLayoutSettings);
+    connect(settings, &ApplicationSettings::positionCacheSizeChanged, this, &EditorManager::updateLayoutSettings);
+    connect(settings, &ApplicationSettings::layoutCacheModeChanged, this, &EditorManager::updateLayoutSettings);
+
+    // Nothing needs to be done to the editors, the next regular expression search uses the new engine
+    RegexEngine::setEngine(settings->regexEngine());
+    connect(settings, &ApplicationSettings::regexEngineChanged, this, [](int engine) {
+        RegexEngine::setEngine(engine);
     });
 }
 
@@ -122,7 +157,7 @@ ScintillaNext *EditorManager::createEditor(const QString &name)
 
 ScintillaNext *EditorManager::createEditorFromFile(const QString &filePath, bool tryToCreate)
 {
-    ScintillaNext *editor = ScintillaNext::fromFile(filePath, tryToCreate);
+    ScintillaNext *editor = ScintillaNext::fromFile(filePath, tryToCreate, true);
 
     if (editor) {
         manageEditor(editor);
@@ -131,35 +166,110 @@ ScintillaNext *EditorManager::createEditorFromFile(const QString &filePath, bool
     return editor;
 }
 
-ScintillaNext *EditorManager::getEditorByFilePath(const QString &filePath)
+ScintillaNext *EditorManager::createClone(ScintillaNext *editor)
 {
-    QFileInfo newInfo(filePath);
-    newInfo.makeAbsolute();
+    ScintillaNext *clone = editor->createClone();
 
-    purgeOldEditorPointers();
+    // Settings still apply to the clone, but it isn't indexed by path since the file is the original's
+    editors.append(QPointer<ScintillaNext>(clone));
+
+    setupEditor(clone);
+
+    // The source could have any of these switched off for being a large file, and the clone shouldn't turn them back on
+    clone->setWrapMode(editor->wrapMode());
+    clone->setLayoutCache(editor->layoutCache());
+    clone->setPositionCache(editor->positionCache());
+
+    emit cloneCreated(clone);
+
+    return clone;
+}
+
+ScintillaNext *EditorManager::createDeferredEditorFromFile(const QString &filePath)
+{
+    ScintillaNext *editor = ScintillaNext::deferredFromFile(filePath);
 
-    for (ScintillaNext *editor : qAsConst(editors)) {
-        if (editor->isFile() && editor->getFileInfo() == newInfo) {
-            return editor;
+    manageEditor(editor);
+
+    return editor;
+}
+
+// Reads one of the editors, then gives the event loop a chance to run before going on to the next one
+static void loadNextDeferredEditor(QObject *context, QList<QPointer<ScintillaNext>> editors)
+{
+    while (!editors.isEmpty()) {
+        QPointer<ScintillaNext> editor = editors.takeFirst();
+
+        if (editor && editor->isLoadDeferred()) {
+            editor->loadDeferred();
+            break;
         }
     }
 
-    return Q_NULLPTR;
+    if (!editors.isEmpty()) {
+        QTimer::singleShot(DEFERRED_LOAD_INTERVAL, context, [=]() {
+            loadNextDeferredEditor(context, editors);
+        });
+    }
+}
+
+void EditorManager::loadDeferredEditors(const QList<QPointer<ScintillaNext>> &deferred)
+{
+    if (deferred.isEmpty()) {
+        return;
+    }
+
+    QTimer::singleShot(DEFERRED_LOAD_DELAY, this, [=]() {
+        loadNextDeferredEditor(this, deferred);
+    });
+}
+
+ScintillaNext *EditorManager::getEditorByFilePath(const QString &filePath)
+{
+    return editorsByPath.value(pathKey(filePath), Q_NULLPTR);
 }
 
 void EditorManager::manageEditor(ScintillaNext *editor)
 {
     editors.append(QPointer<ScintillaNext>(editor));
 
+    indexEditorPath(editor);
+    connect(editor, &ScintillaNext::renamed, this, [=]() { indexEditorPath(editor); });
+    connect(editor, &ScintillaNext::saved, this, [=]() { indexEditorPath(editor); });
+    connect(editor, &ScintillaNext::closed, this, [=]() { unindexEditorPath(editor); });
+    connect(editor, &QObject::destroyed, this, [=]() { unindexEditorPath(editor); });
+
     setupEditor(editor);
 
     emit editorCreated(editor);
 }
 
+void EditorManager::closeEditors(const QVector<ScintillaNext *> &editorsToClose)
+{
+    qInfo(Q_FUNC_INFO);
+
+    closingEditors = true;
+
+    // Closing a clone's source closes the clone too, which is fine since closing it twice does nothing. Each of them
+    // only gets deleted once control gets back to the event loop, so they all go in the same pass.
+    for (ScintillaNext *editor : editorsToClose) {
+        editor->close();
+    }
+
+    closingEditors = false;
+
+    const QVector<ScintillaNext *> closed = closedEditors;
+    closedEditors.clear();
+
+    emit editorsClosed(closed);
+}
+
 void EditorManager::setupEditor(ScintillaNext *editor)
 {
     qInfo(Q_FUNC_INFO);
 
+    TraceScope trace("EditorManager::setupEditor");
+
     editor->clearCmdKey(SCK_INSERT);
 
     editor->setFoldMarkers(QStringLiteral("box"));
@@ -180,7 +290,9 @@ void EditorManager::setupEditor(ScintillaNext *editor)
     editor->setMarginLeft(2);
 
     editor->setMarginWidthN(0, 30);
-    editor->setMarginMaskN(1, (1<<MARK_HIDELINESBEGIN) | (1<<MARK_HIDELINESEND) | (1<<MARK_HIDELINESUNDERLINE));
+    editor->setMarginMaskN(1, (1<<MARK_HIDELINESBEGIN) | (1<<MARK_HIDELINESEND) | (1<<MARK_HIDELINESUNDERLINE) |
+                              (1<<SC_MARKNUM_HISTORY_REVERTED_TO_ORIGIN) | (1<<SC_MARKNUM_HISTORY_SAVED) |
+                              (1<<SC_MARKNUM_HISTORY_MODIFIED) | (1<<SC_MARKNUM_HISTORY_REVERTED_TO_MODIFIED));
     editor->setMarginMaskN(2, SC_MASK_FOLDERS);
     editor->setMarginWidthN(2, 14);
 
@@ -265,9 +377,22 @@ void EditorManager::setupEditor(ScintillaNext *editor)
     editor->setIndentationGuides(settings->showIndentGuide() ? SC_IV_LOOKBOTH : SC_IV_NONE);
     editor->setWrapMode(settings->wordWrap() ? SC_WRAP_WORD : SC_WRAP_NONE);
 
-    // Decorators
-    SmartHighlighter *s = new SmartHighlighter(editor);
-    s->setEnabled(true);
+    applyLayoutSettings(editor);
+
+    TraceScope decoratorsTrace("Decorators");
+
+    // The decorators that keep track of the document, or fill in indicators across it, are only needed once per
+    // document. A clone gets the ones that look after its own view and shares the results of the others.
+    const bool isClone = editor->isClone();
+
+    if (!isClone) {
+        SmartHighlighter *s = new SmartHighlighter(editor);
+        s->setEnabled(true);
+
+        // The scroll bar draws the timeline of log files, so this has to exist before it does
+        LogTimestampIndex *lti = new LogTimestampIndex(editor);
+        lti->setEnabled(true);
+    }
 
     HighlightedScrollBarDecorator *h = new HighlightedScrollBarDecorator(editor);
     h->setEnabled(true);
@@ -290,11 +415,106 @@ void EditorManager::setupEditor(ScintillaNext *editor)
     AutoCompletion *ac = new AutoCompletion(editor);
     ac->setEnabled(true);
 
-    URLFinder *uf = new URLFinder(editor);
-    uf->setEnabled(true);
+    if (!isClone) {
+        URLFinder *uf = new URLFinder(editor);
+        uf->setEnabled(true);
+
+        SpellChecker *sc = new SpellChecker(editor);
+        sc->setEnabled(settings->spellCheck());
+    }
 
     BookMarkDecorator *bm = new BookMarkDecorator(editor);
     bm->setEnabled(true);
+
+    if (isClone) {
+        return;
+    }
+
+    // The clones take it from the document
+    editor->setChangeHistoryEnabled(settings->showChangeHistory());
+
+    // This has to come before the background lexer, so it gets to switch off the lexer before that starts using it
+    LargeFileProfile *lfp = new LargeFileProfile(editor);
+    lfp->setEnabled(true);
+
+    BackgroundLexer *bgl = new BackgroundLexer(editor);
+    bgl->setEnabled(true);
+
+    UndoHistoryLimiter *uhl = new UndoHistoryLimiter(editor);
+    uhl->setLimits(settings->undoActionLimit(), static_cast<qint64>(settings->undoMemoryLimit()) * 1024 * 1024);
+    uhl->setEnabled(true);
+}
+
+void EditorManager::updateUndoLimits()
+{
+    const int maxActions = settings->undoActionLimit();
+    const qint64 maxBytes = static_cast<qint64>(settings->undoMemoryLimit()) * 1024 * 1024;
+
+    for (auto &editor : getEditors()) {
+        if (editor.isNull()) {
+            continue;
+        }
+
+        UndoHistoryLimiter *limiter = editor->findChild<UndoHistoryLimiter *>(QString(), Qt::FindDirectChildrenOnly);
+        if (limiter) {
+            limiter->setLimits(maxActions, maxBytes);
+        }
+    }
+}
+
+void EditorManager::updateLayoutSettings()
+{
+    for (auto &editor : getEditors()) {
+        // The profile has its own values for these, and puts back what it replaced when it is switched off
+        if (editor.isNull() || LargeFileProfile::isAppliedTo(editor)) {
+            continue;
+        }
+
+        applyLayoutSettings(editor);
+    }
+}
+
+void EditorManager::applyLayoutSettings(ScintillaNext *editor)
+{
+    // Wrapping has to lay out every line, which is what spreading it over threads and caching helps the most
+    editor->setLayoutThreads(qMax(1, settings->layoutThreads()));
+    editor->setPositionCache(qMax(0, settings->positionCacheSize()));
+    editor->setLayoutCache(qBound(SC_CACHE_NONE, settings->layoutCacheMode(), SC_CACHE_DOCUMENT));
+}
+
+void EditorManager::updateFonts()
+{
+    forEachEditorWhenShown(QStringLiteral("font"), [=](ScintillaNext *editor) { applyFont(editor); });
+}
+
+void EditorManager::forEachEditorWhenShown(const QString &key, std::function<void(ScintillaNext *)> callback)
+{
+    for (auto &editor : getEditors()) {
+        ScintillaNext *e = editor.data();
+        e->runWhenShown(key, [=]() { callback(e); });
+    }
+}
+
+void EditorManager::applyFont(ScintillaNext *editor)
+{
+    const QByteArray fontName = settings->fontName().toUtf8();
+    const int fontSize = settings->fontSize();
+
+    // Every style that changes would repaint the editor, so hold that off until they are all done
+    editor->setUpdatesEnabled(false);
+
+    for (int i = 0; i <= STYLE_MAX; ++i) {
+        // Anything already right is skipped, since setting a style again still throws away the layout caches
+        if (editor->styleFont(i) != fontName) {
+            editor->styleSetFont(i, fontName.constData());
+        }
+
+        if (editor->styleSize(i) != fontSize) {
+            editor->styleSetSize(i, fontSize);
+        }
+    }
+
+    editor->setUpdatesEnabled(true);
 }
 
 void EditorManager::purgeOldEditorPointers()
@@ -308,6 +528,50 @@ void EditorManager::purgeOldEditorPointers()
     }
 }
 
+QString EditorManager::pathKey(const QString &filePath)
+{
+    // Only the text of the path is normalised, nothing is looked up on disk
+    const QString path = QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    // These file systems are normally case insensitive
+    return path.toCaseFolded();
+#else
+    return path;
+#endif
+}
+
+void EditorManager::indexEditorPath(ScintillaNext *editor)
+{
+    unindexEditorPath(editor);
+
+    if (!editor->isFile()) {
+        return;
+    }
+
+    // Both the path as it was given (which may go through a link) and the canonical path it resolved to
+    QStringList keys{pathKey(editor->getFileInfo().absoluteFilePath()), pathKey(editor->getFilePath())};
+    keys.removeDuplicates();
+
+    for (const QString &key : qAsConst(keys)) {
+        editorsByPath.insert(key, editor);
+    }
+
+    pathKeysOfEditor.insert(editor, keys);
+}
+
+void EditorManager::unindexEditorPath(ScintillaNext *editor)
+{
+    const QStringList keys = pathKeysOfEditor.take(editor);
+
+    for (const QString &key : keys) {
+        // Two editors can end up on the same file, e.g. after a Save As, so only drop the ones that are this editor's
+        if (editorsByPath.value(key) == editor) {
+            editorsByPath.remove(key);
+        }
+    }
+}
+
 QList<QPointer<ScintillaNext> > EditorManager::getEditors()
 {
     purgeOldEditorPointers();
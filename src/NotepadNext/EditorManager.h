@@ -20,8 +20,13 @@
 #ifndef EDITORMANAGER_H
 #define EDITORMANAGER_H
 
+#include <QHash>
 #include <QObject>
 #include <QPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
 
 
 class ApplicationSettings;
@@ -36,22 +41,57 @@ public:
 
     ScintillaNext *createEditor(const QString &name);
     ScintillaNext *createEditorFromFile(const QString &filePath, bool tryToCreate=false);
+    // Nothing is read until the editor is shown, see ScintillaNext::deferredFromFile()
+    ScintillaNext *createDeferredEditorFromFile(const QString &filePath);
+    // Another view of the editor's document, see ScintillaNext::createClone()
+    ScintillaNext *createClone(ScintillaNext *editor);
+
+    // After a moment, reads the editors that are still deferred one at a time with a gap between each
+    void loadDeferredEditors(const QList<QPointer<ScintillaNext>> &deferred);
 
     ScintillaNext *getEditorByFilePath(const QString &filePath);
 
     void manageEditor(ScintillaNext *editor);
 
+    // Closes them all together. editorClosed() is still sent for each of them, but anything that only needs to catch
+    // up once can skip it while isClosingEditors() and wait for editorsClosed()
+    void closeEditors(const QVector<ScintillaNext *> &editors);
+    bool isClosingEditors() const { return closingEditors; }
+
 signals:
     void editorCreated(ScintillaNext *editor);
+    // Clones aren't files of their own, so they are kept apart from editorCreated()
+    void cloneCreated(ScintillaNext *clone);
     void editorClosed(ScintillaNext *editor);
+    void editorsClosed(const QVector<ScintillaNext *> &editors);
+
+private slots:
+    void updateFonts();
+    void updateUndoLimits();
+    void updateLayoutSettings();
 
 private:
     void setupEditor(ScintillaNext *editor);
+    void applyFont(ScintillaNext *editor);
+    void applyLayoutSettings(ScintillaNext *editor);
+
+    // The change is made to the editors that are visible now, and to each of the others the next time it is shown
+    void forEachEditorWhenShown(const QString &key, std::function<void(ScintillaNext *)> callback);
     void purgeOldEditorPointers();
     QList<QPointer<ScintillaNext>> getEditors();
 
+    // Editors backed by a file are also indexed by path, so finding one doesn't compare (and stat) every editor
+    static QString pathKey(const QString &filePath);
+    void indexEditorPath(ScintillaNext *editor);
+    void unindexEditorPath(ScintillaNext *editor);
+
     QList<QPointer<ScintillaNext>> editors;
+    QHash<QString, ScintillaNext *> editorsByPath;
+    QHash<ScintillaNext *, QStringList> pathKeysOfEditor;
     ApplicationSettings *settings;
+
+    bool closingEditors = false;
+    QVector<ScintillaNext *> closedEditors;
 };
 
 #endif // EDITORMANAGER_H
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditorMemoryUsage.h"
+#include "MatchIndex.h"
+#include "ScintillaNext.h"
+#include "WordIndex.h"
+
+#include "lua.hpp"
+
+
+EditorMemoryUsage &EditorMemoryUsage::operator+=(const EditorMemoryUsage &other)
+{
+    text += other.text;
+    styles += other.styles;
+    lineIndex += other.lineIndex;
+    undoActions += other.undoActions;
+    undo += other.undo;
+    changeHistory += other.changeHistory;
+    caches += other.caches;
+    indicatorRuns += other.indicatorRuns;
+    indicators += other.indicators;
+    lexer += other.lexer;
+
+    return *this;
+}
+
+EditorMemoryUsage EditorMemoryUsage::measure(ScintillaNext *editor)
+{
+    EditorMemoryUsage usage;
+
+    // The document has been let go of, or not read yet
+    if (editor->isHibernated() || editor->isLoadDeferred()) {
+        return usage;
+    }
+
+    const qint64 length = editor->length();
+    const qint64 lines = editor->lineCount();
+
+    usage.text = length;
+    usage.styles = (editor->documentOptions() & SC_DOCUMENTOPTION_STYLES_NONE) ? 0 : length;
+    usage.lineIndex = lines * sizeof(Sci_Position);
+
+    const ScintillaNext::UndoUsage undo = editor->undoUsage();
+    usage.undoActions = undo.actions;
+    usage.undo = undo.bytes;
+    usage.changeHistory = editor->changeHistoryMemory();
+
+    MatchIndex *matchIndex = editor->findChild<MatchIndex *>(QString(), Qt::FindDirectChildrenOnly);
+    if (matchIndex) {
+        usage.caches += matchIndex->memoryUsage();
+    }
+
+    for (const WordIndex *wordIndex : WordIndex::allIndexes()) {
+        if (wordIndex->getEditor() == editor) {
+            usage.caches += wordIndex->memoryUsage();
+        }
+    }
+
+    // Each indicator is a list of runs, one that is never set is a single empty run and costs nothing worth counting
+    for (int indicator = 0; indicator <= INDICATOR_MAX; ++indicator) {
+        int runs = 0;
+        Sci_Position pos = 0;
+
+        while (pos < length) {
+            const Sci_Position end = editor->indicatorEnd(indicator, pos);
+            ++runs;
+
+            if (end <= pos) {
+                break;
+            }
+
+            pos = end;
+        }
+
+        if (runs > 1) {
+            usage.indicatorRuns += runs;
+        }
+    }
+    usage.indicators = static_cast<qint64>(usage.indicatorRuns) * (sizeof(Sci_Position) + sizeof(int));
+
+    // Fold levels and line states are an int a line, and are only there once a lexer uses them
+    if (!editor->lexerLanguage().isEmpty()) {
+        usage.lexer += lines * sizeof(int);
+    }
+    if (editor->maxLineState() > 0) {
+        usage.lexer += lines * sizeof(int);
+    }
+
+    return usage;
+}
+
+qint64 luaHeapSize(lua_State *L)
+{
+    return static_cast<qint64>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EDITORMEMORYUSAGE_H
+#define EDITORMEMORYUSAGE_H
+
+#include <QtGlobal>
+
+
+class ScintillaNext;
+struct lua_State;
+
+// Roughly how much memory an editor is using, worked out from what Scintilla and the caches report rather than
+// measured, so it is only meant for telling which editors are big. Everything is in bytes.
+struct EditorMemoryUsage
+{
+    qint64 text = 0;
+    qint64 styles = 0;
+    qint64 lineIndex = 0;
+    int undoActions = 0;
+    qint64 undo = 0;
+    qint64 changeHistory = 0;
+    qint64 caches = 0;
+    int indicatorRuns = 0;
+    qint64 indicators = 0;
+    qint64 lexer = 0;
+
+    qint64 total() const { return text + styles + lineIndex + undo + changeHistory + caches + indicators + lexer; }
+
+    EditorMemoryUsage &operator+=(const EditorMemoryUsage &other);
+
+    // This reads the whole undo history and walks every indicator, so it isn't something to do on every change
+    static EditorMemoryUsage measure(ScintillaNext *editor);
+};
+
+qint64 luaHeapSize(lua_State *L);
+
+#endif // EDITORMEMORYUSAGE_H
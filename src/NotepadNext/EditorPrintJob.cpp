@@ -0,0 +1,140 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditorPrintJob.h"
+#include "JobScheduler.h"
+#include "ScintillaNext.h"
+
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QPainter>
+#include <QPrinter>
+
+
+EditorPrintJob::EditorPrintJob(ScintillaNext *editor, QPrinter *printer, const QVector<int> &knownPageStarts, QObject *parent) :
+    QObject(parent),
+    editor(editor),
+    printer(printer),
+    knownPageStarts(knownPageStarts)
+{
+}
+
+EditorPrintJob::~EditorPrintJob()
+{
+    cancel();
+}
+
+void EditorPrintJob::start()
+{
+    qInfo() << "Print from page" << printer->fromPage() << "to" << printer->toPage();
+    qInfo() << "Paper:" << printer->paperRect(QPrinter::DevicePixel);
+    qInfo() << "Page:" << printer->pageRect(QPrinter::DevicePixel);
+
+    fromPage = printer->fromPage();
+    toPage = printer->toPage();
+    pageNum = 1;
+    startPos = 0;
+    pagesPrinted = 0;
+
+    // The printer starts with a valid page initially
+    needsNewPage = false;
+
+    if (fromPage > 1 && !knownPageStarts.isEmpty()) {
+        pageNum = qMin(fromPage, knownPageStarts.size());
+        startPos = knownPageStarts[pageNum - 1];
+    }
+
+    painter.reset(new QPainter(printer));
+    running = true;
+
+    JobScheduler::instance()->schedule(this, JobScheduler::Interactive, [=](const QDeadlineTimer &deadline) {
+        return printPages(deadline);
+    });
+}
+
+void EditorPrintJob::cancel()
+{
+    if (!running)
+        return;
+
+    qInfo(Q_FUNC_INFO);
+
+    JobScheduler::instance()->unschedule(this);
+
+    printer->abort();
+    painter.reset();
+
+    // Half a PDF is no use to anyone
+    if (printer->outputFormat() == QPrinter::PdfFormat && !printer->outputFileName().isEmpty())
+        QFile::remove(printer->outputFileName());
+
+    finish(false);
+}
+
+bool EditorPrintJob::printPages(const QDeadlineTimer &deadline)
+{
+    if (!editor) {
+        cancel();
+        return false;
+    }
+
+    const QRect paperRect = printer->paperRect(QPrinter::DevicePixel).toRect();
+    const QRect printableArea(QPoint(0, 0), printer->pageRect(QPrinter::DevicePixel).size().toSize());
+    const int length = editor->length();
+
+    do {
+        const bool needsToDraw = (fromPage == 0 && toPage == 0) || (fromPage <= pageNum && pageNum <= toPage);
+
+        if (needsToDraw) {
+            if (needsNewPage) {
+                printer->newPage();
+            }
+            else {
+                needsNewPage = true;
+            }
+        }
+
+        const int next = editor->formatRange(needsToDraw, printer, printer, printableArea, paperRect, startPos, length);
+
+        pageNum++;
+
+        if (needsToDraw)
+            emit pagePrinted(++pagesPrinted);
+
+        // Also guard against a page that could not fit anything, which would otherwise never finish
+        if (next >= length || next <= startPos || (toPage != 0 && pageNum > toPage)) {
+            painter->end();
+            painter.reset();
+            finish(true);
+            return false;
+        }
+
+        startPos = next;
+    } while (!deadline.hasExpired());
+
+    return true;
+}
+
+void EditorPrintJob::finish(bool completed)
+{
+    running = false;
+
+    emit finished(completed);
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EDITORPRINTJOB_H
+#define EDITORPRINTJOB_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include <memory>
+
+class QDeadlineTimer;
+class QPainter;
+class QPrinter;
+class ScintillaNext;
+
+
+// Sends the editor's pages to a printer, or a PDF file, a few at a time as slices of the JobScheduler, so a long
+// document doesn't freeze the application while it prints. Scintilla can only format pages from the editor on the
+// GUI thread, so the work is spread out there rather than moved to a worker. The printer's page range is used.
+class EditorPrintJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Any page breaks already known for the printer's layout let it skip straight to the first page in the range
+    EditorPrintJob(ScintillaNext *editor, QPrinter *printer, const QVector<int> &knownPageStarts, QObject *parent = Q_NULLPTR);
+    ~EditorPrintJob();
+
+    void start();
+    void cancel();
+
+signals:
+    void pagePrinted(int pagesPrinted);
+    void finished(bool completed);
+
+private:
+    bool printPages(const QDeadlineTimer &deadline);
+    void finish(bool completed);
+
+    QPointer<ScintillaNext> editor;
+    QPrinter *printer;
+    QVector<int> knownPageStarts;
+    std::unique_ptr<QPainter> painter;
+
+    int fromPage = 0;
+    int toPage = 0;
+    int pageNum = 1;
+    int startPos = 0;
+    int pagesPrinted = 0;
+    bool needsNewPage = false;
+    bool running = false;
+};
+
+#endif // EDITORPRINTJOB_H
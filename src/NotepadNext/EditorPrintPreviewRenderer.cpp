@@ -21,50 +21,125 @@
 #include "ScintillaNext.h"
 
 #include <QPrinter>
-#include <QDebug>
+#include <QElapsedTimer>
 #include <QPainter>
+#include <QTimer>
+
+
+// How long each idle slice may spend finding page breaks before handing control back to the event loop
+static const int PAGINATION_BUDGET_MS = 15;
+
+static void setImageResolution(QImage &image, qreal dpi)
+{
+    const int dotsPerMeter = qRound(dpi / 0.0254);
+
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+}
 
 EditorPrintPreviewRenderer::EditorPrintPreviewRenderer(ScintillaNext *editor)
-    : QObject(), editor(editor)
+    : QObject(), editor(editor), paginateTimer(new QTimer(this))
 {
+    paginateTimer->setInterval(0);
+    connect(paginateTimer, &QTimer::timeout, this, &EditorPrintPreviewRenderer::paginate);
 }
 
-void EditorPrintPreviewRenderer::render(QPrinter *printer)
+void EditorPrintPreviewRenderer::setPrinter(QPrinter *printer)
 {
-    QRectF printableArea(QPointF(0, 0), printer->pageRect(QPrinter::DevicePixel).size());
+    this->printer = printer;
 
-    qInfo() << "Print from page" << printer->fromPage() << "to" << printer->toPage();
-    qInfo() << "Paper:" << printer->paperRect(QPrinter::DevicePixel);
-    qInfo() << "Page:" << printer->pageRect(QPrinter::DevicePixel);
-    qInfo() << "Printable Area:" << printableArea;
+    paperRect = printer->paperRect(QPrinter::DevicePixel).toRect();
+    pageRect = printer->pageRect(QPrinter::DevicePixel).toRect();
+    resolution = printer->resolution();
 
-    const int fromPage = printer->fromPage();
-    const int toPage = printer->toPage();
+    // Layout is measured against an image with the printer's resolution rather than the printer itself, since
+    // painting on a printer (which measuring needs) would start a print job
+    measureDevice = QImage(1, 1, QImage::Format_RGB32);
+    setImageResolution(measureDevice, resolution);
 
-    // The printer starts with a valid page initially
-    bool needsNewPage = false;
+    pageStarts.clear();
+    pageStarts.append(0);
+    paginated = false;
 
-    int startPos = 0;
-    int pageNum = 1;
+    emit pageCountChanged(pageStarts.size());
 
-    QPainter painter(printer);
+    paginateTimer->start();
+}
 
-    do {
-        bool needsToDraw = (fromPage == 0 && toPage == 0) || (fromPage <= pageNum && pageNum <= toPage);
+QSizeF EditorPrintPreviewRenderer::paperSize() const
+{
+    return resolution > 0 ? QSizeF(paperRect.size()) / resolution : QSizeF();
+}
+
+QImage EditorPrintPreviewRenderer::renderPage(int page, qreal dpi) const
+{
+    if (!editor || !printer || page < 0 || page >= pageStarts.size()) {
+        return QImage();
+    }
+
+    const qreal scale = dpi / resolution;
+    const QRect paper(QPoint(0, 0), (QSizeF(paperRect.size()) * scale).toSize());
+    const QRect printable((QPointF(pageRect.topLeft()) * scale).toPoint(), (QSizeF(pageRect.size()) * scale).toSize());
 
-        if (needsToDraw) {
-            if (needsNewPage) {
-                printer->newPage();
-            }
-            else {
-                needsNewPage = true;
-            }
+    QImage image(paper.size(), QImage::Format_RGB32);
+    setImageResolution(image, dpi);
+    image.fill(Qt::white);
+
+    // Stop at the next known break so the page holds exactly what the printer will put on it, even if the layout at
+    // this resolution would fit a little more or less
+    QPainter painter(&image);
+    editor->formatRange(true, &image, &image, printable, paper, pageStarts[page], pageEnd(page));
+
+    return image;
+}
+
+int EditorPrintPreviewRenderer::pageEnd(int page) const
+{
+    return page + 1 < pageStarts.size() ? pageStarts[page + 1] : editor->length();
+}
+
+void EditorPrintPreviewRenderer::paginate()
+{
+    if (!editor || !printer) {
+        paginateTimer->stop();
+        return;
+    }
+
+    const QRect printableArea(QPoint(0, 0), pageRect.size());
+    const int length = editor->length();
+    const int pagesBefore = pageStarts.size();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed() < PAGINATION_BUDGET_MS) {
+        const int start = pageStarts.last();
+        const int next = editor->formatRange(false, &measureDevice, &measureDevice, printableArea, paperRect, start, length);
+
+        // Also guard against a page that could not fit anything, which would otherwise never finish
+        if (next >= length || next <= start) {
+            paginated = true;
+            break;
         }
 
-        startPos = editor->formatRange(needsToDraw, printer, printer,
-                                    printableArea.toRect(), printer->paperRect(QPrinter::DevicePixel).toRect(),
-                                    startPos, editor->length());
+        pageStarts.append(next);
+    }
+
+    if (pageStarts.size() != pagesBefore) {
+        emit pageCountChanged(pageStarts.size());
+    }
+
+    if (paginated) {
+        paginateTimer->stop();
+        emit paginationFinished();
+    }
+}
+
+QVector<int> EditorPrintPreviewRenderer::pageStartsFor(QPrinter *printer) const
+{
+    const bool sameLayout = printer == this->printer && resolution == printer->resolution()
+                            && paperRect == printer->paperRect(QPrinter::DevicePixel).toRect()
+                            && pageRect == printer->pageRect(QPrinter::DevicePixel).toRect();
 
-        pageNum++;
-    } while (startPos < editor->length());
+    return sameLayout ? pageStarts : QVector<int>();
 }
@@ -20,12 +20,21 @@
 #ifndef EDITORPRINTPREVIEWRENDERER_H
 #define EDITORPRINTPREVIEWRENDERER_H
 
+#include <QImage>
 #include <QObject>
+#include <QPointer>
+#include <QRect>
+#include <QSizeF>
+#include <QVector>
 
 
 class ScintillaNext;
 class QPrinter;
+class QTimer;
 
+// Works out where the editor's pages break for a given printer layout and renders single pages on demand. The breaks
+// are found a few pages at a time while the event loop is idle, so a preview can show the first pages of a huge
+// document straight away and only ever formats the pages that are actually looked at.
 class EditorPrintPreviewRenderer : public QObject
 {
     Q_OBJECT
@@ -33,11 +42,43 @@ class EditorPrintPreviewRenderer : public QObject
 public:
     explicit EditorPrintPreviewRenderer(ScintillaNext *editor);
 
-public slots:
-    void render(QPrinter *printer);
+    // Starts paginating the document again for the printer's current page layout
+    void setPrinter(QPrinter *printer);
+
+    // Number of pages found so far, this only grows until isPaginated() returns true
+    int pageCount() const { return pageStarts.size(); }
+    bool isPaginated() const { return paginated; }
+
+    // Size of the sheet of paper in inches
+    QSizeF paperSize() const;
+
+    // The page is 0 based and the image is the whole sheet of paper at the requested resolution
+    QImage renderPage(int page, qreal dpi) const;
+
+    // The page breaks found so far if the printer still has the layout they were found for, otherwise none
+    QVector<int> pageStartsFor(QPrinter *printer) const;
+
+signals:
+    void pageCountChanged(int count);
+    void paginationFinished();
+
+private slots:
+    void paginate();
 
 private:
-    ScintillaNext *editor;
-};
+    int pageEnd(int page) const;
+
+    QPointer<ScintillaNext> editor;
+    QPrinter *printer = Q_NULLPTR;
+    QTimer *paginateTimer;
 
+    // Printer geometry captured by setPrinter(), in printer device pixels
+    QRect paperRect;
+    QRect pageRect;
+    int resolution = 0;
+    QImage measureDevice;
+
+    QVector<int> pageStarts;
+    bool paginated = false;
+};
 #endif // EDITORPRINTPREVIEWRENDERER_H
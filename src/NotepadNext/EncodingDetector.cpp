@@ -0,0 +1,397 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EncodingDetector.h"
+#include "Compression.h"
+
+#include "uchardet.h"
+
+#include <QFile>
+#include <QList>
+#include <QTextCodec>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+// How many pieces of a file are looked at besides the start, spread evenly through the rest of it
+const int SAMPLE_REGIONS = 4;
+
+// Once uchardet is this sure about one piece the others aren't looked at
+const float CONFIDENT = 0.9f;
+
+// How long the sequence starting with the byte is, or 0 if nothing can start with it
+static int sequenceLength(unsigned char lead)
+{
+    if (lead < 0x80) return 1;
+    if (lead >= 0xC2 && lead <= 0xDF) return 2;
+    if (lead >= 0xE0 && lead <= 0xEF) return 3;
+    if (lead >= 0xF0 && lead <= 0xF4) return 4;
+    return 0;
+}
+
+QTextCodec *EncodingDetector::codecForBom(const char *data, qsizetype length)
+{
+    // Only the first few bytes matter, so avoid copying the whole buffer
+    const QByteArray header = QByteArray::fromRawData(data, static_cast<int>(qMin<qsizetype>(length, 4)));
+
+    return QTextCodec::codecForUtfText(header, Q_NULLPTR);
+}
+
+qsizetype EncodingDetector::validUtf8Length(const char *data, qsizetype length)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = p + length;
+
+    while (p < end) {
+        // Skip over ASCII 16 bytes at a time, which is the vast majority of most files, and stop right on the
+        // first byte that isn't
+#ifdef __SSE2__
+        while (end - p >= 16) {
+            const int high = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+
+            if (high != 0) {
+                p += qCountTrailingZeroBits(static_cast<quint32>(high));
+                break;
+            }
+
+            p += 16;
+        }
+#elif defined(__ARM_NEON)
+        while (end - p >= 16) {
+            // NEON has no movemask, narrowing the comparison leaves 4 bits for each byte instead
+            const uint8x16_t high = vcgeq_u8(vld1q_u8(p), vdupq_n_u8(0x80));
+            const quint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(high), 4)), 0);
+
+            if (mask != 0) {
+                p += qCountTrailingZeroBits(mask) / 4;
+                break;
+            }
+
+            p += 16;
+        }
+#endif
+
+        // Whatever is left is done a word at a time
+        while (end - p >= 8) {
+            quint64 word;
+            std::memcpy(&word, p, sizeof(word));
+
+            if (word & Q_UINT64_C(0x8080808080808080))
+                break;
+
+            p += 8;
+        }
+
+        if (p >= end)
+            break;
+
+        const unsigned char *sequence = p;
+        const unsigned char c = *p;
+
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+
+        int continuationBytes;
+        unsigned char min = 0x80;
+        unsigned char max = 0xBF;
+
+        if (c >= 0xC2 && c <= 0xDF) {
+            continuationBytes = 1;
+        }
+        else if (c >= 0xE0 && c <= 0xEF) {
+            continuationBytes = 2;
+
+            // Reject overlong encodings and surrogates
+            if (c == 0xE0) min = 0xA0;
+            else if (c == 0xED) max = 0x9F;
+        }
+        else if (c >= 0xF0 && c <= 0xF4) {
+            continuationBytes = 3;
+
+            // Reject overlong encodings and anything past U+10FFFF
+            if (c == 0xF0) min = 0x90;
+            else if (c == 0xF4) max = 0x8F;
+        }
+        else {
+            return sequence - reinterpret_cast<const unsigned char *>(data);
+        }
+
+        ++p;
+
+        for (int i = 0; i < continuationBytes; ++i, ++p) {
+            if (p >= end)
+                return length;
+
+            if (*p < min || *p > max)
+                return sequence - reinterpret_cast<const unsigned char *>(data);
+
+            min = 0x80;
+            max = 0xBF;
+        }
+    }
+
+    return length;
+}
+
+bool EncodingDetector::isUtf8(const char *data, qsizetype length)
+{
+    return validUtf8Length(data, length) == length;
+}
+
+bool EncodingDetector::isPlainAscii(const char *data, qsizetype length)
+{
+    qsizetype i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+
+        // The high bit of each byte is set for anything above 0x7F, and ORing in the comparison sets it for NULs
+        if (_mm_movemask_epi8(_mm_or_si128(bytes, _mm_cmpeq_epi8(bytes, zero))) != 0)
+            return false;
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 16 <= length; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        const uint8x16_t notPlain = vorrq_u8(vcgeq_u8(bytes, vdupq_n_u8(0x80)), vceqq_u8(bytes, vdupq_n_u8(0)));
+
+        if (vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(notPlain), 4)), 0) != 0)
+            return false;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+
+        if (c == 0 || c >= 0x80)
+            return false;
+    }
+
+    return true;
+}
+
+bool EncodingDetector::isUtf8Codec(const QTextCodec *codec)
+{
+    return codec != Q_NULLPTR && codec->mibEnum() == 106;
+}
+
+qsizetype EncodingDetector::utf8BomLength(const char *data, qsizetype length)
+{
+    return (length >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) ? 3 : 0;
+}
+
+QTextCodec *EncodingDetector::detect(const char *data, qsizetype length, QIODevice *file)
+{
+    // Search for a BOM mark
+    QTextCodec *codec = codecForBom(data, length);
+
+    if (codec != Q_NULLPTR) {
+        qDebug("BOM mark found");
+        return codec;
+    }
+
+    QList<QByteArray> samples;
+    samples.append(QByteArray::fromRawData(data, static_cast<int>(qMin(length, SAMPLE_SIZE))));
+
+    // Plenty of files start with an ASCII header, so the rest of the file gets a look too
+    if (file != Q_NULLPTR && !file->isSequential() && file->size() > SAMPLE_SIZE) {
+        const qint64 position = file->pos();
+        const qint64 size = file->size();
+        qint64 previousOffset = 0;
+
+        for (int i = 1; i <= SAMPLE_REGIONS; ++i) {
+            // The last one is the end of the file
+            const qint64 offset = qMax<qint64>(SAMPLE_SIZE, (size - SAMPLE_SIZE) * i / SAMPLE_REGIONS);
+
+            if (offset <= previousOffset || !file->seek(offset)) {
+                continue;
+            }
+            previousOffset = offset;
+
+            QByteArray sample = file->read(SAMPLE_SIZE);
+
+            // It most likely starts part way into a multi-byte sequence
+            int start = 0;
+            while (start < qMin(sample.size(), 3) && (static_cast<unsigned char>(sample[start]) & 0xC0) == 0x80) {
+                ++start;
+            }
+            sample.remove(0, start);
+
+            samples.append(sample);
+        }
+
+        file->seek(position);
+    }
+
+    // Plain ASCII and UTF-8 is by far the most common so don't bother with uchardet at all
+    QList<QByteArray> undecided;
+    for (const QByteArray &sample : qAsConst(samples)) {
+        if (!isUtf8(sample.constData(), sample.size())) {
+            undecided.append(sample);
+        }
+    }
+
+    if (undecided.isEmpty()) {
+        qDebug("BOM mark not found, data is valid UTF-8");
+        return Q_NULLPTR;
+    }
+
+    qDebug("BOM mark not found, using uchardet");
+
+    // Use uchardet to try and detect file encoding since no BOM was found. Each sample is detected on its own, so
+    // the rest can be skipped as soon as one of them leaves no doubt.
+    float bestConfidence = 0.0f;
+    for (const QByteArray &sample : qAsConst(undecided)) {
+        uchardet_t encodingDetector = uchardet_new();
+
+        if (uchardet_handle_data(encodingDetector, sample.constData(), sample.size()) == 0) {
+            uchardet_data_end(encodingDetector);
+
+            const char *charset = uchardet_get_charset(encodingDetector);
+            const float confidence = uchardet_get_n_candidates(encodingDetector) > 0 ? uchardet_get_confidence(encodingDetector, 0) : 0.0f;
+
+            qDebug("uchardet detected encoding as: '%s' (%.2f)", charset, confidence);
+
+            if (charset[0] != '\0' && confidence > bestConfidence) {
+                bestConfidence = confidence;
+                codec = QTextCodec::codecForName(charset);
+            }
+        }
+        else {
+            qDebug("uchardet failure");
+        }
+        uchardet_delete(encodingDetector);
+
+        if (bestConfidence >= CONFIDENT) {
+            break;
+        }
+    }
+
+    return codec;
+}
+
+bool EncodingDetector::isBinary(const char *data, qsizetype length)
+{
+    // UTF-16 and UTF-32 are full of NUL bytes
+    if (codecForBom(data, length) != Q_NULLPTR)
+        return false;
+
+    const qsizetype sampleSize = qMin(length, BINARY_SAMPLE_SIZE);
+
+    if (std::memchr(data, 0, sampleSize) != Q_NULLPTR)
+        return true;
+
+    qsizetype controlCharacters = 0;
+    for (qsizetype i = 0; i < sampleSize; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+
+        // Whitespace, backspace and escape (e.g. ANSI colours in logs) all turn up in text
+        if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\v' && c != '\b' && c != 0x1B) || c == 0x7F)
+            ++controlCharacters;
+    }
+
+    // More than one byte in ten
+    return controlCharacters * 10 > sampleSize;
+}
+
+bool EncodingDetector::isBinaryFile(const QString &filePath)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray sample = file.read(BINARY_SAMPLE_SIZE);
+
+    // It is what a compressed file decompresses to that matters, the start of which is enough
+    const Compression::Format compression = Compression::detect(sample.constData(), sample.size());
+    if (compression != Compression::Format::None) {
+        sample += file.read(Compression::INPUT_CHUNK_SIZE - sample.size());
+
+        QByteArray decompressed;
+        if (!Compression::createDecoder(compression)->decode(sample.constData(), sample.size(), decompressed))
+            return true;
+
+        sample = decompressed;
+    }
+
+    return isBinary(sample.constData(), sample.size());
+}
+
+bool Utf8StreamValidator::add(const char *data, qsizetype length)
+{
+    if (error >= 0) {
+        return false;
+    }
+
+    qsizetype start = 0;
+
+    // First finish off the sequence the last piece ended part way into
+    if (!carry.isEmpty()) {
+        const qsizetype needed = sequenceLength(static_cast<unsigned char>(carry[0])) - carry.size();
+        start = qMin(needed, length);
+        carry.append(data, static_cast<int>(start));
+
+        if (EncodingDetector::validUtf8Length(carry.constData(), carry.size()) != carry.size()) {
+            error = 0;
+            return false;
+        }
+
+        if (start < needed) {
+            return true;
+        }
+
+        carry.clear();
+    }
+
+    // A sequence cut off at the end is held back until the next piece
+    qsizetype end = length;
+    for (qsizetype i = 1; i <= 3 && length - i >= start; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[length - i]);
+
+        if ((c & 0xC0) == 0x80) {
+            continue;
+        }
+
+        if (sequenceLength(c) > i) {
+            end = length - i;
+        }
+        break;
+    }
+
+    const qsizetype valid = start + EncodingDetector::validUtf8Length(data + start, end - start);
+    if (valid < end) {
+        error = valid;
+        return false;
+    }
+
+    carry = QByteArray(data + end, static_cast<int>(length - end));
+    return true;
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+
+
+class QIODevice;
+class QString;
+class QTextCodec;
+
+// Works out the encoding of a block of bytes read from disk. Nothing here depends on an editor or
+// keeps any state, so it is safe to use from any thread.
+class EncodingDetector
+{
+public:
+    // Only this much of the data is looked at when validating UTF-8 or running uchardet
+    static constexpr qsizetype SAMPLE_SIZE = 64 * 1024;
+
+    // How much of the start of a file isBinary() needs to see
+    static constexpr qsizetype BINARY_SAMPLE_SIZE = 8 * 1024;
+
+    // Returns the codec matching a byte order mark at the start of data, or nullptr if there isn't one
+    static QTextCodec *codecForBom(const char *data, qsizetype length);
+
+    // A multi-byte sequence cut off at the very end of data is accepted, since data is usually a sample
+    static bool isUtf8(const char *data, qsizetype length);
+
+    // How much of data is UTF-8 before the first byte that isn't, the same way isUtf8() checks it
+    static qsizetype validUtf8Length(const char *data, qsizetype length);
+
+    // Whether data is all ASCII without a single NUL byte, which is what most source files are. Both are looked
+    // for together in one pass, so it can settle a file before anything else looks at it.
+    static bool isPlainAscii(const char *data, qsizetype length);
+
+    // UTF-8 is what the editor stores, so text in it never needs converted. Only the BOM (if any) has to be skipped.
+    static bool isUtf8Codec(const QTextCodec *codec);
+    static qsizetype utf8BomLength(const char *data, qsizetype length);
+
+    // Checks for a BOM, then for plain ASCII/UTF-8, and only then falls back to uchardet. Returns
+    // nullptr when the data is UTF-8 without a BOM (or the encoding is unknown) and no conversion is needed.
+    // Given the file that data is the start of, a few pieces from through the rest of it are checked as well.
+    // The file has to be seekable and is left where it was.
+    static QTextCodec *detect(const char *data, qsizetype length, QIODevice *file = Q_NULLPTR);
+
+    // Whether data looks like the start of something other than text, i.e. it has no BOM and either has a NUL byte
+    // (the same heuristic as git) or too many other control characters for any text file
+    static bool isBinary(const char *data, qsizetype length);
+
+    // The same check on the start of a file, or on what it decompresses to if it is compressed
+    static bool isBinaryFile(const QString &filePath);
+};
+
+// Checks UTF-8 a piece at a time as a file is read, so a sequence split between two pieces is still checked whole
+class Utf8StreamValidator
+{
+public:
+    // Returns false once anything that isn't UTF-8 has turned up, errorOffset() is then where it is in data
+    bool add(const char *data, qsizetype length);
+    qsizetype errorOffset() const { return error; }
+
+private:
+    QByteArray carry;
+    qsizetype error = -1;
+};
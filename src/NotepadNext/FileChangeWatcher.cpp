@@ -0,0 +1,288 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileChangeWatcher.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QPointer>
+#include <QThreadPool>
+#include <QTimer>
+
+
+// Editors often write a file in several steps (truncate, write, rename, touch), wait for them all before looking
+static const int COALESCE_INTERVAL_MS = 250;
+
+// A stat that hasn't returned by now is on a drive that isn't answering
+static const int STAT_TIMEOUT_MS = 5000;
+
+// Threads stuck on a hung drive stay stuck, so they come from a pool of their own rather than the global one
+static const int MAX_STAT_THREADS = 4;
+
+
+FileChangeWatcher::FileChangeWatcher(QObject *parent) :
+    QObject(parent),
+    watcher(new QFileSystemWatcher(this)),
+    coalesceTimer(new QTimer(this)),
+    timeoutTimer(new QTimer(this)),
+    statPool(new QThreadPool(this))
+{
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(COALESCE_INTERVAL_MS);
+
+    timeoutTimer->setSingleShot(true);
+    timeoutTimer->setInterval(STAT_TIMEOUT_MS);
+
+    statPool->setMaxThreadCount(MAX_STAT_THREADS);
+
+    connect(coalesceTimer, &QTimer::timeout, this, &FileChangeWatcher::statPendingFiles);
+    connect(timeoutTimer, &QTimer::timeout, this, &FileChangeWatcher::statTimedOut);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &FileChangeWatcher::pathChanged);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &FileChangeWatcher::directoryChanged);
+}
+
+void FileChangeWatcher::watchEditor(ScintillaNext *editor)
+{
+    // Saving a new buffer or saving it somewhere else changes which file it is
+    connect(editor, &ScintillaNext::renamed, this, [=]() { updateEditorPath(editor); });
+    connect(editor, &ScintillaNext::saved, this, [=]() { updateEditorPath(editor); });
+    connect(editor, &ScintillaNext::closed, this, [=]() { forgetEditor(editor); });
+    connect(editor, &QObject::destroyed, this, [=]() { forgetEditor(editor); });
+
+    updateEditorPath(editor);
+}
+
+void FileChangeWatcher::recheck(ScintillaNext *editor)
+{
+    const QString filePath = editorPaths.value(editor);
+
+    if (!filePath.isEmpty()) {
+        queue(filePath);
+    }
+}
+
+void FileChangeWatcher::recheckAll()
+{
+    for (const QString &filePath : qAsConst(editorPaths)) {
+        queue(filePath);
+    }
+}
+
+void FileChangeWatcher::pathChanged(const QString &path)
+{
+    queue(path);
+}
+
+void FileChangeWatcher::directoryChanged(const QString &directory)
+{
+    // Something in the directory was added, removed or renamed, which might have been one of the files
+    for (const QString &filePath : qAsConst(editorPaths)) {
+        if (QFileInfo(filePath).path() == directory) {
+            queue(filePath);
+        }
+    }
+}
+
+void FileChangeWatcher::statPendingFiles()
+{
+    // Only one batch at a time, whatever comes in meanwhile is picked up when it finishes
+    if (statting || pendingPaths.isEmpty()) {
+        return;
+    }
+
+    // Asking a drive that is already stuck again would only tie up another thread
+    QStringList filePaths;
+    for (const QString &filePath : qAsConst(pendingPaths)) {
+        if (!unresponsivePaths.contains(filePath)) {
+            filePaths.append(filePath);
+        }
+    }
+
+    pendingPaths.clear();
+
+    if (filePaths.isEmpty()) {
+        return;
+    }
+
+    statting = true;
+    currentBatch++;
+    currentPaths = filePaths;
+    timeoutTimer->start();
+
+    const quint64 batch = currentBatch;
+    QPointer<FileChangeWatcher> self(this);
+
+    statPool->start([=]() {
+        QVector<FileState> states;
+        states.reserve(filePaths.size());
+
+        for (const QString &filePath : filePaths) {
+            const QFileInfo info(filePath);
+            states.append({filePath, info.exists(), info.lastModified()});
+        }
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self) {
+                self->handleFileStates(batch, states);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileChangeWatcher::statTimedOut()
+{
+    if (!statting) {
+        return;
+    }
+
+    qWarning("Timed out checking %d file(s) for changes", static_cast<int>(currentPaths.size()));
+
+    // The batch is given up on so other files can still be checked, it gets looked at once it does come back
+    for (const QString &filePath : qAsConst(currentPaths)) {
+        unresponsivePaths.insert(filePath);
+    }
+
+    statting = false;
+    currentPaths.clear();
+
+    if (!pendingPaths.isEmpty()) {
+        coalesceTimer->start();
+    }
+}
+
+void FileChangeWatcher::updateEditorPath(ScintillaNext *editor)
+{
+    const QString filePath = editor->isFile() ? editor->getFilePath() : QString();
+
+    if (editorPaths.value(editor) == filePath) {
+        return;
+    }
+
+    if (filePath.isEmpty()) {
+        editorPaths.remove(editor);
+    }
+    else {
+        editorPaths.insert(editor, filePath);
+    }
+
+    updateWatchedPaths();
+}
+
+void FileChangeWatcher::forgetEditor(ScintillaNext *editor)
+{
+    if (editorPaths.remove(editor) > 0) {
+        updateWatchedPaths();
+    }
+}
+
+void FileChangeWatcher::updateWatchedPaths()
+{
+    QSet<QString> wanted;
+
+    for (const QString &filePath : qAsConst(editorPaths)) {
+        wanted.insert(filePath);
+        wanted.insert(QFileInfo(filePath).path());
+    }
+
+    QStringList watched = watcher->files() + watcher->directories();
+    QStringList unwanted;
+    for (const QString &path : qAsConst(watched)) {
+        if (!wanted.remove(path)) {
+            unwanted.append(path);
+        }
+    }
+
+    if (!unwanted.isEmpty()) {
+        watcher->removePaths(unwanted);
+    }
+
+    // Missing files can't be watched, their directory being watched catches them coming back
+    if (!wanted.isEmpty()) {
+        watcher->addPaths(wanted.values());
+    }
+}
+
+void FileChangeWatcher::queue(const QString &filePath)
+{
+    pendingPaths.insert(filePath);
+
+    // Not restarted by later events, so a file that is written continuously still gets looked at regularly
+    if (!coalesceTimer->isActive()) {
+        coalesceTimer->start();
+    }
+}
+
+void FileChangeWatcher::handleFileStates(quint64 batch, const QVector<FileState> &states)
+{
+    if (batch == currentBatch && statting) {
+        statting = false;
+        currentPaths.clear();
+        timeoutTimer->stop();
+    }
+    else {
+        // A batch that timed out, the drive is answering again but what it said may be stale by now
+        for (const FileState &state : states) {
+            unresponsivePaths.remove(state.filePath);
+            queue(state.filePath);
+        }
+
+        return;
+    }
+
+    bool rewatch = false;
+    QVector<QPair<ScintillaNext *, FileState>> changedEditors;
+
+    for (const FileState &state : states) {
+        for (auto it = editorPaths.cbegin(); it != editorPaths.cend(); ++it) {
+            if (it.value() != state.filePath) {
+                continue;
+            }
+
+            const ScintillaNext *editor = it.key();
+            const bool changed = state.exists ? (editor->isFileMissing() || state.lastModified != editor->lastKnownModification())
+                                              : !editor->isFileMissing();
+
+            if (changed) {
+                changedEditors.append(qMakePair(it.key(), state));
+            }
+        }
+
+        // A file replaced by a rename drops out of the watcher and has to be added again
+        if (state.exists && !watcher->files().contains(state.filePath)) {
+            rewatch = true;
+        }
+    }
+
+    if (rewatch) {
+        updateWatchedPaths();
+    }
+
+    // Reacting to the change can close the editor or give it another file, so that is done last
+    for (const auto &change : qAsConst(changedEditors)) {
+        if (editorPaths.value(change.first) == change.second.filePath) {
+            emit fileChanged(change.first, change.second.exists, change.second.lastModified);
+        }
+    }
+
+    if (!pendingPaths.isEmpty() && !coalesceTimer->isActive()) {
+        coalesceTimer->start();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILECHANGEWATCHER_H
+#define FILECHANGEWATCHER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+
+class ScintillaNext;
+class QFileSystemWatcher;
+class QThreadPool;
+class QTimer;
+
+// Notices when the files behind the editors change on disk, whether or not the editor is the one being looked at.
+// Both the files and the directories they are in are watched, since saving by writing a new file and renaming it
+// over the old one (which a lot of programs do) leaves a watch on the file itself pointing at nothing. Bursts of
+// events are coalesced and the files are stat'ed on a worker thread, so only editors whose file really did change
+// hear about it, and slow network drives never hold up the GUI. A drive that stops answering (e.g. a hung SMB mount)
+// only stalls the files on it, they are left alone until their stat finally returns.
+class FileChangeWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileChangeWatcher(QObject *parent = nullptr);
+
+    void watchEditor(ScintillaNext *editor);
+
+public slots:
+    // Checks the editor's file (or every file) again, for when the file system does not send events, e.g. some
+    // network drives. The check itself still happens in the background.
+    void recheck(ScintillaNext *editor);
+    void recheckAll();
+
+signals:
+    // The file has been modified, deleted or has reappeared since the editor last looked at it. What the stat found
+    // is passed along so it doesn't need to be done again, see ScintillaNext::checkFileForStateChange().
+    void fileChanged(ScintillaNext *editor, bool exists, const QDateTime &lastModified);
+
+private slots:
+    void pathChanged(const QString &path);
+    void directoryChanged(const QString &directory);
+    void statPendingFiles();
+    void statTimedOut();
+
+private:
+    struct FileState {
+        QString filePath;
+        bool exists;
+        QDateTime lastModified;
+    };
+
+    void updateEditorPath(ScintillaNext *editor);
+    void forgetEditor(ScintillaNext *editor);
+    void updateWatchedPaths();
+    void queue(const QString &filePath);
+    void handleFileStates(quint64 batch, const QVector<FileState> &states);
+
+    QFileSystemWatcher *watcher;
+    QTimer *coalesceTimer;
+    QTimer *timeoutTimer;
+    QThreadPool *statPool;
+
+    QHash<ScintillaNext *, QString> editorPaths;
+    QSet<QString> pendingPaths;
+
+    // The batch being stat'ed right now and the files in it
+    bool statting = false;
+    quint64 currentBatch = 0;
+    QStringList currentPaths;
+
+    // Files whose stat took too long and still hasn't returned
+    QSet<QString> unresponsivePaths;
+};
+
+#endif // FILECHANGEWATCHER_H
@@ -0,0 +1,220 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileFilter.h"
+
+#include <QFile>
+
+
+#ifdef Q_OS_WIN
+static const Qt::CaseSensitivity FILE_NAME_CASE = Qt::CaseInsensitive;
+#else
+static const Qt::CaseSensitivity FILE_NAME_CASE = Qt::CaseSensitive;
+#endif
+
+QRegularExpression globToRegularExpression(const QString &glob, Qt::CaseSensitivity cs)
+{
+    QString re;
+    re.reserve(glob.size() * 2 + 8);
+
+    const int length = glob.size();
+    int i = 0;
+
+    while (i < length) {
+        const QChar c = glob.at(i);
+
+        if (c == '*') {
+            if (i + 1 < length && glob.at(i + 1) == '*') {
+                i += 2;
+
+                // "**/" matches zero or more directories, anything else with "**" matches everything
+                if (i < length && glob.at(i) == '/') {
+                    re += QStringLiteral("(?:.*/)?");
+                    ++i;
+                }
+                else {
+                    re += QStringLiteral(".*");
+                }
+                continue;
+            }
+
+            re += QStringLiteral("[^/]*");
+        }
+        else if (c == '?') {
+            re += QStringLiteral("[^/]");
+        }
+        else if (c == '[') {
+            int j = i + 1;
+
+            if (j < length && (glob.at(j) == '!' || glob.at(j) == '^'))
+                ++j;
+            if (j < length && glob.at(j) == ']')
+                ++j;
+            while (j < length && glob.at(j) != ']')
+                ++j;
+
+            if (j >= length) {
+                // No closing bracket so treat it literally
+                re += QStringLiteral("\\[");
+            }
+            else {
+                QString set = glob.mid(i + 1, j - i - 1);
+
+                if (set.startsWith('!'))
+                    set[0] = '^';
+                set.replace('\\', QStringLiteral("\\\\"));
+
+                re += '[' + set + ']';
+                i = j;
+            }
+        }
+        else if (c == '\\' && i + 1 < length) {
+            re += QRegularExpression::escape(glob.at(++i));
+        }
+        else {
+            re += QRegularExpression::escape(c);
+        }
+
+        ++i;
+    }
+
+    QRegularExpression::PatternOptions options = QRegularExpression::DotMatchesEverythingOption;
+    if (cs == Qt::CaseInsensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+
+    QRegularExpression expression(QStringLiteral("\\A(?:%1)\\z").arg(re), options);
+    expression.optimize();
+
+    return expression;
+}
+
+FileFilter::FileFilter(const QString &filters)
+{
+    static const QRegularExpression separators(QStringLiteral("[\\s;]+"));
+
+    for (const QString &filter : filters.split(separators, Qt::SkipEmptyParts)) {
+        if (filter.startsWith('!')) {
+            if (filter.size() > 1)
+                excludes.append(globToRegularExpression(filter.mid(1), FILE_NAME_CASE));
+        }
+        else if (filter != QStringLiteral("*") && filter != QStringLiteral("*.*")) {
+            includes.append(globToRegularExpression(filter, FILE_NAME_CASE));
+        }
+    }
+}
+
+bool FileFilter::acceptsFile(const QString &fileName) const
+{
+    for (const QRegularExpression &re : excludes) {
+        if (re.match(fileName).hasMatch())
+            return false;
+    }
+
+    if (includes.isEmpty())
+        return true;
+
+    for (const QRegularExpression &re : includes) {
+        if (re.match(fileName).hasMatch())
+            return true;
+    }
+
+    return false;
+}
+
+bool FileFilter::acceptsDirectory(const QString &dirName) const
+{
+    for (const QRegularExpression &re : excludes) {
+        if (re.match(dirName).hasMatch())
+            return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const IgnoreRules> IgnoreRules::forDirectory(const std::shared_ptr<const IgnoreRules> &parent, const QString &dirPath)
+{
+    QFile file(dirPath + QStringLiteral("/.gitignore"));
+
+    if (!file.open(QIODevice::ReadOnly))
+        return parent;
+
+    auto ignoreRules = std::make_shared<IgnoreRules>();
+    ignoreRules->parent = parent;
+    ignoreRules->basePath = dirPath.endsWith('/') ? dirPath : dirPath + '/';
+
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (QByteArray line : lines) {
+        if (line.endsWith('\r'))
+            line.chop(1);
+
+        // Trailing spaces are ignored unless escaped
+        while (line.endsWith(' ') && !line.endsWith("\\ "))
+            line.chop(1);
+
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QString pattern = QString::fromUtf8(line);
+        Rule rule{QRegularExpression(), false, false, false};
+
+        if (pattern.startsWith('!')) {
+            rule.negate = true;
+            pattern.remove(0, 1);
+        }
+
+        if (pattern.endsWith('/')) {
+            rule.dirOnly = true;
+            pattern.chop(1);
+        }
+
+        // Patterns without a slash can match at any level below the .gitignore
+        rule.matchName = !pattern.contains('/');
+
+        if (pattern.startsWith('/'))
+            pattern.remove(0, 1);
+
+        if (pattern.isEmpty())
+            continue;
+
+        rule.re = globToRegularExpression(pattern);
+        ignoreRules->rules.append(rule);
+    }
+
+    if (ignoreRules->rules.isEmpty())
+        return parent;
+
+    return ignoreRules;
+}
+
+bool IgnoreRules::isIgnored(const QString &path, const QString &name, bool isDir) const
+{
+    // The last rule that matches wins, and rules closer to the path take precedence over the parents
+    for (auto it = rules.crbegin(); it != rules.crend(); ++it) {
+        if (it->dirOnly && !isDir)
+            continue;
+
+        const bool matched = it->matchName ? it->re.match(name).hasMatch()
+                                           : it->re.match(path.mid(basePath.size())).hasMatch();
+
+        if (matched)
+            return !it->negate;
+    }
+
+    return parent ? parent->isIgnored(path, name, isDir) : false;
+}
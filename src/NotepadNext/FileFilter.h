@@ -0,0 +1,70 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+
+// Converts a shell style glob to an anchored regular expression. '*' and '?' do not match '/',
+// '**' matches across directories, and [...] character classes are supported.
+QRegularExpression globToRegularExpression(const QString &glob, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+// Name based file filters in the same form as the "Filters" box of the Find in Files tab, e.g.
+// "*.cpp *.h !*.min.js". Patterns starting with '!' exclude matching files and directories.
+class FileFilter
+{
+public:
+    explicit FileFilter(const QString &filters = QString());
+
+    bool acceptsFile(const QString &fileName) const;
+    bool acceptsDirectory(const QString &dirName) const;
+
+private:
+    QVector<QRegularExpression> includes;
+    QVector<QRegularExpression> excludes;
+};
+
+// The rules from the .gitignore files of a directory and all its parents. Each directory shares its
+// parent's rules so walking a tree only needs to parse each .gitignore once.
+class IgnoreRules
+{
+public:
+    // Returns the rules that apply inside of dirPath, which is parent if it has no .gitignore
+    static std::shared_ptr<const IgnoreRules> forDirectory(const std::shared_ptr<const IgnoreRules> &parent, const QString &dirPath);
+
+    bool isIgnored(const QString &path, const QString &name, bool isDir) const;
+
+private:
+    struct Rule
+    {
+        QRegularExpression re;
+        bool negate;
+        bool dirOnly;
+        bool matchName;
+    };
+
+    std::shared_ptr<const IgnoreRules> parent;
+    QString basePath; // ends with a '/'
+    QVector<Rule> rules;
+};
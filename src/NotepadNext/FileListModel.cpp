@@ -0,0 +1,227 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileListModel.h"
+#include "ScintillaNext.h"
+
+#include <QIcon>
+#include <QSet>
+#include <QTimer>
+
+#include <algorithm>
+
+
+static bool nameLessThan(const ScintillaNext *e1, const ScintillaNext *e2)
+{
+    return QString::compare(e1->getName(), e2->getName(), Qt::CaseInsensitive) < 0;
+}
+
+FileListModel::FileListModel(EditorSource source, QObject *parent) :
+    QAbstractListModel(parent),
+    source(source),
+    updateTimer(new QTimer(this))
+{
+    updateTimer->setSingleShot(true);
+    updateTimer->setInterval(0);
+    connect(updateTimer, &QTimer::timeout, this, &FileListModel::update);
+}
+
+void FileListModel::setSortByName(bool sort)
+{
+    if (sortByName != sort) {
+        sortByName = sort;
+        update();
+    }
+}
+
+ScintillaNext *FileListModel::editorAt(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= editors.size()) {
+        return Q_NULLPTR;
+    }
+
+    return editors[index.row()];
+}
+
+QModelIndex FileListModel::indexOf(ScintillaNext *editor) const
+{
+    const int row = editors.indexOf(editor);
+
+    return row >= 0 ? index(row) : QModelIndex();
+}
+
+int FileListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : editors.size();
+}
+
+QVariant FileListModel::data(const QModelIndex &index, int role) const
+{
+    static const QIcon savedIcon(":/icons/saved.png");
+    static const QIcon unsavedIcon(":/icons/unsaved.png");
+
+    const ScintillaNext *editor = editorAt(index);
+
+    if (editor == Q_NULLPTR) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return editor->getName();
+    case Qt::DecorationRole:
+        return editor->canSaveToDisk() ? unsavedIcon : savedIcon;
+    default:
+        return QVariant();
+    }
+}
+
+void FileListModel::scheduleUpdate()
+{
+    updateTimer->start();
+}
+
+void FileListModel::update()
+{
+    updateTimer->stop();
+
+    QVector<ScintillaNext *> wanted = source();
+
+    if (sortByName) {
+        std::stable_sort(wanted.begin(), wanted.end(), nameLessThan);
+    }
+
+    // Walk through the wanted order putting each editor in place, usually only a few rows actually change
+    for (int row = 0; row < wanted.size(); ++row) {
+        ScintillaNext *editor = wanted[row];
+
+        if (row < editors.size() && editors[row] == editor) {
+            continue;
+        }
+
+        const int current = editors.indexOf(editor, row);
+
+        if (current < 0) {
+            insertEditor(row, editor);
+        }
+        else {
+            beginMoveRows(QModelIndex(), current, current, QModelIndex(), row);
+            editors.move(current, row);
+            endMoveRows();
+        }
+    }
+
+    // Whatever is left over isn't open anymore
+    if (editors.size() > wanted.size()) {
+        beginRemoveRows(QModelIndex(), wanted.size(), editors.size() - 1);
+        for (int row = wanted.size(); row < editors.size(); ++row) {
+            disconnect(editors[row], Q_NULLPTR, this, Q_NULLPTR);
+        }
+        editors.resize(wanted.size());
+        endRemoveRows();
+    }
+}
+
+void FileListModel::removeEditor(ScintillaNext *editor)
+{
+    const int row = editors.indexOf(editor);
+
+    if (row >= 0) {
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+
+        beginRemoveRows(QModelIndex(), row, row);
+        editors.remove(row);
+        endRemoveRows();
+    }
+}
+
+void FileListModel::removeEditors(const QVector<ScintillaNext *> &editorsToRemove)
+{
+    const QSet<ScintillaNext *> removing(editorsToRemove.begin(), editorsToRemove.end());
+
+    // From the bottom up so the rows above stay where they are
+    int row = editors.size() - 1;
+
+    while (row >= 0) {
+        if (!removing.contains(editors[row])) {
+            --row;
+            continue;
+        }
+
+        const int last = row;
+        while (row > 0 && removing.contains(editors[row - 1])) {
+            --row;
+        }
+
+        beginRemoveRows(QModelIndex(), row, last);
+        for (int i = row; i <= last; ++i) {
+            disconnect(editors[i], Q_NULLPTR, this, Q_NULLPTR);
+        }
+        editors.remove(row, last - row + 1);
+        endRemoveRows();
+
+        --row;
+    }
+}
+
+void FileListModel::clear()
+{
+    updateTimer->stop();
+
+    beginResetModel();
+    for (ScintillaNext *editor : editors) {
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+    }
+    editors.clear();
+    endResetModel();
+}
+
+void FileListModel::editorChanged()
+{
+    const QModelIndex index = indexOf(qobject_cast<ScintillaNext *>(sender()));
+
+    if (index.isValid()) {
+        emit dataChanged(index, index, {Qt::DecorationRole});
+    }
+}
+
+void FileListModel::editorRenamed()
+{
+    const QModelIndex index = indexOf(qobject_cast<ScintillaNext *>(sender()));
+
+    if (index.isValid()) {
+        emit dataChanged(index, index, {Qt::DisplayRole, Qt::ToolTipRole});
+
+        // The new name might belong somewhere else
+        if (sortByName) {
+            scheduleUpdate();
+        }
+    }
+}
+
+void FileListModel::insertEditor(int row, ScintillaNext *editor)
+{
+    connect(editor, &ScintillaNext::savePointChanged, this, &FileListModel::editorChanged);
+    connect(editor, &ScintillaNext::renamed, this, &FileListModel::editorRenamed);
+
+    beginInsertRows(QModelIndex(), row, row);
+    editors.insert(row, editor);
+    endInsertRows();
+}
@@ -0,0 +1,77 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILELISTMODEL_H
+#define FILELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+
+#include <functional>
+
+class QTimer;
+class ScintillaNext;
+
+// The editors shown in the FileListDock. Changes to which editors there are, and what order they are in, are
+// collected and applied together as the fewest inserts, moves and removals needed, so opening lots of files
+// at once doesn't rebuild the list for each one.
+class FileListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    // Gives the editors in the order they should be shown when not sorted by name
+    typedef std::function<QVector<ScintillaNext *>()> EditorSource;
+
+    FileListModel(EditorSource source, QObject *parent = Q_NULLPTR);
+
+    void setSortByName(bool sort);
+
+    ScintillaNext *editorAt(const QModelIndex &index) const;
+    QModelIndex indexOf(ScintillaNext *editor) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+
+public slots:
+    // Brings the list up to date the next time the event loop runs
+    void scheduleUpdate();
+
+    // Brings the list up to date right away
+    void update();
+
+    void removeEditor(ScintillaNext *editor);
+    // Any that are next to each other in the list are removed together
+    void removeEditors(const QVector<ScintillaNext *> &editorsToRemove);
+    void clear();
+
+private slots:
+    void editorChanged();
+    void editorRenamed();
+
+private:
+    void insertEditor(int row, ScintillaNext *editor);
+
+    EditorSource source;
+    QVector<ScintillaNext *> editors;
+    QTimer *updateTimer;
+    bool sortByName = false;
+};
+
+#endif // FILELISTMODEL_H
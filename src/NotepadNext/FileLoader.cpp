@@ -0,0 +1,163 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileLoader.h"
+#include "Compression.h"
+#include "EncodingDetector.h"
+#include "Logging.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QPointer>
+#include <QSemaphore>
+#include <QTextCodec>
+#include <QThreadPool>
+
+#include <atomic>
+
+
+const qint64 CHUNK_SIZE = 1024 * 1024 * 4;
+
+// How many chunks can be waiting to be processed at any one time
+const int MAX_CHUNKS_AHEAD = 4;
+
+struct FileLoader::SharedState
+{
+    std::atomic_bool canceled{false};
+    QSemaphore chunkSlots{MAX_CHUNKS_AHEAD};
+};
+
+FileLoader::FileLoader(QObject *parent) :
+    QObject(parent),
+    state(std::make_shared<SharedState>())
+{
+}
+
+FileLoader::~FileLoader()
+{
+    // The worker only holds on to the shared state so it is safe to let it wind down on its own
+    cancel();
+}
+
+void FileLoader::start(const QString &filePath)
+{
+    QPointer<FileLoader> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+
+    QThreadPool::globalInstance()->start([=]() {
+        // Everything posted back goes through the application object since this object may be deleted at any point
+        auto post = [=](auto func) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    func(self.data());
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        QFile file(filePath);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(filePath), file.error(), qUtf8Printable(file.errorString()));
+            post([=](FileLoader *l) { emit l->finished(false); });
+            return;
+        }
+
+        const qint64 totalBytes = file.size();
+        qint64 totalRead = 0;
+        QTextCodec *codec = Q_NULLPTR;
+        QTextCodec::ConverterState codecState;
+        bool success = true;
+        bool firstRead = true;
+
+        // A compressed file is decompressed here as it is read, so only its text is ever handed over
+        const QByteArray header = file.peek(6);
+        std::unique_ptr<Compression::Decoder> decoder = Compression::createDecoder(Compression::detect(header.constData(), header.size()));
+        const qint64 readSize = decoder ? Compression::INPUT_CHUNK_SIZE : CHUNK_SIZE;
+
+        while (!file.atEnd()) {
+            sharedState->chunkSlots.acquire();
+
+            if (sharedState->canceled) {
+                success = false;
+                break;
+            }
+
+            QByteArray chunk(static_cast<int>(readSize), Qt::Uninitialized);
+            const qint64 bytesRead = file.read(chunk.data(), readSize);
+
+            if (bytesRead == -1) {
+                qWarning("Something bad happened when reading disk %d %s", file.error(), qUtf8Printable(file.errorString()));
+                success = false;
+                break;
+            }
+
+            chunk.resize(static_cast<int>(bytesRead));
+            totalRead += bytesRead;
+
+            if (decoder) {
+                QByteArray decoded;
+
+                if (!decoder->decode(chunk.constData(), chunk.size(), decoded) || (file.atEnd() && !decoder->finish(decoded))) {
+                    qWarning("\"%s\" is not valid compressed data", qUtf8Printable(filePath));
+                    success = false;
+                    break;
+                }
+
+                chunk = decoded;
+            }
+
+            if (firstRead) {
+                firstRead = false;
+
+                // A compressed file can't be sought through, so only its start is looked at
+                codec = EncodingDetector::detect(chunk.constData(), chunk.size(), decoder ? Q_NULLPTR : &file);
+
+                qCDebug(lcFile, "Using codec: '%s'", codec ? codec->name().constData() : "");
+
+                const bool byteOrderMark = EncodingDetector::codecForBom(chunk.constData(), chunk.size()) != Q_NULLPTR;
+                post([=](FileLoader *l) { emit l->encodingDetected(codec, byteOrderMark); });
+
+                // UTF-8 is handed over as is, only without the BOM
+                if (EncodingDetector::isUtf8Codec(codec)) {
+                    codec = Q_NULLPTR;
+                    chunk.remove(0, static_cast<int>(EncodingDetector::utf8BomLength(chunk.constData(), chunk.size())));
+                }
+            }
+
+            const QByteArray text = codec ? codec->toUnicode(chunk.constData(), chunk.size(), &codecState).toUtf8() : chunk;
+
+            post([=](FileLoader *l) { emit l->chunkLoaded(text, totalRead, totalBytes); });
+        }
+
+        post([=](FileLoader *l) { emit l->finished(success); });
+    });
+}
+
+void FileLoader::chunkProcessed()
+{
+    state->chunkSlots.release();
+}
+
+void FileLoader::cancel()
+{
+    state->canceled = true;
+
+    // Make sure the worker is not left waiting for a chunk to be processed
+    state->chunkSlots.release();
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+
+class QTextCodec;
+
+// Reads a file and converts it to UTF-8 on the global QThreadPool, handing the text back in chunks on
+// the thread that owns this object. The reading only gets a few chunks ahead of the ones that have
+// been processed, so a huge file is never held in memory twice.
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(QObject *parent = nullptr);
+    ~FileLoader() override;
+
+    void start(const QString &filePath);
+
+    // Lets the worker know a chunk from chunkLoaded() has been dealt with so it can read another one
+    void chunkProcessed();
+
+public slots:
+    void cancel();
+
+signals:
+    // Sent once, before the first chunk
+    void encodingDetected(QTextCodec *codec, bool byteOrderMark);
+    void chunkLoaded(const QByteArray &text, qint64 bytesRead, qint64 totalBytes);
+    void finished(bool success);
+
+private:
+    struct SharedState;
+
+    std::shared_ptr<SharedState> state;
+};
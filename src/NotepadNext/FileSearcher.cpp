@@ -0,0 +1,655 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileSearcher.h"
+#include "Compression.h"
+#include "EncodingDetector.h"
+#include "FileFilter.h"
+#include "ISearchResultsHandler.h"
+#include "TrigramIndex.h"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+
+
+// How many hits to collect, or how long to wait, before handing them back to the GUI thread
+const int BATCH_SIZE = 500;
+const int BATCH_INTERVAL_MS = 100;
+
+// Same heuristic as git, a NUL byte near the beginning of the file means it is binary
+const qsizetype BINARY_CHECK_LENGTH = 8000;
+
+const int UTF8_MIB = 106;
+
+// Special values for FileEncodingCache, anything else is the MIB enum of a QTextCodec
+const int ENCODING_UTF8 = -1;
+const int ENCODING_BINARY = -2;
+
+// Every worker of a search stays on its thread, waiting for more directories and files, until the whole tree is done.
+// On the global pool that would hold up everything else queued there for as long as the search runs, e.g. saving a
+// file, so searches get a pool of their own.
+Q_GLOBAL_STATIC(QThreadPool, searchPool)
+
+// If a file's modified time and size have not changed since a previous search then there is no need
+// to work out its encoding again. This is shared by every search.
+class FileEncodingCache
+{
+public:
+    static bool lookup(const QString &path, qint64 lastModified, qint64 size, int &encoding)
+    {
+        QMutexLocker locker(&mutex());
+        const auto it = entries().constFind(path);
+
+        if (it == entries().constEnd() || it->lastModified != lastModified || it->size != size)
+            return false;
+
+        encoding = it->encoding;
+        return true;
+    }
+
+    static void insert(const QString &path, qint64 lastModified, qint64 size, int encoding)
+    {
+        QMutexLocker locker(&mutex());
+
+        // Don't let it grow forever, it just gets rebuilt by the following searches
+        if (entries().size() >= MAX_ENTRIES)
+            entries().clear();
+
+        entries().insert(path, {lastModified, size, encoding});
+    }
+
+private:
+    struct Entry
+    {
+        qint64 lastModified;
+        qint64 size;
+        int encoding;
+    };
+
+    static const int MAX_ENTRIES = 500000;
+
+    static QMutex &mutex() { static QMutex m; return m; }
+    static QHash<QString, Entry> &entries() { static QHash<QString, Entry> e; return e; }
+};
+
+struct WorkItem
+{
+    QString path;
+    bool isDirectory;
+    std::shared_ptr<const IgnoreRules> ignoreRules;
+    qint64 lastModified;
+    qint64 size;
+};
+
+static int detectEncoding(const char *data, qsizetype length)
+{
+    // Most of what gets searched is plain ASCII, which needs no BOM, NUL or UTF-8 checks. It is everything detect()
+    // would look at, and more than the NUL check covers.
+    if (EncodingDetector::isPlainAscii(data, qMin(length, EncodingDetector::SAMPLE_SIZE)))
+        return ENCODING_UTF8;
+
+    // A BOM has to be checked first since UTF-16 and UTF-32 are full of NUL bytes
+    QTextCodec *codec = EncodingDetector::codecForBom(data, length);
+
+    if (codec == Q_NULLPTR) {
+        if (std::memchr(data, 0, qMin<qsizetype>(length, BINARY_CHECK_LENGTH)) != Q_NULLPTR)
+            return ENCODING_BINARY;
+
+        codec = EncodingDetector::detect(data, length);
+    }
+
+    return codec ? codec->mibEnum() : ENCODING_UTF8;
+}
+
+static qsizetype bomLength(const char *data, qsizetype length)
+{
+    if (length >= 4 && (std::memcmp(data, "\xFF\xFE\x00\x00", 4) == 0 || std::memcmp(data, "\x00\x00\xFE\xFF", 4) == 0))
+        return 4;
+    if (length >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        return 3;
+    if (length >= 2 && (std::memcmp(data, "\xFF\xFE", 2) == 0 || std::memcmp(data, "\xFE\xFF", 2) == 0))
+        return 2;
+
+    return 0;
+}
+
+// The new contents go to a temporary file which is swapped in at the end, so the file is never left half written
+static bool writeInEncoding(const QString &filePath, const QByteArray &bom, QTextCodec *codec, const QByteArray &text, QString &error)
+{
+    QByteArray contents = bom;
+    if (codec) {
+        // The original BOM is kept as is, so the codec must not write its own
+        const QString unicode = QString::fromUtf8(text);
+        QTextCodec::ConverterState codecState(QTextCodec::IgnoreHeader);
+        contents.append(codec->fromUnicode(unicode.constData(), unicode.length(), &codecState));
+
+        if (codecState.invalidChars > 0) {
+            error = FileSearcher::tr("The replacement can not be represented in %1").arg(QString::fromLatin1(codec->name()));
+            return false;
+        }
+    }
+    else {
+        contents.append(text);
+    }
+
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly) || out.write(contents) != contents.size() || !out.commit()) {
+        error = out.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+struct FileSearcher::SharedState
+{
+    std::atomic_bool canceled{false};
+
+    QMutex mutex;
+    QWaitCondition workAvailable;
+
+    // Every worker takes from and adds to the same queue, so whichever one is free picks up the next
+    // directory or file no matter who found it
+    std::deque<WorkItem> queue;
+    int pendingItems = 0; // queued plus the ones being worked on
+    int activeWorkers = 0;
+
+    std::atomic_int totalHits{0};
+    std::atomic_int filesSearched{0};
+};
+
+FileSearcher::FileSearcher(QObject *parent) :
+    QObject(parent),
+    state(std::make_shared<SharedState>())
+{
+}
+
+FileSearcher::~FileSearcher()
+{
+    // The workers only hold on to the shared state so it is safe to let them wind down on their own
+    cancel();
+}
+
+bool FileSearcher::readSearchableText(const QString &filePath, QByteArray &text, bool &binary)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QFileInfo info(file);
+    const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+    text = file.readAll();
+
+    const Compression::Format compression = Compression::detect(text.constData(), text.size());
+    if (compression != Compression::Format::None) {
+        QByteArray decompressed;
+
+        if (!Compression::decompress(compression, text.constData(), text.size(), decompressed))
+            return false;
+
+        text = decompressed;
+    }
+
+    int encoding;
+    if (!FileEncodingCache::lookup(filePath, lastModified, info.size(), encoding)) {
+        encoding = detectEncoding(text.constData(), text.size());
+        FileEncodingCache::insert(filePath, lastModified, info.size(), encoding);
+    }
+
+    binary = encoding == ENCODING_BINARY;
+
+    if (encoding == UTF8_MIB) {
+        if (text.startsWith("\xEF\xBB\xBF"))
+            text.remove(0, 3);
+    }
+    else if (encoding >= 0) {
+        if (QTextCodec *codec = QTextCodec::codecForMib(encoding)) {
+            const qsizetype bom = bomLength(text.constData(), text.size());
+            text = codec->toUnicode(text.constData() + bom, static_cast<int>(text.size() - bom)).toUtf8();
+        }
+    }
+
+    return true;
+}
+
+bool FileSearcher::replaceInFile(const QString &filePath, qint64 lastModified, qint64 size, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements, QString &error)
+{
+    Q_ASSERT(replacements.size() == 1 || static_cast<size_t>(replacements.size()) == ranges.size());
+
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    // The ranges are only good for the text they were found in
+    const QFileInfo info(file);
+    if (info.lastModified().toMSecsSinceEpoch() != lastModified || info.size() != size) {
+        error = tr("The file has changed since the replacements were previewed");
+        return false;
+    }
+
+    QByteArray text = file.readAll();
+    file.close();
+
+    int encoding;
+    if (!FileEncodingCache::lookup(filePath, lastModified, size, encoding)) {
+        encoding = detectEncoding(text.constData(), text.size());
+        FileEncodingCache::insert(filePath, lastModified, size, encoding);
+    }
+
+    if (encoding == ENCODING_BINARY || Compression::detect(text.constData(), text.size()) != Compression::Format::None) {
+        error = tr("Binary and compressed files are never replaced in");
+        return false;
+    }
+
+    // Same conversion as the search did, so the ranges line up with the text
+    QByteArray bom;
+    QTextCodec *codec = Q_NULLPTR;
+    if (encoding == UTF8_MIB) {
+        if (text.startsWith("\xEF\xBB\xBF")) {
+            bom = text.left(3);
+            text.remove(0, 3);
+        }
+    }
+    else if (encoding >= 0) {
+        codec = QTextCodec::codecForMib(encoding);
+
+        if (codec) {
+            bom = text.left(static_cast<int>(bomLength(text.constData(), text.size())));
+            text = codec->toUnicode(text.constData() + bom.size(), static_cast<int>(text.size() - bom.size())).toUtf8();
+        }
+    }
+
+    QByteArray newText;
+    qsizetype pos = 0;
+
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges[i].cpMin < pos || ranges[i].cpMax > text.size()) {
+            error = tr("The file has changed since the replacements were previewed");
+            return false;
+        }
+
+        newText.append(text.constData() + pos, static_cast<int>(ranges[i].cpMin - pos));
+        newText.append(replacements.size() == 1 ? replacements.first() : replacements.at(static_cast<int>(i)));
+        pos = ranges[i].cpMax;
+    }
+    newText.append(text.constData() + pos, static_cast<int>(text.size() - pos));
+
+    return writeInEncoding(filePath, bom, codec, newText, error);
+}
+
+bool FileSearcher::canSearch(const QByteArray &pattern, int flags)
+{
+    QByteArray searchPattern = pattern;
+    makeSearchable(searchPattern, flags);
+
+    return BufferSearcher(searchPattern, flags).isValid();
+}
+
+void FileSearcher::makeSearchable(QByteArray &pattern, int &flags)
+{
+    if (BufferSearcher(pattern, flags).canSearch())
+        return;
+
+    // Case insensitive non-ASCII literals can't be folded on raw bytes so search for them as an escaped
+    // regular expression instead, which handles the folding itself
+    QString expression = QRegularExpression::escape(QString::fromUtf8(pattern));
+
+    if (flags & SCFIND_WHOLEWORD)
+        expression = QStringLiteral("\\b%1\\b").arg(expression);
+    else if (flags & SCFIND_WORDSTART)
+        expression = QStringLiteral("\\b%1").arg(expression);
+
+    pattern = expression.toUtf8();
+    flags = (flags & ~(SCFIND_WHOLEWORD | SCFIND_WORDSTART)) | SCFIND_REGEXP;
+}
+
+void FileSearcher::start(const Options &options, const QByteArray &searchPattern, int searchFlags)
+{
+    Q_ASSERT(!running);
+
+    running = true;
+
+    QByteArray pattern = searchPattern;
+    int flags = searchFlags;
+    makeSearchable(pattern, flags);
+
+    const int workerCount = qMax(1, QThread::idealThreadCount());
+    const FileFilter filter(options.filters);
+    const std::shared_ptr<const TrigramFilter> trigramFilter = options.trigramIndex ? options.trigramIndex->prepare(pattern, flags) : std::shared_ptr<const TrigramFilter>();
+    QPointer<FileSearcher> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+
+    sharedState->queue.push_back({options.directory, true, std::shared_ptr<const IgnoreRules>(), 0, 0});
+    sharedState->pendingItems = 1;
+    sharedState->activeWorkers = workerCount;
+
+    for (int i = 0; i < workerCount; ++i) {
+        searchPool()->start([=]() {
+            // Everything posted back goes through the application object since this object may be deleted at any point
+            auto post = [=](auto func) {
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                    if (self) {
+                        func(self.data());
+                    }
+                }, Qt::QueuedConnection);
+            };
+
+            BufferSearcher searcher(pattern, flags);
+            searcher.setRegexChunking(BufferSearcher::DEFAULT_REGEX_CHUNK_SIZE, options.regexOverlap);
+            searcher.setCancelFlag(&sharedState->canceled);
+
+            QVector<QPair<QString, QVector<SearchHit>>> results;
+            int resultsHitCount = 0;
+            QElapsedTimer batchTimer;
+            batchTimer.start();
+
+            auto flush = [&]() {
+                const int filesSearched = sharedState->filesSearched;
+
+                if (!results.isEmpty()) {
+                    post([=](FileSearcher *s) {
+                        for (const auto &result : results) {
+                            emit s->resultsFound(result.first, result.second);
+                        }
+                    });
+
+                    results.clear();
+                    resultsHitCount = 0;
+                }
+
+                post([=](FileSearcher *s) { emit s->progressChanged(filesSearched); });
+                batchTimer.restart();
+            };
+
+            auto addWork = [&](WorkItem &&item) {
+                QMutexLocker locker(&sharedState->mutex);
+
+                sharedState->queue.push_back(std::move(item));
+                sharedState->pendingItems++;
+                sharedState->workAvailable.wakeOne();
+            };
+
+            auto searchDirectory = [&](const WorkItem &item) {
+                std::shared_ptr<const IgnoreRules> ignoreRules = item.ignoreRules;
+
+                if (options.respectGitIgnore)
+                    ignoreRules = IgnoreRules::forDirectory(ignoreRules, item.path);
+
+                QDir::Filters dirFilters = QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot;
+                if (options.includeHidden)
+                    dirFilters |= QDir::Hidden;
+
+                QDirIterator it(item.path, dirFilters);
+                while (it.hasNext() && !sharedState->canceled) {
+                    const QString path = it.next();
+                    const QFileInfo info = it.fileInfo();
+                    const QString name = info.fileName();
+                    const bool isDir = info.isDir();
+
+                    if (isDir) {
+                        // Don't follow links to directories, they can easily be cycles
+                        if (!options.recursive || info.isSymLink() || !filter.acceptsDirectory(name))
+                            continue;
+
+                        if (options.respectGitIgnore && name == QStringLiteral(".git"))
+                            continue;
+                    }
+                    else if (!filter.acceptsFile(name)) {
+                        continue;
+                    }
+
+                    if (ignoreRules && ignoreRules->isIgnored(path, name, isDir))
+                        continue;
+
+                    // Skip reading files the index knows can't have a match
+                    if (!isDir && trigramFilter && !trigramFilter->mayContain(path, info.lastModified().toMSecsSinceEpoch(), info.size()))
+                        continue;
+
+                    addWork({path, isDir, ignoreRules, isDir ? 0 : info.lastModified().toMSecsSinceEpoch(), isDir ? 0 : info.size()});
+                }
+            };
+
+            // Writes out the replaced text in the file's original encoding, unless it is only being previewed
+            auto replaceInFile = [&](const WorkItem &item, QFile &file, const char *data, qsizetype length, const QByteArray &bom, QTextCodec *codec) {
+                QByteArray newText;
+                qsizetype pos = 0;
+                int replacements = 0;
+
+                ReplacePreview preview;
+                const bool sameForEveryMatch = !(flags & SCFIND_REGEXP);
+                if (options.preview && sameForEveryMatch)
+                    preview.replacements.append(options.replacement);
+
+                searcher.forEachReplacement(data, length, options.replacement, [&](qsizetype start, qsizetype end, const QByteArray &text) {
+                    if (options.preview) {
+                        preview.ranges.push_back({static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(end)});
+
+                        if (!sameForEveryMatch)
+                            preview.replacements.append(text);
+                    }
+                    else {
+                        newText.append(data + pos, static_cast<int>(start - pos));
+                        newText.append(text);
+                        pos = end;
+                    }
+                    ++replacements;
+
+                    return !sharedState->canceled;
+                });
+
+                if (replacements == 0 || sharedState->canceled)
+                    return;
+
+                if (options.preview) {
+                    preview.lastModified = item.lastModified;
+                    preview.size = item.size;
+                    preview.makeHunks(data, length);
+
+                    sharedState->totalHits += replacements;
+                    post([=](FileSearcher *s) { emit s->replacementsPreviewed(item.path, preview); });
+                    return;
+                }
+
+                newText.append(data + pos, static_cast<int>(length - pos));
+
+                // Let go of the original file first, it can't be replaced while it is mapped on some platforms
+                file.close();
+
+                QString error;
+                if (!writeInEncoding(item.path, bom, codec, newText, error)) {
+                    post([=](FileSearcher *s) { emit s->replaceFailed(item.path, error); });
+                    return;
+                }
+
+                sharedState->totalHits += replacements;
+                post([=](FileSearcher *s) { emit s->fileReplaced(item.path, replacements); });
+            };
+
+            auto searchFile = [&](const WorkItem &item) {
+                if (options.replace && options.excludedFiles.contains(item.path)) {
+                    post([=](FileSearcher *s) { emit s->replaceSkipped(item.path); });
+                    return;
+                }
+
+                QFile file(item.path);
+
+                if (!file.open(QIODevice::ReadOnly))
+                    return;
+
+                const qint64 size = file.size();
+                if (size == 0)
+                    return;
+
+                // Map the file if possible so it is never copied, else fall back to reading it
+                QByteArray buffer;
+                const char *data = reinterpret_cast<const char *>(file.map(0, size));
+                qsizetype length = size;
+
+                if (data == Q_NULLPTR) {
+                    buffer = file.readAll();
+                    data = buffer.constData();
+                    length = buffer.size();
+                }
+
+                // Compressed files are searched by what is in them, but a replace never rewrites one
+                QByteArray decompressed;
+                const Compression::Format compression = Compression::detect(data, length);
+
+                if (compression != Compression::Format::None) {
+                    if (options.replace) {
+                        post([=](FileSearcher *s) { emit s->replaceSkipped(item.path); });
+                        return;
+                    }
+
+                    if (!Compression::decompress(compression, data, length, decompressed))
+                        return;
+
+                    data = decompressed.constData();
+                    length = decompressed.size();
+                }
+
+                sharedState->filesSearched++;
+
+                int encoding;
+                if (!FileEncodingCache::lookup(item.path, item.lastModified, item.size, encoding)) {
+                    encoding = detectEncoding(data, length);
+                    FileEncodingCache::insert(item.path, item.lastModified, item.size, encoding);
+                }
+
+                if (encoding == ENCODING_BINARY && (options.skipBinaryFiles || options.replace))
+                    return;
+
+                // Search the same UTF-8 text the editor would end up with if the file was opened
+                QByteArray converted;
+                QByteArray bom;
+                QTextCodec *codec = Q_NULLPTR;
+                if (encoding == UTF8_MIB) {
+                    // Only the BOM needs dropped, which the editor does not keep
+                    if (length >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+                        bom = QByteArray(data, 3);
+                        data += 3;
+                        length -= 3;
+                    }
+                }
+                else if (encoding >= 0) {
+                    codec = QTextCodec::codecForMib(encoding);
+
+                    if (codec) {
+                        bom = QByteArray(data, static_cast<int>(bomLength(data, length)));
+                        converted = codec->toUnicode(data + bom.size(), static_cast<int>(length - bom.size())).toUtf8();
+                        data = converted.constData();
+                        length = converted.size();
+                    }
+                }
+
+                if (options.replace) {
+                    replaceInFile(item, file, data, length, bom, codec);
+                    return;
+                }
+
+                QVector<SearchHit> hits;
+
+                // There will be no editor to get the text from later, so keep just enough of each line to show it
+                searcher.forEachHit(data, length, [&](const SearchHit &hit, qsizetype) {
+                    hits.append(hit);
+                    return !sharedState->canceled;
+                }, ISearchResultsHandler::LINE_TEXT_CONTEXT);
+
+                if (!hits.isEmpty()) {
+                    sharedState->totalHits += hits.size();
+                    resultsHitCount += hits.size();
+                    results.append(qMakePair(item.path, hits));
+                }
+            };
+
+            forever {
+                WorkItem item;
+
+                {
+                    QMutexLocker locker(&sharedState->mutex);
+
+                    while (sharedState->queue.empty() && sharedState->pendingItems > 0 && !sharedState->canceled)
+                        sharedState->workAvailable.wait(&sharedState->mutex);
+
+                    if (sharedState->queue.empty() || sharedState->canceled)
+                        break;
+
+                    item = std::move(sharedState->queue.front());
+                    sharedState->queue.pop_front();
+                }
+
+                if (item.isDirectory)
+                    searchDirectory(item);
+                else
+                    searchFile(item);
+
+                if (resultsHitCount >= BATCH_SIZE || batchTimer.elapsed() >= BATCH_INTERVAL_MS)
+                    flush();
+
+                QMutexLocker locker(&sharedState->mutex);
+                if (--sharedState->pendingItems == 0)
+                    sharedState->workAvailable.wakeAll();
+            }
+
+            flush();
+
+            QMutexLocker locker(&sharedState->mutex);
+            sharedState->workAvailable.wakeAll();
+
+            // The last worker out reports the totals
+            if (--sharedState->activeWorkers == 0) {
+                const int totalHits = sharedState->totalHits;
+                const int filesSearched = sharedState->filesSearched;
+                const bool canceled = sharedState->canceled;
+
+                post([=](FileSearcher *s) {
+                    s->running = false;
+                    emit s->finished(totalHits, filesSearched, canceled);
+                });
+            }
+        });
+    }
+}
+
+void FileSearcher::cancel()
+{
+    state->canceled = true;
+
+    QMutexLocker locker(&state->mutex);
+    state->workAvailable.wakeAll();
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+#include <memory>
+
+#include "BufferSearcher.h"
+#include "ReplacePreview.h"
+
+class TrigramSnapshot;
+
+
+// Searches every file below a directory straight from disk, without creating an editor for them.
+// The directories and files are shared out between several workers on a QThreadPool kept for searches
+// and results are delivered in batches on the thread that owns this object.
+class FileSearcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        QString directory;
+        QString filters; // see FileFilter
+        bool recursive = true;
+        bool includeHidden = false;
+        bool respectGitIgnore = true;
+        bool skipBinaryFiles = true;
+
+        // How far a regular expression match can go on past the end of one chunk of a file into the next,
+        // see BufferSearcher::setRegexChunking()
+        qsizetype regexOverlap = BufferSearcher::DEFAULT_REGEX_OVERLAP;
+
+        // Rewrites each file with every match replaced, binary files are never touched. Excluded files are
+        // reported with replaceSkipped() instead, e.g. ones that are already open in an editor.
+        bool replace = false;
+        QByteArray replacement;
+        QSet<QString> excludedFiles;
+
+        // Nothing is written, each file's replacements are reported with replacementsPreviewed() instead
+        bool preview = false;
+
+        // Optional, lets files that can not match be skipped without reading them
+        std::shared_ptr<const TrigramSnapshot> trigramIndex;
+    };
+
+    explicit FileSearcher(QObject *parent = nullptr);
+    ~FileSearcher() override;
+
+    // The text a search looks at for a file, the same UTF-8 an editor would have if it was opened or the
+    // bytes as they are for binary files. Returns false if the file can't be read.
+    static bool readSearchableText(const QString &filePath, QByteArray &text, bool &binary);
+
+    // Unlike BackgroundSearcher there is no editor to fall back on, so this is only false for invalid patterns
+    static bool canSearch(const QByteArray &pattern, int flags);
+
+    // Applies replacements that were previewed to a file, as long as it is still the same size and age it was
+    static bool replaceInFile(const QString &filePath, qint64 lastModified, qint64 size, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements, QString &error);
+
+    void start(const Options &options, const QByteArray &searchPattern, int searchFlags);
+    bool isRunning() const { return running; }
+
+public slots:
+    void cancel();
+
+signals:
+    void resultsFound(const QString &filePath, const QVector<SearchHit> &hits);
+    void progressChanged(int filesSearched);
+    void finished(int totalHits, int filesSearched, bool canceled);
+
+    void fileReplaced(const QString &filePath, int replacements);
+    void replaceSkipped(const QString &filePath);
+    void replaceFailed(const QString &filePath, const QString &error);
+    void replacementsPreviewed(const QString &filePath, const ReplacePreview &preview);
+
+private:
+    struct SharedState;
+
+    static void makeSearchable(QByteArray &pattern, int &flags);
+
+    std::shared_ptr<SharedState> state;
+    bool running = false;
+};
@@ -18,7 +18,8 @@
 
 
 #include "Finder.h"
-#include "UndoAction.h"
+#include "BulkEdit.h"
+#include "RegexEngine.h"
 
 Finder::Finder(ScintillaNext *edit) :
     editor(edit)
@@ -107,17 +108,17 @@ Sci_CharacterRange Finder::findPrev()
 // Count all occurrences in the document
 int Finder::count()
 {
-    int total = 0;
+    return static_cast<int>(findAll().size());
+}
 
-    if (text.length() > 0) {
-        forEachMatch([&](int start, int end) {
-            Q_UNUSED(start);
-            total++;
-            return end;
-        });
-    }
+std::vector<Sci_CharacterRange> Finder::findAll()
+{
+    if (text.isEmpty())
+        return {};
 
-    return total;
+    editor->setSearchFlags(search_flags);
+
+    return editor->findAllMatches(text.toUtf8(), search_flags);
 }
 
 Sci_CharacterRange Finder::replaceSelectionIfMatch(const QString &replaceText)
@@ -159,24 +160,49 @@ int Finder::replaceAll(const QString &replaceText)
     // Don't technically need to set the search flags here but do it just in case something looks at the search flags later
     editor->setSearchFlags(search_flags);
 
-    // NOTE: can't use editor->forEachMatch() here since the search range can grow since the document is changing
+    if (!isRegex) {
+        // Every match is known up front so the document can be changed in one go instead of searching after each replacement
+        const std::vector<Sci_CharacterRange> matches = editor->findAllMatches(b, search_flags);
+
+        const BulkEdit be(editor);
+        editor->replaceRanges(matches, replaceData);
+
+        return static_cast<int>(matches.size());
+    }
+
+    // Each match and what it gets replaced with are worked out against the document as it is, then it is changed in
+    // one go. That leaves the undo history with one change for the whole span rather than one for every match.
+    std::vector<Sci_CharacterRange> matches;
+    QVector<QByteArray> replacements;
+    const sptr_t document = editor->docPointer();
 
-    const UndoAction ua(editor);
     while (editor->send(SCI_FINDTEXT, search_flags, reinterpret_cast<sptr_t>(&ttf)) != -1) {
-        const int start = ttf.chrgText.cpMin;
-        const int end = ttf.chrgText.cpMax;
+        const Sci_PositionCR start = ttf.chrgText.cpMin;
+        const Sci_PositionCR end = ttf.chrgText.cpMax;
 
-        editor->setTargetRange(start, end);
+        matches.push_back({start, end});
 
-        if (isRegex)
-            ttf.chrg.cpMin = start + editor->replaceTargetRE(replaceData.length(), replaceData.constData());
-        else
-            ttf.chrg.cpMin = start + editor->replaceTarget(replaceData.length(), replaceData.constData());
+        // Matches often get replaced with the same thing, which can then all share the one copy
+        const QByteArray replacement = RegexEngine::substitute(document, replaceData);
+        replacements.append(!replacements.isEmpty() && replacements.last() == replacement ? replacements.last() : replacement);
+
+        // An empty match would be found again in the same spot
+        if (end > start) {
+            ttf.chrg.cpMin = end;
+        }
+        else if (end < ttf.chrg.cpMax) {
+            ttf.chrg.cpMin = static_cast<Sci_PositionCR>(editor->positionAfter(end));
+        }
+        else {
+            break;
+        }
+    }
 
-        // The replace could have changed the document size, so update the end of the search range
-        ttf.chrg.cpMax = editor->length();
+    total = static_cast<int>(matches.size());
 
-        total++;
+    if (total > 0) {
+        const BulkEdit be(editor);
+        editor->replaceRanges(matches, replacements);
     }
 
     return total;
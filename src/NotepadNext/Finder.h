@@ -32,9 +32,13 @@ public:
     void setWrap(bool wrap);
     void setSearchText(const QString &text);
 
+    int searchFlags() const { return search_flags; }
+    QString searchText() const { return text; }
+
     Sci_CharacterRange findNext(int startPos = INVALID_POSITION);
     Sci_CharacterRange findPrev();
     int count();
+    std::vector<Sci_CharacterRange> findAll();
 
     bool didLatestSearchWrapAround() const { return did_latest_search_wrap; }
 
@@ -0,0 +1,74 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "HexViewerDelegate.h"
+#include "EditorHexViewerTableModel.h"
+
+#include <QApplication>
+#include <QPainter>
+
+
+HexViewerDelegate::HexViewerDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void HexViewerDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem opt = option;
+    opt.state &= ~QStyle::State_HasFocus;
+
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+
+    // Just the background and selection, the text is drawn below
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter, widget);
+
+    QString text;
+    Qt::Alignment alignment;
+
+    if (index.column() == 16) {
+        const QByteArray bytes = index.data(EditorHexViewerTableModel::RowBytesRole).toByteArray();
+
+        text.reserve(bytes.size());
+        for (char ch : bytes) {
+            QChar c = QChar(static_cast<uchar>(ch));
+            text += c.isPrint() ? c : '.';
+        }
+
+        alignment = Qt::AlignLeft | Qt::AlignVCenter;
+    }
+    else {
+        const QVariant byte = index.data(EditorHexViewerTableModel::ByteRole);
+        if (!byte.isValid())
+            return;
+
+        text = EditorHexViewerTableModel::hexString(static_cast<unsigned char>(byte.toInt()));
+        alignment = Qt::AlignCenter;
+    }
+
+    const QPalette::ColorGroup group = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+    const QPalette::ColorRole role = (option.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text;
+
+    painter->save();
+    painter->setFont(option.font);
+    painter->setPen(option.palette.color(group, role));
+    painter->drawText(option.rect.adjusted(2, 0, -2, 0), alignment, text);
+    painter->restore();
+}
@@ -19,7 +19,6 @@
 
 #include "HtmlConverter.h"
 
-#include <QSet>
 #include <QTextStream>
 
 
@@ -52,66 +51,50 @@ static void StyleToCss(QTextStream &stream, ScintillaNext *editor, int style)
     stream << "}" << Qt::endl;
 }
 
-static void AddCharEscaped(QTextStream &stream, int ch)
+// Appends the bytes with anything special to html replaced. The spans in between are appended as they are rather
+// than a byte at a time, and found with Converter::findAnyOf(). A \r that is part of a \r\n is dropped, following is
+// the byte after the last one.
+static void AppendEscaped(QByteArray &out, const char *text, int length, char following)
 {
-    switch (ch) {
-    case '<':
-        stream << QByteArrayLiteral("&lt;");
-        break;
-    case '>':
-        stream << QByteArrayLiteral("&gt;");
-        break;
-    case '&':
-        stream << QByteArrayLiteral("&amp;");
-        break;
-    default:
-        stream << static_cast<char>(ch);
-    }
-}
-
-void HtmlConverter::convertRange(QTextStream &stream, int start, int end)
-{
-    ensureDocumentStyled(start, end);
-
-    // Create the raw html and keep track of the used styles
-    QByteArray html;
-    QTextStream html_stream(&html);
-    QSet<int> usedStyles;
-    int currentStyle = -1;
-
-    for (int i = start; i < end; ++i) {
-        int style = editor->styleAt(i);
-
-        if (style != currentStyle) {
-            currentStyle = style;
-            usedStyles.insert(currentStyle);
-
-            html_stream << "</span><span class=\"s" << currentStyle << "\">";
+    static const char SPECIAL[] = "<>&\r";
+    int spanStart = 0;
+
+    for (int i = Converter::findAnyOf(text, 0, length, SPECIAL); i < length; i = Converter::findAnyOf(text, i + 1, length, SPECIAL)) {
+        const char *replacement;
+
+        switch (text[i]) {
+        case '<':
+            replacement = "&lt;";
+            break;
+        case '>':
+            replacement = "&gt;";
+            break;
+        case '&':
+            replacement = "&amp;";
+            break;
+        case '\r':
+            if (((i + 1 < length) ? text[i + 1] : following) != '\n')
+                continue;
+            replacement = "";
+            break;
+        default:
+            continue;
         }
 
-        const int ch = editor->charAt(i);
-        if (ch == '\r'){
-            if (editor->charAt(i + 1) != '\n') {
-                AddCharEscaped(html_stream, ch);
-            }
-        }
-        else {
-            AddCharEscaped(html_stream, ch);
-        }
+        out.append(text + spanStart, i - spanStart);
+        out.append(replacement);
+        spanStart = i + 1;
     }
-    html_stream.flush();
 
+    out.append(text + spanStart, length - spanStart);
+}
 
-    // Generate the CSS for just the styles that were used
-    QByteArray css;
-    QTextStream css_stream(&css);
-    for (const int style : usedStyles) {
-        StyleToCss(css_stream, editor, style);
-    }
-    css_stream.flush();
+void HtmlConverter::writeHeader(QByteArray &out, const QVector<int> &usedStyles)
+{
+    currentStyle = -1;
 
+    QTextStream stream(&out);
 
-    // Generate the entire document
     stream << "<!DOCTYPE html PUBLIC \"-//W3C//DTD HTML 4.01//EN\" \"http://www.w3.org/TR/1999/REC-html401-19991224/strict.dtd\">" << Qt::endl;
     stream << "<html>" << Qt::endl;
     stream << "<head>" << Qt::endl;
@@ -123,15 +106,46 @@ void HtmlConverter::convertRange(QTextStream &stream, int start, int end)
     stream << "  white-space: pre;" << Qt::endl;
     stream << "  line-height: 1;" << Qt::endl;
     stream << "}" << Qt::endl;
-    stream << css;
+
+    // Generate the CSS for just the styles that were used
+    for (const int style : usedStyles) {
+        StyleToCss(stream, editor, style);
+    }
+
     stream << "</style>" << Qt::endl;
     stream << "</head>" << Qt::endl;
     stream << "<body>" << Qt::endl;
     stream << "<div class=\"main\">";
-    stream << html;
-    stream << "</div>" << Qt::endl;
-    stream << "</body>" << Qt::endl;
-    stream << "<!--EndFragment-->" << Qt::endl;
-    stream << "</html>" << Qt::endl;
     stream.flush();
 }
+
+void HtmlConverter::writeBody(QByteArray &out, const QByteArray &text, const QByteArray &styles, char following)
+{
+    out.reserve(out.size() + text.size() + text.size() / 8 + 64);
+
+    for (int i = 0; i < text.size();) {
+        const int runEnd = styleRunEnd(styles, i);
+        const int style = static_cast<unsigned char>(styles.at(i));
+
+        // A run can carry on from the last chunk
+        if (style != currentStyle) {
+            currentStyle = style;
+
+            out.append("</span><span class=\"s");
+            out.append(QByteArray::number(style));
+            out.append("\">");
+        }
+
+        AppendEscaped(out, text.constData() + i, runEnd - i, runEnd < text.size() ? text.at(runEnd) : following);
+
+        i = runEnd;
+    }
+}
+
+void HtmlConverter::writeFooter(QByteArray &out)
+{
+    out.append("</div>\n");
+    out.append("</body>\n");
+    out.append("<!--EndFragment-->\n");
+    out.append("</html>\n");
+}
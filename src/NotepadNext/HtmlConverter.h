@@ -25,7 +25,12 @@ class HtmlConverter : public Converter
 {
     using Converter::Converter;
 
-public:
-    void convertRange(QTextStream &stream, int start, int end) override;
+protected:
+    void writeHeader(QByteArray &out, const QVector<int> &usedStyles) override;
+    void writeBody(QByteArray &out, const QByteArray &text, const QByteArray &styles, char following) override;
+    void writeFooter(QByteArray &out) override;
+
+private:
+    int currentStyle = -1;
 };
 
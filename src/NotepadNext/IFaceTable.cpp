@@ -37,6 +37,83 @@ typename std::iterator_traits<Iter>::value_type const *binary_find(Iter begin, I
     }
 }
 
+static std::string ConstantNameOfFunction(const char *prefix, const char *name) {
+    std::string s = std::string(prefix) + name;
+    std::transform(s.begin(), s.end(), s.begin(), ::toupper);
+    return s;
+}
+
+void IFaceTable::BuildIndexes() {
+    int lowest = 0;
+    int highest = -1;
+
+    auto include = [&](int message) {
+        if (message <= 0)
+            return;
+
+        if (highest < lowest) {
+            lowest = highest = message;
+        }
+        else {
+            lowest = std::min(lowest, message);
+            highest = std::max(highest, message);
+        }
+    };
+
+    for (const auto &func : functions) {
+        include(func.value);
+    }
+    for (const auto &prop : properties) {
+        include(prop.getter);
+        include(prop.setter);
+    }
+
+    messageBase = lowest;
+    functionsByMessage.assign(highest >= lowest ? highest - lowest + 1 : 0, nullptr);
+    propertiesByMessage.assign(functionsByMessage.size(), nullptr);
+
+    // The first one wins, the same as searching from the start did
+    for (const auto &func : functions) {
+        if (func.value > 0 && functionsByMessage[func.value - messageBase] == nullptr) {
+            functionsByMessage[func.value - messageBase] = &func;
+        }
+
+        functionsByConstantName.emplace(ConstantNameOfFunction(prefix, func.name), &func);
+    }
+
+    for (const auto &prop : properties) {
+        for (int message : {prop.getter, prop.setter}) {
+            if (message > 0 && propertiesByMessage[message - messageBase] == nullptr) {
+                propertiesByMessage[message - messageBase] = &prop;
+            }
+        }
+    }
+
+    for (const auto &con : constants) {
+        constantsByValue[con.value].push_back(&con);
+    }
+}
+
+const IFaceFunction *IFaceTable::FunctionAt(int message) const {
+    const int index = message - messageBase;
+
+    if (index < 0 || index >= static_cast<int>(functionsByMessage.size())) {
+        return nullptr;
+    }
+
+    return functionsByMessage[index];
+}
+
+const IFaceProperty *IFaceTable::PropertyAt(int message) const {
+    const int index = message - messageBase;
+
+    if (index < 0 || index >= static_cast<int>(propertiesByMessage.size())) {
+        return nullptr;
+    }
+
+    return propertiesByMessage[index];
+}
+
 const IFaceConstant *IFaceTable::FindConstant(const char *name) const {
     return binary_find(constants.cbegin(), constants.cend(), name);
 }
@@ -47,31 +124,19 @@ const IFaceFunction *IFaceTable::FindFunction(const char *name) const {
 
 const IFaceFunction *IFaceTable::FindFunctionByConstantName(const char *name) const {
     if (strncmp(name, prefix, strlen(prefix)) == 0) {
-        // This looks like a constant for an iface function.  This requires
-        // a sequential search.  Take special care since the function names
+        // This looks like a constant for an iface function. The function names
         // are mixed case, whereas the constants are all-caps.
+        const auto it = functionsByConstantName.find(name);
 
-        for (const auto &func : functions) {
-            const char *nm = name + strlen(prefix);
-            const char *fn = func.name;
-            while (*nm && *fn && (*nm == toupper(*fn))) {
-                ++nm;
-                ++fn;
-            }
-            if (!*nm && !*fn) {
-                return &func;
-            }
+        if (it != functionsByConstantName.end()) {
+            return it->second;
         }
     }
     return nullptr;
 }
 
 const IFaceFunction *IFaceTable::FindFunctionByValue(int value) const {
-    for (const auto &func : functions) {
-        if (func.value == value)
-            return &func;
-    }
-    return nullptr;
+    return FunctionAt(value);
 }
 
 const IFaceProperty *IFaceTable::FindProperty(const char *name) const {
@@ -84,30 +149,33 @@ int IFaceTable::GetConstantName(int value, char *nameOut, unsigned nameBufferLen
     }
 
     // Look in both the constants table and the functions table.  Start with functions.
-    for (const auto &func : functions) {
-        if (func.value == value) {
-            int len = static_cast<int>(strlen(func.name) + strlen(prefix));
-            if (nameOut && (static_cast<int>(nameBufferLen) > len)) {
-                strcpy(nameOut, prefix);
-                strcat(nameOut, func.name);
-                // fix case
-                for (char *nm = nameOut + strlen(prefix); *nm; ++nm) {
-                    if (*nm >= 'a' && *nm <= 'z') {
-                        *nm = static_cast<char>(*nm - 'a' + 'A');
-                    }
+    if (const IFaceFunction *func = FunctionAt(value)) {
+        int len = static_cast<int>(strlen(func->name) + strlen(prefix));
+        if (nameOut && (static_cast<int>(nameBufferLen) > len)) {
+            strcpy(nameOut, prefix);
+            strcat(nameOut, func->name);
+            // fix case
+            for (char *nm = nameOut + strlen(prefix); *nm; ++nm) {
+                if (*nm >= 'a' && *nm <= 'z') {
+                    *nm = static_cast<char>(*nm - 'a' + 'A');
                 }
-                return len;
-            } else {
-                return -1 - len;
             }
+            return len;
+        } else {
+            return -1 - len;
         }
     }
 
-    for (const auto &con : constants) {
-        if (con.value == value && (hint == NULL || strncmp(hint, con.name, strlen(hint)) == 0)) {
-            int len = static_cast<int>(strlen(con.name));
+    const auto it = constantsByValue.find(value);
+    if (it == constantsByValue.end()) {
+        return 0;
+    }
+
+    for (const IFaceConstant *con : it->second) {
+        if (hint == NULL || strncmp(hint, con->name, strlen(hint)) == 0) {
+            int len = static_cast<int>(strlen(con->name));
             if (nameOut && (static_cast<int>(nameBufferLen) > len)) {
-                strcpy(nameOut, con.name);
+                strcpy(nameOut, con->name);
                 return len;
             } else {
                 return -1 - len;
@@ -119,21 +187,16 @@ int IFaceTable::GetConstantName(int value, char *nameOut, unsigned nameBufferLen
 }
 
 const IFaceFunction *IFaceTable::GetFunctionByMessage(int message) const {
-    for (const auto &func : functions) {
-        if (func.value == message) {
-            return &func;
-        }
-    }
-    return nullptr;
+    return FunctionAt(message);
 }
 
 IFaceFunction IFaceTable::GetPropertyFuncByMessage(int message) const {
-    for (const auto &prop : properties) {
-        if (prop.getter == message) {
-            return prop.GetterFunction();
+    if (const IFaceProperty *prop = PropertyAt(message)) {
+        if (prop->getter == message) {
+            return prop->GetterFunction();
         }
-        else if (prop.setter == message) {
-            return prop.SetterFunction();
+        else {
+            return prop->SetterFunction();
         }
     }
     return { "invalid", -1, iface_void, {iface_void, iface_void} };
@@ -21,6 +21,7 @@
 #define IFACETABLE_H
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 enum IFaceType {
@@ -123,7 +124,9 @@ public:
         functions(_functions),
         constants(_constants),
         properties(_properties)
-    {}
+    {
+        BuildIndexes();
+    }
 
     const char *prefix;
 
@@ -144,6 +147,23 @@ public:
     std::vector<std::string> GetAllConstantNames() const;
     std::vector<std::string> GetAllFunctionNames() const;
     std::vector<std::string> GetAllPropertyNames() const;
+
+private:
+    void BuildIndexes();
+
+    const IFaceFunction *FunctionAt(int message) const;
+    const IFaceProperty *PropertyAt(int message) const;
+
+    // Indexed by message minus the lowest one, so looking up a message is a single load instead of a search
+    int messageBase = 0;
+    std::vector<const IFaceFunction *> functionsByMessage;
+    std::vector<const IFaceProperty *> propertiesByMessage;
+
+    // In the order they are in the table, since the hint picks between constants with the same value
+    std::unordered_map<int, std::vector<const IFaceConstant *>> constantsByValue;
+
+    // The function names as constants, e.g. SCI_GETTEXT
+    std::unordered_map<std::string, const IFaceFunction *> functionsByConstantName;
 };
 
 #endif
@@ -25,8 +25,13 @@
 
 class ISearchResultsHandler {
 public:
+    // Only this much of a line is needed either side of a hit to display it. A null line passed to
+    // newResultsEntry() means the text should be fetched from the editor when it is needed.
+    static constexpr int LINE_TEXT_CONTEXT = 200;
+
     virtual void newSearch(const QString searchTerm) = 0;
     virtual void newFileEntry(ScintillaNext *editor) = 0;
+    virtual void newFileEntry(const QString &filePath) = 0; // a file on disk that is not opened in an editor
     virtual void newResultsEntry(const QString line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount=1) = 0;
     virtual void completeSearch() = 0;
 };
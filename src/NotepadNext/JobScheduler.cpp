@@ -0,0 +1,164 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "JobScheduler.h"
+#include "NotepadNextApplication.h"
+
+#include <QThreadPool>
+#include <QTimer>
+
+
+// About half a frame at 60Hz, which leaves the rest for input and painting
+static const int DEFAULT_FRAME_BUDGET_MS = 8;
+
+JobScheduler::JobScheduler(QObject *parent) :
+    QObject(parent),
+    pool(new QThreadPool(this)),
+    timer(new QTimer(this)),
+    frameBudget(DEFAULT_FRAME_BUDGET_MS)
+{
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &JobScheduler::runSlices);
+}
+
+JobScheduler::~JobScheduler()
+{
+    for (const std::shared_ptr<std::atomic_bool> &token : qAsConst(tokens)) {
+        *token = true;
+    }
+
+    pool->waitForDone();
+}
+
+JobScheduler *JobScheduler::instance()
+{
+    NotepadNextApplication *app = qobject_cast<NotepadNextApplication *>(qApp);
+
+    return app ? app->getJobScheduler() : Q_NULLPTR;
+}
+
+void JobScheduler::schedule(QObject *owner, Priority priority, Slice slice)
+{
+    Q_ASSERT(owner != Q_NULLPTR);
+
+    watch(owner);
+
+    auto it = slices.find(owner);
+    if (it != slices.end()) {
+        queues[it->priority].removeOne(owner);
+    }
+
+    slices.insert(owner, Entry{priority, std::move(slice), nextId++});
+    queues[priority].append(owner);
+
+    if (!timer->isActive()) {
+        timer->start();
+    }
+}
+
+void JobScheduler::unschedule(QObject *owner)
+{
+    auto it = slices.find(owner);
+
+    if (it != slices.end()) {
+        queues[it->priority].removeOne(owner);
+        slices.erase(it);
+    }
+}
+
+void JobScheduler::run(QObject *owner, Priority priority, std::function<void(const CancelToken &token)> job)
+{
+    const CancelToken token = cancelToken(owner);
+
+    // The pool runs the highest number first
+    pool->start([=]() { job(token); }, Idle - priority);
+}
+
+JobScheduler::CancelToken JobScheduler::cancelToken(QObject *owner)
+{
+    Q_ASSERT(owner != Q_NULLPTR);
+
+    watch(owner);
+
+    std::shared_ptr<std::atomic_bool> &token = tokens[owner];
+    if (!token) {
+        token = std::make_shared<std::atomic_bool>(false);
+    }
+
+    return token;
+}
+
+void JobScheduler::cancel(QObject *owner)
+{
+    auto it = tokens.find(owner);
+
+    if (it != tokens.end()) {
+        *it.value() = true;
+        tokens.erase(it);
+    }
+}
+
+void JobScheduler::runSlices()
+{
+    const QDeadlineTimer deadline(frameBudget);
+
+    for (QList<QObject *> &queue : queues) {
+        // Each owner gets one turn per pass, anyone left over goes first next time
+        for (int turns = queue.size(); turns > 0 && !deadline.hasExpired(); --turns) {
+            QObject *owner = queue.takeFirst();
+
+            // Copied since the slice is free to schedule something else for its owner or unschedule it
+            const Entry entry = slices.value(owner);
+            const bool more = entry.slice(deadline);
+
+            auto it = slices.find(owner);
+            if (it != slices.end() && it->id == entry.id) {
+                if (more) {
+                    queue.append(owner);
+                }
+                else {
+                    slices.erase(it);
+                }
+            }
+        }
+
+        if (deadline.hasExpired()) {
+            break;
+        }
+    }
+
+    if (slices.isEmpty()) {
+        timer->stop();
+    }
+}
+
+void JobScheduler::watch(QObject *owner)
+{
+    if (!watched.contains(owner)) {
+        watched.insert(owner);
+        connect(owner, &QObject::destroyed, this, [=]() { forget(owner); });
+    }
+}
+
+void JobScheduler::forget(QObject *owner)
+{
+    unschedule(owner);
+    cancel(owner);
+    watched.remove(owner);
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QThreadPool;
+class QTimer;
+
+
+// One place for the editor's background work, so it is prioritised against everything else instead of every part of
+// the editor running timers and threads of its own.
+//
+// Work on the GUI thread is given as slices that do as much as they can before a deadline and say whether there is
+// more left. The waiting slices share one budget each pass of the event loop, highest priority first and taking turns
+// within a priority, so however much is queued up input is never held up for longer than the budget.
+//
+// Work for other threads goes to a pool of its own in priority order. Each owner, usually an editor or one of its
+// decorators, has a cancellation token its jobs can check. Cancelling it stops all of them, which also happens when
+// the owner is destroyed.
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Interactive, // the user is waiting on it
+        Viewport,    // what is on screen
+        Background,  // the rest of the document
+        Idle,        // nothing is waiting on it at all
+    };
+
+    typedef std::shared_ptr<const std::atomic_bool> CancelToken;
+
+    // Returns true while there is more to do
+    typedef std::function<bool(const QDeadlineTimer &deadline)> Slice;
+
+    explicit JobScheduler(QObject *parent = Q_NULLPTR);
+    ~JobScheduler();
+
+    // The one owned by the application
+    static JobScheduler *instance();
+
+    // How long all the slices together get each pass of the event loop
+    void setFrameBudget(int msecs) { frameBudget = msecs; }
+    int getFrameBudget() const { return frameBudget; }
+
+    // An owner has at most one slice, scheduling another replaces it
+    void schedule(QObject *owner, Priority priority, Slice slice);
+    void unschedule(QObject *owner);
+    bool isScheduled(QObject *owner) const { return slices.contains(owner); }
+
+    // Runs the job on a worker thread. It is given the owner's token as it was when the job was queued.
+    void run(QObject *owner, Priority priority, std::function<void(const CancelToken &token)> job);
+
+    CancelToken cancelToken(QObject *owner);
+
+    // Every job already given the owner's token sees it as canceled, anything started afterwards gets a new one
+    void cancel(QObject *owner);
+
+private slots:
+    void runSlices();
+
+private:
+    struct Entry {
+        Priority priority;
+        Slice slice;
+        quint64 id;
+    };
+
+    void watch(QObject *owner);
+    void forget(QObject *owner);
+
+    QThreadPool *pool;
+    QTimer *timer;
+    int frameBudget;
+
+    QHash<QObject *, Entry> slices;
+    QList<QObject *> queues[Idle + 1]; // the owners waiting for a turn, by priority
+    quint64 nextId = 0;
+
+    QHash<QObject *, std::shared_ptr<std::atomic_bool>> tokens;
+    QSet<QObject *> watched;
+};
+
+#endif // JOBSCHEDULER_H
@@ -70,6 +70,26 @@ QStringList columns{
 LanguageStylesModel::LanguageStylesModel(ScintillaNext *editor, QObject *parent)
     : QAbstractTableModel(parent), editor(editor)
 {
+    styleCount = editor ? editor->namedStyles() : 0;
+}
+
+void LanguageStylesModel::setEditor(ScintillaNext *newEditor)
+{
+    const int newStyleCount = newEditor ? newEditor->namedStyles() : 0;
+
+    if (newStyleCount != styleCount) {
+        beginResetModel();
+        editor = newEditor;
+        styleCount = newStyleCount;
+        endResetModel();
+    }
+    else {
+        editor = newEditor;
+
+        if (styleCount > 0) {
+            emit dataChanged(index(0, 0), index(styleCount - 1, columns.size() - 1));
+        }
+    }
 }
 
 QVariant LanguageStylesModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -88,7 +108,7 @@ int LanguageStylesModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid())
         return 0;
 
-    return editor->namedStyles();
+    return styleCount;
 }
 
 int LanguageStylesModel::columnCount(const QModelIndex &parent) const
@@ -101,7 +121,7 @@ int LanguageStylesModel::columnCount(const QModelIndex &parent) const
 
 QVariant LanguageStylesModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || !editor)
         return QVariant();
 
     if (role == Qt::DisplayRole || role == Qt::ToolTipRole || role == Qt::EditRole) {
@@ -179,7 +199,7 @@ QVariant LanguageStylesModel::data(const QModelIndex &index, int role) const
 
 bool LanguageStylesModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-    if (!index.isValid())
+    if (!index.isValid() || !editor)
         return false;
 
     if (role == Qt::EditRole) {
@@ -20,6 +20,7 @@
 #define LANGUAGESTYLESMODEL_H
 
 #include <QAbstractTableModel>
+#include <QPointer>
 
 class ScintillaNext;
 
@@ -30,6 +31,10 @@ class LanguageStylesModel : public QAbstractTableModel
 public:
     explicit LanguageStylesModel(ScintillaNext *editor, QObject *parent = nullptr);
 
+    // Shows the styles of another editor, or the same one again after they changed. Views only get reset when the
+    // number of styles is different, otherwise every cell is just reported as changed.
+    void setEditor(ScintillaNext *editor);
+
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -41,7 +46,8 @@ public:
     Qt::ItemFlags flags(const QModelIndex& index) const override;
 
 private:
-    ScintillaNext *editor;
+    QPointer<ScintillaNext> editor;
+    int styleCount = 0;
 };
 
 #endif // LANGUAGESTYLESMODEL_H
@@ -0,0 +1,203 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LatencyMonitor.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QTextStream>
+
+
+void LatencyHistogram::record(qint64 microseconds)
+{
+    microseconds = qMax<qint64>(microseconds, 0);
+
+    ++buckets[bucketFor(microseconds)];
+    ++total;
+    sum += microseconds;
+    largest = qMax(largest, microseconds);
+}
+
+void LatencyHistogram::reset()
+{
+    buckets.fill(0);
+    total = 0;
+    sum = 0;
+    largest = 0;
+}
+
+double LatencyHistogram::mean() const
+{
+    return total == 0 ? 0.0 : static_cast<double>(sum) / total;
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (total == 0) {
+        return 0;
+    }
+
+    const quint64 wanted = qMax<quint64>(1, static_cast<quint64>(total * qBound(0.0, p, 100.0) / 100.0 + 0.5));
+    quint64 seen = 0;
+
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += buckets[i];
+
+        if (seen >= wanted) {
+            return qMin(upperBoundOf(i), largest);
+        }
+    }
+
+    return largest;
+}
+
+int LatencyHistogram::bucketFor(qint64 value)
+{
+    // Values below SubBuckets get a bucket each, after that it is the position of the top bit plus the
+    // next SubBucketBits bits below it
+    if (value < SubBuckets) {
+        return static_cast<int>(value);
+    }
+
+    int topBit = 63;
+    while (!(static_cast<quint64>(value) & (Q_UINT64_C(1) << topBit))) {
+        --topBit;
+    }
+
+    const int shift = topBit - SubBucketBits;
+    const int bucket = (shift + 1) * SubBuckets + static_cast<int>((value >> shift) & (SubBuckets - 1));
+
+    return qMin(bucket, BucketCount - 1);
+}
+
+qint64 LatencyHistogram::upperBoundOf(int bucket)
+{
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+
+    const int shift = bucket / SubBuckets - 1;
+    const qint64 base = static_cast<qint64>(SubBuckets + bucket % SubBuckets) << shift;
+
+    return base + (Q_INT64_C(1) << shift) - 1;
+}
+
+
+Q_GLOBAL_STATIC(QElapsedTimer, monitorClock);
+Q_GLOBAL_STATIC(QMap<QByteArray, LatencyHistogram>, histograms);
+static int recorders = 0;
+static qint64 pendingKeyStart = -1;
+
+
+void LatencyMonitor::startRecording()
+{
+    if (recorders++ == 0 && !monitorClock->isValid()) {
+        monitorClock->start();
+    }
+}
+
+void LatencyMonitor::stopRecording()
+{
+    Q_ASSERT(recorders > 0);
+
+    if (--recorders == 0) {
+        pendingKeyStart = -1;
+    }
+}
+
+bool LatencyMonitor::isRecording()
+{
+    return recorders > 0;
+}
+
+qint64 LatencyMonitor::nowMicroseconds()
+{
+    return monitorClock->nsecsElapsed() / 1000;
+}
+
+void LatencyMonitor::record(const QByteArray &phase, qint64 microseconds)
+{
+    if (recorders > 0) {
+        (*histograms)[phase].record(microseconds);
+    }
+}
+
+void LatencyMonitor::keyHandled(qint64 startMicroseconds)
+{
+    if (recorders == 0) {
+        return;
+    }
+
+    record(QByteArrayLiteral("Key press"), nowMicroseconds() - startMicroseconds);
+
+    // If several keys arrive before a paint then the first one is the one that has waited the longest
+    if (pendingKeyStart < 0) {
+        pendingKeyStart = startMicroseconds;
+    }
+}
+
+void LatencyMonitor::paintFinished()
+{
+    if (recorders == 0 || pendingKeyStart < 0) {
+        return;
+    }
+
+    record(QByteArrayLiteral("Key press to paint"), nowMicroseconds() - pendingKeyStart);
+    pendingKeyStart = -1;
+}
+
+QVector<LatencyMonitor::Phase> LatencyMonitor::phases()
+{
+    QVector<Phase> result;
+
+    for (auto it = histograms->constBegin(); it != histograms->constEnd(); ++it) {
+        result.append({it.key(), it.value()});
+    }
+
+    return result;
+}
+
+void LatencyMonitor::reset()
+{
+    histograms->clear();
+    pendingKeyStart = -1;
+}
+
+bool LatencyMonitor::writeReport(const QString &filePath)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning("Unable to write the performance log to \"%s\": %s", qUtf8Printable(filePath), qUtf8Printable(file.errorString()));
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "phase\tcount\tmean_us\tp50_us\tp90_us\tp99_us\tmax_us\n";
+
+    for (const Phase &phase : phases()) {
+        const LatencyHistogram &h = phase.histogram;
+
+        out << phase.name << '\t' << h.count() << '\t' << qRound64(h.mean()) << '\t' << h.percentile(50) << '\t'
+            << h.percentile(90) << '\t' << h.percentile(99) << '\t' << h.maximum() << '\n';
+    }
+
+    return true;
+}
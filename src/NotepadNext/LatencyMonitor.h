@@ -0,0 +1,87 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <array>
+
+
+// Counts values in buckets that get wider as the values get larger, the same idea as an HDR histogram. Each
+// power of two range is split into 8 buckets, so any percentile is within 12.5% of the real value while the
+// whole thing is a fixed size array that only costs an increment to add to.
+class LatencyHistogram
+{
+public:
+    void record(qint64 microseconds);
+    void reset();
+
+    quint64 count() const { return total; }
+    qint64 maximum() const { return largest; }
+    double mean() const;
+
+    // The upper bound of the bucket the given percentile (0 to 100) falls in
+    qint64 percentile(double p) const;
+
+private:
+    static const int SubBucketBits = 3;
+    static const int SubBuckets = 1 << SubBucketBits;
+    static const int BucketCount = SubBuckets * 48;
+
+    static int bucketFor(qint64 value);
+    static qint64 upperBoundOf(int bucket);
+
+    std::array<quint64, BucketCount> buckets = {};
+    quint64 total = 0;
+    qint64 sum = 0;
+    qint64 largest = 0;
+};
+
+// Times the steps between a key press in an editor and the next paint of it: the key handling itself, each
+// decorator's share of the notifications sent during it, and the paint. Nothing is timed unless something
+// has started recording, and everything happens on the main thread.
+namespace LatencyMonitor {
+    struct Phase {
+        QByteArray name;
+        LatencyHistogram histogram;
+    };
+
+    // Recording is reference counted so the dock and --perf-log can both want it
+    void startRecording();
+    void stopRecording();
+    bool isRecording();
+
+    qint64 nowMicroseconds();
+    void record(const QByteArray &phase, qint64 microseconds);
+
+    // Called by the editor, paintFinished() closes off the key press that came before it
+    void keyHandled(qint64 startMicroseconds);
+    void paintFinished();
+
+    QVector<Phase> phases();
+    void reset();
+
+    bool writeReport(const QString &filePath);
+}
+
+#endif // LATENCYMONITOR_H
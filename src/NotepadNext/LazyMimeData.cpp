@@ -0,0 +1,143 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LazyMimeData.h"
+#include "ScintillaNext.h"
+
+#include <utility>
+
+using namespace Scintilla;
+
+
+LazyMimeData::LazyMimeData(ScintillaNext *editor) :
+    editor(editor)
+{
+    if (editor) {
+        connect(editor, &ScintillaEdit::notify, this, &LazyMimeData::editorNotified);
+        connect(editor, &ScintillaNext::closed, this, &LazyMimeData::renderAll);
+        connect(editor, &ScintillaNext::aboutToHibernate, this, &LazyMimeData::renderAll);
+    }
+}
+
+void LazyMimeData::setUtf8Text(const QByteArray &text)
+{
+    utf8Text = text;
+    hasUtf8Text = true;
+}
+
+void LazyMimeData::addFormat(const QString &mimeType, Renderer renderer)
+{
+    pending.insert(mimeType, renderer);
+    rendered.remove(mimeType);
+
+    // Only needed until everything has been rendered
+    if (editor) {
+        editor->setModificationsNeeded(this, ModificationFlags::BeforeInsert | ModificationFlags::BeforeDelete);
+    }
+}
+
+bool LazyMimeData::hasFormat(const QString &mimeType) const
+{
+    return formats().contains(mimeType);
+}
+
+QStringList LazyMimeData::formats() const
+{
+    QStringList formats;
+
+    if (hasUtf8Text) {
+        formats.append(QStringLiteral("text/plain"));
+    }
+
+    formats.append(pending.keys());
+    formats.append(rendered.keys());
+
+    // Anything given with setData(), e.g. markers other applications look for
+    formats.append(QMimeData::formats());
+
+    return formats;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+QVariant LazyMimeData::retrieveData(const QString &mimeType, QMetaType type) const
+{
+    const QVariant data = retrieveFormat(mimeType, type.id() == QMetaType::QString);
+    return data.isValid() ? data : QMimeData::retrieveData(mimeType, type);
+}
+#else
+QVariant LazyMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+    const QVariant data = retrieveFormat(mimeType, type == QVariant::String);
+    return data.isValid() ? data : QMimeData::retrieveData(mimeType, type);
+}
+#endif
+
+QVariant LazyMimeData::retrieveFormat(const QString &mimeType, bool asString) const
+{
+    if (hasUtf8Text && mimeType == QStringLiteral("text/plain")) {
+        // Whoever wants the bytes gets them as they are, only a string has to be converted
+        if (asString)
+            return QString::fromUtf8(utf8Text);
+
+        return utf8Text;
+    }
+
+    auto it = pending.find(mimeType);
+    if (it != pending.end()) {
+        const Renderer renderer = it.value();
+        pending.erase(it);
+
+        rendered.insert(mimeType, renderer());
+    }
+
+    auto found = rendered.constFind(mimeType);
+    if (found != rendered.constEnd()) {
+        return found.value();
+    }
+
+    return QVariant();
+}
+
+void LazyMimeData::editorNotified(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code != Notification::Modified)
+        return;
+
+    if (FlagSet(pscn->modificationType, ModificationFlags::BeforeInsert) || FlagSet(pscn->modificationType, ModificationFlags::BeforeDelete)) {
+        renderAll();
+    }
+}
+
+void LazyMimeData::renderAll()
+{
+    if (pending.isEmpty())
+        return;
+
+    qInfo("Rendering %d clipboard formats before their source changes", static_cast<int>(pending.size()));
+
+    const QMap<QString, Renderer> renderers = std::exchange(pending, {});
+    for (auto it = renderers.begin(); it != renderers.end(); ++it) {
+        rendered.insert(it.key(), it.value()());
+    }
+
+    if (editor) {
+        editor->setModificationsNeeded(this, ModificationFlags::None);
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+    }
+}
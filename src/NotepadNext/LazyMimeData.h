@@ -0,0 +1,78 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LAZYMIMEDATA_H
+#define LAZYMIMEDATA_H
+
+#include <QMap>
+#include <QMimeData>
+#include <QPointer>
+
+#include <functional>
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Clipboard data that only makes each format once an application pasting it asks for that format. Plain text is
+// kept as the editor's UTF-8 bytes and converted each time it is asked for as a string, and anything else is
+// rendered from the editor by a function given for it. Since those read the editor as it is when they run, every
+// format that hasn't been rendered yet is rendered just before the editor's text changes, or it closes. Without an
+// editor, whoever gives the renderers calls renderAll() before whatever they read from changes.
+class LazyMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<QByteArray()> Renderer;
+
+    explicit LazyMimeData(ScintillaNext *editor = Q_NULLPTR);
+
+    void setUtf8Text(const QByteArray &text);
+    void addFormat(const QString &mimeType, Renderer renderer);
+
+    bool hasFormat(const QString &mimeType) const override;
+    QStringList formats() const override;
+
+public slots:
+    void renderAll();
+
+protected:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QVariant retrieveData(const QString &mimeType, QMetaType type) const override;
+#else
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+#endif
+
+private:
+    void editorNotified(const Scintilla::NotificationData *pscn);
+    QVariant retrieveFormat(const QString &mimeType, bool asString) const;
+
+    QPointer<ScintillaNext> editor;
+    QByteArray utf8Text;
+    bool hasUtf8Text = false;
+
+    mutable QMap<QString, Renderer> pending;
+    mutable QMap<QString, QByteArray> rendered;
+};
+
+#endif // LAZYMIMEDATA_H
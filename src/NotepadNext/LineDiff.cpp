@@ -0,0 +1,386 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LineDiff.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+// Where each line starts (with the end of the text as one last entry) plus a hash of each line, EOL included
+// unless the line ends are ignored
+struct Lines {
+    const char *data;
+    QVector<qint64> starts;
+    QVector<size_t> hashes;
+    bool ignoreEol = false;
+
+    int count() const { return hashes.size(); }
+
+    qint64 length(int line) const
+    {
+        qint64 length = starts[line + 1] - starts[line];
+
+        if (ignoreEol) {
+            while (length > 0 && (data[starts[line] + length - 1] == '\n' || data[starts[line] + length - 1] == '\r'))
+                --length;
+        }
+
+        return length;
+    }
+};
+
+// With ignoreEol the lines are split the way Scintilla does, with an empty last line after a final line end
+Lines splitLines(const QByteArray &text, bool ignoreEol = false)
+{
+    Lines lines;
+    lines.data = text.constData();
+    lines.starts.append(0);
+    lines.ignoreEol = ignoreEol;
+
+    const char *p = text.constData();
+    const char *end = p + text.size();
+
+    while (p < end) {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *lineEnd = newline ? newline + 1 : end;
+
+        lines.hashes.append(0);
+        lines.starts.append(lineEnd - text.constData());
+        lines.hashes.last() = qHashBits(p, lines.length(lines.count() - 1));
+
+        p = lineEnd;
+    }
+
+    if (ignoreEol && (text.isEmpty() || text.endsWith('\n'))) {
+        lines.hashes.append(qHashBits(end, 0));
+        lines.starts.append(text.size());
+    }
+
+    return lines;
+}
+
+bool sameLine(const Lines &a, int i, const Lines &b, int j)
+{
+    return a.hashes[i] == b.hashes[j]
+            && a.length(i) == b.length(j)
+            && std::memcmp(a.data + a.starts[i], b.data + b.starts[j], a.length(i)) == 0;
+}
+
+enum class Op { Equal, Delete, Insert };
+
+// Myers' O((N+M)D) algorithm on a[aBegin, aEnd) and b[bBegin, bEnd). Fills in the edit script and returns true,
+// or returns false if it takes more than maxEdits edits.
+bool myers(const Lines &a, int aBegin, int aEnd, const Lines &b, int bBegin, int bEnd, int maxEdits, std::vector<Op> &ops)
+{
+    const int n = aEnd - aBegin;
+    const int m = bEnd - bBegin;
+    const int maxD = qMin(n + m, maxEdits);
+    const int offset = maxD + 1;
+
+    std::vector<int> v(2 * offset + 1, 0);
+    std::vector<std::vector<int>> trace;
+
+    for (int d = 0; d <= maxD; ++d) {
+        trace.push_back(v);
+
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+            int y = x - k;
+
+            while (x < n && y < m && sameLine(a, aBegin + x, b, bBegin + y)) {
+                ++x;
+                ++y;
+            }
+
+            v[offset + k] = x;
+
+            if (x < n || y < m) {
+                continue;
+            }
+
+            // Walk back through the trace to recover the edits, they end up in reverse order
+            for (int backD = d; backD >= 0; --backD) {
+                const std::vector<int> &prev = trace[backD];
+                const int backK = x - y;
+                const int prevK = (backK == -backD || (backK != backD && prev[offset + backK - 1] < prev[offset + backK + 1])) ? backK + 1 : backK - 1;
+                const int prevX = backD > 0 ? prev[offset + prevK] : 0;
+                const int prevY = backD > 0 ? prevX - prevK : 0;
+
+                while (x > prevX && y > prevY) {
+                    ops.push_back(Op::Equal);
+                    --x;
+                    --y;
+                }
+
+                if (backD > 0) {
+                    ops.push_back(x == prevX ? Op::Insert : Op::Delete);
+                }
+
+                x = prevX;
+                y = prevY;
+            }
+
+            std::reverse(ops.begin(), ops.end());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Lines that are in a[aBegin, aEnd) and b[bBegin, bEnd) exactly once each, as pairs of line numbers in order of
+// both, found as the longest increasing run of a's line numbers taken in b's order (by patience sorting)
+std::vector<std::pair<int, int>> uniqueAnchors(const Lines &a, int aBegin, int aEnd, const Lines &b, int bBegin, int bEnd)
+{
+    // An open addressed table of the lines of a, keyed by hash, as there can be millions of them
+    struct Slot {
+        size_t hash;
+        int countA;
+        int countB;
+        int lineA;
+        int lineB;
+    };
+
+    size_t capacity = 16;
+    while (capacity < 2 * static_cast<size_t>(aEnd - aBegin))
+        capacity *= 2;
+
+    const size_t mask = capacity - 1;
+    std::vector<Slot> slots(capacity, Slot{0, 0, 0, 0, 0});
+
+    auto find = [&](size_t hash) -> Slot & {
+        size_t index = hash & mask;
+
+        while (slots[index].countA != 0 && slots[index].hash != hash)
+            index = (index + 1) & mask;
+
+        return slots[index];
+    };
+
+    for (int i = aBegin; i < aEnd; ++i) {
+        Slot &slot = find(a.hashes[i]);
+        slot.hash = a.hashes[i];
+        ++slot.countA;
+        slot.lineA = i;
+    }
+
+    for (int j = bBegin; j < bEnd; ++j) {
+        Slot &slot = find(b.hashes[j]);
+
+        if (slot.countA != 0) {
+            ++slot.countB;
+            slot.lineB = j;
+        }
+    }
+
+    std::vector<std::pair<int, int>> candidates;
+    for (int j = bBegin; j < bEnd; ++j) {
+        const Slot &slot = find(b.hashes[j]);
+
+        if (slot.countA == 1 && slot.countB == 1 && sameLine(a, slot.lineA, b, j)) {
+            candidates.push_back({slot.lineA, j});
+        }
+    }
+
+    // The top of each pile, and what was on top of the pile to the left when each candidate was placed
+    std::vector<int> piles;
+    std::vector<int> previous(candidates.size(), -1);
+
+    for (int c = 0; c < static_cast<int>(candidates.size()); ++c) {
+        auto pile = std::lower_bound(piles.begin(), piles.end(), candidates[c].first, [&](int top, int line) {
+            return candidates[top].first < line;
+        });
+
+        if (pile != piles.begin()) {
+            previous[c] = *(pile - 1);
+        }
+
+        if (pile == piles.end()) {
+            piles.push_back(c);
+        }
+        else {
+            *pile = c;
+        }
+    }
+
+    std::vector<std::pair<int, int>> anchors;
+    for (int c = piles.empty() ? -1 : piles.back(); c >= 0; c = previous[c]) {
+        anchors.push_back(candidates[c]);
+    }
+
+    std::reverse(anchors.begin(), anchors.end());
+    return anchors;
+}
+
+void appendLineHunk(QVector<LineDiff::LineHunk> &hunks, int oldStart, int oldEnd, int newStart, int newEnd)
+{
+    if (oldStart == oldEnd && newStart == newEnd)
+        return;
+
+    if (!hunks.isEmpty() && hunks.last().oldEnd == oldStart && hunks.last().newEnd == newStart) {
+        hunks.last().oldEnd = oldEnd;
+        hunks.last().newEnd = newEnd;
+    }
+    else {
+        hunks.append({oldStart, oldEnd, newStart, newEnd});
+    }
+}
+
+}
+
+QVector<LineDiff::Hunk> LineDiff::diff(const QByteArray &oldText, const QByteArray &newText, int maxEdits)
+{
+    QVector<Hunk> hunks;
+
+    if (oldText == newText) {
+        return hunks;
+    }
+
+    const Lines a = splitLines(oldText);
+    const Lines b = splitLines(newText);
+
+    int prefix = 0;
+    while (prefix < a.count() && prefix < b.count() && sameLine(a, prefix, b, prefix)) {
+        ++prefix;
+    }
+
+    int aEnd = a.count();
+    int bEnd = b.count();
+    while (aEnd > prefix && bEnd > prefix && sameLine(a, aEnd - 1, b, bEnd - 1)) {
+        --aEnd;
+        --bEnd;
+    }
+
+    std::vector<Op> ops;
+    if (prefix == aEnd || prefix == bEnd || !myers(a, prefix, aEnd, b, prefix, bEnd, maxEdits, ops)) {
+        hunks.append({a.starts[prefix], a.starts[aEnd], b.starts[prefix], b.starts[bEnd]});
+        return hunks;
+    }
+
+    // Runs of anything other than Equal become one hunk each
+    int i = prefix;
+    int j = prefix;
+    for (size_t op = 0; op < ops.size();) {
+        if (ops[op] == Op::Equal) {
+            ++i;
+            ++j;
+            ++op;
+            continue;
+        }
+
+        const int hunkI = i;
+        const int hunkJ = j;
+
+        for (; op < ops.size() && ops[op] != Op::Equal; ++op) {
+            if (ops[op] == Op::Delete)
+                ++i;
+            else
+                ++j;
+        }
+
+        hunks.append({a.starts[hunkI], a.starts[i], b.starts[hunkJ], b.starts[j]});
+    }
+
+    return hunks;
+}
+
+QVector<LineDiff::LineHunk> LineDiff::diffLines(const QByteArray &oldText, const QByteArray &newText)
+{
+    // Gaps between anchors that are small enough are worth the smallest set of changes, past that they are
+    // one hunk
+    const int MYERS_MAX_EDITS = 1000;
+    const int MYERS_MAX_LINES = 20000;
+
+    const Lines a = splitLines(oldText, true);
+    const Lines b = splitLines(newText, true);
+
+    QVector<LineHunk> hunks;
+
+    // The regions still to be diffed, the next one to do on the top so the hunks come out in order
+    struct Region {
+        int aBegin;
+        int aEnd;
+        int bBegin;
+        int bEnd;
+    };
+    std::vector<Region> regions{{0, a.count(), 0, b.count()}};
+
+    while (!regions.empty()) {
+        Region region = regions.back();
+        regions.pop_back();
+
+        while (region.aBegin < region.aEnd && region.bBegin < region.bEnd && sameLine(a, region.aBegin, b, region.bBegin)) {
+            ++region.aBegin;
+            ++region.bBegin;
+        }
+
+        while (region.aEnd > region.aBegin && region.bEnd > region.bBegin && sameLine(a, region.aEnd - 1, b, region.bEnd - 1)) {
+            --region.aEnd;
+            --region.bEnd;
+        }
+
+        if (region.aBegin == region.aEnd || region.bBegin == region.bEnd) {
+            appendLineHunk(hunks, region.aBegin, region.aEnd, region.bBegin, region.bEnd);
+            continue;
+        }
+
+        const std::vector<std::pair<int, int>> anchors = uniqueAnchors(a, region.aBegin, region.aEnd, b, region.bBegin, region.bEnd);
+
+        if (!anchors.empty()) {
+            // Pushed last to first, the anchors themselves are the same so they are left out
+            regions.push_back({anchors.back().first + 1, region.aEnd, anchors.back().second + 1, region.bEnd});
+            for (size_t i = anchors.size() - 1; i > 0; --i) {
+                regions.push_back({anchors[i - 1].first + 1, anchors[i].first, anchors[i - 1].second + 1, anchors[i].second});
+            }
+            regions.push_back({region.aBegin, anchors.front().first, region.bBegin, anchors.front().second});
+            continue;
+        }
+
+        std::vector<Op> ops;
+        if (region.aEnd - region.aBegin + region.bEnd - region.bBegin > MYERS_MAX_LINES || !myers(a, region.aBegin, region.aEnd, b, region.bBegin, region.bEnd, MYERS_MAX_EDITS, ops)) {
+            appendLineHunk(hunks, region.aBegin, region.aEnd, region.bBegin, region.bEnd);
+            continue;
+        }
+
+        int i = region.aBegin;
+        int j = region.bBegin;
+        for (Op op : ops) {
+            if (op == Op::Equal) {
+                ++i;
+                ++j;
+            }
+            else if (op == Op::Delete) {
+                appendLineHunk(hunks, i, i + 1, j, j);
+                ++i;
+            }
+            else {
+                appendLineHunk(hunks, i, i, j, j + 1);
+                ++j;
+            }
+        }
+    }
+
+    return hunks;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QByteArray>
+#include <QVector>
+
+
+// Finds which lines differ between two versions of a text, so the old one can be turned into the new one by only
+// replacing what changed. Lines are compared by hash first. Lines that are the same at the start and end are skipped
+// before running Myers' algorithm on what's left, so a small change to a huge file costs about one pass over it.
+//
+// diffLines() is for showing two documents side by side instead, where lining up the lines that obviously belong
+// together matters more than the smallest set of changes. It uses patience diff: lines that appear exactly once
+// in both texts anchor the rest, and only the gaps between anchors are diffed again.
+class LineDiff
+{
+public:
+    // Replace [oldStart, oldEnd) of the old text with [newStart, newEnd) of the new text. Offsets are in bytes.
+    struct Hunk {
+        qint64 oldStart;
+        qint64 oldEnd;
+        qint64 newStart;
+        qint64 newEnd;
+    };
+
+    // The hunks are in order and don't overlap. Past maxEdits changed lines the differing middle is returned as a
+    // single hunk rather than spending more time and memory finding the smallest set of changes.
+    static QVector<Hunk> diff(const QByteArray &oldText, const QByteArray &newText, int maxEdits = 2000);
+
+    // Lines [oldStart, oldEnd) of the old text were replaced by [newStart, newEnd) of the new text. Lines are
+    // numbered the way Scintilla does, so text ending with a line end has an empty last line.
+    struct LineHunk {
+        int oldStart;
+        int oldEnd;
+        int newStart;
+        int newEnd;
+    };
+
+    // Line ends are ignored, so the same text with different line endings compares equal. The hunks are in
+    // order, don't overlap and are never next to each other.
+    static QVector<LineHunk> diffLines(const QByteArray &oldText, const QByteArray &newText);
+};
+
+#endif // LINEDIFF_H
@@ -0,0 +1,485 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LineFilter.h"
+#include "BufferSearcher.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <iterator>
+
+
+// The text is searched in line aligned blocks of about this size, so a new filter never has to wait long
+// for the search of the last one to notice it was canceled
+const qsizetype BLOCK_SIZE = 8 * 1024 * 1024;
+
+// How many of the most recent results are kept to be reused while the pattern is being typed
+const int MAX_RECENT_RESULTS = 8;
+
+// How long to wait after the text is edited before filtering it again
+const int REFILTER_DELAY_MS = 250;
+
+static bool isLineEnd(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+// Position just past the line ending found at or after position, so blocks never split a line or a \r\n
+static qsizetype nextLineStart(const char *data, qsizetype length, qsizetype position)
+{
+    if (position >= length)
+        return length;
+
+    while (position < length && !isLineEnd(data[position]))
+        ++position;
+
+    if (position < length && data[position] == '\r' && position + 1 < length && data[position + 1] == '\n')
+        ++position;
+
+    return qMin(length, position + 1);
+}
+
+LineFilter *LineFilter::forEditor(ScintillaNext *editor)
+{
+    LineFilter *filter = editor->findChild<LineFilter *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (filter == Q_NULLPTR) {
+        filter = new LineFilter(editor);
+    }
+
+    return filter;
+}
+
+LineFilter::LineFilter(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("LineFilter");
+
+    refilterTimer.setSingleShot(true);
+    refilterTimer.setInterval(REFILTER_DELAY_MS);
+    connect(&refilterTimer, &QTimer::timeout, this, [=]() {
+        setFilter(currentPattern, currentFlags);
+    });
+
+    connect(editor, &ScintillaNext::modified, this, [=](Scintilla::ModificationFlags type) {
+        if (Scintilla::FlagSet(type, Scintilla::ModificationFlags::InsertText) || Scintilla::FlagSet(type, Scintilla::ModificationFlags::DeleteText)) {
+            textChanged();
+        }
+    });
+    connect(editor, &ScintillaNext::modificationsResumed, this, &LineFilter::textChanged);
+}
+
+void LineFilter::setFilter(const QByteArray &pattern, int flags)
+{
+    refilterTimer.stop();
+
+    if (canceled) {
+        *canceled = true;
+        canceled.reset();
+    }
+
+    if (pattern.isEmpty()) {
+        clear();
+        return;
+    }
+
+    currentPattern = pattern;
+    currentFlags = flags;
+
+    BufferSearcher searcher(pattern, flags);
+
+    if (!searcher.isValid()) {
+        showAll();
+        emit filterFailed();
+        return;
+    }
+
+    if (!searcher.canSearch()) {
+        // Scintilla has to fold the case so this one is done on the GUI thread
+        LineMatches lines;
+
+        for (const Sci_CharacterRange &range : editor->findAllMatches(pattern, flags)) {
+            const Sci_Position line = editor->lineFromPosition(range.cpMin);
+
+            if (lines.empty() || lines.back().line != line) {
+                lines.push_back({line, editor->positionFromLine(line)});
+            }
+        }
+
+        resultReady({pattern, flags, std::make_shared<const LineMatches>(std::move(lines))}, editor->changeGeneration());
+        return;
+    }
+
+    if (!snapshot || snapshotGeneration != editor->changeGeneration()) {
+        takeSnapshot();
+    }
+
+    for (const Result &result : qAsConst(recentResults)) {
+        if (result.pattern == pattern && result.flags == flags) {
+            resultReady(result, snapshotGeneration);
+            return;
+        }
+    }
+
+    const Result *base = findNarrowingBase(pattern, flags);
+    const std::shared_ptr<const LineMatches> candidates = base ? base->lines : Q_NULLPTR;
+
+    QPointer<LineFilter> self = this;
+    std::shared_ptr<std::atomic_bool> jobCanceled = std::make_shared<std::atomic_bool>(false);
+    const std::shared_ptr<const Snapshot> text = snapshot;
+    const quint64 generation = snapshotGeneration;
+
+    canceled = jobCanceled;
+
+    QThreadPool::globalInstance()->start([=]() {
+        LineMatches lines = candidates ? scanCandidates(*text, pattern, flags, *candidates, *jobCanceled)
+                                       : scanAll(*text, pattern, flags, *jobCanceled);
+
+        if (*jobCanceled)
+            return;
+
+        const std::shared_ptr<const LineMatches> result = std::make_shared<const LineMatches>(std::move(lines));
+
+        // Posted through the application object since the filter may be deleted at any point
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self && !*jobCanceled) {
+                self->resultReady({pattern, flags, result}, generation);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LineFilter::setLineRange(Sci_Position first, Sci_Position last)
+{
+    refilterTimer.stop();
+
+    if (canceled) {
+        *canceled = true;
+        canceled.reset();
+    }
+
+    currentPattern.clear();
+    currentFlags = 0;
+
+    const Sci_Position lastLine = editor->lineCount() - 1;
+    first = qBound<Sci_Position>(0, first, lastLine);
+    last = qBound<Sci_Position>(first, last, lastLine);
+
+    // A range is just the lines either side of it hidden, there is no need to list every line in it
+    showAll();
+
+    if (first > 0) {
+        editor->hideLines(0, first - 1);
+    }
+    if (last < lastLine) {
+        editor->hideLines(last + 1, lastLine);
+    }
+
+    active = true;
+    showingRange = true;
+    appliedGeneration = editor->changeGeneration();
+
+    const Sci_Position caretLine = editor->lineFromPosition(editor->currentPos());
+    if (caretLine < first || caretLine > last) {
+        editor->gotoLine(caretLine < first ? first : last);
+    }
+    else {
+        editor->scrollCaret();
+    }
+
+    emit filterApplied(static_cast<int>(last - first + 1), editor->lineCount());
+}
+
+void LineFilter::clear()
+{
+    refilterTimer.stop();
+
+    if (canceled) {
+        *canceled = true;
+        canceled.reset();
+    }
+
+    currentPattern.clear();
+    currentFlags = 0;
+
+    // Nothing else needs the copy of the text
+    snapshot.reset();
+    recentResults.clear();
+
+    const bool wasActive = active;
+
+    showAll();
+
+    if (wasActive) {
+        emit filterCleared();
+    }
+}
+
+void LineFilter::textChanged()
+{
+    if (!currentPattern.isEmpty()) {
+        refilterTimer.start();
+    }
+}
+
+void LineFilter::takeSnapshot()
+{
+    std::shared_ptr<Snapshot> copy = std::make_shared<Snapshot>();
+
+    copy->text = *editor->textSnapshot();
+    copy->wordChars = editor->wordChars();
+    copy->whitespaceChars = editor->whitespaceChars();
+
+    snapshot = copy;
+    snapshotGeneration = editor->changeGeneration();
+
+    // Line numbers and positions only make sense for the text they came from
+    recentResults.clear();
+}
+
+bool LineFilter::isLiteral(int flags)
+{
+    return !(flags & (SCFIND_REGEXP | SCFIND_WHOLEWORD | SCFIND_WORDSTART));
+}
+
+const LineFilter::Result *LineFilter::findNarrowingBase(const QByteArray &pattern, int flags) const
+{
+    // Any line that contains the new pattern also contains every literal that is part of it, so only the
+    // lines that matched a shorter pattern need to be checked again. The fewer of them the better.
+    if (!isLiteral(flags))
+        return Q_NULLPTR;
+
+    const bool matchCase = flags & SCFIND_MATCHCASE;
+    const QByteArray needle = matchCase ? pattern : pattern.toLower();
+    const Result *best = Q_NULLPTR;
+
+    for (const Result &result : recentResults) {
+        if (result.flags != flags)
+            continue;
+
+        const QByteArray base = matchCase ? result.pattern : result.pattern.toLower();
+
+        if (needle.contains(base) && (best == Q_NULLPTR || result.lines->size() < best->lines->size())) {
+            best = &result;
+        }
+    }
+
+    return best;
+}
+
+void LineFilter::resultReady(const Result &result, quint64 generation)
+{
+    if (generation != editor->changeGeneration()) {
+        // The line numbers are already out of date, try again once the editing stops
+        textChanged();
+        return;
+    }
+
+    if (generation == snapshotGeneration && snapshot) {
+        recentResults.erase(std::remove_if(recentResults.begin(), recentResults.end(), [&](const Result &r) {
+            return r.pattern == result.pattern && r.flags == result.flags;
+        }), recentResults.end());
+
+        recentResults.prepend(result);
+
+        while (recentResults.size() > MAX_RECENT_RESULTS) {
+            recentResults.removeLast();
+        }
+    }
+
+    if (result.lines->empty()) {
+        showAll();
+        emit filterFailed();
+        return;
+    }
+
+    apply(*result.lines);
+
+    emit filterApplied(static_cast<int>(result.lines->size()), editor->lineCount());
+}
+
+void LineFilter::apply(const LineMatches &matches)
+{
+    std::vector<Sci_Position> lines;
+    lines.reserve(matches.size());
+
+    for (const LineMatch &match : matches) {
+        lines.push_back(match.line);
+    }
+
+    // Once the text has been edited the visible lines can't be compared with the new ones anymore
+    const bool edited = active && appliedGeneration != editor->changeGeneration();
+
+    if (edited) {
+        // Don't make the line that is being typed on disappear
+        const Sci_Position caretLine = editor->lineFromPosition(editor->currentPos());
+        auto it = std::lower_bound(lines.begin(), lines.end(), caretLine);
+
+        if (it == lines.end() || *it != caretLine) {
+            lines.insert(it, caretLine);
+        }
+    }
+
+    if (!active || edited || showingRange) {
+        editor->hideLines(0, editor->lineCount() - 1);
+        editor->showLineArray(static_cast<sptr_t>(lines.size()), reinterpret_cast<sptr_t>(lines.data()));
+    }
+    else {
+        std::vector<Sci_Position> changed;
+
+        std::set_difference(visibleLines.begin(), visibleLines.end(), lines.begin(), lines.end(), std::back_inserter(changed));
+        if (!changed.empty()) {
+            editor->hideLineArray(static_cast<sptr_t>(changed.size()), reinterpret_cast<sptr_t>(changed.data()));
+        }
+
+        changed.clear();
+
+        std::set_difference(lines.begin(), lines.end(), visibleLines.begin(), visibleLines.end(), std::back_inserter(changed));
+        if (!changed.empty()) {
+            editor->showLineArray(static_cast<sptr_t>(changed.size()), reinterpret_cast<sptr_t>(changed.data()));
+        }
+    }
+
+    visibleLines = std::move(lines);
+    active = true;
+    showingRange = false;
+    appliedGeneration = editor->changeGeneration();
+
+    keepCaretOnVisibleLine();
+}
+
+void LineFilter::showAll()
+{
+    if (!active)
+        return;
+
+    editor->showLines(0, editor->lineCount() - 1);
+
+    // Put back the folds that were contracted before the filter showed their lines
+    for (Sci_Position line = editor->contractedFoldNext(0); line >= 0; line = editor->contractedFoldNext(line + 1)) {
+        const Sci_Position lastChild = editor->lastChild(line, -1);
+
+        if (lastChild > line) {
+            editor->hideLines(line + 1, lastChild);
+            line = lastChild;
+        }
+    }
+
+    active = false;
+    showingRange = false;
+    visibleLines.clear();
+    visibleLines.shrink_to_fit();
+
+    editor->scrollCaret();
+}
+
+void LineFilter::keepCaretOnVisibleLine()
+{
+    const Sci_Position caretLine = editor->lineFromPosition(editor->currentPos());
+    auto it = std::lower_bound(visibleLines.cbegin(), visibleLines.cend(), caretLine);
+
+    if (it != visibleLines.cend() && *it == caretLine) {
+        editor->scrollCaret();
+        return;
+    }
+
+    // Go to whichever visible line is closest
+    if (it == visibleLines.cend() || (it != visibleLines.cbegin() && caretLine - *(it - 1) < *it - caretLine)) {
+        --it;
+    }
+
+    editor->gotoLine(*it);
+}
+
+LineFilter::LineMatches LineFilter::scanAll(const Snapshot &snapshot, const QByteArray &pattern, int flags, const std::atomic_bool &canceled)
+{
+    BufferSearcher searcher(pattern, flags);
+    searcher.setCharacterClasses(snapshot.wordChars, snapshot.whitespaceChars);
+
+    const char *data = snapshot.text.constData();
+    const qsizetype length = snapshot.text.size();
+
+    LineMatches lines;
+    Sci_Position line = 0;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+
+    for (qsizetype blockStart = 0; blockStart < length && !canceled;) {
+        const qsizetype blockEnd = nextLineStart(data, length, blockStart + BLOCK_SIZE);
+
+        searcher.forEachMatch(data, length, blockStart, blockEnd, [&](qsizetype start, qsizetype) {
+            // Scintilla treats \n, \r\n, and \r as line endings
+            for (; scanned < start; ++scanned) {
+                const char c = data[scanned];
+
+                if (c == '\n' || (c == '\r' && (scanned + 1 >= length || data[scanned + 1] != '\n'))) {
+                    ++line;
+                    lineStart = scanned + 1;
+                }
+            }
+
+            if (lines.empty() || lines.back().line != line) {
+                lines.push_back({line, lineStart});
+            }
+
+            return !canceled;
+        });
+
+        blockStart = blockEnd;
+    }
+
+    return lines;
+}
+
+LineFilter::LineMatches LineFilter::scanCandidates(const Snapshot &snapshot, const QByteArray &pattern, int flags, const LineMatches &candidates, const std::atomic_bool &canceled)
+{
+    BufferSearcher searcher(pattern, flags);
+    searcher.setCharacterClasses(snapshot.wordChars, snapshot.whitespaceChars);
+
+    const char *data = snapshot.text.constData();
+    const qsizetype length = snapshot.text.size();
+
+    LineMatches lines;
+
+    for (const LineMatch &candidate : candidates) {
+        if (canceled)
+            break;
+
+        qsizetype lineEnd = candidate.start;
+        while (lineEnd < length && !isLineEnd(data[lineEnd]))
+            ++lineEnd;
+
+        bool found = false;
+        searcher.forEachMatch(data, length, candidate.start, lineEnd, [&](qsizetype, qsizetype) {
+            found = true;
+            return false;
+        });
+
+        if (found) {
+            lines.push_back(candidate);
+        }
+    }
+
+    return lines;
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Scintilla.h"
+
+
+class ScintillaNext;
+
+// Hides every line of an editor that doesn't contain a match of a pattern. The matching lines are found on
+// a QThreadPool from a snapshot of the text, and recent results are kept around so that typing more of a
+// literal pattern only needs to check the lines that matched before, and deleting characters again can
+// reuse what was already found. Changing the filter only shows or hides the lines that differ from what is
+// currently filtered. It can also show a single range of lines instead, such as the lines of a log between
+// two times. There is one per editor, use LineFilter::forEditor() to get it.
+class LineFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LineFilter *forEditor(ScintillaNext *editor);
+
+    // An empty pattern clears the filter
+    void setFilter(const QByteArray &pattern, int flags);
+
+    // Only shows the lines from first to last instead of the ones matching a pattern
+    void setLineRange(Sci_Position first, Sci_Position last);
+    void clear();
+
+    bool isActive() const { return active; }
+    QByteArray pattern() const { return currentPattern; }
+    int flags() const { return currentFlags; }
+
+signals:
+    void filterApplied(int matchingLines, int totalLines);
+
+    // The pattern is invalid or nothing matched it, the editor is left unfiltered
+    void filterFailed();
+    void filterCleared();
+
+private slots:
+    void textChanged();
+
+private:
+    struct LineMatch
+    {
+        Sci_Position line;
+        qsizetype start;
+    };
+
+    using LineMatches = std::vector<LineMatch>;
+
+    struct Snapshot
+    {
+        QByteArray text;
+        QByteArray wordChars;
+        QByteArray whitespaceChars;
+    };
+
+    struct Result
+    {
+        QByteArray pattern;
+        int flags;
+        std::shared_ptr<const LineMatches> lines;
+    };
+
+    explicit LineFilter(ScintillaNext *editor);
+
+    void takeSnapshot();
+    const Result *findNarrowingBase(const QByteArray &pattern, int flags) const;
+    void resultReady(const Result &result, quint64 generation);
+    void apply(const LineMatches &matches);
+    void showAll();
+    void keepCaretOnVisibleLine();
+
+    static bool isLiteral(int flags);
+    static LineMatches scanAll(const Snapshot &snapshot, const QByteArray &pattern, int flags, const std::atomic_bool &canceled);
+    static LineMatches scanCandidates(const Snapshot &snapshot, const QByteArray &pattern, int flags, const LineMatches &candidates, const std::atomic_bool &canceled);
+
+    ScintillaNext *editor;
+
+    std::shared_ptr<const Snapshot> snapshot;
+    quint64 snapshotGeneration = 0;
+    QList<Result> recentResults;
+    std::shared_ptr<std::atomic_bool> canceled;
+
+    QByteArray currentPattern;
+    int currentFlags = 0;
+
+    // The lines that are shown while the filter is active, and the text they were worked out from
+    bool active = false;
+    bool showingRange = false;
+    std::vector<Sci_Position> visibleLines;
+    quint64 appliedGeneration = 0;
+
+    QTimer refilterTimer;
+};
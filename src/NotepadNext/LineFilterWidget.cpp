@@ -0,0 +1,205 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FocusWatcher.h"
+#include "LineFilter.h"
+#include "LineFilterWidget.h"
+#include "ui_LineFilterWidget.h"
+
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QSignalBlocker>
+
+LineFilterWidget::LineFilterWidget(QWidget *parent) :
+    QFrame(parent),
+    ui(new Ui::LineFilterWidget)
+{
+    ui->setupUi(this);
+
+    // Move the focus to the line edit widget
+    setFocusProxy(ui->lineEdit);
+
+    ui->lineEdit->installEventFilter(this);
+
+    // The filter stays applied, only the box goes away
+    FocusWatcher *fw = new FocusWatcher(ui->lineEdit);
+    connect(fw, &FocusWatcher::focusOut, this, &LineFilterWidget::hide);
+
+    connect(ui->lineEdit, &QLineEdit::returnPressed, this, &LineFilterWidget::returnPressed);
+
+    // Every keystroke refines the filter, the lines are found in the background so this doesn't hold up typing
+    connect(ui->lineEdit, &QLineEdit::textChanged, this, &LineFilterWidget::updateFilter);
+    connect(ui->buttonMatchCase, &QToolButton::toggled, this, &LineFilterWidget::updateFilter);
+    connect(ui->buttonWholeWord, &QToolButton::toggled, this, &LineFilterWidget::updateFilter);
+    connect(ui->buttonRegexp, &QToolButton::toggled, this, &LineFilterWidget::updateFilter);
+
+    ui->lblInfo->hide();
+}
+
+LineFilterWidget::~LineFilterWidget()
+{
+    delete ui;
+}
+
+void LineFilterWidget::setEditor(ScintillaNext *editor)
+{
+    if (this->editor == editor) {
+        positionWidget();
+        return;
+    }
+
+    if (this->editor) {
+        disconnect(this->editor, Q_NULLPTR, this, Q_NULLPTR);
+        disconnect(lineFilter(), Q_NULLPTR, this, Q_NULLPTR);
+    }
+
+    this->editor = editor;
+
+    connect(editor, &ScintillaNext::resized, this, &LineFilterWidget::positionWidget);
+
+    LineFilter *filter = lineFilter();
+    connect(filter, &LineFilter::filterApplied, this, &LineFilterWidget::filterApplied);
+    connect(filter, &LineFilter::filterFailed, this, &LineFilterWidget::filterFailed);
+    connect(filter, &LineFilter::filterCleared, this, &LineFilterWidget::filterCleared);
+
+    // Show whatever this editor is filtered by already
+    const QSignalBlocker lineEditBlocker(ui->lineEdit);
+    const QSignalBlocker matchCaseBlocker(ui->buttonMatchCase);
+    const QSignalBlocker wholeWordBlocker(ui->buttonWholeWord);
+    const QSignalBlocker regexpBlocker(ui->buttonRegexp);
+    const int flags = filter->flags();
+
+    ui->lineEdit->setText(QString::fromUtf8(filter->pattern()));
+    ui->buttonMatchCase->setChecked(flags & SCFIND_MATCHCASE);
+    ui->buttonWholeWord->setChecked(flags & SCFIND_WHOLEWORD);
+    ui->buttonRegexp->setChecked(flags & SCFIND_REGEXP);
+
+    if (filter->isActive()) {
+        filterApplied(-1, editor->lineCount());
+    }
+    else {
+        filterCleared();
+    }
+
+    positionWidget();
+}
+
+bool LineFilterWidget::eventFilter(QObject *obj, QEvent *event)
+{
+    if (event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+
+        // Use escape key to remove the filter and close the widget
+        if (keyEvent->key() == Qt::Key_Escape && editor) {
+            ui->lineEdit->clear();
+            lineFilter()->clear();
+            hide();
+            editor->grabFocus();
+        }
+    }
+
+    return QObject::eventFilter(obj, event);
+}
+
+LineFilter *LineFilterWidget::lineFilter() const
+{
+    return LineFilter::forEditor(editor);
+}
+
+void LineFilterWidget::updateFilter()
+{
+    if (!editor)
+        return;
+
+    lineFilter()->setFilter(ui->lineEdit->text().toUtf8(), computeSearchFlags());
+}
+
+void LineFilterWidget::filterApplied(int matchingLines, int totalLines)
+{
+    setSearchContextColor(QStringLiteral("blue"));
+
+    if (matchingLines >= 0) {
+        ui->lblInfo->setText(tr("%L1/%L2 lines").arg(matchingLines).arg(totalLines));
+        ui->lblInfo->show();
+    }
+}
+
+void LineFilterWidget::filterFailed()
+{
+    setSearchContextColor(QStringLiteral("red"));
+    ui->lblInfo->setText(tr("0 lines"));
+    ui->lblInfo->show();
+}
+
+void LineFilterWidget::filterCleared()
+{
+    setSearchContextColor(QStringLiteral("blue"));
+    ui->lblInfo->hide();
+}
+
+int LineFilterWidget::computeSearchFlags() const
+{
+    int searchFlags = 0;
+
+    if (ui->buttonMatchCase->isChecked()) {
+        searchFlags |= SCFIND_MATCHCASE;
+    }
+
+    if (ui->buttonWholeWord->isChecked()) {
+        searchFlags |= SCFIND_WHOLEWORD;
+    }
+
+    if (ui->buttonRegexp->isChecked()) {
+        searchFlags |= SCFIND_REGEXP;
+    }
+
+    return searchFlags;
+}
+
+void LineFilterWidget::setSearchContextColor(const QString &color)
+{
+    ui->lineEdit->setStyleSheet(QStringLiteral("border: 1px solid %1; padding: 2px;").arg(color));
+}
+
+void LineFilterWidget::positionWidget()
+{
+    if (!editor)
+        return;
+
+    int usableWidth = editor->width();
+
+    // Account for the scrollbar as the widget will be underneath if the scrollbar is visible
+    if (editor->verticalScrollBar() && editor->verticalScrollBar()->isVisible()) {
+        usableWidth -= editor->verticalScrollBar()->width();
+    }
+
+    QPoint position = QPoint(usableWidth - width(), 0);
+
+    move(editor->mapTo(parentWidget(), position));
+}
+
+void LineFilterWidget::returnPressed()
+{
+    // Keep the filter and get back to editing the lines that are left
+    hide();
+
+    if (editor) {
+        editor->grabFocus();
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LINEFILTERWIDGET_H
+#define LINEFILTERWIDGET_H
+
+#include <QEvent>
+#include <QFrame>
+#include <QObject>
+#include <QPointer>
+
+#include "ScintillaNext.h"
+
+namespace Ui {
+class LineFilterWidget;
+}
+
+class LineFilter;
+
+
+// Small box shown over the top of the editor, like the quick find, that only leaves the lines matching what
+// is typed into it visible. The filter stays on when the box loses focus and is cleared with escape.
+class LineFilterWidget : public QFrame
+{
+    Q_OBJECT
+
+public:
+    explicit LineFilterWidget(QWidget *parent = nullptr);
+    ~LineFilterWidget();
+
+    void setEditor(ScintillaNext *editor);
+
+protected:
+   bool eventFilter(QObject *obj, QEvent *event) override;
+
+private slots:
+    void updateFilter();
+
+    void filterApplied(int matchingLines, int totalLines);
+    void filterFailed();
+    void filterCleared();
+
+    void positionWidget();
+
+    void returnPressed();
+
+private:
+    LineFilter *lineFilter() const;
+    int computeSearchFlags() const;
+    void setSearchContextColor(const QString &color);
+
+    Ui::LineFilterWidget *ui;
+    QPointer<ScintillaNext> editor;
+};
+
+#endif // LINEFILTERWIDGET_H
@@ -0,0 +1,191 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LineFormatDetector.h"
+
+#include "Scintilla.h"
+
+#include <QtAlgorithms>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// There have to be at least this many indented lines in the sample before anything is said about the indentation
+const int MIN_INDENTED_LINES = 5;
+
+void LineFormatDetector::reset()
+{
+    *this = LineFormatDetector();
+}
+
+void LineFormatDetector::add(const char *data, qsizetype length)
+{
+    if (length <= 0)
+        return;
+
+    countLineEndings(data, length);
+
+    if (!isIndentSampled())
+        sampleIndentation(data, length);
+}
+
+int LineFormatDetector::eolMode() const
+{
+    const qint64 lfOnly = lfs - crlfs;
+    const qint64 crOnly = crs - crlfs;
+
+    if (crlfs == 0 && lfOnly == 0 && crOnly == 0)
+        return -1;
+
+    if (crlfs >= lfOnly && crlfs >= crOnly)
+        return SC_EOL_CRLF;
+
+    return lfOnly >= crOnly ? SC_EOL_LF : SC_EOL_CR;
+}
+
+bool LineFormatDetector::hasMixedLineEndings() const
+{
+    const qint64 lfOnly = lfs - crlfs;
+    const qint64 crOnly = crs - crlfs;
+
+    return (crlfs > 0) + (lfOnly > 0) + (crOnly > 0) > 1;
+}
+
+int LineFormatDetector::usesTabs() const
+{
+    if (tabIndentedLines + spaceIndentedLines < MIN_INDENTED_LINES)
+        return -1;
+
+    return tabIndentedLines > spaceIndentedLines ? 1 : 0;
+}
+
+int LineFormatDetector::indentSize() const
+{
+    if (usesTabs() != 0)
+        return -1;
+
+    int best = 0;
+    for (int step = 1; step <= 8; ++step) {
+        if (indentSteps[step] > indentSteps[best])
+            best = step;
+    }
+
+    return best > 0 ? best : -1;
+}
+
+void LineFormatDetector::countLineEndings(const char *data, qsizetype length)
+{
+    qsizetype i = 0;
+
+    // A CR at the very end of the last piece may be the first half of a CRLF
+    if (endedWithCr && data[0] == '\n')
+        ++crlfs;
+
+    endedWithCr = data[length - 1] == '\r';
+
+#ifdef __SSE2__
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const uint lfMask = static_cast<uint>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf)));
+        const uint crMask = static_cast<uint>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, cr)));
+
+        lfs += qPopulationCount(lfMask);
+
+        if (crMask == 0)
+            continue;
+
+        // A CR is half of a CRLF when the bit for the byte after it is set in the LF mask
+        crs += qPopulationCount(crMask);
+        crlfs += qPopulationCount(crMask & (lfMask >> 1));
+
+        if ((crMask & 0x8000) && i + 16 < length && data[i + 16] == '\n')
+            ++crlfs;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (data[i] == '\n') {
+            ++lfs;
+        }
+        else if (data[i] == '\r') {
+            ++crs;
+
+            if (i + 1 < length && data[i + 1] == '\n')
+                ++crlfs;
+        }
+    }
+}
+
+void LineFormatDetector::sampleIndentation(const char *data, qsizetype length)
+{
+    for (qsizetype i = 0; i < length && !isIndentSampled(); ++i) {
+        const char c = data[i];
+        const bool afterCr = sampleAfterCr;
+        sampleAfterCr = c == '\r';
+
+        if (c == '\n' && afterCr) {
+            // The rest of a CRLF
+        }
+        else if (c == '\n' || c == '\r') {
+            endSampledLine();
+        }
+        else if (inIndent) {
+            if (c == ' ') {
+                ++indentSpaces;
+            }
+            else if (c == '\t') {
+                if (indentSpaces == 0)
+                    indentStartsWithTab = true;
+            }
+            else {
+                inIndent = false;
+
+                if (indentStartsWithTab) {
+                    ++tabIndentedLines;
+                }
+                else if (indentSpaces > 0) {
+                    // A single space is more likely to be lining something up, e.g. the stars of a block comment
+                    if (indentSpaces > 1)
+                        ++spaceIndentedLines;
+
+                    const int step = indentSpaces - previousIndentSpaces;
+                    if (step > 0 && step <= 8)
+                        ++indentSteps[step];
+                }
+
+                if (!indentStartsWithTab)
+                    previousIndentSpaces = indentSpaces;
+            }
+        }
+    }
+}
+
+void LineFormatDetector::endSampledLine()
+{
+    // Lines that are blank or only whitespace say nothing about the indentation
+    ++sampledLines;
+    inIndent = true;
+    indentStartsWithTab = false;
+    indentSpaces = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LINEFORMATDETECTOR_H
+#define LINEFORMATDETECTOR_H
+
+#include <QtGlobal>
+
+
+// Works out the line endings and indentation of a file from the text as it is being loaded, a piece at a time, so
+// there never has to be a second pass over the document. Line endings are counted over all of it, while the
+// indentation is only sampled from the first lines.
+class LineFormatDetector
+{
+public:
+    // How many lines the indentation is sampled from
+    static const int INDENT_SAMPLE_LINES = 5000;
+
+    void reset();
+    void add(const char *data, qsizetype length);
+
+    // The SC_EOL_* used by the most lines, or -1 if there aren't any line endings
+    int eolMode() const;
+    bool hasMixedLineEndings() const;
+
+    // Whether the sample has been taken, or the text ended before it could be
+    bool isIndentSampled() const { return sampledLines >= INDENT_SAMPLE_LINES; }
+
+    // Each is -1 if there weren't enough indented lines to tell. The size is only known for space indentation.
+    int usesTabs() const;
+    int indentSize() const;
+
+private:
+    void countLineEndings(const char *data, qsizetype length);
+    void sampleIndentation(const char *data, qsizetype length);
+    void endSampledLine();
+
+    qint64 lfs = 0;
+    qint64 crs = 0;
+    qint64 crlfs = 0;
+    bool endedWithCr = false;
+
+    int sampledLines = 0;
+    bool sampleAfterCr = false;
+    bool inIndent = true;
+    bool indentStartsWithTab = false;
+    int indentSpaces = 0;
+    int previousIndentSpaces = 0;
+    int tabIndentedLines = 0;
+    int spaceIndentedLines = 0;
+
+    // How often each increase in indentation from one line to the next was seen, for 1 to 8 spaces
+    int indentSteps[9] = {};
+};
+
+#endif // LINEFORMATDETECTOR_H
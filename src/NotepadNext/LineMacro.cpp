@@ -0,0 +1,263 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LineMacro.h"
+
+#include <QString>
+
+using namespace Scintilla;
+
+
+static bool isContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+static int nextCharacter(const QByteArray &line, int position)
+{
+    do {
+        ++position;
+    } while (position < line.size() && isContinuationByte(line.at(position)));
+
+    return position;
+}
+
+static int previousCharacter(const QByteArray &line, int position)
+{
+    do {
+        --position;
+    } while (position > 0 && isContinuationByte(line.at(position)));
+
+    return position;
+}
+
+static int indentation(const QByteArray &line)
+{
+    int position = 0;
+
+    while (position < line.size() && (line.at(position) == ' ' || line.at(position) == '\t')) {
+        ++position;
+    }
+
+    return position;
+}
+
+LineMacro::LineMacro(const QVector<MacroStep> &steps)
+{
+    if (steps.size() < 2 || steps.last().message != Message::LineDown || steps.last().repeat != 1) {
+        return;
+    }
+
+    // Moving down leaves the caret somewhere along the next line, so it has to be put somewhere known first
+    bool caretKnown = false;
+
+    for (int i = 0; i < steps.size() - 1; ++i) {
+        const Message message = steps.at(i).message;
+
+        if (!isLineLocal(message)) {
+            return;
+        }
+
+        // Anything typed that splits up the line would change which lines the rest of it is played on
+        if (message == Message::ReplaceSel && (steps.at(i).str.contains('\n') || steps.at(i).str.contains('\r'))) {
+            return;
+        }
+
+        if (message == Message::Home || message == Message::LineEnd) {
+            caretKnown = true;
+        }
+        else if (message == Message::VCHome) {
+            // It goes to the indentation unless it's already there, in which case it goes to the start
+            if (!caretKnown) {
+                return;
+            }
+        }
+        else if (message != Message::Cancel && !caretKnown) {
+            return;
+        }
+    }
+
+    // Each repeat is its own step here, every one of them has to be checked against the line anyway
+    for (int i = 0; i < steps.size() - 1; ++i) {
+        MacroStep single = steps.at(i);
+        single.repeat = 1;
+
+        for (int r = 0; r < steps.at(i).repeat; ++r) {
+            this->steps.append(single);
+        }
+    }
+
+    valid = true;
+}
+
+bool LineMacro::isLineLocal(Message message)
+{
+    switch (message) {
+    case Message::Home:
+    case Message::HomeExtend:
+    case Message::VCHome:
+    case Message::VCHomeExtend:
+    case Message::LineEnd:
+    case Message::LineEndExtend:
+    case Message::CharLeft:
+    case Message::CharLeftExtend:
+    case Message::CharRight:
+    case Message::CharRightExtend:
+    case Message::ReplaceSel:
+    case Message::DeleteBack:
+    case Message::DeleteBackNotLine:
+    case Message::Clear:
+    case Message::DelLineLeft:
+    case Message::DelLineRight:
+    case Message::UpperCase:
+    case Message::LowerCase:
+    case Message::Cancel:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool LineMacro::apply(QByteArray &line, int *caretResult) const
+{
+    int caret = 0;
+    int anchor = 0;
+
+    auto selectionStart = [&]() { return qMin(caret, anchor); };
+    auto selectionEnd = [&]() { return qMax(caret, anchor); };
+
+    auto replaceSelection = [&](const QByteArray &text) {
+        const int start = selectionStart();
+
+        line.replace(start, selectionEnd() - start, text);
+        caret = anchor = start + text.size();
+    };
+
+    for (const MacroStep &step : steps) {
+        switch (step.message) {
+        case Message::Home:
+            caret = anchor = 0;
+            break;
+        case Message::HomeExtend:
+            caret = 0;
+            break;
+        case Message::VCHome:
+        case Message::VCHomeExtend: {
+            const int indent = indentation(line);
+
+            caret = caret == indent ? 0 : indent;
+            if (step.message == Message::VCHome)
+                anchor = caret;
+            break;
+        }
+        case Message::LineEnd:
+            caret = anchor = line.size();
+            break;
+        case Message::LineEndExtend:
+            caret = line.size();
+            break;
+        case Message::CharLeft:
+            // A selection just collapses to its start
+            if (caret != anchor) {
+                caret = anchor = selectionStart();
+                break;
+            }
+            if (caret == 0)
+                return false;
+            caret = anchor = previousCharacter(line, caret);
+            break;
+        case Message::CharLeftExtend:
+            if (caret == 0)
+                return false;
+            caret = previousCharacter(line, caret);
+            break;
+        case Message::CharRight:
+            if (caret != anchor) {
+                caret = anchor = selectionEnd();
+                break;
+            }
+            if (caret == line.size())
+                return false;
+            caret = anchor = nextCharacter(line, caret);
+            break;
+        case Message::CharRightExtend:
+            if (caret == line.size())
+                return false;
+            caret = nextCharacter(line, caret);
+            break;
+        case Message::ReplaceSel:
+            replaceSelection(step.str);
+            break;
+        case Message::DeleteBack:
+        case Message::DeleteBackNotLine:
+            if (caret == anchor) {
+                if (caret == 0) {
+                    // That would join it with the line before
+                    if (step.message == Message::DeleteBack)
+                        return false;
+                    break;
+                }
+                anchor = previousCharacter(line, caret);
+            }
+            replaceSelection(QByteArray());
+            break;
+        case Message::Clear:
+            if (caret == anchor) {
+                if (caret == line.size())
+                    return false;
+                anchor = nextCharacter(line, caret);
+            }
+            replaceSelection(QByteArray());
+            break;
+        case Message::DelLineLeft:
+            line.remove(0, caret);
+            caret = anchor = 0;
+            break;
+        case Message::DelLineRight:
+            line.truncate(caret);
+            caret = anchor = line.size();
+            break;
+        case Message::UpperCase:
+        case Message::LowerCase: {
+            const int start = selectionStart();
+            const QString text = QString::fromUtf8(line.constData() + start, selectionEnd() - start);
+            const QByteArray changed = (step.message == Message::UpperCase ? text.toUpper() : text.toLower()).toUtf8();
+            const bool forwards = caret >= anchor;
+
+            line.replace(start, selectionEnd() - start, changed);
+
+            // The selection stays on the text
+            anchor = forwards ? start : start + changed.size();
+            caret = forwards ? start + changed.size() : start;
+            break;
+        }
+        case Message::Cancel:
+            break;
+        default:
+            Q_UNREACHABLE();
+            return false;
+        }
+    }
+
+    if (caretResult) {
+        *caretResult = caret;
+    }
+
+    return true;
+}
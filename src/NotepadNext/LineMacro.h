@@ -0,0 +1,51 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LINEMACRO_H
+#define LINEMACRO_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "MacroStep.h"
+
+
+// A macro that only ever works within the line the caret is on and then moves down to the next one, e.g.
+// something recorded to process each line of a log. Since every line is changed the same way no matter what
+// happened to the others, it can be played on the text of each line on its own, without an editor and on
+// any thread. Only Home, VC Home or Line End can come before anything that depends on where the caret is.
+class LineMacro
+{
+public:
+    explicit LineMacro(const QVector<MacroStep> &steps);
+
+    bool isValid() const { return valid; }
+
+    // Plays the macro on the UTF-8 text of a line, without its end of line, and gives where the caret ended up.
+    // It fails if the macro would have reached outside of the line, e.g. by deleting back from the start of it.
+    bool apply(QByteArray &line, int *caret = Q_NULLPTR) const;
+
+    static bool isLineLocal(Scintilla::Message message);
+
+private:
+    QVector<MacroStep> steps; // everything before moving down a line
+    bool valid = false;
+};
+
+#endif // LINEMACRO_H
@@ -0,0 +1,667 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LineTransforms.h"
+#include "BulkEdit.h"
+#include "CsvColumns.h"
+#include "ScintillaNext.h"
+
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+
+namespace {
+
+using Line = LineTransforms::Line;
+using Lines = LineTransforms::Lines;
+
+// The calling thread waits for the sort, so it can't be queued behind whatever else is on the global pool, e.g. a
+// Find in Files that keeps its threads for as long as it runs
+Q_GLOBAL_STATIC(QThreadPool, sortPool)
+
+// Sorts runs of the items on the thread pool, then merges pairs of runs together a level at a time. The last run or
+// pair of each level is done on the calling thread while it waits for the others.
+template<typename T, typename Less>
+void parallelSort(std::vector<T> &items, Less less)
+{
+    const int runs = qMin(QThread::idealThreadCount(), static_cast<int>(items.size() / (LineTransforms::PARALLEL_SORT_THRESHOLD / 4)));
+
+    if (runs < 2 || static_cast<int>(items.size()) < LineTransforms::PARALLEL_SORT_THRESHOLD) {
+        std::stable_sort(items.begin(), items.end(), less);
+        return;
+    }
+
+    std::vector<size_t> bounds;
+    for (int i = 0; i <= runs; ++i) {
+        bounds.push_back(items.size() * i / runs);
+    }
+
+    QSemaphore done;
+    for (int i = 0; i < runs; ++i) {
+        const size_t start = bounds[i];
+        const size_t end = bounds[i + 1];
+
+        auto sortRun = [&items, less, start, end]() {
+            std::stable_sort(items.begin() + start, items.begin() + end, less);
+        };
+
+        if (i + 1 < runs) {
+            sortPool()->start([&done, sortRun]() {
+                sortRun();
+                done.release();
+            });
+        }
+        else {
+            sortRun();
+        }
+    }
+    done.acquire(runs - 1);
+
+    std::vector<T> buffer(items.size());
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged{0};
+        int tasks = 0;
+
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            const size_t start = bounds[i];
+            const size_t middle = bounds[i + 1];
+            const size_t end = i + 2 < bounds.size() ? bounds[i + 2] : middle;
+
+            auto mergeRuns = [&items, &buffer, less, start, middle, end]() {
+                std::merge(items.begin() + start, items.begin() + middle, items.begin() + middle, items.begin() + end, buffer.begin() + start, less);
+            };
+
+            merged.push_back(end);
+
+            if (i + 3 < bounds.size()) {
+                sortPool()->start([&done, mergeRuns]() {
+                    mergeRuns();
+                    done.release();
+                });
+                ++tasks;
+            }
+            else {
+                mergeRuns();
+            }
+        }
+
+        done.acquire(tasks);
+        items.swap(buffer);
+        bounds.swap(merged);
+    }
+}
+
+char foldAscii(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+}
+
+bool lessIgnoringAsciiCase(std::string_view a, std::string_view b)
+{
+    const size_t length = qMin(a.size(), b.size());
+
+    for (size_t i = 0; i < length; ++i) {
+        const uchar x = static_cast<uchar>(foldAscii(a[i]));
+        const uchar y = static_cast<uchar>(foldAscii(b[i]));
+
+        if (x != y)
+            return x < y;
+    }
+
+    return a.size() < b.size();
+}
+
+bool isBlank(char ch)
+{
+    return ch == ' ' || ch == '\t';
+}
+
+// The given field of the line, or an empty view if it doesn't have that many
+std::string_view fieldOf(std::string_view text, const LineTransforms::Context &context)
+{
+    if (context.field <= 0)
+        return text;
+
+    if (context.quoted && !context.separator.isEmpty())
+        return CsvColumns::field(text, context.field - 1, context.separator.at(0));
+
+    size_t start = 0;
+
+    if (context.separator.isEmpty()) {
+        for (int field = 1;; ++field) {
+            while (start < text.size() && isBlank(text[start]))
+                ++start;
+
+            size_t end = start;
+            while (end < text.size() && !isBlank(text[end]))
+                ++end;
+
+            if (field == context.field)
+                return text.substr(start, end - start);
+            if (end == text.size())
+                return std::string_view();
+
+            start = end;
+        }
+    }
+
+    const std::string_view separator(context.separator.constData(), static_cast<size_t>(context.separator.size()));
+
+    for (int field = 1;; ++field) {
+        const size_t end = text.find(separator, start);
+
+        if (field == context.field)
+            return text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if (end == std::string_view::npos)
+            return std::string_view();
+
+        start = end + separator.size();
+    }
+}
+
+// Reads the number at the start of the text, after any blanks
+bool leadingNumber(std::string_view text, double &value)
+{
+    size_t i = 0;
+    while (i < text.size() && isBlank(text[i]))
+        ++i;
+
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+
+    bool digits = false;
+    double number = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+        number = number * 10 + (text[i] - '0');
+        digits = true;
+    }
+
+    if (i < text.size() && text[i] == '.') {
+        double scale = 0.1;
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            number += (text[i] - '0') * scale;
+            scale /= 10;
+            digits = true;
+        }
+    }
+
+    value = negative ? -number : number;
+    return digits;
+}
+
+enum class SortBy {
+    Text,
+    TextIgnoringCase,
+    Number,
+};
+
+// The lines are sorted as an index of keys pointing at them, each key worked out once up front. Lines that compare
+// equal keep their order. Sorting by number, lines without one go first (or last when descending).
+void sortLines(Lines &lines, const LineTransforms::Context &context, SortBy sortBy, bool descending)
+{
+    struct Key {
+        std::string_view text;
+        double number;
+        bool hasNumber;
+        quint32 line;
+    };
+
+    std::vector<Key> keys(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        Key &key = keys[i];
+
+        key.text = fieldOf(lines[i].text, context);
+        key.hasNumber = sortBy == SortBy::Number && leadingNumber(key.text, key.number);
+        key.line = static_cast<quint32>(i);
+    }
+
+    auto less = [sortBy](const Key &a, const Key &b) {
+        switch (sortBy) {
+        case SortBy::Text:
+            return a.text < b.text;
+        case SortBy::TextIgnoringCase:
+            return lessIgnoringAsciiCase(a.text, b.text);
+        case SortBy::Number:
+            if (a.hasNumber != b.hasNumber)
+                return b.hasNumber;
+            return a.hasNumber && a.number < b.number;
+        }
+        return false;
+    };
+
+    if (descending) {
+        parallelSort(keys, [less](const Key &a, const Key &b) { return less(b, a); });
+    }
+    else {
+        parallelSort(keys, less);
+    }
+
+    Lines sorted;
+    sorted.reserve(lines.size());
+    for (const Key &key : keys) {
+        sorted.push_back(lines[key.line]);
+    }
+
+    lines.swap(sorted);
+}
+
+// Flips the case of ASCII letters 8 at a time, so the text must be all ASCII. For each byte, bit 7 of
+// (byte + 0x80 - low) is set when it is at least low and of (byte + 0x80 - high) when it is past the last letter,
+// which picks out the letters without any branches.
+void mapAsciiCase(const char *text, size_t length, char *out, bool upper)
+{
+    constexpr quint64 ONES = 0x0101010101010101ULL;
+    constexpr quint64 HIGH_BITS = 0x80 * ONES;
+    const quint64 low = static_cast<quint64>(0x80 - (upper ? 'a' : 'A')) * ONES;
+    const quint64 high = static_cast<quint64>(0x80 - (upper ? 'z' : 'Z') - 1) * ONES;
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        quint64 v;
+        std::memcpy(&v, text + i, 8);
+
+        const quint64 letters = ((v + low) & ~(v + high)) & HIGH_BITS;
+        v ^= letters >> 2;
+
+        std::memcpy(out + i, &v, 8);
+    }
+
+    for (; i < length; ++i) {
+        const char ch = text[i];
+        const bool isLetter = upper ? (ch >= 'a' && ch <= 'z') : (ch >= 'A' && ch <= 'Z');
+
+        out[i] = isLetter ? static_cast<char>(ch ^ 0x20) : ch;
+    }
+}
+
+// ASCII runs go through mapAsciiCase(), anything else through QString so the rest of Unicode is handled too
+void mapCase(std::string_view text, QByteArray &out, bool upper)
+{
+    size_t i = 0;
+
+    while (i < text.size()) {
+        size_t j = i;
+        while (j < text.size() && static_cast<uchar>(text[j]) < 0x80)
+            ++j;
+
+        if (j > i) {
+            const int start = out.size();
+            out.resize(start + static_cast<int>(j - i));
+            mapAsciiCase(text.data() + i, j - i, out.data() + start, upper);
+            i = j;
+        }
+
+        while (j < text.size() && static_cast<uchar>(text[j]) >= 0x80)
+            ++j;
+
+        if (j > i) {
+            const QString s = QString::fromUtf8(text.data() + i, static_cast<int>(j - i));
+            out.append(upper ? s.toUpper().toUtf8() : s.toLower().toUtf8());
+            i = j;
+        }
+    }
+}
+
+std::string_view trimLeading(std::string_view text)
+{
+    size_t i = 0;
+    while (i < text.size() && isBlank(text[i]))
+        ++i;
+
+    return text.substr(i);
+}
+
+std::string_view trimTrailing(std::string_view text)
+{
+    size_t i = text.size();
+    while (i > 0 && isBlank(text[i - 1]))
+        --i;
+
+    return text.substr(0, i);
+}
+
+void append(QByteArray &out, std::string_view text)
+{
+    out.append(text.data(), static_cast<int>(text.size()));
+}
+
+void tabsToSpaces(std::string_view text, QByteArray &out, const LineTransforms::Context &context)
+{
+    int column = 0;
+    size_t runStart = 0;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char ch = text[i];
+
+        if (ch == '\t') {
+            append(out, text.substr(runStart, i - runStart));
+
+            const int spaces = context.tabWidth - column % context.tabWidth;
+            out.append(spaces, ' ');
+            column += spaces;
+            runStart = i + 1;
+        }
+        else if ((static_cast<uchar>(ch) & 0xC0) != 0x80) {
+            // Count characters, not the bytes of them
+            ++column;
+        }
+    }
+
+    append(out, text.substr(runStart));
+}
+
+}
+
+const QVector<LineTransforms::Transform> &LineTransforms::transforms()
+{
+    static const QVector<Transform> transforms {
+        {
+            QStringLiteral("SortLinesAscending"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines Ascending"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::Text, false); },
+            {}
+        },
+        {
+            QStringLiteral("SortLinesDescending"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines Descending"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::Text, true); },
+            {}
+        },
+        {
+            QStringLiteral("SortLinesIgnoreCase"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines Ascending, Ignoring Case"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::TextIgnoringCase, false); },
+            {}
+        },
+        {
+            QStringLiteral("SortLinesIgnoreCaseDescending"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines Descending, Ignoring Case"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::TextIgnoringCase, true); },
+            {}
+        },
+        {
+            QStringLiteral("SortLinesNumeric"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines as Numbers Ascending"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::Number, false); },
+            {}
+        },
+        {
+            QStringLiteral("SortLinesNumericDescending"), QT_TRANSLATE_NOOP("LineTransforms", "Sort Lines as Numbers Descending"),
+            [](Lines &lines, const Context &context) { sortLines(lines, context, SortBy::Number, true); },
+            {}
+        },
+        {
+            QStringLiteral("ReverseLines"), QT_TRANSLATE_NOOP("LineTransforms", "Reverse Line Order"),
+            [](Lines &lines, const Context &) { std::reverse(lines.begin(), lines.end()); },
+            {}
+        },
+        {
+            // The first of each line is kept where it is
+            QStringLiteral("RemoveDuplicateLines"), QT_TRANSLATE_NOOP("LineTransforms", "Remove Duplicate Lines"),
+            [](Lines &lines, const Context &) {
+                std::unordered_set<std::string_view> seen;
+                seen.reserve(lines.size());
+
+                lines.erase(std::remove_if(lines.begin(), lines.end(), [&](const Line &line) { return !seen.insert(line.text).second; }), lines.end());
+            },
+            {}
+        },
+        {
+            QStringLiteral("TrimTrailingWhitespace"), QT_TRANSLATE_NOOP("LineTransforms", "Trim Trailing Whitespace"),
+            {},
+            [](std::string_view text, QByteArray &out, const Context &) { append(out, trimTrailing(text)); }
+        },
+        {
+            QStringLiteral("TrimLeadingWhitespace"), QT_TRANSLATE_NOOP("LineTransforms", "Trim Leading Whitespace"),
+            {},
+            [](std::string_view text, QByteArray &out, const Context &) { append(out, trimLeading(text)); }
+        },
+        {
+            QStringLiteral("TrimWhitespace"), QT_TRANSLATE_NOOP("LineTransforms", "Trim Leading and Trailing Whitespace"),
+            {},
+            [](std::string_view text, QByteArray &out, const Context &) { append(out, trimTrailing(trimLeading(text))); }
+        },
+        {
+            QStringLiteral("TabsToSpaces"), QT_TRANSLATE_NOOP("LineTransforms", "Convert Tabs to Spaces"),
+            {},
+            tabsToSpaces
+        },
+        {
+            QStringLiteral("UpperCase"), QT_TRANSLATE_NOOP("LineTransforms", "UPPERCASE"),
+            {},
+            [](std::string_view text, QByteArray &out, const Context &) { mapCase(text, out, true); },
+            false
+        },
+        {
+            QStringLiteral("LowerCase"), QT_TRANSLATE_NOOP("LineTransforms", "lowercase"),
+            {},
+            [](std::string_view text, QByteArray &out, const Context &) { mapCase(text, out, false); },
+            false
+        },
+    };
+
+    return transforms;
+}
+
+const LineTransforms::Transform *LineTransforms::find(const QString &name)
+{
+    for (const Transform &transform : transforms()) {
+        if (transform.name == name)
+            return &transform;
+    }
+
+    return Q_NULLPTR;
+}
+
+bool LineTransforms::apply(ScintillaNext *editor, const QString &name, const Context &context)
+{
+    const Transform *transform = find(name);
+
+    return transform ? apply(editor, *transform, context) : false;
+}
+
+bool LineTransforms::apply(ScintillaNext *editor, const Transform &transform, const Context &context)
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (editor->readOnly())
+        return false;
+
+    const QByteArray string = toMacroString(transform.name, context);
+    emit editor->macroRecord(MacroMessage, 0, reinterpret_cast<sptr_t>(string.constData()));
+
+    Context editorContext = context;
+    editorContext.tabWidth = qMax(1, editor->tabWidth());
+
+    return transform.wholeLines ? applyToLines(editor, transform, editorContext) : applyToSelections(editor, transform, editorContext);
+}
+
+QByteArray LineTransforms::toMacroString(const QString &name, const Context &context)
+{
+    QByteArray string = name.toUtf8();
+
+    // A new line can't be a separator of anything within a line, so it separates these
+    if (context.field > 0) {
+        string += '\n' + QByteArray::number(context.field) + '\n' + context.separator;
+
+        if (context.quoted) {
+            string += "\nquoted";
+        }
+    }
+
+    return string;
+}
+
+bool LineTransforms::applyMacroString(ScintillaNext *editor, const QByteArray &string)
+{
+    const QList<QByteArray> parts = string.split('\n');
+    Context context;
+
+    if (parts.size() >= 3) {
+        context.field = parts.at(1).toInt();
+        context.separator = parts.at(2);
+        context.quoted = parts.size() >= 4 && parts.at(3) == "quoted";
+    }
+
+    return apply(editor, QString::fromUtf8(parts.first()), context);
+}
+
+bool LineTransforms::applyToLines(ScintillaNext *editor, const Transform &transform, const Context &context)
+{
+    // Every line any of the selections touch, or all of them if nothing is selected
+    int firstLine = 0;
+    int lastLine = editor->lineCount() - 1;
+
+    if (!editor->selectionEmpty()) {
+        Sci_Position start = editor->length();
+        Sci_Position end = 0;
+
+        for (int i = 0; i < editor->selections(); ++i) {
+            start = qMin(start, editor->selectionNStart(i));
+            end = qMax(end, editor->selectionNEnd(i));
+        }
+
+        firstLine = editor->lineFromPosition(start);
+        lastLine = editor->lineFromPosition(end);
+
+        // A selection ending at the very start of a line doesn't include it
+        if (lastLine > firstLine && editor->positionFromLine(lastLine) == end)
+            --lastLine;
+    }
+
+    const Sci_Position spanStart = editor->positionFromLine(firstLine);
+    const Sci_Position spanEnd = editor->lineEndPosition(lastLine);
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(spanStart, spanEnd - spanStart));
+    const size_t length = static_cast<size_t>(spanEnd - spanStart);
+
+    Lines lines;
+    lines.reserve(lastLine - firstLine + 1);
+
+    size_t lineStart = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] == '\n' || text[i] == '\r') {
+            const size_t eolLength = (text[i] == '\r' && i + 1 < length && text[i + 1] == '\n') ? 2 : 1;
+
+            lines.push_back({std::string_view(text + lineStart, i - lineStart), std::string_view(text + i, eolLength)});
+            i += eolLength - 1;
+            lineStart = i + 1;
+        }
+    }
+    lines.push_back({std::string_view(text + lineStart, length - lineStart), std::string_view()});
+
+    const size_t originalSize = lines.size();
+
+    if (transform.reorder) {
+        transform.reorder(lines, context);
+    }
+
+    // Lines keep the end of line they had. The one that used to be last goes by the document's, should it move.
+    const QByteArray documentEol = editor->eolString();
+    QByteArray newText;
+    newText.reserve(static_cast<int>(length + (transform.rewrite ? length / 8 : 0)));
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const Line &line = lines[i];
+
+        if (transform.rewrite) {
+            transform.rewrite(line.text, newText, context);
+        }
+        else {
+            append(newText, line.text);
+        }
+
+        if (i + 1 < lines.size()) {
+            if (line.eol.empty()) {
+                newText.append(documentEol);
+            }
+            else {
+                append(newText, line.eol);
+            }
+        }
+    }
+
+    if (lines.size() == originalSize && static_cast<size_t>(newText.size()) == length && std::memcmp(newText.constData(), text, length) == 0)
+        return false;
+
+    const BulkEdit be(editor);
+    editor->replaceRanges({{static_cast<Sci_PositionCR>(spanStart), static_cast<Sci_PositionCR>(spanEnd)}}, newText);
+    editor->setSel(spanStart, spanStart + newText.size());
+
+    return true;
+}
+
+bool LineTransforms::applyToSelections(ScintillaNext *editor, const Transform &transform, const Context &context)
+{
+    std::vector<Sci_CharacterRange> ranges;
+
+    for (int i = 0; i < editor->selections(); ++i) {
+        const Sci_PositionCR start = static_cast<Sci_PositionCR>(editor->selectionNStart(i));
+        const Sci_PositionCR end = static_cast<Sci_PositionCR>(editor->selectionNEnd(i));
+
+        if (start < end)
+            ranges.push_back({start, end});
+    }
+
+    if (ranges.empty())
+        return false;
+
+    std::sort(ranges.begin(), ranges.end(), [](const Sci_CharacterRange &a, const Sci_CharacterRange &b) { return a.cpMin < b.cpMin; });
+
+    QVector<QByteArray> replacements;
+    replacements.reserve(static_cast<int>(ranges.size()));
+
+    bool changed = false;
+    for (const Sci_CharacterRange &range : ranges) {
+        const size_t length = static_cast<size_t>(range.cpMax - range.cpMin);
+        const char *text = reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, range.cpMax - range.cpMin));
+
+        QByteArray replacement;
+        replacement.reserve(static_cast<int>(length));
+        transform.rewrite(std::string_view(text, length), replacement, context);
+
+        changed = changed || static_cast<size_t>(replacement.size()) != length || std::memcmp(replacement.constData(), text, length) != 0;
+        replacements.append(replacement);
+    }
+
+    if (!changed)
+        return false;
+
+    const BulkEdit be(editor);
+    editor->replaceRanges(ranges, replacements);
+
+    // Keep what was selected selected
+    std::vector<Sci_CharacterRange> selections;
+    selections.reserve(ranges.size());
+
+    qint64 offset = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const Sci_PositionCR start = static_cast<Sci_PositionCR>(ranges[i].cpMin + offset);
+        const int replacementLength = replacements[static_cast<int>(i)].size();
+
+        selections.push_back({start, static_cast<Sci_PositionCR>(start + replacementLength)});
+        offset += replacementLength - (ranges[i].cpMax - ranges[i].cpMin);
+    }
+
+    editor->selectRanges(selections, 0);
+
+    return true;
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LINETRANSFORMS_H
+#define LINETRANSFORMS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "ScintillaMessages.h"
+
+#include <functional>
+#include <string_view>
+#include <vector>
+
+class ScintillaNext;
+
+
+// The operations in the Line Operations menu that sort, dedupe, trim, etc. Each one works on a view of the lines
+// of the selection (or of the whole document if nothing is selected) that points into the editor's own buffer, so
+// lines are never copied one by one, and the result is put back as a single replacement. They are looked up by
+// name so they can also be run from Lua (editor:Transform(name)) and recorded in macros.
+class LineTransforms
+{
+public:
+    // A line and the end of line that follows it, which is empty for the last line
+    struct Line {
+        std::string_view text;
+        std::string_view eol;
+    };
+    using Lines = std::vector<Line>;
+
+    struct Context {
+        // Sorts compare this field of each line (1 based) instead of the whole line. Fields are split at separator,
+        // or at runs of spaces and tabs if it is empty.
+        int field = 0;
+        QByteArray separator;
+
+        // Split the fields as CSV, where a quoted field can contain the separator (its first character)
+        bool quoted = false;
+
+        // Filled in from the editor
+        int tabWidth = 4;
+    };
+
+    struct Transform {
+        QString name;
+        const char *title;
+
+        // Rearranges or drops lines...
+        std::function<void(Lines &lines, const Context &context)> reorder;
+
+        // ...or appends a new version of each line to out
+        std::function<void(std::string_view text, QByteArray &out, const Context &context)> rewrite;
+
+        // Otherwise rewrite() is given exactly what is selected, once for each selection
+        bool wholeLines = true;
+    };
+
+    // Recorded in macros as a step with the name of the transform. It is never sent to Scintilla.
+    static constexpr Scintilla::Message MacroMessage = static_cast<Scintilla::Message>(3900);
+
+    static const QVector<Transform> &transforms();
+    static const Transform *find(const QString &name);
+
+    // Returns false if the text was left as it was
+    static bool apply(ScintillaNext *editor, const Transform &transform, const Context &context = Context());
+    static bool apply(ScintillaNext *editor, const QString &name, const Context &context = Context());
+
+    // What a macro step holds: the name, followed by the field, separator and whether it is quoted if there is one
+    static QByteArray toMacroString(const QString &name, const Context &context);
+    static bool applyMacroString(ScintillaNext *editor, const QByteArray &string);
+
+    // Lines at least this many are sorted in parallel, as a merge of separately sorted runs
+    static const int PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+private:
+    static bool applyToLines(ScintillaNext *editor, const Transform &transform, const Context &context);
+    static bool applyToSelections(ScintillaNext *editor, const Transform &transform, const Context &context);
+};
+
+#endif // LINETRANSFORMS_H
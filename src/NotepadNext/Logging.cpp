@@ -0,0 +1,27 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "Logging.h"
+
+
+Q_LOGGING_CATEGORY(lcEditor, "notepadnext.editor", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcFile, "notepadnext.file", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcSearch, "notepadnext.search", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcMacro, "notepadnext.macro", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcUi, "notepadnext.ui", QtInfoMsg)
@@ -0,0 +1,36 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// Messages logged with qCDebug() to these categories only cost a check of a flag when the category is
+// disabled, which they are by default. They can be turned on at runtime with the --log-rules option or
+// the QT_LOGGING_RULES environment variable, e.g. "notepadnext.file.debug=true". Release builds define
+// QT_NO_DEBUG_OUTPUT, which removes qCDebug() calls completely.
+
+Q_DECLARE_LOGGING_CATEGORY(lcEditor)
+Q_DECLARE_LOGGING_CATEGORY(lcFile)
+Q_DECLARE_LOGGING_CATEGORY(lcSearch)
+Q_DECLARE_LOGGING_CATEGORY(lcMacro)
+Q_DECLARE_LOGGING_CATEGORY(lcUi)
+
+#endif // LOGGING_H
@@ -0,0 +1,43 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LuaBytecodeBundle.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+
+const LuaBytecodeBundle::Chunk *LuaBytecodeBundle::find(const char *name)
+{
+#ifdef LUA_BYTECODE_BUNDLE
+    const Chunk *end = chunks + chunkCount;
+    const Chunk *chunk = std::lower_bound(chunks, end, name, [](const Chunk &c, const char *n) {
+        return std::strcmp(c.name, n) < 0;
+    });
+
+    if (chunk != end && std::strcmp(chunk->name, name) == 0) {
+        return chunk;
+    }
+#else
+    Q_UNUSED(name);
+#endif
+
+    return Q_NULLPTR;
+}
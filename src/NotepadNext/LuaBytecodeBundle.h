@@ -0,0 +1,45 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LUABYTECODEBUNDLE_H
+#define LUABYTECODEBUNDLE_H
+
+#include <cstddef>
+
+// The application's Lua scripts and language definitions, compiled to bytecode at build time
+// by the LuaBytecode tool so they don't need to be parsed at start up. Builds that can't run the
+// tool (e.g. cross compiling) leave it empty and the sources are loaded from the resources instead.
+namespace LuaBytecodeBundle {
+
+struct Chunk {
+    // Path relative to the resource root, e.g. "languages/cpp.lua"
+    const char *name;
+    const unsigned char *data;
+    size_t size;
+};
+
+const Chunk *find(const char *name);
+
+// Defined in the generated source, sorted by name
+extern const Chunk chunks[];
+extern const size_t chunkCount;
+
+}
+
+#endif // LUABYTECODEBUNDLE_H
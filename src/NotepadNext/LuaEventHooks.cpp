@@ -0,0 +1,334 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LuaEventHooks.h"
+#include "LuaProfiler.h"
+#include "ScintillaNext.h"
+
+#include "lua.hpp"
+
+#include <QTimer>
+
+using namespace Scintilla;
+
+
+// A handler that spends more than this much of any window running is turned off
+const qint64 BUDGET_WINDOW_MS = 1000;
+const qint64 BUDGET_MS = 200;
+
+static const struct {
+    const char *name;
+    int defaultInterval;
+} events[LuaEventHooks::EventCount] = {
+    {"OnChar", 0},
+    {"OnModification", 100},
+    {"OnUpdateUI", 50},
+    {"OnSave", 0},
+    {"OnSwitchFile", 0},
+};
+
+LuaEventHooks::LuaEventHooks(lua_State *L, QObject *parent) :
+    QObject(parent),
+    L(L)
+{
+    lua_getglobal(L, "nn");
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setglobal(L, "nn");
+    }
+
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, luaAddEventHandler, 1);
+    lua_setfield(L, -2, "addEventHandler");
+
+    lua_pushlightuserdata(L, this);
+    lua_pushcclosure(L, luaRemoveEventHandler, 1);
+    lua_setfield(L, -2, "removeEventHandler");
+
+    lua_pop(L, 1);
+}
+
+int LuaEventHooks::addHandler(Event event, int functionRef, int minInterval)
+{
+    const int id = nextId++;
+
+    Handler handler;
+    handler.event = event;
+    handler.functionRef = functionRef;
+    handler.minInterval = minInterval < 0 ? events[event].defaultInterval : minInterval;
+    handler.timer = new QTimer(this);
+    handler.timer->setSingleShot(true);
+    connect(handler.timer, &QTimer::timeout, this, [=]() { run(id); });
+
+    if (event == Modified && activeEditor) {
+        activeEditor->trackChangedRanges(handler.timer);
+    }
+
+    handlers.insert(id, handler);
+
+    return id;
+}
+
+bool LuaEventHooks::removeHandler(int id)
+{
+    auto it = handlers.find(id);
+    if (it == handlers.end()) {
+        return false;
+    }
+
+    luaL_unref(L, LUA_REGISTRYINDEX, it->functionRef);
+
+    // It may be the handler that is running right now
+    it->timer->stop();
+    it->timer->deleteLater();
+    handlers.erase(it);
+
+    return true;
+}
+
+bool LuaEventHooks::eventFromName(const char *name, Event &event)
+{
+    for (int i = 0; i < EventCount; ++i) {
+        if (qstrcmp(events[i].name, name) == 0) {
+            event = static_cast<Event>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char *LuaEventHooks::eventName(Event event)
+{
+    return events[event].name;
+}
+
+void LuaEventHooks::watchEditor(ScintillaNext *editor)
+{
+    connect(editor, &ScintillaEdit::notify, this, [=](const NotificationData *pscn) {
+        if (editor != activeEditor) {
+            return;
+        }
+
+        if (pscn->nmhdr.code == Notification::CharAdded) {
+            for (Handler &handler : handlers) {
+                if (handler.event == CharAdded) {
+                    handler.lastChar = pscn->ch;
+                    handler.charCount++;
+                }
+            }
+            raise(CharAdded);
+        }
+        else if (pscn->nmhdr.code == Notification::UpdateUI) {
+            // Edits are picked up here rather than from every modification, the range says what they were
+            if (FlagSet(pscn->updated, Update::Content)) {
+                raise(Modified);
+            }
+            raise(UpdateUI);
+        }
+    });
+
+    connect(editor, &ScintillaNext::saved, this, [=]() {
+        for (Handler &handler : handlers) {
+            if (handler.event == Saved) {
+                handler.savedFilePath = editor->getFilePath();
+            }
+        }
+        raise(Saved);
+    });
+}
+
+void LuaEventHooks::editorActivated(ScintillaNext *editor)
+{
+    activeEditor = editor;
+
+    // Whatever happened to it while it was in the background is not news to the handlers
+    for (const Handler &handler : handlers) {
+        if (handler.event == Modified) {
+            editor->trackChangedRanges(handler.timer);
+            editor->takeChangedRange(handler.timer);
+        }
+    }
+
+    raise(BufferActivated);
+}
+
+void LuaEventHooks::raise(Event event)
+{
+    for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+        if (it->event == event) {
+            schedule(it.key());
+        }
+    }
+}
+
+void LuaEventHooks::schedule(int id)
+{
+    Handler &handler = handlers[id];
+
+    // An event that comes in while the call is waiting is folded into it
+    if (handler.timer->isActive()) {
+        return;
+    }
+
+    qint64 wait = 0;
+    if (handler.lastRun.isValid()) {
+        wait = qMax(Q_INT64_C(0), handler.minInterval - handler.lastRun.elapsed());
+    }
+
+    handler.timer->start(static_cast<int>(wait));
+}
+
+void LuaEventHooks::run(int id)
+{
+    auto it = handlers.find(id);
+    if (it == handlers.end()) {
+        return;
+    }
+
+    // A script that is already running (e.g. one that opened a dialog) is not interrupted, it is tried again later
+    if (running) {
+        it->timer->start(qMax(it->minInterval, 1));
+        return;
+    }
+
+    if (it->event == Modified) {
+        if (!activeEditor) {
+            return;
+        }
+
+        // Styling and markers update the content too, but there is nothing to tell the handler about
+        const ScintillaNext::ChangedRange range = activeEditor->takeChangedRange(it->timer);
+        if (range.isEmpty()) {
+            return;
+        }
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, it->functionRef);
+        lua_pushstring(L, eventName(it->event));
+        lua_newtable(L);
+        lua_pushinteger(L, range.start);
+        lua_setfield(L, -2, "startPos");
+        lua_pushinteger(L, range.end);
+        lua_setfield(L, -2, "endPos");
+    }
+    else {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, it->functionRef);
+        lua_pushstring(L, eventName(it->event));
+        pushInfo(it.value());
+    }
+
+    it->lastRun.start();
+
+    running = true;
+    QElapsedTimer callTimer;
+    callTimer.start();
+    const int result = LuaProfiler::pcall(L, 2, 0, 0);
+    const qint64 elapsed = callTimer.nsecsElapsed();
+    running = false;
+
+    if (result != LUA_OK) {
+        qWarning("Lua %s handler failed: %s", eventName(it->event), lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+
+    // The handler could have removed itself, or others, so it has to be found again
+    it = handlers.find(id);
+    if (it == handlers.end()) {
+        return;
+    }
+
+    if (!it->budgetWindow.isValid() || it->budgetWindow.elapsed() > BUDGET_WINDOW_MS) {
+        it->budgetWindow.start();
+        it->usedNs = 0;
+    }
+
+    it->usedNs += elapsed;
+
+    if (it->usedNs > BUDGET_MS * 1000000) {
+        disableHandler(id, it->usedNs / 1000000);
+    }
+}
+
+void LuaEventHooks::pushInfo(Handler &handler)
+{
+    lua_newtable(L);
+
+    switch (handler.event) {
+    case CharAdded:
+        lua_pushinteger(L, handler.lastChar);
+        lua_setfield(L, -2, "ch");
+        lua_pushinteger(L, handler.charCount);
+        lua_setfield(L, -2, "count");
+        handler.charCount = 0;
+        break;
+    case Saved:
+        lua_pushstring(L, handler.savedFilePath.toUtf8().constData());
+        lua_setfield(L, -2, "path");
+        handler.savedFilePath.clear();
+        break;
+    case BufferActivated:
+        if (activeEditor) {
+            lua_pushstring(L, activeEditor->getFilePath().toUtf8().constData());
+            lua_setfield(L, -2, "path");
+            lua_pushstring(L, activeEditor->getName().toUtf8().constData());
+            lua_setfield(L, -2, "name");
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void LuaEventHooks::disableHandler(int id, qint64 usedMs)
+{
+    qWarning("Lua %s handler %d took %lld ms in under %lld ms and has been turned off",
+             eventName(handlers[id].event), id, usedMs, BUDGET_WINDOW_MS);
+
+    removeHandler(id);
+}
+
+int LuaEventHooks::luaAddEventHandler(lua_State *L)
+{
+    LuaEventHooks *hooks = static_cast<LuaEventHooks *>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    const char *name = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    const lua_Integer minInterval = luaL_optinteger(L, 3, -1);
+
+    Event event;
+    if (!eventFromName(name, event)) {
+        return luaL_error(L, "unknown event '%s'", name);
+    }
+
+    lua_pushvalue(L, 2);
+    const int functionRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    lua_pushinteger(L, hooks->addHandler(event, functionRef, static_cast<int>(minInterval)));
+    return 1;
+}
+
+int LuaEventHooks::luaRemoveEventHandler(lua_State *L)
+{
+    LuaEventHooks *hooks = static_cast<LuaEventHooks *>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    lua_pushboolean(L, hooks->removeHandler(static_cast<int>(luaL_checkinteger(L, 1))));
+    return 1;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LUAEVENTHOOKS_H
+#define LUAEVENTHOOKS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+struct lua_State;
+class QTimer;
+class ScintillaNext;
+
+
+// Lets scripts run a function when something happens in the editor without the interpreter being entered for
+// every keystroke. A handler runs once the notification that triggered it is over, never from inside it, and no
+// more often than its minimum interval, so a burst of events ends up as one call. The edits made since a
+// modification handler last ran are handed to it as a single range. The time each handler takes is added up and
+// one that goes over its share is turned off.
+//
+// From Lua: id = nn.addEventHandler("OnChar", function(event, info) ... end [, minIntervalMs]), and
+// nn.removeEventHandler(id). The events are OnChar, OnModification, OnUpdateUI, OnSave and OnSwitchFile.
+class LuaEventHooks : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Event {
+        CharAdded,
+        Modified,
+        UpdateUI,
+        Saved,
+        BufferActivated,
+        EventCount
+    };
+
+    explicit LuaEventHooks(lua_State *L, QObject *parent = Q_NULLPTR);
+
+    // Takes ownership of the registry reference to the function, a negative interval uses the event's default
+    int addHandler(Event event, int functionRef, int minInterval = -1);
+    bool removeHandler(int id);
+
+    static bool eventFromName(const char *name, Event &event);
+    static const char *eventName(Event event);
+
+public slots:
+    void watchEditor(ScintillaNext *editor);
+    void editorActivated(ScintillaNext *editor);
+
+private:
+    struct Handler {
+        Event event;
+        int functionRef;
+        int minInterval;
+
+        // Also the key the active editor keeps the handler's changed range under
+        QTimer *timer;
+        QElapsedTimer lastRun;
+
+        // What has happened since it last ran
+        int lastChar = 0;
+        int charCount = 0;
+        QString savedFilePath;
+
+        QElapsedTimer budgetWindow;
+        qint64 usedNs = 0;
+    };
+
+    void raise(Event event);
+    void schedule(int id);
+    void run(int id);
+    void pushInfo(Handler &handler);
+    void disableHandler(int id, qint64 usedMs);
+
+    static int luaAddEventHandler(lua_State *L);
+    static int luaRemoveEventHandler(lua_State *L);
+
+    lua_State *L;
+    QHash<int, Handler> handlers;
+    int nextId = 1;
+    bool running = false;
+    QPointer<ScintillaNext> activeEditor;
+};
+
+#endif // LUAEVENTHOOKS_H
@@ -26,9 +26,13 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <algorithm>
 
 #include "Scintilla.h"
 #include "LuaExtension.h"
+#include "LuaProfiler.h"
+#include "BulkEdit.h"
+#include "LineTransforms.h"
 
 #include "IFaceTableMixer.h"
 #include "SciIFaceTable.h"
@@ -273,7 +277,7 @@ static int cf_global_print(lua_State *L) {
             }
         }
 
-        int result = lua_pcall(L, nargs, ignoreFunctionReturnValue ? 0 : 1, traceback);
+        int result = LuaProfiler::pcall(L, nargs, ignoreFunctionReturnValue ? 0 : 1, traceback);
 
         if (traceback) {
             lua_remove(L, traceback);
@@ -475,28 +479,15 @@ static int cf_pane_iface_function(lua_State *L) {
     }
 }
 
-static int push_iface_function(lua_State *L, const char *name, IFaceTableInterface *iface) {
-    auto func = iface->FindFunction(name);
-    if (func != nullptr) {
-        if (IFaceFunctionIsScriptable(*func)) {
-            lua_pushlightuserdata(L, (void*)func);
-            lua_pushcclosure(L, cf_pane_iface_function, 1);
-
-            // Since Lua experts say it is inefficient to create closures / cfunctions
-            // in an inner loop, I tried caching the closures in the metatable, and looking
-            // for them there first.  However, it made very little difference and did not
-            // seem worth the added complexity. - WBD
-
-            return 1;
-        }
-    }
-    return -1; // signal to try next pane index handler
+static int push_iface_function(lua_State *L, const IFaceFunction *func) {
+    lua_pushlightuserdata(L, (void*)func);
+    lua_pushcclosure(L, cf_pane_iface_function, 1);
+    return 1;
 }
 
-static int push_iface_propval(lua_State *L, const char *name, IFaceTableInterface *iface) {
+static int push_iface_propval(lua_State *L, const IFaceProperty *prop) {
     // this function doesn't raise errors, but returns 0 if the function is not handled.
 
-    auto prop = iface->FindProperty(name);
     if (prop != nullptr) {
         if (!IFacePropertyIsScriptable(*prop)) {
             raise_error(L, "Error: iface property is not scriptable.");
@@ -554,16 +545,64 @@ static int push_iface_propval(lua_State *L, const char *name, IFaceTableInterfac
     return -1; // signal to try next pane index handler
 }
 
+// Resolving a name against the iface table is a binary search with strcmp, and
+// scripts touch editor.Foo in tight loops. The pane metatable keeps a cache
+// table (upvalue 2 of __index/__newindex) mapping each name to what it resolved
+// to the first time: the function closure, the property as light userdata, or
+// false when the name is neither. The resolved value is left on the stack.
+// Anything other than a table in the upvalue resolves the name every time,
+// which the benchmarks use to measure what the cache saves.
+static int resolve_pane_name(lua_State *L, int nameIndex, IFaceTableInterface *iface) {
+    int cacheIndex = lua_upvalueindex(2);
+    bool cached = lua_istable(L, cacheIndex);
+
+    if (cached) {
+        lua_pushvalue(L, nameIndex);
+        int type = lua_rawget(L, cacheIndex);
+        if (type != LUA_TNIL)
+            return type;
+        lua_pop(L, 1);
+    }
+
+    const char *name = lua_tostring(L, nameIndex);
+    auto func = iface->FindFunction(name);
+    if (func != nullptr && IFaceFunctionIsScriptable(*func)) {
+        push_iface_function(L, func);
+    } else {
+        auto prop = iface->FindProperty(name);
+        if (prop != nullptr) {
+            lua_pushlightuserdata(L, (void*)prop);
+        } else {
+            lua_pushboolean(L, 0);
+        }
+    }
+
+    if (cached) {
+        lua_pushvalue(L, nameIndex);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, cacheIndex);
+    }
+
+    return lua_type(L, -1);
+}
+
 static int cf_pane_metatable_index(lua_State *L) {
     IFaceTableInterface *iface = static_cast<IFaceTableInterface *>(lua_touserdata(L, lua_upvalueindex(1)));
     if (lua_isstring(L, 2)) {
-        const char *name = lua_tostring(L, 2);
-
-        // these return the number of values pushed (possibly 0), or -1 if no match
-        int results = push_iface_function(L, name, iface);
-        if (results < 0)
-            results = push_iface_propval(L, name, iface);
+        // push_iface_propval returns the number of values pushed (possibly 0), or -1 if no match
+        int results = -1;
+        int type = resolve_pane_name(L, 2, iface);
+        if (type == LUA_TFUNCTION) {
+            return 1;
+        } else if (type == LUA_TLIGHTUSERDATA) {
+            const IFaceProperty *prop = static_cast<const IFaceProperty *>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+            results = push_iface_propval(L, prop);
+        } else {
+            lua_pop(L, 1);
+        }
 
+        const char *name = lua_tostring(L, 2);
         if (results >= 0) {
             return results;
         } else if (name[0] != '_') {
@@ -584,7 +623,14 @@ static int cf_pane_metatable_index(lua_State *L) {
 static int cf_pane_metatable_newindex(lua_State *L) {
     IFaceTableInterface *iface = static_cast<IFaceTableInterface *>(lua_touserdata(L, lua_upvalueindex(1)));
     if (lua_isstring(L, 2)) {
-        auto prop = iface->FindProperty(lua_tostring(L, 2));
+        const IFaceProperty *prop = nullptr;
+        int type = resolve_pane_name(L, 2, iface);
+        if (type == LUA_TLIGHTUSERDATA)
+            prop = static_cast<const IFaceProperty *>(lua_touserdata(L, -1));
+        else if (type == LUA_TFUNCTION)
+            prop = iface->FindProperty(lua_tostring(L, 2)); // functions shadow properties in the cache
+        lua_pop(L, 1);
+
         if (prop != nullptr) {
             if (IFacePropertyIsScriptable(*prop)) {
                 if (prop->setter) {
@@ -617,18 +663,214 @@ static int cf_pane_metatable_newindex(lua_State *L) {
     return 0;
 }
 
+// Bulk helpers published on the pane metatable. Scripts that work over a whole
+// document would otherwise cross into C and dispatch a Scintilla message for
+// every line they read or change.
+
+// editor:GetLines([first [, last]]) -> table of line strings (without line endings)
+static int cf_pane_get_lines(lua_State *L) {
+    check_pane_object(L, 1);
+
+    const sptr_t lineCount = editor->send(SCI_GETLINECOUNT);
+    const sptr_t first = static_cast<sptr_t>(luaL_optinteger(L, 2, 0));
+    const sptr_t last = static_cast<sptr_t>(luaL_optinteger(L, 3, lineCount - 1));
+
+    if (first < 0 || last >= lineCount || first > last + 1) {
+        raise_error(L, "GetLines: line range out of bounds");
+        return 0;
+    }
+
+    const char *text = reinterpret_cast<const char *>(editor->send(SCI_GETCHARACTERPOINTER));
+
+    lua_createtable(L, static_cast<int>(last - first + 1), 0);
+    for (sptr_t line = first; line <= last; ++line) {
+        const sptr_t start = editor->send(SCI_POSITIONFROMLINE, line);
+        const sptr_t end = editor->send(SCI_GETLINEENDPOSITION, line);
+
+        lua_pushlstring(L, text + start, static_cast<size_t>(end - start));
+        lua_rawseti(L, -2, static_cast<lua_Integer>(line - first + 1));
+    }
+
+    return 1;
+}
+
+// editor:ApplyEdits({{start, end, text}, ...}) -> number of edits applied
+// Ranges may be given in any order but must not overlap. They are applied back
+// to front as a single undo action.
+static int cf_pane_apply_edits(lua_State *L) {
+    check_pane_object(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    ScintillaNext *sn = qobject_cast<ScintillaNext *>(editor);
+    if (sn == Q_NULLPTR) {
+        raise_error(L, "ApplyEdits: no editor");
+        return 0;
+    }
+
+    struct Edit {
+        Sci_CharacterRange range;
+        QByteArray text;
+    };
+    std::vector<Edit> edits;
+
+    const sptr_t length = editor->send(SCI_GETLENGTH);
+    const lua_Integer count = luaL_len(L, 2);
+    edits.reserve(static_cast<size_t>(count));
+
+    for (lua_Integer i = 1; i <= count; ++i) {
+        if (lua_rawgeti(L, 2, i) != LUA_TTABLE) {
+            raise_ferror(L, "ApplyEdits: edit %d is not a {start, end, text} table", static_cast<int>(i));
+            return 0;
+        }
+
+        lua_rawgeti(L, -1, 1);
+        lua_rawgeti(L, -2, 2);
+        lua_rawgeti(L, -3, 3);
+
+        int isnum = 0;
+        const lua_Integer start = lua_tointegerx(L, -3, &isnum);
+        if (!isnum) {
+            raise_ferror(L, "ApplyEdits: edit %d has no start position", static_cast<int>(i));
+            return 0;
+        }
+        const lua_Integer end = lua_tointegerx(L, -2, &isnum);
+        if (!isnum) {
+            raise_ferror(L, "ApplyEdits: edit %d has no end position", static_cast<int>(i));
+            return 0;
+        }
+        if (start < 0 || end < start || end > length) {
+            raise_ferror(L, "ApplyEdits: edit %d range is out of bounds", static_cast<int>(i));
+            return 0;
+        }
+
+        size_t textLength = 0;
+        const char *text = lua_tolstring(L, -1, &textLength);
+
+        Edit edit;
+        edit.range.cpMin = static_cast<Sci_PositionCR>(start);
+        edit.range.cpMax = static_cast<Sci_PositionCR>(end);
+        if (text)
+            edit.text = QByteArray(text, static_cast<int>(textLength));
+        edits.push_back(edit);
+
+        lua_pop(L, 4);
+    }
+
+    std::stable_sort(edits.begin(), edits.end(), [](const Edit &a, const Edit &b) {
+        return a.range.cpMin < b.range.cpMin;
+    });
+
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+    ranges.reserve(edits.size());
+    replacements.reserve(static_cast<int>(edits.size()));
+
+    for (size_t i = 0; i < edits.size(); ++i) {
+        if (i > 0 && edits[i].range.cpMin < edits[i - 1].range.cpMax) {
+            raise_error(L, "ApplyEdits: edit ranges overlap");
+            return 0;
+        }
+
+        ranges.push_back(edits[i].range);
+        replacements.append(edits[i].text);
+    }
+
+    if (!ranges.empty()) {
+        BulkEdit be(sn);
+        sn->replaceRanges(ranges, replacements);
+    }
+
+    lua_pushinteger(L, static_cast<lua_Integer>(ranges.size()));
+    return 1;
+}
+
+// editor:GetStyles(start, end) -> string with one style byte per document byte
+static int cf_pane_get_styles(lua_State *L) {
+    check_pane_object(L, 1);
+
+    const sptr_t length = editor->send(SCI_GETLENGTH);
+    const sptr_t start = static_cast<sptr_t>(luaL_checkinteger(L, 2));
+    const sptr_t end = static_cast<sptr_t>(luaL_optinteger(L, 3, length));
+
+    if (start < 0 || end < start || end > length) {
+        raise_error(L, "GetStyles: range out of bounds");
+        return 0;
+    }
+
+    // SCI_GETSTYLEDTEXTFULL interleaves each character with its style and adds two terminating zero bytes
+    std::vector<char> styled(static_cast<size_t>(end - start) * 2 + 2);
+    Sci_TextRangeFull tr;
+    tr.chrg.cpMin = start;
+    tr.chrg.cpMax = end;
+    tr.lpstrText = styled.data();
+    editor->send(SCI_GETSTYLEDTEXTFULL, 0, reinterpret_cast<sptr_t>(&tr));
+
+    luaL_Buffer b;
+    char *styles = luaL_buffinitsize(L, &b, static_cast<size_t>(end - start));
+    for (sptr_t i = 0; i < end - start; ++i) {
+        styles[i] = styled[static_cast<size_t>(i) * 2 + 1];
+    }
+    luaL_pushresultsize(&b, static_cast<size_t>(end - start));
+
+    return 1;
+}
+
+// editor:Transform(name [, field [, separator]]) -> true if the text was changed
+// Runs one of the LineTransforms, e.g. "SortLinesAscending" or "RemoveDuplicateLines", on the selection.
+// Sorts compare the given field of each line when there is one.
+static int cf_pane_transform(lua_State *L) {
+    check_pane_object(L, 1);
+    const char *name = luaL_checkstring(L, 2);
+
+    LineTransforms::Context context;
+    context.field = static_cast<int>(luaL_optinteger(L, 3, 0));
+    size_t separatorLength = 0;
+    const char *separator = luaL_optlstring(L, 4, "", &separatorLength);
+    context.separator = QByteArray(separator, static_cast<int>(separatorLength));
+
+    ScintillaNext *sn = qobject_cast<ScintillaNext *>(editor);
+    if (sn == Q_NULLPTR) {
+        raise_error(L, "Transform: no editor");
+        return 0;
+    }
+
+    const LineTransforms::Transform *transform = LineTransforms::find(QString::fromUtf8(name));
+    if (transform == Q_NULLPTR) {
+        raise_ferror(L, "Transform: unknown transform '%s'", name);
+        return 0;
+    }
+
+    lua_pushboolean(L, LineTransforms::apply(sn, *transform, context));
+    return 1;
+}
+
 void push_pane_object(lua_State *L, NppExtensionAPIPane p) {
     *static_cast<NppExtensionAPIPane *>(lua_newuserdata(L, sizeof(p))) = p;
     if (luaL_newmetatable(L, "Nn_MT_Pane")) {
+        // name resolution cache shared by __index and __newindex
+        lua_newtable(L);
+
         lua_pushlightuserdata(L, &SciIFaceTable);
-        lua_pushcclosure(L, cf_pane_metatable_index, 1);
-        lua_setfield(L, -2, "__index");
+        lua_pushvalue(L, -2);
+        lua_pushcclosure(L, cf_pane_metatable_index, 2);
+        lua_setfield(L, -3, "__index");
         lua_pushlightuserdata(L, &SciIFaceTable);
-        lua_pushcclosure(L, cf_pane_metatable_newindex, 1);
-        lua_setfield(L, -2, "__newindex");
+        lua_pushvalue(L, -2);
+        lua_pushcclosure(L, cf_pane_metatable_newindex, 2);
+        lua_setfield(L, -3, "__newindex");
+
+        lua_pop(L, 1);
 
         // Push built-in functions into the metatable, where the custom
         // __index metamethod will find them.
+        lua_pushcfunction(L, cf_pane_get_lines);
+        lua_setfield(L, -2, "GetLines");
+        lua_pushcfunction(L, cf_pane_apply_edits);
+        lua_setfield(L, -2, "ApplyEdits");
+        lua_pushcfunction(L, cf_pane_get_styles);
+        lua_setfield(L, -2, "GetStyles");
+        lua_pushcfunction(L, cf_pane_transform);
+        lua_setfield(L, -2, "Transform");
     }
     lua_setmetatable(L, -2);
 }
@@ -755,7 +997,7 @@ bool LuaExtension::RunString(const char *s) {
         int status = luaL_loadbuffer(luaState, s, strlen(s), "=File");
 
         if (status == LUA_OK) {
-            status = lua_pcall(luaState, 0, LUA_MULTRET, 0);
+            status = LuaProfiler::pcall(luaState, 0, LUA_MULTRET, 0);
         }
 
         if (status != LUA_OK) {
@@ -787,13 +1029,13 @@ bool LuaExtension::OnExecute(const char *s) {
 
             if (status == LUA_OK) {
                 // It worked, let's call it
-                status = lua_pcall(luaState, 0, LUA_MULTRET, 0);
+                status = LuaProfiler::pcall(luaState, 0, LUA_MULTRET, 0);
             }
             else {
                 // Else let's just try it as is
                 status = luaL_loadbuffer(luaState, s, strlen(s), "=Console");
                 if (status == LUA_OK) {
-                    status = lua_pcall(luaState, 0, LUA_MULTRET, 0);
+                    status = LuaProfiler::pcall(luaState, 0, LUA_MULTRET, 0);
                 }
                 else if (status == LUA_ERRSYNTAX) {
                     size_t lmsg;
@@ -813,7 +1055,7 @@ bool LuaExtension::OnExecute(const char *s) {
             chunk.append(s);
             status = luaL_loadbuffer(luaState, chunk.c_str(), chunk.length(), "=Console");
             if (status == LUA_OK) {
-                status = lua_pcall(luaState, 0, LUA_MULTRET, 0);
+                status = LuaProfiler::pcall(luaState, 0, LUA_MULTRET, 0);
             }
             else if (status == LUA_ERRSYNTAX) {
                 size_t lmsg;
@@ -0,0 +1,206 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LuaProfiler.h"
+
+#include "lua.hpp"
+
+#include <QVector>
+
+#include <algorithm>
+
+
+// How many instructions run between each check of the budget and each sample
+const int SAMPLE_INSTRUCTIONS = 1000;
+
+// Only its address is used, as the key the profiler is kept under in the registry
+static const char registryKey = 0;
+
+LuaProfiler::LuaProfiler(lua_State *L) :
+    L(L)
+{
+    lua_pushlightuserdata(L, this);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &registryKey);
+}
+
+LuaProfiler::~LuaProfiler()
+{
+    lua_sethook(L, Q_NULLPTR, 0, 0);
+
+    lua_pushnil(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &registryKey);
+}
+
+LuaProfiler *LuaProfiler::forState(lua_State *L)
+{
+    lua_rawgetp(L, LUA_REGISTRYINDEX, &registryKey);
+    LuaProfiler *profiler = static_cast<LuaProfiler *>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    return profiler;
+}
+
+int LuaProfiler::pcall(lua_State *L, int nargs, int nresults, int msgh)
+{
+    LuaProfiler *profiler = forState(L);
+
+    if (profiler == Q_NULLPTR) {
+        return lua_pcall(L, nargs, nresults, msgh);
+    }
+
+    // The budget is for the whole of the outermost call
+    if (profiler->depth == 0) {
+        profiler->instructions = 0;
+    }
+
+    ++profiler->depth;
+    profiler->updateHook();
+
+    const int status = lua_pcall(L, nargs, nresults, msgh);
+
+    --profiler->depth;
+    profiler->updateHook();
+
+    return status;
+}
+
+void LuaProfiler::start()
+{
+    entries.clear();
+    totalSamples = 0;
+    elapsed = 0;
+    profiling = true;
+    timer.start();
+
+    updateHook();
+}
+
+void LuaProfiler::stop()
+{
+    if (!profiling)
+        return;
+
+    elapsed = timer.elapsed();
+    profiling = false;
+
+    updateHook();
+}
+
+QString LuaProfiler::report(int limit) const
+{
+    QVector<const Entry *> sorted;
+    sorted.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        sorted.append(&entry);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+        return a->samples != b->samples ? a->samples > b->samples : a->calls > b->calls;
+    });
+
+    QString text = QString::asprintf("%lld ms, %lld samples of %d instructions\n", elapsed, totalSamples, SAMPLE_INSTRUCTIONS);
+    text += QString::asprintf("%-48s %10s %8s %10s %6s\n", "function", "calls", "samples", "~ms", "%");
+
+    for (int i = 0; i < sorted.size() && i < limit; ++i) {
+        const Entry *entry = sorted[i];
+        const double share = totalSamples > 0 ? static_cast<double>(entry->samples) / totalSamples : 0.0;
+
+        text += QString::asprintf("%-48s %10lld %8lld %10.1f %6.1f\n", entry->name.constData(), entry->calls, entry->samples, share * elapsed, share * 100.0);
+    }
+
+    return text;
+}
+
+int LuaProfiler::luaProfile(lua_State *L)
+{
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+
+    LuaProfiler *profiler = forState(L);
+    if (profiler == Q_NULLPTR) {
+        return luaL_error(L, "profiling is not available here");
+    }
+
+    // Profiling inside of another nn.profile() just adds to the outer one
+    const bool nested = profiler->isProfiling();
+    if (!nested) {
+        profiler->start();
+    }
+
+    const int status = pcall(L, lua_gettop(L) - 1, 0, 0);
+
+    if (!nested) {
+        profiler->stop();
+    }
+
+    if (status != LUA_OK) {
+        return lua_error(L);
+    }
+
+    lua_pushstring(L, profiler->report().toUtf8().constData());
+    return 1;
+}
+
+void LuaProfiler::hook(lua_State *L, lua_Debug *ar)
+{
+    LuaProfiler *profiler = forState(L);
+    if (profiler == Q_NULLPTR)
+        return;
+
+    if (ar->event == LUA_HOOKCOUNT) {
+        profiler->instructions += SAMPLE_INSTRUCTIONS;
+
+        if (profiler->profiling) {
+            profiler->entryFor(L, ar).samples++;
+            profiler->totalSamples++;
+        }
+
+        if (profiler->budget > 0 && profiler->instructions > profiler->budget) {
+            luaL_error(L, "script stopped after running more than %I instructions", static_cast<lua_Integer>(profiler->budget));
+        }
+    }
+    else if (ar->event == LUA_HOOKCALL || ar->event == LUA_HOOKTAILCALL) {
+        profiler->entryFor(L, ar).calls++;
+    }
+}
+
+void LuaProfiler::updateHook()
+{
+    if (depth > 0 && (budget > 0 || profiling)) {
+        lua_sethook(L, hook, LUA_MASKCOUNT | (profiling ? LUA_MASKCALL : 0), SAMPLE_INSTRUCTIONS);
+    }
+    else {
+        lua_sethook(L, Q_NULLPTR, 0, 0);
+    }
+}
+
+LuaProfiler::Entry &LuaProfiler::entryFor(lua_State *state, lua_Debug *ar)
+{
+    lua_getinfo(state, "Sn", ar);
+
+    // Functions are told apart by where they are defined, C functions only have their name to go by
+    const QByteArray name = ar->name ? QByteArray(ar->name) : QByteArray(*ar->what == 'm' ? "main chunk" : "?");
+    const QByteArray key = (*ar->what == 'C') ? QByteArray("[C] ") + name : QByteArray(ar->short_src) + ':' + QByteArray::number(ar->linedefined);
+
+    Entry &entry = entries[key];
+    if (entry.name.isEmpty()) {
+        entry.name = (*ar->what == 'C') ? key : name + " (" + key + ")";
+    }
+
+    return entry;
+}
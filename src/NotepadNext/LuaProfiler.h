@@ -0,0 +1,87 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LUAPROFILER_H
+#define LUAPROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+
+struct lua_State;
+struct lua_Debug;
+
+
+// Keeps an eye on what the scripts run in a lua_State cost. Calls made through LuaProfiler::pcall() get a count
+// hook, which is the watchdog that stops a script once it has gone over its instruction budget, and while
+// profiling it also samples which function is running and counts calls. Time is not measured per call, it is
+// worked out from the share of the samples each function got, which keeps the profiler cheap enough to leave
+// on around a slow script. From Lua it is used as nn.profile(fn, ...).
+class LuaProfiler
+{
+public:
+    explicit LuaProfiler(lua_State *L);
+    ~LuaProfiler();
+
+    // The profiler attached to the state, if it has one
+    static LuaProfiler *forState(lua_State *L);
+
+    // In instructions, 0 lets scripts run as long as they like
+    void setInstructionBudget(qint64 instructions) { budget = instructions; }
+    qint64 instructionBudget() const { return budget; }
+
+    // The same as lua_pcall(), with the watchdog and profiler hooked in if the state has a profiler
+    static int pcall(lua_State *L, int nargs, int nresults, int msgh);
+
+    void start();
+    void stop();
+    bool isProfiling() const { return profiling; }
+
+    // The functions that took the most samples since start() was last called
+    QString report(int limit = 20) const;
+
+    // nn.profile(fn, ...) runs fn with the profiler on and returns the report
+    static int luaProfile(lua_State *L);
+
+private:
+    struct Entry {
+        QByteArray name;
+        qint64 calls = 0;
+        qint64 samples = 0;
+    };
+
+    static void hook(lua_State *L, lua_Debug *ar);
+    void updateHook();
+    Entry &entryFor(lua_State *state, lua_Debug *ar);
+
+    lua_State *L;
+    qint64 budget = 0;
+    qint64 instructions = 0;
+    int depth = 0;
+
+    bool profiling = false;
+    QHash<QByteArray, Entry> entries;
+    qint64 totalSamples = 0;
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+};
+
+#endif // LUAPROFILER_H
@@ -0,0 +1,304 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LuaScriptJob.h"
+
+#include "BulkEdit.h"
+#include "LuaState.h"
+#include "ScintillaNext.h"
+
+#include "lua.hpp"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <vector>
+
+
+// How often the script is interrupted to check if it has been canceled
+const int CANCEL_CHECK_INSTRUCTIONS = 1000;
+
+namespace {
+
+// What the doc functions work on, only ever touched by the worker running the script
+struct ScriptContext {
+    QByteArray text;
+    std::vector<qint64> lineStarts;
+    LuaScriptJob::Result *result;
+};
+
+}
+
+static ScriptContext *scriptContext(lua_State *L)
+{
+    return static_cast<ScriptContext *>(lua_touserdata(L, lua_upvalueindex(1)));
+}
+
+static void cancelHook(lua_State *L, lua_Debug *ar)
+{
+    Q_UNUSED(ar);
+
+    std::atomic_bool *canceled = *static_cast<std::atomic_bool **>(lua_getextraspace(L));
+    if (*canceled) {
+        luaL_error(L, "canceled");
+    }
+}
+
+// Where line's text ends, not counting the line ending
+static qint64 lineEnd(const ScriptContext *context, size_t line)
+{
+    qint64 end = (line + 1 < context->lineStarts.size()) ? context->lineStarts[line + 1] : context->text.size();
+
+    if (end > context->lineStarts[line] && context->text.at(end - 1) == '\n')
+        --end;
+    if (end > context->lineStarts[line] && context->text.at(end - 1) == '\r')
+        --end;
+
+    return end;
+}
+
+static int doc_lines(lua_State *L)
+{
+    const ScriptContext *context = scriptContext(L);
+    const size_t lines = context->lineStarts.size();
+
+    lua_createtable(L, static_cast<int>(lines), 0);
+    for (size_t line = 0; line < lines; ++line) {
+        const qint64 start = context->lineStarts[line];
+
+        lua_pushlstring(L, context->text.constData() + start, static_cast<size_t>(lineEnd(context, line) - start));
+        lua_rawseti(L, -2, static_cast<lua_Integer>(line + 1));
+    }
+
+    return 1;
+}
+
+static int doc_line_start(lua_State *L)
+{
+    const ScriptContext *context = scriptContext(L);
+    const lua_Integer line = luaL_checkinteger(L, 1);
+
+    luaL_argcheck(L, line >= 1 && line <= static_cast<lua_Integer>(context->lineStarts.size()), 1, "line out of range");
+
+    lua_pushinteger(L, static_cast<lua_Integer>(context->lineStarts[static_cast<size_t>(line - 1)]));
+    return 1;
+}
+
+static int doc_edit(lua_State *L)
+{
+    ScriptContext *context = scriptContext(L);
+    const lua_Integer start = luaL_checkinteger(L, 1);
+    const lua_Integer end = luaL_checkinteger(L, 2);
+    size_t length = 0;
+    const char *text = luaL_optlstring(L, 3, "", &length);
+
+    luaL_argcheck(L, start >= 0 && start <= context->text.size(), 1, "position out of range");
+    luaL_argcheck(L, end >= start && end <= context->text.size(), 2, "position out of range");
+
+    context->result->edits.append({start, end, QByteArray(text, static_cast<int>(length))});
+    return 0;
+}
+
+static int collect_print(lua_State *L)
+{
+    ScriptContext *context = scriptContext(L);
+    const int nargs = lua_gettop(L);
+    QString line;
+
+    for (int i = 1; i <= nargs; ++i) {
+        if (i > 1)
+            line += QLatin1Char('\t');
+
+        line += QString::fromUtf8(luaL_tolstring(L, i, Q_NULLPTR));
+        lua_pop(L, 1);
+    }
+
+    context->result->output.append(line);
+    return 0;
+}
+
+LuaScriptJob::LuaScriptJob(ScintillaNext *editor, const QByteArray &script, QObject *parent) :
+    QObject(parent),
+    editor(editor),
+    script(script)
+{
+}
+
+LuaScriptJob::~LuaScriptJob()
+{
+    cancel();
+}
+
+void LuaScriptJob::start()
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (running || editor.isNull())
+        return;
+
+    running = true;
+    canceled = std::make_shared<std::atomic_bool>(false);
+    generation = editor->changeGeneration();
+
+    const QByteArray text(reinterpret_cast<const char *>(editor->characterPointer()), static_cast<int>(editor->length()));
+    const QByteArray source = script;
+    std::shared_ptr<std::atomic_bool> flag = canceled;
+    QPointer<LuaScriptJob> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        const Result result = run(source, text, flag);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self) {
+                self->scriptFinished(result);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LuaScriptJob::cancel()
+{
+    if (canceled)
+        *canceled = true;
+}
+
+LuaScriptJob::Result LuaScriptJob::run(const QByteArray &script, const QByteArray &text, const std::shared_ptr<std::atomic_bool> &canceled)
+{
+    Result result;
+
+    ScriptContext context;
+    context.text = text;
+    context.result = &result;
+    context.lineStarts.push_back(0);
+    for (int i = 0; i < text.size(); ++i) {
+        if (text.at(i) == '\n' || (text.at(i) == '\r' && (i + 1 == text.size() || text.at(i + 1) != '\n'))) {
+            context.lineStarts.push_back(i + 1);
+        }
+    }
+
+    std::unique_ptr<LuaState> state(LuaState::createSandbox());
+    lua_State *L = state->L;
+
+    *static_cast<std::atomic_bool **>(lua_getextraspace(L)) = canceled.get();
+    lua_sethook(L, cancelHook, LUA_MASKCOUNT, CANCEL_CHECK_INSTRUCTIONS);
+
+    lua_pushlightuserdata(L, &context);
+    lua_pushcclosure(L, collect_print, 1);
+    lua_setglobal(L, "print");
+
+    lua_createtable(L, 0, 4);
+    lua_pushlstring(L, text.constData(), static_cast<size_t>(text.size()));
+    lua_setfield(L, -2, "text");
+    lua_pushlightuserdata(L, &context);
+    lua_pushcclosure(L, doc_lines, 1);
+    lua_setfield(L, -2, "lines");
+    lua_pushlightuserdata(L, &context);
+    lua_pushcclosure(L, doc_line_start, 1);
+    lua_setfield(L, -2, "lineStart");
+    lua_pushlightuserdata(L, &context);
+    lua_pushcclosure(L, doc_edit, 1);
+    lua_setfield(L, -2, "edit");
+    lua_setglobal(L, "doc");
+
+    int status = luaL_loadbuffer(L, script.constData(), static_cast<size_t>(script.size()), "=Script");
+    if (status == LUA_OK) {
+        status = lua_pcall(L, 0, 0, 0);
+    }
+
+    if (*canceled) {
+        result.canceled = true;
+        result.edits.clear();
+    }
+    else if (status != LUA_OK) {
+        result.error = QString::fromUtf8(lua_tostring(L, -1));
+        result.edits.clear();
+    }
+    else {
+        std::stable_sort(result.edits.begin(), result.edits.end(), [](const Edit &a, const Edit &b) {
+            return a.start < b.start;
+        });
+
+        for (int i = 1; i < result.edits.size(); ++i) {
+            if (result.edits[i].start < result.edits[i - 1].end) {
+                result.error = QStringLiteral("Script: doc.edit ranges overlap");
+                result.edits.clear();
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+void LuaScriptJob::scriptFinished(const Result &result)
+{
+    running = false;
+
+    for (const QString &line : result.output) {
+        emit output(line);
+    }
+
+    if (result.canceled) {
+        emit finished(false, tr("The script was canceled"));
+        return;
+    }
+
+    if (!result.error.isEmpty()) {
+        emit finished(false, result.error);
+        return;
+    }
+
+    if (result.edits.isEmpty()) {
+        emit finished(true, QString());
+        return;
+    }
+
+    if (editor.isNull()) {
+        emit finished(false, tr("The editor was closed while the script ran"));
+        return;
+    }
+
+    if (editor->changeGeneration() != generation) {
+        emit finished(false, tr("The document was changed while the script ran, its edits were not applied"));
+        return;
+    }
+
+    if (editor->readOnly()) {
+        emit finished(false, tr("The document is read only"));
+        return;
+    }
+
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+    ranges.reserve(result.edits.size());
+    replacements.reserve(result.edits.size());
+
+    for (const Edit &edit : result.edits) {
+        ranges.push_back({static_cast<Sci_PositionCR>(edit.start), static_cast<Sci_PositionCR>(edit.end)});
+        replacements.append(edit.text);
+    }
+
+    {
+        BulkEdit be(editor);
+        editor->replaceRanges(ranges, replacements);
+    }
+
+    emit finished(true, QString());
+}
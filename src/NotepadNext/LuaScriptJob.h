@@ -0,0 +1,88 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LUASCRIPTJOB_H
+#define LUASCRIPTJOB_H
+
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class ScintillaNext;
+
+
+// Runs a user's Lua script on a worker thread so a long or stuck script neither freezes the editor nor has
+// to be waited out. The script gets its own sandboxed LuaState (see LuaState::createSandbox) and a copy of
+// the text taken when it starts, through a global doc table:
+//
+//   doc.text              the whole document as a string
+//   doc.lines()           a table of its lines, without the line endings
+//   doc.lineStart(n)      the position of the start of line n (1 based, the same as in doc.lines())
+//   doc.edit(s, e, text)  replaces the bytes from position s up to e with text once the script is done
+//
+// print() is collected and handed back. The edits are applied together on the GUI thread as one undo action,
+// unless the document was changed while the script ran.
+class LuaScriptJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    LuaScriptJob(ScintillaNext *editor, const QByteArray &script, QObject *parent = Q_NULLPTR);
+    ~LuaScriptJob() override;
+
+    void start();
+    bool isRunning() const { return running; }
+
+public slots:
+    void cancel();
+
+signals:
+    void output(const QString &text);
+    void finished(bool applied, const QString &error);
+
+    // What a run of the script hands back to the GUI thread
+    struct Edit {
+        qint64 start;
+        qint64 end;
+        QByteArray text;
+    };
+
+    struct Result {
+        QVector<Edit> edits;
+        QStringList output;
+        QString error;
+        bool canceled = false;
+    };
+
+private:
+    static Result run(const QByteArray &script, const QByteArray &text, const std::shared_ptr<std::atomic_bool> &canceled);
+    void scriptFinished(const Result &result);
+
+    QPointer<ScintillaNext> editor;
+    QByteArray script;
+    quint64 generation = 0;
+    bool running = false;
+    std::shared_ptr<std::atomic_bool> canceled;
+};
+
+#endif // LUASCRIPTJOB_H
@@ -18,6 +18,8 @@
 
 
 #include "LuaState.h"
+#include "LuaProfiler.h"
+#include "LuaBytecodeBundle.h"
 #include "lua.hpp"
 
 #include <QFile>
@@ -51,6 +53,39 @@ std::string dumpLuaState(lua_State *L) {
     return ostr.str();
 }
 
+// Loads the bytecode that a resource was compiled to at build time, if there is any. On success
+// the function is left on the stack, otherwise the stack is left as it was.
+static bool load_bytecode(lua_State *L, const QByteArray &name)
+{
+    const LuaBytecodeBundle::Chunk *chunk = LuaBytecodeBundle::find(name.constData());
+
+    if (chunk == Q_NULLPTR) {
+        return false;
+    }
+
+    const QByteArray chunkName = QByteArrayLiteral("@:/") + name;
+    if (luaL_loadbufferx(L, reinterpret_cast<const char *>(chunk->data), chunk->size, chunkName.constData(), "b") != LUA_OK) {
+        // Only happens if the tool's Lua was configured differently, the source is still there to fall back on
+        qWarning("Cannot load bytecode for %s: %s", name.constData(), lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+
+    return true;
+}
+
+static int require_bytecode(lua_State *L)
+{
+    const char *module = luaL_checkstring(L, 1);
+    const QByteArray name = QByteArrayLiteral("languages/") + module + ".lua";
+
+    if (!load_bytecode(L, name)) {
+        lua_pushfstring(L, "\n\tno bytecode for '%s'", name.constData());
+    }
+
+    return 1;
+}
+
 static int require_resource(lua_State *L)
 {
     const char *module = luaL_checkstring(L, 1);
@@ -81,6 +116,8 @@ LuaState::LuaState()
     L = luaL_newstate();
     luaL_openlibs(L);
 
+    profiler = new LuaProfiler(L);
+
     // Remove the searchers used for finding files on the file system
     execute("table.remove(package.searchers, 4); table.remove(package.searchers, 3); table.remove(package.searchers, 2)");
 
@@ -95,21 +132,59 @@ LuaState::LuaState()
         lua_call(L, 1, 0);
     }
 
-    lua_getglobal(L, "table");
-    lua_getfield(L, -1, "insert");
-    lua_remove(L, -2);
+    // Prefer what was compiled at build time over parsing the source
+    for (lua_CFunction searcher : {require_bytecode, require_resource}) {
+        lua_getglobal(L, "table");
+        lua_getfield(L, -1, "insert");
+        lua_remove(L, -2);
 
-    lua_getglobal(L, "package");
-    lua_getfield(L, -1, "searchers");
-    lua_remove(L, -2);
+        lua_getglobal(L, "package");
+        lua_getfield(L, -1, "searchers");
+        lua_remove(L, -2);
 
-    lua_pushcfunction(L, require_resource);
+        lua_pushcfunction(L, searcher);
 
-    lua_call(L, 2, 0);
+        lua_call(L, 2, 0);
+    }
+}
+
+LuaState::LuaState(lua_State *state) :
+    L(state)
+{
+}
+
+LuaState *LuaState::createSandbox()
+{
+    static const luaL_Reg libs[] = {
+        {"_G", luaopen_base},
+        {LUA_TABLIBNAME, luaopen_table},
+        {LUA_STRLIBNAME, luaopen_string},
+        {LUA_MATHLIBNAME, luaopen_math},
+        {LUA_UTF8LIBNAME, luaopen_utf8},
+        {Q_NULLPTR, Q_NULLPTR}
+    };
+
+    lua_State *state = luaL_newstate();
+
+    for (const luaL_Reg *lib = libs; lib->func; ++lib) {
+        luaL_requiref(state, lib->name, lib->func, 1);
+        lua_pop(state, 1);
+    }
+
+    // The base library can still load code from the file system
+    lua_pushnil(state);
+    lua_setglobal(state, "dofile");
+    lua_pushnil(state);
+    lua_setglobal(state, "loadfile");
+
+    return new LuaState(state);
 }
 
 LuaState::~LuaState()
 {
+    delete profiler;
+    profiler = Q_NULLPTR;
+
     if (L) {
         lua_close(L);
         L = Q_NULLPTR;
@@ -123,29 +198,25 @@ void LuaState::execute(const char *statement, bool clear)
 
     int status = luaL_loadstring(L, statement);
 
-    if (status == LUA_OK) {
-        status = lua_pcall(L, 0, LUA_MULTRET, 0);
-    }
-    else if (status == LUA_ERRSYNTAX) {
+    if (status == LUA_ERRSYNTAX) {
         qWarning("LUA_ERRSYNTAX: %s", statement);
     }
-    else if (status == LUA_ERRMEM) {
-        qFatal("Lua memory allocation error");
-    }
 
-    if (status != LUA_OK) {
-        // Print an error message
-        //writeErrorToOutput(lua_tostring(L, -1));
-        //writeErrorToOutput("\r\n");
-        qWarning("%s", lua_tostring(L, -1));
-    }
-
-    if (clear)
-        lua_settop(L, stacktop);
+    callLoaded(status, stacktop, clear);
 }
 
 void LuaState::executeFile(const QString &fileName)
 {
+    // Scripts in the resources were compiled at build time when possible
+    if (fileName.startsWith(QLatin1String(":/"))) {
+        const int stacktop = lua_gettop(L);
+
+        if (load_bytecode(L, fileName.mid(2).toUtf8())) {
+            callLoaded(LUA_OK, stacktop, true);
+            return;
+        }
+    }
+
     QFile ff(fileName);
 
     if (!ff.open(QFile::ReadOnly)) {
@@ -157,6 +228,26 @@ void LuaState::executeFile(const QString &fileName)
     ff.close();
 }
 
+void LuaState::callLoaded(int status, int stacktop, bool clear)
+{
+    if (status == LUA_OK) {
+        status = LuaProfiler::pcall(L, 0, LUA_MULTRET, 0);
+    }
+    else if (status == LUA_ERRMEM) {
+        qFatal("Lua memory allocation error");
+    }
+
+    if (status != LUA_OK) {
+        // Print an error message
+        //writeErrorToOutput(lua_tostring(L, -1));
+        //writeErrorToOutput("\r\n");
+        qWarning("%s", lua_tostring(L, -1));
+    }
+
+    if (clear)
+        lua_settop(L, stacktop);
+}
+
 void LuaState::clearStack()
 {
     lua_settop(L, 0);
@@ -26,6 +26,7 @@
 #include "lua.hpp"
 
 struct lua_State;
+class LuaProfiler;
 
 class LuaState
 {
@@ -33,6 +34,11 @@ public:
     LuaState();
     ~LuaState();
 
+    // A state for running user scripts away from the application. It only has the base, string, table, math and
+    // utf8 libraries, without anything that can reach files, the OS or other modules, and none of the application
+    // is bound into it. It is not tied to a thread, so it can be created and used on a worker.
+    static LuaState *createSandbox();
+
     void execute(const char *statement, bool clear = true);
     void executeFile(const QString &fileName);
 
@@ -45,7 +51,14 @@ public:
 
     lua_State *L = Q_NULLPTR;
 
+    // Only the application's state has one, see LuaProfiler
+    LuaProfiler *profiler = Q_NULLPTR;
+
 private:
+    explicit LuaState(lua_State *state);
+
+    // Runs the function that was just loaded, if status says it was, and reports any error
+    void callLoaded(int status, int stacktop, bool clear);
 };
 
 template<>
@@ -18,6 +18,8 @@
 
 
 #include "Macro.h"
+#include "BulkEdit.h"
+#include "Logging.h"
 
 using namespace Scintilla;
 
@@ -29,31 +31,34 @@ Macro::~Macro()
 
 void Macro::addMacroStep(Message message, uptr_t wParam, sptr_t lParam)
 {
-    qInfo(Q_FUNC_INFO);
-
     // Combine ReplaceSel messages into a single string
     if (message == Message::ReplaceSel && !steps.empty() && steps.constLast().message == Message::ReplaceSel) {
         steps.last().str.append(reinterpret_cast<const char*>(lParam));
     }
     // Combine DeleteBack (backspace) with ReplaceSel
     else if (message == Message::DeleteBack && !steps.empty() && steps.constLast().message == Message::ReplaceSel) {
-        if (steps.last().str.size() == 1) {
+        QByteArray &str = steps.last().str;
+
+        // The whole of the last character goes, not just its last byte
+        int end = str.size() - 1;
+        while (end > 0 && (static_cast<unsigned char>(str.at(end)) & 0xC0) == 0x80)
+            --end;
+
+        if (end <= 0) {
             // A single char left so just remove the action
             steps.takeLast();
         }
         else {
-            steps.last().str.chop(1);
+            str.truncate(end);
         }
     }
     else {
-        steps.append(MacroStep(message, wParam, lParam));
+        appendCoalesced(MacroStep(message, wParam, lParam));
     }
 
-#ifdef QT_DEBUG
-    for (const MacroStep &step : steps) {
-        qInfo("%s", qUtf8Printable(step.toString()));
+    if (!steps.isEmpty()) {
+        qCDebug(lcMacro, "%s", qUtf8Printable(steps.constLast().toString()));
     }
-#endif
 }
 
 void Macro::addMacroStep(MacroStep step)
@@ -61,28 +66,45 @@ void Macro::addMacroStep(MacroStep step)
     steps.append(step);
 }
 
+void Macro::appendCoalesced(const MacroStep &step)
+{
+    if (!steps.isEmpty() && steps.constLast().canRepeatWith(step)) {
+        steps.last().repeat += step.repeat;
+    }
+    else {
+        steps.append(step);
+    }
+}
+
 void Macro::replay(ScintillaNext *editor, int n) const
 {
     qInfo(Q_FUNC_INFO);
 
-    editor->beginUndoAction();
+    const BulkEdit be(editor);
 
+    bool first = true;
     while (n > 0) {
+        const int lengthBefore = editor->length();
+
         for (const MacroStep &step : steps) {
             step.replay(editor);
         }
 
         --n;
-    }
 
-    editor->endUndoAction();
+        // Assume the remaining runs grow the document as much as the first one did
+        if (first && n > 0 && editor->length() > lengthBefore) {
+            editor->reserve(static_cast<qint64>(editor->length() - lengthBefore) * n);
+        }
+        first = false;
+    }
 }
 
 void Macro::replayTillEndOfFile(ScintillaNext *editor) const
 {
     qInfo(Q_FUNC_INFO);
 
-    editor->beginUndoAction();
+    const BulkEdit be(editor);
 
     do {
         int length = editor->length();
@@ -114,8 +136,6 @@ void Macro::replayTillEndOfFile(ScintillaNext *editor) const
 
         break;
     } while (true);
-
-    editor->endUndoAction();
 }
 
 QString Macro::getName() const
@@ -130,10 +150,32 @@ void Macro::setName(const QString &value)
 
 QDataStream &operator<<(QDataStream& stream, const Macro &macro)
 {
-    return stream << macro.name << macro.steps;
+    // Repeats are written out as the steps they stand for, so the saved format stays the same as it always was
+    QVector<MacroStep> stored;
+    stored.reserve(macro.steps.size());
+
+    for (const MacroStep &step : macro.steps) {
+        MacroStep single = step;
+        single.repeat = 1;
+
+        for (int i = 0; i < step.repeat; ++i) {
+            stored.append(single);
+        }
+    }
+
+    return stream << macro.name << stored;
 }
 
 QDataStream &operator>>(QDataStream& stream, Macro &macro)
 {
-    return stream >> macro.name >> macro.steps;
+    QVector<MacroStep> stored;
+    stream >> macro.name >> stored;
+
+    // Macros saved before steps had repeats get folded together the same way as newly recorded ones
+    macro.steps.clear();
+    for (const MacroStep &step : qAsConst(stored)) {
+        macro.appendCoalesced(step);
+    }
+
+    return stream;
 }
@@ -41,11 +41,14 @@ public:
     void setName(const QString &value);
 
     QVector<MacroStep> &getSteps() { return steps; }
+    const QVector<MacroStep> &getSteps() const { return steps; }
 
     friend QDataStream &operator<<(QDataStream& stream, const Macro &Macro);
     friend QDataStream &operator>>(QDataStream& stream, Macro &Macro);
 
 private:
+    void appendCoalesced(const MacroStep &step);
+
     QVector<MacroStep> steps;
     QString name;
 };
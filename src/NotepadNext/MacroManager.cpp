@@ -18,6 +18,9 @@
 
 #include "MacroManager.h"
 #include "ApplicationSettings.h"
+#include "MacroStore.h"
+
+#include <QFileInfo>
 
 MacroManager::MacroManager(QObject *parent) :
     QObject{parent}
@@ -31,8 +34,6 @@ MacroManager::MacroManager(QObject *parent) :
     // see https://stackoverflow.com/q/70974383
     QMetaType::fromType<Macro>().hasRegisteredDataStreamOperators();
 #endif
-
-    loadSettings();
 }
 
 MacroManager::~MacroManager()
@@ -78,10 +79,52 @@ void MacroManager::stopRecording()
     emit recordingStopped();
 }
 
+QVector<Macro *> &MacroManager::availableMacros()
+{
+    // Nothing is read until the macros are first needed, e.g. by the macro menu or the run dialog
+    if (!isLoaded) {
+        loadSettings();
+    }
+
+    return macros;
+}
+
+bool MacroManager::hasMacros() const
+{
+    if (isLoaded) {
+        return macros.size() > 0;
+    }
+
+    const int count = MacroStore::count(macroFileName());
+    if (count >= 0) {
+        return count > 0;
+    }
+
+    ApplicationSettings settings;
+    return settings.value("Macros/size", 0).toInt() > 0;
+}
+
+QString MacroManager::macroFileName() const
+{
+    ApplicationSettings settings;
+
+    return QFileInfo(settings.fileName()).absolutePath() + QStringLiteral("/macros.dat");
+}
+
 void MacroManager::loadSettings()
 {
     qInfo(Q_FUNC_INFO);
 
+    isLoaded = true;
+
+    if (!MacroStore::load(macroFileName(), macros)) {
+        loadLegacySettings();
+    }
+}
+
+// Macros used to be saved as an array of blobs in the settings, they get moved into the macro file the next time it is saved
+void MacroManager::loadLegacySettings()
+{
     ApplicationSettings settings;
 
     int size = settings.beginReadArray("Macros");
@@ -103,17 +146,14 @@ void MacroManager::saveSettings() const
 {
     qInfo(Q_FUNC_INFO);
 
-    ApplicationSettings settings;
-
-    settings.remove("Macros");
+    // If they were never loaded then they can't have changed
+    if (!isLoaded) {
+        return;
+    }
 
-    if (macros.size() > 0) {
-        settings.beginWriteArray("Macros");
-        for (int i = 0; i < macros.size(); ++i) {
-            settings.setArrayIndex(i);
-            settings.setValue("Macro", QVariant::fromValue(*macros.at(i)));
-        }
-        settings.endArray();
+    if (MacroStore::save(macroFileName(), macros)) {
+        ApplicationSettings settings;
+        settings.remove("Macros");
     }
 }
 
@@ -131,7 +171,7 @@ void MacroManager::saveCurrentMacro(const QString &macroName)
     isCurrentMacroSaved = true;
 
     currentMacro->setName(macroName);
-    macros.append(currentMacro);
+    availableMacros().append(currentMacro);
 }
 
 bool MacroManager::hasCurrentUnsavedMacro() const
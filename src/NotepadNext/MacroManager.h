@@ -33,7 +33,8 @@ public:
     virtual ~MacroManager();
 
     bool isRecording() const;
-    QVector<Macro *> &availableMacros() { return macros; };
+    QVector<Macro *> &availableMacros();
+    bool hasMacros() const;
 
     void replayCurrentMacro(ScintillaNext *editor);
     void saveCurrentMacro(const QString &macroName);
@@ -48,16 +49,20 @@ private slots:
     void loadSettings();
     void saveSettings() const;
 
+private:
+    QString macroFileName() const;
+    void loadLegacySettings();
+
 signals:
     void recordingStarted();
     void recordingStopped();
 
-private:
     MacroRecorder recorder;
     Macro *currentMacro = Q_NULLPTR;
     QVector<Macro *> macros;
     bool _isRecording = false;
     bool isCurrentMacroSaved = false;
+    bool isLoaded = false;
 };
 
 #endif // MACROMANAGER_H
@@ -0,0 +1,386 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MacroPlayer.h"
+#include "Macro.h"
+#include "LineTransforms.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
+
+
+// The editor isn't drawn while it runs anyway, so this only has to be short enough for cancel to respond quickly
+const int SLICE_BUDGET_MS = 30;
+
+// When played line by line, each worker gets at least this many lines
+const int MINIMUM_CHUNK_LINES = 1024;
+
+MacroPlayer::MacroPlayer(const Macro *macro, ScintillaNext *editor, int times, QObject *parent) :
+    QObject(parent),
+    editor(editor),
+    timer(new QTimer(this)),
+    times(times),
+    lineMacro(macro->getSteps())
+{
+    const QVector<MacroStep> &macroSteps = macro->getSteps();
+
+    steps.reserve(macroSteps.size());
+    strings.reserve(macroSteps.size());
+
+    for (const MacroStep &step : macroSteps) {
+        sptr_t lParam = step.lParam;
+
+        if (MacroStep::MessageHasString(step.message)) {
+            // The data of a QByteArray stays put even when the vector holding it grows
+            strings.append(step.str);
+            lParam = reinterpret_cast<sptr_t>(strings.last().constData());
+        }
+
+        steps.append({static_cast<unsigned int>(step.message), step.wParam, lParam, step.repeat});
+    }
+
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &MacroPlayer::playSlice);
+
+    // Nothing is left to play it on
+    connect(editor, &QObject::destroyed, this, [=]() {
+        if (running) {
+            editing = false;
+            editorDisabled = false;
+            finish(true);
+        }
+    });
+}
+
+MacroPlayer::~MacroPlayer()
+{
+    if (running) {
+        finish(true);
+    }
+}
+
+void MacroPlayer::start()
+{
+    Q_ASSERT(!running);
+
+    qInfo(Q_FUNC_INFO);
+
+    running = true;
+
+    if (steps.isEmpty() || times == 0) {
+        finish(false);
+        return;
+    }
+
+    // Anything typed or clicked in the meantime would end up in the middle of the macro
+    editorWasEnabled = editor->isEnabled();
+    editor->setEnabled(false);
+    editorDisabled = true;
+
+    if (lineByLine && lineMacro.isValid()) {
+        playLineByLine();
+    }
+    else {
+        if (lineByLine) {
+            qInfo("The macro doesn't stay within each line, playing it the usual way");
+        }
+
+        playInSlices();
+    }
+}
+
+void MacroPlayer::cancel()
+{
+    if (running) {
+        qInfo(Q_FUNC_INFO);
+
+        finish(true);
+    }
+}
+
+void MacroPlayer::playInSlices()
+{
+    editor->beginBulkEdit();
+    editing = true;
+
+    updateProgress();
+    timer->start();
+}
+
+void MacroPlayer::playSlice()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    do {
+        if (!playOnce()) {
+            finish(false);
+            return;
+        }
+    } while (elapsed.elapsed() < SLICE_BUDGET_MS);
+
+    updateProgress();
+}
+
+bool MacroPlayer::playOnce()
+{
+    const Sci_Position length = editor->length();
+    const Sci_Position position = editor->currentPos();
+
+    for (const Step &step : qAsConst(steps)) {
+        if (step.message == static_cast<unsigned int>(LineTransforms::MacroMessage)) {
+            LineTransforms::applyMacroString(editor, QByteArray(reinterpret_cast<const char *>(step.lParam)));
+        }
+        else {
+            for (int i = 0; i < step.repeat; ++i) {
+                editor->send(step.message, step.wParam, step.lParam);
+            }
+        }
+    }
+
+    ++played;
+
+    if (times > 0) {
+        return played < times;
+    }
+
+    // Same as Macro::replayTillEndOfFile(), it stops once the macro no longer gets any further through the file
+    if (editor->length() < length) {
+        return true;
+    }
+    else if (editor->length() > length) {
+        return editor->currentPos() - position > editor->length() - length;
+    }
+    else {
+        return editor->currentPos() != position;
+    }
+}
+
+void MacroPlayer::updateProgress()
+{
+    int newPercent;
+
+    if (times > 0) {
+        newPercent = static_cast<int>(qint64(played) * 100 / times);
+    }
+    else {
+        const Sci_Position length = editor->length();
+        newPercent = length > 0 ? static_cast<int>(editor->currentPos() * 100 / length) : 100;
+    }
+
+    if (newPercent != percent) {
+        percent = newPercent;
+        emit progressChanged(percent);
+    }
+}
+
+void MacroPlayer::playLineByLine()
+{
+    const int firstLine = editor->lineFromPosition(editor->currentPos());
+    const int lineCount = editor->lineCount();
+
+    // The same lines as playing it one time after another, which stops after the last line since it can't move down
+    const int lastLine = times > 0 ? static_cast<int>(qMin<qint64>(qint64(firstLine) + times, lineCount)) - 1 : lineCount - 1;
+    const int lines = lastLine - firstLine + 1;
+
+    // Played one time after another it moves down by what is shown, which skips lines folded away and steps through
+    // each part of a wrapped line, so those only cover the same lines as this when every line is shown as one
+    if (!showsEveryLine(firstLine, lastLine)) {
+        qInfo("Folds or wrapping change which lines the macro moves down to, playing it the usual way");
+        playInSlices();
+        return;
+    }
+
+    qInfo("Playing the macro on each of lines %d to %d", firstLine + 1, lastLine + 1);
+
+    lineRanges.resize(lines);
+    for (int i = 0; i < lines; ++i) {
+        const int line = firstLine + i;
+
+        lineRanges[i] = {static_cast<Sci_PositionCR>(editor->positionFromLine(line)), static_cast<Sci_PositionCR>(editor->lineEndPosition(line))};
+    }
+
+    lineGeneration = editor->changeGeneration();
+    linesCanceled = std::make_shared<std::atomic_bool>(false);
+    chunkResults.clear();
+
+    const int chunkLines = qMax(MINIMUM_CHUNK_LINES, lines / (QThread::idealThreadCount() * 8) + 1);
+    totalChunks = (lines + chunkLines - 1) / chunkLines;
+
+    emit progressChanged(0);
+
+    QPointer<MacroPlayer> self = this;
+    std::shared_ptr<std::atomic_bool> canceled = linesCanceled;
+    const LineMacro macro = lineMacro;
+
+    for (int first = 0; first < lines; first += chunkLines) {
+        const int count = qMin(chunkLines, lines - first);
+
+        // The workers only ever see their own copy of the text
+        QVector<QByteArray> texts;
+        texts.reserve(count);
+        for (int i = first; i < first + count; ++i) {
+            const Sci_CharacterRange &range = lineRanges[i];
+            texts.append(QByteArray(reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, range.cpMax - range.cpMin)), range.cpMax - range.cpMin));
+        }
+
+        QThreadPool::globalInstance()->start([=]() {
+            LineResults results{first, count, true, {}, {}, 0};
+
+            for (int i = 0; i < texts.size() && !*canceled; ++i) {
+                QByteArray text = texts[i];
+
+                if (!macro.apply(text, &results.lastCaret)) {
+                    results.ok = false;
+                    break;
+                }
+
+                if (text != texts[i]) {
+                    results.changedLines.append(first + i);
+                    results.changedText.append(text);
+                }
+            }
+
+            // Everything posted back goes through the application object since the player may be deleted at any point
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self && !*canceled) {
+                    self->linesPlayed(results);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+bool MacroPlayer::showsEveryLine(int firstLine, int lastLine) const
+{
+    if (editor->wrapMode() != SC_WRAP_NONE)
+        return false;
+
+    if (editor->allLinesVisible())
+        return true;
+
+    for (int line = firstLine; line <= lastLine; ++line) {
+        if (!editor->lineVisible(line))
+            return false;
+    }
+
+    return true;
+}
+
+void MacroPlayer::linesPlayed(const LineResults &results)
+{
+    chunkResults.append(results);
+
+    emit progressChanged(static_cast<int>(qint64(chunkResults.size()) * 100 / totalChunks));
+
+    if (chunkResults.size() == totalChunks) {
+        writeLines();
+    }
+}
+
+void MacroPlayer::writeLines()
+{
+    linesCanceled.reset();
+
+    if (editor->changeGeneration() != lineGeneration) {
+        qWarning("The document changed while the macro was being played on it");
+        finish(true);
+        return;
+    }
+
+    const bool ok = std::all_of(chunkResults.cbegin(), chunkResults.cend(), [](const LineResults &results) { return results.ok; });
+
+    // Nothing has been changed yet, so it can still be played the usual way from where it started
+    if (!ok) {
+        qInfo("The macro reached outside of a line, playing it the usual way");
+
+        chunkResults.clear();
+        playInSlices();
+        return;
+    }
+
+    std::sort(chunkResults.begin(), chunkResults.end(), [](const LineResults &a, const LineResults &b) {
+        return a.firstLine < b.firstLine;
+    });
+
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+    for (const LineResults &results : qAsConst(chunkResults)) {
+        for (int i = 0; i < results.changedLines.size(); ++i) {
+            ranges.push_back(lineRanges[results.changedLines[i]]);
+            replacements.append(results.changedText[i]);
+        }
+    }
+
+    const int lastLine = editor->lineFromPosition(lineRanges.back().cpMin);
+    const int lastCaret = chunkResults.last().lastCaret;
+
+    editor->beginBulkEdit();
+    editing = true;
+
+    editor->replaceRanges(ranges, replacements);
+
+    // Moving down from the last line leaves the caret at the start of the next one, or where it was on the last line of the file
+    if (lastLine + 1 < editor->lineCount()) {
+        editor->gotoPos(editor->positionFromLine(lastLine + 1));
+    }
+    else {
+        editor->gotoPos(editor->positionFromLine(lastLine) + lastCaret);
+    }
+
+    played = static_cast<int>(lineRanges.size());
+    chunkResults.clear();
+
+    finish(false);
+}
+
+void MacroPlayer::finish(bool canceled)
+{
+    timer->stop();
+    running = false;
+
+    if (linesCanceled) {
+        *linesCanceled = true;
+        linesCanceled.reset();
+    }
+
+    if (editing) {
+        editing = false;
+        editor->endBulkEdit();
+    }
+
+    if (editorDisabled) {
+        editorDisabled = false;
+        editor->setEnabled(editorWasEnabled);
+    }
+
+    qInfo("Macro played %d times%s", played, canceled ? " before being canceled" : "");
+
+    if (!canceled) {
+        percent = 100;
+        emit progressChanged(percent);
+    }
+
+    emit finished(canceled);
+}
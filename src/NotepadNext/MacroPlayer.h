@@ -0,0 +1,119 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MACROPLAYER_H
+#define MACROPLAYER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "LineMacro.h"
+#include "ScintillaNext.h"
+
+class Macro;
+class QTimer;
+
+
+// Plays a macro back a slice at a time while the application keeps running, so the progress can be shown
+// and it can be canceled part of the way through. The steps are turned into the messages to send once up
+// front rather than every time they are played, and the whole run is a single bulk edit of the editor.
+// A macro that only works within each line can instead be played on all of the lines at once on other
+// threads, with the results written back in one replacement. See LineMacro.
+class MacroPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // A times of -1 keeps playing it until the end of the file
+    MacroPlayer(const Macro *macro, ScintillaNext *editor, int times, QObject *parent = Q_NULLPTR);
+    ~MacroPlayer() override;
+
+    // Only taken up if the macro turns out to be a LineMacro, otherwise it is played the usual way
+    void setLineByLine(bool enabled) { lineByLine = enabled; }
+
+    void start();
+    bool isRunning() const { return running; }
+
+public slots:
+    void cancel();
+
+signals:
+    void progressChanged(int percent);
+    void finished(bool canceled);
+
+private slots:
+    void playSlice();
+
+private:
+    struct Step {
+        unsigned int message;
+        uptr_t wParam;
+        sptr_t lParam;
+        int repeat;
+    };
+
+    struct LineResults {
+        int firstLine; // both relative to where it started
+        int lineCount;
+        bool ok;
+        QVector<int> changedLines;
+        QVector<QByteArray> changedText;
+        int lastCaret;
+    };
+
+    void playInSlices();
+    bool playOnce();
+    void updateProgress();
+
+    void playLineByLine();
+    bool showsEveryLine(int firstLine, int lastLine) const;
+    void linesPlayed(const LineResults &results);
+    void writeLines();
+
+    void finish(bool canceled);
+
+    QPointer<ScintillaNext> editor;
+    QTimer *timer;
+
+    QVector<Step> steps;
+    QVector<QByteArray> strings; // what the steps that take text point to
+
+    int times;
+    int played = 0;
+    int percent = -1;
+    bool running = false;
+    bool editing = false; // inside of the editor's bulk edit
+    bool editorDisabled = false;
+    bool editorWasEnabled = true;
+
+    LineMacro lineMacro;
+    bool lineByLine = false;
+    std::shared_ptr<std::atomic_bool> linesCanceled;
+    std::vector<Sci_CharacterRange> lineRanges;
+    quint64 lineGeneration = 0;
+    int totalChunks = 0;
+    QVector<LineResults> chunkResults;
+};
+
+#endif // MACROPLAYER_H
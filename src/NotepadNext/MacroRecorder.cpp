@@ -19,6 +19,7 @@
 
 #include "MacroRecorder.h"
 #include "ScintillaNext.h"
+#include "Logging.h"
 #include <QMetaEnum>
 
 using namespace Scintilla;
@@ -53,7 +54,7 @@ Macro *MacroRecorder::stopRecording()
 
 void MacroRecorder::recordMacroStep(Message message, uptr_t wParam, sptr_t lParam)
 {
-    qInfo(Q_FUNC_INFO);
+    qCDebug(lcMacro, Q_FUNC_INFO);
 
     macro->addMacroStep(message, wParam, lParam);
 }
@@ -21,6 +21,7 @@
 
 #include "ScintillaNext.h"
 #include "MacroStep.h"
+#include "LineTransforms.h"
 
 
 using namespace Scintilla;
@@ -134,15 +135,16 @@ QMap<Scintilla::Message, QString> messageData {
     { Scintilla::Message::MoveSelectedLinesUp, "Move Selected Lines Up" },
     { Scintilla::Message::MoveSelectedLinesDown, "Move Selected Lines Down" },
     { Scintilla::Message::ScrollToStart, "Scroll To Start" },
-    { Scintilla::Message::ScrollToEnd, "Scroll To End" }
+    { Scintilla::Message::ScrollToEnd, "Scroll To End" },
+    { LineTransforms::MacroMessage, "Transform Lines" }
 };
 
 MacroStep::MacroStep(Message message, uptr_t wParam, sptr_t lParam) :
     message(message),
     wParam(wParam)
 {
-    if (message == Message::ReplaceSel || message == Message::InsertText) {
-        // wParam is 0 for replace, and position for insert
+    if (message == Message::ReplaceSel || message == Message::InsertText || message == LineTransforms::MacroMessage) {
+        // wParam is 0 for replace and transforms, and position for insert
         this->str = QByteArray(reinterpret_cast<const char*>(lParam));
     }
     else if (message == Message::AddText || message == Message::AppendText) {
@@ -166,6 +168,13 @@ QString MacroStep::toString() const
                 .arg(wParam)
                 .arg(str.constData());
     }
+    else if (repeat > 1) {
+        return QString("MacroStep(%1, %2, %3) x%4")
+                .arg(getName())
+                .arg(wParam)
+                .arg(lParam)
+                .arg(repeat);
+    }
     else {
         return QString("MacroStep(%1, %2, %3)")
                 .arg(getName())
@@ -174,6 +183,12 @@ QString MacroStep::toString() const
     }
 }
 
+bool MacroStep::canRepeatWith(const MacroStep &step) const
+{
+    // Text is joined together instead, see Macro::addMacroStep()
+    return message == step.message && !MessageHasString(message) && wParam == step.wParam && lParam == step.lParam;
+}
+
 QString MacroStep::getName() const
 {
     return MacroStep::NameOfMessage(message);
@@ -181,11 +196,16 @@ QString MacroStep::getName() const
 
 void MacroStep::replay(ScintillaNext *editor) const
 {
-    if (MacroStep::MessageHasString(message)) {
+    if (message == LineTransforms::MacroMessage) {
+        LineTransforms::applyMacroString(editor, str);
+    }
+    else if (MacroStep::MessageHasString(message)) {
         editor->sends(static_cast<int>(message), wParam, str.constBegin());
     }
     else {
-        editor->send(static_cast<int>(message), wParam, lParam);
+        for (int i = 0; i < repeat; ++i) {
+            editor->send(static_cast<int>(message), wParam, lParam);
+        }
     }
 }
 
@@ -194,7 +214,8 @@ bool MacroStep::MessageHasString(Scintilla::Message message)
     return message == Message::ReplaceSel ||
             message == Message::InsertText ||
             message == Message::AddText ||
-            message == Message::AppendText;
+            message == Message::AppendText ||
+            message == LineTransforms::MacroMessage;
 }
 
 QString MacroStep::NameOfMessage(Scintilla::Message message)
@@ -40,10 +40,14 @@ public:
     static QString NameOfMessage(Scintilla::Message message);
     static QList<Scintilla::Message> RecordableMacroMessages();
 
+    // Whether step can be folded into this one by counting it as another repeat
+    bool canRepeatWith(const MacroStep &step) const;
+
     Scintilla::Message message;
     uptr_t wParam;
     sptr_t lParam;
     QByteArray str;
+    int repeat = 1; // how many times in a row it is played, e.g. holding down an arrow key is a single step
 };
 Q_DECLARE_METATYPE(MacroStep)
 
@@ -61,6 +61,9 @@ QVariant MacroStepTableModel::data(const QModelIndex &index, int role) const
                 if (role == Qt::EditRole) {
                     return static_cast<int>(macro->getSteps()[index.row()].message);
                 }
+                else if (macro->getSteps()[index.row()].repeat > 1) {
+                    return tr("%1 (x%2)").arg(macro->getSteps()[index.row()].getName()).arg(macro->getSteps()[index.row()].repeat);
+                }
                 else {
                     return macro->getSteps()[index.row()].getName();
                 }
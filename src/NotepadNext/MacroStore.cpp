@@ -0,0 +1,220 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MacroStore.h"
+#include "Macro.h"
+#include "Logging.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+
+static const quint32 STORE_MAGIC = 0x4e4e4d43;
+static const quint32 STORE_VERSION = 1;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 macroCount;
+    quint32 reserved;
+};
+
+struct IndexEntry
+{
+    quint64 offset;
+    quint64 length;
+};
+
+struct MacroRecord
+{
+    quint32 nameLength;
+    quint32 stepCount;
+};
+
+struct StepRecord
+{
+    qint32 message;
+    qint32 repeat;
+    quint64 wParam;
+    qint64 lParam;
+    quint32 strLength;
+    quint32 reserved;
+};
+
+// Records after the index are packed without padding, so they are copied out rather than pointed at
+template <typename T>
+static bool readRecord(const uchar *&data, const uchar *end, T *record)
+{
+    if (end - data < static_cast<qptrdiff>(sizeof(T)))
+        return false;
+
+    std::memcpy(record, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+template <typename T>
+static void appendRecord(QByteArray &out, const T &record)
+{
+    out.append(reinterpret_cast<const char *>(&record), sizeof(T));
+}
+
+static Macro *decodeMacro(const uchar *data, const uchar *end)
+{
+    MacroRecord record;
+    if (!readRecord(data, end, &record) || quint64(end - data) < record.nameLength)
+        return Q_NULLPTR;
+
+    Macro *macro = new Macro();
+    macro->setName(QString::fromUtf8(reinterpret_cast<const char *>(data), record.nameLength));
+    data += record.nameLength;
+
+    QVector<MacroStep> &steps = macro->getSteps();
+    steps.reserve(qMin<quint32>(record.stepCount, (end - data) / sizeof(StepRecord)));
+
+    for (quint32 i = 0; i < record.stepCount; ++i) {
+        StepRecord stepRecord;
+        if (!readRecord(data, end, &stepRecord) || quint64(end - data) < stepRecord.strLength || stepRecord.repeat < 1) {
+            delete macro;
+            return Q_NULLPTR;
+        }
+
+        MacroStep step;
+        step.message = static_cast<Scintilla::Message>(stepRecord.message);
+        step.wParam = static_cast<Scintilla::uptr_t>(stepRecord.wParam);
+        step.lParam = static_cast<Scintilla::sptr_t>(stepRecord.lParam);
+        step.str = QByteArray(reinterpret_cast<const char *>(data), stepRecord.strLength);
+        step.repeat = stepRecord.repeat;
+        data += stepRecord.strLength;
+
+        steps.append(step);
+    }
+
+    return macro;
+}
+
+static void encodeMacro(QByteArray &out, const Macro *macro)
+{
+    const QByteArray name = macro->getName().toUtf8();
+
+    appendRecord(out, MacroRecord{static_cast<quint32>(name.size()), static_cast<quint32>(macro->getSteps().size())});
+    out.append(name);
+
+    for (const MacroStep &step : macro->getSteps()) {
+        const QByteArray str = MacroStep::MessageHasString(step.message) ? step.str : QByteArray();
+
+        appendRecord(out, StepRecord{static_cast<qint32>(step.message), step.repeat, static_cast<quint64>(step.wParam), static_cast<qint64>(step.lParam), static_cast<quint32>(str.size()), 0});
+        out.append(str);
+    }
+}
+
+// Only reads the header, so it is cheap enough to answer whether there are any macros without loading them
+int MacroStore::count(const QString &fileName)
+{
+    QFile file(fileName);
+    Header header;
+
+    if (!file.open(QIODevice::ReadOnly) || file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+        return -1;
+
+    if (header.magic != STORE_MAGIC || header.version != STORE_VERSION)
+        return -1;
+
+    return static_cast<int>(header.macroCount);
+}
+
+bool MacroStore::load(const QString &fileName, QVector<Macro *> &macros)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 length = file.size();
+    if (length < static_cast<qint64>(sizeof(Header))) {
+        qWarning("MacroStore: \"%s\" is too short to hold any macros", qUtf8Printable(fileName));
+        return false;
+    }
+
+    const uchar *data = file.map(0, length);
+    if (data == Q_NULLPTR) {
+        qWarning("QFile::map() failed for \"%s\": %s", qUtf8Printable(fileName), qUtf8Printable(file.errorString()));
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(data);
+
+    if (header->magic != STORE_MAGIC || header->version != STORE_VERSION || quint64(header->macroCount) * sizeof(IndexEntry) > quint64(length) - sizeof(Header)) {
+        qWarning("MacroStore: \"%s\" is not a macro file this version can read", qUtf8Printable(fileName));
+        file.unmap(const_cast<uchar *>(data));
+        return false;
+    }
+
+    const IndexEntry *index = reinterpret_cast<const IndexEntry *>(data + sizeof(Header));
+
+    for (quint32 i = 0; i < header->macroCount; ++i) {
+        const IndexEntry &entry = index[i];
+        Macro *macro = Q_NULLPTR;
+
+        if (entry.offset <= quint64(length) && entry.length <= quint64(length) - entry.offset)
+            macro = decodeMacro(data + entry.offset, data + entry.offset + entry.length);
+
+        if (macro)
+            macros.append(macro);
+        else
+            qWarning("MacroStore: Skipping invalid Macro %u in \"%s\"", i, qUtf8Printable(fileName));
+    }
+
+    qCDebug(lcMacro, "Loaded %d macros from %s", static_cast<int>(macros.size()), qUtf8Printable(fileName));
+
+    file.unmap(const_cast<uchar *>(data));
+    return true;
+}
+
+bool MacroStore::save(const QString &fileName, const QVector<Macro *> &macros)
+{
+    QByteArray records;
+    QVector<IndexEntry> index;
+    const quint64 recordsStart = sizeof(Header) + quint64(macros.size()) * sizeof(IndexEntry);
+
+    index.reserve(macros.size());
+    for (const Macro *macro : macros) {
+        const quint64 offset = records.size();
+
+        encodeMacro(records, macro);
+        index.append({recordsStart + offset, records.size() - offset});
+    }
+
+    QByteArray out;
+    out.reserve(static_cast<int>(recordsStart + records.size()));
+    appendRecord(out, Header{STORE_MAGIC, STORE_VERSION, static_cast<quint32>(macros.size()), 0});
+    for (const IndexEntry &entry : qAsConst(index))
+        appendRecord(out, entry);
+    out.append(records);
+
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) && file.write(out) == out.size() && file.commit())
+        return true;
+
+    qWarning("Unable to save macros to %s: %s", qUtf8Printable(fileName), qUtf8Printable(file.errorString()));
+    return false;
+}
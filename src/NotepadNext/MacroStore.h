@@ -0,0 +1,41 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MACROSTORE_H
+#define MACROSTORE_H
+
+#include <QString>
+#include <QVector>
+
+class Macro;
+
+
+// Saved macros live in their own binary file next to the settings rather than as blobs inside the INI file.
+// The file is a small header, an index with the offset and size of each macro, then the macros themselves with
+// full 64 bit parameters and repeat counts. Reading it maps the file and decodes each macro through the index,
+// so a damaged macro is skipped without losing the rest.
+class MacroStore
+{
+public:
+    static int count(const QString &fileName);
+    static bool load(const QString &fileName, QVector<Macro *> &macros);
+    static bool save(const QString &fileName, const QVector<Macro *> &macros);
+};
+
+#endif // MACROSTORE_H
@@ -0,0 +1,317 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MappedFileHexModel.h"
+#include "EditorHexViewerTableModel.h"
+
+#include <algorithm>
+#include <limits>
+
+
+// How much of the file is mapped at once. Rows never straddle two windows since this is a multiple of 16, and mapping
+// offsets have to be a multiple of the page size, which this is on every platform.
+const qint64 WINDOW_SIZE = 1024 * 1024;
+
+// How many windows stay mapped, the least recently used one goes when another is needed
+const int MAX_WINDOWS = 8;
+
+static qint64 IndexToPos(const QModelIndex &index)
+{
+    return static_cast<qint64>(index.row()) * 16 + index.column();
+}
+
+MappedFileHexModel::MappedFileHexModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+MappedFileHexModel::~MappedFileHexModel()
+{
+    unmapAll();
+}
+
+bool MappedFileHexModel::openFile(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    beginResetModel();
+
+    unmapAll();
+    patches.clear();
+    file.close();
+    file.setFileName(filePath);
+
+    const bool opened = file.open(QIODevice::ReadOnly);
+    if (!opened) {
+        qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(filePath), file.error(), qUtf8Printable(file.errorString()));
+    }
+
+    size = opened ? file.size() : 0;
+
+    endResetModel();
+
+    return opened;
+}
+
+bool MappedFileHexModel::save()
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (patches.isEmpty())
+        return true;
+
+    // Nothing should be mapped while the file is being written to
+    unmapAll();
+
+    QFile out(file.fileName());
+    if (!out.open(QIODevice::ReadWrite)) {
+        qWarning("QFile::open() failed when saving \"%s\" - error code %d: %s", qUtf8Printable(out.fileName()), out.error(), qUtf8Printable(out.errorString()));
+        return false;
+    }
+
+    // Write each run of consecutive patched bytes in one go
+    auto it = patches.constBegin();
+    while (it != patches.constEnd()) {
+        const qint64 start = it.key();
+        QByteArray run;
+
+        do {
+            run.append(it.value());
+            ++it;
+        } while (it != patches.constEnd() && it.key() == start + run.size());
+
+        if (!out.seek(start) || out.write(run) != run.size()) {
+            qWarning("Failed writing to \"%s\": %s", qUtf8Printable(out.fileName()), qUtf8Printable(out.errorString()));
+            return false;
+        }
+    }
+
+    out.close();
+
+    patches.clear();
+    emit modificationChanged(false);
+
+    return true;
+}
+
+void MappedFileHexModel::revert()
+{
+    if (patches.isEmpty())
+        return;
+
+    beginResetModel();
+    patches.clear();
+    endResetModel();
+
+    emit modificationChanged(false);
+}
+
+QVariant MappedFileHexModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::DisplayRole) {
+        if (orientation == Qt::Horizontal) {
+            if (section == 16) return QVariant();
+
+            return EditorHexViewerTableModel::hexString(static_cast<unsigned char>(section));
+        }
+        else if (orientation == Qt::Vertical) {
+            return QString("%1").arg(static_cast<qint64>(section) * 16, 8, 16, QChar('0')).toUpper();
+        }
+    }
+    else if (role == Qt::TextAlignmentRole) {
+        return Qt::AlignCenter;
+    }
+
+    return QVariant();
+}
+
+int MappedFileHexModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    // Views only go up to INT_MAX rows, which is 32 GB
+    return static_cast<int>(qMin<qint64>((size + 15) / 16, std::numeric_limits<int>::max()));
+}
+
+int MappedFileHexModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return 16 + 1;
+}
+
+QVariant MappedFileHexModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    if (role == EditorHexViewerTableModel::ByteRole) {
+        const QByteArray bytes = rowBytes(index.row());
+        if (index.column() >= bytes.size()) return QVariant();
+
+        return static_cast<int>(static_cast<unsigned char>(bytes.at(index.column())));
+    }
+    else if (role == EditorHexViewerTableModel::RowBytesRole) {
+        return rowBytes(index.row());
+    }
+    else if (role == Qt::DisplayRole || role == Qt::EditRole || role == Qt::ToolTipRole) {
+        const QByteArray bytes = rowBytes(index.row());
+
+        if (index.column() == 16) {
+            QString str;
+            str.reserve(bytes.size());
+
+            for (char ch : bytes) {
+                QChar c = QChar(static_cast<uchar>(ch));
+                str += c.isPrint() ? c : '.';
+            }
+
+            return str;
+        }
+
+        if (index.column() >= bytes.size()) return QVariant();
+
+        return EditorHexViewerTableModel::hexString(static_cast<unsigned char>(bytes.at(index.column())));
+    }
+    else if (role == Qt::TextAlignmentRole) {
+        if (index.column() == 16) return Qt::AlignVCenter;
+        else return Qt::AlignCenter;
+    }
+
+    return QVariant();
+}
+
+bool MappedFileHexModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (index.isValid() && role == Qt::EditRole && index.column() < 16) {
+        bool ok;
+        unsigned int charValue = value.toString().toInt(&ok, 16);
+        const qint64 pos = IndexToPos(index);
+
+        if (ok && charValue <= 255 && pos < size) {
+            const bool wasModified = isModified();
+
+            qint64 available = 0;
+            const uchar *original = mapped(pos, &available);
+
+            // Setting a byte back to what is in the file is no longer a change
+            if (original && *original == charValue) {
+                patches.remove(pos);
+            }
+            else {
+                patches.insert(pos, static_cast<char>(charValue));
+            }
+
+            emit dataChanged(index, index.sibling(index.row(), 16));
+
+            if (wasModified != isModified()) {
+                emit modificationChanged(isModified());
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Qt::ItemFlags MappedFileHexModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    if (index.column() == 16) {
+        // The string displayed at the end
+        return Qt::ItemIsEnabled;
+    }
+    else if (IndexToPos(index) >= size) {
+        // The potentially empty cells past the end of the file
+        return Qt::NoItemFlags;
+    }
+    else {
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+    }
+}
+
+QByteArray MappedFileHexModel::rowBytes(int row) const
+{
+    const qint64 start = static_cast<qint64>(row) * 16;
+    if (row < 0 || start >= size)
+        return QByteArray();
+
+    qint64 available = 0;
+    const uchar *data = mapped(start, &available);
+    if (data == Q_NULLPTR)
+        return QByteArray();
+
+    QByteArray bytes(reinterpret_cast<const char *>(data), static_cast<int>(qMin<qint64>(16, available)));
+
+    for (auto it = patches.lowerBound(start); it != patches.constEnd() && it.key() < start + bytes.size(); ++it) {
+        bytes[static_cast<int>(it.key() - start)] = it.value();
+    }
+
+    return bytes;
+}
+
+const uchar *MappedFileHexModel::mapped(qint64 offset, qint64 *available) const
+{
+    const qint64 windowOffset = offset - (offset % WINDOW_SIZE);
+
+    auto it = std::find_if(windows.begin(), windows.end(), [=](const Window &window) {
+        return window.offset == windowOffset;
+    });
+
+    if (it == windows.end()) {
+        if (windows.size() >= MAX_WINDOWS) {
+            auto oldest = std::min_element(windows.begin(), windows.end(), [](const Window &a, const Window &b) {
+                return a.lastUsed < b.lastUsed;
+            });
+
+            file.unmap(oldest->data);
+            windows.erase(oldest);
+        }
+
+        const qint64 length = qMin(WINDOW_SIZE, size - windowOffset);
+        uchar *data = file.map(windowOffset, length);
+
+        if (data == Q_NULLPTR) {
+            qWarning("QFile::map() failed for \"%s\": %s", qUtf8Printable(file.fileName()), qUtf8Printable(file.errorString()));
+            return Q_NULLPTR;
+        }
+
+        windows.append({windowOffset, data, length, 0});
+        it = windows.end() - 1;
+    }
+
+    it->lastUsed = ++useCounter;
+    *available = it->offset + it->length - offset;
+
+    return it->data + (offset - it->offset);
+}
+
+void MappedFileHexModel::unmapAll()
+{
+    for (const Window &window : qAsConst(windows)) {
+        file.unmap(window.data);
+    }
+
+    windows.clear();
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MAPPEDFILEHEXMODEL_H
+#define MAPPEDFILEHEXMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFile>
+#include <QMap>
+#include <QVector>
+
+
+// The same layout and roles as EditorHexViewerTableModel, but for the bytes of a file on disk rather than an editor.
+// The file is memory mapped a window at a time as rows are asked for and only a few windows are kept mapped, so
+// looking through a file of any size only costs the parts of it that are viewed. Edits are kept as a list of
+// patched bytes over the file and only written back to it by save().
+class MappedFileHexModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit MappedFileHexModel(QObject *parent = nullptr);
+    ~MappedFileHexModel() override;
+
+    bool openFile(const QString &filePath);
+    QString filePath() const { return file.fileName(); }
+    qint64 fileSize() const { return size; }
+
+    bool isModified() const { return !patches.isEmpty(); }
+    bool save();
+    void revert();
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role) override;
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+signals:
+    void modificationChanged(bool modified);
+
+private:
+    struct Window {
+        qint64 offset;
+        uchar *data;
+        qint64 length;
+        quint64 lastUsed;
+    };
+
+    QByteArray rowBytes(int row) const;
+    const uchar *mapped(qint64 offset, qint64 *available) const;
+    void unmapAll();
+
+    mutable QFile file;
+    qint64 size = 0;
+
+    mutable QVector<Window> windows;
+    mutable quint64 useCounter = 0;
+
+    QMap<qint64, char> patches;
+};
+
+#endif // MAPPEDFILEHEXMODEL_H
@@ -0,0 +1,594 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MatchIndex.h"
+#include "ScintillaNext.h"
+
+#include <algorithm>
+
+using namespace Scintilla;
+
+
+// The lines around the screen are only filled ahead of time if they add up to no more than this
+const Sci_PositionCR NEAR_VIEWPORT_LIMIT = 1024 * 1024;
+
+static bool startsBefore(const Sci_CharacterRange &range, Sci_PositionCR position)
+{
+    return range.cpMin < position;
+}
+
+static bool endsBefore(const Sci_CharacterRange &range, Sci_PositionCR position)
+{
+    return range.cpMax <= position;
+}
+
+static bool sameRanges(const QVector<Sci_CharacterRange> &a, const QVector<Sci_CharacterRange> &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Sci_CharacterRange &x, const Sci_CharacterRange &y) {
+        return x.cpMin == y.cpMin && x.cpMax == y.cpMax;
+    });
+}
+
+// A screen's worth of lines either side of what a view shows, but not if they are long lines as only the part of those
+// that is on screen matters
+static QVector<Sci_CharacterRange> aroundViewport(ScintillaNext *view)
+{
+    const Sci_Position firstVisible = view->firstVisibleLine();
+    const Sci_Position linesOnScreen = view->linesOnScreen();
+    const Sci_Position firstLine = view->docLineFromVisible(firstVisible);
+    const Sci_Position lastLine = view->docLineFromVisible(firstVisible + linesOnScreen);
+
+    const Sci_CharacterRange above {
+        static_cast<Sci_PositionCR>(view->positionFromLine(view->docLineFromVisible(qMax<Sci_Position>(0, firstVisible - linesOnScreen)))),
+        static_cast<Sci_PositionCR>(view->positionFromLine(firstLine))
+    };
+    const Sci_CharacterRange below {
+        static_cast<Sci_PositionCR>(view->positionFromLine(lastLine + 1)),
+        static_cast<Sci_PositionCR>(view->lineEndPosition(view->docLineFromVisible(firstVisible + 2 * linesOnScreen)))
+    };
+
+    QVector<Sci_CharacterRange> ranges;
+
+    for (const Sci_CharacterRange &range : {above, below}) {
+        if (range.cpMin < range.cpMax && range.cpMax - range.cpMin <= NEAR_VIEWPORT_LIMIT) {
+            ranges.append(range);
+        }
+    }
+
+    return ranges;
+}
+
+MatchIndex *MatchIndex::forEditor(ScintillaNext *editor)
+{
+    MatchIndex *index = editor->findChild<MatchIndex *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (index == Q_NULLPTR) {
+        index = new MatchIndex(editor);
+    }
+
+    return index;
+}
+
+MatchIndex::MatchIndex(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("MatchIndex");
+
+    connect(editor, &ScintillaEdit::notify, this, &MatchIndex::notify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &MatchIndex::rebuild);
+    connect(editor, &ScintillaNext::resized, this, [=]() {
+        for (int indicator : unfilled.keys()) {
+            fillNearViewport(indicator);
+        }
+
+        updateViewportFills();
+    });
+
+    editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    // The indicators belong to the document, so what is filled around the screen has to cover every view of it
+    for (ScintillaNext *view : editor->documentViews()) {
+        if (view != editor) {
+            watchView(view);
+        }
+    }
+
+    connect(editor->documentOwner(), &ScintillaNext::cloned, this, &MatchIndex::watchView);
+}
+
+qint64 MatchIndex::memoryUsage() const
+{
+    qint64 bytes = 0;
+
+    for (const std::vector<Sci_CharacterRange> &matches : indicatorMatches) {
+        bytes += matches.capacity() * sizeof(Sci_CharacterRange);
+    }
+
+    return bytes;
+}
+
+size_t MatchIndex::releaseIndicators(size_t minimumMatches)
+{
+    size_t released = 0;
+
+    for (auto it = indicatorMatches.constBegin(); it != indicatorMatches.constEnd(); ++it) {
+        const int indicator = it.key();
+
+        // Those are never filled far from the screen in the first place
+        if (viewportFills.contains(indicator) || it->size() < minimumMatches) {
+            continue;
+        }
+
+        editor->setIndicatorCurrent(indicator);
+        editor->indicatorClearRange(0, editor->length());
+
+        unfilled[indicator].addAll(editor);
+        fillNearViewport(indicator);
+
+        released += it->size();
+    }
+
+    return released;
+}
+
+const std::vector<Sci_CharacterRange> &MatchIndex::matches(int indicator) const
+{
+    static const std::vector<Sci_CharacterRange> none;
+
+    auto it = indicatorMatches.constFind(indicator);
+
+    return it == indicatorMatches.constEnd() ? none : it.value();
+}
+
+size_t MatchIndex::lowerBound(int indicator, Sci_PositionCR position) const
+{
+    const std::vector<Sci_CharacterRange> &ranges = matches(indicator);
+
+    return std::distance(ranges.begin(), std::lower_bound(ranges.begin(), ranges.end(), position, startsBefore));
+}
+
+void MatchIndex::setMatches(int indicator, const std::vector<Sci_CharacterRange> &matches, bool fillLazily)
+{
+    editor->setIndicatorCurrent(indicator);
+    editor->indicatorClearRange(0, editor->length());
+
+    unfilled.remove(indicator);
+
+    if (matches.empty()) {
+        indicatorMatches.remove(indicator);
+    }
+    else {
+        indicatorMatches.insert(indicator, matches);
+    }
+
+    auto fill = viewportFills.find(indicator);
+
+    if (fill != viewportFills.end()) {
+        fill->filled.clear();
+        fill->outdated = true;
+        fill->generation = editor->changeGeneration();
+
+        updateViewportFill(indicator, fill.value(), viewportWindow());
+    }
+    else if (fillLazily && !matches.empty()) {
+        unfilled[indicator].addAll(editor);
+        fillNearViewport(indicator);
+    }
+    else {
+        for (const Sci_CharacterRange &range : matches) {
+            editor->indicatorFillRange(range.cpMin, range.cpMax - range.cpMin);
+        }
+    }
+
+    emit matchesChanged(indicator);
+}
+
+void MatchIndex::fillNearViewport(int indicator)
+{
+    auto it = unfilled.find(indicator);
+
+    if (it == unfilled.end()) {
+        return;
+    }
+
+    PendingRanges &pending = it.value();
+    QVector<Sci_CharacterRange> ranges = pending.takeVisible(editor);
+
+    // The lines either side are filled as well so scrolling a bit doesn't show them appearing
+    for (const Sci_CharacterRange &range : aroundViewport(editor)) {
+        ranges.append(pending.take(range));
+    }
+
+    for (const Sci_CharacterRange &range : qAsConst(ranges)) {
+        fillRange(indicator, range);
+    }
+
+    if (pending.isEmpty()) {
+        unfilled.erase(it);
+    }
+}
+
+void MatchIndex::fillRange(int indicator, const Sci_CharacterRange &range)
+{
+    const std::vector<Sci_CharacterRange> &ranges = matches(indicator);
+
+    // Any match that overlaps the range gets filled in full, filling part of one twice doesn't matter
+    auto match = std::lower_bound(ranges.begin(), ranges.end(), range.cpMin, endsBefore);
+
+    editor->setIndicatorCurrent(indicator);
+
+    for (; match != ranges.end() && match->cpMin < range.cpMax; ++match) {
+        editor->indicatorFillRange(match->cpMin, match->cpMax - match->cpMin);
+    }
+}
+
+void MatchIndex::replaceMatches(int indicator, const Sci_CharacterRange &range, const std::vector<Sci_CharacterRange> &matches)
+{
+    auto fill = viewportFills.find(indicator);
+
+    if (fill == viewportFills.end()) {
+        editor->setIndicatorCurrent(indicator);
+        editor->indicatorClearRange(range.cpMin, range.cpMax - range.cpMin);
+
+        for (const Sci_CharacterRange &match : matches) {
+            editor->indicatorFillRange(match.cpMin, match.cpMax - match.cpMin);
+        }
+    }
+
+    std::vector<Sci_CharacterRange> &ranges = indicatorMatches[indicator];
+
+    // Anything that started inside the range has just been cleared from the indicator
+    auto first = std::lower_bound(ranges.begin(), ranges.end(), range.cpMin, startsBefore);
+    auto last = std::lower_bound(first, ranges.end(), range.cpMax, startsBefore);
+
+    first = ranges.erase(first, last);
+    ranges.insert(first, matches.begin(), matches.end());
+
+    if (ranges.empty()) {
+        indicatorMatches.remove(indicator);
+    }
+
+    if (fill != viewportFills.end()) {
+        fill->generation = editor->changeGeneration();
+
+        // Most of the document is replaced a piece at a time off screen, which doesn't need the indicator touched
+        for (const Sci_CharacterRange &filled : qAsConst(fill->filled)) {
+            if (filled.cpMin <= range.cpMax && range.cpMin <= filled.cpMax) {
+                fill->outdated = true;
+                updateViewportFill(indicator, fill.value(), viewportWindow());
+                break;
+            }
+        }
+    }
+
+    emit matchesChanged(indicator);
+}
+
+void MatchIndex::clear(int indicator)
+{
+    setMatches(indicator, {});
+}
+
+void MatchIndex::setRangeSource(int indicator, RangeSource source)
+{
+    // Whatever was filled in before could be anywhere
+    editor->setIndicatorCurrent(indicator);
+    editor->indicatorClearRange(0, editor->length());
+
+    unfilled.remove(indicator);
+
+    ViewportFill &fill = viewportFills[indicator];
+    fill.source = source;
+    fill.filled.clear();
+    fill.outdated = true;
+    fill.generation = editor->changeGeneration();
+
+    updateViewportFill(indicator, fill, viewportWindow());
+}
+
+void MatchIndex::removeRangeSource(int indicator)
+{
+    if (viewportFills.remove(indicator) == 0) {
+        return;
+    }
+
+    // The whole document is filled from the index again
+    setMatches(indicator, matches(indicator), true);
+}
+
+void MatchIndex::sourceChanged(int indicator)
+{
+    auto fill = viewportFills.find(indicator);
+
+    if (fill != viewportFills.end()) {
+        fill->outdated = true;
+        updateViewportFill(indicator, fill.value(), viewportWindow());
+    }
+}
+
+void MatchIndex::watchView(ScintillaNext *view)
+{
+    // Scrolling any of the views can bring something into view that isn't filled yet
+    connect(view, &ScintillaEdit::notify, this, [=](const NotificationData *pscn) {
+        if (pscn->nmhdr.code == Notification::UpdateUI) {
+            updateViewportFills();
+        }
+    });
+    connect(view, &ScintillaNext::resized, this, &MatchIndex::updateViewportFills);
+}
+
+QVector<Sci_CharacterRange> MatchIndex::viewportWindow() const
+{
+    QVector<Sci_CharacterRange> ranges;
+
+    for (ScintillaNext *view : editor->documentViews()) {
+        ranges.append(view->visibleRanges());
+        ranges.append(aroundViewport(view));
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const Sci_CharacterRange &a, const Sci_CharacterRange &b) {
+        return a.cpMin < b.cpMin;
+    });
+
+    // Views of the same part of the document end up overlapping
+    QVector<Sci_CharacterRange> window;
+
+    for (const Sci_CharacterRange &range : qAsConst(ranges)) {
+        if (!window.isEmpty() && range.cpMin <= window.last().cpMax) {
+            window.last().cpMax = qMax(window.last().cpMax, range.cpMax);
+        }
+        else {
+            window.append(range);
+        }
+    }
+
+    return window;
+}
+
+void MatchIndex::updateViewportFills()
+{
+    if (viewportFills.isEmpty()) {
+        return;
+    }
+
+    const QVector<Sci_CharacterRange> window = viewportWindow();
+
+    for (auto it = viewportFills.begin(); it != viewportFills.end(); ++it) {
+        updateViewportFill(it.key(), it.value(), window);
+    }
+}
+
+void MatchIndex::updateViewportFill(int indicator, ViewportFill &fill, const QVector<Sci_CharacterRange> &window)
+{
+    if (!fill.outdated && sameRanges(fill.window, window)) {
+        return;
+    }
+
+    editor->setIndicatorCurrent(indicator);
+
+    for (const Sci_CharacterRange &range : qAsConst(fill.filled)) {
+        editor->indicatorClearRange(range.cpMin, range.cpMax - range.cpMin);
+    }
+
+    fill.filled.clear();
+
+    const std::vector<Sci_CharacterRange> &indexed = matches(indicator);
+
+    for (const Sci_CharacterRange &range : window) {
+        std::vector<Sci_CharacterRange> sourced;
+        const Sci_CharacterRange *match;
+        const Sci_CharacterRange *end;
+
+        if (fill.source) {
+            sourced = fill.source(range);
+            match = sourced.data();
+            end = match + sourced.size();
+        }
+        else {
+            match = indexed.data() + std::distance(indexed.begin(), std::lower_bound(indexed.begin(), indexed.end(), range.cpMin, endsBefore));
+            end = indexed.data() + indexed.size();
+        }
+
+        // Any match that overlaps the window gets filled in full, so remember how far that went to clear it later
+        Sci_CharacterRange extent = range;
+
+        for (; match != end && match->cpMin < range.cpMax; ++match) {
+            editor->indicatorFillRange(match->cpMin, match->cpMax - match->cpMin);
+
+            extent.cpMin = qMin(extent.cpMin, match->cpMin);
+            extent.cpMax = qMax(extent.cpMax, match->cpMax);
+        }
+
+        fill.filled.append(extent);
+    }
+
+    fill.window = window;
+    fill.outdated = false;
+}
+
+void MatchIndex::notify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code == Notification::UpdateUI) {
+        for (int indicator : unfilled.keys()) {
+            fillNearViewport(indicator);
+        }
+
+        // This is sent just before painting, which is when the indicators that only cover the screen get filled in
+        updateViewportFills();
+
+        return;
+    }
+
+    if (pscn->nmhdr.code != Notification::Modified) {
+        return;
+    }
+
+    if (!viewportFills.isEmpty() && (FlagSet(pscn->modificationType, ModificationFlags::InsertText) || FlagSet(pscn->modificationType, ModificationFlags::DeleteText))) {
+        const Sci_PositionCR position = static_cast<Sci_PositionCR>(pscn->position);
+        const Sci_PositionCR length = static_cast<Sci_PositionCR>(pscn->length);
+        const bool inserted = FlagSet(pscn->modificationType, ModificationFlags::InsertText);
+
+        // Scintilla moves the filled in parts along with the text, these have to follow so they can be cleared
+        auto adjust = [=](Sci_PositionCR pos) {
+            if (inserted)
+                return pos >= position ? pos + length : pos;
+            else
+                return pos <= position ? pos : qMax(position, pos - length);
+        };
+
+        for (ViewportFill &fill : viewportFills) {
+            for (Sci_CharacterRange &range : fill.filled) {
+                range.cpMin = adjust(range.cpMin);
+                range.cpMax = adjust(range.cpMax);
+            }
+
+            fill.outdated = true;
+        }
+    }
+
+    if (indicatorMatches.isEmpty()) {
+        return;
+    }
+
+    // The lines that were edited are filled again in case a match moved into them
+    for (PendingRanges &pending : unfilled) {
+        pending.documentModified(editor, pscn);
+    }
+
+    const bool inserted = FlagSet(pscn->modificationType, ModificationFlags::InsertText);
+    const bool deleted = FlagSet(pscn->modificationType, ModificationFlags::DeleteText);
+
+    if (!inserted && !deleted) {
+        return;
+    }
+
+    const Sci_PositionCR position = static_cast<Sci_PositionCR>(pscn->position);
+    const Sci_PositionCR length = static_cast<Sci_PositionCR>(pscn->length);
+
+    QList<int> changed;
+
+    for (auto it = indicatorMatches.begin(); it != indicatorMatches.end();) {
+        std::vector<Sci_CharacterRange> &ranges = it.value();
+
+        // Only the matches that end after the change can be affected by it
+        auto first = std::lower_bound(ranges.begin(), ranges.end(), position, endsBefore);
+
+        if (first == ranges.end()) {
+            ++it;
+            continue;
+        }
+
+        changed.append(it.key());
+
+        if (inserted) {
+            // Text inserted inside of a match becomes part of it, same as the indicator
+            for (auto range = first; range != ranges.end(); ++range) {
+                if (range->cpMin >= position)
+                    range->cpMin += length;
+                range->cpMax += length;
+            }
+        }
+        else {
+            auto adjust = [=](Sci_PositionCR pos) {
+                return pos <= position ? pos : qMax(position, pos - length);
+            };
+
+            for (auto range = first; range != ranges.end(); ++range) {
+                range->cpMin = adjust(range->cpMin);
+                range->cpMax = adjust(range->cpMax);
+            }
+
+            // Matches that were deleted entirely are gone from the indicator too
+            ranges.erase(std::remove_if(first, ranges.end(), [](const Sci_CharacterRange &range) {
+                return range.cpMin >= range.cpMax;
+            }), ranges.end());
+        }
+
+        if (ranges.empty()) {
+            it = indicatorMatches.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (const int indicator : qAsConst(changed)) {
+        emit matchesChanged(indicator);
+    }
+}
+
+void MatchIndex::rebuild()
+{
+    // Matches that were never filled in can't be read back, so lazily filled indicators are dropped altogether
+    for (int indicator : unfilled.keys()) {
+        clear(indicator);
+    }
+
+    // The same goes for the ones only filled around the screen, unless whatever found them has already done it again
+    for (auto it = viewportFills.begin(); it != viewportFills.end(); ++it) {
+        editor->setIndicatorCurrent(it.key());
+        editor->indicatorClearRange(0, editor->length());
+
+        it->filled.clear();
+        it->outdated = true;
+
+        if (!it->source && it->generation != editor->changeGeneration() && indicatorMatches.remove(it.key()) > 0) {
+            emit matchesChanged(it.key());
+        }
+    }
+
+    // The text changed without the index hearing about it, but Scintilla kept the indicators lined up with
+    // it so they are read back. Matches right next to each other can't be told apart and become one.
+    const Sci_Position length = editor->length();
+
+    for (int indicator : indicatorMatches.keys()) {
+        if (viewportFills.contains(indicator)) {
+            continue;
+        }
+
+        std::vector<Sci_CharacterRange> ranges;
+
+        Sci_Position position = 0;
+        while (position < length) {
+            const Sci_Position end = editor->indicatorEnd(indicator, position);
+
+            if (editor->indicatorValueAt(indicator, position) != 0) {
+                ranges.push_back({static_cast<Sci_PositionCR>(position), static_cast<Sci_PositionCR>(end)});
+            }
+
+            if (end <= position) {
+                break;
+            }
+
+            position = end;
+        }
+
+        if (ranges.empty()) {
+            indicatorMatches.remove(indicator);
+        }
+        else {
+            indicatorMatches.insert(indicator, ranges);
+        }
+
+        emit matchesChanged(indicator);
+    }
+
+    updateViewportFills();
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATCHINDEX_H
+#define MATCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+
+#include <functional>
+#include <vector>
+
+#include "PendingRanges.h"
+#include "Scintilla.h"
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Keeps the sorted ranges of every match that is currently highlighted with an indicator, so anything
+// that wants to know where the matches are can ask here rather than searching or walking the indicator
+// again. The ranges are moved along with the text as the document is edited, the same way Scintilla
+// moves the indicators themselves. There is one per editor, use MatchIndex::forEditor() to get it.
+//
+// Matches can also be given to the index without filling the indicator for all of them up front. Only the
+// ones on and around the screen are filled straight away and the rest are filled as they are scrolled to.
+//
+// An indicator can instead be given a range source, after which only the matches around what is on screen in
+// any view of the document are ever kept in the indicator. That keeps Scintilla from storing and clearing
+// runs for every match when there can be millions of them.
+class MatchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Gives the matches of an indicator that overlap range, in order
+    typedef std::function<std::vector<Sci_CharacterRange>(const Sci_CharacterRange &range)> RangeSource;
+
+    static MatchIndex *forEditor(ScintillaNext *editor);
+
+    const std::vector<Sci_CharacterRange> &matches(int indicator) const;
+
+    // Index of the first match that starts at or after position, or the number of matches if there is none
+    size_t lowerBound(int indicator, Sci_PositionCR position) const;
+
+    // These update the indicator in the editor as well as the index. If fillLazily is set only the matches
+    // near the viewport are filled in the indicator until the rest of them are scrolled into view. Indicators
+    // with a range source are only ever filled near the viewport anyway.
+    void setMatches(int indicator, const std::vector<Sci_CharacterRange> &matches, bool fillLazily = false);
+    void replaceMatches(int indicator, const Sci_CharacterRange &range, const std::vector<Sci_CharacterRange> &matches);
+    void clear(int indicator);
+
+    // The source is only asked for the part of the document around the screen, just before it is painted. Without
+    // one the matches given to the index are used. Call sourceChanged() if what a source gives changes.
+    void setRangeSource(int indicator, RangeSource source = RangeSource());
+    void removeRangeSource(int indicator);
+    void sourceChanged(int indicator);
+
+    qint64 memoryUsage() const;
+
+    // Takes the matches that are away from the screen back out of the indicators they were filled in, they are
+    // filled in again as they are scrolled to the same as with fillLazily. Only indicators with at least
+    // minimumMatches are worth it. Returns how many matches were in the indicators that were released.
+    size_t releaseIndicators(size_t minimumMatches);
+
+signals:
+    void matchesChanged(int indicator);
+
+private slots:
+    void notify(const Scintilla::NotificationData *pscn);
+    void rebuild();
+
+private:
+    struct ViewportFill {
+        RangeSource source;
+
+        // What the indicator was last filled for, and how far that went once the matches sticking out are included
+        QVector<Sci_CharacterRange> window;
+        QVector<Sci_CharacterRange> filled;
+        bool outdated = true;
+
+        // When the matches in the index were last set, so a rebuild can tell if they were already found again
+        quint64 generation = 0;
+    };
+
+    explicit MatchIndex(ScintillaNext *editor);
+
+    void fillNearViewport(int indicator);
+    void fillRange(int indicator, const Sci_CharacterRange &range);
+
+    void watchView(ScintillaNext *view);
+    QVector<Sci_CharacterRange> viewportWindow() const;
+    void updateViewportFills();
+    void updateViewportFill(int indicator, ViewportFill &fill, const QVector<Sci_CharacterRange> &window);
+
+    ScintillaNext *editor;
+    QHash<int, std::vector<Sci_CharacterRange>> indicatorMatches;
+
+    // The parts of the document where a lazily filled indicator hasn't been filled in yet
+    QHash<int, PendingRanges> unfilled;
+
+    QHash<int, ViewportFill> viewportFills;
+};
+
+#endif // MATCHINDEX_H
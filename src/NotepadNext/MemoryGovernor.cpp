@@ -0,0 +1,407 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MemoryGovernor.h"
+#include "EditorManager.h"
+#include "EditorMemoryUsage.h"
+#include "MatchIndex.h"
+#include "MinimapTiles.h"
+#include "ScintillaNext.h"
+#include "WordIndex.h"
+
+#include <QFile>
+#include <QLocale>
+
+#if defined(Q_OS_LINUX)
+#include <QSocketNotifier>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <QWinEventNotifier>
+#define PSAPI_VERSION 2
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <dispatch/dispatch.h>
+#include <mach/mach.h>
+#endif
+
+
+// How often to look when nothing says it is running low
+static const int POLL_INTERVAL_MS = 5000;
+
+// How long to wait after a step to see if it was enough
+static const int STEP_DELAY_MS = 1000;
+
+// Back to the first step once it has been under for this long, or to try every step again if it is still over
+static const int QUIET_MS = 30000;
+static const int RETRY_AFTER_MS = 60000;
+
+// Hidden editors keep this many undo actions
+static const int UNDO_ACTIONS_KEPT = 1000;
+
+// Indicators with fewer matches than this hardly take anything
+static const size_t RELEASE_MINIMUM_MATCHES = 10000;
+
+static const int MAX_REPORTS = 100;
+
+#if defined(Q_OS_LINUX)
+// Signalled when tasks have stalled waiting on memory for 150ms of any 2s, i.e. the kernel is already reclaiming
+static const char PRESSURE_TRIGGER[] = "some 150000 2000000";
+#elif defined(Q_OS_MACOS)
+static void memoryPressure(void *context)
+{
+    QMetaObject::invokeMethod(static_cast<QObject *>(context), "systemLow", Qt::QueuedConnection);
+}
+#endif
+
+
+MemoryGovernor::MemoryGovernor(EditorManager *editorManager, QObject *parent) :
+    QObject(parent),
+    editorManager(editorManager)
+{
+    pollTimer.setInterval(POLL_INTERVAL_MS);
+    connect(&pollTimer, &QTimer::timeout, this, &MemoryGovernor::check);
+    pollTimer.start();
+
+    stepTimer.setSingleShot(true);
+    stepTimer.setInterval(STEP_DELAY_MS);
+    connect(&stepTimer, &QTimer::timeout, this, &MemoryGovernor::check);
+
+#if defined(Q_OS_LINUX)
+    // Unprivileged triggers need a newer kernel, without one /proc/meminfo is all there is
+    pressureFd = ::open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+    if (pressureFd != -1 && ::write(pressureFd, PRESSURE_TRIGGER, sizeof(PRESSURE_TRIGGER)) < 0) {
+        ::close(pressureFd);
+        pressureFd = -1;
+    }
+
+    if (pressureFd != -1) {
+        pressureNotifier = new QSocketNotifier(pressureFd, QSocketNotifier::Exception, this);
+        connect(pressureNotifier, &QSocketNotifier::activated, this, &MemoryGovernor::systemLow);
+    }
+#elif defined(Q_OS_WIN)
+    lowMemoryHandle = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+
+    if (lowMemoryHandle != NULL) {
+        lowMemoryNotifier = new QWinEventNotifier(lowMemoryHandle, this);
+
+        // The handle stays signalled the whole time memory is low, so it is only listened to again once it isn't
+        connect(lowMemoryNotifier, &QWinEventNotifier::activated, this, [=]() {
+            lowMemoryNotifier->setEnabled(false);
+            systemLow();
+        });
+    }
+#elif defined(Q_OS_MACOS)
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                      DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                                      dispatch_get_main_queue());
+
+    if (source) {
+        dispatch_set_context(source, this);
+        dispatch_source_set_event_handler_f(source, memoryPressure);
+        dispatch_resume(source);
+        pressureSource = source;
+    }
+#endif
+}
+
+MemoryGovernor::~MemoryGovernor()
+{
+#if defined(Q_OS_LINUX)
+    if (pressureFd != -1) {
+        delete pressureNotifier;
+        ::close(pressureFd);
+    }
+#elif defined(Q_OS_WIN)
+    if (lowMemoryHandle != NULL) {
+        delete lowMemoryNotifier;
+        CloseHandle(lowMemoryHandle);
+    }
+#elif defined(Q_OS_MACOS)
+    if (pressureSource) {
+        dispatch_source_t source = static_cast<dispatch_source_t>(pressureSource);
+        dispatch_source_cancel(source);
+        dispatch_release(source);
+    }
+#endif
+}
+
+QString MemoryGovernor::stepName(Step step)
+{
+    switch (step) {
+    case Minimap:
+        return tr("Minimap tiles");
+    case WordIndexes:
+        return tr("Word indexes");
+    case IdleEditors:
+        return tr("Hibernate hidden editors");
+    case UndoHistory:
+        return tr("Trim undo history");
+    case Indicators:
+        return tr("Indicators away from the screen");
+    default:
+        return QString();
+    }
+}
+
+qint64 MemoryGovernor::residentSize()
+{
+#if defined(Q_OS_LINUX)
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    // The total size then what is resident, both in pages
+    const QList<QByteArray> fields = statm.readLine().split(' ');
+    if (fields.size() < 2) {
+        return -1;
+    }
+
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+
+    return static_cast<qint64>(counters.WorkingSetSize);
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return -1;
+    }
+
+    return static_cast<qint64>(info.resident_size);
+#else
+    return -1;
+#endif
+}
+
+void MemoryGovernor::setSoftLimit(qint64 bytes)
+{
+    limit = qMax<qint64>(0, bytes);
+
+    // Anything already taken was for the old limit
+    nextStep = Minimap;
+    check();
+}
+
+void MemoryGovernor::check()
+{
+    const qint64 resident = residentSize();
+    const bool over = limit > 0 && resident > limit;
+    const bool low = lowSignalled || systemRunningLow();
+
+    lowSignalled = false;
+
+    if (!over && !low) {
+        // Only start from the cheapest step again once comfortably under, otherwise the first steps would be taken
+        // over and over while hovering around the limit
+        const bool comfortable = limit == 0 || resident < 0 || resident < limit / 10 * 9;
+
+        if (comfortable && (!sinceLastStep.isValid() || sinceLastStep.elapsed() >= QUIET_MS)) {
+            nextStep = Minimap;
+        }
+
+#ifdef Q_OS_WIN
+        if (lowMemoryNotifier) {
+            lowMemoryNotifier->setEnabled(true);
+        }
+#endif
+        return;
+    }
+
+    if (nextStep >= StepCount) {
+        // Everything has been given back already, whatever has built up since is only worth another go now and then
+        if (sinceLastStep.elapsed() < RETRY_AFTER_MS) {
+            return;
+        }
+
+        nextStep = Minimap;
+    }
+
+    Report report;
+    report.when = QDateTime::currentDateTime();
+    report.step = static_cast<Step>(nextStep++);
+    report.resident = resident;
+
+    const QLocale locale;
+    if (over) {
+        report.reason = tr("Using %1, over the soft limit of %2").arg(locale.formattedDataSize(resident), locale.formattedDataSize(limit));
+    }
+    else {
+        report.reason = tr("The system is running low on memory");
+    }
+
+    report.detail = shedStep(report.step);
+    sinceLastStep.start();
+
+    qInfo("Memory governor: %s (%s), %s", qUtf8Printable(stepName(report.step)), qUtf8Printable(report.reason), qUtf8Printable(report.detail));
+
+    history.append(report);
+    while (history.size() > MAX_REPORTS) {
+        history.removeFirst();
+    }
+
+    emit shed(report);
+
+    // See if that was enough before going any further
+    stepTimer.start();
+}
+
+void MemoryGovernor::systemLow()
+{
+    lowSignalled = true;
+
+    if (!stepTimer.isActive()) {
+        check();
+    }
+}
+
+bool MemoryGovernor::systemRunningLow()
+{
+#if defined(Q_OS_LINUX)
+    QFile meminfo(QStringLiteral("/proc/meminfo"));
+    if (!meminfo.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    qint64 total = 0;
+    qint64 available = -1;
+
+    while (!meminfo.atEnd() && (total == 0 || available == -1)) {
+        const QByteArray line = meminfo.readLine();
+        const QList<QByteArray> fields = line.simplified().split(' ');
+
+        if (fields.size() < 2) {
+            continue;
+        }
+
+        if (fields[0] == "MemTotal:") {
+            total = fields[1].toLongLong();
+        }
+        else if (fields[0] == "MemAvailable:") {
+            available = fields[1].toLongLong();
+        }
+    }
+
+    // Less than a twentieth of it left without having to swap
+    return total > 0 && available != -1 && available * 20 < total;
+#elif defined(Q_OS_WIN)
+    BOOL lowMemory = FALSE;
+    return lowMemoryHandle != NULL && QueryMemoryResourceNotification(lowMemoryHandle, &lowMemory) && lowMemory;
+#else
+    // The dispatch source is all there is
+    return false;
+#endif
+}
+
+QString MemoryGovernor::shedStep(Step step)
+{
+    const QLocale locale;
+    QList<ScintillaNext *> editors;
+
+    for (ScintillaNext *editor : editorManager->getEditors()) {
+        if (editor) {
+            editors.append(editor);
+        }
+    }
+
+    switch (step) {
+    case Minimap: {
+        qint64 bytes = 0;
+
+        // Clones share the tiles of the editor the document belongs to
+        for (ScintillaNext *editor : qAsConst(editors)) {
+            MinimapTiles *tiles = editor->findChild<MinimapTiles *>(QString(), Qt::FindDirectChildrenOnly);
+            if (tiles) {
+                bytes += tiles->releaseTiles();
+            }
+        }
+
+        return tr("%1 of tiles").arg(locale.formattedDataSize(bytes));
+    }
+    case WordIndexes: {
+        qint64 bytes = 0;
+        int released = 0;
+
+        for (WordIndex *index : WordIndex::allIndexes()) {
+            if (index->isReleased() || index->getEditor()->isVisible()) {
+                continue;
+            }
+
+            bytes += index->memoryUsage();
+            index->release();
+            ++released;
+        }
+
+        return tr("%n index(es), about %1", "", released).arg(locale.formattedDataSize(bytes));
+    }
+    case IdleEditors: {
+        // Every one that can go does, they are only read back in when they are next shown
+        QList<ScintillaNext *> candidates;
+
+        for (ScintillaNext *editor : qAsConst(editors)) {
+            if (editor->canHibernate()) {
+                candidates.append(editor);
+            }
+        }
+
+        qint64 bytes = 0;
+
+        for (ScintillaNext *editor : qAsConst(candidates)) {
+            bytes += EditorMemoryUsage::measure(editor).total();
+            editor->hibernate();
+        }
+
+        return tr("%n editor(s), about %1", "", candidates.size()).arg(locale.formattedDataSize(bytes));
+    }
+    case UndoHistory: {
+        qint64 bytes = 0;
+        int actions = 0;
+
+        for (ScintillaNext *editor : qAsConst(editors)) {
+            const qint64 before = editor->undoUsage().bytes;
+
+            actions += editor->trimUndoHistory(UNDO_ACTIONS_KEPT);
+            bytes += before - editor->undoUsage().bytes;
+        }
+
+        return tr("%n undo action(s), about %1", "", actions).arg(locale.formattedDataSize(bytes));
+    }
+    case Indicators: {
+        size_t matches = 0;
+
+        for (ScintillaNext *editor : qAsConst(editors)) {
+            MatchIndex *index = editor->findChild<MatchIndex *>(QString(), Qt::FindDirectChildrenOnly);
+            if (index) {
+                matches += index->releaseIndicators(RELEASE_MINIMUM_MATCHES);
+            }
+        }
+
+        return tr("%n match(es) taken out of indicators", "", static_cast<int>(matches));
+    }
+    default:
+        return QString();
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MEMORYGOVERNOR_H
+#define MEMORYGOVERNOR_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+
+class EditorManager;
+class QSocketNotifier;
+class QWinEventNotifier;
+
+// Gives memory back a step at a time when the process goes over the soft limit or the system says it is running low,
+// so the system doesn't have to start swapping the editor out. The cheapest things to rebuild go first: minimap
+// tiles, then the word indexes of hidden editors, then hidden editors are hibernated, then undo histories are
+// trimmed and finally the matches away from the screen are taken out of their indicators. After each step it waits
+// a moment to see if that was enough before taking the next one, and it starts again from the first step once it is
+// comfortably back under the limit.
+//
+// Linux says it is running low through a pressure stall trigger if the kernel allows one, Windows through a memory
+// resource notification and macOS through a dispatch memory pressure source. Anything else is only polled.
+class MemoryGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Step {
+        Minimap,
+        WordIndexes,
+        IdleEditors,
+        UndoHistory,
+        Indicators,
+        StepCount
+    };
+
+    struct Report {
+        QDateTime when;
+        Step step;
+        QString reason;
+        qint64 resident;
+        QString detail;
+    };
+
+    explicit MemoryGovernor(EditorManager *editorManager, QObject *parent = nullptr);
+    ~MemoryGovernor() override;
+
+    static QString stepName(Step step);
+
+    // What the process is using in physical memory right now, or -1 if it can't be told on this platform
+    static qint64 residentSize();
+
+    qint64 softLimit() const { return limit; }
+
+    // The steps taken most recently, oldest first
+    const QList<Report> &reports() const { return history; }
+
+public slots:
+    // In bytes, 0 only reacts to the system running low
+    void setSoftLimit(qint64 bytes);
+    void check();
+
+signals:
+    void shed(const MemoryGovernor::Report &report);
+
+private slots:
+    void systemLow();
+
+private:
+    bool systemRunningLow();
+    QString shedStep(Step step);
+
+    EditorManager *editorManager;
+    QTimer pollTimer;
+    QTimer stepTimer;
+    qint64 limit = 0;
+
+    // The step to take next if it is still over, and when the last one was taken
+    int nextStep = Minimap;
+    QElapsedTimer sinceLastStep;
+
+    // Set when told about it rather than finding out by polling, it is only acted on once
+    bool lowSignalled = false;
+
+    QList<Report> history;
+
+#if defined(Q_OS_LINUX)
+    int pressureFd = -1;
+    QSocketNotifier *pressureNotifier = nullptr;
+#elif defined(Q_OS_WIN)
+    void *lowMemoryHandle = nullptr;
+    QWinEventNotifier *lowMemoryNotifier = nullptr;
+#elif defined(Q_OS_MACOS)
+    void *pressureSource = nullptr;
+#endif
+};
+
+#endif // MEMORYGOVERNOR_H
@@ -0,0 +1,297 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MinimapTiles.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <array>
+#include <climits>
+#include <vector>
+
+using namespace Scintilla;
+
+
+// How long tiles have to go without being invalidated before they are drawn again
+const int RENDER_DELAY_MS = 300;
+
+// Past this the least recently shown tiles are thrown away
+const int MAX_TILES = 128;
+
+using Palette = std::array<QRgb, 256>;
+
+static QRgb fromBgr(sptr_t colour)
+{
+    return qRgb(colour & 0xFF, (colour >> 8) & 0xFF, (colour >> 16) & 0xFF);
+}
+
+// Each line is its bytes interleaved with their styles, the way SCI_GETSTYLEDTEXT gives them
+static QImage renderTile(const std::vector<QByteArray> &lines, const Palette &palette, QRgb background, int tabWidth)
+{
+    QImage image(MinimapTiles::COLUMNS, MinimapTiles::TILE_LINES, QImage::Format_RGB32);
+    image.fill(background);
+
+    for (int y = 0; y < static_cast<int>(lines.size()); ++y) {
+        QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
+        const QByteArray &line = lines[y];
+        int x = 0;
+
+        for (int i = 0; i + 1 < line.size() && x < MinimapTiles::COLUMNS; i += 2) {
+            const uchar c = static_cast<uchar>(line[i]);
+
+            if (c == '\t') {
+                x = (x / tabWidth + 1) * tabWidth;
+            }
+            else if (c == '\r' || c == '\n') {
+                break;
+            }
+            else if (c == ' ') {
+                ++x;
+            }
+            // Only the first byte of a UTF-8 character takes up a column
+            else if ((c & 0xC0) != 0x80) {
+                row[x++] = palette[static_cast<uchar>(line[i + 1])];
+            }
+        }
+    }
+
+    return image;
+}
+
+MinimapTiles *MinimapTiles::forEditor(ScintillaNext *editor)
+{
+    // Clones show the same document, so they share the tiles of the editor it belongs to
+    ScintillaNext *owner = editor->documentOwner();
+    MinimapTiles *tiles = owner->findChild<MinimapTiles *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (tiles == Q_NULLPTR) {
+        tiles = new MinimapTiles(owner);
+    }
+
+    return tiles;
+}
+
+MinimapTiles::MinimapTiles(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("MinimapTiles");
+
+    renderTimer.setSingleShot(true);
+    connect(&renderTimer, &QTimer::timeout, this, &MinimapTiles::renderWanted);
+
+    connect(editor, &ScintillaEdit::notify, this, &MinimapTiles::notify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &MinimapTiles::invalidateAll);
+    connect(editor, &ScintillaNext::lexerChanged, this, &MinimapTiles::invalidateAll);
+}
+
+void MinimapTiles::setActive(bool active)
+{
+    if (this->active == active)
+        return;
+
+    this->active = active;
+
+    if (active) {
+        editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ChangeStyle);
+        invalidateAll();
+    }
+    else {
+        editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+        wanted.clear();
+        renderTimer.stop();
+    }
+}
+
+QImage MinimapTiles::tile(int index)
+{
+    Tile &tile = tiles[index];
+    tile.lastUsed = ++useCount;
+
+    if (!tile.valid && !tile.rendering && !wanted.contains(index)) {
+        wanted.insert(index);
+
+        // A tile that was never drawn has nothing to show in the meantime, so there's no point waiting
+        if (!renderTimer.isActive()) {
+            renderTimer.start(tile.image.isNull() ? 0 : RENDER_DELAY_MS);
+        }
+    }
+
+    return tile.image;
+}
+
+void MinimapTiles::notify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code != Notification::Modified) {
+        return;
+    }
+
+    if (FlagSet(pscn->modificationType, ModificationFlags::InsertText) || FlagSet(pscn->modificationType, ModificationFlags::DeleteText)) {
+        const int line = static_cast<int>(editor->lineFromPosition(pscn->position));
+
+        // Adding or removing lines moves everything after them up or down a row
+        invalidate(line, pscn->linesAdded != 0 ? INT_MAX : line);
+    }
+    else if (active && FlagSet(pscn->modificationType, ModificationFlags::ChangeStyle)) {
+        invalidate(static_cast<int>(editor->lineFromPosition(pscn->position)), static_cast<int>(editor->lineFromPosition(pscn->position + pscn->length)));
+    }
+}
+
+void MinimapTiles::invalidate(int firstLine, int lastLine)
+{
+    const int firstTile = firstLine / TILE_LINES;
+    const int lastTile = lastLine == INT_MAX ? INT_MAX : lastLine / TILE_LINES;
+    bool invalidated = false;
+
+    for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if (it.key() >= firstTile && it.key() <= lastTile) {
+            // Anything still being drawn is out of date once it is done
+            ++it->version;
+            invalidated |= it->valid;
+            it->valid = false;
+        }
+    }
+
+    if (invalidated) {
+        renderTimer.start(RENDER_DELAY_MS);
+        emit tilesInvalidated();
+    }
+}
+
+void MinimapTiles::invalidateAll()
+{
+    invalidate(0, INT_MAX);
+}
+
+void MinimapTiles::renderWanted()
+{
+    if (wanted.isEmpty())
+        return;
+
+    // Styles can be changed at any time without a notification, so the colours are looked up every time
+    Palette palette;
+    for (int style = 0; style < static_cast<int>(palette.size()); ++style) {
+        palette[style] = fromBgr(editor->styleFore(style));
+    }
+
+    const QRgb background = fromBgr(editor->styleBack(STYLE_DEFAULT));
+    const int tabWidth = qMax(1, static_cast<int>(editor->tabWidth()));
+    const int lineCount = static_cast<int>(editor->lineCount());
+    QPointer<MinimapTiles> self = this;
+
+    for (int index : qAsConst(wanted)) {
+        auto it = tiles.find(index);
+        if (it == tiles.end() || it->valid || it->rendering)
+            continue;
+
+        const int firstLine = index * TILE_LINES;
+        const int lastLine = qMin(lineCount, firstLine + TILE_LINES);
+
+        // Only the start of each line can be seen, so that is all that is copied of long ones
+        std::vector<QByteArray> lines;
+        lines.reserve(qMax(0, lastLine - firstLine));
+
+        for (int line = firstLine; line < lastLine; ++line) {
+            const Sci_Position start = editor->positionFromLine(line);
+            const Sci_Position end = qMin(editor->lineEndPosition(line), start + COLUMNS * 2);
+
+            QByteArray styled(static_cast<int>(2 * (end - start) + 2), Qt::Uninitialized);
+            Sci_TextRangeFull range;
+            range.chrg.cpMin = start;
+            range.chrg.cpMax = end;
+            range.lpstrText = styled.data();
+            editor->send(SCI_GETSTYLEDTEXTFULL, 0, reinterpret_cast<sptr_t>(&range));
+            styled.chop(2);
+
+            lines.push_back(styled);
+        }
+
+        it->rendering = true;
+        const int version = it->version;
+
+        QThreadPool::globalInstance()->start([=]() {
+            const QImage image = renderTile(lines, palette, background, tabWidth);
+
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (!self)
+                    return;
+
+                auto it = self->tiles.find(index);
+                if (it == self->tiles.end())
+                    return;
+
+                it->rendering = false;
+
+                // Edited while it was being drawn, it is still better than nothing until the next one is done
+                if (it->image.isNull() || it->version == version) {
+                    it->image = image;
+                }
+                it->valid = it->version == version;
+
+                emit self->tileReady(index);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    wanted.clear();
+    dropUnusedTiles();
+}
+
+qint64 MinimapTiles::releaseTiles()
+{
+    qint64 bytes = 0;
+
+    for (auto it = tiles.begin(); it != tiles.end();) {
+        // Whatever is drawing it still needs somewhere to put the result
+        if (it->rendering) {
+            ++it;
+            continue;
+        }
+
+        bytes += it->image.sizeInBytes();
+        it = tiles.erase(it);
+    }
+
+    if (bytes > 0) {
+        emit tilesInvalidated();
+    }
+
+    return bytes;
+}
+
+void MinimapTiles::dropUnusedTiles()
+{
+    while (tiles.size() > MAX_TILES) {
+        auto oldest = tiles.end();
+
+        for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+            if (!it->rendering && (oldest == tiles.end() || it->lastUsed < oldest->lastUsed)) {
+                oldest = it;
+            }
+        }
+
+        if (oldest == tiles.end())
+            break;
+
+        tiles.erase(oldest);
+    }
+}
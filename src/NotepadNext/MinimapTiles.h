@@ -0,0 +1,97 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MINIMAPTILES_H
+#define MINIMAPTILES_H
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Pictures of a document for a minimap, one pixel row per line and one pixel per character in the colour of its
+// style, so nothing has to be laid out or lexed a second time. The document is drawn in tiles of TILE_LINES
+// lines, each from a copy of its text and style bytes on a QThreadPool. An edit only invalidates the tiles of the
+// lines it touched (and the ones after them, if lines were added or removed), and while something keeps
+// invalidating tiles they aren't drawn again until it stops, so typing doesn't cost a render per keystroke.
+// Out of date tiles are still handed out until the new ones are ready. There is one per document, use
+// MinimapTiles::forEditor() to get it.
+class MinimapTiles : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int TILE_LINES = 256;
+    static const int COLUMNS = 160;
+
+    static MinimapTiles *forEditor(ScintillaNext *editor);
+
+    // Style changes only invalidate tiles while active, the rest of the time they aren't even sent. Becoming
+    // active again invalidates everything, since the styles could have changed in the meantime.
+    void setActive(bool active);
+
+    // The last picture of the tile, which may be out of date (or null if there never was one), in which case
+    // a new one is drawn and tileReady() is emitted when it is done
+    QImage tile(int index);
+
+    // Drops every picture that isn't being drawn, the ones still wanted are drawn again when they are next asked
+    // for. Returns roughly how many bytes that was.
+    qint64 releaseTiles();
+
+signals:
+    // Something should ask for the tiles it shows again, which then get drawn once the edits stop
+    void tilesInvalidated();
+    void tileReady(int index);
+
+private slots:
+    void notify(const Scintilla::NotificationData *pscn);
+
+private:
+    explicit MinimapTiles(ScintillaNext *editor);
+
+    struct Tile {
+        QImage image;
+        bool valid = false;
+        bool rendering = false;
+        int version = 0;
+        quint64 lastUsed = 0;
+    };
+
+    void invalidate(int firstLine, int lastLine);
+    void invalidateAll();
+    void renderWanted();
+    void dropUnusedTiles();
+
+    ScintillaNext *editor;
+    QHash<int, Tile> tiles;
+    QSet<int> wanted;
+    QTimer renderTimer;
+    quint64 useCount = 0;
+    bool active = false;
+};
+
+#endif // MINIMAPTILES_H
@@ -0,0 +1,143 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MultiMarker.h"
+#include "MatchIndex.h"
+#include "MultiPatternMatcher.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <vector>
+
+
+// Cyan, orange, yellow, purple and green, in the BGR order Scintilla uses
+static const int MARK_COLORS[MultiMarker::COLOR_COUNT] = {0xFFFF00, 0x0080FF, 0x00FFFF, 0xFF0080, 0x00FF00};
+
+MultiMarker *MultiMarker::forEditor(ScintillaNext *editor)
+{
+    MultiMarker *marker = editor->findChild<MultiMarker *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (marker == Q_NULLPTR) {
+        marker = new MultiMarker(editor);
+    }
+
+    return marker;
+}
+
+MultiMarker::MultiMarker(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("MultiMarker");
+
+    for (int i = 0; i < COLOR_COUNT; ++i) {
+        const int indicator = editor->allocateIndicator(QStringLiteral("multi_mark_%1").arg(i));
+
+        editor->indicSetFore(indicator, MARK_COLORS[i]);
+        editor->indicSetStyle(indicator, INDIC_ROUNDBOX);
+        editor->indicSetOutlineAlpha(indicator, 150);
+        editor->indicSetAlpha(indicator, 100);
+        editor->indicSetUnder(indicator, true);
+
+        MatchIndex::forEditor(editor)->setRangeSource(indicator);
+
+        markIndicators.append(indicator);
+    }
+}
+
+void MultiMarker::mark(const QList<QByteArray> &terms, bool matchCase, bool wholeWord)
+{
+    cancel();
+
+    const std::shared_ptr<const QByteArray> text = editor->textSnapshot();
+    const quint64 generation = editor->changeGeneration();
+    const QByteArray wordChars = editor->wordChars();
+
+    QPointer<MultiMarker> self = this;
+    std::shared_ptr<std::atomic_bool> jobCanceled = std::make_shared<std::atomic_bool>(false);
+    canceled = jobCanceled;
+
+    QThreadPool::globalInstance()->start([=]() {
+        MultiPatternMatcher matcher(terms, matchCase, wholeWord);
+        matcher.setWordChars(wordChars);
+        matcher.setCancelFlag(jobCanceled.get());
+
+        // Every term keeps the same colour, and the matches of each colour come out already sorted
+        std::shared_ptr<std::vector<std::vector<Sci_CharacterRange>>> ranges = std::make_shared<std::vector<std::vector<Sci_CharacterRange>>>(COLOR_COUNT);
+        std::vector<bool> found(terms.size(), false);
+        int matches = 0;
+
+        const bool finished = matcher.forEachMatch(text->constData(), text->size(), [&](qsizetype start, qsizetype end, int term) {
+            (*ranges)[term % COLOR_COUNT].push_back({static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(end)});
+            found[term] = true;
+            matches++;
+            return true;
+        });
+
+        if (!finished || *jobCanceled)
+            return;
+
+        const int termsFound = static_cast<int>(std::count(found.begin(), found.end(), true));
+
+        // Posted through the application object since the marker may be deleted at any point
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self || *jobCanceled)
+                return;
+
+            self->canceled.reset();
+
+            if (self->editor->changeGeneration() != generation) {
+                // The text changed while it was being searched
+                self->mark(terms, matchCase, wholeWord);
+                return;
+            }
+
+            MatchIndex *index = MatchIndex::forEditor(self->editor);
+            for (int i = 0; i < COLOR_COUNT; ++i) {
+                index->setMatches(self->markIndicators[i], (*ranges)[i], true);
+            }
+
+            emit self->marked(matches, termsFound);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MultiMarker::cancel()
+{
+    if (canceled) {
+        *canceled = true;
+        canceled.reset();
+
+        emit markingCanceled();
+    }
+}
+
+void MultiMarker::clear()
+{
+    cancel();
+
+    MatchIndex *index = MatchIndex::forEditor(editor);
+    for (int indicator : qAsConst(markIndicators)) {
+        index->clear(indicator);
+    }
+}
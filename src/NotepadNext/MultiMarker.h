@@ -0,0 +1,69 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MULTIMARKER_H
+#define MULTIMARKER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+class ScintillaNext;
+
+
+// Marks every occurrence of a list of terms in an editor, such as hundreds of identifiers pasted from an
+// incident report. The terms are found together in one pass over a snapshot of the text on a QThreadPool,
+// and each term is given one of a few colours in turn. The matches go through the MatchIndex, so only the
+// ones around the screen are filled in straight away. There is one per editor, use MultiMarker::forEditor()
+// to get it.
+class MultiMarker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int COLOR_COUNT = 5;
+
+    static MultiMarker *forEditor(ScintillaNext *editor);
+
+    // The indicators used for the marks, one for each colour
+    QVector<int> indicators() const { return markIndicators; }
+
+    void mark(const QList<QByteArray> &terms, bool matchCase, bool wholeWord);
+    void cancel();
+    void clear();
+
+    bool isMarking() const { return canceled != nullptr; }
+
+signals:
+    void marked(int matches, int termsFound);
+    void markingCanceled();
+
+private:
+    explicit MultiMarker(ScintillaNext *editor);
+
+    ScintillaNext *editor;
+    QVector<int> markIndicators;
+    std::shared_ptr<std::atomic_bool> canceled;
+};
+
+#endif // MULTIMARKER_H
@@ -0,0 +1,261 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MultiPatternMatcher.h"
+
+#include <algorithm>
+
+
+// How many bytes are searched between checks of the cancel flag
+const qsizetype CANCEL_CHECK_INTERVAL = 1024 * 1024;
+
+static unsigned char foldCase(unsigned char c, bool matchCase)
+{
+    return (!matchCase && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+MultiPatternMatcher::MultiPatternMatcher(const QList<QByteArray> &terms, bool matchCase, bool wholeWord) :
+    wholeWord(wholeWord)
+{
+    setWordChars(QByteArray());
+
+    // Bytes that never show up in a term all lead back to the same place, so they share class 0 and the
+    // table only needs a column for each byte that does
+    bool used[256] = {};
+    for (const QByteArray &term : terms) {
+        for (char ch : term) {
+            used[foldCase(static_cast<unsigned char>(ch), matchCase)] = true;
+        }
+    }
+
+    std::fill(byteClass, byteClass + 256, 0);
+    for (int c = 0; c < 256; ++c) {
+        if (used[c]) {
+            byteClass[c] = static_cast<unsigned char>(classCount++);
+        }
+    }
+
+    if (!matchCase) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            byteClass[c] = byteClass[c + ('a' - 'A')];
+        }
+    }
+
+    // Start off with a trie of the terms
+    transitions.assign(classCount, -1);
+    stateTerm.assign(1, -1);
+    depth.assign(1, 0);
+
+    for (int i = 0; i < terms.size(); ++i) {
+        if (terms[i].isEmpty())
+            continue;
+
+        int32_t state = 0;
+        for (char ch : terms[i]) {
+            const size_t index = state * classCount + byteClass[static_cast<unsigned char>(ch)];
+
+            if (transitions[index] == -1) {
+                const int32_t newState = static_cast<int32_t>(stateTerm.size());
+
+                transitions[index] = newState;
+                transitions.resize(transitions.size() + classCount, -1);
+                stateTerm.push_back(-1);
+                depth.push_back(depth[state] + 1);
+            }
+
+            state = transitions[index];
+        }
+
+        // The same term given twice is found as the first one
+        if (stateTerm[state] == -1) {
+            stateTerm[state] = i;
+            termCount++;
+        }
+
+        longestTerm = std::max(longestTerm, depth[state]);
+    }
+
+    // Then fill in where every missing transition would end up by following the failure links, breadth
+    // first so a state's failure has always been filled in before the state itself
+    const size_t stateCount = stateTerm.size();
+    std::vector<int32_t> failure(stateCount, 0);
+    std::vector<int32_t> queue;
+    queue.reserve(stateCount);
+    outputLink.assign(stateCount, -1);
+
+    for (int32_t c = 0; c < classCount; ++c) {
+        if (transitions[c] == -1) {
+            transitions[c] = 0;
+        }
+        else {
+            queue.push_back(transitions[c]);
+        }
+    }
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int32_t state = queue[head];
+        const int32_t *fallback = &transitions[failure[state] * classCount];
+
+        for (int32_t c = 0; c < classCount; ++c) {
+            const size_t index = state * classCount + c;
+            const int32_t target = transitions[index];
+
+            if (target == -1) {
+                transitions[index] = fallback[c];
+                continue;
+            }
+
+            failure[target] = fallback[c];
+            outputLink[target] = stateTerm[fallback[c]] != -1 ? fallback[c] : outputLink[fallback[c]];
+            queue.push_back(target);
+        }
+    }
+}
+
+void MultiPatternMatcher::setWordChars(const QByteArray &wordChars)
+{
+    for (int c = 0; c < 256; ++c) {
+        if (wordChars.isEmpty()) {
+            wordChar[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        }
+        else {
+            wordChar[c] = false;
+        }
+
+        // Scintilla treats the bytes of multi-byte characters as part of words no matter what it was given
+        if (c >= 0x80) {
+            wordChar[c] = true;
+        }
+    }
+
+    for (char ch : wordChars) {
+        wordChar[static_cast<unsigned char>(ch)] = true;
+    }
+}
+
+qsizetype MultiPatternMatcher::memoryUsage() const
+{
+    return static_cast<qsizetype>((transitions.capacity() + stateTerm.capacity() + outputLink.capacity() + depth.capacity()) * sizeof(int32_t));
+}
+
+bool MultiPatternMatcher::isWordBoundary(const char *data, qsizetype length, qsizetype position) const
+{
+    if (position <= 0 || position >= length)
+        return true;
+
+    return !wordChar[static_cast<unsigned char>(data[position - 1])] || !wordChar[static_cast<unsigned char>(data[position])];
+}
+
+bool MultiPatternMatcher::isAcceptable(const char *data, qsizetype length, qsizetype start, qsizetype end) const
+{
+    return !wholeWord || (isWordBoundary(data, length, start) && isWordBoundary(data, length, end));
+}
+
+int32_t MultiPatternMatcher::longestAcceptable(const char *data, qsizetype length, int32_t state, qsizetype end, qsizetype minimumStart) const
+{
+    // The output links go from longer terms to shorter ones
+    int32_t output = stateTerm[state] != -1 ? state : outputLink[state];
+
+    while (output != -1) {
+        const qsizetype start = end - depth[output];
+
+        if (start >= minimumStart && isAcceptable(data, length, start, end)) {
+            return output;
+        }
+
+        output = outputLink[output];
+    }
+
+    return -1;
+}
+
+bool MultiPatternMatcher::forEachMatch(const char *data, qsizetype length, const std::function<bool (qsizetype, qsizetype, int)> &callback) const
+{
+    if (termCount == 0)
+        return true;
+
+    // The longest match ending at each of the last few positions. A match can't be reported until it is
+    // certain nothing starting further left is still going to turn up, which is at most the length of
+    // the longest term later.
+    std::vector<Candidate> pending;
+    std::vector<Candidate> remaining;
+    qsizetype reportedEnd = 0;
+
+    auto reportDecided = [&](qsizetype position) {
+        while (!pending.empty()) {
+            auto best = pending.begin();
+            for (auto it = pending.begin() + 1; it != pending.end(); ++it) {
+                if (it->start < best->start || (it->start == best->start && it->end > best->end)) {
+                    best = it;
+                }
+            }
+
+            if (best->start + longestTerm > position)
+                return true;
+
+            if (!callback(best->start, best->end, stateTerm[best->state]))
+                return false;
+
+            reportedEnd = best->end;
+
+            // Anything overlapping it can only be kept as a shorter term that starts after it
+            remaining.clear();
+            for (Candidate candidate : pending) {
+                if (candidate.end <= reportedEnd)
+                    continue;
+
+                if (candidate.start < reportedEnd) {
+                    candidate.state = longestAcceptable(data, length, candidate.state, candidate.end, reportedEnd);
+
+                    if (candidate.state == -1)
+                        continue;
+
+                    candidate.start = candidate.end - depth[candidate.state];
+                }
+
+                remaining.push_back(candidate);
+            }
+            pending.swap(remaining);
+        }
+
+        return true;
+    };
+
+    int32_t state = 0;
+    for (qsizetype i = 0; i < length; ++i) {
+        if (cancelFlag != nullptr && i % CANCEL_CHECK_INTERVAL == 0 && *cancelFlag)
+            return false;
+
+        state = next(state, static_cast<unsigned char>(data[i]));
+
+        if (stateTerm[state] != -1 || outputLink[state] != -1) {
+            const int32_t output = longestAcceptable(data, length, state, i + 1, reportedEnd);
+
+            if (output != -1) {
+                pending.push_back({i + 1 - depth[output], i + 1, output});
+            }
+        }
+
+        if (!pending.empty() && !reportDecided(i + 1))
+            return false;
+    }
+
+    // Nothing else can turn up now
+    return reportDecided(length + longestTerm);
+}
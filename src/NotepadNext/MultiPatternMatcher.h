@@ -0,0 +1,87 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MULTIPATTERNMATCHER_H
+#define MULTIPATTERNMATCHER_H
+
+#include <QByteArray>
+#include <QList>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+// Finds any number of literal terms in a single pass over a buffer, by compiling them into an
+// Aho-Corasick automaton. Where several terms match at overlapping places the one that starts first
+// wins, and of those the longest, so "ERR-12" is never marked as just "ERR-1". The matches that are
+// reported never overlap.
+//
+// Without matchCase only ASCII letters are folded, any other bytes have to match exactly.
+class MultiPatternMatcher
+{
+public:
+    explicit MultiPatternMatcher(const QList<QByteArray> &terms, bool matchCase = true, bool wholeWord = false);
+
+    // The characters that make up a word when matching whole words only, by default letters, digits,
+    // underscores and anything outside of ASCII
+    void setWordChars(const QByteArray &wordChars);
+
+    // Checked every so often during a search so a long one can be abandoned
+    void setCancelFlag(const std::atomic_bool *flag) { cancelFlag = flag; }
+
+    bool isEmpty() const { return termCount == 0; }
+    qsizetype memoryUsage() const;
+
+    // Calls back with the start and end offsets of every match along with the index of the term that
+    // matched, until it returns false. Returns false if the search was stopped early.
+    bool forEachMatch(const char *data, qsizetype length, const std::function<bool(qsizetype start, qsizetype end, int term)> &callback) const;
+
+private:
+    struct Candidate {
+        qsizetype start;
+        qsizetype end;
+        int32_t state;
+    };
+
+    int32_t next(int32_t state, unsigned char c) const { return transitions[state * classCount + byteClass[c]]; }
+    bool isWordBoundary(const char *data, qsizetype length, qsizetype position) const;
+    bool isAcceptable(const char *data, qsizetype length, qsizetype start, qsizetype end) const;
+    int32_t longestAcceptable(const char *data, qsizetype length, int32_t state, qsizetype end, qsizetype minimumStart) const;
+
+    bool wholeWord;
+    bool wordChar[256];
+    unsigned char byteClass[256];
+    int32_t classCount = 1;
+    int termCount = 0;
+    int32_t longestTerm = 0;
+
+    // The automaton has every failure resolved ahead of time, so each byte of the text is a single lookup
+    std::vector<int32_t> transitions;
+
+    // The term a state completes or -1, and the nearest state along its failure links that completes one
+    std::vector<int32_t> stateTerm;
+    std::vector<int32_t> outputLink;
+    std::vector<int32_t> depth;
+
+    const std::atomic_bool *cancelFlag = nullptr;
+};
+
+#endif // MULTIPATTERNMATCHER_H
@@ -0,0 +1,419 @@
+# This file is part of Notepad Next.
+# Copyright 2024 Justin Dailey
+#
+# Notepad Next is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Notepad Next is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+
+# Everything the application is built from apart from main(), so the benchmarks and tests can build the same
+# editor without the executable around it. See NotepadNext.pro for the application itself.
+
+QT += core widgets printsupport network
+
+include($$PWD/../singleapplication/singleapplication.pri)
+DEFINES += QAPPLICATION_CLASS=QApplication
+
+
+include($$PWD/../scintilla.pri)
+include($$PWD/../lexilla.pri)
+include($$PWD/../uchardet.pri)
+include($$PWD/../lua.pri)
+include($$PWD/../ads.pri)
+include($$PWD/../editorconfig-core-qt/EditorConfig.pri)
+win32:include($$PWD/../QSimpleUpdater/QSimpleUpdater.pri)
+include($$PWD/../i18n.pri)
+
+SOURCES += \
+    $$PWD/ApplicationSettings.cpp \
+    $$PWD/BackgroundSearcher.cpp \
+    $$PWD/BatchProcessor.cpp \
+    $$PWD/BracePairIndex.cpp \
+    $$PWD/BufferSearcher.cpp \
+    $$PWD/BulkEdit.cpp \
+    $$PWD/BytePattern.cpp \
+    $$PWD/ColorPickerDelegate.cpp \
+    $$PWD/ComboBoxDelegate.cpp \
+    $$PWD/Compression.cpp \
+    $$PWD/Converter.cpp \
+    $$PWD/CsvColumns.cpp \
+    $$PWD/DebugManager.cpp \
+    $$PWD/DockedEditor.cpp \
+    $$PWD/DocumentCompare.cpp \
+    $$PWD/DocumentStatistics.cpp \
+    $$PWD/EditJournal.cpp \
+    $$PWD/EditorConfigCache.cpp \
+    $$PWD/EditorHexViewerTableModel.cpp \
+    $$PWD/EditorManager.cpp \
+    $$PWD/EditorMemoryUsage.cpp \
+    $$PWD/EditorPrintJob.cpp \
+    $$PWD/EditorPrintPreviewRenderer.cpp \
+    $$PWD/EncodingDetector.cpp \
+    $$PWD/FadingIndicator.cpp \
+    $$PWD/FileChangeWatcher.cpp \
+    $$PWD/FileDialogHelpers.cpp \
+    $$PWD/FileFilter.cpp \
+    $$PWD/FileListModel.cpp \
+    $$PWD/FileLoader.cpp \
+    $$PWD/FileSearcher.cpp \
+    $$PWD/Finder.cpp \
+    $$PWD/HexViewerDelegate.cpp \
+    $$PWD/HtmlConverter.cpp \
+    $$PWD/IFaceTable.cpp \
+    $$PWD/IFaceTableMixer.cpp \
+    $$PWD/JobScheduler.cpp \
+    $$PWD/LanguageStylesModel.cpp \
+    $$PWD/LatencyMonitor.cpp \
+    $$PWD/LazyMimeData.cpp \
+    $$PWD/LineDiff.cpp \
+    $$PWD/LineFormatDetector.cpp \
+    $$PWD/LineFilter.cpp \
+    $$PWD/LineFilterWidget.cpp \
+    $$PWD/LineMacro.cpp \
+    $$PWD/LineTransforms.cpp \
+    $$PWD/Logging.cpp \
+    $$PWD/LuaBytecodeBundle.cpp \
+    $$PWD/LuaEventHooks.cpp \
+    $$PWD/LuaExtension.cpp \
+    $$PWD/LuaProfiler.cpp \
+    $$PWD/LuaScriptJob.cpp \
+    $$PWD/LuaState.cpp \
+    $$PWD/Macro.cpp \
+    $$PWD/MacroListModel.cpp \
+    $$PWD/MacroManager.cpp \
+    $$PWD/MacroPlayer.cpp \
+    $$PWD/MacroRecorder.cpp \
+    $$PWD/MacroStep.cpp \
+    $$PWD/MacroStepTableModel.cpp \
+    $$PWD/MacroStore.cpp \
+    $$PWD/MappedFileHexModel.cpp \
+    $$PWD/MatchIndex.cpp \
+    $$PWD/MemoryGovernor.cpp \
+    $$PWD/MinimapTiles.cpp \
+    $$PWD/MultiMarker.cpp \
+    $$PWD/MultiPatternMatcher.cpp \
+    $$PWD/NotepadNextApplication.cpp \
+    $$PWD/NppImporter.cpp \
+    $$PWD/OutlineModel.cpp \
+    $$PWD/PendingRanges.cpp \
+    $$PWD/PluginManager.cpp \
+    $$PWD/QRegexSearch.cpp \
+    $$PWD/QuickFindWidget.cpp \
+    $$PWD/RangeAllocator.cpp \
+    $$PWD/RecentFilesListManager.cpp \
+    $$PWD/RecentFilesListMenuBuilder.cpp \
+    $$PWD/RegexEngine.cpp \
+    $$PWD/RemoteFile.cpp \
+    $$PWD/ReplacePreview.cpp \
+    $$PWD/ReplacePreviewModel.cpp \
+    $$PWD/RtfConverter.cpp \
+    $$PWD/SciIFaceTable.cpp \
+    $$PWD/ScintillaCommenter.cpp \
+    $$PWD/ScintillaNext.cpp \
+    $$PWD/SearchResultsCollector.cpp \
+    $$PWD/SearchResultsModel.cpp \
+    $$PWD/SelectionTracker.cpp \
+    $$PWD/SessionManager.cpp \
+    $$PWD/SpellDictionary.cpp \
+    $$PWD/SpinBoxDelegate.cpp \
+    $$PWD/StartupTrace.cpp \
+    $$PWD/TextEncoder.cpp \
+    $$PWD/TextFormatter.cpp \
+    $$PWD/TextTransform.cpp \
+    $$PWD/TranslationManager.cpp \
+    $$PWD/TrigramIndex.cpp \
+    $$PWD/UndoAction.cpp \
+    $$PWD/WordIndex.cpp \
+    $$PWD/WorkspaceModel.cpp \
+    $$PWD/ZoomEventWatcher.cpp \
+    $$PWD/decorators/ApplicationDecorator.cpp \
+    $$PWD/decorators/AutoCompletion.cpp \
+    $$PWD/decorators/AutoIndentation.cpp \
+    $$PWD/decorators/BackgroundLexer.cpp \
+    $$PWD/decorators/BetterMultiSelection.cpp \
+    $$PWD/decorators/BookMarkDecorator.cpp \
+    $$PWD/decorators/EditorConfigAppDecorator.cpp \
+    $$PWD/decorators/SurroundSelection.cpp \
+    $$PWD/decorators/TrailingWhitespaceTrimmer.cpp \
+    $$PWD/decorators/UndoHistoryLimiter.cpp \
+    $$PWD/decorators/URLFinder.cpp \
+    $$PWD/dialogs/ColumnEditorDialog.cpp \
+    $$PWD/dialogs/MacroEditorDialog.cpp \
+    $$PWD/docks/DebugLogDock.cpp \
+    $$PWD/docks/EditorInspectorDock.cpp \
+    $$PWD/dialogs/FindReplaceDialog.cpp \
+    $$PWD/docks/FileListDock.cpp \
+    $$PWD/docks/FolderAsWorkspaceDock.cpp \
+    $$PWD/docks/HexViewerDock.cpp \
+    $$PWD/docks/LanguageInspectorDock.cpp \
+    $$PWD/docks/LuaConsoleDock.cpp \
+    $$PWD/docks/MinimapDock.cpp \
+    $$PWD/docks/OutlineDock.cpp \
+    $$PWD/docks/PerformanceDock.cpp \
+    $$PWD/dialogs/MacroRunDialog.cpp \
+    $$PWD/dialogs/MacroSaveDialog.cpp \
+    $$PWD/dialogs/MainWindow.cpp \
+    $$PWD/dialogs/PreferencesDialog.cpp \
+    $$PWD/dialogs/PrintPreviewDialog.cpp \
+    $$PWD/dialogs/QuickOpenDialog.cpp \
+    $$PWD/dialogs/ReplacePreviewDialog.cpp \
+    $$PWD/docks/SearchResultsDock.cpp \
+    $$PWD/docks/StatisticsDock.cpp \
+    $$PWD/decorators/BraceMatch.cpp \
+    $$PWD/decorators/EditorDecorator.cpp \
+    $$PWD/decorators/HighlightedScrollBar.cpp \
+    $$PWD/decorators/LargeFileProfile.cpp \
+    $$PWD/decorators/LineNumbers.cpp \
+    $$PWD/decorators/LogTimestampIndex.cpp \
+    $$PWD/decorators/NotificationDispatcher.cpp \
+    $$PWD/decorators/SmartHighlighter.cpp \
+    $$PWD/decorators/SpellChecker.cpp \
+    $$PWD/widgets/EditorInfoStatusBar.cpp \
+    $$PWD/widgets/HexFileViewer.cpp \
+    $$PWD/widgets/LargeFileViewer.cpp \
+    $$PWD/widgets/MinimapView.cpp \
+    $$PWD/widgets/PrintPreviewWidget.cpp \
+    $$PWD/widgets/ProgressOverlay.cpp \
+    $$PWD/widgets/StatusLabel.cpp \
+    $$PWD/widgets/TabListMenu.cpp
+
+HEADERS += \
+    $$PWD/ApplicationSettings.h \
+    $$PWD/BackgroundSearcher.h \
+    $$PWD/BatchProcessor.h \
+    $$PWD/BracePairIndex.h \
+    $$PWD/BufferSearcher.h \
+    $$PWD/BulkEdit.h \
+    $$PWD/BytePattern.h \
+    $$PWD/ColorPickerDelegate.h \
+    $$PWD/ComboBoxDelegate.h \
+    $$PWD/Compression.h \
+    $$PWD/Converter.h \
+    $$PWD/CsvColumns.h \
+    $$PWD/DebugManager.h \
+    $$PWD/DockedEditor.h \
+    $$PWD/DockedEditorTitleBar.h \
+    $$PWD/DocumentCompare.h \
+    $$PWD/DocumentStatistics.h \
+    $$PWD/EditJournal.h \
+    $$PWD/EditorConfigCache.h \
+    $$PWD/EditorHexViewerTableModel.h \
+    $$PWD/EditorManager.h \
+    $$PWD/EditorMemoryUsage.h \
+    $$PWD/EditorPrintJob.h \
+    $$PWD/EditorPrintPreviewRenderer.h \
+    $$PWD/EncodingDetector.h \
+    $$PWD/FadingIndicator.h \
+    $$PWD/FileChangeWatcher.h \
+    $$PWD/FileDialogHelpers.h \
+    $$PWD/FileFilter.h \
+    $$PWD/FileListModel.h \
+    $$PWD/FileLoader.h \
+    $$PWD/FileSearcher.h \
+    $$PWD/Finder.h \
+    $$PWD/FocusWatcher.h \
+    $$PWD/HexViewerDelegate.h \
+    $$PWD/HtmlConverter.h \
+    $$PWD/IFaceTable.h \
+    $$PWD/IFaceTableMixer.h \
+    $$PWD/ISearchResultsHandler.h \
+    $$PWD/JobScheduler.h \
+    $$PWD/LanguageStylesModel.h \
+    $$PWD/LatencyMonitor.h \
+    $$PWD/LazyMimeData.h \
+    $$PWD/LineDiff.h \
+    $$PWD/LineFormatDetector.h \
+    $$PWD/LineFilter.h \
+    $$PWD/LineFilterWidget.h \
+    $$PWD/LineMacro.h \
+    $$PWD/LineTransforms.h \
+    $$PWD/Logging.h \
+    $$PWD/LuaBytecodeBundle.h \
+    $$PWD/LuaEventHooks.h \
+    $$PWD/LuaExtension.h \
+    $$PWD/LuaProfiler.h \
+    $$PWD/LuaScriptJob.h \
+    $$PWD/LuaState.h \
+    $$PWD/Macro.h \
+    $$PWD/MacroListModel.h \
+    $$PWD/MacroManager.h \
+    $$PWD/MacroPlayer.h \
+    $$PWD/MacroRecorder.h \
+    $$PWD/MacroStep.h \
+    $$PWD/MacroStepTableModel.h \
+    $$PWD/MacroStore.h \
+    $$PWD/MappedFileHexModel.h \
+    $$PWD/MatchIndex.h \
+    $$PWD/MemoryGovernor.h \
+    $$PWD/MinimapTiles.h \
+    $$PWD/MultiMarker.h \
+    $$PWD/MultiPatternMatcher.h \
+    $$PWD/NotepadNextApplication.h \
+    $$PWD/NotepadNextPlugin.h \
+    $$PWD/NppImporter.h \
+    $$PWD/OutlineModel.h \
+    $$PWD/PendingRanges.h \
+    $$PWD/PluginManager.h \
+    $$PWD/QRegexSearch.h \
+    $$PWD/QuickFindWidget.h \
+    $$PWD/RangeAllocator.h \
+    $$PWD/RecentFilesListManager.h \
+    $$PWD/RecentFilesListMenuBuilder.h \
+    $$PWD/RegexEngine.h \
+    $$PWD/RemoteFile.h \
+    $$PWD/ReplacePreview.h \
+    $$PWD/ReplacePreviewModel.h \
+    $$PWD/RtfConverter.h \
+    $$PWD/SciIFaceTable.h \
+    $$PWD/ScintillaCommenter.h \
+    $$PWD/ScintillaEnums.h \
+    $$PWD/ScintillaNext.h \
+    $$PWD/SearchResultsCollector.h \
+    $$PWD/SearchResultsModel.h \
+    $$PWD/SelectionTracker.h \
+    $$PWD/SessionManager.h \
+    $$PWD/SpellDictionary.h \
+    $$PWD/SpinBoxDelegate.h \
+    $$PWD/StartupTrace.h \
+    $$PWD/TextEncoder.h \
+    $$PWD/TextFormatter.h \
+    $$PWD/TextTransform.h \
+    $$PWD/TranslationManager.h \
+    $$PWD/TrigramIndex.h \
+    $$PWD/UndoAction.h \
+    $$PWD/WordIndex.h \
+    $$PWD/WorkspaceModel.h \
+    $$PWD/ZoomEventWatcher.h \
+    $$PWD/decorators/ApplicationDecorator.h \
+    $$PWD/decorators/AutoCompletion.h \
+    $$PWD/decorators/AutoIndentation.h \
+    $$PWD/decorators/BackgroundLexer.h \
+    $$PWD/decorators/BetterMultiSelection.h \
+    $$PWD/decorators/BookMarkDecorator.h \
+    $$PWD/decorators/EditorConfigAppDecorator.h \
+    $$PWD/decorators/SurroundSelection.h \
+    $$PWD/decorators/TrailingWhitespaceTrimmer.h \
+    $$PWD/decorators/UndoHistoryLimiter.h \
+    $$PWD/decorators/URLFinder.h \
+    $$PWD/dialogs/ColumnEditorDialog.h \
+    $$PWD/dialogs/MacroEditorDialog.h \
+    $$PWD/docks/DebugLogDock.h \
+    $$PWD/docks/EditorInspectorDock.h \
+    $$PWD/dialogs/FindReplaceDialog.h \
+    $$PWD/docks/FileListDock.h \
+    $$PWD/docks/FolderAsWorkspaceDock.h \
+    $$PWD/docks/HexViewerDock.h \
+    $$PWD/docks/LanguageInspectorDock.h \
+    $$PWD/docks/LuaConsoleDock.h \
+    $$PWD/docks/MinimapDock.h \
+    $$PWD/docks/OutlineDock.h \
+    $$PWD/docks/PerformanceDock.h \
+    $$PWD/dialogs/MacroRunDialog.h \
+    $$PWD/dialogs/MacroSaveDialog.h \
+    $$PWD/dialogs/MainWindow.h \
+    $$PWD/dialogs/PreferencesDialog.h \
+    $$PWD/dialogs/PrintPreviewDialog.h \
+    $$PWD/dialogs/QuickOpenDialog.h \
+    $$PWD/dialogs/ReplacePreviewDialog.h \
+    $$PWD/decorators/BraceMatch.h \
+    $$PWD/decorators/EditorDecorator.h \
+    $$PWD/decorators/HighlightedScrollBar.h \
+    $$PWD/decorators/LargeFileProfile.h \
+    $$PWD/decorators/LineNumbers.h \
+    $$PWD/decorators/LogTimestampIndex.h \
+    $$PWD/decorators/NotificationDispatcher.h \
+    $$PWD/decorators/SmartHighlighter.h \
+    $$PWD/decorators/SpellChecker.h \
+    $$PWD/docks/SearchResultsDock.h \
+    $$PWD/docks/StatisticsDock.h \
+    $$PWD/widgets/EditorInfoStatusBar.h \
+    $$PWD/widgets/HexFileViewer.h \
+    $$PWD/widgets/LargeFileViewer.h \
+    $$PWD/widgets/MinimapView.h \
+    $$PWD/widgets/PrintPreviewWidget.h \
+    $$PWD/widgets/ProgressOverlay.h \
+    $$PWD/widgets/StatusLabel.h \
+    $$PWD/widgets/TabListMenu.h
+
+FORMS += \
+    $$PWD/LineFilterWidget.ui \
+    $$PWD/QuickFindWidget.ui \
+    $$PWD/dialogs/ColumnEditorDialog.ui \
+    $$PWD/dialogs/MacroEditorDialog.ui \
+    $$PWD/docks/DebugLogDock.ui \
+    $$PWD/docks/EditorInspectorDock.ui \
+    $$PWD/docks/FileListDock.ui \
+    $$PWD/docks/FolderAsWorkspaceDock.ui \
+    $$PWD/docks/HexViewerDock.ui \
+    $$PWD/docks/LanguageInspectorDock.ui \
+    $$PWD/dialogs/MainWindow.ui \
+    $$PWD/dialogs/FindReplaceDialog.ui \
+    $$PWD/docks/LuaConsoleDock.ui \
+    $$PWD/docks/MinimapDock.ui \
+    $$PWD/docks/OutlineDock.ui \
+    $$PWD/docks/PerformanceDock.ui \
+    $$PWD/dialogs/MacroRunDialog.ui \
+    $$PWD/dialogs/MacroSaveDialog.ui \
+    $$PWD/dialogs/PreferencesDialog.ui \
+    $$PWD/dialogs/QuickOpenDialog.ui \
+    $$PWD/docks/SearchResultsDock.ui \
+    $$PWD/docks/StatisticsDock.ui
+
+RESOURCES += \
+    $$PWD/resources.qrc \
+    $$PWD/scripts.qrc
+
+# PCRE2 is offered as a second regular expression engine if it is installed. Add "CONFIG+=no_pcre2" to
+# leave it out even if it is.
+!no_pcre2:packagesExist(libpcre2-8) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libpcre2-8
+
+    SOURCES += $$PWD/Pcre2RegexSearch.cpp
+    HEADERS += $$PWD/Pcre2RegexSearch.h
+
+    DEFINES += HAVE_PCRE2
+}
+
+# Compressed files are read and written transparently for each library that is installed. Add "CONFIG+=no_zlib",
+# "CONFIG+=no_zstd" or "CONFIG+=no_lzma" to leave one out even if it is.
+!no_zlib:packagesExist(zlib) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += zlib
+    DEFINES += HAVE_ZLIB
+}
+
+!no_zstd:packagesExist(libzstd) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+}
+
+!no_lzma:packagesExist(liblzma) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liblzma
+    DEFINES += HAVE_LZMA
+}
+
+INCLUDEPATH += $$PWD/decorators
+INCLUDEPATH += $$PWD/dialogs
+INCLUDEPATH += $$PWD/docks
+INCLUDEPATH += $$PWD/widgets
+
+
+INCLUDEPATH += $$PWD/../LuaBridge
+INCLUDEPATH += $$PWD/../
+DEFINES += LUA_VERSION_NUM=503
+
+INCLUDEPATH += $$PWD/../lexilla/include
+
+win32-g++:LIBS += libUser32
+win32-msvc*:LIBS += User32.lib
@@ -14,33 +14,22 @@
 # You should have received a copy of the GNU General Public License
 # along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
 
-
-QT += core widgets printsupport network
-
 TARGET = NotepadNext
 
 TEMPLATE = app
 
 include(../Config.pri)
 
-include(../singleapplication/singleapplication.pri)
-DEFINES += QAPPLICATION_CLASS=QApplication
-
-
-include(../scintilla.pri)
-include(../lexilla.pri)
-include(../uchardet.pri)
-include(../lua.pri)
-include(../ads.pri)
-include(../editorconfig-core-qt/EditorConfig.pri)
-win32:include(../QSimpleUpdater/QSimpleUpdater.pri)
-include(../i18n.pri)
+include(NotepadNext.pri)
 
 # Set variables for output executable
 VERSION = $$APP_VERSION
 
 CONFIG += file_copies
 
+# Debug output is compiled out of release builds, add "CONFIG+=keep_debug_output" to keep it
+CONFIG(release, debug|release):!keep_debug_output: DEFINES += QT_NO_DEBUG_OUTPUT
+
 win32 {
     QMAKE_TARGET_COMPANY = Notepad Next
     QMAKE_TARGET_DESCRIPTION = Notepad Next
@@ -61,195 +50,31 @@ COPIES += license
 license.files = ../../LICENSE
 license.path = $$OUT_PWD
 
-SOURCES += \
-    ApplicationSettings.cpp \
-    ColorPickerDelegate.cpp \
-    ComboBoxDelegate.cpp \
-    Converter.cpp \
-    DebugManager.cpp \
-    DockedEditor.cpp \
-    EditorHexViewerTableModel.cpp \
-    EditorManager.cpp \
-    EditorPrintPreviewRenderer.cpp \
-    FadingIndicator.cpp \
-    FileDialogHelpers.cpp \
-    Finder.cpp \
-    HtmlConverter.cpp \
-    IFaceTable.cpp \
-    IFaceTableMixer.cpp \
-    LanguageStylesModel.cpp \
-    LuaExtension.cpp \
-    LuaState.cpp \
-    Macro.cpp \
-    MacroListModel.cpp \
-    MacroManager.cpp \
-    MacroRecorder.cpp \
-    MacroStep.cpp \
-    MacroStepTableModel.cpp \
-    NotepadNextApplication.cpp \
-    NppImporter.cpp \
-    QRegexSearch.cpp \
-    QuickFindWidget.cpp \
-    RangeAllocator.cpp \
-    RecentFilesListManager.cpp \
-    RecentFilesListMenuBuilder.cpp \
-    RtfConverter.cpp \
-    SciIFaceTable.cpp \
-    ScintillaCommenter.cpp \
-    ScintillaNext.cpp \
-    SearchResultsCollector.cpp \
-    SelectionTracker.cpp \
-    SessionManager.cpp \
-    SpinBoxDelegate.cpp \
-    TranslationManager.cpp \
-    UndoAction.cpp \
-    ZoomEventWatcher.cpp \
-    decorators/ApplicationDecorator.cpp \
-    decorators/AutoCompletion.cpp \
-    decorators/AutoIndentation.cpp \
-    decorators/BetterMultiSelection.cpp \
-    decorators/BookMarkDecorator.cpp \
-    decorators/EditorConfigAppDecorator.cpp \
-    decorators/SurroundSelection.cpp \
-    decorators/URLFinder.cpp \
-    dialogs/ColumnEditorDialog.cpp \
-    dialogs/MacroEditorDialog.cpp \
-    docks/DebugLogDock.cpp \
-    docks/EditorInspectorDock.cpp \
-    dialogs/FindReplaceDialog.cpp \
-    docks/FileListDock.cpp \
-    docks/FolderAsWorkspaceDock.cpp \
-    docks/HexViewerDock.cpp \
-    docks/LanguageInspectorDock.cpp \
-    docks/LuaConsoleDock.cpp \
-    dialogs/MacroRunDialog.cpp \
-    dialogs/MacroSaveDialog.cpp \
-    dialogs/MainWindow.cpp \
-    dialogs/PreferencesDialog.cpp \
-    docks/SearchResultsDock.cpp \
-    main.cpp \
-    decorators/BraceMatch.cpp \
-    decorators/EditorDecorator.cpp \
-    decorators/HighlightedScrollBar.cpp \
-    decorators/LineNumbers.cpp \
-    decorators/SmartHighlighter.cpp \
-    widgets/EditorInfoStatusBar.cpp \
-    widgets/StatusLabel.cpp
+SOURCES += main.cpp
 
-HEADERS += \
-    ApplicationSettings.h \
-    ColorPickerDelegate.h \
-    ComboBoxDelegate.h \
-    Converter.h \
-    DebugManager.h \
-    DockedEditor.h \
-    DockedEditorTitleBar.h \
-    EditorHexViewerTableModel.h \
-    EditorManager.h \
-    EditorPrintPreviewRenderer.h \
-    FadingIndicator.h \
-    FileDialogHelpers.h \
-    Finder.h \
-    FocusWatcher.h \
-    HtmlConverter.h \
-    IFaceTable.h \
-    IFaceTableMixer.h \
-    ISearchResultsHandler.h \
-    LanguageStylesModel.h \
-    LuaExtension.h \
-    LuaState.h \
-    Macro.h \
-    MacroListModel.h \
-    MacroManager.h \
-    MacroRecorder.h \
-    MacroStep.h \
-    MacroStepTableModel.h \
-    NotepadNextApplication.h \
-    NppImporter.h \
-    QRegexSearch.h \
-    QuickFindWidget.h \
-    RangeAllocator.h \
-    RecentFilesListManager.h \
-    RecentFilesListMenuBuilder.h \
-    RtfConverter.h \
-    SciIFaceTable.h \
-    ScintillaCommenter.h \
-    ScintillaEnums.h \
-    ScintillaNext.h \
-    SearchResultsCollector.h \
-    SelectionTracker.h \
-    SessionManager.h \
-    SpinBoxDelegate.h \
-    TranslationManager.h \
-    UndoAction.h \
-    ZoomEventWatcher.h \
-    decorators/ApplicationDecorator.h \
-    decorators/AutoCompletion.h \
-    decorators/AutoIndentation.h \
-    decorators/BetterMultiSelection.h \
-    decorators/BookMarkDecorator.h \
-    decorators/EditorConfigAppDecorator.h \
-    decorators/SurroundSelection.h \
-    decorators/URLFinder.h \
-    dialogs/ColumnEditorDialog.h \
-    dialogs/MacroEditorDialog.h \
-    docks/DebugLogDock.h \
-    docks/EditorInspectorDock.h \
-    dialogs/FindReplaceDialog.h \
-    docks/FileListDock.h \
-    docks/FolderAsWorkspaceDock.h \
-    docks/HexViewerDock.h \
-    docks/LanguageInspectorDock.h \
-    docks/LuaConsoleDock.h \
-    dialogs/MacroRunDialog.h \
-    dialogs/MacroSaveDialog.h \
-    dialogs/MainWindow.h \
-    dialogs/PreferencesDialog.h \
-    decorators/BraceMatch.h \
-    decorators/EditorDecorator.h \
-    decorators/HighlightedScrollBar.h \
-    decorators/LineNumbers.h \
-    decorators/SmartHighlighter.h \
-    docks/SearchResultsDock.h \
-    widgets/EditorInfoStatusBar.h \
-    widgets/StatusLabel.h
+# Compile the scripts in scripts.qrc to bytecode so they don't need to be parsed at start up. It needs
+# to run the LuaBytecode tool built alongside this, so cross compiling keeps loading the sources.
+# Add "CONFIG+=no_lua_bytecode" to do the same otherwise.
+!cross_compile:!no_lua_bytecode {
+    LUA_BYTECODE_TOOL = $$shell_path($$OUT_PWD/../LuaBytecode/LuaBytecode)
+    win32: LUA_BYTECODE_TOOL = $${LUA_BYTECODE_TOOL}.exe
 
-FORMS += \
-    QuickFindWidget.ui \
-    dialogs/ColumnEditorDialog.ui \
-    dialogs/MacroEditorDialog.ui \
-    docks/DebugLogDock.ui \
-    docks/EditorInspectorDock.ui \
-    docks/FileListDock.ui \
-    docks/FolderAsWorkspaceDock.ui \
-    docks/HexViewerDock.ui \
-    docks/LanguageInspectorDock.ui \
-    dialogs/MainWindow.ui \
-    dialogs/FindReplaceDialog.ui \
-    docks/LuaConsoleDock.ui \
-    dialogs/MacroRunDialog.ui \
-    dialogs/MacroSaveDialog.ui \
-    dialogs/PreferencesDialog.ui \
-    docks/SearchResultsDock.ui
+    LUA_SCRIPTS = $$files($$PWD/scripts/*.lua) $$files($$PWD/languages/*.lua)
 
-RESOURCES += \
-    resources.qrc \
-    scripts.qrc
+    luabytecode.name = Compiling Lua bytecode
+    luabytecode.input = LUA_SCRIPTS
+    luabytecode.output = build/lua/LuaBytecodeChunks.cpp
+    luabytecode.commands = $$LUA_BYTECODE_TOOL ${QMAKE_FILE_OUT} ${QMAKE_FILE_IN}
+    luabytecode.depends = $$LUA_BYTECODE_TOOL
+    luabytecode.variable_out = SOURCES
+    luabytecode.CONFIG += combine
+    QMAKE_EXTRA_COMPILERS += luabytecode
 
-INCLUDEPATH += $$PWD/decorators
-INCLUDEPATH += $$PWD/dialogs
-INCLUDEPATH += $$PWD/docks
-INCLUDEPATH += $$PWD/widgets
-
-
-INCLUDEPATH += $$PWD/../LuaBridge
-INCLUDEPATH += $$PWD/../
-DEFINES += LUA_VERSION_NUM=503
-
-INCLUDEPATH += $$PWD/../lexilla/include
+    DEFINES += LUA_BYTECODE_BUNDLE
+}
 
-win32-g++:LIBS += libUser32
-win32-msvc*:LIBS += User32.lib
+# Plugins use the application's classes directly, so its symbols have to be visible to them
+unix:!macx: QMAKE_LFLAGS += -rdynamic
 
 OBJECTS_DIR = build/obj
 MOC_DIR = build/moc
@@ -21,12 +21,22 @@
 #include "NotepadNextApplication.h"
 #include "RecentFilesListManager.h"
 #include "EditorManager.h"
+#include "FileChangeWatcher.h"
+#include "JobScheduler.h"
+#include "MemoryGovernor.h"
+#include "LuaEventHooks.h"
 #include "LuaExtension.h"
+#include "PluginManager.h"
 #include "DebugManager.h"
+#include "LargeFileViewer.h"
+#include "LatencyMonitor.h"
 #include "SessionManager.h"
+#include "StartupTrace.h"
 #include "TranslationManager.h"
 #include "ApplicationSettings.h"
+#include "BatchProcessor.h"
 
+#include "LuaProfiler.h"
 #include "LuaState.h"
 #include "lua.hpp"
 #include "LuaBridge.h"
@@ -37,8 +47,15 @@
 #include "Lexilla.h"
 
 #include <QCommandLineParser>
+#include <QDataStream>
 
 #include <QDirIterator>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QTimer>
+
+#include <algorithm>
+#include <list>
 
 #ifdef Q_OS_WIN
 #include <Windows.h>
@@ -71,12 +88,47 @@ void parseCommandLine(QCommandLineParser &parser, const QStringList &args)
     parser.addOptions({
         {"translation", "Overrides the system default translation.", "translation"},
         {"reset-settings", "Resets all application settings."},
-        {"n", "Places the cursor on the line number for the first file specified", "line number"}
+        {"n", "Places the cursor on the line number for the first file specified", "line number"},
+        {"c", "Places the cursor on the column number for the first file specified", "column number"},
+        {"startup-trace", "Writes a trace of the start up in the Chrome trace event format to the file.", "file"},
+        {"perf-log", "Records how long key presses, decorators and painting take and writes a summary to the file on exit.", "file"},
+        {"log-rules", "Enables or disables logging categories, separated by semicolons, e.g. \"notepadnext.file.debug=true\".", "rules"},
+        {"batch", "Runs a macro, script and/or replacement over the files and directories given, saves them and exits without showing a window."},
+        {"macro", "Batch mode: the saved macro to run on each file.", "name"},
+        {"macro-times", "Batch mode: how many times to run the macro, 0 runs it until the end of the file. The default is 1.", "count"},
+        {"script", "Batch mode: a Lua script to run on each file, which it sees as the editor.", "file"},
+        {"find", "Batch mode: the text to find in each file.", "text"},
+        {"replace", "Batch mode: what to replace each match of --find with.", "text"},
+        {"regex", "Batch mode: --find is a regular expression."},
+        {"match-case", "Batch mode: --find is case sensitive."},
+        {"whole-word", "Batch mode: --find only matches whole words."},
+        {"filter", "Batch mode: which files to take from the directories given, e.g. \"*.cpp *.h\".", "filters"},
+        {"dry-run", "Batch mode: reports what would change without saving anything."},
+        {"report", "Batch mode: writes the summary to the file instead of the console.", "file"}
     });
 
     parser.process(args);
 }
 
+// Used to time each require() made by init.lua when tracing the start up
+static int luaTraceBegin(lua_State *L)
+{
+    lua_pushinteger(L, StartupTrace::elapsedMicroseconds());
+    return 1;
+}
+
+static int luaTraceEnd(lua_State *L)
+{
+    const QByteArray name = QByteArrayLiteral("require ") + luaL_checkstring(L, 1);
+    const qint64 start = luaL_checkinteger(L, 2);
+
+    StartupTrace::addEvent(name, start, StartupTrace::elapsedMicroseconds() - start);
+    return 0;
+}
+
+// Starts the message a second instance sends with the files it was given
+static const quint32 OPEN_FILES_MESSAGE = 0x4e4e4f46;
+
 static QString toLocalFileName(const QString file)
 {
     QUrl fileUrl(file);
@@ -92,6 +144,14 @@ NotepadNextApplication::NotepadNextApplication(int &argc, char **argv)
 #endif
     parseCommandLine(parser, arguments());
 
+    if (parser.isSet("startup-trace")) {
+        StartupTrace::start(parser.value("startup-trace"));
+    }
+
+    if (parser.isSet("log-rules")) {
+        QLoggingCategory::setFilterRules(parser.value("log-rules").replace(QLatin1Char(';'), QLatin1Char('\n')));
+    }
+
     DebugManager::manageDebugOutput();
     DebugManager::pauseDebugOutput();
 }
@@ -100,15 +160,22 @@ bool NotepadNextApplication::init()
 {
     qInfo(Q_FUNC_INFO);
 
+    TraceScope initTrace("NotepadNextApplication::init");
+
     setWindowIcon(QIcon(QStringLiteral(":/icons/NotepadNext.png")));
 
+    TraceScope settingsTrace("Settings");
     settings = new ApplicationSettings(this);
 
     if (parser.isSet("reset-settings")) {
         settings->clear();
+        ApplicationSettings::resetCache();
     }
 
+    settingsTrace.end();
+
     // Translation files are stored as a qresource
+    TraceScope translationTrace("Translations");
     translationManager = new TranslationManager(this, QStringLiteral(":/i18n/"));
 
     // The command line overrides the settings
@@ -123,12 +190,31 @@ bool NotepadNextApplication::init()
     // This connection isn't needed since the application can not appropriately retranslate the UI at runtime
     //connect(settings, &ApplicationSettings::translationChanged, translationManager, &TranslationManager::loadTranslationByName);
 
+    translationTrace.end();
+
+    TraceScope managersTrace("Managers");
     luaState = new LuaState();
 
+    // Anything the editors create may need it
+    jobScheduler = new JobScheduler(this);
+
     recentFilesListManager = new RecentFilesListManager(this);
     editorManager = new EditorManager(settings, this);
+    fileChangeWatcher = new FileChangeWatcher(this);
     sessionManager = new SessionManager(this);
 
+    memoryGovernor = new MemoryGovernor(editorManager, this);
+    memoryGovernor->setSoftLimit(static_cast<qint64>(settings->memorySoftLimit()) * 1024 * 1024);
+    connect(settings, &ApplicationSettings::memorySoftLimitChanged, memoryGovernor, [=](int megabytes) {
+        memoryGovernor->setSoftLimit(static_cast<qint64>(megabytes) * 1024 * 1024);
+    });
+
+    connect(editorManager, &EditorManager::editorCreated, fileChangeWatcher, &FileChangeWatcher::watchEditor);
+
+    connect(editorManager, &EditorManager::editorCreated, this, [=](ScintillaNext *editor) {
+        getSessionManager()->journalEditor(editor);
+    });
+
     connect(editorManager, &EditorManager::editorCreated, recentFilesListManager, [=](ScintillaNext *editor) {
         if (editor->isFile()) {
             recentFilesListManager->removeFile(editor->getFilePath());
@@ -136,38 +222,108 @@ bool NotepadNextApplication::init()
     });
 
     connect(editorManager, &EditorManager::editorClosed, recentFilesListManager, [=](ScintillaNext *editor) {
-        if (editor->isFile()) {
+        if (editor->isFile() && !editorManager->isClosingEditors()) {
             recentFilesListManager->addFile(editor->getFilePath());
         }
     });
 
+    connect(editorManager, &EditorManager::editorsClosed, recentFilesListManager, [=](const QVector<ScintillaNext *> &editors) {
+        QStringList filePaths;
+
+        for (const ScintillaNext *editor : editors) {
+            if (editor->isFile()) {
+                filePaths.append(editor->getFilePath());
+            }
+        }
+
+        recentFilesListManager->addFiles(filePaths);
+    });
+
     loadSettings();
 
-    connect(this, &NotepadNextApplication::aboutToQuit, this, &NotepadNextApplication::saveSettings);
+    // A batch run opens and closes files without the user seeing them, so they don't belong in the recent files
+    if (!isBatchMode()) {
+        connect(this, &NotepadNextApplication::aboutToQuit, this, &NotepadNextApplication::saveSettings);
+    }
+
+    if (parser.isSet("perf-log")) {
+        const QString perfLogPath = parser.value("perf-log");
+
+        LatencyMonitor::startRecording();
+        connect(this, &NotepadNextApplication::aboutToQuit, this, [=]() { LatencyMonitor::writeReport(perfLogPath); });
+    }
+
+    managersTrace.end();
 
     EditorConfigAppDecorator *ecad = new EditorConfigAppDecorator(this);
     ecad->setEnabled(true);
 
-    luaState->executeFile(":/scripts/init.lua");
-    LuaExtension::Instance().Initialise(luaState->L, Q_NULLPTR);
+    luaState->profiler->setInstructionBudget(settings->scriptInstructionBudget() * Q_INT64_C(1000000));
+    connect(settings, &ApplicationSettings::scriptInstructionBudgetChanged, this, [=](int budget) {
+        luaState->profiler->setInstructionBudget(budget * Q_INT64_C(1000000));
+    });
 
-    // LuaBridge is not a long term solution
-    // This is probably temporary, but it is quick and works
-    luabridge::setHideMetatables(false);
-    luabridge::getGlobalNamespace(luaState->L)
-        .beginNamespace("nn")
-            .beginClass<ApplicationSettings>("Settings")
-                .addFunction("showMenuBar", &ApplicationSettings::setShowMenuBar)
-                .addFunction("showToolBar", &ApplicationSettings::setShowToolBar)
-                .addFunction("showTabBar", &ApplicationSettings::setShowTabBar)
-                .addFunction("showStatusBar", &ApplicationSettings::setShowStatusBar)
-            .endClass()
-        .endNamespace();
-    luabridge::setGlobal(luaState->L, settings, "settings");
+    // Running init.lua and indexing the languages is the biggest part of starting up after the window itself, and
+    // nothing needs either until there is an editor, so it is done on another thread while the window is built.
+    // Everything that uses the state or the language index waits for it, see waitForLuaState().
+    luaInitialisation = std::async(std::launch::async, [=]() {
+        TraceScope luaTrace("init.lua");
+        if (StartupTrace::isActive()) {
+            lua_register(luaState->L, "nn_trace_begin", luaTraceBegin);
+            lua_register(luaState->L, "nn_trace_end", luaTraceEnd);
+            luaState->execute("nn_untraced_require = require\n"
+                              "require = function(name)\n"
+                              "    local start = nn_trace_begin()\n"
+                              "    local result = nn_untraced_require(name)\n"
+                              "    nn_trace_end(name, start)\n"
+                              "    return result\n"
+                              "end");
+        }
+
+        luaState->executeFile(":/scripts/init.lua");
+
+        if (StartupTrace::isActive()) {
+            luaState->execute("require = nn_untraced_require\n"
+                              "nn_untraced_require = nil");
+        }
+
+        LuaExtension::Instance().Initialise(luaState->L, Q_NULLPTR);
+        refreshLanguageIndex();
+        luaTrace.end();
+
+        // LuaBridge is not a long term solution
+        // This is probably temporary, but it is quick and works
+        TraceScope luaBridgeTrace("LuaBridge registrations");
+        luabridge::setHideMetatables(false);
+        luabridge::getGlobalNamespace(luaState->L)
+            .beginNamespace("nn")
+                .beginClass<ApplicationSettings>("Settings")
+                    .addFunction("showMenuBar", &ApplicationSettings::setShowMenuBar)
+                    .addFunction("showToolBar", &ApplicationSettings::setShowToolBar)
+                    .addFunction("showTabBar", &ApplicationSettings::setShowTabBar)
+                    .addFunction("showStatusBar", &ApplicationSettings::setShowStatusBar)
+                .endClass()
+                .addFunction("profile", &LuaProfiler::luaProfile)
+            .endNamespace();
+        luabridge::setGlobal(luaState->L, settings, "settings");
+    });
+
+    // Everything a batch run needs is set up, it never gets a window
+    if (isBatchMode()) {
+        waitForLuaState();
+        DebugManager::resumeDebugOutput();
+        return startBatch();
+    }
 
+    TraceScope windowTrace("Main window");
     createNewWindow();
     connect(editorManager, &EditorManager::editorCreated, window, &MainWindow::addEditor);
+    connect(editorManager, &EditorManager::cloneCreated, window, &MainWindow::addEditor);
+    windowTrace.end();
 
+    waitForLuaState();
+
+    TraceScope windowBridgeTrace("LuaBridge registrations");
     luabridge::getGlobalNamespace(luaState->L)
         .beginNamespace("nn")
             .beginClass<QWidget>("QWidget")
@@ -184,6 +340,18 @@ bool NotepadNextApplication::init()
             .endClass()
         .endNamespace();
     luabridge::setGlobal(luaState->L, window, "window");
+    windowBridgeTrace.end();
+
+    // Scripts only hear about the editors once there is a window to activate them in
+    LuaEventHooks *luaEventHooks = new LuaEventHooks(luaState->L, this);
+    connect(editorManager, &EditorManager::editorCreated, luaEventHooks, &LuaEventHooks::watchEditor);
+    connect(editorManager, &EditorManager::cloneCreated, luaEventHooks, &LuaEventHooks::watchEditor);
+    connect(window, &MainWindow::editorActivated, luaEventHooks, &LuaEventHooks::editorActivated);
+
+    PluginManager *pluginManager = new PluginManager(this);
+    connect(editorManager, &EditorManager::editorCreated, pluginManager, &PluginManager::watchEditor);
+    connect(editorManager, &EditorManager::cloneCreated, pluginManager, &PluginManager::watchEditor);
+    connect(window, &MainWindow::editorActivated, pluginManager, &PluginManager::editorActivated);
 
     // If the application is activated (e.g. user switching to another program and them back) the focus
     // needs to be reset on whatever object previously had focus (e.g. the find dialog)
@@ -216,20 +384,13 @@ bool NotepadNextApplication::init()
     if (settings->restorePreviousSession()) {
         qInfo("Restoring previous session");
 
+        TraceScope sessionTrace("Session restore");
         sessionManager->loadSession(window);
     }
 
-    openFiles(parser.positionalArguments());
-
-    if (parser.isSet("n") && parser.positionalArguments().length() > 0) {
-        QString firstFile = parser.positionalArguments()[0];
-        ScintillaNext *editor = editorManager->getEditorByFilePath(toLocalFileName(firstFile));
-
-        if (editor) {
-            int n = parser.value("n").toInt();
-            editor->gotoLine(n - 1);
-        }
-    }
+    TraceScope openFilesTrace("Open files");
+    openFileLocations(fileLocationsFromCommandLine());
+    openFilesTrace.end();
 
     // If the window does not have any editors (meaning the no files were
     // specified on the command line) then create a new empty file
@@ -239,14 +400,97 @@ bool NotepadNextApplication::init()
 
     // Everything should be ready at this point
 
+    TraceScope showTrace("Show window");
     window->restoreWindowState();
     window->show();
+    showTrace.end();
+
+    QTimer::singleShot(0, translationManager, &TranslationManager::loadDeferredTranslations);
+    QTimer::singleShot(0, pluginManager, &PluginManager::start);
+
+    // Keep the session on disk up to date so a crash doesn't lose everything since the application was started
+    QTimer *sessionAutoSaveTimer = new QTimer(this);
+    connect(sessionAutoSaveTimer, &QTimer::timeout, this, [=]() {
+        getSessionManager()->autoSaveSession(window);
+    });
+
+    auto setSessionAutoSaveInterval = [=](int seconds) {
+        if (seconds > 0) {
+            sessionAutoSaveTimer->start(seconds * 1000);
+        }
+        else {
+            sessionAutoSaveTimer->stop();
+        }
+    };
+    setSessionAutoSaveInterval(settings->sessionAutoSaveInterval());
+    connect(settings, &ApplicationSettings::sessionAutoSaveIntervalChanged, this, setSessionAutoSaveInterval);
 
     DebugManager::resumeDebugOutput();
 
+    // Give the window a chance to be painted and anything queued during start up to run before it is written out
+    if (StartupTrace::isActive()) {
+        const qint64 queued = StartupTrace::elapsedMicroseconds();
+
+        QTimer::singleShot(0, this, [=]() {
+            StartupTrace::addEvent("First event loop pass", queued, StartupTrace::elapsedMicroseconds() - queued);
+            StartupTrace::finish();
+        });
+    }
+
     return true;
 }
 
+bool NotepadNextApplication::startBatch()
+{
+    qInfo(Q_FUNC_INFO);
+
+    BatchProcessor::Options options;
+    options.paths = parser.positionalArguments();
+    options.filters = parser.value("filter");
+    options.macroName = parser.value("macro");
+    options.macroTimes = parser.isSet("macro-times") ? parser.value("macro-times").toInt() : 1;
+    options.scriptFile = parser.value("script");
+    options.find = parser.value("find").toUtf8();
+    options.replacement = parser.value("replace").toUtf8();
+    options.dryRun = parser.isSet("dry-run");
+    options.reportFile = parser.value("report");
+
+    if (parser.isSet("regex"))
+        options.searchFlags |= SCFIND_REGEXP;
+    if (parser.isSet("match-case"))
+        options.searchFlags |= SCFIND_MATCHCASE;
+    if (parser.isSet("whole-word"))
+        options.searchFlags |= SCFIND_WHOLEWORD;
+
+    QString error;
+    if (parser.isSet("find") != parser.isSet("replace")) {
+        error = tr("--find and --replace have to be given together");
+    }
+    else if (options.macroTimes < 0) {
+        error = tr("--macro-times can not be negative");
+    }
+    else {
+        BatchProcessor *batch = new BatchProcessor(this);
+
+        connect(batch, &BatchProcessor::finished, this, [=](bool success) {
+            exit(success ? 0 : 1);
+        });
+
+        if (batch->start(options, error)) {
+            return true;
+        }
+
+        delete batch;
+    }
+
+    qCritical("%s", qUtf8Printable(error));
+
+    // The event loop hasn't started yet, so the exit has to wait for it
+    QMetaObject::invokeMethod(this, [=]() { exit(2); }, Qt::QueuedConnection);
+
+    return false;
+}
+
 SessionManager *NotepadNextApplication::getSessionManager() const
 {
     SessionManager::SessionFileTypes fileTypes;
@@ -271,85 +515,261 @@ SessionManager *NotepadNextApplication::getSessionManager() const
 
 QString NotepadNextApplication::getFileDialogFilter() const
 {
-    return getLuaState()->executeAndReturn<QString>("return DialogFilters()");
+    waitForLuaState();
+
+    return fileDialogFilter;
 }
 
 QString NotepadNextApplication::getFileDialogFilterForLanguage(const QString &language) const
 {
-    return getLuaState()->executeAndReturn<QString>(QString("return FilterForLanguage(\"%1\")").arg(language).toLatin1().constData());
+    waitForLuaState();
+
+    return fileDialogFilterByLanguage.value(language);
 }
 
 QStringList NotepadNextApplication::getLanguages() const
 {
-    return getLuaState()->executeAndReturn<QStringList>(
+    waitForLuaState();
+
+    return languageNames;
+}
+
+void NotepadNextApplication::refreshLanguageIndex()
+{
+    qInfo(Q_FUNC_INFO);
+
+    // The definitions may have changed as well
+    compiledLanguages.clear();
+
+    languageNames = luaState->executeAndReturn<QStringList>(
                 R"(
                 local names = {}
-                for k in pairs(languages) do table.insert(names, k) end
+                for k in pairs(language_manifest) do table.insert(names, k) end
                 table.sort(names, function (a, b) return string.lower(a) < string.lower(b) end)
                 return names
                 )");
+
+    // Pairs of names and extensions, everything in one go rather than a call per language
+    const QStringList entries = luaState->executeAndReturn<QStringList>(
+                R"(
+                local entries = {}
+                for name, M in pairs(language_manifest) do
+                    for _, ext in ipairs(M.extensions or {}) do
+                        table.insert(entries, name)
+                        table.insert(entries, ext)
+                    end
+                end
+                return entries
+                )");
+
+    QHash<QString, QStringList> extensionsByLanguage;
+    for (int i = 0; i + 1 < entries.size(); i += 2) {
+        extensionsByLanguage[entries[i]].append(entries[i + 1]);
+    }
+
+    languageByExtension.clear();
+    fileDialogFilterByLanguage.clear();
+
+    QStringList filters;
+
+    // Going through them in order means an extension claimed by more than one language always picks the same one
+    for (const QString &name : qAsConst(languageNames)) {
+        if (!extensionsByLanguage.contains(name)) {
+            continue;
+        }
+
+        QStringList patterns;
+        for (const QString &extension : extensionsByLanguage.value(name)) {
+            if (!languageByExtension.contains(extension)) {
+                languageByExtension.insert(extension, name);
+            }
+
+            if (!extension.isEmpty()) {
+                patterns.append(QStringLiteral("*.") + extension);
+            }
+        }
+
+        const QString filter = QStringLiteral("%1 Files (%2)").arg(name, patterns.join(' '));
+        fileDialogFilterByLanguage.insert(name, filter);
+        filters.append(filter);
+    }
+
+    std::sort(filters.begin(), filters.end(), [](const QString &a, const QString &b) { return a.toLower() < b.toLower(); });
+    filters.prepend(QStringLiteral("All Files (*)"));
+
+    fileDialogFilter = filters.join(QStringLiteral(";;"));
 }
 
-void NotepadNextApplication::setEditorLanguage(ScintillaNext *editor, const QString &languageName) const
+// Everything setEditorLanguage() needs from a language definition, read out of Lua once. The styles, keywords
+// and properties are kept as the Scintilla messages that set them, so applying them is just sending each one.
+struct CompiledLanguage
 {
-    LuaExtension::Instance().setEditor(editor);
-
-    getLuaState()->execute(QString("languageName = \"%1\"").arg(languageName).toLatin1().constData());
-    const QString lexer = getLuaState()->executeAndReturn<QString>("return languages[languageName].lexer");
+    struct Message {
+        int message;
+        uptr_t wParam;
+        sptr_t lParam;
+    };
+
+    QByteArray lexer;
+    QByteArray singleLineComment;
+    bool useTabs = true;
+    int tabWidth = 4;
+    QMap<int, QByteArray> keywordSets;
+    QList<QByteArray> keywords;
+
+    QVector<Message> messages;
+
+    // Owns whatever the messages point to
+    std::list<QByteArray> strings;
+
+    void add(int message, uptr_t wParam, sptr_t lParam) { messages.append({message, wParam, lParam}); }
+    void addString(int message, uptr_t wParam, const QByteArray &str)
+    {
+        strings.push_back(str);
+        add(message, wParam, reinterpret_cast<sptr_t>(strings.back().constData()));
+    }
+    void addProperty(const QByteArray &name, const QByteArray &value)
+    {
+        strings.push_back(name);
+        const char *key = strings.back().constData();
+        strings.push_back(value);
+        add(SCI_SETPROPERTY, reinterpret_cast<uptr_t>(key), reinterpret_cast<sptr_t>(strings.back().constData()));
+    }
+};
 
-    editor->languageName = languageName;
-    editor->languageSingleLineComment = getLuaState()->executeAndReturn<QString>("return languages[languageName].singleLineComment or \"\"").toUtf8();
+std::shared_ptr<CompiledLanguage> NotepadNextApplication::compileLanguage(const QString &languageName) const
+{
+    qInfo("Compiling language \"%s\"", qUtf8Printable(languageName));
 
-    auto lexerInstance = CreateLexer(lexer.toLatin1().constData());
-    editor->setILexer((sptr_t) lexerInstance);
-    editor->clearDocumentStyle(); // Remove all previous style information, setting the lexer does not guarantee styling information is cleared
+    std::shared_ptr<CompiledLanguage> language = std::make_shared<CompiledLanguage>();
 
-    // Not ideal this has to be manually emitted but it works since setILexer() is not widely used
-    emit editor->lexerChanged();
+    getLuaState()->execute(QString("languageName = \"%1\"").arg(languageName).toLatin1().constData());
 
-    // Dynamic properties can be used to skip part of the default initialization. The value in the
-    // property doesn't currently matter, but may be used at a later point.
-    getLuaState()->execute(QString("skip_tabs = %1").arg(editor->QObject::property("nn_skip_usetabs").isValid() ? "true" : "false").toLatin1().constData());
-    getLuaState()->execute(QString("skip_tabwidth = %1").arg(editor->QObject::property("nn_skip_tabwidth").isValid() ? "true" : "false").toLatin1().constData());
+    language->lexer = getLuaState()->executeAndReturn<QString>("return languages[languageName].lexer").toLatin1();
+    language->singleLineComment = getLuaState()->executeAndReturn<QString>("return languages[languageName].singleLineComment or \"\"").toUtf8();
+    language->useTabs = getLuaState()->executeAndReturn<bool>("return (languages[languageName].tabSettings or \"tabs\") == \"tabs\"");
+    language->tabWidth = getLuaState()->executeAndReturn<QString>("return tostring(languages[languageName].tabSize or 4)").toInt();
 
-    getLuaState()->execute(R"(
-        local L = languages[languageName]
+    const bool disableFoldMargin = getLuaState()->executeAndReturn<bool>("return languages[languageName].disableFoldMargin and true or false");
+    language->add(SCI_SETMARGINWIDTHN, 2, disableFoldMargin ? 0 : 16);
 
-        if not skip_tabs then
-            editor.UseTabs = (L.tabSettings or "tabs") == "tabs"
-        end
-        if not skip_tabwidth then
-            editor.TabWidth = L.tabSize or 4
+    // Each entry is the style number, the colours and the font style, which is -1 if there isn't one
+    const QStringList styles = getLuaState()->executeAndReturn<QStringList>(R"(
+        local styles = {}
+        for name, style in pairs(languages[languageName].styles or {}) do
+            table.insert(styles, string.format("%d %d %d %d", style.id, style.fgColor or -1, style.bgColor or -1, style.fontStyle or -1))
         end
+        return styles
+        )");
+
+    for (const QString &style : styles) {
+        const QStringList values = style.split(' ');
+        const int id = values[0].toInt();
+        const int fore = values[1].toInt();
+        const int back = values[2].toInt();
+        const int fontStyle = values[3].toInt();
+
+        if (fore >= 0)
+            language->add(SCI_STYLESETFORE, id, fore);
+        if (back >= 0)
+            language->add(SCI_STYLESETBACK, id, back);
+
+        if (fontStyle >= 0) {
+            language->add(SCI_STYLESETBOLD, id, (fontStyle & 1) == 1);
+            language->add(SCI_STYLESETITALIC, id, (fontStyle & 2) == 2);
+            language->add(SCI_STYLESETUNDERLINE, id, (fontStyle & 4) == 4);
+            language->add(SCI_STYLESETEOLFILLED, id, (fontStyle & 8) == 8);
+        }
+    }
 
-        editor.MarginWidthN[2] = L.disableFoldMargin and 0 or 16
-        if L.styles then
-            for name, style in pairs(L.styles) do
-                editor.StyleFore[style.id] = style.fgColor
-                editor.StyleBack[style.id] = style.bgColor
-
-                if style.fontStyle then
-                    editor.StyleBold[style.id] = (style.fontStyle & 1 == 1)
-                    editor.StyleItalic[style.id] = (style.fontStyle & 2 == 2)
-                    editor.StyleUnderline[style.id] = (style.fontStyle & 4 == 4)
-                    editor.StyleEOLFilled[style.id] = (style.fontStyle & 8 == 8)
-                end
-            end
+    // Each entry is the keyword set number followed by its keywords
+    const QStringList keywordSets = getLuaState()->executeAndReturn<QStringList>(R"(
+        local sets = {}
+        for id, kw in pairs(languages[languageName].keywords or {}) do
+            table.insert(sets, tostring(id) .. " " .. kw)
         end
-        if L.keywords then
-            for id, kw in pairs(L.keywords) do
-                editor.KeyWords[id] = kw
-            end
-        end
-        if L.properties then
-            for p,v in pairs(L.properties) do
-                editor.Property[p] = v
-            end
+        return sets
+        )");
+
+    for (const QString &keywordSet : keywordSets) {
+        const QByteArray set = keywordSet.toUtf8();
+        const int separator = set.indexOf(' ');
+        const int id = set.left(separator).toInt();
+        const QByteArray words = set.mid(separator + 1);
+
+        language->keywordSets.insert(id, words);
+        language->keywords.append(words.simplified().split(' '));
+        language->addString(SCI_SETKEYWORDS, id, words);
+    }
+
+    std::sort(language->keywords.begin(), language->keywords.end());
+    language->keywords.erase(std::unique(language->keywords.begin(), language->keywords.end()), language->keywords.end());
+    language->keywords.removeAll(QByteArray());
+
+    // Pairs of names and values
+    const QStringList properties = getLuaState()->executeAndReturn<QStringList>(R"(
+        local properties = {}
+        for p, v in pairs(languages[languageName].properties or {}) do
+            table.insert(properties, p)
+            table.insert(properties, v)
         end
+        return properties
+        )");
+
+    for (int i = 0; i + 1 < properties.size(); i += 2) {
+        language->addProperty(properties[i].toUtf8(), properties[i + 1].toUtf8());
+    }
+
+    language->addProperty("fold", "1");
+    language->addProperty("fold.compact", "0");
+
+    return language;
+}
+
+void NotepadNextApplication::setEditorLanguage(ScintillaNext *editor, const QString &languageName) const
+{
+    TraceScope trace("setEditorLanguage " + languageName.toUtf8());
+
+    waitForLuaState();
+    LuaExtension::Instance().setEditor(editor);
+
+    std::shared_ptr<CompiledLanguage> &language = compiledLanguages[languageName];
+    if (!language) {
+        language = compileLanguage(languageName);
+    }
+
+    editor->languageName = languageName;
+    editor->languageSingleLineComment = language->singleLineComment;
+    editor->languageKeywordSets = language->keywordSets;
+    editor->languageKeywords = language->keywords;
+
+    // The lexer is kept in the document, so a view of one that already has the language only needs its own styles
+    bool lexerShared = false;
+    for (const ScintillaNext *view : editor->documentViews()) {
+        lexerShared |= view != editor && view->languageName == languageName;
+    }
+
+    if (!lexerShared) {
+        auto lexerInstance = CreateLexer(language->lexer.constData());
+        editor->setILexer((sptr_t) lexerInstance);
+        editor->clearDocumentStyle(); // Remove all previous style information, setting the lexer does not guarantee styling information is cleared
+
+        // Not ideal this has to be manually emitted but it works since setILexer() is not widely used
+        emit editor->lexerChanged();
+    }
+
+    // Dynamic properties can be used to skip part of the default initialization. The value in the
+    // property doesn't currently matter, but may be used at a later point.
+    if (!editor->QObject::property("nn_skip_usetabs").isValid()) {
+        editor->setUseTabs(language->useTabs);
+    }
+    if (!editor->QObject::property("nn_skip_tabwidth").isValid()) {
+        editor->setTabWidth(language->tabWidth);
+    }
 
-        editor.Property["fold"] = "1"
-        editor.Property["fold.compact"] = "0"
-    )");
+    for (const CompiledLanguage::Message &message : qAsConst(language->messages)) {
+        editor->send(message.message, message.wParam, message.lParam);
+    }
 }
 
 QString NotepadNextApplication::detectLanguage(ScintillaNext *editor) const
@@ -373,25 +793,16 @@ QString NotepadNextApplication::detectLanguageFromExtension(const QString &exten
 {
     qInfo(Q_FUNC_INFO);
 
-    return getLuaState()->executeAndReturn<QString>(QString(R"(
-    local ext = "%1"
-    for name, L in pairs(languages) do
-        if L.extensions then
-            for _, v in ipairs(L.extensions) do
-                if v == ext then
-                    return name
-                end
-            end
-        end
-    end
-    return "Text"
-    )").arg(extension).toLatin1().constData());
+    waitForLuaState();
+
+    return languageByExtension.value(extension, QStringLiteral("Text"));
 }
 
 QString NotepadNextApplication::detectLanguageFromContents(ScintillaNext *editor) const
 {
     qInfo(Q_FUNC_INFO);
 
+    waitForLuaState();
     LuaExtension::Instance().setEditor(editor);
 
     return getLuaState()->executeAndReturn<QString>(QString(R"(
@@ -405,14 +816,29 @@ QString NotepadNextApplication::detectLanguageFromContents(ScintillaNext *editor
     )").toLatin1().constData());
 }
 
+void NotepadNextApplication::waitForLuaState() const
+{
+    if (luaInitialisation.valid()) {
+        TraceScope trace("Waiting for Lua");
+        luaInitialisation.get();
+    }
+}
+
 void NotepadNextApplication::sendInfoToPrimaryInstance()
 {
     qInfo(Q_FUNC_INFO);
 
+    // Everything the primary instance needs is worked out here, so it can go straight to opening the files
+    const QVector<FileLocation> locations = fileLocationsFromCommandLine();
+
     QByteArray buffer;
     QDataStream stream(&buffer, QIODevice::WriteOnly);
 
-    stream << arguments();
+    stream << OPEN_FILES_MESSAGE << static_cast<quint32>(locations.size());
+    for (const FileLocation &location : locations) {
+        stream << location.filePath << location.line << location.column;
+    }
+
     const bool success = sendMessage(buffer);
 
     if (!success) {
@@ -427,9 +853,33 @@ void NotepadNextApplication::receiveInfoFromSecondaryInstance(quint32 instanceId
     Q_UNUSED(instanceId)
 
     QDataStream stream(&message, QIODevice::ReadOnly);
+    quint32 type = 0;
+
+    stream >> type;
+
+    if (type == OPEN_FILES_MESSAGE) {
+        quint32 count = 0;
+        stream >> count;
+
+        QVector<FileLocation> locations;
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            FileLocation location;
+            stream >> location.filePath >> location.line >> location.column;
+
+            if (stream.status() == QDataStream::Ok) {
+                locations.append(location);
+            }
+        }
+
+        openFileLocations(locations);
+        return;
+    }
+
+    // Older versions send their whole command line instead
+    QDataStream argumentsStream(&message, QIODevice::ReadOnly);
     QStringList args;
 
-    stream >> args;
+    argumentsStream >> args;
 
     QCommandLineParser parser;
     parseCommandLine(parser, args);
@@ -479,13 +929,65 @@ bool NotepadNextApplication::event(QEvent *event)
     return SingleApplication::event(event);
 }
 
+QVector<NotepadNextApplication::FileLocation> NotepadNextApplication::fileLocationsFromCommandLine() const
+{
+    const QStringList files = parser.positionalArguments();
+    QVector<FileLocation> locations;
+    locations.reserve(files.size());
+
+    for (int i = 0; i < files.size(); ++i) {
+        FileLocation location;
+
+        // Relative paths are relative to this process, which needn't be where the primary instance runs
+        location.filePath = QFileInfo(toLocalFileName(files.at(i))).absoluteFilePath();
+        location.line = (i == 0 && parser.isSet("n")) ? parser.value("n").toInt() : 0;
+        location.column = (i == 0 && parser.isSet("c")) ? parser.value("c").toInt() : 0;
+
+        locations.append(location);
+    }
+
+    return locations;
+}
+
+void NotepadNextApplication::openFileLocations(const QVector<FileLocation> &locations)
+{
+    qInfo(Q_FUNC_INFO);
+
+    QStringList filePaths;
+    filePaths.reserve(locations.size());
+    for (const FileLocation &location : locations) {
+        filePaths.append(location.filePath);
+    }
+
+    window->openFileList(filePaths);
+
+    for (const FileLocation &location : locations) {
+        if (location.line <= 0)
+            continue;
+
+        ScintillaNext *editor = editorManager->getEditorByFilePath(location.filePath);
+
+        // Either can still be reading a huge file, then it goes there as soon as the line has been read
+        if (editor) {
+            editor->gotoLineWhenLoaded(location.line - 1, location.column - 1);
+        }
+        else if (LargeFileViewer *viewer = window->largeFileViewer(location.filePath)) {
+            viewer->goToLine(location.line - 1);
+        }
+    }
+}
+
 void NotepadNextApplication::openFiles(const QStringList &files)
 {
     qInfo(Q_FUNC_INFO);
 
+    // Opened as one batch, so only the file that ends up shown gets read straight away
+    QStringList filePaths;
     for (const QString &file : files) {
-        window->openFile(toLocalFileName(file));
+        filePaths.append(toLocalFileName(file));
     }
+
+    window->openFileList(filePaths);
 }
 
 void NotepadNextApplication::loadSettings()
@@ -25,15 +25,24 @@
 #include "SingleApplication"
 
 #include <QCommandLineParser>
+#include <QHash>
 #include <QPointer>
+#include <QVector>
+
+#include <future>
+#include <memory>
 
 
 class MainWindow;
 class LuaState;
 class EditorManager;
+class FileChangeWatcher;
+class JobScheduler;
+class MemoryGovernor;
 class RecentFilesListManager;
 class ScintillaNext;
 class SessionManager;
+struct CompiledLanguage;
 class TranslationManager;
 
 
@@ -46,15 +55,22 @@ public:
 
     bool init();
 
+    // Set by --batch, which runs over files and exits without a window, see BatchProcessor
+    bool isBatchMode() const { return parser.isSet("batch"); }
+
     RecentFilesListManager *getRecentFilesListManager() const { return recentFilesListManager; }
     EditorManager *getEditorManager() const { return editorManager; }
+    FileChangeWatcher *getFileChangeWatcher() const { return fileChangeWatcher; }
+    JobScheduler *getJobScheduler() const { return jobScheduler; }
+    MemoryGovernor *getMemoryGovernor() const { return memoryGovernor; }
     SessionManager *getSessionManager() const;
     TranslationManager *getTranslationManager() const { return translationManager; };
 
-    LuaState *getLuaState() const { return luaState; }
+    LuaState *getLuaState() const { waitForLuaState(); return luaState; }
     QString getFileDialogFilter() const;
     QString getFileDialogFilterForLanguage(const QString &language) const;
     ApplicationSettings *getSettings() const { return settings; }
+    MainWindow *getWindow() const { return window; }
 
     QStringList getLanguages() const;
     void setEditorLanguage(ScintillaNext *editor, const QString &languageName) const;
@@ -63,6 +79,9 @@ public:
     QString detectLanguageFromExtension(const QString &extension) const;
     QString detectLanguageFromContents(ScintillaNext *editor) const;
 
+    // Anything changing language_manifest or the language definitions in Lua needs to call this for the change to be picked up
+    void refreshLanguageIndex();
+
     void sendInfoToPrimaryInstance();
 
     bool isRunningAsAdmin() const;
@@ -75,11 +94,24 @@ private slots:
     void receiveInfoFromSecondaryInstance(quint32 instanceId, QByteArray message);
 
 private:
+    // A file given on the command line, with where to put the cursor (1 based, 0 if not given)
+    struct FileLocation {
+        QString filePath;
+        qint32 line;
+        qint32 column;
+    };
+
+    QVector<FileLocation> fileLocationsFromCommandLine() const;
+    void openFileLocations(const QVector<FileLocation> &locations);
     void openFiles(const QStringList &files);
 
     void loadSettings();
+    bool startBatch();
 
     EditorManager *editorManager;
+    FileChangeWatcher *fileChangeWatcher;
+    JobScheduler *jobScheduler = Q_NULLPTR;
+    MemoryGovernor *memoryGovernor = Q_NULLPTR;
     RecentFilesListManager *recentFilesListManager;
     ApplicationSettings *settings;
     SessionManager *sessionManager;
@@ -87,11 +119,24 @@ private:
 
     LuaState *luaState = Q_NULLPTR;
 
+    // Set while init.lua is still being run on another thread
+    mutable std::future<void> luaInitialisation;
+    void waitForLuaState() const;
+
     MainWindow *window = Q_NULLPTR;
     QPointer<QWidget> currentlyFocusedWidget; // Keep a weak pointer to the QWidget since we don't own it
 
     MainWindow *createNewWindow();
 
+    std::shared_ptr<CompiledLanguage> compileLanguage(const QString &languageName) const;
+    mutable QHash<QString, std::shared_ptr<CompiledLanguage>> compiledLanguages;
+
+    // Built from the language manifest once so none of the lookups have to go through Lua
+    QStringList languageNames;
+    QHash<QString, QString> languageByExtension;
+    QHash<QString, QString> fileDialogFilterByLanguage;
+    QString fileDialogFilter;
+
     QCommandLineParser parser;
 };
 
@@ -0,0 +1,79 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NOTEPADNEXTPLUGIN_H
+#define NOTEPADNEXTPLUGIN_H
+
+#include <QtPlugin>
+
+#include <functional>
+
+class ApplicationDecorator;
+class EditorDecorator;
+class JobScheduler;
+class MatchIndex;
+class NotepadNextApplication;
+class ScintillaNext;
+
+
+// The interface for extensions written in C++, for the things that are called too often to go through Lua such as
+// work done on every keystroke or every match. A plugin is a Qt plugin (see QPluginLoader) built against these
+// headers and the same Qt as the application, so it works with the editor's classes directly.
+//
+// Its metadata needs "apiVersion" set to NotepadNextPlugin::API_VERSION. It can also give "languages", in which
+// case it is not loaded until an editor in one of them is activated. Otherwise it is loaded once the application
+// is idle after starting up.
+
+// What the application gives a plugin to work with. Anything registered is applied to every editor, the ones that
+// are open already as well as the ones opened afterwards.
+class PluginHost
+{
+public:
+    virtual ~PluginHost() {}
+
+    virtual NotepadNextApplication *application() const = 0;
+    virtual JobScheduler *scheduler() const = 0;
+
+    // The factory is called with each editor and clone. The decorator it returns is enabled, it should be
+    // parented to the editor the way EditorDecorator does. Returning Q_NULLPTR skips that editor.
+    virtual void addEditorDecorator(std::function<EditorDecorator *(ScintillaNext *editor)> factory) = 0;
+
+    // The decorator is enabled and kept for as long as the application runs
+    virtual void addApplicationDecorator(ApplicationDecorator *decorator) = 0;
+
+    // Called with the match index of each editor, e.g. to set a range source or to follow matchesChanged()
+    virtual void addMatchIndexConsumer(std::function<void(ScintillaNext *editor, MatchIndex *index)> consumer) = 0;
+};
+
+class NotepadNextPlugin
+{
+public:
+    // Goes up whenever this interface or the classes it hands out change in a way that breaks plugins already built
+    static const int API_VERSION = 1;
+
+    virtual ~NotepadNextPlugin() {}
+
+    virtual void initialise(PluginHost *host) = 0;
+};
+
+#define NotepadNextPlugin_iid "io.github.dail8859.NotepadNext.Plugin/1"
+
+Q_DECLARE_INTERFACE(NotepadNextPlugin, NotepadNextPlugin_iid)
+
+#endif // NOTEPADNEXTPLUGIN_H
@@ -0,0 +1,199 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "OutlineModel.h"
+
+#include "Scintilla.h"
+
+#include <algorithm>
+
+
+// Headers are shown as the start of their line, anything longer isn't worth reading in a tree
+const int MAX_HEADER_TEXT = 200;
+
+std::shared_ptr<const Outline> Outline::build(const Snapshot &snapshot)
+{
+    auto outline = std::make_shared<Outline>();
+    std::vector<Header> &headers = outline->headers;
+
+    const std::vector<Header> *previous = snapshot.previous ? &snapshot.previous->headers : Q_NULLPTR;
+    const int previousLastLine = snapshot.lastLine - snapshot.linesAdded;
+
+    // Headers before the changed lines stay as they were
+    if (previous) {
+        const auto end = std::lower_bound(previous->begin(), previous->end(), snapshot.firstLine, [](const Header &header, int line) {
+            return header.line < line;
+        });
+        headers.reserve(previous->size());
+        headers.insert(headers.end(), previous->begin(), end);
+    }
+
+    // Walk through the changed lines, only the headers need their text
+    const char *text = snapshot.text.constData();
+    const qsizetype length = snapshot.text.size();
+    qsizetype lineStart = 0;
+
+    for (size_t i = 0; i < snapshot.levels.size() && lineStart <= length; ++i) {
+        qsizetype lineEnd = lineStart;
+        while (lineEnd < length && text[lineEnd] != '\n' && text[lineEnd] != '\r')
+            ++lineEnd;
+
+        const int level = snapshot.levels[i];
+        if (level & SC_FOLDLEVELHEADERFLAG) {
+            qsizetype start = lineStart;
+            while (start < lineEnd && (text[start] == ' ' || text[start] == '\t'))
+                ++start;
+
+            const qsizetype shown = qMin<qsizetype>(lineEnd - start, MAX_HEADER_TEXT);
+            headers.push_back({snapshot.firstLine + static_cast<int>(i), (level & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE, QString::fromUtf8(text + start, shown).trimmed()});
+        }
+
+        // Scintilla treats \n, \r\n, and \r as line endings
+        lineStart = lineEnd + 1;
+        if (lineEnd + 1 < length && text[lineEnd] == '\r' && text[lineEnd + 1] == '\n')
+            ++lineStart;
+    }
+
+    // Headers after the changed lines only need moving
+    if (previous) {
+        auto it = std::upper_bound(previous->begin(), previous->end(), previousLastLine, [](int line, const Header &header) {
+            return line < header.line;
+        });
+
+        for (; it != previous->end(); ++it) {
+            headers.push_back({it->line + snapshot.linesAdded, it->level, it->text});
+        }
+    }
+
+    // Nest each header under the closest one before it with a lower level
+    const int count = static_cast<int>(headers.size());
+    outline->parents.resize(count, -1);
+    outline->children.resize(count);
+    outline->rows.resize(count, 0);
+
+    std::vector<int> stack;
+    for (int i = 0; i < count; ++i) {
+        while (!stack.empty() && headers[stack.back()].level >= headers[i].level)
+            stack.pop_back();
+
+        std::vector<int> &siblings = stack.empty() ? outline->roots : outline->children[stack.back()];
+        outline->parents[i] = stack.empty() ? -1 : stack.back();
+        outline->rows[i] = static_cast<int>(siblings.size());
+        siblings.push_back(i);
+
+        stack.push_back(i);
+    }
+
+    return outline;
+}
+
+int Outline::headerAtLine(int line) const
+{
+    const auto it = std::upper_bound(headers.begin(), headers.end(), line, [](int line, const Header &header) {
+        return line < header.line;
+    });
+
+    return static_cast<int>(it - headers.begin()) - 1;
+}
+
+
+OutlineModel::OutlineModel(QObject *parent) :
+    QAbstractItemModel(parent)
+{
+}
+
+void OutlineModel::setOutline(std::shared_ptr<const Outline> outline)
+{
+    beginResetModel();
+    current = std::move(outline);
+    endResetModel();
+}
+
+int OutlineModel::lineAt(const QModelIndex &index) const
+{
+    if (!current || !index.isValid())
+        return -1;
+
+    return current->headers[index.internalId()].line;
+}
+
+QModelIndex OutlineModel::indexForHeader(int header) const
+{
+    if (!current || header < 0 || header >= static_cast<int>(current->headers.size()))
+        return QModelIndex();
+
+    return createIndex(current->rows[header], 0, static_cast<quintptr>(header));
+}
+
+QModelIndex OutlineModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!current || column != 0 || row < 0)
+        return QModelIndex();
+
+    const std::vector<int> &siblings = parent.isValid() ? current->children[parent.internalId()] : current->roots;
+
+    if (row >= static_cast<int>(siblings.size()))
+        return QModelIndex();
+
+    return createIndex(row, 0, static_cast<quintptr>(siblings[row]));
+}
+
+QModelIndex OutlineModel::parent(const QModelIndex &index) const
+{
+    if (!current || !index.isValid())
+        return QModelIndex();
+
+    return indexForHeader(current->parents[index.internalId()]);
+}
+
+int OutlineModel::rowCount(const QModelIndex &parent) const
+{
+    if (!current)
+        return 0;
+
+    if (!parent.isValid())
+        return static_cast<int>(current->roots.size());
+
+    if (parent.column() != 0)
+        return 0;
+
+    return static_cast<int>(current->children[parent.internalId()].size());
+}
+
+int OutlineModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+
+    return 1;
+}
+
+QVariant OutlineModel::data(const QModelIndex &index, int role) const
+{
+    if (!current || !index.isValid())
+        return QVariant();
+
+    const Outline::Header &header = current->headers[index.internalId()];
+
+    if (role == Qt::DisplayRole)
+        return header.text;
+    else if (role == Qt::ToolTipRole)
+        return tr("Line %L1").arg(header.line + 1);
+
+    return QVariant();
+}
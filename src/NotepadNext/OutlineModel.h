@@ -0,0 +1,92 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+
+// The fold headers of a document arranged as a tree, each one nested under the closest header before it
+// with a lower fold level. It is plain data so it can be built on a worker thread.
+struct Outline
+{
+    struct Header
+    {
+        int line;
+        int level;
+        QString text;
+    };
+
+    // What is needed to build an outline for the lines firstLine to lastLine of a document. The headers
+    // from the previous outline are kept for the other lines. Everything after lastLine was moved by
+    // linesAdded since the previous outline was made.
+    struct Snapshot
+    {
+        int firstLine = 0;
+        int lastLine = -1;
+        int linesAdded = 0;
+        std::vector<int> levels;
+        QByteArray text; // from the start of firstLine to the end of lastLine
+        std::shared_ptr<const Outline> previous;
+    };
+
+    static std::shared_ptr<const Outline> build(const Snapshot &snapshot);
+
+    // Sorted by line
+    std::vector<Header> headers;
+
+    // For each header, the index of its parent (or -1), its children, and its row within its parent
+    std::vector<int> parents;
+    std::vector<std::vector<int>> children;
+    std::vector<int> rows;
+    std::vector<int> roots;
+
+    // The last header at or before line, or -1
+    int headerAtLine(int line) const;
+};
+
+
+// Shows an Outline in a tree view. Nothing is copied, the rows are looked up in the outline when asked for.
+class OutlineModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit OutlineModel(QObject *parent = nullptr);
+
+    void setOutline(std::shared_ptr<const Outline> outline);
+    std::shared_ptr<const Outline> outline() const { return current; }
+
+    int lineAt(const QModelIndex &index) const;
+    QModelIndex indexForHeader(int header) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    std::shared_ptr<const Outline> current;
+};
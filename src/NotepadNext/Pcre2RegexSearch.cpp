@@ -0,0 +1,275 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "Pcre2RegexSearch.h"
+#include "Logging.h"
+
+using namespace Scintilla;
+
+
+// The JIT stack starts small and can grow to this, some patterns need a lot of backtracking
+const PCRE2_SIZE JIT_STACK_START = 32 * 1024;
+const PCRE2_SIZE JIT_STACK_MAX = 1024 * 1024;
+
+// How much of the end of the range a backwards search looks at first, it doubles each time nothing is found
+const PCRE2_SIZE BACKWARD_WINDOW_SIZE = 64 * 1024;
+
+static bool isLineEnd(char c)
+{
+    return c == '\n' || c == '\r';
+}
+
+static bool isContinuationByte(char c)
+{
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+Pcre2RegexSearch::Pcre2RegexSearch()
+{
+    compileContext = pcre2_compile_context_create(Q_NULLPTR);
+
+    // Scintilla treats \n, \r\n, and \r as line endings so ^ and $ need to as well
+    pcre2_set_newline(compileContext, PCRE2_NEWLINE_ANYCRLF);
+
+    matchContext = pcre2_match_context_create(Q_NULLPTR);
+    jitStack = pcre2_jit_stack_create(JIT_STACK_START, JIT_STACK_MAX, Q_NULLPTR);
+
+    if (jitStack) {
+        pcre2_jit_stack_assign(matchContext, Q_NULLPTR, jitStack);
+    }
+}
+
+Pcre2RegexSearch::~Pcre2RegexSearch()
+{
+    release();
+
+    pcre2_jit_stack_free(jitStack);
+    pcre2_match_context_free(matchContext);
+    pcre2_compile_context_free(compileContext);
+}
+
+void Pcre2RegexSearch::release()
+{
+    pcre2_match_data_free(matchData);
+    pcre2_code_free(code);
+
+    matchData = Q_NULLPTR;
+    code = Q_NULLPTR;
+}
+
+bool Pcre2RegexSearch::compile(const char *s, bool matchCase)
+{
+    if (compiledPattern == s && compiledMatchCase == matchCase) {
+        return !compileFailed;
+    }
+
+    release();
+
+    compiledPattern = s;
+    compiledMatchCase = matchCase;
+
+    // Same as the options QRegexSearch uses so both engines find the same things
+    uint32_t options = PCRE2_UTF | PCRE2_UCP | PCRE2_MULTILINE;
+
+    if (!matchCase)
+        options |= PCRE2_CASELESS;
+
+#ifdef PCRE2_MATCH_INVALID_UTF
+    // Documents are not guaranteed to be valid UTF-8, this also saves checking the subject on every match
+    options |= PCRE2_MATCH_INVALID_UTF;
+#endif
+
+    int errorCode = 0;
+    PCRE2_SIZE errorOffset = 0;
+
+    code = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(s), PCRE2_ZERO_TERMINATED, options, &errorCode, &errorOffset, compileContext);
+    compileFailed = code == Q_NULLPTR;
+
+    if (compileFailed) {
+        PCRE2_UCHAR message[256];
+        pcre2_get_error_message(errorCode, message, sizeof(message));
+        qCDebug(lcSearch, "Invalid regular expression at %d: %s", static_cast<int>(errorOffset), reinterpret_cast<const char *>(message));
+        return false;
+    }
+
+    // Not every platform has a JIT, the interpreter is used if this fails
+    pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+
+    matchData = pcre2_match_data_create_from_pattern(code, Q_NULLPTR);
+
+    return true;
+}
+
+Sci::Position Pcre2RegexSearch::FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s, bool caseSensitive, bool word, bool wordStart, FindOption flags, Sci::Position *length)
+{
+    Q_UNUSED(caseSensitive);
+    Q_UNUSED(word);
+    Q_UNUSED(wordStart);
+
+    // A backwards search has minPos after maxPos and wants the last match in the range
+    const bool forward = minPos <= maxPos;
+    const Sci::Position rangeStart = doc->MovePositionOutsideChar(forward ? minPos : maxPos, 1, false);
+    const Sci::Position rangeEnd = doc->MovePositionOutsideChar(forward ? maxPos : minPos, -1, false);
+
+    // No need to search an empty range
+    if (rangeStart >= rangeEnd)
+        return -1;
+
+    if (!compile(s, FlagSet(flags, FindOption::MatchCase)))
+        return -1; // Invalid regular expression
+
+    // The subject starts at the beginning of the line so ^ and lookbehinds can see what is before the range.
+    // This points right into the document, the gap is only moved if it is inside of the range.
+    const Sci::Position subjectStart = doc->LineStart(doc->SciLineFromPosition(rangeStart));
+    const PCRE2_SIZE subjectLength = static_cast<PCRE2_SIZE>(rangeEnd - subjectStart);
+    const char *subject = doc->RangePointer(subjectStart, rangeEnd - subjectStart);
+
+    // The end of the range is only the end of a line if it really is one
+    uint32_t matchOptions = 0;
+    if (rangeEnd < doc->Length() && !isLineEnd(doc->CharAt(rangeEnd)))
+        matchOptions |= PCRE2_NOTEOL;
+
+    const PCRE2_SIZE rangeStartOffset = static_cast<PCRE2_SIZE>(rangeStart - subjectStart);
+
+    // Keeps the groups of a match, false if it starts before the range because of a lookaround
+    auto keepMatch = [&]() {
+        const PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(matchData);
+        const uint32_t pairs = pcre2_get_ovector_count(matchData);
+
+        if (ovector[0] < rangeStartOffset)
+            return false;
+
+        groups.assign(pairs * 2, -1);
+
+        for (uint32_t i = 0; i < pairs * 2; ++i) {
+            if (ovector[i] != PCRE2_UNSET)
+                groups[i] = subjectStart + static_cast<Sci::Position>(ovector[i]);
+        }
+
+        *length = groups[1] - groups[0];
+        return true;
+    };
+
+    // Don't start matching in the middle of a character
+    auto skipContinuationBytes = [&](PCRE2_SIZE offset) {
+        while (offset < subjectLength && isContinuationByte(subject[offset]))
+            ++offset;
+        return offset;
+    };
+
+    if (forward) {
+        PCRE2_SIZE offset = rangeStartOffset;
+
+        while (offset <= subjectLength) {
+            if (pcre2_match(code, reinterpret_cast<PCRE2_SPTR>(subject), subjectLength, offset, matchOptions, matchData, matchContext) < 0)
+                return -1; // No (more) matches, or an error such as running out of JIT stack
+
+            if (keepMatch())
+                return groups[0];
+
+            offset = skipContinuationBytes(pcre2_get_ovector_pointer(matchData)[0] + 1);
+        }
+
+        return -1;
+    }
+
+    // Only the end of the range is searched to begin with, going further back each time nothing is found, so finding
+    // the previous match near the end of a big document doesn't mean going through all of it. The subject stays the
+    // same so ^ and lookbehinds still see what is before each window. Every position a match could start at in a
+    // window is tried, the one starting last is the closest to where the search began.
+    PCRE2_SIZE windowSize = BACKWARD_WINDOW_SIZE;
+    PCRE2_SIZE scannedFrom = subjectLength + 1; // matches starting here or later were already looked at
+
+    while (true) {
+        const PCRE2_SIZE windowStart = skipContinuationBytes(scannedFrom - rangeStartOffset > windowSize ? scannedFrom - windowSize : rangeStartOffset);
+        PCRE2_SIZE offset = windowStart;
+        Sci::Position found = -1;
+
+        while (offset < scannedFrom && offset <= subjectLength) {
+            if (pcre2_match(code, reinterpret_cast<PCRE2_SPTR>(subject), subjectLength, offset, matchOptions, matchData, matchContext) < 0)
+                break;
+
+            const PCRE2_SIZE matchStart = pcre2_get_ovector_pointer(matchData)[0];
+
+            if (matchStart >= scannedFrom)
+                break;
+
+            if (keepMatch())
+                found = groups[0];
+
+            offset = skipContinuationBytes(qMax(offset, matchStart) + 1);
+        }
+
+        // The groups are from the last kept match, which is the one found
+        if (found >= 0)
+            return found;
+
+        if (windowStart <= rangeStartOffset)
+            return -1;
+
+        scannedFrom = windowStart;
+        windowSize *= 2;
+    }
+}
+
+const char *Pcre2RegexSearch::SubstituteByPosition(Document *doc, const char *text, Sci::Position *length)
+{
+    qCDebug(lcSearch, Q_FUNC_INFO);
+
+    substituted.clear();
+
+    const int groupCount = static_cast<int>(groups.size() / 2);
+
+    auto appendGroup = [&](int group) {
+        const Sci::Position start = groups[group * 2];
+        const Sci::Position end = groups[group * 2 + 1];
+
+        if (start >= 0 && end > start) {
+            substituted.append(doc->RangePointer(start, end - start), end - start);
+        }
+    };
+
+    // Back references are written \1 to \99, the same as QString::replace() does for QRegexSearch
+    for (Sci::Position i = 0; i < *length; ++i) {
+        if (text[i] == '\\' && i + 1 < *length && text[i + 1] >= '0' && text[i + 1] <= '9') {
+            int group = text[i + 1] - '0';
+            int used = 1;
+
+            if (i + 2 < *length && text[i + 2] >= '0' && text[i + 2] <= '9') {
+                const int twoDigits = group * 10 + (text[i + 2] - '0');
+
+                if (twoDigits < groupCount) {
+                    group = twoDigits;
+                    used = 2;
+                }
+            }
+
+            if (group < groupCount) {
+                appendGroup(group);
+                i += used;
+                continue;
+            }
+        }
+
+        substituted.push_back(text[i]);
+    }
+
+    *length = static_cast<Sci::Position>(substituted.size());
+    return substituted.c_str();
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PCRE2REGEXSEARCH_H
+#define PCRE2REGEXSEARCH_H
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+#include <QByteArray>
+
+#include <string>
+#include <vector>
+
+// Only for the Scintilla headers it pulls in, which have to be in a certain order
+#include "QRegexSearch.h"
+
+
+// Searches with PCRE2 in UTF-8 mode straight on the document's bytes, so unlike QRegexSearch nothing is
+// decoded to UTF-16 and match positions don't need to be mapped back. The pattern is JIT compiled if
+// PCRE2 supports it on this platform.
+class Pcre2RegexSearch : public RegexSearchBase
+{
+public:
+    Pcre2RegexSearch();
+    ~Pcre2RegexSearch() override;
+
+    Pcre2RegexSearch(const Pcre2RegexSearch &) = delete;
+    Pcre2RegexSearch &operator=(const Pcre2RegexSearch &) = delete;
+
+    Sci::Position FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s, bool caseSensitive, bool word, bool wordStart, Scintilla::FindOption flags, Sci::Position *length) override;
+    const char *SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) override;
+
+private:
+    bool compile(const char *s, bool matchCase);
+    void release();
+
+    pcre2_compile_context *compileContext = Q_NULLPTR;
+    pcre2_match_context *matchContext = Q_NULLPTR;
+    pcre2_jit_stack *jitStack = Q_NULLPTR;
+
+    // Only the last pattern is kept, it is nearly always the same one being searched for again
+    pcre2_code *code = Q_NULLPTR;
+    pcre2_match_data *matchData = Q_NULLPTR;
+    QByteArray compiledPattern;
+    bool compiledMatchCase = false;
+    bool compileFailed = false;
+
+    // Document positions of the groups of the last match, -1 when a group didn't take part
+    std::vector<Sci::Position> groups;
+    std::string substituted;
+};
+
+#endif // PCRE2REGEXSEARCH_H
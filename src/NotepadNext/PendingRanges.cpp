@@ -0,0 +1,151 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PendingRanges.h"
+#include "ScintillaNext.h"
+
+using namespace Scintilla;
+
+
+void PendingRanges::add(Sci_CharacterRange range)
+{
+    if (range.cpMin >= range.cpMax) {
+        return;
+    }
+
+    // Merge anything the new range touches
+    int i = 0;
+    while (i < ranges.size() && ranges[i].cpMax < range.cpMin) {
+        ++i;
+    }
+
+    while (i < ranges.size() && ranges[i].cpMin <= range.cpMax) {
+        range.cpMin = qMin(range.cpMin, ranges[i].cpMin);
+        range.cpMax = qMax(range.cpMax, ranges[i].cpMax);
+        ranges.removeAt(i);
+    }
+
+    ranges.insert(i, range);
+}
+
+void PendingRanges::addAll(ScintillaNext *editor)
+{
+    ranges.clear();
+    add({0, static_cast<Sci_PositionCR>(editor->length())});
+}
+
+void PendingRanges::documentModified(ScintillaNext *editor, const NotificationData *pscn)
+{
+    const bool inserted = FlagSet(pscn->modificationType, ModificationFlags::InsertText);
+    const bool deleted = FlagSet(pscn->modificationType, ModificationFlags::DeleteText);
+
+    if (!inserted && !deleted) {
+        return;
+    }
+
+    const Sci_PositionCR position = static_cast<Sci_PositionCR>(pscn->position);
+    const Sci_PositionCR length = static_cast<Sci_PositionCR>(pscn->length);
+
+    for (int i = ranges.size() - 1; i >= 0; --i) {
+        Sci_CharacterRange &range = ranges[i];
+
+        if (inserted) {
+            if (range.cpMin >= position)
+                range.cpMin += length;
+            if (range.cpMax >= position)
+                range.cpMax += length;
+        }
+        else {
+            auto adjust = [=](Sci_PositionCR pos) {
+                return pos <= position ? pos : qMax(position, pos - length);
+            };
+
+            range.cpMin = adjust(range.cpMin);
+            range.cpMax = adjust(range.cpMax);
+
+            if (range.cpMin >= range.cpMax)
+                ranges.removeAt(i);
+        }
+    }
+
+    const Sci_Position end = inserted ? position + length : position;
+    const Sci_PositionCR lineStart = static_cast<Sci_PositionCR>(editor->positionFromLine(editor->lineFromPosition(position)));
+    const Sci_PositionCR lineEnd = static_cast<Sci_PositionCR>(editor->lineEndPosition(editor->lineFromPosition(end)));
+
+    add({lineStart, lineEnd});
+}
+
+QVector<Sci_CharacterRange> PendingRanges::take(const Sci_CharacterRange &range)
+{
+    QVector<Sci_CharacterRange> taken;
+    QVector<Sci_CharacterRange> remaining;
+
+    for (const Sci_CharacterRange &r : qAsConst(ranges)) {
+        if (r.cpMax <= range.cpMin || r.cpMin >= range.cpMax) {
+            remaining.append(r);
+            continue;
+        }
+
+        if (r.cpMin < range.cpMin)
+            remaining.append({r.cpMin, range.cpMin});
+
+        taken.append({qMax(r.cpMin, range.cpMin), qMin(r.cpMax, range.cpMax)});
+
+        if (r.cpMax > range.cpMax)
+            remaining.append({range.cpMax, r.cpMax});
+    }
+
+    ranges = remaining;
+
+    return taken;
+}
+
+QVector<Sci_CharacterRange> PendingRanges::takeVisible(ScintillaNext *editor)
+{
+    if (ranges.isEmpty()) {
+        return QVector<Sci_CharacterRange>();
+    }
+
+    QVector<Sci_CharacterRange> taken;
+
+    for (const Sci_CharacterRange &range : editor->visibleRanges()) {
+        taken.append(take(range));
+    }
+
+    return taken;
+}
+
+Sci_CharacterRange PendingRanges::takeNext(ScintillaNext *editor, Sci_PositionCR size)
+{
+    Q_ASSERT(!ranges.isEmpty());
+
+    Sci_CharacterRange &next = ranges.first();
+    const Sci_CharacterRange chunk {next.cpMin, qMin(next.cpMax, next.cpMin + size)};
+    const Sci_PositionCR lineEnd = static_cast<Sci_PositionCR>(editor->lineEndPosition(editor->lineFromPosition(chunk.cpMax)));
+
+    // Finishing the line keeps whole lines together, unless that means going through most of a long one
+    const Sci_PositionCR end = lineEnd - chunk.cpMax > ScintillaNext::LONG_LINE_LENGTH ? chunk.cpMax : qMin(next.cpMax, qMax(chunk.cpMax, lineEnd));
+
+    next.cpMin = end;
+    if (next.cpMin >= next.cpMax) {
+        ranges.removeFirst();
+    }
+
+    return {chunk.cpMin, end};
+}
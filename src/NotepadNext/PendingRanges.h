@@ -0,0 +1,63 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PENDINGRANGES_H
+#define PENDINGRANGES_H
+
+#include <QVector>
+
+#include "Scintilla.h"
+
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// The parts of a document that still need to be looked at by something that works through it a
+// piece at a time, e.g. while the application is idle. The ranges are kept sorted, never overlap,
+// and start and end on line boundaries so nothing that fits on one line gets split. Long lines are
+// the exception, only the part of them that is on screen or the next piece gets taken at a time.
+class PendingRanges
+{
+public:
+    bool isEmpty() const { return ranges.isEmpty(); }
+    void clear() { ranges.clear(); }
+
+    void add(Sci_CharacterRange range);
+    void addAll(ScintillaNext *editor);
+
+    // Keeps the ranges lined up with the text, and adds the lines that were touched by the change
+    void documentModified(ScintillaNext *editor, const Scintilla::NotificationData *pscn);
+
+    // Removes and returns whatever is pending within range
+    QVector<Sci_CharacterRange> take(const Sci_CharacterRange &range);
+
+    // Removes and returns whatever is pending on the parts of the lines currently on screen
+    QVector<Sci_CharacterRange> takeVisible(ScintillaNext *editor);
+
+    // Removes and returns about size bytes from the start, extended to the end of the line if it isn't long
+    Sci_CharacterRange takeNext(ScintillaNext *editor, Sci_PositionCR size);
+
+private:
+    QVector<Sci_CharacterRange> ranges;
+};
+
+#endif // PENDINGRANGES_H
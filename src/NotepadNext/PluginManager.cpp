@@ -0,0 +1,216 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PluginManager.h"
+#include "JobScheduler.h"
+#include "MatchIndex.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+
+#include "ApplicationDecorator.h"
+#include "EditorDecorator.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLibrary>
+#include <QPluginLoader>
+#include <QStandardPaths>
+
+
+PluginManager::PluginManager(NotepadNextApplication *app) :
+    QObject(app),
+    app(app)
+{
+}
+
+QStringList PluginManager::pluginDirectories()
+{
+    return QStringList()
+        << QCoreApplication::applicationDirPath() + QStringLiteral("/plugins")
+        << QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/plugins");
+}
+
+void PluginManager::start()
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (started) {
+        return;
+    }
+    started = true;
+
+    for (const QString &directory : pluginDirectories()) {
+        for (const QFileInfo &info : QDir(directory).entryInfoList(QDir::Files)) {
+            if (QLibrary::isLibrary(info.fileName())) {
+                unchecked.append(info.absoluteFilePath());
+            }
+        }
+    }
+
+    // Reading the metadata still means opening each file, so it is kept out of the way of anything else
+    scheduler()->schedule(this, JobScheduler::Idle, [=](const QDeadlineTimer &deadline) {
+        while (!unchecked.isEmpty() && !deadline.hasExpired()) {
+            findPlugin(unchecked.takeFirst());
+        }
+
+        if (!unchecked.isEmpty()) {
+            return true;
+        }
+
+        scanned = true;
+        loadPlugins(QString());
+        if (activeEditor) {
+            loadPlugins(activeEditor->languageName);
+        }
+
+        return false;
+    });
+}
+
+JobScheduler *PluginManager::scheduler() const
+{
+    return app->getJobScheduler();
+}
+
+void PluginManager::addEditorDecorator(std::function<EditorDecorator *(ScintillaNext *)> factory)
+{
+    editorDecorators.append(factory);
+
+    for (ScintillaNext *editor : editors) {
+        if (editor) {
+            if (EditorDecorator *decorator = factory(editor)) {
+                decorator->setEnabled(true);
+            }
+        }
+    }
+}
+
+void PluginManager::addApplicationDecorator(ApplicationDecorator *decorator)
+{
+    decorator->setEnabled(true);
+}
+
+void PluginManager::addMatchIndexConsumer(std::function<void(ScintillaNext *, MatchIndex *)> consumer)
+{
+    matchIndexConsumers.append(consumer);
+
+    for (ScintillaNext *editor : editors) {
+        if (editor) {
+            consumer(editor, MatchIndex::forEditor(editor));
+        }
+    }
+}
+
+void PluginManager::watchEditor(ScintillaNext *editor)
+{
+    editors.removeAll(QPointer<ScintillaNext>());
+    editors.append(editor);
+
+    setupEditor(editor);
+
+    connect(editor, &ScintillaNext::lexerChanged, this, [=]() {
+        if (scanned && editor == activeEditor) {
+            loadPlugins(editor->languageName);
+        }
+    });
+}
+
+void PluginManager::editorActivated(ScintillaNext *editor)
+{
+    activeEditor = editor;
+
+    if (scanned) {
+        loadPlugins(editor->languageName);
+    }
+}
+
+void PluginManager::findPlugin(const QString &filePath)
+{
+    QPluginLoader *loader = new QPluginLoader(filePath, this);
+    const QJsonObject metaData = loader->metaData();
+    const QJsonObject pluginData = metaData.value(QStringLiteral("MetaData")).toObject();
+
+    if (metaData.value(QStringLiteral("IID")).toString() != QStringLiteral(NotepadNextPlugin_iid)) {
+        delete loader;
+        return;
+    }
+
+    if (pluginData.value(QStringLiteral("apiVersion")).toInt() != NotepadNextPlugin::API_VERSION) {
+        qWarning("Plugin %s was built for a different version of the plugin interface", qUtf8Printable(filePath));
+        delete loader;
+        return;
+    }
+
+    Plugin plugin;
+    plugin.loader = loader;
+    for (const QJsonValue &language : pluginData.value(QStringLiteral("languages")).toArray()) {
+        plugin.languages.append(language.toString());
+    }
+
+    plugins.append(plugin);
+}
+
+void PluginManager::loadPlugins(const QString &language)
+{
+    for (Plugin &plugin : plugins) {
+        if (plugin.loaded) {
+            continue;
+        }
+
+        const bool wanted = language.isEmpty() ? plugin.languages.isEmpty() : plugin.languages.contains(language, Qt::CaseInsensitive);
+        if (wanted) {
+            load(plugin);
+        }
+    }
+}
+
+void PluginManager::load(Plugin &plugin)
+{
+    qInfo("Loading plugin %s", qUtf8Printable(plugin.loader->fileName()));
+
+    // Whether or not it works, it is only tried once
+    plugin.loaded = true;
+
+    NotepadNextPlugin *instance = qobject_cast<NotepadNextPlugin *>(plugin.loader->instance());
+    if (instance == Q_NULLPTR) {
+        qWarning("Failed to load plugin %s: %s", qUtf8Printable(plugin.loader->fileName()), qUtf8Printable(plugin.loader->errorString()));
+        return;
+    }
+
+    instance->initialise(this);
+}
+
+void PluginManager::setupEditor(ScintillaNext *editor)
+{
+    for (const auto &factory : editorDecorators) {
+        if (EditorDecorator *decorator = factory(editor)) {
+            decorator->setEnabled(true);
+        }
+    }
+
+    if (!matchIndexConsumers.isEmpty()) {
+        MatchIndex *index = MatchIndex::forEditor(editor);
+
+        for (const auto &consumer : matchIndexConsumers) {
+            consumer(editor, index);
+        }
+    }
+}
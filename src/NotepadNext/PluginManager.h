@@ -0,0 +1,84 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PLUGINMANAGER_H
+#define PLUGINMANAGER_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QVector>
+
+#include "NotepadNextPlugin.h"
+
+class QPluginLoader;
+
+
+// Finds the plugins in the plugin directories and loads each of them the first time it is needed, see
+// NotepadNextPlugin. Nothing is looked at until start() is called, which is once the window is up.
+class PluginManager : public QObject, public PluginHost
+{
+    Q_OBJECT
+
+public:
+    explicit PluginManager(NotepadNextApplication *app);
+
+    static QStringList pluginDirectories();
+
+    // Looks through the directories a file at a time while the application is idle
+    void start();
+
+    NotepadNextApplication *application() const override { return app; }
+    JobScheduler *scheduler() const override;
+    void addEditorDecorator(std::function<EditorDecorator *(ScintillaNext *editor)> factory) override;
+    void addApplicationDecorator(ApplicationDecorator *decorator) override;
+    void addMatchIndexConsumer(std::function<void(ScintillaNext *editor, MatchIndex *index)> consumer) override;
+
+public slots:
+    void watchEditor(ScintillaNext *editor);
+    void editorActivated(ScintillaNext *editor);
+
+private:
+    struct Plugin {
+        QPluginLoader *loader;
+        QStringList languages;
+        bool loaded = false;
+    };
+
+    void findPlugin(const QString &filePath);
+    void loadPlugins(const QString &language);
+    void load(Plugin &plugin);
+    void setupEditor(ScintillaNext *editor);
+
+    NotepadNextApplication *app;
+
+    QStringList unchecked;
+    QVector<Plugin> plugins;
+    bool started = false;
+    bool scanned = false;
+
+    QList<QPointer<ScintillaNext>> editors;
+    QPointer<ScintillaNext> activeEditor;
+
+    QVector<std::function<EditorDecorator *(ScintillaNext *)>> editorDecorators;
+    QVector<std::function<void(ScintillaNext *, MatchIndex *)>> matchIndexConsumers;
+};
+
+#endif // PLUGINMANAGER_H
@@ -18,22 +18,20 @@
 
 
 #include "QRegexSearch.h"
+#include "Logging.h"
 
 #include <QtGlobal>
 #include <QRegularExpression>
 
+#include <cstring>
+
 using namespace Scintilla;
 
-#ifdef SCI_OWNREGEX
-RegexSearchBase *Scintilla::Internal::CreateRegexSearch(CharClassify *charClassTable)
-{
-    Q_UNUSED(charClassTable);
+// Keep a handful of expressions around, typically only one or two are ever in use at a time
+const int MAX_CACHED_EXPRESSIONS = 16;
 
-    qInfo(Q_FUNC_INFO);
-
-    return new QRegexSearch();
-}
-#endif
+// How much of the end of the range a backwards search looks at first, it doubles each time nothing is found
+const Sci::Position BACKWARD_WINDOW_SIZE = 64 * 1024;
 
 QRegexSearch::QRegexSearch()
 {
@@ -48,9 +46,11 @@ Sci::Position QRegexSearch::FindText(Document *doc, Sci::Position minPos, Sci::P
     // when you start using characters that are >1 byte a piece. Meaning position 3 (3 bytes into a file) could be 1 character.
     // -----------------------------------------------------------------------------------------------------------------------
 
-    // Make sure the positiosn are outside of characters
-    minPos = doc->MovePositionOutsideChar(minPos, 1, false);
-    maxPos = doc->MovePositionOutsideChar(maxPos, -1, false);
+    // A backwards search has minPos after maxPos and wants the match closest to the end of the range. Either way make
+    // sure the positions are outside of characters.
+    const bool forward = minPos <= maxPos;
+    const Sci::Position rangeStart = doc->MovePositionOutsideChar(forward ? minPos : maxPos, 1, false);
+    const Sci::Position rangeEnd = doc->MovePositionOutsideChar(forward ? maxPos : minPos, -1, false);
 
     //qInfo(Q_FUNC_INFO);
     //qInfo("\tminPos %d", minPos);
@@ -62,26 +62,25 @@ Sci::Position QRegexSearch::FindText(Document *doc, Sci::Position minPos, Sci::P
     //qInfo("\tflags %d", flags);
 
     // No need to search an empty range
-    if (minPos == maxPos)
+    if (rangeStart >= rangeEnd)
         return -1;
 
-    auto options = QRegularExpression::MultilineOption | QRegularExpression::UseUnicodePropertiesOption;
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption | QRegularExpression::UseUnicodePropertiesOption;
 
     if (!FlagSet(flags, FindOption::MatchCase))
         options |= QRegularExpression::CaseInsensitiveOption;
 
     // TODO: does (*ANYCRLF) need prepended to the search string?
-    QRegularExpression re(s, options);
+    const QRegularExpression &re = compiledExpression(s, options);
     if (!re.isValid())
         return -1; // Invalid regular expression
 
-    // Get the bytes from the document. No need to go past maxPos bytes
-    // Not actually sure if this copies the data or not
-    const Sci::Position rangeLength = maxPos - minPos;
-    const QString utf8 = QString::fromUtf8(doc->RangePointer(minPos, rangeLength), rangeLength);
+    if (!forward)
+        return findBackward(doc, re, rangeStart, rangeEnd, length);
 
     // NOTE: QString uses UTF16 counts since QChars are 16 bits
-    QRegularExpressionMatch m = re.match(utf8, 0, QRegularExpression::NormalMatch, QRegularExpression::NoMatchOption);
+    const qsizetype offset = windowOffsetOf(doc, rangeStart, rangeEnd);
+    QRegularExpressionMatch m = re.match(window, offset, QRegularExpression::NormalMatch, QRegularExpression::NoMatchOption);
 
     if (!m.hasMatch())
         return -1; // No match
@@ -89,10 +88,16 @@ Sci::Position QRegexSearch::FindText(Document *doc, Sci::Position minPos, Sci::P
     match = m;
 
     // NOTE: Returned started is the index into the QString which uses UTF16
-    const int positionStart = doc->GetRelativePositionUTF16(minPos, match.capturedStart(0));
+    const Sci::Position positionStart = doc->GetRelativePositionUTF16(rangeStart, match.capturedStart(0) - offset);
 
     // Now move ahead however many characters we matched. Again, based on UTF16 count
-    const int positionEnd = doc->GetRelativePositionUTF16(positionStart, match.capturedLength(0));
+    const Sci::Position positionEnd = doc->GetRelativePositionUTF16(positionStart, match.capturedLength(0));
+
+    matchPosition = positionStart;
+
+    // Remember where the match ended since the next search very likely starts from there
+    cursorPosition = positionEnd;
+    cursorOffset = match.capturedEnd(0);
 
     // The length is the number of bytes that was matched
     *length = positionEnd - positionStart;
@@ -100,25 +105,278 @@ Sci::Position QRegexSearch::FindText(Document *doc, Sci::Position minPos, Sci::P
     return positionStart;
 }
 
-const char *QRegexSearch::SubstituteByPosition(Document *doc, const char *text, Sci::Position *length)
+Sci::Position QRegexSearch::findBackward(Document *doc, const QRegularExpression &re, Sci::Position rangeStart, Sci::Position rangeEnd, Sci::Position *length)
+{
+    // Only the end of the range is searched to begin with, going further back each time nothing is found, so finding
+    // the previous match near the end of a big document doesn't mean going through all of it. Every position a match
+    // could start at in a window is tried, the one starting last is the closest to where the search began.
+    Sci::Position windowSize = BACKWARD_WINDOW_SIZE;
+    Sci::Position scannedFrom = rangeEnd + 1; // matches starting here or later were already looked at
+
+    while (true) {
+        const Sci::Position windowStartPosition = doc->MovePositionOutsideChar(qMax(rangeStart, scannedFrom - windowSize), -1, false);
+
+        // Decoding from the start of the line means ^ and lookbehinds see what they would anyway, unless the line is huge
+        const Sci::Position lineStart = doc->LineStart(doc->SciLineFromPosition(windowStartPosition));
+        const Sci::Position decodeStart = windowStartPosition - lineStart <= windowSize ? lineStart : windowStartPosition;
+
+        // The window that is already decoded gets used if it covers this one, so offsets go from wherever it starts
+        windowOffsetOf(doc, decodeStart, rangeEnd);
+        const qsizetype firstOffset = windowOffsetOf(doc, windowStartPosition, rangeEnd);
+        const qsizetype rangeStartOffset = rangeStart > windowStart ? doc->CountUTF16(windowStart, rangeStart) : 0;
+        const qsizetype endOffset = scannedFrom > rangeEnd ? window.size() + 1 : firstOffset + doc->CountUTF16(windowStartPosition, scannedFrom);
+
+        QRegularExpressionMatch last;
+        qsizetype offset = firstOffset;
+
+        while (offset < endOffset && offset <= window.size()) {
+            QRegularExpressionMatch m = re.match(window, offset, QRegularExpression::NormalMatch, QRegularExpression::NoMatchOption);
+
+            if (!m.hasMatch() || m.capturedStart(0) >= endOffset)
+                break;
+
+            if (m.capturedStart(0) >= rangeStartOffset)
+                last = m;
+
+            offset = qMax(offset, m.capturedStart(0)) + 1;
+
+            // Don't start matching in the middle of a surrogate pair
+            if (offset < window.size() && window.at(offset).isLowSurrogate())
+                ++offset;
+        }
+
+        if (last.hasMatch()) {
+            match = last;
+
+            const Sci::Position positionStart = doc->GetRelativePositionUTF16(windowStart, match.capturedStart(0));
+            const Sci::Position positionEnd = doc->GetRelativePositionUTF16(positionStart, match.capturedLength(0));
+
+            matchPosition = positionStart;
+
+            cursorPosition = positionEnd;
+            cursorOffset = match.capturedEnd(0);
+
+            *length = positionEnd - positionStart;
+
+            return positionStart;
+        }
+
+        if (windowStartPosition <= rangeStart)
+            return -1;
+
+        scannedFrom = windowStartPosition;
+        windowSize *= 2;
+    }
+}
+
+const QRegularExpression &QRegexSearch::compiledExpression(const char *s, QRegularExpression::PatternOptions options)
+{
+    const QPair<QByteArray, int> key(QByteArray(s), static_cast<int>(options));
+
+    auto it = expressionCache.constFind(key);
+    if (it != expressionCache.constEnd()) {
+        return it.value();
+    }
+
+    if (expressionCache.size() >= MAX_CACHED_EXPRESSIONS) {
+        expressionCache.clear();
+    }
+
+    QRegularExpression re(QString::fromUtf8(s), options);
+
+    // Force the pattern to be compiled (and JIT'd if available) right now rather than on first use
+    re.optimize();
+
+    return expressionCache.insert(key, re).value();
+}
+
+qsizetype QRegexSearch::windowOffsetOf(Document *doc, Sci::Position minPos, Sci::Position maxPos)
+{
+    if (watchedDocument != doc) {
+        if (watchedDocument) {
+            watchedDocument->RemoveWatcher(this, Q_NULLPTR);
+        }
+
+        watchedDocument = doc;
+        watchedDocument->AddWatcher(this, Q_NULLPTR);
+        invalidateWindow();
+    }
+
+    // The window can be reused as long as it ends at the same spot and covers the starting position
+    if (windowEnd != maxPos || minPos < windowStart) {
+        const Sci::Position rangeLength = maxPos - minPos;
+
+        window = QString::fromUtf8(doc->RangePointer(minPos, rangeLength), rangeLength);
+        windowStart = minPos;
+        windowEnd = maxPos;
+        cursorPosition = minPos;
+        cursorOffset = 0;
+    }
+
+    // Searches normally move forward so only count the UTF16 characters between the last known position and this one
+    if (minPos < cursorPosition) {
+        cursorPosition = windowStart;
+        cursorOffset = 0;
+    }
+
+    cursorOffset += doc->CountUTF16(cursorPosition, minPos);
+    cursorPosition = minPos;
+
+    return cursorOffset;
+}
+
+void QRegexSearch::invalidateWindow()
+{
+    matchPosition = -1;
+    window.clear();
+    windowStart = -1;
+    windowEnd = -1;
+    cursorPosition = -1;
+    cursorOffset = 0;
+}
+
+void QRegexSearch::NotifyModifyAttempt(Document *doc, void *userData)
+{
+    Q_UNUSED(doc);
+    Q_UNUSED(userData);
+}
+
+void QRegexSearch::NotifySavePoint(Document *doc, void *userData, bool atSavePoint)
+{
+    Q_UNUSED(doc);
+    Q_UNUSED(userData);
+    Q_UNUSED(atSavePoint);
+}
+
+void QRegexSearch::NotifyModified(Document *doc, DocModification mh, void *userData)
 {
     Q_UNUSED(doc);
+    Q_UNUSED(userData);
 
-    qInfo(Q_FUNC_INFO);
+    if (FlagSet(mh.modificationType, ModificationFlags::InsertText) || FlagSet(mh.modificationType, ModificationFlags::DeleteText)) {
+        invalidateWindow();
+    }
+}
+
+void QRegexSearch::NotifyDeleted(Document *doc, void *userData) noexcept
+{
+    Q_UNUSED(doc);
+    Q_UNUSED(userData);
+
+    // The document owns this object, so it is about to go away too
+    watchedDocument = Q_NULLPTR;
+}
+
+void QRegexSearch::NotifyStyleNeeded(Document *doc, void *userData, Sci::Position endPos)
+{
+    Q_UNUSED(doc);
+    Q_UNUSED(userData);
+    Q_UNUSED(endPos);
+}
+
+void QRegexSearch::NotifyErrorOccurred(Document *doc, void *userData, Scintilla::Status status)
+{
+    Q_UNUSED(doc);
+    Q_UNUSED(userData);
+    Q_UNUSED(status);
+}
+
+const char *QRegexSearch::SubstituteByPosition(Document *doc, const char *text, Sci::Position *length)
+{
+    qCDebug(lcSearch, Q_FUNC_INFO);
 
     Q_ASSERT(match.isValid());
     Q_ASSERT(match.hasMatch());
 
-    // Get the captured text and replace the match
-    QString newString = match.captured();
-    newString.replace(match.regularExpression(), QByteArray(text, *length));
+    const int groupCount = match.regularExpression().captureCount();
 
-    // TODO: figure out why this has to be new'd and can't be an instantiated class member
-    if (substituted) {
-        delete substituted;
+    if (replacementGroupCount != groupCount || replacementText.size() != *length || std::memcmp(replacementText.constData(), text, *length) != 0) {
+        parseReplacement(text, *length, groupCount);
     }
 
-    substituted = new QByteArray(newString.toUtf8());
-    *length = substituted->length();
-    return substituted->data();
+    // The groups are copied straight out of their match, nothing gets searched for again
+    substituted.clear();
+
+    for (const ReplacementPart &part : replacementParts) {
+        if (part.group == 0) {
+            substituted.append(replacementText.constData() + part.start, part.length);
+        }
+        else {
+            appendGroup(doc, part.group);
+        }
+    }
+
+    *length = static_cast<Sci::Position>(substituted.size());
+    return substituted.c_str();
+}
+
+void QRegexSearch::parseReplacement(const char *text, Sci::Position length, int groupCount)
+{
+    replacementText = QByteArray(text, length);
+    replacementGroupCount = groupCount;
+    replacementParts.clear();
+
+    Sci::Position literalStart = 0;
+
+    auto endLiteral = [&](Sci::Position end) {
+        if (end > literalStart) {
+            replacementParts.push_back({0, literalStart, end - literalStart});
+        }
+    };
+
+    // Back references are \1 to \99 where there are that many groups, the same as QString::replace() used to do
+    for (Sci::Position i = 0; i + 1 < length; ++i) {
+        if (text[i] != '\\' || text[i + 1] < '1' || text[i + 1] > '9') {
+            continue;
+        }
+
+        int group = text[i + 1] - '0';
+        int used = 2;
+
+        if (group > groupCount) {
+            continue;
+        }
+
+        if (i + 2 < length && text[i + 2] >= '0' && text[i + 2] <= '9') {
+            const int twoDigits = group * 10 + (text[i + 2] - '0');
+
+            if (twoDigits <= groupCount) {
+                group = twoDigits;
+                used = 3;
+            }
+        }
+
+        endLiteral(i);
+        replacementParts.push_back({group, 0, 0});
+
+        i += used - 1;
+        literalStart = i + 1;
+    }
+
+    endLiteral(length);
+}
+
+void QRegexSearch::appendGroup(Document *doc, int group)
+{
+    if (match.capturedStart(group) < 0 || match.capturedLength(group) == 0) {
+        return;
+    }
+
+    // As long as the document hasn't changed since the match, the bytes can be taken from it as they are
+    if (windowStart >= 0 && matchPosition >= 0) {
+        const Sci::Position start = doc->GetRelativePositionUTF16(matchPosition, match.capturedStart(group) - match.capturedStart(0));
+        const Sci::Position end = doc->GetRelativePositionUTF16(start, match.capturedLength(group));
+
+        if (start >= 0 && end > start) {
+            substituted.append(doc->RangePointer(start, end - start), end - start);
+            return;
+        }
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QByteArray utf8 = match.capturedView(group).toUtf8();
+#else
+    const QByteArray utf8 = match.capturedRef(group).toUtf8();
+#endif
+    substituted.append(utf8.constData(), utf8.size());
 }
@@ -20,6 +20,8 @@
 #ifndef QREGEXSEARCH_H
 #define QREGEXSEARCH_H
 
+#include <QHash>
+#include <QRegularExpression>
 #include <QRegularExpressionMatch>
 
 #include <vector>
@@ -85,7 +87,7 @@
 
 using namespace Scintilla::Internal;
 
-class QRegexSearch : public RegexSearchBase
+class QRegexSearch : public RegexSearchBase, public DocWatcher
 {
 public:
     QRegexSearch();
@@ -93,9 +95,49 @@ public:
     Sci::Position FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s, bool caseSensitive, bool word, bool wordStart, Scintilla::FindOption flags, Sci::Position *length) override;
     const char *SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) override;
 
+    // DocWatcher, only used to know when the decoded window is stale
+    void NotifyModifyAttempt(Document *doc, void *userData) override;
+    void NotifySavePoint(Document *doc, void *userData, bool atSavePoint) override;
+    void NotifyModified(Document *doc, DocModification mh, void *userData) override;
+    void NotifyDeleted(Document *doc, void *userData) noexcept override;
+    void NotifyStyleNeeded(Document *doc, void *userData, Sci::Position endPos) override;
+    void NotifyErrorOccurred(Document *doc, void *userData, Scintilla::Status status) override;
+
 private:
+    const QRegularExpression &compiledExpression(const char *s, QRegularExpression::PatternOptions options);
+    Sci::Position findBackward(Document *doc, const QRegularExpression &re, Sci::Position rangeStart, Sci::Position rangeEnd, Sci::Position *length);
+    qsizetype windowOffsetOf(Document *doc, Sci::Position minPos, Sci::Position maxPos);
+    void invalidateWindow();
+    void parseReplacement(const char *text, Sci::Position length, int groupCount);
+    void appendGroup(Document *doc, int group);
+
     QRegularExpressionMatch match;
-    QByteArray *substituted = Q_NULLPTR;
+    Sci::Position matchPosition = -1; // where the match starts in the document, while the window is still valid
+
+    // The replacement split into literal bytes and back references, so it is only looked through once no matter how
+    // many times it gets substituted. A part with a group of 0 is literal text from the replacement.
+    struct ReplacementPart {
+        int group;
+        Sci::Position start;
+        Sci::Position length;
+    };
+    QByteArray replacementText;
+    int replacementGroupCount = -1;
+    std::vector<ReplacementPart> replacementParts;
+    std::string substituted;
+
+    // Compiled expressions keyed on the pattern and the options it was compiled with
+    QHash<QPair<QByteArray, int>, QRegularExpression> expressionCache;
+
+    // The UTF16 version of the bytes [windowStart, windowEnd) so repeated searches do not re-decode the document
+    Document *watchedDocument = Q_NULLPTR;
+    QString window;
+    Sci::Position windowStart = -1;
+    Sci::Position windowEnd = -1;
+
+    // The last known mapping of a byte position to its UTF16 offset within the window
+    Sci::Position cursorPosition = -1;
+    qsizetype cursorOffset = 0;
 };
 
 #endif // QREGEXSEARCH_H
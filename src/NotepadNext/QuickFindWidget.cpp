@@ -17,16 +17,44 @@
  */
 
 
+#include "BackgroundSearcher.h"
+#include "BufferSearcher.h"
 #include "FocusWatcher.h"
 #include "QuickFindWidget.h"
 #include "ScintillaNext.h"
 #include "FadingIndicator.h"
+#include "MatchIndex.h"
+#include "Logging.h"
 #include "ui_QuickFindWidget.h"
 
+#include <QCoreApplication>
 #include <QKeyEvent>
 #include <QLineEdit>
+#include <QPointer>
 #include <QShortcut>
 #include <QScrollBar>
+#include <QThreadPool>
+
+
+// Documents up to this size are searched straight away, anything bigger is searched in the background
+const Sci_Position SYNCHRONOUS_SEARCH_LIMIT = 1024 * 1024;
+
+// How long typing has to pause before a large document is searched again from scratch
+const int SEARCH_DELAY_MS = 150;
+
+// Whether the pattern can overlap with itself, in which case a match of something longer could start inside
+// of a match that was skipped over by the last one and so won't be one of the previous matches
+static bool canOverlapItself(const QByteArray &pattern, bool matchCase)
+{
+    const QByteArray folded = matchCase ? pattern : BufferSearcher::foldLiteral(pattern);
+
+    for (qsizetype length = 1; length < folded.size(); ++length) {
+        if (folded.endsWith(folded.left(length)))
+            return true;
+    }
+
+    return false;
+}
 
 QuickFindWidget::QuickFindWidget(QWidget *parent) :
     QFrame(parent),
@@ -50,10 +78,16 @@ QuickFindWidget::QuickFindWidget(QWidget *parent) :
     connect(ui->buttonMatchCase, &QToolButton::toggled, this, &QuickFindWidget::performNewSearch);
     connect(ui->buttonWholeWord, &QToolButton::toggled, this, &QuickFindWidget::performNewSearch);
     connect(ui->buttonRegexp, &QToolButton::toggled, this, &QuickFindWidget::performNewSearch);
+
+    searchTimer.setSingleShot(true);
+    searchTimer.setInterval(SEARCH_DELAY_MS);
+    connect(&searchTimer, &QTimer::timeout, this, &QuickFindWidget::startBackgroundSearch);
 }
 
 QuickFindWidget::~QuickFindWidget()
 {
+    cancelBackgroundSearch();
+
     if (finder) {
         delete finder;
     }
@@ -71,6 +105,10 @@ void QuickFindWidget::setEditor(ScintillaNext *editor)
 
     this->editor = editor;
 
+    cancelBackgroundSearch();
+    snapshot.reset();
+    hasMatchedSearch = false;
+
     if (finder == Q_NULLPTR) {
         finder = new Finder(editor);
         finder->setWrap(true); // Always wrap the search
@@ -91,6 +129,8 @@ bool QuickFindWidget::eventFilter(QObject *obj, QEvent *event)
 
         // Use escape key to close the quick find widget
         if (keyEvent->key() == Qt::Key_Escape) {
+            cancelBackgroundSearch();
+            snapshot.reset();
             clearHighlights();
             clearCachedMatches();
             hide();
@@ -113,41 +153,166 @@ void QuickFindWidget::setSearchContextColorGood()
 
 void QuickFindWidget::performNewSearch()
 {
-    clearHighlights();
+    cancelBackgroundSearch();
     clearCachedMatches();
     ui->lblInfo->hide();
 
+    const QString text = searchText();
+    const int flags = computeSearchFlags();
+
     // Early out
-    if (searchText().isEmpty()) {
+    if (text.isEmpty()) {
+        clearHighlights();
         setSearchContextColorGood();
         return;
     }
 
+    // Typing more of the same literal can only ever remove matches
+    if (canRefineMatches(text, flags)) {
+        refineMatches(text, flags);
+        return;
+    }
+
+    clearHighlights();
+
+    if (editor->length() > SYNCHRONOUS_SEARCH_LIMIT && BackgroundSearcher::canSearch(text.toUtf8(), flags)) {
+        searchTimer.start();
+        return;
+    }
+
     prepareSearch();
-    finder->forEachMatch([&](int start, int end) {
-        matches.append(qMakePair(start, end));
-        return qMax(start + 1, end);
+    showMatches(text, flags, finder->findAll());
+}
+
+bool QuickFindWidget::canRefineMatches(const QString &text, int flags) const
+{
+    if (!hasMatchedSearch || matchedGeneration != editor->changeGeneration() || matchedFlags != flags)
+        return false;
+
+    // A longer whole word isn't found where the shorter one was
+    if (flags & (SCFIND_REGEXP | SCFIND_WHOLEWORD))
+        return false;
+
+    if (text.length() <= matchedText.length() || !text.startsWith(matchedText))
+        return false;
+
+    return BufferSearcher(text.toUtf8(), flags).canSearch() && !canOverlapItself(matchedText.toUtf8(), flags & SCFIND_MATCHCASE);
+}
+
+void QuickFindWidget::refineMatches(const QString &text, int flags)
+{
+    const QByteArray pattern = text.toUtf8();
+    BufferSearcher searcher(pattern, flags);
+    searcher.setCharacterClasses(editor->wordChars(), editor->whitespaceChars());
+
+    const char *data = reinterpret_cast<const char *>(editor->characterPointer());
+    const qsizetype length = editor->length();
+
+    std::vector<Sci_CharacterRange> refined;
+
+    // Only check if the longer text is at the start of each of the previous matches
+    for (const Sci_CharacterRange &match : matches()) {
+        const qsizetype end = qMin<qsizetype>(length, match.cpMin + pattern.size());
+
+        searcher.forEachMatch(data, length, match.cpMin, end, [&](qsizetype start, qsizetype matchEnd) {
+            refined.push_back({static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(matchEnd)});
+            return false;
+        });
+    }
+
+    showMatches(text, flags, refined);
+}
+
+void QuickFindWidget::startBackgroundSearch()
+{
+    cancelBackgroundSearch();
+
+    if (snapshot == Q_NULLPTR || snapshotGeneration != editor->changeGeneration()) {
+        snapshot = editor->textSnapshot();
+        snapshotGeneration = editor->changeGeneration();
+    }
+
+    const QString text = searchText();
+    const int flags = computeSearchFlags();
+    const QByteArray wordChars = editor->wordChars();
+    const QByteArray whitespaceChars = editor->whitespaceChars();
+    const std::shared_ptr<const QByteArray> data = snapshot;
+    const quint64 generation = snapshotGeneration;
+    const QPointer<ScintillaNext> searchedEditor = editor;
+
+    QPointer<QuickFindWidget> self = this;
+    std::shared_ptr<std::atomic_bool> canceled = std::make_shared<std::atomic_bool>(false);
+    searchCanceled = canceled;
+
+    QThreadPool::globalInstance()->start([=]() {
+        BufferSearcher searcher(text.toUtf8(), flags);
+        searcher.setCharacterClasses(wordChars, whitespaceChars);
+
+        std::vector<Sci_CharacterRange> ranges;
+
+        searcher.forEachMatch(data->constData(), data->size(), 0, data->size(), [&](qsizetype start, qsizetype end) {
+            ranges.push_back({static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(end)});
+            return !*canceled;
+        });
+
+        if (*canceled)
+            return;
+
+        // Posted through the application object since the widget may be deleted at any point
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self || *canceled || self->editor != searchedEditor)
+                return;
+
+            if (self->editor->changeGeneration() != generation) {
+                // The text changed while it was being searched
+                self->searchTimer.start();
+                return;
+            }
+
+            self->searchCanceled.reset();
+            self->showMatches(text, flags, ranges);
+        }, Qt::QueuedConnection);
     });
+}
 
-    if (matches.empty()) {
+void QuickFindWidget::cancelBackgroundSearch()
+{
+    searchTimer.stop();
+
+    if (searchCanceled) {
+        *searchCanceled = true;
+        searchCanceled.reset();
+    }
+}
+
+void QuickFindWidget::showMatches(const QString &text, int flags, const std::vector<Sci_CharacterRange> &ranges)
+{
+    // There can be millions of matches, only the ones that can be seen are filled in straight away
+    matchIndex()->setMatches(indicator, ranges, true);
+
+    matchedText = text;
+    matchedFlags = flags;
+    matchedGeneration = editor->changeGeneration();
+    hasMatchedSearch = true;
+
+    if (matches().empty()) {
         setSearchContextColorBad();
     }
     else {
         setSearchContextColorGood();
     }
 
-    highlightMatches();
     navigateToNextMatch(false);
 }
 
-void QuickFindWidget::highlightMatches()
+MatchIndex *QuickFindWidget::matchIndex() const
 {
-    qInfo(Q_FUNC_INFO);
+    return MatchIndex::forEditor(editor);
+}
 
-    editor->setIndicatorCurrent(indicator);
-    for (const auto &range : matches) {
-        editor->indicatorFillRange(range.first, range.second - range.first);
-    }
+const std::vector<Sci_CharacterRange> &QuickFindWidget::matches() const
+{
+    return matchIndex()->matches(indicator);
 }
 
 void QuickFindWidget::showWrapIndicator()
@@ -157,17 +322,19 @@ void QuickFindWidget::showWrapIndicator()
 
 void QuickFindWidget::navigateToNextMatch(bool skipCurrent)
 {
-    qInfo(Q_FUNC_INFO);
+    qCDebug(lcSearch, Q_FUNC_INFO);
+
+    const std::vector<Sci_CharacterRange> &matches = this->matches();
 
     // Early out if there are no matches
-    if (matches.length() == 0) {
+    if (matches.empty()) {
         ui->lblInfo->hide();
         return;
     }
 
     if (currentMatchIndex != -1) {
         currentMatchIndex++;
-        if (currentMatchIndex >= matches.length()) {
+        if (currentMatchIndex >= static_cast<qsizetype>(matches.size())) {
             currentMatchIndex = 0;
         }
     }
@@ -180,12 +347,10 @@ void QuickFindWidget::navigateToNextMatch(bool skipCurrent)
             startPos = editor->selectionStart();
         }
 
-        auto it = std::lower_bound(matches.begin(), matches.end(), startPos, [](const QPair<int, int>& pair, int value) {
-            return pair.first < value;
-        });
+        const size_t index = matchIndex()->lowerBound(indicator, startPos);
 
-        if (it != matches.end()) {
-            currentMatchIndex = std::distance(matches.begin(), it);
+        if (index < matches.size()) {
+            currentMatchIndex = static_cast<qsizetype>(index);
         } else {
             // Wrap back around
             currentMatchIndex = 0;
@@ -202,18 +367,21 @@ void QuickFindWidget::navigateToNextMatch(bool skipCurrent)
 
 void QuickFindWidget::navigateToPrevMatch()
 {
-    qInfo(Q_FUNC_INFO);
+    qCDebug(lcSearch, Q_FUNC_INFO);
+
+    const std::vector<Sci_CharacterRange> &matches = this->matches();
 
     // Early out if there are no matches
-    if (matches.length() == 0) {
+    if (matches.empty()) {
         ui->lblInfo->hide();
         return;
     }
 
     if (currentMatchIndex != -1) {
         currentMatchIndex--;
-        if (currentMatchIndex < 0) {
-            currentMatchIndex = matches.length() - 1;
+        // Edits can have removed matches since the last time
+        if (currentMatchIndex < 0 || currentMatchIndex >= static_cast<qsizetype>(matches.size())) {
+            currentMatchIndex = matches.size() - 1;
         }
     }
     else {
@@ -222,7 +390,7 @@ void QuickFindWidget::navigateToPrevMatch()
     }
 
     // Search wrapped around
-    if (currentMatchIndex == matches.length() - 1) {
+    if (currentMatchIndex == static_cast<qsizetype>(matches.size()) - 1) {
         showWrapIndicator();
     }
 
@@ -231,11 +399,13 @@ void QuickFindWidget::navigateToPrevMatch()
 
 void QuickFindWidget::goToCurrentMatch()
 {
-    editor->setSel(matches[currentMatchIndex].first, matches[currentMatchIndex].second);
+    const std::vector<Sci_CharacterRange> &matches = this->matches();
+
+    editor->setSel(matches[currentMatchIndex].cpMin, matches[currentMatchIndex].cpMax);
     editor->verticalCentreCaret();
 
     ui->lblInfo->show();
-    ui->lblInfo->setText(tr("%L1/%L2").arg(currentMatchIndex + 1).arg(matches.length()));
+    ui->lblInfo->setText(tr("%L1/%L2").arg(currentMatchIndex + 1).arg(matches.size()));
 }
 
 int QuickFindWidget::computeSearchFlags() const
@@ -271,6 +441,8 @@ void QuickFindWidget::initializeEditorIndicator()
     editor->indicSetOutlineAlpha(indicator, 150);
     editor->indicSetAlpha(indicator, 50);
     editor->indicSetUnder(indicator, true);
+
+    matchIndex()->setRangeSource(indicator);
 }
 
 QString QuickFindWidget::searchText() const
@@ -307,6 +479,8 @@ void QuickFindWidget::focusIn()
 
 void QuickFindWidget::focusOut()
 {
+    cancelBackgroundSearch();
+    snapshot.reset();
     clearHighlights();
     clearCachedMatches();
     hide();
@@ -324,12 +498,11 @@ void QuickFindWidget::returnPressed()
 
 void QuickFindWidget::clearHighlights()
 {
-    editor->setIndicatorCurrent(indicator);
-    editor->indicatorClearRange(0, editor->length());
+    matchIndex()->clear(indicator);
+    hasMatchedSearch = false;
 }
 
 void QuickFindWidget::clearCachedMatches()
 {
-    matches.clear();
     currentMatchIndex = -1;
 }
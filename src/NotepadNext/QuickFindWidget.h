@@ -25,6 +25,10 @@
 #include <QKeyEvent>
 #include <QLineEdit>
 #include <QObject>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
 
 #include "Finder.h"
 #include "ScintillaNext.h"
@@ -33,6 +37,8 @@ namespace Ui {
 class QuickFindWidget;
 }
 
+class MatchIndex;
+
 
 class QuickFindWidget : public QFrame
 {
@@ -60,10 +66,17 @@ private slots:
     void returnPressed();
 
 private:
-    void highlightMatches();
+    MatchIndex *matchIndex() const;
+    const std::vector<Sci_CharacterRange> &matches() const;
     void clearHighlights();
     void clearCachedMatches();
 
+    bool canRefineMatches(const QString &text, int flags) const;
+    void refineMatches(const QString &text, int flags);
+    void startBackgroundSearch();
+    void cancelBackgroundSearch();
+    void showMatches(const QString &text, int flags, const std::vector<Sci_CharacterRange> &ranges);
+
     void prepareSearch();
     int computeSearchFlags() const;
 
@@ -81,8 +94,19 @@ private:
     Finder *finder = Q_NULLPTR;
     int indicator;
 
-    QList<QPair<int, int>> matches;
     qsizetype currentMatchIndex = -1;
+
+    // What the matches in the index were found with, so typing more of it only has to check those matches again
+    QString matchedText;
+    int matchedFlags = 0;
+    quint64 matchedGeneration = 0;
+    bool hasMatchedSearch = false;
+
+    // Full searches of large documents are done on a copy of the text, which is kept until the text changes
+    QTimer searchTimer;
+    std::shared_ptr<const QByteArray> snapshot;
+    quint64 snapshotGeneration = 0;
+    std::shared_ptr<std::atomic_bool> searchCanceled;
 };
 
 #endif // QUICKFINDWIDGET_H
@@ -19,6 +19,11 @@
 
 #include "RecentFilesListManager.h"
 
+
+// The list is short, so looking through it is never worth keeping an index alongside
+static const int MAX_RECENT_FILES = 10;
+
+
 RecentFilesListManager::RecentFilesListManager(QObject *parent) :
     QObject(parent)
 {
@@ -29,25 +34,60 @@ void RecentFilesListManager::addFile(const QString &filePath)
     qInfo(Q_FUNC_INFO);
 
     // Attempt to remove it first to make sure it is not added twice
-    removeFile(filePath);
+    recentFiles.removeOne(filePath);
 
     // Set a limit on how many can be in the list
-    if (recentFiles.size() >= 10) {
+    if (recentFiles.size() >= MAX_RECENT_FILES) {
         recentFiles.removeLast();
     }
 
     recentFiles.prepend(filePath);
+
+    emit fileListChanged();
+}
+
+void RecentFilesListManager::addFiles(const QStringList &filePaths)
+{
+    qInfo(Q_FUNC_INFO);
+
+    QStringList files;
+
+    for (auto it = filePaths.crbegin(); it != filePaths.crend() && files.size() < MAX_RECENT_FILES; ++it) {
+        if (!files.contains(*it)) {
+            files.append(*it);
+        }
+    }
+
+    for (const QString &filePath : qAsConst(recentFiles)) {
+        if (files.size() >= MAX_RECENT_FILES) {
+            break;
+        }
+
+        if (!files.contains(filePath)) {
+            files.append(filePath);
+        }
+    }
+
+    if (files != recentFiles) {
+        recentFiles = files;
+
+        emit fileListChanged();
+    }
 }
 
 void RecentFilesListManager::removeFile(const QString &filePath)
 {
-    recentFiles.removeOne(filePath);
+    if (recentFiles.removeOne(filePath)) {
+        emit fileListChanged();
+    }
 }
 
 void RecentFilesListManager::clear()
 {
     // Clear the file list
     recentFiles.clear();
+
+    emit fileListChanged();
 }
 
 QString RecentFilesListManager::mostRecentFile() const
@@ -64,6 +104,7 @@ QStringList RecentFilesListManager::fileList() const
 
 void RecentFilesListManager::setFileList(const QStringList &list)
 {
-    clear();
-    recentFiles.append(list);
+    recentFiles = list;
+
+    emit fileListChanged();
 }
@@ -38,9 +38,14 @@ public:
 
 public slots:
     void addFile(const QString &filePath);
+    // The same as adding each of them in turn, so the last one ends up the most recent
+    void addFiles(const QStringList &filePaths);
     void removeFile(const QString &filePath);
     void clear();
 
+signals:
+    void fileListChanged();
+
 private:
     QStringList recentFiles;
 };
@@ -20,31 +20,133 @@
 #include "RecentFilesListMenuBuilder.h"
 
 #include <QAction>
-#include <QMenu>
+#include <QCoreApplication>
 #include <QDir>
+#include <QFileInfo>
+#include <QMenu>
+#include <QPointer>
+#include <QThreadPool>
+
+
+// Looking for a file that hasn't finished by now is stuck on a drive that isn't answering
+static const int CHECK_TIMEOUT_MS = 2000;
+
+// Threads stuck on a hung drive stay stuck, so they come from a pool of their own rather than the global one
+static const int MAX_CHECK_THREADS = 2;
+
 
 RecentFilesListMenuBuilder::RecentFilesListMenuBuilder(RecentFilesListManager *manager) :
     QObject(manager),
-    manager(manager)
+    manager(manager),
+    checkPool(new QThreadPool(this))
 {
+    checkPool->setMaxThreadCount(MAX_CHECK_THREADS);
+
+    connect(manager, &RecentFilesListManager::fileListChanged, this, [=]() { actionsOutdated = true; });
 }
 
 void RecentFilesListMenuBuilder::populateMenu(QMenu *menu)
 {
+    if (actionsOutdated) {
+        rebuildActions();
+    }
+
+    if (!actions.isEmpty() && !menu->actions().contains(actions.first())) {
+        menu->setToolTipsVisible(true);
+        menu->addActions(actions);
+    }
+
+    checkFiles();
+}
+
+void RecentFilesListMenuBuilder::rebuildActions()
+{
+    // Deleting them takes them out of the menu as well
+    qDeleteAll(actions);
+    actions.clear();
+
+    const QStringList files = manager->fileList();
     int i = 0;
 
-    QList<QAction *> recentFileListActions;
-    for (const QString &file : manager->fileList()) {
+    for (const QString &file : files) {
         ++i;
-        QAction *action = new QAction(QString("%1%2: %3").arg(i < 10 ? "&" : "").arg(i).arg(QDir::toNativeSeparators(file)), menu);
+        QAction *action = new QAction(QString("%1%2: %3").arg(i < 10 ? "&" : "").arg(i).arg(QDir::toNativeSeparators(file)), this);
 
         action->setData(file);
         connect(action, &QAction::triggered, this, &RecentFilesListMenuBuilder::recentFileActionTriggered);
 
-        recentFileListActions.append(action);
+        updateAction(action);
+        actions.append(action);
     }
 
-    menu->addActions(recentFileListActions);
+    // Forget about files that have dropped off the list
+    for (auto it = fileExists.begin(); it != fileExists.end();) {
+        if (files.contains(it.key()))
+            ++it;
+        else
+            it = fileExists.erase(it);
+    }
+
+    actionsOutdated = false;
+}
+
+void RecentFilesListMenuBuilder::checkFiles()
+{
+    QPointer<RecentFilesListMenuBuilder> self(this);
+
+    for (QAction *action : qAsConst(actions)) {
+        const QString filePath = action->data().toString();
+
+        // Asking a drive that is already stuck again would only tie up another thread
+        if (checking.contains(filePath)) {
+            updateAction(action);
+            continue;
+        }
+
+        checking[filePath].start();
+
+        checkPool->start([=]() {
+            const bool exists = QFileInfo::exists(filePath);
+
+            // Posted through the application object since the builder may be deleted at any point
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    self->fileChecked(filePath, exists);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void RecentFilesListMenuBuilder::fileChecked(const QString &filePath, bool exists)
+{
+    checking.remove(filePath);
+    fileExists.insert(filePath, exists);
+
+    for (QAction *action : qAsConst(actions)) {
+        if (action->data().toString() == filePath) {
+            updateAction(action);
+        }
+    }
+}
+
+void RecentFilesListMenuBuilder::updateAction(QAction *action)
+{
+    const QString filePath = action->data().toString();
+    const auto check = checking.constFind(filePath);
+
+    // Until it is known otherwise the file is assumed to still be there
+    action->setEnabled(fileExists.value(filePath, true));
+
+    if (check != checking.constEnd() && check->hasExpired(CHECK_TIMEOUT_MS)) {
+        action->setToolTip(tr("The drive this file is on isn't answering"));
+    }
+    else if (!action->isEnabled()) {
+        action->setToolTip(tr("This file no longer exists"));
+    }
+    else {
+        action->setToolTip(QString());
+    }
 }
 
 void RecentFilesListMenuBuilder::recentFileActionTriggered()
@@ -21,16 +21,26 @@
 #define RECENTFILESLISTMENUBUILDER_H
 
 #include "RecentFilesListManager.h"
+
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 
+class QAction;
 class QMenu;
+class QThreadPool;
 
+// Makes the actions for the recent files menu. They are kept until the list changes, and whether each file is still
+// there is looked up on a worker thread every time the menu is shown. A missing file is greyed out once its answer
+// comes back, so a network drive that isn't answering never holds up opening the menu.
 class RecentFilesListMenuBuilder : public QObject
 {
     Q_OBJECT
 
 public:
     explicit RecentFilesListMenuBuilder(RecentFilesListManager *manager);
+
+    // Adds the actions to the end of the menu unless they are already there
     void populateMenu(QMenu *menu);
 
 signals:
@@ -40,7 +50,21 @@ private slots:
     void recentFileActionTriggered();
 
 private:
+    void rebuildActions();
+    void checkFiles();
+    void fileChecked(const QString &filePath, bool exists);
+    void updateAction(QAction *action);
+
     RecentFilesListManager *manager;
+
+    QList<QAction *> actions;
+    bool actionsOutdated = true;
+
+    QThreadPool *checkPool;
+
+    // What the last look for each file found, and how long the ones still being looked for have taken
+    QHash<QString, bool> fileExists;
+    QHash<QString, QElapsedTimer> checking;
 };
 
 #endif // RECENTFILESLISTMENUBUILDER_H
@@ -0,0 +1,128 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "RegexEngine.h"
+#include "QRegexSearch.h"
+#include "Logging.h"
+
+#ifdef HAVE_PCRE2
+#include "Pcre2RegexSearch.h"
+#endif
+
+#include <atomic>
+
+using namespace Scintilla;
+
+
+static std::atomic_int currentEngine{RegexEngine::QtRegularExpression};
+
+void RegexEngine::setEngine(int engine)
+{
+    currentEngine = isAvailable(static_cast<Engine>(engine)) ? engine : QtRegularExpression;
+}
+
+RegexEngine::Engine RegexEngine::engine()
+{
+    return static_cast<Engine>(currentEngine.load());
+}
+
+bool RegexEngine::isAvailable(Engine engine)
+{
+    switch (engine) {
+    case QtRegularExpression:
+        return true;
+    case Pcre2:
+#ifdef HAVE_PCRE2
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+QByteArray RegexEngine::substitute(intptr_t document, const QByteArray &replacement)
+{
+    Document *doc = static_cast<Document *>(reinterpret_cast<IDocumentEditable *>(document));
+    Sci::Position length = replacement.size();
+
+    const char *text = doc->SubstituteByPosition(replacement.constData(), &length);
+
+    return text ? QByteArray(text, static_cast<int>(length)) : QByteArray();
+}
+
+// Each document gets one of these. The engines are only created once they are first used, and the
+// substitution is done by whichever engine found the last match.
+class SelectableRegexSearch : public RegexSearchBase
+{
+public:
+    Sci::Position FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s, bool caseSensitive, bool word, bool wordStart, FindOption flags, Sci::Position *length) override
+    {
+        lastUsed = current();
+
+        return lastUsed->FindText(doc, minPos, maxPos, s, caseSensitive, word, wordStart, flags, length);
+    }
+
+    const char *SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) override
+    {
+        if (lastUsed == Q_NULLPTR) {
+            lastUsed = current();
+        }
+
+        return lastUsed->SubstituteByPosition(doc, text, length);
+    }
+
+private:
+    RegexSearchBase *current()
+    {
+#ifdef HAVE_PCRE2
+        if (RegexEngine::engine() == RegexEngine::Pcre2) {
+            if (!pcre2) {
+                pcre2 = std::make_unique<Pcre2RegexSearch>();
+            }
+
+            return pcre2.get();
+        }
+#endif
+
+        if (!qt) {
+            qt = std::make_unique<QRegexSearch>();
+        }
+
+        return qt.get();
+    }
+
+    std::unique_ptr<QRegexSearch> qt;
+#ifdef HAVE_PCRE2
+    std::unique_ptr<Pcre2RegexSearch> pcre2;
+#endif
+    RegexSearchBase *lastUsed = Q_NULLPTR;
+};
+
+#ifdef SCI_OWNREGEX
+RegexSearchBase *Scintilla::Internal::CreateRegexSearch(CharClassify *charClassTable)
+{
+    Q_UNUSED(charClassTable);
+
+    qCDebug(lcSearch, Q_FUNC_INFO);
+
+    return new SelectableRegexSearch();
+}
+#endif
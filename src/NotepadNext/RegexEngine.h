@@ -0,0 +1,47 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REGEXENGINE_H
+#define REGEXENGINE_H
+
+#include <QByteArray>
+
+#include <cstdint>
+
+// Which engine Scintilla's regular expression searches are done with. It can be changed at any time, the
+// next search picks it up. Unavailable engines fall back to QRegularExpression.
+namespace RegexEngine
+{
+    enum Engine {
+        QtRegularExpression = 0,
+        Pcre2 = 1,
+    };
+
+    void setEngine(int engine);
+    Engine engine();
+
+    // PCRE2 is only there if it was found when building
+    bool isAvailable(Engine engine);
+
+    // What replacing the last match found in a document would put there, with its back references filled in. Nothing
+    // is changed, so every match can be worked out before the document is. The document is from SCI_GETDOCPOINTER.
+    QByteArray substitute(intptr_t document, const QByteArray &replacement);
+}
+
+#endif // REGEXENGINE_H
@@ -0,0 +1,396 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "RemoteFile.h"
+
+#include <QDir>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
+
+#include <cstring>
+
+
+// Requests that are sent at once, more than this only slows each of them down
+const int MAX_REQUESTS = 4;
+
+// Anything asked for longer ago than this many blocks is dropped, it has most likely been scrolled past
+const int MAX_QUEUED_BLOCKS = 64;
+
+// How often a followed file is asked for what was added to it, and the most that is taken in one go
+const int POLL_INTERVAL_MS = 2000;
+const qint64 POLL_LIMIT = 16 * RemoteFile::BLOCK_SIZE;
+
+// The cache file is mapped this much bigger than the file so a followed file can grow without mapping it again
+const qint64 GROWTH_HEADROOM = 64 * RemoteFile::BLOCK_SIZE;
+
+static qint64 blockCount(qint64 length)
+{
+    return (length + RemoteFile::BLOCK_SIZE - 1) / RemoteFile::BLOCK_SIZE;
+}
+
+// The total from a "bytes 0-99/1234" or "bytes */1234" Content-Range header, -1 if it isn't given
+static qint64 contentRangeTotal(const QNetworkReply *reply)
+{
+    const QByteArray range = reply->rawHeader("Content-Range");
+    const int slash = range.lastIndexOf('/');
+    bool ok = false;
+    const qint64 total = slash >= 0 ? range.mid(slash + 1).trimmed().toLongLong(&ok) : -1;
+
+    return ok ? total : -1;
+}
+
+RemoteFile::RemoteFile(const QUrl &url, QObject *parent) :
+    QObject(parent),
+    remoteUrl(url),
+    network(new QNetworkAccessManager(this)),
+    pollTimer(new QTimer(this)),
+    cache(Q_NULLPTR)
+{
+    pollTimer->setInterval(POLL_INTERVAL_MS);
+    connect(pollTimer, &QTimer::timeout, this, &RemoteFile::poll);
+}
+
+RemoteFile::~RemoteFile()
+{
+    // Nothing can be waiting since whoever waits holds on to this
+    delete cache;
+}
+
+void RemoteFile::open()
+{
+    qInfo(Q_FUNC_INFO);
+
+    QNetworkRequest request(remoteUrl);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setRawHeader("Accept-Encoding", "identity");
+
+    QNetworkReply *reply = network->head(request);
+    connect(reply, &QNetworkReply::finished, this, [=]() { headFinished(reply); });
+}
+
+qint64 RemoteFile::size() const
+{
+    QMutexLocker locker(&mutex);
+    return fileSize;
+}
+
+const char *RemoteFile::data() const
+{
+    QMutexLocker locker(&mutex);
+    return mapped;
+}
+
+bool RemoteFile::isCached(qint64 offset, qint64 length) const
+{
+    QMutexLocker locker(&mutex);
+    return isCachedLocked(offset, length);
+}
+
+bool RemoteFile::isCachedLocked(qint64 offset, qint64 length) const
+{
+    const qint64 start = qMax<qint64>(0, offset);
+    const qint64 end = qMin(fileSize, offset + length);
+
+    for (qint64 block = start / BLOCK_SIZE; block * BLOCK_SIZE < end; ++block) {
+        if (!cached[block])
+            return false;
+    }
+
+    return true;
+}
+
+void RemoteFile::fetch(qint64 offset, qint64 length)
+{
+    const qint64 start = qMax<qint64>(0, offset);
+    const qint64 end = qMin(size(), offset + length);
+    QList<qint64> blocks;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        for (qint64 block = start / BLOCK_SIZE; block * BLOCK_SIZE < end; ++block) {
+            if (!cached[block] && !requested.contains(block)) {
+                blocks.append(block);
+                queued.removeOne(block);
+            }
+
+            // Asking again is how something that failed gets another try
+            failedBlocks.remove(block);
+        }
+    }
+
+    // What is being looked at now goes before anything asked for earlier
+    queued = blocks + queued;
+    while (queued.size() > MAX_QUEUED_BLOCKS)
+        queued.removeLast();
+
+    startRequests();
+}
+
+bool RemoteFile::waitFor(qint64 offset, qint64 length, const std::atomic_bool &canceled)
+{
+    Q_ASSERT(thread() != QThread::currentThread());
+
+    QMutexLocker locker(&mutex);
+
+    while (!canceled) {
+        if (isCachedLocked(offset, length))
+            return true;
+
+        for (qint64 block = qMax<qint64>(0, offset) / BLOCK_SIZE; block * BLOCK_SIZE < qMin(fileSize, offset + length); ++block) {
+            if (failedBlocks.contains(block))
+                return false;
+        }
+
+        // Asked again each time round since the blocks may have been dropped from the queue for newer ones
+        QMetaObject::invokeMethod(this, [=]() { fetch(offset, length); }, Qt::QueuedConnection);
+        blockArrived.wait(&mutex, 250);
+    }
+
+    return false;
+}
+
+void RemoteFile::setFollowing(bool follow)
+{
+    if (follow)
+        pollTimer->start();
+    else
+        pollTimer->stop();
+}
+
+bool RemoteFile::isFollowing() const
+{
+    return pollTimer->isActive();
+}
+
+QNetworkReply *RemoteFile::get(qint64 first, qint64 last)
+{
+    QNetworkRequest request(remoteUrl);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    // A compressed reply would be decompressed by Qt, and then the offsets wouldn't mean anything
+    request.setRawHeader("Accept-Encoding", "identity");
+    request.setRawHeader("Range", QStringLiteral("bytes=%1-%2").arg(first).arg(last).toLatin1());
+
+    return network->get(request);
+}
+
+void RemoteFile::headFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        emit opened(false);
+        return;
+    }
+
+    const QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+    if (!length.isValid()) {
+        fail(tr("The server did not say how big the file is"));
+        emit opened(false);
+        return;
+    }
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/remote");
+    QDir().mkpath(cacheDir);
+
+    cache = new QTemporaryFile(cacheDir + QStringLiteral("/XXXXXX.part"));
+
+    if (!cache->open() || !resize(length.toLongLong())) {
+        fail(tr("The cache file could not be created: %1").arg(cache->errorString()));
+        emit opened(false);
+        return;
+    }
+
+    qInfo("Opened %s, %lld bytes", qUtf8Printable(remoteUrl.toDisplayString()), fileSize);
+
+    emit opened(true);
+}
+
+bool RemoteFile::resize(qint64 newSize)
+{
+    QMutexLocker locker(&mutex);
+
+    if (newSize > capacity || mapped == Q_NULLPTR) {
+        const qint64 newCapacity = blockCount(newSize + GROWTH_HEADROOM) * BLOCK_SIZE;
+
+        // The file is sparse so the space that hasn't been fetched into doesn't take up any room on disk. The old
+        // mapping is left as it is, workers may still be reading from it.
+        if (!cache->resize(newCapacity))
+            return false;
+
+        char *newMapping = reinterpret_cast<char *>(cache->map(0, newCapacity));
+        if (newMapping == Q_NULLPTR)
+            return false;
+
+        mapped = newMapping;
+        capacity = newCapacity;
+        cached.resize(static_cast<size_t>(blockCount(newCapacity)), false);
+    }
+
+    fileSize = newSize;
+
+    return true;
+}
+
+void RemoteFile::startRequests()
+{
+    while (requested.size() < MAX_REQUESTS && !queued.isEmpty()) {
+        const qint64 block = queued.takeFirst();
+        const qint64 first = block * BLOCK_SIZE;
+        const qint64 last = qMin(size(), first + BLOCK_SIZE) - 1;
+
+        QNetworkReply *reply = get(first, last);
+        requested.insert(block);
+
+        // A server that ignores the range would send the whole file, so stop it before it does
+        connect(reply, &QNetworkReply::metaDataChanged, this, [=]() {
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200 && size() > BLOCK_SIZE)
+                reply->abort();
+        });
+        connect(reply, &QNetworkReply::finished, this, [=]() { blockFinished(reply, block); });
+    }
+}
+
+void RemoteFile::blockFinished(QNetworkReply *reply, qint64 block)
+{
+    reply->deleteLater();
+    requested.remove(block);
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const qint64 first = block * BLOCK_SIZE;
+
+    // A file that fits in one block may well come back whole, which is just as good
+    if (reply->error() == QNetworkReply::NoError && (status == 206 || (status == 200 && first == 0))) {
+        store(first, reply->readAll());
+    }
+    else {
+        {
+            QMutexLocker locker(&mutex);
+            failedBlocks.insert(block);
+        }
+        blockArrived.wakeAll();
+
+        fail(status == 200 ? tr("The server does not support reading part of a file") : reply->errorString());
+    }
+
+    startRequests();
+}
+
+void RemoteFile::store(qint64 offset, const QByteArray &bytes)
+{
+    qint64 end;
+
+    // Whatever went wrong before got better
+    error.clear();
+
+    {
+        QMutexLocker locker(&mutex);
+
+        end = qMin(fileSize, offset + bytes.size());
+        if (end <= offset)
+            return;
+
+        std::memcpy(mapped + offset, bytes.constData(), static_cast<size_t>(end - offset));
+
+        // A block only counts once all of it is there. What came before offset is only there if it was already.
+        for (qint64 block = offset / BLOCK_SIZE; block * BLOCK_SIZE < end; ++block) {
+            const qint64 blockStart = block * BLOCK_SIZE;
+            const qint64 blockEnd = qMin(fileSize, blockStart + BLOCK_SIZE);
+
+            if ((blockStart >= offset || cached[block]) && blockEnd <= end)
+                cached[block] = true;
+        }
+    }
+
+    blockArrived.wakeAll();
+
+    emit blocksFetched(offset, end - offset);
+}
+
+void RemoteFile::poll()
+{
+    // One at a time, the next one would only ask for the same bytes
+    if (pollReply || cache == Q_NULLPTR)
+        return;
+
+    const qint64 from = size();
+    pollReply = get(from, from + POLL_LIMIT - 1);
+
+    QNetworkReply *reply = pollReply;
+    connect(reply, &QNetworkReply::finished, this, [=]() { pollFinished(reply); });
+}
+
+void RemoteFile::pollFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+    pollReply = Q_NULLPTR;
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const qint64 total = contentRangeTotal(reply);
+    const qint64 oldSize = size();
+
+    if (status == 416) {
+        // Nothing past the end, unless the file got smaller
+        if (total >= 0 && total < oldSize) {
+            setFollowing(false);
+            fail(tr("The file got smaller, it has to be opened again"));
+        }
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError || status != 206) {
+        // Following is given up on, a moment's network trouble shouldn't be reported every couple of seconds
+        setFollowing(false);
+        fail(status == 200 ? tr("The server does not support reading part of a file") : reply->errorString());
+        return;
+    }
+
+    const QByteArray bytes = reply->readAll();
+    if (bytes.isEmpty())
+        return;
+
+    if (!resize(oldSize + bytes.size())) {
+        setFollowing(false);
+        fail(tr("The cache file could not be made bigger: %1").arg(cache->errorString()));
+        return;
+    }
+
+    store(oldSize, bytes);
+
+    emit grown(oldSize + bytes.size());
+
+    // There is more waiting than one request takes
+    if (total > oldSize + bytes.size())
+        poll();
+}
+
+void RemoteFile::fail(const QString &message)
+{
+    qWarning("%s: %s", qUtf8Printable(remoteUrl.toDisplayString()), qUtf8Printable(message));
+
+    error = message;
+    emit failed(message);
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QUrl>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <vector>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTemporaryFile;
+class QTimer;
+
+
+// A file on a web server that is read with HTTP range requests, so only the parts that are looked at are ever
+// transferred. Fetched blocks go into a sparse file in the cache directory that stays mapped, which means once a
+// range is cached it is read straight from memory like a local file. Everything but waitFor() is for the thread the
+// object lives in.
+class RemoteFile : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 BLOCK_SIZE = 1024 * 1024;
+
+    explicit RemoteFile(const QUrl &url, QObject *parent = Q_NULLPTR);
+    ~RemoteFile();
+
+    QUrl url() const { return remoteUrl; }
+    QString errorString() const { return error; }
+
+    // Asks the server how big the file is, opened() is sent once it is known
+    void open();
+
+    qint64 size() const;
+
+    // The cached copy, only the ranges isCached() is true for hold the file's bytes. A pointer that was handed out
+    // stays valid until this is destroyed, even after the file grows and the copy is mapped again.
+    const char *data() const;
+
+    bool isCached(qint64 offset, qint64 length) const;
+
+    // Fetches whatever of the range isn't cached yet, the most recently asked for first. blocksFetched() is sent as
+    // each one arrives.
+    void fetch(qint64 offset, qint64 length);
+
+    // For worker threads, waits until the range is cached. Returns false if it couldn't be fetched or was canceled.
+    bool waitFor(qint64 offset, qint64 length, const std::atomic_bool &canceled);
+
+    // Asks only for what comes after the end every so often, and grown() is sent when there is more
+    void setFollowing(bool follow);
+    bool isFollowing() const;
+
+signals:
+    void opened(bool success);
+    void blocksFetched(qint64 offset, qint64 length);
+    void grown(qint64 size);
+    void failed(const QString &error);
+
+private:
+    void headFinished(QNetworkReply *reply);
+    void blockFinished(QNetworkReply *reply, qint64 block);
+    void pollFinished(QNetworkReply *reply);
+    void poll();
+    void startRequests();
+    bool resize(qint64 newSize);
+    bool isCachedLocked(qint64 offset, qint64 length) const;
+    void store(qint64 offset, const QByteArray &bytes);
+    void fail(const QString &message);
+    QNetworkReply *get(qint64 first, qint64 last);
+
+    QUrl remoteUrl;
+    QString error;
+    QNetworkAccessManager *network;
+    QTimer *pollTimer;
+    QTemporaryFile *cache;
+    QNetworkReply *pollReply = Q_NULLPTR;
+
+    QList<qint64> queued; // blocks waiting for a request, the next one first
+    QSet<qint64> requested;
+
+    // Everything below is shared with waitFor()
+    mutable QMutex mutex;
+    QWaitCondition blockArrived;
+    qint64 fileSize = -1;
+    qint64 capacity = 0; // how much of the cache file is mapped, more than the file so it can grow into it
+    char *mapped = Q_NULLPTR;
+    std::vector<bool> cached; // by block
+    QSet<qint64> failedBlocks;
+};
@@ -0,0 +1,139 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ReplacePreview.h"
+#include "ISearchResultsHandler.h"
+
+
+static bool isContinuationByte(const char *data, qsizetype pos)
+{
+    return (static_cast<unsigned char>(data[pos]) & 0xC0) == 0x80;
+}
+
+// Line endings inside a hunk would break it over several rows, so they are shown with a symbol instead
+static QString displayText(const QByteArray &text)
+{
+    const QChar lineEnd(0x21B5);
+    QString display = QString::fromUtf8(text);
+
+    display.replace(QStringLiteral("\r\n"), QString(lineEnd));
+    display.replace(QLatin1Char('\r'), lineEnd);
+    display.replace(QLatin1Char('\n'), lineEnd);
+
+    return display;
+}
+
+void ReplacePreview::makeHunks(const char *data, qsizetype length)
+{
+    const int context = ISearchResultsHandler::LINE_TEXT_CONTEXT;
+    const int count = static_cast<int>(ranges.size());
+
+    int line = 0;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+
+    auto lineEndFrom = [&](qsizetype pos) {
+        while (pos < length && data[pos] != '\n' && data[pos] != '\r')
+            ++pos;
+
+        return pos;
+    };
+
+    hunks.clear();
+
+    for (int first = 0; first < count;) {
+        const qsizetype start = ranges[first].cpMin;
+
+        // Scintilla treats \n, \r\n, and \r as line endings
+        for (; scanned < start; ++scanned) {
+            const char c = data[scanned];
+
+            if (c == '\n' || (c == '\r' && (scanned + 1 >= length || data[scanned + 1] != '\n'))) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        // Anything that would show up in the same text as the match before it goes in the same hunk
+        qsizetype lineEnd = lineEndFrom(ranges[first].cpMax);
+        int last = first;
+
+        while (last + 1 < count && ranges[last + 1].cpMin <= lineEnd && ranges[last + 1].cpMin - ranges[last].cpMax <= 2 * context) {
+            ++last;
+            lineEnd = qMax(lineEnd, lineEndFrom(ranges[last].cpMax));
+        }
+
+        // Only show as much of the lines either side of the matches as the search results do
+        qsizetype textStart = qMax(lineStart, start - context);
+        while (textStart < start && isContinuationByte(data, textStart))
+            ++textStart;
+
+        qsizetype textEnd = qMin(lineEnd, static_cast<qsizetype>(ranges[last].cpMax) + context);
+        while (textEnd < lineEnd && textEnd > ranges[last].cpMax && isContinuationByte(data, textEnd))
+            --textEnd;
+
+        QByteArray before(data + textStart, static_cast<int>(textEnd - textStart));
+        QByteArray after;
+        qsizetype pos = textStart;
+
+        for (int i = first; i <= last; ++i) {
+            after.append(data + pos, static_cast<int>(ranges[i].cpMin - pos));
+            after.append(replacementAt(i));
+            pos = ranges[i].cpMax;
+        }
+        after.append(data + pos, static_cast<int>(textEnd - pos));
+
+        Hunk hunk{line, first, last - first + 1, displayText(before), displayText(after)};
+
+        if (textStart > lineStart) {
+            hunk.before.prepend(QStringLiteral("..."));
+            hunk.after.prepend(QStringLiteral("..."));
+        }
+        if (textEnd < lineEnd) {
+            hunk.before.append(QStringLiteral("..."));
+            hunk.after.append(QStringLiteral("..."));
+        }
+
+        hunks.append(hunk);
+        first = last + 1;
+    }
+}
+
+void ReplacePreview::acceptedReplacements(const std::vector<bool> &accepted, std::vector<Sci_CharacterRange> &acceptedRanges, QVector<QByteArray> &acceptedTexts) const
+{
+    acceptedRanges.clear();
+    acceptedTexts.clear();
+
+    for (int h = 0; h < hunks.size(); ++h) {
+        if (!accepted[h])
+            continue;
+
+        const Hunk &hunk = hunks.at(h);
+
+        for (int i = hunk.firstMatch; i < hunk.firstMatch + hunk.matchCount; ++i) {
+            acceptedRanges.push_back(ranges[i]);
+
+            if (replacements.size() > 1)
+                acceptedTexts.append(replacements.at(i));
+        }
+    }
+
+    if (replacements.size() == 1 && !acceptedRanges.empty())
+        acceptedTexts.append(replacements.first());
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+#include "Scintilla.h"
+
+
+// Everything Replace All would change in one document, worked out from a copy of its text without changing it.
+// The matches are grouped into hunks, each showing a line before and after its replacements so they can be
+// accepted or rejected on their own. Hunks are made on the worker thread that found the matches.
+struct ReplacePreview
+{
+    struct Hunk
+    {
+        int lineNumber;
+        int firstMatch;
+        int matchCount;
+        QString before;
+        QString after;
+    };
+
+    // Same as BackgroundSearcher::replacementsFound(), a single replacement is used for every match
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+    QVector<Hunk> hunks;
+
+    // What the text was when it was previewed, an editor's change generation or a file's modified time and size
+    quint64 changeGeneration = 0;
+    qint64 lastModified = 0;
+    qint64 size = 0;
+
+    const QByteArray &replacementAt(int match) const { return replacements.size() == 1 ? replacements.first() : replacements.at(match); }
+
+    // Groups the matches that are close enough together on the same lines to be read as one change
+    void makeHunks(const char *data, qsizetype length);
+
+    // Only the matches of the accepted hunks, ready for ScintillaNext::replaceRanges()
+    void acceptedReplacements(const std::vector<bool> &accepted, std::vector<Sci_CharacterRange> &acceptedRanges, QVector<QByteArray> &acceptedTexts) const;
+};
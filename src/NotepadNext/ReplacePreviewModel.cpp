@@ -0,0 +1,185 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ReplacePreviewModel.h"
+#include "ScintillaNext.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QDir>
+
+#include <algorithm>
+
+
+ReplacePreviewModel::ReplacePreviewModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+}
+
+void ReplacePreviewModel::addEditor(ScintillaNext *editor, const ReplacePreview &preview)
+{
+    Document document;
+    document.fromEditor = true;
+    document.editor = editor;
+    document.filePath = editor->isFile() ? editor->getFilePath() : QString();
+    document.name = editor->isFile() ? QDir::toNativeSeparators(editor->getFilePath()) : editor->getName();
+    document.preview = preview;
+
+    addDocument(std::move(document));
+}
+
+void ReplacePreviewModel::addFile(const QString &filePath, const ReplacePreview &preview)
+{
+    Document document;
+    document.filePath = filePath;
+    document.name = QDir::toNativeSeparators(filePath);
+    document.preview = preview;
+
+    addDocument(std::move(document));
+}
+
+void ReplacePreviewModel::addDocument(Document &&document)
+{
+    const int hunkCount = document.preview.hunks.size();
+
+    if (hunkCount == 0)
+        return;
+
+    // Everything starts out accepted, the same as Replace All would do
+    document.accepted.assign(hunkCount, true);
+
+    const int first = totalHunks();
+    const int docIndex = static_cast<int>(docs.size());
+
+    beginInsertRows(QModelIndex(), first, first + hunkCount - 1);
+    docs.push_back(std::move(document));
+    for (int i = 0; i < hunkCount; ++i) {
+        hunkRows.emplace_back(docIndex, i);
+    }
+    acceptedCount += hunkCount;
+    endInsertRows();
+
+    emit acceptedChanged(acceptedCount);
+}
+
+void ReplacePreviewModel::setAllAccepted(bool accepted)
+{
+    for (Document &document : docs) {
+        std::fill(document.accepted.begin(), document.accepted.end(), accepted);
+    }
+
+    acceptedCount = accepted ? totalHunks() : 0;
+
+    if (!hunkRows.empty())
+        emit dataChanged(index(0, Location), index(totalHunks() - 1, Location), {Qt::CheckStateRole});
+
+    emit acceptedChanged(acceptedCount);
+}
+
+int ReplacePreviewModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : totalHunks();
+}
+
+int ReplacePreviewModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant ReplacePreviewModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    const auto &row = hunkRows[index.row()];
+    const Document &document = docs[row.first];
+    const ReplacePreview::Hunk &hunk = document.preview.hunks.at(row.second);
+
+    if (index.column() == Location) {
+        // Scintilla internally references line numbers starting at 0, however it needs displayed starting at 1
+        if (role == Qt::DisplayRole)
+            return QStringLiteral("%1:%2").arg(document.name).arg(hunk.lineNumber + 1);
+        else if (role == Qt::ToolTipRole)
+            return tr("%Ln matches", "", hunk.matchCount);
+        else if (role == Qt::CheckStateRole)
+            return document.accepted[row.second] ? Qt::Checked : Qt::Unchecked;
+    }
+    else if (index.column() == Before) {
+        if (role == Qt::DisplayRole)
+            return hunk.before;
+        else if (role == Qt::BackgroundRole)
+            return QBrush(QColor(255, 224, 224));
+    }
+    else if (index.column() == After) {
+        if (role == Qt::DisplayRole)
+            return hunk.after;
+        else if (role == Qt::BackgroundRole)
+            return QBrush(document.accepted[row.second] ? QColor(213, 255, 213) : QColor(232, 232, 232));
+    }
+
+    return QVariant();
+}
+
+bool ReplacePreviewModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.column() != Location || role != Qt::CheckStateRole)
+        return false;
+
+    const auto &row = hunkRows[index.row()];
+    const bool accepted = value.toInt() == Qt::Checked;
+    Document &document = docs[row.first];
+
+    if (document.accepted[row.second] == accepted)
+        return true;
+
+    document.accepted[row.second] = accepted;
+    acceptedCount += accepted ? 1 : -1;
+
+    emit dataChanged(index, index.sibling(index.row(), After), {Qt::CheckStateRole, Qt::BackgroundRole});
+    emit acceptedChanged(acceptedCount);
+
+    return true;
+}
+
+Qt::ItemFlags ReplacePreviewModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags flags = QAbstractTableModel::flags(index);
+
+    if (index.isValid() && index.column() == Location)
+        flags |= Qt::ItemIsUserCheckable;
+
+    return flags;
+}
+
+QVariant ReplacePreviewModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case Location:
+        return tr("Location");
+    case Before:
+        return tr("Before");
+    case After:
+        return tr("After");
+    }
+
+    return QVariant();
+}
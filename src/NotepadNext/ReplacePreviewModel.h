@@ -0,0 +1,81 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QPointer>
+#include <QVector>
+
+#include <vector>
+
+#include "ReplacePreview.h"
+
+
+class ScintillaNext;
+
+// Every hunk of a replace preview as one flat list, with whether each one is accepted. Documents are added as their
+// previews arrive and only the hunks the view asks for are ever looked at, so it copes with any number of them.
+class ReplacePreviewModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { Location, Before, After };
+
+    struct Document
+    {
+        bool fromEditor = false; // else it is a file on disk
+        QPointer<ScintillaNext> editor;
+        QString filePath;
+        QString name;
+        ReplacePreview preview;
+        std::vector<bool> accepted;
+    };
+
+    explicit ReplacePreviewModel(QObject *parent = nullptr);
+
+    void addEditor(ScintillaNext *editor, const ReplacePreview &preview);
+    void addFile(const QString &filePath, const ReplacePreview &preview);
+
+    const std::vector<Document> &documents() const { return docs; }
+
+    void setAllAccepted(bool accepted);
+    int acceptedHunks() const { return acceptedCount; }
+    int totalHunks() const { return static_cast<int>(hunkRows.size()); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    void acceptedChanged(int acceptedHunks);
+
+private:
+    void addDocument(Document &&document);
+
+    std::vector<Document> docs;
+
+    // Which document and hunk each row is
+    std::vector<std::pair<int, int>> hunkRows;
+    int acceptedCount = 0;
+};
@@ -19,27 +19,49 @@
 
 #include "RtfConverter.h"
 
+#include <QHash>
 #include <QTextStream>
-#include <QMap>
+#include <QVector>
 
-static void AddCharEscaped(QTextStream &stream, int ch)
+// Appends the bytes with anything special to rtf replaced. The spans in between are appended as they are rather
+// than a byte at a time, and found with Converter::findAnyOf(). A \r that is part of a \r\n is dropped, following is
+// the byte after the last one.
+static void AppendEscaped(QByteArray &out, const char *text, int length, char following)
 {
-    switch (ch) {
-    case '\n':
-        stream << QByteArrayLiteral("\\par") << Qt::endl;
-        break;
-    case '{':
-        stream << QByteArrayLiteral("\\{");
-        break;
-    case '}':
-        stream << QByteArrayLiteral("\\}");
-        break;
-    case '\t':
-        stream << QByteArrayLiteral("\\tab ");
-        break;
-    default:
-        stream << static_cast<char>(ch);
+    static const char SPECIAL[] = "\n{}\t\r";
+    int spanStart = 0;
+
+    for (int i = Converter::findAnyOf(text, 0, length, SPECIAL); i < length; i = Converter::findAnyOf(text, i + 1, length, SPECIAL)) {
+        const char *replacement;
+
+        switch (text[i]) {
+        case '\n':
+            replacement = "\\par\n";
+            break;
+        case '{':
+            replacement = "\\{";
+            break;
+        case '}':
+            replacement = "\\}";
+            break;
+        case '\t':
+            replacement = "\\tab ";
+            break;
+        case '\r':
+            if (((i + 1 < length) ? text[i + 1] : following) != '\n')
+                continue;
+            replacement = "";
+            break;
+        default:
+            continue;
+        }
+
+        out.append(text + spanStart, i - spanStart);
+        out.append(replacement);
+        spanStart = i + 1;
     }
+
+    out.append(text + spanStart, length - spanStart);
 }
 
 static QColor ScintillaColorToQColor(int color)
@@ -51,51 +73,27 @@ static QColor ScintillaColorToQColor(int color)
     return QColor::fromRgb(r, g, b);
 }
 
-void RtfConverter::convertRange(QTextStream &stream, int start, int end)
+void RtfConverter::writeHeader(QByteArray &out, const QVector<int> &usedStyles)
 {
-    ensureDocumentStyled(start, end);
+    prevStyle = -1;
 
-    QByteArray rtf_body;
-    QTextStream rtf_stream(&rtf_body);
     QVector<QColor> styleColors;
-    int prevStyle = -1;
-
-    for (int i = start; i < end; ++i) {
-        const int newStyle = editor->styleAt(i);
-
-        if (newStyle != prevStyle) {
-            const QColor c = ScintillaColorToQColor(editor->styleFore(newStyle));
-
-            if (!styleColors.contains(c)) {
-                styleColors.append(c);
-            }
-
-            // Turn bold off or non
-            if (prevStyle != -1 && editor->styleBold(prevStyle) && !editor->styleBold(newStyle)) {
-                rtf_stream << "\\b0";
-            }
-            else if (editor->styleBold(newStyle)) {
-                rtf_stream << "\\b";
-            }
+    QHash<QRgb, int> colorIndexes;
 
-            // Set the foreground color
-            rtf_stream << "\\cf" << styleColors.indexOf(c) << ' ';
+    for (const int style : usedStyles) {
+        const QColor c = ScintillaColorToQColor(editor->styleFore(style));
+        auto it = colorIndexes.constFind(c.rgb());
 
-            prevStyle = newStyle;
+        if (it == colorIndexes.constEnd()) {
+            it = colorIndexes.insert(c.rgb(), styleColors.size());
+            styleColors.append(c);
         }
 
-        // Output the character
-        const int ch = editor->charAt(i);
-        if (ch == '\r'){
-            if (editor->charAt(i + 1) != '\n') {
-                AddCharEscaped(rtf_stream, ch);
-            }
-        }
-        else {
-            AddCharEscaped(rtf_stream, ch);
-        }
+        styleInfo[style].bold = editor->styleBold(style);
+        styleInfo[style].colorIndex = it.value();
     }
-    rtf_stream.flush();
+
+    QTextStream stream(&out);
 
     stream << R"({\rtf1\ansi\deff0\deftab480)" << Qt::endl;
     stream << R"({\fonttbl)" << Qt::endl;
@@ -109,7 +107,45 @@ void RtfConverter::convertRange(QTextStream &stream, int start, int end)
     stream << R"(})" << Qt::endl;
     stream << Qt::endl;
     stream << "{" << Qt::endl;
-    stream << rtf_body << Qt::endl;
-    stream << "}" << Qt::endl;
     stream.flush();
 }
+
+void RtfConverter::writeBody(QByteArray &out, const QByteArray &text, const QByteArray &styles, char following)
+{
+    out.reserve(out.size() + text.size() + text.size() / 8 + 64);
+
+    for (int i = 0; i < text.size();) {
+        const int runEnd = styleRunEnd(styles, i);
+        const int newStyle = static_cast<unsigned char>(styles.at(i));
+
+        // A run can carry on from the last chunk
+        if (newStyle != prevStyle) {
+            const StyleInfo &info = styleInfo[newStyle];
+
+            // Turn bold off or non
+            if (prevStyle != -1 && styleInfo[prevStyle].bold && !info.bold) {
+                out.append("\\b0");
+            }
+            else if (info.bold) {
+                out.append("\\b");
+            }
+
+            // Set the foreground color
+            out.append("\\cf");
+            out.append(QByteArray::number(info.colorIndex));
+            out.append(' ');
+
+            prevStyle = newStyle;
+        }
+
+        // Output the characters
+        AppendEscaped(out, text.constData() + i, runEnd - i, runEnd < text.size() ? text.at(runEnd) : following);
+
+        i = runEnd;
+    }
+}
+
+void RtfConverter::writeFooter(QByteArray &out)
+{
+    out.append("\n}\n");
+}
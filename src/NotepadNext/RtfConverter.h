@@ -25,7 +25,19 @@ class RtfConverter : public Converter
 {
     using Converter::Converter;
 
-public:
-    void convertRange(QTextStream &stream, int start, int end) override;
+protected:
+    void writeHeader(QByteArray &out, const QVector<int> &usedStyles) override;
+    void writeBody(QByteArray &out, const QByteArray &text, const QByteArray &styles, char following) override;
+    void writeFooter(QByteArray &out) override;
+
+private:
+    // What is needed from each style used, worked out when the header is written
+    struct StyleInfo {
+        bool bold = false;
+        int colorIndex = 0;
+    };
+
+    StyleInfo styleInfo[256];
+    int prevStyle = -1;
 };
 
@@ -20,77 +20,75 @@
 #include "ScintillaCommenter.h"
 #include "SelectionTracker.h"
 
+#include <cstring>
+
 ScintillaCommenter::ScintillaCommenter(ScintillaNext *editor) :
-    editor(editor), st(editor), ua(editor)
+    editor(editor), st(editor), be(editor)
 {
 }
 
 void ScintillaCommenter::toggleSelection()
 {
-    editor->forEachLineInSelection(editor->mainSelection(), [&](int line) {
-        toggleLine(line);
-    });
+    editSelection(Toggle);
 }
 
 void ScintillaCommenter::commentSelection()
 {
-    editor->forEachLineInSelection(editor->mainSelection(), [&](int line) {
-        commentLine(line);
-    });
+    editSelection(Comment);
 }
 
 void ScintillaCommenter::uncommentSelection()
 {
-    editor->forEachLineInSelection(editor->mainSelection(), [&](int line) {
-        uncommentLine(line);
-    });
+    editSelection(Uncomment);
 }
 
-void ScintillaCommenter::toggleLine(int line)
+// Works out the edit for every line up front from one view of the text, then makes them all with a single
+// replaceRanges() call and a single selection adjustment, rather than an edit and notification per line.
+void ScintillaCommenter::editSelection(Action action)
 {
-    auto indentPos = editor->lineIndentPosition(line);
-    auto lineEnd = qMin(indentPos + editor->languageSingleLineComment.length(), editor->lineEndPosition(line));
-    const QByteArray commentText = editor->get_text_range(indentPos, lineEnd);
+    const QByteArray &comment = editor->languageSingleLineComment;
+    const int commentLength = comment.length();
 
-    if (commentText == editor->languageSingleLineComment) {
-        editor->deleteRange(indentPos, editor->languageSingleLineComment.length());
+    if (commentLength == 0)
+        return;
 
-        st.trackDeletion(indentPos, editor->languageSingleLineComment.length());
-    }
-    else {
-        if (indentPos == editor->lineEndPosition(line)) {
-            return;
-        }
+    const int firstLine = editor->lineFromPosition(editor->selectionNStart(editor->mainSelection()));
+    const int lastLine = editor->lineFromPosition(editor->selectionNEnd(editor->mainSelection()));
+    const Sci_Position spanStart = editor->positionFromLine(firstLine);
+    const Sci_Position spanEnd = editor->positionFromLine(lastLine + 1);
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(spanStart, spanEnd - spanStart));
 
-        editor->insertText(indentPos, editor->languageSingleLineComment.constData());
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+    const QByteArray nothing;
 
-        st.trackInsertion(indentPos, editor->languageSingleLineComment.length());
-    }
-}
+    Sci_Position lineStart = spanStart;
+    for (int line = firstLine; line <= lastLine; ++line) {
+        const Sci_Position nextLineStart = (line == lastLine) ? spanEnd : editor->positionFromLine(line + 1);
 
-void ScintillaCommenter::commentLine(int line)
-{
-    auto indentPos = editor->lineIndentPosition(line);
+        // Same as lineIndentPosition(), only spaces and tabs count
+        Sci_Position indentPos = lineStart;
+        while (indentPos < nextLineStart && (text[indentPos - spanStart] == ' ' || text[indentPos - spanStart] == '\t'))
+            ++indentPos;
 
-    // Don't comment lines with only indentation
-    if (indentPos == editor->lineEndPosition(line)) {
-        return;
-    }
+        const bool onlyIndentation = indentPos == nextLineStart || text[indentPos - spanStart] == '\r' || text[indentPos - spanStart] == '\n';
+        const bool commented = indentPos + commentLength <= nextLineStart && std::memcmp(text + (indentPos - spanStart), comment.constData(), commentLength) == 0;
 
-    editor->insertText(indentPos, editor->languageSingleLineComment.constData());
-
-    st.trackInsertion(indentPos, editor->languageSingleLineComment.length());
-}
+        if (commented && action != Comment) {
+            ranges.push_back({static_cast<Sci_PositionCR>(indentPos), static_cast<Sci_PositionCR>(indentPos + commentLength)});
+            replacements.append(nothing);
+        }
+        else if (!onlyIndentation && (action == Comment || (action == Toggle && !commented))) {
+            ranges.push_back({static_cast<Sci_PositionCR>(indentPos), static_cast<Sci_PositionCR>(indentPos)});
+            replacements.append(comment);
+        }
 
-void ScintillaCommenter::uncommentLine(int line)
-{
-    auto indentPos = editor->lineIndentPosition(line);
-    auto lineEnd = qMin(indentPos + editor->languageSingleLineComment.length(), editor->lineEndPosition(line));
-    const QByteArray commentText = editor->get_text_range(indentPos, lineEnd);
+        lineStart = nextLineStart;
+    }
 
-    if (commentText == editor->languageSingleLineComment) {
-        editor->deleteRange(indentPos, editor->languageSingleLineComment.length());
+    if (ranges.empty())
+        return;
 
-        st.trackDeletion(indentPos, editor->languageSingleLineComment.length());
-    }
+    st.trackReplacements(ranges, replacements);
+    editor->replaceRanges(ranges, replacements);
 }
@@ -22,7 +22,7 @@
 
 #include "ScintillaNext.h"
 #include "SelectionTracker.h"
-#include "UndoAction.h"
+#include "BulkEdit.h"
 
 class ScintillaCommenter
 {
@@ -34,13 +34,17 @@ public:
     void uncommentSelection();
 
 private:
-    void toggleLine(int line);
-    void commentLine(int line);
-    void uncommentLine(int line);
+    enum Action {
+        Toggle,
+        Comment,
+        Uncomment,
+    };
+
+    void editSelection(Action action);
 
     ScintillaNext *editor;
     SelectionTracker st;
-    UndoAction ua;
+    BulkEdit be;
 };
 
 #endif // SCINTILLACOMMENTER_H
@@ -19,35 +19,117 @@
 
 #include "ScintillaNext.h"
 #include "ScintillaCommenter.h"
-
-#include "uchardet.h"
+#include "BufferSearcher.h"
+#include "BulkEdit.h"
+#include "EncodingDetector.h"
+#include "FileLoader.h"
+#include "LatencyMonitor.h"
+#include "LazyMimeData.h"
+#include "Logging.h"
+#include "TextEncoder.h"
+
+#include <algorithm>
 #include <cinttypes>
+#include <cstring>
+#include <map>
+#include <utility>
 
+#include <QClipboard>
+#include <QCoreApplication>
 #include <QDir>
+#include <QGuiApplication>
+#include <QMimeData>
 #include <QMouseEvent>
+#include <QPointer>
 #include <QSaveFile>
+#include <QSemaphore>
 #include <QTextCodec>
+#include <QThreadPool>
 
 
 const int CHUNK_SIZE = 1024 * 1024 * 4; // Not sure what is best
 
+// Set in an undo action's type when it is part of the same operation as the action after it
+const int UNDO_MAY_COALESCE = 0x100;
+
+// Reservations smaller than this are left to Scintilla's own growing of the buffer
+const qint64 RESERVE_THRESHOLD = 64 * 1024;
+
+// About what Scintilla keeps for each undo action besides its text (the type, position and length)
+const int UNDO_ACTION_OVERHEAD = 1 + 2 * sizeof(Sci_Position);
+
+// How much the change history has to grow by before it gets rebuilt at a save point
+const qint64 CHANGE_HISTORY_COMPACT_GROWTH = 1024 * 1024 * 4;
+
+// Files at least this big are loaded on a worker thread when allowed to be
+const qint64 BACKGROUND_LOAD_THRESHOLD = 1024 * 1024 * 32;
+
+// Selections at least this big are copied to the clipboard without converting them up front
+const Sci_Position LAZY_COPY_THRESHOLD = 1024 * 1024;
+
+// Past this many ranges it is faster to rebuild the text than to edit the document once per range
+const size_t BULK_REPLACE_THRESHOLD = 1000;
+
+// Rectangular and multiple selections with at least this many ranges are copied and pasted in one pass
+const int BULK_SELECTION_THRESHOLD = 1000;
 
-static QFileDevice::FileError writeToDisk(const QByteArray &data, const QString &path)
+// How much of the end of a followed file is compared to tell whether it only had something added on to it
+const qint64 FOLLOW_TAIL_SIZE = 1024 * 4;
+
+
+static size_t hashFileTail(QFile &file, qint64 end)
 {
-    qInfo(Q_FUNC_INFO);
+    const qint64 start = qMax<qint64>(0, end - FOLLOW_TAIL_SIZE);
 
-    QFile file(path);
+    if (!file.seek(start))
+        return 0;
 
-    if (file.open(QIODevice::WriteOnly)) {
-        if (file.write(data) != -1) {
-            file.close();
+    return qHash(file.read(end - start));
+}
+
+// Writes the text to the file, compressed on the way if a format is given
+static bool writeCompressed(QFileDevice &file, const char *data, qint64 length, QTextCodec *codec, bool byteOrderMark, Compression::Format compression)
+{
+    if (compression == Compression::Format::None)
+        return TextEncoder::write(file, data, length, codec, byteOrderMark);
+
+    CompressionWriter writer(compression, &file);
+
+    return TextEncoder::write(writer, data, length, codec, byteOrderMark) && writer.finish();
+}
+
+static QFileDevice::FileError writeToDisk(const char *data, qint64 length, const QString &path, bool durable, QTextCodec *codec = Q_NULLPTR, bool byteOrderMark = false, Compression::Format compression = Compression::Format::None)
+{
+    qCDebug(lcFile, Q_FUNC_INFO);
+
+    if (durable) {
+        // The text goes to a temporary file which only replaces the original once it has been completely
+        // written and synced, so a crash part way through never leaves a truncated file behind
+        QSaveFile file(path);
+
+        // If a new file can't be created next to it, e.g. the directory is read only, write it in place instead
+        file.setDirectWriteFallback(true);
+
+        if (file.open(QIODevice::WriteOnly) && writeCompressed(file, data, length, codec, byteOrderMark, compression) && file.commit()) {
             return QFileDevice::NoError;
         }
+
+        // If it got to this point there was an error
+        qWarning("writeToDisk() failure code %d: %s", file.error(), qPrintable(file.errorString()));
+        return file.error() != QFileDevice::NoError ? file.error() : QFileDevice::WriteError;
     }
+    else {
+        QFile file(path);
+
+        if (file.open(QIODevice::WriteOnly) && writeCompressed(file, data, length, codec, byteOrderMark, compression)) {
+            file.close();
+            return QFileDevice::NoError;
+        }
 
-    // If it got to this point there was an error
-    qWarning("writeToDisk() failure code %d: %s", file.error(), qPrintable(file.errorString()));
-    return file.error();
+        // If it got to this point there was an error
+        qWarning("writeToDisk() failure code %d: %s", file.error(), qPrintable(file.errorString()));
+        return file.error() != QFileDevice::NoError ? file.error() : QFileDevice::WriteError;
+    }
 }
 
 static bool isNewlineCharacter(char c)
@@ -55,6 +137,37 @@ static bool isNewlineCharacter(char c)
     return c == '\n' || c == '\r';
 }
 
+// These have to be the same markers ScintillaQt uses, so that it can still tell a rectangular copy made here
+#if defined(Q_OS_WIN)
+static const QString RECTANGULAR_MIME_TYPE = QStringLiteral("MSDEVColumnSelect");
+static const QString WRAPPED_RECTANGULAR_MIME_TYPE = QStringLiteral("application/x-qt-windows-mime;value=\"MSDEVColumnSelect\"");
+#elif defined(Q_OS_MAC)
+static const QString RECTANGULAR_MIME_TYPE = QStringLiteral("text/x-scintilla.utf16-plain-text.rectangular");
+#else
+static const QString RECTANGULAR_MIME_TYPE = QStringLiteral("text/x-rectangular-marker");
+#endif
+
+static void addRectangularMarker(QMimeData *mimeData, const QByteArray &text)
+{
+#if defined(Q_OS_MAC)
+    // Other implementations on macOS expect the text along with the marker
+    mimeData->setData(RECTANGULAR_MIME_TYPE, text);
+#else
+    Q_UNUSED(text)
+    mimeData->setData(RECTANGULAR_MIME_TYPE, QByteArray());
+#endif
+}
+
+static bool isRectangularMimeData(const QMimeData *mimeData)
+{
+#if defined(Q_OS_WIN)
+    if (mimeData->hasFormat(WRAPPED_RECTANGULAR_MIME_TYPE))
+        return true;
+#endif
+
+    return mimeData->hasFormat(RECTANGULAR_MIME_TYPE);
+}
+
 ScintillaNext::ScintillaNext(QString name, QWidget *parent) :
     ScintillaEdit(parent),
     name(name),
@@ -64,13 +177,43 @@ ScintillaNext::ScintillaNext(QString name, QWidget *parent) :
     indicatorResources.disableRange(0, 7);
     indicatorResources.disableRange(INDICATOR_IME, INDICATOR_IME_MAX);
     indicatorResources.disableRange(INDICATOR_HISTORY_REVERTED_TO_ORIGIN_INSERTION, INDICATOR_HISTORY_REVERTED_TO_MODIFIED_DELETION);
+
+    connect(this, &ScintillaNext::modified, this, [=](Scintilla::ModificationFlags type, Scintilla::Position position, Scintilla::Position length) {
+        const bool inserted = Scintilla::FlagSet(type, Scintilla::ModificationFlags::InsertText);
+
+        if (inserted || Scintilla::FlagSet(type, Scintilla::ModificationFlags::DeleteText)) {
+            ++generation;
+
+            if (!changedRanges.isEmpty()) {
+                addChangedRange(inserted, position, length);
+            }
+        }
+    });
+
+    updateModEventMask();
+
+    // This goes first so the document is back the way it was before anything else hears about it
+    connect(this, &ScintillaNext::loadingFinished, this, [=](bool complete) {
+        if (hibernated) {
+            finishWaking(complete);
+        }
+    });
+
+    // Whatever the change history kept that undo can no longer reach can go once it is saved
+    connect(this, &ScintillaNext::savePointChanged, this, [=](bool dirty) {
+        if (!dirty && !isClone()) {
+            compactChangeHistoryIfGrown();
+        }
+    });
+
+    lastVisible.start();
 }
 
 ScintillaNext::~ScintillaNext()
 {
 }
 
-ScintillaNext *ScintillaNext::fromFile(const QString &filePath, bool tryToCreate)
+ScintillaNext *ScintillaNext::fromFile(const QString &filePath, bool tryToCreate, bool loadInBackground)
 {
     QFile file(filePath);
     ScintillaNext *editor = new ScintillaNext(file.fileName());
@@ -85,7 +228,12 @@ ScintillaNext *ScintillaNext::fromFile(const QString &filePath, bool tryToCreate
         f.close();
     }
 
-    bool readSuccessful = editor->readFromDisk(file);
+    bool readSuccessful;
+
+    if (loadInBackground && file.size() >= BACKGROUND_LOAD_THRESHOLD)
+        readSuccessful = editor->readFromDiskInBackground(file);
+    else
+        readSuccessful = editor->readFromDisk(file);
 
     if (!readSuccessful) {
         delete editor;
@@ -97,493 +245,2375 @@ ScintillaNext *ScintillaNext::fromFile(const QString &filePath, bool tryToCreate
     return editor;
 }
 
-int ScintillaNext::allocateIndicator(const QString &name)
+ScintillaNext *ScintillaNext::deferredFromFile(const QString &filePath)
 {
-    return indicatorResources.requestResource(name);
+    ScintillaNext *editor = new ScintillaNext(filePath);
+
+    editor->deferredFilePath = filePath;
+    editor->setFileInfo(filePath);
+
+    return editor;
 }
 
-void ScintillaNext::goToRange(const Sci_CharacterRange &range)
+ScintillaNext *ScintillaNext::createClone()
 {
-    qInfo(Q_FUNC_INFO);
+    if (isClone()) {
+        return cloneSource->createClone();
+    }
 
-    if (isRangeValid(range)) {
-        // Lines can be folded so make sure they are visible
-        ensureVisible(lineFromPosition(range.cpMin));
-        ensureVisible(lineFromPosition(range.cpMax));
+    // There would be nothing for the clone to show, and it never gets read while the document is shared
+    loadDeferred(false);
 
-        setSelection(range.cpMin, range.cpMax);
-        scrollRange(range.cpMax, range.cpMin);
-    }
-}
+    ScintillaNext *clone = new ScintillaNext(name);
 
-QByteArray ScintillaNext::eolString() const
-{
-    const int eol = eOLMode();
+    clone->cloneSource = this;
+    clone->setDocPointer(docPointer());
+    clone->setChangeHistory(changeHistory());
+    clone->copyFileState(this);
 
-    if (eol == SC_EOL_LF) return QByteArrayLiteral("\n");
-    else if (eol == SC_EOL_CRLF) return QByteArrayLiteral("\r\n");
-    else return QByteArrayLiteral("\r");
-}
+    clones.append(clone);
 
-bool ScintillaNext::lineIsEmpty(int line)
-{
-    return (lineEndPosition(line) - positionFromLine(line)) == 0;
+    connect(this, &ScintillaNext::renamed, clone, [=]() {
+        clone->copyFileState(this);
+        emit clone->renamed();
+    });
+    connect(this, &ScintillaNext::saved, clone, [=]() {
+        clone->copyFileState(this);
+        emit clone->saved();
+    });
+    connect(this, &ScintillaNext::saveStarted, clone, &ScintillaNext::saveStarted);
+    connect(this, &ScintillaNext::loadingFinished, clone, &ScintillaNext::loadingFinished);
+    connect(this, &ScintillaNext::closed, clone, &ScintillaNext::close);
+    connect(clone, &QObject::destroyed, this, [=]() { clones.removeOne(clone); });
+
+    emit cloned(clone);
+
+    return clone;
 }
 
-void ScintillaNext::deleteLine(int line)
+QVector<ScintillaNext *> ScintillaNext::documentViews()
 {
-    deleteRange(positionFromLine(line), lineLength(line));
+    ScintillaNext *owner = documentOwner();
+    QVector<ScintillaNext *> views{owner};
+
+    views.append(owner->clones);
+
+    return views;
 }
 
-void ScintillaNext::cutAllowLine()
+void ScintillaNext::loadDeferred(bool allowBackground)
 {
-    if (selectionEmpty()) {
-        copyAllowLine();
-        lineDelete();
+    if (!isLoadDeferred()) {
+        return;
+    }
+
+    qInfo(Q_FUNC_INFO);
+
+    QFile file(deferredFilePath);
+
+    // It could have changed since the editor was created, but it is about to be read as it is now
+    if (bufferType == ScintillaNext::File && QFileInfo(file) == fileInfo)
+        updateTimestamp();
+
+    deferredFilePath.clear();
+
+    bool readSuccessful;
+
+    if (allowBackground && file.size() >= BACKGROUND_LOAD_THRESHOLD) {
+        readSuccessful = readFromDiskInBackground(file);
+
+        // It emits loadingFinished() when it is done
+        if (readSuccessful)
+            return;
     }
     else {
-        cut();
+        readSuccessful = readFromDisk(file);
     }
-}
 
-void ScintillaNext::modifyFoldLevels(int level, int action)
-{
-    const int totalLines = lineCount();
+    // The buffer doesn't hold the whole file, so make sure it never gets saved over it
+    loadIncomplete = !readSuccessful;
 
-    int line = 0;
-    while (line < totalLines) {
-        int foldFlags = foldLevel(line); // Even though its called fold level it contains several other flags
-        bool isHeader = foldFlags & SC_FOLDLEVELHEADERFLAG;
-        int actualLevel = (foldFlags & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE;
+    gotoPendingLine();
 
-        if (isHeader && actualLevel == level) {
-            foldLine(line, action);
-            line = lastChild(line, -1) + 1;
-        }
-        else {
-            ++line;
-        }
-    }
+    emit loadingFinished(readSuccessful);
 }
 
-void ScintillaNext::foldAllLevels(int level)
+void ScintillaNext::reserve(qint64 additionalBytes)
 {
-    modifyFoldLevels(level, SC_FOLDACTION_CONTRACT);
-}
+    if (additionalBytes < RESERVE_THRESHOLD) {
+        return;
+    }
 
-void ScintillaNext::unFoldAllLevels(int level)
-{
-    modifyFoldLevels(level, SC_FOLDACTION_EXPAND);
+    // This only ever grows the buffer, the styles grow along with the text
+    allocate(length() + additionalBytes);
 }
 
-void ScintillaNext::deleteLeadingEmptyLines()
+int ScintillaNext::allocateIndicator(const QString &name)
 {
-    while (lineCount() > 1 && lineIsEmpty(0)) {
-        deleteLine(0);
+    // Indicators are kept in the document, so every view has to use the same number for the same thing
+    if (isClone()) {
+        return cloneSource->allocateIndicator(name);
     }
+
+    return indicatorResources.requestResource(name);
 }
 
-void ScintillaNext::deleteTrailingEmptyLines()
+std::vector<Sci_CharacterRange> ScintillaNext::findAllMatches(const QByteArray &pattern, int flags, Sci_CharacterRange range)
 {
-    const int docLength = length();
-    int position = docLength;
+    std::vector<Sci_CharacterRange> matches;
+    BufferSearcher searcher(pattern, flags);
+
+    range.cpMax = qMin<Sci_PositionCR>(range.cpMax, length());
 
-    while (position > 0 && isNewlineCharacter(charAt(position - 1))) {
-        position--;
+    if (!searcher.isValid() || range.cpMin >= range.cpMax) {
+        return matches;
     }
 
-    deleteRange(position, docLength - position);
-}
+    if (!searcher.canSearch()) {
+        // Fall back to letting Scintilla do the work
+        Sci_TextToFind ttf {range, pattern.constData(), {-1, -1}};
 
-bool ScintillaNext::isSavedToDisk() const
-{
-    return !canSaveToDisk();
-}
+        while (send(SCI_FINDTEXT, flags, reinterpret_cast<sptr_t>(&ttf)) != -1) {
+            if (ttf.chrgText.cpMin == ttf.chrgText.cpMax)
+                break;
 
-bool ScintillaNext::canSaveToDisk() const
-{
-    // The buffer can be saved if:
-    // - It is marked as a temporary since as soon as it gets saved it is no longer a temporary buffer
-    // - A modified file
-    // - A missing file since as soon as it is saved it is no longer missing.
-    return temporary ||
-           (bufferType == ScintillaNext::New && modify()) ||
-           (bufferType == ScintillaNext::File && modify()) ||
-            (bufferType == ScintillaNext::FileMissing);
-}
+            matches.push_back(ttf.chrgText);
+            ttf.chrg.cpMin = ttf.chrgText.cpMax;
+        }
 
-void ScintillaNext::setName(const QString &name)
-{
-    this->name = name;
+        return matches;
+    }
 
-    emit renamed();
-}
+    searcher.setCharacterClasses(wordChars(), whitespaceChars());
 
-bool ScintillaNext::isFile() const
-{
-    return bufferType == ScintillaNext::File || bufferType == ScintillaNext::FileMissing;
+    // Grab one extra byte on each side (if possible) so word boundaries can be checked at the edges
+    const Sci_PositionCR viewStart = qMax<Sci_PositionCR>(0, range.cpMin - 1);
+    const Sci_PositionCR viewEnd = qMin<Sci_PositionCR>(length(), range.cpMax + 1);
+    const char *view = reinterpret_cast<const char *>(rangePointer(viewStart, viewEnd - viewStart));
+
+    return searcher.findAll(view, viewEnd - viewStart, range.cpMin - viewStart, range.cpMax - viewStart, viewStart);
 }
 
-QFileInfo ScintillaNext::getFileInfo() const
+void ScintillaNext::selectRanges(const std::vector<Sci_CharacterRange> &ranges, int mainSelection)
 {
-    Q_ASSERT(isFile());
+    if (ranges.empty())
+        return;
 
-    return fileInfo;
-}
+    QVector<sptr_t> positions;
+    positions.reserve(static_cast<qsizetype>(ranges.size()) * 2);
 
-QString ScintillaNext::getPath() const
-{
-    Q_ASSERT(isFile());
+    for (const Sci_CharacterRange &range : ranges) {
+        positions.append(range.cpMax);
+        positions.append(range.cpMin);
+    }
 
-    return QDir::toNativeSeparators(fileInfo.canonicalPath());
+    setSelections(static_cast<sptr_t>(ranges.size()), reinterpret_cast<sptr_t>(positions.constData()));
+    setMainSelection(qBound(0, mainSelection, static_cast<int>(ranges.size()) - 1));
 }
 
-QString ScintillaNext::getFilePath() const
+void ScintillaNext::replaceRanges(const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements)
 {
-    Q_ASSERT(isFile());
+    if (ranges.empty() || replacements.isEmpty())
+        return;
 
-    return QDir::toNativeSeparators(fileInfo.canonicalFilePath());
-}
+    Q_ASSERT(replacements.size() == 1 || static_cast<size_t>(replacements.size()) == ranges.size());
 
-void ScintillaNext::setFoldMarkers(const QString &type)
-{
-    QMap<QString, QList<int>> map{
-        {"simple", {SC_MARK_MINUS, SC_MARK_PLUS, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY}},
-        {"arrow",  {SC_MARK_ARROWDOWN, SC_MARK_ARROW, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY}},
-        {"circle", {SC_MARK_CIRCLEMINUS, SC_MARK_CIRCLEPLUS, SC_MARK_VLINE, SC_MARK_LCORNERCURVE, SC_MARK_CIRCLEPLUSCONNECTED, SC_MARK_CIRCLEMINUSCONNECTED, SC_MARK_TCORNERCURVE }},
-        {"box",    {SC_MARK_BOXMINUS, SC_MARK_BOXPLUS, SC_MARK_VLINE, SC_MARK_LCORNER, SC_MARK_BOXPLUSCONNECTED, SC_MARK_BOXMINUSCONNECTED, SC_MARK_TCORNER }},
+    auto replacementFor = [&](size_t i) -> const QByteArray & {
+        return replacements.size() == 1 ? replacements.first() : replacements.at(static_cast<int>(i));
     };
 
-    if (!map.contains(type))
+    qint64 removedLength = 0;
+    qint64 addedLength = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        removedLength += ranges[i].cpMax - ranges[i].cpMin;
+        addedLength += replacementFor(i).length();
+    }
+
+    reserve(addedLength - removedLength);
+
+    if (ranges.size() < BULK_REPLACE_THRESHOLD) {
+        // Go backwards so the positions of the earlier ranges are not affected
+        for (size_t i = ranges.size(); i-- > 0;) {
+            const QByteArray &replacement = replacementFor(i);
+
+            setTargetRange(ranges[i].cpMin, ranges[i].cpMax);
+            replaceTarget(replacement.length(), replacement.constData());
+        }
+
         return;
+    }
 
-    const auto types = map[type];
-    markerDefine(SC_MARKNUM_FOLDEROPEN, types[0]);
-    markerDefine(SC_MARKNUM_FOLDER, types[1]);
-    markerDefine(SC_MARKNUM_FOLDERSUB, types[2]);
-    markerDefine(SC_MARKNUM_FOLDERTAIL, types[3]);
-    markerDefine(SC_MARKNUM_FOLDEREND, types[4]);
-    markerDefine(SC_MARKNUM_FOLDEROPENMID, types[5]);
-    markerDefine(SC_MARKNUM_FOLDERMIDTAIL, types[6]);
-}
+    const Sci_PositionCR spanStart = ranges.front().cpMin;
+    const Sci_PositionCR spanEnd = ranges.back().cpMax;
 
-void ScintillaNext::close()
-{
-    emit closed();
+    // Build the new text for the whole span in one pass
+    const char *text = reinterpret_cast<const char *>(rangePointer(spanStart, spanEnd - spanStart));
+    QByteArray newText;
+    newText.reserve(static_cast<int>((spanEnd - spanStart) - removedLength + addedLength));
 
-    deleteLater();
-}
+    Sci_PositionCR pos = spanStart;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        newText.append(text + (pos - spanStart), ranges[i].cpMin - pos);
+        newText.append(replacementFor(i));
+        pos = ranges[i].cpMax;
+    }
 
-QFileDevice::FileError ScintillaNext::save()
-{
-    qInfo(Q_FUNC_INFO);
+    // Where a position ends up once every range before it has been replaced. Positions within a range
+    // move to the start of its replacement.
+    auto mapPosition = [&](Sci_PositionCR position) {
+        qint64 offset = 0;
 
-    Q_ASSERT(isFile());
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            const Sci_CharacterRange &range = ranges[i];
 
-    emit aboutToSave();
+            if (position <= range.cpMin)
+                break;
 
-    QFileDevice::FileError writeSuccessful = writeToDisk(QByteArray::fromRawData((char*)characterPointer(), textLength()), fileInfo.filePath());
+            if (position < range.cpMax)
+                return static_cast<Sci_PositionCR>(range.cpMin + offset);
 
-    if (writeSuccessful == QFileDevice::NoError) {
-        updateTimestamp();
-        setSavePoint();
+            offset += replacementFor(i).length() - (range.cpMax - range.cpMin);
+        }
 
-        // If this was a temporary file, make sure it is not any more
-        setTemporary(false);
+        return static_cast<Sci_PositionCR>(position + offset);
+    };
 
-        emit saved();
-    }
+    const Sci_PositionCR caret = mapPosition(currentPos());
+    const Sci_PositionCR anchor = mapPosition(this->anchor());
+    const int firstLine = firstVisibleLine();
 
-    return writeSuccessful;
-}
+    // Replacing the span as one edit would merge the markers (bookmarks and such) of every line in it onto its
+    // first line and expand any folds in it, so they are noted by line and put back where those lines end up
+    struct SpanLine
+    {
+        Sci_PositionCR position = 0;
+        sptr_t markers = 0;
+        bool contracted = false;
+    };
 
-void ScintillaNext::reload()
-{
-    Q_ASSERT(isFile());
+    const sptr_t spanFirstLine = lineFromPosition(spanStart);
+    const sptr_t spanLastLine = lineFromPosition(spanEnd);
+    std::map<sptr_t, SpanLine> spanLines;
+    bool anyContracted = false;
 
-    // Ensure the file still exists.
-    if (!QFile::exists(fileInfo.canonicalFilePath())) {
-        return;
+    for (sptr_t line = markerNext(spanFirstLine, -1); line != -1 && line <= spanLastLine; line = markerNext(line + 1, -1)) {
+        SpanLine &spanLine = spanLines[line];
+        spanLine.position = static_cast<Sci_PositionCR>(positionFromLine(line));
+        spanLine.markers = markerGet(line);
     }
 
-    // Remove all the text
-    {
-        const QSignalBlocker blocker(this);
-        setUndoCollection(false);
-        emptyUndoBuffer();
-        setText("");
-        setUndoCollection(true);
+    for (sptr_t line = contractedFoldNext(spanFirstLine); line != -1 && line <= spanLastLine; line = contractedFoldNext(line + 1)) {
+        SpanLine &spanLine = spanLines[line];
+        spanLine.position = static_cast<Sci_PositionCR>(positionFromLine(line));
+        spanLine.contracted = true;
+        anyContracted = true;
     }
 
-    // NOTE: if the read fails then the buffer will be completely empty...which probably
-    // isn't a good thing, but this should be a rare occurrence.
-    QFile f(fileInfo.canonicalFilePath());
-    bool readSuccessful = readFromDisk(f);
+    const Sci_PositionCR newSpanEnd = mapPosition(spanEnd);
 
-    if (readSuccessful) {
-        updateTimestamp();
-        setSavePoint();
-    }
+    setTargetRange(spanStart, spanEnd);
+    replaceTarget(newText.length(), newText.constData());
 
-    return;
-}
+    if (!spanLines.empty()) {
+        const sptr_t newSpanLastLine = lineFromPosition(newSpanEnd);
 
-QFileDevice::FileError ScintillaNext::saveAs(const QString &newFilePath)
-{
-    bool isRenamed = bufferType == ScintillaNext::New || fileInfo.canonicalFilePath() != newFilePath;
+        for (sptr_t line = markerNext(spanFirstLine, -1); line != -1 && line <= newSpanLastLine; line = markerNext(line + 1, -1)) {
+            markerDelete(line, -1);
+        }
 
-    emit aboutToSave();
+        // The folds only exist again once the lexer has been over the new text
+        if (anyContracted) {
+            colourise(positionFromLine(spanFirstLine), newSpanEnd);
+        }
 
-    QFileDevice::FileError saveSuccessful = writeToDisk(QByteArray::fromRawData((char*)characterPointer(), textLength()), newFilePath);
+        // Same as mapPosition(), but moving along the ranges since the lines are in order
+        size_t i = 0;
+        qint64 offset = 0;
 
-    if (saveSuccessful == QFileDevice::NoError) {
-        setFileInfo(newFilePath);
-        setSavePoint();
+        for (const auto &entry : spanLines) {
+            const SpanLine &spanLine = entry.second;
 
-        // If this was a temporary file, make sure it is not any more
-        setTemporary(false);
+            while (i < ranges.size() && ranges[i].cpMin < spanLine.position && ranges[i].cpMax <= spanLine.position) {
+                offset += replacementFor(i).length() - (ranges[i].cpMax - ranges[i].cpMin);
+                ++i;
+            }
 
-        emit saved();
+            Sci_PositionCR position = static_cast<Sci_PositionCR>(spanLine.position + offset);
+            if (i < ranges.size() && ranges[i].cpMin < spanLine.position)
+                position = static_cast<Sci_PositionCR>(ranges[i].cpMin + offset);
 
-        if (isRenamed) {
-            emit renamed();
+            const sptr_t line = lineFromPosition(position);
+
+            if (spanLine.markers != 0)
+                markerAddSet(line, spanLine.markers);
+            if (spanLine.contracted)
+                foldLine(line, SC_FOLDACTION_CONTRACT);
         }
     }
 
-    return saveSuccessful;
+    setSelection(caret, anchor);
+    setFirstVisibleLine(firstLine);
 }
 
-QFileDevice::FileError ScintillaNext::saveCopyAs(const QString &filePath)
+void ScintillaNext::goToRange(const Sci_CharacterRange &range)
 {
-    return writeToDisk(QByteArray::fromRawData((char*)characterPointer(), textLength()), filePath);
+    qCDebug(lcEditor, Q_FUNC_INFO);
+
+    if (isRangeValid(range)) {
+        // Lines can be folded so make sure they are visible
+        ensureVisible(lineFromPosition(range.cpMin));
+        ensureVisible(lineFromPosition(range.cpMax));
+
+        setSelection(range.cpMin, range.cpMax);
+        scrollRange(range.cpMax, range.cpMin);
+    }
 }
 
-bool ScintillaNext::rename(const QString &newFilePath)
+void ScintillaNext::runWhenShown(const QString &key, std::function<void()> callback)
 {
-    emit aboutToSave();
-
+    if (isVisible()) {
+        pendingWhenShown.remove(key);
+        callback();
+    }
+    else {
+        pendingWhenShown.insert(key, callback);
+    }
+}
+
+Sci_CharacterRange ScintillaNext::visibleRangeOfLine(int line)
+{
+    // Some context on either side, e.g. so a URL going off the edge of the screen can still be found
+    const Sci_Position slack = 1024;
+
+    const Sci_Position start = positionFromLine(line);
+    const Sci_Position end = lineEndPosition(line);
+    const int visibleLine = visibleFromDocLine(line);
+
+    if (!lineVisible(line) || visibleLine + wrapCount(line) <= firstVisibleLine() || visibleLine >= firstVisibleLine() + linesOnScreen() + 1) {
+        return {static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(start)};
+    }
+
+    if (end - start <= LONG_LINE_LENGTH || wrapMode() != SC_WRAP_NONE) {
+        return {static_cast<Sci_PositionCR>(start), static_cast<Sci_PositionCR>(end)};
+    }
+
+    // The line is already laid out to be painted, so this doesn't have to measure anything new
+    const int y = pointYFromPosition(start);
+    const Sci_Position left = positionFromPoint(0, y);
+    const Sci_Position right = positionFromPoint(width(), y);
+
+    return {static_cast<Sci_PositionCR>(qBound(start, left - slack, end)), static_cast<Sci_PositionCR>(qBound(start, right + slack, end))};
+}
+
+QVector<Sci_CharacterRange> ScintillaNext::visibleRanges()
+{
+    QVector<Sci_CharacterRange> ranges;
+
+    const int startLine = docLineFromVisible(firstVisibleLine());
+    const int endLine = docLineFromVisible(firstVisibleLine() + linesOnScreen());
+
+    for (int line = startLine; line <= endLine; ++line) {
+        const Sci_CharacterRange range = visibleRangeOfLine(line);
+
+        if (range.cpMin >= range.cpMax) {
+            continue;
+        }
+
+        // Only joined up if nothing of the lines in between was left out
+        if (!ranges.isEmpty() && !isLongLine(line) && ranges.last().cpMax >= positionFromLine(line) - 2) {
+            ranges.last().cpMax = range.cpMax;
+        }
+        else {
+            ranges.append(range);
+        }
+    }
+
+    return ranges;
+}
+
+QByteArray ScintillaNext::eolString() const
+{
+    const int eol = eOLMode();
+
+    if (eol == SC_EOL_LF) return QByteArrayLiteral("\n");
+    else if (eol == SC_EOL_CRLF) return QByteArrayLiteral("\r\n");
+    else return QByteArrayLiteral("\r");
+}
+
+bool ScintillaNext::lineIsEmpty(int line)
+{
+    return (lineEndPosition(line) - positionFromLine(line)) == 0;
+}
+
+void ScintillaNext::deleteLine(int line)
+{
+    deleteRange(positionFromLine(line), lineLength(line));
+}
+
+void ScintillaNext::copyToClipboard()
+{
+    const Sci_Position start = selectionStart();
+    const Sci_Position end = selectionEnd();
+
+    // Scintilla's own copy handles multiple and rectangular selections, and copying the line when nothing is selected
+    if (selections() > 1 || selectionMode() != SC_SEL_STREAM || end - start < LAZY_COPY_THRESHOLD) {
+        if (selectionMode() == SC_SEL_RECTANGLE && selections() >= BULK_SELECTION_THRESHOLD)
+            copyRectangularSelection();
+        else
+            copyAllowLine();
+
+        return;
+    }
+
+    LazyMimeData *mimeData = new LazyMimeData(this);
+    mimeData->setUtf8Text(QByteArray(reinterpret_cast<const char *>(rangePointer(start, end - start)), end - start));
+
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+}
+
+void ScintillaNext::pasteFromClipboard()
+{
+    const QMimeData *mimeData = QGuiApplication::clipboard()->mimeData();
+
+    if (mimeData != Q_NULLPTR && !readOnly() && codePage() == SC_CP_UTF8) {
+        if (isRectangularMimeData(mimeData)) {
+            if (pasteRectangular(mimeData->text().toUtf8()))
+                return;
+        }
+        else if (multiPaste() == SC_MULTIPASTE_EACH && selections() >= BULK_SELECTION_THRESHOLD) {
+            pasteIntoEachSelection(mimeData->text().toUtf8());
+            return;
+        }
+    }
+
+    paste();
+}
+
+std::vector<Sci_CharacterRange> ScintillaNext::sortedSelectionRanges()
+{
+    const int count = static_cast<int>(selections());
+
+    std::vector<Sci_CharacterRange> ranges;
+    ranges.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        ranges.push_back({static_cast<Sci_PositionCR>(selectionNStart(i)), static_cast<Sci_PositionCR>(selectionNEnd(i))});
+    }
+
+    // A rectangle made from the bottom up has its ranges in reverse
+    if (count > 1 && ranges.front().cpMin > ranges.back().cpMin) {
+        std::reverse(ranges.begin(), ranges.end());
+    }
+
+    return ranges;
+}
+
+void ScintillaNext::copyRectangularSelection()
+{
+    const std::vector<Sci_CharacterRange> ranges = sortedSelectionRanges();
+    const QByteArray eol = eolString();
+
+    qint64 blockLength = 0;
+    for (const Sci_CharacterRange &range : ranges) {
+        blockLength += range.cpMax - range.cpMin + eol.length();
+    }
+
+    // Every row is read out of a single pointer to the text the rectangle spans
+    const Sci_PositionCR spanStart = ranges.front().cpMin;
+    const char *text = reinterpret_cast<const char *>(rangePointer(spanStart, ranges.back().cpMax - spanStart));
+
+    QByteArray block;
+    block.reserve(static_cast<int>(blockLength));
+
+    for (const Sci_CharacterRange &range : ranges) {
+        block.append(text + (range.cpMin - spanStart), range.cpMax - range.cpMin);
+        block.append(eol);
+    }
+
+    LazyMimeData *mimeData = new LazyMimeData(this);
+    mimeData->setUtf8Text(block);
+    addRectangularMarker(mimeData, block);
+
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+}
+
+bool ScintillaNext::pasteRectangular(const QByteArray &text)
+{
+    // Only the cases where the block goes over what is selected, line by line, are done here
+    const bool rectangular = selectionMode() == SC_SEL_RECTANGLE || selectionMode() == SC_SEL_THIN;
+    if (!rectangular && (selections() > 1 || !selectionEmpty()))
+        return false;
+
+    if (text.count('\n') < BULK_SELECTION_THRESHOLD)
+        return false;
+
+    std::vector<Sci_CharacterRange> rows = sortedSelectionRanges();
+    QVector<sptr_t> rowVirtualSpace;
+    rowVirtualSpace.reserve(static_cast<int>(rows.size()));
+
+    for (int i = 0; i < static_cast<int>(rows.size()); ++i) {
+        rowVirtualSpace.append(selectionNStartVirtualSpace(i));
+    }
+
+    if (rows.size() > 1 && selectionNStart(0) > selectionNStart(static_cast<int>(rows.size()) - 1)) {
+        std::reverse(rowVirtualSpace.begin(), rowVirtualSpace.end());
+    }
+
+    const int firstLine = static_cast<int>(lineFromPosition(rows.front().cpMin));
+    const sptr_t insertColumn = column(rows.front().cpMin) + rowVirtualSpace.first();
+    const int lines = static_cast<int>(lineCount());
+    const Sci_PositionCR documentEnd = static_cast<Sci_PositionCR>(length());
+    const QByteArray eol = eolString();
+
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> replacements;
+
+    // Any lines past the end of the document are added on in one go
+    QByteArray tail;
+    Sci_PositionCR caret = rows.front().cpMin;
+
+    int row = 0;
+    int start = 0;
+    while (start <= text.length()) {
+        int end = start;
+        while (end < text.length() && !isNewlineCharacter(text[end]))
+            ++end;
+
+        const QByteArray segment = QByteArray::fromRawData(text.constData() + start, end - start);
+        const int line = firstLine + row;
+
+        if (line < lines) {
+            Sci_CharacterRange range;
+            sptr_t padding;
+
+            if (row < static_cast<int>(rows.size()) && lineFromPosition(rows[row].cpMin) == line) {
+                range = rows[row];
+                padding = rowVirtualSpace.at(row);
+            }
+            else {
+                const Sci_PositionCR position = static_cast<Sci_PositionCR>(findColumn(line, insertColumn));
+                range = {position, position};
+                padding = segment.isEmpty() ? 0 : insertColumn - column(position);
+            }
+
+            if (row == 0)
+                caret = range.cpMin + static_cast<Sci_PositionCR>(qMax<sptr_t>(0, padding));
+
+            if (range.cpMax > range.cpMin || padding > 0 || !segment.isEmpty()) {
+                ranges.push_back(range);
+                replacements.append(QByteArray(static_cast<int>(qMax<sptr_t>(0, padding)), ' ') + segment);
+            }
+        }
+        else {
+            tail.append(eol);
+
+            if (!segment.isEmpty()) {
+                tail.append(QByteArray(static_cast<int>(insertColumn), ' '));
+                tail.append(segment);
+            }
+        }
+
+        if (end + 1 < text.length() && text[end] == '\r' && text[end + 1] == '\n')
+            ++end;
+
+        start = end + 1;
+        ++row;
+    }
+
+    // The rest of the rectangle is cleared, as it would be before a paste
+    for (; row < static_cast<int>(rows.size()); ++row) {
+        if (rows[row].cpMax > rows[row].cpMin) {
+            ranges.push_back(rows[row]);
+            replacements.append(QByteArray());
+        }
+    }
+
+    if (!tail.isEmpty()) {
+        ranges.push_back({documentEnd, documentEnd});
+        replacements.append(tail);
+    }
+
+    const BulkEdit be(this);
+    replaceRanges(ranges, replacements);
+    setEmptySelection(caret);
+
+    return true;
+}
+
+void ScintillaNext::pasteIntoEachSelection(QByteArray text)
+{
+    if (pasteConvertEndings()) {
+        text.replace("\r\n", "\n").replace('\r', '\n');
+
+        if (eolMode() != SC_EOL_LF)
+            text.replace("\n", eolString());
+    }
+
+    const std::vector<Sci_CharacterRange> ranges = sortedSelectionRanges();
+    const Sci_PositionCR mainStart = static_cast<Sci_PositionCR>(selectionNStart(mainSelection()));
+    const bool reversed = ranges.front().cpMin != selectionNStart(0);
+
+    QVector<QByteArray> replacements;
+    replacements.reserve(static_cast<int>(ranges.size()));
+
+    for (int i = 0; i < static_cast<int>(ranges.size()); ++i) {
+        const int selection = reversed ? static_cast<int>(ranges.size()) - 1 - i : i;
+        const sptr_t virtualSpace = selectionNStartVirtualSpace(selection);
+
+        replacements.append(virtualSpace > 0 ? QByteArray(static_cast<int>(virtualSpace), ' ') + text : text);
+    }
+
+    // Each caret ends up after its own copy of the text
+    std::vector<Sci_CharacterRange> carets;
+    carets.reserve(ranges.size());
+    int mainIndex = 0;
+    qint64 offset = 0;
+
+    for (int i = 0; i < static_cast<int>(ranges.size()); ++i) {
+        const Sci_CharacterRange &range = ranges[i];
+        offset += replacements.at(i).length();
+
+        const Sci_PositionCR caret = static_cast<Sci_PositionCR>(range.cpMin + offset);
+        carets.push_back({caret, caret});
+
+        offset -= range.cpMax - range.cpMin;
+
+        if (range.cpMin == mainStart)
+            mainIndex = i;
+    }
+
+    const BulkEdit be(this);
+    replaceRanges(ranges, replacements);
+    selectRanges(carets, mainIndex);
+}
+
+void ScintillaNext::cutAllowLine()
+{
+    if (selectionEmpty()) {
+        copyAllowLine();
+        lineDelete();
+    }
+    else if (selections() == 1 && selectionMode() == SC_SEL_STREAM && selectionEnd() - selectionStart() >= LAZY_COPY_THRESHOLD) {
+        beginUndoAction();
+        copyToClipboard();
+        clear();
+        endUndoAction();
+    }
+    else if (selectionMode() == SC_SEL_RECTANGLE && selections() >= BULK_SELECTION_THRESHOLD) {
+        const std::vector<Sci_CharacterRange> rows = sortedSelectionRanges();
+
+        copyRectangularSelection();
+
+        const BulkEdit be(this);
+        replaceRanges(rows, QByteArray());
+        setEmptySelection(rows.front().cpMin);
+    }
+    else {
+        cut();
+    }
+}
+
+std::vector<int> ScintillaNext::foldLevels(int firstLine, int lastLine)
+{
+    firstLine = qMax(0, firstLine);
+    lastLine = qMin(lastLine, static_cast<int>(lineCount()) - 1);
+
+    if (firstLine > lastLine)
+        return {};
+
+    // Scintilla copies everything to the end of the document
+    std::vector<int> levels(static_cast<size_t>(lineCount() - firstLine));
+    getFoldLevels(firstLine, reinterpret_cast<sptr_t>(levels.data()));
+    levels.resize(static_cast<size_t>(lastLine - firstLine + 1));
+
+    return levels;
+}
+
+void ScintillaNext::modifyFoldLevels(int level, int action)
+{
+    // Scintilla visits each fold once and only updates the display at the end, instead of a message for every fold
+    foldAllAtLevel(action, level);
+}
+
+void ScintillaNext::foldAllLevels(int level)
+{
+    modifyFoldLevels(level, SC_FOLDACTION_CONTRACT);
+}
+
+void ScintillaNext::unFoldAllLevels(int level)
+{
+    modifyFoldLevels(level, SC_FOLDACTION_EXPAND);
+}
+
+Sci_CharacterRange ScintillaNext::deleteLeadingEmptyLines()
+{
+    const Sci_PositionCR docLength = static_cast<Sci_PositionCR>(length());
+    const char *text = reinterpret_cast<const char *>(characterPointer());
+    Sci_PositionCR position = 0;
+
+    while (position < docLength && isNewlineCharacter(text[position])) {
+        position++;
+    }
+
+    if (position == 0) {
+        return {-1, -1};
+    }
+
+    deleteRange(0, position);
+
+    return {0, 0};
+}
+
+Sci_CharacterRange ScintillaNext::deleteTrailingEmptyLines()
+{
+    const Sci_PositionCR docLength = static_cast<Sci_PositionCR>(length());
+    Sci_PositionCR position = docLength;
+
+    // Only the end of the document is looked at, a chunk at a time, rather than asking for each character
+    const Sci_PositionCR chunkSize = 4096;
+    while (position > 0) {
+        const Sci_PositionCR chunkStart = qMax<Sci_PositionCR>(0, position - chunkSize);
+        const char *chunk = reinterpret_cast<const char *>(rangePointer(chunkStart, position - chunkStart));
+        Sci_PositionCR i = position - chunkStart;
+
+        while (i > 0 && isNewlineCharacter(chunk[i - 1])) {
+            i--;
+        }
+
+        if (i > 0) {
+            position = chunkStart + i;
+            break;
+        }
+
+        position = chunkStart;
+    }
+
+    if (position == docLength) {
+        return {-1, -1};
+    }
+
+    deleteRange(position, docLength - position);
+
+    return {position, position};
+}
+
+Sci_CharacterRange ScintillaNext::convertLineEndings(int eolMode)
+{
+    const Sci_PositionCR docLength = static_cast<Sci_PositionCR>(length());
+    const char *text = reinterpret_cast<const char *>(characterPointer());
+    const char *end = text + docLength;
+    const QByteArray eol = eolMode == SC_EOL_CRLF ? QByteArrayLiteral("\r\n") : eolMode == SC_EOL_CR ? QByteArrayLiteral("\r") : QByteArrayLiteral("\n");
+
+    // The next \r and \n are each found with memchr, which is vectorised, so the bytes in between are never
+    // looked at one by one
+    auto findNext = [end](const char *from, char c) {
+        const void *found = std::memchr(from, c, end - from);
+        return found ? static_cast<const char *>(found) : end;
+    };
+
+    const char *nextCr = findNext(text, '\r');
+    const char *nextLf = findNext(text, '\n');
+
+    // Only the part from the first line ending that is wrong to the last one gets replaced
+    QByteArray converted;
+    Sci_PositionCR changeStart = -1;
+    Sci_PositionCR changeEnd = -1;
+    qsizetype convertedLength = 0;
+    const char *copiedUpTo = text;
+
+    while (true) {
+        const char *lineEnd = qMin(nextCr, nextLf);
+        if (lineEnd == end) {
+            break;
+        }
+
+        const qsizetype eolLength = (*lineEnd == '\r' && lineEnd + 1 < end && lineEnd[1] == '\n') ? 2 : 1;
+        const char *next = lineEnd + eolLength;
+
+        if (eolLength != eol.size() || std::memcmp(lineEnd, eol.constData(), eolLength) != 0) {
+            if (changeStart < 0) {
+                changeStart = static_cast<Sci_PositionCR>(lineEnd - text);
+                copiedUpTo = lineEnd;
+            }
+
+            converted.append(copiedUpTo, lineEnd - copiedUpTo);
+            converted.append(eol);
+            copiedUpTo = next;
+
+            changeEnd = static_cast<Sci_PositionCR>(next - text);
+            convertedLength = converted.size();
+        }
+
+        if (nextCr < next)
+            nextCr = findNext(next, '\r');
+        if (nextLf < next)
+            nextLf = findNext(next, '\n');
+    }
+
+    // Whether or not anything had to change, every line now ends the same way
+    FileFormat format = fileFormat;
+    format.eolMode = eolMode;
+    format.mixedLineEndings = false;
+    setFileFormat(format);
+
+    if (changeStart < 0) {
+        return {-1, -1};
+    }
+
+    // One edit for the whole span, so anything watching hears about a single change instead of one per line
+    setTargetRange(changeStart, changeEnd);
+    replaceTarget(convertedLength, converted.constData());
+
+    return {changeStart, changeStart + static_cast<Sci_PositionCR>(convertedLength)};
+}
+
+bool ScintillaNext::isSavedToDisk() const
+{
+    return !canSaveToDisk();
+}
+
+bool ScintillaNext::canSaveToDisk() const
+{
+    // The buffer can be saved if:
+    // - It is marked as a temporary since as soon as it gets saved it is no longer a temporary buffer
+    // - A modified file
+    // - A missing file since as soon as it is saved it is no longer missing.
+    return temporary ||
+           (bufferType == ScintillaNext::New && modify()) ||
+           (bufferType == ScintillaNext::File && (modify() || encodingConverted)) ||
+            (bufferType == ScintillaNext::FileMissing);
+}
+
+void ScintillaNext::setName(const QString &name)
+{
+    if (isClone()) {
+        cloneSource->setName(name);
+        return;
+    }
+
+    this->name = name;
+
+    emit renamed();
+}
+
+bool ScintillaNext::isFile() const
+{
+    return bufferType == ScintillaNext::File || bufferType == ScintillaNext::FileMissing;
+}
+
+QFileInfo ScintillaNext::getFileInfo() const
+{
+    Q_ASSERT(isFile());
+
+    return fileInfo;
+}
+
+QString ScintillaNext::getPath() const
+{
+    Q_ASSERT(isFile());
+
+    return QDir::toNativeSeparators(QFileInfo(canonicalFilePath).path());
+}
+
+QString ScintillaNext::getFilePath() const
+{
+    Q_ASSERT(isFile());
+
+    return QDir::toNativeSeparators(canonicalFilePath);
+}
+
+void ScintillaNext::setFoldMarkers(const QString &type)
+{
+    QMap<QString, QList<int>> map{
+        {"simple", {SC_MARK_MINUS, SC_MARK_PLUS, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY}},
+        {"arrow",  {SC_MARK_ARROWDOWN, SC_MARK_ARROW, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY, SC_MARK_EMPTY}},
+        {"circle", {SC_MARK_CIRCLEMINUS, SC_MARK_CIRCLEPLUS, SC_MARK_VLINE, SC_MARK_LCORNERCURVE, SC_MARK_CIRCLEPLUSCONNECTED, SC_MARK_CIRCLEMINUSCONNECTED, SC_MARK_TCORNERCURVE }},
+        {"box",    {SC_MARK_BOXMINUS, SC_MARK_BOXPLUS, SC_MARK_VLINE, SC_MARK_LCORNER, SC_MARK_BOXPLUSCONNECTED, SC_MARK_BOXMINUSCONNECTED, SC_MARK_TCORNER }},
+    };
+
+    if (!map.contains(type))
+        return;
+
+    const auto types = map[type];
+    markerDefine(SC_MARKNUM_FOLDEROPEN, types[0]);
+    markerDefine(SC_MARKNUM_FOLDER, types[1]);
+    markerDefine(SC_MARKNUM_FOLDERSUB, types[2]);
+    markerDefine(SC_MARKNUM_FOLDERTAIL, types[3]);
+    markerDefine(SC_MARKNUM_FOLDEREND, types[4]);
+    markerDefine(SC_MARKNUM_FOLDEROPENMID, types[5]);
+    markerDefine(SC_MARKNUM_FOLDERMIDTAIL, types[6]);
+}
+
+void ScintillaNext::close()
+{
+    // A clone gets closed along with its source, which may be part of closing the clone as well
+    if (closing) {
+        return;
+    }
+
+    closing = true;
+
+    emit closed();
+
+    deleteLater();
+}
+
+QFileDevice::FileError ScintillaNext::save()
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (isClone()) {
+        return cloneSource->save();
+    }
+
+    Q_ASSERT(isFile());
+
+    loadDeferred(false);
+
+    // Only part of the file is in the buffer, writing it out would lose the rest
+    if (isLoading() || loadIncomplete) {
+        qWarning("Cannot save \"%s\": it was not completely loaded", qUtf8Printable(fileInfo.fileName()));
+        return QFileDevice::AbortError;
+    }
+
+    // Let a background save finish first, else it could replace the file with older text after this one. This save
+    // takes over from it, so what it posts back once it is done is ignored, and so is any save asked for meanwhile.
+    if (backgroundWrite) {
+        backgroundWrite->acquire();
+        backgroundWrite.reset();
+
+        saving = false;
+        saveRequestedAgain = false;
+        ++backgroundSaveRun;
+    }
+
+    emit aboutToSave();
+
+    QFileDevice::FileError writeSuccessful = writeToDisk(reinterpret_cast<const char *>(characterPointer()), textLength(), fileInfo.filePath(), true, encoding, byteOrderMark, compression);
+
+    if (writeSuccessful == QFileDevice::NoError) {
+        updateTimestamp();
+        setSavePoint();
+
+        // The file is in its new encoding now too
+        encodingConverted = false;
+
+        // If this was a temporary file, make sure it is not any more
+        setTemporary(false);
+
+        emit saved();
+    }
+
+    return writeSuccessful;
+}
+
+void ScintillaNext::saveInBackground()
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (isClone()) {
+        cloneSource->saveInBackground();
+        return;
+    }
+
+    Q_ASSERT(isFile());
+
+    loadDeferred(false);
+
+    if (isLoading() || loadIncomplete) {
+        qWarning("Cannot save \"%s\": it was not completely loaded", qUtf8Printable(fileInfo.fileName()));
+        emit saveFailed(QFileDevice::AbortError);
+        return;
+    }
+
+    // Only one write to the file at a time, anything that changes in the meantime gets saved afterwards
+    if (saving) {
+        saveRequestedAgain = true;
+        return;
+    }
+
+    emit aboutToSave();
+
+    saving = true;
+    emit saveStarted();
+
+    // Copying the text is far quicker than writing it, and means it can keep being edited while the write happens
+    const QByteArray snapshot = *textSnapshot();
+    const quint64 snapshotGeneration = generation;
+    const QString filePath = fileInfo.filePath();
+    QTextCodec *codec = encoding;
+    const bool withByteOrderMark = byteOrderMark;
+    const Compression::Format withCompression = compression;
+    std::shared_ptr<QSemaphore> writeDone = std::make_shared<QSemaphore>(0);
+    QPointer<ScintillaNext> self = this;
+    const quint64 run = ++backgroundSaveRun;
+
+    backgroundWrite = writeDone;
+
+    QThreadPool::globalInstance()->start([=]() {
+        const QFileDevice::FileError error = writeToDisk(snapshot.constData(), snapshot.size(), filePath, true, codec, withByteOrderMark, withCompression);
+
+        writeDone->release();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self) {
+                self->finishBackgroundSave(error, snapshotGeneration, run);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ScintillaNext::finishBackgroundSave(QFileDevice::FileError error, quint64 savedGeneration, quint64 run)
+{
+    // save() waited for it and wrote the file again since, which already settled everything
+    if (run != backgroundSaveRun)
+        return;
+
+    saving = false;
+    backgroundWrite.reset();
+
+    if (error == QFileDevice::NoError) {
+        updateTimestamp();
+
+        // Anything typed while the file was being written is not on disk, so the buffer is still modified
+        if (savedGeneration == generation)
+            setSavePoint();
+
+        // The file is in its new encoding now too
+        encodingConverted = false;
+
+        // If this was a temporary file, make sure it is not any more
+        setTemporary(false);
+
+        emit saved();
+    }
+    else {
+        emit saveFailed(error);
+    }
+
+    if (saveRequestedAgain) {
+        saveRequestedAgain = false;
+
+        if (!isSavedToDisk())
+            saveInBackground();
+    }
+}
+
+bool ScintillaNext::canHibernate() const
+{
+    // The document is shared, so it is only free to go once nobody can be looking at it through another view
+    return !isClone() && clones.isEmpty() && bufferType == ScintillaNext::File && !modify() && !temporary && !isVisible() &&
+           !isLoading() && !saving && !loadIncomplete && !isLoadDeferred();
+}
+
+void ScintillaNext::hibernate()
+{
+    if (!canHibernate()) {
+        return;
+    }
+
+    qInfo("Hibernating \"%s\"", qUtf8Printable(fileInfo.fileName()));
+
+    emit aboutToHibernate();
+
+    hibernation.firstVisibleLine = docLineFromVisible(firstVisibleLine());
+    hibernation.currentPosition = currentPos();
+    hibernation.anchor = anchor();
+    hibernation.readOnly = readOnly();
+    hibernation.lastModified = modifiedTime;
+    hibernation.contractedFoldLines.clear();
+
+    for (Sci_Position line = contractedFoldNext(0); line != -1; line = contractedFoldNext(line + 1)) {
+        hibernation.contractedFoldLines.append(static_cast<int>(line));
+    }
+
+    // These belong to the document rather than the view, so they would go with it
+    const sptr_t documentCodePage = codePage();
+    const sptr_t documentEolMode = eOLMode();
+    const sptr_t documentTabWidth = tabWidth();
+    const sptr_t documentIndent = indent();
+    const bool documentUseTabs = useTabs();
+    const bool documentTabIndents = tabIndents();
+    const bool documentBackSpaceUnIndents = backSpaceUnIndents();
+
+    // Scintilla never shrinks its buffers, so the only way to actually give the memory back is to swap in a new document
+    const sptr_t document = createDocument(0, SC_DOCUMENTOPTION_DEFAULT);
+    {
+        const QSignalBlocker blocker(this);
+        setDocPointer(document);
+    }
+
+    // The editor holds its own reference to it now, and the old one was released when it was swapped out
+    releaseDocument(document);
+
+    setCodePage(documentCodePage);
+    setEOLMode(documentEolMode);
+    setTabWidth(documentTabWidth);
+    setIndent(documentIndent);
+    setUseTabs(documentUseTabs);
+    setTabIndents(documentTabIndents);
+    setBackSpaceUnIndents(documentBackSpaceUnIndents);
+
+    // The view only remembers the change history was wanted, the new document needs to start its own
+    setChangeHistory(changeHistory());
+
+    hibernated = true;
+    deferredFilePath = fileInfo.filePath();
+}
+
+void ScintillaNext::finishWaking(bool complete)
+{
+    hibernated = false;
+
+    // If it changed in the meantime the lines don't mean the same thing any more
+    const bool fileChanged = !complete || modifiedTime != hibernation.lastModified;
+
+    qInfo("Woke up \"%s\"%s", qUtf8Printable(fileInfo.fileName()), fileChanged ? " (file changed)" : "");
+
+    emit wokeUp(fileChanged);
+
+    if (!fileChanged) {
+        if (!hibernation.contractedFoldLines.isEmpty()) {
+            // The fold levels only exist once the text has been styled
+            colourise(0, -1);
+
+            for (const int line : qAsConst(hibernation.contractedFoldLines)) {
+                foldLine(line, SC_FOLDACTION_CONTRACT);
+            }
+        }
+    }
+
+    if (hibernation.readOnly) {
+        setReadOnly(true);
+    }
+
+    setSel(hibernation.anchor, hibernation.currentPosition);
+    setFirstVisibleLine(visibleFromDocLine(hibernation.firstVisibleLine));
+
+    hibernation = HibernatedView();
+}
+
+void ScintillaNext::reload()
+{
+    Q_ASSERT(isFile());
+
+    if (isClone()) {
+        cloneSource->reload();
+        return;
+    }
+
+    // Otherwise the deferred text would get added on to the reloaded text later on
+    loadDeferred(false);
+    cancelLoading();
+
+    // Ensure the file still exists.
+    if (!QFile::exists(canonicalFilePath)) {
+        return;
+    }
+
+    // Everything that keeps track of the document catches up once the new text is there
+    suspendModifications();
+
+    // Remove all the text
+    {
+        const QSignalBlocker blocker(this);
+        setUndoCollection(false);
+        emptyUndoBuffer();
+        setText("");
+        setUndoCollection(true);
+    }
+
+    // NOTE: if the read fails then the buffer will be completely empty...which probably
+    // isn't a good thing, but this should be a rare occurrence.
+    QFile f(canonicalFilePath);
+    bool readSuccessful = readFromDisk(f);
+
+    resumeModifications();
+
+    if (readSuccessful) {
+        loadIncomplete = false;
+        updateTimestamp();
+        setSavePoint();
+
+        if (following) {
+            setFollowing(true);
+        }
+    }
+
+    return;
+}
+
+void ScintillaNext::reloadChanges()
+{
+    Q_ASSERT(isFile());
+
+    if (isClone()) {
+        cloneSource->reloadChanges();
+        return;
+    }
+
+    // Without all the text in the buffer there's nothing worth keeping, so it may as well be read from scratch
+    if (isLoadDeferred() || isLoading() || loadIncomplete || hibernated) {
+        reload();
+        return;
+    }
+
+    // Only one diff at a time, a change in the meantime gets diffed once it is done
+    if (reloadingChanges) {
+        reloadChangesRequestedAgain = true;
+        return;
+    }
+
+    reloadingChanges = true;
+
+    const QByteArray snapshot = *textSnapshot();
+    const quint64 snapshotGeneration = generation;
+    const QString filePath = canonicalFilePath;
+    QTextCodec *codec = encoding;
+    QPointer<ScintillaNext> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        QFile file(filePath);
+        QByteArray newText;
+        bool readSuccessful = file.open(QIODevice::ReadOnly);
+
+        if (readSuccessful) {
+            newText = file.readAll();
+            readSuccessful = file.error() == QFileDevice::NoError;
+        }
+
+        if (codec) {
+            QTextDecoder decoder(codec);
+            newText = decoder.toUnicode(newText).toUtf8();
+        }
+        else {
+            newText.remove(0, EncodingDetector::utf8BomLength(newText.constData(), newText.size()));
+        }
+
+        const QVector<LineDiff::Hunk> hunks = readSuccessful ? LineDiff::diff(snapshot, newText) : QVector<LineDiff::Hunk>();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self) {
+                return;
+            }
+
+            if (readSuccessful) {
+                self->applyReloadedChanges(hunks, newText, snapshotGeneration);
+            }
+            else {
+                self->reloadingChanges = false;
+                self->reload();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ScintillaNext::applyReloadedChanges(const QVector<LineDiff::Hunk> &hunks, const QByteArray &newText, quint64 diffedGeneration)
+{
+    reloadingChanges = false;
+
+    // It was edited while the diff was being worked out, so the hunks no longer line up with the buffer
+    if (diffedGeneration != generation || reloadChangesRequestedAgain) {
+        reloadChangesRequestedAgain = false;
+        reloadChanges();
+        return;
+    }
+
+    if (!hunks.isEmpty()) {
+        const bool wasReadOnly = readOnly();
+        setReadOnly(false);
+
+        {
+            // Going from the end backwards keeps the offsets of the earlier hunks valid
+            BulkEdit be(this);
+
+            for (int i = hunks.size() - 1; i >= 0; --i) {
+                const LineDiff::Hunk &hunk = hunks[i];
+
+                setTargetRange(hunk.oldStart, hunk.oldEnd);
+                replaceTarget(hunk.newEnd - hunk.newStart, newText.constData() + hunk.newStart);
+            }
+        }
+
+        setReadOnly(wasReadOnly);
+    }
+
+    updateTimestamp();
+    setSavePoint();
+
+    if (following) {
+        setFollowing(true);
+    }
+}
+
+bool ScintillaNext::appendFromDisk()
+{
+    if (isClone()) {
+        return cloneSource->appendFromDisk();
+    }
+
+    if (!following || modify() || isLoadDeferred() || loader) {
+        return false;
+    }
+
+    // Nothing can be read from the middle of a compressed file, and anything added to one changes what came before
+    if (compression != Compression::Format::None) {
+        return false;
+    }
+
+    // There's no telling where a character starts in the middle of these, so they are always read from the start
+    if (encoding && encoding->mibEnum() >= 1013 && encoding->mibEnum() <= 1019) {
+        return false;
+    }
+
+    QFile file(canonicalFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // A file that shrunk or whose end isn't what was read before has been truncated, rotated or rewritten
+    const qint64 size = file.size();
+    if (size < followedSize || hashFileTail(file, followedSize) != followedTailHash) {
+        return false;
+    }
+
+    if (!file.seek(followedSize)) {
+        return false;
+    }
+
+    QByteArray data = file.read(size - followedSize);
+    qint64 consumed = data.size();
+
+    if (encoding) {
+        // Only take whole lines so a multi-byte character is never cut in half, the rest comes with the next append.
+        // UTF-8 doesn't need this since split sequences go back together in the buffer.
+        const int lastNewline = data.lastIndexOf('\n');
+        consumed = lastNewline + 1;
+        data = encoding->toUnicode(data.constData(), consumed).toUtf8();
+    }
+
+    if (!data.isEmpty()) {
+        const bool caretAtEnd = selectionEmpty() && currentPos() == length();
+        const bool wasReadOnly = readOnly();
+
+        setReadOnly(false);
+        setUndoCollection(false);
+        appendText(data.size(), data.constData());
+        emptyUndoBuffer();
+        setUndoCollection(true);
+        setReadOnly(wasReadOnly);
+        setSavePoint();
+
+        if (caretAtEnd) {
+            gotoPos(length());
+        }
+    }
+
+    rememberFollowedSize(file, followedSize + consumed);
+    updateTimestamp();
+
+    return true;
+}
+
+void ScintillaNext::setFollowing(bool follow)
+{
+    if (isClone()) {
+        cloneSource->setFollowing(follow);
+        return;
+    }
+
+    following = follow && isFile();
+
+    if (following) {
+        // Whatever is in the buffer now is what the next append carries on from
+        QFile file(canonicalFilePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            rememberFollowedSize(file, file.size());
+        }
+
+        gotoPos(length());
+    }
+
+    updateChangeHistory();
+}
+
+void ScintillaNext::rememberFollowedSize(QFile &file, qint64 size)
+{
+    followedSize = size;
+    followedTailHash = hashFileTail(file, size);
+}
+
+void ScintillaNext::setChangeHistoryEnabled(bool enable)
+{
+    if (isClone()) {
+        cloneSource->setChangeHistoryEnabled(enable);
+        return;
+    }
+
+    changeHistoryWanted = enable;
+    updateChangeHistory();
+}
+
+void ScintillaNext::updateChangeHistory()
+{
+    // What gets read while following is never an edit, the history would only be more to update on every append
+    const int option = (changeHistoryWanted && !following) ? (SC_CHANGE_HISTORY_ENABLED | SC_CHANGE_HISTORY_MARKERS) : SC_CHANGE_HISTORY_DISABLED;
+
+    if (changeHistory() == option) {
+        return;
+    }
+
+    auto apply = [=]() {
+        setChangeHistory(option);
+
+        for (ScintillaNext *clone : qAsConst(clones)) {
+            clone->setChangeHistory(option);
+        }
+    };
+
+    // Scintilla only starts the history on a document without any undo actions, so they are taken out while it
+    // starts and put back after, which also fills in the history of the changes made so far
+    if (option != SC_CHANGE_HISTORY_DISABLED && undoActions() > 0 && !isInBulkEdit() && undoTentative() < 0) {
+        rebuildUndoHistory(0, apply);
+    }
+    else {
+        apply();
+    }
+
+    compactedChangeHistorySize = changeHistoryMemory();
+}
+
+void ScintillaNext::compactChangeHistoryIfGrown()
+{
+    if (changeHistory() == SC_CHANGE_HISTORY_DISABLED) {
+        return;
+    }
+
+    // Rebuilding it replays the whole undo history, so it is only worth doing once there is something to gain
+    if (changeHistoryMemory() - compactedChangeHistorySize < CHANGE_HISTORY_COMPACT_GROWTH) {
+        return;
+    }
+
+    const qint64 before = changeHistoryMemory();
+    compactChangeHistory();
+    compactedChangeHistorySize = changeHistoryMemory();
+
+    qInfo("Compacted the change history of \"%s\" from %lld to %lld bytes", qUtf8Printable(getName()), before, compactedChangeHistorySize);
+}
+
+QFileDevice::FileError ScintillaNext::saveAs(const QString &newFilePath)
+{
+    if (isClone()) {
+        return cloneSource->saveAs(newFilePath);
+    }
+
+    loadDeferred(false);
+
+    bool isRenamed = bufferType == ScintillaNext::New || canonicalFilePath != newFilePath;
+
+    emit aboutToSave();
+
+    // Whether the new file is compressed goes by its name, e.g. saving a .log.gz as .log leaves it uncompressed
+    const Compression::Format newCompression = Compression::forFileName(newFilePath);
+
+    QFileDevice::FileError saveSuccessful = writeToDisk(reinterpret_cast<const char *>(characterPointer()), textLength(), newFilePath, true, encoding, byteOrderMark, newCompression);
+
+    if (saveSuccessful == QFileDevice::NoError) {
+        compression = newCompression;
+        setFileInfo(newFilePath);
+        setSavePoint();
+
+        // The file is in its new encoding now too
+        encodingConverted = false;
+
+        // If this was a temporary file, make sure it is not any more
+        setTemporary(false);
+
+        emit saved();
+
+        if (isRenamed) {
+            emit renamed();
+        }
+    }
+
+    return saveSuccessful;
+}
+
+QFileDevice::FileError ScintillaNext::saveCopyAs(const QString &filePath, bool durable)
+{
+    loadDeferred(false);
+
+    if (!durable) {
+        return writeToDisk(reinterpret_cast<const char *>(characterPointer()), textLength(), filePath, false);
+    }
+
+    return writeToDisk(reinterpret_cast<const char *>(characterPointer()), textLength(), filePath, true, encoding, byteOrderMark, Compression::forFileName(filePath));
+}
+
+void ScintillaNext::saveCopyInEncoding(const QString &filePath, QTextCodec *codec, bool withByteOrderMark)
+{
+    loadDeferred(false);
+
+    // The snapshot is shared with anything else reading the text, and it is only ever converted a chunk at a time
+    const std::shared_ptr<const QByteArray> snapshot = textSnapshot();
+    const Compression::Format withCompression = Compression::forFileName(filePath);
+    QPointer<ScintillaNext> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        const QFileDevice::FileError error = writeToDisk(snapshot->constData(), snapshot->size(), filePath, true, codec, withByteOrderMark, withCompression);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self) {
+                emit self->copySaved(filePath, error);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+bool ScintillaNext::rename(const QString &newFilePath)
+{
+    if (isClone()) {
+        return cloneSource->rename(newFilePath);
+    }
+
+    emit aboutToSave();
+
     // Write out the buffer to the new path
-    if (saveCopyAs(newFilePath)) {
+    if (saveCopyAs(newFilePath) == QFileDevice::NoError) {
         // Remove the old file
-        const QString oldPath = fileInfo.canonicalFilePath();
+        const QString oldPath = canonicalFilePath;
         QFile::remove(oldPath);
 
-        // Everything worked fine, so update the buffer's info
-        setFileInfo(newFilePath);
-        setSavePoint();
+        // Everything worked fine, so update the buffer's info
+        setFileInfo(newFilePath);
+        setSavePoint();
+
+        // The file is in its new encoding now too
+        encodingConverted = false;
+
+        // If this was a temporary file, make sure it is not any more
+        setTemporary(false);
+
+        emit saved();
+
+        emit renamed();
+
+        return true;
+    }
+
+    return false;
+}
+
+ScintillaNext::FileStateChange ScintillaNext::checkFileForStateChange()
+{
+    if (bufferType == BufferType::New) {
+        return FileStateChange::NoChange;
+    }
+
+    // refresh else exists() fails to notice missing file
+    fileInfo.refresh();
+
+    return checkFileForStateChange(fileInfo.exists(), fileInfo.lastModified());
+}
+
+ScintillaNext::FileStateChange ScintillaNext::checkFileForStateChange(bool exists, const QDateTime &lastModified)
+{
+    if (bufferType == BufferType::New) {
+        return FileStateChange::NoChange;
+    }
+    else if (bufferType == BufferType::File) {
+        // The file is being written by this editor itself
+        if (saving) {
+            return FileStateChange::NoChange;
+        }
+
+        if (!exists) {
+            bufferType = BufferType::FileMissing;
+
+            emit savePointChanged(false);
+
+            return FileStateChange::Deleted;
+        }
+
+        // Nothing has been read yet, the new contents are what will get loaded
+        if (isLoadDeferred() && QFileInfo(deferredFilePath) == fileInfo) {
+            modifiedTime = lastModified;
+            return FileStateChange::NoChange;
+        }
+
+        // See if the timestamp changed
+        if (modifiedTime != lastModified) {
+            return FileStateChange::Modified;
+        }
+        else {
+            return FileStateChange::NoChange;
+        }
+    }
+    else if (bufferType == BufferType::FileMissing) {
+        // See if it reappeared
+        if (exists) {
+            bufferType = BufferType::File;
+
+            return FileStateChange::Restored;
+        }
+        else {
+            return FileStateChange::NoChange;
+        }
+    }
+
+    qInfo("type() = %d", bufferType);
+    Q_ASSERT(false);
+
+    return FileStateChange::NoChange;
+}
+
+bool ScintillaNext::moveToTrash()
+{
+    if (QFile::exists(canonicalFilePath)) {
+        QFile f(canonicalFilePath);
+
+        return f.moveToTrash();
+    }
+
+    return false;
+}
+
+void ScintillaNext::toggleCommentSelection()
+{
+    ScintillaCommenter sc(this);
+    sc.toggleSelection();
+}
+
+void ScintillaNext::commentLineSelection()
+{
+    ScintillaCommenter sc(this);
+    sc.commentSelection();
+}
+
+void ScintillaNext::uncommentLineSelection()
+{
+    ScintillaCommenter sc(this);
+    sc.uncommentSelection();
+}
+
+void ScintillaNext::showEvent(QShowEvent *event)
+{
+    // Being seen for the first time is what a deferred editor has been waiting for
+    loadDeferred();
+
+    // Taken first in case any of them defer something else
+    const QMap<QString, std::function<void()>> pending = std::exchange(pendingWhenShown, {});
+    for (const std::function<void()> &callback : pending) {
+        callback();
+    }
+
+    ScintillaEdit::showEvent(event);
+}
+
+void ScintillaNext::hideEvent(QHideEvent *event)
+{
+    lastVisible.restart();
+
+    ScintillaEdit::hideEvent(event);
+}
+
+void ScintillaNext::dragEnterEvent(QDragEnterEvent *event)
+{
+    // Ignore all drag and drop events with urls and let the main application handle it
+    if (event->mimeData()->hasUrls()) {
+        return;
+    }
+
+    ScintillaEdit::dragEnterEvent(event);
+}
+
+void ScintillaNext::dropEvent(QDropEvent *event)
+{
+    // Ignore all drag and drop events with urls and let the main application handle it
+    if (event->mimeData()->hasUrls()) {
+        return;
+    }
+
+    ScintillaEdit::dropEvent(event);
+}
+
+void ScintillaNext::keyPressEvent(QKeyEvent *event)
+{
+    if (!LatencyMonitor::isRecording()) {
+        ScintillaEdit::keyPressEvent(event);
+        return;
+    }
+
+    const qint64 start = LatencyMonitor::nowMicroseconds();
+    ScintillaEdit::keyPressEvent(event);
+    LatencyMonitor::keyHandled(start);
+}
+
+void ScintillaNext::inputMethodEvent(QInputMethodEvent *event)
+{
+    if (!LatencyMonitor::isRecording()) {
+        ScintillaEdit::inputMethodEvent(event);
+        return;
+    }
+
+    const qint64 start = LatencyMonitor::nowMicroseconds();
+    ScintillaEdit::inputMethodEvent(event);
+    LatencyMonitor::keyHandled(start);
+}
+
+void ScintillaNext::paintEvent(QPaintEvent *event)
+{
+    if (!LatencyMonitor::isRecording()) {
+        ScintillaEdit::paintEvent(event);
+        return;
+    }
+
+    const qint64 start = LatencyMonitor::nowMicroseconds();
+    ScintillaEdit::paintEvent(event);
+    LatencyMonitor::record(QByteArrayLiteral("Paint"), LatencyMonitor::nowMicroseconds() - start);
+    LatencyMonitor::paintFinished();
+}
+
+// How big the whole file will be once it is UTF-8, going by the first part of it. This is only meant to get the
+// buffer about the right size up front, a bit over is better than having to grow it right at the end.
+static qint64 estimateTranscodedSize(qint64 fileSize, qint64 bytesRead, qint64 bytesConverted)
+{
+    // The buffer already has room for the file size
+    if (bytesRead <= 0 || bytesConverted <= bytesRead) {
+        return 0;
+    }
+
+    return static_cast<qint64>(static_cast<double>(fileSize) * bytesConverted / bytesRead * 1.02);
+}
+
+bool ScintillaNext::readFromDisk(QFile &file)
+{
+    if (!file.exists()) {
+        qWarning("Cannot read \"%s\": doesn't exist", qUtf8Printable(file.fileName()));
+        return false;
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(file.fileName()), file.error(), qUtf8Printable(file.errorString()));
+        return false;
+    }
+
+    // TODO: figure out what to do if "size" is too big
+    allocate(file.size());
+
+    // A compressed file is decompressed a piece at a time as it is read, so the whole text is never held twice
+    const QByteArray header = file.peek(6);
+    compression = Compression::detect(header.constData(), header.size());
+    std::unique_ptr<Compression::Decoder> decoder = Compression::createDecoder(compression);
+    const qint64 readSize = decoder ? Compression::INPUT_CHUNK_SIZE : CHUNK_SIZE;
+    bool decodeFailed = false;
+
+    lineFormat.reset();
+
+    // Turn off undo collection, notifications and signals during loading
+    setUndoCollection(false);
+    suspendModifications();
+    blockSignals(true);
+
+    QByteArray chunk;
+    qint64 bytesRead;
+    QTextCodec *codec = Q_NULLPTR;
+    QTextCodec::ConverterState state;
+
+    // Only text that was taken to be UTF-8 without a BOM to say so is checked as it is read
+    Utf8StreamValidator validator;
+    bool validating = false;
+
+    bool first_read = true;
+    do {
+        // Try to read as much as possible
+        chunk.resize(readSize);
+        bytesRead = file.read(chunk.data(), readSize);
+        chunk.resize(bytesRead);
+
+        qsizetype skip = 0;
+
+        qCDebug(lcFile, "Read %lld bytes", bytesRead);
+
+        if (decoder && bytesRead > 0) {
+            QByteArray decoded;
+
+            if (!decoder->decode(chunk.constData(), chunk.size(), decoded) || (file.atEnd() && !decoder->finish(decoded))) {
+                decodeFailed = true;
+                break;
+            }
+
+            // The file size is only how big it is compressed, so go by how much the first piece grew
+            if (length() == 0) {
+                reserve(estimateTranscodedSize(file.size(), chunk.size(), decoded.size()));
+            }
+
+            chunk = decoded;
+        }
+
+        if (first_read) {
+            first_read = false;
+
+            // A compressed file can't be sought through, so only its start is looked at
+            codec = EncodingDetector::detect(chunk.constData(), chunk.size(), decoder ? Q_NULLPTR : &file);
+            validating = codec == Q_NULLPTR;
+
+            qCDebug(lcFile, "Using codec: '%s'", codec ? codec->name().constData() : "");
+
+            setEncoding(codec, EncodingDetector::codecForBom(chunk.constData(), chunk.size()) != Q_NULLPTR);
+
+            // UTF-8 goes straight into the buffer as is, which also means a multi-byte sequence split
+            // between chunks just gets put back together by the next append
+            if (EncodingDetector::isUtf8Codec(codec)) {
+                codec = Q_NULLPTR;
+                skip = EncodingDetector::utf8BomLength(chunk.constData(), chunk.size());
+            }
+        }
+
+        // The samples can miss what shows it isn't UTF-8 after all. Everything loaded so far was valid UTF-8 and so
+        // went in exactly as it is in the file, so it can be given to the right codec from memory instead of reading
+        // the file again from the start.
+        if (validating && !validator.add(chunk.constData() + skip, chunk.size() - skip)) {
+            validating = false;
+
+            const qsizetype errorOffset = skip + validator.errorOffset();
+            const qsizetype sampleStart = qMax(skip, errorOffset - EncodingDetector::SAMPLE_SIZE / 2);
+            QTextCodec *corrected = EncodingDetector::detect(chunk.constData() + sampleStart, chunk.size() - sampleStart);
+
+            if (corrected != Q_NULLPTR && !EncodingDetector::isUtf8Codec(corrected)) {
+                qCDebug(lcFile, "Not UTF-8 after all, using codec: '%s'", corrected->name().constData());
+
+                codec = corrected;
+                setEncoding(codec, false);
+
+                const QByteArray loaded(reinterpret_cast<const char *>(characterPointer()), static_cast<int>(length()));
+                clearAll();
+                lineFormat.reset();
+
+                const QByteArray utf8_data = codec->toUnicode(loaded.constData(), loaded.size(), &state).toUtf8();
+                lineFormat.add(utf8_data.constData(), utf8_data.size());
+                appendText(utf8_data.size(), utf8_data.constData());
+            }
+        }
+
+        if (codec) {
+            const QByteArray utf8_data = codec->toUnicode(chunk.constData(), chunk.size(), &state).toUtf8();
+
+            // The file size is only right for UTF-8, so go by how much the first chunk grew or shrank
+            if (length() == 0 && !chunk.isEmpty() && !decoder) {
+                reserve(estimateTranscodedSize(file.size(), chunk.size(), utf8_data.size()));
+            }
+
+            lineFormat.add(utf8_data.constData(), utf8_data.size());
+            appendText(utf8_data.size(), utf8_data.constData());
+        }
+        else {
+            lineFormat.add(chunk.constData() + skip, chunk.size() - skip);
+            appendText(chunk.size() - skip, chunk.constData() + skip);
+        }
+    } while (!file.atEnd() && status() == SC_STATUS_OK);
+
+    file.close();
+
+    // Restore it back
+    this->blockSignals(false);
+    resumeModifications();
+    setUndoCollection(true);
+
+    if (status() != SC_STATUS_OK) {
+        qWarning("something bad happened in document->add_data() %ld", status());
+        return false;
+    }
+
+    if (bytesRead == -1) {
+        qWarning("Something bad happened when reading disk %d %s", file.error(), qUtf8Printable(file.errorString()));
+        return false;
+    }
+
+    if (decodeFailed) {
+        qWarning("\"%s\" is not valid compressed data", qUtf8Printable(file.fileName()));
+        return false;
+    }
+
+    applyLineFormat();
+
+    if (!QFileInfo(file).isWritable()) {
+        qInfo("Setting file as read-only");
+        setReadOnly(true);
+    }
+
+    return true;
+}
+
+bool ScintillaNext::readFromDiskInBackground(QFile &file)
+{
+    if (!file.exists()) {
+        qWarning("Cannot read \"%s\": doesn't exist", qUtf8Printable(file.fileName()));
+        return false;
+    }
+
+    // The loader opens the file again on its own but make sure any problem is reported right away
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(file.fileName()), file.error(), qUtf8Printable(file.errorString()));
+        return false;
+    }
+
+    allocate(file.size());
+
+    // The loader decompresses it the same way, this is only to know how to save it again
+    const QByteArray header = file.peek(6);
+    compression = Compression::detect(header.constData(), header.size());
+
+    file.close();
+
+    const QString filePath = file.fileName();
+
+    // Nothing can be edited until the whole file is there, only the loader changes it
+    setUndoCollection(false);
+    setReadOnly(true);
+    suspendModifications();
+
+    lineFormat.reset();
+
+    loader = new FileLoader(this);
+
+    connect(loader, &FileLoader::encodingDetected, this, &ScintillaNext::setEncoding);
+    connect(loader, &FileLoader::chunkLoaded, this, [=](const QByteArray &text, qint64 bytesRead, qint64 totalBytes) {
+        if (length() == 0 && bytesRead > 0) {
+            reserve(estimateTranscodedSize(totalBytes, bytesRead, text.size()));
+        }
 
-        // If this was a temporary file, make sure it is not any more
-        setTemporary(false);
+        setReadOnly(false);
+        appendText(text.size(), text.constData());
+        setReadOnly(true);
 
-        emit saved();
+        // The line endings so far and the indentation are applied once the sample is in, so it is shown right
+        // from the start rather than changing when the whole file is there
+        const bool wasSampled = lineFormat.isIndentSampled();
+        lineFormat.add(text.constData(), text.size());
 
-        emit renamed();
+        if (!wasSampled && lineFormat.isIndentSampled()) {
+            applyLineFormat();
+        }
 
-        return true;
+        if (status() != SC_STATUS_OK) {
+            qWarning("something bad happened in document->add_data() %ld", status());
+            loader->cancel();
+            return;
+        }
+
+        loader->chunkProcessed();
+
+        // The line is all there once the one after it has started
+        if (pendingLine >= 0 && lineCount() > pendingLine + 1) {
+            gotoPendingLine();
+        }
+
+        emit loadingProgress(totalBytes > 0 ? static_cast<int>(bytesRead * 100 / totalBytes) : 100);
+    });
+    connect(loader, &FileLoader::finished, this, [=](bool success) {
+        loader->deleteLater();
+        loader = Q_NULLPTR;
+
+        finishLoading(success && status() == SC_STATUS_OK, filePath);
+    });
+
+    loader->start(filePath);
+
+    return true;
+}
+
+void ScintillaNext::gotoLineWhenLoaded(int line, int column)
+{
+    pendingLine = line;
+    pendingColumn = column;
+
+    if (!isLoadDeferred() && !isLoading()) {
+        gotoPendingLine();
     }
+}
 
-    return false;
+void ScintillaNext::gotoPendingLine()
+{
+    if (pendingLine < 0) {
+        return;
+    }
+
+    const int line = pendingLine;
+    pendingLine = -1;
+
+    ensureVisible(line);
+    gotoLine(line);
+
+    if (pendingColumn > 0) {
+        gotoPos(findColumn(line, pendingColumn));
+    }
+
+    verticalCentreCaret();
 }
 
-ScintillaNext::FileStateChange ScintillaNext::checkFileForStateChange()
+void ScintillaNext::cancelLoading()
 {
-    if (bufferType == BufferType::New) {
-        return FileStateChange::NoChange;
+    if (loader == Q_NULLPTR)
+        return;
+
+    qInfo(Q_FUNC_INFO);
+
+    // Any chunks the worker already sent are dropped along with the loader
+    delete loader;
+    loader = Q_NULLPTR;
+
+    finishLoading(false, fileInfo.filePath());
+}
+
+void ScintillaNext::finishLoading(bool complete, const QString &filePath)
+{
+    resumeModifications();
+    setUndoCollection(true);
+
+    loadIncomplete = !complete;
+
+    if (complete) {
+        applyLineFormat();
     }
-    else if (bufferType == BufferType::File) {
-        // refresh else exists() fails to notice missing file
-        fileInfo.refresh();
 
-        if (!fileInfo.exists()) {
-            bufferType = BufferType::FileMissing;
+    // A partially loaded file stays read-only so it never accidentally gets saved
+    if (!complete) {
+        qWarning("Only part of \"%s\" was loaded", qUtf8Printable(filePath));
+        setReadOnly(true);
+    }
+    else if (!QFileInfo(filePath).isWritable()) {
+        qInfo("Setting file as read-only");
+        setReadOnly(true);
+    }
+    else {
+        setReadOnly(false);
+    }
 
-            emit savePointChanged(false);
+    gotoPendingLine();
 
-            return FileStateChange::Deleted;
-        }
+    emit loadingFinished(complete);
+}
 
-        // See if the timestamp changed
-        if (modifiedTime != fileTimestamp()) {
-            return FileStateChange::Modified;
-        }
-        else {
-            return FileStateChange::NoChange;
+void ScintillaNext::applyLineFormat()
+{
+    FileFormat format;
+    format.eolMode = lineFormat.eolMode();
+    format.mixedLineEndings = lineFormat.hasMixedLineEndings();
+    format.usesTabs = lineFormat.usesTabs();
+    format.indentSize = lineFormat.indentSize();
+    setFileFormat(format);
+
+    // An EditorConfig setting always wins, see EditorConfigAppDecorator
+    const int eol = lineFormat.eolMode();
+    if (eol != -1 && !QObject::property("nn_skip_eolmode").isValid()) {
+        if (lineFormat.hasMixedLineEndings()) {
+            qInfo("\"%s\" has mixed line endings, using the most common", qUtf8Printable(fileInfo.fileName()));
         }
+
+        setEOLMode(eol);
     }
-    else if (bufferType == BufferType::FileMissing) {
-        // See if it reappeared
-        fileInfo.refresh();
 
-        if (fileInfo.exists()) {
-            bufferType = BufferType::File;
+    // The language's default is not used for anything detected here, but it is still redetected on a reload
+    const QVariant skipUseTabs = QObject::property("nn_skip_usetabs");
+    const int tabs = lineFormat.usesTabs();
+    if (tabs != -1 && (!skipUseTabs.isValid() || skipUseTabs.toString() == QStringLiteral("Detected"))) {
+        setUseTabs(tabs == 1);
+        QObject::setProperty("nn_skip_usetabs", "Detected");
+    }
 
-            return FileStateChange::Restored;
-        }
-        else {
-            return FileStateChange::NoChange;
-        }
+    const int size = lineFormat.indentSize();
+    if (size != -1 && !QObject::property("nn_skip_indent").isValid()) {
+        setIndent(size);
     }
+}
 
-    qInfo("type() = %d", bufferType);
-    Q_ASSERT(false);
+void ScintillaNext::setModificationsNeeded(QObject *listener, Scintilla::ModificationFlags flags)
+{
+    if (!neededModifications.contains(listener)) {
+        connect(listener, &QObject::destroyed, this, [=]() {
+            neededModifications.remove(listener);
+            updateModEventMask();
+        });
+    }
 
-    return FileStateChange::NoChange;
+    neededModifications.insert(listener, flags);
+    updateModEventMask();
 }
 
-bool ScintillaNext::moveToTrash()
+ScintillaNext::UndoUsage ScintillaNext::undoUsage() const
 {
-    if (QFile::exists(fileInfo.canonicalFilePath())) {
-        QFile f(fileInfo.canonicalFilePath());
+    UndoUsage usage;
+    usage.actions = undoActions();
 
-        return f.moveToTrash();
+    // A null buffer just returns the length. Scintilla wants the actions read in order from the start.
+    for (int i = 0; i < usage.actions; ++i) {
+        usage.bytes += send(SCI_GETUNDOACTIONTEXT, i, 0) + UNDO_ACTION_OVERHEAD;
     }
 
-    return false;
+    return usage;
 }
 
-void ScintillaNext::toggleCommentSelection()
+int ScintillaNext::trimUndoHistory(int maxActions, qint64 maxBytes)
 {
-    ScintillaCommenter sc(this);
-    sc.toggleSelection();
+    const int actions = undoActions();
+    const int current = undoCurrent();
+
+    if ((maxActions <= 0 || actions <= maxActions) && maxBytes <= 0) {
+        return 0;
+    }
+
+    // Nothing is done while an operation is still being built or an input method is composing something
+    if (isInBulkEdit() || undoTentative() >= 0) {
+        return 0;
+    }
+
+    int first = maxActions > 0 ? qMax(0, actions - maxActions) : 0;
+
+    // The byte limit needs the size of everything after each action, which takes a pass over the lengths first
+    if (maxBytes > 0) {
+        std::vector<qint64> sizes(actions);
+        qint64 kept = 0;
+
+        for (int i = 0; i < actions; ++i) {
+            sizes[i] = send(SCI_GETUNDOACTIONTEXT, i, 0) + UNDO_ACTION_OVERHEAD;
+        }
+
+        int byBytes = actions;
+        while (byBytes > 0 && kept + sizes[byBytes - 1] <= maxBytes) {
+            kept += sizes[--byBytes];
+        }
+
+        first = qMax(first, byBytes);
+    }
+
+    first = qMin(first, current);
+
+    if (first <= 0) {
+        return 0;
+    }
+
+    return rebuildUndoHistory(first);
 }
 
-void ScintillaNext::commentLineSelection()
+int ScintillaNext::rebuildUndoHistory(int first, const std::function<void()> &whileEmpty)
 {
-    ScintillaCommenter sc(this);
-    sc.commentSelection();
+    const int actions = undoActions();
+    const int current = undoCurrent();
+
+    // Scintilla can only restore a whole history, so read it all and put back the part that is kept
+    struct Action {
+        int type;
+        Sci_Position position;
+        QByteArray text;
+    };
+
+    std::vector<Action> kept;
+    kept.reserve(actions - first);
+
+    for (int i = 0; i < actions; ++i) {
+        const int type = undoActionType(i);
+        const Sci_Position position = undoActionPosition(i);
+
+        // An operation starts after an action that can't be coalesced with the next one, so move
+        // forward to the start of the next operation
+        if (i == first - 1 && (type & UNDO_MAY_COALESCE)) {
+            ++first;
+        }
+
+        if (i >= first) {
+            kept.push_back({type, position, undoActionText(i)});
+        }
+    }
+
+    if (first > current) {
+        return 0;
+    }
+
+    const int savePoint = undoSavePoint();
+    const int detach = undoDetach();
+
+    emptyUndoBuffer();
+
+    if (whileEmpty) {
+        whileEmpty();
+    }
+
+    for (const Action &action : kept) {
+        pushUndoActionType(action.type, action.position);
+
+        if (!action.text.isEmpty()) {
+            changeLastUndoActionText(action.text.size(), action.text.constData());
+        }
+    }
+
+    setUndoSavePoint(savePoint >= first ? savePoint - first : -1);
+    setUndoDetach(detach >= first ? detach - first : -1);
+    setUndoTentative(-1);
+
+    // This has to be last, it checks the history is valid for the document
+    setUndoCurrent(current - first);
+
+    if (status() != SC_STATUS_OK) {
+        qWarning("Unable to restore the undo history of \"%s\", it has been cleared", qUtf8Printable(getName()));
+        setStatus(SC_STATUS_OK);
+    }
+
+    return first;
 }
 
-void ScintillaNext::uncommentLineSelection()
+void ScintillaNext::suspendModifications()
 {
-    ScintillaCommenter sc(this);
-    sc.uncommentSelection();
+    ++modificationsSuspended;
+    updateModEventMask();
 }
 
-void ScintillaNext::dragEnterEvent(QDragEnterEvent *event)
+void ScintillaNext::resumeModifications()
 {
-    // Ignore all drag and drop events with urls and let the main application handle it
-    if (event->mimeData()->hasUrls()) {
+    Q_ASSERT(modificationsSuspended > 0);
+
+    if (--modificationsSuspended > 0) {
         return;
     }
 
-    ScintillaEdit::dragEnterEvent(event);
+    updateModEventMask();
+
+    // There is no telling what changed, so assume something did
+    ++generation;
+
+    for (ChangedRange &range : changedRanges) {
+        range.start = 0;
+        range.end = length();
+    }
+
+    emit modificationsResumed();
 }
 
-void ScintillaNext::dropEvent(QDropEvent *event)
+void ScintillaNext::beginBulkEdit()
 {
-    // Ignore all drag and drop events with urls and let the main application handle it
-    if (event->mimeData()->hasUrls()) {
+    if (bulkEdits++ > 0) {
         return;
     }
 
-    ScintillaEdit::dropEvent(event);
+    beginUndoAction();
+    suspendModifications();
+
+    // Nothing gets painted until the end, which includes the margins and scroll bars
+    updatesEnabledBeforeBulkEdit = updatesEnabled();
+    setUpdatesEnabled(false);
 }
 
-bool ScintillaNext::readFromDisk(QFile &file)
+void ScintillaNext::endBulkEdit()
 {
-    if (!file.exists()) {
-        qWarning("Cannot read \"%s\": doesn't exist", qUtf8Printable(file.fileName()));
-        return false;
+    Q_ASSERT(bulkEdits > 0);
+
+    if (--bulkEdits > 0) {
+        return;
     }
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(file.fileName()), file.error(), qUtf8Printable(file.errorString()));
-        return false;
+    endUndoAction();
+
+    // Everything catches up with the document before it is drawn again, so it only gets drawn once
+    resumeModifications();
+
+    if (updatesEnabledBeforeBulkEdit) {
+        setUpdatesEnabled(true);
     }
+}
 
-    // TODO: figure out what to do if "size" is too big
-    allocate(file.size());
+std::shared_ptr<const QByteArray> ScintillaNext::textSnapshot()
+{
+    // The generation doesn't go up until modifications resume, so nothing can be shared in the meantime
+    if (modificationsSuspended == 0 && lastSnapshotGeneration == generation) {
+        if (std::shared_ptr<const QByteArray> shared = lastSnapshot.lock()) {
+            return shared;
+        }
+    }
 
-    // Turn off undo collection and block signals during loading
-    setUndoCollection(false);
-    blockSignals(true);
-    // TODO disable notifications
-    // modEventMask(SC_MOD_NONE)?
+    const Sci_Position docLength = length();
+    const Sci_Position gap = qBound<Sci_Position>(0, gapPosition(), docLength);
 
-    QByteArray chunk;
-    qint64 bytesRead;
-    QTextCodec *codec = Q_NULLPTR;
-    QTextCodec::ConverterState state;
+    QByteArray text;
+    text.reserve(static_cast<int>(docLength));
+    if (gap > 0) {
+        text.append(reinterpret_cast<const char *>(rangePointer(0, gap)), static_cast<int>(gap));
+    }
+    if (docLength > gap) {
+        text.append(reinterpret_cast<const char *>(rangePointer(gap, docLength - gap)), static_cast<int>(docLength - gap));
+    }
 
-    bool first_read = true;
-    do {
-        // Try to read as much as possible
-        chunk.resize(CHUNK_SIZE);
-        bytesRead = file.read(chunk.data(), CHUNK_SIZE);
-        chunk.resize(bytesRead);
+    std::shared_ptr<const QByteArray> snapshot = std::make_shared<const QByteArray>(std::move(text));
 
-        qDebug("Read %lld bytes", bytesRead);
+    lastSnapshot = snapshot;
+    lastSnapshotGeneration = generation;
 
-        // TODO: this needs moved out of here. Would make much more sense to have a class (or classes)
-        // responsible for handling low level situations like this to do things like:
-        // - determine encoding
-        // - determine space vs tabs
-        // - determine indentation size
+    return snapshot;
+}
 
-        if (first_read) {
-            first_read = false;
+void ScintillaNext::trackChangedRanges(QObject *subscriber)
+{
+    if (!changedRanges.contains(subscriber)) {
+        connect(subscriber, &QObject::destroyed, this, [=]() { changedRanges.remove(subscriber); });
+    }
 
-            // Search for a BOM mark
-            codec = QTextCodec::codecForUtfText(chunk, Q_NULLPTR);
+    changedRanges.insert(subscriber, ChangedRange());
+}
 
-            if (codec != Q_NULLPTR) {
-                qDebug("BOM mark found");
-            }
-            else {
-                qDebug("BOM mark not found, using uchardet");
-
-                // Limit decoding to the first 64 kilobytes
-                int detectionSize = qMin(chunk.size(), 64 * 1024);
-
-                // Use uchardet to try and detect file encoding since no BOM was found
-                uchardet_t encodingDetector = uchardet_new();
-                if (uchardet_handle_data(encodingDetector, chunk.data(), detectionSize) == 0) {
-                    uchardet_data_end(encodingDetector);
-
-                    qDebug("uchardet detected encoding as: '%s'", uchardet_get_charset(encodingDetector));
-                    codec = QTextCodec::codecForName(uchardet_get_charset(encodingDetector));
-                }
-                else {
-                    qDebug("uchardet failure");
-                }
-                uchardet_delete(encodingDetector);
-            }
+ScintillaNext::ChangedRange ScintillaNext::takeChangedRange(QObject *subscriber)
+{
+    auto it = changedRanges.find(subscriber);
 
-            qDebug("Using codec: '%s'", codec ? codec->name().constData() : "");
-        }
+    if (it == changedRanges.end()) {
+        return ChangedRange();
+    }
 
-        if (codec) {
-            const QByteArray utf8_data = codec->toUnicode(chunk.constData(), chunk.size(), &state).toUtf8();
-            appendText(utf8_data.size(), utf8_data.constData());
-        }
-        else {
-            appendText(chunk.size(), chunk.constData());
+    return std::exchange(it.value(), ChangedRange());
+}
+
+void ScintillaNext::addChangedRange(bool inserted, Sci_Position position, Sci_Position length)
+{
+    for (ChangedRange &range : changedRanges) {
+        if (range.isEmpty()) {
+            range.start = position;
+            range.end = inserted ? position + length : position;
+            continue;
         }
-    } while (!file.atEnd() && status() == SC_STATUS_OK);
 
-    file.close();
+        if (inserted) {
+            // Anything after the insertion moves along with the text
+            if (range.start > position)
+                range.start += length;
+            if (range.end >= position)
+                range.end += length;
 
-    // Restore it back
-    this->blockSignals(false);
-    setUndoCollection(true);
-    // modEventMask(SC_MODEVENTMASKALL)?
+            range.start = qMin(range.start, position);
+            range.end = qMax(range.end, position + length);
+        }
+        else {
+            // Anything in what was deleted ends up where it started
+            auto moved = [=](Sci_Position p) { return p >= position + length ? p - length : qMin(p, position); };
 
-    if (status() != SC_STATUS_OK) {
-        qWarning("something bad happened in document->add_data() %ld", status());
-        return false;
+            range.start = qMin(moved(range.start), position);
+            range.end = qMax(moved(range.end), position);
+        }
     }
+}
 
-    if (bytesRead == -1) {
-        qWarning("Something bad happened when reading disk %d %s", file.error(), qUtf8Printable(file.errorString()));
-        return false;
+void ScintillaNext::updateModEventMask()
+{
+    if (modificationsSuspended > 0) {
+        setModEventMask(SC_MOD_NONE);
+        return;
     }
 
-    if (!QFileInfo(file).isWritable()) {
-        qInfo("Setting file as read-only");
-        setReadOnly(true);
+    // The change generation and linesAdded() go by these
+    Scintilla::ModificationFlags mask = Scintilla::ModificationFlags::InsertText | Scintilla::ModificationFlags::DeleteText;
+
+    for (Scintilla::ModificationFlags flags : qAsConst(neededModifications)) {
+        mask = mask | flags;
     }
 
-    return true;
+    setModEventMask(static_cast<int>(mask));
 }
 
 QDateTime ScintillaNext::fileTimestamp()
@@ -591,7 +2621,6 @@ QDateTime ScintillaNext::fileTimestamp()
     Q_ASSERT(bufferType != ScintillaNext::New);
 
     fileInfo.refresh();
-    qInfo("%s last modified %s", qUtf8Printable(fileInfo.fileName()), qUtf8Printable(fileInfo.lastModified().toString()));
     return fileInfo.lastModified();
 }
 
@@ -607,17 +2636,44 @@ void ScintillaNext::setFileInfo(const QString &filePath)
 
     Q_ASSERT(fileInfo.exists());
 
+    // Resolving links means going to the file system, which can be slow (e.g. network drives), so it is done once
+    // here rather than every time the path is asked for. This also keeps the path of a file that goes missing.
+    canonicalFilePath = fileInfo.canonicalFilePath();
+
     name = fileInfo.fileName();
     bufferType = ScintillaNext::File;
 
     updateTimestamp();
 }
 
+void ScintillaNext::copyFileState(const ScintillaNext *other)
+{
+    name = other->name;
+    bufferType = other->bufferType;
+    fileInfo = other->fileInfo;
+    canonicalFilePath = other->canonicalFilePath;
+    modifiedTime = other->modifiedTime;
+    encoding = other->encoding;
+    byteOrderMark = other->byteOrderMark;
+    fileFormat = other->fileFormat;
+
+    emit fileFormatChanged();
+}
+
 void ScintillaNext::detachFileInfo(const QString &newName)
 {
+    if (isClone()) {
+        cloneSource->detachFileInfo(newName);
+        return;
+    }
+
     setName(newName);
 
     bufferType = ScintillaNext::New;
+
+    for (ScintillaNext *clone : qAsConst(clones)) {
+        clone->copyFileState(this);
+    }
 }
 
 void ScintillaNext::setTemporary(bool temp)
@@ -627,3 +2683,54 @@ void ScintillaNext::setTemporary(bool temp)
     // Fake this signal
     emit savePointChanged(temporary);
 }
+
+void ScintillaNext::setEncoding(QTextCodec *codec, bool withByteOrderMark)
+{
+    if (isClone()) {
+        cloneSource->setEncoding(codec, withByteOrderMark);
+        return;
+    }
+
+    // The buffer already is UTF-8 so there is nothing to convert
+    encoding = EncodingDetector::isUtf8Codec(codec) ? Q_NULLPTR : codec;
+    byteOrderMark = withByteOrderMark;
+
+    for (ScintillaNext *clone : qAsConst(clones)) {
+        clone->copyFileState(this);
+    }
+
+    emit fileFormatChanged();
+}
+
+void ScintillaNext::convertEncoding(QTextCodec *codec, bool withByteOrderMark)
+{
+    if (isClone()) {
+        cloneSource->convertEncoding(codec, withByteOrderMark);
+        return;
+    }
+
+    setEncoding(codec, withByteOrderMark);
+
+    if (bufferType == ScintillaNext::File) {
+        encodingConverted = true;
+
+        // Fake this signal, the text didn't change but the file has to be written again
+        emit savePointChanged(true);
+    }
+}
+
+void ScintillaNext::setFileFormat(const FileFormat &format)
+{
+    if (isClone()) {
+        cloneSource->setFileFormat(format);
+        return;
+    }
+
+    fileFormat = format;
+
+    for (ScintillaNext *clone : qAsConst(clones)) {
+        clone->copyFileState(this);
+    }
+
+    emit fileFormatChanged();
+}
@@ -20,15 +20,29 @@
 #ifndef SCINTILLANEXT_H
 #define SCINTILLANEXT_H
 
+#include "Compression.h"
+#include "LineDiff.h"
+#include "LineFormatDetector.h"
 #include "RangeAllocator.h"
 #include "ScintillaEdit.h"
 
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QPointer>
+#include <QVector>
 
+#include <functional>
+#include <memory>
+#include <vector>
 
 
+class FileLoader;
+class QSemaphore;
+class QTextCodec;
 
 class ScintillaNext : public ScintillaEdit
 {
@@ -43,10 +57,136 @@ public:
     explicit ScintillaNext(QString name, QWidget *parent = Q_NULLPTR);
     virtual ~ScintillaNext();
 
-    static ScintillaNext *fromFile(const QString &filePath, bool tryToCreate=false);
+    // Large files can be loaded in the background, in which case the editor is returned straight away and the
+    // text keeps getting added to it until loadingFinished() is emitted
+    static ScintillaNext *fromFile(const QString &filePath, bool tryToCreate=false, bool loadInBackground=false);
+
+    // Creates an editor for the file without reading any of it yet. That happens the first time the editor is shown
+    // or loadDeferred() is called, so restoring a session with lots of tabs doesn't have to read every file up front.
+    // Either way loadingFinished() is emitted once the text is there.
+    static ScintillaNext *deferredFromFile(const QString &filePath);
+
+    bool isLoadDeferred() const { return !deferredFilePath.isEmpty(); }
+    void loadDeferred(bool allowBackground=true);
+
+    // Another view of this editor's document, with its own caret, selections, scroll position and folds but the same
+    // text, styling, markers, indicators and undo history. Scintilla counts a reference to the document for each view,
+    // so it lives as long as any of them. The file still belongs to this editor: saving or reloading a clone is done
+    // by this one, and its clones are closed when it is.
+    ScintillaNext *createClone();
+    bool isClone() const { return !cloneSource.isNull(); }
+    bool hasClones() const { return !clones.isEmpty(); }
+
+    // The editor that owns the document and anything kept once per document, which is this one unless it is a clone
+    ScintillaNext *documentOwner() { return isClone() ? cloneSource.data() : this; }
+
+    // Every editor showing the document, starting with the one that owns it
+    QVector<ScintillaNext *> documentViews();
+
+    // What is kept of a hibernated editor so it can be put back the way it was
+    struct HibernatedView {
+        Sci_Position firstVisibleLine = 0; // document line
+        Sci_Position currentPosition = 0;
+        Sci_Position anchor = 0;
+        QList<int> contractedFoldLines;
+        bool readOnly = false;
+        QDateTime lastModified;
+    };
+
+    // Only a saved, unmodified file that nobody is looking at can hibernate, since it gets read back from disk
+    bool canHibernate() const;
+    bool isHibernated() const { return hibernated; }
+    const HibernatedView &hibernatedView() const { return hibernation; }
+
+    // How long it has been since the editor was last visible, or 0 if it is
+    qint64 msecsSinceVisible() const { return isVisible() ? 0 : lastVisible.elapsed(); }
+
+    bool isLoading() const { return loader != Q_NULLPTR; }
+
+    // Goes to the line (0 based), and the column if there is one, as soon as that much of the file has been read.
+    // That is straight away unless the file is still being loaded in the background or hasn't been read yet.
+    void gotoLineWhenLoaded(int line, int column = -1);
+    bool isSaving() const { return saving; }
+
+    // Runs the callback straight away if the editor is visible, otherwise the next time it is shown. Anything
+    // already waiting under the same key is replaced, so only the latest of several changes ends up being made.
+    void runWhenShown(const QString &key, std::function<void()> callback);
+
+    // Goes up by one for every insertion or deletion, so it can be used to tell if the text changed since some point
+    quint64 changeGeneration() const { return generation; }
+
+    // The span of text that was inserted into or deleted from, in positions as they are now. A deletion leaves an
+    // empty span where the text was, and anything done while modifications were suspended covers the whole document.
+    struct ChangedRange {
+        Sci_Position start = -1;
+        Sci_Position end = -1;
+
+        bool isEmpty() const { return start < 0; }
+    };
+
+    // A copy of the text that can be read from any thread while editing carries on. Until the text changes, every
+    // call shares the copy that is still held by someone, so any number of workers can take one for the cost of a
+    // single copy. It is copied either side of the gap so the buffer doesn't have to be moved around to make it.
+    std::shared_ptr<const QByteArray> textSnapshot();
+
+    // Each subscriber is given all the changes since it last took them as one range, so a cache can redo only that
+    // part when there is one. A subscriber is forgotten when it is destroyed.
+    void trackChangedRanges(QObject *subscriber);
+    ChangedRange takeChangedRange(QObject *subscriber);
+
+    // Only the modification events something has asked for are sent at all, which saves a notification for
+    // every style, fold and indicator change. Asking again replaces what the listener asked for before, and
+    // it is forgotten when it is destroyed. Insertions and deletions are always sent, the editor needs those.
+    void setModificationsNeeded(QObject *listener, Scintilla::ModificationFlags flags);
+
+    // While suspended no modification events are sent, e.g. while text is loaded or replaced in bulk. This can
+    // be nested, and once the last one resumes modificationsResumed() is emitted so anything that keeps track of
+    // the document can catch up with whatever it missed.
+    void suspendModifications();
+    void resumeModifications();
+
+    // See BulkEdit, these can be nested
+    void beginBulkEdit();
+    void endBulkEdit();
+    bool isInBulkEdit() const { return bulkEdits > 0; }
+
+    struct UndoUsage {
+        int actions = 0;
+        qint64 bytes = 0;  // rough, the text of every action plus what is kept about each one
+    };
+    UndoUsage undoUsage() const;
+
+    // Throws away the oldest undo actions so no more than maxActions are kept and they take no more than maxBytes (0 is
+    // no limit for either). An operation is never cut in half and nothing that can still be redone is dropped, so more
+    // may be kept. Returns how many actions were dropped.
+    int trimUndoHistory(int maxActions, qint64 maxBytes = 0);
+
+    // The encoding the file was read with and gets written back with. Null means UTF-8, which is what the buffer holds.
+    QTextCodec *getEncoding() const { return encoding; }
+    bool hasByteOrderMark() const { return byteOrderMark; }
+    void setEncoding(QTextCodec *codec, bool withByteOrderMark);
+
+    // Changes the encoding the file gets written back with. The document counts as changed until it is saved, which
+    // converts it as it is written.
+    void convertEncoding(QTextCodec *codec, bool withByteOrderMark);
+
+    // What the file held when it was read, gathered during the load pass so nothing has to go back over the document
+    // to show it. The line endings are no longer mixed once they have been converted.
+    struct FileFormat {
+        int eolMode = -1; // the most common SC_EOL_*, -1 if there weren't any line endings
+        bool mixedLineEndings = false;
+        int usesTabs = -1;
+        int indentSize = -1;
+    };
+    const FileFormat &detectedFormat() const { return fileFormat; }
 
     int allocateIndicator(const QString &name);
 
+    // Makes room for at least this many more bytes of text up front, so a big insert (or lots of small
+    // ones) doesn't have the buffer grow and get copied again and again along the way. Small amounts are
+    // ignored, the buffer grows well enough by itself for those.
+    void reserve(qint64 additionalBytes);
+
     template<typename Func>
     void forEachMatch(const QString &text, Func callback) { forEachMatch(text.toUtf8(), callback); }
 
@@ -56,29 +196,74 @@ public:
     template<typename Func>
     void forEachMatchInRange(const QByteArray &byteArray, Func callback, Sci_CharacterRange range);
 
+    // Finds every match in the range with a single pass over the buffer rather than repeated SCI_FINDTEXT calls
+    std::vector<Sci_CharacterRange> findAllMatches(const QByteArray &pattern, int flags, Sci_CharacterRange range);
+    std::vector<Sci_CharacterRange> findAllMatches(const QByteArray &pattern, int flags) { return findAllMatches(pattern, flags, {0, (Sci_PositionCR)length()}); }
+
+    // Replaces the selections with the sorted, non-overlapping ranges in one call, with the caret at the end of
+    // each range. Adding them one at a time with addSelection() gets slower with every selection.
+    void selectRanges(const std::vector<Sci_CharacterRange> &ranges, int mainSelection);
+
+    // Replaces each of the sorted, non-overlapping ranges with the matching entry of replacements, or with the
+    // only entry if there is just one. Lots of ranges are done as one edit of the text spanning them, rather
+    // than an edit per range. The caller is responsible for any UndoAction or BulkEdit.
+    void replaceRanges(const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements);
+    void replaceRanges(const std::vector<Sci_CharacterRange> &ranges, const QByteArray &replacement) { replaceRanges(ranges, QVector<QByteArray>{replacement}); }
+
     template<typename Func>
     void forEachLineInSelection(int selection, Func callback);
 
     void goToRange(const Sci_CharacterRange &range);
 
+    // Lines longer than this are avoided being gone over as a whole wherever possible, e.g. in minified files
+    static const Sci_Position LONG_LINE_LENGTH = 1024 * 256;
+    bool isLongLine(int line) { return lineLength(line) > LONG_LINE_LENGTH; }
+
+    // The part of the line that is on screen, which is empty if none of it is. For a long line that isn't
+    // wrapped this is only what is horizontally in view plus a little to either side.
+    Sci_CharacterRange visibleRangeOfLine(int line);
+
+    // The visible parts of the lines on screen, with neighbouring lines that aren't long as a single range
+    QVector<Sci_CharacterRange> visibleRanges();
+
     QByteArray eolString() const;
 
     bool lineIsEmpty(int line);
 
     void deleteLine(int line);
 
+    // Like copyAllowLine(), except that a single large selection is put on the clipboard as one copy of its bytes,
+    // which only get converted once something pastes them. See LazyMimeData.
+    void copyToClipboard();
     void cutAllowLine();
 
+    // Like paste(), except that a rectangular block, or a paste into each of lots of selections, is made as a
+    // single edit of the document rather than by Scintilla one line or selection at a time
+    void pasteFromClipboard();
+
+    // The fold levels of the lines from firstLine to lastLine inclusive, read with a single message
+    std::vector<int> foldLevels(int firstLine, int lastLine);
+
     void modifyFoldLevels(int level, int action);
     void foldAllLevels(int level);
     void unFoldAllLevels(int level);
 
-    void deleteLeadingEmptyLines();
-    void deleteTrailingEmptyLines();
+    // These return where the document changed, in positions after the change. Text that was only removed gives an
+    // empty range where it used to be, and nothing changing at all gives -1 for both.
+    Sci_CharacterRange deleteLeadingEmptyLines();
+    Sci_CharacterRange deleteTrailingEmptyLines();
+
+    // Like SCI_CONVERTEOLS but done as a single replacement of the text from the first line ending that changes
+    // to the last one, rather than an edit (and notification) for every line
+    Sci_CharacterRange convertLineEndings(int eolMode);
 
     bool isFile() const;
+    bool isFileMissing() const { return bufferType == BufferType::FileMissing; }
     QFileInfo getFileInfo() const;
 
+    // When the file was last modified as of the last time it was read, written or checked
+    QDateTime lastKnownModification() const { return modifiedTime; }
+
     bool isSavedToDisk() const;
     bool canSaveToDisk() const;
 
@@ -105,6 +290,14 @@ public:
         FileMissing, // Buffer with a missing file on the file system
     };
 
+    // Following a file keeps reading what gets added to the end of it, like tail -f
+    bool isFollowing() const { return isClone() ? cloneSource->following : following; }
+
+    // Change history marks the lines changed since the file was opened, and whether they have been saved, in the
+    // margin. It belongs to the document so every view of it shows the same. It is held back while following.
+    bool isChangeHistoryEnabled() const { return isClone() ? cloneSource->changeHistoryWanted : changeHistoryWanted; }
+    void setChangeHistoryEnabled(bool enable);
+
     bool isTemporary() const { return temporary; }
     void setTemporary(bool temp);
 
@@ -113,17 +306,37 @@ public:
     QString languageName;
     QByteArray languageSingleLineComment;
 
+    // The keyword sets of the language by number, and every keyword of them sorted and without duplicates
+    QMap<int, QByteArray> languageKeywordSets;
+    QList<QByteArray> languageKeywords;
+
     #include "ScintillaEnums.h"
 
 
 public slots:
     void close();
+    void cancelLoading();
     QFileDevice::FileError save();
+    void saveInBackground();
+    void hibernate();
     void reload();
+    // Only reads what was added to the end of a followed file since it was last read. Returns false if that isn't
+    // possible (it isn't being followed, was edited, truncated, rotated, etc) and it needs a full reload instead.
+    bool appendFromDisk();
+    // Reloads the file by only replacing the lines that differ from the buffer, worked out on a worker thread.
+    // Undo history, markers, folding and styling away from the changes are kept, and the reload itself can be undone.
+    void reloadChanges();
+    void setFollowing(bool follow);
     QFileDevice::FileError saveAs(const QString &newFilePath);
-    QFileDevice::FileError saveCopyAs(const QString &filePath);
+    // If durable is false the file is written directly and not synced to disk, which is fine for things like session snapshots.
+    // Those are also left as UTF-8 rather than converted to the file's encoding, so reading them back never loses anything.
+    QFileDevice::FileError saveCopyAs(const QString &filePath, bool durable=true);
+    // Writes a copy of the text in another encoding on a worker thread, copySaved() is sent once it is done
+    void saveCopyInEncoding(const QString &filePath, QTextCodec *codec, bool withByteOrderMark);
     bool rename(const QString &newFilePath);
     ScintillaNext::FileStateChange checkFileForStateChange();
+    // Same as above using what is already known about the file, so the file system doesn't need to be asked again
+    ScintillaNext::FileStateChange checkFileForStateChange(bool exists, const QDateTime &lastModified);
     bool moveToTrash();
 
     void toggleCommentSelection();
@@ -132,28 +345,119 @@ public slots:
 
 signals:
     void aboutToSave();
+    void saveStarted();
     void saved();
+    void saveFailed(QFileDevice::FileError error);
+    void copySaved(const QString &filePath, QFileDevice::FileError error);
     void closed();
     void renamed();
 
     void lexerChanged();
 
+    // Another view of this document was made by createClone(), only the editor that owns the document sends this
+    void cloned(ScintillaNext *clone);
+
+    void modificationsResumed();
+
+    void loadingProgress(int percent);
+    void loadingFinished(bool complete);
+
+    // The encoding or detectedFormat() changed
+    void fileFormatChanged();
+
+    // The document is released while hibernating, so anything kept in it (markers, the lexer, etc) has to be saved
+    // beforehand and set up again once it wakes. The folds, selection and scroll position are taken care of.
+    void aboutToHibernate();
+    void wokeUp(bool fileChanged);
+
 protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dropEvent(QDropEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void inputMethodEvent(QInputMethodEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 
 private:
     QString name;
     BufferType bufferType = BufferType::New;
     QFileInfo fileInfo;
+    QString canonicalFilePath;
     QDateTime modifiedTime;
     RangeAllocator indicatorResources;
 
     bool temporary = false; // Temporary file loaded from a session. It can either be a 'New' file or actual 'File'
 
+    QTextCodec *encoding = Q_NULLPTR;
+    bool byteOrderMark = false;
+    bool encodingConverted = false; // convertEncoding() was used and the file hasn't been saved since
+    Compression::Format compression = Compression::Format::None; // what the file was compressed with, if anything
+    LineFormatDetector lineFormat; // fed everything read from the file while it loads
+    FileFormat fileFormat;
+
+    QPointer<ScintillaNext> cloneSource;
+    QVector<ScintillaNext *> clones;
+    bool closing = false;
+
+    QString deferredFilePath; // where the text comes from once it is needed, which may not be fileInfo
+    FileLoader *loader = Q_NULLPTR;
+
+    // Where gotoLineWhenLoaded() is waiting to go, -1 if it isn't
+    int pendingLine = -1;
+    int pendingColumn = -1;
+    void gotoPendingLine();
+    bool loadIncomplete = false; // Loading was canceled or failed part of the way through
+
+    bool hibernated = false;
+    HibernatedView hibernation;
+    QElapsedTimer lastVisible;
+    QMap<QString, std::function<void()>> pendingWhenShown;
+
+    quint64 generation = 0;
+    QHash<QObject *, ChangedRange> changedRanges;
+    std::weak_ptr<const QByteArray> lastSnapshot;
+    quint64 lastSnapshotGeneration = 0;
+    QHash<QObject *, Scintilla::ModificationFlags> neededModifications;
+    int modificationsSuspended = 0;
+    int bulkEdits = 0;
+    bool updatesEnabledBeforeBulkEdit = true;
+    bool saving = false;
+
+    bool reloadingChanges = false;
+    bool reloadChangesRequestedAgain = false;
+
+    bool following = false;
+    qint64 followedSize = 0; // how much of the file has been read into the buffer
+    size_t followedTailHash = 0; // hash of the last bytes that were read, to tell if they are still the same
+    bool changeHistoryWanted = false;
+    qint64 compactedChangeHistorySize = 0; // what the change history used when it was last rebuilt
+    bool saveRequestedAgain = false;
+    std::shared_ptr<QSemaphore> backgroundWrite; // released by the worker once the file is written
+    quint64 backgroundSaveRun = 0; // a background save only finishes if nothing took over from it in the meantime
+
     bool readFromDisk(QFile &file);
+    bool readFromDiskInBackground(QFile &file);
+    void finishLoading(bool complete, const QString &filePath);
+    void applyLineFormat();
+    void setFileFormat(const FileFormat &format);
+    void updateModEventMask();
+    void addChangedRange(bool inserted, Sci_Position position, Sci_Position length);
+    void finishBackgroundSave(QFileDevice::FileError error, quint64 savedGeneration, quint64 run);
+    void applyReloadedChanges(const QVector<LineDiff::Hunk> &hunks, const QByteArray &newText, quint64 diffedGeneration);
+    void finishWaking(bool complete);
     QDateTime fileTimestamp();
+    void rememberFollowedSize(QFile &file, qint64 size);
+    void updateChangeHistory();
+    void compactChangeHistoryIfGrown();
+    // Reads the undo history, empties it and puts back the actions from first on. whileEmpty is called in between.
+    int rebuildUndoHistory(int first, const std::function<void()> &whileEmpty = nullptr);
     void updateTimestamp();
+    void copyFileState(const ScintillaNext *other);
+    std::vector<Sci_CharacterRange> sortedSelectionRanges();
+    void copyRectangularSelection();
+    bool pasteRectangular(const QByteArray &text);
+    void pasteIntoEachSelection(QByteArray text);
 
 };
 
@@ -172,13 +476,14 @@ void ScintillaNext::forEachLineInSelection(int selection, Func callback)
 template<typename Func>
 void ScintillaNext::forEachMatchInRange(const QByteArray &text, Func callback, Sci_CharacterRange range)
 {
-    Sci_TextToFind ttf {range, text.constData(), {-1, -1}};
-    int flags = searchFlags();
+    Sci_PositionCR nextStart = range.cpMin;
+
+    for (const Sci_CharacterRange &match : findAllMatches(text, searchFlags(), range)) {
+        // The callback decides where the next match is allowed to start
+        if (match.cpMin < nextStart)
+            continue;
 
-    while (send(SCI_FINDTEXT, flags, reinterpret_cast<sptr_t>(&ttf)) != -1) {
-        if(ttf.chrgText.cpMin == ttf.chrgText.cpMax)
-            break;
-        ttf.chrg.cpMin = callback(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+        nextStart = callback(match.cpMin, match.cpMax);
     }
 }
 
@@ -31,15 +31,18 @@ void SearchResultsCollector::newSearch(const QString searchTerm)
 
 void SearchResultsCollector::newFileEntry(ScintillaNext *editor)
 {
-    // There may be a result that was not passed along yet
-    if (runningHitCount > 0) {
-        child->newResultsEntry(prevLine, prevLineNumber, prevStartPositionFromBeginning, prevEndPositionFromBeginning, runningHitCount);
-    }
-    runningHitCount = 0;
+    flushPendingResult();
 
     child->newFileEntry(editor);
 }
 
+void SearchResultsCollector::newFileEntry(const QString &filePath)
+{
+    flushPendingResult();
+
+    child->newFileEntry(filePath);
+}
+
 void SearchResultsCollector::newResultsEntry(const QString line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount)
 {
     if (runningHitCount == 0) {
@@ -70,12 +73,17 @@ void SearchResultsCollector::newResultsEntry(const QString line, int lineNumber,
 }
 
 void SearchResultsCollector::completeSearch()
+{
+    flushPendingResult();
+
+    child->completeSearch();
+}
+
+void SearchResultsCollector::flushPendingResult()
 {
     // There may be a result that was not passed along yet
     if (runningHitCount > 0) {
         child->newResultsEntry(prevLine, prevLineNumber, prevStartPositionFromBeginning, prevEndPositionFromBeginning, runningHitCount);
     }
     runningHitCount = 0;
-
-    child->completeSearch();
 }
@@ -30,10 +30,13 @@ public:
 
     void newSearch(const QString searchTerm) override;
     void newFileEntry(ScintillaNext *editor) override;
+    void newFileEntry(const QString &filePath) override;
     void newResultsEntry(const QString line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount=1) override;
     void completeSearch() override;
 
 private:
+    void flushPendingResult();
+
     ISearchResultsHandler *child;
     int runningHitCount = 0;
 
@@ -0,0 +1,609 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "SearchResultsModel.h"
+#include "ISearchResultsHandler.h"
+#include "ScintillaNext.h"
+
+#include <QBrush>
+#include <QColor>
+
+
+// How often newly found results are shown while a search is running
+const int FLUSH_INTERVAL_MS = 100;
+
+// How much text is written out at a time
+const int WRITE_CHUNK_SIZE = 1024 * 1024;
+
+SearchResultsModel::SearchResultsModel(QObject *parent) :
+    QAbstractItemModel(parent)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_INTERVAL_MS);
+    connect(&flushTimer, &QTimer::timeout, this, &SearchResultsModel::flush);
+}
+
+SearchResultsModel::~SearchResultsModel()
+{
+}
+
+void SearchResultsModel::LineShifts::append()
+{
+    // Whatever the results before it moved, this one starts out where it was found
+    const int count = static_cast<int>(tree.size()) + 1;
+
+    tree.push_back(-prefix(count - (count & -count)));
+}
+
+void SearchResultsModel::LineShifts::add(int first, int lines)
+{
+    for (int i = first + 1; i <= static_cast<int>(tree.size()); i += i & -i) {
+        tree[i - 1] += lines;
+    }
+}
+
+int SearchResultsModel::LineShifts::shiftOf(int index) const
+{
+    return prefix(index + 1);
+}
+
+int SearchResultsModel::LineShifts::prefix(int count) const
+{
+    int sum = 0;
+
+    for (int i = count; i > 0; i -= i & -i) {
+        sum += tree[i - 1];
+    }
+
+    return sum;
+}
+
+SearchResultsModel::FileNode::~FileNode()
+{
+    QObject::disconnect(edits);
+    QObject::disconnect(editsResumed);
+}
+
+void SearchResultsModel::newSearch(const QString &searchTerm)
+{
+    flush();
+
+    auto search = std::make_unique<SearchNode>();
+    search->type = ItemType::Search;
+    search->row = static_cast<int>(searches.size());
+    search->searchTerm = searchTerm;
+
+    beginInsertRows(QModelIndex(), search->row, search->row);
+    currentSearch = search.get();
+    currentFile = Q_NULLPTR;
+    searches.push_back(std::move(search));
+    endInsertRows();
+}
+
+void SearchResultsModel::newFileEntry(ScintillaNext *editor, const QString &filePath)
+{
+    Q_ASSERT(currentSearch);
+
+    // Any results for the previous file need to be shown before the file can be added
+    flush();
+
+    auto file = std::make_unique<FileNode>();
+    file->type = ItemType::File;
+    file->row = static_cast<int>(currentSearch->files.size());
+    file->search = currentSearch;
+    file->editor = editor;
+    file->filePath = filePath;
+
+    if (editor) {
+        FileNode *node = file.get();
+
+        file->edits = connect(editor, &ScintillaNext::modified, this, [=](Scintilla::ModificationFlags type, Scintilla::Position position, Scintilla::Position length, Scintilla::Position linesAdded, const QByteArray &text) {
+            const bool inserted = Scintilla::FlagSet(type, Scintilla::ModificationFlags::InsertText);
+
+            if (inserted || Scintilla::FlagSet(type, Scintilla::ModificationFlags::DeleteText)) {
+                followEdit(node, inserted, static_cast<int>(position), static_cast<int>(length), static_cast<int>(linesAdded), text);
+            }
+        });
+
+        // There is no telling where anything went, so the results stay where they are
+        file->editsResumed = connect(editor, &ScintillaNext::modificationsResumed, this, [=]() {
+            stopFollowingEdits(node);
+        });
+    }
+
+    beginInsertRows(indexOf(currentSearch), file->row, file->row);
+    currentFile = file.get();
+    currentSearch->files.push_back(std::move(file));
+    endInsertRows();
+
+    scheduleFlush();
+}
+
+void SearchResultsModel::newResultsEntry(const QString &line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount)
+{
+    Q_ASSERT(currentFile);
+
+    Result result;
+    result.lineNumber = lineNumber;
+    result.startPositionFromBeginning = startPositionFromBeginning;
+    result.endPositionFromBeginning = endPositionFromBeginning;
+    result.hitCount = hitCount;
+
+    // Results from an editor don't need their own copy of the line
+    if (line.isNull()) {
+        result.lineTextOffset = 0;
+        result.lineTextLength = -1;
+    }
+    else {
+        result.lineTextOffset = currentSearch->lineTextArena.size();
+        result.lineTextLength = line.size();
+
+        currentSearch->lineTextArena.append(line);
+    }
+    currentFile->results.append(result);
+    currentFile->lineShifts.append();
+    currentFile->totalHits += hitCount;
+    currentSearch->totalHits += hitCount;
+
+    scheduleFlush();
+}
+
+void SearchResultsModel::completeSearch()
+{
+    flush();
+
+    if (currentSearch)
+        currentSearch->lineTextArena.squeeze();
+
+    currentSearch = Q_NULLPTR;
+    currentFile = Q_NULLPTR;
+}
+
+SearchResultsModel::ItemType SearchResultsModel::itemType(const QModelIndex &index) const
+{
+    const Node *parentNode = static_cast<const Node *>(index.internalPointer());
+
+    if (parentNode == Q_NULLPTR)
+        return ItemType::Search;
+    else if (parentNode->type == ItemType::Search)
+        return ItemType::File;
+    else
+        return ItemType::Result;
+}
+
+SearchResultsModel::ResultLocation SearchResultsModel::resultLocation(const QModelIndex &index) const
+{
+    Q_ASSERT(itemType(index) == ItemType::Result);
+
+    const FileNode *file = static_cast<const FileNode *>(index.internalPointer());
+    const Result &result = file->results.at(index.row());
+
+    return {file->editor, file->filePath, lineOf(file, index.row()), result.startPositionFromBeginning, result.endPositionFromBeginning};
+}
+
+void SearchResultsModel::removeEntry(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+
+    flush();
+
+    const ItemType type = itemType(index);
+    const int row = index.row();
+
+    beginRemoveRows(index.parent(), row, row);
+
+    if (type == ItemType::Search) {
+        if (searches[row].get() == currentSearch) {
+            currentSearch = Q_NULLPTR;
+            currentFile = Q_NULLPTR;
+        }
+
+        searches.erase(searches.begin() + row);
+
+        for (int i = row; i < static_cast<int>(searches.size()); ++i) {
+            searches[i]->row = i;
+        }
+    }
+    else if (type == ItemType::File) {
+        SearchNode *search = static_cast<SearchNode *>(index.internalPointer());
+        FileNode *file = search->files[row].get();
+
+        if (file == currentFile)
+            currentFile = Q_NULLPTR;
+
+        search->totalHits -= file->totalHits;
+        search->files.erase(search->files.begin() + row);
+
+        for (int i = row; i < static_cast<int>(search->files.size()); ++i) {
+            search->files[i]->row = i;
+        }
+    }
+    else {
+        FileNode *file = static_cast<FileNode *>(index.internalPointer());
+        const int hitCount = file->results.at(row).hitCount;
+
+        file->totalHits -= hitCount;
+        file->search->totalHits -= hitCount;
+        removeResult(file, row);
+        file->visibleResults--;
+    }
+
+    endRemoveRows();
+
+    emitLabelsChanged();
+}
+
+void SearchResultsModel::clear()
+{
+    beginResetModel();
+
+    searches.clear();
+    currentSearch = Q_NULLPTR;
+    currentFile = Q_NULLPTR;
+    flushTimer.stop();
+
+    endResetModel();
+}
+
+void SearchResultsModel::writeText(const std::function<void(const QByteArray &)> &sink) const
+{
+    QByteArray chunk;
+    chunk.reserve(WRITE_CHUNK_SIZE * 2);
+    bool firstLine = true;
+
+    // The lines go between each other, there isn't one after the last
+    auto writeLine = [&](const QByteArray &first, const QString &second) {
+        if (!firstLine)
+            chunk.append('\n');
+        firstLine = false;
+
+        chunk.append(first);
+        chunk.append(' ');
+        chunk.append(second.toUtf8());
+
+        // Reserving the capacity up front means emptying it keeps the memory for the next chunk
+        if (chunk.size() >= WRITE_CHUNK_SIZE) {
+            sink(chunk);
+            chunk.resize(0);
+        }
+    };
+
+    for (const auto &search : searches) {
+        writeLine(searchLabel(search.get()).toUtf8(), QString());
+
+        for (const auto &file : search->files) {
+            writeLine(fileLabel(file.get()).toUtf8(), QString());
+
+            for (int row = 0; row < file->results.size(); ++row) {
+                writeLine(QByteArray::number(lineOf(file.get(), row) + 1), lineText(file.get(), row));
+            }
+        }
+    }
+
+    if (!chunk.isEmpty())
+        sink(chunk);
+}
+
+QModelIndex SearchResultsModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+
+    if (!parent.isValid())
+        return createIndex(row, column, Q_NULLPTR);
+
+    // The internal pointer is the node of the parent, which is enough to find the item itself
+    const ItemType parentType = itemType(parent);
+
+    if (parentType == ItemType::Search) {
+        return createIndex(row, column, searches[parent.row()].get());
+    }
+    else if (parentType == ItemType::File) {
+        const SearchNode *search = static_cast<const SearchNode *>(parent.internalPointer());
+        return createIndex(row, column, search->files[parent.row()].get());
+    }
+
+    return QModelIndex();
+}
+
+QModelIndex SearchResultsModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return QModelIndex();
+
+    return indexOf(static_cast<const Node *>(index.internalPointer()));
+}
+
+int SearchResultsModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return static_cast<int>(searches.size());
+
+    if (parent.column() > 0)
+        return 0;
+
+    const ItemType parentType = itemType(parent);
+
+    if (parentType == ItemType::Search) {
+        return static_cast<int>(searches[parent.row()]->files.size());
+    }
+    else if (parentType == ItemType::File) {
+        const SearchNode *search = static_cast<const SearchNode *>(parent.internalPointer());
+        return search->files[parent.row()]->visibleResults;
+    }
+
+    return 0;
+}
+
+int SearchResultsModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+
+    // The line number and the line's text
+    return 2;
+}
+
+QVariant SearchResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    const ItemType type = itemType(index);
+
+    if (type == ItemType::Search) {
+        const SearchNode *search = searches[index.row()].get();
+
+        if (role == Qt::DisplayRole && index.column() == 0)
+            return searchLabel(search);
+        else if (role == Qt::BackgroundRole)
+            return QBrush(QColor(232, 232, 255));
+        else if (role == Qt::ForegroundRole)
+            return QBrush(QColor(0, 0, 170));
+    }
+    else if (type == ItemType::File) {
+        const SearchNode *search = static_cast<const SearchNode *>(index.internalPointer());
+        const FileNode *file = search->files[index.row()].get();
+
+        if (role == Qt::DisplayRole && index.column() == 0)
+            return fileLabel(file);
+        else if (role == Qt::BackgroundRole)
+            return QBrush(QColor(213, 255, 213));
+        else if (role == Qt::ForegroundRole)
+            return QBrush(QColor(0, 128, 0));
+    }
+    else {
+        const FileNode *file = static_cast<const FileNode *>(index.internalPointer());
+
+        if (index.column() == 0) {
+            // Scintilla internally references line numbers starting at 0, however it needs displayed starting at 1
+            if (role == Qt::DisplayRole)
+                return QString::number(lineOf(file, index.row()) + 1);
+            else if (role == Qt::BackgroundRole)
+                return QBrush(QColor(220, 220, 220));
+            else if (role == Qt::TextAlignmentRole)
+                return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        else if (role == Qt::DisplayRole) {
+            return lineText(file, index.row());
+        }
+    }
+
+    return QVariant();
+}
+
+void SearchResultsModel::flush()
+{
+    flushTimer.stop();
+
+    if (currentFile && currentFile->visibleResults < currentFile->results.size()) {
+        beginInsertRows(indexOf(currentFile), currentFile->visibleResults, currentFile->results.size() - 1);
+        currentFile->visibleResults = currentFile->results.size();
+        endInsertRows();
+    }
+
+    emitLabelsChanged();
+}
+
+QModelIndex SearchResultsModel::indexOf(const Node *node) const
+{
+    if (node == Q_NULLPTR)
+        return QModelIndex();
+
+    if (node->type == ItemType::Search)
+        return createIndex(node->row, 0, Q_NULLPTR);
+
+    return createIndex(node->row, 0, static_cast<const FileNode *>(node)->search);
+}
+
+QString SearchResultsModel::searchLabel(const SearchNode *search) const
+{
+    return QStringLiteral("Search \"%1\" (%L2 hits in %L3 files)").arg(search->searchTerm).arg(search->totalHits).arg(static_cast<int>(search->files.size()));
+}
+
+QString SearchResultsModel::fileLabel(const FileNode *file) const
+{
+    return QStringLiteral("%1 (%L2 hits)").arg(file->filePath).arg(file->totalHits);
+}
+
+QString SearchResultsModel::lineText(const FileNode *file, int row) const
+{
+    const Result &result = file->results.at(row);
+
+    if (result.lineTextLength >= 0)
+        return file->search->lineTextArena.mid(result.lineTextOffset, result.lineTextLength);
+
+    ScintillaNext *editor = file->editor;
+    const int line = lineOf(file, row);
+
+    // The editor may no longer exist
+    if (editor == Q_NULLPTR || line >= editor->lineCount())
+        return QString();
+
+    // Only get the part of the line around the result, it could be megabytes of minified text
+    const int lineStart = editor->positionFromLine(line);
+    const int lineEnd = editor->lineEndPosition(line);
+    int textStart = qMax(lineStart, lineStart + result.startPositionFromBeginning - ISearchResultsHandler::LINE_TEXT_CONTEXT);
+    int textEnd = qMin(lineEnd, lineStart + result.endPositionFromBeginning + ISearchResultsHandler::LINE_TEXT_CONTEXT);
+
+    // Make sure not to split any characters
+    if (textStart > lineStart)
+        textStart = editor->positionAfter(editor->positionBefore(textStart));
+    if (textEnd < lineEnd)
+        textEnd = editor->positionBefore(editor->positionAfter(textEnd));
+
+    QString text = QString::fromUtf8(editor->get_text_range(textStart, qMax(textStart, textEnd)));
+
+    if (textStart > lineStart)
+        text.prepend(QStringLiteral("..."));
+    if (textEnd < lineEnd)
+        text.append(QStringLiteral("..."));
+
+    return text;
+}
+
+int SearchResultsModel::lineOf(const FileNode *file, int row) const
+{
+    return file->results.at(row).lineNumber + file->lineShifts.shiftOf(row);
+}
+
+int SearchResultsModel::firstResultFrom(const FileNode *file, int line, int column) const
+{
+    // The results are in the order they are in the file, and edits never change that
+    int first = 0;
+    int last = file->results.size();
+
+    while (first < last) {
+        const int middle = first + (last - first) / 2;
+        const int middleLine = lineOf(file, middle);
+
+        if (middleLine < line || (middleLine == line && file->results.at(middle).startPositionFromBeginning < column))
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+void SearchResultsModel::followEdit(FileNode *file, bool inserted, int position, int length, int linesAdded, const QByteArray &text)
+{
+    ScintillaNext *editor = file->editor;
+    const int count = file->results.size();
+
+    if (editor == Q_NULLPTR || count == 0)
+        return;
+
+    // Where the text starts, how many line ends are in it, and the column it ends at on its last line
+    const int line = static_cast<int>(editor->lineFromPosition(position));
+    const int column = position - static_cast<int>(editor->positionFromLine(line));
+    const int lines = qAbs(linesAdded);
+    int endColumn = column + length;
+
+    if (lines > 0) {
+        const int lastLineEnd = qMax(text.lastIndexOf('\n'), text.lastIndexOf('\r'));
+
+        if (text.size() != length || lastLineEnd < 0) {
+            stopFollowingEdits(file);
+            return;
+        }
+
+        endColumn = length - lastLineEnd - 1;
+    }
+
+    const int first = firstResultFrom(file, line, column);
+
+    if (inserted) {
+        // The rest of the line moves to the end of what was inserted, along with any results on it
+        for (int i = first; i < count && lineOf(file, i) == line; ++i) {
+            file->results[i].startPositionFromBeginning += endColumn - column;
+            file->results[i].endPositionFromBeginning += endColumn - column;
+        }
+
+        file->lineShifts.add(first, lines);
+    }
+    else {
+        const int after = firstResultFrom(file, line + lines, endColumn);
+
+        // Anything that was in the deleted text ends up where it was
+        for (int i = first; i < after; ++i) {
+            const int moved = line - lineOf(file, i);
+
+            file->results[i].startPositionFromBeginning = column;
+            file->results[i].endPositionFromBeginning = column;
+            file->lineShifts.add(i, moved);
+            file->lineShifts.add(i + 1, -moved);
+        }
+
+        // What was left of the last line joins the first
+        for (int i = after; i < count && lineOf(file, i) == line + lines; ++i) {
+            file->results[i].startPositionFromBeginning += column - endColumn;
+            file->results[i].endPositionFromBeginning += column - endColumn;
+        }
+
+        file->lineShifts.add(after, -lines);
+    }
+
+    if (first < file->visibleResults) {
+        const QModelIndex parent = indexOf(file);
+
+        emit dataChanged(index(first, 0, parent), index(file->visibleResults - 1, 1, parent), {Qt::DisplayRole});
+    }
+}
+
+void SearchResultsModel::stopFollowingEdits(FileNode *file)
+{
+    QObject::disconnect(file->edits);
+    QObject::disconnect(file->editsResumed);
+}
+
+void SearchResultsModel::removeResult(FileNode *file, int row)
+{
+    // A result can't be taken out of the middle of the tree, so every one takes on where it is now and it starts over
+    for (int i = 0; i < file->results.size(); ++i) {
+        file->results[i].lineNumber = lineOf(file, i);
+    }
+
+    file->results.remove(row);
+    file->lineShifts.clear();
+
+    for (int i = 0; i < file->results.size(); ++i) {
+        file->lineShifts.append();
+    }
+}
+
+void SearchResultsModel::scheduleFlush()
+{
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void SearchResultsModel::emitLabelsChanged()
+{
+    // The hit counts only show up in the search and file rows, so those are the only ones to update
+    if (currentSearch) {
+        const QModelIndex searchIndex = indexOf(currentSearch);
+        emit dataChanged(searchIndex, searchIndex, {Qt::DisplayRole});
+    }
+
+    if (currentFile) {
+        const QModelIndex fileIndex = indexOf(currentFile);
+        emit dataChanged(fileIndex, fileIndex, {Qt::DisplayRole});
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+class ScintillaNext;
+
+// Holds every search shown in the SearchResultsDock as a three level tree: searches, the files
+// within them, and the individual results. Results are kept in compact arrays and only turned into
+// text when the view asks for them, and new rows are announced to the view in batches. Results in an
+// open editor follow the text they were found in as it is edited, so they don't need searching again.
+class SearchResultsModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum class ItemType { Search, File, Result };
+
+    struct ResultLocation
+    {
+        QPointer<ScintillaNext> editor;
+        QString filePath;
+        int lineNumber;
+        int startPositionFromBeginning;
+        int endPositionFromBeginning;
+    };
+
+    explicit SearchResultsModel(QObject *parent = nullptr);
+    ~SearchResultsModel() override;
+
+    void newSearch(const QString &searchTerm);
+    void newFileEntry(ScintillaNext *editor, const QString &filePath);
+    void newResultsEntry(const QString &line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount);
+    void completeSearch();
+
+    ItemType itemType(const QModelIndex &index) const;
+    ResultLocation resultLocation(const QModelIndex &index) const;
+
+    void removeEntry(const QModelIndex &index);
+    void clear();
+
+    // Writes every search, file and result out a line at a time the way they read in the view. It is handed to the
+    // sink in chunks as it goes, so the whole thing is never held as one string.
+    void writeText(const std::function<void(const QByteArray &)> &sink) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+public slots:
+    // Lets the view know about anything added since the last time
+    void flush();
+
+private:
+    struct Node
+    {
+        ItemType type;
+        int row;
+    };
+
+    struct Result
+    {
+        int lineNumber;
+        int startPositionFromBeginning;
+        int endPositionFromBeginning;
+        int hitCount;
+        int lineTextLength; // -1 if the text is fetched from the editor instead
+        qsizetype lineTextOffset;
+    };
+
+    // How many lines each result has moved since it was found. It is a Fenwick tree of how much further each result
+    // moved than the one before it, so moving every result after an edit is one update and finding out where one
+    // is now is one query, both O(log n).
+    class LineShifts
+    {
+    public:
+        // The new result is at the end and hasn't moved
+        void append();
+
+        // Moves the results from first on
+        void add(int first, int lines);
+
+        int shiftOf(int index) const;
+        void clear() { tree.clear(); }
+
+    private:
+        int prefix(int count) const;
+
+        std::vector<int> tree;
+    };
+
+    struct SearchNode;
+
+    struct FileNode : Node
+    {
+        ~FileNode();
+
+        SearchNode *search;
+        QPointer<ScintillaNext> editor;
+        QString filePath;
+        QVector<Result> results;
+        LineShifts lineShifts; // Result::lineNumber is where it was found, add these to find where it is now
+        QMetaObject::Connection edits;
+        QMetaObject::Connection editsResumed;
+        int visibleResults = 0; // how many of the results the view knows about
+        int totalHits = 0;
+    };
+
+    struct SearchNode : Node
+    {
+        QString searchTerm;
+        std::vector<std::unique_ptr<FileNode>> files;
+        QString lineTextArena; // the text of every result's line, back to back
+        int totalHits = 0;
+    };
+
+    QModelIndex indexOf(const Node *node) const;
+    QString searchLabel(const SearchNode *search) const;
+    QString fileLabel(const FileNode *file) const;
+    QString lineText(const FileNode *file, int row) const;
+
+    int lineOf(const FileNode *file, int row) const;
+    int firstResultFrom(const FileNode *file, int line, int column) const;
+    void followEdit(FileNode *file, bool inserted, int position, int length, int linesAdded, const QByteArray &text);
+    void stopFollowingEdits(FileNode *file);
+    void removeResult(FileNode *file, int row);
+    void scheduleFlush();
+    void emitLabelsChanged();
+
+    std::vector<std::unique_ptr<SearchNode>> searches;
+    SearchNode *currentSearch = Q_NULLPTR;
+    FileNode *currentFile = Q_NULLPTR;
+
+    QTimer flushTimer;
+};
@@ -62,3 +62,27 @@ void SelectionTracker::trackDeletion(int pos, int length)
         anchor -= qMin(static_cast<int>(anchor - pos), length);
     }
 }
+
+void SelectionTracker::trackReplacements(const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements)
+{
+    auto replacementLength = [&](size_t i) {
+        return replacements.size() == 1 ? replacements.first().length() : replacements.at(static_cast<int>(i)).length();
+    };
+
+    auto map = [&](int position) {
+        qint64 offset = 0;
+
+        for (size_t i = 0; i < ranges.size() && ranges[i].cpMin <= position; ++i) {
+            // Anything inside of a deleted range ends up after the text that replaced it
+            if (position < ranges[i].cpMax)
+                return static_cast<int>(ranges[i].cpMin + offset + replacementLength(i));
+
+            offset += replacementLength(i) - (ranges[i].cpMax - ranges[i].cpMin);
+        }
+
+        return static_cast<int>(position + offset);
+    };
+
+    caret = map(caret);
+    anchor = map(anchor);
+}
@@ -20,6 +20,13 @@
 #ifndef SELECTIONTRACKER_H
 #define SELECTIONTRACKER_H
 
+#include <QByteArray>
+#include <QVector>
+
+#include <vector>
+
+#include "Scintilla.h"
+
 class ScintillaNext;
 
 class SelectionTracker
@@ -31,6 +38,11 @@ public:
     void trackInsertion(int pos, int length);
     void trackDeletion(int pos, int length);
 
+    // The same as tracking each replacement as a deletion followed by an insertion, in order, but all at once.
+    // The ranges are sorted, don't overlap, and are positions from before any of them were replaced. See
+    // ScintillaNext::replaceRanges() for how replacements pairs up with them.
+    void trackReplacements(const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements);
+
 private:
     void saveSelection();
     void restoreSelection();
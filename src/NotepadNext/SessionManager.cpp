@@ -18,22 +18,52 @@
 
 
 #include "BookMarkDecorator.h"
+#include "EditJournal.h"
 #include "ScintillaNext.h"
 #include "MainWindow.h"
 #include "SessionManager.h"
 #include "EditorManager.h"
 #include "NotepadNextApplication.h"
 
+#include <QCoreApplication>
+#include <QDataStream>
 #include <QDir>
+#include <QSaveFile>
+#include <QSemaphore>
 #include <QStandardPaths>
+#include <QTextCodec>
+#include <QThreadPool>
 #include <QUuid>
 
+#include <limits>
+
+
+// Bump the version whenever what is written to the manifest changes
+const quint32 SESSION_MANIFEST_MAGIC = 0x4E4E534D; // "NNSM"
+const qint32 SESSION_MANIFEST_VERSION = 2;
+const QDataStream::Version SESSION_MANIFEST_STREAM_VERSION = QDataStream::Qt_5_12;
+
+// What the one set of editors there is until another workspace is made is called
+const QString DEFAULT_WORKSPACE_NAME = QStringLiteral("Default");
 
 static QString RandomSessionFileName()
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
 
+// Written to a temporary file first and only then swapped in, so a crash while writing never breaks the previous copy
+static bool writeSessionFile(const QString &filePath, const char *data, qint64 length)
+{
+    QSaveFile file(filePath);
+
+    if (file.open(QIODevice::WriteOnly) && file.write(data, length) == length && file.commit()) {
+        return true;
+    }
+
+    qWarning("writeSessionFile() failure code %d: %s", file.error(), qPrintable(file.errorString()));
+    return false;
+}
+
 // QList<int> cannot be automatically serialized to/from QSettings (i.e. QVariant) so turn it to a QVariantList
 static QVariantList QListToQVariantList(const QList<int> intList)
 {
@@ -54,7 +84,8 @@ static QList<int> QVariantListToQList(const QVariantList &variantList) {
 }
 
 SessionManager::SessionManager(NotepadNextApplication *app, SessionFileTypes types)
-    : app(app)
+    : app(app),
+      workspaceName(DEFAULT_WORKSPACE_NAME)
 {
     setSessionFileTypes(types);
 }
@@ -62,6 +93,42 @@ SessionManager::SessionManager(NotepadNextApplication *app, SessionFileTypes typ
 void SessionManager::setSessionFileTypes(SessionFileTypes types)
 {
     fileTypes = types;
+
+    // The journals are only any use if unsaved files are restored
+    for (EditJournal *journal : qAsConst(journals)) {
+        if (journal) {
+            journal->setEnabled(fileTypes.testFlag(SessionManager::UnsavedFile));
+        }
+    }
+}
+
+void SessionManager::journalEditor(ScintillaNext *editor)
+{
+    // The document belongs to the editor it came from, which keeps the journal
+    if (editor->isClone()) {
+        return;
+    }
+
+    EditJournal *journal = new EditJournal(editor, sessionDirectory().filePath(RandomSessionFileName() + ".journal"));
+
+    journal->setEnabled(fileTypes.testFlag(SessionManager::UnsavedFile));
+    journals.insert(editor, journal);
+}
+
+bool SessionManager::isJournaled(const ScintillaNext *editor) const
+{
+    const EditJournal *journal = journals.value(editor);
+
+    return journal != Q_NULLPTR && journal->isUsable();
+}
+
+QString SessionManager::sessionManifestPath() const
+{
+    QDir d(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+
+    d.mkpath(".");
+
+    return d.filePath("session.manifest");
 }
 
 QDir SessionManager::sessionDirectory() const
@@ -74,15 +141,134 @@ QDir SessionManager::sessionDirectory() const
     return d;
 }
 
-void SessionManager::saveIntoSessionDirectory(ScintillaNext *editor, const QString &sessionFileName) const
+SessionManager::SessionFile &SessionManager::sessionFileFor(ScintillaNext *editor)
 {
-    editor->saveCopyAs(sessionDirectory().filePath(sessionFileName));
+    auto it = sessionFiles.find(editor);
+
+    if (it != sessionFiles.end() && it->editor != editor) {
+        sessionFiles.erase(it);
+        it = sessionFiles.end();
+    }
+
+    if (it == sessionFiles.end()) {
+        SessionFile sessionFile;
+        sessionFile.editor = editor;
+        sessionFile.fileName = RandomSessionFileName();
+
+        it = sessionFiles.insert(editor, sessionFile);
+    }
+
+    sessionFilesInUse.insert(it->fileName);
+
+    return it.value();
+}
+
+bool SessionManager::isUpToDate(const SessionFile &sessionFile, const QDir &directory) const
+{
+    // Nothing was typed since the last snapshot, so the copy already there is still good
+    return sessionFile.upToDate && sessionFile.generation == sessionFile.editor->changeGeneration() && directory.exists(sessionFile.fileName);
+}
+
+void SessionManager::saveIntoSessionDirectory(ScintillaNext *editor)
+{
+    const QDir directory = sessionDirectory();
+    SessionFile &sessionFile = sessionFileFor(editor);
+
+    if (isUpToDate(sessionFile, directory)) {
+        return;
+    }
+
+    qDebug("Writing session file \"%s\"", qUtf8Printable(sessionFile.fileName));
+
+    sessionFile.generation = editor->changeGeneration();
+    sessionFile.upToDate = writeSessionFile(directory.filePath(sessionFile.fileName), reinterpret_cast<const char *>(editor->characterPointer()), editor->textLength());
+}
+
+void SessionManager::rememberSessionFile(ScintillaNext *editor, const QString &sessionFileName)
+{
+    // The editor was just read from this file, so it doesn't need writing again until something changes
+    SessionFile sessionFile;
+    sessionFile.editor = editor;
+    sessionFile.fileName = sessionFileName;
+    sessionFile.generation = editor->changeGeneration();
+    sessionFile.upToDate = true;
+
+    sessionFiles.insert(editor, sessionFile);
+}
+
+void SessionManager::restoreOnceLoaded(ScintillaNext *editor, const QVariantMap &entry, std::function<void()> restore)
+{
+    // Until then the entry is the only thing that knows about the editor, so it goes back into the session as it is
+    DeferredEditor deferredEditor;
+    deferredEditor.editor = editor;
+    deferredEditor.entry = entry;
+
+    deferredEditors.insert(editor, deferredEditor);
+
+    std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+
+    *connection = QObject::connect(editor, &ScintillaNext::loadingFinished, editor, [=]() {
+        QObject::disconnect(*connection);
+
+        deferredEditors.remove(editor);
+
+        restore();
+    });
+}
+
+bool SessionManager::isDeferred(const ScintillaNext *editor) const
+{
+    auto it = deferredEditors.constFind(editor);
+
+    return it != deferredEditors.constEnd() && it->editor == editor;
+}
+
+void SessionManager::waitForAutoSave()
+{
+    if (autoSaveDone) {
+        autoSaveDone->acquire();
+        autoSaveDone.reset();
+    }
+
+    // Anything the auto save was going to do afterwards is out of date now
+    ++autoSaveRun;
+}
+
+QVector<ScintillaNext *> SessionManager::editorsWithSessionFiles(MainWindow *window) const
+{
+    QVector<ScintillaNext *> editors;
+
+    for (ScintillaNext *editor : window->editors()) {
+        const SessionFileType editorType = determineType(editor);
+
+        // Anything not loaded yet still has the session file it came from
+        if (isDeferred(editor)) {
+            continue;
+        }
+
+        // The file itself and its journal are all that is needed
+        if (editorType == SessionManager::UnsavedFile && isJournaled(editor)) {
+            continue;
+        }
+
+        if ((editorType == SessionManager::UnsavedFile || editorType == SessionManager::TempFile) && fileTypes.testFlag(editorType)) {
+            editors.append(editor);
+        }
+    }
+
+    return editors;
 }
 
 SessionManager::SessionFileType SessionManager::determineType(ScintillaNext *editor) const
 {
+    // The document is stored with the editor it came from
+    if (editor->isClone()) {
+        return SessionManager::None;
+    }
+
     if (editor->isFile()) {
-        if (editor->isSavedToDisk()) {
+        // While it is still loading the buffer only holds part of what is on disk, so it is not worth keeping a copy of
+        if (editor->isSavedToDisk() || editor->isLoading()) {
             return SessionManager::SavedFile;
         }
         else {
@@ -99,10 +285,13 @@ SessionManager::SessionFileType SessionManager::determineType(ScintillaNext *edi
     }
 }
 
-void SessionManager::clear() const
+void SessionManager::clear()
 {
     clearSettings();
     clearDirectory();
+    QFile::remove(sessionManifestPath());
+
+    sessionFiles.clear();
 }
 
 void SessionManager::clearSettings() const
@@ -114,12 +303,14 @@ void SessionManager::clearSettings() const
     settings.remove("");
 }
 
-void SessionManager::clearDirectory() const
+void SessionManager::clearDirectory(const QSet<QString> &keep) const
 {
     QDir d = sessionDirectory();
 
-    for (const QString &f : d.entryList()) {
-        d.remove(f);
+    for (const QString &f : d.entryList(QDir::Files)) {
+        if (!keep.contains(f)) {
+            d.remove(f);
+        }
     }
 }
 
@@ -127,88 +318,399 @@ void SessionManager::saveSession(MainWindow *window)
 {
     qInfo(Q_FUNC_INFO);
 
-    clear();
+    // It can't be writing the same files at the same time
+    waitForAutoSave();
+
+    // Early out if no flags are set, unless there are other workspaces to keep
+    if (fileTypes == SessionManager::None && workspaces.isEmpty()) {
+        clear();
+        return;
+    }
+
+    // Files in the session directory are only written for editors that changed since the last time, the rest are left alone
+    for (ScintillaNext *editor : editorsWithSessionFiles(window)) {
+        saveIntoSessionDirectory(editor);
+    }
+
+    // Anything still waiting to go into a journal has to be on disk before the session relies on it
+    for (EditJournal *journal : qAsConst(journals)) {
+        if (journal) {
+            journal->flush();
+        }
+    }
+
+    EditJournal::waitForWrites();
+
+    writeSessionManifest(window);
+    removeUnusedSessionFiles();
+}
+
+void SessionManager::autoSaveSession(MainWindow *window)
+{
+    qInfo(Q_FUNC_INFO);
+
+    // Still busy writing the last one
+    if (autoSaveDone) {
+        return;
+    }
 
-    // Early out if no flags are set
     if (fileTypes == SessionManager::None) {
         return;
     }
 
-    const ScintillaNext *currentEditor = window->currentEditor();
-    int currentEditorIndex = 0;
-    ApplicationSettings settings;;
+    struct PendingWrite {
+        QPointer<ScintillaNext> editor;
+        QString filePath;
+        QByteArray text;
+        quint64 generation;
+    };
 
-    settings.beginGroup("CurrentSession");
+    const QDir directory = sessionDirectory();
+    QVector<PendingWrite> pendingWrites;
+    bool writtenHere = true;
 
-    settings.beginWriteArray("OpenedFiles");
+    for (ScintillaNext *editor : editorsWithSessionFiles(window)) {
+        const SessionFile &sessionFile = sessionFileFor(editor);
+
+        if (!isUpToDate(sessionFile, directory)) {
+            const qint64 length = editor->textLength();
+
+            // Too big to copy into a QByteArray, so it gets written straight out of the editor like it does on exit
+            if (length > std::numeric_limits<int>::max()) {
+                saveIntoSessionDirectory(editor);
+                writtenHere = writtenHere && sessionFileFor(editor).upToDate;
+                continue;
+            }
+
+            // Copying the text is quick, it is writing it out that is slow and that happens on the worker
+            const QByteArray text(reinterpret_cast<const char *>(editor->characterPointer()), static_cast<int>(length));
+
+            pendingWrites.append({editor, directory.filePath(sessionFile.fileName), text, editor->changeGeneration()});
+        }
+    }
+
+    const quint64 run = ++autoSaveRun;
+    QPointer<MainWindow> w = window;
+
+    // The manifest only gets updated once every file it mentions is on disk, so a crash part way
+    // through still leaves a session that can be restored
+    auto finish = [=](const QVector<bool> &written) {
+        if (run != autoSaveRun || w.isNull()) {
+            return;
+        }
+
+        autoSaveDone.reset();
+
+        for (int i = 0; i < pendingWrites.size(); ++i) {
+            ScintillaNext *editor = pendingWrites[i].editor;
+            auto it = sessionFiles.find(editor);
+
+            if (editor && it != sessionFiles.end() && it->editor == editor) {
+                it->generation = pendingWrites[i].generation;
+                it->upToDate = written[i];
+            }
+        }
+
+        // The manifest on disk still points at the last good copies, so it is kept until the next run writes them all
+        if (!writtenHere || written.contains(false)) {
+            qWarning("Not updating the session manifest since some session files could not be written");
+            return;
+        }
+
+        writeSessionManifest(w);
+        removeUnusedSessionFiles();
+    };
+
+    if (pendingWrites.isEmpty()) {
+        finish(QVector<bool>());
+        return;
+    }
+
+    qDebug("Auto saving %d session files", static_cast<int>(pendingWrites.size()));
+
+    std::shared_ptr<QSemaphore> done = std::make_shared<QSemaphore>(0);
+    autoSaveDone = done;
+
+    QThreadPool::globalInstance()->start([=]() {
+        QVector<bool> written;
+
+        for (const PendingWrite &pendingWrite : pendingWrites) {
+            written.append(writeSessionFile(pendingWrite.filePath, pendingWrite.text.constData(), pendingWrite.text.size()));
+        }
+
+        done->release();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            finish(written);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QVector<QVariantMap> SessionManager::sessionEntries(MainWindow *window, SessionFileTypes types, bool useJournals, qint32 &currentEditorIndex)
+{
+    const ScintillaNext *currentEditor = window->currentEditor();
+    QVector<QVariantMap> entries;
+
+    currentEditorIndex = 0;
 
-    int index = 0;
     for (const auto &editor : window->editors()) {
         SessionFileType editorType = determineType(editor);
 
-        if (fileTypes.testFlag(editorType)) {
-            settings.setArrayIndex(index);
+        if (types.testFlag(editorType)) {
+            QVariantMap entry;
 
-            if (editorType == SessionManager::SavedFile) {
-                storeFileDetails(editor, settings);
+            if (isDeferred(editor)) {
+                // Nothing about it could have changed since it was restored
+                entry = deferredEditors.value(editor).entry;
+            }
+            else if (editorType == SessionManager::SavedFile) {
+                storeFileDetails(editor, entry);
             }
             else if (editorType == SessionManager::UnsavedFile) {
-                storeUnsavedFileDetails(editor, settings);
+                storeUnsavedFileDetails(editor, entry, useJournals);
             }
             else if (editorType == SessionManager::TempFile) {
-                storeTempFile(editor, settings);
+                storeTempFile(editor, entry);
             }
             else {
                 qWarning("Unknown SessionFileType %d", editorType);
             }
 
             if (currentEditor == editor) {
-                currentEditorIndex = index;
+                currentEditorIndex = static_cast<qint32>(entries.size());
             }
 
-            ++index;
+            entries.append(entry);
         }
     }
 
-    settings.endArray();
+    return entries;
+}
+
+void SessionManager::keepSessionFilesOf(const QVariantMap &entry)
+{
+    if (entry.contains("SessionFileName")) {
+        sessionFilesInUse.insert(entry.value("SessionFileName").toString());
+    }
+
+    if (entry.contains("JournalFileName")) {
+        sessionFilesInUse.insert(entry.value("JournalFileName").toString());
+    }
+}
+
+void SessionManager::writeSessionManifest(MainWindow *window)
+{
+    sessionFilesInUse.clear();
+
+    qint32 currentEditorIndex = 0;
+    const QVector<QVariantMap> entries = sessionEntries(window, fileTypes, true, currentEditorIndex);
+
+    // What the other workspaces and any editor that hasn't been read yet will need is kept as well, even if this
+    // session wouldn't keep it
+    for (const Workspace &workspace : qAsConst(workspaces)) {
+        for (const QVariantMap &entry : workspace.entries) {
+            keepSessionFilesOf(entry);
+        }
+    }
+
+    for (const ScintillaNext *editor : window->editors()) {
+        if (isDeferred(editor)) {
+            keepSessionFilesOf(deferredEditors.value(editor).entry);
+        }
+    }
+
+    QByteArray manifest;
+    QDataStream stream(&manifest, QIODevice::WriteOnly);
+
+    stream.setVersion(SESSION_MANIFEST_STREAM_VERSION);
+    stream << SESSION_MANIFEST_MAGIC << SESSION_MANIFEST_VERSION << currentEditorIndex << entries;
+    stream << workspaceName << static_cast<qint32>(workspaces.size());
+
+    for (auto it = workspaces.constBegin(); it != workspaces.constEnd(); ++it) {
+        stream << it.key() << it->currentEditorIndex << it->entries;
+    }
+
+    // The whole thing is built in memory first so it is written out in one go, and replaces the old one only once it is complete
+    QSaveFile file(sessionManifestPath());
+
+    if (!(file.open(QIODevice::WriteOnly) && file.write(manifest) == manifest.size() && file.commit())) {
+        qWarning("Failed to write session manifest, error code %d: %s", file.error(), qPrintable(file.errorString()));
+        return;
+    }
+
+    // Now that the manifest is there, the session from older versions is not needed any more
+    if (hasLegacySessionSettings) {
+        clearSettings();
+        hasLegacySessionSettings = false;
+    }
+}
+
+bool SessionManager::readSessionManifest(int &currentEditorIndex, QVector<QVariantMap> &entries)
+{
+    QFile file(sessionManifestPath());
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    qint32 version = 0;
+    qint32 index = 0;
+    QString name = DEFAULT_WORKSPACE_NAME;
+    QMap<QString, Workspace> stored;
+
+    stream.setVersion(SESSION_MANIFEST_STREAM_VERSION);
+    stream >> magic >> version;
+
+    // Version 1 only had the one set of editors
+    if (magic != SESSION_MANIFEST_MAGIC || version < 1 || version > SESSION_MANIFEST_VERSION) {
+        qWarning("Unknown session manifest format (version %d)", version);
+        return false;
+    }
 
-    settings.setValue("CurrentEditorIndex", currentEditorIndex);
+    stream >> index >> entries;
+
+    if (version >= 2) {
+        qint32 count = 0;
+
+        stream >> name >> count;
+
+        for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QString workspace;
+            Workspace details;
+
+            stream >> workspace >> details.currentEditorIndex >> details.entries;
+            stored.insert(workspace, details);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning("Session manifest is corrupt");
+        entries.clear();
+        return false;
+    }
+
+    currentEditorIndex = index;
+    workspaceName = name;
+    workspaces = stored;
+
+    return true;
+}
+
+bool SessionManager::readLegacySessionSettings(int &currentEditorIndex, QVector<QVariantMap> &entries)
+{
+    ApplicationSettings settings;;
+
+    if (!settings.childGroups().contains("CurrentSession")) {
+        return false;
+    }
+
+    hasLegacySessionSettings = true;
+
+    settings.beginGroup("CurrentSession");
+
+    currentEditorIndex = settings.value("CurrentEditorIndex").toInt();
+    const int size = settings.beginReadArray("OpenedFiles");
+
+    for (int index = 0; index < size; ++index) {
+        settings.setArrayIndex(index);
+
+        QVariantMap entry;
+
+        for (const QString &key : settings.childKeys()) {
+            entry.insert(key, settings.value(key));
+        }
+
+        entries.append(entry);
+    }
+
+    settings.endArray();
 
     settings.endGroup();
+
+    return true;
+}
+
+void SessionManager::removeUnusedSessionFiles()
+{
+    // Forget about editors that are closed or no longer part of the session, and remove their files
+    for (auto it = sessionFiles.begin(); it != sessionFiles.end();) {
+        if (it->editor.isNull() || !sessionFilesInUse.contains(it->fileName)) {
+            it = sessionFiles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto it = deferredEditors.begin(); it != deferredEditors.end();) {
+        if (it->editor.isNull()) {
+            it = deferredEditors.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // A journal that is still being kept carries on being written to, even if the session doesn't need it right now
+    QSet<QString> keep = sessionFilesInUse;
+
+    for (auto it = journals.begin(); it != journals.end();) {
+        if (it->isNull()) {
+            it = journals.erase(it);
+        }
+        else {
+            if ((*it)->isUsable()) {
+                keep.insert(QFileInfo((*it)->filePath()).fileName());
+            }
+
+            ++it;
+        }
+    }
+
+    clearDirectory(keep);
 }
 
 void SessionManager::loadSession(MainWindow *window)
 {
     qInfo(Q_FUNC_INFO);
 
-    ApplicationSettings settings;;
+    int currentEditorIndex = 0;
+    QVector<QVariantMap> entries;
 
-    settings.beginGroup("CurrentSession");
+    if (!readSessionManifest(currentEditorIndex, entries)) {
+        readLegacySessionSettings(currentEditorIndex, entries);
+    }
+
+    restoreEntries(window, currentEditorIndex, entries, true);
+}
 
+void SessionManager::restoreEntries(MainWindow *window, int currentEditorIndex, const QVector<QVariantMap> &entries, bool loadInBackground)
+{
     ScintillaNext *currentEditor = Q_NULLPTR;
-    const int currentEditorIndex = settings.value("CurrentEditorIndex").toInt();
-    const int size = settings.beginReadArray("OpenedFiles");
+    QList<QPointer<ScintillaNext>> deferred;
 
     // NOTE: In theory the fileTypes should determine what is loaded, however if the session fileTypes
     // change from the last time it was saved then it means the settings were manually altered outside of the app,
     // which is non-standard behavior, so just load anything in the file
 
-    for (int index = 0; index < size; ++index) {
-        settings.setArrayIndex(index);
+    for (int index = 0; index < entries.size(); ++index) {
+        const QVariantMap &entry = entries[index];
 
         ScintillaNext *editor = Q_NULLPTR;
 
-        if (settings.contains("Type")) {
-            const QString type = settings.value("Type").toString();
+        if (entry.contains("Type")) {
+            const QString type = entry.value("Type").toString();
 
             if (type == QStringLiteral("File")) {
-                editor = loadFileDetails(settings);
+                editor = loadFileDetails(entry);
             }
             else if (type == QStringLiteral("UnsavedFile")) {
-                editor = loadUnsavedFileDetails(settings);
+                editor = loadUnsavedFileDetails(entry);
             }
             else if (type == QStringLiteral("Temp")) {
-                editor = loadTempFile(settings);
+                editor = loadTempFile(entry);
             }
             else {
                 qDebug("Unknown session entry type: %s", qUtf8Printable(type));
@@ -218,6 +720,10 @@ void SessionManager::loadSession(MainWindow *window)
                  if (currentEditorIndex == index) {
                     currentEditor = editor;
                 }
+
+                if (editor->isLoadDeferred()) {
+                    deferred.append(editor);
+                }
             }
         }
         else {
@@ -225,13 +731,78 @@ void SessionManager::loadSession(MainWindow *window)
         }
     }
 
-    settings.endArray();
-
-    settings.endGroup();
-
     if (currentEditor) {
         window->switchToEditor(currentEditor);
     }
+
+    // The editors that are visible load as soon as they are shown, the rest get read a bit at a time afterwards
+    if (loadInBackground) {
+        app->getEditorManager()->loadDeferredEditors(deferred);
+    }
+}
+
+QStringList SessionManager::workspaceNames() const
+{
+    QStringList names = workspaces.keys();
+
+    names.append(workspaceName);
+    names.sort(Qt::CaseInsensitive);
+
+    return names;
+}
+
+bool SessionManager::storeWorkspace(MainWindow *window)
+{
+    qInfo(Q_FUNC_INFO);
+
+    // It can't be writing the same files at the same time
+    waitForAutoSave();
+
+    // Every file has to go in whatever the session would keep, since the editors are about to be closed. Unsaved
+    // files get a copy rather than a journal, the file could well be changed from another workspace before this
+    // one is opened again.
+    const SessionFileTypes allTypes = SessionManager::SavedFile | SessionManager::UnsavedFile | SessionManager::TempFile;
+    const QDir directory = sessionDirectory();
+
+    for (ScintillaNext *editor : window->editors()) {
+        const SessionFileType editorType = determineType(editor);
+
+        if ((editorType == SessionManager::UnsavedFile || editorType == SessionManager::TempFile) && !isDeferred(editor)) {
+            saveIntoSessionDirectory(editor);
+
+            if (!isUpToDate(sessionFileFor(editor), directory)) {
+                qWarning("Unable to keep \"%s\" in the workspace", qUtf8Printable(editor->getName()));
+                return false;
+            }
+        }
+    }
+
+    Workspace workspace;
+    workspace.entries = sessionEntries(window, allTypes, false, workspace.currentEditorIndex);
+
+    workspaces.insert(workspaceName, workspace);
+
+    return true;
+}
+
+void SessionManager::restoreWorkspace(MainWindow *window, const QString &name)
+{
+    qInfo(Q_FUNC_INFO);
+
+    const Workspace workspace = workspaces.take(name);
+
+    workspaceName = name;
+
+    // Only the tabs that get shown read their files, so it takes as long no matter how many there are
+    restoreEntries(window, workspace.currentEditorIndex, workspace.entries, false);
+
+    writeSessionManifest(window);
+    removeUnusedSessionFiles();
+}
+
+void SessionManager::removeWorkspace(const QString &name)
+{
+    workspaces.remove(name);
 }
 
 bool SessionManager::willFileGetStoredInSession(ScintillaNext *editor) const
@@ -242,19 +813,19 @@ bool SessionManager::willFileGetStoredInSession(ScintillaNext *editor) const
     return fileTypes.testFlag(editorType);
 }
 
-void SessionManager::storeFileDetails(ScintillaNext *editor, QSettings &settings)
+void SessionManager::storeFileDetails(ScintillaNext *editor, QVariantMap &entry)
 {
-    settings.setValue("Type", "File");
-    settings.setValue("FilePath", editor->getFilePath());
+    entry.insert("Type", "File");
+    entry.insert("FilePath", editor->getFilePath());
 
-    storeEditorViewDetails(editor, settings);
+    storeEditorViewDetails(editor, entry);
 }
 
-ScintillaNext* SessionManager::loadFileDetails(QSettings &settings)
+ScintillaNext* SessionManager::loadFileDetails(const QVariantMap &entry)
 {
     qInfo(Q_FUNC_INFO);
 
-    const QString filePath = settings.value("FilePath").toString();
+    const QString filePath = entry.value("FilePath").toString();
 
     qDebug("Session file: \"%s\"", qUtf8Printable(filePath));
 
@@ -265,11 +836,13 @@ ScintillaNext* SessionManager::loadFileDetails(QSettings &settings)
     }
 
     if (QFileInfo::exists(filePath)) {
-        editor = ScintillaNext::fromFile(filePath);
+        editor = ScintillaNext::deferredFromFile(filePath);
 
         app->getEditorManager()->manageEditor(editor);
 
-        loadEditorViewDetails(editor, settings);
+        restoreOnceLoaded(editor, entry, [=]() {
+            loadEditorViewDetails(editor, entry);
+        });
 
         return editor;
     }
@@ -279,29 +852,41 @@ ScintillaNext* SessionManager::loadFileDetails(QSettings &settings)
     }
 }
 
-void SessionManager::storeUnsavedFileDetails(ScintillaNext *editor, QSettings &settings)
+void SessionManager::storeUnsavedFileDetails(ScintillaNext *editor, QVariantMap &entry, bool useJournal)
 {
-    const QString sessionFileName = RandomSessionFileName();
+    entry.insert("Type", "UnsavedFile");
+    entry.insert("FilePath", editor->getFilePath());
 
-    settings.setValue("Type", "UnsavedFile");
-    settings.setValue("FilePath", editor->getFilePath());
-    settings.setValue("SessionFileName", sessionFileName);
+    // The journal already has everything that changed, so there is no need for a copy of the whole file
+    if (useJournal && isJournaled(editor)) {
+        const QString journalFileName = QFileInfo(journals.value(editor)->filePath()).fileName();
 
-    storeEditorViewDetails(editor, settings);
+        entry.insert("JournalFileName", journalFileName);
+        sessionFilesInUse.insert(journalFileName);
+    }
+    else {
+        entry.insert("SessionFileName", sessionFileFor(editor).fileName);
+    }
+
+    // The session copy is always UTF-8, so remember what the real file gets saved as
+    if (editor->getEncoding())
+        entry.insert("Encoding", editor->getEncoding()->name());
+    entry.insert("ByteOrderMark", editor->hasByteOrderMark());
 
-    saveIntoSessionDirectory(editor, sessionFileName);
+    storeEditorViewDetails(editor, entry);
 }
 
-ScintillaNext *SessionManager::loadUnsavedFileDetails(QSettings &settings)
+ScintillaNext *SessionManager::loadUnsavedFileDetails(const QVariantMap &entry)
 {
     qInfo(Q_FUNC_INFO);
 
-    const QString filePath = settings.value("FilePath").toString();
-    const QString sessionFileName = settings.value("SessionFileName").toString();
+    const QString filePath = entry.value("FilePath").toString();
+    const QString sessionFileName = entry.value("SessionFileName").toString();
     const QString sessionFilePath = sessionDirectory().filePath(sessionFileName);
+    const QString journalFileName = entry.value("JournalFileName").toString();
 
     qDebug("Session file: \"%s\"", qUtf8Printable(filePath));
-    qDebug("  temp loc: \"%s\"", qUtf8Printable(sessionFilePath));
+    qDebug("  temp loc: \"%s\"", qUtf8Printable(journalFileName.isEmpty() ? sessionFilePath : sessionDirectory().filePath(journalFileName)));
 
     ScintillaNext *editor = app->getEditorManager()->getEditorByFilePath(filePath);
     if (editor != Q_NULLPTR) {
@@ -309,17 +894,44 @@ ScintillaNext *SessionManager::loadUnsavedFileDetails(QSettings &settings)
         return Q_NULLPTR;
     }
 
+    // The file is opened as it is and the changes made to it are played back once it has been read
+    if (!journalFileName.isEmpty() && QFileInfo::exists(filePath)) {
+        ScintillaNext *editor = ScintillaNext::deferredFromFile(filePath);
+        const QString journalFilePath = sessionDirectory().filePath(journalFileName);
+
+        app->getEditorManager()->manageEditor(editor);
+
+        restoreOnceLoaded(editor, entry, [=]() {
+            // Replaying it records the same changes in the editor's own journal, which takes over from this one
+            if (EditJournal::replay(editor, journalFilePath) && journals.value(editor)) {
+                journals.value(editor)->flush();
+            }
+
+            editor->setEncoding(QTextCodec::codecForName(entry.value("Encoding").toByteArray()), entry.value("ByteOrderMark").toBool());
+
+            loadEditorViewDetails(editor, entry);
+        });
+
+        return editor;
+    }
+
     if (QFileInfo::exists(filePath) && QFileInfo::exists(sessionFilePath)) {
-        ScintillaNext *editor = ScintillaNext::fromFile(sessionFilePath);
+        ScintillaNext *editor = ScintillaNext::deferredFromFile(sessionFilePath);
 
         // Since this editor has different file path info, treat this as a temporary buffer
         editor->setFileInfo(filePath);
         editor->setTemporary(true);
 
-        loadEditorViewDetails(editor, settings);
-
         app->getEditorManager()->manageEditor(editor);
 
+        restoreOnceLoaded(editor, entry, [=]() {
+            // Reading the session copy detects it as UTF-8, not what the file itself is saved as
+            editor->setEncoding(QTextCodec::codecForName(entry.value("Encoding").toByteArray()), entry.value("ByteOrderMark").toBool());
+
+            loadEditorViewDetails(editor, entry);
+            rememberSessionFile(editor, sessionFileName);
+        });
+
         return editor;
     }
     else {
@@ -329,45 +941,47 @@ ScintillaNext *SessionManager::loadUnsavedFileDetails(QSettings &settings)
     }
 }
 
-void SessionManager::storeTempFile(ScintillaNext *editor, QSettings &settings)
+void SessionManager::storeTempFile(ScintillaNext *editor, QVariantMap &entry)
 {
-    const QString sessionFileName = RandomSessionFileName();
-
-    settings.setValue("Type", "Temp");
-    settings.setValue("FileName", editor->getName());
-    settings.setValue("SessionFileName", sessionFileName);
-    settings.setValue("Language", editor->languageName);
+    const QString sessionFileName = sessionFileFor(editor).fileName;
 
-    storeEditorViewDetails(editor, settings);
+    entry.insert("Type", "Temp");
+    entry.insert("FileName", editor->getName());
+    entry.insert("SessionFileName", sessionFileName);
+    entry.insert("Language", editor->languageName);
 
-    saveIntoSessionDirectory(editor, sessionFileName);
+    storeEditorViewDetails(editor, entry);
 }
 
-ScintillaNext *SessionManager::loadTempFile(QSettings &settings)
+ScintillaNext *SessionManager::loadTempFile(const QVariantMap &entry)
 {
     qInfo(Q_FUNC_INFO);
 
-    const QString fileName = settings.value("FileName").toString();
-    const QString sessionFileName = settings.value("SessionFileName").toString();
-    const QString languageName = settings.value("Language", QString()).toString();
+    const QString fileName = entry.value("FileName").toString();
+    const QString sessionFileName = entry.value("SessionFileName").toString();
+    const QString languageName = entry.value("Language", QString()).toString();
     const QString fullFilePath = sessionDirectory().filePath(sessionFileName);
 
     qDebug("Session temp file: \"%s\"", qUtf8Printable(fullFilePath));
 
     if (QFileInfo::exists(fullFilePath)) {
-        ScintillaNext *editor = ScintillaNext::fromFile(fullFilePath, false);
+        ScintillaNext *editor = ScintillaNext::deferredFromFile(fullFilePath);
 
         editor->detachFileInfo(fileName);
         editor->setTemporary(true);
 
         app->getEditorManager()->manageEditor(editor);
 
-        loadEditorViewDetails(editor, settings);
+        restoreOnceLoaded(editor, entry, [=]() {
+            loadEditorViewDetails(editor, entry);
 
-        if (!languageName.isEmpty()) {
-            qDebug("Setting session file language to \"%s\"", qUtf8Printable(languageName));
-            app->setEditorLanguage(editor, languageName);
-        }
+            if (!languageName.isEmpty()) {
+                qDebug("Setting session file language to \"%s\"", qUtf8Printable(languageName));
+                app->setEditorLanguage(editor, languageName);
+            }
+
+            rememberSessionFile(editor, sessionFileName);
+        });
 
         return editor;
     }
@@ -377,28 +991,35 @@ ScintillaNext *SessionManager::loadTempFile(QSettings &settings)
     }
 }
 
-void SessionManager::storeEditorViewDetails(ScintillaNext *editor, QSettings &settings)
+void SessionManager::storeEditorViewDetails(ScintillaNext *editor, QVariantMap &entry)
 {
-    settings.setValue("FirstVisibleLine", static_cast<int>(editor->firstVisibleLine() + 1)); // Keep it 1-based in the settings just for human-readability
-    settings.setValue("CurrentPosition", static_cast<int>(editor->currentPos()));
+    // A hibernated editor has no text to ask, but it remembers where it was
+    if (editor->isHibernated()) {
+        entry.insert("FirstVisibleLine", static_cast<int>(editor->hibernatedView().firstVisibleLine + 1));
+        entry.insert("CurrentPosition", static_cast<int>(editor->hibernatedView().currentPosition));
+    }
+    else {
+        entry.insert("FirstVisibleLine", static_cast<int>(editor->firstVisibleLine() + 1)); // Kept 1-based, the way it was when this was stored as human readable settings
+        entry.insert("CurrentPosition", static_cast<int>(editor->currentPos()));
+    }
 
     BookMarkDecorator *decorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
     QList<int> bookMarkedLines = decorator->bookMarkedLines();
     if (bookMarkedLines.length() > 0)
-        settings.setValue("BookMarks", QListToQVariantList(bookMarkedLines));
+        entry.insert("BookMarks", QListToQVariantList(bookMarkedLines));
 }
 
-void SessionManager::loadEditorViewDetails(ScintillaNext *editor, QSettings &settings)
+void SessionManager::loadEditorViewDetails(ScintillaNext *editor, const QVariantMap &entry)
 {
-    const int firstVisibleLine = settings.value("FirstVisibleLine").toInt() - 1;
-    const int currentPosition = settings.value("CurrentPosition").toInt();
+    const int firstVisibleLine = entry.value("FirstVisibleLine").toInt() - 1;
+    const int currentPosition = entry.value("CurrentPosition").toInt();
 
     editor->setFirstVisibleLine(firstVisibleLine);
     editor->setEmptySelection(currentPosition);
 
-    if (settings.contains("BookMarks"))
+    if (entry.contains("BookMarks"))
     {
-        QList<int> bookMarkedLines = QVariantListToQList(settings.value("BookMarks").toList()); // just using .value<QList<int>>() does not work...possibly a Qt bug?
+        QList<int> bookMarkedLines = QVariantListToQList(entry.value("BookMarks").toList()); // just using .value<QList<int>>() does not work...possibly a Qt bug?
 
         BookMarkDecorator *decorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
         decorator->setBookMarkedLines(bookMarkedLines);
@@ -22,12 +22,23 @@
 
 
 #include <QDir>
-#include <QSettings>
+#include <QHash>
+#include <QPointer>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
 
+#include <functional>
+#include <memory>
 
+
+class EditJournal;
 class ScintillaNext;
 class MainWindow;
 class NotepadNextApplication;
+class QSemaphore;
 
 class SessionManager
 {
@@ -45,37 +56,111 @@ public:
 
     void setSessionFileTypes(SessionFileTypes types);
 
-    void clear() const;
+    void clear();
 
     void saveSession(MainWindow *window);
+
+    // Writes the session files of editors that changed on a worker thread, then updates the session
+    // manifest once they are all on disk. Does nothing if the previous one has not finished yet.
+    void autoSaveSession(MainWindow *window);
+
     void loadSession(MainWindow *window);
 
     bool willFileGetStoredInSession(ScintillaNext *editor) const;
 
+    // Workspaces are named sets of editors kept in the session manifest, one of which is open at a time
+    QString currentWorkspace() const { return workspaceName; }
+    QStringList workspaceNames() const;
+
+    // Keeps every editor of the window under the current workspace's name so they can all be closed without asking.
+    // Returns false if any of them couldn't be kept, in which case nothing should be closed.
+    bool storeWorkspace(MainWindow *window);
+
+    // Opens the editors of the named workspace, which is empty if there isn't one yet, and makes it the current one.
+    // They only read their files once shown.
+    void restoreWorkspace(MainWindow *window, const QString &name);
+    void removeWorkspace(const QString &name);
+
+    // Changes to files are recorded in a journal in the session directory, so an unsaved file can be put back
+    // by replaying them on top of it rather than keeping a copy of the whole thing
+    void journalEditor(ScintillaNext *editor);
+
 private:
     QDir sessionDirectory() const;
+    QString sessionManifestPath() const;
+
+    struct SessionFile {
+        QPointer<ScintillaNext> editor; // null once the editor is gone, in case another one gets the same address
+        QString fileName;
+        quint64 generation = 0;
+        bool upToDate = false;
+    };
+
+    SessionFile &sessionFileFor(ScintillaNext *editor);
+    bool isUpToDate(const SessionFile &sessionFile, const QDir &directory) const;
+    void saveIntoSessionDirectory(ScintillaNext *editor);
+    void rememberSessionFile(ScintillaNext *editor, const QString &sessionFileName);
+
+    struct DeferredEditor {
+        QPointer<ScintillaNext> editor;
+        QVariantMap entry;
+    };
+
+    // Restored editors don't read their file until they are needed, restore() gets called once they have
+    void restoreOnceLoaded(ScintillaNext *editor, const QVariantMap &entry, std::function<void()> restore);
+    bool isDeferred(const ScintillaNext *editor) const;
+    void restoreEntries(MainWindow *window, int currentEditorIndex, const QVector<QVariantMap> &entries, bool loadInBackground);
+
+    struct Workspace {
+        qint32 currentEditorIndex = 0;
+        QVector<QVariantMap> entries;
+    };
+
+    bool isJournaled(const ScintillaNext *editor) const;
 
-    void saveIntoSessionDirectory(ScintillaNext *editor, const QString &sessionFileName) const;
+    void waitForAutoSave();
+    QVector<ScintillaNext *> editorsWithSessionFiles(MainWindow *window) const;
+    QVector<QVariantMap> sessionEntries(MainWindow *window, SessionFileTypes types, bool useJournals, qint32 &currentEditorIndex);
+    void keepSessionFilesOf(const QVariantMap &entry);
+    void writeSessionManifest(MainWindow *window);
+    bool readSessionManifest(int &currentEditorIndex, QVector<QVariantMap> &entries);
+    bool readLegacySessionSettings(int &currentEditorIndex, QVector<QVariantMap> &entries);
+    void removeUnusedSessionFiles();
 
     SessionFileType determineType(ScintillaNext *editor) const;
 
     void clearSettings() const;
-    void clearDirectory() const;
+    void clearDirectory(const QSet<QString> &keep = QSet<QString>()) const;
 
-    void storeFileDetails(ScintillaNext *editor, QSettings &settings);
-    ScintillaNext *loadFileDetails(QSettings &settings);
+    void storeFileDetails(ScintillaNext *editor, QVariantMap &entry);
+    ScintillaNext *loadFileDetails(const QVariantMap &entry);
 
-    void storeUnsavedFileDetails(ScintillaNext *editor, QSettings &settings);
-    ScintillaNext *loadUnsavedFileDetails(QSettings &settings);
+    void storeUnsavedFileDetails(ScintillaNext *editor, QVariantMap &entry, bool useJournal);
+    ScintillaNext *loadUnsavedFileDetails(const QVariantMap &entry);
 
-    void storeTempFile(ScintillaNext *editor, QSettings &settings);
-    ScintillaNext *loadTempFile(QSettings &settings);
+    void storeTempFile(ScintillaNext *editor, QVariantMap &entry);
+    ScintillaNext *loadTempFile(const QVariantMap &entry);
 
-    void storeEditorViewDetails(ScintillaNext *editor, QSettings &settings);
-    void loadEditorViewDetails(ScintillaNext *editor, QSettings &settings);
+    void storeEditorViewDetails(ScintillaNext *editor, QVariantMap &entry);
+    void loadEditorViewDetails(ScintillaNext *editor, const QVariantMap &entry);
 
     NotepadNextApplication *app;
     SessionFileTypes fileTypes;
+
+    QHash<const ScintillaNext *, SessionFile> sessionFiles;
+    QSet<QString> sessionFilesInUse;
+
+    QHash<const ScintillaNext *, DeferredEditor> deferredEditors;
+
+    QHash<const ScintillaNext *, QPointer<EditJournal>> journals;
+
+    QString workspaceName;
+    QMap<QString, Workspace> workspaces; // the ones that aren't open
+
+    std::shared_ptr<QSemaphore> autoSaveDone; // released by the worker once the files are written
+    quint64 autoSaveRun = 0;
+
+    bool hasLegacySessionSettings = false; // the session was read from the application settings rather than the manifest
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(SessionManager::SessionFileTypes)
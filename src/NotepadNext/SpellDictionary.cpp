@@ -0,0 +1,276 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "SpellDictionary.h"
+#include "JobScheduler.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+
+#include <cstring>
+#include <vector>
+
+
+// Word lists that are often installed, tried in order when no path has been given
+static const char *const SYSTEM_WORD_LISTS[] = {
+    "/usr/share/dict/words",
+    "/usr/share/dict/american-english",
+    "/usr/share/dict/british-english",
+};
+
+// Nothing longer gets looked up, and no word in the file is expected to be
+static const int MAX_WORD_LENGTH = 64;
+
+struct SpellDictionary::Table
+{
+    QFile file;
+    const uchar *data = Q_NULLPTR;
+    qint64 size = 0;
+
+    // Where each word starts in the file plus one, so 0 is an empty slot. The size is a power of two.
+    std::vector<quint32> slots;
+};
+
+static inline uchar foldCase(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline bool isWordEnd(uchar c)
+{
+    // A .dic file has the affix flags after a slash
+    return c == '\n' || c == '\r' || c == '/' || c == '\t';
+}
+
+static quint32 hashWord(const uchar *word, int length)
+{
+    // FNV-1a
+    quint32 hash = 2166136261u;
+
+    for (int i = 0; i < length; ++i) {
+        hash = (hash ^ foldCase(word[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+static bool sameWord(const uchar *a, int length, const uchar *b, const uchar *end)
+{
+    if (end - b < length) {
+        return false;
+    }
+
+    for (int i = 0; i < length; ++i) {
+        if (foldCase(a[i]) != foldCase(b[i])) {
+            return false;
+        }
+    }
+
+    return b + length == end || isWordEnd(b[length]);
+}
+
+SpellDictionary *SpellDictionary::instance()
+{
+    static QPointer<SpellDictionary> dictionary;
+
+    if (!dictionary) {
+        dictionary = new SpellDictionary(QCoreApplication::instance());
+    }
+
+    return dictionary;
+}
+
+SpellDictionary::SpellDictionary(QObject *parent) :
+    QObject(parent)
+{
+}
+
+SpellDictionary::~SpellDictionary()
+{
+}
+
+void SpellDictionary::setPath(const QString &path)
+{
+    if (this->path == path) {
+        return;
+    }
+
+    this->path = path;
+
+    // Nobody has needed the words yet, so they can wait until someone does
+    if (!loading && !loaded) {
+        return;
+    }
+
+    JobScheduler::instance()->cancel(this);
+    load();
+}
+
+bool SpellDictionary::isReady()
+{
+    if (!loading && !loaded) {
+        load();
+    }
+
+    return loaded;
+}
+
+bool SpellDictionary::hasWords() const
+{
+    return table && !table->slots.empty();
+}
+
+bool SpellDictionary::contains(const char *word, int length) const
+{
+    if (!hasWords() || length <= 0 || length > MAX_WORD_LENGTH) {
+        return true;
+    }
+
+    const uchar *w = reinterpret_cast<const uchar *>(word);
+    const uchar *end = table->data + table->size;
+    const size_t mask = table->slots.size() - 1;
+
+    for (size_t slot = hashWord(w, length) & mask; table->slots[slot] != 0; slot = (slot + 1) & mask) {
+        if (sameWord(w, length, table->data + table->slots[slot] - 1, end)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+qint64 SpellDictionary::memoryUsage() const
+{
+    // The words themselves are in the mapped file, which only takes up memory for the pages that have been read
+    return table ? static_cast<qint64>(table->slots.capacity() * sizeof(quint32)) : 0;
+}
+
+void SpellDictionary::load()
+{
+    QString fileName = path;
+
+    if (fileName.isEmpty()) {
+        for (const char *candidate : SYSTEM_WORD_LISTS) {
+            if (QFileInfo::exists(QString::fromLatin1(candidate))) {
+                fileName = QString::fromLatin1(candidate);
+                break;
+            }
+        }
+    }
+
+    loading = true;
+    loaded = false;
+
+    QPointer<SpellDictionary> self = this;
+
+    JobScheduler::instance()->run(this, JobScheduler::Background, [=](const JobScheduler::CancelToken &canceled) {
+        std::shared_ptr<const Table> built = buildTable(fileName, *canceled);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self || *canceled) {
+                return;
+            }
+
+            self->table = built;
+            self->loading = false;
+            self->loaded = true;
+
+            emit self->ready();
+        }, Qt::QueuedConnection);
+    });
+}
+
+std::shared_ptr<SpellDictionary::Table> SpellDictionary::buildTable(const QString &fileName, const std::atomic_bool &canceled)
+{
+    std::shared_ptr<Table> table = std::make_shared<Table>();
+
+    if (fileName.isEmpty()) {
+        qWarning("No word list was found for spell checking");
+        return table;
+    }
+
+    table->file.setFileName(fileName);
+    table->size = table->file.size();
+
+    // The slots only have 32 bits for where a word starts
+    if (table->size <= 0 || table->size >= Q_INT64_C(0xFFFFFFFF) || !table->file.open(QIODevice::ReadOnly)) {
+        qWarning("Unable to read the word list \"%s\"", qUtf8Printable(fileName));
+        return table;
+    }
+
+    table->data = table->file.map(0, table->size);
+    if (!table->data) {
+        qWarning("QFile::map() failed for \"%s\": %s", qUtf8Printable(fileName), qUtf8Printable(table->file.errorString()));
+        return table;
+    }
+
+    const uchar *data = table->data;
+    const uchar *end = data + table->size;
+
+    // Roughly one word for every ten bytes, the table is grown if there turn out to be more
+    std::vector<quint32> starts;
+    starts.reserve(static_cast<size_t>(table->size / 10));
+
+    for (const uchar *line = data; line < end && !canceled;) {
+        const uchar *wordEnd = line;
+        while (wordEnd < end && !isWordEnd(*wordEnd)) {
+            ++wordEnd;
+        }
+
+        if (wordEnd > line && wordEnd - line <= MAX_WORD_LENGTH) {
+            starts.push_back(static_cast<quint32>(line - data));
+        }
+
+        const uchar *newline = static_cast<const uchar *>(std::memchr(wordEnd, '\n', end - wordEnd));
+        line = newline ? newline + 1 : end;
+    }
+
+    // At most half full so lookups of words that aren't there stop quickly
+    size_t size = 16;
+    while (size < starts.size() * 2) {
+        size *= 2;
+    }
+
+    table->slots.assign(size, 0);
+    const size_t mask = size - 1;
+
+    for (const quint32 start : starts) {
+        const uchar *word = data + start;
+        int length = 0;
+        while (word + length < end && !isWordEnd(word[length])) {
+            ++length;
+        }
+
+        size_t slot = hashWord(word, length) & mask;
+        while (table->slots[slot] != 0) {
+            if (sameWord(word, length, data + table->slots[slot] - 1, end)) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        table->slots[slot] = start + 1;
+    }
+
+    qInfo("Loaded %zu words for spell checking from \"%s\"", starts.size(), qUtf8Printable(fileName));
+
+    return table;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SPELLDICTIONARY_H
+#define SPELLDICTIONARY_H
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+
+// The words spell checking goes by, from a word list with one word a line. Hunspell .dic files can be used too, but
+// only the stems in them are known since their affix rules aren't applied. The file is mapped rather than read, and
+// all that is built is a hash table of where each word starts, on a worker the first time it is needed. Words are
+// compared ignoring the case of ASCII letters.
+class SpellDictionary : public QObject
+{
+    Q_OBJECT
+
+public:
+    // The one every editor shares
+    static SpellDictionary *instance();
+
+    ~SpellDictionary();
+
+    // An empty path uses the first of the usual system word lists that exists
+    void setPath(const QString &path);
+
+    // Starts loading the words if that hasn't been done yet, and returns whether it is done. hasWords() says
+    // whether there turned out to be any.
+    bool isReady();
+    bool hasWords() const;
+
+    bool contains(const char *word, int length) const;
+
+    qint64 memoryUsage() const;
+
+signals:
+    // Also sent again after the path changed and the new words are loaded
+    void ready();
+
+private:
+    struct Table;
+
+    explicit SpellDictionary(QObject *parent);
+
+    void load();
+    static std::shared_ptr<Table> buildTable(const QString &fileName, const std::atomic_bool &canceled);
+
+    QString path;
+    std::shared_ptr<const Table> table;
+    bool loading = false;
+    bool loaded = false;
+};
+
+#endif // SPELLDICTIONARY_H
@@ -0,0 +1,132 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "StartupTrace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+
+struct TraceEvent {
+    QByteArray name;
+    qint64 start;
+    qint64 duration;
+    quintptr thread;
+};
+
+Q_GLOBAL_STATIC(QElapsedTimer, timer);
+Q_GLOBAL_STATIC(QVector<TraceEvent>, events);
+Q_GLOBAL_STATIC(QMutex, eventsMutex);
+Q_GLOBAL_STATIC(QString, outputFilePath);
+static bool active = false;
+
+
+void StartupTrace::start(const QString &filePath)
+{
+    qInfo("Writing the start up trace to \"%s\"", qUtf8Printable(filePath));
+
+    *outputFilePath = filePath;
+    events->clear();
+    timer->start();
+    active = true;
+}
+
+bool StartupTrace::isActive()
+{
+    return active;
+}
+
+void StartupTrace::finish()
+{
+    if (!active) {
+        return;
+    }
+
+    active = false;
+
+    QJsonArray traceEvents;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QMutexLocker locker(eventsMutex);
+    for (const TraceEvent &event : qAsConst(*events)) {
+        traceEvents.append(QJsonObject{
+            {"name", QString::fromUtf8(event.name)},
+            {"cat", "startup"},
+            {"ph", "X"},
+            {"ts", event.start},
+            {"dur", event.duration},
+            {"pid", pid},
+            {"tid", static_cast<qint64>(event.thread)},
+        });
+    }
+    events->clear();
+
+    QFile file(*outputFilePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Unable to write the start up trace to \"%s\": %s", qUtf8Printable(*outputFilePath), qUtf8Printable(file.errorString()));
+        return;
+    }
+
+    const QJsonObject trace {
+        {"traceEvents", traceEvents},
+        {"displayTimeUnit", "ms"},
+    };
+
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    file.close();
+}
+
+void StartupTrace::addEvent(const QByteArray &name, qint64 startMicroseconds, qint64 durationMicroseconds)
+{
+    if (!active) {
+        return;
+    }
+
+    QMutexLocker locker(eventsMutex);
+    events->append({name, startMicroseconds, durationMicroseconds, reinterpret_cast<quintptr>(QThread::currentThreadId())});
+}
+
+qint64 StartupTrace::elapsedMicroseconds()
+{
+    return timer->nsecsElapsed() / 1000;
+}
+
+TraceScope::TraceScope(const QByteArray &name)
+{
+    // This costs next to nothing when nothing is being traced
+    if (StartupTrace::isActive()) {
+        this->name = name;
+        started = StartupTrace::elapsedMicroseconds();
+    }
+}
+
+void TraceScope::end()
+{
+    if (started >= 0) {
+        StartupTrace::addEvent(name, started, StartupTrace::elapsedMicroseconds() - started);
+        started = -1;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QByteArray>
+#include <QString>
+
+
+// Records how long parts of the start up take and writes them out in the Chrome trace event format, which can be
+// opened with chrome://tracing or https://ui.perfetto.dev. Nothing is recorded unless start() has been called.
+namespace StartupTrace {
+    void start(const QString &filePath);
+    bool isActive();
+
+    // Writes the file and stops recording, anything after this is ignored
+    void finish();
+
+    void addEvent(const QByteArray &name, qint64 startMicroseconds, qint64 durationMicroseconds);
+    qint64 elapsedMicroseconds();
+}
+
+// Adds an event covering from when it is created until it is destroyed, or until end() is called
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : TraceScope(QByteArray(name)) {}
+    explicit TraceScope(const QByteArray &name);
+    ~TraceScope() { end(); }
+
+    void end();
+
+private:
+    QByteArray name;
+    qint64 started = -1;
+};
+
+#endif // STARTUPTRACE_H
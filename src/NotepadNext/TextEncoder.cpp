@@ -0,0 +1,311 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TextEncoder.h"
+
+#include "EncodingDetector.h"
+
+#include <QIODevice>
+#include <QString>
+#include <QTextCodec>
+#include <QtAlgorithms>
+#include <QtEndian>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// ASCII that runs shorter than this between other characters goes through the codec along with them, since
+// splitting the text up costs more than it saves
+const qsizetype MIN_ASCII_RUN = 64;
+
+static bool writeAll(QIODevice &device, const QByteArray &data)
+{
+    for (qint64 pos = 0; pos < data.size();) {
+        const qint64 written = device.write(data.constData() + pos, data.size() - pos);
+
+        if (written <= 0)
+            return false;
+
+        pos += written;
+    }
+
+    return true;
+}
+
+qsizetype TextEncoder::asciiLength(const char *data, qsizetype length)
+{
+    qsizetype i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const int high = _mm_movemask_epi8(bytes);
+
+        if (high != 0)
+            return i + qCountTrailingZeroBits(static_cast<quint32>(high));
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80)
+            return i;
+    }
+
+    return length;
+}
+
+void TextEncoder::widenAscii(const char *data, qsizetype length, char *output, bool bigEndian)
+{
+    qsizetype i = 0;
+
+#ifdef __SSE2__
+    // Interleaving with zero bytes is all it takes, which side the zero goes on is the byte order
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i *out = reinterpret_cast<__m128i *>(output + i * 2);
+
+        if (bigEndian) {
+            _mm_storeu_si128(out, _mm_unpacklo_epi8(zero, bytes));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(zero, bytes));
+        }
+        else {
+            _mm_storeu_si128(out, _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(bytes, zero));
+        }
+    }
+#endif
+
+    for (; i < length; ++i) {
+        output[i * 2] = bigEndian ? '\0' : data[i];
+        output[i * 2 + 1] = bigEndian ? data[i] : '\0';
+    }
+}
+
+qsizetype TextEncoder::utf8ToUtf16(const char *data, qsizetype length, char *output, bool bigEndian, qsizetype &consumed)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    char *out = output;
+    qsizetype i = 0;
+
+    auto writeUnit = [&](quint16 unit) {
+        if (bigEndian)
+            qToBigEndian<quint16>(unit, out);
+        else
+            qToLittleEndian<quint16>(unit, out);
+        out += 2;
+    };
+
+    while (i < length) {
+        const qsizetype ascii = asciiLength(data + i, length - i);
+
+        widenAscii(data + i, ascii, out, bigEndian);
+        out += ascii * 2;
+        i += ascii;
+
+        // Everything up to the next ASCII byte, one character at a time
+        while (i < length && p[i] >= 0x80) {
+            const unsigned char lead = p[i];
+            const int sequenceLength = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+
+            if (i + sequenceLength > length) {
+                consumed = i;
+                return out - output;
+            }
+
+            if (sequenceLength == 2) {
+                writeUnit(static_cast<quint16>(((lead & 0x1F) << 6) | (p[i + 1] & 0x3F)));
+            }
+            else if (sequenceLength == 3) {
+                writeUnit(static_cast<quint16>(((lead & 0x0F) << 12) | ((p[i + 1] & 0x3F) << 6) | (p[i + 2] & 0x3F)));
+            }
+            else {
+                const quint32 codePoint = ((lead & 0x07) << 18) | ((p[i + 1] & 0x3F) << 12) | ((p[i + 2] & 0x3F) << 6) | (p[i + 3] & 0x3F);
+
+                writeUnit(static_cast<quint16>(0xD800 + ((codePoint - 0x10000) >> 10)));
+                writeUnit(static_cast<quint16>(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+            }
+
+            i += sequenceLength;
+        }
+    }
+
+    consumed = length;
+    return out - output;
+}
+
+bool TextEncoder::isAsciiCompatible(const QTextCodec *codec)
+{
+    // Stateful encodings like ISO-2022-JP are left out, the same byte can mean something else after a shift
+    switch (codec->mibEnum()) {
+    case 4: // ISO-8859-1
+    case 5: case 6: case 7: case 8: case 9: case 10: case 11: case 12: case 13: // ISO-8859-2 to ISO-8859-10
+    case 109: case 110: case 111: case 112: // ISO-8859-13 to ISO-8859-16
+    case 17: // Shift_JIS
+    case 18: // EUC-JP
+    case 38: // EUC-KR
+    case 113: // GBK
+    case 114: // GB18030
+    case 2026: // Big5
+    case 2101: // Big5-HKSCS
+    case 2084: // KOI8-R
+    case 2088: // KOI8-U
+    case 2259: // TIS-620
+    case 2250: case 2251: case 2252: case 2253: case 2254: case 2255: case 2256: case 2257: case 2258: // windows-1250 to windows-1258
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool TextEncoder::write(QIODevice &device, const char *data, qint64 length, QTextCodec *codec, bool byteOrderMark)
+{
+    if (codec == Q_NULLPTR || EncodingDetector::isUtf8Codec(codec)) {
+        if (byteOrderMark && device.write("\xEF\xBB\xBF", 3) != 3)
+            return false;
+
+        for (qint64 pos = 0; pos < length; pos += CHUNK_SIZE) {
+            if (!writeAll(device, QByteArray::fromRawData(data + pos, static_cast<int>(qMin<qint64>(length - pos, CHUNK_SIZE)))))
+                return false;
+        }
+
+        return true;
+    }
+
+    // The BOM is written once up front, otherwise the codec would put one at the start of every chunk
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+
+    if (byteOrderMark) {
+        const QChar bom(QChar::ByteOrderMark);
+
+        if (!writeAll(device, codec->fromUnicode(&bom, 1, &state)))
+            return false;
+    }
+
+    const int mib = codec->mibEnum();
+    const bool isUtf16 = mib == 1013 || mib == 1014; // UTF-16BE, UTF-16LE
+    const bool bigEndian = mib == 1013;
+    const bool asciiCompatible = isAsciiCompatible(codec);
+    // Reserved once and reused, so each chunk doesn't allocate its output again
+    QByteArray output;
+    output.reserve(static_cast<int>(isUtf16 ? CHUNK_SIZE * 2 : CHUNK_SIZE));
+
+    // ASCII is copied or widened straight from the text, only the rest has to go through QString and the codec
+    auto appendAscii = [&](const char *text, qsizetype size) {
+        if (isUtf16) {
+            const int start = output.size();
+            output.resize(start + static_cast<int>(size * 2));
+            widenAscii(text, size, output.data() + start, bigEndian);
+        }
+        else {
+            output.append(text, static_cast<int>(size));
+        }
+    };
+
+    auto appendOther = [&](const char *text, qsizetype size) {
+        const QString unicode = QString::fromUtf8(text, static_cast<int>(size));
+
+        if (isUtf16) {
+            // The QString already is UTF-16, so at most the bytes need swapping rather than going through the codec
+            const int start = output.size();
+            output.resize(start + unicode.size() * 2);
+
+            if (bigEndian)
+                qToBigEndian<quint16>(unicode.utf16(), unicode.size(), output.data() + start);
+            else
+                qToLittleEndian<quint16>(unicode.utf16(), unicode.size(), output.data() + start);
+        }
+        else {
+            output.append(codec->fromUnicode(unicode.constData(), unicode.size(), &state));
+        }
+    };
+
+    for (qint64 pos = 0; pos < length;) {
+        qint64 end = qMin<qint64>(length, pos + CHUNK_SIZE);
+
+        // Don't split a multi-byte character between two chunks
+        while (end < length && end > pos && (static_cast<unsigned char>(data[end]) & 0xC0) == 0x80)
+            --end;
+
+        if (end == pos)
+            end = qMin<qint64>(length, pos + CHUNK_SIZE);
+
+        const char *chunk = data + pos;
+        const qsizetype size = static_cast<qsizetype>(end - pos);
+
+        output.resize(0);
+
+        if (isUtf16 && EncodingDetector::validUtf8Length(chunk, size) == size) {
+            // Nearly always the case, only text that was never UTF-8 to begin with needs the codec's replacements
+            qsizetype converted = 0;
+
+            output.resize(static_cast<int>(size * 2));
+            output.resize(static_cast<int>(utf8ToUtf16(chunk, size, output.data(), bigEndian, converted)));
+
+            // Whatever is cut off at the very end of the text still gets its replacement character
+            if (converted < size)
+                appendOther(chunk + converted, size - converted);
+        }
+        else if (!isUtf16 && !asciiCompatible) {
+            appendOther(chunk, size);
+        }
+        else {
+            for (qsizetype i = 0; i < size;) {
+                const qsizetype ascii = asciiLength(chunk + i, size - i);
+
+                if (ascii >= MIN_ASCII_RUN || i + ascii == size) {
+                    appendAscii(chunk + i, ascii);
+                    i += ascii;
+                    continue;
+                }
+
+                // Take everything up to the next run of ASCII worth copying on its own. An ASCII byte is never part
+                // of a multi-byte character, so this always ends between two characters.
+                qsizetype j = i + ascii;
+                while (j < size) {
+                    while (j < size && static_cast<unsigned char>(chunk[j]) >= 0x80)
+                        ++j;
+
+                    const qsizetype next = asciiLength(chunk + j, size - j);
+                    if (next >= MIN_ASCII_RUN || j + next == size)
+                        break;
+
+                    j += next;
+                }
+
+                appendOther(chunk + i, j - i);
+                i = j;
+            }
+        }
+
+        if (!writeAll(device, output))
+            return false;
+
+        pos = end;
+    }
+
+    if (state.invalidChars > 0) {
+        qWarning("%d characters could not be represented in %s", state.invalidChars, codec->name().constData());
+    }
+
+    return true;
+}
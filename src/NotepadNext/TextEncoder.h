@@ -0,0 +1,53 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QtGlobal>
+
+
+class QIODevice;
+class QTextCodec;
+
+// Converts the editor's UTF-8 to the encoding of a file as it is written, a chunk at a time so the converted text
+// never has to exist all at once. Nothing here keeps any state, so it is safe to use from any thread.
+class TextEncoder
+{
+public:
+    // How much UTF-8 is converted at a time, the most that is held converted is about twice this
+    static constexpr qsizetype CHUNK_SIZE = 4 * 1024 * 1024;
+
+    // Writes the text in the codec, with its byte order mark first if asked for. A null codec means UTF-8.
+    static bool write(QIODevice &device, const char *data, qint64 length, QTextCodec *codec, bool byteOrderMark);
+
+    // How many bytes at the start of data are ASCII
+    static qsizetype asciiLength(const char *data, qsizetype length);
+
+    // Writes ASCII as UTF-16 code units in the given byte order, 2 bytes of output for each one of input
+    static void widenAscii(const char *data, qsizetype length, char *output, bool bigEndian);
+
+    // Converts data, which has to be valid UTF-8, to UTF-16 code units in the given byte order without going through
+    // a QString. The ASCII in it is widened 16 bytes at a time however short the runs of it are. output needs room
+    // for 2 bytes for each byte of data. Returns how much of output was written. A sequence cut off at the end of
+    // data is left out, consumed says where the converted text ends.
+    static qsizetype utf8ToUtf16(const char *data, qsizetype length, char *output, bool bigEndian, qsizetype &consumed);
+
+    // Whether the codec writes every ASCII character as the same single byte, whatever came before it
+    static bool isAsciiCompatible(const QTextCodec *codec);
+};
@@ -0,0 +1,795 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TextFormatter.h"
+
+#include <QCoreApplication>
+
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+
+// Even on Qt 6 a QByteArray much bigger than this is more than anyone wants in an editor
+static constexpr qint64 MAX_OUTPUT_LENGTH = std::numeric_limits<int>::max() - 64;
+
+namespace {
+
+bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+bool isDigit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
+
+bool isHexDigit(char ch)
+{
+    return isDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+// Everything the two formatters share: the input, where they are in it, the output and how to report a problem
+class Formatter
+{
+public:
+    Formatter(const char *data, qint64 length, QByteArray &out, const TextFormatter::Options &options, TextFormatter::Error &error, const TextFormatter::Progress &progress, bool pretty) :
+        data(data), length(length), out(out), options(options), error(error), progress(progress), pretty(pretty)
+    {
+    }
+
+protected:
+    bool fail(qint64 position, const char *message)
+    {
+        error.position = position;
+        error.message = message;
+        return false;
+    }
+
+    // Returns false if progress asked to stop
+    bool reportProgress()
+    {
+        if (pos >= nextProgress) {
+            nextProgress = pos + TextFormatter::CHUNK_SIZE;
+
+            if (progress && !progress(pos))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool write(const char *text, qint64 size)
+    {
+        if (out.size() + size > MAX_OUTPUT_LENGTH)
+            return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "The result is too large to hold"));
+
+        out.append(text, static_cast<int>(size));
+        return true;
+    }
+
+    bool write(std::string_view text)
+    {
+        return write(text.data(), static_cast<qint64>(text.size()));
+    }
+
+    bool write(char ch)
+    {
+        return write(&ch, 1);
+    }
+
+    bool newLine(size_t depth)
+    {
+        if (!write(options.eol.constData(), options.eol.size()))
+            return false;
+
+        for (size_t i = 0; i < depth; ++i) {
+            if (!write(options.indent.constData(), options.indent.size()))
+                return false;
+        }
+
+        return true;
+    }
+
+    void skipSpaces()
+    {
+        while (pos < length && isSpace(data[pos]))
+            ++pos;
+    }
+
+    bool startsWith(const char *text) const
+    {
+        const qint64 size = static_cast<qint64>(std::strlen(text));
+
+        return length - pos >= size && std::memcmp(data + pos, text, static_cast<size_t>(size)) == 0;
+    }
+
+    // Where text next appears at or after from, or -1
+    qint64 find(qint64 from, const char *text) const
+    {
+        const std::string_view haystack(data, static_cast<size_t>(length));
+        const size_t found = haystack.find(text, static_cast<size_t>(from));
+
+        return found == std::string_view::npos ? -1 : static_cast<qint64>(found);
+    }
+
+    const char *data;
+    const qint64 length;
+    qint64 pos = 0;
+
+    QByteArray &out;
+    const TextFormatter::Options &options;
+    TextFormatter::Error &error;
+    const TextFormatter::Progress &progress;
+    const bool pretty;
+
+private:
+    qint64 nextProgress = TextFormatter::CHUNK_SIZE;
+};
+
+class JsonFormatter : public Formatter
+{
+public:
+    using Formatter::Formatter;
+
+    bool run()
+    {
+        // A byte order mark is kept where it is
+        if (startsWith("\xEF\xBB\xBF")) {
+            pos = 3;
+            write(data, 3);
+        }
+
+        Expect expect = Expect::Value;
+
+        for (;;) {
+            skipSpaces();
+
+            if (!reportProgress())
+                return false;
+
+            if (pos >= length) {
+                if (expect == Expect::End)
+                    return true;
+                if (stack.empty())
+                    return fail(length, QT_TRANSLATE_NOOP("TextFormatter", "There is no JSON value"));
+
+                return fail(length, QT_TRANSLATE_NOOP("TextFormatter", "The text ends before the JSON does"));
+            }
+
+            const char ch = data[pos];
+
+            switch (expect) {
+            case Expect::End:
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "There is more text after the JSON value"));
+
+            case Expect::Colon:
+                if (ch != ':')
+                    return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a ':' after the name"));
+
+                ++pos;
+                if (!(pretty ? write(": ") : write(':')))
+                    return false;
+
+                expect = Expect::Value;
+                continue;
+
+            case Expect::CommaOrClose:
+                if (ch == ',') {
+                    ++pos;
+                    if (!write(',') || (pretty && !newLine(stack.size())))
+                        return false;
+
+                    expect = stack.back() == '{' ? Expect::Key : Expect::Value;
+                    continue;
+                }
+
+                if (ch == (stack.back() == '{' ? '}' : ']')) {
+                    if (!close(expect))
+                        return false;
+                    continue;
+                }
+
+                return fail(pos, stack.back() == '{' ? QT_TRANSLATE_NOOP("TextFormatter", "Expected a ',' or '}'") : QT_TRANSLATE_NOOP("TextFormatter", "Expected a ',' or ']'"));
+
+            case Expect::KeyOrClose:
+                if (ch == '}') {
+                    if (!close(expect))
+                        return false;
+                    continue;
+                }
+                Q_FALLTHROUGH();
+
+            case Expect::Key:
+                if (ch != '"')
+                    return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a name in double quotes"));
+
+                if (!beforeToken() || !string())
+                    return false;
+
+                expect = Expect::Colon;
+                continue;
+
+            case Expect::ValueOrClose:
+                if (ch == ']') {
+                    if (!close(expect))
+                        return false;
+                    continue;
+                }
+                Q_FALLTHROUGH();
+
+            case Expect::Value:
+                if (!beforeToken())
+                    return false;
+
+                if (ch == '{' || ch == '[') {
+                    ++pos;
+                    if (!write(ch))
+                        return false;
+
+                    stack.push_back(ch);
+                    justOpened = true;
+                    expect = ch == '{' ? Expect::KeyOrClose : Expect::ValueOrClose;
+                    continue;
+                }
+
+                if (!scalar())
+                    return false;
+
+                expect = stack.empty() ? Expect::End : Expect::CommaOrClose;
+                continue;
+            }
+        }
+    }
+
+private:
+    enum class Expect {
+        Value,
+        ValueOrClose,
+        Key,
+        KeyOrClose,
+        Colon,
+        CommaOrClose,
+        End,
+    };
+
+    // Anything inside an object or array goes on a new line, but an empty one stays as {} or []
+    bool beforeToken()
+    {
+        if (justOpened) {
+            justOpened = false;
+
+            if (pretty)
+                return newLine(stack.size());
+        }
+
+        return true;
+    }
+
+    bool close(Expect &expect)
+    {
+        const char closer = data[pos++];
+
+        if (justOpened) {
+            justOpened = false;
+        }
+        else if (pretty && !newLine(stack.size() - 1)) {
+            return false;
+        }
+
+        if (!write(closer))
+            return false;
+
+        stack.pop_back();
+        expect = stack.empty() ? Expect::End : Expect::CommaOrClose;
+        return true;
+    }
+
+    bool scalar()
+    {
+        const char ch = data[pos];
+
+        if (ch == '"')
+            return string();
+        if (ch == '-' || isDigit(ch))
+            return number();
+
+        for (const char *literal : {"true", "false", "null"}) {
+            if (startsWith(literal)) {
+                const qint64 size = static_cast<qint64>(std::strlen(literal));
+
+                pos += size;
+                return write(literal, size);
+            }
+        }
+
+        return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a value"));
+    }
+
+    // Strings are copied as they are, escapes and all, once they are known to be valid
+    bool string()
+    {
+        const qint64 start = pos++;
+
+        while (pos < length) {
+            const uchar ch = static_cast<uchar>(data[pos]);
+
+            if (ch == '"') {
+                ++pos;
+                return write(data + start, pos - start);
+            }
+
+            if (ch == '\\') {
+                if (pos + 1 >= length)
+                    break;
+
+                const char escaped = data[pos + 1];
+
+                if (escaped == 'u') {
+                    for (qint64 i = pos + 2; i < pos + 6; ++i) {
+                        if (i >= length || !isHexDigit(data[i]))
+                            return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "A \\u escape needs 4 hex digits"));
+                    }
+                    pos += 6;
+                    continue;
+                }
+
+                if (std::strchr("\"\\/bfnrt", escaped) == nullptr || escaped == '\0')
+                    return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "This is not a valid escape"));
+
+                pos += 2;
+                continue;
+            }
+
+            if (ch < 0x20)
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Control characters in strings must be escaped"));
+
+            ++pos;
+        }
+
+        return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The string is never closed"));
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool number()
+    {
+        const qint64 start = pos;
+
+        auto digits = [this]() {
+            const qint64 first = pos;
+            while (pos < length && isDigit(data[pos]))
+                ++pos;
+            return pos > first;
+        };
+
+        if (data[pos] == '-')
+            ++pos;
+
+        if (pos < length && data[pos] == '0') {
+            ++pos;
+        }
+        else if (!digits()) {
+            return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "This is not a valid number"));
+        }
+
+        if (pos < length && data[pos] == '.') {
+            ++pos;
+            if (!digits())
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "This is not a valid number"));
+        }
+
+        if (pos < length && (data[pos] == 'e' || data[pos] == 'E')) {
+            ++pos;
+            if (pos < length && (data[pos] == '+' || data[pos] == '-'))
+                ++pos;
+            if (!digits())
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "This is not a valid number"));
+        }
+
+        return write(data + start, pos - start);
+    }
+
+    // The { and [ that are still open
+    std::vector<char> stack;
+    bool justOpened = false;
+};
+
+class XmlFormatter : public Formatter
+{
+public:
+    using Formatter::Formatter;
+
+    bool run()
+    {
+        while (pos < length) {
+            if (!reportProgress())
+                return false;
+
+            const bool ok = data[pos] == '<' ? markup() : text();
+
+            if (!ok)
+                return false;
+        }
+
+        if (!open.empty())
+            return fail(open.back().start, QT_TRANSLATE_NOOP("TextFormatter", "This element is never closed"));
+        if (!rootClosed)
+            return fail(length, QT_TRANSLATE_NOOP("TextFormatter", "There is no root element"));
+
+        return true;
+    }
+
+private:
+    enum class Token {
+        StartTag,
+        EndTag,
+        Other,
+    };
+
+    struct Element {
+        std::string_view name;
+        qint64 start;
+    };
+
+    static bool isNameChar(char ch)
+    {
+        return !isSpace(ch) && ch != '/' && ch != '>' && ch != '<' && ch != '=' && ch != '"' && ch != '\'';
+    }
+
+    std::string_view name()
+    {
+        const qint64 start = pos;
+
+        while (pos < length && isNameChar(data[pos]))
+            ++pos;
+
+        return std::string_view(data + start, static_cast<size_t>(pos - start));
+    }
+
+    // Only the shape of a reference is checked, &name; &#digits; or &#xhex;
+    bool checkReferences(qint64 start, qint64 end)
+    {
+        for (qint64 i = start; i < end; ++i) {
+            if (data[i] != '&')
+                continue;
+
+            qint64 j = i + 1;
+            if (j < end && data[j] == '#') {
+                ++j;
+                const bool hex = j < end && data[j] == 'x';
+                if (hex)
+                    ++j;
+
+                const qint64 first = j;
+                while (j < end && (hex ? isHexDigit(data[j]) : isDigit(data[j])))
+                    ++j;
+
+                if (j == first || j >= end || data[j] != ';')
+                    return fail(i, QT_TRANSLATE_NOOP("TextFormatter", "This is not a valid character reference"));
+            }
+            else {
+                const qint64 first = j;
+                while (j < end && isNameChar(data[j]) && data[j] != '&' && data[j] != ';')
+                    ++j;
+
+                if (j == first || j >= end || data[j] != ';')
+                    return fail(i, QT_TRANSLATE_NOOP("TextFormatter", "A '&' has to start an entity reference such as &amp;"));
+            }
+
+            i = j;
+        }
+
+        return true;
+    }
+
+    bool text()
+    {
+        const qint64 start = pos;
+        const void *found = std::memchr(data + pos, '<', static_cast<size_t>(length - pos));
+        const qint64 end = found ? static_cast<const char *>(found) - data : length;
+
+        pos = end;
+
+        qint64 first = start;
+        qint64 last = end;
+        while (first < last && isSpace(data[first]))
+            ++first;
+        while (last > first && isSpace(data[last - 1]))
+            --last;
+
+        // Only whitespace, which is dropped as the lines are laid out again
+        if (first == last)
+            return true;
+
+        if (open.empty())
+            return fail(first, QT_TRANSLATE_NOOP("TextFormatter", "Text is only allowed inside the root element"));
+
+        if (!checkReferences(first, last))
+            return false;
+
+        if (!pretty)
+            return write(data + start, end - start);
+
+        const std::string_view trimmed(data + first, static_cast<size_t>(last - first));
+
+        // Text that is all an element holds stays on the line with its tags
+        if (lastToken == Token::StartTag && pendingText.empty()) {
+            pendingText = trimmed;
+            return true;
+        }
+
+        return flushPendingText() && newLine(open.size()) && write(trimmed);
+    }
+
+    bool markup()
+    {
+        const qint64 start = pos;
+
+        if (startsWith("<!--")) {
+            const qint64 end = find(pos + 4, "-->");
+            if (end < 0)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The comment is never closed"));
+
+            pos = end + 3;
+            return token(Token::Other, start);
+        }
+
+        if (startsWith("<![CDATA[")) {
+            if (open.empty())
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "CDATA is only allowed inside the root element"));
+
+            const qint64 end = find(pos + 9, "]]>");
+            if (end < 0)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The CDATA section is never closed"));
+
+            pos = end + 3;
+            return token(Token::Other, start);
+        }
+
+        if (startsWith("<?")) {
+            const qint64 end = find(pos + 2, "?>");
+            if (end < 0)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The processing instruction is never closed"));
+
+            pos = end + 2;
+            return token(Token::Other, start);
+        }
+
+        if (startsWith("<!")) {
+            if (!open.empty() || rootClosed)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "A DOCTYPE has to come before the root element"));
+
+            return doctype() && token(Token::Other, start);
+        }
+
+        if (startsWith("</")) {
+            pos += 2;
+            const std::string_view tagName = name();
+            skipSpaces();
+
+            if (pos >= length || data[pos] != '>')
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a '>' to end the tag"));
+            ++pos;
+
+            if (open.empty() || open.back().name != tagName)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "This end tag doesn't match the element that is open"));
+
+            open.pop_back();
+            rootClosed = open.empty();
+
+            return token(Token::EndTag, start);
+        }
+
+        ++pos;
+        const std::string_view tagName = name();
+
+        if (tagName.empty())
+            return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected the name of an element"));
+        if (open.empty() && rootClosed)
+            return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "There can only be one root element"));
+
+        for (;;) {
+            const qint64 beforeSpaces = pos;
+            skipSpaces();
+
+            if (pos >= length)
+                return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The tag is never closed"));
+
+            if (data[pos] == '>') {
+                ++pos;
+                open.push_back({tagName, start});
+                return token(Token::StartTag, start);
+            }
+
+            if (data[pos] == '/') {
+                if (pos + 1 >= length || data[pos + 1] != '>')
+                    return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a '>' after the '/'"));
+
+                pos += 2;
+                rootClosed = rootClosed || open.empty();
+                return token(Token::Other, start);
+            }
+
+            if (pos == beforeSpaces || name().empty())
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected the name of an attribute"));
+
+            skipSpaces();
+            if (pos >= length || data[pos] != '=')
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Expected a '=' after the attribute name"));
+            ++pos;
+            skipSpaces();
+
+            if (pos >= length || (data[pos] != '"' && data[pos] != '\''))
+                return fail(pos, QT_TRANSLATE_NOOP("TextFormatter", "Attribute values have to be in quotes"));
+
+            const qint64 valueStart = ++pos;
+            const void *found = std::memchr(data + pos, data[pos - 1], static_cast<size_t>(length - pos));
+            if (found == nullptr)
+                return fail(valueStart - 1, QT_TRANSLATE_NOOP("TextFormatter", "The attribute value is never closed"));
+
+            pos = static_cast<const char *>(found) - data;
+
+            if (std::memchr(data + valueStart, '<', static_cast<size_t>(pos - valueStart)) != nullptr)
+                return fail(valueStart, QT_TRANSLATE_NOOP("TextFormatter", "Attribute values can't contain '<'"));
+            if (!checkReferences(valueStart, pos))
+                return false;
+
+            ++pos;
+        }
+    }
+
+    // Up to the '>' that isn't quoted or inside the [...] of an internal subset
+    bool doctype()
+    {
+        const qint64 start = pos;
+        char quote = 0;
+        int brackets = 0;
+
+        for (pos += 2; pos < length; ++pos) {
+            const char ch = data[pos];
+
+            if (quote) {
+                if (ch == quote)
+                    quote = 0;
+            }
+            else if (ch == '"' || ch == '\'') {
+                quote = ch;
+            }
+            else if (ch == '[') {
+                ++brackets;
+            }
+            else if (ch == ']') {
+                --brackets;
+            }
+            else if (ch == '>' && brackets <= 0) {
+                ++pos;
+                return true;
+            }
+        }
+
+        return fail(start, QT_TRANSLATE_NOOP("TextFormatter", "The DOCTYPE is never closed"));
+    }
+
+    // Writes the markup from start up to where it got to
+    bool token(Token type, qint64 start)
+    {
+        const std::string_view markup(data + start, static_cast<size_t>(pos - start));
+        const Token previous = lastToken;
+
+        lastToken = type;
+
+        if (!pretty)
+            return write(markup);
+
+        switch (type) {
+        case Token::StartTag:
+            if (!flushPendingText() || !startLine(open.size() - 1))
+                return false;
+            break;
+
+        case Token::EndTag:
+            // An element that only holds text, or nothing at all, is kept on one line
+            if (previous == Token::StartTag) {
+                const bool ok = write(pendingText);
+                pendingText = std::string_view();
+
+                if (!ok)
+                    return false;
+            }
+            else if (!startLine(open.size())) {
+                return false;
+            }
+            break;
+
+        case Token::Other:
+            if (!flushPendingText() || !startLine(open.size()))
+                return false;
+            break;
+        }
+
+        return write(markup);
+    }
+
+    bool flushPendingText()
+    {
+        if (pendingText.empty())
+            return true;
+
+        const std::string_view text = pendingText;
+        pendingText = std::string_view();
+        lastToken = Token::Other;
+
+        return newLine(open.size()) && write(text);
+    }
+
+    // Everything but the very first thing goes on a line of its own
+    bool startLine(size_t depth)
+    {
+        if (!started) {
+            started = true;
+
+            for (size_t i = 0; i < depth; ++i) {
+                if (!write(options.indent.constData(), options.indent.size()))
+                    return false;
+            }
+
+            return true;
+        }
+
+        return newLine(depth);
+    }
+
+    std::vector<Element> open;
+    bool rootClosed = false;
+
+    bool started = false;
+    Token lastToken = Token::Other;
+    std::string_view pendingText;
+};
+
+}
+
+bool TextFormatter::apply(Kind kind, const char *data, qint64 length, QByteArray &out, const Options &options, Error &error, const Progress &progress)
+{
+    const bool pretty = kind == JsonPrettyPrint || kind == XmlPrettyPrint;
+
+    error = Error();
+    out.clear();
+
+    // Pretty printing a minified document makes it grow by about half again
+    out.reserve(static_cast<int>(qMin(MAX_OUTPUT_LENGTH, pretty ? length + length / 2 : length)));
+
+    bool ok = false;
+
+    if (kind == JsonPrettyPrint || kind == JsonMinify) {
+        ok = JsonFormatter(data, length, out, options, error, progress, pretty).run();
+    }
+    else {
+        ok = XmlFormatter(data, length, out, options, error, progress, pretty).run();
+    }
+
+    if (!ok) {
+        out.clear();
+        out.squeeze();
+    }
+
+    return ok;
+}
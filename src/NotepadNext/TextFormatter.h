@@ -0,0 +1,66 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TEXTFORMATTER_H
+#define TEXTFORMATTER_H
+
+#include <QByteArray>
+
+#include <functional>
+
+
+// Pretty prints or minifies JSON and XML. The text is read as a stream of tokens straight from the buffer; no tree
+// of the document is ever built. Each token is written to an output buffer reserved up front. The text is checked
+// as it goes, and the first thing that isn't well formed stops it with the position it was found at. Everything
+// here is safe to call from any thread.
+class TextFormatter
+{
+public:
+    enum Kind {
+        JsonPrettyPrint,
+        JsonMinify,
+        XmlPrettyPrint,
+        XmlMinify,
+    };
+
+    struct Options {
+        // One level of indentation, and what goes between lines, when pretty printing
+        QByteArray indent = QByteArrayLiteral("    ");
+        QByteArray eol = QByteArrayLiteral("\n");
+    };
+
+    struct Error {
+        // The byte of the input the problem was found at, or -1 if there wasn't one (i.e. it was stopped)
+        qint64 position = -1;
+
+        // Untranslated, see QCoreApplication::translate("TextFormatter", message)
+        const char *message = nullptr;
+    };
+
+    // Called every CHUNK_SIZE bytes or so with how many input bytes have been done, returning false stops it
+    using Progress = std::function<bool(qint64 processed)>;
+
+    static constexpr qint64 CHUNK_SIZE = 1 << 20;
+
+    // Sets out to the formatted text. Returns false if the text isn't well formed, the result would be too large to
+    // hold or progress asked to stop, in which case out is left empty.
+    static bool apply(Kind kind, const char *data, qint64 length, QByteArray &out, const Options &options, Error &error, const Progress &progress = Progress());
+};
+
+#endif // TEXTFORMATTER_H
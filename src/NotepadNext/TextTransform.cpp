@@ -0,0 +1,471 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TextTransform.h"
+
+#include <cstring>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Even on Qt 6 a QByteArray much bigger than this is more than anyone wants in an editor
+static constexpr qint64 MAX_OUTPUT_LENGTH = std::numeric_limits<int>::max() - 64;
+
+static constexpr char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Set in the decode tables for anything that isn't a Base64 digit. Decoded values only use the low 24 bits.
+static constexpr quint32 INVALID = 0x01000000;
+
+namespace {
+
+// Every pair of output characters for 12 bits of input, so 3 bytes are encoded with 2 lookups
+struct Base64EncodeTable {
+    char pairs[4096][2] = {};
+};
+
+// The value of each character already shifted to its place in a group of 4, so a group is decoded by or-ing 4
+// lookups together. Both the standard and the URL safe alphabets are accepted.
+struct Base64DecodeTable {
+    quint32 shifted[4][256] = {};
+};
+
+struct PercentEncodeTable {
+    bool unreserved[256] = {};
+};
+
+constexpr Base64EncodeTable makeBase64EncodeTable()
+{
+    Base64EncodeTable table;
+
+    for (int i = 0; i < 4096; ++i) {
+        table.pairs[i][0] = BASE64_ALPHABET[i >> 6];
+        table.pairs[i][1] = BASE64_ALPHABET[i & 63];
+    }
+
+    return table;
+}
+
+constexpr Base64DecodeTable makeBase64DecodeTable()
+{
+    Base64DecodeTable table;
+
+    for (int group = 0; group < 4; ++group) {
+        for (int ch = 0; ch < 256; ++ch) {
+            table.shifted[group][ch] = INVALID;
+        }
+
+        for (quint32 value = 0; value < 64; ++value) {
+            table.shifted[group][static_cast<uchar>(BASE64_ALPHABET[value])] = value << (6 * (3 - group));
+        }
+
+        table.shifted[group]['-'] = 62u << (6 * (3 - group));
+        table.shifted[group]['_'] = 63u << (6 * (3 - group));
+    }
+
+    return table;
+}
+
+// The same characters QByteArray::toPercentEncoding() leaves alone
+constexpr PercentEncodeTable makePercentEncodeTable()
+{
+    PercentEncodeTable table;
+
+    for (int ch = 0; ch < 256; ++ch) {
+        table.unreserved[ch] = (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') ||
+                               ch == '-' || ch == '.' || ch == '_' || ch == '~';
+    }
+
+    return table;
+}
+
+constexpr Base64EncodeTable base64EncodeTable = makeBase64EncodeTable();
+constexpr Base64DecodeTable base64DecodeTable = makeBase64DecodeTable();
+constexpr PercentEncodeTable percentEncodeTable = makePercentEncodeTable();
+
+#ifdef __SSE2__
+// SSE2 has no byte shuffle, so the 4 groups of 3 bytes are loaded into the 4 lanes with plain loads. Each load also
+// takes the byte after its group, so 13 bytes have to be there. The 16 digit values end up in place with shifts and
+// masks, and are turned into characters by working out each one's offset with comparisons instead of looking it up.
+void base64Encode12(const uchar *in, char *out)
+{
+    quint32 groups[4];
+    for (int i = 0; i < 4; ++i) {
+        std::memcpy(&groups[i], in + 3 * i, 4);
+    }
+
+    const __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(groups));
+    auto bits = [&](int left, int right, int mask) {
+        const __m128i shifted = left > 0 ? _mm_slli_epi32(lanes, left) : _mm_srli_epi32(lanes, right);
+        return _mm_and_si128(shifted, _mm_set1_epi32(mask));
+    };
+
+    // A lane holds b0 | b1 << 8 | b2 << 16, and its bytes become the 4 digit values in order
+    __m128i values = bits(0, 2, 0x0000003F);
+    values = _mm_or_si128(values, bits(12, 0, 0x00003000));
+    values = _mm_or_si128(values, bits(0, 4, 0x00000F00));
+    values = _mm_or_si128(values, bits(10, 0, 0x003C0000));
+    values = _mm_or_si128(values, bits(0, 6, 0x00030000));
+    values = _mm_or_si128(values, bits(8, 0, 0x3F000000));
+
+    // 'A' for 0 to 25, 'a' - 26 from 26, '0' - 52 from 52, then '+' and '/' for the last two
+    __m128i offset = _mm_set1_epi8('A');
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(values, _mm_set1_epi8(25)), _mm_set1_epi8('a' - 26 - 'A')));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(values, _mm_set1_epi8(51)), _mm_set1_epi8('0' - 52 - ('a' - 26))));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpeq_epi8(values, _mm_set1_epi8(62)), _mm_set1_epi8('+' - 62 - ('0' - 52))));
+    offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpeq_epi8(values, _mm_set1_epi8(63)), _mm_set1_epi8('/' - 63 - ('0' - 52))));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_add_epi8(values, offset));
+}
+
+// Decodes 16 digits into 12 bytes, or returns false without writing anything if any of them isn't a digit (which
+// includes whitespace and padding). Both the standard and the URL safe alphabets are accepted. Each group's 3 bytes
+// are written with a 4 byte store, so the byte after the 12 gets overwritten.
+bool base64Decode16(const uchar *in, char *out)
+{
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+
+    // Anything from 0x80 up is negative to these signed comparisons, so it is never in any of the ranges
+    auto inRange = [&](char first, char last) {
+        return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(last + 1), chars));
+    };
+    auto is = [&](char ch) { return _mm_cmpeq_epi8(chars, _mm_set1_epi8(ch)); };
+
+    const __m128i upper = inRange('A', 'Z');
+    const __m128i lower = inRange('a', 'z');
+    const __m128i digit = inRange('0', '9');
+    const __m128i plus = _mm_or_si128(is('+'), is('-'));
+    const __m128i slash = _mm_or_si128(is('/'), is('_'));
+
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    __m128i values = _mm_and_si128(upper, _mm_sub_epi8(chars, _mm_set1_epi8('A')));
+    values = _mm_or_si128(values, _mm_and_si128(lower, _mm_sub_epi8(chars, _mm_set1_epi8('a' - 26))));
+    values = _mm_or_si128(values, _mm_and_si128(digit, _mm_sub_epi8(chars, _mm_set1_epi8('0' - 52))));
+    values = _mm_or_si128(values, _mm_and_si128(plus, _mm_set1_epi8(62)));
+    values = _mm_or_si128(values, _mm_and_si128(slash, _mm_set1_epi8(63)));
+
+    // A lane holds the 4 digit values v0 | v1 << 8 | v2 << 16 | v3 << 24, and its low 3 bytes become the output
+    auto bits = [&](int left, int right, int mask) {
+        const __m128i shifted = left > 0 ? _mm_slli_epi32(values, left) : _mm_srli_epi32(values, right);
+        return _mm_and_si128(shifted, _mm_set1_epi32(mask));
+    };
+
+    __m128i bytes = bits(2, 0, 0x000000FC);
+    bytes = _mm_or_si128(bytes, bits(0, 12, 0x00000003));
+    bytes = _mm_or_si128(bytes, bits(4, 0, 0x0000F000));
+    bytes = _mm_or_si128(bytes, bits(0, 10, 0x00000F00));
+    bytes = _mm_or_si128(bytes, bits(6, 0, 0x00C00000));
+    bytes = _mm_or_si128(bytes, bits(0, 8, 0x003F0000));
+
+    quint32 groups[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(groups), bytes);
+
+    for (int i = 0; i < 4; ++i) {
+        std::memcpy(out + 3 * i, &groups[i], 4);
+    }
+
+    return true;
+}
+#endif
+
+int hexValue(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    return -1;
+}
+
+}
+
+bool TextTransform::apply(Kind kind, const char *data, qint64 length, QByteArray &out, const Progress &progress)
+{
+    bool ok = false;
+
+    switch (kind) {
+    case Base64Encode:
+        ok = base64Encode(data, length, out, progress);
+        break;
+    case Base64Decode:
+        ok = base64Decode(data, length, out, progress);
+        break;
+    case PercentEncode:
+        ok = percentEncode(data, length, out, progress);
+        break;
+    case PercentDecode:
+        ok = percentDecode(data, length, out, progress);
+        break;
+    }
+
+    if (!ok) {
+        out.clear();
+    }
+
+    return ok;
+}
+
+bool TextTransform::base64Encode(const char *data, qint64 length, QByteArray &out, const Progress &progress)
+{
+    const qint64 outLength = (length + 2) / 3 * 4;
+    if (outLength > MAX_OUTPUT_LENGTH)
+        return false;
+
+    out.resize(static_cast<int>(outLength));
+
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+    char *o = out.data();
+    const qint64 whole = length - length % 3;
+    qint64 i = 0;
+
+    while (i < whole) {
+        const qint64 chunkEnd = qMin(whole, i + CHUNK_SIZE / 3 * 3);
+
+#ifdef __SSE2__
+        for (; i + 12 < chunkEnd; i += 12) {
+            base64Encode12(in + i, o);
+            o += 16;
+        }
+#endif
+
+        for (; i < chunkEnd; i += 3) {
+            const quint32 bits = static_cast<quint32>(in[i]) << 16 | static_cast<quint32>(in[i + 1]) << 8 | in[i + 2];
+
+            std::memcpy(o, base64EncodeTable.pairs[bits >> 12], 2);
+            std::memcpy(o + 2, base64EncodeTable.pairs[bits & 0xFFF], 2);
+            o += 4;
+        }
+
+        if (progress && !progress(i))
+            return false;
+    }
+
+    if (length - whole == 1) {
+        const quint32 bits = static_cast<quint32>(in[i]) << 16;
+
+        o[0] = BASE64_ALPHABET[bits >> 18];
+        o[1] = BASE64_ALPHABET[(bits >> 12) & 63];
+        o[2] = '=';
+        o[3] = '=';
+    }
+    else if (length - whole == 2) {
+        const quint32 bits = static_cast<quint32>(in[i]) << 16 | static_cast<quint32>(in[i + 1]) << 8;
+
+        o[0] = BASE64_ALPHABET[bits >> 18];
+        o[1] = BASE64_ALPHABET[(bits >> 12) & 63];
+        o[2] = BASE64_ALPHABET[(bits >> 6) & 63];
+        o[3] = '=';
+    }
+
+    return true;
+}
+
+bool TextTransform::base64Decode(const char *data, qint64 length, QByteArray &out, const Progress &progress)
+{
+    if (length / 4 * 3 + 3 > MAX_OUTPUT_LENGTH)
+        return false;
+
+    out.resize(static_cast<int>(length / 4 * 3 + 3));
+
+    const quint32 (&shifted)[4][256] = base64DecodeTable.shifted;
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+    char *const begin = out.data();
+    char *o = begin;
+
+    // A group of 4 digits that is split up by whitespace is put together here one digit at a time
+    quint32 group = 0;
+    int digits = 0;
+    int padding = 0;
+
+    qint64 i = 0;
+    while (i < length) {
+        const qint64 chunkEnd = qMin(length, i + CHUNK_SIZE);
+
+        while (i < chunkEnd) {
+            // Whole groups of digits, which is nearly everything between line breaks
+            if (digits == 0 && padding == 0) {
+#ifdef __SSE2__
+                while (i + 16 <= chunkEnd && base64Decode16(in + i, o)) {
+                    o += 12;
+                    i += 16;
+                }
+#endif
+
+                while (i + 4 <= chunkEnd) {
+                    const quint32 bits = shifted[0][in[i]] | shifted[1][in[i + 1]] | shifted[2][in[i + 2]] | shifted[3][in[i + 3]];
+                    if (bits & INVALID)
+                        break;
+
+                    o[0] = static_cast<char>(bits >> 16);
+                    o[1] = static_cast<char>(bits >> 8);
+                    o[2] = static_cast<char>(bits);
+                    o += 3;
+                    i += 4;
+                }
+
+                if (i == chunkEnd)
+                    break;
+            }
+
+            const uchar ch = in[i++];
+            const quint32 value = shifted[3][ch];
+
+            if (!(value & INVALID)) {
+                if (padding > 0)
+                    return false;
+
+                group = group << 6 | value;
+                if (++digits == 4) {
+                    o[0] = static_cast<char>(group >> 16);
+                    o[1] = static_cast<char>(group >> 8);
+                    o[2] = static_cast<char>(group);
+                    o += 3;
+                    group = 0;
+                    digits = 0;
+                }
+            }
+            else if (ch == '=') {
+                ++padding;
+                if (digits < 2 || digits + padding > 4)
+                    return false;
+            }
+            else if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') {
+                return false;
+            }
+        }
+
+        if (progress && !progress(i))
+            return false;
+    }
+
+    if (digits == 1)
+        return false;
+    else if (digits == 2) {
+        *o++ = static_cast<char>(group >> 4);
+    }
+    else if (digits == 3) {
+        *o++ = static_cast<char>(group >> 10);
+        *o++ = static_cast<char>(group >> 2);
+    }
+
+    out.resize(static_cast<int>(o - begin));
+
+    return true;
+}
+
+bool TextTransform::percentEncode(const char *data, qint64 length, QByteArray &out, const Progress &progress)
+{
+    const bool (&unreserved)[256] = percentEncodeTable.unreserved;
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+
+    // Counting first is cheap next to growing the output as it goes
+    qint64 outLength = length;
+    for (qint64 i = 0; i < length; ++i) {
+        if (!unreserved[in[i]])
+            outLength += 2;
+    }
+
+    if (outLength > MAX_OUTPUT_LENGTH)
+        return false;
+
+    out.resize(static_cast<int>(outLength));
+
+    char *o = out.data();
+    qint64 i = 0;
+
+    while (i < length) {
+        const qint64 chunkEnd = qMin(length, i + CHUNK_SIZE);
+
+        for (; i < chunkEnd; ++i) {
+            const uchar ch = in[i];
+
+            if (unreserved[ch]) {
+                *o++ = static_cast<char>(ch);
+            }
+            else {
+                o[0] = '%';
+                o[1] = HEX_DIGITS[ch >> 4];
+                o[2] = HEX_DIGITS[ch & 0xF];
+                o += 3;
+            }
+        }
+
+        if (progress && !progress(i))
+            return false;
+    }
+
+    return true;
+}
+
+bool TextTransform::percentDecode(const char *data, qint64 length, QByteArray &out, const Progress &progress)
+{
+    if (length > MAX_OUTPUT_LENGTH)
+        return false;
+
+    out.resize(static_cast<int>(length));
+
+    char *const begin = out.data();
+    char *o = begin;
+    qint64 i = 0;
+
+    while (i < length) {
+        const qint64 chunkEnd = qMin(length, i + CHUNK_SIZE);
+
+        while (i < chunkEnd) {
+            // Copy everything up to the next escape in one go
+            const char *percent = static_cast<const char *>(std::memchr(data + i, '%', static_cast<size_t>(chunkEnd - i)));
+            const qint64 runEnd = percent ? percent - data : chunkEnd;
+
+            std::memcpy(o, data + i, static_cast<size_t>(runEnd - i));
+            o += runEnd - i;
+            i = runEnd;
+
+            if (i == chunkEnd)
+                break;
+
+            // Anything that isn't a valid escape is kept as it is
+            const int high = i + 2 < length ? hexValue(data[i + 1]) : -1;
+            const int low = high >= 0 ? hexValue(data[i + 2]) : -1;
+
+            if (low >= 0) {
+                *o++ = static_cast<char>(high << 4 | low);
+                i += 3;
+            }
+            else {
+                *o++ = '%';
+                i += 1;
+            }
+        }
+
+        if (progress && !progress(i))
+            return false;
+    }
+
+    out.resize(static_cast<int>(o - begin));
+
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TEXTTRANSFORM_H
+#define TEXTTRANSFORM_H
+
+#include <QByteArray>
+
+#include <functional>
+
+
+// Encodes or decodes a block of text, such as a selection read straight from the editor with rangePointer(). The
+// output is sized once up front and written in place, a few bytes per table lookup, rather than going through the
+// intermediate copies QByteArray::toBase64() and friends make. Everything here is safe to call from any thread.
+class TextTransform
+{
+public:
+    enum Kind {
+        Base64Encode,
+        Base64Decode,
+        PercentEncode,
+        PercentDecode,
+    };
+
+    // Called every CHUNK_SIZE bytes or so with how many input bytes have been done, returning false stops the transform
+    using Progress = std::function<bool(qint64 processed)>;
+
+    static constexpr qint64 CHUNK_SIZE = 1 << 20;
+
+    // Sets out to the transformed text. Returns false if the text can't be decoded, the result would be too large to
+    // hold or progress asked to stop, in which case out is left empty.
+    static bool apply(Kind kind, const char *data, qint64 length, QByteArray &out, const Progress &progress = Progress());
+
+private:
+    static bool base64Encode(const char *data, qint64 length, QByteArray &out, const Progress &progress);
+    static bool base64Decode(const char *data, qint64 length, QByteArray &out, const Progress &progress);
+    static bool percentEncode(const char *data, qint64 length, QByteArray &out, const Progress &progress);
+    static bool percentDecode(const char *data, qint64 length, QByteArray &out, const Progress &progress);
+};
+
+#endif // TEXTTRANSFORM_H
@@ -17,10 +17,12 @@
  */
 
 #include "TranslationManager.h"
+#include "ApplicationSettings.h"
 
 #include <QApplication>
 #include <QDirIterator>
 #include <QDebug>
+#include <QFile>
 
 #include <memory>
 
@@ -38,7 +40,10 @@ TranslationManager::TranslationManager(QObject *parent, const QString &path)
 
 QStringList TranslationManager::availableTranslations() const
 {
-    QStringList translations;
+    if (translationsListed) {
+        return translations;
+    }
+
     QDirIterator it(path);
 
     while (it.hasNext()) {
@@ -51,6 +56,9 @@ QStringList TranslationManager::availableTranslations() const
         }
     }
 
+    translations.sort();
+    translationsListed = true;
+
     return translations;
 }
 
@@ -65,6 +73,58 @@ QString TranslationManager::FormatLocaleTerritoryAndLanguage(QLocale &locale)
     return QStringLiteral("%1 / %2").arg(language, territory);
 }
 
+// Picks from the translations there actually are, rather than having QTranslator try every file name each of the
+// locale's UI languages could have. The first UI language with an exact match wins, else the first one with a
+// translation for the same language in another territory (e.g. "pt_PT" for "pt_BR"). Empty if there is none.
+QString TranslationManager::resolveTranslation(const QLocale &locale) const
+{
+    const QStringList available = availableTranslations();
+    QStringList languages = locale.uiLanguages();
+
+    if (languages.isEmpty()) {
+        languages.append(locale.name());
+    }
+
+    for (QString language : languages) {
+        language.replace(QLatin1Char('-'), QLatin1Char('_'));
+
+        if (available.contains(language)) {
+            return language;
+        }
+
+        // The script is never part of the file names, e.g. "zh_Hans_CN"
+        const QStringList parts = language.split(QLatin1Char('_'));
+        if (parts.size() > 2 && available.contains(parts.first() + QLatin1Char('_') + parts.last())) {
+            return parts.first() + QLatin1Char('_') + parts.last();
+        }
+    }
+
+    for (const QString &language : qAsConst(languages)) {
+        const QString prefix = language.section(QLatin1Char('-'), 0, 0).section(QLatin1Char('_'), 0, 0) + QLatin1Char('_');
+
+        for (const QString &name : available) {
+            if (name.startsWith(prefix)) {
+                return name;
+            }
+        }
+    }
+
+    return QString();
+}
+
+bool TranslationManager::installTranslation(const QString &fileName)
+{
+    std::unique_ptr<QTranslator> translator = std::make_unique<QTranslator>();
+
+    if (translator->load(fileName) && QCoreApplication::installTranslator(translator.get())) {
+        qInfo() << "Loaded translation" << translator.get()->filePath();
+        translators.append(translator.release());
+        return true;
+    }
+
+    return false;
+}
+
 void TranslationManager::loadSystemDefaultTranslation()
 {
     // The wrong translation file may be loaded when passing Locale::system() to loadTranslation function, e.g. "zh_CN" translation file will be loaded when the locale is "en_US". It's probably a Qt bug.
@@ -75,20 +135,50 @@ void TranslationManager::loadTranslation(QLocale locale)
 {
     qInfo(Q_FUNC_INFO);
 
-    const QStringList filenames{QStringList{QApplication::applicationName(), "qt", "qtbase"}};
+    // What the locale resolves to only changes with the translations that are built in, so it is worked out once per version
+    ApplicationSettings settings;
+    const QString cacheKey = QStringLiteral("%1@%2").arg(locale.uiLanguages().join(QLatin1Char(',')), QStringLiteral(APP_VERSION));
+    const QStringList cached = settings.value(QStringLiteral("App/ResolvedTranslation")).toStringList();
+    QString localeName;
 
-    for (const auto& filename : filenames) {
-        std::unique_ptr<QTranslator> translator = std::make_unique<QTranslator>();
+    if (cached.size() == 2 && cached.first() == cacheKey) {
+        localeName = cached.last();
+    }
+    else {
+        localeName = resolveTranslation(locale);
+        settings.setValue(QStringLiteral("App/ResolvedTranslation"), QStringList{cacheKey, localeName});
+    }
 
-        if (translator->load(locale, filename, QStringLiteral("_"), path)) {
-            if (QCoreApplication::installTranslator(translator.get())) {
-                qInfo() << "Loaded translation" << translator.get()->filePath();
-                translators.append(translator.release());
+    // Nothing to do for the untranslated text, Qt's own text is left untranslated as well to match it
+    if (localeName.isEmpty()) {
+        qInfo("No translation for %s", qUtf8Printable(locale.name()));
+        return;
+    }
+
+    installTranslation(QStringLiteral("%1%2_%3.qm").arg(path, QApplication::applicationName(), localeName));
+
+    // Qt's files are often only named for the language, see i18n.pri
+    for (const QString &filename : {QStringLiteral("qt"), QStringLiteral("qtbase")}) {
+        for (const QString &name : {localeName, localeName.section(QLatin1Char('_'), 0, 0)}) {
+            const QString fileName = QStringLiteral("%1%2_%3.qm").arg(path, filename, name);
+
+            if (QFile::exists(fileName)) {
+                deferredFiles.append(fileName);
+                break;
             }
         }
     }
 }
 
+void TranslationManager::loadDeferredTranslations()
+{
+    for (const QString &fileName : qAsConst(deferredFiles)) {
+        installTranslation(fileName);
+    }
+
+    deferredFiles.clear();
+}
+
 void TranslationManager::loadTranslationByName(QString localeName)
 {
     if (localeName.isEmpty()) {
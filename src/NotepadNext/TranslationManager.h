@@ -31,6 +31,7 @@ class TranslationManager : public QObject
 public:
     TranslationManager(QObject *parent, const QString &path);
 
+    // The locale names there are translations of the application for, sorted. It is only looked up once.
     QStringList availableTranslations() const;
 
     static QString FormatLocaleTerritoryAndLanguage(QLocale &locale);
@@ -40,8 +41,19 @@ public slots:
     void loadTranslation(QLocale locale);
     void loadTranslationByName(QString localeName);
 
+    // Qt's own translations are only seen in the standard dialogs and buttons, so they are left until after
+    // the window is shown. Anything loadTranslation() found for them is installed by this.
+    void loadDeferredTranslations();
+
 private:
+    QString resolveTranslation(const QLocale &locale) const;
+    bool installTranslation(const QString &fileName);
+
     const QString path;
 
     QList<QTranslator*> translators;
+    QStringList deferredFiles;
+
+    mutable QStringList translations;
+    mutable bool translationsListed = false;
 };
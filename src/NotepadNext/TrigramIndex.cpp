@@ -0,0 +1,896 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TrigramIndex.h"
+#include "FileSearcher.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+
+
+static const quint32 SEGMENT_MAGIC = 0x4e4e5447;
+static const quint32 SEGMENT_VERSION = 1;
+
+static const quint32 FILE_INDEXED = 0x1;
+
+// Bigger files are always searched, their trigrams would match nearly everything anyway
+static const qint64 MAX_INDEXED_FILE_SIZE = 16 * 1024 * 1024;
+
+// Once this many files have changed since the base segment was built it is cheaper to start over
+static const int MAX_DELTA_FILES = 5000;
+
+struct TrigramSegment::Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 fileCount;
+    quint32 trigramCount;
+    quint64 postingCount;
+    quint64 pathBytes;
+};
+
+struct TrigramSegment::FileRecord
+{
+    quint32 pathOffset;
+    quint32 pathLength;
+    qint64 lastModified;
+    qint64 size;
+    quint32 flags;
+    quint32 reserved;
+};
+
+struct TrigramSegment::TrigramRecord
+{
+    quint32 trigram;
+    quint32 count;
+    quint64 start;
+};
+
+static inline uchar foldCase(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int comparePaths(const char *left, quint32 leftLength, const char *right, quint32 rightLength)
+{
+    const int result = std::memcmp(left, right, qMin(leftLength, rightLength));
+
+    if (result != 0)
+        return result;
+
+    return leftLength < rightLength ? -1 : (leftLength > rightLength ? 1 : 0);
+}
+
+TrigramSegment::~TrigramSegment()
+{
+    if (file.isOpen() && data)
+        file.unmap(const_cast<uchar *>(data));
+}
+
+std::shared_ptr<const TrigramSegment> TrigramSegment::map(const QString &fileName)
+{
+    std::shared_ptr<TrigramSegment> segment(new TrigramSegment());
+
+    segment->file.setFileName(fileName);
+    if (!segment->file.open(QIODevice::ReadOnly))
+        return std::shared_ptr<const TrigramSegment>();
+
+    segment->length = segment->file.size();
+    segment->data = segment->file.map(0, segment->length);
+
+    if (!segment->data || !segment->validate())
+        return std::shared_ptr<const TrigramSegment>();
+
+    return segment;
+}
+
+std::shared_ptr<const TrigramSegment> TrigramSegment::fromData(const QByteArray &data)
+{
+    std::shared_ptr<TrigramSegment> segment(new TrigramSegment());
+
+    segment->ownedData = data;
+    segment->data = reinterpret_cast<const uchar *>(segment->ownedData.constData());
+    segment->length = segment->ownedData.size();
+
+    if (!segment->validate())
+        return std::shared_ptr<const TrigramSegment>();
+
+    return segment;
+}
+
+// Makes sure everything the header claims is actually there, so nothing can read past the end
+bool TrigramSegment::validate()
+{
+    if (length < static_cast<qint64>(sizeof(Header)))
+        return false;
+
+    header = reinterpret_cast<const Header *>(data);
+    if (header->magic != SEGMENT_MAGIC || header->version != SEGMENT_VERSION)
+        return false;
+
+    const quint64 expected = sizeof(Header) + quint64(header->fileCount) * sizeof(FileRecord) + quint64(header->trigramCount) * sizeof(TrigramRecord)
+                             + header->postingCount * sizeof(quint32) + header->pathBytes;
+    if (header->postingCount > quint64(length) || header->pathBytes > quint64(length) || expected != quint64(length))
+        return false;
+
+    files = reinterpret_cast<const FileRecord *>(data + sizeof(Header));
+    trigrams = reinterpret_cast<const TrigramRecord *>(files + header->fileCount);
+    postings = reinterpret_cast<const quint32 *>(trigrams + header->trigramCount);
+    pathData = reinterpret_cast<const char *>(postings + header->postingCount);
+
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        if (quint64(files[i].pathOffset) + files[i].pathLength > header->pathBytes)
+            return false;
+    }
+
+    for (quint32 i = 0; i < header->trigramCount; ++i) {
+        if (trigrams[i].start + trigrams[i].count > header->postingCount)
+            return false;
+    }
+
+    return true;
+}
+
+int TrigramSegment::fileCount() const
+{
+    return static_cast<int>(header->fileCount);
+}
+
+int TrigramSegment::find(const QByteArray &relativePath) const
+{
+    int low = 0;
+    int high = fileCount() - 1;
+
+    while (low <= high) {
+        const int middle = low + (high - low) / 2;
+        const int result = comparePaths(pathData + files[middle].pathOffset, files[middle].pathLength, relativePath.constData(), static_cast<quint32>(relativePath.size()));
+
+        if (result == 0)
+            return middle;
+        else if (result < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+
+    return -1;
+}
+
+bool TrigramSegment::matches(int file, qint64 lastModified, qint64 size) const
+{
+    return files[file].lastModified == lastModified && files[file].size == size;
+}
+
+QByteArray TrigramSegment::relativePath(int file) const
+{
+    return QByteArray(pathData + files[file].pathOffset, static_cast<int>(files[file].pathLength));
+}
+
+std::vector<bool> TrigramSegment::candidates(const std::vector<quint32> &required) const
+{
+    const int count = fileCount();
+    std::vector<bool> result(count, false);
+
+    std::vector<const TrigramRecord *> lists;
+    bool missing = false;
+
+    for (quint32 trigram : required) {
+        const TrigramRecord *end = trigrams + header->trigramCount;
+        const TrigramRecord *it = std::lower_bound(trigrams, end, trigram, [](const TrigramRecord &record, quint32 value) { return record.trigram < value; });
+
+        if (it == end || it->trigram != trigram) {
+            missing = true;
+            break;
+        }
+
+        lists.push_back(it);
+    }
+
+    // Intersect the shortest lists first so the working set only ever shrinks
+    if (!missing && !lists.empty()) {
+        std::sort(lists.begin(), lists.end(), [](const TrigramRecord *left, const TrigramRecord *right) { return left->count < right->count; });
+
+        std::vector<quint32> matching(postings + lists.front()->start, postings + lists.front()->start + lists.front()->count);
+        std::vector<quint32> next;
+
+        for (size_t i = 1; i < lists.size() && !matching.empty(); ++i) {
+            const quint32 *list = postings + lists[i]->start;
+
+            next.clear();
+            std::set_intersection(matching.cbegin(), matching.cend(), list, list + lists[i]->count, std::back_inserter(next));
+            matching.swap(next);
+        }
+
+        for (quint32 file : matching) {
+            if (file < quint32(count))
+                result[file] = true;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!(files[i].flags & FILE_INDEXED))
+            result[i] = true;
+    }
+
+    return result;
+}
+
+TrigramSegment::Builder::Builder() :
+    seen((1 << 24) / 64, 0)
+{
+}
+
+void TrigramSegment::Builder::addFile(const QByteArray &relativePath, qint64 lastModified, qint64 size, const QByteArray *text)
+{
+    const quint32 id = static_cast<quint32>(files.size());
+
+    files.push_back({relativePath, lastModified, size, text != Q_NULLPTR});
+
+    if (!text || text->size() < 3)
+        return;
+
+    // Collect the distinct trigrams of the file first, the bitmap is cleared again afterwards
+    const uchar *p = reinterpret_cast<const uchar *>(text->constData());
+    const qsizetype length = text->size();
+    quint32 trigram = (foldCase(p[0]) << 8) | foldCase(p[1]);
+
+    fileTrigrams.clear();
+    for (qsizetype i = 2; i < length; ++i) {
+        trigram = ((trigram << 8) | foldCase(p[i])) & 0xFFFFFF;
+
+        const quint64 bit = Q_UINT64_C(1) << (trigram & 63);
+        quint64 &word = seen[trigram >> 6];
+        if (!(word & bit)) {
+            word |= bit;
+            fileTrigrams.push_back(trigram);
+        }
+    }
+
+    for (quint32 t : fileTrigrams) {
+        postings[t].push_back(id);
+        seen[t >> 6] = 0;
+    }
+}
+
+QByteArray TrigramSegment::Builder::data() const
+{
+    // Files are written sorted by path, so the ids given out while adding them need mapping
+    std::vector<quint32> order(files.size());
+    for (quint32 i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [this](quint32 left, quint32 right) {
+        const QByteArray &l = files[left].relativePath;
+        const QByteArray &r = files[right].relativePath;
+        return comparePaths(l.constData(), static_cast<quint32>(l.size()), r.constData(), static_cast<quint32>(r.size())) < 0;
+    });
+
+    std::vector<quint32> newIds(files.size());
+    for (quint32 i = 0; i < order.size(); ++i)
+        newIds[order[i]] = i;
+
+    std::vector<quint32> keys;
+    keys.reserve(postings.size());
+    quint64 postingCount = 0;
+    for (const auto &posting : postings) {
+        keys.push_back(posting.first);
+        postingCount += posting.second.size();
+    }
+    std::sort(keys.begin(), keys.end());
+
+    quint64 pathBytes = 0;
+    for (const File &file : files)
+        pathBytes += file.relativePath.size();
+
+    Header header{SEGMENT_MAGIC, SEGMENT_VERSION, static_cast<quint32>(files.size()), static_cast<quint32>(keys.size()), postingCount, pathBytes};
+
+    QByteArray out;
+    out.reserve(static_cast<int>(sizeof(Header) + files.size() * sizeof(FileRecord) + keys.size() * sizeof(TrigramRecord) + postingCount * sizeof(quint32) + pathBytes));
+    out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    quint32 pathOffset = 0;
+    for (quint32 old : order) {
+        const File &file = files[old];
+        const FileRecord record{pathOffset, static_cast<quint32>(file.relativePath.size()), file.lastModified, file.size, file.indexed ? FILE_INDEXED : 0, 0};
+
+        out.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        pathOffset += record.pathLength;
+    }
+
+    quint64 start = 0;
+    for (quint32 key : keys) {
+        const TrigramRecord record{key, static_cast<quint32>(postings.at(key).size()), start};
+
+        out.append(reinterpret_cast<const char *>(&record), sizeof(record));
+        start += record.count;
+    }
+
+    std::vector<quint32> list;
+    for (quint32 key : keys) {
+        const std::vector<quint32> &ids = postings.at(key);
+
+        list.resize(ids.size());
+        std::transform(ids.cbegin(), ids.cend(), list.begin(), [&](quint32 id) { return newIds[id]; });
+        std::sort(list.begin(), list.end());
+
+        out.append(reinterpret_cast<const char *>(list.data()), static_cast<int>(list.size() * sizeof(quint32)));
+    }
+
+    for (quint32 old : order)
+        out.append(files[old].relativePath);
+
+    return out;
+}
+
+TrigramSnapshot::TrigramSnapshot(const QString &rootPath, std::shared_ptr<const TrigramSegment> base, std::shared_ptr<const TrigramSegment> delta) :
+    rootPath(rootPath),
+    base(base),
+    delta(delta)
+{
+}
+
+std::shared_ptr<const TrigramFilter> TrigramSnapshot::prepare(const QByteArray &pattern, int flags) const
+{
+    const std::vector<quint32> required = requiredTrigrams(pattern, flags);
+
+    if (required.empty())
+        return std::shared_ptr<const TrigramFilter>();
+
+    auto filter = std::make_shared<TrigramFilter>();
+    filter->snapshot = shared_from_this();
+    filter->prefix = rootPath.endsWith('/') ? rootPath : rootPath + '/';
+
+    if (base)
+        filter->baseCandidates = base->candidates(required);
+    if (delta)
+        filter->deltaCandidates = delta->candidates(required);
+
+    return filter;
+}
+
+static void chopLastCharacter(QByteArray &run)
+{
+    // Drop any UTF-8 continuation bytes along with the lead byte
+    while (!run.isEmpty() && (static_cast<uchar>(run.back()) & 0xC0) == 0x80)
+        run.chop(1);
+
+    if (!run.isEmpty())
+        run.chop(1);
+}
+
+std::vector<quint32> TrigramSnapshot::requiredTrigrams(const QByteArray &pattern, int flags)
+{
+    QVector<QByteArray> runs;
+
+    if (!(flags & SCFIND_REGEXP)) {
+        runs.append(pattern);
+    }
+    else {
+        // Only pieces of literal text outside of any group are certain to be in every match. An alternative
+        // or inline option anywhere could change that, so there is nothing to go on with those.
+        if (pattern.contains('|') || pattern.contains("(?"))
+            return std::vector<quint32>();
+
+        QByteArray run;
+        int depth = 0;
+        const int length = pattern.size();
+
+        auto endRun = [&]() {
+            if (depth == 0 && run.size() >= 3)
+                runs.append(run);
+            run.clear();
+        };
+
+        for (int i = 0; i < length; ++i) {
+            const char c = pattern.at(i);
+
+            switch (c) {
+            case '\\':
+                if (i + 1 < length) {
+                    const uchar next = static_cast<uchar>(pattern.at(i + 1));
+
+                    if (next < 0x80 && std::isalnum(next)) {
+                        // Escapes taking arguments or back references would need parsing further
+                        if (std::isdigit(next) || std::strchr("xuoNpPcgk", next))
+                            return std::vector<quint32>();
+
+                        endRun();
+                    }
+                    else if (depth == 0) {
+                        run.append(static_cast<char>(next));
+                    }
+                    ++i;
+                }
+                break;
+            case '{':
+                // The quantified character may not be there at all
+                chopLastCharacter(run);
+                endRun();
+                while (i + 1 < length && pattern.at(i + 1) != '}')
+                    ++i;
+                ++i;
+                break;
+            case '*':
+            case '?':
+                chopLastCharacter(run);
+                endRun();
+                break;
+            case '+':
+                endRun();
+                break;
+            case '(':
+                endRun();
+                ++depth;
+                break;
+            case ')':
+                endRun();
+                depth = qMax(0, depth - 1);
+                break;
+            case '[':
+                endRun();
+                ++i;
+                if (i < length && pattern.at(i) == '^')
+                    ++i;
+                if (i < length && pattern.at(i) == ']')
+                    ++i;
+                while (i < length && pattern.at(i) != ']') {
+                    if (pattern.at(i) == '\\')
+                        ++i;
+                    ++i;
+                }
+                break;
+            case '.':
+            case '^':
+            case '$':
+                endRun();
+                break;
+            default:
+                if (depth == 0)
+                    run.append(c);
+                break;
+            }
+        }
+
+        endRun();
+    }
+
+    // The index folds ASCII case only, so without matching case non-ASCII text can't be relied on
+    const bool matchCase = flags & SCFIND_MATCHCASE;
+    std::vector<quint32> trigrams;
+
+    for (const QByteArray &run : qAsConst(runs)) {
+        const uchar *p = reinterpret_cast<const uchar *>(run.constData());
+
+        for (int i = 0; i + 2 < run.size(); ++i) {
+            if (!matchCase && (p[i] >= 0x80 || p[i + 1] >= 0x80 || p[i + 2] >= 0x80))
+                continue;
+
+            trigrams.push_back((foldCase(p[i]) << 16) | (foldCase(p[i + 1]) << 8) | foldCase(p[i + 2]));
+        }
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    return trigrams;
+}
+
+bool TrigramFilter::mayContain(const QString &filePath, qint64 lastModified, qint64 size) const
+{
+    if (!filePath.startsWith(prefix))
+        return true;
+
+    const QByteArray relativePath = filePath.mid(prefix.size()).toUtf8();
+
+    // Files that changed since the base was built are in the delta
+    if (snapshot->delta) {
+        const int file = snapshot->delta->find(relativePath);
+
+        if (file >= 0 && snapshot->delta->matches(file, lastModified, size))
+            return deltaCandidates[file];
+    }
+
+    if (snapshot->base) {
+        const int file = snapshot->base->find(relativePath);
+
+        if (file >= 0 && snapshot->base->matches(file, lastModified, size))
+            return baseCandidates[file];
+    }
+
+    // Anything the index doesn't know about, or that changed since, has to be searched
+    return true;
+}
+
+struct TrigramIndex::Job
+{
+    struct FileInfo
+    {
+        QByteArray relativePath;
+        qint64 lastModified;
+        qint64 size;
+    };
+
+    QString root;
+    FileFilter filter;
+    bool respectGitIgnore;
+    QString cacheBaseName;
+    std::shared_ptr<std::atomic<bool>> canceled;
+
+    std::shared_ptr<const TrigramSnapshot> snapshot;
+    QSet<QByteArray> deltaFiles;
+    QStringList directories; // empty for the whole tree
+
+    std::shared_ptr<const TrigramSnapshot> result; // null if nothing changed
+    QSet<QByteArray> resultDeltaFiles;
+
+    bool accepts(const QString &path, const QString &name, bool isDir, const std::shared_ptr<const IgnoreRules> &rules) const
+    {
+        if (!filter.acceptsDirectory(name))
+            return false;
+        if (isDir && respectGitIgnore && name == QStringLiteral(".git"))
+            return false;
+
+        return !(rules && rules->isIgnored(path, name, isDir));
+    }
+
+    QByteArray relativePathOf(const QString &path) const
+    {
+        return path.mid(root.endsWith('/') ? root.size() : root.size() + 1).toUtf8();
+    }
+
+    // Lists the files directly inside of dirPath, or everything below it when recursive
+    void listFiles(const QString &dirPath, const std::shared_ptr<const IgnoreRules> &parentRules, bool recursive, std::vector<FileInfo> &out) const
+    {
+        QVector<QPair<QString, std::shared_ptr<const IgnoreRules>>> pending{{dirPath, parentRules}};
+
+        while (!pending.isEmpty() && !*canceled) {
+            const auto dir = pending.takeLast();
+            const std::shared_ptr<const IgnoreRules> rules = respectGitIgnore ? IgnoreRules::forDirectory(dir.second, dir.first) : dir.second;
+
+            QDirIterator it(dir.first, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+            while (it.hasNext()) {
+                const QString path = it.next();
+                const QFileInfo info = it.fileInfo();
+                const bool isDir = info.isDir();
+
+                if (!accepts(path, info.fileName(), isDir, rules))
+                    continue;
+
+                if (isDir) {
+                    // Don't follow links to directories, they can easily be cycles
+                    if (recursive && !info.isSymLink())
+                        pending.append({path, rules});
+                }
+                else {
+                    out.push_back({relativePathOf(path), info.lastModified().toMSecsSinceEpoch(), info.size()});
+                }
+            }
+        }
+    }
+
+    // The ignore rules that apply inside of dirPath, or false if the directory itself is left out
+    bool rulesFor(const QString &dirPath, std::shared_ptr<const IgnoreRules> &rules) const
+    {
+        rules = respectGitIgnore ? IgnoreRules::forDirectory(std::shared_ptr<const IgnoreRules>(), root) : std::shared_ptr<const IgnoreRules>();
+
+        QString path = root;
+        for (const QString &name : dirPath.mid(root.size()).split('/', Qt::SkipEmptyParts)) {
+            path = path.endsWith('/') ? path + name : path + '/' + name;
+
+            if (!accepts(path, name, true, rules))
+                return false;
+
+            if (respectGitIgnore)
+                rules = IgnoreRules::forDirectory(rules, path);
+        }
+
+        return true;
+    }
+
+    bool isCurrent(const FileInfo &info) const
+    {
+        if (!snapshot)
+            return false;
+
+        for (const std::shared_ptr<const TrigramSegment> &segment : {snapshot->delta, snapshot->base}) {
+            if (segment) {
+                const int file = segment->find(info.relativePath);
+
+                if (file >= 0 && segment->matches(file, info.lastModified, info.size))
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    void index(TrigramSegment::Builder &builder, const FileInfo &info) const
+    {
+        if (info.size > MAX_INDEXED_FILE_SIZE) {
+            builder.addFile(info.relativePath, info.lastModified, info.size, Q_NULLPTR);
+            return;
+        }
+
+        QByteArray text;
+        bool binary;
+
+        // Files that can't be read are left out so they are searched like any other unknown file
+        if (FileSearcher::readSearchableText(QDir(root).filePath(QString::fromUtf8(info.relativePath)), text, binary))
+            builder.addFile(info.relativePath, info.lastModified, info.size, &text);
+    }
+
+    std::shared_ptr<const TrigramSegment> loadNewestBase() const
+    {
+        const QFileInfo base(cacheBaseName);
+        const QStringList names = QDir(base.absolutePath()).entryList({base.fileName() + QStringLiteral("-*.trigrams")}, QDir::Files, QDir::Name);
+
+        // The names end with the time they were written, so the last one is the newest
+        return names.isEmpty() ? std::shared_ptr<const TrigramSegment>() : TrigramSegment::map(base.absolutePath() + '/' + names.last());
+    }
+
+    std::shared_ptr<const TrigramSegment> saveBase(const QByteArray &data) const
+    {
+        const QFileInfo base(cacheBaseName);
+        const QString fileName = QStringLiteral("%1-%2.trigrams").arg(cacheBaseName).arg(QDateTime::currentMSecsSinceEpoch(), 16, 10, QChar('0'));
+
+        QDir().mkpath(base.absolutePath());
+
+        QSaveFile out(fileName);
+        if (out.open(QIODevice::WriteOnly) && out.write(data) == data.size() && out.commit()) {
+            // Older ones may still be mapped by a search, on some platforms those will be cleaned up next time
+            for (const QString &name : QDir(base.absolutePath()).entryList({base.fileName() + QStringLiteral("-*.trigrams")}, QDir::Files)) {
+                if (base.absolutePath() + '/' + name != fileName)
+                    QFile::remove(base.absolutePath() + '/' + name);
+            }
+
+            if (std::shared_ptr<const TrigramSegment> segment = TrigramSegment::map(fileName))
+                return segment;
+        }
+        else {
+            qWarning("Unable to save the trigram index to %s", qUtf8Printable(fileName));
+        }
+
+        return TrigramSegment::fromData(data);
+    }
+
+    void run(const std::function<void(const std::shared_ptr<const TrigramSnapshot> &)> &publish)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        std::shared_ptr<const TrigramSegment> base = snapshot ? snapshot->base : std::shared_ptr<const TrigramSegment>();
+
+        // Anything saved by an earlier session can be used while it is checked for changes
+        if (!base) {
+            base = loadNewestBase();
+
+            if (base) {
+                snapshot = std::make_shared<TrigramSnapshot>(root, base, std::shared_ptr<const TrigramSegment>());
+                publish(snapshot);
+            }
+        }
+
+        std::vector<FileInfo> files;
+        bool haveAllFiles = directories.isEmpty();
+
+        if (haveAllFiles) {
+            listFiles(root, std::shared_ptr<const IgnoreRules>(), true, files);
+        }
+        else {
+            for (const QString &dir : qAsConst(directories)) {
+                std::shared_ptr<const IgnoreRules> rules;
+
+                // Only up to the parent's rules, listFiles() adds the directory's own
+                if (dir == root)
+                    listFiles(root, std::shared_ptr<const IgnoreRules>(), false, files);
+                else if (rulesFor(QFileInfo(dir).path(), rules) && accepts(dir, QFileInfo(dir).fileName(), true, rules))
+                    listFiles(dir, rules, false, files);
+            }
+        }
+
+        if (*canceled)
+            return;
+
+        QSet<QByteArray> changed = haveAllFiles ? QSet<QByteArray>() : deltaFiles;
+        int staleCount = 0;
+        for (const FileInfo &info : files) {
+            if (!isCurrent(info)) {
+                changed.insert(info.relativePath);
+                ++staleCount;
+            }
+        }
+
+        if (staleCount == 0 && base)
+            return;
+
+        if (!base || changed.size() > MAX_DELTA_FILES) {
+            if (!haveAllFiles) {
+                files.clear();
+                listFiles(root, std::shared_ptr<const IgnoreRules>(), true, files);
+            }
+
+            TrigramSegment::Builder builder;
+            for (const FileInfo &info : files) {
+                if (*canceled)
+                    return;
+
+                index(builder, info);
+            }
+
+            result = std::make_shared<TrigramSnapshot>(root, saveBase(builder.data()), std::shared_ptr<const TrigramSegment>());
+            resultDeltaFiles.clear();
+
+            qInfo("Indexed %d files below %s in %lld ms", builder.fileCount(), qUtf8Printable(root), static_cast<long long>(timer.elapsed()));
+        }
+        else {
+            // The delta is small, so it is simply rebuilt with every file that changed so far
+            TrigramSegment::Builder builder;
+            resultDeltaFiles.clear();
+
+            for (const QByteArray &relativePath : qAsConst(changed)) {
+                if (*canceled)
+                    return;
+
+                const QFileInfo info(QDir(root).filePath(QString::fromUtf8(relativePath)));
+                if (info.exists()) {
+                    index(builder, {relativePath, info.lastModified().toMSecsSinceEpoch(), info.size()});
+                    resultDeltaFiles.insert(relativePath);
+                }
+            }
+
+            result = std::make_shared<TrigramSnapshot>(root, base, TrigramSegment::fromData(builder.data()));
+        }
+    }
+};
+
+TrigramIndex::TrigramIndex(QObject *parent) :
+    QObject(parent),
+    refreshTimer(new QTimer(this))
+{
+    // Builds tend to touch lots of directories at once, so wait for things to settle down
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(1000);
+    connect(refreshTimer, &QTimer::timeout, this, &TrigramIndex::startRefresh);
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    if (canceled)
+        *canceled = true;
+}
+
+void TrigramIndex::setRootPath(const QString &path, const QString &excludePatterns, bool respect)
+{
+    const QString cleanPath = path.isEmpty() ? QString() : QDir::cleanPath(path);
+
+    if (canceled)
+        *canceled = true;
+    canceled = std::make_shared<std::atomic<bool>>(false);
+
+    ++generation;
+    current.reset();
+    deltaFiles.clear();
+    pendingDirectories.clear();
+    refreshTimer->stop();
+    busy = false;
+
+    root = cleanPath;
+    filter = FileFilter(excludePatterns);
+    respectGitIgnore = respect;
+
+    emit indexUpdated();
+
+    if (root.isEmpty())
+        return;
+
+    // Different excludes give a different index, so they are part of the name too
+    const QString key = root + '\n' + excludePatterns + '\n' + (respect ? '1' : '0');
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    cacheBaseName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/workspace/") + QString::fromLatin1(hash);
+
+    startRefresh();
+}
+
+void TrigramIndex::refreshDirectory(const QString &dirPath)
+{
+    if (root.isEmpty())
+        return;
+
+    const QString cleanPath = QDir::cleanPath(dirPath);
+    const QString prefix = root.endsWith('/') ? root : root + '/';
+
+    if (cleanPath != root && !cleanPath.startsWith(prefix))
+        return;
+
+    pendingDirectories.insert(cleanPath);
+
+    if (!busy)
+        refreshTimer->start();
+}
+
+void TrigramIndex::startRefresh()
+{
+    if (busy)
+        return;
+
+    auto job = std::make_shared<Job>();
+    job->root = root;
+    job->filter = filter;
+    job->respectGitIgnore = respectGitIgnore;
+    job->cacheBaseName = cacheBaseName;
+    job->canceled = canceled;
+    job->snapshot = current;
+    job->deltaFiles = deltaFiles;
+
+    // Before there is an index at all the whole tree is looked at
+    if (current)
+        job->directories = pendingDirectories.values();
+    pendingDirectories.clear();
+
+    busy = true;
+
+    const quint64 jobGeneration = generation;
+    QPointer<TrigramIndex> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        job->run([=](const std::shared_ptr<const TrigramSnapshot> &snapshot) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self && self->generation == jobGeneration) {
+                    self->current = snapshot;
+                    emit self->indexUpdated();
+                }
+            }, Qt::QueuedConnection);
+        });
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self && self->generation == jobGeneration) {
+                self->finishJob(job);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TrigramIndex::finishJob(const std::shared_ptr<Job> &job)
+{
+    busy = false;
+
+    if (job->result) {
+        current = job->result;
+        deltaFiles = job->resultDeltaFiles;
+        emit indexUpdated();
+    }
+
+    if (!pendingDirectories.isEmpty())
+        refreshTimer->start();
+}
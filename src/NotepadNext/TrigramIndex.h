@@ -0,0 +1,181 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "FileFilter.h"
+
+class QTimer;
+
+// One immutable piece of a trigram index: which files it covers and, for each trigram of (ASCII case
+// folded) text, the files containing it. The data is laid out so it can be used straight from a
+// memory mapped file. Files are sorted by relative path so they can be found without a hash table.
+class TrigramSegment
+{
+public:
+    ~TrigramSegment();
+
+    static std::shared_ptr<const TrigramSegment> map(const QString &fileName);
+    static std::shared_ptr<const TrigramSegment> fromData(const QByteArray &data);
+
+    int fileCount() const;
+    int find(const QByteArray &relativePath) const; // -1 if it isn't in the segment
+    bool matches(int file, qint64 lastModified, qint64 size) const;
+    QByteArray relativePath(int file) const;
+
+    // Marks the files that contain every one of the trigrams, including ones that were too large to index
+    std::vector<bool> candidates(const std::vector<quint32> &trigrams) const;
+
+    class Builder
+    {
+    public:
+        Builder();
+
+        // A null text means the file is unindexed and is always a candidate
+        void addFile(const QByteArray &relativePath, qint64 lastModified, qint64 size, const QByteArray *text);
+        int fileCount() const { return static_cast<int>(files.size()); }
+
+        QByteArray data() const;
+
+    private:
+        struct File
+        {
+            QByteArray relativePath;
+            qint64 lastModified;
+            qint64 size;
+            bool indexed;
+        };
+
+        std::vector<File> files;
+        std::unordered_map<quint32, std::vector<quint32>> postings;
+        std::vector<quint64> seen; // one bit for each possible trigram
+        std::vector<quint32> fileTrigrams;
+    };
+
+private:
+    struct Header;
+    struct FileRecord;
+    struct TrigramRecord;
+
+    TrigramSegment() = default;
+    bool validate();
+
+    QFile file;
+    QByteArray ownedData;
+    const uchar *data = Q_NULLPTR;
+    qint64 length = 0;
+
+    const Header *header = Q_NULLPTR;
+    const FileRecord *files = Q_NULLPTR;
+    const TrigramRecord *trigrams = Q_NULLPTR;
+    const quint32 *postings = Q_NULLPTR;
+    const char *pathData = Q_NULLPTR;
+};
+
+class TrigramFilter;
+
+// The state of the index at one point in time. Searches can hold on to it from any thread while the
+// index moves on without them.
+class TrigramSnapshot : public std::enable_shared_from_this<TrigramSnapshot>
+{
+public:
+    TrigramSnapshot(const QString &rootPath, std::shared_ptr<const TrigramSegment> base, std::shared_ptr<const TrigramSegment> delta);
+
+    // Returns null if the pattern has nothing to narrow the files down with, e.g. a regex like "a.b"
+    std::shared_ptr<const TrigramFilter> prepare(const QByteArray &pattern, int flags) const;
+
+    // Works out which trigrams any match of the pattern must contain
+    static std::vector<quint32> requiredTrigrams(const QByteArray &pattern, int flags);
+
+    const QString rootPath;
+    const std::shared_ptr<const TrigramSegment> base;
+    const std::shared_ptr<const TrigramSegment> delta; // files changed since the base was built
+};
+
+class TrigramFilter
+{
+public:
+    // Only false when the file is known to the index, hasn't changed since and lacks a required trigram
+    bool mayContain(const QString &filePath, qint64 lastModified, qint64 size) const;
+
+private:
+    friend class TrigramSnapshot;
+
+    std::shared_ptr<const TrigramSnapshot> snapshot;
+    QString prefix;
+    std::vector<bool> baseCandidates;
+    std::vector<bool> deltaCandidates;
+};
+
+// Keeps a trigram index of the text of every file below a directory, so Find in Files only has to read
+// the files that could possibly match. The index is built on the thread pool, saved to the cache
+// directory, and brought up to date by re-indexing the files in directories reported as changed.
+class TrigramIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrigramIndex(QObject *parent = nullptr);
+    ~TrigramIndex() override;
+
+    // An empty path stops indexing altogether. The excludes are in the same form as FileFilter.
+    void setRootPath(const QString &path, const QString &excludePatterns, bool respectGitIgnore);
+    QString rootPath() const { return root; }
+
+    // Null until the first index is available
+    std::shared_ptr<const TrigramSnapshot> snapshot() const { return current; }
+
+public slots:
+    // The files directly inside of dirPath are checked and re-indexed if they changed
+    void refreshDirectory(const QString &dirPath);
+
+signals:
+    void indexUpdated();
+
+private:
+    struct Job;
+
+    void startRefresh();
+    void finishJob(const std::shared_ptr<Job> &job);
+
+    QString root;
+    FileFilter filter;
+    bool respectGitIgnore = true;
+    QString cacheBaseName;
+
+    std::shared_ptr<const TrigramSnapshot> current;
+    QSet<QByteArray> deltaFiles;
+    QSet<QString> pendingDirectories;
+    bool busy = false;
+    QTimer *refreshTimer;
+
+    quint64 generation = 0;
+    std::shared_ptr<std::atomic<bool>> canceled;
+};
@@ -0,0 +1,273 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "WordIndex.h"
+#include "ScintillaNext.h"
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
+
+using namespace Scintilla;
+
+
+// The document is counted in pieces of about this size while the application is idle
+const int CHUNK_SIZE = 1024 * 256;
+
+// How long each idle slice is allowed to run before giving control back to the event loop
+const int SLICE_BUDGET_MS = 8;
+
+// Changes bigger than this get counted in the background rather than while typing
+const int REINDEX_THRESHOLD = 1024 * 1024;
+
+static QList<WordIndex *> indexes;
+
+WordIndex::WordIndex(ScintillaNext *editor, QObject *parent) :
+    QObject(parent),
+    editor(editor),
+    timer(new QTimer(this))
+{
+    timer->setInterval(0);
+    connect(timer, &QTimer::timeout, this, &WordIndex::indexNextChunk);
+
+    connect(editor, &ScintillaEdit::notify, this, &WordIndex::notify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &WordIndex::reset);
+
+    editor->setModificationsNeeded(this, ModificationFlags::BeforeInsert | ModificationFlags::BeforeDelete | ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    reset();
+
+    indexes.append(this);
+}
+
+WordIndex::~WordIndex()
+{
+    indexes.removeOne(this);
+}
+
+const QList<WordIndex *> &WordIndex::allIndexes()
+{
+    return indexes;
+}
+
+qint64 WordIndex::memoryUsage() const
+{
+    // A map node is the key, the value and about four pointers for the tree
+    const qint64 nodeSize = sizeof(QByteArray) + sizeof(int) + 4 * sizeof(void *);
+    qint64 bytes = 0;
+
+    for (const auto &word : words) {
+        bytes += nodeSize + word.first.capacity();
+    }
+
+    return bytes;
+}
+
+QVector<WordIndex::Word> WordIndex::wordsStartingWith(const QByteArray &prefix, Sci_Position excludeStart, Sci_Position excludeEnd) const
+{
+    QVector<Word> matches;
+
+    // The excluded word is only in the index if that part of the document has been counted
+    const bool exclude = excludeStart >= 0 && excludeEnd <= indexedTo;
+    const QByteArray excluded = exclude ? editor->get_text_range(excludeStart, excludeEnd) : QByteArray();
+
+    for (auto it = words.lower_bound(prefix); it != words.end() && it->first.startsWith(prefix); ++it) {
+        const int count = (exclude && it->first == excluded) ? it->second - 1 : it->second;
+
+        if (count > 0) {
+            matches.append({it->first, count});
+        }
+    }
+
+    return matches;
+}
+
+void WordIndex::release()
+{
+    if (released) {
+        return;
+    }
+
+    timer->stop();
+
+    // Clearing the map frees its nodes, the words are never kept anywhere else
+    words.clear();
+    indexedTo = 0;
+    changeStart = -1;
+    released = true;
+
+    QPointer<WordIndex> self = this;
+    editor->runWhenShown(QStringLiteral("WordIndex"), [self]() {
+        if (self && self->released) {
+            self->reset();
+        }
+    });
+}
+
+void WordIndex::notify(const NotificationData *pscn)
+{
+    if (released || pscn->nmhdr.code != Notification::Modified) {
+        return;
+    }
+
+    const bool beforeInsert = FlagSet(pscn->modificationType, ModificationFlags::BeforeInsert);
+    const bool beforeDelete = FlagSet(pscn->modificationType, ModificationFlags::BeforeDelete);
+    const bool inserted = FlagSet(pscn->modificationType, ModificationFlags::InsertText);
+    const bool deleted = FlagSet(pscn->modificationType, ModificationFlags::DeleteText);
+
+    if (beforeInsert || beforeDelete) {
+        // The document was changed without anything being heard about it
+        if (editor->length() != expectedLength) {
+            reset();
+        }
+
+        changeStart = -1;
+
+        const Sci_Position start = wordStart(pscn->position);
+        const Sci_Position end = wordEnd(beforeDelete ? pscn->position + pscn->length : pscn->position);
+
+        // Nothing has been counted there yet so it is picked up later anyway
+        if (start >= indexedTo) {
+            return;
+        }
+
+        if (qMin(end, indexedTo) - start > REINDEX_THRESHOLD) {
+            reset();
+            return;
+        }
+
+        // Take the words that are about to change back out, they get counted again after
+        countWords(start, qMin(end, indexedTo), -1);
+        changeStart = start;
+        changeStraddled = end > indexedTo;
+    }
+    else if (inserted || deleted) {
+        expectedLength = editor->length();
+
+        if (changeStart != -1) {
+            const Sci_Position delta = inserted ? pscn->length : -pscn->length;
+            const Sci_Position end = wordEnd(inserted ? pscn->position + pscn->length : pscn->position);
+
+            if (changeStraddled) {
+                // It ran into the part that has not been counted yet, so carry on from where it started
+                indexedTo = changeStart;
+            }
+            else if (end - changeStart > REINDEX_THRESHOLD) {
+                reset();
+            }
+            else {
+                countWords(changeStart, end, 1);
+                indexedTo = qMax(indexedTo + delta, end);
+            }
+
+            changeStart = -1;
+        }
+
+        if (indexedTo < editor->length() && !timer->isActive()) {
+            timer->start();
+        }
+    }
+}
+
+void WordIndex::indexNextChunk()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    const Sci_Position length = editor->length();
+
+    while (indexedTo < length && elapsed.elapsed() < SLICE_BUDGET_MS) {
+        // Always stop on a word boundary so a word is never counted in two pieces
+        const Sci_Position end = wordEnd(qMin(length, indexedTo + CHUNK_SIZE));
+
+        countWords(indexedTo, end, 1);
+        indexedTo = end;
+    }
+
+    if (indexedTo >= length) {
+        timer->stop();
+    }
+}
+
+void WordIndex::reset()
+{
+    released = false;
+    words.clear();
+    indexedTo = 0;
+    expectedLength = editor->length();
+    changeStart = -1;
+
+    wordCharacters.fill(false);
+    for (const char c : editor->wordChars()) {
+        wordCharacters[static_cast<unsigned char>(c)] = true;
+    }
+
+    if (expectedLength > 0) {
+        timer->start();
+    }
+}
+
+void WordIndex::countWords(Sci_Position start, Sci_Position end, int delta)
+{
+    if (start >= end) {
+        return;
+    }
+
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(start, end - start));
+    const Sci_Position length = end - start;
+    Sci_Position i = 0;
+
+    while (i < length) {
+        if (!wordCharacters[static_cast<unsigned char>(text[i])]) {
+            ++i;
+            continue;
+        }
+
+        const Sci_Position begin = i;
+        while (i < length && wordCharacters[static_cast<unsigned char>(text[i])]) {
+            ++i;
+        }
+
+        if (i - begin < MINIMUM_WORD_LENGTH) {
+            continue;
+        }
+
+        const QByteArray word(text + begin, static_cast<int>(i - begin));
+
+        if (delta > 0) {
+            words[word] += delta;
+        }
+        else {
+            auto it = words.find(word);
+            if (it != words.end() && (it->second += delta) <= 0) {
+                words.erase(it);
+            }
+        }
+    }
+}
+
+Sci_Position WordIndex::wordStart(Sci_Position position) const
+{
+    return editor->wordStartPosition(position, true);
+}
+
+Sci_Position WordIndex::wordEnd(Sci_Position position) const
+{
+    return editor->wordEndPosition(position, true);
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+#include <array>
+#include <map>
+
+#include "Scintilla.h"
+
+class ScintillaNext;
+class QTimer;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// A sorted count of every word in a document so words starting with a given prefix can be looked up
+// without searching the text. The document is indexed from the start while the application is idle,
+// and after that each edit only has to re-count the words it touched.
+class WordIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    WordIndex(ScintillaNext *editor, QObject *parent = Q_NULLPTR);
+    ~WordIndex() override;
+
+    // Words shorter than this are not worth completing so they are not kept
+    static const int MINIMUM_WORD_LENGTH = 3;
+
+    struct Word
+    {
+        QByteArray text;
+        int count;
+    };
+
+    // Every index that currently exists, one for each editor with auto completion enabled
+    static const QList<WordIndex *> &allIndexes();
+
+    ScintillaNext *getEditor() const { return editor; }
+
+    // Rough, each word's text plus what the map keeps for it
+    qint64 memoryUsage() const;
+
+    // Throws the words away until the editor is shown again, when it is indexed from the start. Edits made in
+    // the meantime aren't counted.
+    void release();
+    bool isReleased() const { return released; }
+
+    // Every word that starts with prefix in sorted order. If given, one occurrence of the text in
+    // [excludeStart, excludeEnd) is not counted.
+    QVector<Word> wordsStartingWith(const QByteArray &prefix, Sci_Position excludeStart = -1, Sci_Position excludeEnd = -1) const;
+
+private slots:
+    void notify(const Scintilla::NotificationData *pscn);
+    void indexNextChunk();
+
+private:
+    void reset();
+    void countWords(Sci_Position start, Sci_Position end, int delta);
+    Sci_Position wordStart(Sci_Position position) const;
+    Sci_Position wordEnd(Sci_Position position) const;
+
+    ScintillaNext *editor;
+    QTimer *timer;
+
+    std::map<QByteArray, int> words;
+    std::array<bool, 256> wordCharacters;
+
+    // Everything before this has been counted, it always sits on a word boundary
+    Sci_Position indexedTo = 0;
+
+    // What the document length should be if no changes were missed, e.g. while the document was swapped out
+    Sci_Position expectedLength = 0;
+
+    // Remembered between the before and after notifications of a change
+    Sci_Position changeStart = -1;
+    bool changeStraddled = false;
+
+    bool released = false;
+};
+
+#endif // WORDINDEX_H
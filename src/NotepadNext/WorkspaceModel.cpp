@@ -0,0 +1,950 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "WorkspaceModel.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileIconProvider>
+#include <QFileSystemWatcher>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+#include <algorithm>
+
+
+// Operating systems only allow so many watches (e.g. inotify defaults to 8192 for the whole user),
+// so only this many of the expanded directories get watched. The rest are re-read when expanded again.
+static const int MAX_WATCHED_DIRECTORIES = 256;
+
+// Caps the memory used for the path index, roughly 100 bytes a file
+static const int MAX_INDEXED_FILES = 500000;
+
+
+static bool isWordBoundary(QChar previous, QChar c)
+{
+    switch (previous.unicode()) {
+    case '/':
+    case '\\':
+    case '_':
+    case '-':
+    case '.':
+    case ' ':
+        return true;
+    default:
+        return previous.isLower() && c.isUpper();
+    }
+}
+
+// Set for files that were deleted, these are skipped until the index is rebuilt
+static const quint64 REMOVED_MASK = Q_UINT64_C(1) << 63;
+
+static const quint32 PATH_INDEX_MAGIC = 0x4e4e5749;
+static const qint32 PATH_INDEX_VERSION = 1;
+
+QString WorkspacePathIndex::path(int file) const
+{
+    const int start = offsets.at(file);
+
+    return paths.mid(start, pathEnd(file) - start);
+}
+
+// One bit for each letter, digit and common punctuation, plus one for anything else outside of ASCII,
+// all after case folding. A path can only match a query if it has every bit of the query's mask, which
+// rules out most of the paths without looking at them character by character.
+quint64 WorkspacePathIndex::characterMask(const QChar *begin, const QChar *end)
+{
+    quint64 mask = 0;
+
+    for (const QChar *p = begin; p < end; ++p) {
+        char16_t c = p->unicode();
+
+        if (c >= 0x80)
+            c = p->toCaseFolded().unicode();
+
+        if (c >= 'a' && c <= 'z')
+            mask |= Q_UINT64_C(1) << (c - 'a');
+        else if (c >= 'A' && c <= 'Z')
+            mask |= Q_UINT64_C(1) << (c - 'A');
+        else if (c >= '0' && c <= '9')
+            mask |= Q_UINT64_C(1) << (26 + c - '0');
+        else if (c == '.')
+            mask |= Q_UINT64_C(1) << 36;
+        else if (c == '_')
+            mask |= Q_UINT64_C(1) << 37;
+        else if (c == '-')
+            mask |= Q_UINT64_C(1) << 38;
+        else if (c >= 0x80)
+            mask |= Q_UINT64_C(1) << 39;
+    }
+
+    return mask;
+}
+
+// Returns -1 if foldedQuery is not a subsequence of the path. Matches that are consecutive, start a word,
+// or fall entirely inside of the file name score higher, and shorter paths are preferred.
+int WorkspacePathIndex::fuzzyScore(int file, const QString &foldedQuery) const
+{
+    const int start = offsets.at(file);
+    const int end = pathEnd(file);
+    const QChar *p = paths.constData();
+
+    int nameStart = start;
+    for (int i = end - 1; i >= start; --i) {
+        if (p[i] == '/') {
+            nameStart = i + 1;
+            break;
+        }
+    }
+
+    auto matchFrom = [&](int from, int &score) {
+        int q = 0;
+        int last = -2;
+
+        score = 0;
+        for (int i = from; i < end && q < foldedQuery.size(); ++i) {
+            if (p[i].toCaseFolded() != foldedQuery.at(q))
+                continue;
+
+            score += 1;
+            if (i == last + 1)
+                score += 5;
+            if (i == from || isWordBoundary(p[i - 1], p[i]))
+                score += 8;
+
+            last = i;
+            ++q;
+        }
+
+        return q == foldedQuery.size();
+    };
+
+    const int lengthPenalty = (end - start) / 16;
+    int score;
+
+    if (matchFrom(nameStart, score))
+        return qMax(0, score + 20 - lengthPenalty);
+
+    if (nameStart != start && matchFrom(start, score))
+        return qMax(0, score - lengthPenalty);
+
+    return -1;
+}
+
+QVector<WorkspacePathIndex::Match> WorkspacePathIndex::filter(const QString &query, int maxResults)
+{
+    const QString foldedQuery = query.toCaseFolded();
+    QVector<Match> best;
+
+    if (foldedQuery.isEmpty() || maxResults <= 0) {
+        previousQuery.clear();
+        previousMatches.clear();
+        return best;
+    }
+
+    const quint64 queryMask = characterMask(foldedQuery.constData(), foldedQuery.constData() + foldedQuery.size());
+
+    auto better = [this](const Match &left, const Match &right) {
+        if (left.score != right.score)
+            return left.score > right.score;
+
+        const int leftLength = pathEnd(left.file) - offsets.at(left.file);
+        const int rightLength = pathEnd(right.file) - offsets.at(right.file);
+        if (leftLength != rightLength)
+            return leftLength < rightLength;
+
+        return left.file < right.file;
+    };
+
+    // Only the best maxResults are kept, in a heap with the worst of them on top
+    QVector<int> matched;
+    best.reserve(maxResults);
+
+    auto consider = [&](int file) {
+        if ((queryMask & ~masks.at(file)) != 0 || (masks.at(file) & REMOVED_MASK))
+            return;
+
+        const int score = fuzzyScore(file, foldedQuery);
+        if (score < 0)
+            return;
+
+        const Match match{file, score};
+        matched.append(file);
+
+        if (best.size() < maxResults) {
+            best.append(match);
+            std::push_heap(best.begin(), best.end(), better);
+        }
+        else if (better(match, best.first())) {
+            std::pop_heap(best.begin(), best.end(), better);
+            best.last() = match;
+            std::push_heap(best.begin(), best.end(), better);
+        }
+    };
+
+    // Anything matching the longer query had to match the shorter one too
+    if (!previousQuery.isEmpty() && foldedQuery.startsWith(previousQuery)) {
+        for (int file : qAsConst(previousMatches))
+            consider(file);
+    }
+    else {
+        for (int file = 0; file < offsets.size(); ++file)
+            consider(file);
+    }
+
+    previousQuery = foldedQuery;
+    previousMatches = matched;
+
+    std::sort_heap(best.begin(), best.end(), better);
+
+    return best;
+}
+
+void WorkspacePathIndex::append(const QString &relativePath)
+{
+    offsets.append(paths.size());
+    masks.append(characterMask(relativePath.constData(), relativePath.constData() + relativePath.size()));
+    paths += relativePath;
+    paths += '\n';
+}
+
+// The previous matches may no longer be right
+void WorkspacePathIndex::changed()
+{
+    previousQuery.clear();
+    previousMatches.clear();
+}
+
+void WorkspacePathIndex::addFile(const QString &relativePath)
+{
+    const QString needle = relativePath + '\n';
+
+    for (int pos = paths.indexOf(needle); pos >= 0; pos = paths.indexOf(needle, pos + 1)) {
+        if (pos == 0 || paths.at(pos - 1) == '\n') {
+            const int file = static_cast<int>(std::upper_bound(offsets.cbegin(), offsets.cend(), pos) - offsets.cbegin()) - 1;
+
+            // It was deleted and has come back, e.g. saved by replacing the old file
+            masks[file] = characterMask(paths.constData() + pos, paths.constData() + pos + relativePath.size());
+            changed();
+            return;
+        }
+    }
+
+    if (offsets.size() >= MAX_INDEXED_FILES) {
+        truncated = true;
+        return;
+    }
+
+    append(relativePath);
+    changed();
+}
+
+void WorkspacePathIndex::removeFile(const QString &relativePath)
+{
+    const QString needle = relativePath + '\n';
+
+    for (int pos = paths.indexOf(needle); pos >= 0; pos = paths.indexOf(needle, pos + 1)) {
+        if (pos == 0 || paths.at(pos - 1) == '\n') {
+            const int file = static_cast<int>(std::upper_bound(offsets.cbegin(), offsets.cend(), pos) - offsets.cbegin()) - 1;
+
+            masks[file] |= REMOVED_MASK;
+            changed();
+            return;
+        }
+    }
+}
+
+void WorkspacePathIndex::removeDirectory(const QString &relativePath)
+{
+    const QString needle = relativePath + '/';
+
+    for (int pos = paths.indexOf(needle); pos >= 0; pos = paths.indexOf(needle, pos + 1)) {
+        if (pos == 0 || paths.at(pos - 1) == '\n') {
+            const int file = static_cast<int>(std::upper_bound(offsets.cbegin(), offsets.cend(), pos) - offsets.cbegin()) - 1;
+
+            masks[file] |= REMOVED_MASK;
+        }
+    }
+
+    changed();
+}
+
+bool WorkspacePathIndex::save(const QString &fileName, const QString &rootPath) const
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    // Deleted files are left out rather than saved as removed
+    QString livePaths;
+    QVector<int> liveOffsets;
+    livePaths.reserve(paths.size());
+    liveOffsets.reserve(offsets.size());
+    for (int i = 0; i < offsets.size(); ++i) {
+        if (!(masks.at(i) & REMOVED_MASK)) {
+            liveOffsets.append(livePaths.size());
+            livePaths.append(paths.constData() + offsets.at(i), pathEnd(i) - offsets.at(i) + 1);
+        }
+    }
+
+    QDataStream stream(&file);
+    stream << PATH_INDEX_MAGIC << PATH_INDEX_VERSION << rootPath << truncated << livePaths << liveOffsets;
+
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+std::shared_ptr<WorkspacePathIndex> WorkspacePathIndex::load(const QString &fileName, const QString &rootPath)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return std::shared_ptr<WorkspacePathIndex>();
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    QString savedRootPath;
+    auto index = std::make_shared<WorkspacePathIndex>();
+
+    stream >> magic >> version;
+    if (magic != PATH_INDEX_MAGIC || version != PATH_INDEX_VERSION)
+        return std::shared_ptr<WorkspacePathIndex>();
+
+    stream >> savedRootPath >> index->truncated >> index->paths >> index->offsets;
+    if (stream.status() != QDataStream::Ok || savedRootPath != rootPath)
+        return std::shared_ptr<WorkspacePathIndex>();
+
+    // Don't trust a damaged file to be in order
+    for (int i = 0; i < index->offsets.size(); ++i) {
+        const int start = index->offsets.at(i);
+        const int next = i + 1 < index->offsets.size() ? index->offsets.at(i + 1) : index->paths.size();
+
+        if (start < 0 || next <= start || next > index->paths.size() || index->paths.at(next - 1) != '\n')
+            return std::shared_ptr<WorkspacePathIndex>();
+    }
+
+    index->masks.reserve(index->offsets.size());
+    for (int i = 0; i < index->offsets.size(); ++i)
+        index->masks.append(characterMask(index->paths.constData() + index->offsets.at(i), index->paths.constData() + index->pathEnd(i)));
+
+    return index;
+}
+
+WorkspaceModel::WorkspaceModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    options{FileFilter(), true},
+    watcher(new QFileSystemWatcher(this))
+{
+    QFileIconProvider iconProvider;
+    folderIcon = iconProvider.icon(QFileIconProvider::Folder);
+    fileIcon = iconProvider.icon(QFileIconProvider::File);
+
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, [=](const QString &path) {
+        Node *node = nodeFromPath(path);
+
+        emit directoryChanged(path);
+
+        if (node && node->populated) {
+            loadDirectory(node);
+        }
+        else if (!node) {
+            watchedPaths.remove(path);
+            watcher->removePath(path);
+        }
+    });
+}
+
+WorkspaceModel::~WorkspaceModel()
+{
+    if (fileIndexCanceled)
+        *fileIndexCanceled = true;
+}
+
+void WorkspaceModel::setRootPath(const QString &path)
+{
+    const QString cleanPath = path.isEmpty() ? QString() : QDir::cleanPath(path);
+
+    beginResetModel();
+    root.reset();
+    if (!cleanPath.isEmpty()) {
+        root = std::make_unique<Node>();
+        root->name = cleanPath;
+        root->isDir = true;
+    }
+    reset();
+    endResetModel();
+}
+
+void WorkspaceModel::setExcludePatterns(const QString &patterns)
+{
+    excludePatterns = patterns;
+    options.filter = FileFilter(patterns);
+
+    beginResetModel();
+    if (root) {
+        root->children.clear();
+        root->populated = false;
+    }
+    reset();
+    endResetModel();
+}
+
+void WorkspaceModel::setRespectGitIgnore(bool respect)
+{
+    if (options.respectGitIgnore == respect)
+        return;
+
+    options.respectGitIgnore = respect;
+
+    beginResetModel();
+    if (root) {
+        root->children.clear();
+        root->populated = false;
+    }
+    reset();
+    endResetModel();
+}
+
+// Forgets everything that was read for the old root or options, only called between begin/endResetModel()
+void WorkspaceModel::reset()
+{
+    ++generation;
+
+    if (fileIndexCanceled)
+        *fileIndexCanceled = true;
+    fileIndexCanceled.reset();
+    fileIndex.reset();
+
+    if (!watchedPaths.isEmpty()) {
+        watcher->removePaths(watchedPaths.values());
+        watchedPaths.clear();
+    }
+
+    if (root) {
+        root->loading = false;
+        root->reloadPending = false;
+        root->ignoreRules.reset();
+
+        if (watcher->addPath(root->name))
+            watchedPaths.insert(root->name);
+
+        // Nothing is posted back until the event loop runs, so it is fine for this to happen during the reset
+        loadDirectory(root.get());
+    }
+}
+
+QString WorkspaceModel::filePath(const QModelIndex &index) const
+{
+    const Node *node = nodeFromIndex(index);
+    return node ? pathOf(node) : QString();
+}
+
+bool WorkspaceModel::isDir(const QModelIndex &index) const
+{
+    const Node *node = nodeFromIndex(index);
+    return node && node->isDir;
+}
+
+void WorkspaceModel::setWatched(const QModelIndex &index, bool watched)
+{
+    Node *node = nodeFromIndex(index);
+
+    if (!node || !node->isDir || node == root.get())
+        return;
+
+    const QString path = pathOf(node);
+
+    if (watched) {
+        // It may have changed while nobody was watching it
+        if (node->stale && node->populated)
+            loadDirectory(node);
+
+        if (watchedPaths.contains(path))
+            return;
+
+        if (watchedPaths.size() >= MAX_WATCHED_DIRECTORIES) {
+            node->stale = true;
+            return;
+        }
+
+        if (watcher->addPath(path))
+            watchedPaths.insert(path);
+        else
+            node->stale = true;
+    }
+    else {
+        if (watchedPaths.remove(path))
+            watcher->removePath(path);
+
+        node->stale = true;
+    }
+}
+
+WorkspacePathIndex *WorkspaceModel::pathIndex()
+{
+    if (fileIndex || fileIndexCanceled || !root)
+        return fileIndex.get();
+
+    const QString path = root->name;
+    const QString cacheFile = pathIndexCacheFile(path, excludePatterns, options.respectGitIgnore);
+    const Options indexOptions = options;
+    const quint64 requestGeneration = generation;
+    auto canceled = std::make_shared<std::atomic<bool>>(false);
+    QPointer<WorkspaceModel> self = this;
+
+    fileIndexCanceled = canceled;
+
+    QThreadPool::globalInstance()->start([=]() {
+        auto deliver = [=](const std::shared_ptr<WorkspacePathIndex> &index) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self && self->generation == requestGeneration) {
+                    self->fileIndex = index;
+                    emit self->pathIndexReady();
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        // The copy from the last session can be used straight away while the tree is walked again
+        std::shared_ptr<WorkspacePathIndex> cached = WorkspacePathIndex::load(cacheFile, path);
+        if (cached && !*canceled)
+            deliver(cached);
+
+        std::shared_ptr<WorkspacePathIndex> index = buildPathIndex(path, QString(), std::shared_ptr<const IgnoreRules>(), indexOptions, *canceled);
+        if (*canceled)
+            return;
+
+        if (!index->save(cacheFile, path))
+            qWarning("Unable to save the workspace index to %s", qUtf8Printable(cacheFile));
+
+        deliver(index);
+    });
+
+    return Q_NULLPTR;
+}
+
+// Files found in a directory that was created after the index was built
+void WorkspaceModel::indexNewDirectory(const QString &relativePath, const std::shared_ptr<const IgnoreRules> &ignoreRules)
+{
+    const QString path = root->name;
+    const Options indexOptions = options;
+    const quint64 requestGeneration = generation;
+    const std::shared_ptr<std::atomic<bool>> canceled = fileIndexCanceled;
+    QPointer<WorkspaceModel> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        std::shared_ptr<WorkspacePathIndex> index = buildPathIndex(path, relativePath, ignoreRules, indexOptions, *canceled);
+        if (*canceled)
+            return;
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (self && self->generation == requestGeneration && self->fileIndex) {
+                for (int i = 0; i < index->count(); ++i)
+                    self->fileIndex->addFile(index->path(i));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+QModelIndex WorkspaceModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node *parentNode = nodeFromIndex(parent);
+
+    if (!parentNode || row < 0 || column != 0 || row >= static_cast<int>(parentNode->children.size()))
+        return QModelIndex();
+
+    return createIndex(row, column, parentNode->children[row].get());
+}
+
+QModelIndex WorkspaceModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+
+    return indexFromNode(static_cast<Node *>(child.internalPointer())->parent);
+}
+
+int WorkspaceModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+
+    const Node *node = nodeFromIndex(parent);
+    return node ? static_cast<int>(node->children.size()) : 0;
+}
+
+int WorkspaceModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+
+    return 1;
+}
+
+QVariant WorkspaceModel::data(const QModelIndex &index, int role) const
+{
+    const Node *node = nodeFromIndex(index);
+
+    if (!index.isValid() || !node)
+        return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return node->name;
+    case Qt::ToolTipRole:
+        return QDir::toNativeSeparators(pathOf(node));
+    case Qt::DecorationRole:
+        return node->isDir ? folderIcon : fileIcon;
+    default:
+        return QVariant();
+    }
+}
+
+bool WorkspaceModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node *node = nodeFromIndex(parent);
+
+    // Unread directories claim to have children so the view shows them as expandable
+    return node && node->isDir && (!node->populated || !node->children.empty());
+}
+
+bool WorkspaceModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node *node = nodeFromIndex(parent);
+
+    return node && node->isDir && !node->populated && !node->loading;
+}
+
+void WorkspaceModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = nodeFromIndex(parent);
+
+    if (node && node->isDir)
+        loadDirectory(node);
+}
+
+bool WorkspaceModel::entryLessThan(const QString &leftName, bool leftIsDir, const QString &rightName, bool rightIsDir)
+{
+    // Directories first, then by name ignoring case, and exact case only to break ties
+    if (leftIsDir != rightIsDir)
+        return leftIsDir;
+
+    const int result = leftName.compare(rightName, Qt::CaseInsensitive);
+    if (result != 0)
+        return result < 0;
+
+    return leftName < rightName;
+}
+
+QVector<WorkspaceModel::Entry> WorkspaceModel::listDirectory(const QString &dirPath, const Options &options, const std::shared_ptr<const IgnoreRules> &parentRules, std::shared_ptr<const IgnoreRules> &rules)
+{
+    rules = options.respectGitIgnore ? IgnoreRules::forDirectory(parentRules, dirPath) : parentRules;
+
+    QVector<Entry> entries;
+
+    QDirIterator it(dirPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString name = info.fileName();
+        const bool isDir = info.isDir();
+
+        // Only the excludes matter here, so this works the same for files and directories
+        if (!options.filter.acceptsDirectory(name))
+            continue;
+
+        if (isDir && options.respectGitIgnore && name == QStringLiteral(".git"))
+            continue;
+
+        if (rules && rules->isIgnored(path, name, isDir))
+            continue;
+
+        entries.append({name, isDir, info.isSymLink()});
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right) {
+        return entryLessThan(left.name, left.isDir, right.name, right.isDir);
+    });
+
+    return entries;
+}
+
+std::shared_ptr<WorkspacePathIndex> WorkspaceModel::buildPathIndex(const QString &rootPath, const QString &relativePath, const std::shared_ptr<const IgnoreRules> &ignoreRules, const Options &options, const std::atomic<bool> &canceled)
+{
+    struct PendingDirectory
+    {
+        QString relativePath;
+        std::shared_ptr<const IgnoreRules> ignoreRules;
+    };
+
+    auto index = std::make_shared<WorkspacePathIndex>();
+    QVector<PendingDirectory> pending{{relativePath, ignoreRules}};
+
+    while (!pending.isEmpty() && !canceled) {
+        const PendingDirectory dir = pending.takeLast();
+        const QString dirPath = dir.relativePath.isEmpty() ? rootPath : rootPath + '/' + dir.relativePath;
+        std::shared_ptr<const IgnoreRules> rules;
+
+        for (const Entry &entry : listDirectory(dirPath, options, dir.ignoreRules, rules)) {
+            const QString entryPath = dir.relativePath.isEmpty() ? entry.name : dir.relativePath + '/' + entry.name;
+
+            if (entry.isDir) {
+                // Don't follow links to directories, they can easily be cycles
+                if (!entry.isLink)
+                    pending.append({entryPath, rules});
+            }
+            else if (index->offsets.size() >= MAX_INDEXED_FILES) {
+                index->truncated = true;
+                pending.clear();
+                break;
+            }
+            else {
+                index->append(entryPath);
+            }
+        }
+    }
+
+    index->paths.squeeze();
+    index->offsets.squeeze();
+    index->masks.squeeze();
+
+    return index;
+}
+
+QString WorkspaceModel::pathIndexCacheFile(const QString &rootPath, const QString &excludePatterns, bool respectGitIgnore)
+{
+    // Different excludes give a different index, so they are part of the name too
+    const QString key = rootPath + '\n' + excludePatterns + '\n' + (respectGitIgnore ? '1' : '0');
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/workspace/") + QString::fromLatin1(hash) + QStringLiteral(".index");
+}
+
+WorkspaceModel::Node *WorkspaceModel::nodeFromIndex(const QModelIndex &index) const
+{
+    return index.isValid() ? static_cast<Node *>(index.internalPointer()) : root.get();
+}
+
+QModelIndex WorkspaceModel::indexFromNode(Node *node) const
+{
+    if (!node || node == root.get())
+        return QModelIndex();
+
+    return createIndex(rowOf(node), 0, node);
+}
+
+int WorkspaceModel::rowOf(const Node *node) const
+{
+    // Siblings are always kept sorted, so this doesn't need to scan huge directories
+    const auto &siblings = node->parent->children;
+    const auto it = std::lower_bound(siblings.cbegin(), siblings.cend(), node, [](const std::unique_ptr<Node> &left, const Node *right) {
+        return entryLessThan(left->name, left->isDir, right->name, right->isDir);
+    });
+
+    return static_cast<int>(it - siblings.cbegin());
+}
+
+QString WorkspaceModel::relativePathOf(const Node *node) const
+{
+    QStringList names;
+
+    for (; node->parent; node = node->parent)
+        names.prepend(node->name);
+
+    return names.join('/');
+}
+
+QString WorkspaceModel::pathOf(const Node *node) const
+{
+    if (!node->parent)
+        return node->name;
+
+    return root->name + (root->name.endsWith('/') ? "" : "/") + relativePathOf(node);
+}
+
+WorkspaceModel::Node *WorkspaceModel::nodeFromPath(const QString &path) const
+{
+    if (!root)
+        return Q_NULLPTR;
+
+    const QString cleanPath = QDir::cleanPath(path);
+    if (cleanPath == root->name)
+        return root.get();
+
+    const QString prefix = root->name.endsWith('/') ? root->name : root->name + '/';
+    if (!cleanPath.startsWith(prefix))
+        return Q_NULLPTR;
+
+    Node *node = root.get();
+    for (const QString &name : cleanPath.mid(prefix.size()).split('/', Qt::SkipEmptyParts)) {
+        const auto &children = node->children;
+        const auto it = std::lower_bound(children.cbegin(), children.cend(), name, [](const std::unique_ptr<Node> &left, const QString &right) {
+            return entryLessThan(left->name, left->isDir, right, true);
+        });
+
+        if (it == children.cend() || !(*it)->isDir || (*it)->name != name)
+            return Q_NULLPTR;
+
+        node = it->get();
+    }
+
+    return node;
+}
+
+void WorkspaceModel::loadDirectory(Node *node)
+{
+    if (node->loading) {
+        node->reloadPending = true;
+        return;
+    }
+
+    node->loading = true;
+
+    const QString path = pathOf(node);
+    const std::shared_ptr<const IgnoreRules> parentRules = node->parent ? node->parent->ignoreRules : std::shared_ptr<const IgnoreRules>();
+    const Options loadOptions = options;
+    const quint64 loadGeneration = generation;
+    QPointer<WorkspaceModel> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        std::shared_ptr<const IgnoreRules> rules;
+        const QVector<Entry> entries = listDirectory(path, loadOptions, parentRules, rules);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self || self->generation != loadGeneration)
+                return;
+
+            // The node may have gone away in the meantime, so look it up again
+            Node *node = self->nodeFromPath(path);
+            if (!node || !node->isDir)
+                return;
+
+            node->loading = false;
+            node->ignoreRules = rules;
+            self->mergeEntries(node, entries);
+            node->populated = true;
+            node->stale = false;
+
+            emit self->directoryLoaded(path);
+
+            if (node->reloadPending) {
+                node->reloadPending = false;
+                self->loadDirectory(node);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Both lists are sorted the same way, so a single pass finds runs of rows to remove or insert and
+// anything already there, including whole subtrees that were expanded, is left alone
+void WorkspaceModel::mergeEntries(Node *node, const QVector<Entry> &entries)
+{
+    const QModelIndex parentIndex = indexFromNode(node);
+    auto &children = node->children;
+
+    // The first time a directory is read everything will be new to the tree but not to the path index,
+    // after that any difference really was made on disk
+    const bool updateIndex = node->populated && fileIndex;
+    const QString relativePath = updateIndex ? relativePathOf(node) : QString();
+    auto entryPath = [&](const QString &name) { return relativePath.isEmpty() ? name : relativePath + '/' + name; };
+    size_t i = 0;
+    int j = 0;
+
+    auto childBeforeEntry = [&](size_t child, int entry) {
+        return entryLessThan(children[child]->name, children[child]->isDir, entries.at(entry).name, entries.at(entry).isDir);
+    };
+    auto entryBeforeChild = [&](int entry, size_t child) {
+        return entryLessThan(entries.at(entry).name, entries.at(entry).isDir, children[child]->name, children[child]->isDir);
+    };
+
+    while (i < children.size() || j < entries.size()) {
+        size_t removeEnd = i;
+        while (removeEnd < children.size() && (j >= entries.size() || childBeforeEntry(removeEnd, j)))
+            ++removeEnd;
+
+        if (removeEnd > i) {
+            beginRemoveRows(parentIndex, static_cast<int>(i), static_cast<int>(removeEnd) - 1);
+            for (size_t k = i; k < removeEnd; ++k) {
+                unwatch(children[k].get());
+
+                if (updateIndex) {
+                    if (children[k]->isDir)
+                        fileIndex->removeDirectory(entryPath(children[k]->name));
+                    else
+                        fileIndex->removeFile(entryPath(children[k]->name));
+                }
+            }
+            children.erase(children.begin() + i, children.begin() + removeEnd);
+            endRemoveRows();
+            continue;
+        }
+
+        int insertEnd = j;
+        while (insertEnd < entries.size() && (i >= children.size() || entryBeforeChild(insertEnd, i)))
+            ++insertEnd;
+
+        if (insertEnd > j) {
+            std::vector<std::unique_ptr<Node>> nodes;
+            nodes.reserve(insertEnd - j);
+            for (int k = j; k < insertEnd; ++k) {
+                auto child = std::make_unique<Node>();
+                child->name = entries.at(k).name;
+                child->isDir = entries.at(k).isDir;
+                child->parent = node;
+                nodes.push_back(std::move(child));
+
+                if (updateIndex) {
+                    if (!entries.at(k).isDir)
+                        fileIndex->addFile(entryPath(entries.at(k).name));
+                    else if (!entries.at(k).isLink)
+                        indexNewDirectory(entryPath(entries.at(k).name), node->ignoreRules);
+                }
+            }
+
+            beginInsertRows(parentIndex, static_cast<int>(i), static_cast<int>(i) + (insertEnd - j) - 1);
+            children.insert(children.begin() + i, std::make_move_iterator(nodes.begin()), std::make_move_iterator(nodes.end()));
+            endInsertRows();
+
+            i += insertEnd - j;
+            j = insertEnd;
+            continue;
+        }
+
+        // Same entry in both
+        ++i;
+        ++j;
+    }
+}
+
+void WorkspaceModel::unwatch(Node *node)
+{
+    if (!node->isDir || watchedPaths.isEmpty())
+        return;
+
+    const QString path = pathOf(node);
+    if (watchedPaths.remove(path))
+        watcher->removePath(path);
+
+    for (const auto &child : node->children)
+        unwatch(child.get());
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "FileFilter.h"
+
+class QFileSystemWatcher;
+
+
+// A compact list of every file below a workspace root, kept as one string of '\n' separated relative
+// paths plus the offset of each one. It is built once per root, cached on disk between sessions, kept
+// up to date from the directory watches of the model and can be fuzzy filtered by file name.
+class WorkspacePathIndex
+{
+public:
+    struct Match
+    {
+        int file;
+        int score;
+    };
+
+    int count() const { return offsets.size(); }
+    bool isTruncated() const { return truncated; }
+    QString path(int file) const;
+
+    // Returns the best matches for query, best first. Queries that extend the previous one only look
+    // at the files that matched it, so typing a query one character at a time stays cheap.
+    QVector<Match> filter(const QString &query, int maxResults);
+
+    void addFile(const QString &relativePath);
+    void removeFile(const QString &relativePath);
+    void removeDirectory(const QString &relativePath);
+
+    bool save(const QString &fileName, const QString &rootPath) const;
+    static std::shared_ptr<WorkspacePathIndex> load(const QString &fileName, const QString &rootPath);
+
+private:
+    friend class WorkspaceModel;
+
+    static quint64 characterMask(const QChar *begin, const QChar *end);
+
+    int pathEnd(int file) const { return (file + 1 < offsets.size() ? offsets.at(file + 1) : paths.size()) - 1; }
+    int fuzzyScore(int file, const QString &foldedQuery) const;
+    void append(const QString &relativePath);
+    void changed();
+
+    QString paths;
+    QVector<int> offsets;
+    QVector<quint64> masks; // which characters each path contains, see characterMask()
+    bool truncated = false;
+
+    QString previousQuery;
+    QVector<int> previousMatches;
+};
+
+// A lazily populated tree of the files below a workspace root. Unlike QFileSystemModel, directories are
+// read on the thread pool only when a view asks for them, names matching the exclude patterns or the
+// .gitignore files are left out, and only a limited number of directories are watched for changes.
+class WorkspaceModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit WorkspaceModel(QObject *parent = nullptr);
+    ~WorkspaceModel() override;
+
+    void setRootPath(const QString &path);
+    QString rootPath() const { return root ? root->name : QString(); }
+
+    // Patterns in the same form as FileFilter, only the excludes are used, e.g. "!node_modules !build"
+    void setExcludePatterns(const QString &patterns);
+    void setRespectGitIgnore(bool respect);
+
+    QString filePath(const QModelIndex &index) const;
+    bool isDir(const QModelIndex &index) const;
+
+    // Views call this as directories are expanded and collapsed, only expanded ones need watching
+    void setWatched(const QModelIndex &index, bool watched);
+
+    // The index is built on the thread pool the first time it is asked for, so this is null until
+    // pathIndexReady() is emitted
+    WorkspacePathIndex *pathIndex();
+
+    // Where the path index is kept between sessions
+    static QString pathIndexCacheFile(const QString &rootPath, const QString &excludePatterns, bool respectGitIgnore);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+signals:
+    void directoryLoaded(const QString &path);
+    void directoryChanged(const QString &path);
+    void pathIndexReady();
+
+private:
+    struct Entry
+    {
+        QString name;
+        bool isDir;
+        bool isLink;
+    };
+
+    struct Node
+    {
+        QString name; // the full path for the root
+        bool isDir = false;
+        bool populated = false;
+        bool loading = false;
+        bool reloadPending = false;
+        bool stale = false;
+        Node *parent = Q_NULLPTR;
+        std::vector<std::unique_ptr<Node>> children;
+        std::shared_ptr<const IgnoreRules> ignoreRules; // the rules for the entries inside of it
+    };
+
+    struct Options
+    {
+        FileFilter filter;
+        bool respectGitIgnore;
+    };
+
+    static bool entryLessThan(const QString &leftName, bool leftIsDir, const QString &rightName, bool rightIsDir);
+    static QVector<Entry> listDirectory(const QString &dirPath, const Options &options, const std::shared_ptr<const IgnoreRules> &parentRules, std::shared_ptr<const IgnoreRules> &rules);
+    static std::shared_ptr<WorkspacePathIndex> buildPathIndex(const QString &rootPath, const QString &relativePath, const std::shared_ptr<const IgnoreRules> &ignoreRules, const Options &options, const std::atomic<bool> &canceled);
+
+    Node *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexFromNode(Node *node) const;
+    int rowOf(const Node *node) const;
+    QString pathOf(const Node *node) const;
+    Node *nodeFromPath(const QString &path) const;
+
+    void reset();
+    void loadDirectory(Node *node);
+    void mergeEntries(Node *node, const QVector<Entry> &entries);
+    void indexNewDirectory(const QString &relativePath, const std::shared_ptr<const IgnoreRules> &ignoreRules);
+    QString relativePathOf(const Node *node) const;
+    void unwatch(Node *node);
+
+    std::unique_ptr<Node> root;
+    Options options;
+    QString excludePatterns;
+    quint64 generation = 0;
+
+    QFileSystemWatcher *watcher;
+    QSet<QString> watchedPaths;
+
+    std::shared_ptr<WorkspacePathIndex> fileIndex;
+    std::shared_ptr<std::atomic<bool>> fileIndexCanceled;
+
+    QIcon folderIcon;
+    QIcon fileIcon;
+};
@@ -18,17 +18,54 @@
 
 
 #include "AutoCompletion.h"
+#include "WordIndex.h"
 
-#include <QSet>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <algorithm>
 
 
 using namespace Scintilla;
 
+// Gathering candidates stops once this much time has gone by, whatever has been found so far is shown
+const int LATENCY_BUDGET_MS = 5;
+
+// More than this is never going to be scrolled through, and keeps the list Scintilla is given short
+const int MAX_CANDIDATES = 100;
+
+// Words in the document being typed in are more likely to be wanted than those in other documents
+const int CURRENT_DOCUMENT_WEIGHT = 4;
+
+// A keyword of the language counts as if it was used this many times
+const int KEYWORD_WEIGHT = 2;
+
+// How many of the most recently picked completions are remembered
+const int MAX_RECENT_COMPLETIONS = 500;
+
+// Completions that were picked, shared by all editors, with larger numbers being more recent
+static QHash<QByteArray, quint64> recentCompletions;
+static quint64 completionCounter = 0;
+
 AutoCompletion::AutoCompletion(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
-    editor->autoCSetOrder(SC_ORDER_PERFORMSORT);
+    setNotifications({Notification::CharAdded, Notification::AutoCCompleted});
+
+    // The candidates are given to Scintilla already ranked
+    editor->autoCSetOrder(SC_ORDER_CUSTOM);
     editor->autoCSetMaxHeight(10);
+
+    // The index costs memory for every word in the document, so it only exists while it is being used
+    connect(this, &EditorDecorator::stateChanged, this, [=](bool enabled) {
+        if (enabled && wordIndex == Q_NULLPTR) {
+            wordIndex = new WordIndex(editor, this);
+        }
+        else if (!enabled && wordIndex != Q_NULLPTR) {
+            delete wordIndex;
+            wordIndex = Q_NULLPTR;
+        }
+    });
 }
 
 void AutoCompletion::notify(const NotificationData *pscn)
@@ -39,39 +76,109 @@ void AutoCompletion::notify(const NotificationData *pscn)
 
         showAutoCompletion();
     }
+    else if (pscn->nmhdr.code == Notification::AutoCCompleted && pscn->text != Q_NULLPTR) {
+        rememberCompletion(QByteArray(pscn->text));
+    }
 }
 
 void AutoCompletion::showAutoCompletion()
 {
+    if (wordIndex == Q_NULLPTR)
+        return;
+
     int curPos = editor->currentPos();
     int startPos = editor->wordStartPosition(curPos, true);
     int endPos = editor->wordEndPosition(curPos, true);
 
     // Need a minimum number of characters to trigger auto completion
-    if ((curPos - startPos) < 3)
+    if ((curPos - startPos) < WordIndex::MINIMUM_WORD_LENGTH)
         return;
 
-    const QByteArray current_word = editor->get_text_range(startPos, curPos);
-    const QByteArray regex = "\\b" + current_word + "[\\w]*";
-    QSet<QByteArray> words;
+    QElapsedTimer elapsed;
+    elapsed.start();
 
-    editor->setSearchFlags(SCFIND_REGEXP | SCFIND_MATCHCASE);
+    const QByteArray current_word = editor->get_text_range(startPos, curPos);
+    QHash<QByteArray, int> scores;
 
     // Don't want to find the word that's currently being typed
+    for (const WordIndex::Word &word : wordIndex->wordsStartingWith(current_word, startPos, endPos)) {
+        scores[word.text] += word.count * CURRENT_DOCUMENT_WEIGHT;
+    }
 
-    // Find everything before this word
-    editor->forEachMatchInRange(regex, [&](int start, int end) {
-        words.insert(editor->get_text_range(start, end));
-        return end;
-    }, { 0, startPos});
+    const QList<QByteArray> &keywords = editor->languageKeywords;
+    for (auto it = std::lower_bound(keywords.begin(), keywords.end(), current_word); it != keywords.end() && it->startsWith(current_word); ++it) {
+        if (*it != current_word) {
+            scores[*it] += KEYWORD_WEIGHT;
+        }
+    }
+
+    // The other documents are a bonus, so only look at as many as there is time for
+    for (const WordIndex *index : WordIndex::allIndexes()) {
+        if (elapsed.elapsed() >= LATENCY_BUDGET_MS)
+            break;
+
+        if (index == wordIndex)
+            continue;
+
+        for (const WordIndex::Word &word : index->wordsStartingWith(current_word)) {
+            if (word.text != current_word) {
+                scores[word.text] += word.count;
+            }
+        }
+    }
+
+    if (scores.isEmpty()) {
+        return;
+    }
+
+    // Recently picked completions first, then the most used
+    struct Candidate
+    {
+        QByteArray text;
+        quint64 recent;
+        int score;
+    };
+
+    QVector<Candidate> candidates;
+    candidates.reserve(scores.size());
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        candidates.append({it.key(), recentCompletions.value(it.key(), 0), it.value()});
+    }
 
-    // Find everything after this word
-    editor->forEachMatchInRange(regex, [&](int start, int end) {
-        words.insert(editor->get_text_range(start, end));
-        return end;
-    }, { endPos, (Sci_PositionCR)editor->length()});
+    auto ranking = [](const Candidate &a, const Candidate &b) {
+        if (a.recent != b.recent)
+            return a.recent > b.recent;
+        if (a.score != b.score)
+            return a.score > b.score;
+        return a.text < b.text;
+    };
+
+    const int count = qMin(static_cast<int>(candidates.size()), MAX_CANDIDATES);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), ranking);
+
+    QByteArray list;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0)
+            list.append(' ');
+        list.append(candidates[i].text);
+    }
 
-    if (!words.isEmpty()) {
-        editor->autoCShow(current_word.length(), words.values().join(' '));
+    editor->autoCShow(current_word.length(), list);
+}
+
+void AutoCompletion::rememberCompletion(const QByteArray &text)
+{
+    recentCompletions.insert(text, ++completionCounter);
+
+    // Forget the oldest ones rather than letting it grow forever
+    if (recentCompletions.size() > MAX_RECENT_COMPLETIONS * 2) {
+        const quint64 oldest = completionCounter - MAX_RECENT_COMPLETIONS;
+
+        for (auto it = recentCompletions.begin(); it != recentCompletions.end();) {
+            if (it.value() <= oldest)
+                it = recentCompletions.erase(it);
+            else
+                ++it;
+        }
     }
 }
@@ -22,6 +22,8 @@
 
 #include "EditorDecorator.h"
 
+class WordIndex;
+
 
 class AutoCompletion : public EditorDecorator
 {
@@ -33,6 +35,11 @@ public:
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
     void showAutoCompletion();
+
+private:
+    void rememberCompletion(const QByteArray &text);
+
+    WordIndex *wordIndex = Q_NULLPTR;
 };
 
 #endif // AUTOCOMPLETION_H
@@ -18,6 +18,9 @@
 
 
 #include "AutoIndentation.h"
+#include "BulkEdit.h"
+
+#include <algorithm>
 
 
 using namespace Scintilla;
@@ -25,6 +28,7 @@ using namespace Scintilla;
 AutoIndentation::AutoIndentation(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
+    setNotifications({Notification::CharAdded});
 }
 
 void AutoIndentation::notify(const NotificationData *pscn)
@@ -34,7 +38,15 @@ void AutoIndentation::notify(const NotificationData *pscn)
         const int eolMode = editor->eOLMode();
 
         if (((eolMode == SC_EOL_CRLF || eolMode == SC_EOL_LF) && ch == '\n') || (eolMode == SC_EOL_CR && ch == '\r')) {
-            autoIndentLine(editor->lineFromPosition(editor->currentPos()));
+            if (editor->selections() == 1) {
+                autoIndentLine(editor->lineFromPosition(editor->currentPos()));
+            }
+            // Scintilla sends this once per selection after it has put in every line end, the first of them
+            // indents all the lines and the rest have nothing left to do
+            else if (editor->changeGeneration() != indentedGeneration) {
+                autoIndentSelections();
+                indentedGeneration = editor->changeGeneration();
+            }
         }
     }
 }
@@ -49,3 +61,62 @@ void AutoIndentation::autoIndentLine(int line) const
         editor->gotoPos(editor->findColumn(line, previousIndentation));
     }
 }
+
+void AutoIndentation::autoIndentSelections() const
+{
+    const int num = editor->selections();
+    const int mainSelection = editor->mainSelection();
+
+    std::vector<std::pair<Sci_Position, int>> carets;
+    carets.reserve(num);
+    for (int i = 0; i < num; ++i) {
+        carets.push_back(std::make_pair(editor->selectionNCaret(i), i));
+    }
+    std::sort(carets.begin(), carets.end());
+
+    const bool useTabs = editor->useTabs();
+    const int tabWidth = qMax(1, static_cast<int>(editor->tabWidth()));
+
+    // All the lines are indented as one edit, with each caret moved along by what was inserted before it
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> indents;
+    std::vector<Sci_CharacterRange> newCarets;
+    newCarets.reserve(carets.size());
+    int newMainSelection = 0;
+
+    Sci_Position offset = 0;
+    Sci_Position lastLine = -1;
+    for (const auto &caret : carets) {
+        const Sci_Position position = caret.first;
+        const Sci_Position line = editor->lineFromPosition(position);
+        Sci_Position newPosition = position + offset;
+
+        if (line != lastLine && line > 0) {
+            const int previousIndentation = editor->lineIndentation(line - 1);
+
+            if (previousIndentation > 0) {
+                const Sci_Position lineStart = editor->positionFromLine(line);
+                const Sci_Position indentEnd = editor->lineIndentPosition(line);
+                const QByteArray indent = useTabs ? QByteArray(previousIndentation / tabWidth, '\t') + QByteArray(previousIndentation % tabWidth, ' ') : QByteArray(previousIndentation, ' ');
+
+                ranges.push_back({static_cast<Sci_PositionCR>(lineStart), static_cast<Sci_PositionCR>(indentEnd)});
+                indents.append(indent);
+
+                offset += indent.size() - (indentEnd - lineStart);
+                newPosition = position <= indentEnd ? lineStart + offset + (indentEnd - lineStart) : position + offset;
+            }
+        }
+        lastLine = line;
+
+        if (caret.second == mainSelection)
+            newMainSelection = static_cast<int>(newCarets.size());
+        newCarets.push_back({static_cast<Sci_PositionCR>(newPosition), static_cast<Sci_PositionCR>(newPosition)});
+    }
+
+    if (ranges.empty())
+        return;
+
+    const BulkEdit be(editor);
+    editor->replaceRanges(ranges, indents);
+    editor->selectRanges(newCarets, newMainSelection);
+}
@@ -35,6 +35,10 @@ public slots:
 
 private:
     void autoIndentLine(int line) const;
+    void autoIndentSelections() const;
+
+    // What the document was at when the selections were last indented
+    quint64 indentedGeneration = ~Q_UINT64_C(0);
 };
 
 #endif // AUTOINDENTATION_H
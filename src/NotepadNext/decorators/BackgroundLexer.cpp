@@ -0,0 +1,609 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BackgroundLexer.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "ILexer.h"
+#include "Lexilla.h"
+
+using namespace Scintilla;
+
+
+// Documents smaller than this are lexed by the editor as usual
+const Sci_Position BACKGROUND_LEXING_THRESHOLD = 1024 * 1024 * 32;
+
+// How much text the worker lexes before handing the results over
+const Sci_Position CHUNK_SIZE = 1024 * 1024 * 4;
+
+// How many lines before the first visible one the quick pass starts, so things like comments spanning
+// several lines have a chance to be picked up
+const int QUICK_PASS_CONTEXT_LINES = 100;
+
+// Anything asking for styles this far past the screen wants them to be right rather than quick, e.g. exporting
+const int QUICK_PASS_SLACK_LINES = 200;
+
+// These are still handled by Scintilla itself, there is just no reason to tell everyone about them
+const int QUIET_MODIFICATIONS = SC_MOD_CHANGESTYLE | SC_MOD_CHANGEFOLD | SC_MOD_CHANGELINESTATE;
+
+
+namespace {
+
+// A read only copy of some text that a lexer can run against without touching the editor, so it can be
+// used from any thread. It keeps its own styles, fold levels and line states for the lexer to fill in.
+// Line -1 can be given a state and level, for when the text starts part way through a document.
+class SnapshotDocument : public IDocument
+{
+public:
+    SnapshotDocument(const QByteArray &text, int codePage, int tabWidth, int previousLineState = 0, int previousLevel = SC_FOLDLEVELBASE);
+
+    QByteArray stylesInRange(Sci_Position start, Sci_Position end) const { return styles.mid(start, end - start); }
+    Sci_Position lineCount() const { return static_cast<Sci_Position>(lineStarts.size()); }
+
+    int SCI_METHOD Version() const override { return dvRelease4; }
+    void SCI_METHOD SetErrorStatus(int) override {}
+    Sci_Position SCI_METHOD Length() const override { return text.size(); }
+    void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const override;
+    char SCI_METHOD StyleAt(Sci_Position position) const override;
+    Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override;
+    Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
+    int SCI_METHOD GetLevel(Sci_Position line) const override;
+    int SCI_METHOD SetLevel(Sci_Position line, int level) override;
+    int SCI_METHOD GetLineState(Sci_Position line) const override;
+    int SCI_METHOD SetLineState(Sci_Position line, int state) override;
+    void SCI_METHOD StartStyling(Sci_Position position) override { stylingPosition = position; }
+    bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override;
+    bool SCI_METHOD SetStyles(Sci_Position length, const char *styles) override;
+    void SCI_METHOD DecorationSetCurrentIndicator(int) override {}
+    void SCI_METHOD DecorationFillRange(Sci_Position, int, Sci_Position) override {}
+    void SCI_METHOD ChangeLexerState(Sci_Position, Sci_Position) override {}
+    int SCI_METHOD CodePage() const override { return codePage; }
+    bool SCI_METHOD IsDBCSLeadByte(char) const override { return false; }
+    const char * SCI_METHOD BufferPointer() override { return text.constData(); }
+    int SCI_METHOD GetLineIndentation(Sci_Position line) override;
+    Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
+    Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override;
+    int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const override;
+
+private:
+    int characterWidth(Sci_Position position) const;
+
+    const QByteArray text;
+    QByteArray styles;
+    std::vector<Sci_Position> lineStarts;
+    std::vector<int> levels;
+    std::vector<int> lineStates;
+    Sci_Position stylingPosition = 0;
+
+    const int codePage;
+    const int tabWidth;
+    const int previousLineState;
+    const int previousLevel;
+};
+
+SnapshotDocument::SnapshotDocument(const QByteArray &text, int codePage, int tabWidth, int previousLineState, int previousLevel) :
+    text(text),
+    styles(text.size(), '\0'),
+    codePage(codePage),
+    tabWidth(qMax(1, tabWidth)),
+    previousLineState(previousLineState),
+    previousLevel(previousLevel)
+{
+    const char *data = text.constData();
+    const Sci_Position length = text.size();
+
+    lineStarts.push_back(0);
+    for (Sci_Position i = 0; i < length; ++i) {
+        if (data[i] == '\n' || (data[i] == '\r' && (i + 1 >= length || data[i + 1] != '\n'))) {
+            lineStarts.push_back(i + 1);
+        }
+    }
+
+    levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+    lineStates.assign(lineStarts.size(), 0);
+}
+
+void SnapshotDocument::GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const
+{
+    const Sci_Position start = qBound<Sci_Position>(0, position, Length());
+    const Sci_Position end = qBound<Sci_Position>(start, position + lengthRetrieve, Length());
+
+    std::memset(buffer, 0, lengthRetrieve);
+    std::memcpy(buffer + (start - position), text.constData() + start, end - start);
+}
+
+char SnapshotDocument::StyleAt(Sci_Position position) const
+{
+    return (position >= 0 && position < Length()) ? styles.at(position) : 0;
+}
+
+Sci_Position SnapshotDocument::LineFromPosition(Sci_Position position) const
+{
+    if (position <= 0) {
+        return 0;
+    }
+
+    return std::distance(lineStarts.begin(), std::upper_bound(lineStarts.begin(), lineStarts.end(), position)) - 1;
+}
+
+Sci_Position SnapshotDocument::LineStart(Sci_Position line) const
+{
+    if (line <= 0) {
+        return 0;
+    }
+
+    return line < lineCount() ? lineStarts[line] : Length();
+}
+
+int SnapshotDocument::GetLevel(Sci_Position line) const
+{
+    if (line < 0) {
+        return previousLevel;
+    }
+
+    return line < lineCount() ? levels[line] : SC_FOLDLEVELBASE;
+}
+
+int SnapshotDocument::SetLevel(Sci_Position line, int level)
+{
+    if (line < 0 || line >= lineCount()) {
+        return SC_FOLDLEVELBASE;
+    }
+
+    const int previous = levels[line];
+    levels[line] = level;
+    return previous;
+}
+
+int SnapshotDocument::GetLineState(Sci_Position line) const
+{
+    if (line < 0) {
+        return previousLineState;
+    }
+
+    return line < lineCount() ? lineStates[line] : 0;
+}
+
+int SnapshotDocument::SetLineState(Sci_Position line, int state)
+{
+    if (line < 0 || line >= lineCount()) {
+        return 0;
+    }
+
+    const int previous = lineStates[line];
+    lineStates[line] = state;
+    return previous;
+}
+
+bool SnapshotDocument::SetStyleFor(Sci_Position length, char style)
+{
+    const Sci_Position end = qMin(Length(), stylingPosition + length);
+
+    if (stylingPosition < 0 || stylingPosition > end) {
+        return false;
+    }
+
+    std::memset(styles.data() + stylingPosition, style, end - stylingPosition);
+    stylingPosition = end;
+    return true;
+}
+
+bool SnapshotDocument::SetStyles(Sci_Position length, const char *newStyles)
+{
+    const Sci_Position end = qMin(Length(), stylingPosition + length);
+
+    if (stylingPosition < 0 || stylingPosition > end) {
+        return false;
+    }
+
+    std::memcpy(styles.data() + stylingPosition, newStyles, end - stylingPosition);
+    stylingPosition = end;
+    return true;
+}
+
+int SnapshotDocument::GetLineIndentation(Sci_Position line)
+{
+    int indent = 0;
+
+    for (Sci_Position i = LineStart(line); i < LineEnd(line); ++i) {
+        if (text.at(i) == ' ') {
+            ++indent;
+        }
+        else if (text.at(i) == '\t') {
+            indent = (indent / tabWidth + 1) * tabWidth;
+        }
+        else {
+            break;
+        }
+    }
+
+    return indent;
+}
+
+Sci_Position SnapshotDocument::LineEnd(Sci_Position line) const
+{
+    if (line + 1 >= lineCount()) {
+        return Length();
+    }
+
+    const Sci_Position start = LineStart(line);
+    Sci_Position end = LineStart(line + 1);
+
+    if (end > start && text.at(end - 1) == '\n') {
+        --end;
+    }
+
+    if (end > start && text.at(end - 1) == '\r') {
+        --end;
+    }
+
+    return end;
+}
+
+int SnapshotDocument::characterWidth(Sci_Position position) const
+{
+    Sci_Position width = 1;
+    GetCharacterAndWidth(position, &width);
+    return static_cast<int>(width);
+}
+
+Sci_Position SnapshotDocument::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const
+{
+    Sci_Position position = positionStart;
+
+    if (codePage != SC_CP_UTF8) {
+        position += characterOffset;
+        return (position < 0 || position > Length()) ? INVALID_POSITION : position;
+    }
+
+    while (characterOffset > 0 && position < Length()) {
+        position += characterWidth(position);
+        --characterOffset;
+    }
+
+    while (characterOffset < 0 && position > 0) {
+        --position;
+        while (position > 0 && (static_cast<unsigned char>(text.at(position)) & 0xC0) == 0x80) {
+            --position;
+        }
+        ++characterOffset;
+    }
+
+    return characterOffset == 0 ? position : INVALID_POSITION;
+}
+
+int SnapshotDocument::GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const
+{
+    int width = 1;
+    int character = 0;
+
+    if (position >= 0 && position < Length()) {
+        const unsigned char lead = static_cast<unsigned char>(text.at(position));
+        character = lead;
+
+        if (codePage == SC_CP_UTF8 && lead >= 0x80) {
+            const int bytes = (lead >= 0xC2 && lead <= 0xDF) ? 2 : (lead >= 0xE0 && lead <= 0xEF) ? 3 : (lead >= 0xF0 && lead <= 0xF4) ? 4 : 0;
+            int value = bytes == 2 ? (lead & 0x1F) : bytes == 3 ? (lead & 0x0F) : (lead & 0x07);
+            bool valid = bytes > 0 && position + bytes <= Length();
+
+            for (int i = 1; valid && i < bytes; ++i) {
+                const unsigned char trail = static_cast<unsigned char>(text.at(position + i));
+                valid = (trail & 0xC0) == 0x80;
+                value = (value << 6) | (trail & 0x3F);
+            }
+
+            // Same as Scintilla, anything that isn't valid UTF-8 is treated as a single replacement character
+            if (valid) {
+                character = value;
+                width = bytes;
+            }
+            else {
+                character = 0xFFFD;
+            }
+        }
+    }
+
+    if (pWidth) {
+        *pWidth = width;
+    }
+
+    return character;
+}
+
+void lexRange(ILexer5 *lexer, IDocument *document, Sci_Position start, Sci_Position end, int initStyle)
+{
+    lexer->Lex(start, end - start, initStyle, document);
+    lexer->Fold(start, end - start, initStyle, document);
+}
+
+}
+
+
+ILexer5 *BackgroundLexer::Configuration::createLexer() const
+{
+    ILexer5 *lexer = CreateLexer(name.constData());
+
+    if (lexer == Q_NULLPTR) {
+        return lexer;
+    }
+
+    for (const auto &property : properties) {
+        lexer->PropertySet(property.first.constData(), property.second.constData());
+    }
+
+    for (auto it = keywordSets.constBegin(); it != keywordSets.constEnd(); ++it) {
+        lexer->WordListSet(it.key(), it.value().constData());
+    }
+
+    return lexer;
+}
+
+BackgroundLexer::BackgroundLexer(ScintillaNext *editor) :
+    EditorDecorator(editor)
+{
+    setNotifications({Notification::StyleNeeded, Notification::Modified}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    setObjectName("BackgroundLexer");
+
+    // The language sets up the lexer's properties after it has been changed, so wait for that to be done
+    connect(editor, &ScintillaNext::lexerChanged, this, &BackgroundLexer::start, Qt::QueuedConnection);
+    connect(editor, &ScintillaNext::loadingFinished, this, &BackgroundLexer::start, Qt::QueuedConnection);
+
+    connect(this, &EditorDecorator::stateChanged, this, [=](bool enabled) {
+        if (!enabled && isActive()) {
+            stop(finishedTo);
+        }
+    });
+}
+
+BackgroundLexer::~BackgroundLexer()
+{
+    cancel();
+}
+
+void BackgroundLexer::notify(const NotificationData *pscn)
+{
+    if (!isActive()) {
+        return;
+    }
+
+    if (pscn->nmhdr.code == Notification::StyleNeeded) {
+        styleVisibleLines(pscn->position);
+    }
+    else if (pscn->nmhdr.code == Notification::Modified) {
+        if (FlagSet(pscn->modificationType, ModificationFlags::InsertText) || FlagSet(pscn->modificationType, ModificationFlags::DeleteText)) {
+            // The worker's copy is out of date now, so the editor's own lexer takes over from here
+            const Sci_Position lineStart = editor->positionFromLine(editor->lineFromPosition(pscn->position));
+
+            stop(qMin(finishedTo, lineStart));
+        }
+    }
+}
+
+void BackgroundLexer::modificationsMissed()
+{
+    // There is no telling where the worker's copy stopped matching the document
+    if (isActive()) {
+        stop(0);
+    }
+}
+
+bool BackgroundLexer::shouldStart() const
+{
+    // Anything else is left to Scintilla, e.g. DBCS code pages
+    const int codePage = editor->codePage();
+
+    return isEnabled() && !editor->isLoading() && editor->length() >= BACKGROUND_LEXING_THRESHOLD &&
+           (codePage == 0 || codePage == SC_CP_UTF8) && editor->lexer() != SCLEX_CONTAINER && editor->lexer() != SCLEX_NULL;
+}
+
+BackgroundLexer::Configuration BackgroundLexer::currentConfiguration() const
+{
+    Configuration config;
+    config.name = editor->lexerLanguage();
+
+    // The ones the lexer knows about plus the ones that are always set for every language
+    QList<QByteArray> names = editor->propertyNames().split('\n');
+    names << QByteArrayLiteral("fold") << QByteArrayLiteral("fold.compact");
+
+    for (const QByteArray &name : qAsConst(names)) {
+        if (!name.isEmpty()) {
+            config.properties.append({name, editor->property(name.constData())});
+        }
+    }
+
+    config.keywordSets = editor->languageKeywordSets;
+
+    return config;
+}
+
+void BackgroundLexer::start()
+{
+    // A different language may have been set, which already gave the editor a new lexer
+    cancel();
+
+    if (!shouldStart()) {
+        return;
+    }
+
+    configuration = currentConfiguration();
+    quickLexer = configuration.createLexer();
+
+    if (quickLexer == Q_NULLPTR) {
+        return;
+    }
+
+    qInfo("Lexing \"%s\" in the background", qUtf8Printable(editor->getName()));
+
+    const QByteArray text = *editor->textSnapshot();
+    const int codePage = editor->codePage();
+    const int tabWidth = editor->tabWidth();
+    const Configuration config = configuration;
+
+    snapshotLength = text.size();
+    finishedTo = 0;
+
+    // Scintilla releases its lexer, after this the editor asks for styles with the StyleNeeded notification
+    editor->setILexer(0);
+
+    job = std::make_shared<Job>();
+
+    std::shared_ptr<Job> currentJob = job;
+    QPointer<BackgroundLexer> self(this);
+
+    QThreadPool::globalInstance()->start([=]() {
+        ILexer5 *lexer = config.createLexer();
+        SnapshotDocument document(text, codePage, tabWidth);
+        const Sci_Position length = document.Length();
+        Sci_Position position = 0;
+
+        while (lexer && position < length && !currentJob->cancelled) {
+            // Always stop at the start of a line, the same as Scintilla would
+            const Sci_Position end = document.LineStart(document.LineFromPosition(qMin(length, position + CHUNK_SIZE)) + 1);
+
+            lexRange(lexer, &document, position, end, document.StyleAt(position - 1));
+
+            Chunk chunk;
+            chunk.position = position;
+            chunk.styles = document.stylesInRange(position, end);
+            chunk.firstLine = document.LineFromPosition(position);
+
+            const Sci_Position lastLine = qMin(document.LineFromPosition(end), document.lineCount() - 1);
+            for (Sci_Position line = chunk.firstLine; line <= lastLine; ++line) {
+                chunk.levels.append(document.GetLevel(line));
+                chunk.lineStates.append(document.GetLineState(line));
+            }
+
+            const bool last = end >= length;
+
+            // Everything posted back goes through the application object since this object may be deleted at any point
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self && self->job == currentJob) {
+                    self->applyChunk(chunk, last);
+                }
+            }, Qt::QueuedConnection);
+
+            position = end;
+        }
+
+        if (lexer) {
+            lexer->Release();
+        }
+    });
+}
+
+void BackgroundLexer::applyChunk(const Chunk &chunk, bool last)
+{
+    // The document was swapped out from underneath, whatever is there now gets its own language set
+    if (editor->length() != snapshotLength) {
+        cancel();
+        return;
+    }
+
+    const int eventMask = editor->modEventMask();
+    editor->setModEventMask(eventMask & ~QUIET_MODIFICATIONS);
+
+    editor->startStyling(chunk.position, 0);
+    editor->setStylingEx(chunk.styles.size(), chunk.styles.constData());
+
+    for (int i = 0; i < chunk.levels.size(); ++i) {
+        editor->setFoldLevel(chunk.firstLine + i, chunk.levels[i]);
+        editor->setLineState(chunk.firstLine + i, chunk.lineStates[i]);
+    }
+
+    editor->setModEventMask(eventMask);
+
+    finishedTo = chunk.position + chunk.styles.size();
+
+    if (last) {
+        qInfo("Finished lexing \"%s\" in the background", qUtf8Printable(editor->getName()));
+        stop(-1);
+    }
+}
+
+void BackgroundLexer::styleVisibleLines(Sci_Position endPosition)
+{
+    const int firstVisibleLine = editor->docLineFromVisible(editor->firstVisibleLine());
+    const int lastVisibleLine = editor->docLineFromVisible(editor->firstVisibleLine() + editor->linesOnScreen());
+    const int endLine = editor->lineFromPosition(endPosition);
+
+    if (endLine > lastVisibleLine + QUICK_PASS_SLACK_LINES) {
+        // Not the screen asking, so do it properly the same way the editor would have done it all along
+        stop(finishedTo);
+        editor->colourise(editor->endStyled(), endPosition);
+        return;
+    }
+
+    const int startLine = qMax(editor->lineFromPosition(editor->endStyled()), firstVisibleLine - QUICK_PASS_CONTEXT_LINES);
+    const Sci_Position start = editor->positionFromLine(startLine);
+    const Sci_Position end = endLine + 1 < editor->lineCount() ? editor->positionFromLine(endLine + 1) : editor->length();
+
+    if (start >= end) {
+        return;
+    }
+
+    // A guess, anything from before the start is unknown. The worker replaces it once it gets that far.
+    SnapshotDocument document(editor->get_text_range(start, end), editor->codePage(), editor->tabWidth(),
+                              startLine > 0 ? editor->lineState(startLine - 1) : 0,
+                              startLine > 0 ? editor->foldLevel(startLine - 1) : SC_FOLDLEVELBASE);
+
+    quickLexer->Lex(0, document.Length(), start > 0 ? editor->styleAt(start - 1) : 0, &document);
+
+    const QByteArray styles = document.stylesInRange(0, document.Length());
+
+    const int eventMask = editor->modEventMask();
+    editor->setModEventMask(eventMask & ~QUIET_MODIFICATIONS);
+
+    editor->startStyling(start, 0);
+    editor->setStylingEx(styles.size(), styles.constData());
+
+    editor->setModEventMask(eventMask);
+}
+
+void BackgroundLexer::cancel()
+{
+    if (job) {
+        job->cancelled = true;
+        job.reset();
+    }
+
+    if (quickLexer) {
+        quickLexer->Release();
+        quickLexer = Q_NULLPTR;
+    }
+}
+
+void BackgroundLexer::stop(Sci_Position restyleFrom)
+{
+    cancel();
+
+    // Give the editor back a lexer of its own, set up the same way. The styles it already has stay as they are.
+    editor->setILexer(reinterpret_cast<sptr_t>(configuration.createLexer()));
+
+    if (restyleFrom >= 0 && restyleFrom < editor->endStyled()) {
+        editor->startStyling(restyleFrom, 0);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BACKGROUNDLEXER_H
+#define BACKGROUNDLEXER_H
+
+#include <QMap>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+#include "EditorDecorator.h"
+
+namespace Scintilla {
+    class ILexer5;
+}
+
+
+// For large documents the lexer is taken off the editor and run over a copy of the text on a worker
+// thread instead, so that jumping far into a file doesn't lex everything before it on the GUI thread.
+// The styles and fold levels are copied back into the editor a chunk at a time as they are finished.
+// Until a part of the document has been done, whatever is on screen gets a quick approximate pass that
+// starts a little before the first visible line. Once everything has been copied over, or as soon as
+// the document is edited, the lexer is put back on the editor and takes over as usual.
+class BackgroundLexer : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    explicit BackgroundLexer(ScintillaNext *editor);
+    ~BackgroundLexer() override;
+
+    // Everything needed to create another lexer set up the same way as the editor's
+    struct Configuration
+    {
+        QByteArray name;
+        QVector<QPair<QByteArray, QByteArray>> properties;
+        QMap<int, QByteArray> keywordSets;
+
+        Scintilla::ILexer5 *createLexer() const;
+    };
+
+    struct Chunk
+    {
+        Sci_Position position;
+        QByteArray styles;
+        Sci_Position firstLine;
+        QVector<int> levels;
+        QVector<int> lineStates;
+    };
+
+    bool isActive() const { return job != nullptr; }
+
+public slots:
+    void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+private slots:
+    void start();
+
+private:
+    struct Job
+    {
+        std::atomic<bool> cancelled{false};
+    };
+
+    bool shouldStart() const;
+    Configuration currentConfiguration() const;
+    void applyChunk(const Chunk &chunk, bool last);
+    void styleVisibleLines(Sci_Position endPosition);
+    void cancel();
+    void stop(Sci_Position restyleFrom);
+
+    std::shared_ptr<Job> job;
+    Configuration configuration;
+    Scintilla::ILexer5 *quickLexer = Q_NULLPTR;
+    Sci_Position snapshotLength = 0;
+
+    // Everything before this has been copied in from the worker
+    Sci_Position finishedTo = 0;
+};
+
+#endif // BACKGROUNDLEXER_H
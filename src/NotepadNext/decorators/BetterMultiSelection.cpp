@@ -37,39 +37,42 @@ struct Selection {
     void offset(int offset) { anchor += offset; caret += offset; }
 };
 
-template<typename It>
-It uniquify(It begin, It const end)
+static bool selectionLessThan(const Selection &lhs, const Selection &rhs)
 {
-    std::vector<It> v;
-    v.reserve(static_cast<size_t>(std::distance(begin, end)));
-
-    for (It i = begin; i != end; ++i)
-        v.push_back(i);
-
-    std::sort(v.begin(), v.end(), [](const auto &lhs, const auto &rhs) {
-        return (*lhs).start() < (*rhs).start() || (!((*rhs).start() < (*lhs).start()) && (*lhs).end() < (*rhs).end());
-    });
+    return lhs.start() < rhs.start() || (!(rhs.start() < lhs.start()) && lhs.end() < rhs.end());
+}
 
-    v.erase(std::unique(v.begin(), v.end(), [](const auto &lhs, const auto &rhs) {
-        return (*lhs).start() == (*rhs).start() && (*lhs).end() == (*rhs).end();
-    }), v.end());
+// Sorts the selections and drops any that are duplicates of or overlap an earlier one, which is what
+// Scintilla would have trimmed away if they were added one at a time
+static void normalizeSelections(QVector<Selection> &selections)
+{
+    std::sort(selections.begin(), selections.end(), selectionLessThan);
 
-    std::sort(v.begin(), v.end());
+    auto out = selections.begin();
+    for (auto it = selections.begin(); it != selections.end(); ++it) {
+        if (out != selections.begin()) {
+            const Selection &previous = *(out - 1);
 
-    size_t j = 0;
-    for (It i = begin; i != end && j != v.size(); ++i) {
-        if (i == v[j]) {
-            using std::iter_swap; iter_swap(i, begin);
-            ++j;
-            ++begin;
+            if (it->start() == previous.start() && it->end() == previous.end()) {
+                continue;
+            }
+            if (it->start() < previous.end()) {
+                continue;
+            }
         }
+
+        *out++ = *it;
     }
-    return begin;
+
+    selections.erase(out, selections.end());
 }
 
 BetterMultiSelection::BetterMultiSelection(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
+    // Everything is done through the event filter
+    setNotifications({});
+
     setObjectName("BetterMultiSelection");
 
     // Allow insertion of autocompletion at each cursor
@@ -182,6 +185,7 @@ QVector<Selection> BetterMultiSelection::GetSelections() {
     QVector<Selection> selections;
 
     int num = editor->selections();
+    selections.reserve(num);
     for (int i = 0; i < num; ++i) {
         int caret = editor->selectionNCaret(i);
         int anchor = editor->selectionNAnchor(i);
@@ -192,12 +196,19 @@ QVector<Selection> BetterMultiSelection::GetSelections() {
 }
 
 void BetterMultiSelection::SetSelections(const QVector<Selection> &selections) {
-    for (auto i = 0; i < selections.size(); ++i) {
-        if (i == 0)
-            editor->setSelection(selections[i].caret, selections[i].anchor);
-        else
-            editor->addSelection(selections[i].caret, selections[i].anchor);
+    if (selections.isEmpty())
+        return;
+
+    // Install them all in one go, adding them one at a time trims each new one against every other selection
+    QVector<sptr_t> positions;
+    positions.reserve(selections.size() * 2);
+
+    for (const Selection &selection : selections) {
+        positions.append(selection.caret);
+        positions.append(selection.anchor);
     }
+
+    editor->setSelections(selections.size(), reinterpret_cast<sptr_t>(positions.constData()));
 }
 
 void BetterMultiSelection::EditSelections(std::function<void(Selection &selection)> edit) {
@@ -205,12 +216,11 @@ void BetterMultiSelection::EditSelections(std::function<void(Selection &selectio
 
     editor->clearSelections();
 
-    std::sort(selections.begin(), selections.end(), [](const auto &lhs, const auto &rhs) {
-        return lhs.start() < rhs.start() || (!(rhs.start() < lhs.start()) && lhs.end() < rhs.end());
-    });
+    std::sort(selections.begin(), selections.end(), selectionLessThan);
 
     editor->beginUndoAction();
 
+    // Selections are edited front to back so each one only needs to be shifted by how much the earlier edits changed the length
     int totalOffset = 0;
     for (auto &selection : selections) {
         selection.offset(totalOffset);
@@ -223,7 +233,7 @@ void BetterMultiSelection::EditSelections(std::function<void(Selection &selectio
 
     editor->endUndoAction();
 
-    selections.erase(uniquify(selections.begin(), selections.end()), selections.end());
+    normalizeSelections(selections);
 
     SetSelections(selections);
 }
@@ -18,6 +18,7 @@
 
 
 #include "BookMarkDecorator.h"
+#include "BulkEdit.h"
 
 const int MARK_BOOKMARK = 24;
 const int MARGIN = 1;
@@ -25,6 +26,8 @@ const int MARGIN = 1;
 BookMarkDecorator::BookMarkDecorator(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
+    setNotifications({Scintilla::Notification::MarginClick});
+
     editor->markerSetAlpha(MARK_BOOKMARK, 70);
     editor->markerDefine(MARK_BOOKMARK, SC_MARK_BOOKMARK);
     editor->markerSetFore(MARK_BOOKMARK, 0xFF2020);
@@ -34,6 +37,19 @@ BookMarkDecorator::BookMarkDecorator(ScintillaNext *editor) :
     editor->setMarginMaskN(MARGIN, (1 << MARK_BOOKMARK) | mask);
 
     editor->setMarginSensitiveN(MARGIN, true);
+
+    // The markers go away with the document while the editor is hibernating
+    connect(editor, &ScintillaNext::aboutToHibernate, this, [=]() {
+        hibernatedLines = bookMarkedLines();
+    });
+
+    connect(editor, &ScintillaNext::wokeUp, this, [=](bool fileChanged) {
+        if (!fileChanged) {
+            setBookMarkedLines(hibernatedLines);
+        }
+
+        hibernatedLines.clear();
+    });
 }
 
 void BookMarkDecorator::toggleBookmark(int line)
@@ -80,6 +96,10 @@ void BookMarkDecorator::clearBookmarks()
 
 QList<int> BookMarkDecorator::bookMarkedLines() const
 {
+    if (editor->isHibernated()) {
+        return hibernatedLines;
+    }
+
     QList<int> bookMarkedLines;
 
     int line = 0;
@@ -105,6 +125,128 @@ void BookMarkDecorator::setBookMarkedLines(QList<int> &lines)
     }
 }
 
+QBitArray BookMarkDecorator::bookMarkedLineBits() const
+{
+    QBitArray lines(static_cast<int>(editor->lineCount()));
+
+    if (editor->isHibernated()) {
+        for (const int line : hibernatedLines) {
+            if (line < lines.size())
+                lines.setBit(line);
+        }
+
+        return lines;
+    }
+
+    int line = 0;
+    while ((line = editor->markerNext(line, 1 << MARK_BOOKMARK)) != -1) {
+        lines.setBit(line);
+        line++;
+    }
+
+    return lines;
+}
+
+void BookMarkDecorator::addBookmarks(const QBitArray &lines)
+{
+    // Every marker added is a notification and a repaint otherwise
+    const BulkEdit be(editor);
+    const int lineCount = qMin(lines.size(), static_cast<int>(editor->lineCount()));
+
+    for (int line = 0; line < lineCount; ++line) {
+        if (lines.testBit(line) && !(editor->markerGet(line) & (1 << MARK_BOOKMARK))) {
+            editor->markerAdd(line, MARK_BOOKMARK);
+        }
+    }
+}
+
+void BookMarkDecorator::addBookmarksForRanges(const std::vector<Sci_CharacterRange> &ranges)
+{
+    QBitArray lines(static_cast<int>(editor->lineCount()));
+
+    for (const Sci_CharacterRange &range : ranges) {
+        lines.setBit(editor->lineFromPosition(range.cpMin));
+    }
+
+    addBookmarks(lines);
+}
+
+void BookMarkDecorator::invertBookmarks()
+{
+    const QBitArray lines = ~bookMarkedLineBits();
+
+    const BulkEdit be(editor);
+    clearBookmarks();
+    addBookmarks(lines);
+}
+
+QByteArray BookMarkDecorator::bookMarkedText() const
+{
+    QByteArray text;
+
+    int line = 0;
+    while ((line = editor->markerNext(line, 1 << MARK_BOOKMARK)) != -1) {
+        const Sci_Position start = editor->positionFromLine(line);
+        const Sci_Position end = editor->positionFromLine(line + 1);
+
+        text.append(reinterpret_cast<const char *>(editor->rangePointer(start, end - start)), end - start);
+        line++;
+    }
+
+    return text;
+}
+
+int BookMarkDecorator::deleteBookMarkedLines()
+{
+    const int firstLine = editor->markerNext(0, 1 << MARK_BOOKMARK);
+
+    if (firstLine == -1)
+        return 0;
+
+    const int lastLine = editor->markerPrevious(editor->lineCount(), 1 << MARK_BOOKMARK);
+    const QBitArray lines = bookMarkedLineBits();
+
+    // Only the span between the first and last bookmarks changes, and everything in it that is kept is
+    // copied into one buffer so it all goes back as a single replacement
+    Sci_Position spanStart = editor->positionFromLine(firstLine);
+    const Sci_Position spanEnd = editor->positionFromLine(lastLine + 1);
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(spanStart, spanEnd - spanStart));
+
+    QByteArray keptText;
+    keptText.reserve(static_cast<int>(spanEnd - spanStart) / 2);
+
+    int deleted = 0;
+    for (int line = firstLine; line <= lastLine; ++line) {
+        if (lines.testBit(line)) {
+            deleted++;
+            continue;
+        }
+
+        const Sci_Position start = editor->positionFromLine(line);
+        keptText.append(text + (start - spanStart), editor->positionFromLine(line + 1) - start);
+    }
+
+    // The last line of the document has no end of line, so if it went the one before it loses its own
+    if (lastLine == editor->lineCount() - 1) {
+        if (!keptText.isEmpty()) {
+            const int eol = keptText.endsWith("\r\n") ? 2 : 1;
+            keptText.chop(eol);
+        }
+        else if (firstLine > 0) {
+            spanStart = editor->lineEndPosition(firstLine - 1);
+        }
+    }
+
+    const BulkEdit be(editor);
+    editor->replaceRanges({{static_cast<Sci_PositionCR>(spanStart), static_cast<Sci_PositionCR>(spanEnd)}}, keptText);
+
+    // What was left of the deleted lines' markers has been merged into the lines that remain
+    clearBookmarks();
+    editor->setEmptySelection(spanStart);
+
+    return deleted;
+}
+
 void BookMarkDecorator::notify(const Scintilla::NotificationData *pscn)
 {
     if (pscn->nmhdr.code == Scintilla::Notification::MarginClick) {
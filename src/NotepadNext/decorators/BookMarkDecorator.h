@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <QBitArray>
+
+#include <vector>
+
 #include "EditorDecorator.h"
 
 
@@ -36,6 +40,21 @@ public:
     QList<int> bookMarkedLines() const;
     void setBookMarkedLines(QList<int> &lines);
 
+    // These work on every line at once, as a bit for each line of the document
+    QBitArray bookMarkedLineBits() const;
+    void addBookmarks(const QBitArray &lines);
+    void addBookmarksForRanges(const std::vector<Sci_CharacterRange> &ranges);
+    void invertBookmarks();
+
+    // The text of every bookmarked line along with its end of line
+    QByteArray bookMarkedText() const;
+
+    // Takes the bookmarked lines out as a single change, returns how many were removed
+    int deleteBookMarkedLines();
+
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
+
+private:
+    QList<int> hibernatedLines;
 };
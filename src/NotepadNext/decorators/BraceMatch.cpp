@@ -20,13 +20,61 @@
 #include "Sci_Position.h"
 
 #include "BraceMatch.h"
+#include "BracePairIndex.h"
+
+#include <cstring>
 
 using namespace Scintilla;
 
+// Until the index has got there, a brace's partner is only searched for this far either side of it
+const Sci_Position SEARCH_DISTANCE = 64 * 1024;
+
+// The same as SCI_BRACEMATCH but never looks outside of range, since on a long line that could mean going
+// through most of the document. Like Scintilla's it only counts braces with the same style as the first one.
+static Sci_Position matchBraceInRange(ScintillaNext *editor, Sci_Position pos, const Sci_CharacterRange &range)
+{
+    static const char braces[] = "()[]{}<>";
+
+    if (pos < range.cpMin || pos >= range.cpMax) {
+        return INVALID_POSITION;
+    }
+
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, range.cpMax - range.cpMin));
+    const char brace = text[pos - range.cpMin];
+    const char *found = brace != '\0' ? std::strchr(braces, brace) : Q_NULLPTR;
+
+    if (found == Q_NULLPTR) {
+        return INVALID_POSITION;
+    }
+
+    const int index = static_cast<int>(found - braces);
+    const char partner = braces[index ^ 1];
+    const int direction = (index % 2 == 0) ? 1 : -1;
+    const int style = editor->styleAt(pos);
+    int depth = 0;
+
+    for (Sci_Position i = pos; i >= range.cpMin && i < range.cpMax; i += direction) {
+        const char c = text[i - range.cpMin];
+
+        if ((c == brace || c == partner) && editor->styleAt(i) == style) {
+            depth += (c == brace) ? 1 : -1;
+
+            if (depth == 0) {
+                return i;
+            }
+        }
+    }
+
+    return INVALID_POSITION;
+}
+
 
 BraceMatch::BraceMatch(ScintillaNext *editor) :
-    EditorDecorator(editor)
+    EditorDecorator(editor),
+    braceIndex(new BracePairIndex(editor, this))
 {
+    setNotifications({Notification::UpdateUI});
+
     setObjectName("BraceMatch");
 
     const int braceHighlight = editor->allocateIndicator("brace_highlight");
@@ -54,6 +102,38 @@ BraceMatch::BraceMatch(ScintillaNext *editor) :
             clearHighlighting();
         }
     });
+
+    // A brace that was too far away to be found might be known now
+    connect(braceIndex, &BracePairIndex::indexUpdated, this, [=]() {
+        if (isEnabled()) {
+            doHighlighting();
+        }
+    });
+}
+
+Sci_Position BraceMatch::findMatch(Sci_Position pos, bool &certain) const
+{
+    Sci_Position match = INVALID_POSITION;
+
+    if (braceIndex->lookup(pos, match)) {
+        certain = true;
+        return match;
+    }
+
+    // A long line only gets searched as far as can be seen, anything else a limited distance either side
+    const Sci_Position length = editor->length();
+    const int line = editor->lineFromPosition(pos);
+    const Sci_CharacterRange range = editor->isLongLine(line)
+            ? editor->visibleRangeOfLine(line)
+            : Sci_CharacterRange{static_cast<Sci_PositionCR>(qMax<Sci_Position>(0, pos - SEARCH_DISTANCE)),
+                                 static_cast<Sci_PositionCR>(qMin<Sci_Position>(length, pos + SEARCH_DISTANCE + 1))};
+
+    match = matchBraceInRange(editor, pos, range);
+
+    // Not finding anything doesn't mean there is nothing unless the whole document was searched
+    certain = match != INVALID_POSITION || (range.cpMin == 0 && range.cpMax >= length);
+
+    return match;
 }
 
 void BraceMatch::doHighlighting()
@@ -61,9 +141,11 @@ void BraceMatch::doHighlighting()
     static const QList<char> braces = {'[', ']', '(', ')', '{', '}'};
 
     const Sci_Position pos = static_cast<Sci_Position>(editor->currentPos());
+    bool certainBefore = false;
+    bool certainAfter = false;
 
     // Check the character before the caret first
-    int match = editor->braceMatch(pos - 1, 0);
+    Sci_Position match = findMatch(pos - 1, certainBefore);
 
     if (match != INVALID_POSITION) {
          editor->braceHighlight(pos - 1, match);
@@ -71,21 +153,24 @@ void BraceMatch::doHighlighting()
     }
     else {
         // Check the character after the caret
-        match = editor->braceMatch(pos, 0);
+        match = findMatch(pos, certainAfter);
         if (match != INVALID_POSITION) {
              editor->braceHighlight(pos, match);
              editor->setHighlightGuide(editor->column(editor->lineIndentPosition(editor->lineFromPosition(pos))));
         }
         else {
             // Nothing was found, now check to see if we need to badlight something
-            // by checking the characters
+            // by checking the characters, as long as it is known there's no partner
             char c = static_cast<char>(editor->charAt(pos - 1));
             if (braces.contains(c)) {
-                editor->braceBadLight(pos - 1);
+                if (certainBefore)
+                    editor->braceBadLight(pos - 1);
+                else
+                    clearHighlighting();
             }
             else {
                 c = static_cast<char>(editor->charAt(pos));
-                if (braces.contains(c)) {
+                if (braces.contains(c) && certainAfter) {
                     editor->braceBadLight(pos);
                 }
                 else {
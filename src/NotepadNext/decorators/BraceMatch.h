@@ -22,6 +22,7 @@
 
 #include "EditorDecorator.h"
 
+class BracePairIndex;
 
 class BraceMatch : public EditorDecorator
 {
@@ -34,6 +35,11 @@ private:
     void doHighlighting();
     void clearHighlighting();
 
+    // Sets certain to false if the partner might be further away than was searched
+    Sci_Position findMatch(Sci_Position pos, bool &certain) const;
+
+    BracePairIndex *braceIndex;
+
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
 };
@@ -19,9 +19,9 @@
 #include "EditorConfigAppDecorator.h"
 #include "EditorManager.h"
 #include "ScintillaNext.h"
-#include "Finder.h"
+#include "TrailingWhitespaceTrimmer.h"
 
-#include "EditorConfig.h"
+#include "EditorConfigCache.h"
 
 class PreventUnfolding
 {
@@ -42,7 +42,7 @@ private:
 
 
 EditorConfigAppDecorator::EditorConfigAppDecorator(NotepadNextApplication *app)
-     : ApplicationDecorator(app)
+     : ApplicationDecorator(app), cache(new EditorConfigCache(this))
 {
     EditorManager *manager = app->getEditorManager();
 
@@ -54,12 +54,7 @@ void EditorConfigAppDecorator::doEditorConfig(ScintillaNext *editor)
 {
     if (this->isEnabled()) {
         if (editor->isFile()) {
-            EditorConfigSettings settings = EditorConfig::getFileSettings(editor->getFilePath());
-
-            qDebug() << "EditorConfig settings for:" << editor->getFilePath();
-            for(auto &setting : settings.toStdMap()) {
-                qDebug() << setting.first << "=" << setting.second;
-            }
+            QMap<QString, QString> settings = cache->settingsForFile(editor->getFilePath());
 
             if (settings.contains(QStringLiteral("indent_style"))) {
                 if (settings[QStringLiteral("indent_style")] == QStringLiteral("tab")) editor->setUseTabs(true);
@@ -71,6 +66,9 @@ void EditorConfigAppDecorator::doEditorConfig(ScintillaNext *editor)
 
             if (settings.contains(QStringLiteral("indent_size")) && settings[QStringLiteral("indent_size")].toInt() > 0) {
                 editor->setIndent(settings[QStringLiteral("indent_size")].toInt());
+
+                // Set a flag so that the indentation detected from the file won't override it
+                editor->QObject::setProperty("nn_skip_indent", "EditorConfig");
             }
 
             if (settings.contains(QStringLiteral("tab_width")) && settings[QStringLiteral("tab_width")].toInt() > 0) {
@@ -84,10 +82,17 @@ void EditorConfigAppDecorator::doEditorConfig(ScintillaNext *editor)
                 if (settings[QStringLiteral("end_of_line")] == QStringLiteral("lf")) editor->setEOLMode(SC_EOL_LF);
                 else if (settings[QStringLiteral("end_of_line")] == QStringLiteral("cr")) editor->setEOLMode(SC_EOL_CR);
                 else if (settings[QStringLiteral("end_of_line")] == QStringLiteral("crlf")) editor->setEOLMode(SC_EOL_CRLF);
+
+                // Set a flag so that the line endings detected from the file won't override it
+                editor->QObject::setProperty("nn_skip_eolmode", "EditorConfig");
             }
 
             if (settings.contains(QStringLiteral("trim_trailing_whitespace"))) {
                 if (settings[QStringLiteral("trim_trailing_whitespace")] == QStringLiteral("true")) {
+                    // It tracks which lines get edited from now on, so it is created up front rather than when saving
+                    TrailingWhitespaceTrimmer *trimmer = new TrailingWhitespaceTrimmer(editor);
+                    trimmer->setEnabled(true);
+
                     connect(editor, &ScintillaNext::aboutToSave, this, &EditorConfigAppDecorator::trimTrailingWhitespace);
                 }
             }
@@ -107,13 +112,12 @@ void EditorConfigAppDecorator::doEditorConfig(ScintillaNext *editor)
 void EditorConfigAppDecorator::trimTrailingWhitespace()
 {
     ScintillaNext *editor = qobject_cast<ScintillaNext *>(sender());
-    Finder f(editor);
+    TrailingWhitespaceTrimmer *trimmer = editor->findChild<TrailingWhitespaceTrimmer *>(QString(), Qt::FindDirectChildrenOnly);
     const PreventUnfolding pu(editor);
 
-    // NOTE: see note in QRegexSearch about (*ANYCRLF)
-    f.setSearchText("(*ANYCRLF)[ \t]+$");
-    f.setSearchFlags(SCFIND_REGEXP);
-    f.replaceAll("");
+    if (trimmer) {
+        trimmer->trim();
+    }
 }
 
 void EditorConfigAppDecorator::ensureFinalNewline()
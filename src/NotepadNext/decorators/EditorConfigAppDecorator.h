@@ -21,6 +21,7 @@
 
 #include "ApplicationDecorator.h"
 
+class EditorConfigCache;
 class ScintillaNext;
 
 class EditorConfigAppDecorator : public ApplicationDecorator
@@ -36,6 +37,9 @@ private slots:
     void trimTrailingWhitespace();
     void ensureFinalNewline();
     void ensureNoFinalNewline();
+
+private:
+    EditorConfigCache *cache;
 };
 
 #endif // EDITORCONFIGAPPDECORATOR_H
@@ -18,17 +18,36 @@
 
 
 #include "EditorDecorator.h"
+#include "NotificationDispatcher.h"
 
 void EditorDecorator::setEnabled(bool b)
 {
     enabled = b;
 
-    if (enabled) {
-        connect(editor, &ScintillaEdit::notify, this, &EditorDecorator::notify);
+    // Only the notifications, anything else the decorator connected to is still needed when it is enabled again
+    if (enabled && wantsNotifications) {
+        NotificationDispatcher::forEditor(editor)->subscribe(this, notificationCodes, notificationModifications);
     }
     else {
-        disconnect(editor, nullptr, this, nullptr);
+        NotificationDispatcher::forEditor(editor)->unsubscribe(this);
     }
 
     emit stateChanged(enabled);
 }
+
+void EditorDecorator::setNotifications(std::initializer_list<Scintilla::Notification> codes, Scintilla::ModificationFlags modifications)
+{
+    notificationCodes.clear();
+    for (Scintilla::Notification code : codes) {
+        notificationCodes.insert(static_cast<int>(code));
+    }
+
+    notificationModifications = modifications;
+
+    // An empty list means none at all, only the dispatcher treats no codes as everything
+    wantsNotifications = codes.size() > 0;
+
+    if (enabled) {
+        setEnabled(true);
+    }
+}
@@ -21,6 +21,9 @@
 #define EDITORDECORATOR_H
 
 #include <QObject>
+#include <QSet>
+
+#include <initializer_list>
 
 #include "ScintillaNext.h"
 
@@ -40,12 +43,26 @@ public slots:
     void setEnabled(bool b);
     virtual void notify(const Scintilla::NotificationData *pscn) = 0;
 
+    // The document may have changed while modification events were suspended, see ScintillaNext::suspendModifications()
+    virtual void modificationsMissed() {}
+
 signals:
     void stateChanged(bool b);
 
 protected:
+    // Limits the notifications this decorator is sent while enabled, and which modifications of the Modified
+    // notification. Decorators that never call this are sent everything.
+    void setNotifications(std::initializer_list<Scintilla::Notification> codes, Scintilla::ModificationFlags modifications = allModifications);
+
     ScintillaNext *editor;
     bool enabled = false;
+
+private:
+    static constexpr Scintilla::ModificationFlags allModifications = static_cast<Scintilla::ModificationFlags>(~0);
+
+    QSet<int> notificationCodes;
+    Scintilla::ModificationFlags notificationModifications = allModifications;
+    bool wantsNotifications = true;
 };
 
 #endif // EDITORDECORATOR_H
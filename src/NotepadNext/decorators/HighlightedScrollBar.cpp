@@ -19,7 +19,13 @@
 
 #include <QPainter>
 
+#include <algorithm>
+#include <cmath>
+
 #include "HighlightedScrollBar.h"
+#include "LogTimestampIndex.h"
+#include "MatchIndex.h"
+#include "MultiMarker.h"
 
 
 using namespace Scintilla;
@@ -28,10 +34,14 @@ const int DEFAULT_TICK_HEIGHT = 3;
 const int DEFAULT_TICK_PADDING = 3;
 const QColor CURSOR_SELECTION_COLOR = QColor(0, 0, 0, 25);
 const QColor CURSOR_CARET_COLOR = QColor(0, 0, 0, 100);
+const int MANY_CURSORS = 1000;
+const QColor TIMELINE_COLOR = QColor(255, 140, 0, 60);
 
 HighlightedScrollBarDecorator::HighlightedScrollBarDecorator(ScintillaNext *editor)
     : EditorDecorator(editor), scrollBar(new HighlightedScrollBar(editor, Qt::Vertical, editor))
 {
+    setNotifications({Notification::UpdateUI, Notification::Modified}, ModificationFlags::ChangeMarker);
+
     connect(scrollBar, &QScrollBar::valueChanged, editor, &ScintillaEdit::scrollVertical);
 
     editor->setVerticalScrollBar(scrollBar);
@@ -47,17 +57,42 @@ void HighlightedScrollBarDecorator::notify(const NotificationData *pscn)
         scrollBar->update();
     }
     else if (pscn->nmhdr.code == Notification::Modified && FlagSet(pscn->modificationType, ModificationFlags::ChangeMarker)) {
-        scrollBar->update();
+        scrollBar->invalidateTickMarks();
     }
 }
 
 
+void HighlightedScrollBarDecorator::modificationsMissed()
+{
+    // Markers move along with the text
+    scrollBar->invalidateTickMarks();
+}
 
 
 HighlightedScrollBar::HighlightedScrollBar(ScintillaNext *editor, Qt::Orientation orientation, QWidget *parent)
     : QScrollBar(orientation, parent), editor(editor)
 {
     smartHighlighterIndicator = editor->allocateIndicator("smart_highlighter");
+    markIndicators = MultiMarker::forEditor(editor)->indicators();
+
+    // Matches can be found long after the last content or selection change, e.g. in the background
+    connect(MatchIndex::forEditor(editor), &MatchIndex::matchesChanged, this, [=](int indicator) {
+        if (indicator == smartHighlighterIndicator || markIndicators.contains(indicator)) {
+            invalidateTickMarks();
+        }
+    });
+
+    // Log files get a histogram of how busy the log was down the side
+    LogTimestampIndex *logIndex = LogTimestampIndex::forEditor(editor);
+    if (logIndex != Q_NULLPTR) {
+        connect(logIndex, &LogTimestampIndex::indexChanged, this, &HighlightedScrollBar::invalidateTickMarks);
+    }
+}
+
+void HighlightedScrollBar::invalidateTickMarks()
+{
+    tickMarksValid = false;
+    update();
 }
 
 void HighlightedScrollBar::paintEvent(QPaintEvent *event)
@@ -66,39 +101,180 @@ void HighlightedScrollBar::paintEvent(QPaintEvent *event)
     QScrollBar::paintEvent(event);
     QPainter p(this);
 
-    drawMarker(p, 24);
-    drawIndicator(p, smartHighlighterIndicator);
+    // Working out where the tick marks go means visiting every bookmark and match, so that only gets
+    // done when one of them changes or when the lines no longer map to the same rows, e.g. after
+    // resizing, folding, or adding lines. Most repaints are just the caret moving.
+    const int height = rect().height() - scrollbarArrowHeight() * 2;
+    const int lineCount = scrollBarLineCount();
+
+    if (!tickMarksValid || height != cachedHeight || lineCount != cachedLineCount) {
+        cachedHeight = height;
+        cachedLineCount = lineCount;
+        bookMarkRows = markerRows(24);
+        smartHighlighterRows = indicatorRows(smartHighlighterIndicator);
+        markRows.clear();
+        for (int indicator : qAsConst(markIndicators)) {
+            markRows.append(indicatorRows(indicator));
+        }
+        timelineRows = activityRows();
+        tickMarksValid = true;
+    }
+
+    drawTimeline(p);
+
+    // NOTE: SCI_MARKERGETBACK doesn't exist...so can't use the marker color
+    drawRows(p, bookMarkRows, QColor(100, 100, 255));
+    for (int i = 0; i < markRows.size(); ++i) {
+        drawRows(p, markRows[i], editor->indicFore(markIndicators[i]));
+    }
+    drawRows(p, smartHighlighterRows, editor->indicFore(smartHighlighterIndicator));
     drawCursors(p);
 }
 
-void HighlightedScrollBar::drawMarker(QPainter &p, int marker)
+QBitArray HighlightedScrollBar::markerRows(int marker) const
 {
-    // NOTE: SCI_MARKERGETBACK doesn't exist...so can't use the marker color
+    QBitArray rows(qMax(0, cachedHeight + 1));
     int curLine = 0;
 
+    if (rows.isEmpty()) {
+        return rows;
+    }
+
     while ((curLine = editor->markerNext(curLine, 1 << marker)) != -1) {
-        drawTickMark(p, lineToScrollBarY(curLine), DEFAULT_TICK_HEIGHT, QColor(100, 100, 255));
+        rows.setBit(qBound(0, lineToScrollBarY(editor->visibleFromDocLine(curLine)), cachedHeight));
 
         curLine++;
     }
+
+    return rows;
 }
 
-void HighlightedScrollBar::drawIndicator(QPainter &p, int indicator)
+QVector<float> HighlightedScrollBar::activityRows() const
 {
-    int curPos = editor->indicatorEnd(indicator, 0);
-    int color = editor->indicFore(indicator);
+    const LogTimestampIndex *logIndex = LogTimestampIndex::forEditor(editor);
+    QVector<float> rows;
+
+    if (logIndex == Q_NULLPTR || !logIndex->isLog() || logIndex->samples().size() < 2 || cachedHeight <= 0) {
+        return rows;
+    }
+
+    // Lines logged per second between each pair of samples, on a log scale so quiet stretches still show up
+    const std::vector<LogTimestampIndex::Sample> &samples = logIndex->samples();
+    float busiest = 0;
+
+    rows.fill(0, cachedHeight + 1);
+
+    for (size_t i = 0; i + 1 < samples.size(); ++i) {
+        const qint64 elapsed = samples[i + 1].time - samples[i].time;
 
-    if (curPos > 0) {
-        while ((curPos = editor->indicatorEnd(indicator, curPos)) < editor->length()) {
-            drawTickMark(p, posToScrollBarY(curPos), DEFAULT_TICK_HEIGHT, color);
+        // Out of order, e.g. where two logs were joined together
+        if (elapsed < 0)
+            continue;
 
-            curPos = editor->indicatorEnd(indicator, curPos);
+        const float rate = std::log1p(static_cast<float>(samples[i + 1].line - samples[i].line) * 1000.0f / qMax<qint64>(1, elapsed));
+        const int firstRow = qBound(0, lineToScrollBarY(editor->visibleFromDocLine(samples[i].line)), cachedHeight);
+        const int lastRow = qBound(0, lineToScrollBarY(editor->visibleFromDocLine(samples[i + 1].line)), cachedHeight);
+
+        for (int row = firstRow; row <= lastRow; ++row) {
+            rows[row] = qMax(rows[row], rate);
+        }
+
+        busiest = qMax(busiest, rate);
+    }
+
+    if (busiest > 0) {
+        for (float &row : rows) {
+            row /= busiest;
+        }
+    }
+
+    return rows;
+}
+
+QBitArray HighlightedScrollBar::indicatorRows(int indicator) const
+{
+    const std::vector<Sci_CharacterRange> &matches = MatchIndex::forEditor(editor)->matches(indicator);
+    QBitArray rows(qMax(0, cachedHeight + 1));
+
+    if (cachedHeight <= 0) {
+        return rows;
+    }
+
+    auto it = matches.begin();
+    while (it != matches.end()) {
+        const int line = editor->visibleFromDocLine(editor->lineFromPosition(it->cpMin));
+        const int y = lineToScrollBarY(line);
+
+        rows.setBit(qBound(0, y, cachedHeight));
+
+        // Everything else that lands on the same row needs no further work, so jump past it.
+        // Erring one line early only costs a redundant lookup, erring late would lose a row.
+        const int nextLine = qMax(line + 1, static_cast<int>(std::ceil(static_cast<double>(y + 1) * cachedLineCount / cachedHeight)) - 1);
+        const Sci_PositionCR nextPosition = editor->positionFromLine(editor->docLineFromVisible(nextLine));
+
+        it = std::lower_bound(it + 1, matches.end(), nextPosition, [](const Sci_CharacterRange &range, Sci_PositionCR position) {
+            return range.cpMin < position;
+        });
+    }
+
+    return rows;
+}
+
+void HighlightedScrollBar::drawRows(QPainter &p, const QBitArray &rows, QColor color)
+{
+    // Rows next to each other overlap anyway, so draw each run of them as a single mark
+    int row = 0;
+    while (row < rows.size()) {
+        if (!rows.testBit(row)) {
+            ++row;
+            continue;
+        }
+
+        const int runStart = row;
+        while (row < rows.size() && rows.testBit(row)) {
+            ++row;
+        }
+
+        drawTickMark(p, runStart, row - runStart - 1 + DEFAULT_TICK_HEIGHT, color);
+    }
+}
+
+void HighlightedScrollBar::drawTimeline(QPainter &p)
+{
+    const int width = rect().width() - (DEFAULT_TICK_PADDING * 2);
+
+    for (int row = 0; row < timelineRows.size(); ++row) {
+        if (timelineRows[row] > 0) {
+            p.fillRect(rect().x() + DEFAULT_TICK_PADDING, row + scrollbarArrowHeight(), qMax(1, qRound(timelineRows[row] * width)), 1, TIMELINE_COLOR);
         }
     }
 }
 
 void HighlightedScrollBar::drawCursors(QPainter &p)
 {
+    const int count = editor->selections();
+
+    // Lots of cursors mostly land on the same rows, so mark the rows first and draw each run of them once
+    if (count > MANY_CURSORS && cachedHeight > 0) {
+        QBitArray selectionRows(cachedHeight + 1);
+        QBitArray caretRows(cachedHeight + 1);
+
+        for (int i = 0; i < count; i++) {
+            const int caretY = qBound(0, posToScrollBarY(editor->selectionNCaret(i)), cachedHeight);
+            const int anchorY = qBound(0, posToScrollBarY(editor->selectionNAnchor(i)), cachedHeight);
+
+            if (caretY != anchorY) {
+                selectionRows.fill(true, qMin(caretY, anchorY), qMax(caretY, anchorY));
+            }
+
+            caretRows.setBit(caretY);
+        }
+
+        drawRows(p, selectionRows, CURSOR_SELECTION_COLOR);
+        drawRows(p, caretRows, CURSOR_CARET_COLOR);
+        return;
+    }
+
     for (int i = 0; i < editor->selections() ; i++) {
         int startCaretY = posToScrollBarY(editor->selectionNCaret(i));
         int startAnchorY = posToScrollBarY(editor->selectionNAnchor(i));
@@ -124,6 +300,11 @@ int HighlightedScrollBar::posToScrollBarY(int pos) const
 }
 
 int HighlightedScrollBar::lineToScrollBarY(int line) const
+{
+    return static_cast<double>(line) / scrollBarLineCount() * (rect().height() - scrollbarArrowHeight() * 2);
+}
+
+int HighlightedScrollBar::scrollBarLineCount() const
 {
     int lineCount = editor->visibleFromDocLine(editor->lineCount());
 
@@ -131,7 +312,7 @@ int HighlightedScrollBar::lineToScrollBarY(int line) const
         lineCount += editor->linesOnScreen();
     }
 
-    return static_cast<double>(line) / lineCount * (rect().height() - scrollbarArrowHeight() * 2);
+    return lineCount;
 }
 
 int HighlightedScrollBar::scrollbarArrowHeight() const
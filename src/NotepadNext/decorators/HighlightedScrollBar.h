@@ -20,8 +20,10 @@
 #ifndef HIGHLIGHTEDSCROLLBAR_H
 #define HIGHLIGHTEDSCROLLBAR_H
 
+#include <QBitArray>
 #include <QScrollBar>
 #include <QPointer>
+#include <QVector>
 
 #include "EditorDecorator.h"
 
@@ -38,6 +40,7 @@ public:
 
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
 
 private:
     HighlightedScrollBar *scrollBar;
@@ -51,22 +54,38 @@ class HighlightedScrollBar : public QScrollBar
 public:
     explicit HighlightedScrollBar(ScintillaNext *editor, Qt::Orientation orientation, QWidget *parent = nullptr);
 
+    void invalidateTickMarks();
+
 protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
-    void drawMarker(QPainter &p, int marker);
-    void drawIndicator(QPainter &p, int indicator);
+    QBitArray markerRows(int marker) const;
+    QBitArray indicatorRows(int indicator) const;
+    QVector<float> activityRows() const;
+    void drawRows(QPainter &p, const QBitArray &rows, QColor color);
+    void drawTimeline(QPainter &p);
     void drawCursors(QPainter &p);
 
     void drawTickMark(QPainter &p, int y, int height, QColor color);
 
     int posToScrollBarY(int pos) const;
     int lineToScrollBarY(int line) const;
+    int scrollBarLineCount() const;
     int scrollbarArrowHeight() const;
 
     ScintillaNext *editor;
     int smartHighlighterIndicator;
+    QVector<int> markIndicators;
+
+    // Which rows of the scroll bar have a tick mark, worked out for the height and line count they were built with
+    QBitArray bookMarkRows;
+    QBitArray smartHighlighterRows;
+    QVector<QBitArray> markRows;
+    QVector<float> timelineRows;
+    int cachedHeight = -1;
+    int cachedLineCount = -1;
+    bool tickMarksValid = false;
 };
 
 #endif // HIGHLIGHTEDSCROLLBAR_H
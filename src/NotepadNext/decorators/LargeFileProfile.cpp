@@ -0,0 +1,234 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LargeFileProfile.h"
+
+#include "AutoCompletion.h"
+#include "BraceMatch.h"
+#include "LineNumbers.h"
+#include "NotepadNextApplication.h"
+#include "SmartHighlighter.h"
+#include "SpellChecker.h"
+#include "URLFinder.h"
+
+#include "Lexilla.h"
+
+#include <QThread>
+
+#include <climits>
+#include <cstring>
+
+using namespace Scintilla;
+
+
+// Any one of these is enough for a file to get the profile
+const Sci_Position LARGE_FILE_SIZE = 1024 * 1024 * 256;
+const Sci_Position LARGE_FILE_LINE_COUNT = 5000000;
+
+// How many measured pieces of text to keep for files with very long lines
+const int LONG_LINES_POSITION_CACHE_SIZE = 1024 * 64;
+
+
+
+static Sci_Position longestLineLength(ScintillaNext *editor)
+{
+    const char *text = reinterpret_cast<const char *>(editor->characterPointer());
+    const char *end = text + editor->length();
+    Sci_Position longest = 0;
+
+    while (text < end) {
+        const char *newline = static_cast<const char *>(std::memchr(text, '\n', end - text));
+        const char *lineEnd = newline ? newline : end;
+
+        longest = qMax<Sci_Position>(longest, lineEnd - text);
+        text = lineEnd + 1;
+    }
+
+    return longest;
+}
+
+LargeFileProfile::LargeFileProfile(ScintillaNext *editor) :
+    EditorDecorator(editor)
+{
+    setNotifications({});
+
+    setObjectName("LargeFileProfile");
+
+    connect(editor, &ScintillaNext::loadingFinished, this, &LargeFileProfile::evaluate, Qt::QueuedConnection);
+
+    // The language sets up the lexer's properties after it has been changed, so wait for that to be done
+    connect(editor, &ScintillaNext::lexerChanged, this, &LargeFileProfile::downgradeLexer, Qt::QueuedConnection);
+
+    connect(this, &EditorDecorator::stateChanged, this, [=](bool enabled) {
+        if (enabled) {
+            evaluate();
+        }
+        else if (applied) {
+            restore();
+        }
+    });
+}
+
+QString LargeFileProfile::description() const
+{
+    if (longLines) {
+        return tr("The file has very long lines, so syntax highlighting, folding, word wrap and some other features are switched off. Click to turn them back on.");
+    }
+
+    return tr("The file is very large, so folding, word wrap and some other features are switched off. Click to turn them back on.");
+}
+
+bool LargeFileProfile::isAppliedTo(ScintillaNext *editor)
+{
+    LargeFileProfile *profile = editor->documentOwner()->findChild<LargeFileProfile *>(QString(), Qt::FindDirectChildrenOnly);
+
+    return profile && profile->isApplied();
+}
+
+void LargeFileProfile::notify(const NotificationData *pscn)
+{
+    Q_UNUSED(pscn);
+}
+
+void LargeFileProfile::evaluate()
+{
+    if (!isEnabled() || applied || editor->isLoading() || editor->isLoadDeferred()) {
+        return;
+    }
+
+    longestLine = longestLineLength(editor);
+    longLines = longestLine > ScintillaNext::LONG_LINE_LENGTH;
+    largeDocument = editor->length() >= LARGE_FILE_SIZE || editor->lineCount() >= LARGE_FILE_LINE_COUNT;
+
+    if (longLines || largeDocument) {
+        apply();
+    }
+}
+
+void LargeFileProfile::apply()
+{
+    qInfo("Using the large file profile for \"%s\"", qUtf8Printable(editor->getName()));
+
+    applied = true;
+
+    const QList<EditorDecorator *> decorators = editor->findChildren<EditorDecorator *>(QString(), Qt::FindDirectChildrenOnly);
+    for (EditorDecorator *decorator : decorators) {
+        // These two only look at what is on screen of long lines, so they just get too slow for large documents
+        const bool visibleOnly = qobject_cast<URLFinder *>(decorator) || qobject_cast<BraceMatch *>(decorator);
+        const bool expensive = qobject_cast<SmartHighlighter *>(decorator) || qobject_cast<AutoCompletion *>(decorator) ||
+                               qobject_cast<SpellChecker *>(decorator) ||
+                               qobject_cast<LineNumbers *>(decorator) || (visibleOnly && largeDocument);
+
+        if (expensive && decorator->isEnabled()) {
+            decorator->setEnabled(false);
+            disabledDecorators.append(decorator);
+        }
+    }
+
+    // The line numbers still get shown, the margin just doesn't keep adjusting while scrolling
+    LineNumbers *lineNumbers = editor->findChild<LineNumbers *>(QString(), Qt::FindDirectChildrenOnly);
+    if (lineNumbers && disabledDecorators.contains(lineNumbers)) {
+        lineNumbers->adjustMarginWidth();
+    }
+
+    wrapMode = editor->wrapMode();
+    editor->setWrapMode(SC_WRAP_NONE);
+
+    // Measuring every line that gets drawn is replaced by a guess from the longest line
+    scrollWidthTracking = editor->scrollWidthTracking();
+    editor->setScrollWidthTracking(false);
+    editor->setScrollWidth(static_cast<int>(qBound<qint64>(1, longestLine * editor->textWidth(STYLE_DEFAULT, "8"), INT_MAX)));
+
+    // Scintilla can split laying out long lines between threads, which is all of each line it has to measure
+    layoutThreads = editor->layoutThreads();
+    positionCacheSize = editor->positionCache();
+    if (longLines) {
+        editor->setLayoutThreads(qMax(layoutThreads, QThread::idealThreadCount()));
+
+        // Long lines are measured in many short pieces, so keep more of them around
+        editor->setPositionCache(qMax(positionCacheSize, LONG_LINES_POSITION_CACHE_SIZE));
+    }
+
+    // Every line's layout would be a lot of memory for millions of lines
+    layoutCacheMode = editor->layoutCache();
+    if (largeDocument && layoutCacheMode == SC_CACHE_DOCUMENT) {
+        editor->setLayoutCache(SC_CACHE_PAGE);
+    }
+
+    foldMarginWidth = editor->marginWidthN(2);
+    editor->setMarginWidthN(2, 0);
+
+    // Marking every line of a huge document is a lot to keep and update on each edit
+    changeHistory = editor->isChangeHistoryEnabled();
+    editor->setChangeHistoryEnabled(false);
+
+    downgradeLexer();
+
+    emit profileChanged(true);
+}
+
+void LargeFileProfile::downgradeLexer()
+{
+    if (!applied) {
+        return;
+    }
+
+    foldProperty = editor->property("fold");
+    editor->setProperty("fold", "0");
+
+    if (longLines) {
+        editor->setILexer(reinterpret_cast<sptr_t>(CreateLexer("null")));
+    }
+}
+
+void LargeFileProfile::restore()
+{
+    qInfo("No longer using the large file profile for \"%s\"", qUtf8Printable(editor->getName()));
+
+    applied = false;
+
+    for (const QPointer<EditorDecorator> &decorator : qAsConst(disabledDecorators)) {
+        if (decorator) {
+            decorator->setEnabled(true);
+        }
+    }
+    disabledDecorators.clear();
+
+    editor->setWrapMode(wrapMode);
+    editor->setScrollWidthTracking(scrollWidthTracking);
+    editor->setLayoutThreads(layoutThreads);
+    editor->setPositionCache(positionCacheSize);
+    editor->setLayoutCache(layoutCacheMode);
+    editor->setMarginWidthN(2, foldMarginWidth);
+    editor->setChangeHistoryEnabled(changeHistory);
+
+    if (longLines) {
+        // The lexer was thrown away, setting the language again is the only way to get one set up the same
+        NotepadNextApplication *app = qobject_cast<NotepadNextApplication *>(qApp);
+
+        if (app && !editor->languageName.isEmpty()) {
+            app->setEditorLanguage(editor, editor->languageName);
+        }
+    }
+    else {
+        editor->setProperty("fold", foldProperty.constData());
+    }
+
+    emit profileChanged(false);
+}
@@ -0,0 +1,77 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LARGEFILEPROFILE_H
+#define LARGEFILEPROFILE_H
+
+#include <QList>
+#include <QPointer>
+
+#include "EditorDecorator.h"
+
+
+// Some files make nearly everything slow at once, e.g. huge single line minified files or CSV files with millions
+// of lines. Once such a file is loaded this switches off the expensive decorators, folding, word wrap, change history
+// and scroll width tracking for that editor. Very long lines also lose the lexer, and get laid out on every core with
+// a bigger cache of measured text. Huge documents stop keeping the layout of every line.
+// Disabling it puts everything back.
+class LargeFileProfile : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileProfile(ScintillaNext *editor);
+
+    bool isApplied() const { return applied; }
+    QString description() const;
+
+    static bool isAppliedTo(ScintillaNext *editor);
+
+public slots:
+    void notify(const Scintilla::NotificationData *pscn) override;
+
+signals:
+    void profileChanged(bool applied);
+
+private slots:
+    void evaluate();
+    void downgradeLexer();
+
+private:
+    void apply();
+    void restore();
+
+    bool applied = false;
+    bool longLines = false;
+    bool largeDocument = false;
+    Sci_Position longestLine = 0;
+
+    // What was changed so it can be put back
+    QList<QPointer<EditorDecorator>> disabledDecorators;
+    int wrapMode = 0;
+    bool scrollWidthTracking = true;
+    int layoutThreads = 1;
+    int positionCacheSize = 0;
+    int layoutCacheMode = 0;
+    QByteArray foldProperty;
+    int foldMarginWidth = 0;
+    bool changeHistory = false;
+};
+
+#endif // LARGEFILEPROFILE_H
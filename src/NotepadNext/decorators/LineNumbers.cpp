@@ -39,6 +39,9 @@ static inline int countDigits(quint32 x)
 LineNumbers::LineNumbers(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
+    // The width only depends on how many digits the line count has, so there's no need to look at it while scrolling
+    setNotifications({Notification::Modified, Notification::Zoom}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
     editor->setMarginWidthN(0, 0);
 
     connect(this, &EditorDecorator::stateChanged, editor, [=](bool b) {
@@ -49,18 +52,48 @@ LineNumbers::LineNumbers(ScintillaNext *editor) :
             editor->setMarginWidthN(0, 0);
         }
     });
+
+    // Changing the language resets the styles, which can change the margin's font
+    connect(editor, &ScintillaNext::lexerChanged, this, [=]() {
+        digitWidth = -1;
+
+        if (isEnabled()) {
+            adjustMarginWidth();
+        }
+    });
 }
 
 void LineNumbers::adjustMarginWidth()
 {
-    int lineCount = editor->lineCount();
-    int pixelWidth = 8 + (qMax(countDigits(lineCount), 3)) * editor->textWidth(STYLE_LINENUMBER, "8");
-    editor->setMarginWidthN(0, pixelWidth);
+    // Measuring text goes through the platform's font layer so only do it when the font or zoom could have changed
+    if (digitWidth < 0) {
+        digitWidth = editor->textWidth(STYLE_LINENUMBER, "8");
+    }
+
+    digits = qMax(countDigits(editor->lineCount()), 3);
+
+    const int pixelWidth = 8 + digits * digitWidth;
+
+    // Setting the width causes a relayout even if it is the same
+    if (editor->marginWidthN(0) != pixelWidth) {
+        editor->setMarginWidthN(0, pixelWidth);
+    }
 }
 
 void LineNumbers::notify(const NotificationData *pscn)
 {
-    if ((pscn->nmhdr.code == Notification::UpdateUI && FlagSet(pscn->updated, Update::VScroll)) || (pscn->nmhdr.code == Notification::Zoom)) {
+    if (pscn->nmhdr.code == Notification::Modified) {
+        if (pscn->linesAdded != 0 && qMax(countDigits(editor->lineCount()), 3) != digits) {
+            adjustMarginWidth();
+        }
+    }
+    else if (pscn->nmhdr.code == Notification::Zoom) {
+        digitWidth = -1;
         adjustMarginWidth();
     }
 }
+
+void LineNumbers::modificationsMissed()
+{
+    adjustMarginWidth();
+}
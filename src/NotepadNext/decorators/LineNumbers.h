@@ -36,6 +36,11 @@ private:
 
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+private:
+    int digitWidth = -1;
+    int digits = 0;
 };
 
 #endif // LINENUMBERS_H
@@ -0,0 +1,517 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LogTimestampIndex.h"
+#include "JobScheduler.h"
+
+#include <QDeadlineTimer>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Scintilla;
+
+
+// How many of the first lines are looked at to work out the format
+const int DETECT_LINES = 50;
+
+// How many of them need a timestamp, unless the document has fewer lines than this
+const int DETECT_MINIMUM = 3;
+
+// Only this much of the start of a line is looked at for its timestamp
+const int TIMESTAMP_SEARCH_LENGTH = 96;
+
+// A sample is the first timestamped line within this many lines of where it is meant to be
+const int SAMPLE_SEARCH_LINES = 32;
+
+// Syslog timestamps don't have a year, a leap year lets the 29th of February through
+const int YEARLESS_YEAR = 2000;
+
+const qint64 MS_PER_DAY = 24 * 60 * 60 * 1000;
+
+static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar, and back again
+static qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + static_cast<qint64>(dayOfEra) - 719468;
+}
+
+static void civilFromDays(qint64 days, int &year, int &month, int &day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned mp = (5 * dayOfYear + 2) / 153;
+
+    day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+static qint64 toTime(int year, int month, int day, int hour, int minute, int second, int msec)
+{
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return -1;
+
+    return (((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second) * 1000 + msec;
+}
+
+static bool readNumber(const char *&p, const char *end, int minDigits, int maxDigits, int &value)
+{
+    int digits = 0;
+    value = 0;
+
+    while (p < end && digits < maxDigits && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+        ++digits;
+    }
+
+    return digits >= minDigits;
+}
+
+static bool readChar(const char *&p, const char *end, char c)
+{
+    if (p < end && *p == c) {
+        ++p;
+        return true;
+    }
+
+    return false;
+}
+
+static bool readMonthName(const char *&p, const char *end, int &month)
+{
+    if (end - p < 3)
+        return false;
+
+    for (int i = 0; i < 12; ++i) {
+        if (std::memcmp(p, MONTHS + i * 3, 3) == 0) {
+            month = i + 1;
+            p += 3;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// HH:MM:SS followed by an optional fraction of a second, of which only the milliseconds are kept
+static bool readTimeOfDay(const char *&p, const char *end, int &hour, int &minute, int &second, int &msec)
+{
+    if (!readNumber(p, end, 1, 2, hour) || !readChar(p, end, ':') || !readNumber(p, end, 2, 2, minute) || !readChar(p, end, ':') || !readNumber(p, end, 2, 2, second))
+        return false;
+
+    msec = 0;
+
+    if (readChar(p, end, '.') || readChar(p, end, ',')) {
+        int digits = 0;
+
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 3) {
+                msec = msec * 10 + (*p - '0');
+                ++digits;
+            }
+            ++p;
+        }
+
+        if (digits == 0)
+            return false;
+
+        for (; digits < 3; ++digits) {
+            msec *= 10;
+        }
+    }
+
+    return true;
+}
+
+static qint64 parseTimestamp(LogTimestampIndex::Format format, const char *data, qsizetype length)
+{
+    const char *p = data;
+    const char *end = data + qMin<qsizetype>(length, TIMESTAMP_SEARCH_LENGTH);
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0, msec = 0;
+
+    switch (format) {
+    case LogTimestampIndex::IsoTimestamps: {
+        readChar(p, end, '[');
+
+        if (!readNumber(p, end, 4, 4, year) || p >= end || (*p != '-' && *p != '/'))
+            return -1;
+
+        const char separator = *p++;
+
+        if (!readNumber(p, end, 2, 2, month) || !readChar(p, end, separator) || !readNumber(p, end, 2, 2, day))
+            return -1;
+
+        if (!readChar(p, end, 'T') && !readChar(p, end, ' '))
+            return -1;
+
+        if (!readTimeOfDay(p, end, hour, minute, second, msec))
+            return -1;
+
+        return toTime(year, month, day, hour, minute, second, msec);
+    }
+    case LogTimestampIndex::SyslogTimestamps:
+        if (!readMonthName(p, end, month) || !readChar(p, end, ' '))
+            return -1;
+
+        // Days before the 10th are padded with a space
+        readChar(p, end, ' ');
+
+        if (!readNumber(p, end, 1, 2, day) || !readChar(p, end, ' ') || !readTimeOfDay(p, end, hour, minute, second, msec))
+            return -1;
+
+        return toTime(YEARLESS_YEAR, month, day, hour, minute, second, msec);
+    case LogTimestampIndex::ApacheTimestamps:
+        p = static_cast<const char *>(std::memchr(p, '[', end - p));
+
+        if (p == Q_NULLPTR)
+            return -1;
+
+        ++p;
+
+        if (!readNumber(p, end, 2, 2, day) || !readChar(p, end, '/') || !readMonthName(p, end, month) || !readChar(p, end, '/') ||
+            !readNumber(p, end, 4, 4, year) || !readChar(p, end, ':') || !readTimeOfDay(p, end, hour, minute, second, msec))
+            return -1;
+
+        return toTime(year, month, day, hour, minute, second, msec);
+    case LogTimestampIndex::NoTimestamps:
+        break;
+    }
+
+    return -1;
+}
+
+LogTimestampIndex::LogTimestampIndex(ScintillaNext *editor) :
+    EditorDecorator(editor)
+{
+    setNotifications({Notification::Modified}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    setObjectName("LogTimestampIndex");
+
+    // The format can only be told once there is some text to look at
+    connect(editor, &ScintillaNext::loadingFinished, this, [=]() {
+        restartFrom(0);
+    });
+    connect(editor, &ScintillaNext::wokeUp, this, [=]() {
+        restartFrom(0);
+    });
+
+    restartFrom(0);
+}
+
+LogTimestampIndex *LogTimestampIndex::forEditor(ScintillaNext *editor)
+{
+    // Clones share the index of the editor whose document they show
+    return editor->documentOwner()->findChild<LogTimestampIndex *>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+qint64 LogTimestampIndex::parseTime(const QString &text) const
+{
+    const QString trimmed = text.trimmed();
+    const QByteArray bytes = trimmed.toUtf8();
+    const qint64 time = parseTimestamp(logFormat, bytes.constData(), bytes.size());
+
+    if (time >= 0)
+        return time;
+
+    static const QRegularExpression re(QStringLiteral("^(?:(\\d{4})[-/](\\d{1,2})[-/](\\d{1,2}))?[T ]*(?:(\\d{1,2}):(\\d{2})(?::(\\d{2})(?:[.,](\\d{1,3}))?)?)?$"));
+    const QRegularExpressionMatch match = re.match(trimmed);
+
+    if (!match.hasMatch() || (match.capturedLength(1) == 0 && match.capturedLength(4) == 0))
+        return -1;
+
+    qint64 day = 0;
+
+    if (match.capturedLength(1) > 0) {
+        const int year = logFormat == SyslogTimestamps ? YEARLESS_YEAR : match.captured(1).toInt();
+        const qint64 midnight = toTime(year, match.captured(2).toInt(), match.captured(3).toInt(), 0, 0, 0, 0);
+
+        if (midnight < 0)
+            return -1;
+
+        day = midnight / MS_PER_DAY;
+    }
+    else if (!timeSamples.empty()) {
+        // A time on its own is on the day the log starts
+        day = timeSamples.front().time / MS_PER_DAY;
+    }
+    else {
+        return -1;
+    }
+
+    const int hour = match.captured(4).toInt();
+    const int minute = match.captured(5).toInt();
+    const int second = match.captured(6).toInt();
+    const int msec = match.captured(7).leftJustified(3, QLatin1Char('0')).toInt();
+
+    if (hour > 23 || minute > 59 || second > 60)
+        return -1;
+
+    return (((day * 24 + hour) * 60 + minute) * 60 + second) * 1000 + msec;
+}
+
+QString LogTimestampIndex::formatTime(qint64 time) const
+{
+    if (time < 0)
+        return QString();
+
+    int year, month, day;
+    civilFromDays(time / MS_PER_DAY, year, month, day);
+
+    const qint64 msecOfDay = time % MS_PER_DAY;
+    const QString timeOfDay = QStringLiteral("%1:%2:%3")
+                                  .arg(msecOfDay / 3600000, 2, 10, QLatin1Char('0'))
+                                  .arg(msecOfDay / 60000 % 60, 2, 10, QLatin1Char('0'))
+                                  .arg(msecOfDay / 1000 % 60, 2, 10, QLatin1Char('0'));
+
+    if (logFormat == SyslogTimestamps) {
+        return QStringLiteral("%1 %2 %3").arg(QLatin1String(MONTHS + (month - 1) * 3, 3)).arg(day, 2, 10, QLatin1Char(' ')).arg(timeOfDay);
+    }
+
+    return QStringLiteral("%1-%2-%3 %4").arg(year, 4, 10, QLatin1Char('0')).arg(month, 2, 10, QLatin1Char('0')).arg(day, 2, 10, QLatin1Char('0')).arg(timeOfDay);
+}
+
+qint64 LogTimestampIndex::timeOfLine(Sci_Position line) const
+{
+    if (!isLog())
+        return -1;
+
+    // Lines such as stack traces go by the entry they are part of
+    const Sci_Position limit = qMax<Sci_Position>(0, line - SAMPLE_INTERVAL);
+    for (Sci_Position l = line; l >= limit; --l) {
+        const qint64 time = lineTimestamp(l);
+
+        if (time >= 0)
+            return time;
+    }
+
+    auto it = std::partition_point(timeSamples.cbegin(), timeSamples.cend(), [=](const Sample &sample) {
+        return sample.line <= line;
+    });
+
+    return it == timeSamples.cbegin() ? -1 : std::prev(it)->time;
+}
+
+Sci_Position LogTimestampIndex::lineAtOrAfter(qint64 time)
+{
+    finishSampling();
+
+    if (timeSamples.empty())
+        return -1;
+
+    // The samples narrow it down to the lines between two of them...
+    auto it = std::partition_point(timeSamples.cbegin(), timeSamples.cend(), [=](const Sample &sample) {
+        return sample.time < time;
+    });
+
+    const Sci_Position upper = it == timeSamples.cend() ? editor->lineCount() : it->line;
+    Sci_Position low = it == timeSamples.cbegin() ? 0 : std::prev(it)->line;
+    Sci_Position high = upper;
+
+    // ...which are searched the same way. Lines without a timestamp go by the next line that has one.
+    while (low < high) {
+        const Sci_Position mid = low + (high - low) / 2;
+        Sci_Position found = -1;
+        const qint64 midTime = nextTimestamp(mid, high, &found);
+
+        if (midTime < 0 || midTime >= time) {
+            high = mid;
+        }
+        else {
+            low = found + 1;
+        }
+    }
+
+    Sci_Position found = -1;
+    if (nextTimestamp(low, upper, &found) >= 0)
+        return found;
+
+    return upper < editor->lineCount() ? upper : -1;
+}
+
+void LogTimestampIndex::notify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code == Notification::Modified) {
+        restartFrom(editor->lineFromPosition(pscn->position));
+    }
+}
+
+void LogTimestampIndex::modificationsMissed()
+{
+    restartFrom(0);
+}
+
+bool LogTimestampIndex::sampleMore(const QDeadlineTimer &deadline)
+{
+    if (!isEnabled()) {
+        return false;
+    }
+
+    if (!detected) {
+        detectFormat();
+    }
+
+    if (!isLog()) {
+        return false;
+    }
+
+    while (!deadline.hasExpired()) {
+        for (int i = 0; i < 64; ++i) {
+            if (!sampleNext()) {
+                complete = true;
+
+                emit indexChanged();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void LogTimestampIndex::restartFrom(Sci_Position line)
+{
+    // Anything the edit could have moved starts over, along with the format if the first lines changed
+    const Sci_Position slot = (line / SAMPLE_INTERVAL) * SAMPLE_INTERVAL;
+
+    if (slot == 0) {
+        detected = false;
+    }
+    else if (detected && !isLog()) {
+        return;
+    }
+
+    timeSamples.erase(std::partition_point(timeSamples.begin(), timeSamples.end(), [=](const Sample &sample) {
+        return sample.line < slot;
+    }), timeSamples.end());
+
+    nextSampleLine = qMin(slot, nextSampleLine);
+    complete = false;
+
+    JobScheduler *scheduler = JobScheduler::instance();
+    if (!scheduler->isScheduled(this)) {
+        scheduler->schedule(this, JobScheduler::Idle, [=](const QDeadlineTimer &deadline) { return sampleMore(deadline); });
+    }
+}
+
+void LogTimestampIndex::detectFormat()
+{
+    const Sci_Position lines = qMin<Sci_Position>(editor->lineCount(), DETECT_LINES);
+    int counts[ApacheTimestamps + 1] = {};
+    int nonEmptyLines = 0;
+
+    for (Sci_Position line = 0; line < lines; ++line) {
+        const Sci_Position start = editor->positionFromLine(line);
+        const Sci_Position length = qMin<Sci_Position>(editor->lineEndPosition(line) - start, TIMESTAMP_SEARCH_LENGTH);
+
+        if (length == 0)
+            continue;
+
+        const char *text = reinterpret_cast<const char *>(editor->rangePointer(start, length));
+        nonEmptyLines++;
+
+        for (int format = IsoTimestamps; format <= ApacheTimestamps; ++format) {
+            if (parseTimestamp(static_cast<Format>(format), text, length) >= 0) {
+                counts[format]++;
+            }
+        }
+    }
+
+    const int *best = std::max_element(counts + IsoTimestamps, counts + ApacheTimestamps + 1);
+    const bool enough = *best > 0 && *best >= qMin(DETECT_MINIMUM, nonEmptyLines) && *best * 2 >= nonEmptyLines;
+
+    logFormat = enough ? static_cast<Format>(best - counts) : NoTimestamps;
+    detected = true;
+    nextSampleLine = 0;
+    timeSamples.clear();
+}
+
+void LogTimestampIndex::finishSampling()
+{
+    if (!detected) {
+        detectFormat();
+    }
+
+    if (!isLog() || complete)
+        return;
+
+    while (sampleNext()) {
+    }
+
+    JobScheduler::instance()->unschedule(this);
+    complete = true;
+
+    emit indexChanged();
+}
+
+bool LogTimestampIndex::sampleNext()
+{
+    if (nextSampleLine >= editor->lineCount())
+        return false;
+
+    Sci_Position found = -1;
+    const qint64 time = nextTimestamp(nextSampleLine, nextSampleLine + SAMPLE_SEARCH_LINES, &found);
+
+    if (time >= 0) {
+        timeSamples.push_back({found, time});
+    }
+
+    nextSampleLine += SAMPLE_INTERVAL;
+
+    return true;
+}
+
+qint64 LogTimestampIndex::lineTimestamp(Sci_Position line) const
+{
+    const Sci_Position start = editor->positionFromLine(line);
+    const Sci_Position length = qMin<Sci_Position>(editor->lineEndPosition(line) - start, TIMESTAMP_SEARCH_LENGTH);
+
+    if (length <= 0)
+        return -1;
+
+    return parseTimestamp(logFormat, reinterpret_cast<const char *>(editor->rangePointer(start, length)), length);
+}
+
+qint64 LogTimestampIndex::nextTimestamp(Sci_Position line, Sci_Position limit, Sci_Position *foundLine) const
+{
+    limit = qMin<Sci_Position>(limit, editor->lineCount());
+
+    for (; line < limit; ++line) {
+        const qint64 time = lineTimestamp(line);
+
+        if (time >= 0) {
+            *foundLine = line;
+            return time;
+        }
+    }
+
+    return -1;
+}
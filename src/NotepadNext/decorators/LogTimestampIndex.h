@@ -0,0 +1,100 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOGTIMESTAMPINDEX_H
+#define LOGTIMESTAMPINDEX_H
+
+#include <vector>
+
+#include "EditorDecorator.h"
+
+class QDeadlineTimer;
+
+
+// Finds out whether a document is a log file by looking for a timestamp at the start of its first lines. If
+// it is, this keeps a sparse index of the time of one line in every SAMPLE_INTERVAL, built in small slices
+// while the application is idle. Finding the line for a time is a binary search of the samples and then of
+// the lines between two of them, so no query ever has to look at more than a handful of lines.
+//
+// Timestamps are compared as they are written, time zones are ignored. Formats without a year (syslog) are
+// all taken to be in the same year.
+class LogTimestampIndex : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        NoTimestamps,
+        IsoTimestamps,      // 2024-01-31 13:45:00.123, 2024-01-31T13:45:00Z, 2024/01/31 13:45:00
+        SyslogTimestamps,   // Jan 31 13:45:00
+        ApacheTimestamps    // 127.0.0.1 - - [31/Jan/2024:13:45:00 +0000]
+    };
+
+    struct Sample {
+        Sci_Position line;
+        qint64 time;
+    };
+
+    static const int SAMPLE_INTERVAL = 256;
+
+    explicit LogTimestampIndex(ScintillaNext *editor);
+
+    static LogTimestampIndex *forEditor(ScintillaNext *editor);
+
+    Format format() const { return logFormat; }
+    bool isLog() const { return logFormat != NoTimestamps; }
+    bool isComplete() const { return complete; }
+    const std::vector<Sample> &samples() const { return timeSamples; }
+
+    // Times are milliseconds counted the same way for every format, -1 if the text isn't understood. Besides
+    // the log's own format a date and time such as "2024-01-31 13:45" or just a time of the first day works.
+    qint64 parseTime(const QString &text) const;
+    QString formatTime(qint64 time) const;
+
+    // The time of a line, or of the closest line before it that has one. -1 if there is none.
+    qint64 timeOfLine(Sci_Position line) const;
+
+    // The first line stamped at or after time, or -1 if every line is earlier
+    Sci_Position lineAtOrAfter(qint64 time);
+
+public slots:
+    void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+signals:
+    void indexChanged();
+
+private:
+    bool sampleMore(const QDeadlineTimer &deadline);
+    void restartFrom(Sci_Position line);
+    void detectFormat();
+    void finishSampling();
+    bool sampleNext();
+
+    qint64 lineTimestamp(Sci_Position line) const;
+    qint64 nextTimestamp(Sci_Position line, Sci_Position limit, Sci_Position *foundLine) const;
+
+    Format logFormat = NoTimestamps;
+    std::vector<Sample> timeSamples;
+    Sci_Position nextSampleLine = 0;
+    bool complete = false;
+    bool detected = false;
+};
+
+#endif // LOGTIMESTAMPINDEX_H
@@ -0,0 +1,160 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "NotificationDispatcher.h"
+#include "EditorDecorator.h"
+#include "LatencyMonitor.h"
+
+using namespace Scintilla;
+
+
+NotificationDispatcher *NotificationDispatcher::forEditor(ScintillaNext *editor)
+{
+    NotificationDispatcher *dispatcher = editor->findChild<NotificationDispatcher *>(QString(), Qt::FindDirectChildrenOnly);
+
+    if (dispatcher == Q_NULLPTR) {
+        dispatcher = new NotificationDispatcher(editor);
+    }
+
+    return dispatcher;
+}
+
+NotificationDispatcher::NotificationDispatcher(ScintillaNext *editor) :
+    QObject(editor),
+    editor(editor)
+{
+    setObjectName("NotificationDispatcher");
+
+    connect(editor, &ScintillaNext::notify, this, &NotificationDispatcher::dispatch);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &NotificationDispatcher::modificationsResumed);
+}
+
+void NotificationDispatcher::subscribe(EditorDecorator *decorator, const QSet<int> &codes, ModificationFlags modifications)
+{
+    bool found = false;
+
+    for (Subscription &subscription : subscriptions) {
+        if (subscription.decorator == decorator) {
+            subscription.codes = codes;
+            subscription.modifications = modifications;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        subscriptions.append({decorator, codes, modifications});
+    }
+
+    subscriptionsChanged();
+}
+
+void NotificationDispatcher::unsubscribe(EditorDecorator *decorator)
+{
+    for (int i = subscriptions.size() - 1; i >= 0; --i) {
+        if (subscriptions[i].decorator.isNull() || subscriptions[i].decorator == decorator) {
+            subscriptions.removeAt(i);
+        }
+    }
+
+    subscriptionsChanged();
+}
+
+void NotificationDispatcher::subscriptionsChanged()
+{
+    subscribersByCode.clear();
+
+    ModificationFlags modifications = ModificationFlags::None;
+
+    for (const Subscription &subscription : qAsConst(subscriptions)) {
+        if (subscription.codes.isEmpty() || subscription.codes.contains(static_cast<int>(Notification::Modified))) {
+            modifications = modifications | subscription.modifications;
+        }
+    }
+
+    editor->setModificationsNeeded(this, modifications);
+}
+
+const QVector<QPointer<EditorDecorator>> &NotificationDispatcher::subscribersFor(Notification code)
+{
+    auto it = subscribersByCode.find(static_cast<int>(code));
+
+    if (it == subscribersByCode.end()) {
+        QVector<QPointer<EditorDecorator>> subscribers;
+
+        for (const Subscription &subscription : qAsConst(subscriptions)) {
+            if (subscription.codes.isEmpty() || subscription.codes.contains(static_cast<int>(code))) {
+                subscribers.append(subscription.decorator);
+            }
+        }
+
+        it = subscribersByCode.insert(static_cast<int>(code), subscribers);
+    }
+
+    return it.value();
+}
+
+void NotificationDispatcher::dispatch(const NotificationData *pscn)
+{
+    // A copy, since any of them could subscribe or unsubscribe something while handling it
+    const QVector<QPointer<EditorDecorator>> subscribers = subscribersFor(pscn->nmhdr.code);
+
+    for (const QPointer<EditorDecorator> &decorator : subscribers) {
+        if (decorator.isNull()) {
+            continue;
+        }
+
+        if (pscn->nmhdr.code == Notification::Modified) {
+            ModificationFlags modifications = ModificationFlags::None;
+
+            for (const Subscription &subscription : qAsConst(subscriptions)) {
+                if (subscription.decorator == decorator) {
+                    modifications = subscription.modifications;
+                    break;
+                }
+            }
+
+            if (!FlagSet(pscn->modificationType, modifications)) {
+                continue;
+            }
+        }
+
+        if (LatencyMonitor::isRecording()) {
+            const qint64 start = LatencyMonitor::nowMicroseconds();
+            decorator->notify(pscn);
+
+            if (decorator) {
+                LatencyMonitor::record(QByteArrayLiteral("Notify: ") + decorator->metaObject()->className(), LatencyMonitor::nowMicroseconds() - start);
+            }
+        }
+        else {
+            decorator->notify(pscn);
+        }
+    }
+}
+
+void NotificationDispatcher::modificationsResumed()
+{
+    const QVector<QPointer<EditorDecorator>> subscribers = subscribersFor(Notification::Modified);
+
+    for (const QPointer<EditorDecorator> &decorator : subscribers) {
+        if (!decorator.isNull()) {
+            decorator->modificationsMissed();
+        }
+    }
+}
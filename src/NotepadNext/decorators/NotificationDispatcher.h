@@ -0,0 +1,78 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NOTIFICATIONDISPATCHER_H
+#define NOTIFICATIONDISPATCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QVector>
+
+#include "ScintillaTypes.h"
+
+class EditorDecorator;
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+
+// Takes every notification of an editor and hands it on to only the decorators that asked for that kind,
+// rather than every decorator being connected to the editor and filtering them all out itself. Modified
+// notifications can also be narrowed down by their modification flags. The decorators are called in the
+// order they subscribed. Only the modifications some decorator wants are asked of the editor at all, and
+// the decorators are told if they missed any while modification events were suspended. There is one per editor, use NotificationDispatcher::forEditor() to get it.
+class NotificationDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static NotificationDispatcher *forEditor(ScintillaNext *editor);
+
+    // No codes means every notification. Subscribing again replaces what the decorator asked for before.
+    void subscribe(EditorDecorator *decorator, const QSet<int> &codes, Scintilla::ModificationFlags modifications);
+    void unsubscribe(EditorDecorator *decorator);
+
+private slots:
+    void dispatch(const Scintilla::NotificationData *pscn);
+    void modificationsResumed();
+
+private:
+    explicit NotificationDispatcher(ScintillaNext *editor);
+
+    const QVector<QPointer<EditorDecorator>> &subscribersFor(Scintilla::Notification code);
+    void subscriptionsChanged();
+
+    struct Subscription {
+        QPointer<EditorDecorator> decorator;
+        QSet<int> codes;
+        Scintilla::ModificationFlags modifications;
+    };
+
+    ScintillaNext *editor;
+    QVector<Subscription> subscriptions;
+
+    // Worked out from the subscriptions the first time each code is seen
+    QHash<int, QVector<QPointer<EditorDecorator>>> subscribersByCode;
+};
+
+#endif // NOTIFICATIONDISPATCHER_H
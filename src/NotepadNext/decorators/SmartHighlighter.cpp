@@ -17,14 +17,24 @@
  */
 
 
+#include <QDeadlineTimer>
+
+#include "JobScheduler.h"
+#include "MatchIndex.h"
 #include "SmartHighlighter.h"
 
 using namespace Scintilla;
 
 
+// The rest of the document is searched in pieces of about this size while the application is idle
+const int CHUNK_SIZE = 1024 * 256;
+
 SmartHighlighter::SmartHighlighter(ScintillaNext *editor) :
-    EditorDecorator(editor)
+    EditorDecorator(editor),
+    matchIndex(MatchIndex::forEditor(editor))
 {
+    setNotifications({Notification::UpdateUI, Notification::Modified}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
     setObjectName("SmartHighlighter");
 
     indicator = editor->allocateIndicator("smart_highlighter");
@@ -34,22 +44,43 @@ SmartHighlighter::SmartHighlighter(ScintillaNext *editor) :
     editor->indicSetOutlineAlpha(indicator, 150);
     editor->indicSetAlpha(indicator, 100);
     editor->indicSetUnder(indicator, true);
+
+    // A common word can be all over the document, only the ones near the screen need to be in the indicator
+    matchIndex->setRangeSource(indicator);
 }
 
 void SmartHighlighter::notify(const NotificationData *pscn)
 {
-    if (pscn->nmhdr.code == Notification::UpdateUI && (FlagSet(pscn->updated, Update::Content) || FlagSet(pscn->updated, Update::Selection))) {
-        highlightCurrentView();
+    if (pscn->nmhdr.code == Notification::UpdateUI) {
+        if (FlagSet(pscn->updated, Update::Content) || FlagSet(pscn->updated, Update::Selection)) {
+            updateWord();
+        }
+
+        if (FlagSet(pscn->updated, Update::Content) || FlagSet(pscn->updated, Update::Selection) || FlagSet(pscn->updated, Update::VScroll)) {
+            highlightVisibleRanges();
+        }
+    }
+    else if (pscn->nmhdr.code == Notification::Modified) {
+        if (FlagSet(pscn->modificationType, ModificationFlags::InsertText) || FlagSet(pscn->modificationType, ModificationFlags::DeleteText)) {
+            documentChanged(pscn);
+        }
     }
 }
 
-void SmartHighlighter::highlightCurrentView()
+void SmartHighlighter::modificationsMissed()
 {
-    editor->setIndicatorCurrent(indicator);
-    editor->indicatorClearRange(0, editor->length());
+    // Any of it could have gained or lost a match
+    if (!word.isEmpty()) {
+        pending.clear();
+        pending.addAll(editor);
+        highlightVisibleRanges();
+    }
+}
 
+QByteArray SmartHighlighter::selectedWord() const
+{
     if (editor->selectionEmpty()) {
-        return;
+        return QByteArray();
     }
 
     const int mainSelection = editor->mainSelection();
@@ -58,7 +89,7 @@ void SmartHighlighter::highlightCurrentView()
 
     // Make sure the current selection is valid
     if (selectionStart == selectionEnd) {
-        return;
+        return QByteArray();
     }
 
     const int curPos = editor->currentPos();
@@ -67,28 +98,76 @@ void SmartHighlighter::highlightCurrentView()
 
     // Make sure the selection is on word boundaries
     if (wordStart == wordEnd || wordStart != selectionStart || wordEnd != selectionEnd) {
+        return QByteArray();
+    }
+
+    return editor->get_text_range(selectionStart, selectionEnd);
+}
+
+void SmartHighlighter::updateWord()
+{
+    const QByteArray selection = selectedWord();
+
+    // Same word as before, so only the parts that were edited need another look
+    if (selection == word) {
         return;
     }
 
-    const QByteArray selText = editor->get_text_range(selectionStart, selectionEnd);
+    word = selection;
+    pending.clear();
+    JobScheduler::instance()->unschedule(this);
 
-    // TODO: Handle large files. By default Notepad++ only monitors the text on screen. However,
-    // that will not work when using a highlighted scroll bar. Testing with small files seems to
-    // have minimal impact. For large files, Qt can have a timer set to 0 to do heavier processing.
-    // Using threads seems to be a bit overkill and too burdensome to do it properly.
+    matchIndex->clear(indicator);
 
-    //const int startLine = editor->firstVisibleLine();
-    //const int linesOnScreen = editor->linesOnScreen();
-    //const int startPos = editor->positionFromLine(startLine);
-    //const int endPos = editor->lineEndPosition(startLine + linesOnScreen);
+    if (!word.isEmpty()) {
+        pending.addAll(editor);
+    }
+}
 
+void SmartHighlighter::highlightVisibleRanges()
+{
     // TODO: skip hidden or folded lines?
 
-    Sci_TextToFind ttf {{0, (Sci_PositionCR)editor->length()}, selText.constData(), {-1, -1}};
+    // The lines on screen get done straight away so the user never sees them catch up
+    for (const Sci_CharacterRange &range : pending.takeVisible(editor)) {
+        highlightRange(range);
+    }
+
+    // Anything left over, such as for the scroll bar, is done when there is nothing better to do
+    JobScheduler *scheduler = JobScheduler::instance();
+
+    if (pending.isEmpty()) {
+        scheduler->unschedule(this);
+    }
+    else if (!scheduler->isScheduled(this)) {
+        scheduler->schedule(this, JobScheduler::Background, [=](const QDeadlineTimer &deadline) { return highlightPendingRanges(deadline); });
+    }
+}
+
+bool SmartHighlighter::highlightPendingRanges(const QDeadlineTimer &deadline)
+{
+    if (!isEnabled()) {
+        pending.clear();
+    }
+
+    while (!pending.isEmpty() && !deadline.hasExpired()) {
+        highlightRange(pending.takeNext(editor, CHUNK_SIZE));
+    }
+
+    return !pending.isEmpty();
+}
+
+void SmartHighlighter::highlightRange(const Sci_CharacterRange &range)
+{
     const int flags = SCFIND_MATCHCASE | SCFIND_WHOLEWORD;
 
-    while (editor->send(SCI_FINDTEXT, flags, (sptr_t)&ttf) != -1) {
-        editor->indicatorFillRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax - ttf.chrgText.cpMin);
-        ttf.chrg.cpMin = ttf.chrgText.cpMax;
+    matchIndex->replaceMatches(indicator, range, editor->findAllMatches(word, flags, range));
+}
+
+void SmartHighlighter::documentChanged(const NotificationData *pscn)
+{
+    // Only the lines that were touched can have gained or lost a match
+    if (!word.isEmpty()) {
+        pending.documentModified(editor, pscn);
     }
 }
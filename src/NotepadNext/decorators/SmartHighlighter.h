@@ -21,6 +21,10 @@
 #define SMARTHIGHLIGHTER_H
 
 #include "EditorDecorator.h"
+#include "PendingRanges.h"
+
+class MatchIndex;
+class QDeadlineTimer;
 
 
 class SmartHighlighter : public EditorDecorator
@@ -31,11 +35,23 @@ public:
     SmartHighlighter(ScintillaNext *editor);
 
 private:
-    void highlightCurrentView();
+    bool highlightPendingRanges(const QDeadlineTimer &deadline);
+    QByteArray selectedWord() const;
+    void updateWord();
+    void highlightVisibleRanges();
+    void highlightRange(const Sci_CharacterRange &range);
+    void documentChanged(const Scintilla::NotificationData *pscn);
+
     int indicator;
+    MatchIndex *matchIndex;
+
+    // The word currently being highlighted, and the parts of the document that have not been searched for it yet
+    QByteArray word;
+    PendingRanges pending;
 
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
 };
 
 #endif // SMARTHIGHLIGHTER_H
@@ -0,0 +1,337 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <QDeadlineTimer>
+
+#include "JobScheduler.h"
+#include "MatchIndex.h"
+#include "SpellChecker.h"
+#include "SpellDictionary.h"
+
+#include <cstring>
+
+using namespace Scintilla;
+
+
+// The rest of the document is checked in pieces of about this size while the application is idle
+const int CHUNK_SIZE = 1024 * 128;
+
+// Longer runs of letters are more likely to be encoded data than words
+const int MAX_WORD_LENGTH = 64;
+
+static bool isAsciiLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool isWordByte(char c)
+{
+    // Digits and underscores are taken as part of a word so identifiers are skipped as a whole
+    return isAsciiLetter(c) || (c >= '0' && c <= '9') || c == '_' || c == '\'' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+// Whether some word bytes look like a word worth looking up, rather than an identifier, an acronym or part of a file
+// name, URL or escape sequence. prev, next and afterNext are the bytes around it, or 0.
+static bool isCheckableWord(const char *word, int length, char prev, char next, char afterNext)
+{
+    if (length < 2 || length > MAX_WORD_LENGTH) {
+        return false;
+    }
+
+    if (prev != '\0' && std::strchr("./\\@#$%&~", prev) != Q_NULLPTR) {
+        return false;
+    }
+
+    if (next != '\0' && std::strchr("/\\@(", next) != Q_NULLPTR) {
+        return false;
+    }
+
+    if (next == '.' && isAsciiLetter(afterNext)) {
+        return false;
+    }
+
+    // Only all lower case or capitalized, anything else is camelCase, an acronym and so on
+    for (int i = 0; i < length; ++i) {
+        const char c = word[i];
+
+        if ((c >= '0' && c <= '9') || c == '_') {
+            return false;
+        }
+
+        if (c >= 'A' && c <= 'Z' && i > 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Finds the misspelled words in text that aren't left out by checked, with offset being the position of the first
+// byte. The range [start, end) of text is checked, the bytes either side of it are only looked at.
+template <typename Checked>
+static std::vector<Sci_CharacterRange> findMisspellings(const char *text, int start, int end, int size, Sci_PositionCR offset, Checked checked)
+{
+    const SpellDictionary *dictionary = SpellDictionary::instance();
+    std::vector<Sci_CharacterRange> misspellings;
+
+    int i = start;
+    while (i < end) {
+        if (!isWordByte(text[i]) || !checked(i)) {
+            ++i;
+            continue;
+        }
+
+        int wordEnd = i;
+        while (wordEnd < end && isWordByte(text[wordEnd]) && checked(wordEnd)) {
+            ++wordEnd;
+        }
+
+        // Quotes around a word aren't part of it, nor is a possessive
+        int wordStart = i;
+        while (wordStart < wordEnd && text[wordStart] == '\'') {
+            ++wordStart;
+        }
+
+        int trimmedEnd = wordEnd;
+        while (trimmedEnd > wordStart && text[trimmedEnd - 1] == '\'') {
+            --trimmedEnd;
+        }
+        if (trimmedEnd - wordStart > 2 && text[trimmedEnd - 2] == '\'' && (text[trimmedEnd - 1] == 's' || text[trimmedEnd - 1] == 'S')) {
+            trimmedEnd -= 2;
+        }
+
+        const char prev = i > 0 ? text[i - 1] : '\0';
+        const char next = wordEnd < size ? text[wordEnd] : '\0';
+        const char afterNext = wordEnd + 1 < size ? text[wordEnd + 1] : '\0';
+        const int length = trimmedEnd - wordStart;
+
+        if (isCheckableWord(text + wordStart, length, prev, next, afterNext) && !dictionary->contains(text + wordStart, length)) {
+            misspellings.push_back({offset + wordStart, offset + trimmedEnd});
+        }
+
+        i = wordEnd;
+    }
+
+    return misspellings;
+}
+
+SpellChecker::SpellChecker(ScintillaNext *editor) :
+    EditorDecorator(editor),
+    matchIndex(MatchIndex::forEditor(editor))
+{
+    // Restyling is what turns code into a comment or the other way round, so it has to be checked again
+    setNotifications({Notification::UpdateUI, Notification::Modified, Notification::Zoom},
+                     ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ChangeStyle);
+
+    setObjectName("SpellChecker");
+
+    indicator = editor->allocateIndicator("spell_checker");
+
+    editor->indicSetStyle(indicator, INDIC_SQUIGGLEPIXMAP);
+    editor->indicSetFore(indicator, 0x0000FF);
+
+    // A document full of misspellings shouldn't mean Scintilla keeps a run for every one of them
+    matchIndex->setRangeSource(indicator);
+
+    connect(editor, &ScintillaNext::resized, this, &SpellChecker::checkVisible);
+
+    // The language sets up its styles after the lexer has been changed
+    connect(editor, &ScintillaNext::lexerChanged, this, &SpellChecker::restart, Qt::QueuedConnection);
+
+    // Nothing is checked until the words are there, and all of it is checked again if they change
+    connect(SpellDictionary::instance(), &SpellDictionary::ready, this, &SpellChecker::restart);
+
+    connect(this, &EditorDecorator::stateChanged, this, [=](bool enabled) {
+        if (enabled) {
+            restart();
+        }
+        else {
+            pending.clear();
+            JobScheduler::instance()->unschedule(this);
+            matchIndex->clear(indicator);
+        }
+    });
+}
+
+void SpellChecker::notify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code == Notification::UpdateUI) {
+        if (FlagSet(pscn->updated, Update::Content) || FlagSet(pscn->updated, Update::VScroll)) {
+            checkVisible();
+        }
+    }
+    else if (pscn->nmhdr.code == Notification::Modified) {
+        if (FlagSet(pscn->modificationType, ModificationFlags::ChangeStyle)) {
+            if (!checkEverything) {
+                pending.add({static_cast<Sci_PositionCR>(pscn->position), static_cast<Sci_PositionCR>(pscn->position + pscn->length)});
+            }
+        }
+        else {
+            pending.documentModified(editor, pscn);
+        }
+    }
+    else if (pscn->nmhdr.code == Notification::Zoom) {
+        checkVisible();
+    }
+}
+
+void SpellChecker::modificationsMissed()
+{
+    pending.clear();
+    pending.addAll(editor);
+    checkVisible();
+}
+
+void SpellChecker::restart()
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    pending.clear();
+    JobScheduler::instance()->unschedule(this);
+    matchIndex->clear(indicator);
+
+    SpellDictionary *dictionary = SpellDictionary::instance();
+
+    // This starts loading the words the first time, ready() comes back here once they are there
+    if (!dictionary->isReady() || !dictionary->hasWords()) {
+        return;
+    }
+
+    updateCheckedStyles();
+
+    pending.addAll(editor);
+    checkVisible();
+}
+
+void SpellChecker::updateCheckedStyles()
+{
+    const QByteArray lexer = editor->lexerLanguage();
+
+    checkEverything = lexer.isEmpty() || lexer == "null";
+    checkedStyles.reset();
+
+    if (checkEverything) {
+        return;
+    }
+
+    // Going by the tags of the styles works for any lexer that describes them, the names are for the ones that
+    // only name them. A comment keyword is something like @param, and character literals are rarely words.
+    const int styles = qMin<int>(static_cast<int>(editor->namedStyles()), static_cast<int>(checkedStyles.size()));
+
+    for (int style = 0; style < styles; ++style) {
+        QByteArray description = editor->tagsOfStyle(style);
+        if (description.isEmpty()) {
+            description = editor->nameOfStyle(style).toLower();
+        }
+
+        const bool isText = description.contains("comment") || description.contains("string");
+        const bool isExcluded = description.contains("keyword") || description.contains("character") || description.contains("regex");
+
+        checkedStyles[style] = isText && !isExcluded;
+    }
+}
+
+void SpellChecker::checkVisible()
+{
+    if (!isEnabled() || !SpellDictionary::instance()->hasWords()) {
+        return;
+    }
+
+    // What is on screen is done straight away and everything else is left for when the application is idle
+    for (const Sci_CharacterRange &range : pending.takeVisible(editor)) {
+        checkRange(range);
+    }
+
+    JobScheduler *scheduler = JobScheduler::instance();
+
+    if (pending.isEmpty()) {
+        scheduler->unschedule(this);
+    }
+    else if (!scheduler->isScheduled(this)) {
+        scheduler->schedule(this, JobScheduler::Background, [=](const QDeadlineTimer &deadline) { return checkPending(deadline); });
+    }
+}
+
+bool SpellChecker::checkPending(const QDeadlineTimer &deadline)
+{
+    while (!pending.isEmpty() && !deadline.hasExpired()) {
+        checkRange(pending.takeNext(editor, CHUNK_SIZE));
+    }
+
+    return !pending.isEmpty();
+}
+
+void SpellChecker::checkRange(Sci_CharacterRange range)
+{
+    const Sci_PositionCR length = static_cast<Sci_PositionCR>(editor->length());
+
+    range.cpMax = qMin(range.cpMax, length);
+
+    // A piece of a long line, or of some restyled text, can start or end in the middle of a word
+    while (range.cpMin > 0 && isWordByte(static_cast<char>(editor->charAt(range.cpMin - 1)))) {
+        --range.cpMin;
+    }
+    while (range.cpMax < length && isWordByte(static_cast<char>(editor->charAt(range.cpMax)))) {
+        ++range.cpMax;
+    }
+
+    if (range.cpMin >= range.cpMax) {
+        return;
+    }
+
+    // Include the bytes either side of the range to check what the words are next to
+    const Sci_PositionCR viewStart = qMax<Sci_PositionCR>(0, range.cpMin - 1);
+    const Sci_PositionCR viewEnd = qMin<Sci_PositionCR>(length, range.cpMax + 2);
+    const int size = viewEnd - viewStart;
+    const int start = range.cpMin - viewStart;
+    const int end = range.cpMax - viewStart;
+
+    if (checkEverything) {
+        const char *view = reinterpret_cast<const char *>(editor->rangePointer(viewStart, size));
+
+        matchIndex->replaceMatches(indicator, range, findMisspellings(view, start, end, size, viewStart, [](int) { return true; }));
+        return;
+    }
+
+    // Text that hasn't been styled yet is the default style, which is never checked. Styling it as a comment or
+    // string comes back here through the style change.
+    QByteArray styled(2 * size + 2, '\0');
+    Sci_TextRangeFull tr;
+    tr.chrg.cpMin = viewStart;
+    tr.chrg.cpMax = viewEnd;
+    tr.lpstrText = styled.data();
+    editor->send(SCI_GETSTYLEDTEXTFULL, 0, reinterpret_cast<sptr_t>(&tr));
+
+    QByteArray text(size, '\0');
+    QByteArray styles(size, '\0');
+
+    const char *src = styled.constData();
+    char *textData = text.data();
+    char *styleData = styles.data();
+    for (int i = 0; i < size; ++i) {
+        textData[i] = src[2 * i];
+        styleData[i] = src[2 * i + 1];
+    }
+
+    matchIndex->replaceMatches(indicator, range, findMisspellings(text.constData(), start, end, size, viewStart, [&](int i) {
+        return checkedStyles[static_cast<unsigned char>(styleData[i])];
+    }));
+}
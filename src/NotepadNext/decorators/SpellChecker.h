@@ -0,0 +1,66 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SPELLCHECKER_H
+#define SPELLCHECKER_H
+
+#include "EditorDecorator.h"
+#include "PendingRanges.h"
+
+#include <bitset>
+
+class MatchIndex;
+class QDeadlineTimer;
+
+// Underlines the misspelled words in comments and strings, or anywhere in plain text. What counts as a comment or
+// string goes by the tags the lexer gives its styles, so text is only checked once it has been styled. The document
+// is checked in the background a piece at a time, after that only the lines that are edited or restyled are checked
+// again. Only the misspellings on and around the screen are ever put in the indicator.
+class SpellChecker : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    explicit SpellChecker(ScintillaNext *editor);
+
+public slots:
+    void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+private slots:
+    void restart();
+    void checkVisible();
+
+private:
+    void updateCheckedStyles();
+    bool checkPending(const QDeadlineTimer &deadline);
+    void checkRange(Sci_CharacterRange range);
+
+    MatchIndex *matchIndex;
+    int indicator;
+
+    // The parts of the document that have not been checked since they were loaded, changed or restyled
+    PendingRanges pending;
+
+    // Plain text has no styles to go by, so all of it is checked
+    bool checkEverything = false;
+    std::bitset<256> checkedStyles;
+};
+
+#endif // SPELLCHECKER_H
@@ -18,14 +18,20 @@
 
 
 #include "SurroundSelection.h"
+#include "BulkEdit.h"
 
 #include <QEvent>
 #include <QKeyEvent>
 
+#include <algorithm>
+
 
 SurroundSelection::SurroundSelection(ScintillaNext *editor) :
     EditorDecorator(editor)
 {
+    // Everything is done through the event filter
+    setNotifications({});
+
     setObjectName("SurroundSelection");
 
     editor->installEventFilter(this);
@@ -75,44 +81,60 @@ void SurroundSelection::notify(const Scintilla::NotificationData *pscn)
 
 void SurroundSelection::surroundSelections(const char ch1, const char ch2)
 {
-    std::vector<std::pair<int, int>> selections;
+    const int num = editor->selections();
+    const int mainSelection = editor->mainSelection();
+
+    // Each selection and whether it is the main one
+    std::vector<std::pair<Sci_CharacterRange, bool>> selections;
+    selections.reserve(num);
 
-    int num = editor->selections();
     for (int i = 0; i < num; ++i) {
-        int start = editor->selectionNStart(i);
-        int end = editor->selectionNEnd(i);
+        const Sci_PositionCR start = editor->selectionNStart(i);
+        const Sci_PositionCR end = editor->selectionNEnd(i);
 
         if (start != end /* && editor.LineFromPosition(start) == editor.LineFromPosition(end) */)
-            selections.push_back(std::make_pair(start, end));
+            selections.push_back(std::make_pair(Sci_CharacterRange{start, end}, i == mainSelection));
     }
 
-    // Sort so they are replaced top to bottom
-    std::sort(selections.begin(), selections.end());
-
-    editor->beginUndoAction();
-    editor->clearSelections();
+    if (selections.empty())
+        return;
 
-    int offset = 0;
-    for (size_t i = 0; i < selections.size(); ++i) {
-        const auto &selection = selections[i];
-        editor->setTargetRange(selection.first + offset, selection.second + offset);
+    // Sort so they are replaced top to bottom
+    std::sort(selections.begin(), selections.end(), [](const auto &a, const auto &b) { return a.first.cpMin < b.first.cpMin; });
 
-        QByteArray target = editor->targetText();
+    // Only the characters either side are inserted, the selected text is left where it is. Every one of them goes in
+    // as a single edit however many selections there are, e.g. after selecting every occurrence of something.
+    std::vector<Sci_CharacterRange> insertions;
+    insertions.reserve(selections.size() * 2);
+    std::vector<Sci_CharacterRange> surrounded;
+    surrounded.reserve(selections.size());
+    int newMainSelection = 0;
 
-        // Add in the characters
-        target.push_front(ch1);
-        target.push_back(ch2);
+    Sci_PositionCR offset = 0;
+    for (const auto &selection : selections) {
+        const Sci_CharacterRange &range = selection.first;
 
-        editor->replaceTarget(target.length(), target.data());
+        insertions.push_back({range.cpMin, range.cpMin});
+        insertions.push_back({range.cpMax, range.cpMax});
 
         // leave cursor at end of insertion
-        if (i == 0)
-            editor->setSelection(selection.second + offset + 1, selection.first + offset + 1);
-        else
-            editor->addSelection(selection.second + offset + 1, selection.first + offset + 1);
+        if (selection.second)
+            newMainSelection = static_cast<int>(surrounded.size());
+        surrounded.push_back({range.cpMin + offset + 1, range.cpMax + offset + 1});
 
-        offset += 2; // Add 2 since the replaced string is 2 chars longer
+        offset += 2; // Add 2 since the surrounded string is 2 chars longer
+    }
+
+    QVector<QByteArray> replacements;
+    replacements.reserve(static_cast<int>(insertions.size()));
+    const QByteArray opening(1, ch1);
+    const QByteArray closing(1, ch2);
+    for (size_t i = 0; i < selections.size(); ++i) {
+        replacements.append(opening);
+        replacements.append(closing);
     }
 
-    editor->endUndoAction();
+    const BulkEdit be(editor);
+    editor->replaceRanges(insertions, replacements);
+    editor->selectRanges(surrounded, newMainSelection);
 }
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TrailingWhitespaceTrimmer.h"
+#include "BulkEdit.h"
+
+#include <vector>
+
+using namespace Scintilla;
+
+
+// Adds the spaces and tabs at the end of each line of text to ranges. The text has to start at the beginning of a
+// line and end at the end of one.
+static void findTrailingWhitespace(const char *text, Sci_PositionCR length, Sci_PositionCR offset, std::vector<Sci_CharacterRange> &ranges)
+{
+    Sci_PositionCR whitespaceStart = -1;
+
+    for (Sci_PositionCR i = 0; i < length; ++i) {
+        const char c = text[i];
+
+        if (c == ' ' || c == '\t') {
+            if (whitespaceStart < 0)
+                whitespaceStart = i;
+        }
+        else {
+            if (whitespaceStart >= 0 && (c == '\r' || c == '\n'))
+                ranges.push_back({offset + whitespaceStart, offset + i});
+
+            whitespaceStart = -1;
+        }
+    }
+
+    if (whitespaceStart >= 0)
+        ranges.push_back({offset + whitespaceStart, offset + length});
+}
+
+TrailingWhitespaceTrimmer::TrailingWhitespaceTrimmer(ScintillaNext *editor) :
+    EditorDecorator(editor)
+{
+    setNotifications({Notification::Modified}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    setObjectName("TrailingWhitespaceTrimmer");
+}
+
+void TrailingWhitespaceTrimmer::trim()
+{
+    const Sci_PositionCR length = static_cast<Sci_PositionCR>(editor->length());
+    std::vector<Sci_CharacterRange> whitespace;
+
+    if (wholeDocument) {
+        const char *text = reinterpret_cast<const char *>(editor->characterPointer());
+        findTrailingWhitespace(text, length, 0, whitespace);
+    }
+    else {
+        Sci_PositionCR scanned = 0;
+
+        for (const Sci_CharacterRange &range : dirty.take({0, length})) {
+            // Each range is made of whole lines, the last one might have been cut short by a later edit
+            const Sci_PositionCR start = static_cast<Sci_PositionCR>(editor->positionFromLine(editor->lineFromPosition(range.cpMin)));
+            const Sci_PositionCR end = static_cast<Sci_PositionCR>(editor->lineEndPosition(editor->lineFromPosition(range.cpMax)));
+
+            // Ranges that were next to each other can overlap once they are extended to whole lines
+            const Sci_PositionCR from = qMax(start, scanned);
+            if (from >= end) {
+                continue;
+            }
+
+            const char *text = reinterpret_cast<const char *>(editor->rangePointer(from, end - from));
+            findTrailingWhitespace(text, end - from, from, whitespace);
+            scanned = end;
+        }
+    }
+
+    if (!whitespace.empty()) {
+        // One undo action however many lines it touches
+        BulkEdit be(editor);
+        editor->replaceRanges(whitespace, QByteArray());
+    }
+
+    // Everything has been looked at now, only what is edited from here on needs to be again
+    dirty.clear();
+    wholeDocument = false;
+}
+
+void TrailingWhitespaceTrimmer::notify(const NotificationData *pscn)
+{
+    if (!wholeDocument) {
+        dirty.documentModified(editor, pscn);
+    }
+}
+
+void TrailingWhitespaceTrimmer::modificationsMissed()
+{
+    wholeDocument = true;
+    dirty.clear();
+}
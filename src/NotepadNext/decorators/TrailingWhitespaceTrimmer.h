@@ -0,0 +1,47 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TRAILINGWHITESPACETRIMMER_H
+#define TRAILINGWHITESPACETRIMMER_H
+
+#include "EditorDecorator.h"
+#include "PendingRanges.h"
+
+
+// Removes the spaces and tabs at the end of lines. It keeps track of the lines that were edited since it last ran, so
+// after the first time only those get looked at, rather than the whole document on every save.
+class TrailingWhitespaceTrimmer : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    explicit TrailingWhitespaceTrimmer(ScintillaNext *editor);
+
+public slots:
+    void trim();
+
+    void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+private:
+    PendingRanges dirty;
+    bool wholeDocument = true; // nothing is known about the lines that haven't been edited yet
+};
+
+#endif // TRAILINGWHITESPACETRIMMER_H
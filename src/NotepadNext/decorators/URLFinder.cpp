@@ -16,17 +16,127 @@
  * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <QDeadlineTimer>
 #include <QDesktopServices>
-#include <QTimer>
 #include <QUrl>
 
+#include <cstring>
+
+#include "JobScheduler.h"
+#include "MatchIndex.h"
 #include "URLFinder.h"
 
 
+// The rest of the document is scanned in pieces of about this size while the application is idle
+const int CHUNK_SIZE = 1024 * 1024;
+
+// These follow the character classes of the expression that was used to find URLs with Scintilla, i.e.
+// \bhttps?://[-a-zA-Z0-9@:%._\+~#=]{1,256}\.[a-zA-Z0-9()]{1,6}\b(?:[-a-zA-Z0-9()@:%_\+.~#?&\/=]*)
+static bool isAsciiAlphanumeric(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static bool isWordCharacter(char c)
+{
+    return isAsciiAlphanumeric(c) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+static bool isHostCharacter(char c)
+{
+    return isAsciiAlphanumeric(c) || (c != '\0' && std::strchr("-@:%._+~#=", c) != Q_NULLPTR);
+}
+
+static bool isPathCharacter(char c)
+{
+    return isAsciiAlphanumeric(c) || (c != '\0' && std::strchr("-()@:%_+.~#?&/=", c) != Q_NULLPTR);
+}
+
+// Finds the URLs that start within [start, end) of text. Rather than trying every position, it jumps
+// from one "://" to the next and only then looks back for the scheme.
+static std::vector<Sci_CharacterRange> findURLsInText(const char *text, int start, int end, Sci_PositionCR offset)
+{
+    std::vector<Sci_CharacterRange> urls;
+    int pos = start;
+
+    while (pos < end) {
+        const char *colon = static_cast<const char *>(std::memchr(text + pos, ':', end - pos));
+        if (colon == Q_NULLPTR) {
+            break;
+        }
+
+        const int separator = static_cast<int>(colon - text);
+        pos = separator + 1;
+
+        if (separator + 3 > end || text[separator + 1] != '/' || text[separator + 2] != '/') {
+            continue;
+        }
+
+        int schemeStart;
+        if (separator - 5 >= start && qstrnicmp(text + separator - 5, "https", 5) == 0) {
+            schemeStart = separator - 5;
+        }
+        else if (separator - 4 >= start && qstrnicmp(text + separator - 4, "http", 4) == 0) {
+            schemeStart = separator - 4;
+        }
+        else {
+            continue;
+        }
+
+        // The byte before start (if there is one) is only there to check this
+        if (schemeStart > 0 && isWordCharacter(text[schemeStart - 1])) {
+            continue;
+        }
+
+        // The host needs a dot somewhere after its first character, followed by the start of a top level domain
+        const int hostStart = separator + 3;
+        bool hasDomain = false;
+
+        for (int i = hostStart; i < end && i - hostStart <= 256 && isHostCharacter(text[i]); ++i) {
+            if (text[i] == '.' && i > hostStart && i + 1 < end && isAsciiAlphanumeric(text[i + 1])) {
+                hasDomain = true;
+                break;
+            }
+        }
+
+        if (!hasDomain) {
+            continue;
+        }
+
+        int urlEnd = hostStart;
+        while (urlEnd < end && isPathCharacter(text[urlEnd])) {
+            ++urlEnd;
+        }
+
+        // Though technically certain characters are allowed in the URL such as brackets, parenthesis, etc
+        // this adds a bit of logic to trim off the end character based on if something is in front if it, for example
+        // [https://example.com] probably shouldn't include the last bracket since it starts with an opening bracket.
+        if (schemeStart > 0) {
+            const char prevChar = text[schemeStart - 1];
+            const char lastChar = text[urlEnd - 1];
+
+            if ((prevChar == '(' && lastChar == ')') ||
+                (prevChar == '[' && lastChar == ']') ||
+                (prevChar == '<' && lastChar == '>') ||
+                (prevChar == '"' && lastChar == '"')) {
+                urlEnd--;
+            }
+        }
+
+        urls.push_back({offset + schemeStart, offset + urlEnd});
+        pos = urlEnd;
+    }
+
+    return urls;
+}
+
 URLFinder::URLFinder(ScintillaNext *editor) :
     EditorDecorator(editor),
-    timer(new QTimer(this))
+    matchIndex(MatchIndex::forEditor(editor))
 {
+    setNotifications({Scintilla::Notification::UpdateUI, Scintilla::Notification::Modified, Scintilla::Notification::Zoom, Scintilla::Notification::IndicatorClick},
+                     Scintilla::ModificationFlags::InsertText | Scintilla::ModificationFlags::DeleteText);
+
     // Setup the indicator
     indicator = editor->allocateIndicator("url_finder");
 
@@ -36,71 +146,73 @@ URLFinder::URLFinder(ScintillaNext *editor) :
     editor->indicSetHoverStyle(indicator, INDIC_DOTS);
     editor->indicSetHoverFore(indicator, 0xFF0000);
 
-    // Resizing the window could reveal more text
-    connect(editor, &ScintillaNext::resized, timer, qOverload<>(&QTimer::start));
+    // Clicking and copying a URL only ever happens on screen, so that is all the indicator needs to cover
+    matchIndex->setRangeSource(indicator);
+
+    // Resizing the window could reveal text that has not been scanned yet
+    connect(editor, &ScintillaNext::resized, this, &URLFinder::findVisibleURLs);
 
-    timer->setInterval(200);
-    timer->setSingleShot(true);
-    connect(timer, &QTimer::timeout, this, &URLFinder::findURLs);
+    // The whole document gets indexed once, after that only the lines that are edited are scanned again
+    connect(this, &EditorDecorator::stateChanged, this, [=](bool enabled) {
+        pending.clear();
+
+        if (enabled) {
+            pending.addAll(editor);
+            findVisibleURLs();
+        }
+        else {
+            JobScheduler::instance()->unschedule(this);
+            matchIndex->clear(indicator);
+        }
+    });
 }
 
-void URLFinder::findURLs()
+void URLFinder::modificationsMissed()
 {
-    //qInfo(Q_FUNC_INFO);
+    pending.clear();
+    pending.addAll(editor);
+    findVisibleURLs();
+}
 
-    editor->setIndicatorCurrent(indicator);
-    editor->indicatorClearRange(0, editor->length());
+void URLFinder::findVisibleURLs()
+{
+    // The lines on screen are done straight away and everything else is left for when the application is idle
+    for (const Sci_CharacterRange &range : pending.takeVisible(editor)) {
+        findURLsInRange(range);
+    }
 
-    int currentLine = editor->docLineFromVisible(editor->firstVisibleLine());
-    int linesLeftToProcess = editor->linesOnScreen();
-    const int flags = SCFIND_REGEXP;
+    JobScheduler *scheduler = JobScheduler::instance();
 
-    while(linesLeftToProcess >= 0 && currentLine < editor->lineCount()) {
-        // Should only happen if the line is hidden
-        if (!editor->lineVisible(currentLine)) {
-            currentLine++;
-            continue;
-        }
+    if (pending.isEmpty()) {
+        scheduler->unschedule(this);
+    }
+    else if (!scheduler->isScheduled(this)) {
+        scheduler->schedule(this, JobScheduler::Background, [=](const QDeadlineTimer &deadline) { return findPendingURLs(deadline); });
+    }
+}
 
-        const int startPos = editor->positionFromLine(currentLine);
-        const int endPos = editor->lineEndPosition(currentLine);
-        QByteArray reg = QByteArrayLiteral(R"(\bhttps?://[-a-zA-Z0-9@:%._\+~#=]{1,256}\.[a-zA-Z0-9()]{1,6}\b(?:[-a-zA-Z0-9()@:%_\+.~#?&\/=]*))");
-
-        Sci_TextToFind ttf {{startPos, (Sci_PositionCR)endPos}, reg.constData(), {-1, -1}};
-        while (editor->send(SCI_FINDTEXT, flags, (sptr_t)&ttf) != -1) {
-            const int startUrl = ttf.chrgText.cpMin;
-            int endUrl = ttf.chrgText.cpMax;
-
-            // Though technically certain characters are allowed in the URL such as brackets, parenthesis, etc
-            // this adds a bit of logic to trim off the end character based on if something is in front if it, for example
-            // [https://example.com] probably shouldn't include the last bracket since it starts with an opening bracket.
-            if (startUrl > 0) {
-                const int prevChar = static_cast<int>(editor->charAt(startUrl - 1));
-                const int nextChar = static_cast<int>(editor->charAt(endUrl - 1));
-
-                if ((prevChar == '(' && nextChar == ')') ||
-                    (prevChar == '[' && nextChar == ']') ||
-                    (prevChar == '<' && nextChar == '>') ||
-                    (prevChar == '"' && nextChar == '"')) {
-                    endUrl--;
-                }
-            }
+bool URLFinder::findPendingURLs(const QDeadlineTimer &deadline)
+{
+    while (!pending.isEmpty() && !deadline.hasExpired()) {
+        findURLsInRange(pending.takeNext(editor, CHUNK_SIZE));
+    }
 
-            editor->indicatorFillRange(startUrl, endUrl - startUrl);
-            ttf.chrg.cpMin = endUrl;
-        }
+    return !pending.isEmpty();
+}
 
-        // If a line is wrapped, skip however many lines it takes up on the screen
-        linesLeftToProcess -= editor->wrapCount(currentLine);
+void URLFinder::findURLsInRange(const Sci_CharacterRange &range)
+{
+    const Sci_PositionCR end = qMin<Sci_PositionCR>(range.cpMax, editor->length());
 
-        // If the current line is a fold header and the fold is not expanded, skip
-        if (((editor->foldLevel(currentLine) & SC_FOLDLEVELHEADERFLAG) == SC_FOLDLEVELHEADERFLAG) && (!editor->foldExpanded(currentLine))) {
-            currentLine = editor->lastChild(currentLine, -1) + 1;
-        }
-        else {
-            currentLine++;
-        }
+    if (range.cpMin >= end) {
+        return;
     }
+
+    // Include one byte before the range to check the word boundary
+    const Sci_PositionCR viewStart = qMax<Sci_PositionCR>(0, range.cpMin - 1);
+    const char *view = reinterpret_cast<const char *>(editor->rangePointer(viewStart, end - viewStart));
+
+    matchIndex->replaceMatches(indicator, range, findURLsInText(view, range.cpMin - viewStart, end - viewStart, viewStart));
 }
 
 void URLFinder::notify(const Scintilla::NotificationData *pscn)
@@ -108,19 +220,18 @@ void URLFinder::notify(const Scintilla::NotificationData *pscn)
     // TODO: handle editor folding/unfolding
     // Currently there is no generic notification for this
 
-    // Reprocess any time the content was updated or the editor was vertically scrolled
-    if ((pscn->nmhdr.code == Scintilla::Notification::UpdateUI)) {
-        if (FlagSet(pscn->updated, Scintilla::Update::VScroll)) {
-            timer->start();
+    // The URLs are already known for the whole document, this only makes sure anything that
+    // was just edited or scrolled into view is up to date before it gets painted
+    if (pscn->nmhdr.code == Scintilla::Notification::UpdateUI) {
+        if (FlagSet(pscn->updated, Scintilla::Update::Content) || FlagSet(pscn->updated, Scintilla::Update::VScroll)) {
+            findVisibleURLs();
         }
     }
     else if (pscn->nmhdr.code == Scintilla::Notification::Modified) {
-        if (FlagSet(pscn->modificationType, Scintilla::ModificationFlags::InsertText) || FlagSet(pscn->modificationType, Scintilla::ModificationFlags::DeleteText)) {
-            timer->start();
-        }
+        pending.documentModified(editor, pscn);
     }
     else if (pscn->nmhdr.code == Scintilla::Notification::Zoom) {
-        timer->start();
+        findVisibleURLs();
     }
     else if (pscn->nmhdr.code == Scintilla::Notification::IndicatorClick && FlagSet(pscn->modifiers, Scintilla::KeyMod::Ctrl)) {
         const int indicators = editor->indicatorAllOnFor(pscn->position);
@@ -21,6 +21,10 @@
 #define URLFINDER_H
 
 #include "EditorDecorator.h"
+#include "PendingRanges.h"
+
+class MatchIndex;
+class QDeadlineTimer;
 
 class URLFinder : public EditorDecorator
 {
@@ -32,14 +36,21 @@ public:
     void copyURLToClipboard(int position) const;
 
 private slots:
-    void findURLs();
+    void findVisibleURLs();
 
 public slots:
     void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
 
 private:
-    QTimer *timer;
+    bool findPendingURLs(const QDeadlineTimer &deadline);
+    void findURLsInRange(const Sci_CharacterRange &range);
+
+    MatchIndex *matchIndex;
     int indicator;
+
+    // The parts of the document that have not been scanned since they were loaded or changed
+    PendingRanges pending;
 };
 
 #endif // URLFINDER_H
@@ -0,0 +1,130 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "UndoHistoryLimiter.h"
+
+#include <QTimer>
+
+using namespace Scintilla;
+
+
+// How far over a limit the history can get before it is trimmed back down to it, so it isn't done on every edit
+static const double TRIM_MARGIN = 1.1;
+
+// About what Scintilla keeps for each undo action besides its text, see ScintillaNext::undoUsage()
+static const int ACTION_OVERHEAD = 1 + 2 * sizeof(Sci_Position);
+
+
+UndoHistoryLimiter::UndoHistoryLimiter(ScintillaNext *editor) :
+    EditorDecorator(editor)
+{
+    setObjectName("UndoHistoryLimiter");
+
+    setNotifications({Notification::Modified}, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    // Trimming copies the whole history, so wait for a pause in the editing
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(1000);
+    connect(timer, &QTimer::timeout, this, &UndoHistoryLimiter::trim);
+}
+
+void UndoHistoryLimiter::setLimits(int maxActions, qint64 maxBytes)
+{
+    this->maxActions = maxActions;
+    this->maxBytes = maxBytes;
+
+    measure();
+
+    if (isOverLimit()) {
+        timer->start();
+    }
+}
+
+void UndoHistoryLimiter::notify(const NotificationData *pscn)
+{
+    // Undo and redo move through the history rather than adding to it
+    if (FlagSet(pscn->modificationType, ModificationFlags::Undo) || FlagSet(pscn->modificationType, ModificationFlags::Redo)) {
+        return;
+    }
+
+    if (maxActions <= 0 && maxBytes <= 0) {
+        return;
+    }
+
+    ++estimatedActions;
+    estimatedBytes += pscn->length + ACTION_OVERHEAD;
+
+    if (isOverLimit()) {
+        timer->start();
+    }
+}
+
+void UndoHistoryLimiter::modificationsMissed()
+{
+    measure();
+
+    if (isOverLimit()) {
+        timer->start();
+    }
+}
+
+void UndoHistoryLimiter::trim()
+{
+    // Try again later rather than in the middle of something
+    if (editor->isInBulkEdit()) {
+        timer->start();
+        return;
+    }
+
+    // The estimate may well be too high, e.g. the history could have been emptied
+    measure();
+
+    if (isOverLimit()) {
+        const int dropped = editor->trimUndoHistory(maxActions, maxBytes);
+
+        if (dropped > 0) {
+            qInfo("Dropped the %d oldest undo actions of \"%s\"", dropped, qUtf8Printable(editor->getName()));
+        }
+
+        measure();
+    }
+}
+
+void UndoHistoryLimiter::measure()
+{
+    if (maxActions <= 0 && maxBytes <= 0) {
+        estimatedActions = 0;
+        estimatedBytes = 0;
+        return;
+    }
+
+    // The number of actions is cheap to get, the size means going through all of them
+    estimatedActions = editor->undoActions();
+
+    if (maxBytes > 0) {
+        estimatedBytes = editor->undoUsage().bytes;
+    }
+}
+
+bool UndoHistoryLimiter::isOverLimit() const
+{
+    return (maxActions > 0 && estimatedActions > maxActions * TRIM_MARGIN) ||
+           (maxBytes > 0 && estimatedBytes > maxBytes * TRIM_MARGIN);
+}
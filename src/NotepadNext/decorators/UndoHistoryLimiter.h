@@ -0,0 +1,62 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UNDOHISTORYLIMITER_H
+#define UNDOHISTORYLIMITER_H
+
+#include "EditorDecorator.h"
+
+
+class QTimer;
+
+// Keeps an editor's undo history within a number of actions and a number of bytes by throwing away the oldest
+// operations, see ScintillaNext::trimUndoHistory(). The size is estimated from the edits as they happen and only
+// measured properly when it looks to be over, and it is only trimmed once it is a bit over the limit, so this costs
+// next to nothing while editing.
+class UndoHistoryLimiter : public EditorDecorator
+{
+    Q_OBJECT
+
+public:
+    explicit UndoHistoryLimiter(ScintillaNext *editor);
+
+    // 0 means no limit
+    void setLimits(int maxActions, qint64 maxBytes);
+
+public slots:
+    void notify(const Scintilla::NotificationData *pscn) override;
+    void modificationsMissed() override;
+
+private slots:
+    void trim();
+
+private:
+    void measure();
+    bool isOverLimit() const;
+
+    QTimer *timer;
+    int maxActions = 0;
+    qint64 maxBytes = 0;
+
+    // Only ever over, undoing and saving don't take anything off these
+    int estimatedActions = 0;
+    qint64 estimatedBytes = 0;
+};
+
+#endif // UNDOHISTORYLIMITER_H
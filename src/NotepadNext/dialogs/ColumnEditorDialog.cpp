@@ -18,9 +18,13 @@
 
 
 #include "ColumnEditorDialog.h"
-#include "UndoAction.h"
+#include "BulkEdit.h"
 #include "ui_ColumnEditorDialog.h"
 
+#include <algorithm>
+#include <charconv>
+#include <vector>
+
 
 ColumnEditorDialog::ColumnEditorDialog(MainWindow *parent) :
     QDialog(parent),
@@ -47,15 +51,10 @@ ColumnEditorDialog::ColumnEditorDialog(MainWindow *parent) :
 
     connect(ui->buttonBox, &QDialogButtonBox::accepted, this, [=]() {
         if (ui->gbxText->isChecked() && !ui->txtText->text().isEmpty()) {
-            insertTextStartingAtCurrentColumn([=]() { return ui->txtText->text(); });
+            insertTextStartingAtCurrentColumn(ui->txtText->text().toUtf8());
         }
         else if (ui->gbxNumbers->isChecked()) {
-            int currentValue = ui->sbxStart->value();
-            insertTextStartingAtCurrentColumn([&currentValue, this]() {
-                const QString s = QString::number(currentValue);
-                currentValue += ui->sbxStep->value();
-                return s;
-            });
+            insertNumbersStartingAtCurrentColumn(ui->sbxStart->value(), ui->sbxStep->value());
         }
     });
 
@@ -67,54 +66,226 @@ ColumnEditorDialog::~ColumnEditorDialog()
     delete ui;
 }
 
-void ColumnEditorDialog::insertTextStartingAtCurrentColumn(const std::function<QString ()> &f)
+// The text for each spot, all of it generated up front into one buffer once it is known how many there are
+struct ColumnEditorDialog::Insertions
+{
+    QByteArray text; // the same every time, unless counting
+    bool counting = false;
+    qint64 start = 0;
+    qint64 step = 0;
+
+    QByteArray arena;
+    std::vector<int> offsets;
+
+    void generate(int count)
+    {
+        if (!counting)
+            return;
+
+        offsets.reserve(count + 1);
+        arena.reserve(count * 8);
+
+        char buffer[24];
+        qint64 value = start;
+        for (int i = 0; i < count; ++i) {
+            const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+            offsets.push_back(arena.size());
+            arena.append(buffer, static_cast<int>(result.ptr - buffer));
+            value += step;
+        }
+        offsets.push_back(arena.size());
+    }
+
+    const char *data(int i) const { return counting ? arena.constData() + offsets[i] : text.constData(); }
+    int length(int i) const { return counting ? offsets[i + 1] - offsets[i] : text.length(); }
+    qint64 totalLength(int count) const { return counting ? arena.size() : static_cast<qint64>(text.length()) * count; }
+};
+
+void ColumnEditorDialog::insertTextStartingAtCurrentColumn(const QByteArray &text)
+{
+    Insertions insertions;
+    insertions.text = text;
+
+    insertStartingAtCurrentColumn(insertions);
+}
+
+void ColumnEditorDialog::insertNumbersStartingAtCurrentColumn(qint64 start, qint64 step)
+{
+    Insertions insertions;
+    insertions.counting = true;
+    insertions.start = start;
+    insertions.step = step;
+
+    insertStartingAtCurrentColumn(insertions);
+}
+
+void ColumnEditorDialog::insertStartingAtCurrentColumn(Insertions &insertions)
 {
     ScintillaNext *editor = parent->currentEditor();
 
+    // Each edit replaces [start, end) with some padding followed by the next insertion. The padding makes up
+    // for virtual space, and when that is on a line with nothing but indentation the whole indentation is
+    // redone the same way as Scintilla does, i.e. with tabs if the editor uses them.
+    struct Edit
+    {
+        Sci_Position start;
+        Sci_Position end;
+        int tabs;
+        int spaces;
+    };
+
+    const int tabWidth = qMax(1, editor->tabWidth());
+    const bool useTabs = editor->useTabs();
+    std::vector<Edit> edits;
+
+    auto pad = [&](Sci_Position lineStart, Sci_Position position, bool onlyIndentation, int column, int virtualSpace) -> Edit {
+        if (virtualSpace <= 0)
+            return {position, position, 0, 0};
+
+        if (onlyIndentation) {
+            const int indentation = column + virtualSpace;
+            const int tabs = useTabs ? indentation / tabWidth : 0;
+
+            return {lineStart, position, tabs, indentation - tabs * tabWidth};
+        }
+
+        return {position, position, 0, virtualSpace};
+    };
+
     if (editor->selectionMode() == SC_SEL_STREAM && editor->selections() == 1 && editor->selectionEmpty()) {
-        const int currentPos = editor->selectionNCaret(0);
+        const Sci_Position currentPos = editor->selectionNCaret(0);
 
         // If the cursor is in virtual space, the call to selectionNCaretVirtualSpace will be > 0
         const int currentColumn = editor->column(currentPos) + editor->selectionNCaretVirtualSpace(0);
 
-        const UndoAction ua(editor);
-        for (int line = editor->lineFromPosition(currentPos); line < editor->lineCount(); ++line) {
-            insertTextAtColumn(editor, line, currentColumn, f());
+        const int firstLine = editor->lineFromPosition(currentPos);
+        const int lineCount = editor->lineCount();
+        const Sci_Position viewStart = editor->positionFromLine(firstLine);
+        const Sci_Position viewEnd = editor->length();
+        const char *text = reinterpret_cast<const char *>(editor->rangePointer(viewStart, viewEnd - viewStart));
+
+        edits.reserve(lineCount - firstLine);
+
+        // One pass along each line to the column, counting it the same way as findColumn()
+        Sci_Position lineStart = viewStart;
+        for (int line = firstLine; line < lineCount; ++line) {
+            const Sci_Position nextLineStart = (line + 1 < lineCount) ? editor->positionFromLine(line + 1) : viewEnd;
+            Sci_Position position = lineStart;
+            int column = 0;
+            bool onlyIndentation = true;
+
+            while (column < currentColumn && position < nextLineStart) {
+                const char ch = text[position - viewStart];
+
+                if (ch == '\t') {
+                    const int nextColumn = (column / tabWidth + 1) * tabWidth;
+                    if (nextColumn > currentColumn)
+                        break;
+
+                    column = nextColumn;
+                    ++position;
+                }
+                else if (ch == '\r' || ch == '\n') {
+                    break;
+                }
+                else {
+                    if (ch != ' ')
+                        onlyIndentation = false;
+
+                    // A whole UTF-8 character counts as one column
+                    ++column;
+                    ++position;
+                    while (position < nextLineStart && (static_cast<uchar>(text[position - viewStart]) & 0xC0) == 0x80)
+                        ++position;
+                }
+            }
+
+            const bool atLineEnd = position == nextLineStart || text[position - viewStart] == '\r' || text[position - viewStart] == '\n';
+            const int virtualSpace = atLineEnd ? currentColumn - column : 0;
+
+            edits.push_back(pad(lineStart, position, onlyIndentation, column, virtualSpace));
+
+            lineStart = nextLineStart;
         }
     }
     else/* if (editor->selectionMode() == SC_SEL_RECTANGLE || editor->selections() > 0)*/ {
         const int totalSelections = editor->selections();
 
-        // TODO: sort selections from top to bottom?
+        edits.reserve(totalSelections);
 
-        const UndoAction ua(editor);
-        for(int selection = 0; selection < totalSelections; ++selection) {
-            const int start = editor->selectionNStart(selection) + editor->selectionNStartVirtualSpace(selection);
-            const int end = editor->selectionNEnd(selection) + editor->selectionNEndVirtualSpace(selection);
+        for (int selection = 0; selection < totalSelections; ++selection) {
+            const Sci_Position start = editor->selectionNStart(selection);
+            const Sci_Position end = editor->selectionNEnd(selection);
+            const int virtualSpace = editor->selectionNStartVirtualSpace(selection);
+            const int line = editor->lineFromPosition(start);
+            const Sci_Position lineStart = editor->positionFromLine(line);
+            const bool onlyIndentation = editor->lineIndentPosition(line) == start;
 
-            editor->setTargetRange(start, end);
-            editor->replaceTarget(-1, f().toUtf8().constData());
+            Edit edit = pad(lineStart, start, onlyIndentation, editor->column(start), virtualSpace);
+            edit.end = qMax(edit.end, end);
+            edits.push_back(edit);
         }
+
+        // Numbers go from the top down no matter what order the selections were made in
+        std::sort(edits.begin(), edits.end(), [](const Edit &left, const Edit &right) { return left.start < right.start; });
+        for (size_t i = 1; i < edits.size(); ++i)
+            edits[i].start = qMax(edits[i].start, edits[i - 1].end);
     }
-}
 
-void ColumnEditorDialog::insertTextAtColumn(ScintillaNext *editor, int line, int column, const QString &str)
-{
-    const int lineEndPosition = editor->lineEndPosition(line);
-    const int lineEndColumn = editor->column(lineEndPosition);
+    if (edits.empty())
+        return;
 
-    // If the line does not end past the needed column, then use the left over as virtual space
-    if (lineEndColumn < column) {
-        editor->setTargetRange(lineEndPosition, lineEndPosition);
+    const int count = static_cast<int>(edits.size());
+    insertions.generate(count);
 
-        editor->setTargetStartVirtualSpace(column - lineEndColumn);
-        editor->setTargetEndVirtualSpace(column - lineEndColumn);
+    const Sci_Position spanStart = edits.front().start;
+    const Sci_Position spanEnd = edits.back().end;
+    const char *text = reinterpret_cast<const char *>(editor->rangePointer(spanStart, spanEnd - spanStart));
+
+    qint64 paddingLength = 0;
+    qint64 removedLength = 0;
+    for (const Edit &edit : edits) {
+        paddingLength += edit.tabs + edit.spaces;
+        removedLength += edit.end - edit.start;
     }
-    else {
-        const int pos = editor->findColumn(line, column);
 
-        editor->setTargetRange(pos, pos);
+    QByteArray newText;
+    newText.reserve(static_cast<int>((spanEnd - spanStart) - removedLength + paddingLength + insertions.totalLength(count)));
+
+    // Build the new text for the whole span, noting where each insertion starts so the carets can go there
+    std::vector<Sci_CharacterRange> carets;
+    carets.reserve(edits.size());
+
+    Sci_Position pos = spanStart;
+    for (int i = 0; i < count; ++i) {
+        const Edit &edit = edits[i];
+
+        newText.append(text + (pos - spanStart), static_cast<int>(edit.start - pos));
+        newText.append(edit.tabs, '\t');
+        newText.append(edit.spaces, ' ');
+
+        const Sci_PositionCR caret = static_cast<Sci_PositionCR>(spanStart + newText.size());
+        carets.push_back({caret, caret});
+
+        newText.append(insertions.data(i), insertions.length(i));
+        pos = edit.end;
     }
 
-    editor->replaceTarget(-1, str.toUtf8().constData());
+    const BulkEdit be(editor);
+    const int firstVisibleLine = editor->firstVisibleLine();
+    const bool multipleCarets = editor->selections() > 1 || editor->selectionMode() != SC_SEL_STREAM;
+
+    editor->reserve(newText.size() - (spanEnd - spanStart));
+    editor->setTargetRange(spanStart, spanEnd);
+    editor->replaceTarget(newText.size(), newText.constData());
+
+    // Leave the carets in front of what was inserted, like inserting it at each of them would have
+    if (multipleCarets) {
+        editor->selectRanges(carets, 0);
+    }
+    else {
+        editor->setEmptySelection(carets.front().cpMin);
+    }
+    editor->setFirstVisibleLine(firstVisibleLine);
 }
@@ -35,10 +35,16 @@ public:
     explicit ColumnEditorDialog(MainWindow *parent);
     ~ColumnEditorDialog();
 
-    void insertTextStartingAtCurrentColumn(const std::function <QString (void)>& f);
-    void insertTextAtColumn(ScintillaNext *editor, int line, int column, const QString &str);
+    // Everything below is inserted with a single edit of the document, either the same text at each spot or
+    // numbers counting up (or down) by step
+    void insertTextStartingAtCurrentColumn(const QByteArray &text);
+    void insertNumbersStartingAtCurrentColumn(qint64 start, qint64 step);
 
 private:
+    struct Insertions;
+
+    void insertStartingAtCurrentColumn(Insertions &insertions);
+
     Ui::ColumnEditorDialog *ui;
     MainWindow *parent;
 };
@@ -19,11 +19,29 @@
 
 #include "FindReplaceDialog.h"
 #include "ApplicationSettings.h"
+#include "BackgroundSearcher.h"
+#include "BookMarkDecorator.h"
+#include "BulkEdit.h"
+#include "FileSearcher.h"
+#include "FolderAsWorkspaceDock.h"
+#include "MatchIndex.h"
+#include "MultiMarker.h"
+#include "NotepadNextApplication.h"
+#include "ReplacePreviewDialog.h"
+#include "ReplacePreviewModel.h"
+#include "TrigramIndex.h"
 #include "ui_FindReplaceDialog.h"
 
 #include <QStatusBar>
 #include <QLineEdit>
 #include <QKeyEvent>
+#include <QDir>
+#include <QFile>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPointer>
+
+#include <memory>
 
 #include "ScintillaNext.h"
 #include "MainWindow.h"
@@ -58,6 +76,8 @@ FindReplaceDialog::FindReplaceDialog(ISearchResultsHandler *searchResults, MainW
     tabBar = new QTabBar();
     tabBar->addTab(tr("Find"));
     tabBar->addTab(tr("Replace"));
+    tabBar->addTab(tr("Find in Files"));
+    tabBar->addTab(tr("Mark"));
     tabBar->setExpanding(false);
     qobject_cast<QVBoxLayout *>(layout())->insertWidget(0, tabBar);
     connect(tabBar, &QTabBar::currentChanged, this, &FindReplaceDialog::changeTab);
@@ -66,9 +86,22 @@ FindReplaceDialog::FindReplaceDialog(ISearchResultsHandler *searchResults, MainW
     statusBar->setSizeGripEnabled(false); // the dialog has one already
     qobject_cast<QVBoxLayout *>(layout())->insertWidget(-1, statusBar);
 
+    // Long running searches show their progress and can be canceled from the status bar
+    searchProgress = new QProgressBar();
+    searchProgress->setRange(0, 100);
+    searchProgress->setMaximumWidth(120);
+    searchProgress->hide();
+    statusBar->addPermanentWidget(searchProgress);
+
+    buttonCancelSearch = new QPushButton(tr("Cancel"));
+    buttonCancelSearch->hide();
+    statusBar->addPermanentWidget(buttonCancelSearch);
+
     // Disable auto completion
     ui->comboFind->setCompleter(nullptr);
     ui->comboReplace->setCompleter(nullptr);
+    ui->comboFilters->setCompleter(nullptr);
+    ui->comboDirectory->setCompleter(nullptr);
 
     // If the selection changes highlight the text
     connect(ui->comboFind, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), ui->comboFind->lineEdit(), &QLineEdit::selectAll);
@@ -76,8 +109,13 @@ FindReplaceDialog::FindReplaceDialog(ISearchResultsHandler *searchResults, MainW
 
     // Force focus on the find text box
     connect(this, &FindReplaceDialog::windowActivated, [=]() {
-        ui->comboFind->setFocus();
-        ui->comboFind->lineEdit()->selectAll();
+        if (tabBar->currentIndex() == MARK_TAB) {
+            ui->textMarkTerms->setFocus();
+        }
+        else {
+            ui->comboFind->setFocus();
+            ui->comboFind->lineEdit()->selectAll();
+        }
     });
 
     connect(this, &QDialog::rejected, [=]() {
@@ -97,52 +135,17 @@ FindReplaceDialog::FindReplaceDialog(ISearchResultsHandler *searchResults, MainW
 
     connect(ui->buttonFind, &QPushButton::clicked, this, &FindReplaceDialog::find);
     connect(ui->buttonCount, &QPushButton::clicked, this, &FindReplaceDialog::count);
-    connect(ui->buttonFindAllInCurrent, &QPushButton::clicked, this, [=]() {
-        prepareToPerformSearch();
-
-        searchResultsHandler->newSearch(findString());
-
-        findAllInCurrentDocument();
-
-        searchResultsHandler->completeSearch();
-
-        close();
-    });
-    connect(ui->buttonFindAllInDocuments, &QPushButton::clicked, this, [=]() {
-        prepareToPerformSearch();
-
-        searchResultsHandler->newSearch(findString());
-
-        findAllInDocuments();
-
-        searchResultsHandler->completeSearch();
-
-        close();
-    });
+    connect(ui->buttonFindAllInCurrent, &QPushButton::clicked, this, &FindReplaceDialog::findAllInCurrentDocument);
+    connect(ui->buttonFindAllInDocuments, &QPushButton::clicked, this, &FindReplaceDialog::findAllInDocuments);
+    connect(ui->buttonFindAllInFiles, &QPushButton::clicked, this, &FindReplaceDialog::findAllInFiles);
+    connect(ui->buttonBrowseDirectory, &QToolButton::clicked, this, &FindReplaceDialog::browseForDirectory);
     connect(ui->buttonReplace, &QPushButton::clicked, this, &FindReplaceDialog::replace);
     connect(ui->buttonReplaceAll, &QPushButton::clicked, this, &FindReplaceDialog::replaceAll);
-    connect(ui->buttonReplaceAllInDocuments, &QPushButton::clicked, this, [=]() {
-        prepareToPerformSearch(true);
-
-        QString replaceText = replaceString();
-
-        if (ui->radioExtendedSearch->isChecked()) {
-            convertToExtended(replaceText);
-        }
-
-        int count = 0;
-        ScintillaNext *current_editor = editor;
-        MainWindow *window = qobject_cast<MainWindow *>(parent());
-
-        for(ScintillaNext *editor : window->editors()) {
-            setEditor(editor);
-            count += finder->replaceAll(replaceText);
-        }
-
-        setEditor(current_editor);
-
-        showMessage(tr("Replaced %Ln matches", "", count), "green");
-    });
+    connect(ui->buttonReplaceAllInDocuments, &QPushButton::clicked, this, &FindReplaceDialog::replaceAllInDocuments);
+    connect(ui->buttonReplaceInFiles, &QPushButton::clicked, this, &FindReplaceDialog::replaceInFiles);
+    connect(ui->buttonMarkAll, &QPushButton::clicked, this, &FindReplaceDialog::markAll);
+    connect(ui->buttonLoadMarkTerms, &QPushButton::clicked, this, &FindReplaceDialog::loadMarkTerms);
+    connect(ui->buttonClearMarks, &QPushButton::clicked, this, &FindReplaceDialog::clearMarks);
     connect(ui->buttonClose, &QPushButton::clicked, this, &FindReplaceDialog::close);
 
     loadSettings();
@@ -155,6 +158,11 @@ FindReplaceDialog::FindReplaceDialog(ISearchResultsHandler *searchResults, MainW
 
 FindReplaceDialog::~FindReplaceDialog()
 {
+    if (backgroundSearcher)
+        backgroundSearcher->cancel();
+    if (fileSearcher)
+        fileSearcher->cancel();
+
     delete ui;
     delete finder;
 }
@@ -251,11 +259,154 @@ void FindReplaceDialog::findAllInCurrentDocument()
 {
     qInfo(Q_FUNC_INFO);
 
+    prepareToPerformSearch();
+
+    searchResultsHandler->newSearch(findString());
+
+    if (BackgroundSearcher::canSearch(finder->searchText().toUtf8(), finder->searchFlags())) {
+        startBackgroundSearch({editor}, true);
+    }
+    else {
+        findAllInEditor(editor);
+
+        searchResultsHandler->completeSearch();
+
+        close();
+    }
+}
+
+void FindReplaceDialog::findAllInDocuments()
+{
+    qInfo(Q_FUNC_INFO);
+
+    prepareToPerformSearch();
+
+    searchResultsHandler->newSearch(findString());
+
+    if (BackgroundSearcher::canSearch(finder->searchText().toUtf8(), finder->searchFlags())) {
+        startBackgroundSearch(openEditors(), true);
+    }
+    else {
+        ScintillaNext *current_editor = editor;
+
+        for(ScintillaNext *editor : openEditors()) {
+            findAllInEditor(editor);
+        }
+
+        setEditor(current_editor);
+
+        searchResultsHandler->completeSearch();
+
+        close();
+    }
+}
+
+void FindReplaceDialog::findAllInFiles()
+{
+    qInfo(Q_FUNC_INFO);
+
+    const QString directory = ui->comboDirectory->currentText();
+
+    if (directory.isEmpty() || !QDir(directory).exists()) {
+        showMessage(tr("Invalid directory."), "red");
+        return;
+    }
+
+    prepareToPerformSearch();
+
+    const QByteArray pattern = finder->searchText().toUtf8();
+    const int flags = finder->searchFlags();
+
+    if (pattern.isEmpty() || !FileSearcher::canSearch(pattern, flags)) {
+        showMessage(tr("Invalid search."), "red");
+        return;
+    }
+
+    updateComboList(ui->comboDirectory, directory);
+    if (!ui->comboFilters->currentText().isEmpty())
+        updateComboList(ui->comboFilters, ui->comboFilters->currentText());
+
+    FileSearcher::Options options;
+    options.directory = QDir::cleanPath(directory);
+    options.filters = ui->comboFilters->currentText();
+    options.recursive = ui->checkBoxInSubFolders->isChecked();
+    options.includeHidden = ui->checkBoxInHiddenFolders->isChecked();
+    options.respectGitIgnore = ui->checkBoxFollowGitIgnore->isChecked();
+
+    // Narrows things down when searching inside of the workspace, if its contents are indexed
+    if (FolderAsWorkspaceDock *fawDock = qobject_cast<MainWindow *>(parent())->findChild<FolderAsWorkspaceDock *>())
+        options.trigramIndex = fawDock->contentIndex()->snapshot();
+
+    searchResultsHandler->newSearch(findString());
+
+    // Only one search at a time, anything from a previous one is simply dropped. Its signals may already be queued,
+    // so it is disconnected rather than left to report into this search.
+    if (fileSearcher) {
+        fileSearcher->disconnect();
+        fileSearcher->cancel();
+        fileSearcher->deleteLater();
+    }
+
+    fileSearcher = new FileSearcher(this);
+
+    FileSearcher *searcher = fileSearcher;
+
+    connect(searcher, &FileSearcher::resultsFound, this, [=](const QString &filePath, const QVector<SearchHit> &hits) {
+        searchResultsHandler->newFileEntry(QDir::toNativeSeparators(filePath));
+
+        for (const SearchHit &hit : hits) {
+            searchResultsHandler->newResultsEntry(hit.lineText, hit.lineNumber, hit.startPositionFromBeginning, hit.endPositionFromBeginning);
+        }
+    });
+    connect(searcher, &FileSearcher::progressChanged, this, [=](int filesSearched) {
+        statusBar->showMessage(tr("Searched %Ln files", "", filesSearched));
+    });
+    connect(searcher, &FileSearcher::finished, this, [=](int totalHits, int filesSearched, bool canceled) {
+        if (fileSearcher == searcher)
+            fileSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+        searchProgress->setRange(0, 100);
+
+        searchResultsHandler->completeSearch();
+
+        if (canceled) {
+            showMessage(tr("Search canceled, showing the first %Ln matches", "", totalHits), "blue");
+        }
+        else {
+            showMessage(tr("Found %1 in %2").arg(tr("%Ln matches", "", totalHits), tr("%Ln files", "", filesSearched)), "green");
+        }
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &FileSearcher::cancel);
+
+    setSearchInProgress(true);
+
+    // The number of files is not known ahead of time
+    searchProgress->setRange(0, 0);
+
+    searcher->start(options, pattern, flags);
+}
+
+QVector<ScintillaNext *> FindReplaceDialog::openEditors() const
+{
+    MainWindow *window = qobject_cast<MainWindow *>(parent());
+    const QVector<ScintillaNext *> editors = window->editors();
+
+    // Editors restored from a session may not have read their text yet, which would make them look empty
+    for (ScintillaNext *editor : editors) {
+        editor->loadDeferred(false);
+    }
+
+    return editors;
+}
+
+void FindReplaceDialog::findAllInEditor(ScintillaNext *editor)
+{
     bool firstMatch = true;
 
-    QString text = findString();
+    setEditor(editor);
 
-    finder->setSearchText(text);
     finder->forEachMatch([&](int start, int end){
         // Only add the file entry if there was a valid search result
         if (firstMatch) {
@@ -265,30 +416,304 @@ void FindReplaceDialog::findAllInCurrentDocument()
 
         const int line = editor->lineFromPosition(start);
         const int lineStartPosition = editor->positionFromLine(line);
-        const int lineEndPosition = editor->lineEndPosition(line);
         const int startPositionFromBeginning = start - lineStartPosition;
         const int endPositionFromBeginning = end - lineStartPosition;
-        QString lineText = editor->get_text_range(lineStartPosition, lineEndPosition);
 
-        searchResultsHandler->newResultsEntry(lineText, line, startPositionFromBeginning, endPositionFromBeginning);
+        // The line's text is fetched from the editor only when it is displayed
+        searchResultsHandler->newResultsEntry(QString(), line, startPositionFromBeginning, endPositionFromBeginning);
 
         return end;
     });
 }
 
-void FindReplaceDialog::findAllInDocuments()
+void FindReplaceDialog::startBackgroundSearch(const QVector<ScintillaNext *> &editors, bool collectResults)
 {
     qInfo(Q_FUNC_INFO);
 
-    ScintillaNext *current_editor = editor;
-    MainWindow *window = qobject_cast<MainWindow *>(parent());
+    // Only one search at a time, anything from a previous one is simply dropped. Its signals may already be queued,
+    // so it is disconnected rather than left to report into this search.
+    if (backgroundSearcher) {
+        backgroundSearcher->disconnect();
+        backgroundSearcher->cancel();
+        backgroundSearcher->deleteLater();
+    }
 
-    for(ScintillaNext *editor : window->editors()) {
-        setEditor(editor);
-        findAllInCurrentDocument();
+    backgroundSearcher = new BackgroundSearcher(this);
+
+    for (ScintillaNext *editor : editors) {
+        backgroundSearcher->addEditor(editor);
     }
 
-    setEditor(current_editor);
+    BackgroundSearcher *searcher = backgroundSearcher;
+
+    // The file entry is only added once the editor has a result
+    ScintillaNext *lastEditor = Q_NULLPTR;
+
+    connect(searcher, &BackgroundSearcher::resultsFound, this, [=](ScintillaNext *editor, const QVector<SearchHit> &hits) mutable {
+        // The editor was closed while the search was running
+        if (editor == Q_NULLPTR)
+            return;
+
+        if (editor != lastEditor) {
+            searchResultsHandler->newFileEntry(editor);
+            lastEditor = editor;
+        }
+
+        for (const SearchHit &hit : hits) {
+            searchResultsHandler->newResultsEntry(hit.lineText, hit.lineNumber, hit.startPositionFromBeginning, hit.endPositionFromBeginning);
+        }
+    });
+    connect(searcher, &BackgroundSearcher::progressChanged, searchProgress, &QProgressBar::setValue);
+    connect(searcher, &BackgroundSearcher::finished, this, [=](int totalHits, bool canceled) {
+        if (backgroundSearcher == searcher)
+            backgroundSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+
+        if (collectResults) {
+            searchResultsHandler->completeSearch();
+
+            if (canceled) {
+                showMessage(tr("Search canceled, showing the first %Ln matches", "", totalHits), "blue");
+            }
+            else {
+                close();
+            }
+        }
+        else if (canceled) {
+            showMessage(tr("Count canceled after %Ln matches", "", totalHits), "blue");
+        }
+        else {
+            showMessage(tr("Found %Ln matches", "", totalHits), "green");
+        }
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &BackgroundSearcher::cancel);
+
+    setSearchInProgress(true);
+
+    searcher->start(finder->searchText().toUtf8(), finder->searchFlags(), collectResults);
+}
+
+void FindReplaceDialog::startBackgroundReplace(const QVector<ScintillaNext *> &editors, const QString &replaceText)
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (backgroundSearcher) {
+        backgroundSearcher->disconnect();
+        backgroundSearcher->cancel();
+        backgroundSearcher->deleteLater();
+    }
+
+    backgroundSearcher = new BackgroundSearcher(this);
+
+    for (ScintillaNext *editor : editors) {
+        backgroundSearcher->addEditor(editor);
+    }
+
+    BackgroundSearcher *searcher = backgroundSearcher;
+    std::shared_ptr<int> totalReplaced = std::make_shared<int>(0);
+
+    connect(searcher, &BackgroundSearcher::replacementsFound, this, [=](ScintillaNext *target, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &replacements) {
+        // Nothing more is changed once the replace is canceled or another search has taken over
+        if (target == Q_NULLPTR || backgroundSearcher != searcher || searcher->isCanceled())
+            return;
+
+        if (searcher->isOutdated(target)) {
+            // The document was edited while the replacements were worked out, so they no longer line up with its text
+            ScintillaNext *current_editor = editor;
+
+            setEditor(target);
+            *totalReplaced += finder->replaceAll(replaceText);
+            setEditor(current_editor);
+        }
+        else {
+            const BulkEdit be(target);
+            target->replaceRanges(ranges, replacements);
+
+            *totalReplaced += static_cast<int>(ranges.size());
+        }
+    });
+    connect(searcher, &BackgroundSearcher::progressChanged, searchProgress, &QProgressBar::setValue);
+    connect(searcher, &BackgroundSearcher::finished, this, [=](int, bool canceled) {
+        if (backgroundSearcher == searcher)
+            backgroundSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+
+        if (canceled) {
+            showMessage(tr("Replace canceled after %Ln matches", "", *totalReplaced), "blue");
+        }
+        else {
+            showMessage(tr("Replaced %Ln matches", "", *totalReplaced), "green");
+        }
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &BackgroundSearcher::cancel);
+
+    setSearchInProgress(true);
+
+    searcher->startReplace(finder->searchText().toUtf8(), finder->searchFlags(), replaceText.toUtf8());
+}
+
+ReplacePreviewDialog *FindReplaceDialog::showReplacePreview()
+{
+    ReplacePreviewDialog *preview = new ReplacePreviewDialog(this);
+    preview->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(preview, &ReplacePreviewDialog::applied, this, [=](int replacements, int documents) {
+        showMessage(tr("Replaced %1 in %2").arg(tr("%Ln matches", "", replacements), tr("%Ln documents", "", documents)), "green");
+    });
+
+    // There is no point working out the rest of it once the preview is gone
+    connect(preview, &QDialog::finished, this, [=]() {
+        if (backgroundSearcher)
+            backgroundSearcher->cancel();
+        if (fileSearcher)
+            fileSearcher->cancel();
+    });
+
+    preview->show();
+
+    return preview;
+}
+
+void FindReplaceDialog::startReplacePreview(const QVector<ScintillaNext *> &editors, const QString &replaceText, ReplacePreviewDialog *preview)
+{
+    qInfo(Q_FUNC_INFO);
+
+    const QPointer<ReplacePreviewDialog> dialog = preview;
+
+    // The preview is made from the same bytes the background replace works on
+    if (!BackgroundSearcher::canSearch(finder->searchText().toUtf8(), finder->searchFlags())) {
+        showMessage(tr("This search can not be previewed."), "red");
+
+        if (dialog)
+            dialog->previewFinished(true);
+
+        return;
+    }
+
+    if (backgroundSearcher) {
+        backgroundSearcher->disconnect();
+        backgroundSearcher->cancel();
+        backgroundSearcher->deleteLater();
+    }
+
+    backgroundSearcher = new BackgroundSearcher(this);
+
+    for (ScintillaNext *editor : editors) {
+        backgroundSearcher->addEditor(editor);
+    }
+
+    BackgroundSearcher *searcher = backgroundSearcher;
+
+    connect(searcher, &BackgroundSearcher::replacementsPreviewed, this, [=](ScintillaNext *target, const ReplacePreview &documentPreview) {
+        if (target && dialog)
+            dialog->model()->addEditor(target, documentPreview);
+    });
+    connect(searcher, &BackgroundSearcher::progressChanged, searchProgress, &QProgressBar::setValue);
+    connect(searcher, &BackgroundSearcher::finished, this, [=](int totalHits, bool canceled) {
+        if (backgroundSearcher == searcher)
+            backgroundSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+
+        if (dialog)
+            dialog->previewFinished(canceled);
+
+        showMessage(tr("Previewing %Ln matches", "", totalHits), canceled ? "blue" : "green");
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &BackgroundSearcher::cancel);
+
+    setSearchInProgress(true);
+
+    searcher->startReplace(finder->searchText().toUtf8(), finder->searchFlags(), replaceText.toUtf8(), true);
+}
+
+void FindReplaceDialog::startReplaceInFilesPreview(const FileSearcher::Options &options, const QHash<QString, QPointer<ScintillaNext>> &openFiles, const QString &replaceText)
+{
+    qInfo(Q_FUNC_INFO);
+
+    FileSearcher::Options previewOptions = options;
+    previewOptions.preview = true;
+
+    const QPointer<ReplacePreviewDialog> dialog = showReplacePreview();
+
+    // Open files are previewed from their editor once every file on disk has been
+    std::shared_ptr<QVector<QPointer<ScintillaNext>>> skippedEditors = std::make_shared<QVector<QPointer<ScintillaNext>>>();
+
+    // Only one search at a time, anything from a previous one is simply dropped. Its signals may already be queued,
+    // so it is disconnected rather than left to report into this search.
+    if (fileSearcher) {
+        fileSearcher->disconnect();
+        fileSearcher->cancel();
+        fileSearcher->deleteLater();
+    }
+
+    fileSearcher = new FileSearcher(this);
+
+    FileSearcher *searcher = fileSearcher;
+
+    connect(searcher, &FileSearcher::replacementsPreviewed, this, [=](const QString &filePath, const ReplacePreview &filePreview) {
+        if (dialog)
+            dialog->model()->addFile(filePath, filePreview);
+    });
+    connect(searcher, &FileSearcher::replaceSkipped, this, [=](const QString &filePath) {
+        if (ScintillaNext *target = openFiles.value(filePath))
+            skippedEditors->append(target);
+    });
+    connect(searcher, &FileSearcher::progressChanged, this, [=](int filesSearched) {
+        statusBar->showMessage(tr("Searched %Ln files", "", filesSearched));
+    });
+    connect(searcher, &FileSearcher::finished, this, [=](int, int, bool canceled) {
+        if (fileSearcher == searcher)
+            fileSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+        searchProgress->setRange(0, 100);
+
+        if (dialog.isNull())
+            return;
+
+        // Any of them could have been closed in the meantime
+        QVector<ScintillaNext *> editors;
+        for (ScintillaNext *target : qAsConst(*skippedEditors)) {
+            if (target)
+                editors.append(target);
+        }
+
+        if (canceled || editors.isEmpty())
+            dialog->previewFinished(canceled);
+        else
+            startReplacePreview(editors, replaceText, dialog);
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &FileSearcher::cancel);
+
+    setSearchInProgress(true);
+    searchProgress->setRange(0, 0);
+
+    searcher->start(previewOptions, finder->searchText().toUtf8(), finder->searchFlags());
+}
+
+void FindReplaceDialog::setSearchInProgress(bool inProgress)
+{
+    searchProgress->setValue(0);
+    searchProgress->setVisible(inProgress);
+    buttonCancelSearch->setVisible(inProgress);
+
+    ui->buttonFind->setDisabled(inProgress);
+    ui->buttonCount->setDisabled(inProgress);
+    ui->buttonFindAllInCurrent->setDisabled(inProgress);
+    ui->buttonFindAllInDocuments->setDisabled(inProgress);
+    ui->buttonFindAllInFiles->setDisabled(inProgress);
+    ui->buttonReplace->setDisabled(inProgress);
+    ui->buttonReplaceAll->setDisabled(inProgress);
+    ui->buttonReplaceAllInDocuments->setDisabled(inProgress);
+    ui->buttonReplaceInFiles->setDisabled(inProgress);
+    ui->buttonMarkAll->setDisabled(inProgress);
 }
 
 void FindReplaceDialog::replace()
@@ -333,19 +758,216 @@ void FindReplaceDialog::replaceAll()
         convertToExtended(replaceText);
     }
 
+    if (ui->checkBoxPreviewReplace->isChecked()) {
+        startReplacePreview({editor}, replaceText, showReplacePreview());
+        return;
+    }
+
     int count = finder->replaceAll(replaceText);
     showMessage(tr("Replaced %Ln matches", "", count), "green");
 }
 
+void FindReplaceDialog::replaceAllInDocuments()
+{
+    qInfo(Q_FUNC_INFO);
+
+    prepareToPerformSearch(true);
+
+    QString replaceText = replaceString();
+
+    if (ui->radioExtendedSearch->isChecked()) {
+        convertToExtended(replaceText);
+    }
+
+    if (ui->checkBoxPreviewReplace->isChecked()) {
+        startReplacePreview(openEditors(), replaceText, showReplacePreview());
+        return;
+    }
+
+    // The replacements for every document are worked out at the same time and then applied in one edit each
+    if (BackgroundSearcher::canSearch(finder->searchText().toUtf8(), finder->searchFlags())) {
+        startBackgroundReplace(openEditors(), replaceText);
+        return;
+    }
+
+    int count = 0;
+    ScintillaNext *current_editor = editor;
+
+    for(ScintillaNext *editor : openEditors()) {
+        setEditor(editor);
+        count += finder->replaceAll(replaceText);
+    }
+
+    setEditor(current_editor);
+
+    showMessage(tr("Replaced %Ln matches", "", count), "green");
+}
+
+void FindReplaceDialog::replaceInFiles()
+{
+    qInfo(Q_FUNC_INFO);
+
+    const QString directory = ui->comboDirectory->currentText();
+
+    if (directory.isEmpty() || !QDir(directory).exists()) {
+        showMessage(tr("Invalid directory."), "red");
+        return;
+    }
+
+    prepareToPerformSearch(true);
+
+    const QByteArray pattern = finder->searchText().toUtf8();
+    const int flags = finder->searchFlags();
+
+    if (pattern.isEmpty() || !FileSearcher::canSearch(pattern, flags)) {
+        showMessage(tr("Invalid search."), "red");
+        return;
+    }
+
+    QString replaceText = replaceString();
+
+    if (ui->radioExtendedSearch->isChecked()) {
+        convertToExtended(replaceText);
+    }
+
+    // Files that are not open can't be undone, so give a chance to see what would change first
+    bool preview = ui->checkBoxPreviewReplace->isChecked();
+
+    if (!preview) {
+        QMessageBox confirm(QMessageBox::Question, tr("Replace in Files"), tr("Replace all matches in the files in %1?").arg(QDir::toNativeSeparators(directory)), QMessageBox::Cancel, this);
+        confirm.setInformativeText(tr("Files that are already open are changed in their editor. The changes made to any other file can not be undone."));
+        QPushButton *replaceButton = confirm.addButton(tr("Replace"), QMessageBox::AcceptRole);
+        QPushButton *previewButton = confirm.addButton(tr("Preview"), QMessageBox::ActionRole);
+        confirm.exec();
+
+        if (confirm.clickedButton() == previewButton)
+            preview = true;
+        else if (confirm.clickedButton() != replaceButton)
+            return;
+    }
+
+    updateComboList(ui->comboDirectory, directory);
+    if (!ui->comboFilters->currentText().isEmpty())
+        updateComboList(ui->comboFilters, ui->comboFilters->currentText());
+
+    FileSearcher::Options options;
+    options.directory = QDir::cleanPath(directory);
+    options.filters = ui->comboFilters->currentText();
+    options.recursive = ui->checkBoxInSubFolders->isChecked();
+    options.includeHidden = ui->checkBoxInHiddenFolders->isChecked();
+    options.respectGitIgnore = ui->checkBoxFollowGitIgnore->isChecked();
+    options.replace = true;
+    options.replacement = replaceText.toUtf8();
+
+    // Open files are changed through their editor so there is no conflict with any unsaved changes, and they can be undone
+    QHash<QString, QPointer<ScintillaNext>> openFiles;
+
+    for (ScintillaNext *editor : openEditors()) {
+        if (editor->isFile()) {
+            const QString filePath = QDir::cleanPath(editor->getFilePath());
+
+            options.excludedFiles.insert(filePath);
+            openFiles.insert(filePath, editor);
+        }
+    }
+
+    if (preview) {
+        startReplaceInFilesPreview(options, openFiles, replaceText);
+        return;
+    }
+
+    struct Totals
+    {
+        int replacements = 0;
+        int files = 0;
+        QStringList failures;
+    };
+    std::shared_ptr<Totals> totals = std::make_shared<Totals>();
+
+    // Only one search at a time, anything from a previous one is simply dropped. Its signals may already be queued,
+    // so it is disconnected rather than left to report into this search.
+    if (fileSearcher) {
+        fileSearcher->disconnect();
+        fileSearcher->cancel();
+        fileSearcher->deleteLater();
+    }
+
+    fileSearcher = new FileSearcher(this);
+
+    FileSearcher *searcher = fileSearcher;
+
+    connect(searcher, &FileSearcher::fileReplaced, this, [=](const QString &, int replacements) {
+        totals->replacements += replacements;
+        totals->files++;
+    });
+    connect(searcher, &FileSearcher::replaceSkipped, this, [=](const QString &filePath) {
+        ScintillaNext *target = openFiles.value(filePath);
+
+        if (target == Q_NULLPTR)
+            return;
+
+        ScintillaNext *current_editor = editor;
+
+        setEditor(target);
+        const int replacements = finder->replaceAll(replaceText);
+        setEditor(current_editor);
+
+        if (replacements > 0) {
+            totals->replacements += replacements;
+            totals->files++;
+        }
+    });
+    connect(searcher, &FileSearcher::replaceFailed, this, [=](const QString &filePath, const QString &error) {
+        totals->failures.append(QStringLiteral("%1: %2").arg(QDir::toNativeSeparators(filePath), error));
+    });
+    connect(searcher, &FileSearcher::progressChanged, this, [=](int filesSearched) {
+        statusBar->showMessage(tr("Searched %Ln files", "", filesSearched));
+    });
+    connect(searcher, &FileSearcher::finished, this, [=](int, int, bool canceled) {
+        if (fileSearcher == searcher)
+            fileSearcher = nullptr;
+        searcher->deleteLater();
+
+        setSearchInProgress(false);
+        searchProgress->setRange(0, 100);
+
+        const QString summary = tr("Replaced %1 in %2").arg(tr("%Ln matches", "", totals->replacements), tr("%Ln files", "", totals->files));
+
+        if (!totals->failures.isEmpty()) {
+            QMessageBox failed(QMessageBox::Warning, tr("Replace in Files"), tr("%Ln files could not be changed.", "", totals->failures.size()), QMessageBox::Ok, this);
+            failed.setDetailedText(totals->failures.join('\n'));
+            failed.exec();
+        }
+
+        if (canceled) {
+            showMessage(tr("Replace canceled. %1").arg(summary), "blue");
+        }
+        else {
+            showMessage(summary, totals->failures.isEmpty() ? "green" : "red");
+        }
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, searcher, &FileSearcher::cancel);
+
+    setSearchInProgress(true);
+    searchProgress->setRange(0, 0);
+
+    searcher->start(options, pattern, flags);
+}
+
 void FindReplaceDialog::count()
 {
     qInfo(Q_FUNC_INFO);
 
     prepareToPerformSearch();
 
-    int total = finder->count();
+    if (BackgroundSearcher::canSearch(finder->searchText().toUtf8(), finder->searchFlags())) {
+        startBackgroundSearch({editor}, false);
+    }
+    else {
+        int total = finder->count();
 
-    showMessage(tr("Found %Ln matches", "", total), "green");
+        showMessage(tr("Found %Ln matches", "", total), "green");
+    }
 }
 
 void FindReplaceDialog::setEditor(ScintillaNext *editor)
@@ -422,38 +1044,178 @@ void FindReplaceDialog::adjustOpacityAlways(bool checked)
 
 void FindReplaceDialog::changeTab(int index)
 {
-    if (index == 0) {
-        ui->labelReplaceWith->setMaximumHeight(0);
-        ui->comboReplace->setMaximumHeight(0);
-        // The combo box isn't actually "hidden", so adjust the focus policy so it does not get tabbed to
-        ui->comboReplace->setFocusPolicy(Qt::NoFocus);
-
-        ui->buttonReplace->hide();
-        ui->buttonReplaceAll->hide();
-        ui->buttonReplaceAllInDocuments->hide();
-
-        ui->buttonCount->show();
-        ui->buttonFindAllInCurrent->show();
-        ui->buttonFindAllInDocuments->show();
+    const bool isReplace = index == REPLACE_TAB;
+    const bool isFindInFiles = index == FIND_IN_FILES_TAB;
+    const bool isMark = index == MARK_TAB;
+
+    // Files can be replaced in as well
+    const bool showReplace = isReplace || isFindInFiles;
+
+    // Marking takes a whole list of terms instead of a single search
+    ui->label->setMaximumHeight(isMark ? 0 : QWIDGETSIZE_MAX);
+    ui->comboFind->setMaximumHeight(isMark ? 0 : QWIDGETSIZE_MAX);
+    ui->comboFind->setFocusPolicy(isMark ? Qt::NoFocus : Qt::StrongFocus);
+    ui->labelMarkTerms->setVisible(isMark);
+    ui->textMarkTerms->setVisible(isMark);
+
+    ui->labelReplaceWith->setMaximumHeight(showReplace ? QWIDGETSIZE_MAX : 0);
+    ui->comboReplace->setMaximumHeight(showReplace ? QWIDGETSIZE_MAX : 0);
+    // The combo box isn't actually "hidden", so adjust the focus policy so it does not get tabbed to
+    ui->comboReplace->setFocusPolicy(showReplace ? Qt::StrongFocus : Qt::NoFocus);
+
+    ui->labelFilters->setMaximumHeight(isFindInFiles ? QWIDGETSIZE_MAX : 0);
+    ui->comboFilters->setMaximumHeight(isFindInFiles ? QWIDGETSIZE_MAX : 0);
+    ui->comboFilters->setFocusPolicy(isFindInFiles ? Qt::StrongFocus : Qt::NoFocus);
+    ui->labelDirectory->setMaximumHeight(isFindInFiles ? QWIDGETSIZE_MAX : 0);
+    ui->comboDirectory->setMaximumHeight(isFindInFiles ? QWIDGETSIZE_MAX : 0);
+    ui->comboDirectory->setFocusPolicy(isFindInFiles ? Qt::StrongFocus : Qt::NoFocus);
+    ui->buttonBrowseDirectory->setVisible(isFindInFiles);
+
+    ui->buttonReplace->setVisible(isReplace);
+    ui->buttonReplaceAll->setVisible(isReplace);
+    ui->buttonReplaceAllInDocuments->setVisible(isReplace);
+
+    ui->buttonFind->setVisible(!isFindInFiles && !isMark);
+    ui->buttonCount->setVisible(index == FIND_TAB);
+    ui->buttonFindAllInCurrent->setVisible(index == FIND_TAB);
+    ui->buttonFindAllInDocuments->setVisible(index == FIND_TAB);
+    ui->buttonFindAllInFiles->setVisible(isFindInFiles);
+    ui->buttonReplaceInFiles->setVisible(isFindInFiles);
+    ui->buttonMarkAll->setVisible(isMark);
+    ui->buttonLoadMarkTerms->setVisible(isMark);
+    ui->buttonClearMarks->setVisible(isMark);
+
+    // Files on disk are always searched from the top, and marks are put on the whole document
+    ui->checkBoxBackwardsDirection->setVisible(!isFindInFiles && !isMark);
+    ui->checkBoxWrapAround->setVisible(!isFindInFiles && !isMark);
+    ui->checkBoxInSubFolders->setVisible(isFindInFiles);
+    ui->checkBoxInHiddenFolders->setVisible(isFindInFiles);
+    ui->checkBoxFollowGitIgnore->setVisible(isFindInFiles);
+    ui->checkBoxBookmarkLine->setVisible(isMark);
+    ui->checkBoxPreviewReplace->setVisible(showReplace);
+
+    // The terms are always matched literally
+    ui->searchMode->setDisabled(isMark);
+    ui->checkBoxMatchWholeWord->setDisabled(!isMark && ui->radioRegexSearch->isChecked());
+
+    if (isMark) {
+        ui->buttonMarkAll->setDefault(true);
+        ui->textMarkTerms->setFocus();
+        return;
     }
-    else if (index == 1) {
-        ui->labelReplaceWith->setMaximumHeight(QWIDGETSIZE_MAX);
-        ui->comboReplace->setMaximumHeight(QWIDGETSIZE_MAX);
-        ui->comboReplace->setFocusPolicy(Qt::StrongFocus); // Reset its focus policy
 
-        ui->buttonReplace->show();
-        ui->buttonReplaceAll->show();
-        ui->buttonReplaceAllInDocuments->show();
+    if (isFindInFiles) {
+        ui->buttonFindAllInFiles->setDefault(true);
 
-        ui->buttonCount->hide();
-        ui->buttonFindAllInCurrent->hide();
-        ui->buttonFindAllInDocuments->hide();
+        // Start out with the directory of the current file
+        if (ui->comboDirectory->currentText().isEmpty() && editor->isFile()) {
+            ui->comboDirectory->setCurrentText(QDir::toNativeSeparators(editor->getPath()));
+        }
+    }
+    else {
+        ui->buttonFind->setDefault(true);
     }
 
     ui->comboFind->setFocus();
     ui->comboFind->lineEdit()->selectAll();
 }
 
+void FindReplaceDialog::markAll()
+{
+    qInfo(Q_FUNC_INFO);
+
+    QList<QByteArray> terms;
+    const QStringList lines = ui->textMarkTerms->toPlainText().split('\n');
+    for (const QString &line : lines) {
+        const QString term = line.trimmed();
+
+        if (!term.isEmpty()) {
+            terms.append(term.toUtf8());
+        }
+    }
+
+    if (terms.isEmpty()) {
+        showMessage(tr("No terms to mark."), "red");
+        return;
+    }
+
+    ScintillaNext *markedEditor = editor;
+    MultiMarker *marker = MultiMarker::forEditor(editor);
+    const bool bookmarkLines = ui->checkBoxBookmarkLine->isChecked();
+
+    // Drop whatever an earlier run was waiting to hear back about
+    marker->cancel();
+    disconnect(marker, Q_NULLPTR, this, Q_NULLPTR);
+    disconnect(buttonCancelSearch, Q_NULLPTR, marker, Q_NULLPTR);
+
+    auto finished = [=]() {
+        disconnect(marker, Q_NULLPTR, this, Q_NULLPTR);
+        disconnect(buttonCancelSearch, Q_NULLPTR, marker, Q_NULLPTR);
+
+        setSearchInProgress(false);
+        searchProgress->setRange(0, 100);
+    };
+
+    connect(marker, &MultiMarker::marked, this, [=](int matches, int termsFound) {
+        finished();
+
+        BookMarkDecorator *bookMarkDecorator = markedEditor->findChild<BookMarkDecorator *>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (bookmarkLines && bookMarkDecorator && bookMarkDecorator->isEnabled()) {
+            for (int indicator : marker->indicators()) {
+                bookMarkDecorator->addBookmarksForRanges(MatchIndex::forEditor(markedEditor)->matches(indicator));
+            }
+        }
+
+        const QString summary = tr("Marked %1, found %2 of %3 terms").arg(tr("%Ln matches", "", matches)).arg(termsFound).arg(terms.size());
+        showMessage(summary, matches > 0 ? "green" : "red");
+    });
+    connect(marker, &MultiMarker::markingCanceled, this, [=]() {
+        finished();
+        showMessage(tr("Marking canceled."), "blue");
+    });
+    connect(buttonCancelSearch, &QPushButton::clicked, marker, &MultiMarker::cancel);
+
+    setSearchInProgress(true);
+    searchProgress->setRange(0, 0);
+
+    marker->mark(terms, ui->checkBoxMatchCase->isChecked(), ui->checkBoxMatchWholeWord->isChecked());
+}
+
+void FindReplaceDialog::loadMarkTerms()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Terms"), QString(), tr("Text Files (*.txt);;All Files (*)"));
+
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        showMessage(tr("Could not read %1").arg(QDir::toNativeSeparators(fileName)), "red");
+        return;
+    }
+
+    ui->textMarkTerms->setPlainText(QString::fromUtf8(file.readAll()));
+}
+
+void FindReplaceDialog::clearMarks()
+{
+    qInfo(Q_FUNC_INFO);
+
+    MultiMarker::forEditor(editor)->clear();
+    statusBar->clearMessage();
+}
+
+void FindReplaceDialog::browseForDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Select Directory"), ui->comboDirectory->currentText(), QFileDialog::ShowDirsOnly);
+
+    if (!dir.isEmpty()) {
+        ui->comboDirectory->setCurrentText(QDir::toNativeSeparators(dir));
+    }
+}
+
 QString FindReplaceDialog::findString()
 {
     return ui->comboFind->currentText();
@@ -503,11 +1265,19 @@ void FindReplaceDialog::loadSettings()
 
     ui->comboFind->addItems(settings.value("RecentSearchList").toStringList());
     ui->comboReplace->addItems(settings.value("RecentReplaceList").toStringList());
+    ui->comboFilters->addItems(settings.value("RecentFiltersList").toStringList());
+    ui->comboDirectory->addItems(settings.value("RecentDirectoryList").toStringList());
 
     ui->checkBoxBackwardsDirection->setChecked(settings.value("Backwards").toBool());
     ui->checkBoxMatchWholeWord->setChecked(settings.value("WholeWord").toBool());
     ui->checkBoxMatchCase->setChecked(settings.value("MatchCase").toBool());
     ui->checkBoxWrapAround->setChecked(settings.value("WrapAround", true).toBool());
+    ui->checkBoxInSubFolders->setChecked(settings.value("InSubFolders", true).toBool());
+    ui->checkBoxInHiddenFolders->setChecked(settings.value("InHiddenFolders").toBool());
+    ui->checkBoxFollowGitIgnore->setChecked(settings.value("FollowGitIgnore", true).toBool());
+    ui->textMarkTerms->setPlainText(settings.value("MarkTerms").toString());
+    ui->checkBoxBookmarkLine->setChecked(settings.value("BookmarkLine").toBool());
+    ui->checkBoxPreviewReplace->setChecked(settings.value("PreviewReplace").toBool());
 
     if (settings.contains("SearchMode")) {
         const QString searchMode = settings.value("SearchMode").toString();
@@ -556,10 +1326,28 @@ void FindReplaceDialog::saveSettings()
     }
     settings.setValue("RecentReplaceList", recentSearches);
 
+    recentSearches.clear();
+    for (int i = 0; i < ui->comboFilters->count(); ++i) {
+        recentSearches << ui->comboFilters->itemText(i);
+    }
+    settings.setValue("RecentFiltersList", recentSearches);
+
+    recentSearches.clear();
+    for (int i = 0; i < ui->comboDirectory->count(); ++i) {
+        recentSearches << ui->comboDirectory->itemText(i);
+    }
+    settings.setValue("RecentDirectoryList", recentSearches);
+
     settings.setValue("Backwards", ui->checkBoxBackwardsDirection->isChecked());
     settings.setValue("WholeWord", ui->checkBoxMatchWholeWord->isChecked());
     settings.setValue("MatchCase", ui->checkBoxMatchCase->isChecked());
     settings.setValue("WrapAround", ui->checkBoxWrapAround->isChecked());
+    settings.setValue("InSubFolders", ui->checkBoxInSubFolders->isChecked());
+    settings.setValue("InHiddenFolders", ui->checkBoxInHiddenFolders->isChecked());
+    settings.setValue("FollowGitIgnore", ui->checkBoxFollowGitIgnore->isChecked());
+    settings.setValue("MarkTerms", ui->textMarkTerms->toPlainText());
+    settings.setValue("BookmarkLine", ui->checkBoxBookmarkLine->isChecked());
+    settings.setValue("PreviewReplace", ui->checkBoxPreviewReplace->isChecked());
 
     if (ui->radioNormalSearch->isChecked())
         settings.setValue("SearchMode", "normal");
@@ -589,9 +1377,9 @@ void FindReplaceDialog::restorePosition()
 {
     qInfo(Q_FUNC_INFO);
 
-    ApplicationSettings settings;
+    NotepadNextApplication *app = qobject_cast<NotepadNextApplication *>(qApp);
 
-    if (settings.centerSearchDialog()) {
+    if (app->getSettings()->centerSearchDialog()) {
         const QPoint centerPoint = parentWidget()->geometry().center();
         move(centerPoint - rect().center());
     }
@@ -22,13 +22,20 @@
 
 #include <QDialog>
 #include <QEvent>
+#include <QHash>
+#include <QPointer>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QStatusBar>
 #include <QTabBar>
 
+#include "FileSearcher.h"
 #include "Finder.h"
 #include "ISearchResultsHandler.h"
 
 
+class BackgroundSearcher;
+class ReplacePreviewDialog;
 class ScintillaNext;
 class MainWindow;
 
@@ -72,9 +79,15 @@ public slots:
     void find();
     void findAllInCurrentDocument();
     void findAllInDocuments();
+    void findAllInFiles();
     void count();
     void replace();
     void replaceAll();
+    void replaceAllInDocuments();
+    void replaceInFiles();
+    void markAll();
+    void loadMarkTerms();
+    void clearMarks();
 
 private slots:
     void setEditor(ScintillaNext *edit);
@@ -98,8 +111,18 @@ private:
 
     void showMessage(const QString &message, const QString &color);
 
+    QVector<ScintillaNext *> openEditors() const;
+    void findAllInEditor(ScintillaNext *editor);
+    void startBackgroundSearch(const QVector<ScintillaNext *> &editors, bool collectResults);
+    void startBackgroundReplace(const QVector<ScintillaNext *> &editors, const QString &replaceText);
+    ReplacePreviewDialog *showReplacePreview();
+    void startReplacePreview(const QVector<ScintillaNext *> &editors, const QString &replaceText, ReplacePreviewDialog *preview);
+    void startReplaceInFilesPreview(const FileSearcher::Options &options, const QHash<QString, QPointer<ScintillaNext>> &openFiles, const QString &replaceText);
+    void setSearchInProgress(bool inProgress);
+
     void updateFindList(const QString &text);
     void updateReplaceList(const QString &text);
+    void browseForDirectory();
 
     bool isFirstTime = true;
     QPoint lastClosedPosition;
@@ -110,6 +133,11 @@ private:
     QTabBar *tabBar;
     ISearchResultsHandler *searchResultsHandler;
     Finder *finder;
+
+    BackgroundSearcher *backgroundSearcher = nullptr;
+    FileSearcher *fileSearcher = nullptr;
+    QProgressBar *searchProgress;
+    QPushButton *buttonCancelSearch;
 };
 
 #endif // FINDREPLACEDIALOG_H
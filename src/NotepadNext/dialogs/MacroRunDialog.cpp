@@ -22,6 +22,11 @@
 
 #include "ui_MacroRunDialog.h"
 
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+
 
 MacroRunDialog::MacroRunDialog(QWidget *parent, MacroManager *mm) :
     QDialog(parent, Qt::Tool),
@@ -30,6 +35,19 @@ MacroRunDialog::MacroRunDialog(QWidget *parent, MacroManager *mm) :
 {
     ui->setupUi(this);
 
+    ui->progressBar->hide();
+
+    connect(ui->comboScope, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MacroRunDialog::updateScope);
+    updateScope();
+
+    connect(ui->buttonBrowse, &QToolButton::clicked, this, [=]() {
+        const QString folder = QFileDialog::getExistingDirectory(this, tr("Run Macro in Folder"), ui->editFolder->text());
+
+        if (!folder.isEmpty()) {
+            ui->editFolder->setText(QDir::toNativeSeparators(folder));
+        }
+    });
+
     connect(ui->buttonRun, &QPushButton::clicked, this, [=]() {
         Macro *selectedMacro = ui->comboBox->currentData().value<Macro*>();
         int times = -1; // for end of file
@@ -38,7 +56,31 @@ MacroRunDialog::MacroRunDialog(QWidget *parent, MacroManager *mm) :
             times = ui->spinTimes->value();
         }
 
-        emit execute(selectedMacro, times);
+        switch (ui->comboScope->currentIndex()) {
+        case AllOpenDocuments:
+            emit executeInDocuments(selectedMacro, times, ui->checkLineByLine->isChecked(), QString(), QString());
+            break;
+        case FolderDocuments:
+            if (!QFileInfo(ui->editFolder->text()).isDir()) {
+                QMessageBox::warning(this, windowTitle(), tr("\"%1\" is not a folder.").arg(ui->editFolder->text()));
+                return;
+            }
+
+            emit executeInDocuments(selectedMacro, times, ui->checkLineByLine->isChecked(), QDir::fromNativeSeparators(ui->editFolder->text()), ui->editFilters->text());
+            break;
+        default:
+            emit execute(selectedMacro, times, ui->checkLineByLine->isChecked());
+            break;
+        }
+    });
+
+    connect(ui->buttonCancel, &QPushButton::clicked, this, [=]() {
+        if (running) {
+            emit cancelRequested();
+        }
+        else {
+            close();
+        }
     });
 }
 
@@ -47,6 +89,39 @@ MacroRunDialog::~MacroRunDialog()
     delete ui;
 }
 
+void MacroRunDialog::updateScope()
+{
+    const bool folder = ui->comboScope->currentIndex() == FolderDocuments;
+
+    ui->labelFolder->setEnabled(folder);
+    ui->editFolder->setEnabled(folder);
+    ui->buttonBrowse->setEnabled(folder);
+    ui->labelFilters->setEnabled(folder);
+    ui->editFilters->setEnabled(folder);
+}
+
+void MacroRunDialog::runStarted()
+{
+    running = true;
+
+    ui->progressBar->setValue(0);
+    ui->progressBar->setVisible(true);
+    ui->buttonRun->setEnabled(false);
+}
+
+void MacroRunDialog::setProgress(int percent)
+{
+    ui->progressBar->setValue(percent);
+}
+
+void MacroRunDialog::runFinished()
+{
+    running = false;
+
+    ui->progressBar->setVisible(false);
+    ui->buttonRun->setEnabled(true);
+}
+
 void MacroRunDialog::showEvent(QShowEvent *event)
 {
     ui->comboBox->clear();
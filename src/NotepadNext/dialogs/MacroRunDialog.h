@@ -38,15 +38,33 @@ public:
     MacroRunDialog(QWidget *parent, MacroManager *mm);
     ~MacroRunDialog();
 
+public slots:
+    // While a macro is running the progress is shown and Cancel stops it rather than closing the dialog
+    void runStarted();
+    void setProgress(int percent);
+    void runFinished();
+
 protected:
     void showEvent(QShowEvent *event) override;
 
 signals:
-    void execute(Macro *macro, int times);
+    void execute(Macro *macro, int times, bool lineByLine);
+    // Every open document if folder is empty, else the documents in it that match filters
+    void executeInDocuments(Macro *macro, int times, bool lineByLine, const QString &folder, const QString &filters);
+    void cancelRequested();
 
 private:
+    enum Scope {
+        CurrentDocument,
+        AllOpenDocuments,
+        FolderDocuments
+    };
+
+    void updateScope();
+
     Ui::MacroRunDialog *ui;
     MacroManager *macroManager;
+    bool running = false;
 };
 
 #endif // MACRORUNDIALOG_H
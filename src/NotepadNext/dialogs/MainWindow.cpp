@@ -18,12 +18,21 @@
 
 
 #include "MainWindow.h"
+#include "BatchProcessor.h"
 #include "BookMarkDecorator.h"
+#include "CsvColumns.h"
+#include "DocumentCompare.h"
+#include "EncodingDetector.h"
+#include "LazyMimeData.h"
+#include "LogTimestampIndex.h"
 #include "URLFinder.h"
 #include "SessionManager.h"
-#include "UndoAction.h"
+#include "BulkEdit.h"
+#include "LineTransforms.h"
+#include "StartupTrace.h"
 #include "ui_MainWindow.h"
 
+#include <QBuffer>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStringList>
@@ -33,12 +42,27 @@
 #include <QPushButton>
 #include <QTimer>
 #include <QInputDialog>
-#include <QPrintPreviewDialog>
-#include <QPrinter>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QLineEdit>
 #include <QDirIterator>
 #include <QProcess>
 #include <QScreen>
-
+#include <QLocale>
+#include <QProgressDialog>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QCryptographicHash>
+#include <QFileSystemWatcher>
+#include <QTextCodec>
+#include <QUrl>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
 
 #ifdef Q_OS_WIN
 #include <QSimpleUpdater.h>
@@ -64,17 +88,25 @@
 #include "DebugLogDock.h"
 #include "HexViewerDock.h"
 #include "FileListDock.h"
+#include "MinimapDock.h"
+#include "OutlineDock.h"
+#include "PerformanceDock.h"
+#include "StatisticsDock.h"
 
 #include "FindReplaceDialog.h"
 #include "MacroRunDialog.h"
+#include "MacroPlayer.h"
 #include "MacroSaveDialog.h"
 #include "PreferencesDialog.h"
 #include "ColumnEditorDialog.h"
 
+#include "LineFilter.h"
+#include "LineFilterWidget.h"
 #include "QuickFindWidget.h"
 
-#include "EditorPrintPreviewRenderer.h"
+#include "PrintPreviewDialog.h"
 #include "MacroEditorDialog.h"
+#include "QuickOpenDialog.h"
 
 #include "ZoomEventWatcher.h"
 #include "FileDialogHelpers.h"
@@ -83,7 +115,21 @@
 #include "RtfConverter.h"
 
 #include "FadingIndicator.h"
+#include "JobScheduler.h"
+#include "ProgressOverlay.h"
+#include "HexFileViewer.h"
+#include "FileChangeWatcher.h"
+#include "LargeFileViewer.h"
+
+
+// Files at least this big are written on a worker thread when saved from the Save and Save All actions
+const int BACKGROUND_SAVE_THRESHOLD = 1024 * 1024 * 16;
+
+// Selections at least this big are encoded or decoded on a worker thread
+const int TRANSFORM_IN_BACKGROUND_THRESHOLD = 1024 * 1024 * 4;
 
+// How often to look for editors that can hibernate
+const int HIBERNATION_CHECK_INTERVAL = 60 * 1000;
 
 MainWindow::MainWindow(NotepadNextApplication *app) :
     ui(new Ui::MainWindow),
@@ -94,7 +140,15 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
 
     setAttribute(Qt::WA_DeleteOnClose);
 
+    // Set before any of the children exist, so each one is styled as it is created instead of all of them being polished again afterwards
+    TraceScope styleSheetTrace("Style sheet");
+    applyStyleSheet();
+    watchCustomStyleSheet();
+    styleSheetTrace.end();
+
+    TraceScope setupUiTrace("MainWindow::setupUi");
     ui->setupUi(this);
+    setupUiTrace.end();
 
     applyCustomShortcuts();
 
@@ -109,10 +163,33 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     connect(dockedEditor, &DockedEditor::contextMenuRequestedForEditor, this, &MainWindow::tabBarRightClicked);
     connect(dockedEditor, &DockedEditor::titleBarDoubleClicked, this, &MainWindow::newFile);
 
+    connect(app->getFileChangeWatcher(), &FileChangeWatcher::fileChanged, this, [=](ScintillaNext *editor, bool exists, const QDateTime &lastModified) {
+        if (checkFileForModification(editor, editor->checkFileForStateChange(exists, lastModified)) && editor == currentEditor()) {
+            updateGui(editor);
+        }
+    });
+
+    QTimer *hibernationTimer = new QTimer(this);
+    connect(hibernationTimer, &QTimer::timeout, this, &MainWindow::hibernateIdleEditors);
+    hibernationTimer->start(HIBERNATION_CHECK_INTERVAL);
+
     // Set up the menus
     connect(ui->actionNew, &QAction::triggered, this, &MainWindow::newFile);
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::openFileDialog);
     connect(ui->actionReload, &QAction::triggered, this, &MainWindow::reloadFile);
+    connect(ui->actionFollowFile, &QAction::triggered, this, [=](bool follow) { currentEditor()->setFollowing(follow); });
+    connect(ui->actionShowChangeHistory, &QAction::triggered, this, [=](bool show) {
+        currentEditor()->setChangeHistoryEnabled(show);
+
+        // Files opened from now on start out the same way
+        app->getSettings()->setShowChangeHistory(show);
+    });
+    connect(ui->actionCloneToOtherView, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        ScintillaNext *clone = app->getEditorManager()->createClone(editor);
+
+        dockedEditor->showSideBySide(editor, clone);
+    });
     connect(ui->actionClose, &QAction::triggered, this, &MainWindow::closeCurrentFile);
     connect(ui->actionCloseAll, &QAction::triggered, this, &MainWindow::closeAllFiles);
     connect(ui->actionExit, &QAction::triggered, this, &MainWindow::close);
@@ -124,6 +201,9 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
 #endif
 
     connect(ui->actionOpenFolderasWorkspace, &QAction::triggered, this, &MainWindow::openFolderAsWorkspaceDialog);
+    connect(ui->actionGoToFile, &QAction::triggered, this, &MainWindow::goToFileDialog);
+    connect(ui->actionOpenInHexViewer, &QAction::triggered, this, &MainWindow::openInHexViewerDialog);
+    connect(ui->actionOpenUrl, &QAction::triggered, this, &MainWindow::openUrlDialog);
 
     connect(ui->actionCloseAllExceptActive, &QAction::triggered, this, &MainWindow::closeAllExceptActive);
     connect(ui->actionCloseAllToLeft, &QAction::triggered, this, &MainWindow::closeAllToLeft);
@@ -151,28 +231,15 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     connect(ui->actionSingleLineComment, &QAction::triggered, this, [=]() { currentEditor()->commentLineSelection(); });
     connect(ui->actionSingleLineUncomment, &QAction::triggered, this, [=]() { currentEditor()->uncommentLineSelection(); });
 
-    connect(ui->actionBase64Encode,&QAction::triggered, this, [=]() {
-        ScintillaNext *editor = currentEditor();
-        const QByteArray selection = currentEditor()->getSelText();
-        editor->replaceSel(selection.toBase64().constData());
-    });
-    connect(ui->actionURLEncode,&QAction::triggered, this, [=]() {
-        ScintillaNext *editor = currentEditor();
-        const QByteArray selection = currentEditor()->getSelText();
-        editor->replaceSel(selection.toPercentEncoding().constData());
-    });
-    connect(ui->actionBase64Decode,&QAction::triggered, this, [=]() {
-        ScintillaNext *editor = currentEditor();
-        const QByteArray selection = editor->getSelText();
-        if (auto result = QByteArray::fromBase64Encoding(selection)) {
-            editor->replaceSel((*result).constData());
-        }
-    });
-    connect(ui->actionURLDecode,&QAction::triggered, this, [=]() {
-        ScintillaNext *editor = currentEditor();
-        const QByteArray selection = editor->getSelText();
-        editor->replaceSel(QByteArray::fromPercentEncoding(selection).constData());
-    });
+    connect(ui->actionBase64Encode, &QAction::triggered, this, [=]() { transformSelections(TextTransform::Base64Encode); });
+    connect(ui->actionURLEncode, &QAction::triggered, this, [=]() { transformSelections(TextTransform::PercentEncode); });
+    connect(ui->actionBase64Decode, &QAction::triggered, this, [=]() { transformSelections(TextTransform::Base64Decode); });
+    connect(ui->actionURLDecode, &QAction::triggered, this, [=]() { transformSelections(TextTransform::PercentDecode); });
+
+    connect(ui->actionJsonPrettyPrint, &QAction::triggered, this, [=]() { formatText(TextFormatter::JsonPrettyPrint); });
+    connect(ui->actionJsonMinify, &QAction::triggered, this, [=]() { formatText(TextFormatter::JsonMinify); });
+    connect(ui->actionXmlPrettyPrint, &QAction::triggered, this, [=]() { formatText(TextFormatter::XmlPrettyPrint); });
+    connect(ui->actionXmlMinify, &QAction::triggered, this, [=]() { formatText(TextFormatter::XmlMinify); });
     connect(ui->actionCopyURL, &QAction::triggered, this, [=]() {
         ScintillaNext *editor = currentEditor();
         URLFinder *urlFinder = editor->findChild<URLFinder *>(QString(), Qt::FindDirectChildrenOnly);
@@ -187,13 +254,63 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
 
     RecentFilesListMenuBuilder *recentFileListMenuBuilder = new RecentFilesListMenuBuilder(app->getRecentFilesListManager());
     connect(ui->menuRecentFiles, &QMenu::aboutToShow, this, [=]() {
-        // NOTE: its unfortunate that this has to be hard coded, but there's no way
-        // to easily determine what should or shouldn't be there
-        while (ui->menuRecentFiles->actions().size() > 4) {
-            delete ui->menuRecentFiles->actions().takeLast();
+        recentFileListMenuBuilder->populateMenu(ui->menuRecentFiles);
+    });
+
+    connect(ui->menuWorkspaces, &QMenu::aboutToShow, this, [=]() {
+        const SessionManager *sessionManager = app->getSessionManager();
+
+        // Everything after the separator is one of the workspaces
+        for (QAction *action : ui->menuWorkspaces->actions()) {
+            if (!action->data().isNull()) {
+                delete action;
+            }
         }
 
-        recentFileListMenuBuilder->populateMenu(ui->menuRecentFiles);
+        for (const QString &name : sessionManager->workspaceNames()) {
+            QAction *action = ui->menuWorkspaces->addAction(name);
+
+            action->setData(name);
+            action->setCheckable(true);
+            action->setChecked(name == sessionManager->currentWorkspace());
+
+            connect(action, &QAction::triggered, this, [=]() {
+                switchToWorkspace(name);
+            });
+        }
+
+        ui->actionDeleteWorkspace->setEnabled(sessionManager->workspaceNames().size() > 1);
+    });
+
+    connect(ui->actionNewWorkspace, &QAction::triggered, this, [=]() {
+        bool ok = false;
+        const QString name = QInputDialog::getText(this, tr("New Workspace"), tr("Name:"), QLineEdit::Normal, QString(), &ok).trimmed();
+
+        if (!ok || name.isEmpty()) {
+            return;
+        }
+
+        if (app->getSessionManager()->workspaceNames().contains(name)) {
+            QMessageBox::warning(this, tr("New Workspace"), tr("There already is a workspace called \"%1\".").arg(name));
+            return;
+        }
+
+        switchToWorkspace(name);
+    });
+
+    connect(ui->actionDeleteWorkspace, &QAction::triggered, this, [=]() {
+        SessionManager *sessionManager = app->getSessionManager();
+        QStringList names = sessionManager->workspaceNames();
+
+        // The open one has to be switched away from first
+        names.removeOne(sessionManager->currentWorkspace());
+
+        bool ok = false;
+        const QString name = QInputDialog::getItem(this, tr("Delete Workspace"), tr("Workspace:"), names, 0, false, &ok);
+
+        if (ok && !name.isEmpty()) {
+            sessionManager->removeWorkspace(name);
+        }
     });
 
     connect(ui->actionRestoreRecentlyClosedFile, &QAction::triggered, this, [=]() {
@@ -234,7 +351,7 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     connect(ui->actionRemoveEmptyLines, &QAction::triggered, this, [=]() {
         ScintillaNext *editor = currentEditor();
         Finder f(editor);
-        const UndoAction ua(editor);
+        const BulkEdit be(editor);
 
         f.setSearchText(QStringLiteral("\\R\\R+"));
         f.setSearchFlags(SCFIND_REGEXP);
@@ -247,6 +364,43 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         editor->deleteTrailingEmptyLines();
     });
 
+    // The rest of the line operations come from the transforms that work on whole lines
+    ui->menuLine_Operations->addSeparator();
+    for (const LineTransforms::Transform &transform : LineTransforms::transforms()) {
+        if (transform.wholeLines) {
+            const QString name = transform.name;
+            ui->menuLine_Operations->addAction(QCoreApplication::translate("LineTransforms", transform.title), this, [=]() {
+                LineTransforms::apply(currentEditor(), name);
+            });
+        }
+    }
+    ui->menuLine_Operations->addAction(tr("Sort Lines by Field..."), this, [=]() {
+        QStringList titles;
+        QStringList names;
+        for (const LineTransforms::Transform &transform : LineTransforms::transforms()) {
+            if (transform.name.startsWith(QStringLiteral("SortLines"))) {
+                titles.append(QCoreApplication::translate("LineTransforms", transform.title));
+                names.append(transform.name);
+            }
+        }
+
+        bool ok = false;
+        const QString title = QInputDialog::getItem(this, tr("Sort Lines by Field"), tr("Sort:"), titles, 0, false, &ok);
+        if (!ok)
+            return;
+
+        LineTransforms::Context context;
+        context.field = QInputDialog::getInt(this, tr("Sort Lines by Field"), tr("Field:"), 1, 1, 1000, 1, &ok);
+        if (!ok)
+            return;
+
+        context.separator = QInputDialog::getText(this, tr("Sort Lines by Field"), tr("Separator, or nothing for spaces and tabs:"), QLineEdit::Normal, QStringLiteral(","), &ok).toUtf8();
+        if (!ok)
+            return;
+
+        LineTransforms::apply(currentEditor(), names.at(titles.indexOf(title)), context);
+    });
+
     connect(ui->actionColumnMode, &QAction::triggered, this, [=]() {
         ColumnEditorDialog *columnEditor = findChild<ColumnEditorDialog *>(QString(), Qt::FindDirectChildrenOnly);
 
@@ -262,9 +416,17 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     connect(ui->actionUndo, &QAction::triggered, this, [=]() { currentEditor()->undo(); });
     connect(ui->actionRedo, &QAction::triggered, this, [=]() { currentEditor()->redo(); });
     connect(ui->actionCut, &QAction::triggered, this, [=]() { currentEditor()->cutAllowLine(); });
-    connect(ui->actionCopy, &QAction::triggered, this, [=]() { currentEditor()->copyAllowLine(); });
+    connect(ui->actionCopy, &QAction::triggered, this, [=]() { currentEditor()->copyToClipboard(); });
     connect(ui->actionDelete, &QAction::triggered, this, [=]() { currentEditor()->clear(); });
-    connect(ui->actionPaste, &QAction::triggered, this, [=]() { currentEditor()->paste(); });
+    connect(ui->actionPaste, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+
+        // Each selection gets its own copy of the clipboard, so make room for all of them up front.
+        // A UTF-16 code unit is at most 3 bytes of UTF-8
+        const qsizetype clipboardLength = QApplication::clipboard()->text().size();
+        editor->reserve(static_cast<qint64>(clipboardLength) * editor->selections() * 3);
+        editor->pasteFromClipboard();
+    });
     connect(ui->actionSelectAll, &QAction::triggered, this, [=]() { currentEditor()->selectAll(); });
     connect(ui->actionSelectNext, &QAction::triggered, this, [=]() {
         ScintillaNext *editor = currentEditor();
@@ -273,6 +435,34 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         editor->targetWholeDocument();
         editor->multipleSelectAddNext();
     });
+    connect(ui->actionSelectAllInstances, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        const int main = editor->mainSelection();
+        int start = editor->selectionNStart(main);
+        int end = editor->selectionNEnd(main);
+        int flags = SCFIND_MATCHCASE;
+
+        // Same as Scintilla's multiple selection, an empty selection means the whole word at the caret
+        if (start == end) {
+            start = editor->wordStartPosition(start, true);
+            end = editor->wordEndPosition(end, true);
+            flags |= SCFIND_WHOLEWORD;
+
+            if (start == end)
+                return;
+        }
+
+        const std::vector<Sci_CharacterRange> matches = editor->findAllMatches(editor->get_text_range(start, end), flags);
+        if (matches.empty())
+            return;
+
+        // Keep the main selection on the text it started on so the view doesn't jump
+        const auto it = std::lower_bound(matches.begin(), matches.end(), start, [](const Sci_CharacterRange &range, int position) {
+            return range.cpMax <= position;
+        });
+
+        editor->selectRanges(matches, static_cast<int>(std::distance(matches.begin(), qMin(it, matches.end() - 1))));
+    });
     connect(ui->actionCopyFullPath, &QAction::triggered, this, [=]() {
         auto editor = currentEditor();
         if (editor->isFile()) {
@@ -290,13 +480,11 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     });
 
     connect(ui->actionCopyAsHtml, &QAction::triggered, this, [=]() {
-        HtmlConverter html(currentEditor());
-        copyAsFormat(&html, "text/html");
+        copyAsFormat("text/html", [](ScintillaNext *editor) { return new HtmlConverter(editor); });
     });
 
     connect(ui->actionCopyAsRtf, &QAction::triggered, this, [=]() {
-        RtfConverter rtf(currentEditor());
-        copyAsFormat(&rtf, "Rich Text Format");
+        copyAsFormat("Rich Text Format", [](ScintillaNext *editor) { return new RtfConverter(editor); });
     });
 
     connect(ui->actionIncrease_Indent, &QAction::triggered, this, [=]() { currentEditor()->tab(); });
@@ -313,7 +501,7 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     srDock->toggleViewAction()->setShortcut(Qt::Key_F7);
     ui->menuView->addAction(srDock->toggleViewAction());
 
-    connect(srDock, &SearchResultsDock::searchResultActivated, this, [=](ScintillaNext *editor, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning) {
+    auto goToSearchResult = [=](ScintillaNext *editor, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning) {
         dockedEditor->switchToEditor(editor);
 
         int linePos = editor->positionFromLine(lineNumber);
@@ -321,6 +509,21 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         editor->verticalCentreCaret();
 
         editor->grabFocus();
+    };
+    connect(srDock, &SearchResultsDock::searchResultActivated, this, goToSearchResult);
+    connect(srDock, &SearchResultsDock::exportToNewTabRequested, this, [=]() {
+        newFile();
+        srDock->writeResults(currentEditor());
+    });
+    connect(srDock, &SearchResultsDock::fileSearchResultActivated, this, [=](const QString &filePath, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning) {
+        openFile(filePath);
+
+        ScintillaNext *editor = app->getEditorManager()->getEditorByFilePath(filePath);
+
+        // The file may no longer exist
+        if (editor) {
+            goToSearchResult(editor, lineNumber, startPositionFromBeginning, endPositionFromBeginning);
+        }
     });
 
     connect(ui->actionFind, &QAction::triggered, this, [=]() {
@@ -347,25 +550,248 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         quickFind->show();
     });
 
+    connect(ui->actionFilterLines, &QAction::triggered, this, [=]() {
+        LineFilterWidget *lineFilter = findChild<LineFilterWidget *>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (lineFilter == Q_NULLPTR) {
+            lineFilter = new LineFilterWidget(this);
+        }
+
+        lineFilter->setEditor(currentEditor());
+        lineFilter->setFocus();
+        lineFilter->show();
+    });
+
     connect(ui->actionReplace, &QAction::triggered, this, [=]() {
         showFindReplaceDialog(FindReplaceDialog::REPLACE_TAB);
     });
 
+    connect(ui->actionFindInFiles, &QAction::triggered, this, [=]() {
+        showFindReplaceDialog(FindReplaceDialog::FIND_IN_FILES_TAB);
+    });
+
+    connect(ui->actionMark, &QAction::triggered, this, [=]() {
+        showFindReplaceDialog(FindReplaceDialog::MARK_TAB);
+    });
+
     connect(ui->actionGoToLine, &QAction::triggered, this, [=]() {
         ScintillaNext *editor = currentEditor();
         const int currentLine = editor->lineFromPosition(editor->currentPos()) + 1;
-        const int maxLine = editor->lineCount();
         bool ok;
 
+        // Until the whole file is there it isn't known how many lines it has, a line past the end of what has been
+        // read so far is gone to once it is
+        const bool loading = editor->isLoading();
+        const int maxLine = loading ? INT_MAX : editor->lineCount();
+        const QString label = loading ? tr("Line Number (%1 read so far)").arg(editor->lineCount()) : tr("Line Number (1 - %1)").arg(maxLine);
+
         QInputDialog d = QInputDialog(this);
         Qt::WindowFlags flags = d.windowFlags() & ~Qt::WindowContextHelpButtonHint;
-        int lineToGoTo = d.getInt(this, tr("Go to line"), tr("Line Number (1 - %1)").arg(maxLine), currentLine, 1, maxLine, 1, &ok, flags);
+        int lineToGoTo = d.getInt(this, tr("Go to line"), label, currentLine, 1, maxLine, 1, &ok, flags);
 
         if (ok) {
-            editor->ensureVisible(lineToGoTo - 1);
-            editor->gotoLine(lineToGoTo - 1);
-            editor->verticalCentreCaret();
+            editor->gotoLineWhenLoaded(lineToGoTo - 1);
+        }
+    });
+
+    connect(ui->actionCsvMode, &QAction::triggered, this, [=](bool enabled) {
+        ScintillaNext *editor = currentEditor();
+
+        CsvColumns::forEditor(editor)->setEnabled(enabled);
+        updateCsvBasedUi(editor);
+    });
+
+    connect(ui->actionCsvDelimiter, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        CsvColumns *columns = CsvColumns::forEditor(editor);
+
+        const QStringList names{tr("Comma"), tr("Tab"), tr("Semicolon"), tr("Pipe")};
+        const QByteArray delimiters(",\t;|");
+
+        bool ok = false;
+        const int current = qMax(0, delimiters.indexOf(columns->delimiter()));
+        const QString name = QInputDialog::getItem(this, tr("CSV Delimiter"), tr("Fields are separated by:"), names, current, false, &ok);
+        if (!ok)
+            return;
+
+        columns->setDelimiter(delimiters.at(names.indexOf(name)));
+        updateCsvBasedUi(editor);
+    });
+
+    connect(ui->actionAlignCsvColumns, &QAction::triggered, this, [=](bool aligned) {
+        CsvColumns::forEditor(currentEditor())->setAligned(aligned);
+    });
+
+    connect(ui->actionSelectCsvColumn, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        CsvColumns *columns = CsvColumns::forEditor(editor);
+
+        columns->selectColumn(columns->columnAt(editor->currentPos()));
+    });
+
+    connect(ui->actionSortByCsvColumn, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        CsvColumns *columns = CsvColumns::forEditor(editor);
+
+        QStringList titles;
+        QStringList names;
+        for (const LineTransforms::Transform &transform : LineTransforms::transforms()) {
+            if (transform.name.startsWith(QStringLiteral("SortLines"))) {
+                titles.append(QCoreApplication::translate("LineTransforms", transform.title));
+                names.append(transform.name);
+            }
+        }
+
+        const int column = columns->columnAt(editor->currentPos()) + 1;
+
+        bool ok = false;
+        const QString title = QInputDialog::getItem(this, tr("Sort by Column"), tr("Sort by column %1:").arg(column), titles, 0, false, &ok);
+        if (!ok)
+            return;
+
+        LineTransforms::Context context;
+        context.field = column;
+        context.separator = QByteArray(1, columns->delimiter());
+        context.quoted = true;
+
+        LineTransforms::apply(editor, names.at(titles.indexOf(title)), context);
+    });
+
+    connect(ui->actionCompareWith, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+
+        QVector<ScintillaNext *> others;
+        QStringList names;
+        for (ScintillaNext *other : dockedEditor->editors()) {
+            // Another view of the same document would always be the same
+            if (other->documentOwner() != editor->documentOwner()) {
+                others.append(other);
+                names.append(other->getName());
+            }
+        }
+
+        if (others.isEmpty()) {
+            QMessageBox::information(this, tr("Compare"), tr("Open another document to compare this one with."));
+            return;
+        }
+
+        bool ok = false;
+        const QString name = QInputDialog::getItem(this, tr("Compare"), tr("Compare %1 with:").arg(editor->getName()), names, 0, false, &ok);
+        if (!ok)
+            return;
+
+        compareWith(editor, others.at(names.indexOf(name)));
+    });
+
+    connect(ui->actionNextDifference, &QAction::triggered, this, [=]() {
+        if (documentCompare && !documentCompare->goToDifference(currentEditor(), true)) {
+            FadingIndicator::showText(currentEditor(), tr("No more differences"));
+        }
+    });
+
+    connect(ui->actionPreviousDifference, &QAction::triggered, this, [=]() {
+        if (documentCompare && !documentCompare->goToDifference(currentEditor(), false)) {
+            FadingIndicator::showText(currentEditor(), tr("No more differences"));
+        }
+    });
+
+    connect(ui->actionStopComparing, &QAction::triggered, this, [=]() {
+        if (documentCompare) {
+            delete documentCompare;
         }
+        updateCompareBasedUi(currentEditor());
+    });
+
+    connect(ui->actionGoToTime, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        LogTimestampIndex *logIndex = LogTimestampIndex::forEditor(editor);
+
+        if (logIndex == Q_NULLPTR || !logIndex->isLog()) {
+            QMessageBox::information(this, tr("Go to Time"), tr("No timestamps were found at the start of the lines of this document."));
+            return;
+        }
+
+        const qint64 currentTime = logIndex->timeOfLine(editor->lineFromPosition(editor->currentPos()));
+        bool ok;
+
+        QInputDialog d = QInputDialog(this);
+        Qt::WindowFlags flags = d.windowFlags() & ~Qt::WindowContextHelpButtonHint;
+        const QString text = d.getText(this, tr("Go to Time"), tr("Time:"), QLineEdit::Normal, logIndex->formatTime(currentTime), &ok, flags);
+
+        if (!ok)
+            return;
+
+        const qint64 time = logIndex->parseTime(text);
+
+        if (time < 0) {
+            QMessageBox::warning(this, tr("Go to Time"), tr("\"%1\" is not a time that can be understood.").arg(text));
+            return;
+        }
+
+        // Anything later than the whole log ends up on the last line
+        Sci_Position line = logIndex->lineAtOrAfter(time);
+        if (line < 0) {
+            line = editor->lineCount() - 1;
+        }
+
+        editor->ensureVisible(line);
+        editor->gotoLine(line);
+        editor->verticalCentreCaret();
+    });
+
+    connect(ui->actionShowTimeRange, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        LogTimestampIndex *logIndex = LogTimestampIndex::forEditor(editor);
+
+        if (logIndex == Q_NULLPTR || !logIndex->isLog()) {
+            QMessageBox::information(this, tr("Show Time Range"), tr("No timestamps were found at the start of the lines of this document."));
+            return;
+        }
+
+        QDialog dialog(this);
+        dialog.setWindowTitle(tr("Show Time Range"));
+        dialog.setWindowFlag(Qt::WindowContextHelpButtonHint, false);
+
+        const std::vector<LogTimestampIndex::Sample> &samples = logIndex->samples();
+        QLineEdit *from = new QLineEdit(samples.empty() ? QString() : logIndex->formatTime(samples.front().time));
+        QLineEdit *to = new QLineEdit(samples.empty() ? QString() : logIndex->formatTime(samples.back().time));
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel | QDialogButtonBox::Reset);
+        buttons->button(QDialogButtonBox::Reset)->setText(tr("Show All Lines"));
+        connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+        connect(buttons->button(QDialogButtonBox::Reset), &QPushButton::clicked, &dialog, [&]() {
+            LineFilter::forEditor(editor)->clear();
+            dialog.reject();
+        });
+
+        QFormLayout *layout = new QFormLayout(&dialog);
+        layout->addRow(tr("From:"), from);
+        layout->addRow(tr("To:"), to);
+        layout->addRow(buttons);
+
+        if (dialog.exec() != QDialog::Accepted)
+            return;
+
+        const qint64 startTime = logIndex->parseTime(from->text());
+        const qint64 endTime = logIndex->parseTime(to->text());
+
+        if (startTime < 0 || endTime < 0 || endTime < startTime) {
+            QMessageBox::warning(this, tr("Show Time Range"), tr("The range from \"%1\" to \"%2\" can not be understood.").arg(from->text(), to->text()));
+            return;
+        }
+
+        // Everything up to the first line that is later than the end, so the whole last second is included
+        // along with anything such as a stack trace that follows the last line in the range
+        const Sci_Position firstLine = logIndex->lineAtOrAfter(startTime);
+        const Sci_Position afterLast = logIndex->lineAtOrAfter(endTime + 1);
+
+        if (firstLine < 0 || firstLine == afterLast) {
+            QMessageBox::information(this, tr("Show Time Range"), tr("Nothing was logged between those times."));
+            return;
+        }
+
+        LineFilter::forEditor(editor)->setLineRange(firstLine, afterLast < 0 ? editor->lineCount() - 1 : afterLast - 1);
     });
 
     connect(ui->actionToggleBookmark, &QAction::triggered, this, [=]() {
@@ -408,12 +834,46 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         BookMarkDecorator *bookMarkDecorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
 
         if (bookMarkDecorator && bookMarkDecorator->isEnabled()) {
-            for (int line = 0; line < editor->lineCount(); line++) {
-                bookMarkDecorator->toggleBookmark(line);
+            bookMarkDecorator->invertBookmarks();
+        }
+    });
+
+    connect(ui->actionCopyBookmarkedLines, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        BookMarkDecorator *bookMarkDecorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (bookMarkDecorator && bookMarkDecorator->isEnabled()) {
+            const QByteArray text = bookMarkDecorator->bookMarkedText();
+
+            if (!text.isEmpty()) {
+                editor->copyText(text.size(), text.constData());
+            }
+        }
+    });
+
+    connect(ui->actionCutBookmarkedLines, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        BookMarkDecorator *bookMarkDecorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (bookMarkDecorator && bookMarkDecorator->isEnabled()) {
+            const QByteArray text = bookMarkDecorator->bookMarkedText();
+
+            if (!text.isEmpty()) {
+                editor->copyText(text.size(), text.constData());
+                bookMarkDecorator->deleteBookMarkedLines();
             }
         }
     });
 
+    connect(ui->actionDeleteBookmarkedLines, &QAction::triggered, this, [=]() {
+        ScintillaNext *editor = currentEditor();
+        BookMarkDecorator *bookMarkDecorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (bookMarkDecorator && bookMarkDecorator->isEnabled()) {
+            bookMarkDecorator->deleteBookMarkedLines();
+        }
+    });
+
     connect(ui->actionPreviousBookmark, &QAction::triggered, this, [=]() {
         ScintillaNext *editor = currentEditor();
         BookMarkDecorator *bookMarkDecorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
@@ -527,6 +987,10 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     connect(app->getSettings(), &ApplicationSettings::wordWrapChanged, ui->actionWordWrap, &QAction::setChecked);
     connect(ui->actionWordWrap, &QAction::toggled, app->getSettings(), &ApplicationSettings::setWordWrap);
 
+    ui->actionSpellCheck->setChecked(app->getSettings()->spellCheck());
+    connect(app->getSettings(), &ApplicationSettings::spellCheckChanged, ui->actionSpellCheck, &QAction::setChecked);
+    connect(ui->actionSpellCheck, &QAction::toggled, app->getSettings(), &ApplicationSettings::setSpellCheck);
+
     // Zooming controls all editors simulaneously
     connect(ui->actionZoomIn, &QAction::triggered, this, [=]() {
         for (ScintillaNext *editor : editors()) {
@@ -595,9 +1059,9 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         pd->activateWindow();
     });
 
-    // The macro manager has already loaded any saved macros, so it might have some already
-    ui->actionRunMacroMultipleTimes->setEnabled(macroManager.availableMacros().size() > 0);
-    ui->actionEditMacros->setEnabled(macroManager.availableMacros().size() > 0);
+    // The macro manager might have some saved macros already, this checks without loading them
+    ui->actionRunMacroMultipleTimes->setEnabled(macroManager.hasMacros());
+    ui->actionEditMacros->setEnabled(macroManager.hasMacros());
 
     connect(ui->actionMacroRecording, &QAction::triggered, this, [=](bool b) {
         if (b) {
@@ -625,7 +1089,7 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         ui->actionSaveCurrentRecordedMacro->setEnabled(macroManager.hasCurrentUnsavedMacro());
 
         // The macro manager might have other macros
-        ui->actionRunMacroMultipleTimes->setEnabled(macroManager.availableMacros().size() > 0 || macroManager.hasCurrentUnsavedMacro());
+        ui->actionRunMacroMultipleTimes->setEnabled(macroManager.hasMacros() || macroManager.hasCurrentUnsavedMacro());
     });
 
     connect(ui->actionPlayback, &QAction::triggered, this, [=]() {
@@ -663,11 +1127,57 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
         if (macroRunDialog == Q_NULLPTR) {
             macroRunDialog = new MacroRunDialog(this, &macroManager);
 
-            connect(macroRunDialog, &MacroRunDialog::execute, this, [=](Macro *macro, int times) {
-                if (times > 0)
-                    macro->replay(currentEditor(), times);
-                else if (times == -1)
-                    macro->replayTillEndOfFile(currentEditor());
+            connect(macroRunDialog, &MacroRunDialog::execute, this, [=](Macro *macro, int times, bool lineByLine) {
+                MacroPlayer *player = new MacroPlayer(macro, currentEditor(), times, macroRunDialog);
+                player->setLineByLine(lineByLine);
+
+                connect(player, &MacroPlayer::progressChanged, macroRunDialog, &MacroRunDialog::setProgress);
+                connect(player, &MacroPlayer::finished, macroRunDialog, &MacroRunDialog::runFinished);
+                connect(player, &MacroPlayer::finished, player, &QObject::deleteLater);
+                connect(macroRunDialog, &MacroRunDialog::cancelRequested, player, &MacroPlayer::cancel);
+
+                macroRunDialog->runStarted();
+                player->start();
+            });
+
+            connect(macroRunDialog, &MacroRunDialog::executeInDocuments, this, [=](Macro *macro, int times, bool lineByLine, const QString &folder, const QString &filters) {
+                BatchProcessor::Options options;
+                options.macroTimes = times > 0 ? times : 0;
+                options.lineByLine = lineByLine;
+                options.writeReport = false;
+
+                if (folder.isEmpty()) {
+                    options.editors = editors();
+                }
+                else {
+                    // Files that aren't open are changed and saved without ever being shown, the open ones are left to be saved
+                    options.paths.append(folder);
+                    options.filters = filters;
+                    options.useEditorManager = false;
+                }
+
+                BatchProcessor *batch = new BatchProcessor(app);
+                batch->setMacro(*macro);
+
+                connect(batch, &BatchProcessor::progressChanged, macroRunDialog, &MacroRunDialog::setProgress);
+                connect(batch, &BatchProcessor::finished, macroRunDialog, &MacroRunDialog::runFinished);
+                connect(batch, &BatchProcessor::finished, this, [=]() {
+                    QMessageBox box(QMessageBox::Information, tr("Run Macro"), batch->summary(), QMessageBox::Ok, this);
+                    box.setDetailedText(batch->report());
+                    box.exec();
+
+                    batch->deleteLater();
+                });
+                connect(macroRunDialog, &MacroRunDialog::cancelRequested, batch, &BatchProcessor::cancel);
+
+                QString error;
+                if (!batch->start(options, error)) {
+                    delete batch;
+                    QMessageBox::warning(this, tr("Run Macro"), error);
+                    return;
+                }
+
+                macroRunDialog->runStarted();
             });
         }
 
@@ -685,7 +1195,7 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
 
         med.exec();
 
-        ui->actionEditMacros->setEnabled(macroManager.availableMacros().size() > 0);
+        ui->actionEditMacros->setEnabled(macroManager.hasMacros());
     });
 
     connect(ui->menuMacro, &QMenu::aboutToShow, this, [=]() {
@@ -726,44 +1236,54 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     });
 #endif
 
-    EditorInspectorDock *editorInspectorDock = new EditorInspectorDock(this);
-    editorInspectorDock->hide();
-    addDockWidget(Qt::RightDockWidgetArea, editorInspectorDock);
+    TraceScope docksTrace("Docks");
 
-    LanguageInspectorDock *languageInspectorDock = new LanguageInspectorDock(this);
-    languageInspectorDock->hide();
-    addDockWidget(Qt::RightDockWidgetArea, languageInspectorDock);
+    // Most docks are never opened in a typical session, so their menu entries stand in for
+    // them until the first time they are shown. See restoreWindowState() for ones that were left open.
+    QAction *firstHelpAction = ui->menuHelp->actions().at(0);
 
-    LuaConsoleDock *luaConsoleDock = new LuaConsoleDock(app->getLuaState(), this);
-    luaConsoleDock->hide();
-    addDockWidget(Qt::BottomDockWidgetArea, luaConsoleDock);
+    addDeferredDock(QStringLiteral("LuaConsoleDock"), tr("Lua Console"), Qt::BottomDockWidgetArea, ui->menuHelp, firstHelpAction, [=]() {
+        return new LuaConsoleDock(app->getLuaState(), this);
+    });
+    addDeferredDock(QStringLiteral("LanguageInspectorDock"), tr("Language Inspector"), Qt::RightDockWidgetArea, ui->menuHelp, firstHelpAction, [=]() {
+        return new LanguageInspectorDock(this);
+    });
+    addDeferredDock(QStringLiteral("EditorInspectorDock"), tr("Editor Inspector"), Qt::RightDockWidgetArea, ui->menuHelp, firstHelpAction, [=]() {
+        return new EditorInspectorDock(this);
+    });
 
+    // The log only shows messages that arrive after it exists, so it can't wait until it is opened
     DebugLogDock *debugLogDock = new DebugLogDock(this);
     debugLogDock->hide();
     addDockWidget(Qt::RightDockWidgetArea, debugLogDock);
+    ui->menuHelp->insertAction(firstHelpAction, debugLogDock->toggleViewAction());
+
+    addDeferredDock(QStringLiteral("HexViewerDock"), tr("Hex Viewer"), Qt::RightDockWidgetArea, ui->menuHelp, firstHelpAction, [=]() {
+        return new HexViewerDock(this);
+    });
+    addDeferredDock(QStringLiteral("PerformanceDock"), tr("Performance"), Qt::BottomDockWidgetArea, ui->menuHelp, firstHelpAction, [=]() {
+        return new PerformanceDock(this);
+    });
+
+    addDeferredDock(QStringLiteral("FolderAsWorkspaceDock"), tr("Folder as Workspace"), Qt::LeftDockWidgetArea, ui->menuView, Q_NULLPTR, [=]() {
+        FolderAsWorkspaceDock *fawDock = new FolderAsWorkspaceDock(this);
+        connect(fawDock, &FolderAsWorkspaceDock::fileDoubleClicked, this, &MainWindow::openFile);
+        return fawDock;
+    });
+    addDeferredDock(QStringLiteral("FileList"), tr("File List"), Qt::LeftDockWidgetArea, ui->menuView, Q_NULLPTR, [=]() {
+        return new FileListDock(this);
+    });
+    addDeferredDock(QStringLiteral("OutlineDock"), tr("Outline"), Qt::LeftDockWidgetArea, ui->menuView, Q_NULLPTR, [=]() {
+        return new OutlineDock(this);
+    });
+    addDeferredDock(QStringLiteral("MinimapDock"), tr("Minimap"), Qt::RightDockWidgetArea, ui->menuView, Q_NULLPTR, [=]() {
+        return new MinimapDock(this);
+    });
+    addDeferredDock(QStringLiteral("StatisticsDock"), tr("Statistics"), Qt::RightDockWidgetArea, ui->menuView, Q_NULLPTR, [=]() {
+        return new StatisticsDock(this);
+    });
 
-    HexViewerDock *hexViewerDock = new HexViewerDock(this);
-    hexViewerDock->hide();
-    addDockWidget(Qt::RightDockWidgetArea, hexViewerDock);
-
-    ui->menuHelp->insertActions(ui->menuHelp->actions().at(0), {
-                                    luaConsoleDock->toggleViewAction(),
-                                    languageInspectorDock->toggleViewAction(),
-                                    editorInspectorDock->toggleViewAction(),
-                                    debugLogDock->toggleViewAction(),
-                                    hexViewerDock->toggleViewAction()
-                                });
-
-    FolderAsWorkspaceDock *fawDock = new FolderAsWorkspaceDock(this);
-    fawDock->hide();
-    addDockWidget(Qt::LeftDockWidgetArea, fawDock);
-    ui->menuView->addAction(fawDock->toggleViewAction());
-    connect(fawDock, &FolderAsWorkspaceDock::fileDoubleClicked, this, &MainWindow::openFile);
-
-    FileListDock *fileListDock = new FileListDock(this);
-    fileListDock->hide();
-    addDockWidget(Qt::LeftDockWidgetArea, fileListDock);
-    ui->menuView->addAction(fileListDock->toggleViewAction());
+    docksTrace.end();
 
     connect(app->getSettings(), &ApplicationSettings::showMenuBarChanged, this, [=](bool showMenuBar) {
         // Don't 'hide' it, else the actions won't be enabled
@@ -775,9 +1295,23 @@ MainWindow::MainWindow(NotepadNextApplication *app) :
     // It seems restoreState() does not affect the status bar so set it manually
     ui->statusBar->setVisible(app->getSettings()->showStatusBar());
 
+    setupEncodingMenu();
+
+    // There is an entry per language, so the menu isn't filled in until it is first opened
+#ifdef Q_OS_MACOS
+    // The native menu bar may not ask an empty menu to show itself
     setupLanguageMenu();
+#else
+    connect(ui->menuLanguage, &QMenu::aboutToShow, this, [=]() {
+        if (languageActionGroup->actions().isEmpty()) {
+            setupLanguageMenu();
 
-    applyStyleSheet();
+            if (currentEditor() != Q_NULLPTR) {
+                updateLanguageBasedUi(currentEditor());
+            }
+        }
+    });
+#endif
 
     restoreSettings();
 
@@ -810,6 +1344,47 @@ void MainWindow::applyCustomShortcuts()
     settings->endGroup();
 }
 
+void MainWindow::setupEncodingMenu()
+{
+    qInfo(Q_FUNC_INFO);
+
+    struct Encoding {
+        QString text;
+        QByteArray codecName;
+        bool byteOrderMark;
+    };
+
+    const QVector<Encoding> encodings = {
+        {tr("UTF-8"), QByteArrayLiteral("UTF-8"), false},
+        {tr("UTF-8 with BOM"), QByteArrayLiteral("UTF-8"), true},
+        {tr("UTF-16 LE with BOM"), QByteArrayLiteral("UTF-16LE"), true},
+        {tr("UTF-16 BE with BOM"), QByteArrayLiteral("UTF-16BE"), true},
+        {tr("Windows-1252"), QByteArrayLiteral("windows-1252"), false},
+        {tr("ISO-8859-1"), QByteArrayLiteral("ISO-8859-1"), false},
+    };
+
+    QMenu *convertMenu = ui->menuEncodings->addMenu(tr("Convert To"));
+    QMenu *saveCopyMenu = ui->menuEncodings->addMenu(tr("Save a Copy In"));
+
+    for (const Encoding &encoding : encodings) {
+        QTextCodec *codec = QTextCodec::codecForName(encoding.codecName);
+
+        if (codec == Q_NULLPTR) {
+            continue;
+        }
+
+        const bool withByteOrderMark = encoding.byteOrderMark;
+
+        // Converting only changes what the next save writes, which streams through the codec the same as any save
+        connect(convertMenu->addAction(encoding.text), &QAction::triggered, this, [=]() {
+            currentEditor()->convertEncoding(codec, withByteOrderMark);
+        });
+        connect(saveCopyMenu->addAction(encoding.text + QStringLiteral("...")), &QAction::triggered, this, [=]() {
+            saveCopyInEncodingDialog(codec, withByteOrderMark);
+        });
+    }
+}
+
 void MainWindow::setupLanguageMenu()
 {
     qInfo(Q_FUNC_INFO);
@@ -860,10 +1435,8 @@ int MainWindow::editorCount() const
 
 QVector<ScintillaNext *> MainWindow::editors() const
 {
-    // NOTE: this will need re-evaluated in the future.
-    // So far it has been assumed 1 ScintillaNext instance is 1 DockedEditor widget instance.
-    // If in the future a ScintillaNext can be cloned then the DockedEditor could return
-    // the same ScintillaNext instance multiple times since 1 ScintillaNext could mean >= 1 DockedEditor widget instance
+    // Each ScintillaNext instance is 1 DockedEditor widget instance. A clone is an instance of its own that
+    // shares the document of another one, see ScintillaNext::isClone()
     return dockedEditor->editors();
 }
 
@@ -910,6 +1483,51 @@ ScintillaNext *MainWindow::getInitialEditor()
     return Q_NULLPTR;
 }
 
+// The window waits for the files to be stat'ed, so that can't be queued behind whatever else is on the global pool,
+// e.g. a Find in Files that keeps its threads for as long as it runs
+Q_GLOBAL_STATIC(QThreadPool, statPool)
+
+// Stat'ing is mostly waiting on the file system, so a lot of files get split up and done in parallel. The last part
+// is done here while waiting for the others.
+static QVector<QFileInfo> statFiles(const QStringList &filePaths)
+{
+    QVector<QFileInfo> fileInfos(filePaths.size());
+    QFileInfo *out = fileInfos.data();
+
+    const int threads = qMax(1, statPool()->maxThreadCount());
+    const int perTask = (filePaths.size() + threads - 1) / threads;
+    QSemaphore done;
+    int tasks = 0;
+
+    for (int start = 0; start < filePaths.size(); start += perTask) {
+        const int end = qMin(start + perTask, static_cast<int>(filePaths.size()));
+
+        auto stat = [&filePaths, out, start, end]() {
+            for (int i = start; i < end; ++i) {
+                QFileInfo fileInfo(filePaths[i]);
+                fileInfo.exists(); // fills in the cached details
+                out[i] = fileInfo;
+            }
+        };
+
+        if (end < filePaths.size()) {
+            statPool()->start([&done, stat]() {
+                stat();
+                done.release();
+            });
+
+            ++tasks;
+        }
+        else {
+            stat();
+        }
+    }
+
+    done.acquire(tasks);
+
+    return fileInfos;
+}
+
 void MainWindow::openFileList(const QStringList &fileNames)
 {
     qInfo(Q_FUNC_INFO);
@@ -920,15 +1538,29 @@ void MainWindow::openFileList(const QStringList &fileNames)
     ScintillaNext *initialEditor = getInitialEditor();
     const ScintillaNext *mostRecentEditor = Q_NULLPTR;
 
-    for (const QString &filePath : fileNames) {
+    // When opening a batch of files (e.g. dropped on the window or passed on the command line) none of them are read
+    // yet, only the one that ends up shown is read straight away and the rest once they are looked at. See below.
+    const bool batch = fileNames.size() > 1;
+    const QVector<QFileInfo> fileInfos = batch ? statFiles(fileNames) : QVector<QFileInfo>{QFileInfo(fileNames.first())};
+
+    // Hold off drawing the tabs until they are all there
+    const bool wereUpdatesEnabled = updatesEnabled();
+    if (batch) {
+        setUpdatesEnabled(false);
+    }
+
+    QList<QPointer<ScintillaNext>> deferred;
+
+    for (int i = 0; i < fileNames.size(); ++i) {
+        const QString &filePath = fileNames[i];
+        const QFileInfo &fileInfo = fileInfos[i];
+
         qInfo("%s", qUtf8Printable(filePath));
 
         // Search currently open editors to see if it is already open
         ScintillaNext *editor = app->getEditorManager()->getEditorByFilePath(filePath);
 
         if (editor == Q_NULLPTR) {
-            QFileInfo fileInfo(filePath);
-
             if (!fileInfo.isFile()) {
                 auto reply = QMessageBox::question(this, tr("Create File"), tr("<b>%1</b> does not exist. Do you want to create it?").arg(filePath));
 
@@ -943,6 +1575,22 @@ void MainWindow::openFileList(const QStringList &fileNames)
                     continue;
                 }
             }
+            else if (EncodingDetector::isBinaryFile(filePath)) {
+                // Decoding, lexing and indexing the "lines" of a binary file is a lot of work for nothing useful
+                if (HexFileViewer *viewer = openInHexViewer(filePath)) {
+                    viewer->offerOpenAsText();
+                    connect(viewer, &HexFileViewer::openAsTextRequested, this, &MainWindow::openAsText);
+                }
+                continue;
+            }
+            else if (shouldOpenInLargeFileViewer(fileInfo)) {
+                openInLargeFileViewer(filePath);
+                continue;
+            }
+            else if (batch) {
+                editor = app->getEditorManager()->createDeferredEditorFromFile(filePath);
+                deferred.append(editor);
+            }
             else {
                 editor = app->getEditorManager()->createEditorFromFile(filePath);
             }
@@ -961,12 +1609,107 @@ void MainWindow::openFileList(const QStringList &fileNames)
     if (initialEditor) {
         initialEditor->close();
     }
+
+    if (batch) {
+        setUpdatesEnabled(wereUpdatesEnabled);
+    }
+
+    // The shown editor reads its file as soon as it is visible, the others are read a little at a time afterwards
+    app->getEditorManager()->loadDeferredEditors(deferred);
+}
+
+bool MainWindow::shouldOpenInLargeFileViewer(const QFileInfo &fileInfo)
+{
+    const qint64 threshold = static_cast<qint64>(app->getSettings()->largeFileThreshold()) * 1024 * 1024;
+
+    if (threshold <= 0 || fileInfo.size() < threshold)
+        return false;
+
+    const QString size = QLocale().formattedDataSize(fileInfo.size());
+    auto reply = QMessageBox::question(this, tr("Large File"), tr("<b>%1</b> is %2. Do you want to open it in the read only viewer instead?<br><br>The viewer opens it instantly and uses very little memory, but the file can not be edited.").arg(fileInfo.fileName(), size));
+
+    return reply == QMessageBox::Yes;
+}
+
+void MainWindow::openInLargeFileViewer(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    LargeFileViewer *viewer = new LargeFileViewer(this);
+    viewer->setWindowFlag(Qt::Window);
+
+    if (!viewer->openFile(filePath)) {
+        delete viewer;
+        QMessageBox::warning(this, tr("Error Opening File"), tr("<b>%1</b> could not be opened.").arg(filePath));
+        return;
+    }
+
+    viewer->show();
+}
+
+void MainWindow::openUrlInLargeFileViewer(const QUrl &url)
+{
+    qInfo(Q_FUNC_INFO);
+
+    LargeFileViewer *viewer = new LargeFileViewer(this);
+    viewer->setWindowFlag(Qt::Window);
+
+    // Any error is shown by the viewer once the server answers
+    viewer->openUrl(url);
+    viewer->show();
+}
+
+LargeFileViewer *MainWindow::largeFileViewer(const QString &filePath) const
+{
+    for (LargeFileViewer *viewer : findChildren<LargeFileViewer *>()) {
+        if (QFileInfo(viewer->filePath()) == QFileInfo(filePath)) {
+            return viewer;
+        }
+    }
+
+    return Q_NULLPTR;
+}
+
+HexFileViewer *MainWindow::openInHexViewer(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    HexFileViewer *viewer = new HexFileViewer(this);
+    viewer->setWindowFlag(Qt::Window);
+
+    if (!viewer->openFile(filePath)) {
+        delete viewer;
+        QMessageBox::warning(this, tr("Error Opening File"), tr("<b>%1</b> could not be opened.").arg(filePath));
+        return Q_NULLPTR;
+    }
+
+    viewer->show();
+
+    return viewer;
+}
+
+void MainWindow::openAsText(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    // Unlike openFileList() this skips the check for binary files
+    ScintillaNext *editor = app->getEditorManager()->getEditorByFilePath(filePath);
+
+    if (editor == Q_NULLPTR) {
+        editor = app->getEditorManager()->createEditorFromFile(filePath);
+    }
+
+    if (editor) {
+        dockedEditor->switchToEditor(editor);
+        activateWindow();
+    }
 }
 
 bool MainWindow::checkEditorsBeforeClose(const QVector<ScintillaNext *> &editors)
 {
     for (ScintillaNext *editor : editors) {
-        if (!editor->isSavedToDisk()) {
+        // Closing a clone never loses anything, the document is still open in the editor it came from
+        if (!editor->isClone() && !editor->isSavedToDisk()) {
             // Switch to it
             dockedEditor->switchToEditor(editor);
 
@@ -1028,12 +1771,69 @@ void MainWindow::openFolderAsWorkspaceDialog()
     QString dir = QFileDialog::getExistingDirectory(this, tr("Open Folder as Workspace"), dialogDir, QFileDialog::ShowDirsOnly);
 
     if (!dir.isEmpty()) {
-        FolderAsWorkspaceDock *fawDock = findChild<FolderAsWorkspaceDock *>();
+        FolderAsWorkspaceDock *fawDock = qobject_cast<FolderAsWorkspaceDock *>(ensureDock(QStringLiteral("FolderAsWorkspaceDock")));
         fawDock->setRootPath(dir);
         fawDock->setVisible(true);
     }
 }
 
+void MainWindow::goToFileDialog()
+{
+    FolderAsWorkspaceDock *fawDock = qobject_cast<FolderAsWorkspaceDock *>(ensureDock(QStringLiteral("FolderAsWorkspaceDock")));
+
+    // There needs to be a workspace to look in
+    if (fawDock->rootPath().isEmpty()) {
+        openFolderAsWorkspaceDialog();
+
+        if (fawDock->rootPath().isEmpty()) {
+            return;
+        }
+    }
+
+    QuickOpenDialog *dialog = new QuickOpenDialog(fawDock->workspace(), this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+
+    connect(dialog, &QuickOpenDialog::fileSelected, this, &MainWindow::openFile);
+
+    dialog->show();
+}
+
+void MainWindow::openInHexViewerDialog()
+{
+    QString dialogDir;
+    const ScintillaNext *editor = currentEditor();
+
+    // Use the path if possible
+    if (editor->isFile()) {
+        dialogDir = editor->getPath();
+    }
+
+    const QStringList fileNames = FileDialogHelpers::getOpenFileNames(this, tr("Open in Hex Viewer"), dialogDir);
+
+    for (const QString &fileName : fileNames) {
+        openInHexViewer(fileName);
+    }
+}
+
+void MainWindow::openUrlDialog()
+{
+    bool ok;
+    const QString text = QInputDialog::getText(this, tr("Open URL"), tr("URL of the file (http or https):"), QLineEdit::Normal, QString(), &ok).trimmed();
+
+    if (!ok || text.isEmpty()) {
+        return;
+    }
+
+    const QUrl url = QUrl::fromUserInput(text);
+
+    if (url.scheme() != QLatin1String("http") && url.scheme() != QLatin1String("https")) {
+        QMessageBox::warning(this, tr("Open URL"), tr("Only http and https URLs can be opened."));
+        return;
+    }
+
+    openUrlInLargeFileViewer(url);
+}
+
 void MainWindow::reloadFile()
 {
     auto editor = currentEditor();
@@ -1062,7 +1862,7 @@ void MainWindow::closeFile(ScintillaNext *editor)
         return;
     }
 
-    if(editor->isSavedToDisk()) {
+    if(editor->isClone() || editor->isSavedToDisk()) {
         editor->close();
     }
     else {
@@ -1098,18 +1898,43 @@ void MainWindow::closeFile(ScintillaNext *editor)
     }
 }
 
-void MainWindow::closeAllFiles()
-{
-    if (!checkEditorsBeforeClose(editors())) {
+void MainWindow::closeAllFiles()
+{
+    const QVector<ScintillaNext *> editor_list = editors();
+
+    if (!checkEditorsBeforeClose(editor_list)) {
+        return;
+    }
+
+    // Opened first so there is a tab to switch to that isn't about to be closed as well
+    newFile();
+
+    closeEditors(editor_list);
+}
+
+void MainWindow::switchToWorkspace(const QString &name)
+{
+    qInfo(Q_FUNC_INFO);
+
+    SessionManager *sessionManager = app->getSessionManager();
+
+    if (name == sessionManager->currentWorkspace()) {
         return;
     }
 
-    // Ask the manager to close the editors the dockedEditor knows about
-    for (ScintillaNext *editor : editors()) {
-        editor->close();
+    if (!sessionManager->storeWorkspace(this)) {
+        QMessageBox::warning(this, tr("Switch Workspace"), tr("Not all of the open files could be kept in the workspace \"%1\", so it was not switched.").arg(sessionManager->currentWorkspace()));
+        return;
     }
 
-    newFile();
+    // Everything is in the workspace, so nothing needs asking about
+    closeEditors(editors());
+
+    sessionManager->restoreWorkspace(this, name);
+
+    if (editorCount() == 0) {
+        newFile();
+    }
 }
 
 void MainWindow::closeAllExceptActive()
@@ -1120,9 +1945,7 @@ void MainWindow::closeAllExceptActive()
     editor_list.removeOne(e);
 
     if (checkEditorsBeforeClose(editor_list)) {
-        for (ScintillaNext *editor : editor_list) {
-            editor->close();
-        }
+        closeEditors(editor_list);
     }
 }
 
@@ -1137,9 +1960,7 @@ void MainWindow::closeAllToLeft()
     }
 
     if (checkEditorsBeforeClose(editors)) {
-        for (ScintillaNext *editor : editors) {
-            editor->close();
-        }
+        closeEditors(editors);
     }
 }
 
@@ -1155,18 +1976,24 @@ void MainWindow::closeAllToRight()
     }
 
     if (checkEditorsBeforeClose(editors)) {
-        for (ScintillaNext *editor : editors) {
-            editor->close();
-        }
+        closeEditors(editors);
     }
 }
 
+void MainWindow::closeEditors(const QVector<ScintillaNext *> &editors)
+{
+    // The tabs, file list and recent files only catch up once all of them are gone
+    dockedEditor->beginClosingEditors(editors);
+    app->getEditorManager()->closeEditors(editors);
+    dockedEditor->endClosingEditors();
+}
+
 bool MainWindow::saveCurrentFile()
 {
-    return saveFile(currentEditor());
+    return saveFile(currentEditor(), true);
 }
 
-bool MainWindow::saveFile(ScintillaNext *editor)
+bool MainWindow::saveFile(ScintillaNext *editor, bool allowBackground)
 {
     if (editor->isSavedToDisk())
         return true;
@@ -1176,6 +2003,11 @@ bool MainWindow::saveFile(ScintillaNext *editor)
         dockedEditor->switchToEditor(editor);
         return saveCurrentFileAsDialog();
     }
+    else if (allowBackground && editor->textLength() >= BACKGROUND_SAVE_THRESHOLD) {
+        // Any error gets reported once it finishes
+        editor->saveInBackground();
+        return true;
+    }
     else {
         QFileDevice::FileError error = editor->save();
         if (error == QFileDevice::NoError) {
@@ -1253,6 +2085,29 @@ bool MainWindow::saveCopyAsDialog()
     return saveCopyAs(fileName);
 }
 
+bool MainWindow::saveCopyInEncodingDialog(QTextCodec *codec, bool withByteOrderMark)
+{
+    QString dialogDir;
+    const QString filter = app->getFileDialogFilter();
+    ScintillaNext *editor = currentEditor();
+
+    // Use the file path if possible
+    if (editor->isFile()) {
+        dialogDir = editor->getFilePath();
+    }
+
+    QString selectedFilter = app->getFileDialogFilterForLanguage(editor->languageName);
+    QString fileName = FileDialogHelpers::getSaveFileName(this, tr("Save a Copy In %1").arg(QString::fromLatin1(codec->name())), dialogDir, filter, &selectedFilter);
+
+    if (fileName.size() == 0) {
+        return false;
+    }
+
+    // Any error gets reported once it finishes
+    editor->saveCopyInEncoding(fileName, codec, withByteOrderMark);
+    return true;
+}
+
 bool MainWindow::saveCopyAs(const QString &fileName)
 {
     auto editor = currentEditor();
@@ -1271,7 +2126,7 @@ bool MainWindow::saveCopyAs(const QString &fileName)
 void MainWindow::saveAll()
 {
     for (ScintillaNext *editor : editors()) {
-        saveFile(editor);
+        saveFile(editor, true);
     }
 }
 
@@ -1283,30 +2138,296 @@ void MainWindow::exportAsFormat(Converter *converter, const QString &filter)
         return;
     }
 
-    QFile f(fileName);
+    QSaveFile f(fileName);
+
+    if (!f.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, tr("Error Saving File"), tr("An error occurred when saving <b>%1</b><br><br>Error: %2").arg(fileName, f.errorString()));
+        return;
+    }
+
+    ScintillaNext *editor = currentEditor();
+    QProgressDialog progress(tr("Exporting %1...").arg(editor->getName()), tr("Cancel"), 0, 100, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+
+    // The output is written as it is made, so only a chunk of it is ever held in memory
+    const bool finished = converter->exportRange(&f, 0, editor->length(), [&](int percent) {
+        progress.setValue(percent);
+        return !progress.wasCanceled();
+    });
+
+    if (!finished) {
+        f.cancelWriting();
+
+        if (!progress.wasCanceled()) {
+            QMessageBox::warning(this, tr("Error Saving File"), tr("An error occurred when saving <b>%1</b><br><br>Error: %2").arg(fileName, f.errorString()));
+        }
+
+        return;
+    }
+
+    if (!f.commit()) {
+        QMessageBox::warning(this, tr("Error Saving File"), tr("An error occurred when saving <b>%1</b><br><br>Error: %2").arg(fileName, f.errorString()));
+    }
+}
+
+void MainWindow::transformSelections(TextTransform::Kind kind)
+{
+    ScintillaNext *editor = currentEditor();
+
+    if (editor->readOnly())
+        return;
+
+    // Each selection is transformed on its own, top to bottom
+    std::vector<Sci_CharacterRange> ranges;
+    qint64 totalLength = 0;
+
+    for (int i = 0; i < editor->selections(); ++i) {
+        const Sci_PositionCR start = static_cast<Sci_PositionCR>(editor->selectionNStart(i));
+        const Sci_PositionCR end = static_cast<Sci_PositionCR>(editor->selectionNEnd(i));
+
+        if (start < end) {
+            ranges.push_back({start, end});
+            totalLength += end - start;
+        }
+    }
+
+    if (ranges.empty())
+        return;
+
+    std::sort(ranges.begin(), ranges.end(), [](const Sci_CharacterRange &a, const Sci_CharacterRange &b) { return a.cpMin < b.cpMin; });
+
+    QVector<QByteArray> results(static_cast<int>(ranges.size()));
+
+    // Small selections are quicker to do right away, straight out of the document
+    if (totalLength < TRANSFORM_IN_BACKGROUND_THRESHOLD) {
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            const Sci_CharacterRange &range = ranges[i];
+            const char *text = reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, range.cpMax - range.cpMin));
+
+            if (!TextTransform::apply(kind, text, range.cpMax - range.cpMin, results[static_cast<int>(i)]))
+                return;
+        }
+
+        applyTransformedSelections(editor, ranges, results);
+        return;
+    }
+
+    // The worker gets its own copy of the text since Scintilla is free to move the gap in its buffer at any time
+    QVector<QByteArray> texts;
+    texts.reserve(static_cast<int>(ranges.size()));
+    for (const Sci_CharacterRange &range : ranges) {
+        texts.append(QByteArray(reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, range.cpMax - range.cpMin)), range.cpMax - range.cpMin));
+    }
+
+    ProgressOverlay *progress = new ProgressOverlay(editor, tr("Converting selection..."), totalLength);
+
+    const quint64 generation = editor->changeGeneration();
+    QPointer<ScintillaNext> target = editor;
+    QPointer<ProgressOverlay> overlay = progress;
+    QPointer<MainWindow> self = this;
+
+    JobScheduler::instance()->run(progress, JobScheduler::Interactive, [=](const JobScheduler::CancelToken &canceled) {
+        QVector<QByteArray> transformed(texts.size());
+        qint64 done = 0;
+        bool ok = true;
+
+        for (int i = 0; i < texts.size() && ok; ++i) {
+            ok = TextTransform::apply(kind, texts[i].constData(), texts[i].size(), transformed[i], [&](qint64 processed) {
+                const qint64 total = done + processed;
+
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                    if (overlay) {
+                        overlay->setProgress(total);
+                    }
+                }, Qt::QueuedConnection);
+
+                return !*canceled;
+            });
+            done += texts[i].size();
+        }
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (overlay) {
+                overlay->finish();
+            }
+
+            // Nothing is applied if the document changed in the meantime, the ranges would no longer be right
+            if (!ok || !self || !target || target->changeGeneration() != generation) {
+                return;
+            }
+
+            self->applyTransformedSelections(target, ranges, transformed);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::applyTransformedSelections(ScintillaNext *editor, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &results)
+{
+    const BulkEdit be(editor);
+
+    editor->replaceRanges(ranges, results);
 
-    f.open(QIODevice::WriteOnly);
+    // Select what each selection was turned into so it can be converted back again
+    std::vector<Sci_CharacterRange> selections;
+    selections.reserve(ranges.size());
 
-    QTextStream s(&f);
-    converter->convert(s);
-    f.close();
+    qint64 offset = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const Sci_PositionCR start = static_cast<Sci_PositionCR>(ranges[i].cpMin + offset);
+
+        selections.push_back({start, static_cast<Sci_PositionCR>(start + results[static_cast<int>(i)].size())});
+        offset += results[static_cast<int>(i)].size() - (ranges[i].cpMax - ranges[i].cpMin);
+    }
+
+    editor->selectRanges(selections, 0);
 }
 
-void MainWindow::copyAsFormat(Converter *converter, const QString &mimeType)
+void MainWindow::formatText(TextFormatter::Kind kind)
 {
-    // This is not ideal as we are *assuming* the converter is currently associated with the currentEditor()
     ScintillaNext *editor = currentEditor();
-    QByteArray buffer;
-    QTextStream stream(&buffer);
 
-    if (editor->selectionEmpty())
-        converter->convert(stream);
+    if (editor->readOnly())
+        return;
+
+    // The main selection, or the whole document if nothing is selected
+    Sci_CharacterRange range{0, static_cast<Sci_PositionCR>(editor->length())};
+    if (!editor->selectionEmpty()) {
+        range = {static_cast<Sci_PositionCR>(editor->selectionStart()), static_cast<Sci_PositionCR>(editor->selectionEnd())};
+    }
+
+    TextFormatter::Options options;
+    options.eol = editor->eolString();
+    options.indent = editor->useTabs() ? QByteArrayLiteral("\t") : QByteArray(qMax(1, static_cast<int>(editor->indent() ? editor->indent() : editor->tabWidth())), ' ');
+
+    const qint64 length = range.cpMax - range.cpMin;
+
+    if (length < TRANSFORM_IN_BACKGROUND_THRESHOLD) {
+        QByteArray result;
+        TextFormatter::Error error;
+
+        TextFormatter::apply(kind, reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, length)), length, result, options, error);
+        applyFormattedText(editor, range, result, error);
+        return;
+    }
+
+    // The worker gets its own copy of the text since Scintilla is free to move the gap in its buffer at any time
+    const QByteArray text(reinterpret_cast<const char *>(editor->rangePointer(range.cpMin, length)), length);
+
+    ProgressOverlay *progress = new ProgressOverlay(editor, tr("Formatting..."), length);
+
+    const quint64 generation = editor->changeGeneration();
+    QPointer<ScintillaNext> target = editor;
+    QPointer<ProgressOverlay> overlay = progress;
+    QPointer<MainWindow> self = this;
+
+    JobScheduler::instance()->run(progress, JobScheduler::Interactive, [=](const JobScheduler::CancelToken &canceled) {
+        QByteArray result;
+        TextFormatter::Error error;
+
+        TextFormatter::apply(kind, text.constData(), text.size(), result, options, error, [&](qint64 processed) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (overlay) {
+                    overlay->setProgress(processed);
+                }
+            }, Qt::QueuedConnection);
+
+            return !*canceled;
+        });
+
+        const bool wasCanceled = *canceled;
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (overlay) {
+                overlay->finish();
+            }
+
+            // Nothing is applied if the document changed in the meantime, the range would no longer be right
+            if (wasCanceled || !self || !target || target->changeGeneration() != generation) {
+                return;
+            }
+
+            self->applyFormattedText(target, range, result, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::applyFormattedText(ScintillaNext *editor, const Sci_CharacterRange &range, const QByteArray &result, const TextFormatter::Error &error)
+{
+    if (error.message != Q_NULLPTR) {
+        const Sci_Position position = range.cpMin + error.position;
+        const Sci_Position line = editor->lineFromPosition(position);
+
+        editor->ensureVisible(line);
+        editor->gotoPos(position);
+        editor->verticalCentreCaret();
+
+        QMessageBox::warning(this, tr("Format"), tr("Line %1, column %2: %3")
+                             .arg(line + 1)
+                             .arg(editor->column(position) + 1)
+                             .arg(QCoreApplication::translate("TextFormatter", error.message)));
+        return;
+    }
+
+    // Canceled, or already formatted that way
+    if (result.isEmpty() || (result.size() == range.cpMax - range.cpMin && std::memcmp(result.constData(), editor->rangePointer(range.cpMin, result.size()), result.size()) == 0))
+        return;
+
+    const bool wasSelected = !editor->selectionEmpty();
+    const BulkEdit be(editor);
+
+    editor->replaceRanges({range}, result);
+
+    if (wasSelected) {
+        editor->setSel(range.cpMin, range.cpMin + result.size());
+    }
     else {
-        converter->convertRange(stream, editor->selectionStart(), editor->selectionEnd());
+        editor->gotoPos(0);
+    }
+}
+
+void MainWindow::compareWith(ScintillaNext *editor, ScintillaNext *other)
+{
+    // Only one pair is compared at a time
+    if (documentCompare) {
+        delete documentCompare;
     }
 
-    QMimeData *mimeData = new QMimeData();
-    mimeData->setData(mimeType, buffer);
+    dockedEditor->showSideBySide(editor, other);
+
+    documentCompare = new DocumentCompare(editor, other, this);
+
+    connect(documentCompare, &DocumentCompare::compared, this, [=](int differences, bool initial) {
+        if (initial && differences == 0) {
+            QMessageBox::information(this, tr("Compare"), tr("%1 and %2 are the same.").arg(editor->getName(), other->getName()));
+        }
+    });
+    connect(documentCompare, &QObject::destroyed, this, [=]() { updateCompareBasedUi(currentEditor()); });
+
+    updateCompareBasedUi(currentEditor());
+}
+
+void MainWindow::copyAsFormat(const QString &mimeType, const std::function<Converter *(ScintillaNext *)> &create)
+{
+    ScintillaNext *editor = currentEditor();
+    const int start = editor->selectionEmpty() ? 0 : editor->selectionStart();
+    const int end = editor->selectionEmpty() ? editor->length() : editor->selectionEnd();
+
+    // Nothing is converted until something pastes this format. The mime data renders it before the range can change.
+    LazyMimeData *mimeData = new LazyMimeData(editor);
+    mimeData->setUtf8Text(QByteArray(reinterpret_cast<const char *>(editor->rangePointer(start, end - start)), end - start));
+    mimeData->addFormat(mimeType, [=, editor = QPointer<ScintillaNext>(editor)]() {
+        if (!editor)
+            return QByteArray();
+
+        std::unique_ptr<Converter> converter(create(editor));
+        QBuffer buffer;
+
+        buffer.open(QIODevice::WriteOnly);
+        converter->exportRange(&buffer, start, end);
+
+        return buffer.data();
+    });
 
     QApplication::clipboard()->setMimeData(mimeData);
 }
@@ -1370,19 +2491,7 @@ void MainWindow::moveFileToTrash(ScintillaNext *editor)
 
 void MainWindow::print()
 {
-    QPrintPreviewDialog printDialog(this, Qt::Window);
-    EditorPrintPreviewRenderer renderer(currentEditor());
-
-    connect(&printDialog, &QPrintPreviewDialog::paintRequested, &renderer, &EditorPrintPreviewRenderer::render);
-
-    // TODO: load/save the page layout that was used and reload it next time
-    //preview.printer()->setPageLayout( /* todo */ );
-
-    printDialog.printer()->setPageMargins(QMarginsF(.5, .5, .5, .5), QPageLayout::Inch);
-
-    connect(&printDialog, &QPrintPreviewDialog::accepted, this, [&]() {
-        qInfo() << printDialog.printer()->pageLayout();
-    });
+    PrintPreviewDialog printDialog(currentEditor(), this);
 
     printDialog.exec();
 }
@@ -1391,8 +2500,7 @@ void MainWindow::convertEOLs(int eolMode)
 {
     ScintillaNext *editor = currentEditor();
 
-    // TODO: does convertEOLs trigger SCN_MODIFIED notifications? If so can these be turned off to increase performance?
-    editor->convertEOLs(eolMode);
+    editor->convertLineEndings(eolMode);
     editor->setEOLMode(eolMode);
 
     updateEOLBasedUi(editor);
@@ -1465,6 +2573,9 @@ void MainWindow::updateFileStatusBasedUi(ScintillaNext *editor)
     setWindowTitle(title);
 
     ui->actionReload->setEnabled(isFile);
+    ui->actionFollowFile->setEnabled(isFile);
+    ui->actionFollowFile->setChecked(editor->isFollowing());
+    ui->actionShowChangeHistory->setChecked(editor->isChangeHistoryEnabled());
     ui->actionMoveToTrash->setEnabled(isFile);
     ui->actionCopyFullPath->setEnabled(isFile);
     ui->actionCopyFileDirectory->setEnabled(isFile);
@@ -1555,6 +2666,29 @@ void MainWindow::updateLanguageBasedUi(ScintillaNext *editor)
     }
 }
 
+void MainWindow::updateCsvBasedUi(ScintillaNext *editor)
+{
+    // Don't create one for every editor that is activated, most of them are never going to be CSV
+    const CsvColumns *columns = editor->findChild<CsvColumns *>(QString(), Qt::FindDirectChildrenOnly);
+    const bool enabled = columns != Q_NULLPTR && columns->isEnabled();
+
+    ui->actionCsvMode->setChecked(enabled);
+    ui->actionCsvDelimiter->setEnabled(enabled);
+    ui->actionAlignCsvColumns->setEnabled(enabled && columns->canAlign());
+    ui->actionAlignCsvColumns->setChecked(enabled && columns->isAligned());
+    ui->actionSelectCsvColumn->setEnabled(enabled);
+    ui->actionSortByCsvColumn->setEnabled(enabled);
+}
+
+void MainWindow::updateCompareBasedUi(ScintillaNext *editor)
+{
+    const bool comparing = documentCompare && documentCompare->isComparing(editor);
+
+    ui->actionNextDifference->setEnabled(comparing);
+    ui->actionPreviousDifference->setEnabled(comparing);
+    ui->actionStopComparing->setEnabled(documentCompare);
+}
+
 void MainWindow::updateGui(ScintillaNext *editor)
 {
     qInfo(Q_FUNC_INFO);
@@ -1566,6 +2700,8 @@ void MainWindow::updateGui(ScintillaNext *editor)
     updateSelectionBasedUi(editor);
     updateContentBasedUi(editor);
     updateLanguageBasedUi(editor);
+    updateCsvBasedUi(editor);
+    updateCompareBasedUi(editor);
 }
 
 void MainWindow::updateDocumentBasedUi(Scintilla::Update updated)
@@ -1626,29 +2762,37 @@ void MainWindow::activateEditor(ScintillaNext *editor)
 {
     qInfo(Q_FUNC_INFO);
 
-    checkFileForModification(editor);
+    // Stat'ing the file here could stall on slow drives, let the watcher look at it in the background instead
+    app->getFileChangeWatcher()->recheck(editor);
     updateGui(editor);
 
     emit editorActivated(editor);
 }
 
+QString MainWindow::customStyleSheetPath() const
+{
+    // A "custom.css" file where the ini is located is loaded as a style sheet addition
+    return QDir(QFileInfo(app->getSettings()->fileName()).absolutePath()).filePath("custom.css");
+}
+
 void MainWindow::applyStyleSheet()
 {
     qInfo(Q_FUNC_INFO);
 
-    QString sheet;
-    QFile f(":/stylesheets/npp.css");
-    qInfo() << "Loading stylesheet: " << f.fileName();
+    // The built in sheet can't change, so it is only read the once
+    if (baseStyleSheet.isNull()) {
+        QFile f(":/stylesheets/npp.css");
+        qInfo() << "Loading stylesheet: " << f.fileName();
+
+        f.open(QFile::ReadOnly);
+        baseStyleSheet = f.readAll();
+        f.close();
+    }
 
-    f.open(QFile::ReadOnly);
-    sheet = f.readAll();
-    f.close();
+    QString sheet = baseStyleSheet;
 
-    // If there is a "custom.css" file where the ini is located, load it as a style sheet addition
-    QString directoryPath = QFileInfo(app->getSettings()->fileName()).absolutePath();
-    QString fullPath = QDir(directoryPath).filePath("custom.css");
-    if (QFile::exists(fullPath)) {
-        QFile custom(fullPath);
+    QFile custom(customStyleSheetPath());
+    if (custom.exists()) {
         qInfo() << "Loading stylesheet: " << custom.fileName();
 
         custom.open(QFile::ReadOnly);
@@ -1656,15 +2800,48 @@ void MainWindow::applyStyleSheet()
         custom.close();
     }
 
+    // Setting it polishes every widget in the window again, which is a waste if nothing is different
+    const QByteArray hash = QCryptographicHash::hash(sheet.toUtf8(), QCryptographicHash::Sha1);
+    if (hash == styleSheetHash) {
+        return;
+    }
+
+    styleSheetHash = hash;
     setStyleSheet(sheet);
 }
 
+void MainWindow::watchCustomStyleSheet()
+{
+    const QString filePath = customStyleSheetPath();
+    QFileSystemWatcher *watcher = new QFileSystemWatcher(this);
+
+    // The directory is watched too, since the file may not exist yet or get replaced rather than written to
+    watcher->addPath(QFileInfo(filePath).absolutePath());
+    if (QFile::exists(filePath)) {
+        watcher->addPath(filePath);
+    }
+
+    auto changed = [=]() {
+        if (QFile::exists(filePath) && !watcher->files().contains(filePath)) {
+            watcher->addPath(filePath);
+        }
+
+        applyStyleSheet();
+    };
+
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, changed);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, changed);
+}
+
 void MainWindow::setLanguage(ScintillaNext *editor, const QString &languageName)
 {
     qInfo(Q_FUNC_INFO);
     qInfo("Language Name: %s", qUtf8Printable(languageName));
 
-    app->setEditorLanguage(editor, languageName);
+    // Each view of the document has its own styles, the first one sets up the lexer they all share
+    for (ScintillaNext *view : editor->documentViews()) {
+        app->setEditorLanguage(view, languageName);
+    }
 }
 
 void MainWindow::bringWindowToForeground()
@@ -1709,24 +2886,32 @@ void MainWindow::bringWindowToForeground()
 #endif
 }
 
-bool MainWindow::checkFileForModification(ScintillaNext *editor)
+bool MainWindow::checkFileForModification(ScintillaNext *editor, ScintillaNext::FileStateChange state)
 {
     qInfo(Q_FUNC_INFO);
 
-    auto state = editor->checkFileForStateChange();
-
     if (state == ScintillaNext::NoChange) {
         return false;
     }
     else if (state == ScintillaNext::Modified) {
         qInfo("ScintillaNext::Modified");
-        editor->reload();
+
+        // A followed file that only grew just gets the new part added to the end, anything else only has the
+        // lines that changed replaced
+        if (!editor->appendFromDisk()) {
+            editor->reloadChanges();
+        }
     }
     else if (state == ScintillaNext::Deleted) {
         qInfo("ScintillaNext::Deleted");
     }
     else if (state == ScintillaNext::Restored) {
         qInfo("ScintillaNext::Restored");
+
+        // A rotated log usually disappears for a moment before the new one shows up
+        if (editor->isFollowing()) {
+            editor->reload();
+        }
     }
 
     return true;
@@ -1753,6 +2938,16 @@ void MainWindow::saveSettings() const
     settings->setValue("MainWindow/geometry", saveGeometry());
     settings->setValue("MainWindow/windowState", saveState());
 
+    QStringList openDocks;
+    for (auto it = deferredDocks.cbegin(); it != deferredDocks.cend(); ++it) {
+        const QDockWidget *dock = findChild<QDockWidget *>(it.key());
+
+        if (dock != Q_NULLPTR && dock->toggleViewAction()->isChecked()) {
+            openDocks.append(it.key());
+        }
+    }
+    settings->setValue("MainWindow/openDocks", openDocks);
+
     settings->setValue("Editor/ZoomLevel", zoomLevel);
 }
 
@@ -1783,6 +2978,12 @@ void MainWindow::restoreWindowState()
     ApplicationSettings *settings = app->getSettings();
 
     restoreGeometry(settings->value("MainWindow/geometry").toByteArray());
+
+    // Docks that were open last time need to exist before the state is restored so they come back where they were
+    for (const QString &objectName : settings->value("MainWindow/openDocks").toStringList()) {
+        ensureDock(objectName);
+    }
+
     restoreState(settings->value("MainWindow/windowState").toByteArray());
 
     // Always hide the dock no matter how the application was closed
@@ -1790,6 +2991,54 @@ void MainWindow::restoreWindowState()
     srDock->hide();
 }
 
+void MainWindow::addDeferredDock(const QString &objectName, const QString &title, Qt::DockWidgetArea area, QMenu *menu, QAction *before, std::function<QDockWidget *()> create)
+{
+    QAction *placeholder = new QAction(title, this);
+    placeholder->setCheckable(true);
+    menu->insertAction(before, placeholder);
+
+    connect(placeholder, &QAction::triggered, this, [=]() {
+        QDockWidget *dock = ensureDock(objectName);
+        dock->setVisible(true);
+        dock->raise();
+    });
+
+    deferredDocks.insert(objectName, DeferredDock{area, menu, placeholder, create});
+}
+
+QDockWidget *MainWindow::ensureDock(const QString &objectName)
+{
+    QDockWidget *dock = findChild<QDockWidget *>(objectName);
+
+    if (dock != Q_NULLPTR) {
+        return dock;
+    }
+
+    auto it = deferredDocks.find(objectName);
+    if (it == deferredDocks.end()) {
+        return Q_NULLPTR;
+    }
+
+    qInfo("Creating %s", qUtf8Printable(objectName));
+    TraceScope trace("Create " + objectName.toUtf8());
+
+    DeferredDock &deferred = it.value();
+    dock = deferred.create();
+    dock->hide();
+    addDockWidget(deferred.area, dock);
+
+    // If the restored window state knows about this dock then put it back where it was
+    restoreDockWidget(dock);
+
+    // The dock's own action takes over from the placeholder and stays in sync with it from now on
+    deferred.menu->insertAction(deferred.placeholder, dock->toggleViewAction());
+    deferred.menu->removeAction(deferred.placeholder);
+    deferred.placeholder->deleteLater();
+    deferred.placeholder = Q_NULLPTR;
+
+    return dock;
+}
+
 void MainWindow::switchToEditor(const ScintillaNext *editor)
 {
     dockedEditor->switchToEditor(editor);
@@ -1799,21 +3048,55 @@ void MainWindow::focusIn()
 {
     qInfo(Q_FUNC_INFO);
 
-    if (checkFileForModification(currentEditor())) {
-        updateGui(currentEditor());
-    }
+    // Some file systems (e.g. network drives) don't report changes, so coming back to the window is a good time to look
+    app->getFileChangeWatcher()->recheckAll();
 }
 
 void MainWindow::addEditor(ScintillaNext *editor)
 {
     qInfo(Q_FUNC_INFO);
 
-    detectLanguage(editor);
+    // A clone gets the language of the document it shares
+    if (editor->isClone()) {
+        app->setEditorLanguage(editor, editor->documentOwner()->languageName);
+    }
+    // Setting up the language is fairly expensive, so one that hasn't been read yet waits until it is
+    else if (editor->isLoadDeferred()) {
+        connect(editor, &ScintillaNext::loadingFinished, this, [=]() {
+            if (editor->languageName.isEmpty() || editor->languageName == QStringLiteral("Text"))
+                detectLanguage(editor);
+        });
+    }
+    else {
+        detectLanguage(editor);
+
+        // Nothing may have been loaded yet to detect the language from
+        if (editor->isLoading()) {
+            connect(editor, &ScintillaNext::loadingFinished, this, [=]() {
+                if (editor->languageName == QStringLiteral("Text"))
+                    detectLanguage(editor);
+            });
+        }
+    }
+
+    // The lexer went with the old document, so it needs setting up again before the folds can be restored
+    connect(editor, &ScintillaNext::wokeUp, this, [=]() {
+        if (editor->languageName.isEmpty())
+            detectLanguage(editor);
+        else
+            setLanguage(editor, editor->languageName);
+    });
 
     // These should only ever occur for the focused editor??
     // TODO: look at editor inspector as an example to ensure updates are only coming from one editor.
     // Can save the connection objects and disconnected from them and only connect to the editor as it is activated.
     connect(editor, &ScintillaNext::savePointChanged, this, [=]() { updateSaveStatusBasedUi(editor); });
+    connect(editor, &ScintillaNext::saveFailed, this, [=](QFileDevice::FileError error) { showSaveErrorMessage(editor, error); });
+    connect(editor, &ScintillaNext::copySaved, this, [=](const QString &, QFileDevice::FileError error) {
+        if (error != QFileDevice::NoError) {
+            showSaveErrorMessage(editor, error);
+        }
+    });
     connect(editor, &ScintillaNext::renamed, this, [=]() { detectLanguage(editor); });
     connect(editor, &ScintillaNext::renamed, this, [=]() { updateFileStatusBasedUi(editor); });
     connect(editor, &ScintillaNext::updateUi, this, &MainWindow::updateDocumentBasedUi);
@@ -1855,6 +3138,46 @@ void MainWindow::addEditor(ScintillaNext *editor)
     dockedEditor->addEditor(editor);
 }
 
+void MainWindow::hibernateIdleEditors()
+{
+    const qint64 hibernateAfter = static_cast<qint64>(app->getSettings()->hibernateAfter()) * 60 * 1000;
+    const int maxAwakeEditors = app->getSettings()->maxAwakeEditors();
+
+    if (hibernateAfter == 0 && maxAwakeEditors == 0) {
+        return;
+    }
+
+    QVector<ScintillaNext *> candidates;
+    int awakeEditors = 0;
+
+    for (ScintillaNext *editor : editors()) {
+        if (!editor->isLoadDeferred()) {
+            ++awakeEditors;
+        }
+
+        if (editor->canHibernate()) {
+            candidates.append(editor);
+        }
+    }
+
+    // The ones that have gone the longest without being looked at go first
+    std::sort(candidates.begin(), candidates.end(), [](const ScintillaNext *a, const ScintillaNext *b) {
+        return a->msecsSinceVisible() > b->msecsSinceVisible();
+    });
+
+    for (ScintillaNext *editor : candidates) {
+        const bool tooOld = hibernateAfter > 0 && editor->msecsSinceVisible() >= hibernateAfter;
+        const bool tooMany = maxAwakeEditors > 0 && awakeEditors > maxAwakeEditors;
+
+        if (!tooOld && !tooMany) {
+            break;
+        }
+
+        editor->hibernate();
+        --awakeEditors;
+    }
+}
+
 void MainWindow::checkForUpdates(bool silent)
 {
 #ifdef Q_OS_WIN
@@ -2040,6 +3363,8 @@ void MainWindow::tabBarRightClicked(ScintillaNext *editor)
         "",
         "Reload",
         "",
+        "CloneToOtherView",
+        "",
 #ifdef Q_OS_WIN
         "ShowInExplorer",
         "OpenCommandPromptHere",
@@ -23,6 +23,10 @@
 #include <QMainWindow>
 #include <QLabel>
 #include <QActionGroup>
+#include <QMap>
+#include <QPointer>
+
+#include <functional>
 
 #include "DockedEditor.h"
 
@@ -30,6 +34,8 @@
 #include "ScintillaNext.h"
 #include "NppImporter.h"
 #include "SearchResultsCollector.h"
+#include "TextFormatter.h"
+#include "TextTransform.h"
 
 namespace Ui {
 class MainWindow;
@@ -41,6 +47,11 @@ class Settings;
 class QuickFindWidget;
 class ZoomEventWatcher;
 class Converter;
+class DocumentCompare;
+class HexFileViewer;
+class LargeFileViewer;
+class QTextCodec;
+class QUrl;
 
 class MainWindow : public QMainWindow
 {
@@ -53,18 +64,26 @@ public:
     bool isAnyUnsaved() const;
 
     void setupLanguageMenu();
+    void setupEncodingMenu();
     ScintillaNext *currentEditor() const;
     int editorCount() const;
     QVector<ScintillaNext *> editors() const;
     DockedEditor *getDockedEditor() const { return dockedEditor; }
 
+    // The read only viewer the file is open in, if it is
+    LargeFileViewer *largeFileViewer(const QString &filePath) const;
+
 public slots:
     void newFile();
 
     void openFileDialog();
     void openFile(const QString &filePath);
+    void openFileList(const QStringList &fileNames);
 
     void openFolderAsWorkspaceDialog();
+    void goToFileDialog();
+    void openInHexViewerDialog();
+    void openUrlDialog();
 
     void reloadFile();
 
@@ -75,8 +94,12 @@ public slots:
     void closeAllToLeft();
     void closeAllToRight();
 
+    // Keeps the open editors in the current workspace, closes them, and opens the ones kept in the named workspace
+    void switchToWorkspace(const QString &name);
+
     bool saveCurrentFile();
-    bool saveFile(ScintillaNext *editor);
+    // Big files are saved on a worker thread when allowed to be, in which case errors are reported later on
+    bool saveFile(ScintillaNext *editor, bool allowBackground=false);
 
     bool saveCurrentFileAsDialog();
     bool saveCurrentFileAs(const QString &fileName);
@@ -84,10 +107,11 @@ public slots:
 
     bool saveCopyAsDialog();
     bool saveCopyAs(const QString &fileName);
+    bool saveCopyInEncodingDialog(QTextCodec *codec, bool withByteOrderMark);
     void saveAll();
 
     void exportAsFormat(Converter *converter, const QString &filter);
-    void copyAsFormat(Converter *converter, const QString &mimeType);
+    void copyAsFormat(const QString &mimeType, const std::function<Converter *(ScintillaNext *)> &create);
 
     void renameFile();
 
@@ -108,6 +132,8 @@ public slots:
     void updateSaveStatusBasedUi(ScintillaNext *editor);
     void updateEditorPositionBasedUi();
     void updateLanguageBasedUi(ScintillaNext *editor);
+    void updateCsvBasedUi(ScintillaNext *editor);
+    void updateCompareBasedUi(ScintillaNext *editor);
     void updateGui(ScintillaNext *editor);
 
     void detectLanguage(ScintillaNext *editor);
@@ -139,6 +165,7 @@ private slots:
     void languageMenuTriggered();
     void checkForUpdatesFinished(QString url);
     void activateEditor(ScintillaNext *editor);
+    void hibernateIdleEditors();
 
 private:
     Ui::MainWindow *ui = Q_NULLPTR;
@@ -146,24 +173,53 @@ private:
     DockedEditor *dockedEditor = Q_NULLPTR;
 
     QScopedPointer<SearchResultsCollector> searchResults;
+    QPointer<DocumentCompare> documentCompare;
 
+    QString customStyleSheetPath() const;
     void applyStyleSheet();
+    void watchCustomStyleSheet();
     void applyCustomShortcuts();
     void initUpdateCheck();
     ScintillaNext *getInitialEditor();
-    void openFileList(const QStringList &fileNames);
+    bool shouldOpenInLargeFileViewer(const QFileInfo &fileInfo);
+    void openInLargeFileViewer(const QString &filePath);
+    void openUrlInLargeFileViewer(const QUrl &url);
+    HexFileViewer *openInHexViewer(const QString &filePath);
+    void openAsText(const QString &filePath);
     bool checkEditorsBeforeClose(const QVector<ScintillaNext *> &editors);
-    bool checkFileForModification(ScintillaNext *editor);
+    void closeEditors(const QVector<ScintillaNext *> &editors);
+    bool checkFileForModification(ScintillaNext *editor, ScintillaNext::FileStateChange state);
     void showSaveErrorMessage(ScintillaNext *editor, QFileDevice::FileError error);
     void showEditorZoomLevelIndicator();
 
+    void transformSelections(TextTransform::Kind kind);
+    void applyTransformedSelections(ScintillaNext *editor, const std::vector<Sci_CharacterRange> &ranges, const QVector<QByteArray> &results);
+    void formatText(TextFormatter::Kind kind);
+    void applyFormattedText(ScintillaNext *editor, const Sci_CharacterRange &range, const QByteArray &result, const TextFormatter::Error &error);
+    void compareWith(ScintillaNext *editor, ScintillaNext *other);
+
     void saveSettings() const;
     void restoreSettings();
 
     ISearchResultsHandler *determineSearchResultsHandler();
 
+    // Docks that are only created the first time they are shown
+    struct DeferredDock {
+        Qt::DockWidgetArea area;
+        QMenu *menu;
+        QAction *placeholder;
+        std::function<QDockWidget *()> create;
+    };
+    QMap<QString, DeferredDock> deferredDocks;
+
+    void addDeferredDock(const QString &objectName, const QString &title, Qt::DockWidgetArea area, QMenu *menu, QAction *before, std::function<QDockWidget *()> create);
+    QDockWidget *ensureDock(const QString &objectName);
+
     QActionGroup *languageActionGroup;
 
+    QString baseStyleSheet;
+    QByteArray styleSheetHash;
+
     //NppImporter *npp;
 
     MacroManager macroManager;
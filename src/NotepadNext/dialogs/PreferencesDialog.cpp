@@ -18,6 +18,7 @@
 
 
 #include "PreferencesDialog.h"
+#include "RegexEngine.h"
 #include "NotepadNextApplication.h"
 #include "TranslationManager.h"
 #include "ui_PreferencesDialog.h"
@@ -57,6 +58,10 @@ PreferencesDialog::PreferencesDialog(ApplicationSettings *settings, QWidget *par
     MapSettingToCheckBox(ui->checkBoxUnsavedFiles, &ApplicationSettings::restoreUnsavedFiles, &ApplicationSettings::setRestoreUnsavedFiles, &ApplicationSettings::restoreUnsavedFilesChanged);
     MapSettingToCheckBox(ui->checkBoxRestoreTempFiles, &ApplicationSettings::restoreTempFiles, &ApplicationSettings::setRestoreTempFiles, &ApplicationSettings::restoreTempFilesChanged);
 
+    ui->spbSessionAutoSaveInterval->setValue(settings->sessionAutoSaveInterval());
+    connect(ui->spbSessionAutoSaveInterval, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setSessionAutoSaveInterval);
+    connect(settings, &ApplicationSettings::sessionAutoSaveIntervalChanged, ui->spbSessionAutoSaveInterval, &QSpinBox::setValue);
+
     MapSettingToCheckBox(ui->checkBoxCombineSearchResults, &ApplicationSettings::combineSearchResults, &ApplicationSettings::setCombineSearchResults, &ApplicationSettings::combineSearchResultsChanged);
 
     populateTranslationComboBox();
@@ -65,6 +70,56 @@ PreferencesDialog::PreferencesDialog(ApplicationSettings *settings, QWidget *par
         showApplicationRestartRequired();
     });
 
+    ui->spbLargeFileThreshold->setValue(settings->largeFileThreshold());
+    connect(ui->spbLargeFileThreshold, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setLargeFileThreshold);
+    connect(settings, &ApplicationSettings::largeFileThresholdChanged, ui->spbLargeFileThreshold, &QSpinBox::setValue);
+
+    ui->spbHibernateAfter->setValue(settings->hibernateAfter());
+    connect(ui->spbHibernateAfter, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setHibernateAfter);
+    connect(settings, &ApplicationSettings::hibernateAfterChanged, ui->spbHibernateAfter, &QSpinBox::setValue);
+
+    ui->spbMaxAwakeEditors->setValue(settings->maxAwakeEditors());
+    connect(ui->spbMaxAwakeEditors, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setMaxAwakeEditors);
+    connect(settings, &ApplicationSettings::maxAwakeEditorsChanged, ui->spbMaxAwakeEditors, &QSpinBox::setValue);
+
+    ui->spbUndoActionLimit->setValue(settings->undoActionLimit());
+    connect(ui->spbUndoActionLimit, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setUndoActionLimit);
+    connect(settings, &ApplicationSettings::undoActionLimitChanged, ui->spbUndoActionLimit, &QSpinBox::setValue);
+
+    ui->spbUndoMemoryLimit->setValue(settings->undoMemoryLimit());
+    connect(ui->spbUndoMemoryLimit, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setUndoMemoryLimit);
+    connect(settings, &ApplicationSettings::undoMemoryLimitChanged, ui->spbUndoMemoryLimit, &QSpinBox::setValue);
+
+    ui->spbScriptInstructionBudget->setValue(settings->scriptInstructionBudget());
+    connect(ui->spbScriptInstructionBudget, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setScriptInstructionBudget);
+    connect(settings, &ApplicationSettings::scriptInstructionBudgetChanged, ui->spbScriptInstructionBudget, &QSpinBox::setValue);
+
+    ui->spbMemorySoftLimit->setValue(settings->memorySoftLimit());
+    connect(ui->spbMemorySoftLimit, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setMemorySoftLimit);
+    connect(settings, &ApplicationSettings::memorySoftLimitChanged, ui->spbMemorySoftLimit, &QSpinBox::setValue);
+
+    ui->spbLayoutThreads->setValue(settings->layoutThreads());
+    connect(ui->spbLayoutThreads, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setLayoutThreads);
+    connect(settings, &ApplicationSettings::layoutThreadsChanged, ui->spbLayoutThreads, &QSpinBox::setValue);
+
+    ui->spbPositionCacheSize->setValue(settings->positionCacheSize());
+    connect(ui->spbPositionCacheSize, QOverload<int>::of(&QSpinBox::valueChanged), settings, &ApplicationSettings::setPositionCacheSize);
+    connect(settings, &ApplicationSettings::positionCacheSizeChanged, ui->spbPositionCacheSize, &QSpinBox::setValue);
+
+    // The items are in the same order as the SC_CACHE_* values
+    ui->comboBoxLayoutCacheMode->setCurrentIndex(settings->layoutCacheMode());
+    connect(ui->comboBoxLayoutCacheMode, QOverload<int>::of(&QComboBox::currentIndexChanged), settings, &ApplicationSettings::setLayoutCacheMode);
+    connect(settings, &ApplicationSettings::layoutCacheModeChanged, ui->comboBoxLayoutCacheMode, &QComboBox::setCurrentIndex);
+
+    // The items are in the same order as RegexEngine::Engine
+    if (!RegexEngine::isAvailable(RegexEngine::Pcre2)) {
+        ui->comboBoxRegexEngine->setEnabled(false);
+        ui->comboBoxRegexEngine->setToolTip(tr("This build was made without PCRE2"));
+    }
+    ui->comboBoxRegexEngine->setCurrentIndex(RegexEngine::engine());
+    connect(ui->comboBoxRegexEngine, QOverload<int>::of(&QComboBox::currentIndexChanged), settings, &ApplicationSettings::setRegexEngine);
+    connect(settings, &ApplicationSettings::regexEngineChanged, ui->comboBoxRegexEngine, &QComboBox::setCurrentIndex);
+
     MapSettingToCheckBox(ui->checkBoxExitOnLastTabClosed, &ApplicationSettings::exitOnLastTabClosed, &ApplicationSettings::setExitOnLastTabClosed, &ApplicationSettings::exitOnLastTabClosedChanged);
 
     ui->fcbDefaultFont->setCurrentFont(QFont(settings->fontName()));
@@ -0,0 +1,173 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PrintPreviewDialog.h"
+#include "EditorPrintJob.h"
+#include "EditorPrintPreviewRenderer.h"
+#include "PrintPreviewWidget.h"
+#include "ScintillaNext.h"
+
+#include <QAction>
+#include <QDebug>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QLabel>
+#include <QLocale>
+#include <QPageSetupDialog>
+#include <QPrintDialog>
+#include <QProgressDialog>
+#include <QToolBar>
+#include <QVBoxLayout>
+
+
+PrintPreviewDialog::PrintPreviewDialog(ScintillaNext *editor, QWidget *parent) :
+    QDialog(parent, Qt::Window),
+    editor(editor),
+    printerDevice(QPrinter::HighResolution),
+    renderer(new EditorPrintPreviewRenderer(editor)),
+    preview(Q_NULLPTR),
+    pageLabel(new QLabel(this))
+{
+    setWindowTitle(tr("Print Preview"));
+    renderer->setParent(this);
+
+    // TODO: load/save the page layout that was used and reload it next time
+    printerDevice.setPageMargins(QMarginsF(.5, .5, .5, .5), QPageLayout::Inch);
+
+    preview = new PrintPreviewWidget(renderer, this);
+
+    QToolBar *toolBar = new QToolBar(this);
+    toolBar->addAction(tr("Print..."), this, &PrintPreviewDialog::print);
+    toolBar->addAction(tr("Export to PDF..."), this, &PrintPreviewDialog::exportToPdf);
+    toolBar->addAction(tr("Page Setup..."), this, &PrintPreviewDialog::pageSetup);
+    toolBar->addSeparator();
+    toolBar->addAction(tr("Zoom In"), preview, &PrintPreviewWidget::zoomIn);
+    toolBar->addAction(tr("Zoom Out"), preview, &PrintPreviewWidget::zoomOut);
+    toolBar->addSeparator();
+    toolBar->addWidget(pageLabel);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(0);
+    layout->addWidget(toolBar);
+    layout->addWidget(preview);
+
+    connect(renderer, &EditorPrintPreviewRenderer::pageCountChanged, this, &PrintPreviewDialog::updatePageLabel);
+    connect(renderer, &EditorPrintPreviewRenderer::paginationFinished, this, &PrintPreviewDialog::updatePageLabel);
+    connect(preview, &PrintPreviewWidget::currentPageChanged, this, &PrintPreviewDialog::updatePageLabel);
+
+    renderer->setPrinter(&printerDevice);
+
+    resize(800, 900);
+}
+
+void PrintPreviewDialog::print()
+{
+    QPrintDialog dialog(&printerDevice, this);
+    dialog.setOption(QAbstractPrintDialog::PrintPageRange);
+    if (renderer->isPaginated()) {
+        dialog.setMinMax(1, renderer->pageCount());
+    }
+
+    if (dialog.exec() == QDialog::Accepted) {
+        qInfo() << printerDevice.pageLayout();
+
+        printPages();
+    }
+}
+
+void PrintPreviewDialog::exportToPdf()
+{
+    const QString suggestedName = QFileInfo(editor->getName()).completeBaseName() + QStringLiteral(".pdf");
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Export to PDF"), suggestedName, tr("PDF Files (*.pdf)"));
+
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    printerDevice.setOutputFormat(QPrinter::PdfFormat);
+    printerDevice.setOutputFileName(fileName);
+    printerDevice.setPrintRange(QPrinter::AllPages);
+    printerDevice.setFromTo(0, 0);
+
+    printPages();
+}
+
+void PrintPreviewDialog::printPages()
+{
+    const QVector<int> knownPageStarts = renderer->pageStartsFor(&printerDevice);
+    EditorPrintJob *job = new EditorPrintJob(editor, &printerDevice, knownPageStarts, this);
+
+    // Without a page range the total is only known once every page break has been found
+    int pages = 0;
+    if (printerDevice.fromPage() > 0) {
+        pages = printerDevice.toPage() - printerDevice.fromPage() + 1;
+    }
+    else if (renderer->isPaginated() && !knownPageStarts.isEmpty()) {
+        pages = knownPageStarts.size();
+    }
+
+    QProgressDialog *progress = new QProgressDialog(tr("Printing..."), tr("Cancel"), 0, pages, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+
+    connect(job, &EditorPrintJob::pagePrinted, progress, [=](int pagesPrinted) {
+        progress->setLabelText(tr("Printed %L1 pages...").arg(pagesPrinted));
+        if (pages > 0) {
+            progress->setValue(qMin(pagesPrinted, pages - 1));
+        }
+    });
+    connect(progress, &QProgressDialog::canceled, job, &EditorPrintJob::cancel);
+    connect(job, &EditorPrintJob::finished, this, [=](bool completed) {
+        progress->deleteLater();
+        job->deleteLater();
+
+        // The printer goes back to what it was, the next print could just as well be on paper
+        if (printerDevice.outputFormat() == QPrinter::PdfFormat) {
+            printerDevice.setOutputFileName(QString());
+        }
+
+        if (completed) {
+            accept();
+        }
+    });
+
+    job->start();
+}
+
+void PrintPreviewDialog::pageSetup()
+{
+    QPageSetupDialog dialog(&printerDevice, this);
+
+    if (dialog.exec() == QDialog::Accepted) {
+        renderer->setPrinter(&printerDevice);
+        preview->refresh();
+    }
+}
+
+void PrintPreviewDialog::updatePageLabel()
+{
+    const QLocale locale;
+    const QString count = locale.toString(renderer->pageCount());
+
+    // The total is only a lower bound until every page break has been found
+    pageLabel->setText(tr("Page %1 of %2%3").arg(locale.toString(preview->currentPage() + 1),
+                                                 count,
+                                                 renderer->isPaginated() ? QString() : QStringLiteral("+")));
+}
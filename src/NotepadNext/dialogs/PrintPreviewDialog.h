@@ -0,0 +1,58 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QDialog>
+#include <QPrinter>
+
+class EditorPrintPreviewRenderer;
+class PrintPreviewWidget;
+class ScintillaNext;
+class QLabel;
+
+
+// Print preview that opens immediately however long the document is. Pages are found in the background by the
+// EditorPrintPreviewRenderer and only drawn when scrolled into view. Printing is done by an EditorPrintJob, with
+// progress and a way to cancel it.
+class PrintPreviewDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit PrintPreviewDialog(ScintillaNext *editor, QWidget *parent = nullptr);
+
+    QPrinter *printer() { return &printerDevice; }
+
+private slots:
+    void print();
+    void exportToPdf();
+    void pageSetup();
+    void updatePageLabel();
+
+private:
+    // Prints with whatever the printer is set up for, without asking anything
+    void printPages();
+
+    ScintillaNext *editor;
+    QPrinter printerDevice;
+    EditorPrintPreviewRenderer *renderer;
+    PrintPreviewWidget *preview;
+    QLabel *pageLabel;
+};
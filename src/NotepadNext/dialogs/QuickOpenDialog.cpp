@@ -0,0 +1,126 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "QuickOpenDialog.h"
+#include "WorkspaceModel.h"
+#include "ui_QuickOpenDialog.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QStringListModel>
+
+
+static const int MAX_RESULTS = 100;
+
+QuickOpenDialog::QuickOpenDialog(WorkspaceModel *workspace, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::QuickOpenDialog),
+    workspace(workspace),
+    results(new QStringListModel(this))
+{
+    setWindowFlag(Qt::WindowContextHelpButtonHint, false);
+
+    ui->setupUi(this);
+    ui->listResults->setModel(results);
+    ui->editQuery->installEventFilter(this);
+
+    connect(ui->editQuery, &QLineEdit::textChanged, this, &QuickOpenDialog::updateResults);
+    connect(ui->editQuery, &QLineEdit::returnPressed, this, [=]() {
+        openResult(ui->listResults->currentIndex());
+    });
+    connect(ui->listResults, &QListView::activated, this, &QuickOpenDialog::openResult);
+    connect(workspace, &WorkspaceModel::pathIndexReady, this, &QuickOpenDialog::updateResults);
+    connect(workspace, &WorkspaceModel::modelReset, this, &QuickOpenDialog::updateResults);
+
+    updateResults();
+}
+
+QuickOpenDialog::~QuickOpenDialog()
+{
+    delete ui;
+}
+
+bool QuickOpenDialog::eventFilter(QObject *obj, QEvent *event)
+{
+    // Let the keys for moving through the results work while typing
+    if (obj == ui->editQuery && event->type() == QEvent::KeyPress) {
+        switch (static_cast<QKeyEvent *>(event)->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QCoreApplication::sendEvent(ui->listResults, event);
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return QDialog::eventFilter(obj, event);
+}
+
+void QuickOpenDialog::updateResults()
+{
+    const QString query = ui->editQuery->text().trimmed();
+    WorkspacePathIndex *index = workspace->pathIndex();
+
+    if (workspace->rootPath().isEmpty()) {
+        ui->lblStatus->setText(tr("No folder is open"));
+        results->setStringList(QStringList());
+        return;
+    }
+
+    if (!index) {
+        ui->lblStatus->setText(tr("Indexing files..."));
+        results->setStringList(QStringList());
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList paths;
+    if (!query.isEmpty()) {
+        for (const WorkspacePathIndex::Match &match : index->filter(query, MAX_RESULTS)) {
+            paths.append(index->path(match.file));
+        }
+    }
+
+    results->setStringList(paths);
+    ui->listResults->setCurrentIndex(results->index(0));
+
+    // Anything slower than a frame is noticeable while typing
+    if (timer.elapsed() > 16)
+        qDebug("Quick open took %lld ms to match \"%s\"", static_cast<long long>(timer.elapsed()), qUtf8Printable(query));
+
+    if (index->isTruncated())
+        ui->lblStatus->setText(tr("Only the first %L1 files were indexed").arg(index->count()));
+    else
+        ui->lblStatus->setText(tr("%L1 files indexed").arg(index->count()));
+}
+
+void QuickOpenDialog::openResult(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+
+    emit fileSelected(QDir(workspace->rootPath()).filePath(index.data().toString()));
+    accept();
+}
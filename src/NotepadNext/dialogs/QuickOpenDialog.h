@@ -0,0 +1,57 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+#include <QDialog>
+
+namespace Ui {
+class QuickOpenDialog;
+}
+
+class QStringListModel;
+class WorkspaceModel;
+
+// Fuzzy finds a file anywhere below the workspace root by name, using the model's path index
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QuickOpenDialog(WorkspaceModel *workspace, QWidget *parent = Q_NULLPTR);
+    ~QuickOpenDialog();
+
+signals:
+    void fileSelected(const QString &filePath);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+
+private slots:
+    void updateResults();
+    void openResult(const QModelIndex &index);
+
+private:
+    Ui::QuickOpenDialog *ui;
+    WorkspaceModel *workspace;
+    QStringListModel *results;
+};
+
+#endif // QUICKOPENDIALOG_H
@@ -0,0 +1,156 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ReplacePreviewDialog.h"
+#include "BulkEdit.h"
+#include "FileSearcher.h"
+#include "ReplacePreviewModel.h"
+#include "ScintillaNext.h"
+
+#include <QApplication>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+
+ReplacePreviewDialog::ReplacePreviewDialog(QWidget *parent) :
+    QDialog(parent, Qt::Window),
+    previewModel(new ReplacePreviewModel(this)),
+    view(new QTreeView(this)),
+    statusLabel(new QLabel(this))
+{
+    setWindowTitle(tr("Replace Preview"));
+
+    // Every row is a single line of text, so the view only ever has to deal with the rows that are showing
+    view->setModel(previewModel);
+    view->setRootIsDecorated(false);
+    view->setUniformRowHeights(true);
+    view->header()->setStretchLastSection(true);
+    view->header()->setSectionResizeMode(ReplacePreviewModel::Before, QHeaderView::Interactive);
+    view->header()->resizeSection(ReplacePreviewModel::Location, 250);
+    view->header()->resizeSection(ReplacePreviewModel::Before, 400);
+
+    QFont font(QStringLiteral("Courier New"), 10);
+    view->setFont(font);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(this);
+    QPushButton *acceptAll = buttons->addButton(tr("Accept All"), QDialogButtonBox::ActionRole);
+    QPushButton *rejectAll = buttons->addButton(tr("Reject All"), QDialogButtonBox::ActionRole);
+    buttonApply = buttons->addButton(tr("Replace Accepted"), QDialogButtonBox::AcceptRole);
+    buttons->addButton(QDialogButtonBox::Cancel);
+    buttonApply->setEnabled(false);
+
+    connect(acceptAll, &QPushButton::clicked, this, [=]() { previewModel->setAllAccepted(true); });
+    connect(rejectAll, &QPushButton::clicked, this, [=]() { previewModel->setAllAccepted(false); });
+    connect(buttons, &QDialogButtonBox::accepted, this, &ReplacePreviewDialog::apply);
+    connect(buttons, &QDialogButtonBox::rejected, this, &ReplacePreviewDialog::reject);
+    connect(previewModel, &ReplacePreviewModel::acceptedChanged, this, &ReplacePreviewDialog::updateStatus);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(view);
+    layout->addWidget(statusLabel);
+    layout->addWidget(buttons);
+
+    updateStatus();
+
+    resize(1000, 600);
+}
+
+void ReplacePreviewDialog::previewFinished(bool canceled)
+{
+    finished = true;
+    wasCanceled = canceled;
+
+    updateStatus();
+}
+
+void ReplacePreviewDialog::apply()
+{
+    qInfo(Q_FUNC_INFO);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    int replacements = 0;
+    int documents = 0;
+    QStringList failures;
+
+    std::vector<Sci_CharacterRange> ranges;
+    QVector<QByteArray> texts;
+
+    for (const ReplacePreviewModel::Document &document : previewModel->documents()) {
+        document.preview.acceptedReplacements(document.accepted, ranges, texts);
+
+        if (ranges.empty())
+            continue;
+
+        QString error;
+
+        if (document.fromEditor) {
+            if (document.editor == Q_NULLPTR) {
+                failures.append(tr("%1: The document has been closed").arg(document.name));
+                continue;
+            }
+
+            // The ranges only line up with the text the preview was made from
+            if (document.editor->changeGeneration() != document.preview.changeGeneration) {
+                failures.append(tr("%1: The document has changed since the replacements were previewed").arg(document.name));
+                continue;
+            }
+
+            const BulkEdit be(document.editor);
+            document.editor->replaceRanges(ranges, texts);
+        }
+        else if (!FileSearcher::replaceInFile(document.filePath, document.preview.lastModified, document.preview.size, ranges, texts, error)) {
+            failures.append(QStringLiteral("%1: %2").arg(document.name, error));
+            continue;
+        }
+
+        replacements += static_cast<int>(ranges.size());
+        documents++;
+    }
+
+    QApplication::restoreOverrideCursor();
+
+    if (!failures.isEmpty()) {
+        QMessageBox failed(QMessageBox::Warning, windowTitle(), tr("%Ln documents could not be changed.", "", failures.size()), QMessageBox::Ok, this);
+        failed.setDetailedText(failures.join('\n'));
+        failed.exec();
+    }
+
+    emit applied(replacements, documents);
+
+    accept();
+}
+
+void ReplacePreviewDialog::updateStatus()
+{
+    QString status = tr("%1 of %2 accepted").arg(previewModel->acceptedHunks()).arg(tr("%Ln changes", "", previewModel->totalHunks()));
+
+    if (!finished)
+        status.append(tr(", still looking..."));
+    else if (wasCanceled)
+        status.append(tr(", the preview was canceled so not every match is shown"));
+
+    statusLabel->setText(status);
+    buttonApply->setEnabled(finished && previewModel->acceptedHunks() > 0);
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QDialog>
+
+class ReplacePreviewModel;
+class QLabel;
+class QPushButton;
+class QTreeView;
+
+
+// Shows what a Replace All would change before anything does. The previews are worked out in the background and
+// added to the list as they arrive, then only the accepted hunks are replaced, in one edit for each document.
+class ReplacePreviewDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ReplacePreviewDialog(QWidget *parent = nullptr);
+
+    ReplacePreviewModel *model() const { return previewModel; }
+
+    // No more previews are coming, so the replacements can be applied
+    void previewFinished(bool canceled);
+
+signals:
+    void applied(int replacements, int documents);
+
+private slots:
+    void apply();
+    void updateStatus();
+
+private:
+    ReplacePreviewModel *previewModel;
+    QTreeView *view;
+    QLabel *statusLabel;
+    QPushButton *buttonApply;
+    bool finished = false;
+    bool wasCanceled = false;
+};
@@ -25,9 +25,13 @@
 
 static QPlainTextEdit *output = Q_NULLPTR;
 
-static void debugLogDockMessageHandler(const QString &msg)
+static void debugLogDockMessageHandler(const QStringList &messages)
 {
-    output->appendPlainText(msg);
+    // Anything past the block limit would be thrown away straight after being laid out, so skip it
+    const int limit = output->maximumBlockCount();
+    const QStringList shown = (limit > 0 && messages.size() > limit) ? messages.mid(messages.size() - limit) : messages;
+
+    output->appendPlainText(shown.join(QLatin1Char('\n')));
 }
 
 DebugLogDock::DebugLogDock(QWidget *parent) :
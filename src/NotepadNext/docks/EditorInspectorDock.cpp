@@ -21,6 +21,11 @@
 
 #include "MainWindow.h"
 
+#include <QTimer>
+
+
+// Showing every selection is useless once there are thousands of them and makes each update very slow
+static const int MAX_SELECTIONS_SHOWN = 100;
 
 static inline QString toBool(int b) {
     return b ? QStringLiteral("True") : QStringLiteral("False");
@@ -32,6 +37,16 @@ EditorInspectorDock::EditorInspectorDock(MainWindow *parent) :
 {
     ui->setupUi(this);
 
+    // Scintilla can send several updates for a single key press, so only refresh once per frame at most
+    updateTimer = new QTimer(this);
+    updateTimer->setSingleShot(true);
+    updateTimer->setInterval(16);
+    connect(updateTimer, &QTimer::timeout, this, [=]() {
+        if (pendingEditor) {
+            updateEditorInfo(pendingEditor);
+        }
+    });
+
     QTreeWidgetItem *positionInfo = new QTreeWidgetItem(ui->treeWidget);
     positionInfo->setText(0, tr("Position Information"));
     positionInfo->setExpanded(true);
@@ -137,6 +152,9 @@ void EditorInspectorDock::disconnectFromEditor()
     if (editorConnection) {
         disconnect(editorConnection);
     }
+
+    updateTimer->stop();
+    pendingEditor = Q_NULLPTR;
 }
 
 void EditorInspectorDock::editorUIUpdated(Scintilla::Update updated)
@@ -145,9 +163,11 @@ void EditorInspectorDock::editorUIUpdated(Scintilla::Update updated)
             || FlagSet(updated, Scintilla::Update::Selection)
             || FlagSet(updated, Scintilla::Update::VScroll)
             || FlagSet(updated, Scintilla::Update::HScroll)) {
-        ScintillaNext *editor = qobject_cast<ScintillaNext*>(sender());
+        pendingEditor = qobject_cast<ScintillaNext*>(sender());
 
-        updateEditorInfo(editor);
+        if (!updateTimer->isActive()) {
+            updateTimer->start();
+        }
     }
 }
 
@@ -162,31 +182,58 @@ void EditorInspectorDock::updateEditorInfo(ScintillaNext *editor)
         }
     }
 
-    qDeleteAll(selectionsInfo->takeChildren());
+    if (selectionsInfo->isExpanded()) {
+        updateSelections(editor);
+    }
+}
 
-    for (int i = 0; i < editor->selections(); ++i) {
+void EditorInspectorDock::updateSelections(ScintillaNext *editor)
+{
+    const int selections = editor->selections();
+    const int shown = qMin(selections, MAX_SELECTIONS_SHOWN);
+
+    // Keep the existing items and only add or remove the difference, the text of an item is only
+    // touched if it actually changed
+    delete moreSelections;
+    moreSelections = Q_NULLPTR;
+
+    const bool countChanged = selectionsInfo->childCount() != shown;
+
+    while (selectionsInfo->childCount() > shown) {
+        delete selectionsInfo->takeChild(selectionsInfo->childCount() - 1);
+    }
+
+    while (selectionsInfo->childCount() < shown) {
         QTreeWidgetItem *selection = new QTreeWidgetItem(selectionsInfo);
-        selection->setText(0, QLatin1Char('#') + QString::number(i));
+        selection->setText(0, QLatin1Char('#') + QString::number(selectionsInfo->indexOfChild(selection)));
         selection->setExpanded(true);
 
-        QTreeWidgetItem *caret = new QTreeWidgetItem(selection);
-        caret->setText(0, tr("Caret"));
-        caret->setText(1, QString::number(editor->selectionNCaret(i)));
+        new QTreeWidgetItem(selection, QStringList(tr("Caret")));
+        new QTreeWidgetItem(selection, QStringList(tr("Anchor")));
+        new QTreeWidgetItem(selection, QStringList(tr("Caret Virtual Space")));
+        new QTreeWidgetItem(selection, QStringList(tr("Anchor Virtual Space")));
+    }
+
+    for (int i = 0; i < shown; ++i) {
+        QTreeWidgetItem *selection = selectionsInfo->child(i);
 
-        QTreeWidgetItem *anchor = new QTreeWidgetItem(selection);
-        anchor->setText(0, tr("Anchor"));
-        anchor->setText(1, QString::number(editor->selectionNAnchor(i)));
+        if (!selection->isExpanded())
+            continue;
 
-        QTreeWidgetItem *caretVirtual = new QTreeWidgetItem(selection);
-        caretVirtual->setText(0, tr("Caret Virtual Space"));
-        caretVirtual->setText(1, QString::number(editor->selectionNCaretVirtualSpace(i)));
+        selection->child(0)->setText(1, QString::number(editor->selectionNCaret(i)));
+        selection->child(1)->setText(1, QString::number(editor->selectionNAnchor(i)));
+        selection->child(2)->setText(1, QString::number(editor->selectionNCaretVirtualSpace(i)));
+        selection->child(3)->setText(1, QString::number(editor->selectionNAnchorVirtualSpace(i)));
+    }
 
-        QTreeWidgetItem *anchorVirtual = new QTreeWidgetItem(selection);
-        anchorVirtual->setText(0, tr("Anchor Virtual Space"));
-        anchorVirtual->setText(1, QString::number(editor->selectionNAnchorVirtualSpace(i)));
+    if (selections > shown) {
+        moreSelections = new QTreeWidgetItem(selectionsInfo);
+        moreSelections->setText(0, tr("%L1 more...").arg(selections - shown));
     }
 
-    ui->treeWidget->resizeColumnToContents(0);
+    if (countChanged) {
+        ui->treeWidget->resizeColumnToContents(0);
+    }
 }
 
 void EditorInspectorDock::newItem(QTreeWidgetItem *parent, const QString &label, EditorFunction func)
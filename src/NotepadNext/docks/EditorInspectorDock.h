@@ -21,12 +21,14 @@
 #define EDITORINSPECTORDOCK_H
 
 #include <QDockWidget>
+#include <QPointer>
 #include <QTreeWidgetItem>
 
 #include "ScintillaTypes.h"
 
 
 class MainWindow;
+class QTimer;
 class ScintillaNext;
 
 typedef std::function<QString(ScintillaNext *)> EditorFunction;
@@ -51,9 +53,13 @@ private slots:
 private:
     void newItem(QTreeWidgetItem *parent, const QString &label, EditorFunction func);
     void disconnectFromEditor();
+    void updateSelections(ScintillaNext *editor);
 
     Ui::EditorInspectorDock *ui;
     QTreeWidgetItem *selectionsInfo;
+    QTreeWidgetItem *moreSelections = Q_NULLPTR;
+    QPointer<ScintillaNext> pendingEditor;
+    QTimer *updateTimer;
     QMetaObject::Connection editorConnection;
     QVector<QPair<QTreeWidgetItem *, EditorFunction>> items;
 };
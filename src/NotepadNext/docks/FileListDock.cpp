@@ -19,6 +19,7 @@
 
 #include "FileListDock.h"
 #include "ApplicationSettings.h"
+#include "FileListModel.h"
 #include "ui_FileListDock.h"
 
 #include "MainWindow.h"
@@ -28,58 +29,53 @@ ApplicationSetting<bool> sortByName{"FileList/SortByName", false};
 FileListDock::FileListDock(MainWindow *parent) :
     QDockWidget(parent),
     ui(new Ui::FileList),
-    window(parent)
+    window(parent),
+    model(new FileListModel([=]() { return parent->getDockedEditor()->editors(); }, this))
 {
     qInfo(Q_FUNC_INFO);
 
     ui->setupUi(this);
     ui->btnSettings->addAction(ui->actionSortbyFileName);
+    ui->listView->setModel(model);
 
     // Set the initial state
-    ApplicationSettings settings;
-    ui->actionSortbyFileName->setChecked(settings.get(sortByName));
+    ui->actionSortbyFileName->setChecked(ApplicationSettings::get(sortByName));
+    model->setSortByName(ApplicationSettings::get(sortByName));
 
     // Track it if it changes
     connect(ui->actionSortbyFileName, &QAction::toggled, this, [=](bool b) {
-        ApplicationSettings settings;
-        settings.set(sortByName, b);
-        refreshList();
+        ApplicationSettings::set(sortByName, b);
+        model->setSortByName(b);
+        selectCurrentEditor();
     });
 
     connect(this, &QDockWidget::visibilityChanged, this, [=](bool visible) {
         if (visible) {
-            // Only get events when the dock is visible
-            connect(window->getDockedEditor(), &DockedEditor::editorAdded, this, [=](ScintillaNext *editor) {
-                Q_UNUSED(editor);
-
-                // The editor could get added on any DockArea and doesn't necessarily get appended to the end of the FileList, so refresh everything
-                refreshList();
-            });
+            // Only get events when the dock is visible. Files tend to get opened in batches, e.g. restoring a
+            // session, and the editor could get added on any DockArea, so the changes are collected and the
+            // list is brought in line with the docked editor's order once they are done.
+            connect(window->getDockedEditor(), &DockedEditor::editorAdded, model, &FileListModel::scheduleUpdate);
+            connect(window->getDockedEditor(), &DockedEditor::editorOrderChanged, model, &FileListModel::scheduleUpdate);
+            connect(window->getDockedEditor(), &DockedEditor::editorClosed, model, &FileListModel::removeEditor);
+            connect(window->getDockedEditor(), &DockedEditor::editorsClosed, model, &FileListModel::removeEditors);
             connect(window->getDockedEditor(), &DockedEditor::editorActivated, this, &FileListDock::selectCurrentEditor);
-            connect(window->getDockedEditor(), &DockedEditor::editorClosed, this, &FileListDock::removeEditor);
-            connect(window->getDockedEditor(), &DockedEditor::editorOrderChanged, this, &FileListDock::refreshList);
+            connect(model, &FileListModel::rowsInserted, this, &FileListDock::selectCurrentEditor);
 
-            refreshList();
+            model->update();
             selectCurrentEditor();
         }
         else {
-            // Disconnect all the editors
-            for(int i = 0; i < ui->listWidget->count(); ++i) {
-                QListWidgetItem* item = ui->listWidget->item(i);
-                const ScintillaNext *other = item->data(Qt::UserRole).value<ScintillaNext *>();
-
-                disconnect(other, Q_NULLPTR, this, Q_NULLPTR);
-            }
-
-            // Don't need to clear it but why not
-            ui->listWidget->clear();
+            // Don't need to keep it around but why not
+            model->clear();
 
             // Don't need events from the docked editor either
+            disconnect(window->getDockedEditor(), Q_NULLPTR, model, Q_NULLPTR);
             disconnect(window->getDockedEditor(), Q_NULLPTR, this, Q_NULLPTR);
+            disconnect(model, &FileListModel::rowsInserted, this, &FileListDock::selectCurrentEditor);
         }
     });
 
-    connect(ui->listWidget, &QListWidget::itemClicked, this, &FileListDock::itemClicked);
+    connect(ui->listView, &QListView::clicked, this, &FileListDock::itemClicked);
 }
 
 FileListDock::~FileListDock()
@@ -87,122 +83,24 @@ FileListDock::~FileListDock()
     delete ui;
 }
 
-void FileListDock::refreshList()
-{
-    qInfo(Q_FUNC_INFO);
-
-    ui->listWidget->clear();
-
-    QVector<ScintillaNext*> editors = window->getDockedEditor()->editors();
-    ApplicationSettings settings;
-
-    if (settings.get(sortByName)) {
-        std::sort(editors.begin(), editors.end(), [](const ScintillaNext* e1, const ScintillaNext* e2) {
-            return QString::compare(e1->getName(), e2->getName(), Qt::CaseInsensitive) < 0;
-        });
-    }
-
-    for (ScintillaNext *editor : editors) {
-        addEditor(editor);
-    }
-
-    selectCurrentEditor();
-}
-
-void FileListDock::addEditor(ScintillaNext *editor)
-{
-    qInfo(Q_FUNC_INFO);
-
-    QListWidgetItem *item = new QListWidgetItem(editor->getName());
-    item->setToolTip(editor->getName());
-    item->setIcon(QIcon(":/icons/saved.png"));
-    item->setData(Qt::UserRole, QVariant::fromValue(editor));
-    item->setIcon(QIcon(editor->canSaveToDisk() ? ":/icons/unsaved.png" : ":/icons/saved.png"));
-
-    // Need some notifications from the editor itself
-    // NOTE: Cannot use a lambda here because item is not a QObject, and thus cannot be used as a context for Qt to know
-    // when to cancel the connection. If item was a QObject, the lambda is disconnected when the sender or context is destroyed
-    connect(editor, &ScintillaNext::savePointChanged, this, &FileListDock::editorSavePointChanged, Qt::UniqueConnection);
-    connect(editor, &ScintillaNext::renamed, this, &FileListDock::editorRenamed, Qt::UniqueConnection);
-
-    ui->listWidget->addItem(item);
-}
-
-void FileListDock::removeEditor(ScintillaNext *editor)
-{
-    qInfo(Q_FUNC_INFO);
-
-    QListWidgetItem* item = lookupItemByEditor(editor);
-
-    if (item) {
-        delete ui->listWidget->takeItem(ui->listWidget->row(item));
-    }
-}
-
 void FileListDock::selectCurrentEditor()
 {
     qInfo(Q_FUNC_INFO);
 
-    ScintillaNext *editor = window->currentEditor();
-    QListWidgetItem* item = lookupItemByEditor(editor);
-
-    if (item) {
-        ui->listWidget->setCurrentItem(item);
-    }
-}
-
-void FileListDock::itemClicked(QListWidgetItem *item)
-{
-    qInfo(Q_FUNC_INFO);
-
-    ScintillaNext *editor = item->data(Qt::UserRole).value<ScintillaNext *>();
-
-    window->getDockedEditor()->switchToEditor(editor);
-}
-
-void FileListDock::editorSavePointChanged(bool dirty)
-{
-    Q_UNUSED(dirty);
-    qInfo(Q_FUNC_INFO);
-
-    ScintillaNext *editor = qobject_cast<ScintillaNext *>(sender());
-
-    if (editor) {
-        QListWidgetItem* item = lookupItemByEditor(editor);
+    const QModelIndex index = model->indexOf(window->currentEditor());
 
-        if (item) {
-            const QString iconPath = editor->canSaveToDisk() ? ":/icons/unsaved.png" : ":/icons/saved.png";
-            item->setIcon(QIcon(iconPath));
-        }
+    if (index.isValid()) {
+        ui->listView->setCurrentIndex(index);
     }
 }
 
-void FileListDock::editorRenamed()
+void FileListDock::itemClicked(const QModelIndex &index)
 {
     qInfo(Q_FUNC_INFO);
 
-    ScintillaNext *editor = qobject_cast<ScintillaNext *>(sender());
+    ScintillaNext *editor = model->editorAt(index);
 
     if (editor) {
-        QListWidgetItem* item = lookupItemByEditor(editor);
-
-        if (item) {
-            item->setText(editor->getName());
-            item->setToolTip(editor->getName());
-        }
+        window->getDockedEditor()->switchToEditor(editor);
     }
 }
-
-QListWidgetItem *FileListDock::lookupItemByEditor(ScintillaNext *editor)
-{
-    for(int i = 0; i < ui->listWidget->count(); ++i) {
-        QListWidgetItem* item = ui->listWidget->item(i);
-        const ScintillaNext *other = item->data(Qt::UserRole).value<ScintillaNext *>();
-
-        if (other == editor) {
-            return item;
-        }
-    }
-
-    return Q_NULLPTR;
-}
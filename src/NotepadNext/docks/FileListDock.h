@@ -23,12 +23,12 @@
 #include "ScintillaNext.h"
 
 #include <QDockWidget>
-#include <QListWidgetItem>
 
 namespace Ui {
 class FileList;
 }
 
+class FileListModel;
 class MainWindow;
 
 class FileListDock : public QDockWidget
@@ -40,22 +40,14 @@ public:
     ~FileListDock();
 
 private slots:
-    void refreshList();
-    void addEditor(ScintillaNext *editor);
-    void removeEditor(ScintillaNext *editor);
-
     void selectCurrentEditor();
 
-    void itemClicked(QListWidgetItem *item);
-
-    void editorSavePointChanged(bool dirty);
-    void editorRenamed();
+    void itemClicked(const QModelIndex &index);
 
 private:
-    QListWidgetItem *lookupItemByEditor(ScintillaNext *editor);
-
     Ui::FileList *ui;
     MainWindow *window;
+    FileListModel *model;
 };
 
 #endif // FILELISTDOCK_H
@@ -19,23 +19,44 @@
 
 #include "FolderAsWorkspaceDock.h"
 #include "ApplicationSettings.h"
+#include "TrigramIndex.h"
+#include "WorkspaceModel.h"
 #include "ui_FolderAsWorkspaceDock.h"
 
-#include <QFileSystemModel>
+#include <QDir>
+#include <QInputDialog>
+#include <QStringListModel>
+#include <QTimer>
 
 ApplicationSetting<QString> rootPathSetting{"FolderAsWorkspace/RootPath"};
+ApplicationSetting<QString> excludePatternsSetting{"FolderAsWorkspace/ExcludePatterns", "!node_modules !build !.vs"};
+ApplicationSetting<bool> respectGitIgnoreSetting{"FolderAsWorkspace/RespectGitIgnore", true};
+ApplicationSetting<bool> indexContentsSetting{"FolderAsWorkspace/IndexContents", false};
+
+static const int MAX_FILTER_RESULTS = 500;
 
 FolderAsWorkspaceDock::FolderAsWorkspaceDock(QWidget *parent) :
     QDockWidget(parent),
     ui(new Ui::FolderAsWorkspaceDock),
-    model(new QFileSystemModel(this))
+    model(new WorkspaceModel(this)),
+    matchesModel(new QStringListModel(this)),
+    filterTimer(new QTimer(this)),
+    trigramIndex(new TrigramIndex(this))
 {
     ui->setupUi(this);
+    ui->btnSettings->addAction(ui->actionRespectGitIgnore);
+    ui->btnSettings->addAction(ui->actionExcludePatterns);
+    ui->btnSettings->addAction(ui->actionIndexContents);
+    ui->listMatches->setModel(matchesModel);
+    ui->listMatches->hide();
+    ui->lblStatus->hide();
+
+    ui->actionRespectGitIgnore->setChecked(ApplicationSettings::get(respectGitIgnoreSetting));
+    ui->actionIndexContents->setChecked(ApplicationSettings::get(indexContentsSetting));
+    model->setRespectGitIgnore(ApplicationSettings::get(respectGitIgnoreSetting));
+    model->setExcludePatterns(ApplicationSettings::get(excludePatternsSetting));
 
     ui->treeView->setModel(model);
-    ui->treeView->header()->hideSection(1);
-    ui->treeView->header()->hideSection(2);
-    ui->treeView->header()->hideSection(3);
 
     connect(ui->treeView, &QTreeView::doubleClicked, this, [=](const QModelIndex &index) {
         if (!model->isDir(index)) {
@@ -43,8 +64,50 @@ FolderAsWorkspaceDock::FolderAsWorkspaceDock(QWidget *parent) :
         }
     });
 
-    ApplicationSettings settings;
-    setRootPath(settings.get(rootPathSetting));
+    // Only the directories that are actually open need to be watched for changes
+    connect(ui->treeView, &QTreeView::expanded, this, [=](const QModelIndex &index) { model->setWatched(index, true); });
+    connect(ui->treeView, &QTreeView::collapsed, this, [=](const QModelIndex &index) { model->setWatched(index, false); });
+
+    connect(ui->actionRespectGitIgnore, &QAction::toggled, this, [=](bool b) {
+        ApplicationSettings::set(respectGitIgnoreSetting, b);
+        model->setRespectGitIgnore(b);
+        applyFilter();
+        updateContentIndex();
+    });
+    connect(ui->actionExcludePatterns, &QAction::triggered, this, &FolderAsWorkspaceDock::editExcludePatterns);
+    connect(ui->actionIndexContents, &QAction::toggled, this, [=](bool b) {
+        ApplicationSettings::set(indexContentsSetting, b);
+        updateContentIndex();
+    });
+
+    // The content index only hears about directories being watched, anything else is caught by
+    // checking each file's modified time and size before trusting the index with it
+    connect(model, &WorkspaceModel::directoryChanged, trigramIndex, &TrigramIndex::refreshDirectory);
+
+    // Wait for a pause in typing rather than filtering on every key press
+    filterTimer->setSingleShot(true);
+    filterTimer->setInterval(100);
+    connect(filterTimer, &QTimer::timeout, this, &FolderAsWorkspaceDock::applyFilter);
+    connect(ui->editFilter, &QLineEdit::textChanged, filterTimer, QOverload<>::of(&QTimer::start));
+    connect(model, &WorkspaceModel::pathIndexReady, this, &FolderAsWorkspaceDock::applyFilter);
+
+    connect(ui->editFilter, &QLineEdit::returnPressed, this, [=]() {
+        if (filterTimer->isActive()) {
+            filterTimer->stop();
+            applyFilter();
+        }
+
+        const QModelIndex index = ui->listMatches->currentIndex().isValid() ? ui->listMatches->currentIndex() : matchesModel->index(0);
+        if (index.isValid()) {
+            emit ui->listMatches->activated(index);
+        }
+    });
+
+    connect(ui->listMatches, &QListView::activated, this, [=](const QModelIndex &index) {
+        emit fileDoubleClicked(QDir(model->rootPath()).filePath(index.data().toString()));
+    });
+
+    setRootPath(ApplicationSettings::get(rootPathSetting));
 }
 
 FolderAsWorkspaceDock::~FolderAsWorkspaceDock()
@@ -54,14 +117,77 @@ FolderAsWorkspaceDock::~FolderAsWorkspaceDock()
 
 void FolderAsWorkspaceDock::setRootPath(const QString dir)
 {
-    ApplicationSettings settings;
-    settings.set(rootPathSetting, dir);
+    ApplicationSettings::set(rootPathSetting, dir);
 
     model->setRootPath(dir);
-    ui->treeView->setRootIndex(model->index(dir));
+    applyFilter();
+    updateContentIndex();
 }
 
 QString FolderAsWorkspaceDock::rootPath() const
 {
     return model->rootPath();
 }
+
+void FolderAsWorkspaceDock::applyFilter()
+{
+    const QString query = ui->editFilter->text().trimmed();
+
+    if (query.isEmpty()) {
+        matchesModel->setStringList(QStringList());
+        ui->listMatches->hide();
+        ui->lblStatus->hide();
+        ui->treeView->show();
+        return;
+    }
+
+    ui->treeView->hide();
+    ui->listMatches->show();
+
+    // The first filter for a root walks the whole tree in the background, this gets called again once it is done
+    WorkspacePathIndex *index = model->pathIndex();
+    if (!index) {
+        matchesModel->setStringList(QStringList());
+        ui->lblStatus->setText(model->rootPath().isEmpty() ? tr("No folder is open") : tr("Indexing files..."));
+        ui->lblStatus->show();
+        return;
+    }
+
+    QStringList paths;
+    for (const WorkspacePathIndex::Match &match : index->filter(query, MAX_FILTER_RESULTS)) {
+        paths.append(index->path(match.file));
+    }
+    matchesModel->setStringList(paths);
+
+    if (index->isTruncated()) {
+        ui->lblStatus->setText(tr("Only the first %L1 files were indexed").arg(index->count()));
+        ui->lblStatus->show();
+    }
+    else {
+        ui->lblStatus->hide();
+    }
+}
+
+void FolderAsWorkspaceDock::editExcludePatterns()
+{
+    bool ok;
+
+    const QString patterns = QInputDialog::getText(this, tr("Exclude Patterns"), tr("Names to leave out, e.g. !node_modules !*.o"), QLineEdit::Normal, ApplicationSettings::get(excludePatternsSetting), &ok);
+
+    if (ok) {
+        ApplicationSettings::set(excludePatternsSetting, patterns);
+        model->setExcludePatterns(patterns);
+        applyFilter();
+        updateContentIndex();
+    }
+}
+
+void FolderAsWorkspaceDock::updateContentIndex()
+{
+    if (ApplicationSettings::get(indexContentsSetting)) {
+        trigramIndex->setRootPath(model->rootPath(), ApplicationSettings::get(excludePatternsSetting), ApplicationSettings::get(respectGitIgnoreSetting));
+    }
+    else {
+        trigramIndex->setRootPath(QString(), QString(), false);
+    }
+}
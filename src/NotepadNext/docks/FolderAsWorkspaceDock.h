@@ -26,7 +26,10 @@ namespace Ui {
 class FolderAsWorkspaceDock;
 }
 
-class QFileSystemModel;
+class QStringListModel;
+class QTimer;
+class TrigramIndex;
+class WorkspaceModel;
 
 class FolderAsWorkspaceDock : public QDockWidget
 {
@@ -39,13 +42,24 @@ public:
     void setRootPath(const QString dir);
     QString rootPath() const;
 
+    WorkspaceModel *workspace() const { return model; }
+    TrigramIndex *contentIndex() const { return trigramIndex; }
+
 signals:
     void fileDoubleClicked(const QString &filePath);
 
+private slots:
+    void applyFilter();
+    void editExcludePatterns();
+    void updateContentIndex();
+
 private:
     Ui::FolderAsWorkspaceDock *ui;
 
-    QFileSystemModel *model;
+    WorkspaceModel *model;
+    QStringListModel *matchesModel;
+    QTimer *filterTimer;
+    TrigramIndex *trigramIndex;
 };
 
 #endif // FOLDERASWORKSPACEDOCK_H
@@ -16,7 +16,13 @@
  * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
 #include <QFontDatabase>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QItemSelection>
 
 #include "MainWindow.h"
 #include "ScintillaNext.h"
@@ -24,7 +30,9 @@
 #include "HexViewerDock.h"
 #include "ui_HexViewerDock.h"
 
+#include "BytePattern.h"
 #include "EditorHexViewerTableModel.h"
+#include "HexViewerDelegate.h"
 
 
 HexViewerDock::HexViewerDock(MainWindow *parent) :
@@ -36,6 +44,31 @@ HexViewerDock::HexViewerDock(MainWindow *parent) :
     // Set the font of the table to a monospaced font...not sure how best to do this
     QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont).family();
     ui->tblHexView->setFont(font);
+    ui->tblHexView->setItemDelegate(new HexViewerDelegate(this));
+
+    // Sizing the rows to their contents has to look at every one of them, and they are all the same height anyway
+    ui->tblHexView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tblHexView->verticalHeader()->setDefaultSectionSize(ui->tblHexView->fontMetrics().height() + 4);
+
+    connect(ui->editFindBytes, &QLineEdit::returnPressed, this, [=]() { findBytes(false); });
+    connect(ui->btnFindNext, &QToolButton::clicked, this, [=]() { findBytes(false); });
+    connect(ui->btnFindPrevious, &QToolButton::clicked, this, [=]() { findBytes(true); });
+    connect(ui->editFindBytes, &QLineEdit::textChanged, ui->lblFindStatus, &QLabel::clear);
+
+    QAction *copyAction = new QAction(tr("Copy as Hex"), this);
+    copyAction->setShortcut(QKeySequence::Copy);
+    copyAction->setShortcutContext(Qt::WidgetShortcut);
+    connect(copyAction, &QAction::triggered, this, &HexViewerDock::copySelectionAsHex);
+
+    QAction *pasteAction = new QAction(tr("Paste Hex"), this);
+    pasteAction->setShortcut(QKeySequence::Paste);
+    pasteAction->setShortcutContext(Qt::WidgetShortcut);
+    connect(pasteAction, &QAction::triggered, this, &HexViewerDock::pasteHex);
+
+    QAction *fillAction = new QAction(tr("Fill Selection..."), this);
+    connect(fillAction, &QAction::triggered, this, &HexViewerDock::fillSelection);
+
+    ui->tblHexView->addActions({copyAction, pasteAction, fillAction});
 
     connect(this, &QDockWidget::visibilityChanged, this, [=](bool visible) {
         if (visible) {
@@ -64,5 +97,185 @@ void HexViewerDock::connectToEditor(ScintillaNext *editor)
     model->setEditor(editor);
     ui->tblHexView->setModel(model);
     ui->tblHexView->resizeColumnsToContents();
-    ui->tblHexView->resizeRowsToContents();
+}
+
+void HexViewerDock::findBytes(bool backwards)
+{
+    EditorHexViewerTableModel *hexModel = model();
+    const BytePattern pattern(ui->editFindBytes->text());
+
+    if (hexModel == Q_NULLPTR) {
+        return;
+    }
+
+    if (!pattern.isValid()) {
+        ui->lblFindStatus->setText(tr("Invalid pattern"));
+        return;
+    }
+
+    // Carry on from the match that is selected, if there is one
+    qint64 start = 0;
+    qint64 end = 0;
+    qint64 from = 0;
+
+    if (selectedRange(start, end)) {
+        from = backwards ? start - 1 : start + 1;
+    }
+    else if (backwards) {
+        from = hexModel->length();
+    }
+
+    qint64 found = hexModel->find(pattern, from, backwards);
+    bool wrapped = false;
+
+    if (found < 0) {
+        found = hexModel->find(pattern, backwards ? hexModel->length() : 0, backwards);
+        wrapped = true;
+    }
+
+    if (found < 0) {
+        ui->lblFindStatus->setText(tr("Not found"));
+        return;
+    }
+
+    ui->lblFindStatus->setText(wrapped ? tr("Wrapped") : QString());
+    selectRange(found, found + pattern.length());
+}
+
+void HexViewerDock::fillSelection()
+{
+    EditorHexViewerTableModel *hexModel = model();
+    qint64 start = 0;
+    qint64 end = 0;
+
+    if (hexModel == Q_NULLPTR || hexModel->isReadOnly() || !selectedRange(start, end)) {
+        return;
+    }
+
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Fill Selection"), tr("Bytes:"), QLineEdit::Normal, QStringLiteral("00"), &ok);
+
+    if (!ok) {
+        return;
+    }
+
+    const BytePattern pattern(text);
+
+    if (!pattern.isValid() || pattern.hasWildcards()) {
+        ui->lblFindStatus->setText(tr("Invalid bytes"));
+        return;
+    }
+
+    hexModel->fillBytes(start, end, pattern.bytes());
+    selectRange(start, end);
+}
+
+void HexViewerDock::copySelectionAsHex()
+{
+    EditorHexViewerTableModel *hexModel = model();
+    qint64 start = 0;
+    qint64 end = 0;
+
+    if (hexModel == Q_NULLPTR || !selectedRange(start, end)) {
+        return;
+    }
+
+    QString text;
+    text.reserve(static_cast<int>((end - start) * 3));
+
+    for (qint64 position = start; position < end; ++position) {
+        if (position > start) {
+            text += (position % 16 == 0) ? QChar('\n') : QChar(' ');
+        }
+
+        text += hexModel->indexOf(position).data().toString();
+    }
+
+    QApplication::clipboard()->setText(text);
+}
+
+void HexViewerDock::pasteHex()
+{
+    EditorHexViewerTableModel *hexModel = model();
+
+    if (hexModel == Q_NULLPTR || hexModel->isReadOnly()) {
+        return;
+    }
+
+    const BytePattern pattern(QApplication::clipboard()->text());
+
+    if (!pattern.isValid() || pattern.hasWildcards()) {
+        ui->lblFindStatus->setText(tr("The clipboard does not hold hex bytes"));
+        return;
+    }
+
+    // Goes over the bytes from the start of the selection, or the end of the document if nothing is selected
+    qint64 start = hexModel->length();
+    qint64 end = start;
+
+    selectedRange(start, end);
+
+    if (hexModel->overwriteBytes(start, pattern.bytes())) {
+        selectRange(start, start + pattern.length());
+    }
+}
+
+EditorHexViewerTableModel *HexViewerDock::model() const
+{
+    return qobject_cast<EditorHexViewerTableModel *>(ui->tblHexView->model());
+}
+
+bool HexViewerDock::selectedRange(qint64 &start, qint64 &end) const
+{
+    const EditorHexViewerTableModel *hexModel = model();
+
+    if (hexModel == Q_NULLPTR || ui->tblHexView->selectionModel() == Q_NULLPTR) {
+        return false;
+    }
+
+    qint64 first = -1;
+    qint64 last = -1;
+
+    // Everything from the first selected byte to the last, as the bytes run on from one row to the next
+    for (const QModelIndex &index : ui->tblHexView->selectionModel()->selectedIndexes()) {
+        const qint64 position = EditorHexViewerTableModel::positionOf(index);
+
+        if (index.column() == 16 || position >= hexModel->length()) {
+            continue;
+        }
+
+        first = first < 0 ? position : qMin(first, position);
+        last = qMax(last, position);
+    }
+
+    if (first < 0) {
+        return false;
+    }
+
+    start = first;
+    end = last + 1;
+
+    return true;
+}
+
+void HexViewerDock::selectRange(qint64 start, qint64 end)
+{
+    EditorHexViewerTableModel *hexModel = model();
+
+    if (hexModel == Q_NULLPTR || end <= start) {
+        return;
+    }
+
+    QItemSelection selection;
+
+    for (qint64 row = start / 16; row <= (end - 1) / 16; ++row) {
+        const int firstColumn = row == start / 16 ? static_cast<int>(start % 16) : 0;
+        const int lastColumn = row == (end - 1) / 16 ? static_cast<int>((end - 1) % 16) : 15;
+
+        selection.select(hexModel->index(static_cast<int>(row), firstColumn), hexModel->index(static_cast<int>(row), lastColumn));
+    }
+
+    ui->tblHexView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+    ui->tblHexView->selectionModel()->setCurrentIndex(hexModel->indexOf(start), QItemSelectionModel::NoUpdate);
+    ui->tblHexView->scrollTo(hexModel->indexOf(start));
 }
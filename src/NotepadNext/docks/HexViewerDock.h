@@ -25,6 +25,7 @@
 namespace Ui {
 class HexViewerDock;
 }
+class EditorHexViewerTableModel;
 class MainWindow;
 class ScintillaNext;
 
@@ -39,7 +40,17 @@ public:
 private slots:
     void connectToEditor(ScintillaNext *editor);
 
+    void findBytes(bool backwards);
+    void fillSelection();
+    void copySelectionAsHex();
+    void pasteHex();
+
 private:
+    EditorHexViewerTableModel *model() const;
+
+    // The bytes [start, end) of the selected cells, false if nothing is selected
+    bool selectedRange(qint64 &start, qint64 &end) const;
+    void selectRange(qint64 start, qint64 end);
 
     Ui::HexViewerDock *ui;
 };
@@ -62,12 +62,49 @@ static QString property_type_to_string(int type) {
     }
 }
 
+// Rows are kept from one refresh to the next instead of being thrown away, items are only made for new ones
+static QTableWidgetItem *reuseItem(QTableWidget *table, int row, int column, Qt::ItemFlags flags)
+{
+    QTableWidgetItem *item = table->item(row, column);
+
+    if (!item) {
+        item = new QTableWidgetItem();
+        item->setFlags(flags);
+        table->setItem(row, column, item);
+    }
+
+    return item;
+}
+
+static void setItemText(QTableWidgetItem *item, const QString &text)
+{
+    if (item->text() != text) {
+        item->setText(text);
+    }
+}
+
 LanguageInspectorDock::LanguageInspectorDock(MainWindow *parent) :
     QDockWidget(parent),
-    ui(new Ui::LanguageInspectorDock)
+    ui(new Ui::LanguageInspectorDock),
+    stylesModel(new LanguageStylesModel(Q_NULLPTR, this))
 {
     ui->setupUi(this);
 
+    ui->tblStyles->setModel(stylesModel);
+    ui->tblProperties->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
+
+    connect(ui->tblProperties, &QTableWidget::itemChanged, this, [=](QTableWidgetItem *item) {
+        if (!currentEditor || item->column() != 3) {
+            return;
+        }
+
+        const QString property = ui->tblProperties->item(item->row(), 0)->text();
+
+        currentEditor->setProperty(property.toLatin1().constData(), item->text().toLatin1().constData());
+
+        currentEditor->colourise(0, -1);
+    });
+
     SpinBoxDelegate *fontSizeDelegate = new SpinBoxDelegate(FontSizeSpinBoxFactory, this);
     ui->tblStyles->setItemDelegateForColumn(5, fontSizeDelegate);
 
@@ -149,6 +186,8 @@ void LanguageInspectorDock::updatePositionInfo(Scintilla::Update updated)
 
 void LanguageInspectorDock::updateLexerInfo(ScintillaNext *editor)
 {
+    currentEditor = editor;
+
     updateLanguageName(editor);
     updatePropertyInfo(editor);
     updateKeywordInfo(editor);
@@ -167,104 +206,76 @@ void LanguageInspectorDock::updatePropertyInfo(ScintillaNext *editor)
 {
     const QSignalBlocker blocker(ui->tblProperties);
 
-    ui->tblProperties->clearContents();
-
     const QString propertyNames = editor->propertyNames();
+    const QStringList propertyNamesList = propertyNames.isEmpty() ? QStringList() : propertyNames.split('\n');
 
-    if (propertyNames.isEmpty()) {
-        ui->tblProperties->setRowCount(0);
-    }
-    else {
-        QStringList propertyNamesList = propertyNames.split('\n');
-
-        ui->tblProperties->setRowCount(propertyNamesList.count());
+    ui->tblProperties->setRowCount(propertyNamesList.count());
 
-        for (int i = 0; i < propertyNamesList.count(); ++i) {
-            const auto property = propertyNamesList[i];
+    const Qt::ItemFlags readOnly = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
 
-            QTableWidgetItem *prop = new QTableWidgetItem(property);
-            QTableWidgetItem *type = new QTableWidgetItem(property_type_to_string(editor->propertyType(property.toLatin1().constData())));
-            QTableWidgetItem *desc = new QTableWidgetItem(QString(editor->describeProperty(property.toLatin1().constData())));
-            QTableWidgetItem *val = new QTableWidgetItem(QString(editor->property(property.toLatin1().constData())));
+    for (int i = 0; i < propertyNamesList.count(); ++i) {
+        const QByteArray property = propertyNamesList[i].toLatin1();
 
-            desc->setToolTip(desc->text());
+        QTableWidgetItem *desc = reuseItem(ui->tblProperties, i, 2, readOnly);
+        QTableWidgetItem *val = reuseItem(ui->tblProperties, i, 3, readOnly | Qt::ItemIsEditable);
 
-            prop->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-            type->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-            desc->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-            val->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable);
+        setItemText(reuseItem(ui->tblProperties, i, 0, readOnly), propertyNamesList[i]);
+        setItemText(reuseItem(ui->tblProperties, i, 1, readOnly), property_type_to_string(editor->propertyType(property.constData())));
+        setItemText(desc, QString(editor->describeProperty(property.constData())));
+        setItemText(val, QString(editor->property(property.constData())));
 
-            val->setTextAlignment(Qt::AlignCenter);
-
-            ui->tblProperties->setItem(i, 0, prop);
-            ui->tblProperties->setItem(i, 1, type);
-            ui->tblProperties->setItem(i, 2, desc);
-            ui->tblProperties->setItem(i, 3, val);
-        }
+        desc->setToolTip(desc->text());
+        val->setTextAlignment(Qt::AlignCenter);
     }
 
-    ui->tblProperties->resizeColumnToContents(0);
-    ui->tblProperties->resizeColumnToContents(1);
-    ui->tblProperties->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
-    ui->tblProperties->resizeColumnToContents(3);
+    const QString lexer = editor->lexerLanguage();
+    if (lexer != sizedPropertiesLexer) {
+        sizedPropertiesLexer = lexer;
 
-    ui->tblProperties->disconnect();
-    connect(ui->tblProperties, &QTableWidget::itemChanged, this, [=](QTableWidgetItem *item) {
-        const QString property = ui->tblProperties->item(item->row(), 0)->text();
-
-        editor->setProperty(property.toLatin1().constData(), item->text().toLatin1().constData());
-
-        editor->colourise(0, -1);
-    });
+        ui->tblProperties->resizeColumnToContents(0);
+        ui->tblProperties->resizeColumnToContents(1);
+        ui->tblProperties->resizeColumnToContents(3);
+    }
 }
 
 void LanguageInspectorDock::updateKeywordInfo(ScintillaNext *editor)
 {
-    ui->tblKeywords->clearContents();
-
     const QString keyWordSetsDescription = QString(editor->describeKeyWordSets());
+    const QStringList keyWordsSets = keyWordSetsDescription.isEmpty() ? QStringList() : keyWordSetsDescription.split('\n');
 
-    if (keyWordSetsDescription.isEmpty()) {
-        ui->tblKeywords->setRowCount(0);
-    }
-    else {
-        QStringList keyWordsSets = keyWordSetsDescription.split('\n');
+    ui->tblKeywords->setRowCount(keyWordsSets.count());
 
-        ui->tblKeywords->setRowCount(keyWordsSets.count());
+    const Qt::ItemFlags flags = Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
 
-        for (int i = 0; i < keyWordsSets.count(); ++i) {
-            auto id = new QTableWidgetItem(QString::number(i));
-            id->setTextAlignment(Qt::AlignCenter);
+    for (int i = 0; i < keyWordsSets.count(); ++i) {
+        QTableWidgetItem *id = reuseItem(ui->tblKeywords, i, 0, flags);
+        id->setTextAlignment(Qt::AlignCenter);
 
-            ui->tblKeywords->setItem(i, 0, id);
-            ui->tblKeywords->setItem(i, 1, new QTableWidgetItem(keyWordsSets[i]));
-        }
+        setItemText(id, QString::number(i));
+        setItemText(reuseItem(ui->tblKeywords, i, 1, flags), keyWordsSets[i]);
     }
 
-    ui->tblKeywords->resizeColumnToContents(0);
+    const QString lexer = editor->lexerLanguage();
+    if (lexer != sizedKeywordsLexer) {
+        sizedKeywordsLexer = lexer;
+
+        ui->tblKeywords->resizeColumnToContents(0);
+    }
 }
 
 void LanguageInspectorDock::updateStyleInfo(ScintillaNext *editor)
 {
-    if (auto model = ui->tblStyles->model()) {
-        model->deleteLater();
+    stylesModel->setEditor(editor);
+
+    // Sizing a column asks the model for every row of it, so it is only worth doing when the styles are different
+    const QString lexer = editor->lexerLanguage();
+    if (lexer == sizedStylesLexer) {
+        return;
+    }
+
+    sizedStylesLexer = lexer;
+
+    for (int column : {0, 1, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18}) {
+        ui->tblStyles->resizeColumnToContents(column);
     }
-    ui->tblStyles->setModel(new LanguageStylesModel(editor));
-
-    ui->tblStyles->resizeColumnToContents(0);
-    ui->tblStyles->resizeColumnToContents(1);
-    ui->tblStyles->resizeColumnToContents(5);
-    ui->tblStyles->resizeColumnToContents(6);
-    ui->tblStyles->resizeColumnToContents(7);
-    ui->tblStyles->resizeColumnToContents(8);
-    ui->tblStyles->resizeColumnToContents(9);
-    ui->tblStyles->resizeColumnToContents(10);
-    ui->tblStyles->resizeColumnToContents(11);
-    ui->tblStyles->resizeColumnToContents(12);
-    ui->tblStyles->resizeColumnToContents(13);
-    ui->tblStyles->resizeColumnToContents(14);
-    ui->tblStyles->resizeColumnToContents(15);
-    ui->tblStyles->resizeColumnToContents(16);
-    ui->tblStyles->resizeColumnToContents(17);
-    ui->tblStyles->resizeColumnToContents(18);
 }
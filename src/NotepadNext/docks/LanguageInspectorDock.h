@@ -20,9 +20,11 @@
 #define LANGUAGEINSPECTORDOCK_H
 
 #include <QDockWidget>
+#include <QPointer>
 
 #include "ScintillaTypes.h"
 
+class LanguageStylesModel;
 class MainWindow;
 class ScintillaNext;
 
@@ -49,6 +51,14 @@ private:
     QMetaObject::Connection editorConnection;
     QMetaObject::Connection documentConnection;
 
+    QPointer<ScintillaNext> currentEditor;
+    LanguageStylesModel *stylesModel;
+
+    // The lexer the columns were last sized for, they only get sized again when it changes
+    QString sizedPropertiesLexer;
+    QString sizedKeywordsLexer;
+    QString sizedStylesLexer;
+
     void disconnectFromEditor();
     void updateLanguageName(ScintillaNext *editor);
     void updatePropertyInfo(ScintillaNext *editor);
@@ -30,12 +30,26 @@
 #include "lua.hpp"
 
 #include "LuaExtension.h"
+#include "LuaScriptJob.h"
+#include "MainWindow.h"
+#include "ApplicationSettings.h"
 
 #include <QKeyEvent>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #define INDIC_BRACEHIGHLIGHT INDIC_CONTAINER
 
+// Lines at the top of the output are removed once there are more than this, 0 keeps all of them
+ApplicationSetting<int> maxOutputLinesSetting{"LuaConsole/MaxOutputLines", 10000};
+
+// How often waiting output is added, and how much of it at most each time so the rest of the UI keeps up
+const int FLUSH_INTERVAL_MS = 16;
+const int MAX_FLUSH_BYTES = 256 * 1024;
+
+// Output a script prints faster than it can be shown is dropped from the front past this
+const int MAX_PENDING_OUTPUT = 16 * 1024 * 1024;
+
 static bool inline isBrace(int ch) {
     return strchr("[]{}()", ch) != NULL;
 }
@@ -96,6 +110,11 @@ LuaConsoleDock::LuaConsoleDock(LuaState *l, QWidget *parent) :
 
     ui->setupUi(this);
 
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(FLUSH_INTERVAL_MS);
+    connect(flushTimer, &QTimer::timeout, this, [=]() { flushOutput(MAX_FLUSH_BYTES); });
+
     output = new ScintillaNext(Q_NULLPTR, this);
 
     QFrame *line;
@@ -230,11 +249,87 @@ LuaConsoleDock::~LuaConsoleDock()
 }
 
 void LuaConsoleDock::writeToOutput(const char *s)
+{
+    pendingOutput.append(s);
+
+    // It could never all be kept anyway, so only the most recent output is
+    if (pendingOutput.size() > MAX_PENDING_OUTPUT) {
+        const int lineStart = pendingOutput.indexOf('\n', pendingOutput.size() - MAX_PENDING_OUTPUT / 2);
+
+        pendingOutput.remove(0, lineStart < 0 ? pendingOutput.size() - MAX_PENDING_OUTPUT / 2 : lineStart + 1);
+        pendingOutputDropped = true;
+    }
+
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void LuaConsoleDock::flushOutput(int limit)
+{
+    if (pendingOutputDropped) {
+        pendingOutputDropped = false;
+
+        const char dropped[] = "...\r\n";
+        appendToOutput(dropped, static_cast<int>(strlen(dropped)));
+    }
+
+    int length = qMin(limit, pendingOutput.size());
+
+    // Whole lines where possible, otherwise at least whole characters
+    if (length < pendingOutput.size()) {
+        const int lineEnd = pendingOutput.lastIndexOf('\n', length - 1);
+
+        if (lineEnd >= 0) {
+            length = lineEnd + 1;
+        }
+        else {
+            const int cut = length;
+
+            while (length > 0 && (static_cast<unsigned char>(pendingOutput.at(length)) & 0xC0) == 0x80) {
+                --length;
+            }
+
+            // Not text after all, so it doesn't matter where it is cut
+            if (length == 0) {
+                length = cut;
+            }
+        }
+    }
+
+    if (length > 0) {
+        appendToOutput(pendingOutput.constData(), length);
+        pendingOutput.remove(0, length);
+
+        trimOutput();
+        output->documentEnd();
+    }
+
+    if (!pendingOutput.isEmpty()) {
+        flushTimer->start();
+    }
+    else {
+        flushTimer->stop();
+        pendingOutput.squeeze();
+    }
+}
+
+void LuaConsoleDock::appendToOutput(const char *s, int length)
 {
     output->setReadOnly(false);
-    output->appendText(strlen(s), s);
+    output->appendText(length, s);
     output->setReadOnly(true);
-    output->documentEnd();
+}
+
+void LuaConsoleDock::trimOutput()
+{
+    const int maxLines = ApplicationSettings::get(maxOutputLinesSetting);
+
+    if (maxLines > 0 && output->lineCount() > maxLines) {
+        output->setReadOnly(false);
+        output->deleteRange(0, output->positionFromLine(output->lineCount() - maxLines));
+        output->setReadOnly(true);
+    }
 }
 
 void LuaConsoleDock::writeErrorToOutput(const char *s)
@@ -255,15 +350,21 @@ void LuaConsoleDock::writeErrorToOutput(const char *s)
     cells[length].c = 0;
     cells[length].style = 0;
 
+    flushAllOutput();
+
     output->setReadOnly(false);
     output->documentEnd();
     output->addStyledText(length * 2, (const char *) cells.constData());
     output->setReadOnly(true);
+
+    trimOutput();
     output->documentEnd();
 }
 
-void LuaConsoleDock::runCurrentCommand()
+void LuaConsoleDock::echoInput()
 {
+    flushAllOutput();
+
     int prevLastLine = output->lineCount();
     int newLastLine = 0;
 
@@ -277,7 +378,7 @@ void LuaConsoleDock::runCurrentCommand()
     output->setReadOnly(false);
     output->addStyledText(2 * (tr.chrg.cpMax - tr.chrg.cpMin), tr.lpstrText);
 
-    writeToOutput("\r\n");
+    appendToOutput("\r\n", 2);
 
     delete[] tr.lpstrText;
 
@@ -288,6 +389,14 @@ void LuaConsoleDock::runCurrentCommand()
         output->marginSetStyle(i - 1, STYLE_LINENUMBER);
     }
 
+    trimOutput();
+    output->documentEnd();
+}
+
+void LuaConsoleDock::runCurrentCommand()
+{
+    echoInput();
+
     QString text((const char *)input->characterPointer());
     //historyAdd(GUI::StringFromUTF8(text).c_str());
 
@@ -299,6 +408,54 @@ void LuaConsoleDock::runCurrentCommand()
     LuaExtension::Instance().OnExecute(text.toLatin1().constData());
 }
 
+void LuaConsoleDock::runCurrentCommandInBackground()
+{
+    MainWindow *window = qobject_cast<MainWindow *>(parentWidget());
+    ScintillaNext *editor = window ? window->currentEditor() : Q_NULLPTR;
+
+    if (editor == Q_NULLPTR)
+        return;
+
+    if (backgroundScript) {
+        writeErrorToOutput("A script is already running, press Escape to cancel it\r\n");
+        return;
+    }
+
+    echoInput();
+
+    const QByteArray script(reinterpret_cast<const char *>(input->characterPointer()), static_cast<int>(input->length()));
+
+    input->clearAll();
+    input->emptyUndoBuffer();
+    input->marginSetText(0, ">");
+    input->marginSetStyle(0, STYLE_LINENUMBER);
+
+    backgroundScript = new LuaScriptJob(editor, script, this);
+
+    connect(backgroundScript, &LuaScriptJob::output, this, [=](const QString &text) {
+        writeToOutput(text.toUtf8().constData());
+        writeToOutput("\r\n");
+    });
+    connect(backgroundScript, &LuaScriptJob::finished, this, [=](bool applied, const QString &error) {
+        Q_UNUSED(applied);
+
+        if (!error.isEmpty()) {
+            writeErrorToOutput(error.toUtf8().constData());
+            writeErrorToOutput("\r\n");
+        }
+
+        backgroundScript->deleteLater();
+    });
+
+    backgroundScript->start();
+}
+
+void LuaConsoleDock::cancelBackgroundScript()
+{
+    if (backgroundScript)
+        backgroundScript->cancel();
+}
+
 bool LuaConsoleDock::eventFilter(QObject *obj, QEvent *event)
 {
     if (event->type() == QEvent::KeyPress) {
@@ -307,6 +464,14 @@ bool LuaConsoleDock::eventFilter(QObject *obj, QEvent *event)
             runCurrentCommand();
             return true;
         }
+        else if (keyEvent->key() == Qt::Key_Return && keyEvent->modifiers() == Qt::ShiftModifier) {
+            runCurrentCommandInBackground();
+            return true;
+        }
+        else if (keyEvent->key() == Qt::Key_Escape && backgroundScript) {
+            cancelBackgroundScript();
+            return true;
+        }
     }
     else {
         // standard event processing
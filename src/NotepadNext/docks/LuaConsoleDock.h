@@ -20,9 +20,13 @@
 #ifndef LUACONSOLEDOCK_H
 #define LUACONSOLEDOCK_H
 
+#include <QByteArray>
 #include <QDockWidget>
+#include <QPointer>
 
+class QTimer;
 class ScintillaNext;
+class LuaScriptJob;
 class LuaState;
 
 namespace Ui {
@@ -37,6 +41,8 @@ public:
     explicit LuaConsoleDock(LuaState *l, QWidget *parent = 0);
     ~LuaConsoleDock();
 
+    // Text is collected and added to the output a piece at a time once per frame, so a script that prints a lot
+    // doesn't lay out and repaint the output for every line. Errors are shown straight away after anything before them.
     void writeToOutput(const char *s);
     void writeErrorToOutput(const char *s);
     LuaState *L = Q_NULLPTR;
@@ -44,6 +50,10 @@ public:
 public slots:
     void runCurrentCommand(void);
 
+    // Runs the input as a script on a worker against the current editor, see LuaScriptJob
+    void runCurrentCommandInBackground();
+    void cancelBackgroundScript();
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event);
 
@@ -53,7 +63,18 @@ private:
     ScintillaNext *output;
     ScintillaNext *input;
 
+    QPointer<LuaScriptJob> backgroundScript;
+
+    QTimer *flushTimer;
+    QByteArray pendingOutput;
+    bool pendingOutputDropped = false;
+
+    void flushOutput(int limit);
+    void flushAllOutput() { flushOutput(pendingOutput.size()); }
+    void appendToOutput(const char *s, int length);
+    void trimOutput();
 
+    void echoInput();
     void setupStyle(ScintillaNext *editor);
 };
 
@@ -0,0 +1,45 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MINIMAPDOCK_H
+#define MINIMAPDOCK_H
+
+#include <QDockWidget>
+
+
+class MainWindow;
+
+namespace Ui {
+class MinimapDock;
+}
+
+// Shows a MinimapView of the current editor
+class MinimapDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MinimapDock(MainWindow *parent);
+    ~MinimapDock();
+
+private:
+    Ui::MinimapDock *ui;
+};
+
+#endif // MINIMAPDOCK_H
@@ -0,0 +1,316 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "OutlineDock.h"
+#include "ui_OutlineDock.h"
+
+#include "BackgroundLexer.h"
+#include "MainWindow.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <functional>
+
+using namespace Scintilla;
+
+
+// Edits are collected for this long before the outline gets updated
+const int REBUILD_DELAY_MS = 300;
+
+// Smaller documents get styled up front so the whole outline is there straight away, bigger ones fill in as
+// the lexer gets through them
+const Sci_Position STYLE_ALL_LIMIT = 8 * 1024 * 1024;
+
+static QString pathKey(const QString &parentKey, const QString &text)
+{
+    return parentKey.isEmpty() ? text : parentKey + QChar('\n') + text;
+}
+
+OutlineDock::OutlineDock(MainWindow *parent) :
+    QDockWidget(parent),
+    ui(new Ui::OutlineDock),
+    window(parent),
+    model(new OutlineModel(this)),
+    rebuildTimer(new QTimer(this))
+{
+    qInfo(Q_FUNC_INFO);
+
+    ui->setupUi(this);
+    ui->treeOutline->setModel(model);
+    ui->lblStatus->hide();
+
+    rebuildTimer->setSingleShot(true);
+    rebuildTimer->setInterval(REBUILD_DELAY_MS);
+    connect(rebuildTimer, &QTimer::timeout, this, &OutlineDock::rebuild);
+
+    connect(ui->treeOutline, &QTreeView::activated, this, &OutlineDock::itemActivated);
+    connect(ui->treeOutline, &QTreeView::clicked, this, &OutlineDock::itemActivated);
+
+    connect(this, &QDockWidget::visibilityChanged, this, [=](bool visible) {
+        if (visible) {
+            connectToEditor(parent->currentEditor());
+            connect(parent, &MainWindow::editorActivated, this, &OutlineDock::connectToEditor);
+        }
+        else {
+            disconnectFromEditor();
+            disconnect(parent, &MainWindow::editorActivated, this, &OutlineDock::connectToEditor);
+        }
+    });
+}
+
+OutlineDock::~OutlineDock()
+{
+    delete ui;
+}
+
+void OutlineDock::connectToEditor(ScintillaNext *editor)
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (editor == this->editor) {
+        return;
+    }
+
+    disconnectFromEditor();
+
+    this->editor = editor;
+
+    if (editor == Q_NULLPTR) {
+        return;
+    }
+
+    connect(editor, &ScintillaNext::notify, this, &OutlineDock::editorNotify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &OutlineDock::invalidateAll);
+    connect(editor, &ScintillaNext::lexerChanged, this, &OutlineDock::invalidateAll);
+    editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ChangeFold);
+
+    invalidateAll();
+    rebuild();
+}
+
+void OutlineDock::disconnectFromEditor()
+{
+    if (editor) {
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+        editor->setModificationsNeeded(this, ModificationFlags::None);
+    }
+
+    editor = Q_NULLPTR;
+    ++generation;
+    rebuildTimer->stop();
+    model->setOutline(Q_NULLPTR);
+    ui->lblStatus->hide();
+}
+
+void OutlineDock::editorNotify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code != Notification::Modified) {
+        return;
+    }
+
+    if (FlagSet(pscn->modificationType, ModificationFlags::InsertText) || FlagSet(pscn->modificationType, ModificationFlags::DeleteText)) {
+        lineChanged(editor->lineFromPosition(pscn->position), static_cast<int>(pscn->linesAdded));
+    }
+    else if (FlagSet(pscn->modificationType, ModificationFlags::ChangeFold)) {
+        lineChanged(static_cast<int>(pscn->line), 0);
+    }
+}
+
+void OutlineDock::invalidateAll()
+{
+    rebuildAll = true;
+    changedFirst = changedLast = -1;
+    linesAdded = 0;
+
+    rebuildTimer->start();
+}
+
+void OutlineDock::lineChanged(int line, int added)
+{
+    if (!rebuildAll) {
+        if (changedFirst < 0) {
+            changedFirst = line;
+            changedLast = line + qMax(0, added);
+        }
+        else {
+            // Everything after the line moves, which includes the end of the changed lines if it is past it
+            if (changedLast > line) {
+                changedLast = qMax(line, changedLast + added);
+            }
+
+            changedFirst = qMin(changedFirst, line);
+            changedLast = qMax(changedLast, line + qMax(0, added));
+        }
+
+        linesAdded += added;
+    }
+
+    rebuildTimer->start();
+}
+
+void OutlineDock::rebuild()
+{
+    if (!editor) {
+        return;
+    }
+
+    // Only one outline is built at a time since each one starts from the last
+    if (building) {
+        rebuildTimer->start();
+        return;
+    }
+
+    if (!rebuildAll && changedFirst < 0) {
+        return;
+    }
+
+    // Fold levels are only known for what has been styled
+    const BackgroundLexer *backgroundLexer = editor->documentOwner()->findChild<BackgroundLexer *>();
+    const bool lexingInBackground = backgroundLexer && backgroundLexer->isActive();
+    if (!lexingInBackground && editor->endStyled() < editor->length() && editor->length() <= STYLE_ALL_LIMIT) {
+        editor->colourise(editor->endStyled(), -1);
+    }
+
+    Outline::Snapshot snapshot;
+
+    if (rebuildAll || !model->outline()) {
+        snapshot.firstLine = 0;
+        snapshot.lastLine = static_cast<int>(editor->lineCount()) - 1;
+    }
+    else {
+        snapshot.firstLine = qBound(0, changedFirst, static_cast<int>(editor->lineCount()) - 1);
+        snapshot.lastLine = qBound(snapshot.firstLine, changedLast, static_cast<int>(editor->lineCount()) - 1);
+        snapshot.linesAdded = linesAdded;
+        snapshot.previous = model->outline();
+    }
+
+    snapshot.levels = editor->foldLevels(snapshot.firstLine, snapshot.lastLine);
+
+    const Sci_Position start = editor->positionFromLine(snapshot.firstLine);
+    const Sci_Position end = editor->lineEndPosition(snapshot.lastLine);
+    snapshot.text = QByteArray(reinterpret_cast<const char *>(editor->rangePointer(start, end - start)), end - start);
+
+    rebuildAll = false;
+    changedFirst = changedLast = -1;
+    linesAdded = 0;
+
+    const int styledLine = static_cast<int>(editor->lineFromPosition(editor->endStyled()));
+    if (styledLine < editor->lineCount() - 1) {
+        ui->lblStatus->setText(tr("Outline up to line %L1, the rest is still being styled").arg(styledLine + 1));
+        ui->lblStatus->show();
+    }
+    else {
+        ui->lblStatus->hide();
+    }
+
+    building = true;
+
+    QPointer<OutlineDock> self(this);
+    const int buildGeneration = generation;
+
+    QThreadPool::globalInstance()->start([self, snapshot = std::move(snapshot), buildGeneration]() {
+        std::shared_ptr<const Outline> outline = Outline::build(snapshot);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, outline, buildGeneration]() {
+            if (self) {
+                self->outlineBuilt(outline, buildGeneration);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void OutlineDock::outlineBuilt(std::shared_ptr<const Outline> outline, int buildGeneration)
+{
+    building = false;
+
+    if (buildGeneration != generation) {
+        // It was for another editor, anything waiting for the current one can go now
+        if (editor) {
+            rebuildTimer->start();
+        }
+        return;
+    }
+
+    const QSet<QString> expanded = expandedPaths();
+    model->setOutline(outline);
+    restoreExpandedPaths(expanded);
+}
+
+void OutlineDock::itemActivated(const QModelIndex &index)
+{
+    const int line = model->lineAt(index);
+
+    if (!editor || line < 0 || line >= editor->lineCount()) {
+        return;
+    }
+
+    const Sci_PositionCR pos = static_cast<Sci_PositionCR>(editor->positionFromLine(line));
+    editor->goToRange({pos, pos});
+    editor->verticalCentreCaret();
+}
+
+QSet<QString> OutlineDock::expandedPaths() const
+{
+    QSet<QString> paths;
+
+    // Only the expanded branches are visited so this stays cheap however big the outline is
+    std::function<void(const QModelIndex &, const QString &)> visit = [&](const QModelIndex &parent, const QString &parentKey) {
+        const int rows = model->rowCount(parent);
+
+        for (int row = 0; row < rows; ++row) {
+            const QModelIndex index = model->index(row, 0, parent);
+
+            if (ui->treeOutline->isExpanded(index)) {
+                const QString key = pathKey(parentKey, index.data().toString());
+                paths.insert(key);
+                visit(index, key);
+            }
+        }
+    };
+
+    visit(QModelIndex(), QString());
+
+    return paths;
+}
+
+void OutlineDock::restoreExpandedPaths(const QSet<QString> &paths)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    std::function<void(const QModelIndex &, const QString &)> visit = [&](const QModelIndex &parent, const QString &parentKey) {
+        const int rows = model->rowCount(parent);
+
+        for (int row = 0; row < rows; ++row) {
+            const QModelIndex index = model->index(row, 0, parent);
+            const QString key = pathKey(parentKey, index.data().toString());
+
+            if (paths.contains(key)) {
+                ui->treeOutline->expand(index);
+                visit(index, key);
+            }
+        }
+    };
+
+    visit(QModelIndex(), QString());
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OUTLINEDOCK_H
+#define OUTLINEDOCK_H
+
+#include <QDockWidget>
+#include <QPointer>
+#include <QSet>
+
+#include <memory>
+
+#include "OutlineModel.h"
+
+
+class MainWindow;
+class QTimer;
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+namespace Ui {
+class OutlineDock;
+}
+
+// Shows the fold headers of the current editor as a tree to navigate with. The outline is built on a worker
+// thread from a copy of the fold levels and text, and after an edit only the lines that changed are copied.
+class OutlineDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit OutlineDock(MainWindow *parent);
+    ~OutlineDock();
+
+private slots:
+    void connectToEditor(ScintillaNext *editor);
+    void editorNotify(const Scintilla::NotificationData *pscn);
+    void rebuild();
+    void itemActivated(const QModelIndex &index);
+
+private:
+    void disconnectFromEditor();
+    void invalidateAll();
+    void lineChanged(int line, int linesAdded);
+    void outlineBuilt(std::shared_ptr<const Outline> outline, int buildGeneration);
+
+    QSet<QString> expandedPaths() const;
+    void restoreExpandedPaths(const QSet<QString> &paths);
+
+    Ui::OutlineDock *ui;
+    MainWindow *window;
+    OutlineModel *model;
+    QTimer *rebuildTimer;
+    QPointer<ScintillaNext> editor;
+
+    // The lines that changed since the last snapshot, in the editor's current line numbers, and how many lines
+    // everything after them moved. A first line of -1 means nothing changed.
+    int changedFirst = -1;
+    int changedLast = -1;
+    int linesAdded = 0;
+    bool rebuildAll = true;
+
+    // Results for an editor that is no longer shown are thrown away
+    int generation = 0;
+    bool building = false;
+};
+
+#endif // OUTLINEDOCK_H
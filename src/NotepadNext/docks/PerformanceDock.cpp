@@ -0,0 +1,284 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PerformanceDock.h"
+#include "ui_PerformanceDock.h"
+
+#include "EditorManager.h"
+#include "EditorMemoryUsage.h"
+#include "LatencyMonitor.h"
+#include "LuaState.h"
+#include "MemoryGovernor.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+
+#include "lua.hpp"
+
+#include <QLocale>
+#include <QTimer>
+
+
+// Undo actions kept for each editor when compacting
+static const int COMPACT_UNDO_ACTIONS = 1000;
+
+// The governor only remembers this many itself
+static const int MAX_SHEDDING_ITEMS = 100;
+
+
+static QString toMilliseconds(double microseconds)
+{
+    return QString::number(microseconds / 1000.0, 'f', 2);
+}
+
+static void setMemoryItem(QTreeWidgetItem *item, const QString &name, const EditorMemoryUsage &usage)
+{
+    const QLocale locale;
+
+    item->setText(0, name);
+    item->setText(1, locale.formattedDataSize(usage.text));
+    item->setText(2, locale.formattedDataSize(usage.styles));
+    item->setText(3, locale.formattedDataSize(usage.lineIndex));
+    item->setText(4, locale.toString(usage.undoActions));
+    item->setText(5, locale.formattedDataSize(usage.undo));
+    item->setText(6, locale.formattedDataSize(usage.changeHistory));
+    item->setText(7, locale.formattedDataSize(usage.caches));
+    item->setText(8, locale.toString(usage.indicatorRuns));
+    item->setText(9, locale.formattedDataSize(usage.lexer));
+    item->setText(10, locale.formattedDataSize(usage.total()));
+
+    for (int column = 1; column < 11; ++column) {
+        item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+    }
+}
+
+// Newest first
+static void addSheddingItem(QTreeWidget *tree, const MemoryGovernor::Report &report)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem();
+
+    item->setText(0, QLocale().toString(report.when.time(), QLocale::ShortFormat));
+    item->setText(1, MemoryGovernor::stepName(report.step));
+    item->setText(2, report.reason);
+    item->setText(3, report.resident < 0 ? QString() : QLocale().formattedDataSize(report.resident));
+    item->setText(4, report.detail);
+    item->setToolTip(2, report.reason);
+    item->setTextAlignment(3, Qt::AlignRight | Qt::AlignVCenter);
+
+    tree->insertTopLevelItem(0, item);
+
+    while (tree->topLevelItemCount() > MAX_SHEDDING_ITEMS) {
+        delete tree->takeTopLevelItem(tree->topLevelItemCount() - 1);
+    }
+}
+
+PerformanceDock::PerformanceDock(QWidget *parent) :
+    QDockWidget(parent),
+    ui(new Ui::PerformanceDock)
+{
+    ui->setupUi(this);
+
+    ui->treeLatency->sortByColumn(0, Qt::AscendingOrder);
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(500);
+    connect(refreshTimer, &QTimer::timeout, this, &PerformanceDock::updateLatency);
+
+    connect(ui->btnResetLatency, &QPushButton::clicked, this, [=]() {
+        LatencyMonitor::reset();
+        updateLatency();
+    });
+
+    // Measuring walks every editor's undo history and indicators, so only do it now and then while it is being looked at
+    memoryTimer = new QTimer(this);
+    memoryTimer->setInterval(2000);
+    connect(memoryTimer, &QTimer::timeout, this, &PerformanceDock::updateMemory);
+
+    connect(ui->tabWidget, &QTabWidget::currentChanged, this, [=]() {
+        if (isVisible() && ui->tabWidget->currentWidget() == ui->tabMemory) {
+            memoryTimer->start();
+            updateMemory();
+        }
+        else {
+            memoryTimer->stop();
+        }
+    });
+
+    connect(ui->btnCompact, &QPushButton::clicked, this, &PerformanceDock::compact);
+
+    MemoryGovernor *governor = qobject_cast<NotepadNextApplication *>(qApp)->getMemoryGovernor();
+
+    for (const MemoryGovernor::Report &report : governor->reports()) {
+        addSheddingItem(ui->treeShedding, report);
+    }
+
+    connect(governor, &MemoryGovernor::shed, this, [=](const MemoryGovernor::Report &report) {
+        addSheddingItem(ui->treeShedding, report);
+    });
+
+    connect(this, &QDockWidget::visibilityChanged, this, [=](bool visible) {
+        if (visible && !recording) {
+            LatencyMonitor::startRecording();
+            recording = true;
+            refreshTimer->start();
+            updateLatency();
+
+            if (ui->tabWidget->currentWidget() == ui->tabMemory) {
+                memoryTimer->start();
+                updateMemory();
+            }
+        }
+        else if (!visible && recording) {
+            LatencyMonitor::stopRecording();
+            recording = false;
+            refreshTimer->stop();
+            memoryTimer->stop();
+        }
+    });
+}
+
+PerformanceDock::~PerformanceDock()
+{
+    if (recording) {
+        LatencyMonitor::stopRecording();
+    }
+
+    delete ui;
+}
+
+void PerformanceDock::updateLatency()
+{
+    const QVector<LatencyMonitor::Phase> phases = LatencyMonitor::phases();
+
+    // Sorting is turned off while updating so the items don't move around underneath the loop
+    ui->treeLatency->setSortingEnabled(false);
+
+    while (ui->treeLatency->topLevelItemCount() > phases.size()) {
+        delete ui->treeLatency->takeTopLevelItem(ui->treeLatency->topLevelItemCount() - 1);
+    }
+
+    while (ui->treeLatency->topLevelItemCount() < phases.size()) {
+        new QTreeWidgetItem(ui->treeLatency);
+    }
+
+    for (int i = 0; i < phases.size(); ++i) {
+        const LatencyMonitor::Phase &phase = phases[i];
+        QTreeWidgetItem *item = ui->treeLatency->topLevelItem(i);
+
+        item->setText(0, QString::fromUtf8(phase.name));
+        item->setText(1, QString::number(phase.histogram.count()));
+        item->setText(2, toMilliseconds(phase.histogram.mean()));
+        item->setText(3, toMilliseconds(phase.histogram.percentile(50)));
+        item->setText(4, toMilliseconds(phase.histogram.percentile(90)));
+        item->setText(5, toMilliseconds(phase.histogram.percentile(99)));
+        item->setText(6, toMilliseconds(phase.histogram.maximum()));
+
+        for (int column = 1; column < 7; ++column) {
+            item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+        }
+    }
+
+    ui->treeLatency->setSortingEnabled(true);
+}
+
+void PerformanceDock::updateMemory()
+{
+    NotepadNextApplication *app = qobject_cast<NotepadNextApplication *>(qApp);
+
+    const QList<QPointer<ScintillaNext>> editors = app->getEditorManager()->getEditors();
+
+    // The first item is the total across every editor
+    while (ui->treeMemory->topLevelItemCount() > editors.size() + 1) {
+        delete ui->treeMemory->takeTopLevelItem(ui->treeMemory->topLevelItemCount() - 1);
+    }
+
+    while (ui->treeMemory->topLevelItemCount() < editors.size() + 1) {
+        new QTreeWidgetItem(ui->treeMemory);
+    }
+
+    EditorMemoryUsage total;
+    int row = 1;
+
+    for (ScintillaNext *editor : editors) {
+        if (!editor) {
+            continue;
+        }
+
+        const EditorMemoryUsage usage = EditorMemoryUsage::measure(editor);
+        total += usage;
+
+        QString name = editor->getName();
+        if (editor->isHibernated()) {
+            name += tr(" (hibernated)");
+        }
+
+        setMemoryItem(ui->treeMemory->topLevelItem(row++), name, usage);
+    }
+
+    while (ui->treeMemory->topLevelItemCount() > row) {
+        delete ui->treeMemory->takeTopLevelItem(ui->treeMemory->topLevelItemCount() - 1);
+    }
+
+    QTreeWidgetItem *totalItem = ui->treeMemory->topLevelItem(0);
+    setMemoryItem(totalItem, tr("All Editors"), total);
+
+    QFont font = totalItem->font(0);
+    font.setBold(true);
+    for (int column = 0; column < ui->treeMemory->columnCount(); ++column) {
+        totalItem->setFont(column, font);
+    }
+
+    ui->lblLuaHeap->setText(tr("Lua heap: %1").arg(QLocale().formattedDataSize(luaHeapSize(app->getLuaState()->L))));
+
+    const qint64 resident = MemoryGovernor::residentSize();
+    const qint64 softLimit = app->getMemoryGovernor()->softLimit();
+
+    if (resident < 0) {
+        ui->lblResident->clear();
+    }
+    else if (softLimit > 0) {
+        ui->lblResident->setText(tr("Resident: %1 of %2").arg(QLocale().formattedDataSize(resident), QLocale().formattedDataSize(softLimit)));
+    }
+    else {
+        ui->lblResident->setText(tr("Resident: %1").arg(QLocale().formattedDataSize(resident)));
+    }
+}
+
+void PerformanceDock::compact()
+{
+    NotepadNextApplication *app = qobject_cast<NotepadNextApplication *>(qApp);
+
+    // Scintilla has no way to give back the unused part of its buffers, but an editor that can hibernate gives
+    // back everything and reads the file again when it is next shown
+    for (ScintillaNext *editor : app->getEditorManager()->getEditors()) {
+        if (!editor) {
+            continue;
+        }
+
+        if (editor->canHibernate()) {
+            editor->hibernate();
+        }
+        else {
+            editor->trimUndoHistory(COMPACT_UNDO_ACTIONS);
+        }
+    }
+
+    lua_gc(app->getLuaState()->L, LUA_GCCOLLECT, 0);
+
+    updateMemory();
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PERFORMANCEDOCK_H
+#define PERFORMANCEDOCK_H
+
+#include <QDockWidget>
+
+
+class QTimer;
+
+namespace Ui {
+class PerformanceDock;
+}
+
+// Shows what the LatencyMonitor has recorded and roughly how much memory each editor is using. Recording only
+// happens while the dock is visible (or the application was started with --perf-log) so it costs nothing otherwise.
+class PerformanceDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerformanceDock(QWidget *parent = nullptr);
+    ~PerformanceDock();
+
+private slots:
+    void updateLatency();
+    void updateMemory();
+    void compact();
+
+private:
+    Ui::PerformanceDock *ui;
+    QTimer *refreshTimer;
+    QTimer *memoryTimer;
+    bool recording = false;
+};
+
+#endif // PERFORMANCEDOCK_H
@@ -18,54 +18,74 @@
 
 
 #include "SearchResultsDock.h"
+#include "SearchResultsModel.h"
+#include "FileDialogHelpers.h"
+#include "LazyMimeData.h"
 #include "ScintillaNext.h"
 #include "ui_SearchResultsDock.h"
 
 #include <QKeyEvent>
-#include <QPointer>
 #include <QMenu>
+#include <QMessageBox>
+#include <QSaveFile>
 #include <QShortcut>
 #include <QClipboard>
 
-enum SearchResultData
-{
-    LineNumber = Qt::UserRole,
-    LinePosStart,
-    LinePosEnd
-};
 
 SearchResultsDock::SearchResultsDock(QWidget *parent) :
     QDockWidget(parent),
-    ui(new Ui::SearchResultsDock)
+    ui(new Ui::SearchResultsDock),
+    model(new SearchResultsModel(this))
 {
     ui->setupUi(this);
 
+    ui->treeView->setModel(model);
+
 #ifdef Q_OS_MACOS
     // Set a slightly larger font on MacOS
     QFont font("Courier New", 14);
-    ui->treeWidget->setFont(font);
+    ui->treeView->setFont(font);
 #endif
 
     // Close the results when escape is pressed
     new QShortcut(QKeySequence::Cancel, this, this, &SearchResultsDock::close, Qt::WidgetWithChildrenShortcut);
 
-    connect(ui->treeWidget, &QTreeWidget::itemActivated, this, &SearchResultsDock::itemActivated);
-    connect(ui->treeWidget, &QTreeWidget::itemExpanded, this, &SearchResultsDock::itemExpanded);
+    connect(ui->treeView, &QTreeView::activated, this, &SearchResultsDock::itemActivated);
+    connect(ui->treeView, &QTreeView::expanded, this, [=]() { ui->treeView->resizeColumnToContents(1); });
+    connect(model, &SearchResultsModel::rowsInserted, this, &SearchResultsDock::rowsInserted);
     connect(ui->btnCopyResults, &QPushButton::released,this, &SearchResultsDock::copySearchResultsToClipboard);
 
-    connect(ui->treeWidget, &QTreeWidget::customContextMenuRequested, this, [=](const QPoint &pos) {
-        QTreeWidgetItem *item = ui->treeWidget->itemAt(pos);
-
-        if (item == Q_NULLPTR) {
+    QMenu *exportMenu = new QMenu(this);
+    exportMenu->addAction(tr("Export to New Tab"), this, &SearchResultsDock::exportToNewTabRequested);
+    exportMenu->addAction(tr("Export to File..."), this, &SearchResultsDock::exportResultsToFile);
+    ui->btnExportResults->setMenu(exportMenu);
+
+    // Whatever was copied has to be rendered before the results it reads from change
+    auto renderCopiedResults = [=]() {
+        if (copiedResults)
+            copiedResults->renderAll();
+    };
+    connect(model, &SearchResultsModel::rowsAboutToBeInserted, this, renderCopiedResults);
+    connect(model, &SearchResultsModel::rowsAboutToBeRemoved, this, renderCopiedResults);
+    connect(model, &SearchResultsModel::modelAboutToBeReset, this, renderCopiedResults);
+    connect(model, &SearchResultsModel::dataChanged, this, renderCopiedResults);
+
+    connect(ui->treeView, &QTreeView::customContextMenuRequested, this, [=](const QPoint &pos) {
+        const QModelIndex index = ui->treeView->indexAt(pos);
+
+        if (!index.isValid()) {
             return;
         }
 
+        // The index can be invalidated by the time the action is triggered
+        const QPersistentModelIndex persistentIndex = index.sibling(index.row(), 0);
+
         // Create the menu and show it
         QMenu menu(this);
         menu.addAction(tr("Collapse All"), this, &SearchResultsDock::collapseAll);
         menu.addAction(tr("Expand All"), this, &SearchResultsDock::expandAll);
         menu.addSeparator();
-        menu.addAction(tr("Delete Entry"), this, [=]() { deleteEntry(item); });
+        menu.addAction(tr("Delete Entry"), this, [=]() { deleteEntry(persistentIndex); });
         menu.addSeparator();
         menu.addAction(tr("Delete All"), this, &SearchResultsDock::deleteAll);
 
@@ -75,6 +95,9 @@ SearchResultsDock::SearchResultsDock(QWidget *parent) :
 
 SearchResultsDock::~SearchResultsDock()
 {
+    if (copiedResults)
+        copiedResults->renderAll();
+
     delete ui;
 }
 
@@ -82,148 +105,132 @@ void SearchResultsDock::newSearch(const QString searchTerm)
 {
     show();
 
-    this->searchTerm = searchTerm;
-
-    for (int i = 0; i < ui->treeWidget->topLevelItemCount(); ++i)
-    {
-        const QTreeWidgetItem* topLevelItem = ui->treeWidget->topLevelItem(i);
-        ui->treeWidget->collapseItem(topLevelItem);
+    for (int i = 0; i < model->rowCount(); ++i) {
+        ui->treeView->collapse(model->index(i, 0));
     }
 
-    currentSearch = new QTreeWidgetItem(ui->treeWidget);
-    currentSearch->setBackground(0, QColor(232, 232, 255));
-    currentSearch->setForeground(0, QColor(0, 0, 170));
-    currentSearch->setExpanded(true);
-    currentSearch->setFirstColumnSpanned(true);
-
-    updateSearchStatus();
+    model->newSearch(searchTerm);
 }
 
 void SearchResultsDock::newFileEntry(ScintillaNext *editor)
 {
-    // Store a QPointer since there is no guarantee this editor will be around later
-    QPointer<ScintillaNext> editor_pointer = editor;
-
-    totalFileHitCount = 0;
-    currentFilePath = editor->isFile() ? editor->getFilePath() : editor->getName();
-
-    currentFile = new QTreeWidgetItem(currentSearch);
-    currentFile->setData(0, Qt::UserRole, QVariant::fromValue(editor_pointer));
-
-    currentFile->setBackground(0, QColor(213, 255, 213));
-    currentFile->setForeground(0, QColor(0, 128, 0));
-    currentFile->setExpanded(true);
-    currentFile->setFirstColumnSpanned(true);
+    model->newFileEntry(editor, editor->isFile() ? editor->getFilePath() : editor->getName());
+}
 
-    currentFileCount++;
-    updateSearchStatus();
+void SearchResultsDock::newFileEntry(const QString &filePath)
+{
+    model->newFileEntry(Q_NULLPTR, filePath);
 }
 
 void SearchResultsDock::newResultsEntry(const QString line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount)
 {
-    QTreeWidgetItem *item = new QTreeWidgetItem(currentFile);
-
-    // Scintilla internally references line numbers starting at 0, however it needs displayed starting at 1
-    item->setText(0, QString::number(lineNumber + 1));
-    item->setData(0, SearchResultData::LineNumber, lineNumber);
-    item->setData(0, SearchResultData::LinePosStart, startPositionFromBeginning);
-    item->setData(0, SearchResultData::LinePosEnd, endPositionFromBeginning);
-    item->setBackground(0, QBrush(QColor(220, 220, 220)));
-    item->setTextAlignment(0, Qt::AlignRight);
-
-    item->setText(1, line);
-
-    totalFileHitCount += hitCount;
-    totalHitCount += hitCount;
-
-    updateSearchStatus();
+    model->newResultsEntry(line, lineNumber, startPositionFromBeginning, endPositionFromBeginning, hitCount);
 }
 
 void SearchResultsDock::completeSearch()
 {
-    currentSearch = Q_NULLPTR;
-    currentFile = Q_NULLPTR;
-    currentFileCount = 0;
-    totalFileHitCount = 0;
-    totalHitCount = 0;
+    model->completeSearch();
 
-    ui->treeWidget->resizeColumnToContents(0);
-    ui->treeWidget->resizeColumnToContents(1);
+    ui->treeView->resizeColumnToContents(0);
+    ui->treeView->resizeColumnToContents(1);
 }
 
 void SearchResultsDock::collapseAll() const
 {
-    ui->treeWidget->collapseAll();
+    ui->treeView->collapseAll();
 }
 
 void SearchResultsDock::expandAll() const
 {
-    ui->treeWidget->expandAll();
+    ui->treeView->expandAll();
 }
 
-void SearchResultsDock::deleteEntry(QTreeWidgetItem *item)
+void SearchResultsDock::deleteEntry(const QModelIndex &index)
 {
-    QTreeWidgetItem *parent = item->parent();
-
-    if (parent != Q_NULLPTR) {
-        parent->removeChild(item);
-        delete item;
-    }
-    else {
-        const int index = ui->treeWidget->indexOfTopLevelItem(item);
-        delete ui->treeWidget->takeTopLevelItem(index);
-    }
+    model->removeEntry(index);
 }
 
 void SearchResultsDock::deleteAll()
 {
-    ui->treeWidget->clear();
+    model->clear();
 }
 
-void SearchResultsDock::itemActivated(QTreeWidgetItem *item, int column)
+void SearchResultsDock::itemActivated(const QModelIndex &index)
 {
-    Q_UNUSED(column);
+    // Only the results themselves go anywhere
+    if (model->itemType(index) != SearchResultsModel::ItemType::Result)
+        return;
 
-    // Result entries have no children
-    // Make sure the entry has a parent since search entries can have no children
-    if (item->childCount() == 0 && item->parent() != Q_NULLPTR) {
-        QPointer<ScintillaNext> editor = item->parent()->data(0, Qt::UserRole).value<QPointer<ScintillaNext>>();
+    const SearchResultsModel::ResultLocation location = model->resultLocation(index);
 
-        // The editor may no longer exist
-        if (editor) {
-            int lineNumber = item->data(0, SearchResultData::LineNumber).toInt();
-            int startPositionFromBeginning = item->data(0, SearchResultData::LinePosStart).toInt();
-            int endPositionFromBeginning = item->data(0, SearchResultData::LinePosEnd).toInt();
+    // The editor may no longer exist
+    if (location.editor) {
+        emit searchResultActivated(location.editor, location.lineNumber, location.startPositionFromBeginning, location.endPositionFromBeginning);
+    }
+    else if (!location.filePath.isEmpty()) {
+        emit fileSearchResultActivated(location.filePath, location.lineNumber, location.startPositionFromBeginning, location.endPositionFromBeginning);
+    }
+}
 
-            emit searchResultActivated(editor, lineNumber, startPositionFromBeginning, endPositionFromBeginning);
-        }
+void SearchResultsDock::rowsInserted(const QModelIndex &parent, int first, int last)
+{
+    // Searches and files span both columns and start out expanded, results don't need anything
+    if (parent.isValid() && model->itemType(parent) != SearchResultsModel::ItemType::Search)
+        return;
+
+    for (int row = first; row <= last; ++row) {
+        ui->treeView->setFirstColumnSpanned(row, parent, true);
+        ui->treeView->expand(model->index(row, 0, parent));
     }
 }
 
-void SearchResultsDock::itemExpanded(QTreeWidgetItem *)
+void SearchResultsDock::writeResults(ScintillaNext *editor) const
 {
-    ui->treeWidget->resizeColumnToContents(1);
+    // There is no need to be able to undo it a chunk at a time
+    editor->setUndoCollection(false);
+    model->writeText([=](const QByteArray &chunk) {
+        editor->appendText(chunk.size(), chunk.constData());
+    });
+    editor->setUndoCollection(true);
+    editor->emptyUndoBuffer();
 }
 
-void SearchResultsDock::updateSearchStatus()
+void SearchResultsDock::exportResultsToFile()
 {
-    currentSearch->setText(0, QStringLiteral("Search \"%1\" (%L2 hits in %L3 files)").arg(searchTerm).arg(totalHitCount).arg(currentFileCount));
+    const QString fileName = FileDialogHelpers::getSaveFileName(this, tr("Export Results"), QString(), tr("Text files (*.txt);;All files (*)"));
+
+    if (fileName.isEmpty())
+        return;
 
-    if (currentFile)
-        currentFile->setText(0, QStringLiteral("%1 (%L2 hits)").arg(currentFilePath).arg(totalFileHitCount));
+    QSaveFile file(fileName);
+    bool ok = file.open(QIODevice::WriteOnly);
+
+    if (ok) {
+        model->writeText([&](const QByteArray &chunk) {
+            ok = ok && file.write(chunk) == chunk.size();
+        });
+    }
+
+    if (!(ok && file.commit())) {
+        qWarning("Failed to export search results to %s: %s", qUtf8Printable(fileName), qUtf8Printable(file.errorString()));
+        QMessageBox::warning(this, tr("Error Saving File"), tr("An error occurred when saving <b>%1</b><br><br>Error: %2").arg(fileName, file.errorString()));
+    }
 }
 
 void SearchResultsDock::copySearchResultsToClipboard()
 {
-    QStringList results;
-    QTreeWidgetItemIterator it(ui->treeWidget);
+    // Nothing is made until something goes to paste it, by then there could be a lot of results to turn into text
+    LazyMimeData *mimeData = new LazyMimeData();
+    mimeData->addFormat(QStringLiteral("text/plain"), [model = QPointer<SearchResultsModel>(model)]() {
+        QByteArray text;
 
-    while (*it) {
-        const QTreeWidgetItem *item = *it;
-        results.append(QStringLiteral("%1 %2").arg(item->text(0)).arg(item->text(1)));
-        ++it;
-    }
+        if (model) {
+            model->writeText([&](const QByteArray &chunk) { text.append(chunk); });
+        }
 
-    QGuiApplication::clipboard()->setText(results.join('\n'));
-}
+        return text;
+    });
 
+    copiedResults = mimeData;
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+}
@@ -21,6 +21,7 @@
 #define SEARCHRESULTSDOCK_H
 
 #include <QDockWidget>
+#include <QPointer>
 
 #include "ISearchResultsHandler.h"
 
@@ -28,8 +29,10 @@ namespace Ui {
 class SearchResultsDock;
 }
 
-class QTreeWidgetItem;
+class LazyMimeData;
+class QModelIndex;
 class ScintillaNext;
+class SearchResultsModel;
 
 class SearchResultsDock : public QDockWidget, public ISearchResultsHandler
 {
@@ -41,37 +44,34 @@ public:
 
     void newSearch(const QString searchTerm) override;
     void newFileEntry(ScintillaNext *editor) override;
+    void newFileEntry(const QString &filePath) override;
     void newResultsEntry(const QString line, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning, int hitCount=1) override;
     void completeSearch() override;
 
 public slots:
     void collapseAll() const;
     void expandAll() const;
-    void deleteEntry(QTreeWidgetItem *item);
+    void deleteEntry(const QModelIndex &index);
     void deleteAll();
 
+    void writeResults(ScintillaNext *editor) const;
+    void exportResultsToFile();
+
 private slots:
-    void itemActivated(QTreeWidgetItem *item, int column);
-    void itemExpanded(QTreeWidgetItem *item);
-    void copySearchResultsToClipboard() ;
+    void itemActivated(const QModelIndex &index);
+    void rowsInserted(const QModelIndex &parent, int first, int last);
+    void copySearchResultsToClipboard();
 
 
 signals:
     void searchResultActivated(ScintillaNext *editor, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning);
+    void fileSearchResultActivated(const QString &filePath, int lineNumber, int startPositionFromBeginning, int endPositionFromBeginning);
+    void exportToNewTabRequested();
 
 private:
-    void updateSearchStatus();
     Ui::SearchResultsDock *ui;
-
-    QString searchTerm;
-    QString currentFilePath;
-
-    int currentFileCount = 0;
-    int totalFileHitCount = 0;
-    int totalHitCount = 0;
-
-    QTreeWidgetItem *currentSearch = Q_NULLPTR;
-    QTreeWidgetItem *currentFile = Q_NULLPTR;
+    SearchResultsModel *model;
+    QPointer<LazyMimeData> copiedResults;
 };
 
 #endif // SEARCHRESULTSDOCK_H
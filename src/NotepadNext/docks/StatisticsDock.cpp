@@ -0,0 +1,511 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "StatisticsDock.h"
+#include "ui_StatisticsDock.h"
+
+#include "JobScheduler.h"
+#include "MainWindow.h"
+#include "ScintillaNext.h"
+
+#include <QCoreApplication>
+#include <QHeaderView>
+#include <QTimer>
+
+#include <algorithm>
+
+using namespace Scintilla;
+
+
+// Edits are collected for this long before anything gets counted again
+const int RECOUNT_DELAY_MS = 300;
+
+// Big enough that a huge document is still only a few thousand blocks, small enough that recounting one after a
+// keystroke is next to nothing
+const qsizetype BLOCK_SIZE = 256 * 1024;
+
+// The most frequent characters that are listed
+const int CHARACTERS_SHOWN = 100;
+
+static QString characterName(uint codePoint)
+{
+    switch (codePoint) {
+    case '\t':
+        return StatisticsDock::tr("Tab");
+    case '\n':
+        return StatisticsDock::tr("Line Feed");
+    case '\r':
+        return StatisticsDock::tr("Carriage Return");
+    case ' ':
+        return StatisticsDock::tr("Space");
+    }
+
+    if (codePoint < 0x20 || codePoint == 0x7F) {
+        return QStringLiteral("U+%1").arg(codePoint, 4, 16, QChar('0')).toUpper();
+    }
+
+    QString text;
+    if (QChar::requiresSurrogates(codePoint)) {
+        text.append(QChar(QChar::highSurrogate(codePoint)));
+        text.append(QChar(QChar::lowSurrogate(codePoint)));
+    }
+    else {
+        text.append(QChar(static_cast<ushort>(codePoint)));
+    }
+
+    return QStringLiteral("%1  U+%2").arg(text, QString::number(codePoint, 16).rightJustified(4, QChar('0')).toUpper());
+}
+
+static QString bucketName(int bucket)
+{
+    if (bucket == 0) {
+        return StatisticsDock::tr("Empty");
+    }
+    if (bucket == 1) {
+        return StatisticsDock::tr("1");
+    }
+
+    const qint64 low = Q_INT64_C(1) << (bucket - 1);
+    if (bucket == BlockStatistics::LENGTH_BUCKETS - 1) {
+        return StatisticsDock::tr("%L1 or more").arg(low);
+    }
+
+    return StatisticsDock::tr("%L1 - %L2").arg(low).arg(low * 2 - 1);
+}
+
+static void setChildren(QTreeWidgetItem *parent, const QList<QPair<QString, QString>> &rows, const QList<QVariant> &lines = QList<QVariant>())
+{
+    // Items are reused so the tree keeps its scroll position and selection while the counts change
+    while (parent->childCount() > rows.size()) {
+        delete parent->takeChild(parent->childCount() - 1);
+    }
+
+    for (int i = 0; i < rows.size(); ++i) {
+        QTreeWidgetItem *item = i < parent->childCount() ? parent->child(i) : new QTreeWidgetItem(parent);
+
+        item->setText(0, rows[i].first);
+        item->setText(1, rows[i].second);
+        item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+        item->setData(0, Qt::UserRole, i < lines.size() ? lines[i] : QVariant());
+    }
+}
+
+StatisticsDock::StatisticsDock(MainWindow *parent) :
+    QDockWidget(parent),
+    ui(new Ui::StatisticsDock),
+    window(parent),
+    recountTimer(new QTimer(this))
+{
+    qInfo(Q_FUNC_INFO);
+
+    ui->setupUi(this);
+    ui->treeStatistics->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    ui->treeStatistics->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    ui->lblStatus->hide();
+
+    summaryItem = new QTreeWidgetItem(ui->treeStatistics, {tr("Summary")});
+    longestLinesItem = new QTreeWidgetItem(ui->treeStatistics, {tr("Longest Lines")});
+    lineLengthsItem = new QTreeWidgetItem(ui->treeStatistics, {tr("Line Lengths")});
+    charactersItem = new QTreeWidgetItem(ui->treeStatistics, {tr("Characters")});
+    summaryItem->setExpanded(true);
+
+    recountTimer->setSingleShot(true);
+    recountTimer->setInterval(RECOUNT_DELAY_MS);
+    connect(recountTimer, &QTimer::timeout, this, &StatisticsDock::recount);
+
+    connect(ui->treeStatistics, &QTreeWidget::itemActivated, this, &StatisticsDock::itemActivated);
+    connect(ui->treeStatistics, &QTreeWidget::itemClicked, this, &StatisticsDock::itemActivated);
+
+    connect(this, &QDockWidget::visibilityChanged, this, [=](bool visible) {
+        if (visible) {
+            connectToEditor(parent->currentEditor());
+            connect(parent, &MainWindow::editorActivated, this, &StatisticsDock::connectToEditor);
+        }
+        else {
+            disconnectFromEditor();
+            disconnect(parent, &MainWindow::editorActivated, this, &StatisticsDock::connectToEditor);
+        }
+    });
+}
+
+StatisticsDock::~StatisticsDock()
+{
+    delete ui;
+}
+
+void StatisticsDock::connectToEditor(ScintillaNext *editor)
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (editor == this->editor) {
+        return;
+    }
+
+    disconnectFromEditor();
+
+    this->editor = editor;
+
+    if (editor == Q_NULLPTR) {
+        return;
+    }
+
+    connect(editor, &ScintillaNext::notify, this, &StatisticsDock::editorNotify);
+    connect(editor, &ScintillaNext::modificationsResumed, this, &StatisticsDock::invalidateAll);
+    editor->setModificationsNeeded(this, ModificationFlags::InsertText | ModificationFlags::DeleteText);
+
+    invalidateAll();
+    recount();
+}
+
+void StatisticsDock::disconnectFromEditor()
+{
+    if (editor) {
+        disconnect(editor, Q_NULLPTR, this, Q_NULLPTR);
+        editor->setModificationsNeeded(this, ModificationFlags::None);
+    }
+
+    editor = Q_NULLPTR;
+    ++generation;
+    recountTimer->stop();
+
+    blocks.clear();
+    retired.clear();
+    totals.reset();
+    summary = DocumentStatistics::Summary();
+
+    for (QTreeWidgetItem *item : {summaryItem, longestLinesItem, lineLengthsItem, charactersItem}) {
+        setChildren(item, {});
+    }
+    ui->lblStatus->hide();
+}
+
+void StatisticsDock::editorNotify(const NotificationData *pscn)
+{
+    if (pscn->nmhdr.code != Notification::Modified || blocks.empty()) {
+        return;
+    }
+
+    if (FlagSet(pscn->modificationType, ModificationFlags::InsertText)) {
+        textInserted(pscn->position, pscn->length);
+    }
+    else if (FlagSet(pscn->modificationType, ModificationFlags::DeleteText)) {
+        textDeleted(pscn->position, pscn->length);
+    }
+}
+
+void StatisticsDock::invalidateAll()
+{
+    // Starting over is simpler than working out what happened while modifications were suspended
+    ++generation;
+
+    blocks.clear();
+    blocks.push_back({nextBlockId++, editor ? static_cast<qint64>(editor->length()) : 0, Q_NULLPTR, false});
+    retired.clear();
+    totals = std::make_shared<DocumentStatistics>();
+
+    recountTimer->start();
+}
+
+int StatisticsDock::blockAt(qint64 position, qint64 &blockStart) const
+{
+    blockStart = 0;
+
+    for (int i = 0; i < static_cast<int>(blocks.size()) - 1; ++i) {
+        if (position < blockStart + blocks[i].length) {
+            return i;
+        }
+
+        blockStart += blocks[i].length;
+    }
+
+    return static_cast<int>(blocks.size()) - 1;
+}
+
+void StatisticsDock::changeBlock(Block &block)
+{
+    if (block.stats) {
+        retired.push_back(std::move(block.stats));
+        block.stats.reset();
+    }
+
+    // A count that is running for it is out of date now, this way it doesn't get mistaken for this block
+    if (block.counting) {
+        block.id = nextBlockId++;
+        block.counting = false;
+    }
+}
+
+void StatisticsDock::textInserted(qint64 position, qint64 length)
+{
+    // Blocks end after a line end, and anything inserted at the start of a block belongs to the line that starts it
+    qint64 blockStart;
+    Block &block = blocks[blockAt(position, blockStart)];
+
+    block.length += length;
+    changeBlock(block);
+
+    recountTimer->start();
+}
+
+void StatisticsDock::textDeleted(qint64 position, qint64 length)
+{
+    // Deleting the line end of a block joins its last line with the first one of the next block, so everything from
+    // the block the deletion starts in up to the one it ends in becomes one block
+    qint64 firstStart;
+    qint64 lastStart;
+    const int first = blockAt(position, firstStart);
+    const int last = blockAt(position + length, lastStart);
+
+    Block merged{nextBlockId++, lastStart + blocks[last].length - firstStart - length, Q_NULLPTR, false};
+
+    for (int i = first; i <= last; ++i) {
+        changeBlock(blocks[i]);
+    }
+
+    blocks.erase(blocks.begin() + first, blocks.begin() + last + 1);
+    blocks.insert(blocks.begin() + first, merged);
+
+    recountTimer->start();
+}
+
+void StatisticsDock::recount()
+{
+    if (!editor) {
+        return;
+    }
+
+    // Only one count runs at a time since they all update the same totals
+    if (counting) {
+        recountTimer->start();
+        return;
+    }
+
+    struct Work {
+        quint64 id;
+        QByteArray text; // or empty if it is taken from the snapshot
+        qsizetype offset;
+        qsizetype length;
+        bool endOfDocument;
+    };
+
+    std::vector<Work> work;
+    qint64 blockStart = 0;
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        Block &block = blocks[i];
+
+        if (!block.stats && !block.counting) {
+            work.push_back({block.id, QByteArray(), static_cast<qsizetype>(blockStart), static_cast<qsizetype>(block.length), i == blocks.size() - 1});
+            block.counting = true;
+        }
+
+        blockStart += block.length;
+    }
+
+    if (work.empty() && retired.empty()) {
+        return;
+    }
+
+    // When everything has to be counted the text is shared instead of copied, after that only what changed is copied
+    std::shared_ptr<const QByteArray> snapshot;
+    if (work.size() == blocks.size()) {
+        snapshot = editor->textSnapshot();
+    }
+    else {
+        for (Work &w : work) {
+            w.text = QByteArray(reinterpret_cast<const char *>(editor->rangePointer(w.offset, w.length)), w.length);
+        }
+    }
+
+    std::vector<std::shared_ptr<const BlockStatistics>> removed;
+    removed.swap(retired);
+
+    ui->lblStatus->setText(tr("Counting..."));
+    ui->lblStatus->show();
+
+    counting = true;
+
+    QPointer<StatisticsDock> self(this);
+    const int countGeneration = generation;
+    std::shared_ptr<DocumentStatistics> countTotals = totals;
+
+    JobScheduler::instance()->run(this, JobScheduler::Background, [self, work = std::move(work), snapshot, removed = std::move(removed), countTotals, countGeneration](const JobScheduler::CancelToken &canceled) {
+        for (const auto &stats : removed) {
+            countTotals->remove(*stats);
+        }
+
+        std::vector<Result> results;
+        results.reserve(work.size());
+
+        for (const Work &w : work) {
+            if (*canceled) {
+                return;
+            }
+
+            const char *data = snapshot ? snapshot->constData() + w.offset : w.text.constData();
+            Result result{w.id, BlockStatistics::count(data, w.length, w.endOfDocument, BLOCK_SIZE)};
+
+            for (const auto &stats : result.stats) {
+                countTotals->add(*stats);
+            }
+
+            results.push_back(std::move(result));
+        }
+
+        const DocumentStatistics::Summary summary = countTotals->summary();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [self, results = std::move(results), summary, countGeneration]() {
+            if (self) {
+                self->counted(results, summary, countGeneration);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void StatisticsDock::counted(const std::vector<Result> &results, const DocumentStatistics::Summary &summary, int countGeneration)
+{
+    counting = false;
+
+    if (countGeneration != generation) {
+        // It was for another editor or from before starting over, anything waiting for the current one can go now
+        if (editor) {
+            recountTimer->start();
+        }
+        return;
+    }
+
+    for (const Result &result : results) {
+        auto it = std::find_if(blocks.begin(), blocks.end(), [&](const Block &block) {
+            return block.id == result.id && block.counting;
+        });
+
+        if (it == blocks.end()) {
+            // The block changed while it was being counted, so it has to come back out of the totals
+            retired.insert(retired.end(), result.stats.begin(), result.stats.end());
+            continue;
+        }
+
+        // Big blocks come back split up so the next edit in them has less to count
+        std::vector<Block> counted;
+        for (const auto &stats : result.stats) {
+            counted.push_back({nextBlockId++, stats->bytes, stats, false});
+        }
+
+        it = blocks.erase(it);
+        blocks.insert(it, counted.begin(), counted.end());
+    }
+
+    this->summary = summary;
+
+    const bool pending = !retired.empty() || std::any_of(blocks.begin(), blocks.end(), [](const Block &block) {
+        return !block.stats;
+    });
+
+    showSummary();
+
+    if (pending) {
+        recountTimer->start();
+    }
+    else {
+        showLongestLines();
+        ui->lblStatus->hide();
+    }
+}
+
+void StatisticsDock::showSummary()
+{
+    setChildren(summaryItem, {
+        {tr("Bytes"), QStringLiteral("%L1").arg(summary.bytes)},
+        {tr("Characters"), QStringLiteral("%L1").arg(summary.characters)},
+        {tr("Words"), QStringLiteral("%L1").arg(summary.words)},
+        {tr("Lines"), QStringLiteral("%L1").arg(summary.lines)},
+        {tr("Distinct Lines"), QStringLiteral("%L1").arg(summary.distinctLines)},
+        {tr("Duplicate Lines"), QStringLiteral("%L1").arg(summary.lines - summary.distinctLines)},
+    });
+
+    QList<QPair<QString, QString>> lengths;
+    for (int bucket = 0; bucket < BlockStatistics::LENGTH_BUCKETS; ++bucket) {
+        if (summary.lineLengths[bucket] > 0) {
+            lengths.append({bucketName(bucket), QStringLiteral("%L1").arg(summary.lineLengths[bucket])});
+        }
+    }
+    setChildren(lineLengthsItem, lengths);
+
+    QVector<QPair<qint64, uint>> characters;
+    for (uint c = 0; c < 128; ++c) {
+        if (summary.asciiCounts[c] > 0) {
+            characters.append({summary.asciiCounts[c], c});
+        }
+    }
+    for (auto it = summary.otherCharacters.constBegin(); it != summary.otherCharacters.constEnd(); ++it) {
+        characters.append({it.value(), it.key()});
+    }
+
+    const int shown = qMin(CHARACTERS_SHOWN, characters.size());
+    std::partial_sort(characters.begin(), characters.begin() + shown, characters.end(), [](const QPair<qint64, uint> &a, const QPair<qint64, uint> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    QList<QPair<QString, QString>> rows;
+    for (int i = 0; i < shown; ++i) {
+        rows.append({characterName(characters[i].second), QStringLiteral("%L1").arg(characters[i].first)});
+    }
+    setChildren(charactersItem, rows);
+}
+
+void StatisticsDock::showLongestLines()
+{
+    // Each block knows its own longest lines, so the document's are among them
+    QVector<BlockStatistics::Line> longest;
+    qint64 firstLine = 0;
+
+    for (const Block &block : blocks) {
+        for (const BlockStatistics::Line &line : block.stats->longestLines) {
+            longest.append({line.length, firstLine + line.line});
+        }
+
+        firstLine += block.stats->lines;
+    }
+
+    const int shown = qMin(BlockStatistics::LONGEST_LINES, longest.size());
+    std::partial_sort(longest.begin(), longest.begin() + shown, longest.end(), [](const BlockStatistics::Line &a, const BlockStatistics::Line &b) {
+        return a.length > b.length || (a.length == b.length && a.line < b.line);
+    });
+
+    QList<QPair<QString, QString>> rows;
+    QList<QVariant> lines;
+    for (int i = 0; i < shown; ++i) {
+        rows.append({tr("Line %L1").arg(longest[i].line + 1), QStringLiteral("%L1").arg(longest[i].length)});
+        lines.append(longest[i].line);
+    }
+    setChildren(longestLinesItem, rows, lines);
+}
+
+void StatisticsDock::itemActivated(QTreeWidgetItem *item)
+{
+    const QVariant data = item->data(0, Qt::UserRole);
+
+    if (!editor || !data.isValid() || data.toLongLong() >= editor->lineCount()) {
+        return;
+    }
+
+    const Sci_PositionCR pos = static_cast<Sci_PositionCR>(editor->positionFromLine(data.toLongLong()));
+    editor->goToRange({pos, pos});
+    editor->verticalCentreCaret();
+}
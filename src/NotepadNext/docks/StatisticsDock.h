@@ -0,0 +1,113 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef STATISTICSDOCK_H
+#define STATISTICSDOCK_H
+
+#include <QDockWidget>
+#include <QPointer>
+
+#include <memory>
+#include <vector>
+
+#include "DocumentStatistics.h"
+
+
+class MainWindow;
+class QTimer;
+class QTreeWidgetItem;
+class ScintillaNext;
+
+namespace Scintilla {
+    struct NotificationData;
+}
+
+namespace Ui {
+class StatisticsDock;
+}
+
+// Shows word and character counts, line lengths and duplicate lines of the current editor. The document is split
+// into blocks of lines that are counted on a worker thread, and after an edit only the blocks it touched are copied
+// and counted again, so typing never waits on it however big the document is.
+class StatisticsDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsDock(MainWindow *parent);
+    ~StatisticsDock();
+
+private slots:
+    void connectToEditor(ScintillaNext *editor);
+    void editorNotify(const Scintilla::NotificationData *pscn);
+    void recount();
+    void itemActivated(QTreeWidgetItem *item);
+
+private:
+    struct Block
+    {
+        quint64 id;
+        qint64 length;
+        std::shared_ptr<const BlockStatistics> stats; // null until it has been counted since it last changed
+        bool counting;
+    };
+
+    struct Result
+    {
+        quint64 id;
+        std::vector<std::shared_ptr<const BlockStatistics>> stats;
+    };
+
+    void disconnectFromEditor();
+    void invalidateAll();
+    void textInserted(qint64 position, qint64 length);
+    void textDeleted(qint64 position, qint64 length);
+    void changeBlock(Block &block);
+    int blockAt(qint64 position, qint64 &blockStart) const;
+    void counted(const std::vector<Result> &results, const DocumentStatistics::Summary &summary, int countGeneration);
+
+    void showSummary();
+    void showLongestLines();
+
+    Ui::StatisticsDock *ui;
+    MainWindow *window;
+    QTimer *recountTimer;
+    QPointer<ScintillaNext> editor;
+
+    QTreeWidgetItem *summaryItem;
+    QTreeWidgetItem *longestLinesItem;
+    QTreeWidgetItem *lineLengthsItem;
+    QTreeWidgetItem *charactersItem;
+
+    std::vector<Block> blocks;
+    quint64 nextBlockId = 0;
+
+    // Blocks that were counted into the totals but have changed since, they are taken out by the next count
+    std::vector<std::shared_ptr<const BlockStatistics>> retired;
+
+    // Only ever used by the one count that is running, which is why it isn't locked
+    std::shared_ptr<DocumentStatistics> totals;
+    DocumentStatistics::Summary summary;
+
+    // Results for an editor that is no longer shown are thrown away
+    int generation = 0;
+    bool counting = false;
+};
+
+#endif // STATISTICSDOCK_H
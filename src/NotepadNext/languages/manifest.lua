@@ -0,0 +1,88 @@
+-- Generated by scripts/GenerateLanguageManifest.py, do not edit
+return {
+    ["ActionScript"] = {module = "actionscript", extensions = {"as", "mx"}},
+    ["ADA"] = {module = "ada", extensions = {"ada", "ads", "adb"}},
+    ["Assembly"] = {module = "asm", extensions = {"asm"}},
+    ["ASN.1"] = {module = "asn1", extensions = {"mib"}},
+    ["asp"] = {module = "asp", extensions = {"asp"}},
+    ["autoIt"] = {module = "autoit", extensions = {"au3"}},
+    ["AviSynth"] = {module = "avs", extensions = {"avs", "avsi"}},
+    ["BaanC"] = {module = "baanc", extensions = {"bc", "cln"}},
+    ["bash"] = {module = "bash", extensions = {"bash", "sh", "bsh", "csh", "bash_profile", "bashrc", "profile"}, first_line = {"^#!.*bash", "^#!.*zsh", "^#!.*csh", "^#!.*bsh", "^#!.*sh"}},
+    ["Batch"] = {module = "batch", extensions = {"bat", "cmd", "nt"}},
+    ["BlitzBasic"] = {module = "blitzbasic", extensions = {"bb"}},
+    ["C"] = {module = "c", extensions = {"c", "lex"}},
+    ["Caml"] = {module = "caml", extensions = {"ml", "mli", "sml", "thy"}},
+    ["CMakeFile"] = {module = "cmake", extensions = {"cmake"}},
+    ["COBOL"] = {module = "cobol", extensions = {"cbl", "cbd", "cdb", "cdc", "cob", "cpy", "copy", "lst"}},
+    ["Csound"] = {module = "csound", extensions = {"orc", "sco", "csd"}},
+    ["CoffeeScript"] = {module = "coffeescript", extensions = {"coffee", "litcoffee"}},
+    ["C++"] = {module = "cpp", extensions = {"cpp", "cxx", "cc", "h", "hh", "hpp", "hxx", "ino"}},
+    ["C#"] = {module = "cs", extensions = {"cs"}},
+    ["CSS"] = {module = "css", extensions = {"css"}},
+    ["SCSS"] = {module = "scss", extensions = {"scss"}},
+    ["D"] = {module = "d", extensions = {"d"}},
+    ["DIFF"] = {module = "diff", extensions = {"diff", "patch"}},
+    ["Erlang"] = {module = "erlang", extensions = {"erl", "hrl"}},
+    ["ESCRIPT"] = {module = "escript", extensions = {"src", "em"}},
+    ["Forth"] = {module = "forth", extensions = {"forth"}},
+    ["Fortran (free form)"] = {module = "fortran", extensions = {"f", "for", "f90", "f95", "f2k", "f23"}},
+    ["Fortran (fixed form)"] = {module = "fortran77", extensions = {"f77"}},
+    ["FreeBasic"] = {module = "freebasic", extensions = {"bas", "bi"}},
+    ["GUI4CLI"] = {module = "gui4cli"},
+    ["Go"] = {module = "go", extensions = {"go"}},
+    ["Haskell"] = {module = "haskell", extensions = {"hs", "lhs", "las"}},
+    ["HTML"] = {module = "html", extensions = {"html", "htm", "shtml", "shtm", "xhtml", "xht", "hta", "vue"}},
+    ["ini file"] = {module = "ini", extensions = {"ini", "inf", "url", "wer"}, first_line = {"^%[.+%][\r\n]"}},
+    ["InnoSetup"] = {module = "inno", extensions = {"iss"}},
+    ["Intel HEX"] = {module = "ihex", extensions = {"hex"}},
+    ["Java"] = {module = "java", extensions = {"java"}},
+    ["JavaScript"] = {module = "javascript", extensions = {"js", "mjs", "cjs", "jsm", "jsx", "ts", "tsx"}},
+    ["JSON"] = {module = "json", extensions = {"json"}, first_line = {"^{[\r\n]"}},
+    ["KiXtart"] = {module = "kix", extensions = {"kix"}},
+    ["LISP"] = {module = "lisp", extensions = {"lsp", "lisp"}},
+    ["LaTeX"] = {module = "latex", extensions = {"tex", "sty"}},
+    ["Lua"] = {module = "lua", extensions = {"lua"}},
+    ["Less"] = {module = "less", extensions = {"less"}},
+    ["Makefile"] = {module = "makefile", extensions = {"mak", "mk"}},
+    ["Markdown"] = {module = "markdown", extensions = {"md", "markdown"}},
+    ["Matlab"] = {module = "matlab", extensions = {"m"}},
+    ["MMIXAL"] = {module = "mmixal", extensions = {"mms"}},
+    ["Nimrod"] = {module = "nimrod", extensions = {"nim"}},
+    ["extended crontab"] = {module = "nncrontab", extensions = {"tab", "spf"}},
+    ["Dos Style"] = {module = "nfo", extensions = {"nfo"}},
+    ["NSIS"] = {module = "nsis", extensions = {"nsi", "nsh"}},
+    ["OScript"] = {module = "oscript", extensions = {"osx"}},
+    ["Objective-C"] = {module = "objc", extensions = {"mm"}},
+    ["Pascal"] = {module = "pascal", extensions = {"pas", "pp", "p", "inc", "lpr"}},
+    ["Perl"] = {module = "perl", extensions = {"pl", "pm", "plx"}, first_line = {"^#!.*perl"}},
+    ["PHP"] = {module = "php", extensions = {"php", "php3", "php4", "php5", "phps", "phpt", "phtml"}},
+    ["Postscript"] = {module = "postscript", extensions = {"ps"}},
+    ["PowerShell"] = {module = "powershell", extensions = {"ps1", "psm1"}},
+    ["Properties file"] = {module = "props", extensions = {"properties"}},
+    ["PureBasic"] = {module = "purebasic", extensions = {"pb"}},
+    ["Python"] = {module = "python", extensions = {"py", "pyw"}, first_line = {"^#!.*python"}},
+    ["R"] = {module = "r", extensions = {"r", "s", "splus"}},
+    ["REBOL"] = {module = "rebol", extensions = {"r2", "r3", "reb"}},
+    ["registry"] = {module = "registry", extensions = {"reg"}},
+    ["RC"] = {module = "rc", extensions = {"rc"}},
+    ["Ruby"] = {module = "ruby", extensions = {"rb", "rbw"}},
+    ["Rust"] = {module = "rust", extensions = {"rs"}},
+    ["Scheme"] = {module = "scheme", extensions = {"scm", "smd", "ss"}},
+    ["Smalltalk"] = {module = "smalltalk", extensions = {"st"}},
+    ["spice"] = {module = "spice", extensions = {"scp", "out"}},
+    ["SQL"] = {module = "sql", extensions = {"sql"}},
+    ["S-Record"] = {module = "srec", extensions = {"mot", "srec"}},
+    ["Swift"] = {module = "swift", extensions = {"swift"}},
+    ["TCL"] = {module = "tcl", extensions = {"tcl"}},
+    ["Tektronix extended HEX"] = {module = "tehex", extensions = {"tek"}},
+    ["TeX"] = {module = "tex", extensions = {"tex"}},
+    ["Text"] = {module = "text", extensions = {"", "txt"}},
+    ["VB / VBS"] = {module = "vb", extensions = {"vb", "vbs"}},
+    ["txt2tags"] = {module = "txt2tags", extensions = {"t2t"}},
+    ["Verilog"] = {module = "verilog", extensions = {"v", "sv", "vh", "svh"}},
+    ["VHDL"] = {module = "vhdl", extensions = {"vhd", "vhdl"}},
+    ["Visual Prolog"] = {module = "visualprolog", extensions = {"pro", "cl", "i", "pack", "ph"}},
+    ["XML"] = {module = "xml", extensions = {"xml", "xaml", "xsl", "xslt", "xsd", "xul", "kml", "svg", "mxml", "xsml", "wsdl", "xlf", "xliff", "xbl", "sxbl", "sitemap", "gml", "gpx", "plist", "vcproj", "vcxproj", "csproj", "csxproj", "vbproj", "dbproj"}, first_line = {"^<%?xml"}},
+    ["YAML"] = {module = "yaml", extensions = {"yml", "yaml"}},
+}
@@ -24,6 +24,7 @@
 #include <QDataStream>
 
 #include "NotepadNextApplication.h"
+#include "ApplicationSettings.h"
 
 int main(int argc, char *argv[])
 {
@@ -46,24 +47,39 @@ int main(int argc, char *argv[])
     // Default settings format
     QSettings::setDefaultFormat(QSettings::IniFormat);
 
+    // A batch run never shows anything, so it shouldn't need a display either. The platform has to be picked
+    // before the application is created, which is before the command line gets parsed.
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--batch") == 0 && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+    }
+
     NotepadNextApplication app(argc, argv);
 
-    // Log some debug info
-    qInfo("=============================");
-    qInfo("%s v%s%s", qUtf8Printable(QApplication::applicationDisplayName()), qUtf8Printable(QApplication::applicationVersion()), APP_DISTRIBUTION);
-    qInfo("Build Date/Time: %s %s", __DATE__, __TIME__);
-    qInfo("Qt: %s", qVersion());
-    qInfo("OS: %s", qUtf8Printable(QSysInfo::prettyProductName()));
-    qInfo("Locale: %s", qUtf8Printable(QLocale::system().name()));
-    qInfo("CPU: %s", qUtf8Printable(QSysInfo::currentCpuArchitecture()));
-    qInfo("File Path: %s", qUtf8Printable(QApplication::applicationFilePath()));
-    qInfo("Arguments: %s", qUtf8Printable(app.arguments().join(' ')));
-    qInfo("=============================");
-
-    if(app.isPrimary()) {
+    // A second instance only hands its files to the first one, so it skips everything else. A batch run does
+    // its own work whether or not another instance is running.
+    if(app.isPrimary() || app.isBatchMode()) {
+        // Log some debug info
+        qInfo("=============================");
+        qInfo("%s v%s%s", qUtf8Printable(QApplication::applicationDisplayName()), qUtf8Printable(QApplication::applicationVersion()), APP_DISTRIBUTION);
+        qInfo("Build Date/Time: %s %s", __DATE__, __TIME__);
+        qInfo("Qt: %s", qVersion());
+        qInfo("OS: %s", qUtf8Printable(QSysInfo::prettyProductName()));
+        qInfo("Locale: %s", qUtf8Printable(QLocale::system().name()));
+        qInfo("CPU: %s", qUtf8Printable(QSysInfo::currentCpuArchitecture()));
+        qInfo("File Path: %s", qUtf8Printable(QApplication::applicationFilePath()));
+        qInfo("Arguments: %s", qUtf8Printable(app.arguments().join(' ')));
+        qInfo("=============================");
+
         app.init();
 
-        return app.exec();
+        const int result = app.exec();
+
+        // Anything changed in the last moments still has to be written
+        ApplicationSettings::flush();
+
+        return result;
     }
     else {
         qInfo() << "Primary instance already running. PID:" << app.primaryPid();
@@ -6,10 +6,13 @@ function starts_with(str, start)
    return str:sub(1, #start) == start
 end
 
+-- Only what is needed to pick a language, the full definitions are loaded the first time they are used
+language_manifest = require("manifest")
+
 function detectLanguageFromContents(contents)
-    for name, L in pairs(languages) do
-        if L.first_line then
-            for _, pattern in ipairs(L.first_line) do
+    for name, M in pairs(language_manifest) do
+        if M.first_line then
+            for _, pattern in ipairs(M.first_line) do
                 if string.match(contents, pattern) then
                     return name
                 end
@@ -19,15 +22,28 @@ function detectLanguageFromContents(contents)
     return "Text"
 end
 
+function detectLanguageFromExtension(ext)
+    for name, M in pairs(language_manifest) do
+        if M.extensions then
+            for _, v in ipairs(M.extensions) do
+                if v == ext then
+                    return name
+                end
+            end
+        end
+    end
+    return "Text"
+end
+
 function FilterForLanguage(name)
     local extensions = {}
-    local language_definition = languages[name]
+    local manifest_entry = language_manifest[name]
 
-    if not language_definition.extensions then
+    if not manifest_entry or not manifest_entry.extensions then
         return nil
     end
 
-    for _, ext in ipairs(language_definition.extensions) do
+    for _, ext in ipairs(manifest_entry.extensions) do
         if #ext > 0 then
             extensions[#extensions + 1] = "*." .. ext
         end
@@ -39,7 +55,7 @@ end
 function DialogFilters()
     local filters = {}
 
-    for name, L in pairs(languages) do
+    for name, M in pairs(language_manifest) do
         local filter = FilterForLanguage(name)
         if filter then
             filters[#filters + 1] = filter
@@ -52,89 +68,24 @@ function DialogFilters()
     return table.concat(filters, ";;")
 end
 
-languages = {}
-languages["ActionScript"] = require("actionscript")
-languages["ADA"] = require("ada")
-languages["Assembly"] = require("asm")
-languages["ASN.1"] = require("asn1")
-languages["asp"] = require("asp")
-languages["autoIt"] = require("autoit")
-languages["AviSynth"] = require("avs")
-languages["BaanC"] = require("baanc")
-languages["bash"] = require("bash")
-languages["Batch"] = require("batch")
-languages["BlitzBasic"] = require("blitzbasic")
-languages["C"] = require("c")
-languages["Caml"] = require("caml")
-languages["CMakeFile"] = require("cmake")
-languages["COBOL"] = require("cobol")
-languages["Csound"] = require("csound")
-languages["CoffeeScript"] = require("coffeescript")
-languages["C++"] = require("cpp")
-languages["C#"] = require("cs")
-languages["CSS"] = require("css")
-languages["SCSS"] = require("scss")
-languages["D"] = require("d")
-languages["DIFF"] = require("diff")
-languages["Erlang"] = require("erlang")
-languages["ESCRIPT"] = require("escript")
-languages["Forth"] = require("forth")
-languages["Fortran (free form)"] = require("fortran")
-languages["Fortran (fixed form)"] = require("fortran77")
-languages["FreeBasic"] = require("freebasic")
-languages["GUI4CLI"] = require("gui4cli")
-languages["Go"] = require("go")
-languages["Haskell"] = require("haskell")
-languages["HTML"] = require("html")
-languages["ini file"] = require("ini")
-languages["InnoSetup"] = require("inno")
-languages["Intel HEX"] = require("ihex")
-languages["Java"] = require("java")
-languages["JavaScript"] = require("javascript")
-languages["JSON"] = require("json")
-languages["KiXtart"] = require("kix")
-languages["LISP"] = require("lisp")
-languages["LaTeX"] = require("latex")
-languages["Lua"] = require("lua")
-languages["Less"] = require("less")
-languages["Makefile"] = require("makefile")
-languages["Markdown"] = require("markdown")
-languages["Matlab"] = require("matlab")
-languages["MMIXAL"] = require("mmixal")
-languages["Nimrod"] = require("nimrod")
-languages["extended crontab"] = require("nncrontab")
-languages["Dos Style"] = require("nfo")
-languages["NSIS"] = require("nsis")
-languages["OScript"] = require("oscript")
-languages["Objective-C"] = require("objc")
-languages["Pascal"] = require("pascal")
-languages["Perl"] = require("perl")
-languages["PHP"] = require("php")
-languages["Postscript"] = require("postscript")
-languages["PowerShell"] = require("powershell")
-languages["Properties file"] = require("props")
-languages["PureBasic"] = require("purebasic")
-languages["Python"] = require("python")
-languages["R"] = require("r")
-languages["REBOL"] = require("rebol")
-languages["registry"] = require("registry")
-languages["RC"] = require("rc")
-languages["Ruby"] = require("ruby")
-languages["Rust"] = require("rust")
-languages["Scheme"] = require("scheme")
-languages["Smalltalk"] = require("smalltalk")
-languages["spice"] = require("spice")
-languages["SQL"] = require("sql")
-languages["S-Record"] = require("srec")
-languages["Swift"] = require("swift")
-languages["TCL"] = require("tcl")
-languages["Tektronix extended HEX"] = require("tehex")
-languages["TeX"] = require("tex")
-languages["Text"] = require("text")
-languages["VB / VBS"] = require("vb")
-languages["txt2tags"] = require("txt2tags")
-languages["Verilog"] = require("verilog")
-languages["VHDL"] = require("vhdl")
-languages["Visual Prolog"] = require("visualprolog")
-languages["XML"] = require("xml")
-languages["YAML"] = require("yaml")
+-- languages["X"] loads the definition on first use. Going through all of them with pairs() loads every one.
+languages = setmetatable({}, {
+    __index = function(t, name)
+        local M = language_manifest[name]
+        if M then
+            local L = require(M.module)
+            rawset(t, name, L)
+            return L
+        end
+        return nil
+    end,
+    __pairs = function(t)
+        local name = nil
+        return function()
+            name = next(language_manifest, name)
+            if name then
+                return name, t[name]
+            end
+        end, t, nil
+    end,
+})
@@ -18,13 +18,95 @@
 
 
 #include "EditorInfoStatusBar.h"
+#include "LargeFileProfile.h"
 #include "MainWindow.h"
 #include "StatusLabel.h"
 
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Selections larger than this are counted on a worker thread so holding a huge selection doesn't stall the UI
+static const int ASYNC_COUNT_THRESHOLD = 1024 * 1024;
+
+// Holding down a key or playing a macro updates the editor far more often than the labels can be seen to change
+static const int UPDATE_INTERVAL_MS = 16;
+
+// Changing a label's text lays out the whole status bar again
+static void setTextIfChanged(QLabel *label, const QString &text)
+{
+    if (label->text() != text) {
+        label->setText(text);
+    }
+}
+
+// Counts UTF-8 characters by counting every byte that isn't a continuation byte (10xxxxxx)
+static qint64 countUtf8Characters(const char *data, qint64 length)
+{
+    qint64 continuationBytes = 0;
+    qint64 i = 0;
+
+#ifdef __SSE2__
+    // Continuation bytes are the only ones less than -64 when treated as signed. The per byte
+    // results are accumulated for up to 255 blocks before being summed so they can't overflow.
+    const __m128i threshold = _mm_set1_epi8(-64);
+    const __m128i zero = _mm_setzero_si128();
+
+    while (i + 16 <= length) {
+        __m128i accumulator = _mm_setzero_si128();
+        int blocks = 0;
+
+        while (blocks < 255 && i + 16 <= length) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            accumulator = _mm_sub_epi8(accumulator, _mm_cmpgt_epi8(threshold, chunk));
+            i += 16;
+            ++blocks;
+        }
+
+        const __m128i sums = _mm_sad_epu8(accumulator, zero);
+        continuationBytes += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#else
+    // Do 8 bytes at a time, a continuation byte has its high bit set and the next bit clear
+    while (i + 8 <= length) {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+
+        const quint64 marks = word & ~(word << 1) & Q_UINT64_C(0x8080808080808080);
+        continuationBytes += qPopulationCount(marks);
+        i += 8;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if ((static_cast<unsigned char>(data[i]) & 0xC0) == 0x80)
+            ++continuationBytes;
+    }
+
+    return length - continuationBytes;
+}
+
 
 EditorInfoStatusBar::EditorInfoStatusBar(QMainWindow *window) :
-    QStatusBar(window)
+    QStatusBar(window),
+    updateTimer(new QTimer(this))
 {
+    updateTimer->setSingleShot(true);
+    updateTimer->setInterval(UPDATE_INTERVAL_MS);
+    connect(updateTimer, &QTimer::timeout, this, &EditorInfoStatusBar::applyPendingUpdates);
+
     // Set up the status bar
     docType = new StatusLabel();
     addWidget(docType, 1);
@@ -44,6 +126,24 @@ EditorInfoStatusBar::EditorInfoStatusBar(QMainWindow *window) :
     overType = new StatusLabel(25);
     addPermanentWidget(overType, 0);
 
+    // Only shown for editors using the large file profile
+    largeFile = new StatusLabel(100);
+    largeFile->setText(tr("Large File"));
+    largeFile->hide();
+    addPermanentWidget(largeFile, 0);
+
+    // Only shown while a large file is still being loaded
+    loadProgress = new QProgressBar();
+    loadProgress->setRange(0, 100);
+    loadProgress->setMaximumWidth(150);
+    loadProgress->hide();
+    addPermanentWidget(loadProgress, 0);
+
+    cancelLoad = new QPushButton(tr("Cancel"));
+    cancelLoad->setToolTip(tr("Stop loading the file, only the part already loaded is kept"));
+    cancelLoad->hide();
+    addPermanentWidget(cancelLoad, 0);
+
     /*
     docType->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(docType, &QLabel::customContextMenuRequested, [=](const QPoint &pos) {
@@ -65,16 +165,36 @@ EditorInfoStatusBar::EditorInfoStatusBar(QMainWindow *window) :
         editor->editToggleOvertype();
         updateOverType(editor);
     });
+
+    connect(qobject_cast<StatusLabel*>(largeFile), &StatusLabel::clicked, w, [=]() {
+        ScintillaNext *editor = w->currentEditor();
+        LargeFileProfile *profile = editor->findChild<LargeFileProfile *>(QString(), Qt::FindDirectChildrenOnly);
+
+        if (profile && profile->isApplied()) {
+            const QString message = tr("Turning everything back on can make the editor very slow for this file. Do you want to continue?");
+
+            if (QMessageBox::question(w, tr("Large File"), message) == QMessageBox::Yes) {
+                profile->setEnabled(false);
+            }
+        }
+    });
 }
 
 void EditorInfoStatusBar::refresh(ScintillaNext *editor)
 {
+    // Everything is brought up to date right now, anything still pending would only repeat it
+    updateTimer->stop();
+    sizeChanged = false;
+    selectionChanged = false;
+
     updateDocumentSize(editor);
     updateSelectionInfo(editor);
     updateLanguage(editor);
     updateEol(editor);
     updateEncoding(editor);
     updateOverType(editor);
+    updateLoading(editor);
+    updateLargeFile(editor);
 }
 
 void EditorInfoStatusBar::connectToEditor(ScintillaNext *editor)
@@ -82,35 +202,88 @@ void EditorInfoStatusBar::connectToEditor(ScintillaNext *editor)
     // Remove any previous connections
     disconnect(editorUiUpdated);
     disconnect(documentLexerChanged);
+    disconnect(documentLoadingProgress);
+    disconnect(documentLoadingFinished);
+    disconnect(cancelLoadClicked);
+    disconnect(largeFileProfileChanged);
+    disconnect(documentFormatChanged);
 
     // Connect to the new editor
+    currentEditor = editor;
     editorUiUpdated = connect(editor, &ScintillaNext::updateUi, this, &EditorInfoStatusBar::editorUpdated);
     documentLexerChanged = connect(editor, &ScintillaNext::lexerChanged, this, [=]() { updateLanguage(editor); });
+    documentLoadingProgress = connect(editor, &ScintillaNext::loadingProgress, loadProgress, &QProgressBar::setValue);
+    documentLoadingFinished = connect(editor, &ScintillaNext::loadingFinished, this, [=]() { updateEncoding(editor); updateLoading(editor); updateDocumentSize(editor); });
+    documentFormatChanged = connect(editor, &ScintillaNext::fileFormatChanged, this, [=]() { updateEol(editor); updateEncoding(editor); });
+    cancelLoadClicked = connect(cancelLoad, &QPushButton::clicked, editor, &ScintillaNext::cancelLoading);
+
+    LargeFileProfile *profile = editor->findChild<LargeFileProfile *>(QString(), Qt::FindDirectChildrenOnly);
+    if (profile) {
+        largeFileProfileChanged = connect(profile, &LargeFileProfile::profileChanged, this, [=]() { updateLargeFile(editor); });
+    }
 
     refresh(editor);
 }
 
 void EditorInfoStatusBar::editorUpdated(Scintilla::Update updated)
 {
-    ScintillaNext *editor = qobject_cast<ScintillaNext *>(sender());
-
     if (Scintilla::FlagSet(updated, Scintilla::Update::Content)) {
-        updateDocumentSize(editor);
+        sizeChanged = true;
     }
 
     if (Scintilla::FlagSet(updated, Scintilla::Update::Content) || Scintilla::FlagSet(updated, Scintilla::Update::Selection)) {
-        updateSelectionInfo(editor);
+        selectionChanged = true;
+    }
+
+    if ((sizeChanged || selectionChanged) && !updateTimer->isActive()) {
+        updateTimer->start();
+    }
+}
+
+void EditorInfoStatusBar::applyPendingUpdates()
+{
+    if (currentEditor.isNull()) {
+        return;
+    }
+
+    if (sizeChanged) {
+        sizeChanged = false;
+        updateDocumentSize(currentEditor);
+    }
+
+    if (selectionChanged) {
+        selectionChanged = false;
+        updateSelectionInfo(currentEditor);
     }
 }
 
 void EditorInfoStatusBar::updateDocumentSize(ScintillaNext *editor)
 {
+    // The length and line count can only be different after the document was modified. Loading a file doesn't count
+    // as modifying it until it is done, so it is shown growing the whole time.
+    const quint64 generation = editor->changeGeneration();
+    if (shownSize.editor == editor && shownSize.generation == generation && !editor->isLoading()) {
+        return;
+    }
+
+    shownSize.editor = editor;
+    shownSize.generation = generation;
+
     QString sizeText = tr("Length: %L1    Lines: %L2").arg(editor->length()).arg(editor->lineCount());
-    docSize->setText(sizeText);
+    setTextIfChanged(docSize, sizeText);
 }
 
 void EditorInfoStatusBar::updateSelectionInfo(ScintillaNext *editor)
 {
+    const ShownState state{editor, editor->changeGeneration(), static_cast<int>(editor->currentPos()), static_cast<int>(editor->anchor()), static_cast<int>(editor->selections())};
+
+    if (shownSelection.editor == editor && shownSelection.generation == state.generation && shownSelection.position == state.position
+            && shownSelection.anchor == state.anchor && shownSelection.selections == state.selections) {
+        return;
+    }
+
+    shownSelection = state;
+
     QString selectionText;
 
     if (editor->selections() > 1) {
@@ -124,12 +297,73 @@ void EditorInfoStatusBar::updateSelectionInfo(ScintillaNext *editor)
         if (end > start)
             lines++;
 
-        selectionText = tr("Sel: %L1 | %L2").arg(editor->countCharacters(start, end)).arg(lines);
+        const qint64 characters = selectionCharacterCount(editor, start, end);
+
+        if (characters < 0)
+            selectionText = tr("Sel: counting… | %L1").arg(lines);
+        else
+            selectionText = tr("Sel: %L1 | %L2").arg(characters).arg(lines);
     }
 
     const int pos = editor->currentPos();
     QString positionText = tr("Ln: %L1    Col: %L2    ").arg(editor->lineFromPosition(pos) + 1).arg(editor->column(pos) + 1);
-    docPos->setText(positionText + selectionText);
+    setTextIfChanged(docPos, positionText + selectionText);
+}
+
+bool EditorInfoStatusBar::SelectionCount::matches(ScintillaNext *e, int s, int en) const
+{
+    return editor == e && start == s && end == en && generation == e->changeGeneration();
+}
+
+qint64 EditorInfoStatusBar::selectionCharacterCount(ScintillaNext *editor, int start, int end)
+{
+    if (end - start < ASYNC_COUNT_THRESHOLD) {
+        return editor->countCharacters(start, end);
+    }
+
+    if (cachedCount.matches(editor, start, end)) {
+        return cachedCount.count;
+    }
+
+    // Only one count runs at a time. When it finishes it refreshes the selection info, which starts
+    // the next one if the selection has moved on in the meantime.
+    if (pendingCount.editor) {
+        return -1;
+    }
+
+    pendingCount.editor = editor;
+    pendingCount.start = start;
+    pendingCount.end = end;
+    pendingCount.generation = editor->changeGeneration();
+
+    const QByteArray text(reinterpret_cast<const char *>(editor->rangePointer(start, end - start)), end - start);
+    const SelectionCount request = pendingCount;
+    QPointer<EditorInfoStatusBar> self = this;
+
+    QThreadPool::globalInstance()->start([=]() {
+        const qint64 count = countUtf8Characters(text.constData(), text.size());
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+            if (!self) {
+                return;
+            }
+
+            self->cachedCount = request;
+            self->cachedCount.count = count;
+
+            if (self->pendingCount.editor == request.editor && self->pendingCount.start == request.start && self->pendingCount.end == request.end) {
+                self->pendingCount = SelectionCount();
+            }
+
+            if (self->currentEditor) {
+                // Nothing else moved but the count still has to be shown
+                self->shownSelection = ShownState();
+                self->updateSelectionInfo(self->currentEditor);
+            }
+        }, Qt::QueuedConnection);
+    });
+
+    return -1;
 }
 
 void EditorInfoStatusBar::updateLanguage(ScintillaNext *editor)
@@ -141,28 +375,48 @@ void EditorInfoStatusBar::updateLanguage(ScintillaNext *editor)
 void EditorInfoStatusBar::updateEol(ScintillaNext *editor)
 {
     // No good way to keep these in sync with the Main Window menu items :(
+    QString text;
 
     switch(editor->eOLMode()) {
     case SC_EOL_CR:
-        eolFormat->setText(tr("Macintosh (CR)"));
+        text = tr("Macintosh (CR)");
         break;
     case SC_EOL_CRLF:
-        eolFormat->setText(tr("Windows (CR LF)"));
+        text = tr("Windows (CR LF)");
         break;
     case SC_EOL_LF:
-        eolFormat->setText(tr("Unix (LF)"));
+        text = tr("Unix (LF)");
         break;
     }
+
+    // The mode is only what new lines get, the file itself can still have a mix until the line endings are converted
+    const ScintillaNext::FileFormat &format = editor->detectedFormat();
+    if (format.mixedLineEndings) {
+        //: Shown after the line ending type when the file uses more than one kind
+        text += tr(" - Mixed");
+        eolFormat->setToolTip(tr("The file has mixed line endings. New lines use the most common one."));
+    }
+    else {
+        eolFormat->setToolTip(QString());
+    }
+
+    setTextIfChanged(eolFormat, text);
 }
 
 void EditorInfoStatusBar::updateEncoding(ScintillaNext *editor)
 {
+    // The buffer is always UTF-8, but the file on disk is written in whatever it was read as
+    if (editor->getEncoding()) {
+        unicodeType->setText(QString::fromLatin1(editor->getEncoding()->name()));
+        return;
+    }
+
     switch(editor->codePage()) {
     case 0:
         unicodeType->setText(tr("ANSI"));
         break;
     case SC_CP_UTF8:
-        unicodeType->setText(tr("UTF-8"));
+        unicodeType->setText(editor->hasByteOrderMark() ? tr("UTF-8-BOM") : tr("UTF-8"));
         break;
     default:
         unicodeType->setText(QString::number(editor->codePage()));
@@ -182,3 +436,23 @@ void EditorInfoStatusBar::updateOverType(ScintillaNext *editor)
         overType->setText(tr("INS"));
     }
 }
+
+void EditorInfoStatusBar::updateLoading(ScintillaNext *editor)
+{
+    const bool loading = editor->isLoading();
+
+    if (!loading)
+        loadProgress->setValue(0);
+
+    loadProgress->setVisible(loading);
+    cancelLoad->setVisible(loading);
+}
+
+void EditorInfoStatusBar::updateLargeFile(ScintillaNext *editor)
+{
+    LargeFileProfile *profile = editor->findChild<LargeFileProfile *>(QString(), Qt::FindDirectChildrenOnly);
+    const bool applied = profile && profile->isApplied();
+
+    largeFile->setVisible(applied);
+    largeFile->setToolTip(applied ? profile->description() : QString());
+}
@@ -20,6 +20,7 @@
 #ifndef EDITORINFOSTATUSBAR_H
 #define EDITORINFOSTATUSBAR_H
 
+#include <QPointer>
 #include <QStatusBar>
 
 #include "ScintillaTypes.h"
@@ -27,6 +28,9 @@
 
 class QLabel;
 class QMainWindow;
+class QProgressBar;
+class QPushButton;
+class QTimer;
 class ScintillaNext;
 
 class EditorInfoStatusBar : public QStatusBar
@@ -42,6 +46,7 @@ private slots:
     void connectToEditor(ScintillaNext *editor);
 
     void editorUpdated(Scintilla::Update updated);
+    void applyPendingUpdates();
 
     void updateDocumentSize(ScintillaNext *editor);
     void updateSelectionInfo(ScintillaNext *editor);
@@ -49,17 +54,62 @@ private slots:
     void updateEol(ScintillaNext *editor);
     void updateEncoding(ScintillaNext *editor);
     void updateOverType(ScintillaNext *editor);
+    void updateLoading(ScintillaNext *editor);
+    void updateLargeFile(ScintillaNext *editor);
 
 private:
+    struct SelectionCount
+    {
+        QPointer<ScintillaNext> editor;
+        int start = -1;
+        int end = -1;
+        quint64 generation = 0;
+        qint64 count = -1;
+
+        bool matches(ScintillaNext *e, int s, int en) const;
+    };
+
+    qint64 selectionCharacterCount(ScintillaNext *editor, int start, int end);
+
+    // What the labels were last worked out from, so nothing is formatted again when none of it changed
+    struct ShownState
+    {
+        QPointer<ScintillaNext> editor;
+        quint64 generation = 0;
+        int position = -1;
+        int anchor = -1;
+        int selections = -1;
+    };
+
     QLabel *docType;
     QLabel *docSize;
     QLabel *docPos;
     QLabel *unicodeType;
     QLabel *eolFormat;
     QLabel *overType;
+    QLabel *largeFile;
+    QProgressBar *loadProgress;
+    QPushButton *cancelLoad;
+
+    QPointer<ScintillaNext> currentEditor;
+    ShownState shownSize;
+    ShownState shownSelection;
+
+    // Updates from the editor are gathered up and shown at most once a frame
+    QTimer *updateTimer;
+    bool sizeChanged = false;
+    bool selectionChanged = false;
+
+    SelectionCount cachedCount;
+    SelectionCount pendingCount;
 
     QMetaObject::Connection editorUiUpdated;
     QMetaObject::Connection documentLexerChanged;
+    QMetaObject::Connection documentLoadingProgress;
+    QMetaObject::Connection documentLoadingFinished;
+    QMetaObject::Connection cancelLoadClicked;
+    QMetaObject::Connection largeFileProfileChanged;
+    QMetaObject::Connection documentFormatChanged;
 };
 
 #endif // EDITORINFOSTATUSBAR_H
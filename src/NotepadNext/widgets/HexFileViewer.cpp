@@ -0,0 +1,177 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "HexFileViewer.h"
+#include "HexViewerDelegate.h"
+#include "MappedFileHexModel.h"
+
+#include <QAction>
+#include <QCloseEvent>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableView>
+#include <QVBoxLayout>
+
+
+HexFileViewer::HexFileViewer(QWidget *parent) :
+    QWidget(parent),
+    model(new MappedFileHexModel(this)),
+    view(new QTableView(this))
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->setFrameShape(QFrame::NoFrame);
+    view->setEditTriggers(QAbstractItemView::DoubleClicked);
+    view->setSelectionMode(QAbstractItemView::NoSelection);
+    view->setWordWrap(false);
+    view->setCornerButtonEnabled(false);
+    view->setItemDelegate(new HexViewerDelegate(this));
+    view->setModel(model);
+
+    // Every row is the same height, so the header never has to measure the millions of them a big file has
+    view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view->verticalHeader()->setDefaultSectionSize(view->fontMetrics().height() + 4);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(view);
+
+    QAction *saveAction = new QAction(tr("Save"), this);
+    saveAction->setShortcut(QKeySequence::Save);
+    saveAction->setShortcutContext(Qt::WindowShortcut);
+    connect(saveAction, &QAction::triggered, this, &HexFileViewer::save);
+    addAction(saveAction);
+
+    QAction *goToAction = new QAction(tr("Go to Offset..."), this);
+    goToAction->setShortcut(Qt::CTRL | Qt::Key_G);
+    goToAction->setShortcutContext(Qt::WindowShortcut);
+    connect(goToAction, &QAction::triggered, this, &HexFileViewer::showGoToOffset);
+    addAction(goToAction);
+
+    connect(model, &MappedFileHexModel::modificationChanged, this, &HexFileViewer::updateTitle);
+
+    resize(700, 600);
+}
+
+bool HexFileViewer::openFile(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    if (!model->openFile(filePath))
+        return false;
+
+    view->resizeColumnsToContents();
+    updateTitle();
+
+    return true;
+}
+
+QString HexFileViewer::filePath() const
+{
+    return model->filePath();
+}
+
+void HexFileViewer::offerOpenAsText()
+{
+    if (openAsTextBar)
+        return;
+
+    openAsTextBar = new QWidget(this);
+
+    QHBoxLayout *barLayout = new QHBoxLayout(openAsTextBar);
+    barLayout->addWidget(new QLabel(tr("This file looks like binary data, so it was opened in the hex viewer."), openAsTextBar), 1);
+
+    QPushButton *openAsTextButton = new QPushButton(tr("Open as Text Anyway"), openAsTextBar);
+    barLayout->addWidget(openAsTextButton);
+
+    connect(openAsTextButton, &QPushButton::clicked, this, [=]() {
+        const QString path = filePath();
+
+        // Closing can still be canceled if there are changes to the bytes
+        if (close())
+            emit openAsTextRequested(path);
+    });
+
+    static_cast<QVBoxLayout *>(layout())->insertWidget(0, openAsTextBar);
+}
+
+bool HexFileViewer::save()
+{
+    if (model->save())
+        return true;
+
+    QMessageBox::warning(this, tr("Error Saving File"), tr("An error occurred when saving <b>%1</b>").arg(filePath()));
+    return false;
+}
+
+void HexFileViewer::goToOffset(qint64 offset)
+{
+    const int row = static_cast<int>(qBound<qint64>(0, offset / 16, model->rowCount() - 1));
+    const QModelIndex index = model->index(row, static_cast<int>(offset % 16));
+
+    view->scrollTo(index, QAbstractItemView::PositionAtTop);
+}
+
+void HexFileViewer::showGoToOffset()
+{
+    bool ok;
+    const QString text = QInputDialog::getText(this, tr("Go to Offset"), tr("Offset (hex):"), QLineEdit::Normal, QString(), &ok);
+
+    if (!ok || text.isEmpty())
+        return;
+
+    const qint64 offset = text.trimmed().toLongLong(&ok, 16);
+    if (ok)
+        goToOffset(offset);
+}
+
+void HexFileViewer::closeEvent(QCloseEvent *event)
+{
+    if (model->isModified()) {
+        const QString message = tr("Save the changes to <b>%1</b>?").arg(QFileInfo(filePath()).fileName());
+        const auto reply = QMessageBox::question(this, tr("Save File"), message, QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel, QMessageBox::Save);
+
+        if (reply == QMessageBox::Cancel || (reply == QMessageBox::Save && !save())) {
+            event->ignore();
+            return;
+        }
+    }
+
+    QWidget::closeEvent(event);
+}
+
+void HexFileViewer::updateTitle()
+{
+    QString title = tr("%1 [Hex]").arg(QFileInfo(filePath()).fileName());
+
+    if (model->isModified())
+        title.prepend(QLatin1Char('*'));
+
+    title += QStringLiteral(" - ") + QLocale().formattedDataSize(model->fileSize());
+
+    setWindowTitle(title);
+}
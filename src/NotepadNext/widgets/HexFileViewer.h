@@ -0,0 +1,60 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QWidget>
+
+class MappedFileHexModel;
+class QTableView;
+
+
+// A window showing the bytes of a file on disk in hex, whatever its size and without decoding it first the way an
+// editor would. See MappedFileHexModel. Bytes can be edited and are only written to the file when saved.
+class HexFileViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HexFileViewer(QWidget *parent = nullptr);
+
+    bool openFile(const QString &filePath);
+    QString filePath() const;
+
+    // Shows a bar above the bytes saying the file was taken to be binary, with a button to open it as text instead
+    void offerOpenAsText();
+
+signals:
+    void openAsTextRequested(const QString &filePath);
+
+public slots:
+    bool save();
+    void goToOffset(qint64 offset);
+    void showGoToOffset();
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
+private:
+    void updateTitle();
+
+    MappedFileHexModel *model;
+    QTableView *view;
+    QWidget *openAsTextBar = nullptr;
+};
@@ -0,0 +1,825 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LargeFileViewer.h"
+#include "BufferSearcher.h"
+#include "RemoteFile.h"
+
+#include <QContextMenuEvent>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QInputDialog>
+#include <QKeyEvent>
+#include <QLocale>
+#include <QMenu>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPointer>
+#include <QScrollBar>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+
+// Lines longer than this are shown in pieces, otherwise a file without any newlines would be one huge line
+const qint64 MAX_LINE_LENGTH = 64 * 1024;
+
+// Only every this many lines gets its offset stored, anything in between is counted from the closest one
+const qint64 LINE_INDEX_STRIDE = 1024;
+
+// The newlines are counted this much at a time, and only a block with a checkpoint in it is looked at line by line
+const qint64 INDEX_BLOCK_SIZE = 4096;
+
+// The scroll bar can't cover every byte of a huge file so it moves in steps of at least this many bytes
+const int SCROLL_BAR_STEPS = 1 << 30;
+
+// Searches go through the file this much at a time, always ending on a line boundary
+const qint64 SEARCH_WINDOW = 64 * 1024 * 1024;
+
+const int TEXT_MARGIN = 4;
+
+static QString displayText(const char *data, qint64 length)
+{
+    QString text = QString::fromUtf8(data, static_cast<int>(length));
+    text.replace(QLatin1Char('\t'), QStringLiteral("    "));
+    return text;
+}
+
+// Counts a word at a time, which is most of what it takes to skip over the lines between two checkpoints
+static qint64 countNewlines(const char *p, const char *end)
+{
+    const quint64 newlines = Q_UINT64_C(0x0A0A0A0A0A0A0A0A);
+    const quint64 low = Q_UINT64_C(0x7F7F7F7F7F7F7F7F);
+    qint64 count = 0;
+
+    for (; end - p >= 8; p += 8) {
+        quint64 word;
+        std::memcpy(&word, p, sizeof(word));
+
+        // Every byte that was a newline is now zero, and only those end up with their top bit set
+        const quint64 x = word ^ newlines;
+        count += qPopulationCount(~(((x & low) + low) | x | low));
+    }
+
+    for (; p < end; ++p)
+        count += *p == '\n';
+
+    return count;
+}
+
+struct LargeFileViewer::SharedState
+{
+    std::atomic_bool canceled{false};
+};
+
+LargeFileViewer::LargeFileViewer(QWidget *parent) :
+    QAbstractScrollArea(parent),
+    state(std::make_shared<SharedState>())
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    verticalScrollBar()->setRange(0, 0);
+    horizontalScrollBar()->setRange(0, 0);
+
+    resize(900, 600);
+}
+
+LargeFileViewer::~LargeFileViewer()
+{
+    // The workers hold on to the file themselves so it stays mapped until they are done
+    state->canceled = true;
+}
+
+bool LargeFileViewer::openFile(const QString &filePath)
+{
+    qInfo(Q_FUNC_INFO);
+
+    file = std::make_shared<QFile>(filePath);
+
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning("QFile::open() failed when opening \"%s\" - error code %d: %s", qUtf8Printable(filePath), file->error(), qUtf8Printable(file->errorString()));
+        return false;
+    }
+
+    size = file->size();
+
+    if (size > 0) {
+        data = reinterpret_cast<const char *>(file->map(0, size));
+
+        if (data == Q_NULLPTR) {
+            qWarning("QFile::map() failed for \"%s\": %s", qUtf8Printable(filePath), qUtf8Printable(file->errorString()));
+            return false;
+        }
+    }
+
+    topOffset = 0;
+    updateScrollBars();
+    updateTitle();
+    buildLineIndex();
+
+    return true;
+}
+
+void LargeFileViewer::openUrl(const QUrl &url)
+{
+    qInfo(Q_FUNC_INFO);
+
+    // Workers that are waiting on blocks keep it alive, and it is always deleted on this thread
+    remote = std::shared_ptr<RemoteFile>(new RemoteFile(url), [](RemoteFile *remoteFile) {
+        remoteFile->deleteLater();
+    });
+
+    connect(remote.get(), &RemoteFile::opened, this, [=](bool success) {
+        if (!success) {
+            QMessageBox::warning(this, tr("Error Opening File"), tr("<b>%1</b> could not be opened: %2").arg(url.toDisplayString().toHtmlEscaped(), remote->errorString()));
+            close();
+            return;
+        }
+
+        data = remote->data();
+        size = remote->size();
+        topOffset = 0;
+
+        updateScrollBars();
+        updateTitle();
+        viewport()->update();
+    });
+    connect(remote.get(), &RemoteFile::blocksFetched, this, &LargeFileViewer::remoteFetched);
+    connect(remote.get(), &RemoteFile::grown, this, &LargeFileViewer::remoteGrown);
+    connect(remote.get(), &RemoteFile::failed, this, [=]() {
+        // Shown where the text would have been, and following may have stopped
+        updateTitle();
+        viewport()->update();
+    });
+
+    updateTitle();
+    remote->open();
+}
+
+QString LargeFileViewer::filePath() const
+{
+    if (remote)
+        return remote->url().toString();
+
+    return file ? file->fileName() : QString();
+}
+
+void LargeFileViewer::goToLine(qint64 line)
+{
+    // A line that hasn't been counted up to yet is gone to as soon as it has been
+    if (!lineIndex || (!lineIndex->complete && line >= lineIndex->lineCount)) {
+        pendingLine = line;
+        return;
+    }
+
+    pendingLine = -1;
+    goToOffset(offsetOfLine(qBound<qint64>(0, line, lineIndex->lineCount - 1)));
+}
+
+void LargeFileViewer::goToOffset(qint64 offset)
+{
+    setTopOffset(qBound<qint64>(0, offset, size));
+
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileViewer::find()
+{
+    bool ok;
+    const QString text = QInputDialog::getText(this, tr("Find"), tr("Find what:"), QLineEdit::Normal, QString::fromUtf8(searchText), &ok);
+
+    if (!ok || text.isEmpty())
+        return;
+
+    searchText = text.toUtf8();
+    searchFlags = SCFIND_MATCHCASE;
+    matchStart = matchEnd = -1;
+
+    searchFrom(topOffset);
+}
+
+void LargeFileViewer::findRegularExpression()
+{
+    bool ok;
+    const QString text = QInputDialog::getText(this, tr("Find"), tr("Find regular expression:"), QLineEdit::Normal, QString::fromUtf8(searchText), &ok);
+
+    if (!ok || text.isEmpty())
+        return;
+
+    if (!BufferSearcher(text.toUtf8(), SCFIND_MATCHCASE | SCFIND_REGEXP).isValid()) {
+        QMessageBox::warning(this, tr("Find"), tr("\"%1\" is not a valid regular expression.").arg(text));
+        return;
+    }
+
+    searchText = text.toUtf8();
+    searchFlags = SCFIND_MATCHCASE | SCFIND_REGEXP;
+    matchStart = matchEnd = -1;
+
+    searchFrom(topOffset);
+}
+
+void LargeFileViewer::findNext()
+{
+    if (searchText.isEmpty()) {
+        find();
+        return;
+    }
+
+    searchFrom(matchEnd >= 0 ? matchEnd : topOffset);
+}
+
+void LargeFileViewer::showGoToLine()
+{
+    if (remote) {
+        QMessageBox::information(this, tr("Go to Line"), tr("Lines are not counted in remote files, since that would mean fetching all of it."));
+        return;
+    }
+
+    const qint64 lineCount = lineIndex ? lineIndex->lineCount : 0;
+    const QString label = lineIndex && lineIndex->complete ? tr("Line number (1 - %L1):").arg(lineCount) : tr("Line number (%L1 counted so far):").arg(lineCount);
+
+    bool ok;
+    const QString text = QInputDialog::getText(this, tr("Go to Line"), label, QLineEdit::Normal, QString(), &ok);
+    const qint64 line = text.toLongLong(&ok);
+
+    if (ok)
+        goToLine(line - 1);
+}
+
+void LargeFileViewer::setFollowing(bool follow)
+{
+    if (remote)
+        remote->setFollowing(follow);
+}
+
+bool LargeFileViewer::isAvailable(qint64 offset, qint64 length) const
+{
+    if (!remote)
+        return true;
+
+    const qint64 start = qMax<qint64>(0, offset);
+    const qint64 end = qMin(size, offset + length);
+
+    if (end <= start || remote->isCached(start, end - start))
+        return true;
+
+    // There is no waiting on the GUI thread, it gets drawn again once the blocks arrive
+    remote->fetch(start, end - start);
+    return false;
+}
+
+void LargeFileViewer::setTopOffset(qint64 offset)
+{
+    topNeedsLineStart = !isAvailable(offset - MAX_LINE_LENGTH, MAX_LINE_LENGTH);
+    topOffset = topNeedsLineStart ? offset : lineStart(offset);
+}
+
+void LargeFileViewer::remoteFetched()
+{
+    if (topNeedsLineStart && isAvailable(topOffset - MAX_LINE_LENGTH, MAX_LINE_LENGTH)) {
+        topNeedsLineStart = false;
+        topOffset = lineStart(topOffset);
+        updateScrollBars();
+    }
+
+    viewport()->update();
+}
+
+void LargeFileViewer::remoteGrown(qint64 newSize)
+{
+    const bool wasShowingEnd = showingEnd;
+
+    // The cache may have been mapped again somewhere else to make room
+    data = remote->data();
+    size = newSize;
+
+    if (wasShowingEnd) {
+        goToOffset(size);
+        scrollLines(-(visibleLineCount() - 1));
+    }
+    else {
+        updateScrollBars();
+        viewport()->update();
+    }
+
+    updateTitle();
+}
+
+qint64 LargeFileViewer::lineStart(qint64 offset) const
+{
+    const qint64 limit = qMax<qint64>(0, offset - MAX_LINE_LENGTH);
+
+    if (!isAvailable(limit, offset - limit))
+        return offset;
+
+    for (qint64 i = offset; i > limit; --i) {
+        if (data[i - 1] == '\n')
+            return i;
+    }
+
+    return limit;
+}
+
+qint64 LargeFileViewer::nextLineStart(qint64 offset) const
+{
+    const qint64 limit = qMin(size, offset + MAX_LINE_LENGTH);
+    const void *newline = std::memchr(data + offset, '\n', static_cast<size_t>(limit - offset));
+
+    return newline ? static_cast<const char *>(newline) - data + 1 : limit;
+}
+
+qint64 LargeFileViewer::lineNumberAt(qint64 offset) const
+{
+    Q_ASSERT(lineIndex);
+
+    const std::vector<qint64> &checkpoints = lineIndex->checkpoints;
+    const auto it = std::upper_bound(checkpoints.cbegin(), checkpoints.cend(), offset) - 1;
+
+    return (it - checkpoints.cbegin()) * LINE_INDEX_STRIDE + countNewlines(data + *it, data + offset);
+}
+
+qint64 LargeFileViewer::offsetOfLine(qint64 line) const
+{
+    Q_ASSERT(lineIndex);
+
+    qint64 offset = lineIndex->checkpoints[line / LINE_INDEX_STRIDE];
+
+    for (qint64 i = line % LINE_INDEX_STRIDE; i > 0 && offset < size; --i) {
+        const void *newline = std::memchr(data + offset, '\n', static_cast<size_t>(size - offset));
+        offset = newline ? static_cast<const char *>(newline) - data + 1 : size;
+    }
+
+    return offset;
+}
+
+void LargeFileViewer::scrollLines(qint64 lines)
+{
+    for (; lines > 0 && topOffset < size && isAvailable(topOffset, MAX_LINE_LENGTH); --lines) {
+        const qint64 next = nextLineStart(topOffset);
+
+        // Never scroll the last line off the top
+        if (next >= size)
+            break;
+
+        topOffset = next;
+    }
+
+    for (; lines < 0 && topOffset > 0 && isAvailable(topOffset - 1 - MAX_LINE_LENGTH, MAX_LINE_LENGTH + 1); ++lines)
+        topOffset = lineStart(topOffset - 1);
+
+    updateScrollBars();
+    viewport()->update();
+}
+
+int LargeFileViewer::visibleLineCount() const
+{
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+void LargeFileViewer::updateScrollBars()
+{
+    settingScrollBar = true;
+
+    const int steps = static_cast<int>(qMin<qint64>(size, SCROLL_BAR_STEPS));
+    verticalScrollBar()->setRange(0, steps);
+    verticalScrollBar()->setPageStep(qMax(1, steps / 100));
+    verticalScrollBar()->setValue(size > 0 ? static_cast<int>(topOffset * steps / size) : 0);
+
+    horizontalScrollBar()->setRange(0, qMax(0, maxLineWidth - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth());
+
+    settingScrollBar = false;
+}
+
+void LargeFileViewer::updateTitle()
+{
+    if (remote) {
+        QString title = tr("%1 [Read Only Viewer]").arg(remote->url().fileName());
+
+        if (size > 0)
+            title += QStringLiteral(" - ") + QLocale().formattedDataSize(size);
+        if (remote->isFollowing())
+            title += QStringLiteral(" - ") + tr("Following");
+
+        setWindowTitle(title);
+        return;
+    }
+
+    QString title = tr("%1 [Read Only Viewer]").arg(QFileInfo(filePath()).fileName());
+
+    if (lineIndex && lineIndex->complete)
+        title += QStringLiteral(" - ") + tr("%Ln lines", "", static_cast<int>(qMin<qint64>(lineIndex->lineCount, INT_MAX)));
+    else
+        title += QStringLiteral(" - ") + tr("Counting lines %1%").arg(indexProgress);
+
+    setWindowTitle(title);
+}
+
+void LargeFileViewer::buildLineIndex()
+{
+    QPointer<LargeFileViewer> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+    std::shared_ptr<QFile> mappedFile = file;
+    const char *bytes = data;
+    const qint64 length = size;
+
+    QThreadPool::globalInstance()->start([=]() {
+        // Everything posted back goes through the application object since this object may be deleted at any point
+        auto post = [=](auto func) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    func(self.data());
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        Q_UNUSED(mappedFile) // keeps the mapping alive
+
+        std::shared_ptr<LineIndex> index = std::make_shared<LineIndex>();
+        index->checkpoints.push_back(0);
+
+        const char *p = bytes;
+        const char *end = bytes + length;
+        const char *nextReport = p + SEARCH_WINDOW;
+        const char *lastLineStart = p;
+        qint64 lines = 0;
+
+        while (p < end && !sharedState->canceled) {
+            const char *blockEnd = p + qMin<qint64>(INDEX_BLOCK_SIZE, end - p);
+            const qint64 blockLines = countNewlines(p, blockEnd);
+
+            if (blockLines > 0 && (lines % LINE_INDEX_STRIDE) + blockLines >= LINE_INDEX_STRIDE) {
+                for (const char *newline; (newline = static_cast<const char *>(std::memchr(p, '\n', blockEnd - p))) != Q_NULLPTR;) {
+                    p = newline + 1;
+
+                    if ((++lines % LINE_INDEX_STRIDE) == 0)
+                        index->checkpoints.push_back(p - bytes);
+                }
+                lastLineStart = p;
+            }
+            else if (blockLines > 0) {
+                lines += blockLines;
+
+                lastLineStart = blockEnd;
+                while (lastLineStart[-1] != '\n')
+                    --lastLineStart;
+            }
+
+            p = blockEnd;
+
+            // What has been counted so far can already be used, e.g. to go to a line near the start
+            if (p >= nextReport && p < end) {
+                nextReport = p + SEARCH_WINDOW;
+
+                std::shared_ptr<LineIndex> partial = std::make_shared<LineIndex>(*index);
+                partial->lineCount = lines;
+                partial->indexedTo = lastLineStart - bytes;
+
+                const int percent = static_cast<int>((p - bytes) * 100 / length);
+                post([=](LargeFileViewer *v) {
+                    v->indexProgress = percent;
+                    v->setLineIndex(partial);
+                });
+            }
+        }
+
+        if (sharedState->canceled)
+            return;
+
+        // The last line only counts if there is something on it
+        index->lineCount = lines + (lastLineStart < end || length == 0 ? 1 : 0);
+        index->indexedTo = length;
+        index->complete = true;
+
+        post([=](LargeFileViewer *v) {
+            v->setLineIndex(index);
+        });
+    });
+}
+
+void LargeFileViewer::setLineIndex(std::shared_ptr<const LineIndex> index)
+{
+    lineIndex = index;
+
+    if (pendingLine >= 0 && (index->complete || pendingLine < index->lineCount))
+        goToLine(pendingLine);
+
+    updateTitle();
+    viewport()->update();
+}
+
+void LargeFileViewer::searchFrom(qint64 offset)
+{
+    if (searching)
+        return;
+
+    searching = true;
+    setCursor(Qt::BusyCursor);
+
+    QPointer<LargeFileViewer> self = this;
+    std::shared_ptr<SharedState> sharedState = state;
+    std::shared_ptr<QFile> mappedFile = file;
+    std::shared_ptr<RemoteFile> remoteFile = remote;
+    const char *bytes = data;
+    const qint64 length = size;
+    const QByteArray pattern = searchText;
+    const int flags = searchFlags;
+    const qint64 contextStart = lineStart(offset);
+
+    QThreadPool::globalInstance()->start([=]() {
+        auto post = [=](auto func) {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [=]() {
+                if (self) {
+                    func(self.data());
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        Q_UNUSED(mappedFile) // keeps the mapping alive
+
+        BufferSearcher searcher(pattern, flags);
+        searcher.setCancelFlag(&sharedState->canceled);
+
+        qint64 foundStart = -1;
+        qint64 foundEnd = -1;
+
+        // A remote file is searched a window at a time like any other, each one is fetched before it is searched.
+        // Regular expressions only match within a window then, so they can't span more than SEARCH_WINDOW.
+        auto windowEnd = [&](qint64 start) {
+            qint64 end = qMin(length, start + SEARCH_WINDOW);
+
+            while (end < length) {
+                const qint64 lookAhead = remoteFile ? qMin<qint64>(length - end, RemoteFile::BLOCK_SIZE) : length - end;
+
+                if (remoteFile && !remoteFile->waitFor(end, lookAhead, sharedState->canceled))
+                    return qint64(-1);
+
+                const void *newline = std::memchr(bytes + end, '\n', static_cast<size_t>(lookAhead));
+                if (newline)
+                    return static_cast<qint64>(static_cast<const char *>(newline) - bytes + 1);
+
+                end += lookAhead;
+            }
+
+            return length;
+        };
+
+        for (qint64 start = (flags & SCFIND_REGEXP) ? contextStart : offset; remoteFile && start < length && foundStart == -1 && !sharedState->canceled;) {
+            const qint64 end = windowEnd(start);
+
+            if (end < 0 || !remoteFile->waitFor(start, end - start, sharedState->canceled))
+                break;
+
+            // Nothing past the window is looked at, it may not have been fetched
+            searcher.forEachMatch(bytes, end, start, end, [&](qsizetype matchStart, qsizetype matchEnd) {
+                if (matchStart < offset)
+                    return true;
+
+                foundStart = matchStart;
+                foundEnd = matchEnd;
+                return false;
+            });
+
+            start = end;
+        }
+
+        if (!remoteFile && (flags & SCFIND_REGEXP)) {
+            // The searcher goes through the file a chunk at a time itself, carrying on with matches that span
+            // chunks. Starting at the beginning of the line lets ^ and lookbehinds work after the last match.
+            searcher.forEachMatch(bytes, length, contextStart, length, [&](qsizetype matchStart, qsizetype matchEnd) {
+                if (matchStart < offset)
+                    return true;
+
+                foundStart = matchStart;
+                foundEnd = matchEnd;
+                return false;
+            });
+        }
+
+        // Ending each window on a newline means a match can never be split between two of them
+        for (qint64 start = offset; !remoteFile && !(flags & SCFIND_REGEXP) && start < length && foundStart == -1 && !sharedState->canceled;) {
+            const qint64 end = windowEnd(start);
+
+            searcher.forEachMatch(bytes, length, start, end, [&](qsizetype matchStart, qsizetype matchEnd) {
+                foundStart = matchStart;
+                foundEnd = matchEnd;
+                return false;
+            });
+
+            start = end;
+        }
+
+        post([=](LargeFileViewer *v) {
+            v->searching = false;
+            v->unsetCursor();
+
+            if (foundStart == -1) {
+                QMessageBox::information(v, tr("Find"), tr("No more occurrences of \"%1\" were found.").arg(QString::fromUtf8(pattern)));
+                return;
+            }
+
+            v->matchStart = foundStart;
+            v->matchEnd = foundEnd;
+
+            // Leave a few lines of context above the match
+            v->goToOffset(foundStart);
+            v->scrollLines(-qMin(3, v->visibleLineCount() / 3));
+
+            const int x = v->fontMetrics().horizontalAdvance(displayText(v->data + v->lineStart(foundStart), foundStart - v->lineStart(foundStart)));
+            if (x < v->horizontalScrollBar()->value() || x > v->horizontalScrollBar()->value() + v->viewport()->width())
+                v->horizontalScrollBar()->setValue(qMax(0, x - v->viewport()->width() / 2));
+        });
+    });
+}
+
+void LargeFileViewer::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), palette().base());
+    painter.setFont(font());
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.height();
+    const int scrollX = horizontalScrollBar()->value();
+
+    // Past what has been counted so far there is no telling what line it is
+    qint64 lineNumber = lineIndex && size > 0 && topOffset <= lineIndex->indexedTo ? lineNumberAt(topOffset) : -1;
+    const int gutterWidth = lineIndex ? metrics.horizontalAdvance(QString::number(lineIndex->lineCount)) + 2 * TEXT_MARGIN : 0;
+    const int textX = gutterWidth + TEXT_MARGIN;
+    int widest = maxLineWidth;
+
+    qint64 offset = topOffset;
+    for (int y = 0; y < viewport()->height() && offset < size; y += lineHeight) {
+        if (!isAvailable(offset, MAX_LINE_LENGTH)) {
+            painter.setPen(palette().placeholderText().color());
+            painter.drawText(textX, y + metrics.ascent(), remote->errorString().isEmpty() ? tr("Fetching...") : tr("Fetching... (%1)").arg(remote->errorString()));
+            break;
+        }
+
+        const qint64 next = nextLineStart(offset);
+        const bool endsLine = data[next - 1] == '\n';
+
+        qint64 end = next;
+        while (end > offset && (data[end - 1] == '\n' || data[end - 1] == '\r'))
+            --end;
+
+        const QString text = displayText(data + offset, end - offset);
+        const int width = metrics.horizontalAdvance(text);
+        widest = qMax(widest, width + textX + TEXT_MARGIN);
+
+        painter.save();
+        painter.setClipRect(gutterWidth, y, viewport()->width() - gutterWidth, lineHeight);
+
+        if (matchStart >= offset && matchStart < next) {
+            const int matchX = metrics.horizontalAdvance(displayText(data + offset, matchStart - offset));
+            const int matchWidth = metrics.horizontalAdvance(displayText(data + matchStart, qMin(matchEnd, end) - matchStart));
+
+            painter.fillRect(textX - scrollX + matchX, y, qMax(matchWidth, 2), lineHeight, palette().highlight());
+        }
+
+        painter.setPen(palette().text().color());
+        painter.drawText(textX - scrollX, y + metrics.ascent(), text);
+        painter.restore();
+
+        if (lineNumber >= 0) {
+            painter.setPen(palette().placeholderText().color());
+            painter.drawText(QRect(0, y, gutterWidth - TEXT_MARGIN, lineHeight), Qt::AlignRight | Qt::AlignVCenter, QString::number(lineNumber + 1));
+
+            if (endsLine)
+                ++lineNumber;
+        }
+
+        offset = next;
+    }
+
+    // A followed file keeps showing its end as it grows
+    showingEnd = offset >= size;
+
+    if (widest != maxLineWidth) {
+        maxLineWidth = widest;
+        updateScrollBars();
+    }
+}
+
+void LargeFileViewer::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    updateScrollBars();
+}
+
+void LargeFileViewer::keyPressEvent(QKeyEvent *event)
+{
+    const bool control = event->modifiers() & Qt::ControlModifier;
+
+    if (event->matches(QKeySequence::Find)) {
+        find();
+    }
+    else if (control && (event->modifiers() & Qt::ShiftModifier) && event->key() == Qt::Key_F) {
+        findRegularExpression();
+    }
+    else if (event->matches(QKeySequence::FindNext) || event->key() == Qt::Key_F3) {
+        findNext();
+    }
+    else if (control && event->key() == Qt::Key_G) {
+        showGoToLine();
+    }
+    else if (event->key() == Qt::Key_Down) {
+        scrollLines(1);
+    }
+    else if (event->key() == Qt::Key_Up) {
+        scrollLines(-1);
+    }
+    else if (event->key() == Qt::Key_PageDown) {
+        scrollLines(visibleLineCount() - 1);
+    }
+    else if (event->key() == Qt::Key_PageUp) {
+        scrollLines(-(visibleLineCount() - 1));
+    }
+    else if (control && event->key() == Qt::Key_Home) {
+        goToOffset(0);
+    }
+    else if (control && event->key() == Qt::Key_End) {
+        // Fill the whole screen with the end of the file
+        goToOffset(size);
+        scrollLines(-(visibleLineCount() - 1));
+    }
+    else {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+void LargeFileViewer::wheelEvent(QWheelEvent *event)
+{
+    // Scroll by lines, the vertical scroll bar is in bytes
+    const int lines = -event->angleDelta().y() / 40;
+
+    if (lines != 0)
+        scrollLines(lines);
+    else
+        QAbstractScrollArea::wheelEvent(event);
+}
+
+void LargeFileViewer::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx)
+
+    if (dy != 0 && !settingScrollBar) {
+        // The user moved the scroll bar so jump to the matching place in the file
+        const int steps = verticalScrollBar()->maximum();
+        setTopOffset(steps > 0 ? static_cast<qint64>(verticalScrollBar()->value()) * size / steps : 0);
+    }
+
+    viewport()->update();
+}
+
+void LargeFileViewer::contextMenuEvent(QContextMenuEvent *event)
+{
+    QMenu menu(this);
+
+    menu.addAction(tr("Find..."), this, &LargeFileViewer::find);
+    menu.addAction(tr("Find Regular Expression..."), this, &LargeFileViewer::findRegularExpression);
+    menu.addAction(tr("Find Next"), this, &LargeFileViewer::findNext);
+
+    if (!remote) {
+        menu.addAction(tr("Go to Line..."), this, &LargeFileViewer::showGoToLine);
+    }
+    else {
+        menu.addSeparator();
+
+        QAction *follow = menu.addAction(tr("Follow"), this, [=](bool checked) {
+            setFollowing(checked);
+            updateTitle();
+        });
+        follow->setCheckable(true);
+        follow->setChecked(remote->isFollowing());
+    }
+
+    menu.exec(event->globalPos());
+}
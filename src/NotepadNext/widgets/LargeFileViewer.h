@@ -0,0 +1,125 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QFile>
+
+#include "Scintilla.h"
+
+#include <memory>
+#include <vector>
+
+class RemoteFile;
+class QUrl;
+
+// A read-only view of a file that is too big to load into an editor. The file is memory mapped and only
+// the lines on screen are ever decoded, so it opens instantly no matter how big it is. Line numbers
+// come from a sparse index that is built in the background, the part counted so far is usable while
+// it is. There is no lexing, undo, or decorators.
+//
+// A file on a web server can be viewed the same way. Only the blocks that are shown or searched are fetched, and a
+// remote file can be followed to see what gets added to it. Lines aren't counted for those, since that would mean
+// fetching all of it.
+class LargeFileViewer : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileViewer(QWidget *parent = nullptr);
+    ~LargeFileViewer() override;
+
+    bool openFile(const QString &filePath);
+    // Returns straight away, the viewer closes itself with a warning if the file turns out not to be readable
+    void openUrl(const QUrl &url);
+    QString filePath() const;
+
+public slots:
+    void goToLine(qint64 line);
+    void goToOffset(qint64 offset);
+
+    void find();
+    void findRegularExpression();
+    void findNext();
+    void showGoToLine();
+    void setFollowing(bool follow);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+    struct LineIndex
+    {
+        std::vector<qint64> checkpoints; // offset of every LINE_INDEX_STRIDE'th line
+        qint64 lineCount = 0;
+
+        // The index is handed over while it is still being built, only the lines up to here are counted so far
+        qint64 indexedTo = 0;
+        bool complete = false;
+    };
+
+    struct SharedState;
+
+    bool isAvailable(qint64 offset, qint64 length) const;
+    void setTopOffset(qint64 offset);
+    void remoteFetched();
+    void remoteGrown(qint64 newSize);
+
+    qint64 lineStart(qint64 offset) const;
+    qint64 nextLineStart(qint64 offset) const;
+    qint64 lineNumberAt(qint64 offset) const;
+    qint64 offsetOfLine(qint64 line) const;
+
+    void scrollLines(qint64 lines);
+    int visibleLineCount() const;
+    void updateScrollBars();
+    void updateTitle();
+
+    void buildLineIndex();
+    void setLineIndex(std::shared_ptr<const LineIndex> index);
+    void searchFrom(qint64 offset);
+
+    std::shared_ptr<QFile> file;
+    std::shared_ptr<RemoteFile> remote;
+    const char *data = Q_NULLPTR;
+    qint64 size = 0;
+
+    qint64 topOffset = 0;
+    qint64 matchStart = -1;
+    qint64 matchEnd = -1;
+    QByteArray searchText;
+    int searchFlags = SCFIND_MATCHCASE;
+    int maxLineWidth = 0;
+    bool settingScrollBar = false;
+    bool topNeedsLineStart = false; // the text before it wasn't fetched yet so the line it is on wasn't known
+    bool showingEnd = false;
+
+    std::shared_ptr<const LineIndex> lineIndex;
+    int indexProgress = 0;
+    qint64 pendingLine = -1;
+    bool searching = false;
+
+    std::shared_ptr<SharedState> state;
+};
@@ -0,0 +1,144 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "MinimapView.h"
+#include "MinimapTiles.h"
+#include "ScintillaNext.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+
+
+const int PIXELS_PER_LINE = 2;
+
+MinimapView::MinimapView(QWidget *parent) :
+    QWidget(parent)
+{
+    setMinimumWidth(MinimapTiles::COLUMNS / 2);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void MinimapView::setEditor(ScintillaNext *editor)
+{
+    if (editor == this->editor)
+        return;
+
+    if (this->editor) {
+        disconnect(this->editor, Q_NULLPTR, this, Q_NULLPTR);
+    }
+    if (tiles) {
+        disconnect(tiles, Q_NULLPTR, this, Q_NULLPTR);
+        tiles->setActive(false);
+    }
+
+    this->editor = editor;
+    tiles = editor ? MinimapTiles::forEditor(editor) : Q_NULLPTR;
+
+    if (editor) {
+        // Scrolling, typing and resizing all come with an update
+        connect(editor, &ScintillaNext::updateUi, this, [=]() { update(); });
+
+        connect(tiles, &MinimapTiles::tilesInvalidated, this, [=]() { update(); });
+        connect(tiles, &MinimapTiles::tileReady, this, [=]() { update(); });
+        tiles->setActive(true);
+    }
+
+    update();
+}
+
+int MinimapView::topLine() const
+{
+    const int lineCount = static_cast<int>(editor->lineCount());
+    const int minimapLines = height() / PIXELS_PER_LINE;
+
+    if (lineCount <= minimapLines)
+        return 0;
+
+    // Move through the document at the same rate as the editor, so both reach the end together
+    const int firstLine = static_cast<int>(editor->docLineFromVisible(editor->firstVisibleLine()));
+    const int scrollableLines = qMax(1, lineCount - static_cast<int>(editor->linesOnScreen()));
+
+    return qBound(0, static_cast<int>(static_cast<qint64>(firstLine) * (lineCount - minimapLines) / scrollableLines), lineCount - minimapLines);
+}
+
+void MinimapView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+
+    if (!editor) {
+        painter.fillRect(rect(), palette().window());
+        return;
+    }
+
+    const sptr_t back = editor->styleBack(STYLE_DEFAULT);
+    const QColor background(back & 0xFF, (back >> 8) & 0xFF, (back >> 16) & 0xFF);
+    painter.fillRect(rect(), background);
+
+    const int lineCount = static_cast<int>(editor->lineCount());
+    const int top = topLine();
+    const int bottom = qMin(lineCount, top + height() / PIXELS_PER_LINE + 1);
+    const int scaledWidth = qMin(width(), MinimapTiles::COLUMNS);
+
+    for (int index = top / MinimapTiles::TILE_LINES; index * MinimapTiles::TILE_LINES < bottom; ++index) {
+        const QImage image = tiles->tile(index);
+
+        if (!image.isNull()) {
+            const int y = (index * MinimapTiles::TILE_LINES - top) * PIXELS_PER_LINE;
+            painter.drawImage(QRect(0, y, scaledWidth, MinimapTiles::TILE_LINES * PIXELS_PER_LINE), image, QRect(0, 0, scaledWidth, MinimapTiles::TILE_LINES));
+        }
+    }
+
+    // Lines past the end may be left over in the last tile from before they were deleted
+    const int endY = (lineCount - top) * PIXELS_PER_LINE;
+    if (endY < height()) {
+        painter.fillRect(0, endY, width(), height() - endY, background);
+    }
+
+    // The lines on screen, which folds and wrapping can make more or less than the editor's height in lines
+    const int firstLine = static_cast<int>(editor->docLineFromVisible(editor->firstVisibleLine()));
+    const int lastLine = static_cast<int>(editor->docLineFromVisible(editor->firstVisibleLine() + editor->linesOnScreen()));
+    painter.fillRect(0, (firstLine - top) * PIXELS_PER_LINE, width(), qMax(1, lastLine - firstLine) * PIXELS_PER_LINE, QColor(128, 128, 128, 60));
+}
+
+void MinimapView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        scrollEditorTo(event->pos().y());
+    }
+}
+
+void MinimapView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton) {
+        scrollEditorTo(event->pos().y());
+    }
+}
+
+void MinimapView::scrollEditorTo(int y)
+{
+    if (!editor)
+        return;
+
+    const int line = qBound(0, topLine() + y / PIXELS_PER_LINE, static_cast<int>(editor->lineCount()) - 1);
+
+    // With the line in the middle of the screen
+    editor->setFirstVisibleLine(qMax<sptr_t>(0, editor->visibleFromDocLine(line) - editor->linesOnScreen() / 2));
+}
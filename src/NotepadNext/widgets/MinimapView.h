@@ -0,0 +1,55 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MINIMAPVIEW_H
+#define MINIMAPVIEW_H
+
+#include <QPointer>
+#include <QWidget>
+
+class MinimapTiles;
+class ScintillaNext;
+
+
+// Draws the MinimapTiles of an editor two pixels per line, with the lines on screen shaded. It scrolls along with
+// the editor, and clicking or dragging in it scrolls the editor to that line.
+class MinimapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MinimapView(QWidget *parent = Q_NULLPTR);
+
+    void setEditor(ScintillaNext *editor);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    // The first line of the document at the top of the minimap
+    int topLine() const;
+    void scrollEditorTo(int y);
+
+    QPointer<ScintillaNext> editor;
+    QPointer<MinimapTiles> tiles;
+};
+
+#endif // MINIMAPVIEW_H
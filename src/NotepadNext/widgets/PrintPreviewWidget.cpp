@@ -0,0 +1,207 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "PrintPreviewWidget.h"
+#include "EditorPrintPreviewRenderer.h"
+
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+
+// Space around each page in device independent pixels
+static const int PAGE_SPACING = 16;
+
+// Number of rendered pages kept around for scrolling back and forth
+static const int MAX_CACHED_PAGES = 12;
+
+static const qreal MIN_ZOOM = 0.25;
+static const qreal MAX_ZOOM = 4.0;
+
+
+PrintPreviewWidget::PrintPreviewWidget(EditorPrintPreviewRenderer *renderer, QWidget *parent) :
+    QAbstractScrollArea(parent),
+    renderer(renderer)
+{
+    viewport()->setBackgroundRole(QPalette::Dark);
+    viewport()->setAutoFillBackground(true);
+
+    // New pages only make the document longer, the ones already rendered stay valid
+    connect(renderer, &EditorPrintPreviewRenderer::pageCountChanged, this, [=]() {
+        updateScrollBars();
+        viewport()->update();
+    });
+}
+
+int PrintPreviewWidget::currentPage() const
+{
+    return qBound(0, (verticalScrollBar()->value() + viewport()->height() / 3) / pageStride(), renderer->pageCount() - 1);
+}
+
+void PrintPreviewWidget::setZoom(qreal zoom)
+{
+    zoom = qBound(MIN_ZOOM, zoom, MAX_ZOOM);
+
+    if (qFuzzyCompare(zoom, zoomFactor)) {
+        return;
+    }
+
+    const int page = currentPage();
+
+    zoomFactor = zoom;
+    refresh();
+    goToPage(page);
+}
+
+void PrintPreviewWidget::zoomIn()
+{
+    setZoom(zoomFactor * 1.25);
+}
+
+void PrintPreviewWidget::zoomOut()
+{
+    setZoom(zoomFactor / 1.25);
+}
+
+void PrintPreviewWidget::goToPage(int page)
+{
+    verticalScrollBar()->setValue(page * pageStride());
+}
+
+void PrintPreviewWidget::refresh()
+{
+    pages.clear();
+    recentPages.clear();
+
+    updateScrollBars();
+    viewport()->update();
+}
+
+void PrintPreviewWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(viewport());
+
+    const QSize size = pageSize();
+    const int stride = pageStride();
+    const int top = verticalScrollBar()->value();
+    const int x = qMax(PAGE_SPACING, (viewport()->width() - size.width()) / 2) - horizontalScrollBar()->value();
+
+    for (int page = top / stride; page < renderer->pageCount(); ++page) {
+        const int y = page * stride + PAGE_SPACING - top;
+
+        if (y >= viewport()->height()) {
+            break;
+        }
+
+        const QRect pageRect(QPoint(x, y), size);
+        painter.drawImage(pageRect, pageImage(page));
+        painter.setPen(palette().color(QPalette::Shadow));
+        painter.drawRect(pageRect.adjusted(-1, -1, 0, 0));
+    }
+}
+
+void PrintPreviewWidget::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    updateScrollBars();
+}
+
+void PrintPreviewWidget::wheelEvent(QWheelEvent *event)
+{
+    if (event->modifiers() & Qt::ControlModifier) {
+        if (event->angleDelta().y() > 0) {
+            zoomIn();
+        }
+        else if (event->angleDelta().y() < 0) {
+            zoomOut();
+        }
+
+        event->accept();
+        return;
+    }
+
+    QAbstractScrollArea::wheelEvent(event);
+}
+
+void PrintPreviewWidget::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+
+    viewport()->update();
+
+    const int page = currentPage();
+    if (page != lastCurrentPage) {
+        lastCurrentPage = page;
+        emit currentPageChanged(page);
+    }
+}
+
+QSize PrintPreviewWidget::pageSize() const
+{
+    return (renderer->paperSize() * logicalDpiY() * zoomFactor).toSize();
+}
+
+int PrintPreviewWidget::pageStride() const
+{
+    return qMax(1, pageSize().height() + PAGE_SPACING);
+}
+
+QImage PrintPreviewWidget::pageImage(int page)
+{
+    auto it = pages.constFind(page);
+
+    if (it != pages.constEnd()) {
+        recentPages.removeOne(page);
+        recentPages.append(page);
+        return it.value();
+    }
+
+    // Render at the screen's real resolution so text stays sharp on high DPI displays
+    const qreal ratio = devicePixelRatioF();
+    QImage image = renderer->renderPage(page, logicalDpiY() * zoomFactor * ratio);
+    image.setDevicePixelRatio(ratio);
+
+    if (recentPages.size() >= MAX_CACHED_PAGES) {
+        pages.remove(recentPages.takeFirst());
+    }
+
+    pages.insert(page, image);
+    recentPages.append(page);
+
+    return image;
+}
+
+void PrintPreviewWidget::updateScrollBars()
+{
+    const QSize size = pageSize();
+    const int height = renderer->pageCount() * pageStride() + PAGE_SPACING;
+    const int width = size.width() + 2 * PAGE_SPACING;
+
+    verticalScrollBar()->setRange(0, qMax(0, height - viewport()->height()));
+    verticalScrollBar()->setPageStep(viewport()->height());
+    verticalScrollBar()->setSingleStep(qMax(1, size.height() / 20));
+
+    horizontalScrollBar()->setRange(0, qMax(0, width - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(qMax(1, size.width() / 20));
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2020 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QImage>
+#include <QList>
+
+class EditorPrintPreviewRenderer;
+
+
+// Shows the pages of an EditorPrintPreviewRenderer one below the other. Only the pages scrolled into view are
+// rendered, and only the few most recently shown are kept, so the cost does not depend on the length of the document.
+class PrintPreviewWidget : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit PrintPreviewWidget(EditorPrintPreviewRenderer *renderer, QWidget *parent = nullptr);
+
+    qreal zoom() const { return zoomFactor; }
+    int currentPage() const;
+
+public slots:
+    void setZoom(qreal zoom);
+    void zoomIn();
+    void zoomOut();
+    void goToPage(int page);
+
+    // Throws away the rendered pages, e.g. after the page layout changed
+    void refresh();
+
+signals:
+    void currentPageChanged(int page);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    QSize pageSize() const;
+    int pageStride() const;
+    QImage pageImage(int page);
+    void updateScrollBars();
+
+    EditorPrintPreviewRenderer *renderer;
+    qreal zoomFactor = 1.0;
+    int lastCurrentPage = -1;
+
+    QHash<int, QImage> pages;
+    QList<int> recentPages;
+};
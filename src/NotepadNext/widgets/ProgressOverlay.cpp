@@ -0,0 +1,181 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ProgressOverlay.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPainter>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+
+// Anything quicker than this is over before the overlay would be any use
+static const int SHOW_DELAY_MS = 500;
+
+// The numbers are only worked out again this often, otherwise they jump around too much to read
+static const int STATISTICS_INTERVAL_MS = 250;
+
+static QString formatDuration(qint64 seconds)
+{
+    if (seconds >= 3600) {
+        return QStringLiteral("%1:%2:%3").arg(seconds / 3600).arg((seconds / 60) % 60, 2, 10, QLatin1Char('0')).arg(seconds % 60, 2, 10, QLatin1Char('0'));
+    }
+
+    return QStringLiteral("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QLatin1Char('0'));
+}
+
+ProgressOverlay::ProgressOverlay(QWidget *parent, const QString &title, qint64 total, Unit unit) :
+    QWidget(parent),
+    titleLabel(new QLabel(title)),
+    progressBar(new QProgressBar()),
+    statisticsLabel(new QLabel()),
+    total(total),
+    unit(unit)
+{
+    Q_ASSERT(parent != Q_NULLPTR);
+
+    // The text is drawn in the window colour over a box of the text colour, the same as the FadingIndicator
+    QPalette pal = palette();
+    pal.setColor(QPalette::WindowText, palette().color(QPalette::Window));
+    titleLabel->setPalette(pal);
+    statisticsLabel->setPalette(pal);
+
+    progressBar->setRange(0, 1000);
+    progressBar->setTextVisible(false);
+    progressBar->setFixedWidth(240);
+
+    QPushButton *cancelButton = new QPushButton(tr("Cancel"));
+    connect(cancelButton, &QPushButton::clicked, this, [=]() {
+        canceled = true;
+        statisticsLabel->setText(tr("Canceling..."));
+
+        JobScheduler::instance()->cancel(this);
+        emit canceledByUser();
+    });
+
+    QHBoxLayout *row = new QHBoxLayout();
+    row->addWidget(progressBar);
+    row->addWidget(cancelButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(12, 8, 12, 8);
+    layout->setSizeConstraint(QLayout::SetFixedSize);
+    layout->addWidget(titleLabel);
+    layout->addLayout(row);
+    layout->addWidget(statisticsLabel);
+
+    parent->installEventFilter(this);
+    elapsed.start();
+
+    hide();
+    QTimer::singleShot(SHOW_DELAY_MS, this, [=]() {
+        updateStatistics();
+        updatePosition();
+        show();
+        raise();
+    });
+}
+
+void ProgressOverlay::setProgress(qint64 value)
+{
+    done = value;
+
+    if (total > 0) {
+        progressBar->setValue(static_cast<int>(qBound<qint64>(0, done * 1000 / total, 1000)));
+    }
+
+    if (isVisible() && !canceled && elapsed.elapsed() - lastStatisticsUpdate >= STATISTICS_INTERVAL_MS) {
+        updateStatistics();
+    }
+}
+
+void ProgressOverlay::finish()
+{
+    // Anything still running for it has nothing left to report to
+    JobScheduler::instance()->cancel(this);
+
+    hide();
+    deleteLater();
+}
+
+bool ProgressOverlay::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == parentWidget() && event->type() == QEvent::Resize) {
+        updatePosition();
+    }
+
+    return QWidget::eventFilter(obj, event);
+}
+
+void ProgressOverlay::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+
+    QColor background = palette().color(QPalette::WindowText);
+    background.setAlphaF(0.8);
+
+    p.setBrush(background);
+    p.setPen(Qt::NoPen);
+    p.drawRoundedRect(rect(), 10, 10);
+}
+
+void ProgressOverlay::updatePosition()
+{
+    adjustSize();
+
+    // Near the top so it doesn't cover the middle of the text, which is where the FadingIndicator goes
+    const QWidget *parent = parentWidget();
+    move((parent->width() - width()) / 2, parent->height() / 8);
+}
+
+void ProgressOverlay::updateStatistics()
+{
+    const qint64 msecs = elapsed.elapsed();
+    lastStatisticsUpdate = msecs;
+
+    if (msecs <= 0 || done <= 0) {
+        statisticsLabel->setText(tr("Starting..."));
+        return;
+    }
+
+    const double perSecond = done * 1000.0 / msecs;
+
+    QString rate;
+    if (unit == Bytes) {
+        rate = tr("%1 MB/s").arg(perSecond / (1024 * 1024), 0, 'f', 1);
+    }
+    else {
+        rate = tr("%1/s").arg(qRound64(perSecond));
+    }
+
+    if (total > 0 && done < total && perSecond > 0) {
+        const qint64 remaining = static_cast<qint64>((total - done) / perSecond);
+        statisticsLabel->setText(tr("%1, about %2 left").arg(rate, formatDuration(remaining)));
+    }
+    else {
+        statisticsLabel->setText(rate);
+    }
+}
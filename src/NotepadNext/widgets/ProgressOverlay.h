@@ -0,0 +1,83 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PROGRESSOVERLAY_H
+#define PROGRESSOVERLAY_H
+
+#include <QElapsedTimer>
+#include <QWidget>
+
+#include "JobScheduler.h"
+
+class QLabel;
+class QProgressBar;
+
+
+// Shown over an editor while something long runs on it, in the same style as the FadingIndicator. It gives how far
+// along it is, how fast it is going, about how long is left and a way to cancel it. It only appears once the work
+// has taken long enough to be worth showing, so quick ones never flash it up.
+//
+// The overlay owns a cancellation token in the JobScheduler: jobs started with JobScheduler::run() with the overlay
+// as their owner see it canceled when the button is pressed, or the overlay is closed.
+class ProgressOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum Unit {
+        Bytes, // shown as MB/s
+        Items, // shown as a count per second, e.g. matches
+    };
+
+    ProgressOverlay(QWidget *parent, const QString &title, qint64 total, Unit unit = Bytes);
+
+    JobScheduler::CancelToken cancelToken() { return JobScheduler::instance()->cancelToken(this); }
+    bool wasCanceled() const { return canceled; }
+
+public slots:
+    void setProgress(qint64 done);
+
+    // Deletes the overlay
+    void finish();
+
+signals:
+    void canceledByUser();
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    void updatePosition();
+    void updateStatistics();
+
+    QLabel *titleLabel;
+    QProgressBar *progressBar;
+    QLabel *statisticsLabel;
+
+    const qint64 total;
+    const Unit unit;
+    qint64 done = 0;
+    bool canceled = false;
+
+    QElapsedTimer elapsed;
+    qint64 lastStatisticsUpdate = -1;
+};
+
+#endif // PROGRESSOVERLAY_H
@@ -0,0 +1,150 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TabListMenu.h"
+
+#include "DockAreaWidget.h"
+#include "DockWidget.h"
+#include "DockWidgetTab.h"
+
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+#include <QWidgetAction>
+
+
+// How many rows are shown before the list starts to scroll
+static const int VISIBLE_ROWS = 20;
+
+TabListMenu::TabListMenu(ads::CDockAreaWidget *dockArea, QWidget *parent) :
+    QMenu(parent),
+    dockArea(dockArea),
+    filter(new QLineEdit()),
+    list(new QListWidget())
+{
+    filter->setPlaceholderText(tr("Filter"));
+    filter->setClearButtonEnabled(true);
+    filter->installEventFilter(this);
+
+    // Every row is the same height so only the ones on screen ever get laid out
+    list->setUniformItemSizes(true);
+    list->setMinimumWidth(300);
+    list->setFrameShape(QFrame::NoFrame);
+
+    QWidget *container = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(container);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->addWidget(filter);
+    layout->addWidget(list);
+
+    QWidgetAction *action = new QWidgetAction(this);
+    action->setDefaultWidget(container);
+    addAction(action);
+
+    connect(this, &QMenu::aboutToShow, this, &TabListMenu::populate);
+    connect(filter, &QLineEdit::textChanged, this, &TabListMenu::applyFilter);
+    connect(filter, &QLineEdit::returnPressed, this, [=]() { activateItem(list->currentItem()); });
+    connect(list, &QListWidget::itemClicked, this, &TabListMenu::activateItem);
+    connect(list, &QListWidget::itemActivated, this, &TabListMenu::activateItem);
+}
+
+bool TabListMenu::eventFilter(QObject *obj, QEvent *event)
+{
+    // Moving through the list shouldn't mean having to leave the filter
+    if (obj == filter && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QCoreApplication::sendEvent(list, event);
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return QMenu::eventFilter(obj, event);
+}
+
+void TabListMenu::populate()
+{
+    list->clear();
+
+    for (int i = 0; i < dockArea->dockWidgetsCount(); ++i) {
+        const ads::CDockWidget *dockWidget = dockArea->dockWidget(i);
+
+        if (dockWidget->isClosed()) {
+            continue;
+        }
+
+        QListWidgetItem *item = new QListWidgetItem(dockWidget->tabWidget()->icon(), dockWidget->windowTitle(), list);
+        item->setToolTip(dockWidget->tabWidget()->toolTip());
+        item->setData(Qt::UserRole, i);
+
+        if (i == dockArea->currentIndex()) {
+            list->setCurrentItem(item);
+        }
+    }
+
+    const int rows = qBound(1, list->count(), VISIBLE_ROWS);
+    list->setFixedHeight(rows * qMax(1, list->sizeHintForRow(0)) + 2 * list->frameWidth());
+
+    filter->clear();
+    filter->setFocus();
+}
+
+void TabListMenu::applyFilter(const QString &text)
+{
+    QListWidgetItem *firstShown = Q_NULLPTR;
+
+    for (int i = 0; i < list->count(); ++i) {
+        QListWidgetItem *item = list->item(i);
+        const bool shown = text.isEmpty() || item->text().contains(text, Qt::CaseInsensitive);
+
+        item->setHidden(!shown);
+
+        if (shown && firstShown == Q_NULLPTR) {
+            firstShown = item;
+        }
+    }
+
+    if (list->currentItem() == Q_NULLPTR || list->currentItem()->isHidden()) {
+        list->setCurrentItem(firstShown);
+    }
+}
+
+void TabListMenu::activateItem(QListWidgetItem *item)
+{
+    if (item == Q_NULLPTR || item->isHidden()) {
+        return;
+    }
+
+    ads::CDockWidget *dockWidget = dockArea->dockWidget(item->data(Qt::UserRole).toInt());
+
+    close();
+
+    if (dockWidget) {
+        dockWidget->raise();
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TABLISTMENU_H
+#define TABLISTMENU_H
+
+#include <QMenu>
+
+class QLineEdit;
+class QListWidget;
+class QListWidgetItem;
+
+namespace ads {
+class CDockAreaWidget;
+}
+
+
+// Replaces the dock area's list of tabs, which is one menu entry per tab and so is no use with hundreds of them, with
+// a list that scrolls and can be filtered by typing
+class TabListMenu : public QMenu
+{
+    Q_OBJECT
+
+public:
+    explicit TabListMenu(ads::CDockAreaWidget *dockArea, QWidget *parent = Q_NULLPTR);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+
+private slots:
+    void populate();
+    void applyFilter(const QString &text);
+    void activateItem(QListWidgetItem *item);
+
+private:
+    ads::CDockAreaWidget *dockArea;
+    QLineEdit *filter;
+    QListWidget *list;
+};
+
+#endif // TABLISTMENU_H
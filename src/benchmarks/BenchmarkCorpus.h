@@ -0,0 +1,48 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BENCHMARKCORPUS_H
+#define BENCHMARKCORPUS_H
+
+#include <QDir>
+#include <QFileInfo>
+#include <QString>
+
+
+// Where GeneratePerfCorpus wrote its files when the benchmarks were built. NN_PERF_CORPUS points them somewhere
+// else, e.g. at a corpus generated at a bigger scale.
+inline QString corpusFile(const QString &name)
+{
+    QString directory = qEnvironmentVariable("NN_PERF_CORPUS");
+
+    if (directory.isEmpty()) {
+        directory = QStringLiteral(PERF_CORPUS_DIR);
+    }
+
+    return QDir(directory).filePath(name);
+}
+
+// Skips the current benchmark if the file isn't there rather than failing it
+#define REQUIRE_CORPUS_FILE(path) \
+    do { \
+        if (!QFileInfo::exists(path)) \
+            QSKIP(qPrintable(QStringLiteral("%1 has not been generated").arg(path))); \
+    } while (false)
+
+#endif // BENCHMARKCORPUS_H
@@ -0,0 +1,293 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditorBenchmarks.h"
+#include "BenchmarkCorpus.h"
+#include "TestEnvironment.h"
+
+#include "Finder.h"
+#include "HtmlConverter.h"
+#include "JobScheduler.h"
+#include "Macro.h"
+#include "ScintillaNext.h"
+#include "SmartHighlighter.h"
+
+#include <QBuffer>
+#include <QtTest>
+
+using namespace Scintilla;
+
+
+// Files the readFromDisk benchmark opens, between them they cover every encoding the corpus is written in
+static const char *const READ_FILES[] = {
+    "minified.js",
+    "big.csv",
+    "mixed_eol.log",
+    "utf16le_bom.log",
+    "shift_jis.txt",
+    "nested.json",
+};
+
+// What each search benchmark looks for, where, and how
+static void addSearchRows()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("flags");
+    QTest::addColumn<QString>("replacement");
+
+    QTest::newRow("literal") << "mixed_eol.log" << "error" << 0 << "failure";
+    QTest::newRow("literal match case") << "mixed_eol.log" << "ERROR" << int(SCFIND_MATCHCASE) << "FAILURE";
+    QTest::newRow("literal whole word") << "big.csv" << "true" << int(SCFIND_WHOLEWORD) << "yes";
+    QTest::newRow("regex") << "big.csv" << "[0-9]+\\.[0-9]{4}" << int(SCFIND_REGEXP) << "0.0";
+    QTest::newRow("regex long line") << "minified.js" << "return \"[a-z]+\"" << int(SCFIND_REGEXP) << "return \"\"";
+}
+
+static ScintillaNext *openCorpusFile(const QString &name)
+{
+    ScintillaNext *editor = TestEnvironment::instance()->openFile(corpusFile(name));
+    Q_ASSERT(editor != Q_NULLPTR);
+
+    return editor;
+}
+
+static void sendUpdateUI(SmartHighlighter *highlighter, Update updated)
+{
+    NotificationData scn{};
+    scn.nmhdr.code = Notification::UpdateUI;
+    scn.updated = updated;
+
+    highlighter->notify(&scn);
+}
+
+void EditorBenchmarks::cleanup()
+{
+    TestEnvironment::instance()->closeAllEditors();
+}
+
+void EditorBenchmarks::readFromDisk_data()
+{
+    QTest::addColumn<QString>("file");
+
+    for (const char *name : READ_FILES) {
+        QTest::newRow(name) << QString::fromLatin1(name);
+    }
+}
+
+void EditorBenchmarks::readFromDisk()
+{
+    QFETCH(QString, file);
+
+    const QString path = corpusFile(file);
+    REQUIRE_CORPUS_FILE(path);
+
+    // Straight into an editor of its own, so nothing else the application does with a new editor is measured
+    QBENCHMARK {
+        ScintillaNext *editor = ScintillaNext::fromFile(path);
+        QVERIFY(editor != Q_NULLPTR);
+        delete editor;
+    }
+}
+
+void EditorBenchmarks::finderCount_data()
+{
+    addSearchRows();
+}
+
+void EditorBenchmarks::finderCount()
+{
+    QFETCH(QString, file);
+    QFETCH(QString, text);
+    QFETCH(int, flags);
+
+    REQUIRE_CORPUS_FILE(corpusFile(file));
+
+    ScintillaNext *editor = openCorpusFile(file);
+    Finder finder(editor);
+    finder.setSearchFlags(flags);
+    finder.setSearchText(text);
+
+    int count = 0;
+    QBENCHMARK {
+        count = finder.count();
+    }
+
+    QVERIFY(count > 0);
+}
+
+void EditorBenchmarks::finderReplaceAll_data()
+{
+    addSearchRows();
+}
+
+void EditorBenchmarks::finderReplaceAll()
+{
+    QFETCH(QString, file);
+    QFETCH(QString, text);
+    QFETCH(int, flags);
+    QFETCH(QString, replacement);
+
+    REQUIRE_CORPUS_FILE(corpusFile(file));
+
+    ScintillaNext *editor = openCorpusFile(file);
+    Finder finder(editor);
+    finder.setSearchFlags(flags);
+    finder.setSearchText(text);
+
+    // Replacing changes what there is to replace, so it can only be timed the once on each document
+    int replaced = 0;
+    QBENCHMARK_ONCE {
+        replaced = finder.replaceAll(replacement);
+    }
+
+    QVERIFY(replaced > 0);
+}
+
+void EditorBenchmarks::forEachMatchInRange_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<int>("flags");
+
+    QTest::newRow("common word") << "mixed_eol.log" << QByteArray("value") << 0;
+    QTest::newRow("every line") << "big.csv" << QByteArray(",") << int(SCFIND_MATCHCASE);
+    QTest::newRow("regex") << "mixed_eol.log" << QByteArray("\\[[A-Z]+\\]") << int(SCFIND_REGEXP);
+}
+
+void EditorBenchmarks::forEachMatchInRange()
+{
+    QFETCH(QString, file);
+    QFETCH(QByteArray, text);
+    QFETCH(int, flags);
+
+    REQUIRE_CORPUS_FILE(corpusFile(file));
+
+    ScintillaNext *editor = openCorpusFile(file);
+    editor->setSearchFlags(flags);
+
+    const Sci_CharacterRange range = {0, static_cast<Sci_PositionCR>(editor->length())};
+    int matches = 0;
+
+    QBENCHMARK {
+        matches = 0;
+        editor->forEachMatchInRange(text, [&](int start, int end) {
+            Q_UNUSED(start);
+            ++matches;
+            return end;
+        }, range);
+    }
+
+    QVERIFY(matches > 0);
+}
+
+void EditorBenchmarks::smartHighlighter_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<QString>("word");
+
+    QTest::newRow("log") << "mixed_eol.log" << "buffer";
+    QTest::newRow("csv") << "big.csv" << "sigma";
+}
+
+void EditorBenchmarks::smartHighlighter()
+{
+    QFETCH(QString, file);
+    QFETCH(QString, word);
+
+    REQUIRE_CORPUS_FILE(corpusFile(file));
+
+    ScintillaNext *editor = openCorpusFile(file);
+    SmartHighlighter *highlighter = editor->findChild<SmartHighlighter *>(QString(), Qt::FindDirectChildrenOnly);
+    QVERIFY(highlighter != Q_NULLPTR);
+
+    Finder finder(editor);
+    finder.setSearchFlags(SCFIND_WHOLEWORD | SCFIND_MATCHCASE);
+    finder.setSearchText(word);
+
+    const Sci_CharacterRange found = finder.findNext(0);
+    QVERIFY(found.cpMin != INVALID_POSITION);
+
+    // Selecting the word straight from nothing selected, then everything it does in the background until the whole
+    // document was searched
+    QBENCHMARK {
+        editor->setEmptySelection(0);
+        sendUpdateUI(highlighter, Update::Selection);
+
+        editor->setSel(found.cpMin, found.cpMax);
+        sendUpdateUI(highlighter, Update::Selection);
+
+        while (JobScheduler::instance()->isScheduled(highlighter)) {
+            QCoreApplication::processEvents();
+        }
+    }
+}
+
+void EditorBenchmarks::htmlConverter_data()
+{
+    QTest::addColumn<QString>("file");
+
+    QTest::newRow("json") << "nested.json";
+    QTest::newRow("javascript") << "minified.js";
+    QTest::newRow("log") << "mixed_eol.log";
+}
+
+void EditorBenchmarks::htmlConverter()
+{
+    QFETCH(QString, file);
+
+    REQUIRE_CORPUS_FILE(corpusFile(file));
+
+    ScintillaNext *editor = openCorpusFile(file);
+    HtmlConverter converter(editor);
+
+    // Styling the document is only done the first time, so that is left out of what is measured
+    editor->colourise(0, -1);
+
+    qint64 written = 0;
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+
+        QVERIFY(converter.exportRange(&buffer, 0, editor->length()));
+        written = buffer.size();
+    }
+
+    QVERIFY(written > editor->length());
+}
+
+void EditorBenchmarks::macroReplay()
+{
+    const QString path = corpusFile(QStringLiteral("mixed_eol.log"));
+    REQUIRE_CORPUS_FILE(path);
+
+    ScintillaNext *editor = openCorpusFile(QStringLiteral("mixed_eol.log"));
+
+    // Quoting each line, the sort of thing a macro is recorded for
+    Macro macro;
+    macro.addMacroStep(Message::Home, 0, 0);
+    macro.addMacroStep(Message::ReplaceSel, 0, reinterpret_cast<sptr_t>("> "));
+    macro.addMacroStep(Message::LineDown, 0, 0);
+
+    const int lines = qMin(10000, static_cast<int>(editor->lineCount()));
+
+    QBENCHMARK {
+        editor->gotoPos(0);
+        macro.replay(editor, lines);
+    }
+}
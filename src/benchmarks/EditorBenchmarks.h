@@ -0,0 +1,55 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EDITORBENCHMARKS_H
+#define EDITORBENCHMARKS_H
+
+#include <QObject>
+
+
+// The editing operations that have to keep up with large files, run on editors opened the same way the user opens them
+class EditorBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void readFromDisk_data();
+    void readFromDisk();
+
+    void finderCount_data();
+    void finderCount();
+
+    void finderReplaceAll_data();
+    void finderReplaceAll();
+
+    void forEachMatchInRange_data();
+    void forEachMatchInRange();
+
+    void smartHighlighter_data();
+    void smartHighlighter();
+
+    void htmlConverter_data();
+    void htmlConverter();
+
+    void macroReplay();
+};
+
+#endif // EDITORBENCHMARKS_H
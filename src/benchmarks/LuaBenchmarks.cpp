@@ -0,0 +1,86 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "LuaBenchmarks.h"
+#include "TestEnvironment.h"
+
+#include "LuaExtension.h"
+#include "LuaState.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+
+#include <QtTest>
+
+
+// Each benchmark iteration is one script doing this many accesses, so the time is mostly the accesses themselves
+static const int ACCESSES = 100000;
+
+static LuaState *luaState()
+{
+    return TestEnvironment::instance()->app()->getLuaState();
+}
+
+void LuaBenchmarks::init()
+{
+    ScintillaNext *editor = TestEnvironment::instance()->newEditor(QByteArrayLiteral("alpha beta gamma\ndelta epsilon\n"));
+
+    LuaExtension::Instance().setEditor(editor);
+
+    // Upvalue 2 of the pane's __index is its name cache, see resolve_pane_name() in LuaExtension.cpp
+    luaState()->execute("benchmarkPaneCache = select(2, debug.getupvalue(getmetatable(editor).__index, 2))");
+    luaState()->execute("benchmarkTable = {CurrentPos = 0}");
+}
+
+void LuaBenchmarks::cleanup()
+{
+    luaState()->execute("debug.setupvalue(getmetatable(editor).__index, 2, benchmarkPaneCache) benchmarkPaneCache = nil benchmarkTable = nil");
+
+    LuaExtension::Instance().setEditor(Q_NULLPTR);
+    TestEnvironment::instance()->closeAllEditors();
+}
+
+void LuaBenchmarks::paneAccess_data()
+{
+    QTest::addColumn<QString>("statement");
+    QTest::addColumn<bool>("cached");
+
+    // The same loop reading a plain global table, to tell how much of the time is the loop itself
+    QTest::newRow("baseline") << "local p = benchmarkTable.CurrentPos" << true;
+
+    QTest::newRow("property") << "local p = editor.CurrentPos" << true;
+    QTest::newRow("property uncached") << "local p = editor.CurrentPos" << false;
+    QTest::newRow("function") << "local l = editor:LineFromPosition(0)" << true;
+    QTest::newRow("function uncached") << "local l = editor:LineFromPosition(0)" << false;
+}
+
+void LuaBenchmarks::paneAccess()
+{
+    QFETCH(QString, statement);
+    QFETCH(bool, cached);
+
+    // A fresh table keeps names resolved by earlier rows from counting, false turns the cache off altogether
+    luaState()->execute(cached ? "debug.setupvalue(getmetatable(editor).__index, 2, {})"
+                               : "debug.setupvalue(getmetatable(editor).__index, 2, false)");
+
+    const QByteArray script = QStringLiteral("for i = 1, %1 do %2 end").arg(ACCESSES).arg(statement).toUtf8();
+
+    QBENCHMARK {
+        luaState()->execute(script.constData());
+    }
+}
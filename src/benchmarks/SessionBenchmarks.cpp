@@ -0,0 +1,137 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "SessionBenchmarks.h"
+#include "BenchmarkCorpus.h"
+#include "TestEnvironment.h"
+
+#include "MainWindow.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+#include "SessionManager.h"
+
+#include <QDirIterator>
+#include <QtTest>
+
+
+// Files from the corpus tree and buffers that were never saved, each of which goes into the session differently
+static const int SESSION_FILES = 40;
+static const int SESSION_UNSAVED_BUFFERS = 10;
+
+void SessionBenchmarks::init()
+{
+    SessionManager *sessionManager = TestEnvironment::instance()->app()->getSessionManager();
+
+    sessionManager->setSessionFileTypes(SessionManager::SavedFile | SessionManager::UnsavedFile | SessionManager::TempFile);
+    sessionManager->clear();
+}
+
+void SessionBenchmarks::cleanup()
+{
+    TestEnvironment *environment = TestEnvironment::instance();
+
+    environment->closeAllEditors();
+    environment->app()->getSessionManager()->clear();
+}
+
+bool SessionBenchmarks::openSessionEditors()
+{
+    TestEnvironment *environment = TestEnvironment::instance();
+
+    QDirIterator it(corpusFile(QStringLiteral("tree")), QDir::Files, QDirIterator::Subdirectories);
+    for (int i = 0; i < SESSION_FILES && it.hasNext(); ++i) {
+        if (environment->openFile(it.next()) == Q_NULLPTR) {
+            return false;
+        }
+    }
+
+    QFile file(corpusFile(QStringLiteral("mixed_eol.log")));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray text = file.readAll();
+
+    for (int i = 0; i < SESSION_UNSAVED_BUFFERS; ++i) {
+        environment->newEditor(text);
+    }
+
+    return true;
+}
+
+void SessionBenchmarks::saveSession_data()
+{
+    QTest::addColumn<bool>("edited");
+
+    // Only the buffers that changed since the last time are written again
+    QTest::newRow("unchanged") << false;
+    QTest::newRow("edited") << true;
+}
+
+void SessionBenchmarks::saveSession()
+{
+    QFETCH(bool, edited);
+
+    REQUIRE_CORPUS_FILE(corpusFile(QStringLiteral("tree")));
+    REQUIRE_CORPUS_FILE(corpusFile(QStringLiteral("mixed_eol.log")));
+    QVERIFY(openSessionEditors());
+
+    TestEnvironment *environment = TestEnvironment::instance();
+    SessionManager *sessionManager = environment->app()->getSessionManager();
+    MainWindow *window = environment->window();
+
+    sessionManager->saveSession(window);
+
+    QBENCHMARK {
+        if (edited) {
+            for (ScintillaNext *editor : window->editors()) {
+                if (!editor->isFile()) {
+                    editor->appendText(1, "x");
+                }
+            }
+        }
+
+        sessionManager->saveSession(window);
+    }
+}
+
+void SessionBenchmarks::loadSession()
+{
+    REQUIRE_CORPUS_FILE(corpusFile(QStringLiteral("tree")));
+    REQUIRE_CORPUS_FILE(corpusFile(QStringLiteral("mixed_eol.log")));
+    QVERIFY(openSessionEditors());
+
+    TestEnvironment *environment = TestEnvironment::instance();
+    SessionManager *sessionManager = environment->app()->getSessionManager();
+    MainWindow *window = environment->window();
+
+    sessionManager->saveSession(window);
+
+    // As if the application was started again, everything is closed and then restored
+    QBENCHMARK {
+        environment->closeAllEditors();
+        sessionManager->loadSession(window);
+
+        for (ScintillaNext *editor : window->editors()) {
+            TestEnvironment::waitUntilLoaded(editor);
+        }
+    }
+
+    QVERIFY(window->editorCount() >= SESSION_FILES + SESSION_UNSAVED_BUFFERS);
+}
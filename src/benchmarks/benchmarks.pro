@@ -0,0 +1,59 @@
+# This file is part of Notepad Next.
+# Copyright 2024 Justin Dailey
+#
+# Notepad Next is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Notepad Next is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+
+# QtTest benchmarks of the editor core. They run on real editors inside a whole application that never shows
+# anything, see TestEnvironment. Build them with "CONFIG+=benchmarks" and run with "-json <file>" to get results
+# that can be compared between builds.
+
+TARGET = benchmarks
+
+TEMPLATE = app
+
+include(../testing/testing.pri)
+
+# The files the benchmarks run on. They are written by the GeneratePerfCorpus tool built alongside this, and only
+# again when the tool or the scale changes. "PERF_CORPUS_SCALE=1" writes the full sized files (several GB).
+# NN_PERF_CORPUS points the benchmarks at a corpus somewhere else at run time.
+isEmpty(PERF_CORPUS_DIR): PERF_CORPUS_DIR = $$OUT_PWD/corpus
+isEmpty(PERF_CORPUS_SCALE): PERF_CORPUS_SCALE = 0.01
+DEFINES += PERF_CORPUS_DIR='"\\\"$$PERF_CORPUS_DIR\\\""'
+
+PERF_CORPUS_TOOL = $$shell_path($$OUT_PWD/../GeneratePerfCorpus/GeneratePerfCorpus)
+win32: PERF_CORPUS_TOOL = $${PERF_CORPUS_TOOL}.exe
+PERF_CORPUS_STAMP = $$shell_path($$PERF_CORPUS_DIR/scale-$${PERF_CORPUS_SCALE}.stamp)
+
+perfcorpus.target = $$PERF_CORPUS_STAMP
+perfcorpus.commands = $$PERF_CORPUS_TOOL $$shell_path($$PERF_CORPUS_DIR) --scale $$PERF_CORPUS_SCALE --stamp $$PERF_CORPUS_STAMP
+perfcorpus.depends = $$PERF_CORPUS_TOOL
+QMAKE_EXTRA_TARGETS += perfcorpus
+PRE_TARGETDEPS += $$PERF_CORPUS_STAMP
+
+SOURCES += \
+    EditorBenchmarks.cpp \
+    LuaBenchmarks.cpp \
+    SessionBenchmarks.cpp \
+    main.cpp
+
+HEADERS += \
+    BenchmarkCorpus.h \
+    EditorBenchmarks.h \
+    LuaBenchmarks.h \
+    SessionBenchmarks.h
+
+OBJECTS_DIR = build/obj
+MOC_DIR = build/moc
+RCC_DIR = build/qrc
+UI_DIR = build/ui
@@ -0,0 +1,135 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EditorBenchmarks.h"
+#include "LuaBenchmarks.h"
+#include "SessionBenchmarks.h"
+#include "TestEnvironment.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QXmlStreamReader>
+#include <QtTest>
+
+#include <memory>
+#include <vector>
+
+
+// Picks the results out of QtTest's XML output, so they can be written as JSON and compared between builds
+static void readResults(const QString &xmlFile, QJsonArray &results)
+{
+    QFile file(xmlFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QXmlStreamReader xml(&file);
+    QString testCase;
+    QString testFunction;
+
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+
+        const QXmlStreamAttributes attributes = xml.attributes();
+
+        if (xml.name() == QLatin1String("TestCase")) {
+            testCase = attributes.value(QLatin1String("name")).toString();
+        }
+        else if (xml.name() == QLatin1String("TestFunction")) {
+            testFunction = attributes.value(QLatin1String("name")).toString();
+        }
+        else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            QJsonObject result;
+            result.insert(QStringLiteral("benchmark"), testCase + QStringLiteral("::") + testFunction);
+            result.insert(QStringLiteral("tag"), attributes.value(QLatin1String("tag")).toString());
+            result.insert(QStringLiteral("metric"), attributes.value(QLatin1String("metric")).toString());
+            result.insert(QStringLiteral("value"), attributes.value(QLatin1String("value")).toDouble());
+            result.insert(QStringLiteral("iterations"), attributes.value(QLatin1String("iterations")).toInt());
+            results.append(result);
+        }
+    }
+}
+
+// Takes "-json <file>" off the command line, everything else is for QtTest
+static QString takeJsonOption(QStringList &arguments)
+{
+    const int index = arguments.indexOf(QStringLiteral("-json"));
+
+    if (index == -1 || index + 1 >= arguments.size()) {
+        return QString();
+    }
+
+    const QString file = arguments.at(index + 1);
+    arguments.erase(arguments.begin() + index, arguments.begin() + index + 2);
+
+    return file;
+}
+
+int main(int argc, char *argv[])
+{
+    TestEnvironment environment(argc, argv);
+
+    QStringList arguments = environment.arguments();
+    const QString jsonFile = takeJsonOption(arguments);
+
+    std::vector<std::unique_ptr<QObject>> benchmarks;
+    benchmarks.emplace_back(new EditorBenchmarks);
+    benchmarks.emplace_back(new LuaBenchmarks);
+    benchmarks.emplace_back(new SessionBenchmarks);
+
+    int failures = 0;
+    QJsonArray results;
+
+    for (const std::unique_ptr<QObject> &benchmark : benchmarks) {
+        QStringList benchmarkArguments = arguments;
+        QString xmlFile;
+
+        if (!jsonFile.isEmpty()) {
+            xmlFile = environment.tempPath(QString::fromLatin1(benchmark->metaObject()->className()) + QStringLiteral(".xml"));
+            benchmarkArguments << QStringLiteral("-o") << xmlFile + QStringLiteral(",xml") << QStringLiteral("-o") << QStringLiteral("-,txt");
+        }
+
+        failures += QTest::qExec(benchmark.get(), benchmarkArguments);
+
+        if (!xmlFile.isEmpty()) {
+            readResults(xmlFile, results);
+        }
+    }
+
+    if (!jsonFile.isEmpty()) {
+        QJsonObject report;
+        report.insert(QStringLiteral("version"), QStringLiteral(APP_VERSION));
+        report.insert(QStringLiteral("qt"), QString::fromLatin1(qVersion()));
+        report.insert(QStringLiteral("cpu"), QSysInfo::currentCpuArchitecture());
+        report.insert(QStringLiteral("results"), results);
+
+        QFile file(jsonFile);
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(report).toJson()) == -1) {
+            qWarning("Could not write %s", qUtf8Printable(jsonFile));
+            return failures + 1;
+        }
+    }
+
+    return failures;
+}
@@ -10,9 +10,12 @@
 #include <cstring>
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "WordList.h"
 #include "CharacterSet.h"
@@ -72,10 +75,103 @@ bool cmpWords(const char *a, const char *b) noexcept {
 
 }
 
+namespace Lexilla {
+
+struct WordListData {
+	std::string text;	///< What the list was set to, after any lower casing. Also the key in the cache.
+	bool onlyLineEnds = false;
+	std::unique_ptr<char[]> list;
+	std::unique_ptr<char *[]> words;
+	size_t len = 0;
+	int starts[256];
+	size_t references = 0;	///< Guarded by the cache's mutex
+};
+
+}
+
+namespace {
+
+// Every distinct word list in use, by separator mode and then text. These are never destroyed
+// so lexers that outlive static destruction can still release their lists.
+std::mutex &CacheMutex() {
+	static std::mutex *mutex = new std::mutex();
+	return *mutex;
+}
+
+std::unordered_map<std::string_view, WordListData *> &Cache(bool onlyLineEnds) {
+	static auto *caches = new std::unordered_map<std::string_view, WordListData *>[2];
+	return caches[onlyLineEnds ? 1 : 0];
+}
+
+WordListData *ParseWordList(std::string &&text, bool onlyLineEnds) {
+	std::unique_ptr<WordListData> data = std::make_unique<WordListData>();
+	data->text = std::move(text);
+	data->onlyLineEnds = onlyLineEnds;
+
+	const size_t lenS = data->text.size() + 1;
+	data->list = std::make_unique<char[]>(lenS);
+	memcpy(data->list.get(), data->text.c_str(), lenS);
+	data->words = ArrayFromWordList(data->list.get(), lenS - 1, &data->len, onlyLineEnds);
+	std::sort(data->words.get(), data->words.get() + data->len, cmpWords);
+
+	std::fill(data->starts, std::end(data->starts), -1);
+	for (int l = static_cast<int>(data->len - 1); l >= 0; l--) {
+		unsigned char const indexChar = data->words[l][0];
+		data->starts[indexChar] = l;
+	}
+	return data.release();
+}
+
+// Returns the shared list for the text, parsing it only if nothing else is using it, with a reference taken
+WordListData *Acquire(std::string_view text, bool onlyLineEnds) {
+	{
+		std::lock_guard<std::mutex> guard(CacheMutex());
+		auto &cache = Cache(onlyLineEnds);
+		auto it = cache.find(text);
+		if (it != cache.end()) {
+			it->second->references++;
+			return it->second;
+		}
+	}
+
+	// Parse without holding the lock, if another thread got there first then use theirs
+	WordListData *parsed = ParseWordList(std::string(text), onlyLineEnds);
+
+	std::lock_guard<std::mutex> guard(CacheMutex());
+	auto inserted = Cache(onlyLineEnds).emplace(parsed->text, parsed);
+	if (!inserted.second) {
+		delete parsed;
+	}
+	inserted.first->second->references++;
+	return inserted.first->second;
+}
+
+void Release(WordListData *data) noexcept {
+	if (!data)
+		return;
+	std::lock_guard<std::mutex> guard(CacheMutex());
+	if (--data->references == 0) {
+		Cache(data->onlyLineEnds).erase(data->text);
+		delete data;
+	}
+}
+
+bool SameWords(const WordListData &a, const WordListData &b) noexcept {
+	if (&a == &b)
+		return true;
+	if (a.len != b.len)
+		return false;
+	for (size_t i = 0; i < a.len; i++) {
+		if (strcmp(a.words[i], b.words[i]) != 0)
+			return false;
+	}
+	return true;
+}
+
+}
+
 WordList::WordList(bool onlyLineEnds_) noexcept :
-	words(nullptr), list(nullptr), len(0), onlyLineEnds(onlyLineEnds_) {
-	// Prevent warnings by static analyzers about uninitialized starts.
-	starts[0] = -1;
+	data(nullptr), words(nullptr), len(0), onlyLineEnds(onlyLineEnds_), starts(nullptr) {
 }
 
 WordList::~WordList() {
@@ -87,13 +183,9 @@ WordList::operator bool() const noexcept {
 }
 
 bool WordList::operator!=(const WordList &other) const noexcept {
-	if (len != other.len)
-		return true;
-	for (size_t i=0; i<len; i++) {
-		if (strcmp(words[i], other.words[i]) != 0)
-			return true;
-	}
-	return false;
+	if (data && other.data)
+		return !SameWords(*data, *other.data);
+	return len != other.len;
 }
 
 int WordList::Length() const noexcept {
@@ -101,48 +193,35 @@ int WordList::Length() const noexcept {
 }
 
 void WordList::Clear() noexcept {
-	delete []list;
-	list = nullptr;
-	delete []words;
+	Release(data);
+	data = nullptr;
 	words = nullptr;
+	starts = nullptr;
 	len = 0;
 }
 
 bool WordList::Set(const char *s, bool lowerCase) {
-	const size_t lenS = strlen(s) + 1;
-	std::unique_ptr<char[]> listTemp = std::make_unique<char[]>(lenS);
-	memcpy(listTemp.get(), s, lenS);
+	WordListData *interned = nullptr;
 	if (lowerCase) {
-		for (size_t i = 0; i < lenS; i++) {
-			listTemp[i] = MakeLowerCase(listTemp[i]);
+		std::string lowered(s);
+		for (char &ch : lowered) {
+			ch = MakeLowerCase(ch);
 		}
+		interned = Acquire(lowered, onlyLineEnds);
+	} else {
+		interned = Acquire(s, onlyLineEnds);
 	}
-	size_t lenTemp = 0;
-	std::unique_ptr<char *[]> wordsTemp = ArrayFromWordList(listTemp.get(), lenS - 1, &lenTemp, onlyLineEnds);
-	std::sort(wordsTemp.get(), wordsTemp.get() + lenTemp, cmpWords);
-
-	if (lenTemp == len) {
-		bool changed = false;
-		for (size_t i = 0; i < lenTemp; i++) {
-			if (strcmp(words[i], wordsTemp[i]) != 0) {
-				changed = true;
-				break;
-			}
-		}
-		if (!changed) {
-			return false;
-		}
+
+	if (data ? SameWords(*data, *interned) : interned->len == 0) {
+		Release(interned);
+		return false;
 	}
 
 	Clear();
-	words = wordsTemp.release();
-	list = listTemp.release();
-	len = lenTemp;
-	std::fill(starts, std::end(starts), -1);
-	for (int l = static_cast<int>(len - 1); l >= 0; l--) {
-		unsigned char const indexChar = words[l][0];
-		starts[indexChar] = l;
-	}
+	data = interned;
+	words = data->words.get();
+	len = data->len;
+	starts = data->starts;
 	return true;
 }
 
@@ -10,15 +10,19 @@
 
 namespace Lexilla {
 
+struct WordListData;
+
 /**
+ * The parsed and sorted words are interned: every WordList set to the same text
+ * shares one read-only copy, so many lexers of one language hold their keywords once.
  */
 class WordList {
+	WordListData *data;
 	// Each word contains at least one character - an empty word acts as sentinel at the end.
 	char **words;
-	char *list;
 	size_t len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
-	int starts[256];
+	const int *starts;
 public:
 	explicit WordList(bool onlyLineEnds_ = false) noexcept;
 	// Deleted so WordList objects can not be copied.
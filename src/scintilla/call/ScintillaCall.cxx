@@ -1259,6 +1259,14 @@ ChangeHistoryOption ScintillaCall::ChangeHistory() {
 	return static_cast<Scintilla::ChangeHistoryOption>(Call(Message::GetChangeHistory));
 }
 
+void ScintillaCall::CompactChangeHistory() {
+	Call(Message::CompactChangeHistory);
+}
+
+Position ScintillaCall::ChangeHistoryMemory() {
+	return Call(Message::GetChangeHistoryMemory);
+}
+
 Line ScintillaCall::FirstVisibleLine() {
 	return Call(Message::GetFirstVisibleLine);
 }
@@ -1583,6 +1591,10 @@ FoldLevel ScintillaCall::FoldLevel(Line line) {
 	return static_cast<Scintilla::FoldLevel>(Call(Message::GetFoldLevel, line));
 }
 
+Line ScintillaCall::GetFoldLevels(Line line, void *levels) {
+	return CallPointer(Message::GetFoldLevels, line, levels);
+}
+
 Line ScintillaCall::LastChild(Line line, Scintilla::FoldLevel level) {
 	return Call(Message::GetLastChild, line, static_cast<intptr_t>(level));
 }
@@ -1599,6 +1611,14 @@ void ScintillaCall::HideLines(Line lineStart, Line lineEnd) {
 	Call(Message::HideLines, lineStart, lineEnd);
 }
 
+void ScintillaCall::ShowLineArray(Line count, void *lines) {
+	CallPointer(Message::ShowLineArray, count, lines);
+}
+
+void ScintillaCall::HideLineArray(Line count, void *lines) {
+	CallPointer(Message::HideLineArray, count, lines);
+}
+
 bool ScintillaCall::LineVisible(Line line) {
 	return Call(Message::GetLineVisible, line);
 }
@@ -1659,6 +1679,10 @@ void ScintillaCall::FoldAll(Scintilla::FoldAction action) {
 	Call(Message::FoldAll, static_cast<uintptr_t>(action));
 }
 
+void ScintillaCall::FoldAllAtLevel(Scintilla::FoldAction action, int level) {
+	Call(Message::FoldAllAtLevel, static_cast<uintptr_t>(action), level);
+}
+
 void ScintillaCall::EnsureVisible(Line line) {
 	Call(Message::EnsureVisible, line);
 }
@@ -2991,6 +3015,10 @@ void ScintillaCall::AddSelection(Position caret, Position anchor) {
 	Call(Message::AddSelection, caret, anchor);
 }
 
+void ScintillaCall::SetSelections(Position count, void *positions) {
+	CallPointer(Message::SetSelections, count, positions);
+}
+
 int ScintillaCall::SelectionFromPoint(int x, int y) {
 	return static_cast<int>(Call(Message::SelectionFromPoint, x, y));
 }
@@ -532,6 +532,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_CHANGE_HISTORY_INDICATORS 4
 #define SCI_SETCHANGEHISTORY 2780
 #define SCI_GETCHANGEHISTORY 2781
+#define SCI_COMPACTCHANGEHISTORY 2993
+#define SCI_GETCHANGEHISTORYMEMORY 2994
 #define SCI_GETFIRSTVISIBLELINE 2152
 #define SCI_GETLINE 2153
 #define SCI_GETLINECOUNT 2154
@@ -614,10 +616,13 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_FOLDLEVELNUMBERMASK 0x0FFF
 #define SCI_SETFOLDLEVEL 2222
 #define SCI_GETFOLDLEVEL 2223
+#define SCI_GETFOLDLEVELS 2997
 #define SCI_GETLASTCHILD 2224
 #define SCI_GETFOLDPARENT 2225
 #define SCI_SHOWLINES 2226
 #define SCI_HIDELINES 2227
+#define SCI_SHOWLINEARRAY 2995
+#define SCI_HIDELINEARRAY 2996
 #define SCI_GETLINEVISIBLE 2228
 #define SCI_GETALLLINESVISIBLE 2236
 #define SCI_SETFOLDEXPANDED 2229
@@ -639,6 +644,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_FOLDCHILDREN 2238
 #define SCI_EXPANDCHILDREN 2239
 #define SCI_FOLDALL 2662
+#define SCI_FOLDALLATLEVEL 2998
 #define SCI_ENSUREVISIBLE 2232
 #define SC_AUTOMATICFOLD_NONE 0x0000
 #define SC_AUTOMATICFOLD_SHOW 0x0001
@@ -1059,6 +1065,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_CLEARSELECTIONS 2571
 #define SCI_SETSELECTION 2572
 #define SCI_ADDSELECTION 2573
+#define SCI_SETSELECTIONS 2999
 #define SCI_SELECTIONFROMPOINT 2474
 #define SCI_DROPSELECTIONN 2671
 #define SCI_SETMAINSELECTION 2574
@@ -360,6 +360,8 @@ public:
 	Position FormatRangeFull(bool draw, RangeToFormatFull *fr);
 	void SetChangeHistory(Scintilla::ChangeHistoryOption changeHistory);
 	Scintilla::ChangeHistoryOption ChangeHistory();
+	void CompactChangeHistory();
+	Position ChangeHistoryMemory();
 	Line FirstVisibleLine();
 	Position GetLine(Line line, char *text);
 	std::string GetLine(Line line);
@@ -441,10 +443,13 @@ public:
 	Line WrapCount(Line docLine);
 	void SetFoldLevel(Line line, Scintilla::FoldLevel level);
 	Scintilla::FoldLevel FoldLevel(Line line);
+	Line GetFoldLevels(Line line, void *levels);
 	Line LastChild(Line line, Scintilla::FoldLevel level);
 	Line FoldParent(Line line);
 	void ShowLines(Line lineStart, Line lineEnd);
 	void HideLines(Line lineStart, Line lineEnd);
+	void ShowLineArray(Line count, void *lines);
+	void HideLineArray(Line count, void *lines);
 	bool LineVisible(Line line);
 	bool AllLinesVisible();
 	void SetFoldExpanded(Line line, bool expanded);
@@ -460,6 +465,7 @@ public:
 	void FoldChildren(Line line, Scintilla::FoldAction action);
 	void ExpandChildren(Line line, Scintilla::FoldLevel level);
 	void FoldAll(Scintilla::FoldAction action);
+	void FoldAllAtLevel(Scintilla::FoldAction action, int level);
 	void EnsureVisible(Line line);
 	void SetAutomaticFold(Scintilla::AutomaticFold automaticFold);
 	Scintilla::AutomaticFold AutomaticFold();
@@ -793,6 +799,7 @@ public:
 	void ClearSelections();
 	void SetSelection(Position caret, Position anchor);
 	void AddSelection(Position caret, Position anchor);
+	void SetSelections(Position count, void *positions);
 	int SelectionFromPoint(int x, int y);
 	void DropSelectionN(int selection);
 	void SetMainSelection(int selection);
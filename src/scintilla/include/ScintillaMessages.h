@@ -285,6 +285,8 @@ enum class Message {
 	FormatRangeFull = 2777,
 	SetChangeHistory = 2780,
 	GetChangeHistory = 2781,
+	CompactChangeHistory = 2993,
+	GetChangeHistoryMemory = 2994,
 	GetFirstVisibleLine = 2152,
 	GetLine = 2153,
 	GetLineCount = 2154,
@@ -362,10 +364,13 @@ enum class Message {
 	WrapCount = 2235,
 	SetFoldLevel = 2222,
 	GetFoldLevel = 2223,
+	GetFoldLevels = 2997,
 	GetLastChild = 2224,
 	GetFoldParent = 2225,
 	ShowLines = 2226,
 	HideLines = 2227,
+	ShowLineArray = 2995,
+	HideLineArray = 2996,
 	GetLineVisible = 2228,
 	GetAllLinesVisible = 2236,
 	SetFoldExpanded = 2229,
@@ -380,6 +385,7 @@ enum class Message {
 	FoldChildren = 2238,
 	ExpandChildren = 2239,
 	FoldAll = 2662,
+	FoldAllAtLevel = 2998,
 	EnsureVisible = 2232,
 	SetAutomaticFold = 2663,
 	GetAutomaticFold = 2664,
@@ -702,6 +708,7 @@ enum class Message {
 	ClearSelections = 2571,
 	SetSelection = 2572,
 	AddSelection = 2573,
+	SetSelections = 2999,
 	SelectionFromPoint = 2474,
 	DropSelectionN = 2671,
 	SetMainSelection = 2574,
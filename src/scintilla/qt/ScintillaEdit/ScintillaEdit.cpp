@@ -1136,6 +1136,14 @@ sptr_t ScintillaEdit::changeHistory() const {
     return send(SCI_GETCHANGEHISTORY, 0, 0);
 }
 
+void ScintillaEdit::compactChangeHistory() {
+    send(SCI_COMPACTCHANGEHISTORY, 0, 0);
+}
+
+sptr_t ScintillaEdit::changeHistoryMemory() const {
+    return send(SCI_GETCHANGEHISTORYMEMORY, 0, 0);
+}
+
 sptr_t ScintillaEdit::firstVisibleLine() const {
     return send(SCI_GETFIRSTVISIBLELINE, 0, 0);
 }
@@ -1436,6 +1444,10 @@ sptr_t ScintillaEdit::foldLevel(sptr_t line) const {
     return send(SCI_GETFOLDLEVEL, line, 0);
 }
 
+sptr_t ScintillaEdit::getFoldLevels(sptr_t line, sptr_t levels) {
+    return send(SCI_GETFOLDLEVELS, line, levels);
+}
+
 sptr_t ScintillaEdit::lastChild(sptr_t line, sptr_t level) const {
     return send(SCI_GETLASTCHILD, line, level);
 }
@@ -1452,6 +1464,14 @@ void ScintillaEdit::hideLines(sptr_t lineStart, sptr_t lineEnd) {
     send(SCI_HIDELINES, lineStart, lineEnd);
 }
 
+void ScintillaEdit::showLineArray(sptr_t count, sptr_t lines) {
+    send(SCI_SHOWLINEARRAY, count, lines);
+}
+
+void ScintillaEdit::hideLineArray(sptr_t count, sptr_t lines) {
+    send(SCI_HIDELINEARRAY, count, lines);
+}
+
 bool ScintillaEdit::lineVisible(sptr_t line) const {
     return send(SCI_GETLINEVISIBLE, line, 0);
 }
@@ -1508,6 +1528,10 @@ void ScintillaEdit::foldAll(sptr_t action) {
     send(SCI_FOLDALL, action, 0);
 }
 
+void ScintillaEdit::foldAllAtLevel(sptr_t action, sptr_t level) {
+    send(SCI_FOLDALLATLEVEL, action, level);
+}
+
 void ScintillaEdit::ensureVisible(sptr_t line) {
     send(SCI_ENSUREVISIBLE, line, 0);
 }
@@ -2796,6 +2820,10 @@ void ScintillaEdit::addSelection(sptr_t caret, sptr_t anchor) {
     send(SCI_ADDSELECTION, caret, anchor);
 }
 
+void ScintillaEdit::setSelections(sptr_t count, sptr_t positions) {
+    send(SCI_SETSELECTIONS, count, positions);
+}
+
 sptr_t ScintillaEdit::selectionFromPoint(sptr_t x, sptr_t y) {
     return send(SCI_SELECTIONFROMPOINT, x, y);
 }
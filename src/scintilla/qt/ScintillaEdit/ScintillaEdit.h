@@ -322,6 +322,8 @@ public:
 	sptr_t printColourMode() const;
 	void setChangeHistory(sptr_t changeHistory);
 	sptr_t changeHistory() const;
+	void compactChangeHistory();
+	sptr_t changeHistoryMemory() const;
 	sptr_t firstVisibleLine() const;
 	QByteArray getLine(sptr_t line);
 	sptr_t lineCount() const;
@@ -397,10 +399,13 @@ public:
 	sptr_t wrapCount(sptr_t docLine);
 	void setFoldLevel(sptr_t line, sptr_t level);
 	sptr_t foldLevel(sptr_t line) const;
+	sptr_t getFoldLevels(sptr_t line, sptr_t levels);
 	sptr_t lastChild(sptr_t line, sptr_t level) const;
 	sptr_t foldParent(sptr_t line) const;
 	void showLines(sptr_t lineStart, sptr_t lineEnd);
 	void hideLines(sptr_t lineStart, sptr_t lineEnd);
+	void showLineArray(sptr_t count, sptr_t lines);
+	void hideLineArray(sptr_t count, sptr_t lines);
 	bool lineVisible(sptr_t line) const;
 	bool allLinesVisible() const;
 	void setFoldExpanded(sptr_t line, bool expanded);
@@ -415,6 +420,7 @@ public:
 	void foldChildren(sptr_t line, sptr_t action);
 	void expandChildren(sptr_t line, sptr_t level);
 	void foldAll(sptr_t action);
+	void foldAllAtLevel(sptr_t action, sptr_t level);
 	void ensureVisible(sptr_t line);
 	void setAutomaticFold(sptr_t automaticFold);
 	sptr_t automaticFold() const;
@@ -737,6 +743,7 @@ public:
 	void clearSelections();
 	void setSelection(sptr_t caret, sptr_t anchor);
 	void addSelection(sptr_t caret, sptr_t anchor);
+	void setSelections(sptr_t count, sptr_t positions);
 	sptr_t selectionFromPoint(sptr_t x, sptr_t y);
 	void dropSelectionN(sptr_t selection);
 	void setMainSelection(sptr_t selection);
@@ -21,6 +21,14 @@
 #include <algorithm>
 #include <memory>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CELLBUFFER_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CELLBUFFER_NEON
+#endif
+
 #include "ScintillaTypes.h"
 
 #include "Debugging.h"
@@ -330,6 +338,48 @@ public:
 	}
 };
 
+namespace {
+
+// Skips over whole 16 byte blocks that cannot contain a line end, returning the start of the first block
+// that might contain one. Blocks are only taken while they lie wholly before end so the caller always has
+// at least one byte left before end. With Unicode line ends any byte >= 0x80 may be part of one.
+const char *SkipPlainBlocks(const char *ptr, const char *end, bool unicodeLineEnds) noexcept {
+	constexpr ptrdiff_t blockSize = 16;
+#if defined(CELLBUFFER_SSE2)
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	while (end - ptr > blockSize) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		__m128i found = _mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, cr));
+		if (unicodeLineEnds) {
+			found = _mm_or_si128(found, block);
+		}
+		if (_mm_movemask_epi8(found) != 0) {
+			break;
+		}
+		ptr += blockSize;
+	}
+#elif defined(CELLBUFFER_NEON)
+	const uint8x16_t lf = vdupq_n_u8('\n');
+	const uint8x16_t cr = vdupq_n_u8('\r');
+	const uint8x16_t high = vdupq_n_u8(unicodeLineEnds ? 0x80 : 0);
+	while (end - ptr > blockSize) {
+		const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t *>(ptr));
+		const uint8x16_t found = vorrq_u8(vorrq_u8(vceqq_u8(block, lf), vceqq_u8(block, cr)), vandq_u8(block, high));
+		if (vmaxvq_u8(found) != 0) {
+			break;
+		}
+		ptr += blockSize;
+	}
+#else
+	(void)end;
+	(void)unicodeLineEnds;
+#endif
+	return ptr;
+}
+
+}
+
 CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 	hasStyles(hasStyles_), largeDocument(largeDocument_) {
 	readOnly = false;
@@ -854,8 +904,15 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 			eolTable[0xa9] = 3;
 		}
 
+		const bool unicodeLineEnds = utf8LineEnds == LineEndType::Unicode;
 		do {
-			// skip to line end
+			// skip to line end, a block at a time while there is nothing interesting in it
+			const char *const skipped = SkipPlainBlocks(ptr, end, unicodeLineEnds);
+			if (skipped != ptr) {
+				ptr = skipped;
+				chBeforePrev = ptr[-2];
+				chPrev = ptr[-1];
+			}
 			ch = *ptr++;
 			uint8_t type;
 			while ((type = eolTable[ch]) == 0 && ptr < end) {
@@ -1291,6 +1348,26 @@ void CellBuffer::ChangeHistorySet(bool set) {
 	}
 }
 
+void CellBuffer::ChangeHistoryCompact() {
+	if (!changeHistory) {
+		return;
+	}
+	const intptr_t lengthOriginal = Length() - uh->Delta(uh->Current());
+	std::unique_ptr<ChangeHistory> compacted = std::make_unique<ChangeHistory>(lengthOriginal);
+	RestoreChangeHistory(uh.get(), compacted.get());
+	// Keep what there was if the undo history doesn't describe the document
+	if (Length() == compacted->Length()) {
+		changeHistory = std::move(compacted);
+	}
+}
+
+size_t CellBuffer::ChangeHistoryMemory() const noexcept {
+	if (changeHistory) {
+		return changeHistory->MemoryUsage();
+	}
+	return 0;
+}
+
 int CellBuffer::EditionAt(Sci::Position pos) const noexcept {
 	if (changeHistory) {
 		return changeHistory->EditionAt(pos);
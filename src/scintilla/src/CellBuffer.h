@@ -197,6 +197,10 @@ public:
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
 	void ChangeHistorySet(bool set);
+	// Rebuild change history from the undo history, dropping whatever has built up that undo can't use.
+	// Not part of upstream Scintilla.
+	void ChangeHistoryCompact();
+	[[nodiscard]] size_t ChangeHistoryMemory() const noexcept;
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept;
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept;
@@ -91,6 +91,10 @@ void ChangeStack::SetSavePoint() noexcept {
 	}
 }
 
+size_t ChangeStack::MemoryUsage() const noexcept {
+	return steps.capacity() * sizeof(int) + changes.capacity() * sizeof(ChangeSpan);
+}
+
 void ChangeStack::Check() const noexcept {
 #ifdef _DEBUG
 	// Ensure count in steps same as insertions;
@@ -317,6 +321,22 @@ size_t ChangeLog::DeletionCount(Sci::Position start, Sci::Position length) const
 	return count;
 }
 
+size_t ChangeLog::MemoryUsage() const noexcept {
+	// Each run is a start and a value, each deletion an element of the sparse vector and its edition set
+	size_t bytes = changeStack.MemoryUsage();
+	bytes += insertEdition.Runs() * (sizeof(Sci::Position) + sizeof(int));
+	bytes += deleteEdition.Elements() * (sizeof(Sci::Position) + sizeof(EditionSetOwned));
+	const Sci::Position length = deleteEdition.Length();
+	for (Sci::Position positionDeletion = 0; positionDeletion <= length;) {
+		const EditionSetOwned &editions = deleteEdition.ValueAt(positionDeletion);
+		if (editions) {
+			bytes += sizeof(EditionSet) + editions->capacity() * sizeof(EditionCount);
+		}
+		positionDeletion = deleteEdition.PositionNext(positionDeletion);
+	}
+	return bytes;
+}
+
 void ChangeLog::Check() const noexcept {
 	assert(insertEdition.Length() == deleteEdition.Length());
 	changeStack.Check();
@@ -477,6 +497,14 @@ Sci::Position ChangeHistory::EditionNextDelete(Sci::Position pos) const noexcept
 	return next;
 }
 
+size_t ChangeHistory::MemoryUsage() const noexcept {
+	size_t bytes = changeLog.MemoryUsage();
+	if (changeLogReversions) {
+		bytes += changeLogReversions->MemoryUsage();
+	}
+	return bytes;
+}
+
 size_t ChangeHistory::DeletionCount(Sci::Position start, Sci::Position length) const noexcept {
 	return changeLog.DeletionCount(start, length);
 }
@@ -54,6 +54,7 @@ public:
 	[[nodiscard]] int PopStep() noexcept;
 	[[nodiscard]] ChangeSpan PopSpan(int maxSteps) noexcept;
 	void SetSavePoint() noexcept;
+	[[nodiscard]] size_t MemoryUsage() const noexcept;
 	void Check() const noexcept;
 };
 
@@ -77,6 +78,7 @@ struct ChangeLog {
 
 	Sci::Position Length() const noexcept;
 	[[nodiscard]] size_t DeletionCount(Sci::Position start, Sci::Position length) const noexcept;
+	[[nodiscard]] size_t MemoryUsage() const noexcept;
 	void Check() const noexcept;
 };
 
@@ -113,6 +115,9 @@ public:
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionNextDelete(Sci::Position pos) const noexcept;
 
+	// Approximate number of bytes allocated. Not part of upstream Scintilla.
+	[[nodiscard]] size_t MemoryUsage() const noexcept;
+
 	// Testing - not used by Scintilla
 	[[nodiscard]] size_t DeletionCount(Sci::Position start, Sci::Position length) const noexcept;
 	EditionSet DeletionsAt(Sci::Position pos) const;
@@ -422,6 +422,8 @@ public:
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
 	void ChangeHistorySet(bool set) { cb.ChangeHistorySet(set); }
+	void ChangeHistoryCompact() { cb.ChangeHistoryCompact(); }
+	[[nodiscard]] size_t ChangeHistoryMemory() const noexcept { return cb.ChangeHistoryMemory(); }
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept { return cb.EditionAt(pos); }
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept { return cb.EditionEndRun(pos); }
 	[[nodiscard]] unsigned int EditionDeletesAt(Sci::Position pos) const noexcept { return cb.EditionDeletesAt(pos); }
@@ -5713,6 +5713,72 @@ void Editor::FoldAll(FoldAction action) {
 	Redraw();
 }
 
+void Editor::FoldAllAtLevel(FoldAction action, int level) {
+	const Sci::Line maxLine = pdoc->LinesTotal();
+	const bool expanding = action == FoldAction::Expand;
+	if (!expanding) {
+		pdoc->EnsureStyledTo(pdoc->Length());
+	}
+	// Each fold at the level is visited once and its children are skipped, so the
+	// fold levels are only read in a single pass over the document
+	for (Sci::Line line = 0; line < maxLine; line++) {
+		const FoldLevel levelLine = pdoc->GetFoldLevel(line);
+		if (LevelIsHeader(levelLine) && (static_cast<int>(LevelNumberPart(levelLine)) - static_cast<int>(FoldLevel::Base) == level)) {
+			Sci::Line lineMaxSubord = line;
+			if (expanding) {
+				// Same as FoldLine, a header hidden by a contracted parent gets shown
+				if (!pcs->GetVisible(line)) {
+					EnsureLineVisible(line, false);
+				}
+				pcs->SetExpanded(line, true);
+				lineMaxSubord = ExpandLine(line);
+			} else {
+				lineMaxSubord = pdoc->GetLastChild(line, LevelNumberPart(levelLine));
+				if (lineMaxSubord > line) {
+					pcs->SetExpanded(line, false);
+					pcs->SetVisible(line + 1, lineMaxSubord, false);
+				}
+			}
+			line = std::max(line, lineMaxSubord);
+		}
+	}
+	if (!expanding && !pcs->GetVisible(pdoc->SciLineFromPosition(sel.MainCaret()))) {
+		// This does not re-expand the fold
+		EnsureCaretVisible();
+	}
+	SetScrollBars();
+	Redraw();
+}
+
+void Editor::SetLineArrayVisible(size_t count, const Sci::Position *lines, bool visible) {
+	if (!lines || count == 0) {
+		return;
+	}
+	const Sci::Line maxLine = pdoc->LinesTotal() - 1;
+	bool changed = false;
+	size_t i = 0;
+	while (i < count) {
+		// Lines are sorted so each run of consecutive lines is a single range update
+		const Sci::Line lineStart = lines[i];
+		Sci::Line lineEnd = lineStart;
+		i++;
+		while (i < count && lines[i] == lineEnd + 1) {
+			lineEnd = lines[i];
+			i++;
+		}
+		if (lineStart > maxLine || lineEnd < 0) {
+			continue;
+		}
+		if (pcs->SetVisible(std::max<Sci::Line>(lineStart, 0), std::min(lineEnd, maxLine), visible)) {
+			changed = true;
+		}
+	}
+	if (changed) {
+		SetScrollBars();
+		Redraw();
+	}
+}
+
 void Editor::FoldChanged(Sci::Line line, FoldLevel levelNow, FoldLevel levelPrev) {
 	if (LevelIsHeader(levelNow)) {
 		if (!LevelIsHeader(levelPrev)) {
@@ -7757,6 +7823,17 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetFoldLevel:
 		return pdoc->GetLevel(LineFromUPtr(wParam));
 
+	case Message::GetFoldLevels: {
+			const Sci::Line lineStart = std::clamp<Sci::Line>(LineFromUPtr(wParam), 0, pdoc->LinesTotal());
+			int *levels = static_cast<int *>(PtrFromSPtr(lParam));
+			if (!levels)
+				return pdoc->LinesTotal() - lineStart;
+			for (Sci::Line line = lineStart; line < pdoc->LinesTotal(); line++) {
+				*levels++ = pdoc->GetLevel(line);
+			}
+			return pdoc->LinesTotal() - lineStart;
+		}
+
 	case Message::GetLastChild:
 		return pdoc->GetLastChild(LineFromUPtr(wParam), OptionalFoldLevel(lParam));
 
@@ -7775,6 +7852,11 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		Redraw();
 		break;
 
+	case Message::ShowLineArray:
+	case Message::HideLineArray:
+		SetLineArrayVisible(wParam, static_cast<const Sci::Position *>(PtrFromSPtr(lParam)), iMessage == Message::ShowLineArray);
+		break;
+
 	case Message::GetLineVisible:
 		return pcs->GetVisible(LineFromUPtr(wParam));
 
@@ -7837,6 +7919,10 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		FoldAll(static_cast<FoldAction>(wParam));
 		break;
 
+	case Message::FoldAllAtLevel:
+		FoldAllAtLevel(static_cast<FoldAction>(wParam), static_cast<int>(lParam));
+		break;
+
 	case Message::ExpandChildren:
 		FoldExpand(LineFromUPtr(wParam), FoldAction::Expand, static_cast<FoldLevel>(lParam));
 		break;
@@ -8601,6 +8687,14 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetChangeHistory:
 		return static_cast<sptr_t>(changeHistoryOption);
 
+	case Message::CompactChangeHistory:
+		pdoc->ChangeHistoryCompact();
+		Redraw();
+		break;
+
+	case Message::GetChangeHistoryMemory:
+		return pdoc->ChangeHistoryMemory();
+
 	case Message::SetExtraAscent:
 		vs.extraAscent = static_cast<int>(wParam);
 		InvalidateStyleRedraw();
@@ -8833,6 +8927,22 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		Redraw();
 		break;
 
+	case Message::SetSelections: {
+			const Sci::Position *positions = static_cast<const Sci::Position *>(PtrFromSPtr(lParam));
+			const size_t count = wParam;
+			if (count > 0 && positions) {
+				InvalidateWholeSelection();
+				sel.Clear();
+				sel.SetSelection(SelectionRange(pdoc->ClampPositionIntoDocument(positions[0]), pdoc->ClampPositionIntoDocument(positions[1])));
+				for (size_t i = 1; i < count; i++) {
+					sel.AddSelectionWithoutTrim(SelectionRange(pdoc->ClampPositionIntoDocument(positions[i * 2]), pdoc->ClampPositionIntoDocument(positions[i * 2 + 1])));
+				}
+				ContainerNeedsUpdate(Update::Selection);
+				Redraw();
+			}
+		}
+		break;
+
 	case Message::SelectionFromPoint:
 		return SelectionFromPoint(PointFromParameters(wParam, lParam));
 
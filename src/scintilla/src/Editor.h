@@ -592,6 +592,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void FoldChanged(Sci::Line line, Scintilla::FoldLevel levelNow, Scintilla::FoldLevel levelPrev);
 	void NeedShown(Sci::Position pos, Sci::Position len);
 	void FoldAll(Scintilla::FoldAction action);
+	void FoldAllAtLevel(Scintilla::FoldAction action, int level);
+	void SetLineArrayVisible(size_t count, const Sci::Position *lines, bool visible);
 
 	Sci::Position GetTag(char *tagValue, int tagNumber);
 	enum class ReplaceType {basic, patterns, minimal};
@@ -0,0 +1,137 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TestEnvironment.h"
+#include "EditorManager.h"
+#include "MainWindow.h"
+#include "NotepadNextApplication.h"
+#include "ScintillaNext.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QSettings>
+#include <QStandardPaths>
+
+
+TestEnvironment *TestEnvironment::current = Q_NULLPTR;
+
+TestEnvironment::TestEnvironment(int &argc, char **argv)
+{
+    Q_ASSERT(current == Q_NULLPTR);
+    current = this;
+
+    for (int i = 0; i < argc; ++i) {
+        commandLine.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    // Nothing is ever shown, so there is no need for a display. This has to be picked before the application exists.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // Its own name keeps it away from the user's session and anything the application writes next to it
+    QApplication::setOrganizationName("NotepadNext");
+    QApplication::setApplicationName("NotepadNextTests");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, directory.filePath("settings"));
+
+    applicationArgv[0] = argv[0];
+    applicationArgv[1] = Q_NULLPTR;
+    application.reset(new NotepadNextApplication(applicationArgc, applicationArgv));
+
+    // Whatever an earlier run left behind would otherwise be picked up again
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+
+    application->init();
+    processEvents();
+}
+
+TestEnvironment::~TestEnvironment()
+{
+    // The window deletes itself once closed, which has to happen before the application goes
+    closeAllEditors();
+    window()->close();
+    processEvents();
+
+    application.reset();
+
+    current = Q_NULLPTR;
+}
+
+MainWindow *TestEnvironment::window() const
+{
+    return application->getWindow();
+}
+
+QString TestEnvironment::tempPath(const QString &name) const
+{
+    return directory.filePath(name);
+}
+
+ScintillaNext *TestEnvironment::openFile(const QString &filePath) const
+{
+    ScintillaNext *editor = application->getEditorManager()->createEditorFromFile(filePath);
+
+    if (editor) {
+        waitUntilLoaded(editor);
+    }
+
+    return editor;
+}
+
+ScintillaNext *TestEnvironment::newEditor(const QByteArray &text) const
+{
+    ScintillaNext *editor = application->getEditorManager()->createEditor(QStringLiteral("Test"));
+
+    editor->setText(text.constData());
+    editor->emptyUndoBuffer();
+
+    return editor;
+}
+
+void TestEnvironment::closeAllEditors() const
+{
+    const QVector<ScintillaNext *> editors = window()->editors();
+
+    // Opened first so the window never runs out of editors, the same as closing them all from the menu
+    window()->newFile();
+
+    for (ScintillaNext *editor : editors) {
+        editor->close();
+    }
+
+    processEvents();
+}
+
+void TestEnvironment::waitUntilLoaded(ScintillaNext *editor)
+{
+    while (editor->isLoading()) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    }
+}
+
+void TestEnvironment::processEvents()
+{
+    QCoreApplication::processEvents();
+
+    // Nothing is running the event loop, so anything closed with deleteLater() has to be deleted by hand
+    QCoreApplication::sendPostedEvents(Q_NULLPTR, QEvent::DeferredDelete);
+}
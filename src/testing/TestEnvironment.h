@@ -0,0 +1,75 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TESTENVIRONMENT_H
+#define TESTENVIRONMENT_H
+
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <memory>
+
+
+class MainWindow;
+class NotepadNextApplication;
+class ScintillaNext;
+
+// Starts the whole application the same way main() does, but without a display and with its settings and session
+// kept away from the user's, so the benchmarks and tests drive the same editors the user gets. There can only be one,
+// since there is only one application. The application doesn't see the command line, QtTest gets all of it.
+class TestEnvironment
+{
+public:
+    TestEnvironment(int &argc, char **argv);
+    ~TestEnvironment();
+
+    static TestEnvironment *instance() { return current; }
+
+    NotepadNextApplication *app() const { return application.get(); }
+    MainWindow *window() const;
+
+    QStringList arguments() const { return commandLine; }
+
+    // Somewhere to write files that goes away with the environment
+    QString tempPath(const QString &name) const;
+
+    // Opens the file the same way the user does and waits for it to finish loading, even if it is done in the background
+    ScintillaNext *openFile(const QString &filePath) const;
+    ScintillaNext *newEditor(const QByteArray &text) const;
+
+    // Closes every editor in the window without asking to save them, and leaves a new empty one like at start up
+    void closeAllEditors() const;
+
+    static void waitUntilLoaded(ScintillaNext *editor);
+
+    // Waits for anything queued to the event loop to run, e.g. background results being posted back
+    static void processEvents();
+
+private:
+    static TestEnvironment *current;
+
+    QTemporaryDir directory;
+    QStringList commandLine;
+
+    int applicationArgc = 1;
+    char *applicationArgv[2];
+    std::unique_ptr<NotepadNextApplication> application;
+};
+
+#endif // TESTENVIRONMENT_H
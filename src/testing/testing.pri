@@ -0,0 +1,31 @@
+# This file is part of Notepad Next.
+# Copyright 2024 Justin Dailey
+#
+# Notepad Next is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Notepad Next is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+
+# What the benchmarks and tests share: the whole editor, built the same way as the application, and
+# TestEnvironment to start it without a display or the user's settings.
+
+QT += testlib
+
+CONFIG += console
+CONFIG -= app_bundle
+
+include($$PWD/../Config.pri)
+include($$PWD/../NotepadNext/NotepadNext.pri)
+
+SOURCES += $$PWD/TestEnvironment.cpp
+HEADERS += $$PWD/TestEnvironment.h
+
+INCLUDEPATH += $$PWD
@@ -0,0 +1,113 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BufferSearcherTests.h"
+#include "TestEnvironment.h"
+
+#include "BufferSearcher.h"
+#include "ScintillaNext.h"
+
+#include <QtTest>
+
+
+// Every match Scintilla finds in the whole document, the way Finder does it when BufferSearcher can't be used
+static std::vector<Sci_CharacterRange> scintillaMatches(ScintillaNext *editor, const QByteArray &pattern, int flags)
+{
+    std::vector<Sci_CharacterRange> matches;
+    const sptr_t length = editor->length();
+    sptr_t start = 0;
+
+    editor->setSearchFlags(flags);
+
+    while (start < length) {
+        editor->setTargetRange(start, length);
+
+        const sptr_t found = editor->searchInTarget(pattern.length(), pattern.constData());
+        if (found == -1 || editor->targetEnd() == found)
+            break;
+
+        matches.push_back({static_cast<Sci_PositionCR>(found), static_cast<Sci_PositionCR>(editor->targetEnd())});
+        start = editor->targetEnd();
+    }
+
+    return matches;
+}
+
+static QByteArray describe(const std::vector<Sci_CharacterRange> &matches)
+{
+    QByteArray text;
+
+    for (const Sci_CharacterRange &match : matches) {
+        text += QByteArray::number(match.cpMin) + '-' + QByteArray::number(match.cpMax) + ' ';
+    }
+
+    return text;
+}
+
+void BufferSearcherTests::cleanup()
+{
+    TestEnvironment::instance()->closeAllEditors();
+}
+
+void BufferSearcherTests::wordBoundaries_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<QByteArray>("pattern");
+    QTest::addColumn<int>("flags");
+    QTest::addColumn<QByteArray>("wordChars");
+    QTest::addColumn<bool>("matchAtStart");
+
+    // An empty wordChars keeps the editor's own
+    QTest::newRow("whole word at start") << QByteArray("alpha beta alpha") << QByteArray("alpha") << int(SCFIND_WHOLEWORD) << QByteArray() << true;
+    QTest::newRow("word start at start") << QByteArray("alphabet alpha") << QByteArray("alph") << int(SCFIND_WORDSTART) << QByteArray() << true;
+    QTest::newRow("part of word at start") << QByteArray("alphabet alpha") << QByteArray("alpha") << int(SCFIND_WHOLEWORD) << QByteArray() << false;
+    QTest::newRow("punctuation at start") << QByteArray("(a) (b)") << QByteArray("(") << int(SCFIND_WORDSTART) << QByteArray() << true;
+    QTest::newRow("space at start") << QByteArray(" alpha alpha") << QByteArray(" alpha") << int(SCFIND_WHOLEWORD) << QByteArray() << false;
+    QTest::newRow("match case at start") << QByteArray("Alpha alpha") << QByteArray("Alpha") << int(SCFIND_WHOLEWORD | SCFIND_MATCHCASE) << QByteArray() << true;
+
+    // Scintilla treats the start of the document as a space, so it depends on what a space is
+    QTest::newRow("space is a word character") << QByteArray("alpha beta alpha") << QByteArray("alpha") << int(SCFIND_WORDSTART) << QByteArray("abcdefghijklmnopqrstuvwxyz ") << false;
+}
+
+void BufferSearcherTests::wordBoundaries()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(QByteArray, pattern);
+    QFETCH(int, flags);
+    QFETCH(QByteArray, wordChars);
+    QFETCH(bool, matchAtStart);
+
+    ScintillaNext *editor = TestEnvironment::instance()->newEditor(text);
+    if (!wordChars.isEmpty()) {
+        editor->setWordChars(wordChars.constData());
+    }
+
+    BufferSearcher searcher(pattern, flags);
+    QVERIFY(searcher.canSearch());
+    searcher.setCharacterClasses(editor->wordChars(), editor->whitespaceChars());
+
+    const std::vector<Sci_CharacterRange> expected = scintillaMatches(editor, pattern, flags);
+    const std::vector<Sci_CharacterRange> found = searcher.findAll(text.constData(), text.length(), 0, text.length());
+
+    QCOMPARE(describe(found), describe(expected));
+    QCOMPARE(!found.empty() && found.front().cpMin == 0, matchAtStart);
+
+    // The editor goes through the same searcher, but only sees the document through a view of its buffer
+    QCOMPARE(describe(editor->findAllMatches(pattern, flags)), describe(expected));
+}
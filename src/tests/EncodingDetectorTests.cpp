@@ -0,0 +1,81 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "EncodingDetectorTests.h"
+
+#include "EncodingDetector.h"
+
+#include <QtTest>
+
+
+void EncodingDetectorTests::validUtf8Length_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<int>("validLength");
+
+    // ASCII is skipped 16 bytes at a time, so the first bad byte is moved across every place in a few of those blocks
+    for (int offset = 0; offset < 40; ++offset) {
+        const QByteArray ascii(offset, 'a');
+        const QByteArray after(40, 'b');
+
+        QTest::addRow("invalid byte at %d", offset) << ascii + '\xFF' + after << offset;
+        QTest::addRow("stray continuation at %d", offset) << ascii + '\x80' + after << offset;
+        QTest::addRow("valid sequence at %d", offset) << ascii + "\xE2\x82\xAC" + after << offset + 3 + after.length();
+        QTest::addRow("overlong sequence at %d", offset) << ascii + "\xC0\xAF" + after << offset;
+        QTest::addRow("surrogate at %d", offset) << ascii + "\xED\xA0\x80" + after << offset;
+        QTest::addRow("cut off sequence at %d", offset) << ascii + "\xF0\x9F\x98" << offset + 3;
+    }
+
+    QTest::newRow("empty") << QByteArray() << 0;
+    QTest::newRow("all ASCII") << QByteArray(100, 'x') << 100;
+}
+
+void EncodingDetectorTests::validUtf8Length()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(int, validLength);
+
+    QCOMPARE(EncodingDetector::validUtf8Length(text.constData(), text.length()), static_cast<qsizetype>(validLength));
+}
+
+void EncodingDetectorTests::isPlainAscii_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<bool>("plain");
+
+    for (int offset = 0; offset < 40; ++offset) {
+        const QByteArray ascii(offset, 'a');
+        const QByteArray after(40, 'b');
+
+        QTest::addRow("NUL at %d", offset) << ascii + '\0' + after << false;
+        QTest::addRow("high byte at %d", offset) << ascii + '\x80' + after << false;
+        QTest::addRow("control character at %d", offset) << ascii + '\x01' + after << true;
+    }
+
+    QTest::newRow("empty") << QByteArray() << true;
+    QTest::newRow("delete") << QByteArray(100, '\x7F') << true;
+}
+
+void EncodingDetectorTests::isPlainAscii()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(bool, plain);
+
+    QCOMPARE(EncodingDetector::isPlainAscii(text.constData(), text.length()), plain);
+}
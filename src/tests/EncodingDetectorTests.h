@@ -0,0 +1,38 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ENCODINGDETECTORTESTS_H
+#define ENCODINGDETECTORTESTS_H
+
+#include <QObject>
+
+
+class EncodingDetectorTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void validUtf8Length_data();
+    void validUtf8Length();
+
+    void isPlainAscii_data();
+    void isPlainAscii();
+};
+
+#endif // ENCODINGDETECTORTESTS_H
@@ -0,0 +1,117 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "ScintillaNextTests.h"
+#include "TestEnvironment.h"
+
+#include "BookMarkDecorator.h"
+#include "BulkEdit.h"
+#include "ScintillaNext.h"
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QtTest>
+
+
+void ScintillaNextTests::cleanup()
+{
+    TestEnvironment::instance()->closeAllEditors();
+}
+
+void ScintillaNextTests::replaceRangesKeepsBookmarks_data()
+{
+    QTest::addColumn<int>("matches");
+    QTest::addColumn<QByteArray>("replacement");
+    QTest::addColumn<int>("linesPerReplacement");
+
+    // Enough matches to be done as one edit of the text spanning them, and a few to be done one at a time
+    QTest::newRow("bulk") << 2000 << QByteArray("MATCH") << 0;
+    QTest::newRow("bulk adding lines") << 2000 << QByteArray("one\ntwo") << 1;
+    QTest::newRow("bulk removing matches") << 2000 << QByteArray() << 0;
+    QTest::newRow("few") << 10 << QByteArray("one\ntwo") << 1;
+}
+
+void ScintillaNextTests::replaceRangesKeepsBookmarks()
+{
+    QFETCH(int, matches);
+    QFETCH(QByteArray, replacement);
+    QFETCH(int, linesPerReplacement);
+
+    QByteArray text;
+    for (int i = 0; i < matches; ++i) {
+        text += "line " + QByteArray::number(i) + " match\n";
+    }
+
+    ScintillaNext *editor = TestEnvironment::instance()->newEditor(text);
+    BookMarkDecorator *decorator = editor->findChild<BookMarkDecorator*>(QString(), Qt::FindDirectChildrenOnly);
+    QVERIFY(decorator != Q_NULLPTR);
+
+    // Between two matches in the middle of the span
+    const int bookmarkedLine = matches / 2;
+    decorator->toggleBookmark(bookmarkedLine);
+
+    const std::vector<Sci_CharacterRange> ranges = editor->findAllMatches(QByteArrayLiteral("match"), SCFIND_MATCHCASE);
+    QCOMPARE(static_cast<int>(ranges.size()), matches);
+
+    {
+        const BulkEdit be(editor);
+        editor->replaceRanges(ranges, replacement);
+    }
+
+    // Every line before it got its replacement's extra lines
+    const int expectedLine = bookmarkedLine * (1 + linesPerReplacement);
+    QCOMPARE(decorator->bookMarkedLines(), QList<int>{expectedLine});
+    QVERIFY(editor->textRange(editor->positionFromLine(expectedLine), editor->lineEndPosition(expectedLine)).startsWith("line " + QByteArray::number(bookmarkedLine) + ' '));
+}
+
+void ScintillaNextTests::saveTakesOverFromBackgroundSave()
+{
+    TestEnvironment *environment = TestEnvironment::instance();
+    const QString filePath = environment->tempPath(QStringLiteral("save.txt"));
+
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::WriteOnly) && file.write("before\n") > 0);
+    file.close();
+
+    ScintillaNext *editor = environment->openFile(filePath);
+    QVERIFY(editor != Q_NULLPTR);
+
+    QSignalSpy saved(editor, &ScintillaNext::saved);
+    QSignalSpy saveFailed(editor, &ScintillaNext::saveFailed);
+
+    // Saving straight away waits for the background save and then writes the file again
+    editor->appendText(6, "after\n");
+    editor->saveInBackground();
+    editor->save();
+
+    QCOMPARE(saved.count(), 1);
+    QVERIFY(!editor->isSaving());
+
+    // What the background save posts back once it is done has nothing left to do
+    QTest::qWait(200);
+    TestEnvironment::processEvents();
+
+    QCOMPARE(saved.count(), 1);
+    QCOMPARE(saveFailed.count(), 0);
+    QVERIFY(!editor->isSaving());
+    QVERIFY(!editor->modify());
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("before\nafter\n"));
+}
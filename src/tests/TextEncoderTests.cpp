@@ -0,0 +1,66 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TextEncoderTests.h"
+
+#include "TextEncoder.h"
+
+#include <QBuffer>
+#include <QTextCodec>
+#include <QtTest>
+
+
+void TextEncoderTests::writeUtf16_data()
+{
+    QTest::addColumn<QByteArray>("codecName");
+    QTest::addColumn<QByteArray>("text");
+
+    // Short and long runs of ASCII between other characters, since the ASCII is widened 16 bytes at a time
+    const QByteArray mixed = QByteArrayLiteral("a\xC3\xA9" "bc\xE2\x82\xAC" "0123456789abcdefghij\xF0\x9F\x98\x80" "x\n");
+    QByteArray longMixed;
+    for (int i = 0; i < 50; ++i) {
+        longMixed += QByteArray(i, 'q') + mixed;
+    }
+
+    for (const QByteArray &codecName : {QByteArrayLiteral("UTF-16LE"), QByteArrayLiteral("UTF-16BE")}) {
+        QTest::addRow("%s ascii", codecName.constData()) << codecName << QByteArray(100, 'a');
+        QTest::addRow("%s mixed", codecName.constData()) << codecName << mixed;
+        QTest::addRow("%s long mixed", codecName.constData()) << codecName << longMixed;
+        QTest::addRow("%s cut off at the end", codecName.constData()) << codecName << mixed + "\xF0\x9F";
+        QTest::addRow("%s invalid", codecName.constData()) << codecName << mixed + "\xFF" + mixed;
+    }
+}
+
+void TextEncoderTests::writeUtf16()
+{
+    QFETCH(QByteArray, codecName);
+    QFETCH(QByteArray, text);
+
+    QTextCodec *codec = QTextCodec::codecForName(codecName);
+    QVERIFY(codec != Q_NULLPTR);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(TextEncoder::write(buffer, text.constData(), text.length(), codec, false));
+
+    // What the codec makes of the same text, without a byte order mark
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+    const QString unicode = QString::fromUtf8(text);
+    QCOMPARE(buffer.data(), codec->fromUnicode(unicode.constData(), unicode.size(), &state));
+}
@@ -0,0 +1,90 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "TextTransformTests.h"
+
+#include "TextTransform.h"
+
+#include <QtTest>
+
+
+static QByteArray allBytes(int length)
+{
+    QByteArray data(length, Qt::Uninitialized);
+    for (int i = 0; i < length; ++i) {
+        data[i] = static_cast<char>(i * 167 + 13);
+    }
+    return data;
+}
+
+void TextTransformTests::base64Encode_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    // Lengths around the 12 bytes that are encoded at a time, and every byte value
+    for (int length : {0, 1, 2, 3, 11, 12, 13, 14, 15, 24, 25, 26, 27, 100, 1000}) {
+        QTest::addRow("%d bytes", length) << allBytes(length);
+    }
+}
+
+void TextTransformTests::base64Encode()
+{
+    QFETCH(QByteArray, data);
+
+    QByteArray out;
+    QVERIFY(TextTransform::apply(TextTransform::Base64Encode, data.constData(), data.length(), out));
+    QCOMPARE(out, data.toBase64());
+}
+
+void TextTransformTests::base64Decode_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<QByteArray>("data");
+
+    // Lengths around the 16 digits that are decoded at a time
+    for (int length : {1, 2, 11, 12, 13, 24, 25, 100, 1000}) {
+        const QByteArray data = allBytes(length);
+        const QByteArray text = data.toBase64();
+
+        QTest::addRow("%d bytes", length) << text << true << data;
+        QTest::addRow("%d bytes url safe", length) << data.toBase64(QByteArray::Base64UrlEncoding) << true << data;
+
+        // Line breaks that split up the blocks and groups of digits
+        QByteArray wrapped;
+        for (int i = 0; i < text.length(); i += 19) {
+            wrapped += text.mid(i, 19) + "\r\n";
+        }
+        QTest::addRow("%d bytes wrapped", length) << wrapped << true << data;
+
+        QTest::addRow("%d bytes invalid", length) << text + "!" + text << false << QByteArray();
+        QTest::addRow("%d bytes high byte", length) << "\xC3" + text << false << QByteArray();
+    }
+}
+
+void TextTransformTests::base64Decode()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(bool, ok);
+    QFETCH(QByteArray, data);
+
+    QByteArray out;
+    QCOMPARE(TextTransform::apply(TextTransform::Base64Decode, text.constData(), text.length(), out), ok);
+    QCOMPARE(out, data);
+}
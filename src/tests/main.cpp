@@ -0,0 +1,51 @@
+/*
+ * This file is part of Notepad Next.
+ * Copyright 2024 Justin Dailey
+ *
+ * Notepad Next is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Notepad Next is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "BufferSearcherTests.h"
+#include "EncodingDetectorTests.h"
+#include "ScintillaNextTests.h"
+#include "TextEncoderTests.h"
+#include "TextTransformTests.h"
+#include "TestEnvironment.h"
+
+#include <QtTest>
+
+#include <memory>
+#include <vector>
+
+
+int main(int argc, char *argv[])
+{
+    TestEnvironment environment(argc, argv);
+
+    std::vector<std::unique_ptr<QObject>> tests;
+    tests.emplace_back(new BufferSearcherTests);
+    tests.emplace_back(new EncodingDetectorTests);
+    tests.emplace_back(new ScintillaNextTests);
+    tests.emplace_back(new TextEncoderTests);
+    tests.emplace_back(new TextTransformTests);
+
+    int failures = 0;
+
+    for (const std::unique_ptr<QObject> &test : tests) {
+        failures += QTest::qExec(test.get(), environment.arguments());
+    }
+
+    return failures;
+}
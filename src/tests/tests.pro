@@ -0,0 +1,46 @@
+# This file is part of Notepad Next.
+# Copyright 2024 Justin Dailey
+#
+# Notepad Next is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Notepad Next is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Notepad Next.  If not, see <https://www.gnu.org/licenses/>.
+
+# QtTest tests of the editor core. Like the benchmarks they run on real editors inside a whole application that
+# never shows anything, see TestEnvironment. Build them with "CONFIG+=tests" and run them with "make check".
+
+TARGET = tests
+
+TEMPLATE = app
+
+CONFIG += testcase
+
+include(../testing/testing.pri)
+
+SOURCES += \
+    BufferSearcherTests.cpp \
+    EncodingDetectorTests.cpp \
+    ScintillaNextTests.cpp \
+    TextEncoderTests.cpp \
+    TextTransformTests.cpp \
+    main.cpp
+
+HEADERS += \
+    BufferSearcherTests.h \
+    EncodingDetectorTests.h \
+    ScintillaNextTests.h \
+    TextEncoderTests.h \
+    TextTransformTests.h
+
+OBJECTS_DIR = build/obj
+MOC_DIR = build/moc
+RCC_DIR = build/qrc
+UI_DIR = build/ui